@@ -23,6 +23,12 @@
 static bool                            m_advertising_start_pending = false; /**< Flag to keep track of ongoing operations on persistent memory. */
 
 static ble_gap_addr_t                  m_peer_address;     /**< Address of the most recently connected peer, used for direct advertising. */
+static ble_gap_addr_t                  m_last_peer_address;      /**< Address of the central of the most recent connection. */
+static ble_gap_addr_t                  m_reconnect_address;      /**< Address given to @ref ble_advertising_reconnect_start, used instead of requesting one. */
+static bool                            m_reconnect_pending = false; /**< Flag to keep track of an ongoing reconnect. */
+static ble_advdata_template_t          m_adv_template;           /**< Advertising data encoded for advertising without whitelist. */
+static ble_advdata_template_t          m_adv_template_whitelist; /**< Advertising data encoded for advertising with whitelist. */
+static bool                            m_adv_data_whitelist;     /**< True if the whitelist advertising data has been passed to the stack last. */
 static ble_advdata_t                   m_advdata;          /**< Used by the initialization function to set name, appearance, and UUIDs and advertising flags visible to peer devices. */
 static ble_adv_evt_t                   m_adv_evt;          /**< Advertising event propogated to the main application. The event is either a transaction to a new advertising mode, or a request for whitelist or peer address.. */
 static ble_advertising_evt_handler_t   m_evt_handler;      /**< Handler for the advertising events. Can be initialized as NULL if no handling is implemented on in the main application. */
@@ -67,6 +73,31 @@ static void ble_advertising_peer_address_clear()
 }
 
 
+/**@brief Function for passing the precomputed advertising data for a mode to the stack.
+ *
+ * @param[in] whitelist  True for the advertising data of whitelist advertising.
+ */
+static uint32_t adv_data_select(bool whitelist)
+{
+    ble_advdata_template_t const * p_template;
+    uint32_t                       err_code;
+
+    if (whitelist == m_adv_data_whitelist)
+    {
+        return NRF_SUCCESS;
+    }
+
+    // The scan response data is the same for all modes, so it is left unchanged.
+    p_template = whitelist ? &m_adv_template_whitelist : &m_adv_template;
+    err_code   = sd_ble_gap_adv_data_set(p_template->adv_data, p_template->adv_len, NULL, 0);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_adv_data_whitelist = whitelist;
+    }
+    return err_code;
+}
+
+
 /**@brief Function for checking if an address is non-zero. Used to determine if 
  */
 static bool peer_address_exists(uint8_t const * address)
@@ -178,7 +209,22 @@ uint32_t ble_advertising_init(ble_advdata_t const                 * p_advdata,
         m_advdata.p_tx_power_level     = &m_tx_power_level;
         m_advdata.p_tx_power_level     = p_advdata->p_tx_power_level;
     }
-    err_code = ble_advdata_set(&m_advdata, p_srdata);
+
+    // Encode the advertising data of each mode once, so that a mode switch only passes it to the
+    // stack. Whitelist advertising is not discoverable. The data without whitelist is set last.
+    m_reconnect_pending = false;
+    if (m_adv_modes_config.ble_adv_whitelist_enabled)
+    {
+        m_advdata.flags = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
+        err_code        = ble_advdata_template_set(&m_adv_template_whitelist, &m_advdata, NULL);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+        m_advdata.flags = p_advdata->flags;
+    }
+    err_code = ble_advdata_template_set(&m_adv_template, &m_advdata, p_srdata);
+    m_adv_data_whitelist = false;
     return err_code;
 }
 
@@ -213,7 +259,13 @@ uint32_t ble_advertising_start(ble_adv_mode_t advertising_mode)
 
     // Fetch the peer address.
     ble_advertising_peer_address_clear();
-    if (   (m_adv_modes_config.ble_adv_directed_enabled)
+    if (m_reconnect_pending && m_adv_mode_current == BLE_ADV_MODE_DIRECTED)
+    {
+        // Reconnecting: the peer is known already.
+        m_peer_address             = m_reconnect_address;
+        m_peer_addr_reply_expected = false;
+    }
+    else if (   (m_adv_modes_config.ble_adv_directed_enabled)
            && m_adv_mode_current == BLE_ADV_MODE_DIRECTED)
     {
         if (m_evt_handler != NULL)
@@ -229,9 +281,11 @@ uint32_t ble_advertising_start(ble_adv_mode_t advertising_mode)
 
     // If a mode is disabled, continue to the next mode. I.e fast instead of direct, slow instead of fast, idle instead of slow.
     if (  (m_adv_mode_current == BLE_ADV_MODE_DIRECTED)
-        &&(!m_adv_modes_config.ble_adv_directed_enabled || !peer_address_exists(m_peer_address.addr)))
+        &&(!(m_adv_modes_config.ble_adv_directed_enabled || m_reconnect_pending)
+           || !peer_address_exists(m_peer_address.addr)))
     {
-        m_adv_mode_current = BLE_ADV_MODE_FAST;
+        m_adv_mode_current  = BLE_ADV_MODE_FAST;
+        m_reconnect_pending = false;
     }
     if (!m_adv_modes_config.ble_adv_fast_enabled && m_adv_mode_current == BLE_ADV_MODE_FAST)
     {
@@ -287,8 +341,7 @@ uint32_t ble_advertising_start(ble_adv_mode_t advertising_mode)
             {
                 adv_params.fp          = BLE_GAP_ADV_FP_FILTER_CONNREQ;
                 adv_params.p_whitelist = &m_whitelist;
-                m_advdata.flags        = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
-                err_code               = ble_advdata_set(&m_advdata, NULL);
+                err_code               = adv_data_select(true);
                 if(err_code != NRF_SUCCESS)
                 {
                     return err_code;
@@ -299,6 +352,12 @@ uint32_t ble_advertising_start(ble_adv_mode_t advertising_mode)
             }
             else
             {
+                err_code = adv_data_select(false);
+                if(err_code != NRF_SUCCESS)
+                {
+                    return err_code;
+                }
+
                 m_adv_evt = BLE_ADV_EVT_FAST;
                 LOG("[ADV]: Starting fast advertisement.\r\n");
             }
@@ -314,8 +373,7 @@ uint32_t ble_advertising_start(ble_adv_mode_t advertising_mode)
             {
                 adv_params.fp          = BLE_GAP_ADV_FP_FILTER_CONNREQ;
                 adv_params.p_whitelist = &m_whitelist;
-                m_advdata.flags        = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
-                err_code               = ble_advdata_set(&m_advdata, NULL);
+                err_code               = adv_data_select(true);
                 if(err_code != NRF_SUCCESS)
                 {
                     return err_code;
@@ -326,6 +384,12 @@ uint32_t ble_advertising_start(ble_adv_mode_t advertising_mode)
             }
             else
             {
+                err_code = adv_data_select(false);
+                if(err_code != NRF_SUCCESS)
+                {
+                    return err_code;
+                }
+
                 m_adv_evt = BLE_ADV_EVT_SLOW;
                 LOG("[ADV]: Starting slow advertisement.\r\n");
             }
@@ -362,9 +426,13 @@ void ble_advertising_on_ble_evt(ble_evt_t const * p_ble_evt)
             if (p_ble_evt->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_PERIPH)
             {
                 current_slave_link_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+                m_last_peer_address            = p_ble_evt->evt.gap_evt.params.connected.peer_addr;
+                m_reconnect_pending            = false;
             }
 #else
             current_slave_link_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            m_last_peer_address            = p_ble_evt->evt.gap_evt.params.connected.peer_addr;
+            m_reconnect_pending            = false;
 #endif
             break;
 
@@ -411,6 +479,7 @@ void ble_advertising_on_ble_evt(ble_evt_t const * p_ble_evt)
                         else
                         {
                             uint32_t err_code;
+                            m_reconnect_pending = false;
                             err_code = ble_advertising_start(BLE_ADV_MODE_FAST);
                             if ((err_code != NRF_SUCCESS) && (m_error_handler != NULL))
                             {
@@ -553,3 +622,26 @@ uint32_t ble_advertising_restart_without_whitelist(void)
 }
 
 
+uint32_t ble_advertising_reconnect_start(ble_gap_addr_t const * p_peer_addr)
+{
+    if (p_peer_addr == NULL)
+    {
+        if (!peer_address_exists(m_last_peer_address.addr))
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+        p_peer_addr = &m_last_peer_address;
+    }
+
+    if (m_adv_mode_current != BLE_ADV_MODE_IDLE)
+    {
+        // Stop ongoing advertising. It may have timed out already, which is fine.
+        (void)sd_ble_gap_adv_stop();
+    }
+
+    m_reconnect_address = *p_peer_addr;
+    m_reconnect_pending = true;
+    m_direct_adv_cnt    = m_adv_modes_config.ble_adv_directed_timeout;
+
+    return ble_advertising_start(BLE_ADV_MODE_DIRECTED);
+}
@@ -141,7 +141,8 @@ void ble_advertising_on_sys_evt(uint32_t sys_evt);
 
 /**@brief Function for initializing the Advertising Module.
  *
- * @details Encodes the required advertising data and passes it to the stack.
+ * @details Encodes the required advertising data and passes it to the stack. The data for
+ *          whitelist advertising is encoded as well, so that mode switches do not encode again.
  *          Also builds a structure to be passed to the stack when starting advertising.
  *          The supplied advertising data is copied to a local structure and is manipulated
  *          depending on what advertising modes are started in @ref ble_advertising_start.
@@ -209,6 +210,25 @@ uint32_t ble_advertising_whitelist_reply(ble_gap_whitelist_t * p_whitelist);
  * @retval @ref NRF_SUCCESS On success, else an error message propogated from the Softdevice.
  */
 uint32_t ble_advertising_restart_without_whitelist(void);
+
+
+/**@brief Function for reconnecting to a known central.
+ *
+ * @details Starts high duty cycle directed advertising toward the central right away, without
+ *          requesting the peer address from the application. Directed advertising is tried
+ *          ble_adv_directed_timeout more times before continuing with fast advertising as usual.
+ *          Use this to let a central that just used the device, for example the bonded central
+ *          the application last connected to as found with dm_peer_addr_get(), connect within
+ *          tens of milliseconds. Works even if directed advertising is disabled in the
+ *          advertising modes.
+ *
+ * @param[in] p_peer_addr  Address of the central, or NULL for the central of the most recent
+ *                         connection.
+ *
+ * @retval @ref NRF_SUCCESS On success, else an error code from @ref ble_advertising_start.
+ * @retval @ref NRF_ERROR_NOT_FOUND If p_peer_addr is NULL and there has been no connection.
+ */
+uint32_t ble_advertising_reconnect_start(ble_gap_addr_t const * p_peer_addr);
 /** @} */
 
 #endif // BLE_ADVERTISING_H__
@@ -18,6 +18,7 @@
 #include "nordic_common.h"
 
 #define SRV_DISC_START_HANDLE  0x0001                    /**< The start handle value used during service discovery. */
+#define SRV_DISC_END_HANDLE    0xFFFF                    /**< The last handle value of the GATT database at the peer. */
 #define DB_DISCOVERY_MAX_USERS BLE_DB_DISCOVERY_MAX_SRV  /**< The maximum number of users/registrations allowed by this module. */
 #define DB_LOG                 app_trace_log             /**< A debug logger macro that can be used in this file to do logging information over UART. */
 
@@ -28,45 +29,22 @@ static struct
     ble_db_discovery_evt_handler_t evt_handler;  /**< The event handler of the application module to be called in case there are any events.*/
 } m_registered_handlers[DB_DISCOVERY_MAX_USERS];
 
-/**@brief   Array of structures containing pending events to be sent to the application modules.
- *
- * @details Whenever a discovery related event is to be raised to a user module, it will be stored
- *          in this array first. When all services needed to be discovered have been
- *          discovered, all pending events will be sent to the corresponding user modules.
- **/
-static struct
-{
-    ble_db_discovery_evt_t         evt;          /**< The pending event. */
-    ble_db_discovery_evt_handler_t evt_handler;  /**< The event handler which should be called to raise this event. */
-} m_pending_user_evts[DB_DISCOVERY_MAX_USERS];
-
-static uint32_t m_pending_usr_evt_index;    /**< The index to the pending user event array, pointing to the last added pending user event. */
 static uint32_t m_num_of_handlers_reg;      /**< The number of handlers registered with the DB Discovery module. */
-static uint32_t m_num_of_discoveries_made;  /**< The total number of service discoveries (successful or unsuccessful) made since initialization. */
 static bool     m_initialized = false;      /**< This variable Indicates if the module is initialized or not. */
 
-/**@brief     Function for fetching the event handler provided by a registered application module.
- *
- * @param[in] srv_uuid UUID of the service.
- *
- * @retval    evt_handler Event handler of the module, registered for the given service UUID.
- * @retval    NULL If no event handler is found.
+#if (BLE_DB_DISCOVERY_CACHE_SIZE > 0)
+/**@brief   Array of structures containing the databases discovered at bonded peers.
  */
-static ble_db_discovery_evt_handler_t registered_handler_get(ble_uuid_t * p_srv_uuid)
+static struct
 {
-    uint32_t i;
-
-    for (i = 0; i < m_num_of_handlers_reg; i++)
-    {
-        if (BLE_UUID_EQ(&(m_registered_handlers[i].srv_uuid), p_srv_uuid))
-        {
-            return (m_registered_handlers[i].evt_handler);
-        }
-    }
-
-    return NULL;
-}
+    ble_gap_addr_t              peer_addr;                                /**< Address of the peer. */
+    ble_db_discovery_srv_t      services[BLE_DB_DISCOVERY_MAX_SRV];       /**< Services discovered at the peer. */
+    ble_db_discovery_evt_type_t srv_evt_types[BLE_DB_DISCOVERY_MAX_SRV];  /**< Outcome of the discovery of each service. */
+    bool                        in_use;                                   /**< Variable to indicate if the entry holds a database. */
+} m_cache[BLE_DB_DISCOVERY_CACHE_SIZE];
 
+static uint32_t m_cache_next;               /**< The index of the cache entry to be replaced when the cache is full. */
+#endif
 
 /**@brief     Function for storing the event handler provided by a registered application module.
  *
@@ -95,191 +73,132 @@ static uint32_t registered_handler_set(const ble_uuid_t * const       p_srv_uuid
 }
 
 
-/**@brief Function for sending all pending discovery events to the corresponding user modules.
+/**@brief     Function for sending the discovery events of all registered services to the
+ *            corresponding user modules.
+ *
+ * @param[in] p_db_discovery Pointer to the DB discovery structure.
  */
-static void pending_user_evts_send(void)
+static void pending_user_evts_send(ble_db_discovery_t * const p_db_discovery)
 {
-    uint32_t i;
+    uint32_t               i;
+    ble_db_discovery_evt_t evt;
 
     for (i = 0; i < m_num_of_handlers_reg; i++)
     {
+        evt.conn_handle = p_db_discovery->conn_handle;
+        evt.evt_type    = p_db_discovery->srv_evt_types[i];
+
+        if (evt.evt_type == BLE_DB_DISCOVERY_COMPLETE)
+        {
+            evt.params.discovered_db = p_db_discovery->services[i];
+        }
+        else if (evt.evt_type == BLE_DB_DISCOVERY_ERROR)
+        {
+            evt.params.err_code = p_db_discovery->err_code;
+        }
+
         // Pass the event to the corresponding event handler.
-        m_pending_user_evts[i].evt_handler(&(m_pending_user_evts[i].evt));
+        m_registered_handlers[i].evt_handler(&evt);
     }
-    
-    m_pending_usr_evt_index = 0;
 }
 
 
-/**@brief     Function for indicating error to the application.
+#if (BLE_DB_DISCOVERY_CACHE_SIZE > 0)
+/**@brief     Function for finding the cache entry of a peer.
  *
- * @details   This function will fetch the event handler based on the UUID of the service being
- *            discovered. (The event handler is registered by the application beforehand).
- *            The error code is added to the pending events together with the event handler.
- *            If no event handler was found, then this function will do nothing.
- *
- * @param[in] p_db_discovery Pointer to the DB discovery structure.
- * @param[in] err_code       Error code that should be provided to the application.
+ * @param[in] p_peer_addr Address of the peer.
  *
+ * @return    Index of the entry, or BLE_DB_DISCOVERY_CACHE_SIZE if the peer is not in the cache.
  */
-static void discovery_error_evt_trigger(ble_db_discovery_t * const p_db_discovery,
-                                        uint32_t                   err_code)
+static uint32_t cache_find(const ble_gap_addr_t * const p_peer_addr)
 {
-    ble_db_discovery_evt_handler_t p_evt_handler;
-    ble_db_discovery_srv_t       * p_srv_being_discovered;
-
-    p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
-
-    p_evt_handler = registered_handler_get(&(p_srv_being_discovered->srv_uuid));
+    uint32_t i;
 
-    if (p_evt_handler != NULL)
+    for (i = 0; i < BLE_DB_DISCOVERY_CACHE_SIZE; i++)
     {
-        if (m_pending_usr_evt_index < DB_DISCOVERY_MAX_USERS)
+        if (m_cache[i].in_use &&
+            (m_cache[i].peer_addr.addr_type == p_peer_addr->addr_type) &&
+            (memcmp(m_cache[i].peer_addr.addr, p_peer_addr->addr, BLE_GAP_ADDR_LEN) == 0))
         {
-            // Insert an event into the pending event list.
-            m_pending_user_evts[m_pending_usr_evt_index].evt.conn_handle     =
-                p_db_discovery->conn_handle;
-            m_pending_user_evts[m_pending_usr_evt_index].evt.evt_type        =
-                BLE_DB_DISCOVERY_ERROR;
-            m_pending_user_evts[m_pending_usr_evt_index].evt.params.err_code = err_code;
-            m_pending_user_evts[m_pending_usr_evt_index].evt_handler         = p_evt_handler;
-
-            m_pending_usr_evt_index++;
-
-            if (m_pending_usr_evt_index == m_num_of_handlers_reg)
-            {
-                // All registered modules have pending events.
-                // Send all pending events to the user modules.
-                pending_user_evts_send();
-            }
-        }
-        else
-        {
-            // Too many events pending. Do nothing. (Ideally this should not happen.)
+            break;
         }
     }
+
+    return i;
 }
 
 
-/**@brief     Function for triggering a Discovery Complete or Service Not Found event to the
- *            application.
- *
- * @details   This function will fetch the event handler based on the UUID of the service being
- *            discovered. (The event handler is registered by the application beforehand).
- *            It then triggers an event indicating the completion of the service discovery.
- *            If no event handler was found, then this function will do nothing.
+/**@brief     Function for caching the discovered database, if requested at the start of the
+ *            discovery.
  *
  * @param[in] p_db_discovery Pointer to the DB discovery structure.
- * @param[in] is_srv_found   Variable to indicate if the service was found at the peer.
  */
-static void discovery_complete_evt_trigger(ble_db_discovery_t * const p_db_discovery,
-                                           bool                       is_srv_found)
+static void cache_store(ble_db_discovery_t * const p_db_discovery)
 {
-    ble_db_discovery_evt_handler_t p_evt_handler;
-    ble_db_discovery_srv_t       * p_srv_being_discovered;
-
-    p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
-
-    p_evt_handler = registered_handler_get(&(p_srv_being_discovered->srv_uuid));
+    uint32_t i;
 
-    if (p_evt_handler != NULL)
+    if (!p_db_discovery->cache_store)
     {
-        if (m_pending_usr_evt_index < DB_DISCOVERY_MAX_USERS)
-        {
-            // Insert an event into the pending event list.
-            m_pending_user_evts[m_pending_usr_evt_index].evt.conn_handle =
-                p_db_discovery->conn_handle;
-
-            if (is_srv_found)
-            {
-                m_pending_user_evts[m_pending_usr_evt_index].evt.evt_type =
-                    BLE_DB_DISCOVERY_COMPLETE;
-
-                m_pending_user_evts[m_pending_usr_evt_index].evt.params.discovered_db =
-                    *p_srv_being_discovered;
-            }
-            else
-            {
-                m_pending_user_evts[m_pending_usr_evt_index].evt.evt_type =
-                    BLE_DB_DISCOVERY_SRV_NOT_FOUND;
-            }
-            m_pending_user_evts[m_pending_usr_evt_index].evt_handler = p_evt_handler;
+        return;
+    }
 
-            m_pending_usr_evt_index++;
+    i = cache_find(&(p_db_discovery->peer_addr));
 
-            if (m_pending_usr_evt_index == m_num_of_handlers_reg)
-            {
-                // All registered modules have pending events. Send all pending events to the user
-                // modules.
-                pending_user_evts_send();
-            }
-            else
-            {
-                // Too many events pending. Do nothing. (Ideally this should not happen.)
-            }
-        }
+    if (i == BLE_DB_DISCOVERY_CACHE_SIZE)
+    {
+        i            = m_cache_next;
+        m_cache_next = (m_cache_next + 1) % BLE_DB_DISCOVERY_CACHE_SIZE;
     }
+
+    m_cache[i].peer_addr = p_db_discovery->peer_addr;
+    m_cache[i].in_use    = true;
+    memcpy(m_cache[i].services, p_db_discovery->services, sizeof(m_cache[i].services));
+    memcpy(m_cache[i].srv_evt_types,
+           p_db_discovery->srv_evt_types,
+           sizeof(m_cache[i].srv_evt_types));
 }
+#endif
 
 
-/**@brief     Function for handling service discovery completion.
+/**@brief     Function for indicating error to the application.
  *
- * @details   This function will be used to determine if there are more services to be discovered,
- *            and if so, initiate the discovery of the next service.
+ * @details   The discovery is stopped. The service being discovered and the services after it get
+ *            an error event, and the events of all registered services are sent.
+ *
+ * @param[in] p_db_discovery Pointer to the DB discovery structure.
+ * @param[in] err_code       Error code that should be provided to the application.
  *
- * @param[in] p_db_discovery Pointer to the DB Discovery Structure.
  */
-static void on_srv_disc_completion(ble_db_discovery_t * p_db_discovery)
+static void discovery_error_evt_trigger(ble_db_discovery_t * const p_db_discovery,
+                                        uint32_t                   err_code)
 {
-    m_num_of_discoveries_made++;
-
-    // Check if more services need to be discovered.
-    if (m_num_of_discoveries_made < m_num_of_handlers_reg)
-    {
-        // Reset the current characteristic index since a new service discovery is about to start.
-        p_db_discovery->curr_char_ind = 0;
-
-        // Initiate discovery of the next service.
-        p_db_discovery->curr_srv_ind++;
-
-        ble_db_discovery_srv_t * p_srv_being_discovered;
-
-        p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
-
-        p_srv_being_discovered->srv_uuid =
-            m_registered_handlers[p_db_discovery->curr_srv_ind].srv_uuid;
+    uint32_t i;
 
-        // Reset the characteristic count in the current service to zero since a new service
-        // discovery is about to start.
-        p_srv_being_discovered->char_count = 0;
+    p_db_discovery->discovery_in_progress = false;
+    p_db_discovery->err_code              = err_code;
 
-        DB_LOG("[DB]: Starting discovery of service with UUID 0x%x for Connection handle %d\r\n",
-               p_srv_being_discovered->srv_uuid.uuid, p_db_discovery->conn_handle);
+    for (i = p_db_discovery->curr_srv_ind; i < m_num_of_handlers_reg; i++)
+    {
+        p_db_discovery->srv_evt_types[i] = BLE_DB_DISCOVERY_ERROR;
+    }
 
-        uint32_t err_code;
+    pending_user_evts_send(p_db_discovery);
+}
 
-        err_code = sd_ble_gattc_primary_services_discover
-                   (
-                   p_db_discovery->conn_handle,
-                   SRV_DISC_START_HANDLE,
-                   &(p_srv_being_discovered->srv_uuid)
-                   );
-        if (err_code != NRF_SUCCESS)
-        {
-            p_db_discovery->discovery_in_progress = false;
 
-            // Error with discovering the service.
-            // Indicate the error to the registered user application.
-            discovery_error_evt_trigger(p_db_discovery, err_code);
-
-            return;
-        }
-    }
-    else
-    {
-        // No more service discovery is needed.
-        p_db_discovery->discovery_in_progress = false;
-    }
+/**@brief     Function for recording the outcome of the discovery of the current service.
+ *
+ * @details   The Discovery Complete or Service Not Found event is sent to the application when the
+ *            discovery of all registered services has finished.
+ *
+ * @param[in] p_db_discovery Pointer to the DB discovery structure.
+ * @param[in] is_srv_found   Variable to indicate if the service was found at the peer.
+ */
+static void discovery_complete_evt_trigger(ble_db_discovery_t * const p_db_discovery,
+                                           bool                       is_srv_found)
+{
+    p_db_discovery->srv_evt_types[p_db_discovery->curr_srv_ind] =
+        is_srv_found ? BLE_DB_DISCOVERY_COMPLETE : BLE_DB_DISCOVERY_SRV_NOT_FOUND;
 }
 
 
@@ -421,6 +340,85 @@ static uint32_t characteristics_discover(ble_db_discovery_t * const p_db_discove
 }
 
 
+/**@brief     Function for starting the discovery of a service, or finishing the discovery if there
+ *            are no more services to be discovered.
+ *
+ * @details   In full range mode the handle ranges of all services are already known, so the
+ *            discovery of the characteristics is started directly. The services not found by the
+ *            discovery of all primary services are skipped.
+ *
+ * @param[in] p_db_discovery Pointer to the DB Discovery Structure.
+ * @param[in] srv_ind        Index of the service to be discovered.
+ */
+static void srv_disc_start(ble_db_discovery_t * const p_db_discovery, uint8_t srv_ind)
+{
+    uint32_t                 err_code;
+    ble_db_discovery_srv_t * p_srv_being_discovered;
+
+#if BLE_DB_DISCOVERY_FULL_RANGE
+    while ((srv_ind < m_num_of_handlers_reg) &&
+           (p_db_discovery->services[srv_ind].handle_range.start_handle == 0))
+    {
+        srv_ind++;
+    }
+#endif
+
+    p_db_discovery->curr_srv_ind = srv_ind;
+
+    if (srv_ind >= m_num_of_handlers_reg)
+    {
+        // No more service discovery is needed.
+        p_db_discovery->discovery_in_progress = false;
+
+#if (BLE_DB_DISCOVERY_CACHE_SIZE > 0)
+        cache_store(p_db_discovery);
+#endif
+        pending_user_evts_send(p_db_discovery);
+
+        return;
+    }
+
+    // Reset the current characteristic index since a new service discovery is about to start.
+    p_db_discovery->curr_char_ind = 0;
+
+    p_srv_being_discovered = &(p_db_discovery->services[srv_ind]);
+
+    // Reset the characteristic count in the current service to zero since a new service
+    // discovery is about to start.
+    p_srv_being_discovered->char_count = 0;
+
+    DB_LOG("[DB]: Starting discovery of service with UUID 0x%x for Connection handle %d\r\n",
+           p_srv_being_discovered->srv_uuid.uuid, p_db_discovery->conn_handle);
+
+#if BLE_DB_DISCOVERY_FULL_RANGE
+    err_code = characteristics_discover(p_db_discovery);
+#else
+    err_code = sd_ble_gattc_primary_services_discover(p_db_discovery->conn_handle,
+                                                      SRV_DISC_START_HANDLE,
+                                                      &(p_srv_being_discovered->srv_uuid));
+#endif
+    if (err_code != NRF_SUCCESS)
+    {
+        // Error with discovering the service.
+        // Indicate the error to the registered user application.
+        discovery_error_evt_trigger(p_db_discovery, err_code);
+    }
+}
+
+
+/**@brief     Function for handling service discovery completion.
+ *
+ * @details   This function will be used to determine if there are more services to be discovered,
+ *            and if so, initiate the discovery of the next service.
+ *
+ * @param[in] p_db_discovery Pointer to the DB Discovery Structure.
+ */
+static void on_srv_disc_completion(ble_db_discovery_t * p_db_discovery)
+{
+    srv_disc_start(p_db_discovery, p_db_discovery->curr_srv_ind + 1);
+}
+
+
 /**@brief      Function for performing descriptor discovery, if required.
  *
  * @details    This function will check if descriptor discovery is required and then perform it if
@@ -513,6 +511,122 @@ static uint32_t descriptors_discover(ble_db_discovery_t * const p_db_discovery,
 }
 
 
+#if BLE_DB_DISCOVERY_FULL_RANGE
+/**@brief      Function for performing descriptor discovery over the rest of the service.
+ *
+ * @details    All descriptors of the service are requested with one handle range, from the first
+ *             characteristic value to the end of the service. The peer returns as many of them as
+ *             fit in one response, and the discovery is continued from the last one returned.
+ *
+ * @param[in]  p_db_discovery           Pointer to the DB Discovery structure.
+ * @param[in]  start_handle             Handle to start the discovery from.
+ * @param[out] p_raise_discov_complete  The value pointed to by this pointer will be set to true if
+ *                                      the Discovery Complete event can be triggered to the
+ *                                      application.
+ *
+ * @return     NRF_SUCCESS if the SoftDevice was successfully requested to perform the descriptor
+ *             discovery, or if no more descriptor discovery is required. Otherwise an error code.
+ *             This function returns the error code returned by the SoftDevice API @ref
+ *             sd_ble_gattc_descriptors_discover.
+ */
+static uint32_t descriptors_batch_discover(ble_db_discovery_t * const p_db_discovery,
+                                           uint32_t                   start_handle,
+                                           bool *                     p_raise_discov_complete)
+{
+    ble_gattc_handle_range_t handle_range;
+    ble_db_discovery_srv_t * p_srv_being_discovered;
+
+    p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
+
+    if ((p_srv_being_discovered->char_count == 0) ||
+        (start_handle > p_srv_being_discovered->handle_range.end_handle))
+    {
+        // No descriptors can be present.
+        *p_raise_discov_complete = true;
+
+        return NRF_SUCCESS;
+    }
+
+    handle_range.start_handle = (uint16_t)start_handle;
+    handle_range.end_handle   = p_srv_being_discovered->handle_range.end_handle;
+
+    *p_raise_discov_complete = false;
+
+    return sd_ble_gattc_descriptors_discover(p_db_discovery->conn_handle,
+                                             &handle_range);
+}
+#endif
+
+
+#if BLE_DB_DISCOVERY_FULL_RANGE
+/**@brief     Function for handling the response to the discovery of all primary services.
+ *
+ * @details   The handle range of the first instance of each registered service is recorded. The
+ *            discovery continues after the last service of the response until the peer reports
+ *            that there are no more services, and then the characteristics of the services found
+ *            are discovered.
+ *
+ * @param[in] p_db_discovery    Pointer to the DB Discovery structure.
+ * @param[in] p_ble_gattc_evt   Pointer to the GATT Client event.
+ */
+static void on_primary_srv_discovery_rsp(ble_db_discovery_t * const    p_db_discovery,
+                                         const ble_gattc_evt_t * const p_ble_gattc_evt)
+{
+    uint32_t next_handle = 0;
+
+    if (p_ble_gattc_evt->gatt_status == BLE_GATT_STATUS_SUCCESS)
+    {
+        const ble_gattc_evt_prim_srvc_disc_rsp_t * p_prim_srvc_disc_rsp_evt;
+        uint32_t                                   i;
+        uint32_t                                   j;
+
+        p_prim_srvc_disc_rsp_evt = &(p_ble_gattc_evt->params.prim_srvc_disc_rsp);
+
+        for (i = 0; i < p_prim_srvc_disc_rsp_evt->count; i++)
+        {
+            for (j = 0; j < m_num_of_handlers_reg; j++)
+            {
+                if (BLE_UUID_EQ(&(p_prim_srvc_disc_rsp_evt->services[i].uuid),
+                                &(p_db_discovery->services[j].srv_uuid)) &&
+                    (p_db_discovery->services[j].handle_range.start_handle == 0))
+                {
+                    p_db_discovery->services[j].handle_range =
+                        p_prim_srvc_disc_rsp_evt->services[i].handle_range;
+                }
+            }
+        }
+
+        if (p_prim_srvc_disc_rsp_evt->count != 0)
+        {
+            next_handle =
+                p_prim_srvc_disc_rsp_evt->services[p_prim_srvc_disc_rsp_evt->count - 1]
+                .handle_range.end_handle + 1;
+
+            if (next_handle > SRV_DISC_END_HANDLE)
+            {
+                next_handle = 0;
+            }
+        }
+    }
+
+    if (next_handle != 0)
+    {
+        uint32_t err_code;
+
+        err_code = sd_ble_gattc_primary_services_discover(p_db_discovery->conn_handle,
+                                                          (uint16_t)next_handle,
+                                                          NULL);
+        if (err_code != NRF_SUCCESS)
+        {
+            discovery_error_evt_trigger(p_db_discovery, err_code);
+        }
+        return;
+    }
+
+    // All primary services are known. The services not found keep the Service Not Found outcome.
+    srv_disc_start(p_db_discovery, 0);
+}
+#else
 /**@brief     Function for handling primary service discovery response.
  *
  * @details   This function will handle the primary service discovery response and start the
@@ -556,6 +670,7 @@ static void on_primary_srv_discovery_rsp(ble_db_discovery_t * const    p_db_disc
         on_srv_disc_completion(p_db_discovery);
     }
 }
+#endif
 
 
 /**@brief     Function for handling characteristic discovery response.
@@ -654,7 +769,16 @@ static void on_characteristic_discovery_rsp(ble_db_discovery_t * const    p_db_d
 
         p_db_discovery->curr_char_ind = 0;
 
+#if BLE_DB_DISCOVERY_FULL_RANGE
+        err_code = descriptors_batch_discover
+                   (
+                   p_db_discovery,
+                   (uint32_t)p_srv_being_discovered->charateristics[0].characteristic.handle_value + 1,
+                   &raise_discov_complete
+                   );
+#else
         err_code = descriptors_discover(p_db_discovery, &raise_discov_complete);
+#endif
 
         if (err_code != NRF_SUCCESS)
         {
@@ -680,6 +804,96 @@ static void on_characteristic_discovery_rsp(ble_db_discovery_t * const    p_db_d
 }
 
 
+#if BLE_DB_DISCOVERY_FULL_RANGE
+/**@brief     Function for handling descriptor discovery response.
+ *
+ * @details   The response of a batched descriptor discovery holds every attribute in the range,
+ *            including the declarations and values of the characteristics. A CCCD belongs to the
+ *            characteristic with the highest value handle below it. The discovery ends at the
+ *            declaration of a characteristic beyond the last one stored.
+ *
+ * @param[in] p_db_discovery    Pointer to the DB Discovery structure.
+ * @param[in] p_ble_gattc_evt   Pointer to the GATT Client event.
+ */
+static void on_descriptor_discovery_rsp(ble_db_discovery_t * const    p_db_discovery,
+                                        const ble_gattc_evt_t * const p_ble_gattc_evt)
+{
+    const ble_gattc_evt_desc_disc_rsp_t * p_desc_disc_rsp_evt;
+    ble_db_discovery_srv_t              * p_srv_being_discovered;
+    uint32_t                              next_handle = SRV_DISC_END_HANDLE + 1;
+    bool                                  raise_discov_complete;
+    uint32_t                              err_code;
+
+    p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
+
+    p_desc_disc_rsp_evt = &(p_ble_gattc_evt->params.desc_disc_rsp);
+
+    if ((p_ble_gattc_evt->gatt_status == BLE_GATT_STATUS_SUCCESS) &&
+        (p_desc_disc_rsp_evt->count != 0))
+    {
+        uint16_t last_value_handle =
+            p_srv_being_discovered->charateristics[p_srv_being_discovered->char_count - 1]
+            .characteristic.handle_value;
+        uint32_t i;
+
+        next_handle = (uint32_t)p_desc_disc_rsp_evt->descs[p_desc_disc_rsp_evt->count - 1].handle + 1;
+
+        for (i = 0; i < p_desc_disc_rsp_evt->count; i++)
+        {
+            const ble_gattc_desc_t * p_desc = &(p_desc_disc_rsp_evt->descs[i]);
+
+            if ((p_desc->uuid.uuid == BLE_UUID_CHARACTERISTIC) &&
+                (p_desc->handle > last_value_handle))
+            {
+                // Descriptors after this belong to characteristics that are not stored.
+                next_handle = SRV_DISC_END_HANDLE + 1;
+                break;
+            }
+
+            if (p_desc->uuid.uuid == BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)
+            {
+                uint32_t j = p_srv_being_discovered->char_count;
+
+                while ((j > 0) &&
+                       (p_srv_being_discovered->charateristics[j - 1].characteristic.handle_value
+                        >= p_desc->handle))
+                {
+                    j--;
+                }
+
+                if ((j > 0) &&
+                    (p_srv_being_discovered->charateristics[j - 1].cccd_handle ==
+                     BLE_GATT_HANDLE_INVALID))
+                {
+                    p_srv_being_discovered->charateristics[j - 1].cccd_handle = p_desc->handle;
+                }
+            }
+        }
+    }
+
+    err_code = descriptors_batch_discover(p_db_discovery, next_handle, &raise_discov_complete);
+
+    if (err_code != NRF_SUCCESS)
+    {
+        // Error with discovering the service.
+        // Indicate the error to the registered user application.
+        discovery_error_evt_trigger(p_db_discovery, err_code);
+
+        return;
+    }
+
+    if (raise_discov_complete)
+    {
+        DB_LOG("[DB]: Discovery of service with UUID 0x%x completed with success for Connection"
+               "handle %d\r\n", p_srv_being_discovered->srv_uuid.uuid,
+               p_db_discovery->conn_handle);
+
+        discovery_complete_evt_trigger(p_db_discovery, true);
+
+        on_srv_disc_completion(p_db_discovery);
+    }
+}
+#else
 /**@brief     Function for handling descriptor discovery response.
  *
  * @param[in] p_db_discovery    Pointer to the DB Discovery structure.
@@ -761,16 +975,15 @@ static void on_descriptor_discovery_rsp(ble_db_discovery_t * const    p_db_disco
         on_srv_disc_completion(p_db_discovery);
     }
 }
+#endif
 
 
 uint32_t ble_db_discovery_init(void)
 {
     m_num_of_handlers_reg      = 0;
     m_initialized              = true;
-    m_num_of_discoveries_made  = 0;
-    m_pending_usr_evt_index    = 0;
 
-    return NRF_SUCCESS;
+    return ble_db_discovery_cache_clear(NULL);
 }
 
 
@@ -778,10 +991,8 @@ uint32_t ble_db_discovery_close()
 {
     m_num_of_handlers_reg      = 0;
     m_initialized              = false;
-    m_num_of_discoveries_made  = 0;
-    m_pending_usr_evt_index    = 0;
 
-    return NRF_SUCCESS;
+    return ble_db_discovery_cache_clear(NULL);
 }
 
 
@@ -808,8 +1019,15 @@ uint32_t ble_db_discovery_evt_register(const ble_uuid_t * const             p_uu
 }
 
 
-uint32_t ble_db_discovery_start(ble_db_discovery_t * const p_db_discovery,
-                                uint16_t                   conn_handle)
+/**@brief     Function for starting the discovery of the GATT database at the server.
+ *
+ * @param[out] p_db_discovery    Pointer to the DB Discovery structure.
+ * @param[in]  conn_handle       The handle of the connection.
+ * @param[in]  p_peer_addr       Address to cache the database under, or NULL to not use the cache.
+ */
+static uint32_t discovery_start(ble_db_discovery_t * const   p_db_discovery,
+                                uint16_t                     conn_handle,
+                                const ble_gap_addr_t * const p_peer_addr)
 {
     if (p_db_discovery == NULL)
     {
@@ -832,26 +1050,66 @@ uint32_t ble_db_discovery_start(ble_db_discovery_t * const p_db_discovery,
         return NRF_ERROR_BUSY;
     }
 
-    ble_db_discovery_srv_t * p_srv_being_discovered;
+    uint32_t i;
+
+    p_db_discovery->curr_srv_ind  = 0;
+    p_db_discovery->curr_char_ind = 0;
+    p_db_discovery->conn_handle   = conn_handle;
+    p_db_discovery->cache_store   = (p_peer_addr != NULL);
+
+    for (i = 0; i < m_num_of_handlers_reg; i++)
+    {
+        p_db_discovery->services[i].srv_uuid                  = m_registered_handlers[i].srv_uuid;
+        p_db_discovery->services[i].char_count                = 0;
+        p_db_discovery->services[i].handle_range.start_handle = 0;
+        p_db_discovery->services[i].handle_range.end_handle   = 0;
+        p_db_discovery->srv_evt_types[i]                      = BLE_DB_DISCOVERY_SRV_NOT_FOUND;
+    }
+
+#if (BLE_DB_DISCOVERY_CACHE_SIZE > 0)
+    if (p_peer_addr != NULL)
+    {
+        p_db_discovery->peer_addr = *p_peer_addr;
+
+        i = cache_find(p_peer_addr);
+
+        if (i != BLE_DB_DISCOVERY_CACHE_SIZE)
+        {
+            DB_LOG("[DB]: Using cached database for Connection handle %d\r\n", conn_handle);
+
+            memcpy(p_db_discovery->services, m_cache[i].services, sizeof(m_cache[i].services));
+            memcpy(p_db_discovery->srv_evt_types,
+                   m_cache[i].srv_evt_types,
+                   sizeof(m_cache[i].srv_evt_types));
+
+            pending_user_evts_send(p_db_discovery);
+
+            return NRF_SUCCESS;
+        }
+    }
+#endif
+
+    uint32_t err_code;
 
-    m_num_of_discoveries_made = 0;
-    m_pending_usr_evt_index   = 0;
+#if BLE_DB_DISCOVERY_FULL_RANGE
+    DB_LOG("[DB]: Starting discovery of all primary services for Connection handle %d\r\n",
+           p_db_discovery->conn_handle);
 
-    p_db_discovery->curr_srv_ind = 0;
-    p_db_discovery->conn_handle  = conn_handle;
+    err_code = sd_ble_gattc_primary_services_discover(p_db_discovery->conn_handle,
+                                                      SRV_DISC_START_HANDLE,
+                                                      NULL);
+#else
+    ble_db_discovery_srv_t * p_srv_being_discovered;
 
     p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
 
-    p_srv_being_discovered->srv_uuid = m_registered_handlers[p_db_discovery->curr_srv_ind].srv_uuid;
-    
     DB_LOG("[DB]: Starting discovery of service with UUID 0x%x for Connection handle %d\r\n",
            p_srv_being_discovered->srv_uuid.uuid, p_db_discovery->conn_handle);
-    
-    uint32_t err_code;
 
     err_code = sd_ble_gattc_primary_services_discover(p_db_discovery->conn_handle,
                                                       SRV_DISC_START_HANDLE,
                                                       &(p_srv_being_discovered->srv_uuid));
+#endif
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -862,6 +1120,61 @@ uint32_t ble_db_discovery_start(ble_db_discovery_t * const p_db_discovery,
 }
 
 
+uint32_t ble_db_discovery_start(ble_db_discovery_t * const p_db_discovery,
+                                uint16_t                   conn_handle)
+{
+    return discovery_start(p_db_discovery, conn_handle, NULL);
+}
+
+
+uint32_t ble_db_discovery_cache_start(ble_db_discovery_t * const   p_db_discovery,
+                                      uint16_t                     conn_handle,
+                                      const ble_gap_addr_t * const p_peer_addr)
+{
+#if (BLE_DB_DISCOVERY_CACHE_SIZE > 0)
+    if (p_peer_addr == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    return discovery_start(p_db_discovery, conn_handle, p_peer_addr);
+#else
+    UNUSED_PARAMETER(p_db_discovery);
+    UNUSED_PARAMETER(conn_handle);
+    UNUSED_PARAMETER(p_peer_addr);
+
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+
+uint32_t ble_db_discovery_cache_clear(const ble_gap_addr_t * const p_peer_addr)
+{
+#if (BLE_DB_DISCOVERY_CACHE_SIZE > 0)
+    uint32_t i;
+
+    if (p_peer_addr == NULL)
+    {
+        memset(m_cache, 0, sizeof(m_cache));
+        m_cache_next = 0;
+    }
+    else
+    {
+        i = cache_find(p_peer_addr);
+
+        if (i != BLE_DB_DISCOVERY_CACHE_SIZE)
+        {
+            m_cache[i].in_use = false;
+        }
+    }
+#else
+    UNUSED_PARAMETER(p_peer_addr);
+#endif
+
+    return NRF_SUCCESS;
+}
+
+
 void ble_db_discovery_on_ble_evt(ble_db_discovery_t * const p_db_discovery,
                                  const ble_evt_t * const    p_ble_evt)
 {
@@ -876,6 +1189,14 @@ void ble_db_discovery_on_ble_evt(ble_db_discovery_t * const p_db_discovery,
         return;
     }
 
+    if ((p_ble_evt->header.evt_id >= BLE_GATTC_EVT_BASE) &&
+        (p_ble_evt->header.evt_id <= BLE_GATTC_EVT_LAST) &&
+        (p_ble_evt->evt.gattc_evt.conn_handle != p_db_discovery->conn_handle))
+    {
+        // Event for another connection, which has its own DB Discovery structure.
+        return;
+    }
+
     switch (p_ble_evt->header.evt_id)
     {
         case BLE_GAP_EVT_CONNECTED:
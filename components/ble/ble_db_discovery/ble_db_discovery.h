@@ -30,6 +30,9 @@
  *           discovered and any further characteristics will be ignored. No descriptors other
  *           than Client Characteristic Configuration Descriptors will be searched for at the peer.
  *
+ * @note     Each connection uses its own DB Discovery structure, so discoveries at several peers
+ *           can be in progress at the same time.
+ *
  * @note     Presently only one instance of a Primary Service can be discovered by this module. If
  *           there are multiple instances of the service at the peer, only the first instance
  *           of it at the peer is fetched and returned to the application.
@@ -53,8 +56,19 @@
  * @{
  */
 
+#ifndef BLE_DB_DISCOVERY_MAX_SRV
 #define BLE_DB_DISCOVERY_MAX_SRV          2  /**< Maximum number of services supported by this module. This also indicates the maximum number of users allowed to be registered to this module. (one user per service). */
+#endif
+#ifndef BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV
 #define BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV 3  /**< Maximum number of characteristics per service supported by this module. */
+#endif
+
+#ifndef BLE_DB_DISCOVERY_FULL_RANGE
+#define BLE_DB_DISCOVERY_FULL_RANGE       0  /**< Set to 1 to find all registered services with one discovery of all primary services, and to discover the descriptors of a service with one request per response instead of one per characteristic. */
+#endif
+#ifndef BLE_DB_DISCOVERY_CACHE_SIZE
+#define BLE_DB_DISCOVERY_CACHE_SIZE       0  /**< Number of peers whose discovered database is kept for @ref ble_db_discovery_cache_start. 0 disables the cache. */
+#endif
 
 /** @} */
 
@@ -108,12 +122,16 @@ typedef struct
  */
 typedef struct
 {
-    ble_db_discovery_srv_t services[BLE_DB_DISCOVERY_MAX_SRV];  /**< Information related to the current service being discovered. This is intended for internal use during service discovery.*/
-    uint16_t               conn_handle;                         /**< Connection handle as provided by the SoftDevice. */
-    uint8_t                srv_count;                           /**< Number of services at the peers GATT database.*/
-    uint8_t                curr_char_ind;                       /**< Index of the current characteristic being discovered. This is intended for internal use during service discovery.*/
-    uint8_t                curr_srv_ind;                        /**< Index of the current service being discovered. This is intended for internal use during service discovery.*/
-    bool                   discovery_in_progress;               /**< Variable to indicate if there is a service discovery in progress. */
+    ble_db_discovery_srv_t      services[BLE_DB_DISCOVERY_MAX_SRV];       /**< Information related to the current service being discovered. This is intended for internal use during service discovery.*/
+    ble_db_discovery_evt_type_t srv_evt_types[BLE_DB_DISCOVERY_MAX_SRV];  /**< Outcome of the discovery of each service, sent to its user when all services are done. This is intended for internal use during service discovery.*/
+    uint32_t                    err_code;                                 /**< Error that stopped the discovery. This is intended for internal use during service discovery.*/
+    ble_gap_addr_t              peer_addr;                                /**< Address under which the discovered database is cached. This is intended for internal use during service discovery.*/
+    bool                        cache_store;                              /**< Variable to indicate if the discovered database is to be cached under peer_addr. */
+    uint16_t                    conn_handle;                              /**< Connection handle as provided by the SoftDevice. */
+    uint8_t                     srv_count;                                /**< Number of services at the peers GATT database.*/
+    uint8_t                     curr_char_ind;                            /**< Index of the current characteristic being discovered. This is intended for internal use during service discovery.*/
+    uint8_t                     curr_srv_ind;                             /**< Index of the current service being discovered. This is intended for internal use during service discovery.*/
+    bool                        discovery_in_progress;                    /**< Variable to indicate if there is a service discovery in progress. */
 } ble_db_discovery_t;
 
 
@@ -218,6 +236,45 @@ uint32_t ble_db_discovery_evt_register(const ble_uuid_t * const             p_uu
 uint32_t ble_db_discovery_start(ble_db_discovery_t * const p_db_discovery,
                                 uint16_t                   conn_handle);
 
+
+/**@brief Function for starting the discovery of the GATT database at a bonded server, using the
+ *        database cached at the previous discovery of the same server.
+ *
+ * @details If the database of the peer is in the cache, the events of all registered services are
+ *          sent before this function returns, and no GATT procedure is performed. Otherwise, the
+ *          discovery is started as by @ref ble_db_discovery_start, and its result is cached under
+ *          p_peer_addr if it has no error. The least recently stored entry is replaced when the
+ *          cache is full.
+ *
+ * @note    The cache is kept in RAM and is keyed by address only. The application should use it
+ *          for bonded peers, and call @ref ble_db_discovery_cache_clear when a bond is deleted or
+ *          a peer indicates that its database has changed.
+ *
+ * @param[out] p_db_discovery    Pointer to the DB Discovery structure.
+ * @param[in]  conn_handle       The handle of the connection for which the discovery should be
+ *                               started.
+ * @param[in]  p_peer_addr       Address of the bonded peer.
+ *
+ * @retval    NRF_SUCCESS               Operation success.
+ * @retval    NRF_ERROR_NULL            When a NULL pointer is passed as input.
+ * @retval    NRF_ERROR_NOT_SUPPORTED   If BLE_DB_DISCOVERY_CACHE_SIZE is 0.
+ *
+ * @return                              This API propagates the errors of
+ *                                      @ref ble_db_discovery_start.
+ */
+uint32_t ble_db_discovery_cache_start(ble_db_discovery_t * const   p_db_discovery,
+                                      uint16_t                     conn_handle,
+                                      const ble_gap_addr_t * const p_peer_addr);
+
+
+/**@brief Function for removing a peer from the discovery cache.
+ *
+ * @param[in] p_peer_addr        Address of the peer. NULL to remove all peers.
+ *
+ * @retval    NRF_SUCCESS               Operation success, also if the peer was not in the cache.
+ */
+uint32_t ble_db_discovery_cache_clear(const ble_gap_addr_t * const p_peer_addr);
+
                                 
 /**@brief Function for handling the Application's BLE Stack events.
  *
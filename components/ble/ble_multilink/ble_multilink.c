@@ -0,0 +1,637 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ */
+
+#include "ble_multilink.h"
+#include <stddef.h>
+#include <string.h>
+#include "nrf_error.h"
+#include "ble_err.h"
+#include "ble_hci.h"
+#include "nordic_common.h"
+
+#define TX_OP_WRITE 0 /**< Queued operation is a write to the GATT server of the peer. */
+#define TX_OP_HVX   1 /**< Queued operation is a notification or an indication. */
+
+/**@brief Write or notification waiting in the queue of a link. */
+typedef struct
+{
+    uint8_t  type;                             /**< TX_OP_WRITE or TX_OP_HVX. */
+    uint8_t  op;                               /**< Write operation or HVX type. */
+    uint16_t handle;                           /**< Handle of the attribute. */
+    uint16_t offset;                           /**< Offset of the value. */
+    uint16_t len;                              /**< Length of the value. */
+    uint8_t  data[BLE_MULTILINK_DATA_MAX_LEN]; /**< Copy of the value. */
+} tx_op_t;
+
+/**@brief Link managed by the module. */
+typedef struct
+{
+    uint16_t              conn_handle;                     /**< Connection handle, BLE_CONN_HANDLE_INVALID if the entry is unused. */
+    uint16_t              req_interval;                    /**< Connection interval last requested for the link, 0 if none. */
+    tx_op_t               queue[BLE_MULTILINK_QUEUE_SIZE]; /**< Writes and notifications waiting to be sent. */
+    uint8_t               queue_head;                      /**< Index of the oldest entry in the queue. */
+    uint8_t               in_flight;                       /**< Number of SoftDevice TX buffers holding packets of the link. */
+    bool                  procedure_busy;                  /**< A write request or an indication waits for the peer. */
+    ble_multilink_stats_t stats;                           /**< Statistics of the link. */
+    uint32_t              last_tx_bytes;                   /**< tx_bytes at the previous throughput calculation. */
+    uint32_t              last_rx_bytes;                   /**< rx_bytes at the previous throughput calculation. */
+} link_t;
+
+static ble_multilink_init_t m_config;                           /**< Configuration as specified by the application. */
+static link_t               m_links[BLE_MULTILINK_MAX_LINKS];   /**< Links managed by the module. */
+static uint8_t              m_link_count;                       /**< Number of links in use. */
+static uint8_t              m_tx_buffer_count;                  /**< Number of TX buffers of the SoftDevice. */
+static uint8_t              m_tx_buffers_free;                  /**< Number of SoftDevice TX buffers not holding a packet. */
+static uint8_t              m_rr_index;                         /**< Link served first in the next round. */
+
+
+/**@brief Function for finding the link of a connection.
+ *
+ * @param[in]   conn_handle  Connection handle, or BLE_CONN_HANDLE_INVALID to find an unused entry.
+ *
+ * @return      Pointer to the link, or NULL if not found.
+ */
+static link_t * link_find(uint16_t conn_handle)
+{
+    uint32_t i;
+
+    for (i = 0; i < BLE_MULTILINK_MAX_LINKS; i++)
+    {
+        if (m_links[i].conn_handle == conn_handle)
+        {
+            return &m_links[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**@brief Function for reporting an error to the application.
+ *
+ * @param[in]   err_code  Error code.
+ */
+static void error_report(uint32_t err_code)
+{
+    if (m_config.error_handler != NULL)
+    {
+        m_config.error_handler(err_code);
+    }
+}
+
+
+/**@brief Function for getting the number of SoftDevice TX buffers each link can hold. */
+static uint8_t link_credits(void)
+{
+    if (m_config.link_credits != 0)
+    {
+        return m_config.link_credits;
+    }
+
+    if (m_link_count == 0)
+    {
+        return m_tx_buffer_count;
+    }
+
+    return MAX(1, m_tx_buffer_count / m_link_count);
+}
+
+
+/**@brief Function for assigning the connection interval to all links.
+ *
+ * @details The interval is the number of links times the slot of a link, so that the connection
+ *          events of all links fit in it. A new interval is only requested from links that were
+ *          not asked for it yet.
+ */
+static void conn_intervals_assign(void)
+{
+    uint32_t              i;
+    uint32_t              err_code;
+    uint32_t              interval;
+    ble_gap_conn_params_t conn_params;
+
+    if (m_link_count == 0)
+    {
+        return;
+    }
+
+    interval = m_link_count * m_config.link_slot_len;
+    interval = MAX(interval, m_config.min_conn_interval);
+    interval = MIN(interval, m_config.max_conn_interval);
+
+    conn_params.min_conn_interval = interval;
+    conn_params.max_conn_interval = interval;
+    conn_params.slave_latency     = m_config.slave_latency;
+    conn_params.conn_sup_timeout  = m_config.conn_sup_timeout;
+
+    for (i = 0; i < BLE_MULTILINK_MAX_LINKS; i++)
+    {
+        link_t * p_link = &m_links[i];
+
+        if ((p_link->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+            (p_link->req_interval == interval) ||
+            (p_link->stats.conn_interval == interval))
+        {
+            continue;
+        }
+
+        err_code = sd_ble_gap_conn_param_update(p_link->conn_handle, &conn_params);
+
+        if (err_code == NRF_SUCCESS)
+        {
+            p_link->req_interval = interval;
+        }
+        else if (err_code != NRF_ERROR_BUSY)
+        {
+            error_report(err_code);
+        }
+        // On NRF_ERROR_BUSY the request is repeated when the ongoing procedure completes.
+    }
+}
+
+
+/**@brief Function for sending the oldest queued operation of a link.
+ *
+ * @param[in]   p_link  Link.
+ *
+ * @retval      true if an operation was taken from the queue, false otherwise.
+ */
+static bool link_tx(link_t * p_link)
+{
+    uint32_t  err_code;
+    tx_op_t * p_op;
+    bool      uses_credit;
+
+    if ((p_link->conn_handle == BLE_CONN_HANDLE_INVALID) || (p_link->stats.queued == 0))
+    {
+        return false;
+    }
+
+    p_op        = &p_link->queue[p_link->queue_head];
+    uses_credit = (p_op->type == TX_OP_WRITE) ? (p_op->op == BLE_GATT_OP_WRITE_CMD)
+                                              : (p_op->op == BLE_GATT_HVX_NOTIFICATION);
+
+    if (uses_credit)
+    {
+        if ((p_link->in_flight >= link_credits()) || (m_tx_buffers_free == 0))
+        {
+            return false;
+        }
+    }
+    else if (p_link->procedure_busy)
+    {
+        return false;
+    }
+
+    if (p_op->type == TX_OP_WRITE)
+    {
+        ble_gattc_write_params_t write_params;
+
+        memset(&write_params, 0, sizeof(write_params));
+
+        write_params.write_op = p_op->op;
+        write_params.handle   = p_op->handle;
+        write_params.offset   = p_op->offset;
+        write_params.len      = p_op->len;
+        write_params.p_value  = p_op->data;
+
+        err_code = sd_ble_gattc_write(p_link->conn_handle, &write_params);
+    }
+    else
+    {
+        ble_gatts_hvx_params_t hvx_params;
+        uint16_t               len = p_op->len;
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = p_op->handle;
+        hvx_params.type   = p_op->op;
+        hvx_params.offset = p_op->offset;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = p_op->data;
+
+        err_code = sd_ble_gatts_hvx(p_link->conn_handle, &hvx_params);
+    }
+
+    if (err_code == BLE_ERROR_NO_TX_BUFFERS)
+    {
+        // Buffers are also used outside of this module. Wait for the next TX complete event.
+        m_tx_buffers_free = 0;
+        return false;
+    }
+
+    if (err_code == NRF_ERROR_BUSY)
+    {
+        p_link->procedure_busy = true;
+        return false;
+    }
+
+    if (err_code == NRF_SUCCESS)
+    {
+        p_link->stats.tx_bytes += p_op->len;
+
+        if (uses_credit)
+        {
+            p_link->in_flight++;
+            m_tx_buffers_free--;
+        }
+        else
+        {
+            p_link->procedure_busy = true;
+            p_link->stats.tx_packets++;
+        }
+    }
+    else
+    {
+        p_link->stats.tx_drop_count++;
+        error_report(err_code);
+    }
+
+    p_link->queue_head = (p_link->queue_head + 1) % BLE_MULTILINK_QUEUE_SIZE;
+    p_link->stats.queued--;
+
+    return true;
+}
+
+
+/**@brief Function for handing queued operations to the SoftDevice.
+ *
+ * @details Links are served in round-robin order, one operation per link and round, until no
+ *          link can send. The link served first changes with every call, so that no link is
+ *          favored when the TX buffers run out.
+ */
+static void tx_process(void)
+{
+    uint32_t i;
+    bool     progress;
+
+    do
+    {
+        progress = false;
+
+        for (i = 0; i < BLE_MULTILINK_MAX_LINKS; i++)
+        {
+            if (link_tx(&m_links[(m_rr_index + i) % BLE_MULTILINK_MAX_LINKS]))
+            {
+                progress = true;
+            }
+        }
+    } while (progress);
+
+    m_rr_index = (m_rr_index + 1) % BLE_MULTILINK_MAX_LINKS;
+}
+
+
+/**@brief Function for queuing an operation.
+ *
+ * @param[in]   conn_handle  Connection handle of the link.
+ * @param[in]   p_op         Operation, copied to the queue. Its value is taken from p_data.
+ * @param[in]   p_data       Value of the operation.
+ *
+ * @return      See @ref ble_multilink_write.
+ */
+static uint32_t tx_queue(uint16_t conn_handle, tx_op_t const * p_op, uint8_t const * p_data)
+{
+    link_t * p_link;
+    tx_op_t * p_entry;
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    p_link = link_find(conn_handle);
+
+    if (p_link == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    if (p_op->len > BLE_MULTILINK_DATA_MAX_LEN)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    if (p_link->stats.queued == BLE_MULTILINK_QUEUE_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_entry = &p_link->queue[(p_link->queue_head + p_link->stats.queued) % BLE_MULTILINK_QUEUE_SIZE];
+
+    memcpy(p_entry, p_op, offsetof(tx_op_t, data));
+    memcpy(p_entry->data, p_data, p_op->len);
+
+    p_link->stats.queued++;
+
+    tx_process();
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for handling the Connect event.
+ *
+ * @param[in]   p_ble_evt  Event received from the BLE stack.
+ */
+static void on_connect(ble_evt_t * p_ble_evt)
+{
+    link_t * p_link = link_find(BLE_CONN_HANDLE_INVALID);
+
+    if (p_link == NULL)
+    {
+        error_report(NRF_ERROR_NO_MEM);
+        return;
+    }
+
+    memset(p_link, 0, sizeof(link_t));
+
+    p_link->conn_handle         = p_ble_evt->evt.gap_evt.conn_handle;
+    p_link->stats.conn_interval =
+        p_ble_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval;
+
+    m_link_count++;
+
+    conn_intervals_assign();
+}
+
+
+/**@brief Function for handling the Disconnect event.
+ *
+ * @param[in]   p_ble_evt  Event received from the BLE stack.
+ */
+static void on_disconnect(ble_evt_t * p_ble_evt)
+{
+    link_t * p_link = link_find(p_ble_evt->evt.gap_evt.conn_handle);
+
+    if (p_link == NULL)
+    {
+        return;
+    }
+
+    // The SoftDevice frees the TX buffers of a link when it is disconnected.
+    m_tx_buffers_free   = MIN(m_tx_buffer_count, m_tx_buffers_free + p_link->in_flight);
+    p_link->conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    m_link_count--;
+
+    conn_intervals_assign();
+    tx_process();
+}
+
+
+/**@brief Function for handling the TX Complete event.
+ *
+ * @param[in]   p_ble_evt  Event received from the BLE stack.
+ */
+static void on_tx_complete(ble_evt_t * p_ble_evt)
+{
+    uint8_t  count  = p_ble_evt->evt.common_evt.params.tx_complete.count;
+    link_t * p_link = link_find(p_ble_evt->evt.common_evt.conn_handle);
+
+    m_tx_buffers_free = MIN(m_tx_buffer_count, m_tx_buffers_free + count);
+
+    if (p_link != NULL)
+    {
+        count                    = MIN(count, p_link->in_flight);
+        p_link->in_flight       -= count;
+        p_link->stats.tx_packets += count;
+    }
+
+    tx_process();
+}
+
+
+/**@brief Function for handling the completion of a write request or an indication.
+ *
+ * @param[in]   conn_handle  Connection handle of the link.
+ */
+static void on_procedure_complete(uint16_t conn_handle)
+{
+    link_t * p_link = link_find(conn_handle);
+
+    if (p_link != NULL)
+    {
+        p_link->procedure_busy = false;
+    }
+
+    tx_process();
+}
+
+
+/**@brief Function for counting the bytes received on a link.
+ *
+ * @param[in]   conn_handle  Connection handle of the link.
+ * @param[in]   len          Number of payload bytes received.
+ */
+static void on_rx(uint16_t conn_handle, uint16_t len)
+{
+    link_t * p_link = link_find(conn_handle);
+
+    if (p_link != NULL)
+    {
+        p_link->stats.rx_bytes += len;
+    }
+}
+
+
+uint32_t ble_multilink_init(ble_multilink_init_t const * p_init)
+{
+    uint32_t i;
+    uint32_t err_code;
+
+    if (p_init == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if ((p_init->min_conn_interval == 0) ||
+        (p_init->min_conn_interval > p_init->max_conn_interval))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    err_code = sd_ble_tx_buffer_count_get(&m_tx_buffer_count);
+
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_config          = *p_init;
+    m_link_count      = 0;
+    m_tx_buffers_free = m_tx_buffer_count;
+    m_rr_index        = 0;
+
+    for (i = 0; i < BLE_MULTILINK_MAX_LINKS; i++)
+    {
+        m_links[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+void ble_multilink_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            on_connect(p_ble_evt);
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            on_disconnect(p_ble_evt);
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+        {
+            link_t * p_link = link_find(p_ble_evt->evt.gap_evt.conn_handle);
+
+            if (p_link != NULL)
+            {
+                p_link->stats.conn_interval =
+                    p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval;
+                p_link->req_interval = 0;
+            }
+
+            // Repeat requests refused while this procedure was ongoing.
+            conn_intervals_assign();
+            break;
+        }
+
+        case BLE_EVT_TX_COMPLETE:
+            on_tx_complete(p_ble_evt);
+            break;
+
+        case BLE_GATTC_EVT_WRITE_RSP:
+            on_procedure_complete(p_ble_evt->evt.gattc_evt.conn_handle);
+            break;
+
+        case BLE_GATTS_EVT_HVC:
+            on_procedure_complete(p_ble_evt->evt.gatts_evt.conn_handle);
+            break;
+
+        case BLE_GATTC_EVT_HVX:
+            on_rx(p_ble_evt->evt.gattc_evt.conn_handle, p_ble_evt->evt.gattc_evt.params.hvx.len);
+            break;
+
+        case BLE_GATTS_EVT_WRITE:
+            on_rx(p_ble_evt->evt.gatts_evt.conn_handle, p_ble_evt->evt.gatts_evt.params.write.len);
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
+uint32_t ble_multilink_write(uint16_t conn_handle, ble_gattc_write_params_t const * p_write_params)
+{
+    tx_op_t op;
+
+    if (p_write_params == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if ((p_write_params->write_op != BLE_GATT_OP_WRITE_REQ) &&
+        (p_write_params->write_op != BLE_GATT_OP_WRITE_CMD))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    op.type   = TX_OP_WRITE;
+    op.op     = p_write_params->write_op;
+    op.handle = p_write_params->handle;
+    op.offset = p_write_params->offset;
+    op.len    = p_write_params->len;
+
+    return tx_queue(conn_handle, &op, p_write_params->p_value);
+}
+
+
+uint32_t ble_multilink_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+    tx_op_t op;
+
+    if ((p_hvx_params == NULL) || (p_hvx_params->p_len == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    op.type   = TX_OP_HVX;
+    op.op     = p_hvx_params->type;
+    op.handle = p_hvx_params->handle;
+    op.offset = p_hvx_params->offset;
+    op.len    = *p_hvx_params->p_len;
+
+    return tx_queue(conn_handle, &op, p_hvx_params->p_data);
+}
+
+
+uint32_t ble_multilink_stats_get(uint16_t conn_handle, ble_multilink_stats_t * p_stats)
+{
+    link_t * p_link;
+
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    p_link = (conn_handle != BLE_CONN_HANDLE_INVALID) ? link_find(conn_handle) : NULL;
+
+    if (p_link == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *p_stats         = p_link->stats;
+    p_stats->credits = link_credits();
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_multilink_throughput_get(uint16_t                     conn_handle,
+                                      uint32_t                     interval_ms,
+                                      ble_multilink_throughput_t * p_throughput)
+{
+    link_t * p_link;
+
+    if (p_throughput == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (interval_ms == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_link = (conn_handle != BLE_CONN_HANDLE_INVALID) ? link_find(conn_handle) : NULL;
+
+    if (p_link == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    p_throughput->tx_bytes_per_sec =
+        (uint32_t)(((uint64_t)(p_link->stats.tx_bytes - p_link->last_tx_bytes) * 1000) / interval_ms);
+    p_throughput->rx_bytes_per_sec =
+        (uint32_t)(((uint64_t)(p_link->stats.rx_bytes - p_link->last_rx_bytes) * 1000) / interval_ms);
+
+    p_link->last_tx_bytes = p_link->stats.tx_bytes;
+    p_link->last_rx_bytes = p_link->stats.rx_bytes;
+
+    return NRF_SUCCESS;
+}
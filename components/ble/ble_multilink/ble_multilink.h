@@ -0,0 +1,167 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ */
+
+
+/**@file
+ *
+ * @defgroup ble_sdk_lib_multilink Multilink Manager
+ * @{
+ * @ingroup  ble_sdk_lib
+ * @brief    Module for sharing the radio and the SoftDevice TX buffers between several links.
+ *
+ * @details  The module keeps track of all connections and assigns them one connection interval,
+ *           scaled with the number of links so that every link gets a slot of
+ *           @ref ble_multilink_init_t::link_slot_len in each interval. Writes and notifications
+ *           are queued per link and handed to the SoftDevice in round-robin order, each link
+ *           holding at most its budget of TX buffers. Budgets are returned by
+ *           @ref BLE_EVT_TX_COMPLETE, so that one busy link cannot starve the others.
+ *
+ *           Write requests and indications are sent one at a time per link, as the SoftDevice
+ *           allows, and do not use the TX buffer budget.
+ *
+ * @note     The application must propagate BLE stack events to this module by calling
+ *           @ref ble_multilink_on_ble_evt, and call the other functions of the module from the
+ *           same interrupt priority, for example through the scheduler.
+ */
+
+#ifndef BLE_MULTILINK_H__
+#define BLE_MULTILINK_H__
+
+#include <stdint.h>
+#include "ble.h"
+#include "ble_gattc.h"
+#include "ble_gatts.h"
+#include "ble_srv_common.h"
+
+#ifndef BLE_MULTILINK_MAX_LINKS
+#define BLE_MULTILINK_MAX_LINKS    8  /**< Maximum number of links managed at the same time. */
+#endif
+#ifndef BLE_MULTILINK_QUEUE_SIZE
+#define BLE_MULTILINK_QUEUE_SIZE   4  /**< Number of writes and notifications that can be queued per link. */
+#endif
+#ifndef BLE_MULTILINK_DATA_MAX_LEN
+#define BLE_MULTILINK_DATA_MAX_LEN 20 /**< Maximum length of a queued write or notification. The default fits the default ATT MTU. */
+#endif
+
+/**@brief Multilink Manager init structure. */
+typedef struct
+{
+    uint16_t                min_conn_interval; /**< Lower bound of the connection interval assigned to the links, in 1.25 ms units. */
+    uint16_t                max_conn_interval; /**< Upper bound of the connection interval assigned to the links, in 1.25 ms units. */
+    uint16_t                slave_latency;     /**< Slave latency used for all links. */
+    uint16_t                conn_sup_timeout;  /**< Supervision timeout used for all links, in 10 ms units. */
+    uint16_t                link_slot_len;     /**< Time each link needs for its connection event, in 1.25 ms units. The connection interval is the number of links times this value, within the bounds above. */
+    uint8_t                 link_credits;      /**< Maximum number of SoftDevice TX buffers a link can hold. 0 shares the TX buffers equally between the links. */
+    ble_srv_error_handler_t error_handler;     /**< Function to be called in case of an error. */
+} ble_multilink_init_t;
+
+/**@brief Statistics of a link. */
+typedef struct
+{
+    uint32_t tx_packets;    /**< Number of writes and notifications sent on the link. */
+    uint32_t tx_bytes;      /**< Payload bytes of writes and notifications sent on the link. */
+    uint32_t rx_bytes;      /**< Payload bytes of writes, notifications and indications received on the link. */
+    uint32_t tx_drop_count; /**< Number of queued writes and notifications the SoftDevice rejected. */
+    uint16_t conn_interval; /**< Connection interval of the link, in 1.25 ms units. */
+    uint8_t  credits;       /**< Number of SoftDevice TX buffers the link can hold. */
+    uint8_t  queued;        /**< Number of writes and notifications waiting in the queue of the link. */
+} ble_multilink_stats_t;
+
+/**@brief Throughput of a link over an interval. */
+typedef struct
+{
+    uint32_t tx_bytes_per_sec; /**< Payload bytes sent per second. */
+    uint32_t rx_bytes_per_sec; /**< Payload bytes received per second. */
+} ble_multilink_throughput_t;
+
+/**@brief Function for initializing the Multilink Manager.
+ *
+ * @param[in]   p_init  This contains information needed to initialize this module.
+ *
+ * @retval      NRF_SUCCESS             Operation success.
+ * @retval      NRF_ERROR_NULL          p_init is NULL.
+ * @retval      NRF_ERROR_INVALID_PARAM The connection interval bounds are invalid.
+ * @return      Errors propagated from sd_ble_tx_buffer_count_get.
+ */
+uint32_t ble_multilink_init(ble_multilink_init_t const * p_init);
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @details Handles all events from the BLE stack that are of interest to this module.
+ *
+ * @param[in]   p_ble_evt  The event received from the BLE stack.
+ */
+void ble_multilink_on_ble_evt(ble_evt_t * p_ble_evt);
+
+/**@brief Function for queuing a write to the GATT server of a peer.
+ *
+ * @details The value is copied, so the buffer can be reused when the function returns.
+ *
+ * @param[in]   conn_handle     Connection handle of the link.
+ * @param[in]   p_write_params  Write parameters, as for sd_ble_gattc_write. Only write requests
+ *                              and write commands are supported.
+ *
+ * @retval      NRF_SUCCESS             The write is queued.
+ * @retval      NRF_ERROR_NULL          p_write_params is NULL.
+ * @retval      NRF_ERROR_NOT_FOUND     No link with this connection handle.
+ * @retval      NRF_ERROR_INVALID_PARAM The write operation is not supported.
+ * @retval      NRF_ERROR_DATA_SIZE     The value is longer than BLE_MULTILINK_DATA_MAX_LEN.
+ * @retval      NRF_ERROR_NO_MEM        The queue of the link is full.
+ */
+uint32_t ble_multilink_write(uint16_t conn_handle, ble_gattc_write_params_t const * p_write_params);
+
+/**@brief Function for queuing a notification or an indication to a peer.
+ *
+ * @details The value is copied, so the buffer can be reused when the function returns.
+ *
+ * @param[in]   conn_handle   Connection handle of the link.
+ * @param[in]   p_hvx_params  Notification or indication parameters, as for sd_ble_gatts_hvx.
+ *
+ * @retval      NRF_SUCCESS             The notification or indication is queued.
+ * @retval      NRF_ERROR_NULL          p_hvx_params or its length pointer is NULL.
+ * @retval      NRF_ERROR_NOT_FOUND     No link with this connection handle.
+ * @retval      NRF_ERROR_DATA_SIZE     The value is longer than BLE_MULTILINK_DATA_MAX_LEN.
+ * @retval      NRF_ERROR_NO_MEM        The queue of the link is full.
+ */
+uint32_t ble_multilink_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params);
+
+/**@brief Function for getting the statistics of a link.
+ *
+ * @param[in]   conn_handle  Connection handle of the link.
+ * @param[out]  p_stats      Statistics of the link since it was connected.
+ *
+ * @retval      NRF_SUCCESS          Operation success.
+ * @retval      NRF_ERROR_NULL       p_stats is NULL.
+ * @retval      NRF_ERROR_NOT_FOUND  No link with this connection handle.
+ */
+uint32_t ble_multilink_stats_get(uint16_t conn_handle, ble_multilink_stats_t * p_stats);
+
+/**@brief Function for getting the throughput of a link since the previous call.
+ *
+ * @details Intended to be called periodically, for example from an app_timer handler, with the
+ *          time elapsed since the previous call.
+ *
+ * @param[in]   conn_handle   Connection handle of the link.
+ * @param[in]   interval_ms   Time since the previous call, or since the link was connected.
+ * @param[out]  p_throughput  Throughput of the link over the interval.
+ *
+ * @retval      NRF_SUCCESS             Operation success.
+ * @retval      NRF_ERROR_NULL          p_throughput is NULL.
+ * @retval      NRF_ERROR_INVALID_PARAM interval_ms is 0.
+ * @retval      NRF_ERROR_NOT_FOUND     No link with this connection handle.
+ */
+uint32_t ble_multilink_throughput_get(uint16_t                     conn_handle,
+                                      uint32_t                     interval_ms,
+                                      ble_multilink_throughput_t * p_throughput);
+
+#endif // BLE_MULTILINK_H__
+
+/** @} */
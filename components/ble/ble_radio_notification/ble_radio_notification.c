@@ -11,15 +11,59 @@
 
 #include "ble_radio_notification.h"
 #include <stdlib.h>
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nrf_assert.h"
+#include "nrf_error.h"
+#include "nordic_common.h"
 
+STATIC_ASSERT(BLE_RADIO_NOTIFICATION_PREPARE_MAX <= 32);
+
+/**@brief Prepare handler and its context. */
+typedef struct
+{
+    ble_radio_notification_prepare_handler_t handler;   /**< Prepare handler. */
+    void *                                   p_context; /**< Context passed to the handler. */
+} prepare_hook_t;
 
 static bool                                 m_radio_active = false;  /**< Current radio state. */
 static ble_radio_notification_evt_handler_t m_evt_handler  = NULL;   /**< Application event handler for handling Radio Notification events. */
 
+static prepare_hook_t                       m_prepare_hooks[BLE_RADIO_NOTIFICATION_PREPARE_MAX]; /**< Registered prepare handlers. */
+static uint8_t                              m_prepare_count;         /**< Number of registered prepare handlers. */
+static volatile uint32_t                    m_prepare_requests;      /**< Prepare handlers requested for the next radio event, one bit each. */
+
+
+/**@brief Function for calling the prepare handlers requested before this radio event. */
+static void prepare_hooks_run(void)
+{
+    uint32_t requests;
+    uint8_t  i;
+
+    // Take the requests at once, so that new requests are kept for the next event.
+    CRITICAL_REGION_ENTER();
+    requests           = m_prepare_requests;
+    m_prepare_requests = 0;
+    CRITICAL_REGION_EXIT();
+
+    for (i = 0; (requests != 0) && (i < m_prepare_count); i++)
+    {
+        if (requests & (1UL << i))
+        {
+            requests &= ~(1UL << i);
+            m_prepare_hooks[i].handler(m_prepare_hooks[i].p_context);
+        }
+    }
+}
+
 
 void SWI1_IRQHandler(void)
 {
     m_radio_active = !m_radio_active;
+    if (m_radio_active && (m_prepare_requests != 0))
+    {
+        prepare_hooks_run();
+    }
     if (m_evt_handler != NULL)
     {
         m_evt_handler(m_radio_active);
@@ -57,3 +101,35 @@ uint32_t ble_radio_notification_init(nrf_app_irq_priority_t               irq_pr
     // Configure the event
     return sd_radio_notification_cfg_set(NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH, distance);
 }
+
+
+uint32_t ble_radio_notification_prepare_register(ble_radio_notification_prepare_handler_t handler,
+                                                 void *                                   p_context,
+                                                 ble_radio_notification_prepare_id_t *    p_id)
+{
+    if ((handler == NULL) || (p_id == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (m_prepare_count >= BLE_RADIO_NOTIFICATION_PREPARE_MAX)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    m_prepare_hooks[m_prepare_count].handler   = handler;
+    m_prepare_hooks[m_prepare_count].p_context = p_context;
+
+    *p_id = m_prepare_count++;
+
+    return NRF_SUCCESS;
+}
+
+
+void ble_radio_notification_prepare_request(ble_radio_notification_prepare_id_t id)
+{
+    ASSERT(id < m_prepare_count);
+
+    CRITICAL_REGION_ENTER();
+    m_prepare_requests |= (1UL << id);
+    CRITICAL_REGION_EXIT();
+}
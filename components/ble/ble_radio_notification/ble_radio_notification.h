@@ -15,6 +15,17 @@
  * @{
  * @ingroup ble_sdk_lib
  * @brief Module for propagating Radio Notification events to the application.
+ *
+ * @details Besides the application event handler, modules can register prepare handlers, to build
+ *          the data they send, for example a sensor reading, an encoded value or a HID report, just
+ *          before the next radio event. A module requests its handler with
+ *          @ref ble_radio_notification_prepare_request when it has data to prepare, and the handler
+ *          is called once, from the Active notification of the next radio event, before the
+ *          application event handler. Data queued by the handler is then sent in this radio event,
+ *          instead of one connection interval later.
+ *
+ *          The prepare handlers run in the Radio Notification interrupt, and must return within the
+ *          notification distance given to @ref ble_radio_notification_init.
  */
 
 #ifndef BLE_RADIO_NOTIFICATION_H__
@@ -24,9 +35,22 @@
 #include <stdbool.h>
 #include "nrf_soc.h"
 
+#ifndef BLE_RADIO_NOTIFICATION_PREPARE_MAX
+#define BLE_RADIO_NOTIFICATION_PREPARE_MAX 4 /**< Maximum number of prepare handlers. */
+#endif
+
 /**@brief Application radio notification event handler type. */
 typedef void (*ble_radio_notification_evt_handler_t) (bool radio_active);
 
+/**@brief Prepare handler type, called before the radio event following a request.
+ *
+ * @param[in]  p_context  Context given to @ref ble_radio_notification_prepare_register.
+ */
+typedef void (*ble_radio_notification_prepare_handler_t) (void * p_context);
+
+/**@brief Prepare handler identifier. */
+typedef uint8_t ble_radio_notification_prepare_id_t;
+
 /**@brief Function for initializing the Radio Notification module.
  *
  * @param[in]  irq_priority   Interrupt priority for the Radio Notification interrupt handler.
@@ -40,6 +64,34 @@ uint32_t ble_radio_notification_init(nrf_app_irq_priority_t               irq_pr
                                      nrf_radio_notification_distance_t    distance,
                                      ble_radio_notification_evt_handler_t evt_handler);
 
+/**@brief Function for registering a prepare handler.
+ *
+ * @details Handlers requested for the same radio event are called in the order of registration.
+ *          May be called before @ref ble_radio_notification_init.
+ *
+ * @param[in]  handler    Handler to call before the radio event following a request.
+ * @param[in]  p_context  Context passed to the handler.
+ * @param[out] p_id       Identifier of the handler, for @ref ble_radio_notification_prepare_request.
+ *
+ * @retval NRF_SUCCESS             Handler registered.
+ * @retval NRF_ERROR_NULL          The handler or p_id is NULL.
+ * @retval NRF_ERROR_NO_MEM        BLE_RADIO_NOTIFICATION_PREPARE_MAX handlers are already
+ *                                 registered.
+ */
+uint32_t ble_radio_notification_prepare_register(ble_radio_notification_prepare_handler_t handler,
+                                                 void *                                   p_context,
+                                                 ble_radio_notification_prepare_id_t *    p_id);
+
+/**@brief Function for requesting a prepare handler before the next radio event.
+ *
+ * @details Requests made before the handler is called are merged into one call. Requests made
+ *          from the handler itself are kept for the following radio event. Safe to call at any
+ *          interrupt priority.
+ *
+ * @param[in]  id  Identifier of the handler.
+ */
+void ble_radio_notification_prepare_request(ble_radio_notification_prepare_id_t id);
+
 #endif // BLE_RADIO_NOTIFICATION_H__
 
 /** @} */
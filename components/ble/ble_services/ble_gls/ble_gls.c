@@ -19,6 +19,7 @@
 #include "ble_srv_common.h"
 #include "ble_racp.h"
 #include "ble_gls_db.h"
+#include "nordic_common.h"
 
 
 #define OPERAND_FILTER_TYPE_SEQ_NUM     0x01                                     /**< Filter data using Sequence Number criteria. */
@@ -44,11 +45,10 @@ typedef enum
 
 static gls_state_t      m_gls_state;                                   /**< Current communication state. */
 static uint16_t         m_next_seq_num;                                /**< Sequence number of the next database record. */
-static uint8_t          m_racp_proc_operator;                          /**< Operator of current request. */
-static uint16_t         m_racp_proc_seq_num;                           /**< Sequence number of current request. */
-static uint8_t          m_racp_proc_record_ndx;                        /**< Current record index. */
-static uint8_t          m_racp_proc_records_reported;                  /**< Number of reported records. */
-static uint8_t          m_racp_proc_records_reported_since_txcomplete; /**< Number of reported records since last TX_COMPLETE event. */
+static uint16_t         m_racp_proc_record_ndx;                        /**< Current record index. */
+static uint16_t         m_racp_proc_record_end;                        /**< Index after the last record selected by the current request. */
+static uint16_t         m_racp_proc_records_reported;                  /**< Number of reported records. */
+static uint16_t         m_racp_proc_records_reported_since_txcomplete; /**< Number of reported records since last TX_COMPLETE event. */
 static ble_racp_value_t m_pending_racp_response;                       /**< RACP response to be sent. */
 static uint8_t          m_pending_racp_response_operand[2];            /**< Operand of RACP response to be sent. */
 
@@ -517,128 +517,92 @@ static uint32_t glucose_meas_send(ble_gls_t * p_gls, ble_gls_rec_t * p_rec)
 }
 
 
-/**@brief Function for responding to the ALL operation.
+/**@brief Function for finding the records selected by a request.
  *
- * @param[in] p_gls  Service instance.
+ * @details The database is ordered by sequence number, so the selected records are a range of
+ *          indices, found by binary search.
  *
- * @return NRF_SUCCESS on success, otherwise an error code.
+ * @param[in]  p_racp_request  Request, checked by is_request_to_be_executed().
+ * @param[out] p_first         Index of the first selected record.
+ * @param[out] p_end           Index after the last selected record.
  */
-static uint32_t racp_report_records_all(ble_gls_t * p_gls)
+static void racp_records_select(const ble_racp_value_t * p_racp_request,
+                                uint16_t               * p_first,
+                                uint16_t               * p_end)
 {
     uint16_t total_records = ble_gls_db_num_records_get();
+    uint16_t seq_num_min;
+    uint16_t seq_num_max;
 
-    if (m_racp_proc_record_ndx >= total_records)
-    {
-        state_set(STATE_NO_COMM);
-    }
-    else
-    {
-        uint32_t      err_code;
-        ble_gls_rec_t rec;
+    *p_first = 0;
+    *p_end   = total_records;
 
-        err_code = ble_gls_db_record_get(m_racp_proc_record_ndx, &rec);
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
+    switch (p_racp_request->operator)
+    {
+        case RACP_OPERATOR_ALL:
+            break;
 
-        err_code = glucose_meas_send(p_gls, &rec);
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-    }
+        case RACP_OPERATOR_FIRST:
+            *p_end = MIN(total_records, 1);
+            break;
 
-    return NRF_SUCCESS;
-}
+        case RACP_OPERATOR_LAST:
+            *p_first = (total_records > 0) ? (total_records - 1) : 0;
+            break;
 
+        case RACP_OPERATOR_GREATER_OR_EQUAL:
+            seq_num_min = (p_racp_request->p_operand[2] << 8) | p_racp_request->p_operand[1];
+            *p_first    = ble_gls_db_seq_num_lower_bound(seq_num_min);
+            break;
 
-/**@brief Function for responding to the FIRST or the LAST operation.
- *
- * @param[in] p_gls  Service instance.
- *
- * @return  NRF_SUCCESS on success, otherwise an error code.
- */
-static uint32_t racp_report_records_first_last(ble_gls_t * p_gls)
-{
-    uint32_t      err_code;
-    ble_gls_rec_t rec;
-    uint16_t      total_records;
+        case RACP_OPERATOR_LESS_OR_EQUAL:
+            seq_num_max = (p_racp_request->p_operand[2] << 8) | p_racp_request->p_operand[1];
+            *p_end      = ble_gls_db_seq_num_upper_bound(seq_num_max);
+            break;
 
-    total_records = ble_gls_db_num_records_get();
+        case RACP_OPERATOR_RANGE:
+            seq_num_min = (p_racp_request->p_operand[2] << 8) | p_racp_request->p_operand[1];
+            seq_num_max = (p_racp_request->p_operand[4] << 8) | p_racp_request->p_operand[3];
+            *p_first    = ble_gls_db_seq_num_lower_bound(seq_num_min);
+            *p_end      = ble_gls_db_seq_num_upper_bound(seq_num_max);
+            break;
 
-    if ((m_racp_proc_records_reported != 0) || (total_records == 0))
-    {
-        state_set(STATE_NO_COMM);
+        default:
+            *p_end = 0;
+            break;
     }
-    else
-    {
-        if (m_racp_proc_operator == RACP_OPERATOR_FIRST)
-        {
-            err_code = ble_gls_db_record_get(0, &rec);
-            if (err_code != NRF_SUCCESS)
-            {
-                return err_code;
-            }
-        }
-        else if (m_racp_proc_operator == RACP_OPERATOR_LAST)
-        {
-            err_code = ble_gls_db_record_get(total_records - 1, &rec);
-            if (err_code != NRF_SUCCESS)
-            {
-                return err_code;
-            }
-        }
 
-        err_code = glucose_meas_send(p_gls, &rec);
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
+    if (*p_end < *p_first)
+    {
+        *p_end = *p_first;
     }
-
-    return NRF_SUCCESS;
 }
 
 
-/**@brief Function for responding to the GREATER_OR_EQUAL operation.
+/**@brief Function for sending the next record selected by the current request.
  *
  * @param[in] p_gls  Service instance.
  *
  * @return NRF_SUCCESS on success, otherwise an error code.
  */
-static uint32_t racp_report_records_greater_or_equal(ble_gls_t * p_gls)
+static uint32_t racp_report_records_next(ble_gls_t * p_gls)
 {
-    uint16_t total_records = ble_gls_db_num_records_get();
+    uint32_t      err_code;
+    ble_gls_rec_t rec;
 
-    while (m_racp_proc_record_ndx < total_records)
+    if (m_racp_proc_record_ndx >= m_racp_proc_record_end)
     {
-        uint32_t      err_code;
-        ble_gls_rec_t rec;
-
-        err_code = ble_gls_db_record_get(m_racp_proc_record_ndx, &rec);
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-
-        if (rec.meas.sequence_number >= m_racp_proc_seq_num)
-        {
-            err_code = glucose_meas_send(p_gls, &rec);
-            if (err_code != NRF_SUCCESS)
-            {
-                return err_code;
-            }
-            break;
-        }
-        m_racp_proc_record_ndx++;
+        state_set(STATE_NO_COMM);
+        return NRF_SUCCESS;
     }
-    if (m_racp_proc_record_ndx == total_records)
+
+    err_code = ble_gls_db_record_get(m_racp_proc_record_ndx, &rec);
+    if (err_code != NRF_SUCCESS)
     {
-        state_set(STATE_NO_COMM);
+        return err_code;
     }
 
-    return NRF_SUCCESS;
+    return glucose_meas_send(p_gls, &rec);
 }
 
 
@@ -671,35 +635,11 @@ static void racp_report_records_procedure(ble_gls_t * p_gls)
 {
     uint32_t err_code;
 
+    // Send records until the stack runs out of transmit buffers, so that all buffers are filled
+    // for each connection event.
     while (m_gls_state == STATE_RACP_PROC_ACTIVE)
     {
-        // Execute requested procedure
-        switch (m_racp_proc_operator)
-        {
-            case RACP_OPERATOR_ALL:
-                err_code = racp_report_records_all(p_gls);
-                break;
-
-            case RACP_OPERATOR_FIRST:
-            case RACP_OPERATOR_LAST:
-                err_code = racp_report_records_first_last(p_gls);
-                break;
-
-            case RACP_OPERATOR_GREATER_OR_EQUAL:
-                err_code = racp_report_records_greater_or_equal(p_gls);
-                break;
-
-            default:
-                // Report error to application
-                if (p_gls->error_handler != NULL)
-                {
-                    p_gls->error_handler(NRF_ERROR_INTERNAL);
-                }
-
-                // Make sure state machine returns to the default state
-                state_set(STATE_NO_COMM);
-                return;
-        }
+        err_code = racp_report_records_next(p_gls);
 
         // Error handling
         switch (err_code)
@@ -799,9 +739,25 @@ static bool is_request_to_be_executed(const ble_racp_value_t * p_racp_request,
 
             // Operators WITH a filter.
             case RACP_OPERATOR_GREATER_OR_EQUAL:
-                if (p_racp_request->p_operand[0] == OPERAND_FILTER_TYPE_SEQ_NUM)
+            case RACP_OPERATOR_LESS_OR_EQUAL:
+            case RACP_OPERATOR_RANGE:
+                if (p_racp_request->operand_len == 0)
+                {
+                    *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
+                }
+                else if (p_racp_request->p_operand[0] == OPERAND_FILTER_TYPE_SEQ_NUM)
                 {
-                    if (p_racp_request->operand_len != 3)
+                    if (p_racp_request->operator == RACP_OPERATOR_RANGE)
+                    {
+                        if ((p_racp_request->operand_len != 5) ||
+                            (((p_racp_request->p_operand[2] << 8) | p_racp_request->p_operand[1]) >
+                             ((p_racp_request->p_operand[4] << 8) | p_racp_request->p_operand[3]))
+                           )
+                        {
+                            *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
+                        }
+                    }
+                    else if (p_racp_request->operand_len != 3)
                     {
                         *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
                     }
@@ -820,12 +776,6 @@ static bool is_request_to_be_executed(const ble_racp_value_t * p_racp_request,
                 }
                 break;
 
-            // Unsupported operators.
-            case RACP_OPERATOR_LESS_OR_EQUAL:
-            case RACP_OPERATOR_RANGE:
-                *p_response_code = RACP_RESPONSE_OPERATOR_UNSUPPORTED;
-                 break;
-
             // Invalid operators.
             case RACP_OPERATOR_NULL:
             default:
@@ -864,14 +814,10 @@ static bool is_request_to_be_executed(const ble_racp_value_t * p_racp_request,
  */
 static void report_records_request_execute(ble_gls_t * p_gls, ble_racp_value_t * p_racp_request)
 {
-    uint16_t seq_num = (p_racp_request->p_operand[2] << 8) | p_racp_request->p_operand[1];
-
     state_set(STATE_RACP_PROC_ACTIVE);
 
-    m_racp_proc_record_ndx       = 0;
-    m_racp_proc_operator         = p_racp_request->operator;
+    racp_records_select(p_racp_request, &m_racp_proc_record_ndx, &m_racp_proc_record_end);
     m_racp_proc_records_reported = 0;
-    m_racp_proc_seq_num          = seq_num;
 
     racp_report_records_procedure(p_gls);
 }
@@ -884,52 +830,12 @@ static void report_records_request_execute(ble_gls_t * p_gls, ble_racp_value_t *
  */
 static void report_num_records_request_execute(ble_gls_t * p_gls, ble_racp_value_t * p_racp_request)
 {
-    uint16_t total_records;
+    uint16_t first;
+    uint16_t end;
     uint16_t num_records;
 
-    total_records = ble_gls_db_num_records_get();
-    num_records   = 0;
-
-    if (p_racp_request->operator == RACP_OPERATOR_ALL)
-    {
-        num_records = total_records;
-    }
-    else if (p_racp_request->operator == RACP_OPERATOR_GREATER_OR_EQUAL)
-    {
-        uint16_t seq_num;
-        uint16_t i;
-
-        seq_num = (p_racp_request->p_operand[2] << 8) | p_racp_request->p_operand[1];
-
-        for (i = 0; i < total_records; i++)
-        {
-            uint32_t      err_code;
-            ble_gls_rec_t rec;
-
-            err_code = ble_gls_db_record_get(i, &rec);
-            if (err_code != NRF_SUCCESS)
-            {
-                if (p_gls->error_handler != NULL)
-                {
-                    p_gls->error_handler(err_code);
-                }
-                return;
-            }
-
-            if (rec.meas.sequence_number >= seq_num)
-            {
-                num_records++;
-            }
-        }
-    }
-    else if ((p_racp_request->operator == RACP_OPERATOR_FIRST) ||
-             (p_racp_request->operator == RACP_OPERATOR_LAST))
-    {
-        if (total_records > 0)
-        {
-            num_records = 1;
-        }
-    }
+    racp_records_select(p_racp_request, &first, &end);
+    num_records = end - first;
 
     m_pending_racp_response.opcode      = RACP_OPCODE_NUM_RECS_RESPONSE;
     m_pending_racp_response.operator    = RACP_OPERATOR_NULL;
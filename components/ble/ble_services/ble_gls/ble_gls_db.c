@@ -19,10 +19,41 @@ typedef struct
 } database_entry_t;
 
 static database_entry_t m_database[BLE_GLS_DB_MAX_RECORDS];
-static uint8_t          m_database_crossref[BLE_GLS_DB_MAX_RECORDS];
+static uint16_t         m_database_crossref[BLE_GLS_DB_MAX_RECORDS];
 static uint16_t         m_num_records;
 
 
+/**@brief Function for finding the first record with a sequence number above a bound.
+ *
+ * @param[in]   seq_num   Bound of the sequence numbers.
+ * @param[in]   strict    Skip the records with a sequence number equal to the bound.
+ *
+ * @return      Index of the record, or the number of records if there is none.
+ */
+static uint16_t seq_num_search(uint16_t seq_num, bool strict)
+{
+    uint16_t low  = 0;
+    uint16_t high = m_num_records;
+
+    while (low < high)
+    {
+        uint16_t mid     = low + (high - low) / 2;
+        uint16_t rec_seq = m_database[m_database_crossref[mid]].record.meas.sequence_number;
+
+        if ((rec_seq < seq_num) || (strict && (rec_seq == seq_num)))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+
 uint32_t ble_gls_db_init(void)
 {
     int i;
@@ -30,7 +61,7 @@ uint32_t ble_gls_db_init(void)
     for (i = 0; i < BLE_GLS_DB_MAX_RECORDS; i++)
     {
         m_database[i].in_use_flag = false;
-        m_database_crossref[i]    = 0xFF;
+        m_database_crossref[i]    = 0xFFFF;
     }
 
     m_num_records = 0;
@@ -45,7 +76,7 @@ uint16_t ble_gls_db_num_records_get(void)
 }
 
 
-uint32_t ble_gls_db_record_get(uint8_t rec_ndx, ble_gls_rec_t * p_rec)
+uint32_t ble_gls_db_record_get(uint16_t rec_ndx, ble_gls_rec_t * p_rec)
 {
     if (rec_ndx >= m_num_records)
     {
@@ -87,7 +118,7 @@ uint32_t ble_gls_db_record_add(ble_gls_rec_t * p_rec)
 }
 
 
-uint32_t ble_gls_db_record_delete(uint8_t rec_ndx)
+uint32_t ble_gls_db_record_delete(uint16_t rec_ndx)
 {
     int i;
 
@@ -110,3 +141,15 @@ uint32_t ble_gls_db_record_delete(uint8_t rec_ndx)
 
     return NRF_SUCCESS;
 }
+
+
+uint16_t ble_gls_db_seq_num_lower_bound(uint16_t seq_num)
+{
+    return seq_num_search(seq_num, false);
+}
+
+
+uint16_t ble_gls_db_seq_num_upper_bound(uint16_t seq_num)
+{
+    return seq_num_search(seq_num, true);
+}
@@ -30,7 +30,9 @@
 #include <stdint.h>
 #include "ble_gls.h"
 
+#ifndef BLE_GLS_DB_MAX_RECORDS
 #define BLE_GLS_DB_MAX_RECORDS      20
+#endif
 
 /**@brief Function for initializing the glucose record database.
  *
@@ -57,7 +59,7 @@ uint16_t ble_gls_db_num_records_get(void);
  * 
  * @return      NRF_SUCCESS on success.
  */
-uint32_t ble_gls_db_record_get(uint8_t record_num, ble_gls_rec_t * p_rec);
+uint32_t ble_gls_db_record_get(uint16_t record_num, ble_gls_rec_t * p_rec);
 
 /**@brief Function for adding a record at the end of the database.
  *
@@ -77,7 +79,27 @@ uint32_t ble_gls_db_record_add(ble_gls_rec_t * p_rec);
  * 
  * @return      NRF_SUCCESS on success.
  */
-uint32_t ble_gls_db_record_delete(uint8_t record_num);
+uint32_t ble_gls_db_record_delete(uint16_t record_num);
+
+/**@brief Function for finding the first record with a sequence number at or above a value.
+ *
+ * @details Records are kept in the order they were added, which is the order of their sequence
+ *          numbers, so the record is found by binary search.
+ *
+ * @param[in]   seq_num   Lowest sequence number.
+ *
+ * @return      Index of the record, or the number of records if there is none.
+ */
+uint16_t ble_gls_db_seq_num_lower_bound(uint16_t seq_num);
+
+/**@brief Function for finding the first record with a sequence number above a value.
+ *
+ * @param[in]   seq_num   Sequence number.
+ *
+ * @return      Index of the record, or the number of records if there is none. The records before
+ *              it are those with a sequence number at or below seq_num.
+ */
+uint16_t ble_gls_db_seq_num_upper_bound(uint16_t seq_num);
 
 #endif // BLE_GLS_DB_H__
 
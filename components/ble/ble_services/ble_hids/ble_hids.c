@@ -21,6 +21,7 @@
 #include "nordic_common.h"
 #include "ble_srv_common.h"
 #include "app_util.h"
+#include "app_util_platform.h"
 
 
 // Protocol Mode values
@@ -41,6 +42,13 @@
 #define BOOT_MOUSE_INPUT_REPORT_MIN_SIZE 3                           /**< Minimum size of a Boot Mouse Input Report (as per Appendix B in Device Class Definition for Human Interface Devices (HID), Version 1.11). */
 #define BOOT_MOUSE_INPUT_REPORT_MAX_SIZE 8                           /**< Maximum size of a Boot Mouse Input Report (as per Appendix B in Device Class Definition for Human Interface Devices (HID), Version 1.11). */
 
+#define REP_TARGET_BOOT_KB               0xFE                        /**< Queue target of the Boot Keyboard Input Report. */
+#define REP_TARGET_BOOT_MOUSE            0xFF                        /**< Queue target of the Boot Mouse Input Report. */
+
+STATIC_ASSERT(BLE_HIDS_MAX_INPUT_REP < REP_TARGET_BOOT_KB);
+STATIC_ASSERT(BLE_HIDS_REP_QUEUE_DATA_MAX >= BOOT_KB_INPUT_REPORT_MAX_SIZE);
+STATIC_ASSERT(BLE_HIDS_REP_QUEUE_DATA_MAX <= 0xFF);
+
 
 /**@brief Function for making a HID Service characteristic id.
  *
@@ -107,6 +115,245 @@ static void on_disconnect(ble_hids_t * p_hids, ble_evt_t * p_ble_evt)
 {
     UNUSED_PARAMETER(p_ble_evt);
     p_hids->conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    // Reports are meaningless to the next host.
+    CRITICAL_REGION_ENTER();
+    p_hids->rep_queue.count        = 0;
+    p_hids->rep_queue.move_pending = false;
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Function for sending a report from the queue.
+ *
+ * @param[in]   p_hids      HID Service structure.
+ * @param[in]   target      Index of the Input Report characteristic, or a boot report target.
+ * @param[in]   len         Length of the report.
+ * @param[in]   p_data      Report data.
+ *
+ * @return      NRF_SUCCESS if the report was handed to the stack, otherwise an error code.
+ */
+static uint32_t rep_hvx(ble_hids_t * p_hids, uint8_t target, uint16_t len, uint8_t * p_data)
+{
+    uint32_t               err_code;
+    ble_gatts_hvx_params_t hvx_params;
+    uint16_t               hvx_len = len;
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+
+    if (target == REP_TARGET_BOOT_KB)
+    {
+        hvx_params.handle = p_hids->boot_kb_inp_rep_handles.value_handle;
+    }
+    else if (target == REP_TARGET_BOOT_MOUSE)
+    {
+        hvx_params.handle = p_hids->boot_mouse_inp_rep_handles.value_handle;
+    }
+    else
+    {
+        hvx_params.handle = p_hids->inp_rep_array[target].char_handles.value_handle;
+    }
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.offset = 0;
+    hvx_params.p_len  = &hvx_len;
+    hvx_params.p_data = p_data;
+
+    err_code = sd_ble_gatts_hvx(p_hids->conn_handle, &hvx_params);
+    if (err_code == NRF_SUCCESS)
+    {
+        p_hids->rep_queue.reps_sent++;
+        if (hvx_len != len)
+        {
+            err_code = NRF_ERROR_DATA_SIZE;
+        }
+    }
+
+    return err_code;
+}
+
+
+/**@brief Function for encoding the pending mouse movement.
+ *
+ * @details The encoded part of the movement is subtracted from the deltas.
+ *
+ * @param[in]   p_hids      HID Service structure.
+ * @param[inout] p_x_delta  Horizontal movement.
+ * @param[inout] p_y_delta  Vertical movement.
+ * @param[out]  p_target    Target of the report.
+ * @param[out]  p_report    Report, BLE_HIDS_REP_QUEUE_DATA_MAX bytes long.
+ *
+ * @return      Length of the report.
+ */
+static uint16_t movement_encode(ble_hids_t * p_hids,
+                                int16_t    * p_x_delta,
+                                int16_t    * p_y_delta,
+                                uint8_t    * p_target,
+                                uint8_t    * p_report)
+{
+    ble_hids_rep_queue_t * p_queue = &p_hids->rep_queue;
+
+    if (p_queue->move_boot)
+    {
+        int16_t x = MAX(MIN(*p_x_delta, INT8_MAX), INT8_MIN);
+        int16_t y = MAX(MIN(*p_y_delta, INT8_MAX), INT8_MIN);
+
+        p_report[0] = p_queue->move_buttons;
+        p_report[1] = (uint8_t)x;
+        p_report[2] = (uint8_t)y;
+
+        *p_x_delta -= x;
+        *p_y_delta -= y;
+        *p_target   = REP_TARGET_BOOT_MOUSE;
+
+        return BOOT_MOUSE_INPUT_REPORT_MIN_SIZE;
+    }
+
+    *p_target = p_hids->movement_rep_index;
+
+    return p_hids->movement_encode(p_queue->move_buttons, p_x_delta, p_y_delta, p_report);
+}
+
+
+/**@brief Function for passing an error of a queued report to the application.
+ *
+ * @details Errors caused by the link going down or notifications being disabled are expected, and
+ *          ignored like the examples do.
+ *
+ * @param[in]   p_hids      HID Service structure.
+ * @param[in]   err_code    Error from sending the report.
+ */
+static void rep_error_report(ble_hids_t * p_hids, uint32_t err_code)
+{
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_INVALID_STATE) &&
+        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING) &&
+        (p_hids->error_handler != NULL)
+       )
+    {
+        p_hids->error_handler(err_code);
+    }
+}
+
+
+/**@brief Function for sending queued reports until the transmit buffers are full.
+ *
+ * @details Must be called from a critical region.
+ *
+ * @param[in]   p_hids      HID Service structure.
+ */
+static void rep_queue_flush(ble_hids_t * p_hids)
+{
+    ble_hids_rep_queue_t * p_queue = &p_hids->rep_queue;
+    uint32_t               err_code;
+
+    while (p_queue->count > 0)
+    {
+        ble_hids_rep_queue_entry_t * p_entry = &p_queue->entries[p_queue->rp];
+
+        err_code = rep_hvx(p_hids, p_entry->target, p_entry->len, p_entry->data);
+        if (err_code == BLE_ERROR_NO_TX_BUFFERS)
+        {
+            return;
+        }
+        rep_error_report(p_hids, err_code);
+
+        p_queue->rp = (p_queue->rp + 1) % BLE_HIDS_REP_QUEUE_SIZE;
+        p_queue->count--;
+    }
+
+    while (p_queue->move_pending)
+    {
+        uint8_t  report[BLE_HIDS_REP_QUEUE_DATA_MAX];
+        uint8_t  target;
+        int16_t  x_delta = p_queue->move_x;
+        int16_t  y_delta = p_queue->move_y;
+        uint16_t len     = movement_encode(p_hids, &x_delta, &y_delta, &target, report);
+
+        err_code = rep_hvx(p_hids, target, len, report);
+        if (err_code == BLE_ERROR_NO_TX_BUFFERS)
+        {
+            // Keep the whole movement, it is merged with the next one.
+            return;
+        }
+        rep_error_report(p_hids, err_code);
+
+        // Movement larger than a report is sent in several reports.
+        if ((err_code != NRF_SUCCESS) ||
+            ((x_delta == 0) && (y_delta == 0)) ||
+            ((x_delta == p_queue->move_x) && (y_delta == p_queue->move_y))
+           )
+        {
+            p_queue->move_pending = false;
+        }
+        p_queue->move_x = x_delta;
+        p_queue->move_y = y_delta;
+    }
+}
+
+
+/**@brief Function for queueing a report, or sending it at once if no report is waiting.
+ *
+ * @param[in]   p_hids      HID Service structure.
+ * @param[in]   target      Index of the Input Report characteristic, or a boot report target.
+ * @param[in]   len         Length of the report.
+ * @param[in]   p_data      Report data.
+ *
+ * @return      NRF_SUCCESS if the report was sent or queued, otherwise an error code.
+ */
+static uint32_t rep_queue_push(ble_hids_t * p_hids, uint8_t target, uint16_t len, uint8_t * p_data)
+{
+    ble_hids_rep_queue_t * p_queue  = &p_hids->rep_queue;
+    uint32_t               err_code = BLE_ERROR_NO_TX_BUFFERS;
+
+    if (p_hids->conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (len > BLE_HIDS_REP_QUEUE_DATA_MAX)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    if ((p_queue->count == 0) && !p_queue->move_pending)
+    {
+        err_code = rep_hvx(p_hids, target, len, p_data);
+    }
+
+    if (err_code == BLE_ERROR_NO_TX_BUFFERS)
+    {
+        if (p_queue->count < BLE_HIDS_REP_QUEUE_SIZE)
+        {
+            ble_hids_rep_queue_entry_t * p_entry =
+                &p_queue->entries[(p_queue->rp + p_queue->count) % BLE_HIDS_REP_QUEUE_SIZE];
+
+            p_entry->target = target;
+            p_entry->len    = (uint8_t)len;
+            memcpy(p_entry->data, p_data, len);
+            p_queue->count++;
+
+            err_code = NRF_SUCCESS;
+        }
+        else
+        {
+            err_code = NRF_ERROR_NO_MEM;
+        }
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+/**@brief Function for adding two deltas without wrapping around.
+ */
+static int16_t delta_add(int16_t a, int16_t b)
+{
+    int32_t sum = (int32_t)a + b;
+
+    return (int16_t)MAX(MIN(sum, INT16_MAX), INT16_MIN);
 }
 
 
@@ -416,6 +663,13 @@ void ble_hids_on_ble_evt(ble_hids_t * p_hids, ble_evt_t * p_ble_evt)
         case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
             on_rw_authorize_request(p_hids, p_ble_evt);
             break;
+
+        case BLE_EVT_TX_COMPLETE:
+            CRITICAL_REGION_ENTER();
+            rep_queue_flush(p_hids);
+            CRITICAL_REGION_EXIT();
+            break;
+
         default:
             // No implementation needed.
             break;
@@ -1108,6 +1362,9 @@ uint32_t ble_hids_init(ble_hids_t * p_hids, const ble_hids_init_t * p_hids_init)
     p_hids->outp_rep_count    = p_hids_init->outp_rep_count;
     p_hids->feature_rep_count = p_hids_init->feature_rep_count;
     p_hids->conn_handle       = BLE_CONN_HANDLE_INVALID;
+    p_hids->movement_rep_index = p_hids_init->movement_rep_index;
+    p_hids->movement_encode    = p_hids_init->movement_encode;
+    memset(&p_hids->rep_queue, 0, sizeof(p_hids->rep_queue));
 
     // Add service.
     BLE_UUID_BLE_ASSIGN(ble_uuid, BLE_UUID_HUMAN_INTERFACE_DEVICE_SERVICE);
@@ -1355,6 +1612,114 @@ uint32_t ble_hids_boot_mouse_inp_rep_send(ble_hids_t * p_hids,
 }
 
 
+uint32_t ble_hids_inp_rep_queue(ble_hids_t * p_hids,
+                                uint8_t      rep_index,
+                                uint16_t     len,
+                                uint8_t    * p_data)
+{
+    if (rep_index >= p_hids->inp_rep_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    return rep_queue_push(p_hids, rep_index, len, p_data);
+}
+
+
+uint32_t ble_hids_boot_kb_inp_rep_queue(ble_hids_t * p_hids, uint16_t len, uint8_t * p_data)
+{
+    return rep_queue_push(p_hids, REP_TARGET_BOOT_KB, len, p_data);
+}
+
+
+uint32_t ble_hids_mouse_movement_queue(ble_hids_t * p_hids,
+                                       bool         boot_mode,
+                                       uint8_t      buttons,
+                                       int16_t      x_delta,
+                                       int16_t      y_delta)
+{
+    ble_hids_rep_queue_t * p_queue  = &p_hids->rep_queue;
+    uint32_t               err_code = NRF_SUCCESS;
+
+    if (p_hids->conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (!boot_mode && (p_hids->movement_encode == NULL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    if (p_queue->move_pending &&
+        ((p_queue->move_boot != boot_mode) || (p_queue->move_buttons != buttons))
+       )
+    {
+        // Queue the pending movement with its own button state, so that no click is lost.
+        if (p_queue->count < BLE_HIDS_REP_QUEUE_SIZE)
+        {
+            ble_hids_rep_queue_entry_t * p_entry =
+                &p_queue->entries[(p_queue->rp + p_queue->count) % BLE_HIDS_REP_QUEUE_SIZE];
+
+            p_entry->len = (uint8_t)movement_encode(p_hids,
+                                                    &p_queue->move_x,
+                                                    &p_queue->move_y,
+                                                    &p_entry->target,
+                                                    p_entry->data);
+            p_queue->count++;
+        }
+        else
+        {
+            err_code = NRF_ERROR_NO_MEM;
+        }
+    }
+
+    if (err_code == NRF_SUCCESS)
+    {
+        if (p_queue->move_pending)
+        {
+            p_queue->moves_merged++;
+            p_queue->move_x = delta_add(p_queue->move_x, x_delta);
+            p_queue->move_y = delta_add(p_queue->move_y, y_delta);
+        }
+        else
+        {
+            p_queue->move_pending = true;
+            p_queue->move_x       = x_delta;
+            p_queue->move_y       = y_delta;
+        }
+        p_queue->move_boot    = boot_mode;
+        p_queue->move_buttons = buttons;
+
+        if (p_queue->count == 0)
+        {
+            rep_queue_flush(p_hids);
+        }
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+uint32_t ble_hids_rep_rate_get(ble_hids_t * p_hids, uint32_t elapsed_ms)
+{
+    uint32_t reps_sent = p_hids->rep_queue.reps_sent;
+    uint32_t reps      = reps_sent - p_hids->rep_queue.rate_reps_sent;
+
+    p_hids->rep_queue.rate_reps_sent = reps_sent;
+
+    if (elapsed_ms == 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t)(((uint64_t)reps * 1000) / elapsed_ms);
+}
+
+
 uint32_t ble_hids_outp_rep_get(ble_hids_t * p_hids,
                                uint8_t      rep_index,
                                uint16_t     len,
@@ -62,6 +62,14 @@
 #define HID_INFO_FLAG_REMOTE_WAKE_MSK           0x01
 #define HID_INFO_FLAG_NORMALLY_CONNECTABLE_MSK  0x02
 
+// Input Report queue
+#ifndef BLE_HIDS_REP_QUEUE_SIZE
+#define BLE_HIDS_REP_QUEUE_SIZE                 8       /**< Number of Input Reports held by the queue of each service instance. */
+#endif
+#ifndef BLE_HIDS_REP_QUEUE_DATA_MAX
+#define BLE_HIDS_REP_QUEUE_DATA_MAX             8       /**< Maximum length of a queued Input Report. */
+#endif
+
 /**@brief HID Service characteristic id. */
 typedef struct
 {
@@ -153,6 +161,47 @@ typedef struct
     uint8_t                       read_resp : 1;    /**< Should application generate a response to read requests. */
 } ble_hids_feature_rep_init_t;
 
+/**@brief Mouse movement encoder, for the Input Report carrying mouse movement in Report mode.
+ *
+ * @details Encodes as much of the accumulated movement as the report can hold, and leaves the rest
+ *          in the deltas, to be sent in the next report.
+ *
+ * @param[in]     buttons    State of the mouse buttons.
+ * @param[in,out] p_x_delta  Accumulated horizontal movement, minus the encoded part on return.
+ * @param[in,out] p_y_delta  Accumulated vertical movement, minus the encoded part on return.
+ * @param[out]    p_report   Report to encode, BLE_HIDS_REP_QUEUE_DATA_MAX bytes long.
+ *
+ * @return      Length of the encoded report.
+ */
+typedef uint16_t (*ble_hids_movement_encode_t) (uint8_t   buttons,
+                                                int16_t * p_x_delta,
+                                                int16_t * p_y_delta,
+                                                uint8_t * p_report);
+
+/**@brief Queued Input Report. */
+typedef struct
+{
+    uint8_t                       target;                                       /**< Index of the Input Report characteristic, or one of the boot report targets. */
+    uint8_t                       len;                                          /**< Length of the report. */
+    uint8_t                       data[BLE_HIDS_REP_QUEUE_DATA_MAX];            /**< Report data. */
+} ble_hids_rep_queue_entry_t;
+
+/**@brief Input Report queue, and the mouse movement waiting for a free buffer. */
+typedef struct
+{
+    ble_hids_rep_queue_entry_t    entries[BLE_HIDS_REP_QUEUE_SIZE];             /**< Queued reports, sent in order. */
+    uint8_t                       rp;                                           /**< Index of the oldest queued report. */
+    uint8_t                       count;                                        /**< Number of queued reports. */
+    bool                          move_pending;                                 /**< Mouse movement waits for a free buffer. */
+    bool                          move_boot;                                    /**< The pending movement is sent as a Boot Mouse Input Report. */
+    uint8_t                       move_buttons;                                 /**< Button state of the pending movement. */
+    int16_t                       move_x;                                       /**< Accumulated horizontal movement. */
+    int16_t                       move_y;                                       /**< Accumulated vertical movement. */
+    uint32_t                      reps_sent;                                    /**< Input Reports handed to the stack since initialization. */
+    uint32_t                      moves_merged;                                 /**< Mouse movements merged into a pending movement. */
+    uint32_t                      rate_reps_sent;                               /**< Value of reps_sent at the last rate measurement. */
+} ble_hids_rep_queue_t;
+
 /**@brief HID Service Report Map characteristic init structure. This contains all options and data 
  *        needed for initialization of the Report Map characteristic. */
 typedef struct
@@ -194,6 +243,8 @@ typedef struct
     ble_srv_cccd_security_mode_t  security_mode_boot_mouse_inp_rep;             /**< Security settings for HID service Mouse input report attribute */
     ble_srv_cccd_security_mode_t  security_mode_boot_kb_inp_rep;                /**< Security settings for HID service Keyboard input report attribute */
     ble_srv_security_mode_t       security_mode_boot_kb_outp_rep;               /**< Security settings for HID service Keyboard output report attribute */
+    uint8_t                       movement_rep_index;                           /**< Index of the Input Report characteristic carrying mouse movement in Report mode. */
+    ble_hids_movement_encode_t    movement_encode;                              /**< Encoder of the mouse movement in Report mode, NULL if movement is only queued in Boot mode. */
 } ble_hids_init_t;
 
 /**@brief HID Service structure. This contains various status information for the service. */
@@ -217,6 +268,9 @@ struct ble_hids_s
     ble_gatts_char_handles_t      hid_information_handles;                      /**< Handles related to the Report Map characteristic. */
     ble_gatts_char_handles_t      hid_control_point_handles;                    /**< Handles related to the Report Map characteristic. */
     uint16_t                      conn_handle;                                  /**< Handle of the current connection (as provided by the BLE stack, is BLE_CONN_HANDLE_INVALID if not in a connection). */
+    uint8_t                       movement_rep_index;                           /**< Index of the Input Report characteristic carrying mouse movement in Report mode. */
+    ble_hids_movement_encode_t    movement_encode;                              /**< Encoder of the mouse movement in Report mode. */
+    ble_hids_rep_queue_t          rep_queue;                                    /**< Input Reports waiting for free transmit buffers. */
 };
 
 /**@brief Function for initializing the HID Service.
@@ -290,6 +344,81 @@ uint32_t ble_hids_boot_mouse_inp_rep_send(ble_hids_t * p_hids,
                                           uint16_t     optional_data_len,
                                           uint8_t *    p_optional_data);
 
+/**@brief Function for queueing an Input Report.
+ *
+ * @details The report is sent at once if no report is waiting, otherwise it is copied to the queue
+ *          and sent when the stack frees transmit buffers, in the order of the calls. Queued
+ *          reports are never dropped while connected, which suits keyboard reports, where a lost
+ *          release would leave a key pressed. The queue is emptied on disconnection.
+ *
+ * @param[in]   p_hids       HID Service structure.
+ * @param[in]   rep_index    Index of the characteristic (corresponding to the index in
+ *                           ble_hids_t.inp_rep_array as passed to ble_hids_init()).
+ * @param[in]   len          Length of data to be sent, at most BLE_HIDS_REP_QUEUE_DATA_MAX.
+ * @param[in]   p_data       Pointer to data to be sent.
+ *
+ * @retval      NRF_SUCCESS              The report was sent or queued.
+ * @retval      NRF_ERROR_INVALID_PARAM  The index is invalid.
+ * @retval      NRF_ERROR_DATA_SIZE      The report is longer than BLE_HIDS_REP_QUEUE_DATA_MAX.
+ * @retval      NRF_ERROR_INVALID_STATE  Not connected.
+ * @retval      NRF_ERROR_NO_MEM         The queue is full.
+ */
+uint32_t ble_hids_inp_rep_queue(ble_hids_t * p_hids,
+                                uint8_t      rep_index,
+                                uint16_t     len,
+                                uint8_t *    p_data);
+
+/**@brief Function for queueing a Boot Keyboard Input Report.
+ *
+ * @details See @ref ble_hids_inp_rep_queue.
+ *
+ * @param[in]   p_hids       HID Service structure.
+ * @param[in]   len          Length of data to be sent.
+ * @param[in]   p_data       Pointer to data to be sent.
+ *
+ * @return      As for @ref ble_hids_inp_rep_queue.
+ */
+uint32_t ble_hids_boot_kb_inp_rep_queue(ble_hids_t * p_hids,
+                                        uint16_t     len,
+                                        uint8_t *    p_data);
+
+/**@brief Function for queueing mouse movement.
+ *
+ * @details While all transmit buffers are in use, the movement is added to the movement waiting
+ *          for a free buffer, so a mouse can report at any rate without losing movement or filling
+ *          the queue. Movement with another button state is queued as a report of its own, so no
+ *          click is lost. The movement is sent after the reports queued before it.
+ *
+ * @param[in]   p_hids       HID Service structure.
+ * @param[in]   boot_mode    Send a Boot Mouse Input Report, as in Boot Protocol Mode. Otherwise
+ *                           the report is encoded by ble_hids_init_t.movement_encode.
+ * @param[in]   buttons      State of mouse buttons.
+ * @param[in]   x_delta      Horizontal movement.
+ * @param[in]   y_delta      Vertical movement.
+ *
+ * @retval      NRF_SUCCESS              The movement was sent or queued.
+ * @retval      NRF_ERROR_INVALID_PARAM  No movement encoder was given for Report mode.
+ * @retval      NRF_ERROR_INVALID_STATE  Not connected.
+ * @retval      NRF_ERROR_NO_MEM         The queue is full, and the button state has changed.
+ */
+uint32_t ble_hids_mouse_movement_queue(ble_hids_t * p_hids,
+                                       bool         boot_mode,
+                                       uint8_t      buttons,
+                                       int16_t      x_delta,
+                                       int16_t      y_delta);
+
+/**@brief Function for getting the Input Report rate achieved since the previous call.
+ *
+ * @details Counts all Input Reports handed to the stack, queued or not. Call periodically, for
+ *          example from an app_timer.
+ *
+ * @param[in]   p_hids       HID Service structure.
+ * @param[in]   elapsed_ms   Time since the previous call.
+ *
+ * @return      Input Reports per second.
+ */
+uint32_t ble_hids_rep_rate_get(ble_hids_t * p_hids, uint32_t elapsed_ms);
+
 /**@brief Function for getting the current value of Output Report from the stack.
  *
  * @details Fetches the current value of the output report characteristic from the stack.
@@ -43,6 +43,104 @@ static void on_disconnect(ble_nus_t * p_nus, ble_evt_t * p_ble_evt)
 {
     UNUSED_PARAMETER(p_ble_evt);
     p_nus->conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    if (p_nus->is_stream_enabled)
+    {
+        // Data not sent yet belongs to the previous connection.
+        UNUSED_VARIABLE(app_fifo_flush(&p_nus->stream_fifo));
+        p_nus->is_stream_flush_pending = false;
+    }
+}
+
+
+/**@brief Function for getting the number of bytes in the stream.
+ *
+ * @param[in] p_nus     Nordic UART Service structure.
+ *
+ * @return Number of bytes put in the stream and not sent yet.
+ */
+static uint32_t stream_length(ble_nus_t * p_nus)
+{
+    uint32_t length;
+
+    UNUSED_VARIABLE(app_fifo_read(&p_nus->stream_fifo, NULL, &length));
+    return length;
+}
+
+
+/**@brief Function for sending notifications from the stream until it is empty or the SoftDevice
+ *        has no TX buffer left.
+ *
+ * @details Data is sent from the stream in place, or copied out without consuming it where it
+ *          wraps around the end of the buffer, and only consumed once the SoftDevice has accepted
+ *          the notification, so no data is lost when it runs out of TX buffers.
+ *
+ * @param[in] p_nus     Nordic UART Service structure.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code from sd_ble_gatts_hvx.
+ */
+static uint32_t stream_send(ble_nus_t * p_nus)
+{
+    uint32_t               err_code;
+    uint32_t               span;
+    uint16_t               length;
+    uint8_t              * p_data;
+    uint8_t                data[BLE_NUS_MAX_DATA_LEN];
+    ble_gatts_hvx_params_t hvx_params;
+
+    if ((p_nus->conn_handle == BLE_CONN_HANDLE_INVALID) || (!p_nus->is_notification_enabled))
+    {
+        return NRF_SUCCESS;
+    }
+
+    for (;;)
+    {
+        length = MIN(stream_length(p_nus), BLE_NUS_MAX_DATA_LEN);
+
+        if ((length == 0) || ((length < BLE_NUS_MAX_DATA_LEN) && !p_nus->is_stream_flush_pending))
+        {
+            break;
+        }
+
+        UNUSED_VARIABLE(app_fifo_span_get(&p_nus->stream_fifo, &p_data, &span));
+
+        if (span < length)
+        {
+            memcpy(data, p_data, span);
+            memcpy(&data[span], p_nus->stream_fifo.p_buf, length - span);
+            p_data = data;
+        }
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = p_nus->rx_handles.value_handle;
+        hvx_params.p_data = p_data;
+        hvx_params.p_len  = &length;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+
+        err_code = sd_ble_gatts_hvx(p_nus->conn_handle, &hvx_params);
+
+        if (err_code == BLE_ERROR_NO_TX_BUFFERS)
+        {
+            // Sending is resumed on BLE_EVT_TX_COMPLETE.
+            p_nus->stream_stats.tx_full_count++;
+            return NRF_SUCCESS;
+        }
+
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+
+        UNUSED_VARIABLE(app_fifo_consume(&p_nus->stream_fifo, length));
+
+        p_nus->stream_stats.tx_bytes += length;
+        p_nus->stream_stats.tx_packets++;
+    }
+
+    p_nus->is_stream_flush_pending = false;
+
+    return NRF_SUCCESS;
 }
 
 
@@ -219,6 +317,13 @@ void ble_nus_on_ble_evt(ble_nus_t * p_nus, ble_evt_t * p_ble_evt)
             on_write(p_nus, p_ble_evt);
             break;
 
+        case BLE_EVT_TX_COMPLETE:
+            if (p_nus->is_stream_enabled)
+            {
+                UNUSED_VARIABLE(stream_send(p_nus));
+            }
+            break;
+
         default:
             // No implementation needed.
             break;
@@ -241,6 +346,23 @@ uint32_t ble_nus_init(ble_nus_t * p_nus, const ble_nus_init_t * p_nus_init)
     p_nus->conn_handle             = BLE_CONN_HANDLE_INVALID;
     p_nus->data_handler            = p_nus_init->data_handler;
     p_nus->is_notification_enabled = false;
+    p_nus->is_stream_enabled       = false;
+    p_nus->is_stream_flush_pending = false;
+
+    memset(&p_nus->stream_stats, 0, sizeof(p_nus->stream_stats));
+
+    if (p_nus_init->p_stream_buf != NULL)
+    {
+        err_code = app_fifo_init(&p_nus->stream_fifo,
+                                 p_nus_init->p_stream_buf,
+                                 p_nus_init->stream_buf_size);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+
+        p_nus->is_stream_enabled = true;
+    }
 
     /**@snippet [Adding proprietary Service to S110 SoftDevice] */
     // Add a custom base UUID.
@@ -311,3 +433,63 @@ uint32_t ble_nus_string_send(ble_nus_t * p_nus, uint8_t * p_string, uint16_t len
 }
 
 
+uint32_t ble_nus_stream_put(ble_nus_t * p_nus, uint8_t const * p_data, uint16_t length)
+{
+    uint32_t size;
+
+    if ((p_nus == NULL) || (p_data == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if ((!p_nus->is_stream_enabled) ||
+        (p_nus->conn_handle == BLE_CONN_HANDLE_INVALID) ||
+        (!p_nus->is_notification_enabled))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    UNUSED_VARIABLE(app_fifo_write(&p_nus->stream_fifo, NULL, &size));
+
+    if (length > size)
+    {
+        p_nus->stream_stats.drop_bytes += length;
+        return NRF_ERROR_NO_MEM;
+    }
+
+    size = length;
+    UNUSED_VARIABLE(app_fifo_write(&p_nus->stream_fifo, p_data, &size));
+
+    return stream_send(p_nus);
+}
+
+
+uint32_t ble_nus_stream_flush(ble_nus_t * p_nus)
+{
+    if (p_nus == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if ((!p_nus->is_stream_enabled) || (p_nus->conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    p_nus->is_stream_flush_pending = true;
+
+    return stream_send(p_nus);
+}
+
+
+uint32_t ble_nus_stream_stats_get(ble_nus_t const * p_nus, ble_nus_stream_stats_t * p_stats)
+{
+    if ((p_nus == NULL) || (p_stats == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    *p_stats = p_nus->stream_stats;
+
+    return NRF_SUCCESS;
+}
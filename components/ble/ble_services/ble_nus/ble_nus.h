@@ -25,6 +25,11 @@
  *          is used by the application to send and receive ASCII text strings to and from the
  *          peer.
  *
+ *          For bulk data, a stream buffer can be given at initialization. Data put in the stream
+ *          with @ref ble_nus_stream_put is sent in notifications of BLE_NUS_MAX_DATA_LEN bytes,
+ *          as many as the SoftDevice has TX buffers for, and the rest is sent when
+ *          @ref BLE_EVT_TX_COMPLETE returns buffers. Data is only lost if the stream buffer is full.
+ *
  * @note The application must propagate S110 SoftDevice events to the Nordic UART Service module
  *       by calling the ble_nus_on_ble_evt() function from the ble_stack_handler callback.
  */
@@ -34,6 +39,7 @@
 
 #include "ble.h"
 #include "ble_srv_common.h"
+#include "app_fifo.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -54,9 +60,20 @@ typedef void (*ble_nus_data_handler_t) (ble_nus_t * p_nus, uint8_t * p_data, uin
  */
 typedef struct
 {
-    ble_nus_data_handler_t data_handler; /**< Event handler to be called for handling received data. */
+    ble_nus_data_handler_t data_handler;    /**< Event handler to be called for handling received data. */
+    uint8_t *              p_stream_buf;    /**< Buffer of the stream, see @ref ble_nus_stream_put. NULL if the stream is not used. */
+    uint16_t               stream_buf_size; /**< Size of the stream buffer, a power of two. */
 } ble_nus_init_t;
 
+/**@brief Nordic UART Service stream statistics. */
+typedef struct
+{
+    uint32_t tx_bytes;      /**< Number of bytes sent from the stream. */
+    uint32_t tx_packets;    /**< Number of notifications sent from the stream. */
+    uint32_t tx_full_count; /**< Number of times sending stopped because the SoftDevice had no TX buffer left. */
+    uint32_t drop_bytes;    /**< Number of bytes refused by @ref ble_nus_stream_put because the stream buffer was full. */
+} ble_nus_stream_stats_t;
+
 /**@brief Nordic UART Service structure.
  *
  * @details This structure contains status information related to the service.
@@ -70,6 +87,10 @@ struct ble_nus_s
     uint16_t                 conn_handle;             /**< Handle of the current connection (as provided by the S110 SoftDevice). BLE_CONN_HANDLE_INVALID if not in a connection. */
     bool                     is_notification_enabled; /**< Variable to indicate if the peer has enabled notification of the RX characteristic.*/
     ble_nus_data_handler_t   data_handler;            /**< Event handler to be called for handling received data. */
+    app_fifo_t               stream_fifo;             /**< Data put in the stream and not sent yet. */
+    bool                     is_stream_enabled;       /**< Variable to indicate if a stream buffer was given at initialization. */
+    bool                     is_stream_flush_pending; /**< Variable to indicate if the stream must be sent even if the last notification is not full. */
+    ble_nus_stream_stats_t   stream_stats;            /**< Statistics of the stream. */
 };
 
 /**@brief Function for initializing the Nordic UART Service.
@@ -109,6 +130,49 @@ void ble_nus_on_ble_evt(ble_nus_t * p_nus, ble_evt_t * p_ble_evt);
  */
 uint32_t ble_nus_string_send(ble_nus_t * p_nus, uint8_t * p_string, uint16_t length);
 
+/**@brief Function for putting data in the stream to the peer.
+ *
+ * @details The data is copied to the stream buffer and sent in notifications of
+ *          BLE_NUS_MAX_DATA_LEN bytes. Data that does not fill a notification is kept until more
+ *          data is put or @ref ble_nus_stream_flush is called.
+ *
+ * @param[in] p_nus       Pointer to the Nordic UART Service structure.
+ * @param[in] p_data      Data to be sent.
+ * @param[in] length      Length of the data.
+ *
+ * @retval NRF_SUCCESS             If the data was put in the stream.
+ * @retval NRF_ERROR_NULL          If p_nus or p_data is NULL.
+ * @retval NRF_ERROR_INVALID_STATE If the stream is not used, there is no connection or the peer
+ *                                 has not enabled notifications.
+ * @retval NRF_ERROR_NO_MEM        If the stream buffer cannot hold the data. Nothing is put.
+ * @return Errors from sd_ble_gatts_hvx other than BLE_ERROR_NO_TX_BUFFERS.
+ */
+uint32_t ble_nus_stream_put(ble_nus_t * p_nus, uint8_t const * p_data, uint16_t length);
+
+/**@brief Function for sending all data in the stream, including a last notification that is not
+ *        full.
+ *
+ * @param[in] p_nus       Pointer to the Nordic UART Service structure.
+ *
+ * @retval NRF_SUCCESS             If the data is sent or will be sent when TX buffers are freed.
+ * @retval NRF_ERROR_NULL          If p_nus is NULL.
+ * @retval NRF_ERROR_INVALID_STATE If the stream is not used or there is no connection.
+ * @return Errors from sd_ble_gatts_hvx other than BLE_ERROR_NO_TX_BUFFERS.
+ */
+uint32_t ble_nus_stream_flush(ble_nus_t * p_nus);
+
+/**@brief Function for getting the statistics of the stream.
+ *
+ * @details Throughput is obtained by sampling tx_bytes periodically.
+ *
+ * @param[in]  p_nus      Pointer to the Nordic UART Service structure.
+ * @param[out] p_stats    Statistics since the service was initialized.
+ *
+ * @retval NRF_SUCCESS    On success.
+ * @retval NRF_ERROR_NULL If p_nus or p_stats is NULL.
+ */
+uint32_t ble_nus_stream_stats_get(ble_nus_t const * p_nus, ble_nus_stream_stats_t * p_stats);
+
 #endif // BLE_NUS_H__
 
 /** @} */
@@ -532,15 +532,14 @@ static uint32_t srdata_check(const ble_advdata_t * p_srdata)
 }
 
 
-uint32_t ble_advdata_set(const ble_advdata_t * p_advdata, const ble_advdata_t * p_srdata)
+static uint32_t advdata_encode(const ble_advdata_t * p_advdata,
+                               const ble_advdata_t * p_srdata,
+                               uint8_t             * p_encoded_advdata,
+                               uint8_t             * p_len_advdata,
+                               uint8_t             * p_encoded_srdata,
+                               uint8_t             * p_len_srdata)
 {
-    uint32_t  err_code;
-    uint8_t   len_advdata = 0;
-    uint8_t   len_srdata  = 0;
-    uint8_t   encoded_advdata[BLE_GAP_ADV_MAX_SIZE];
-    uint8_t   encoded_srdata[BLE_GAP_ADV_MAX_SIZE];
-    uint8_t * p_encoded_advdata;
-    uint8_t * p_encoded_srdata;
+    uint32_t err_code;
 
     // Encode advertising data (if supplied).
     if (p_advdata != NULL)
@@ -551,16 +550,11 @@ uint32_t ble_advdata_set(const ble_advdata_t * p_advdata, const ble_advdata_t *
             return err_code;
         }
 
-        err_code = adv_data_encode(p_advdata, encoded_advdata, &len_advdata);
+        err_code = adv_data_encode(p_advdata, p_encoded_advdata, p_len_advdata);
         if (err_code != NRF_SUCCESS)
         {
             return err_code;
         }
-        p_encoded_advdata = encoded_advdata;
-    }
-    else
-    {
-        p_encoded_advdata = NULL;
     }
 
     // Encode scan response data (if supplied).
@@ -572,18 +566,142 @@ uint32_t ble_advdata_set(const ble_advdata_t * p_advdata, const ble_advdata_t *
             return err_code;
         }
 
-        err_code = adv_data_encode(p_srdata, encoded_srdata, &len_srdata);
+        err_code = adv_data_encode(p_srdata, p_encoded_srdata, p_len_srdata);
         if (err_code != NRF_SUCCESS)
         {
             return err_code;
         }
-        p_encoded_srdata = encoded_srdata;
     }
-    else
+
+    return NRF_SUCCESS;
+}
+
+
+static uint8_t * field_find(uint8_t * p_encoded_data, uint8_t len, uint8_t ad_type)
+{
+    uint8_t index = 0;
+
+    // Each field is a length octet, covering the AD type and the content, followed by them.
+    while ((index + 1) < len)
+    {
+        if (p_encoded_data[index] == 0)
+        {
+            return NULL;
+        }
+        if (p_encoded_data[index + 1] == ad_type)
+        {
+            return &p_encoded_data[index];
+        }
+        index += p_encoded_data[index] + 1;
+    }
+
+    return NULL;
+}
+
+
+uint32_t ble_advdata_set(const ble_advdata_t * p_advdata, const ble_advdata_t * p_srdata)
+{
+    uint32_t  err_code;
+    uint8_t   len_advdata = 0;
+    uint8_t   len_srdata  = 0;
+    uint8_t   encoded_advdata[BLE_GAP_ADV_MAX_SIZE];
+    uint8_t   encoded_srdata[BLE_GAP_ADV_MAX_SIZE];
+
+    err_code = advdata_encode(p_advdata,
+                              p_srdata,
+                              encoded_advdata,
+                              &len_advdata,
+                              encoded_srdata,
+                              &len_srdata);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Pass encoded advertising data and/or scan response data to the stack.
+    return sd_ble_gap_adv_data_set((p_advdata != NULL) ? encoded_advdata : NULL,
+                                   len_advdata,
+                                   (p_srdata != NULL) ? encoded_srdata : NULL,
+                                   len_srdata);
+}
+
+
+uint32_t ble_advdata_template_set(ble_advdata_template_t * p_template,
+                                  const ble_advdata_t    * p_advdata,
+                                  const ble_advdata_t    * p_srdata)
+{
+    uint32_t err_code;
+
+    if (p_template == NULL)
     {
-        p_encoded_srdata = NULL;
+        return NRF_ERROR_NULL;
+    }
+
+    p_template->adv_len = 0;
+    p_template->sr_len  = 0;
+
+    err_code = advdata_encode(p_advdata,
+                              p_srdata,
+                              p_template->adv_data,
+                              &p_template->adv_len,
+                              p_template->sr_data,
+                              &p_template->sr_len);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
     }
 
     // Pass encoded advertising data and/or scan response data to the stack.
-    return sd_ble_gap_adv_data_set(p_encoded_advdata, len_advdata, p_encoded_srdata, len_srdata);
+    return sd_ble_gap_adv_data_set((p_advdata != NULL) ? p_template->adv_data : NULL,
+                                   p_template->adv_len,
+                                   (p_srdata != NULL) ? p_template->sr_data : NULL,
+                                   p_template->sr_len);
+}
+
+
+uint32_t ble_advdata_template_update(ble_advdata_template_t * p_template,
+                                     uint8_t                  ad_type,
+                                     uint8_t                  offset,
+                                     const uint8_t          * p_data,
+                                     uint8_t                  len)
+{
+    bool      in_srdata = false;
+    uint8_t * p_field;
+    uint8_t * p_content;
+
+    if ((p_template == NULL) || (p_data == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    p_field = field_find(p_template->adv_data, p_template->adv_len, ad_type);
+    if (p_field == NULL)
+    {
+        p_field   = field_find(p_template->sr_data, p_template->sr_len, ad_type);
+        in_srdata = true;
+    }
+    if (p_field == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    // The length octet counts the AD type octet as well as the content.
+    if ((uint16_t)offset + len > p_field[0] - 1)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    p_content = &p_field[ADV_DATA_OFFSET + offset];
+    if (memcmp(p_content, p_data, len) == 0)
+    {
+        return NRF_SUCCESS;
+    }
+    memcpy(p_content, p_data, len);
+
+    // Pass only the packet holding the field to the stack, the other one is left unchanged.
+    if (in_srdata)
+    {
+        return sd_ble_gap_adv_data_set(NULL, 0, p_template->sr_data, p_template->sr_len);
+    }
+    return sd_ble_gap_adv_data_set(p_template->adv_data, p_template->adv_len, NULL, 0);
 }
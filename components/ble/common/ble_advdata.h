@@ -83,6 +83,19 @@ typedef struct
     uint8_t                      service_data_count;                  /**< Number of Service data structures. */
 } ble_advdata_t;
 
+/**@brief Encoded advertising data and scan response data, kept to update single fields in place.
+ *
+ * @details The structure is filled by @ref ble_advdata_template_set and must stay allocated while
+ *          @ref ble_advdata_template_update is used. Its content should not be accessed directly.
+ */
+typedef struct
+{
+    uint8_t                      adv_data[BLE_GAP_ADV_MAX_SIZE];      /**< Encoded advertising data. */
+    uint8_t                      adv_len;                             /**< Length of the encoded advertising data. */
+    uint8_t                      sr_data[BLE_GAP_ADV_MAX_SIZE];       /**< Encoded scan response data. */
+    uint8_t                      sr_len;                              /**< Length of the encoded scan response data. */
+} ble_advdata_template_t;
+
 /**@brief Function for encoding and setting the advertising data and/or scan response data.
  *
  * @details This function encodes advertising data and/or scan response data based on the selections
@@ -108,6 +121,51 @@ typedef struct
  */
 uint32_t ble_advdata_set(const ble_advdata_t * p_advdata, const ble_advdata_t * p_srdata);
 
+/**@brief Function for encoding the advertising data and/or scan response data into a template, and
+ *        setting them.
+ *
+ * @details Works like @ref ble_advdata_set, but keeps the encoded data in the template, so that
+ *          fields that change often, like a sensor value in the manufacturer specific data, can be
+ *          updated with @ref ble_advdata_template_update without encoding all the data again.
+ *
+ * @param[out]  p_template  Template for the encoded data.
+ * @param[in]   p_advdata   Structure for specifying the content of the advertising data.
+ *                          Set to NULL if advertising data is not to be set.
+ * @param[in]   p_srdata    Structure for specifying the content of the scan response data.
+ *                          Set to NULL if scan response data is not to be set.
+ *
+ * @return      As @ref ble_advdata_set.
+ */
+uint32_t ble_advdata_template_set(ble_advdata_template_t * p_template,
+                                  const ble_advdata_t    * p_advdata,
+                                  const ble_advdata_t    * p_srdata);
+
+/**@brief Function for updating part of a field of the encoded data in place.
+ *
+ * @details The first field of the given AD type is searched in the advertising data, then in the
+ *          scan response data. Its content is overwritten from the given offset, and only the
+ *          packet holding the field is passed to the stack. Nothing is passed to the stack if the
+ *          content is unchanged. The length of the field cannot change.
+ *
+ * @param[in,out] p_template  Template filled by @ref ble_advdata_template_set.
+ * @param[in]     ad_type     AD type of the field, for example
+ *                            BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA.
+ * @param[in]     offset      Offset in the field content, after the AD type. For manufacturer
+ *                            specific data and service data, the data follows a 2 byte identifier.
+ * @param[in]     p_data      New content.
+ * @param[in]     len         Length of the new content.
+ *
+ * @retval      NRF_SUCCESS             The field was updated.
+ * @retval      NRF_ERROR_NOT_FOUND     No field of the given type in the template.
+ * @retval      NRF_ERROR_DATA_SIZE     The new content does not fit in the field.
+ * @return      Errors from sd_ble_gap_adv_data_set().
+ */
+uint32_t ble_advdata_template_update(ble_advdata_template_t * p_template,
+                                     uint8_t                  ad_type,
+                                     uint8_t                  offset,
+                                     const uint8_t          * p_data,
+                                     uint8_t                  len);
+
 #endif // BLE_ADVDATA_H__
 
 /** @} */
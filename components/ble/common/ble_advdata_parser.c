@@ -1,4 +1,8 @@
 #include "ble_advdata_parser.h"
+#include "nrf_error.h"
+
+#define UUID16_SIZE  2  /**< Size of a 16-bit UUID in a report. */
+#define UUID128_SIZE 16 /**< Size of a 128-bit UUID in a report. */
 
 uint32_t ble_advdata_parser_field_find(uint8_t    type,
                                        uint8_t  * p_advdata,
@@ -22,3 +26,126 @@ uint32_t ble_advdata_parser_field_find(uint8_t    type,
     }
     return NRF_ERROR_NOT_FOUND;
 }
+
+
+static uint8_t index_slot(uint8_t type)
+{
+    if (type == BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA)
+    {
+        return 0;
+    }
+    // Type 0 is not a valid AD type, its slot holds the manufacturer specific data.
+    return ((type != 0) && (type < BLE_ADVDATA_INDEX_TYPES)) ? type : BLE_ADVDATA_INDEX_TYPES;
+}
+
+
+uint32_t ble_advdata_index_build(ble_advdata_index_t * p_index, uint8_t * p_data, uint8_t len)
+{
+    uint32_t index = 0;
+
+    memset(p_index->offsets, 0, sizeof(p_index->offsets));
+    p_index->p_data = p_data;
+    p_index->len    = 0;
+
+    while (index < len)
+    {
+        uint8_t field_length = p_data[index];
+        uint8_t slot;
+
+        // A length of 0 ends the significant part of the report.
+        if (field_length == 0)
+        {
+            break;
+        }
+        if (index + field_length + 1 > len)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+
+        slot = index_slot(p_data[index + 1]);
+        if ((slot < BLE_ADVDATA_INDEX_TYPES) && (p_index->offsets[slot] == 0))
+        {
+            p_index->offsets[slot] = index + 1;
+        }
+
+        index       += field_length + 1;
+        p_index->len = index;
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_advdata_index_field_get(const ble_advdata_index_t * p_index,
+                                     uint8_t                     type,
+                                     uint8_t **                  pp_field_data,
+                                     uint8_t *                   p_len)
+{
+    uint8_t slot = index_slot(type);
+    uint8_t offset;
+
+    if (slot < BLE_ADVDATA_INDEX_TYPES)
+    {
+        if (p_index->offsets[slot] == 0)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+        offset = p_index->offsets[slot] - 1;
+
+        *pp_field_data = &p_index->p_data[offset + 2];
+        *p_len         = p_index->p_data[offset] - 1;
+        return NRF_SUCCESS;
+    }
+
+    *p_len = p_index->len;
+    return ble_advdata_parser_field_find(type, p_index->p_data, p_len, pp_field_data);
+}
+
+
+static bool uuid_list_find(const ble_advdata_index_t * p_index,
+                           uint8_t                     type,
+                           const uint8_t *             p_uuid,
+                           uint8_t                     uuid_len)
+{
+    uint8_t * p_list;
+    uint8_t   len;
+    uint8_t   i;
+
+    if (ble_advdata_index_field_get(p_index, type, &p_list, &len) != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    for (i = 0; i + uuid_len <= len; i += uuid_len)
+    {
+        // Bytes 12 and 13 of a 128-bit UUID, and both bytes of a 16-bit one, hold the 16-bit part.
+        uint8_t alias = (uuid_len == UUID128_SIZE) ? 12 : 0;
+
+        if ((p_list[i + alias] == p_uuid[alias])         &&
+            (p_list[i + alias + 1] == p_uuid[alias + 1]) &&
+            (memcmp(&p_list[i], p_uuid, uuid_len) == 0))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool ble_advdata_uuid16_find(const ble_advdata_index_t * p_index, uint16_t uuid)
+{
+    uint8_t encoded[UUID16_SIZE];
+
+    (void)uint16_encode(uuid, encoded);
+
+    return uuid_list_find(p_index, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE, encoded, UUID16_SIZE) ||
+           uuid_list_find(p_index, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE, encoded, UUID16_SIZE);
+}
+
+
+bool ble_advdata_uuid128_find(const ble_advdata_index_t * p_index, const ble_uuid128_t * p_uuid)
+{
+    return uuid_list_find(p_index, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE,
+                          p_uuid->uuid128, UUID128_SIZE) ||
+           uuid_list_find(p_index, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE,
+                          p_uuid->uuid128, UUID128_SIZE);
+}
@@ -3,7 +3,75 @@
 
 #include "ble_advdata.h"
 
+#define BLE_ADVDATA_INDEX_TYPES 0x20 /**< AD types below this value, and the manufacturer specific data, are indexed by @ref ble_advdata_index_build. */
+
+/**@brief Index of the fields of an advertising report.
+ *
+ * @details Built in one pass over the report, so that each indexed AD type is found without
+ *          walking the report again. Holds the offset of the first field of each type.
+ */
+typedef struct
+{
+    uint8_t * p_data;                           /**< Indexed report. */
+    uint8_t   len;                              /**< Length of the valid part of the report. */
+    uint8_t   offsets[BLE_ADVDATA_INDEX_TYPES]; /**< Offset plus 1 of the first field of each type, 0 if absent. Manufacturer specific data uses entry 0, AD type 0 being unused. */
+} ble_advdata_index_t;
+
 uint32_t ble_advdata_parse(uint8_t * p_data, uint8_t len, ble_advdata_t * advdata);
 uint32_t ble_advdata_parser_field_find(uint8_t type, uint8_t * p_advdata, uint8_t * len, uint8_t ** pp_field_data);
 
+/**@brief Function for indexing the fields of an advertising report.
+ *
+ * @param[out] p_index  Index of the report.
+ * @param[in]  p_data   Report, for example the data of a BLE_GAP_EVT_ADV_REPORT event. Must stay
+ *                      valid while the index is used.
+ * @param[in]  len      Length of the report.
+ *
+ * @retval NRF_SUCCESS                The report was indexed.
+ * @retval NRF_ERROR_INVALID_LENGTH   A field overruns the report. The fields before it are indexed.
+ */
+uint32_t ble_advdata_index_build(ble_advdata_index_t * p_index, uint8_t * p_data, uint8_t len);
+
+/**@brief Function for getting a field of an indexed report.
+ *
+ * @details Constant time for the indexed types, falls back to a search of the report for the
+ *          others.
+ *
+ * @param[in]  p_index        Index of the report.
+ * @param[in]  type           AD type of the field.
+ * @param[out] pp_field_data  Content of the field, after the AD type.
+ * @param[out] p_len          Length of the content.
+ *
+ * @retval NRF_SUCCESS          The field was found.
+ * @retval NRF_ERROR_NOT_FOUND  The report has no field of this type.
+ */
+uint32_t ble_advdata_index_field_get(const ble_advdata_index_t * p_index,
+                                     uint8_t                     type,
+                                     uint8_t **                  pp_field_data,
+                                     uint8_t *                   p_len);
+
+/**@brief Function for checking if an indexed report lists a 16-bit service UUID, in its complete
+ *        or incomplete list.
+ *
+ * @param[in]  p_index  Index of the report.
+ * @param[in]  uuid     Service UUID.
+ *
+ * @return true if the UUID is listed.
+ */
+bool ble_advdata_uuid16_find(const ble_advdata_index_t * p_index, uint16_t uuid);
+
+/**@brief Function for checking if an indexed report lists a 128-bit service UUID, in its complete
+ *        or incomplete list.
+ *
+ * @details Meant for scan filters: the bytes of the 16-bit part of the UUID, which differ between
+ *          services sharing a base UUID, are compared first, so that most UUIDs are rejected
+ *          after two bytes.
+ *
+ * @param[in]  p_index  Index of the report.
+ * @param[in]  p_uuid   Service UUID, in little endian order as in the report.
+ *
+ * @return true if the UUID is listed.
+ */
+bool ble_advdata_uuid128_find(const ble_advdata_index_t * p_index, const ble_uuid128_t * p_uuid);
+
 #endif
@@ -12,6 +12,7 @@
 
 #include "ble_conn_params.h"
 #include <stdlib.h>
+#include <string.h>
 #include "nordic_common.h"
 #include "ble_hci.h"
 #include "app_timer.h"
@@ -25,9 +26,30 @@ static uint8_t                m_update_count;           /**< Number of Connectio
 static uint16_t               m_conn_handle;            /**< Current connection handle. */
 static ble_gap_conn_params_t  m_current_conn_params;    /**< Connection parameters received in the most recent Connect event. */
 static app_timer_id_t         m_conn_params_timer_id;   /**< Connection parameters timer. */
+static ble_gap_conn_params_t  m_profiles[BLE_CONN_PARAMS_PROFILE_COUNT];  /**< Connection parameter profiles given by the application. */
+static bool                   m_profiles_valid;         /**< True if the application has given connection parameter profiles. */
+static ble_conn_params_profile_t m_profile;             /**< Connection parameter profile last requested. */
+static app_timer_id_t         m_idle_timer_id;          /**< Timer for falling back to the idle profile. */
 
 static bool m_change_param = false;
 
+/**@brief Function for sending an event to the application, with the current connection parameters.
+ *
+ * @param[in]   evt_type  Type of event.
+ */
+static void evt_send(ble_conn_params_evt_type_t evt_type)
+{
+    if (m_conn_params_config.evt_handler != NULL)
+    {
+        ble_conn_params_evt_t evt;
+
+        evt.evt_type    = evt_type;
+        evt.conn_params = m_current_conn_params;
+        m_conn_params_config.evt_handler(&evt);
+    }
+}
+
+
 static bool is_conn_params_ok(ble_gap_conn_params_t * p_conn_params)
 {
     // Check if interval is within the acceptable range.
@@ -84,18 +106,27 @@ static void update_timeout_handler(void * p_context)
             }
 
             // Notify the application that the procedure has failed
-            if (m_conn_params_config.evt_handler != NULL)
-            {
-                ble_conn_params_evt_t evt;
-
-                evt.evt_type = BLE_CONN_PARAMS_EVT_FAILED;
-                m_conn_params_config.evt_handler(&evt);
-            }
+            evt_send(BLE_CONN_PARAMS_EVT_FAILED);
         }
     }
 }
 
 
+static void idle_timeout_handler(void * p_context)
+{
+    uint32_t err_code;
+
+    UNUSED_PARAMETER(p_context);
+
+    // No activity reported for idle_timeout: drop to the power saving profile.
+    err_code = ble_conn_params_profile_set(BLE_CONN_PARAMS_PROFILE_IDLE);
+    if ((err_code != NRF_SUCCESS) && (m_conn_params_config.error_handler != NULL))
+    {
+        m_conn_params_config.error_handler(err_code);
+    }
+}
+
+
 uint32_t ble_conn_params_init(const ble_conn_params_init_t * p_init)
 {
     uint32_t err_code;
@@ -126,6 +157,24 @@ uint32_t ble_conn_params_init(const ble_conn_params_init_t * p_init)
     m_conn_handle  = BLE_CONN_HANDLE_INVALID;
     m_update_count = 0;
 
+    m_profiles_valid = (p_init->p_profiles != NULL);
+    m_profile        = BLE_CONN_PARAMS_PROFILE_IDLE;
+    if (m_profiles_valid)
+    {
+        memcpy(m_profiles, p_init->p_profiles, sizeof(m_profiles));
+    }
+
+    if (m_profiles_valid && (p_init->idle_timeout != 0))
+    {
+        err_code = app_timer_create(&m_idle_timer_id,
+                                    APP_TIMER_MODE_SINGLE_SHOT,
+                                    idle_timeout_handler);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
     return app_timer_create(&m_conn_params_timer_id,
                             APP_TIMER_MODE_SINGLE_SHOT,
                             update_timeout_handler);
@@ -134,6 +183,15 @@ uint32_t ble_conn_params_init(const ble_conn_params_init_t * p_init)
 
 uint32_t ble_conn_params_stop(void)
 {
+    if (m_profiles_valid && (m_conn_params_config.idle_timeout != 0))
+    {
+        uint32_t err_code = app_timer_stop(m_idle_timer_id);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
     return app_timer_stop(m_conn_params_timer_id);
 }
 
@@ -149,13 +207,7 @@ static void conn_params_negotiation(void)
         if (m_change_param)
         {
             // Notify the application that the procedure has failed
-            if (m_conn_params_config.evt_handler != NULL)
-            {
-                ble_conn_params_evt_t evt;
-
-                evt.evt_type = BLE_CONN_PARAMS_EVT_FAILED;
-                m_conn_params_config.evt_handler(&evt);
-            }
+            evt_send(BLE_CONN_PARAMS_EVT_FAILED);
         }
         else
         {
@@ -179,13 +231,7 @@ static void conn_params_negotiation(void)
     else
     {
         // Notify the application that the procedure has succeded
-        if (m_conn_params_config.evt_handler != NULL)
-        {
-            ble_conn_params_evt_t evt;
-
-            evt.evt_type = BLE_CONN_PARAMS_EVT_SUCCEEDED;
-            m_conn_params_config.evt_handler(&evt);
-        }
+        evt_send(BLE_CONN_PARAMS_EVT_SUCCEEDED);
     }
     m_change_param = false;
 }
@@ -220,6 +266,15 @@ static void on_disconnect(ble_evt_t * p_ble_evt)
     {
         m_conn_params_config.error_handler(err_code);
     }
+
+    if (m_profiles_valid && (m_conn_params_config.idle_timeout != 0))
+    {
+        err_code = app_timer_stop(m_idle_timer_id);
+        if ((err_code != NRF_SUCCESS) && (m_conn_params_config.error_handler != NULL))
+        {
+            m_conn_params_config.error_handler(err_code);
+        }
+    }
 }
 
 
@@ -309,15 +364,62 @@ uint32_t ble_conn_params_change_conn_params(ble_gap_conn_params_t * new_params)
         else
         {
             // Notify the application that the procedure has succeded
-            if (m_conn_params_config.evt_handler != NULL)
-            {
-                ble_conn_params_evt_t evt;
-
-                evt.evt_type = BLE_CONN_PARAMS_EVT_SUCCEEDED;
-                m_conn_params_config.evt_handler(&evt);
-            }
+            evt_send(BLE_CONN_PARAMS_EVT_SUCCEEDED);
             err_code = NRF_SUCCESS;
         }
     }
     return err_code;
 }
+
+
+uint32_t ble_conn_params_profile_set(ble_conn_params_profile_t profile)
+{
+    uint32_t err_code;
+
+    if (!m_profiles_valid)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (profile >= BLE_CONN_PARAMS_PROFILE_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_profile = profile;
+
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        // Nothing to negotiate, the profile applies to the next connection.
+        m_preferred_conn_params = m_profiles[profile];
+        return sd_ble_gap_ppcp_set(&m_preferred_conn_params);
+    }
+
+    err_code = ble_conn_params_change_conn_params(&m_profiles[profile]);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return ble_conn_params_activity_notify();
+}
+
+
+uint32_t ble_conn_params_activity_notify(void)
+{
+    uint32_t err_code;
+
+    if (!m_profiles_valid ||
+        (m_conn_params_config.idle_timeout == 0) ||
+        (m_conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return NRF_SUCCESS;
+    }
+
+    err_code = app_timer_stop(m_idle_timer_id);
+    if ((err_code != NRF_SUCCESS) || (m_profile == BLE_CONN_PARAMS_PROFILE_IDLE))
+    {
+        return err_code;
+    }
+
+    return app_timer_start(m_idle_timer_id, m_conn_params_config.idle_timeout, NULL);
+}
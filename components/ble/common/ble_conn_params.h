@@ -32,10 +32,20 @@ typedef enum
     BLE_CONN_PARAMS_EVT_SUCCEEDED                                   /**< Negotiation procedure succeeded. */
 } ble_conn_params_evt_type_t;
 
+/**@brief Connection parameter profiles, see \ref ble_conn_params_profile_set. */
+typedef enum
+{
+    BLE_CONN_PARAMS_PROFILE_BULK,                                   /**< Short interval and no slave latency, for bulk transfers such as configuration download or DFU. */
+    BLE_CONN_PARAMS_PROFILE_INTERACTIVE,                            /**< Moderate interval, for user interaction. */
+    BLE_CONN_PARAMS_PROFILE_IDLE,                                   /**< Long interval, for idle monitoring at minimal power. */
+    BLE_CONN_PARAMS_PROFILE_COUNT                                   /**< Number of profiles. */
+} ble_conn_params_profile_t;
+
 /**@brief Connection Parameters Module event. */
 typedef struct
 {
     ble_conn_params_evt_type_t evt_type;                            /**< Type of event. */
+    ble_gap_conn_params_t      conn_params;                         /**< Connection parameters in use when the event was generated. The achieved connection interval is conn_params.max_conn_interval. */
 } ble_conn_params_evt_t;
 
 /**@brief Connection Parameters Module event handler type. */
@@ -53,6 +63,8 @@ typedef struct
     bool                          disconnect_on_fail;               /**< Set to TRUE if a failed connection parameters update shall cause an automatic disconnection, set to FALSE otherwise. */
     ble_conn_params_evt_handler_t evt_handler;                      /**< Event handler to be called for handling events in the Connection Parameters. */
     ble_srv_error_handler_t       error_handler;                    /**< Function to be called in case of an error. */
+    const ble_gap_conn_params_t * p_profiles;                       /**< Array of BLE_CONN_PARAMS_PROFILE_COUNT parameter sets, indexed by \ref ble_conn_params_profile_t. Copied by the module. Set to NULL to not use profiles. */
+    uint32_t                      idle_timeout;                     /**< Time without activity after which the module switches to BLE_CONN_PARAMS_PROFILE_IDLE (in number of timer ticks), see \ref ble_conn_params_activity_notify. Set to 0 to only switch on request. Uses one more app_timer. */
 } ble_conn_params_init_t;
 
 
@@ -98,6 +110,35 @@ uint32_t ble_conn_params_stop(void);
  */
 uint32_t ble_conn_params_change_conn_params(ble_gap_conn_params_t *new_params);
 
+/**@brief Function for switching to a connection parameter profile.
+ *
+ * @details Negotiates the parameters of the profile as with
+ *          \ref ble_conn_params_change_conn_params. The outcome is reported with a
+ *          BLE_CONN_PARAMS_EVT_SUCCEEDED or BLE_CONN_PARAMS_EVT_FAILED event, which holds the
+ *          achieved parameters. When not connected, the profile is only made the preferred one
+ *          for the next connection.
+ *          Switching to any profile but BLE_CONN_PARAMS_PROFILE_IDLE starts the idle timeout,
+ *          if one has been configured.
+ *
+ * @param[in]   profile  Profile to switch to.
+ *
+ * @retval      NRF_SUCCESS              The switch was requested.
+ * @retval      NRF_ERROR_INVALID_STATE  The module was initialized without profiles.
+ * @retval      NRF_ERROR_INVALID_PARAM  The profile does not exist.
+ * @return      Otherwise an error code from the SoftDevice or the app_timer.
+ */
+uint32_t ble_conn_params_profile_set(ble_conn_params_profile_t profile);
+
+/**@brief Function for reporting activity on the connection.
+ *
+ * @details Restarts the idle timeout, so the module stays in the current profile for at least
+ *          another idle_timeout. Call this for each transfer of a bulk or interactive phase.
+ *          Does nothing in BLE_CONN_PARAMS_PROFILE_IDLE or without an idle timeout.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code from the app_timer.
+ */
+uint32_t ble_conn_params_activity_notify(void);
+
 /**@brief Function for handling the Application's BLE Stack events.
  *
  * @details Handles all events from the BLE stack that are of interest to this module.
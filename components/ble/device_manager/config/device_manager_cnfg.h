@@ -66,6 +66,31 @@
  */
 #define DEVICE_MANAGER_MAX_BONDS         7
 
+/**
+ * @brief Number of buckets in the address hash index of bonded devices.
+ *
+ * @details Bonded devices are looked up by identity address in a hash index, so that the cost of
+ *          finding a peer on connection does not grow with DEVICE_MANAGER_MAX_BONDS.
+ *          Minimum value : 1.
+ *          Maximum value : 254.
+ *          Dependencies  : None. About a quarter of DEVICE_MANAGER_MAX_BONDS is a good choice for
+ *                          large bond tables.
+ */
+#define DEVICE_MANAGER_ADDR_HASH_SIZE    8
+
+/**
+ * @brief Size of the IRK resolution cache.
+ *
+ * @details Resolvable private addresses recently resolved against the IRKs of bonded devices are
+ *          remembered, so that a peer reconnecting with the same address is found without one ECB
+ *          operation per bond.
+ *          Minimum value : 0.
+ *          Maximum value : 254.
+ *          Dependencies  : None.
+ * @note If set to zero, every resolvable private address is resolved against all stored IRKs.
+ */
+#define DEVICE_MANAGER_IRK_CACHE_SIZE    4
+
 
 /**
  * @brief Maximum Characteristic Client Descriptors used for GATT Server.
@@ -91,6 +116,19 @@
  */
 #define DEVICE_MANAGER_APP_CONTEXT_SIZE    0
 
+/**
+ * @brief Attribute cache in application context.
+ *
+ * @details When set to 1, the application context of a bonded peer starts with a
+ *          \ref dm_attr_cache_hdr_t and holds attribute handles discovered on the peer. The module
+ *          deletes the application context when the peer indicates a change on the Service
+ *          Changed characteristic recorded in the header, and notifies
+ *          \ref DM_EVT_APPL_CONTEXT_INVALIDATED.
+ *          Dependencies  : DEVICE_MANAGER_APP_CONTEXT_SIZE large enough for the header and the
+ *                          cached handles.
+ */
+#define DEVICE_MANAGER_ATTR_CACHE          0
+
 /* @} */
 /* @} */
 /** @endcond */
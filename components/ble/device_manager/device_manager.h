@@ -71,6 +71,18 @@
 #include "ble_gap.h"
 #include "device_manager_cnfg.h"
 
+#ifndef DEVICE_MANAGER_ADDR_HASH_SIZE
+#define DEVICE_MANAGER_ADDR_HASH_SIZE 8 /**< Default number of buckets in the address hash index, for configurations that do not set it. */
+#endif
+
+#ifndef DEVICE_MANAGER_IRK_CACHE_SIZE
+#define DEVICE_MANAGER_IRK_CACHE_SIZE 4 /**< Default size of the IRK resolution cache, for configurations that do not set it. */
+#endif
+
+#ifndef DEVICE_MANAGER_ATTR_CACHE
+#define DEVICE_MANAGER_ATTR_CACHE     0 /**< Attribute cache disabled by default, for configurations that do not set it. */
+#endif
+
 /**
  * @defgroup dm_service_cntext_types Service/Protocol Types
  *
@@ -166,6 +178,7 @@
 #define DM_EVT_APPL_CONTEXT_LOADED     0x41 /**< Indicates that application context for a peer is loaded. */
 #define DM_EVT_APPL_CONTEXT_STORED     0x42 /**< Indicates that application context is stored persistently. */
 #define DM_EVT_APPL_CONTEXT_DELETED    0x43 /**< Indicates that application context is deleted. */
+#define DM_EVT_APPL_CONTEXT_INVALIDATED 0x44 /**< Indicates that the attribute cache held in the application context was deleted because the peer changed its services. See \ref DEVICE_MANAGER_ATTR_CACHE. */
 /** @} */
 /** @} */
 
@@ -329,6 +342,22 @@ typedef struct
  */
 typedef dm_context_t dm_application_context_t;
 
+/**
+ * @brief Attribute cache header.
+ *
+ * @details When DEVICE_MANAGER_ATTR_CACHE is set, the application context data starts with this
+ *          header, followed by 'data_len' bytes of cached attribute handles in a layout chosen by
+ *          the application. The header is filled with \ref dm_attr_cache_seal before the
+ *          context is set, and checked with \ref dm_attr_cache_verify after it is loaded, so that
+ *          a reconnecting bonded peer can skip service discovery.
+ */
+typedef struct
+{
+    uint32_t db_hash;             /**< CRC-32 over the cached handles, filled by \ref dm_attr_cache_seal. */
+    uint16_t srvc_changed_handle; /**< Value handle of the peer's Service Changed characteristic, or BLE_GATT_HANDLE_INVALID if the peer has none. */
+    uint16_t data_len;            /**< Number of bytes of cached handles following the header. */
+} dm_attr_cache_hdr_t;
+
 /**
  * @brief Event parameters.
  *
@@ -777,6 +806,43 @@ ret_code_t dm_application_context_get(dm_handle_t const        * p_handle,
  */
 ret_code_t dm_application_context_delete(dm_handle_t const * p_handle);
 
+/**
+ * @brief Function for sealing an attribute cache before it is stored as application context.
+ *
+ * @details Computes the hash of the cached handles described by the \ref dm_attr_cache_hdr_t at
+ *          the start of the context data, stores it in the header and sets the context length.
+ *          The context can then be stored with \ref dm_application_context_set.
+ *
+ * @param[in,out] p_context Application context holding the attribute cache. The 'srvc_changed_handle'
+ *                          and 'data_len' fields of the header are set by the application.
+ *
+ * @retval NRF_SUCCESS             On success.
+ * @retval NRF_ERROR_NULL          If p_context or its data pointer is NULL.
+ * @retval NRF_ERROR_DATA_SIZE     If the header and cached handles do not fit in
+ *                                 DEVICE_MANAGER_APP_CONTEXT_SIZE.
+ *
+ * @note The API returns FEATURE_NOT_ENABLED if DEVICE_MANAGER_ATTR_CACHE is not set.
+ */
+ret_code_t dm_attr_cache_seal(dm_application_context_t * p_context);
+
+/**
+ * @brief Function for verifying an attribute cache loaded from application context.
+ *
+ * @details Checks that the context loaded with \ref dm_application_context_get holds a complete
+ *          attribute cache whose hash matches the cached handles. If it does, the application can
+ *          use the cached handles instead of discovering the services of the peer.
+ *
+ * @param[in] p_context Application context holding the attribute cache.
+ *
+ * @retval NRF_SUCCESS             If the cache can be used.
+ * @retval NRF_ERROR_NULL          If p_context or its data pointer is NULL.
+ * @retval DM_ATTR_CACHE_STALE     If the cache is truncated or corrupted, and the services of the
+ *                                 peer have to be discovered again.
+ *
+ * @note The API returns FEATURE_NOT_ENABLED if DEVICE_MANAGER_ATTR_CACHE is not set.
+ */
+ret_code_t dm_attr_cache_verify(dm_application_context_t const * p_context);
+
 /** @} */
 
 
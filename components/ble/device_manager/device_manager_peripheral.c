@@ -14,6 +14,10 @@
 #include "pstorage.h"
 #include "ble_hci.h"
 #include "app_error.h"
+#include "nrf_soc.h"
+#if (DEVICE_MANAGER_ATTR_CACHE != 0)
+#include "crc32.h"
+#endif // DEVICE_MANAGER_ATTR_CACHE
 
 #if defined ( __CC_ARM )
     #ifndef __ALIGN
@@ -31,6 +35,7 @@
 
 #define INVALID_ADDR_TYPE 0xFF   /**< Identifier for an invalid address type. */
 #define EDIV_INIT_VAL     0xFFFF /**< Initial value for diversifier. */
+#define RPA_PART_LEN      3      /**< Length of the hash and of the prand parts of a resolvable private address. */
 
 /**
  * @defgroup device_manager_app_states Connection Manager Application States
@@ -332,6 +337,7 @@ typedef enum
 /** @} */
 
 #define INVALID_CONTEXT_LEN 0xFFFFFFFF /**< Identifier for invalid context length. */
+#define PEER_ADDR_UPDATE_WORDS ((DEVICE_MANAGER_MAX_BONDS + 31) / 32) /**< Number of words in the peer address update bitmap. */
 /**@brief Macro for checking that application context size is greater that minimal size.
  *
  * @param[in] X Size of application context.
@@ -360,6 +366,14 @@ typedef struct
     uint8_t          id_bitmap; /**< Contains information if above field is valid. */
 } peer_id_t;
 
+/**@brief IRK resolution cache entry.
+ */
+typedef struct
+{
+    uint8_t addr[BLE_GAP_ADDR_LEN]; /**< Resolvable private address. */
+    uint8_t device_id;              /**< Device instance the address resolved to, DM_INVALID_ID if the entry is unused. */
+} irk_cache_entry_t;
+
 STATIC_ASSERT(sizeof(peer_id_t) % 4 == 0); /**< Check to ensure Peer identification information is a multiple of 4. */
 
 /**@brief Portion of bonding information exchanged by a device during bond creation that needs to
@@ -374,6 +388,15 @@ typedef struct
 
 STATIC_ASSERT(sizeof(bond_context_t) % 4 == 0); /**< Check to ensure bond information is a multiple of 4. */
 
+/**@brief Device context as laid out at the start of a storage block, so that peer identification
+ *        and bond information can be written with a single flash operation.
+ */
+typedef struct
+{
+    peer_id_t      peer;        /**< Peer identification information, at PEER_ID_STORAGE_OFFSET. */
+    bond_context_t bond;        /**< Bond information, at BOND_STORAGE_OFFSET. */
+} device_record_t;
+
 /**@brief GATT Server Attributes size and data.
  */
 typedef struct
@@ -393,7 +416,13 @@ typedef struct
 } dm_gatt_client_context_t;
 
 STATIC_ASSERT(sizeof(dm_gatt_client_context_t) % 4 == 0);  /**< Check to ensure GATT Client context information is a multiple of 4. */
+STATIC_ASSERT(sizeof(device_record_t) == DEVICE_CONTEXT_SIZE); /**< Check to ensure the device record matches the layout of the storage block. */
 STATIC_ASSERT((DEVICE_MANAGER_APP_CONTEXT_SIZE % 4) == 0); /**< Check to ensure device manager application context information is a multiple of 4. */
+STATIC_ASSERT(DEVICE_MANAGER_MAX_BONDS < DM_INVALID_ID);         /**< Check to ensure device instances fit in the hash index and IRK cache tables. */
+STATIC_ASSERT((DEVICE_MANAGER_ADDR_HASH_SIZE > 0) && (DEVICE_MANAGER_ADDR_HASH_SIZE < DM_INVALID_ID)); /**< Check to ensure buckets fit in the hash index tables. */
+#if (DEVICE_MANAGER_ATTR_CACHE != 0)
+STATIC_ASSERT(DEVICE_MANAGER_APP_CONTEXT_SIZE >= sizeof(dm_attr_cache_hdr_t)); /**< Check to ensure the attribute cache header fits in the application context. */
+#endif // DEVICE_MANAGER_ATTR_CACHE
 
 /**@brief Connection instance definition. Maintains information with respect to an active peer.
  */
@@ -465,10 +494,19 @@ static peer_id_t              m_peer_table[DEVICE_MANAGER_MAX_BONDS] ;
 __ALIGN(sizeof(uint32_t))
 static bond_context_t         m_bond_table[DEVICE_MANAGER_MAX_CONNECTIONS];         /**< Table to maintain bond information for active peers. */
 static dm_gatts_context_t     m_gatts_table[DEVICE_MANAGER_MAX_CONNECTIONS];        /**< Table for service information for active connection instances. */
+__ALIGN(sizeof(uint32_t))
+static device_record_t        m_record_table[DEVICE_MANAGER_MAX_CONNECTIONS];       /**< Copies of the device context being written for active connection instances, kept until the flash operation completes. */
 static connection_instance_t  m_connection_table[DEVICE_MANAGER_MAX_CONNECTIONS];   /**< Table to maintain active peer information. An instance is allocated in the table when a new connection is established and freed on disconnection. */
 static application_instance_t m_application_table[DEVICE_MANAGER_MAX_APPLICATIONS]; /**< Table to maintain application instances. */
 static pstorage_handle_t      m_storage_handle;                                     /**< Persistent storage handle for blocks requested by the module. */
-static uint32_t               m_peer_addr_update;                                   /**< 32-bit bitmap to remember peer device address update. */
+static uint32_t               m_peer_addr_update[PEER_ADDR_UPDATE_WORDS];           /**< Bitmap to remember peer device address update. */
+static uint8_t                m_addr_hash_head[DEVICE_MANAGER_ADDR_HASH_SIZE];      /**< First device instance in each bucket of the address hash index, DM_INVALID_ID if the bucket is empty. */
+static uint8_t                m_addr_hash_next[DEVICE_MANAGER_MAX_BONDS];           /**< Next device instance in the same bucket of the address hash index. */
+static uint8_t                m_addr_hash_bucket[DEVICE_MANAGER_MAX_BONDS];         /**< Bucket each device instance is indexed in, DM_INVALID_ID if it has no identity address. */
+#if (DEVICE_MANAGER_IRK_CACHE_SIZE != 0)
+static irk_cache_entry_t      m_irk_cache[DEVICE_MANAGER_IRK_CACHE_SIZE];           /**< Recently resolved private addresses of bonded devices. */
+static uint32_t               m_irk_cache_next;                                     /**< IRK resolution cache entry replaced by the next resolved address. */
+#endif // DEVICE_MANAGER_IRK_CACHE_SIZE
 static ble_gap_id_key_t       m_local_id_info;                                      /**< ID information of central in case resolvable address is used. */
 static bool                   m_module_initialized = false;                         /**< State indicating if module is initialized or not. */
 static uint8_t                m_irk_index_table[DEVICE_MANAGER_MAX_BONDS];          /**< List maintaining IRK index list. */
@@ -547,7 +585,7 @@ const uint32_t m_context_init_len = 0xFFFFFFFF; /**< Constant used to update the
  */
 static __INLINE void update_status_bit_set(uint32_t index)
 {
-    m_peer_addr_update |= (BIT_0 << index);
+    m_peer_addr_update[index / 32] |= (BIT_0 << (index % 32));
 }
 
 
@@ -557,7 +595,7 @@ static __INLINE void update_status_bit_set(uint32_t index)
  */
 static __INLINE void update_status_bit_reset(uint32_t index)
 {
-    m_peer_addr_update &= (~((uint32_t)BIT_0 << index));
+    m_peer_addr_update[index / 32] &= (~((uint32_t)BIT_0 << (index % 32)));
 }
 
 
@@ -569,7 +607,7 @@ static __INLINE void update_status_bit_reset(uint32_t index)
  */
 static __INLINE bool update_status_bit_is_set(uint32_t index)
 {
-    return ((m_peer_addr_update & (BIT_0 << index)) ? true : false);
+    return ((m_peer_addr_update[index / 32] & (BIT_0 << (index % 32))) ? true : false);
 }
 
 
@@ -603,6 +641,190 @@ static __INLINE void connection_instance_init(uint32_t index)
 }
 
 
+/**@brief Function for computing the bucket of a peer address in the address hash index.
+ *
+ * @param[in] p_addr Peer address.
+ *
+ * @retval Bucket index.
+ */
+static __INLINE uint32_t addr_hash(ble_gap_addr_t const * p_addr)
+{
+    uint32_t hash = p_addr->addr_type;
+    uint32_t index;
+
+    for (index = 0; index < BLE_GAP_ADDR_LEN; index++)
+    {
+        hash = (hash * 31) + p_addr->addr[index];
+    }
+
+    return (hash % DEVICE_MANAGER_ADDR_HASH_SIZE);
+}
+
+
+/**@brief Function for updating the address hash index entry of the device identified by 'index'.
+ *
+ * @details Must be called whenever the identity address of a device instance changes. Devices
+ *          without a valid identity address are removed from the index.
+ *
+ * @param[in] index Device identifier.
+ */
+static void addr_index_update(uint32_t index)
+{
+    uint8_t * p_link;
+    uint32_t  bucket = m_addr_hash_bucket[index];
+
+    //Unlink the device from the bucket it was indexed in.
+    if (bucket != DM_INVALID_ID)
+    {
+        p_link = &m_addr_hash_head[bucket];
+
+        while ((*p_link != DM_INVALID_ID) && (*p_link != index))
+        {
+            p_link = &m_addr_hash_next[*p_link];
+        }
+
+        if (*p_link == index)
+        {
+            (*p_link) = m_addr_hash_next[index];
+        }
+
+        m_addr_hash_bucket[index] = DM_INVALID_ID;
+    }
+
+    if (m_peer_table[index].peer_id.id_addr_info.addr_type != INVALID_ADDR_TYPE)
+    {
+        bucket = addr_hash(&m_peer_table[index].peer_id.id_addr_info);
+
+        m_addr_hash_next[index]   = m_addr_hash_head[bucket];
+        m_addr_hash_head[bucket]  = index;
+        m_addr_hash_bucket[index] = bucket;
+    }
+}
+
+
+/**@brief Function for checking if a resolvable private address was generated from an IRK.
+ *
+ * @details Computes the random address hash function 'ah' of the Bluetooth Core Specification
+ *          with the ECB peripheral. The ECB works on big endian data while the SoftDevice keeps
+ *          keys and addresses little endian.
+ *
+ * @param[in] p_addr Resolvable private address.
+ * @param[in] p_irk  Identity resolving key.
+ *
+ * @retval true if the address resolves with the key, false otherwise.
+ */
+static bool irk_match(ble_gap_addr_t const * p_addr, ble_gap_irk_t const * p_irk)
+{
+    nrf_ecb_hal_data_t ecb_data;
+    uint32_t           index;
+
+    for (index = 0; index < SOC_ECB_KEY_LENGTH; index++)
+    {
+        ecb_data.key[index] = p_irk->irk[SOC_ECB_KEY_LENGTH - 1 - index];
+    }
+
+    //Cleartext is the 24-bit prand, stored in the upper half of the address, padded with zeros.
+    memset(ecb_data.cleartext, 0, SOC_ECB_KEY_LENGTH);
+
+    for (index = 0; index < RPA_PART_LEN; index++)
+    {
+        ecb_data.cleartext[SOC_ECB_KEY_LENGTH - 1 - index] = p_addr->addr[RPA_PART_LEN + index];
+    }
+
+    if (sd_ecb_block_encrypt(&ecb_data) != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    //The 24-bit hash, stored in the lower half of the address, is the end of the ciphertext.
+    for (index = 0; index < RPA_PART_LEN; index++)
+    {
+        if (ecb_data.ciphertext[SOC_ECB_KEY_LENGTH - 1 - index] != p_addr->addr[index])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+#if (DEVICE_MANAGER_IRK_CACHE_SIZE != 0)
+/**@brief Function for removing the resolved addresses of the device identified by 'index' from
+ *        the IRK resolution cache.
+ *
+ * @param[in] index Device identifier.
+ */
+static __INLINE void irk_cache_purge(uint32_t index)
+{
+    uint32_t entry;
+
+    for (entry = 0; entry < DEVICE_MANAGER_IRK_CACHE_SIZE; entry++)
+    {
+        if (m_irk_cache[entry].device_id == index)
+        {
+            m_irk_cache[entry].device_id = DM_INVALID_ID;
+        }
+    }
+}
+#endif // DEVICE_MANAGER_IRK_CACHE_SIZE
+
+
+/**@brief Function for resolving a resolvable private address against the IRKs of bonded devices.
+ *
+ * @details Recently resolved addresses are looked up in the IRK resolution cache first, so that a
+ *          peer reconnecting with the same address does not cost one ECB operation per bond.
+ *
+ * @param[in]  p_addr         Resolvable private address.
+ * @param[out] p_device_index Device index.
+ *
+ * @retval NRF_SUCCESS         Operation success.
+ * @retval NRF_ERROR_NOT_FOUND Operation failure.
+ */
+static ret_code_t irk_resolve(ble_gap_addr_t const * p_addr, uint32_t * p_device_index)
+{
+    uint32_t index;
+
+#if (DEVICE_MANAGER_IRK_CACHE_SIZE != 0)
+    for (index = 0; index < DEVICE_MANAGER_IRK_CACHE_SIZE; index++)
+    {
+        if ((m_irk_cache[index].device_id != DM_INVALID_ID) &&
+            (memcmp(m_irk_cache[index].addr, p_addr->addr, BLE_GAP_ADDR_LEN) == 0))
+        {
+            DM_LOG("[DM]: Resolved device at instance 0x%02X from cache\r\n",
+                   m_irk_cache[index].device_id);
+
+            (*p_device_index) = m_irk_cache[index].device_id;
+
+            return NRF_SUCCESS;
+        }
+    }
+#endif // DEVICE_MANAGER_IRK_CACHE_SIZE
+
+    for (index = 0; index < DEVICE_MANAGER_MAX_BONDS; index++)
+    {
+        if (((m_peer_table[index].id_bitmap & IRK_ENTRY) == 0) &&
+            irk_match(p_addr, &m_peer_table[index].peer_id.id_info))
+        {
+            DM_LOG("[DM]: Resolved device at instance 0x%02X\r\n", index);
+
+#if (DEVICE_MANAGER_IRK_CACHE_SIZE != 0)
+            memcpy(m_irk_cache[m_irk_cache_next].addr, p_addr->addr, BLE_GAP_ADDR_LEN);
+            m_irk_cache[m_irk_cache_next].device_id = index;
+
+            m_irk_cache_next = (m_irk_cache_next + 1) % DEVICE_MANAGER_IRK_CACHE_SIZE;
+#endif // DEVICE_MANAGER_IRK_CACHE_SIZE
+
+            (*p_device_index) = index;
+
+            return NRF_SUCCESS;
+        }
+    }
+
+    return NRF_ERROR_NOT_FOUND;
+}
+
+
 /**@brief Function for initialiasing the peer device instance identified by 'index'.
  *
  * @param[in] index Device identifier.
@@ -627,6 +849,12 @@ static __INLINE void peer_instance_init(uint32_t index)
     //Reset the status bit.
     update_status_bit_reset(index);
 
+    //Remove the device from the address hash index and IRK resolution cache.
+    addr_index_update(index);
+#if (DEVICE_MANAGER_IRK_CACHE_SIZE != 0)
+    irk_cache_purge(index);
+#endif // DEVICE_MANAGER_IRK_CACHE_SIZE
+
 #if (DEVICE_MANAGER_APP_CONTEXT_SIZE != 0)
     //Initialize the application context for bond device.
     m_app_context_table[index] = NULL;
@@ -717,6 +945,7 @@ static __INLINE ret_code_t device_instance_allocate(uint8_t *              p_dev
             {
                 m_peer_table[index].id_bitmap            &= (~ADDR_ENTRY);
                 m_peer_table[index].peer_id.id_addr_info  = (*p_addr);
+                addr_index_update(index);
             }
             else
             {
@@ -769,8 +998,13 @@ static __INLINE ret_code_t device_instance_free(uint32_t device_index)
 
 /**@brief Function for searching for the device in the bonded device list.
  *
- * @param[in]  p_addr         Peer identification information.
+ * @details Identity addresses are looked up in the address hash index. Resolvable private
+ *          addresses are resolved against the IRKs of bonded devices. Without an address, the
+ *          device is searched by its encrypted diversifier.
+ *
+ * @param[in]  p_addr         Peer identification information, or NULL to search by 'ediv'.
  * @param[out] p_device_index Device index.
+ * @param[in]  ediv           Encrypted diversifier, used if p_addr is NULL.
  *
  * @retval NRF_SUCCESS         Operation success.
  * @retval NRF_ERROR_NOT_FOUND Operation failure.
@@ -782,18 +1016,40 @@ static ret_code_t device_instance_find(ble_gap_addr_t const * p_addr, uint32_t *
 
     err_code = NRF_ERROR_NOT_FOUND;
     
-    if (NULL != p_addr)
+    if (NULL == p_addr)
+    {
+        for (index = 0; index < DEVICE_MANAGER_MAX_BONDS; index++)
+        {
+            if (ediv == m_peer_table[index].ediv)
+            {
+                DM_LOG("[DM]: Found device at instance 0x%02X\r\n", index);
+
+                (*p_device_index) = index;
+                err_code          = NRF_SUCCESS;
+
+                break;
+            }
+        }
+
+        return err_code;
+    }
+
+    DM_TRC("[DM]: Searching for device 0x%02X 0x%02X 0x%02X 0x%02X 0x%02X 0x%02X.\r\n",
+           p_addr->addr[0],
+           p_addr->addr[1],
+           p_addr->addr[2],
+           p_addr->addr[3],
+           p_addr->addr[4],
+           p_addr->addr[5]);
+
+    if (p_addr->addr_type == BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_RESOLVABLE)
     {
-        DM_TRC("[DM]: Searching for device 0x%02X 0x%02X 0x%02X 0x%02X 0x%02X 0x%02X.\r\n",
-               p_addr->addr[0],
-               p_addr->addr[1],
-               p_addr->addr[2],
-               p_addr->addr[3],
-               p_addr->addr[4],
-               p_addr->addr[5]);
+        return irk_resolve(p_addr, p_device_index);
     }
 
-    for (index = 0; index < DEVICE_MANAGER_MAX_BONDS; index++)
+    for (index = m_addr_hash_head[addr_hash(p_addr)];
+         index != DM_INVALID_ID;
+         index = m_addr_hash_next[index])
     {
         DM_TRC("[DM]:[DI 0x%02X]: Device type 0x%02X.\r\n",
                index, m_peer_table[index].peer_id.id_addr_info.addr_type);
@@ -805,8 +1061,7 @@ static ret_code_t device_instance_find(ble_gap_addr_t const * p_addr, uint32_t *
                m_peer_table[index].peer_id.id_addr_info.addr[4],
                m_peer_table[index].peer_id.id_addr_info.addr[5]);
 
-        if (((NULL == p_addr) && (ediv == m_peer_table[index].ediv)) ||
-            ((NULL != p_addr) && (memcmp(&m_peer_table[index].peer_id.id_addr_info, p_addr, sizeof(ble_gap_addr_t)) == 0)))
+        if (memcmp(&m_peer_table[index].peer_id.id_addr_info, p_addr, sizeof(ble_gap_addr_t)) == 0)
         {
             DM_LOG("[DM]: Found device at instance 0x%02X\r\n", index);
 
@@ -960,28 +1215,36 @@ static __INLINE void device_context_store(dm_handle_t const * p_handle, device_s
             store_fn = storage_operation_dummy_handler;
         }
 
-        //Store the peer id.
-        err_code = store_fn(&block_handle,
-                            (uint8_t *)&m_peer_table[p_handle->device_id],
-                            PEER_ID_SIZE,
-                            PEER_ID_STORAGE_OFFSET);
-
-        if ((err_code == NRF_SUCCESS) && (state != UPDATE_PEER_ADDR))
+        if ((store_fn != storage_operation_dummy_handler) && (state != UPDATE_PEER_ADDR))
         {
+            device_record_t * p_record = &m_record_table[p_handle->connection_id];
+
             m_connection_table[p_handle->connection_id].state &= (~STATE_BOND_INFO_UPDATE);
 
-            //Store the bond information.
+            //Store the peer id and the bond information together, as an update of each would
+            //swap the flash page.
+            p_record->peer = m_peer_table[p_handle->device_id];
+            p_record->bond = m_bond_table[p_handle->connection_id];
+
             err_code = store_fn(&block_handle,
-                                (uint8_t *)&m_bond_table[p_handle->connection_id],
-                                BOND_SIZE,
-                                BOND_STORAGE_OFFSET);
+                                (uint8_t *)p_record,
+                                DEVICE_CONTEXT_SIZE,
+                                PEER_ID_STORAGE_OFFSET);
 
             if (err_code != NRF_SUCCESS)
             {
-                DM_ERR("[DM]:[0x%02X]:Failed to store bond information, reason 0x%08X\r\n",
+                DM_ERR("[DM]:[0x%02X]:Failed to store device context, reason 0x%08X\r\n",
                        p_handle->device_id, err_code);
             }
         }
+        else
+        {
+            //Store the peer id only, when the peer address has changed.
+            err_code = store_fn(&block_handle,
+                                (uint8_t *)&m_peer_table[p_handle->device_id],
+                                PEER_ID_SIZE,
+                                PEER_ID_STORAGE_OFFSET);
+        }
 
         if (state != UPDATE_PEER_ADDR)
         {
@@ -1392,6 +1655,25 @@ static __INLINE ret_code_t gattsc_context_apply(dm_handle_t * p_handle)
 }
 
 
+/**@brief Function for getting the connection instance of a stored bond information.
+ *
+ * @param[in] p_data Data of the flash operation, either bond information or a device record.
+ *
+ * @retval Connection instance, DEVICE_MANAGER_MAX_CONNECTIONS or more if the data is neither.
+ */
+static __INLINE uint32_t bond_context_index_get(uint8_t const * p_data)
+{
+    uint32_t index = ((uint32_t)(p_data - (uint8_t *)m_record_table)) / sizeof(device_record_t);
+
+    if (index < DEVICE_MANAGER_MAX_CONNECTIONS)
+    {
+        return index;
+    }
+
+    return ((uint32_t)(p_data - (uint8_t *)m_bond_table)) / BOND_SIZE;
+}
+
+
 /**@brief Function for pstorage module callback.
  *
  * @param[in] p_handle Identifies module and block for which callback is received.
@@ -1500,7 +1782,7 @@ static void dm_pstorage_cb_handler(pstorage_handle_t * p_handle,
             }
             else
             {
-                index_count = ((uint32_t)(p_data - (uint8_t *)m_bond_table)) / BOND_SIZE;
+                index_count = bond_context_index_get(p_data);
 
                 if (index_count < DEVICE_MANAGER_MAX_CONNECTIONS)
                 {
@@ -1650,6 +1932,9 @@ ret_code_t dm_init(dm_init_param_t const * const p_init_param)
 
     memset(m_gatts_table, 0, sizeof(m_gatts_table));
 
+    memset(m_addr_hash_head, DM_INVALID_ID, sizeof(m_addr_hash_head));
+    memset(m_addr_hash_bucket, DM_INVALID_ID, sizeof(m_addr_hash_bucket));
+
     //Initialization of all device instances.
     for (index = 0; index < DEVICE_MANAGER_MAX_BONDS; index++)
     {
@@ -1715,6 +2000,8 @@ ret_code_t dm_init(dm_init_param_t const * const p_init_param)
                                m_peer_table[index].peer_id.id_addr_info.addr[3],
                                m_peer_table[index].peer_id.id_addr_info.addr[4],
                                m_peer_table[index].peer_id.id_addr_info.addr[5]);
+
+                        addr_index_update(index);
                     }
                 }
                 else
@@ -2289,6 +2576,65 @@ ret_code_t dm_application_context_delete(const dm_handle_t * p_handle)
 }
 
 
+ret_code_t dm_attr_cache_seal(dm_application_context_t * p_context)
+{
+#if (DEVICE_MANAGER_ATTR_CACHE != 0)
+    NULL_PARAM_CHECK(p_context);
+    NULL_PARAM_CHECK(p_context->p_data);
+
+    dm_attr_cache_hdr_t header;
+
+    memcpy(&header, p_context->p_data, sizeof(dm_attr_cache_hdr_t));
+
+    if ((sizeof(dm_attr_cache_hdr_t) + header.data_len) > DEVICE_MANAGER_APP_CONTEXT_SIZE)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    header.db_hash = crc32_compute(&p_context->p_data[sizeof(dm_attr_cache_hdr_t)],
+                                   header.data_len,
+                                   NULL);
+
+    memcpy(p_context->p_data, &header, sizeof(dm_attr_cache_hdr_t));
+    p_context->len = sizeof(dm_attr_cache_hdr_t) + header.data_len;
+
+    return NRF_SUCCESS;
+#else //DEVICE_MANAGER_ATTR_CACHE
+    return (FEATURE_NOT_ENABLED | DEVICE_MANAGER_ERR_BASE);
+#endif //DEVICE_MANAGER_ATTR_CACHE
+}
+
+
+ret_code_t dm_attr_cache_verify(dm_application_context_t const * p_context)
+{
+#if (DEVICE_MANAGER_ATTR_CACHE != 0)
+    NULL_PARAM_CHECK(p_context);
+    NULL_PARAM_CHECK(p_context->p_data);
+
+    dm_attr_cache_hdr_t header;
+
+    memcpy(&header, p_context->p_data, sizeof(dm_attr_cache_hdr_t));
+
+    if ((p_context->len > DEVICE_MANAGER_APP_CONTEXT_SIZE) ||
+        (p_context->len != (sizeof(dm_attr_cache_hdr_t) + header.data_len)))
+    {
+        return DM_ATTR_CACHE_STALE;
+    }
+
+    if (header.db_hash != crc32_compute(&p_context->p_data[sizeof(dm_attr_cache_hdr_t)],
+                                        header.data_len,
+                                        NULL))
+    {
+        return DM_ATTR_CACHE_STALE;
+    }
+
+    return NRF_SUCCESS;
+#else //DEVICE_MANAGER_ATTR_CACHE
+    return (FEATURE_NOT_ENABLED | DEVICE_MANAGER_ERR_BASE);
+#endif //DEVICE_MANAGER_ATTR_CACHE
+}
+
+
 ret_code_t dm_application_instance_set(dm_application_instance_t const * p_appl_instance,
                                        dm_handle_t                     * p_handle)
 {
@@ -2335,6 +2681,7 @@ ret_code_t dm_peer_addr_set(dm_handle_t const    * p_handle,
         (p_addr->addr_type != BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_RESOLVABLE))
     {
         m_peer_table[p_handle->device_id].peer_id.id_addr_info = (*p_addr);
+        addr_index_update(p_handle->device_id);
         update_status_bit_set(p_handle->device_id);
         device_context_store(p_handle, UPDATE_PEER_ADDR);
         err_code = NRF_SUCCESS;
@@ -2517,6 +2864,74 @@ void bond_data_load(dm_handle_t * p_handle)
 }
 
 
+#if (DEVICE_MANAGER_ATTR_CACHE != 0)
+/**@brief Function for deleting the attribute cache of a bonded peer if its services changed.
+ *
+ * @details Called with the module locked on every handle value notification or indication. The
+ *          attribute cache is deleted if the value handle is the one of the Service Changed
+ *          characteristic recorded in the cache header.
+ *
+ * @param[in] p_handle    Identifies the bonded peer.
+ * @param[in] attr_handle Handle of the notified or indicated value.
+ *
+ * @retval NRF_SUCCESS       If the attribute cache was deleted.
+ * @retval DM_NO_APP_CONTEXT If the peer has no attribute cache or the value is not a service change.
+ */
+static ret_code_t attr_cache_invalidate(dm_handle_t const * p_handle, uint16_t attr_handle)
+{
+    uint32_t            err_code;
+    uint32_t            context_len;
+    dm_attr_cache_hdr_t header;
+    pstorage_handle_t   block_handle;
+
+    err_code = pstorage_block_identifier_get(&m_storage_handle,
+                                             p_handle->device_id,
+                                             &block_handle);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = pstorage_load((uint8_t *)&context_len,
+                                 &block_handle,
+                                 sizeof(uint32_t),
+                                 APP_CONTEXT_STORAGE_OFFSET);
+    }
+
+    if ((err_code != NRF_SUCCESS) || (context_len == INVALID_CONTEXT_LEN))
+    {
+        return DM_NO_APP_CONTEXT;
+    }
+
+    err_code = pstorage_load((uint8_t *)&header,
+                             &block_handle,
+                             sizeof(dm_attr_cache_hdr_t),
+                             (APP_CONTEXT_STORAGE_OFFSET + sizeof(uint32_t)));
+
+    if ((err_code != NRF_SUCCESS) ||
+        (header.srvc_changed_handle == BLE_GATT_HANDLE_INVALID) ||
+        (header.srvc_changed_handle != attr_handle))
+    {
+        return DM_NO_APP_CONTEXT;
+    }
+
+    err_code = pstorage_update(&block_handle,
+                               (uint8_t *)&m_context_init_len,
+                               sizeof(uint32_t),
+                               APP_CONTEXT_STORAGE_OFFSET);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_app_context_table[p_handle->device_id] = NULL;
+    }
+    else
+    {
+        DM_ERR("[DM]: Failed to delete attribute cache, reason 0x%08X\r\n", err_code);
+    }
+
+    return err_code;
+}
+#endif // DEVICE_MANAGER_ATTR_CACHE
+
+
 void dm_ble_evt_handler(ble_evt_t * p_ble_evt)
 {
     uint32_t    err_code;
@@ -2794,6 +3209,7 @@ void dm_ble_evt_handler(ble_evt_t * p_ble_evt)
                                 m_peer_table[handle.device_id].id_bitmap &= (~IRK_ENTRY);
                             }
 
+                            addr_index_update(handle.device_id);
                             device_context_store(&handle, FIRST_BOND_STORE);
                         }
                     }
@@ -2864,6 +3280,25 @@ void dm_ble_evt_handler(ble_evt_t * p_ble_evt)
             
             break;
 
+#if (DEVICE_MANAGER_ATTR_CACHE != 0)
+        case BLE_GATTC_EVT_HVX:
+            //Drop the attribute cache of a bonded peer when it indicates a change of its services,
+            //so that the application discovers them again instead of using stale handles.
+            if ((handle.device_id != DM_INVALID_ID) &&
+                (attr_cache_invalidate(&handle,
+                                       p_ble_evt->evt.gattc_evt.params.hvx.handle) == NRF_SUCCESS))
+            {
+                DM_LOG("[DM]:[DI 0x%02X]: Services changed, attribute cache deleted.\r\n",
+                       handle.device_id);
+
+                event.event_id                = DM_EVT_APPL_CONTEXT_INVALIDATED;
+                event.event_param.p_gap_param = NULL;
+                event.event_paramlen          = 0;
+                notify_app                    = true;
+            }
+            break;
+#endif // DEVICE_MANAGER_ATTR_CACHE
+
         default:
             break;
     }
@@ -15,6 +15,9 @@
 
 #include "twi_master.h"
 #include "synaptics_touchpad.h"
+#include "nrf_drv_gpiote.h"
+#include "app_util_platform.h"
+#include "nordic_common.h"
 
 /*lint ++flb "Enter library region" */
 
@@ -23,6 +26,21 @@
 static uint8_t       m_device_address; // !< Device address in bits [7:1]
 static const uint8_t expected_product_id[PRODUCT_ID_BYTES] = {'T', 'M', '1', '9', '4', '4', '-', '0', '0', '2'};  //!< Product ID expected to get from product ID query
 
+STATIC_ASSERT(IS_POWER_OF_TWO(TOUCHPAD_FRAME_QUEUE_SIZE));
+
+static const uint8_t             m_int_status_address = TOUCHPAD_INT_STATUS;  //!< Register address written before reading the interrupt status
+static const uint8_t             m_data_block_address = TOUCHPAD_FINGER0_REL; //!< Register address written before reading the data block
+static nrf_drv_twi_t const *     mp_twi;                                      //!< TWI instance used in burst read mode
+static touchpad_frame_handler_t  m_frame_handler;                             //!< Handler called when a burst read is done
+static uint32_t                  m_attn_pin;                                  //!< Pin connected to the ATTN line
+static touchpad_frame_t          m_frame_rx;                                  //!< Frame being read
+static touchpad_frame_t          m_frames[TOUCHPAD_FRAME_QUEUE_SIZE];         //!< Ring buffer of frames read
+static volatile uint32_t         m_frame_write_pos;                           //!< Number of frames added to the ring buffer
+static volatile uint32_t         m_frame_read_pos;                            //!< Number of frames fetched from the ring buffer
+static bool                      m_status_read_ok;                            //!< Result of reading the interrupt status of the current burst
+static volatile bool             m_burst_in_progress;                         //!< A burst read is in progress
+static volatile bool             m_burst_pending;                             //!< ATTN was asserted again during the burst read in progress
+
 bool touchpad_init(uint8_t device_address)
 {
     bool transfer_succeeded = true;
@@ -112,4 +130,152 @@ bool touchpad_product_id_read(uint8_t * product_id, uint8_t product_id_bytes)
     return transfer_succeeded;
 }
 
+static void burst_start(void);
+
+static void burst_status_read_done(ret_code_t result, void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+    m_status_read_ok = (result == NRF_SUCCESS);
+}
+
+static void burst_data_read_done(ret_code_t result, void * p_context)
+{
+    bool success = m_status_read_ok && (result == NRF_SUCCESS);
+    bool restart;
+
+    UNUSED_PARAMETER(p_context);
+
+    if (success && ((m_frame_write_pos - m_frame_read_pos) < TOUCHPAD_FRAME_QUEUE_SIZE))
+    {
+        m_frames[m_frame_write_pos & (TOUCHPAD_FRAME_QUEUE_SIZE - 1)] = m_frame_rx;
+        m_frame_write_pos++;
+    }
+
+    if (m_frame_handler != NULL)
+    {
+        m_frame_handler(success);
+    }
+
+    CRITICAL_REGION_ENTER();
+    restart             = m_burst_pending;
+    m_burst_pending     = false;
+    m_burst_in_progress = restart;
+    CRITICAL_REGION_EXIT();
+
+    if (restart)
+    {
+        burst_start();
+    }
+}
+
+static void burst_start(void)
+{
+    nrf_drv_twi_xfer_t xfer;
+    ret_code_t         err_code;
+
+    // Reading the interrupt status first releases ATTN, so an event during the data read
+    // asserts it again and triggers the next burst.
+    xfer.address   = (uint8_t)(m_device_address >> 1);
+    xfer.tx_length = 1;
+    xfer.rx_length = 1;
+    xfer.p_tx_data = &m_int_status_address;
+    xfer.p_rx_data = &m_frame_rx.interrupt_status;
+    xfer.callback  = burst_status_read_done;
+    xfer.p_context = NULL;
+
+    err_code = nrf_drv_twi_xfer_schedule(mp_twi, &xfer);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        xfer.rx_length = TOUCHPAD_DATA_BLOCK_LEN;
+        xfer.p_tx_data = &m_data_block_address;
+        xfer.p_rx_data = m_frame_rx.data;
+        xfer.callback  = burst_data_read_done;
+
+        // If this fails, the status read already queued still runs, which only clears the
+        // interrupts.
+        err_code = nrf_drv_twi_xfer_schedule(mp_twi, &xfer);
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        m_burst_in_progress = false;
+        if (m_frame_handler != NULL)
+        {
+            m_frame_handler(false);
+        }
+    }
+}
+
+static void attn_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    bool start;
+
+    UNUSED_PARAMETER(pin);
+    UNUSED_PARAMETER(action);
+
+    CRITICAL_REGION_ENTER();
+    start               = !m_burst_in_progress;
+    m_burst_pending     = !start;
+    m_burst_in_progress = true;
+    CRITICAL_REGION_EXIT();
+
+    if (start)
+    {
+        burst_start();
+    }
+}
+
+bool touchpad_burst_mode_enable(nrf_drv_twi_t const * p_twi, uint32_t attn_pin, touchpad_frame_handler_t frame_handler)
+{
+    nrf_drv_gpiote_in_config_t config = GPIOTE_CONFIG_IN_SENSE_HITOLO(false);
+
+    mp_twi              = p_twi;
+    m_attn_pin          = attn_pin;
+    m_frame_handler     = frame_handler;
+    m_frame_write_pos   = 0;
+    m_frame_read_pos    = 0;
+    m_burst_pending     = false;
+    m_burst_in_progress = false;
+
+    if (!nrf_drv_gpiote_is_init() && (nrf_drv_gpiote_init() != NRF_SUCCESS))
+    {
+        return false;
+    }
+
+    config.pull = NRF_GPIO_PIN_PULLUP;
+    if (nrf_drv_gpiote_in_init(attn_pin, &config, attn_handler) != NRF_SUCCESS)
+    {
+        return false;
+    }
+    nrf_drv_gpiote_in_event_enable(attn_pin, true);
+
+    if (!nrf_drv_gpiote_in_is_set(attn_pin))
+    {
+        // ATTN already asserted, no edge will come until the interrupts are cleared.
+        attn_handler(attn_pin, NRF_GPIOTE_POLARITY_HITOLO);
+    }
+
+    return true;
+}
+
+void touchpad_burst_mode_disable(void)
+{
+    nrf_drv_gpiote_in_event_disable(m_attn_pin);
+    nrf_drv_gpiote_in_uninit(m_attn_pin);
+}
+
+bool touchpad_frame_get(touchpad_frame_t * p_frame)
+{
+    if (m_frame_write_pos == m_frame_read_pos)
+    {
+        return false;
+    }
+
+    *p_frame = m_frames[m_frame_read_pos & (TOUCHPAD_FRAME_QUEUE_SIZE - 1)];
+    m_frame_read_pos++;
+
+    return true;
+}
+
 /*lint --flb "Leave library region" */
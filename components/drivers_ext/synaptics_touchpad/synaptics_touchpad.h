@@ -17,6 +17,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "nrf_drv_twi.h"
 
 /** @file
 * @brief Synaptics Touchpad driver
@@ -43,6 +44,34 @@
 #define TOUCHPAD_PAGESELECT 0xFF //!< Address of page select (can be found in every page at the same address)
 #define TOUCHPAD_PRODUCT_ID 0xA2 //!< Address of product ID string
 
+#ifndef TOUCHPAD_FRAME_QUEUE_SIZE
+#define TOUCHPAD_FRAME_QUEUE_SIZE 4 //!< Number of frames buffered in burst read mode, must be a power of two
+#endif
+
+#define TOUCHPAD_DATA_BLOCK_LEN (TOUCHPAD_BUTTON_STATUS - TOUCHPAD_FINGER0_REL + 1) //!< Number of data registers read in one burst, from TOUCHPAD_FINGER0_REL to TOUCHPAD_BUTTON_STATUS
+
+/**
+  @brief Macro for getting a data register from a frame.
+  @param FRAME Frame of type @ref touchpad_frame_t
+  @param REG Register address, from TOUCHPAD_FINGER0_REL to TOUCHPAD_BUTTON_STATUS
+*/
+#define TOUCHPAD_FRAME_REGISTER(FRAME, REG) ((FRAME).data[(REG) - TOUCHPAD_FINGER0_REL])
+
+/**
+  Touchpad data read in one burst when the ATTN line is asserted
+*/
+typedef struct
+{
+  uint8_t interrupt_status;              //!< Interrupt status register, read first to clear the interrupts
+  uint8_t data[TOUCHPAD_DATA_BLOCK_LEN]; //!< Data registers, see @ref TOUCHPAD_FRAME_REGISTER
+} touchpad_frame_t;
+
+/**
+  @brief Handler called from the TWI interrupt when a burst read is done.
+  @param success true if a frame was read and can be fetched with @ref touchpad_frame_get, false if the read failed
+*/
+typedef void (*touchpad_frame_handler_t)(bool success);
+
 /**
   Operational states
 */
@@ -119,6 +148,37 @@ bool touchpad_product_id_read(uint8_t *product_id, uint8_t product_id_bytes);
 */
 bool touchpad_product_id_verify(void);
 
+/**
+  @brief Function for enabling the burst read mode.
+
+  Each time the touchpad asserts its ATTN line, the interrupt status register and the whole data
+  register block are read without blocking, chained on the TWI transaction queue, and stored as a
+  frame in a ring buffer of TOUCHPAD_FRAME_QUEUE_SIZE frames. A frame that does not fit is dropped.
+
+  @note The TWI instance must be initialized in non-blocking mode and enabled. While the burst
+        read mode is enabled, the blocking register functions of this driver must not be used.
+        The GPIOTE driver is initialized if it is not already.
+  @param[in] p_twi TWI instance the touchpad is connected to
+  @param[in] attn_pin Pin connected to the ATTN line of the touchpad
+  @param[in] frame_handler Handler called when a burst read is done
+  @retval true Burst read mode enabled
+  @retval false ATTN pin configuration failed
+*/
+bool touchpad_burst_mode_enable(nrf_drv_twi_t const * p_twi, uint32_t attn_pin, touchpad_frame_handler_t frame_handler);
+
+/**
+  @brief Function for disabling the burst read mode. A burst read in progress still completes.
+*/
+void touchpad_burst_mode_disable(void);
+
+/**
+  @brief Function for getting the oldest frame read in burst read mode.
+  @param[out] p_frame Frame
+  @retval true A frame was copied to p_frame
+  @retval false No frame available
+*/
+bool touchpad_frame_get(touchpad_frame_t * p_frame);
+
 /**
  *@}
  **/
@@ -0,0 +1,168 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "touchpad_gesture.h"
+
+/*lint ++flb "Enter library region" */
+
+#define TOUCHPAD_FINGER0_REL_Y  (TOUCHPAD_FINGER0_REL + 1) //!< Vertical finger delta register
+#define GESTURE_FLAG_SINGLE_TAP 0x01                       //!< Single tap flag in TOUCHPAD_GESTURE_FLAGS
+#define GESTURE_FLAG_PRESS      0x20                       //!< Press flag in TOUCHPAD_GESTURE_FLAGS, set while a finger rests on the pad
+
+#define FRACTION_BITS 8                                    //!< Fraction bits of the filtered motion and the travel
+#define SWIPE_TRAVEL  (TOUCHPAD_GESTURE_SWIPE_COUNTS << FRACTION_BITS)
+#define DIM_TRAVEL    (TOUCHPAD_GESTURE_DIM_COUNTS << FRACTION_BITS)
+
+/**
+  Decoder states
+*/
+typedef enum
+{
+  GESTURE_STATE_IDLE,  //!< No finger on the pad
+  GESTURE_STATE_TOUCH, //!< Finger on the pad, not moved enough for a swipe
+  GESTURE_STATE_SWIPE, //!< Finger swiping, dim events are reported
+  GESTURE_STATE_HELD   //!< Long press reported, waiting for the finger to lift
+} gesture_state_t;
+
+static touchpad_gesture_handler_t m_handler;        //!< Handler called for each decoded gesture
+static gesture_state_t            m_state;          //!< Decoder state
+static bool                       m_pressed;        //!< The last frame had the press flag set
+static uint32_t                   m_touch_start_ms; //!< Time of the first frame of the touch
+static uint32_t                   m_last_frame_ms;  //!< Time of the last frame of the touch
+static int32_t                    m_motion;         //!< Filtered vertical motion per frame, with FRACTION_BITS fraction bits
+static int32_t                    m_travel;         //!< Filtered vertical travel not yet reported, with FRACTION_BITS fraction bits
+
+static void evt_send(touchpad_gesture_evt_type_t type, int8_t dim_steps)
+{
+    touchpad_gesture_evt_t evt;
+
+    evt.type      = type;
+    evt.dim_steps = dim_steps;
+
+    if (m_handler != NULL)
+    {
+        m_handler(&evt);
+    }
+}
+
+static void touch_end(bool tap)
+{
+    // A tap flagged by the pad is already debounced by the pad.
+    if ((m_state == GESTURE_STATE_TOUCH) &&
+        (tap || ((m_last_frame_ms - m_touch_start_ms) >= TOUCHPAD_GESTURE_DEBOUNCE_MS)))
+    {
+        evt_send(TOUCHPAD_GESTURE_EVT_TAP, 0);
+    }
+    m_state   = GESTURE_STATE_IDLE;
+    m_pressed = false;
+}
+
+static void long_press_check(uint32_t time_ms)
+{
+    if ((m_state == GESTURE_STATE_TOUCH) &&
+        ((time_ms - m_touch_start_ms) >= TOUCHPAD_GESTURE_LONG_PRESS_MS))
+    {
+        m_state = GESTURE_STATE_HELD;
+        evt_send(TOUCHPAD_GESTURE_EVT_LONG_PRESS, 0);
+    }
+}
+
+void touchpad_gesture_init(touchpad_gesture_handler_t handler)
+{
+    m_handler = handler;
+    m_state   = GESTURE_STATE_IDLE;
+    m_pressed = false;
+}
+
+void touchpad_gesture_frame_process(touchpad_frame_t const * p_frame, uint32_t time_ms)
+{
+    int32_t delta = (int8_t)TOUCHPAD_FRAME_REGISTER(*p_frame, TOUCHPAD_FINGER0_REL_Y);
+    uint8_t flags = TOUCHPAD_FRAME_REGISTER(*p_frame, TOUCHPAD_GESTURE_FLAGS);
+    int32_t steps;
+
+    if (m_state == GESTURE_STATE_IDLE)
+    {
+        m_state          = GESTURE_STATE_TOUCH;
+        m_touch_start_ms = time_ms;
+        m_motion         = 0;
+        m_travel         = 0;
+    }
+    m_last_frame_ms = time_ms;
+    m_pressed       = ((flags & GESTURE_FLAG_PRESS) != 0);
+
+    // First order IIR low-pass, y += (x - y) / 2^shift. The division rounds towards zero, so a
+    // resting finger settles at exactly no motion.
+    m_motion += ((delta << FRACTION_BITS) - m_motion) / (1 << TOUCHPAD_GESTURE_IIR_SHIFT);
+    m_travel += m_motion;
+
+    switch (m_state)
+    {
+        case GESTURE_STATE_TOUCH:
+            if (abs(m_travel) >= SWIPE_TRAVEL)
+            {
+                m_state  = GESTURE_STATE_SWIPE;
+                evt_send(TOUCHPAD_GESTURE_EVT_DIM, (m_travel > 0) ? 1 : -1);
+                m_travel = 0;
+            }
+            else
+            {
+                long_press_check(time_ms);
+            }
+            break;
+
+        case GESTURE_STATE_SWIPE:
+            steps = m_travel / DIM_TRAVEL;
+            if (steps != 0)
+            {
+                m_travel -= steps * DIM_TRAVEL;
+                evt_send(TOUCHPAD_GESTURE_EVT_DIM, (int8_t)steps);
+            }
+            break;
+
+        default:
+            // Motion after a long press is ignored until the finger lifts.
+            break;
+    }
+
+    if ((flags & GESTURE_FLAG_SINGLE_TAP) != 0)
+    {
+        touch_end(true);
+    }
+}
+
+void touchpad_gesture_timeout_check(uint32_t time_ms)
+{
+    if (m_state == GESTURE_STATE_IDLE)
+    {
+        return;
+    }
+
+    if (!m_pressed && ((time_ms - m_last_frame_ms) >= TOUCHPAD_GESTURE_RELEASE_MS))
+    {
+        touch_end(false);
+    }
+    else
+    {
+        long_press_check(time_ms);
+    }
+}
+
+bool touchpad_gesture_is_active(void)
+{
+    return (m_state != GESTURE_STATE_IDLE);
+}
+
+/*lint --flb "Leave library region" */
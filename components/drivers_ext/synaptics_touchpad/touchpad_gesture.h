@@ -0,0 +1,125 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef TOUCHPAD_GESTURE_H
+#define TOUCHPAD_GESTURE_H
+
+/*lint ++flb "Enter library region" */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "synaptics_touchpad.h"
+
+/** @file
+* @brief Touchpad gesture decoder
+*
+*
+* @defgroup nrf_drivers_touchpad_gesture Touchpad gesture decoder.
+* @{
+* @ingroup nrf_drivers_synaptics_touchpad
+* @brief Decoding of touchpad frames into light switch gestures.
+*
+* Turns the frames read in burst read mode into tap, long press and dim events, so that an
+* application only has to act on, and publish, the intent of the user instead of finger motion.
+* The vertical finger motion is smoothed with a fixed-point first order IIR filter, touches shorter
+* than the debounce time are ignored, and each frame is handled in constant time with a few bytes
+* of state.
+*
+* A touch starts with the first frame after an idle period and ends when no frame has been
+* received for TOUCHPAD_GESTURE_RELEASE_MS. As a finger that does not move does not produce
+* frames, @ref touchpad_gesture_timeout_check must be called periodically to detect long presses
+* and releases.
+*/
+
+#ifndef TOUCHPAD_GESTURE_DEBOUNCE_MS
+#define TOUCHPAD_GESTURE_DEBOUNCE_MS   30   //!< Touches shorter than this are ignored
+#endif
+#ifndef TOUCHPAD_GESTURE_RELEASE_MS
+#define TOUCHPAD_GESTURE_RELEASE_MS    120  //!< Time without frames after which the finger is considered lifted
+#endif
+#ifndef TOUCHPAD_GESTURE_LONG_PRESS_MS
+#define TOUCHPAD_GESTURE_LONG_PRESS_MS 800  //!< Time a finger must rest on the pad for a long press
+#endif
+#ifndef TOUCHPAD_GESTURE_IIR_SHIFT
+#define TOUCHPAD_GESTURE_IIR_SHIFT     2    //!< IIR filter coefficient, as a power of two: y += (x - y) / 2^shift
+#endif
+#ifndef TOUCHPAD_GESTURE_SWIPE_COUNTS
+#define TOUCHPAD_GESTURE_SWIPE_COUNTS  24   //!< Filtered vertical travel, in touchpad counts, that turns a touch into a swipe
+#endif
+#ifndef TOUCHPAD_GESTURE_DIM_COUNTS
+#define TOUCHPAD_GESTURE_DIM_COUNTS    16   //!< Filtered vertical travel, in touchpad counts, per dim step while swiping
+#endif
+
+/**
+  Gesture event types
+*/
+typedef enum
+{
+  TOUCHPAD_GESTURE_EVT_TAP,        //!< Short touch without motion, for example to toggle the light
+  TOUCHPAD_GESTURE_EVT_LONG_PRESS, //!< Finger resting on the pad for TOUCHPAD_GESTURE_LONG_PRESS_MS, reported once per touch
+  TOUCHPAD_GESTURE_EVT_DIM         //!< Vertical swipe, see @ref touchpad_gesture_evt_t::dim_steps
+} touchpad_gesture_evt_type_t;
+
+/**
+  Gesture event
+*/
+typedef struct
+{
+  touchpad_gesture_evt_type_t type;      //!< Event type
+  int8_t                      dim_steps; //!< For TOUCHPAD_GESTURE_EVT_DIM, number of steps to dim up (positive) or down (negative)
+} touchpad_gesture_evt_t;
+
+/**
+  @brief Handler called for each decoded gesture.
+  @param[in] p_evt Gesture event
+*/
+typedef void (*touchpad_gesture_handler_t)(touchpad_gesture_evt_t const * p_evt);
+
+/**
+  @brief Function for initializing the gesture decoder.
+  @param[in] handler Handler called for each decoded gesture
+*/
+void touchpad_gesture_init(touchpad_gesture_handler_t handler);
+
+/**
+  @brief Function for decoding a touchpad frame.
+  @note The handler is called from this function, and from @ref touchpad_gesture_timeout_check, so
+        both must be called from the same interrupt priority, for example from the main loop with
+        the frames fetched with @ref touchpad_frame_get.
+  @param[in] p_frame Frame read in burst read mode
+  @param[in] time_ms Time the frame was fetched, in milliseconds. Only differences are used, so
+                     the counter may wrap around.
+*/
+void touchpad_gesture_frame_process(touchpad_frame_t const * p_frame, uint32_t time_ms);
+
+/**
+  @brief Function for detecting long presses and releases between frames.
+  @details Should be called at least every TOUCHPAD_GESTURE_RELEASE_MS / 2 while a touch is in
+           progress, see @ref touchpad_gesture_is_active.
+  @param[in] time_ms Current time, in milliseconds, on the same time base as the frames
+*/
+void touchpad_gesture_timeout_check(uint32_t time_ms);
+
+/**
+  @brief Function for checking if a touch is in progress.
+  @retval true A touch is in progress, @ref touchpad_gesture_timeout_check must be called
+  @retval false The pad is idle
+*/
+bool touchpad_gesture_is_active(void);
+
+/**
+ *@}
+ **/
+
+/*lint --flb "Leave library region" */
+
+#endif /* TOUCHPAD_GESTURE_H */
@@ -0,0 +1,236 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "nrf_drv_adc.h"
+
+#include "nrf_drv_ppi.h"
+#include "nrf_assert.h"
+#include "nrf_error.h"
+#include "app_util_platform.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static nrf_drv_adc_event_handler_t m_event_handler = NULL;
+static nrf_drv_state_t             m_state = NRF_DRV_STATE_UNINITIALIZED;
+
+static nrf_adc_config_input_t      m_channels[NRF_DRV_ADC_MAX_CHANNELS]; /**< Inputs converted in each scan. */
+static uint8_t                     m_channel_count;                      /**< Number of inputs in the list, 0 until a list is set. */
+static volatile uint8_t            m_channel_index;                      /**< Input currently converted, 0 when idle. */
+static int16_t *                   mp_buffer;                            /**< Buffer of the scan in progress. */
+static int16_t *                   mp_next_buffer;                       /**< Buffer of the following scans. */
+
+static nrf_ppi_channel_t           m_ppi_channel;                        /**< PPI channel of the hardware trigger. */
+static bool                        m_trigger_enabled;                    /**< The hardware trigger is connected. */
+
+static const nrf_drv_adc_config_t  m_default_config = NRF_DRV_ADC_DEFAULT_CONFIG;
+
+
+void ADC_IRQHandler(void)
+{
+    int16_t * p_done;
+
+    nrf_adc_conversion_event_clean();
+    mp_buffer[m_channel_index] = (int16_t)nrf_adc_result_get();
+
+    if (++m_channel_index < m_channel_count)
+    {
+        // The ADC is idle after END, go straight on to the next input.
+        nrf_adc_input_select(m_channels[m_channel_index]);
+        nrf_adc_start();
+    }
+    else
+    {
+        // Be ready for the next trigger before calling the handler.
+        p_done          = mp_buffer;
+        m_channel_index = 0;
+        nrf_adc_input_select(m_channels[0]);
+
+        m_event_handler(p_done, m_channel_count);
+
+        mp_buffer = mp_next_buffer;
+    }
+}
+
+
+ret_code_t nrf_drv_adc_init(nrf_drv_adc_config_t const * p_config,
+                            nrf_drv_adc_event_handler_t  event_handler)
+{
+    if (m_state != NRF_DRV_STATE_UNINITIALIZED)
+    { // ADC driver is already initialized
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (event_handler == NULL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (p_config == NULL)
+    {
+        p_config = &m_default_config;
+    }
+
+    m_event_handler   = event_handler;
+    m_channel_count   = 0;
+    m_channel_index   = 0;
+    m_trigger_enabled = false;
+
+    nrf_adc_configure((nrf_adc_config_t *)&p_config->hal);
+    nrf_adc_conversion_event_clean();
+    nrf_adc_int_enable(ADC_INTENSET_END_Enabled << ADC_INTENSET_END_Pos);
+    nrf_drv_common_irq_enable(ADC_IRQn, p_config->interrupt_priority);
+
+    m_state = NRF_DRV_STATE_INITIALIZED;
+
+    return NRF_SUCCESS;
+}
+
+
+void nrf_drv_adc_uninit(void)
+{
+    ASSERT(m_state != NRF_DRV_STATE_UNINITIALIZED);
+
+    nrf_drv_adc_trigger_disable();
+
+    nrf_drv_common_irq_disable(ADC_IRQn);
+    nrf_adc_int_disable(ADC_INTENCLR_END_Enabled << ADC_INTENCLR_END_Pos);
+    nrf_adc_stop();
+    nrf_adc_conversion_event_clean();
+    nrf_adc_input_select(NRF_ADC_CONFIG_INPUT_DISABLED);
+
+    m_channel_count = 0;
+    m_channel_index = 0;
+    m_event_handler = NULL;
+    m_state         = NRF_DRV_STATE_UNINITIALIZED;
+}
+
+
+ret_code_t nrf_drv_adc_scan_setup(nrf_adc_config_input_t const * p_channels,
+                                  uint8_t                        count,
+                                  int16_t *                      p_buffer)
+{
+    if (m_state == NRF_DRV_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if ((count == 0) || (count > NRF_DRV_ADC_MAX_CHANNELS) || (p_buffer == NULL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (nrf_drv_adc_is_busy())
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    memcpy(m_channels, p_channels, count * sizeof(nrf_adc_config_input_t));
+    m_channel_count = count;
+    m_channel_index = 0;
+    mp_buffer       = p_buffer;
+    mp_next_buffer  = p_buffer;
+
+    nrf_adc_input_select(m_channels[0]);
+
+    return NRF_SUCCESS;
+}
+
+
+void nrf_drv_adc_buffer_set(int16_t * p_buffer)
+{
+    ASSERT(p_buffer != NULL);
+
+    mp_next_buffer = p_buffer;
+}
+
+
+ret_code_t nrf_drv_adc_trigger_enable(uint32_t event_address)
+{
+    ret_code_t err_code;
+
+    if ((m_state == NRF_DRV_STATE_UNINITIALIZED) || m_trigger_enabled)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    // The driver may be initialized already by other modules.
+    err_code = nrf_drv_ppi_init();
+    if ((err_code != NRF_SUCCESS) && (err_code != MODULE_ALREADY_INITIALIZED))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    if (nrf_drv_ppi_channel_alloc(&m_ppi_channel) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    err_code = nrf_drv_ppi_channel_assign(m_ppi_channel,
+                                          event_address,
+                                          (uint32_t)nrf_adc_task_address_get(NRF_ADC_TASK_START));
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = nrf_drv_ppi_channel_enable(m_ppi_channel);
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        (void)nrf_drv_ppi_channel_free(m_ppi_channel);
+        return err_code;
+    }
+
+    m_trigger_enabled = true;
+
+    return NRF_SUCCESS;
+}
+
+
+void nrf_drv_adc_trigger_disable(void)
+{
+    if (m_trigger_enabled)
+    {
+        (void)nrf_drv_ppi_channel_disable(m_ppi_channel);
+        (void)nrf_drv_ppi_channel_free(m_ppi_channel);
+        m_trigger_enabled = false;
+    }
+}
+
+
+ret_code_t nrf_drv_adc_scan_start(void)
+{
+    if ((m_state == NRF_DRV_STATE_UNINITIALIZED) || (m_channel_count == 0))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    ret_code_t err_code = NRF_SUCCESS;
+
+    CRITICAL_REGION_ENTER();
+    if (nrf_drv_adc_is_busy())
+    {
+        err_code = NRF_ERROR_BUSY;
+    }
+    else
+    {
+        nrf_adc_start();
+    }
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+bool nrf_drv_adc_is_busy(void)
+{
+    return ((m_channel_index != 0) || nrf_adc_is_busy());
+}
@@ -0,0 +1,173 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#ifndef NRF_DRV_ADC_H__
+#define NRF_DRV_ADC_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "nrf_adc.h"
+#include "sdk_errors.h"
+#include "nrf_drv_common.h"
+#include "nrf_drv_config.h"
+#include "app_util_platform.h"
+
+/**
+ * @addtogroup nrf_adc ADC HAL and driver
+ * @ingroup nrf_drivers
+ * @brief Analog-to-digital converter (ADC) APIs.
+ * @details The ADC HAL provides basic APIs for accessing the registers of the analog-to-digital
+ * converter. The ADC driver provides APIs on a higher level.
+ *
+ * @defgroup nrf_drivers_adc ADC driver
+ * @{
+ * @ingroup nrf_adc
+ * @brief Analog-to-digital converter (ADC) scan driver.
+ *
+ * @details The driver converts a list of channels, one after the other, without the CPU waiting
+ * for any conversion. A scan is started either by software with @ref nrf_drv_adc_scan_start, or
+ * through PPI by a hardware event, for example a TIMER compare or RTC tick event, set with
+ * @ref nrf_drv_adc_trigger_enable. The END interrupt of each conversion stores the result in the
+ * buffer given by the application and starts the conversion of the next channel. When the last
+ * channel has been converted, the event handler is called with the filled buffer.
+ *
+ * @note The driver owns ADC_IRQHandler.
+ */
+
+#ifndef ADC_CONFIG_IRQ_PRIORITY
+#define ADC_CONFIG_IRQ_PRIORITY APP_IRQ_PRIORITY_LOW /**< Default ADC interrupt priority. */
+#endif
+
+#define NRF_DRV_ADC_MAX_CHANNELS 8 /**< Maximum number of channels in a scan, the number of analog inputs. */
+
+/**@brief ADC event handler function type, called when a scan is complete.
+ *
+ * @param[in] p_buffer  Buffer holding one result for each channel, in the order of the channel list.
+ * @param[in] count     Number of results in the buffer.
+ */
+typedef void (* nrf_drv_adc_event_handler_t)(int16_t * p_buffer, uint8_t count);
+
+/**@brief ADC driver configuration.
+ */
+typedef struct
+{
+    nrf_adc_config_t hal;                /**< ADC HAL configuration. */
+    uint8_t          interrupt_priority; /**< ADC interrupt priority. */
+} nrf_drv_adc_config_t;
+
+/** ADC driver default configuration, including the ADC HAL configuration. */
+#define NRF_DRV_ADC_DEFAULT_CONFIG                            \
+    {                                                         \
+        .hal                = NRF_ADC_CONFIG_DEFAULT,         \
+        .interrupt_priority = ADC_CONFIG_IRQ_PRIORITY         \
+    }
+
+/**
+ * @brief Function for initializing the ADC driver.
+ *
+ * The ADC is configured and its END interrupt enabled. No conversion is started until a channel
+ * list is set with nrf_drv_adc_scan_setup() and a scan is triggered.
+ *
+ * @note Driver will be initialized to default settings if configuration struct is not provided.
+ *
+ * @param[in] p_config              Initial configuration. Default configuration used if NULL.
+ * @param[in] event_handler         Handler called when a scan is complete.
+ * @retval NRF_SUCCESS             If the driver was initialized.
+ * @retval NRF_ERROR_INVALID_PARAM If no handler is given.
+ * @retval NRF_ERROR_INVALID_STATE If the driver has already been initialized.
+ */
+ret_code_t nrf_drv_adc_init(nrf_drv_adc_config_t const * p_config,
+                            nrf_drv_adc_event_handler_t  event_handler);
+
+/**
+ * @brief Function for uninitializing the ADC driver.
+ *
+ * The hardware trigger is disconnected, and the ADC and its interrupt are disabled.
+ */
+void nrf_drv_adc_uninit(void);
+
+/**
+ * @brief Function for setting the channel list and the result buffer of the scans.
+ *
+ * Must not be called while a scan is in progress.
+ *
+ * @param[in] p_channels  List of inputs to convert in each scan. The list is copied.
+ * @param[in] count       Number of inputs in the list.
+ * @param[in] p_buffer    Buffer for the results, with room for count samples. Must be kept
+ *                        valid until the driver is uninitialized or another buffer is set.
+ * @retval NRF_SUCCESS             If the list was set.
+ * @retval NRF_ERROR_INVALID_PARAM If the count is 0 or larger than @ref NRF_DRV_ADC_MAX_CHANNELS,
+ *                                 or p_buffer is NULL.
+ * @retval NRF_ERROR_INVALID_STATE If the driver is not initialized.
+ * @retval NRF_ERROR_BUSY          If a scan is in progress.
+ */
+ret_code_t nrf_drv_adc_scan_setup(nrf_adc_config_input_t const * p_channels,
+                                  uint8_t                        count,
+                                  int16_t *                      p_buffer);
+
+/**
+ * @brief Function for setting the result buffer of the next scans.
+ *
+ * The buffer is used from the scan following the one in progress, so that the application can
+ * alternate between two buffers and process one while the other is filled. It is safe to call
+ * from the event handler.
+ *
+ * @param[in] p_buffer  Buffer for the results, with room for the number of channels set with
+ *                      nrf_drv_adc_scan_setup().
+ */
+void nrf_drv_adc_buffer_set(int16_t * p_buffer);
+
+/**
+ * @brief Function for starting scans on a hardware event.
+ *
+ * A PPI channel is allocated to connect the event to the START task of the ADC. The first
+ * conversion of each scan is then started by the event, without CPU involvement. Events that
+ * occur while a scan is in progress restart the current conversion, so the interval between events
+ * must be longer than a full scan.
+ *
+ * @param[in] event_address  Address of the event register, for example from
+ *                           nrf_drv_timer_compare_event_address_get().
+ * @retval NRF_SUCCESS             If the trigger was connected.
+ * @retval NRF_ERROR_INVALID_STATE If the driver is not initialized or a trigger is already connected.
+ * @retval NRF_ERROR_NO_MEM        If no PPI channel is available.
+ */
+ret_code_t nrf_drv_adc_trigger_enable(uint32_t event_address);
+
+/**
+ * @brief Function for disconnecting the hardware event set with nrf_drv_adc_trigger_enable().
+ *
+ * The PPI channel is freed. A scan in progress is completed.
+ */
+void nrf_drv_adc_trigger_disable(void);
+
+/**
+ * @brief Function for starting a scan by software.
+ *
+ * @retval NRF_SUCCESS             If the scan was started.
+ * @retval NRF_ERROR_INVALID_STATE If no channel list is set.
+ * @retval NRF_ERROR_BUSY          If a scan is in progress.
+ */
+ret_code_t nrf_drv_adc_scan_start(void);
+
+/**
+ * @brief Function for checking if a scan is in progress.
+ *
+ * @retval true  If a scan is in progress.
+ * @retval false If the ADC is idle.
+ */
+bool nrf_drv_adc_is_busy(void);
+
+/**
+ *@}
+ **/
+
+#endif /* NRF_DRV_ADC_H__ */
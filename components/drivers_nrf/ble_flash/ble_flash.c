@@ -153,12 +153,44 @@ uint32_t ble_flash_word_write(uint32_t * p_address, uint32_t value)
 
 uint32_t ble_flash_block_write(uint32_t * p_address, uint32_t * p_in_array, uint16_t word_count)
 {
-    uint16_t i;
+    uint16_t i = 0;
 
-    for (i = 0; i < word_count; i++)
+    while (i < word_count)
     {
-        flash_word_write(p_address, p_in_array[i]);
-        p_address++;
+        // If radio is active, wait for it to become inactive.
+        while (m_radio_active)
+        {
+            // Do nothing (just wait for radio to become inactive).
+            (void) sd_app_evt_wait();
+        }
+
+        // Turn on flash write enable once for the rest of the page, and wait until the NVMC is ready.
+        NRF_NVMC->CONFIG = (NVMC_CONFIG_WEN_Wen << NVMC_CONFIG_WEN_Pos);
+        while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+        {
+            // Do nothing.
+        }
+
+        // Write words until the end of the block or page, or until the radio is about to start.
+        do
+        {
+            *p_address = p_in_array[i];
+            while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+            {
+                // Do nothing.
+            }
+            p_address++;
+            i++;
+        } while ((i < word_count) &&
+                 !m_radio_active &&
+                 (((uint32_t)p_address % BLE_FLASH_PAGE_SIZE) != 0));
+
+        // Turn off flash write enable and wait until the NVMC is ready.
+        NRF_NVMC->CONFIG = (NVMC_CONFIG_WEN_Ren << NVMC_CONFIG_WEN_Pos);
+        while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+        {
+            // Do nothing
+        }
     }
 
     return NRF_SUCCESS;
@@ -97,6 +97,9 @@ uint32_t ble_flash_page_erase(uint8_t page_num);
 uint32_t ble_flash_word_write(uint32_t * p_address, uint32_t value);
 
 /**@brief Function for writing a data block to flash.
+ *
+ * @details Flash write is enabled once per page, and only re-enabled within a page if the radio
+ *          becomes active in between two words.
  *
  * @note Flash locations to be written must have been erased previously.
  *
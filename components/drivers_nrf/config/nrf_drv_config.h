@@ -125,6 +125,13 @@
 #define LPCOMP_CONFIG_INPUT        NRF_LPCOMP_INPUT_0
 #endif
 
+/* ADC */
+#define ADC_ENABLED 0
+
+#if (ADC_ENABLED == 1)
+#define ADC_CONFIG_IRQ_PRIORITY APP_IRQ_PRIORITY_LOW
+#endif
+
 /* WDT */
 #define WDT_ENABLED 0
 
@@ -82,12 +82,79 @@ void nrf_nvmc_write_word(uint32_t address, uint32_t value)
   }
 }
 
-void nrf_nvmc_write_bytes(uint32_t address, const uint8_t * src, uint32_t num_bytes)
+/**
+ * @brief Merge bytes into a flash word and write it back. Write must be enabled.
+ */
+static void nvmc_word_merge(uint32_t address32, uint32_t byte_shift, const uint8_t * src, uint32_t num_bytes)
 {
+  uint32_t value32 = *(uint32_t*)address32;
   uint32_t i;
-  for(i=0;i<num_bytes;i++)
+  for (i = 0; i < num_bytes; i++)
+  {
+    uint32_t bit_shift = (byte_shift + i) << 3;
+    value32 = (value32 & ~((uint32_t)0xFF << bit_shift)) | ((uint32_t)src[i] << bit_shift);
+  }
+
+  *(uint32_t*)address32 = value32;
+  while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+  {
+  }
+}
+
+void nrf_nvmc_write_bytes(uint32_t address, const uint8_t * src, uint32_t num_bytes)
+{
+  uint32_t byte_shift = address & (uint32_t)0x03;
+  uint32_t count;
+
+  if (num_bytes == 0)
+  {
+    return;
+  }
+
+  // Enable write once for the whole block, instead of once per byte.
+  NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Wen;
+  while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+  {
+  }
+
+  // Unaligned head.
+  if (byte_shift != 0)
+  {
+    count = 4 - byte_shift;
+    if (count > num_bytes)
+    {
+      count = num_bytes;
+    }
+    nvmc_word_merge(address - byte_shift, byte_shift, src, count);
+    address   += count;
+    src       += count;
+    num_bytes -= count;
+  }
+
+  // Aligned words. The source may be unaligned, so assemble each word.
+  while (num_bytes >= 4)
+  {
+    *(uint32_t*)address = (uint32_t)src[0]
+                        | ((uint32_t)src[1] << 8)
+                        | ((uint32_t)src[2] << 16)
+                        | ((uint32_t)src[3] << 24);
+    while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+    {
+    }
+    address   += 4;
+    src       += 4;
+    num_bytes -= 4;
+  }
+
+  // Unaligned tail.
+  if (num_bytes > 0)
+  {
+    nvmc_word_merge(address, 0, src, num_bytes);
+  }
+
+  NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Ren;
+  while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
   {
-     nrf_nvmc_write_byte(address+i,src[i]);
   }
 }
 
@@ -67,6 +67,10 @@ void nrf_nvmc_write_word(uint32_t address, uint32_t value);
 /**
  * @brief Write consecutive bytes to flash.
  *
+ * Write is enabled once for the whole block. Whole words are written
+ * directly, only the unaligned bytes at the start and end are merged with
+ * the flash contents.
+ *
  * @param address   Address to write to.
  * @param src       Pointer to data to copy from.
  * @param num_bytes Number of bytes in src to write.
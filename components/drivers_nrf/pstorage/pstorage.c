@@ -25,6 +25,7 @@
 #define SOC_MAX_WRITE_SIZE 1024                            /**< Maximum write size allowed for a single call to \ref sd_flash_write as specified in the SoC API. */
 #define RAW_MODE_APP_ID    (PSTORAGE_MAX_APPLICATIONS + 1) /**< Application id for raw mode. */
 #define SD_CMD_MAX_TRIES   3                               /**< Number of times to try a softdevice flash operation when the @ref NRF_EVT_FLASH_OPERATION_ERROR sys_evt is received. */
+#define ERASED_WORD        0xFFFFFFFF                      /**< Value of an erased flash word. */
 
 /**
  * @defgroup api_param_check API Parameters check macros.
@@ -149,6 +150,7 @@ typedef enum
     STATE_TAIL_RESTORE,        /**< State for restoring tail (end) of backed up data from swap to data page when using update/clear API. */
     STATE_NEW_BODY_WRITE,      /**< State for writing body (middle) data to the data page when using update/clear API. */
     STATE_SWAP_ERASE,          /**< State for erasing the swap page when using the update/clear API. */
+    STATE_BATCH_WRITE,         /**< State for rewriting the data page piece by piece, from swap or from the updates, when several updates to the page are handled in one swap cycle. */
     STATE_COMPLETE,            /**< State for indicating that update/clear sequence is completed internal in the module when using the update/clear API. */
     STATE_SWAP_DIRTY           /**< State for initializing the swap region on module initialization. */
 } swap_backup_state_t;
@@ -225,6 +227,8 @@ static uint32_t            m_next_page_addr;             /**< Points to the flas
 static pstorage_size_t     m_round_val;                  /**< Round value for multiple round operations. For erase operations, the round value will contain current round counter which is identical to number of pages erased. For store operations, the round value contains current round of operation * SOC_MAX_WRITE_SIZE to ensure each store to the SoC Flash API is within the SoC limit. */
 static bool                m_module_initialized = false; /**< Flag for checking if module has been initialized. */
 static swap_backup_state_t m_swap_state;                 /**< Swap page state. */
+static uint8_t             m_batch_count;                /**< Number of queued updates, starting at the read pointer, that are handled in the current swap cycle. */
+static uint32_t            m_batch_cursor;               /**< Byte offset into the data page up to which it has been rewritten in the current swap cycle. */
 
 
 static pstorage_module_table_t m_app_table[PSTORAGE_MAX_APPLICATIONS]; /**< Registered application information table. */
@@ -287,6 +291,7 @@ static void cmd_queue_init(void)
 
     m_round_val              = 0;
     m_swap_state             = STATE_INIT;
+    m_batch_count            = 1;
     m_cmd_queue.rp           = 0;
     m_cmd_queue.count        = 0;
     m_cmd_queue.flash_access = false;
@@ -493,23 +498,31 @@ void pstorage_sys_event_handler(uint32_t sys_evt)
                     clear_all_finished ||
                     store_finished)
                 {
-                    uint8_t queue_rp = m_cmd_queue.rp;
+                    // All updates that shared the swap cycle are finished at once.
+                    uint8_t completed = update_finished ? m_batch_count : 1;
 
-                    m_swap_state = STATE_INIT;
+                    m_swap_state  = STATE_INIT;
+                    m_batch_count = 1;
 
                     m_round_val = 0;
-                    m_cmd_queue.count--;
-                    m_cmd_queue.rp++;
 
-                    if (m_cmd_queue.rp >= PSTORAGE_CMD_QUEUE_SIZE)
+                    while (completed--)
                     {
-                        m_cmd_queue.rp -= PSTORAGE_CMD_QUEUE_SIZE;
-                    }
+                        uint8_t queue_rp = m_cmd_queue.rp;
+
+                        m_cmd_queue.count--;
+                        m_cmd_queue.rp++;
+
+                        if (m_cmd_queue.rp >= PSTORAGE_CMD_QUEUE_SIZE)
+                        {
+                            m_cmd_queue.rp -= PSTORAGE_CMD_QUEUE_SIZE;
+                        }
 
-                    app_notify(retval, &m_cmd_queue.cmd[queue_rp]);
+                        app_notify(retval, &m_cmd_queue.cmd[queue_rp]);
 
-                    // Initialize/free the element as it is now processed.
-                    cmd_queue_element_init(queue_rp);
+                        // Initialize/free the element as it is now processed.
+                        cmd_queue_element_init(queue_rp);
+                    }
                 }
                 // Schedule any queued flash access operations.
                 retval = cmd_queue_dequeue();
@@ -715,6 +728,238 @@ static uint32_t swap_state_process(cmd_queue_element_t * p_cmd,
 }
 
 
+/**@brief Function for getting the byte offset of a queued update within its flash page.
+ *
+ * @param[in] p_cmd Queue element of the update.
+ */
+static __INLINE uint32_t update_page_offset_get(cmd_queue_element_t * p_cmd)
+{
+    return ((p_cmd->storage_addr.block_id + p_cmd->offset) % PSTORAGE_FLASH_PAGE_SIZE);
+}
+
+
+/**@brief Function for finding how many queued updates can share the swap cycle of the update at
+ *        the read pointer.
+ *
+ * @details Updates that directly follow the one at the read pointer in the queue are merged as
+ *          long as they are to the same flash page and do not overlap any update already merged.
+ *          Since only directly following updates are merged and the regions do not overlap, the
+ *          result is the same as doing the updates one by one in queue order.
+ *
+ * @retval    Number of updates, at least 1.
+ */
+static uint8_t update_batch_size_get(void)
+{
+    cmd_queue_element_t * p_first     = &m_cmd_queue.cmd[m_cmd_queue.rp];
+    uint32_t              page_number = p_first->storage_addr.block_id / PSTORAGE_FLASH_PAGE_SIZE;
+    uint8_t               count       = 1;
+
+    while (count < m_cmd_queue.count)
+    {
+        uint32_t              index = (m_cmd_queue.rp + count) % PSTORAGE_CMD_QUEUE_SIZE;
+        cmd_queue_element_t * p_cmd = &m_cmd_queue.cmd[index];
+        uint32_t              start = update_page_offset_get(p_cmd);
+        uint8_t               i;
+
+        if ((p_cmd->op_code != PSTORAGE_UPDATE_OP_CODE) ||
+            ((p_cmd->storage_addr.block_id / PSTORAGE_FLASH_PAGE_SIZE) != page_number))
+        {
+            break;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            cmd_queue_element_t * p_merged =
+                &m_cmd_queue.cmd[(m_cmd_queue.rp + i) % PSTORAGE_CMD_QUEUE_SIZE];
+            uint32_t              merged_start = update_page_offset_get(p_merged);
+
+            if ((start < merged_start + p_merged->size) && (merged_start < start + p_cmd->size))
+            {
+                break;
+            }
+        }
+        if (i != count)
+        {
+            // Overlaps an update in the batch, must wait for the next swap cycle.
+            break;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+
+/**@brief Function for checking if a flash region is erased.
+ *
+ * @param[in] p_addr     Start of the region, word aligned.
+ * @param[in] word_count Size of the region in number of words.
+ */
+static bool flash_region_is_erased(uint32_t * p_addr, uint32_t word_count)
+{
+    while (word_count--)
+    {
+        if (*p_addr++ != ERASED_WORD)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**@brief Function for writing the next piece of a page rewritten in a coalesced update.
+ *
+ * @details Writes the data of the update starting at the cursor, or else restores the backup from
+ *          swap up to the start of the next update. Restores of erased backup are skipped. The
+ *          cursor is advanced when the write is accepted by the SoftDevice.
+ *
+ * @param[in] page_addr Address of the data page.
+ *
+ * @retval    NRF_SUCCESS         if a write was started.
+ * @retval    NRF_ERROR_NOT_FOUND if the rest of the page needed no writes.
+ * @retval    Any error code returned by sd_flash_write.
+ */
+static uint32_t batch_piece_write(uint32_t page_addr)
+{
+    uint32_t retval = NRF_ERROR_NOT_FOUND;
+
+    while (m_batch_cursor < PSTORAGE_FLASH_PAGE_SIZE)
+    {
+        cmd_queue_element_t * p_write    = NULL;
+        uint32_t              next_start = PSTORAGE_FLASH_PAGE_SIZE;
+        uint8_t               i;
+
+        // Find the update starting at the cursor, or the start of the next one.
+        for (i = 0; i < m_batch_count; i++)
+        {
+            cmd_queue_element_t * p_cmd =
+                &m_cmd_queue.cmd[(m_cmd_queue.rp + i) % PSTORAGE_CMD_QUEUE_SIZE];
+            uint32_t              start = update_page_offset_get(p_cmd);
+
+            if (start == m_batch_cursor)
+            {
+                p_write = p_cmd;
+                break;
+            }
+            if ((start > m_batch_cursor) && (start < next_start))
+            {
+                next_start = start;
+            }
+        }
+
+        if (p_write != NULL)
+        {
+            // Write new data of this update.
+            retval = sd_flash_write((uint32_t *)(page_addr + m_batch_cursor),
+                                    (uint32_t *)p_write->p_data_addr,
+                                    p_write->size / sizeof(uint32_t));
+            if (retval == NRF_SUCCESS)
+            {
+                m_batch_cursor += p_write->size;
+            }
+            break;
+        }
+
+        if (flash_region_is_erased((uint32_t *)(PSTORAGE_SWAP_ADDR + m_batch_cursor),
+                                   (next_start - m_batch_cursor) / sizeof(uint32_t)))
+        {
+            // Nothing to restore, the page is already erased here.
+            m_batch_cursor = next_start;
+            continue;
+        }
+
+        // Restore the old content up to the next update from swap.
+        retval = sd_flash_write((uint32_t *)(page_addr + m_batch_cursor),
+                                (uint32_t *)(PSTORAGE_SWAP_ADDR + m_batch_cursor),
+                                (next_start - m_batch_cursor) / sizeof(uint32_t));
+        if (retval == NRF_SUCCESS)
+        {
+            m_batch_cursor = next_start;
+        }
+        break;
+    }
+
+    return retval;
+}
+
+
+/** @brief Function for doing several updates to one flash page in a single swap cycle.
+ *
+ * @details The page is backed up to swap and erased once, then rewritten in address order, each
+ *          piece either from the data of one of the updates or from the backup in swap. Pieces of
+ *          the backup that are erased are skipped. Compared to one swap cycle per update, this
+ *          saves two page erases for each update merged.
+ *
+ * @param[in] page_number The affected page number.
+ *
+ * @retval    NRF_SUCCESS    on success, else an error code indicating reason for failure.
+ */
+static uint32_t swap_batch_process(uint32_t page_number)
+{
+    uint32_t retval    = NRF_ERROR_INTERNAL;
+    uint32_t page_addr = page_number * PSTORAGE_FLASH_PAGE_SIZE;
+
+    if (m_swap_state == STATE_INIT)
+    {
+        m_swap_state = STATE_DATA_TO_SWAP_WRITE;
+    }
+
+    switch (m_swap_state)
+    {
+        case STATE_DATA_TO_SWAP_WRITE:
+            // Backup previous content into swap page.
+            retval = sd_flash_write((uint32_t *)(PSTORAGE_SWAP_ADDR),
+                                    (uint32_t *)page_addr,
+                                    PSTORAGE_FLASH_PAGE_SIZE / sizeof(uint32_t));
+            if (retval == NRF_SUCCESS)
+            {
+                m_swap_state = STATE_DATA_ERASE;
+            }
+            break;
+
+        case STATE_DATA_ERASE:
+            // Clear the application data page.
+            retval = sd_flash_page_erase(page_number);
+            if (retval == NRF_SUCCESS)
+            {
+                m_batch_cursor = 0;
+                m_swap_state   = STATE_BATCH_WRITE;
+            }
+            break;
+
+        case STATE_BATCH_WRITE:
+            retval = batch_piece_write(page_addr);
+            if (retval != NRF_ERROR_NOT_FOUND)
+            {
+                if (m_batch_cursor == PSTORAGE_FLASH_PAGE_SIZE)
+                {
+                    m_swap_state = STATE_SWAP_ERASE;
+                }
+                break;
+            }
+
+            // The rest of the backup is erased, go straight on to erasing the swap.
+            m_swap_state = STATE_SWAP_ERASE;
+            // Fall through.
+
+        case STATE_SWAP_ERASE:
+            // Clear the swap page for subsequent use.
+            retval = sd_flash_page_erase(PSTORAGE_SWAP_ADDR / PSTORAGE_FLASH_PAGE_SIZE);
+            if (retval == NRF_SUCCESS)
+            {
+                m_swap_state = STATE_COMPLETE;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return retval;
+}
+
+
 /**
  * @brief Routine called to actually issue the flash access request to the SoftDevice.
  *
@@ -809,17 +1054,30 @@ static uint32_t cmd_process(void)
         {
             uint32_t page_number = (storage_addr / PSTORAGE_FLASH_PAGE_SIZE);
 
-            uint32_t head_word_size = (
-                storage_addr + p_cmd->offset -
-                (page_number * PSTORAGE_FLASH_PAGE_SIZE)
-                ) / sizeof(uint32_t);
+            if (m_swap_state == STATE_INIT)
+            {
+                // Merge the following updates to the same page into this swap cycle.
+                m_batch_count = update_batch_size_get();
+            }
 
-            uint32_t tail_word_size = (
-                ((page_number + 1) * PSTORAGE_FLASH_PAGE_SIZE) -
-                (storage_addr + p_cmd->offset + p_cmd->size)
-                ) / sizeof(uint32_t);
+            if (m_batch_count > 1)
+            {
+                retval = swap_batch_process(page_number);
+            }
+            else
+            {
+                uint32_t head_word_size = (
+                    storage_addr + p_cmd->offset -
+                    (page_number * PSTORAGE_FLASH_PAGE_SIZE)
+                    ) / sizeof(uint32_t);
+
+                uint32_t tail_word_size = (
+                    ((page_number + 1) * PSTORAGE_FLASH_PAGE_SIZE) -
+                    (storage_addr + p_cmd->offset + p_cmd->size)
+                    ) / sizeof(uint32_t);
 
-            retval = swap_state_process(p_cmd, page_number, head_word_size, tail_word_size);
+                retval = swap_state_process(p_cmd, page_number, head_word_size, tail_word_size);
+            }
         }
         break;
 
@@ -1076,6 +1334,156 @@ uint32_t pstorage_clear(pstorage_handle_t * p_dest, pstorage_size_t size)
 }
 
 
+/**@brief Function for finding the slot the next log record of a block is to be written to.
+ *
+ * @details Starts from the first erased slot in flash, and then accounts for the log stores and
+ *          clears of the block that are still in the command queue.
+ *
+ * @param[in] p_block     Block of the log.
+ * @param[in] record_size Size of one record.
+ *
+ * @return    Index of the next slot, equal to the number of slots if the block is full.
+ */
+static uint32_t log_next_slot_get(pstorage_handle_t * p_block, pstorage_size_t record_size)
+{
+    uint32_t slot_count = MODULE_BLOCK_SIZE(p_block) / record_size;
+    uint32_t next_slot  = 0;
+    uint32_t index;
+
+    // Records are only ever appended, so the first erased slot follows the last written one.
+    while ((next_slot < slot_count) &&
+           !flash_region_is_erased((uint32_t *)(p_block->block_id + next_slot * record_size),
+                                   record_size / sizeof(uint32_t)))
+    {
+        next_slot++;
+    }
+
+    for (index = 0; index < m_cmd_queue.count; index++)
+    {
+        cmd_queue_element_t * p_cmd =
+            &m_cmd_queue.cmd[(m_cmd_queue.rp + index) % PSTORAGE_CMD_QUEUE_SIZE];
+
+        if ((p_cmd->storage_addr.module_id != p_block->module_id) ||
+            (p_cmd->storage_addr.block_id != p_block->block_id))
+        {
+            continue;
+        }
+
+        if (p_cmd->op_code == PSTORAGE_CLEAR_OP_CODE)
+        {
+            next_slot = 0;
+        }
+        else if ((p_cmd->op_code == PSTORAGE_STORE_OP_CODE) &&
+                 (p_cmd->offset / record_size >= next_slot))
+        {
+            next_slot = p_cmd->offset / record_size + 1;
+        }
+    }
+
+    return next_slot;
+}
+
+
+uint32_t pstorage_log_append(pstorage_handle_t * p_dest,
+                             uint8_t           * p_src,
+                             pstorage_size_t     size)
+{
+    uint32_t slot;
+
+    VERIFY_MODULE_INITIALIZED();
+    NULL_PARAM_CHECK(p_src);
+    NULL_PARAM_CHECK(p_dest);
+    MODULE_ID_RANGE_CHECK(p_dest);
+    BLOCK_ID_RANGE_CHECK(p_dest);
+    SIZE_CHECK(p_dest, size);
+
+    if ((size < 2 * sizeof(uint32_t)) || ((size % sizeof(uint32_t)) != 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // Verify word alignment.
+    if ((!is_word_aligned(p_src)) || (!is_word_aligned((uint32_t *)p_dest->block_id)))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    // The marker is the last word written, so a record cut short by a reset is never valid.
+    ((uint32_t *)p_src)[(size / sizeof(uint32_t)) - 1] = PSTORAGE_LOG_MARKER;
+
+    slot = log_next_slot_get(p_dest, size);
+    if (slot == MODULE_BLOCK_SIZE(p_dest) / size)
+    {
+        uint32_t retval;
+
+        // The block is full, start over from its first slot.
+        if ((PSTORAGE_CMD_QUEUE_SIZE - m_cmd_queue.count) < 2)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+
+        retval = cmd_queue_enqueue(PSTORAGE_CLEAR_OP_CODE, p_dest, NULL, MODULE_BLOCK_SIZE(p_dest), 0);
+        if (retval != NRF_SUCCESS)
+        {
+            return retval;
+        }
+        slot = 0;
+    }
+
+    return cmd_queue_enqueue(PSTORAGE_STORE_OP_CODE, p_dest, p_src, size, slot * size);
+}
+
+
+uint32_t pstorage_log_load(uint8_t           * p_dest,
+                           pstorage_handle_t * p_src,
+                           pstorage_size_t     size)
+{
+    uint32_t   slot_count;
+    uint32_t   slot;
+    uint8_t  * p_latest = NULL;
+
+    VERIFY_MODULE_INITIALIZED();
+    NULL_PARAM_CHECK(p_src);
+    NULL_PARAM_CHECK(p_dest);
+    MODULE_ID_RANGE_CHECK(p_src);
+    BLOCK_ID_RANGE_CHECK(p_src);
+    SIZE_CHECK(p_src, size);
+
+    if ((size < 2 * sizeof(uint32_t)) || ((size % sizeof(uint32_t)) != 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // Verify word alignment.
+    if ((!is_word_aligned(p_dest)) || (!is_word_aligned((uint32_t *)p_src->block_id)))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    slot_count = MODULE_BLOCK_SIZE(p_src) / size;
+    for (slot = 0; slot < slot_count; slot++)
+    {
+        uint8_t * p_record = (uint8_t *)p_src->block_id + slot * size;
+
+        if (((uint32_t *)p_record)[(size / sizeof(uint32_t)) - 1] == PSTORAGE_LOG_MARKER)
+        {
+            p_latest = p_record;
+        }
+    }
+
+    if (p_latest == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    memcpy(p_dest, p_latest, size);
+
+    m_app_table[p_src->module_id].cb(p_src, PSTORAGE_LOAD_OP_CODE, NRF_SUCCESS, p_dest, size);
+
+    return NRF_SUCCESS;
+}
+
+
 uint32_t pstorage_access_status_get(uint32_t * p_count)
 {
     VERIFY_MODULE_INITIALIZED();
@@ -46,6 +46,8 @@
 
 /**@} */
 
+#define PSTORAGE_LOG_MARKER       0x474C5350  /**< Value written to the last word of each record by @ref pstorage_log_append to mark it as complete. */
+
 /**@defgroup pstorage_data_types Persistent Memory Interface Data Types
  * @{
  * @brief Data Types needed for interfacing with persistent memory.
@@ -223,12 +225,65 @@ uint32_t pstorage_store(pstorage_handle_t * p_dest,
  *             to flash cannot be freed or reused by the application until this procedure
  *             is complete. End of this procedure is notified to the application using the
  *             notification callback registered by the application.
+ *
+ * @note       Updates that are queued back to back for the same flash page, and do not overlap,
+ *             are done in one swap cycle, with one erase of the data page and of the swap page
+ *             in total. A larger PSTORAGE_CMD_QUEUE_SIZE lets more of a burst of updates share
+ *             the cycle.
  */
 uint32_t pstorage_update(pstorage_handle_t * p_dest,
                          uint8_t *           p_src,
                          pstorage_size_t     size,
                          pstorage_size_t     offset);
 
+/**@brief Routine to append a record to a block used as a log.
+ *
+ * @details The block is split in slots of 'size' bytes, and each record is stored in the next
+ *          erased slot without touching the rest of the flash page. Only when all slots are used
+ *          is the block cleared, and the record stored in the first slot. With N slots, this is
+ *          one clear for every N records, where @ref pstorage_update erases the page twice for
+ *          every record. Use @ref pstorage_log_load to read back the last record appended.
+ *
+ * @param[in]  p_dest Block used as a log. Use the same record size for all records in the block.
+ * @param[in]  p_src  Source address containing the record. API assumes this to be resident
+ *                    memory and no intermediate copy of data is made by the API. The last word of
+ *                    the record is reserved, the module sets it to @ref PSTORAGE_LOG_MARKER.
+ * @param[in]  size   Size of the record in bytes, including the marker word. Should be word
+ *                    aligned, at least 8 bytes and not larger than the block.
+ *
+ * @retval     NRF_SUCCESS             on success, else an error code indicating reason for failure.
+ * @retval     NRF_ERROR_INVALID_STATE is returned is API is called without module initialization.
+ * @retval     NRF_ERROR_NULL          if NULL parameter has been passed.
+ * @retval     NRF_ERROR_INVALID_PARAM if invalid parameters are passed to the API.
+ * @retval     NRF_ERROR_INVALID_ADDR  in case data address 'p_src' is not aligned.
+ * @retval     NRF_ERROR_NO_MEM        in case request cannot be processed.
+ *
+ * @note       The record is stored with a store operation, and the application is notified with
+ *             @ref PSTORAGE_STORE_OP_CODE. When the block is full, a clear operation of the block
+ *             is queued first, and notified with @ref PSTORAGE_CLEAR_OP_CODE. A reset between the
+ *             two leaves the block without records.
+ */
+uint32_t pstorage_log_append(pstorage_handle_t * p_dest,
+                             uint8_t *           p_src,
+                             pstorage_size_t     size);
+
+/**@brief Routine to load the last record appended to a block used as a log.
+ *
+ * @param[in]  p_dest Destination address where the record is to be loaded.
+ * @param[in]  p_src  Block used as a log.
+ * @param[in]  size   Size of the records in the block, as passed to @ref pstorage_log_append.
+ *
+ * @retval     NRF_SUCCESS             on success, else an error code indicating reason for failure.
+ * @retval     NRF_ERROR_INVALID_STATE is returned is API is called without module initialization.
+ * @retval     NRF_ERROR_NULL          if NULL parameter has been passed.
+ * @retval     NRF_ERROR_INVALID_PARAM if invalid parameters are passed to the API.
+ * @retval     NRF_ERROR_INVALID_ADDR  in case data address 'p_dest' is not aligned.
+ * @retval     NRF_ERROR_NOT_FOUND     if no complete record has been stored in the block.
+ */
+uint32_t pstorage_log_load(uint8_t *           p_dest,
+                           pstorage_handle_t * p_src,
+                           pstorage_size_t     size);
+
 /**@brief Routine to load persistently stored data of length 'size' from 'p_src' address
  *        to 'p_dest' address; Equivalent to Storage Read.
  *
@@ -291,6 +346,43 @@ uint32_t pstorage_clear(pstorage_handle_t * p_base_id, pstorage_size_t size);
  */
 uint32_t pstorage_access_status_get(uint32_t * p_count);
 
+#ifdef PSTORAGE_RAW_MODE_ENABLE
+
+/**
+ * @brief Function for registering with the persistent storage interface in raw mode, where the
+ *        handle's block identifier is a flash address outside the pstorage data area.
+ *
+ * @param[in]  p_module_param Module registration parameter, only the callback is used.
+ * @param[out] p_block_id     Handle to use with the raw mode APIs, the block_id must be set to
+ *                            the flash address to access.
+ *
+ * @retval     NRF_SUCCESS             on success, else an error code indicating reason for failure.
+ * @retval     NRF_ERROR_INVALID_STATE is returned is API is called without module initialization.
+ * @retval     NRF_ERROR_NULL          if NULL parameter has been passed.
+ * @retval     NRF_ERROR_NO_MEM        if a raw mode module is already registered.
+ */
+uint32_t pstorage_raw_register(pstorage_module_param_t * p_module_param,
+                               pstorage_handle_t       * p_block_id);
+
+/**
+ * @brief Raw mode function for persistently storing data at the handle's flash address.
+ *
+ * @details As @ref pstorage_store, without the checks against the module's blocks.
+ */
+uint32_t pstorage_raw_store(pstorage_handle_t * p_dest,
+                            uint8_t           * p_src,
+                            pstorage_size_t     size,
+                            pstorage_size_t     offset);
+
+/**
+ * @brief Raw mode function for erasing the flash pages from the handle's flash address.
+ *
+ * @details As @ref pstorage_clear, erasing every page the size reaches into.
+ */
+uint32_t pstorage_raw_clear(pstorage_handle_t * p_dest, pstorage_size_t size);
+
+#endif // PSTORAGE_RAW_MODE_ENABLE
+
 /**@} */
 /**@} */
 
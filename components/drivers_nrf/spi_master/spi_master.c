@@ -36,6 +36,7 @@ typedef struct
     uint16_t max_length;        /**< Max length (Max of the TX and RX length). */
     uint16_t bytes_count;
     uint8_t pin_slave_select;   /**< A pin for Slave Select. */
+    uint8_t pin_ss_active;      /**< Slave Select pin of the transfer in progress, or held asserted. */
 
     spi_master_event_handler_t callback_event_handler;  /**< A handler for event callback function. */
 
@@ -43,6 +44,13 @@ typedef struct
     bool started_flag;
     bool disable_all_irq;
 
+    spi_master_xfer_t xfer_queue[SPI_MASTER_QUEUE_SIZE]; /**< Queued transactions, the one in progress first. */
+    uint8_t xfer_head;          /**< Index of the first queued transaction. */
+    uint8_t xfer_count;         /**< Number of queued transactions. */
+    uint8_t xfer_prefetched;    /**< Number of bytes of the next queued transaction already in TXD. */
+    bool xfer_active;           /**< The transfer in progress is the first queued transaction. */
+    bool ss_held;               /**< Slave Select left asserted by the previous transaction. */
+
 } spi_master_instance_t;
 
 #define _static static
@@ -128,12 +136,57 @@ static __INLINE void spi_master_init_hw_instance(NRF_SPI_Type *
     p_spi_instance->bytes_count      = 0;
     p_spi_instance->max_length       = 0;
     p_spi_instance->pin_slave_select = 0;
+    p_spi_instance->pin_ss_active    = 0;
 
     p_spi_instance->callback_event_handler = NULL;
 
     p_spi_instance->state           = SPI_MASTER_STATE_DISABLED;
     p_spi_instance->started_flag    = false;
     p_spi_instance->disable_all_irq = disable_all_irq;
+
+    p_spi_instance->xfer_head       = 0;
+    p_spi_instance->xfer_count      = 0;
+    p_spi_instance->xfer_prefetched = 0;
+    p_spi_instance->xfer_active     = false;
+    p_spi_instance->ss_held         = false;
+}
+
+/**
+ * @brief Function for disabling the interrupts the instance is accessed from.
+ */
+static __INLINE void spi_master_irq_lock(volatile spi_master_instance_t * const p_spi_instance,
+                                         uint8_t * const                        p_nested)
+{
+    //Check if disable all IRQs flag is set
+    if (p_spi_instance->disable_all_irq)
+    {
+        //Disable interrupts.
+        APP_ERROR_CHECK(sd_nvic_critical_region_enter(p_nested));
+    }
+    else
+    {
+        //Disable interrupt SPI.
+        APP_ERROR_CHECK(sd_nvic_DisableIRQ(p_spi_instance->irq_type));
+    }
+}
+
+/**
+ * @brief Function for enabling the interrupts disabled by @ref spi_master_irq_lock.
+ */
+static __INLINE void spi_master_irq_unlock(volatile spi_master_instance_t * const p_spi_instance,
+                                           uint8_t                                nested)
+{
+    //Check if disable all IRQs flag is set.
+    if (p_spi_instance->disable_all_irq)
+    {
+        //Enable interrupts.
+        APP_ERROR_CHECK(sd_nvic_critical_region_exit(nested));
+    }
+    else
+    {
+        //Enable SPI interrupt.
+        APP_ERROR_CHECK(sd_nvic_EnableIRQ(p_spi_instance->irq_type));
+    }
 }
 
 /**
@@ -185,6 +238,28 @@ static __INLINE void spi_master_signal_evt(volatile spi_master_instance_t * cons
     }
 }
 
+/**
+ * @brief Function for loading the next byte of the transfer in progress to TXD, if any is left.
+ *
+ * @retval true     A byte has been loaded.
+ * @retval false    All bytes of the transfer have been loaded already.
+ */
+static __INLINE bool spi_master_tx_byte_load(volatile spi_master_instance_t * const p_spi_instance)
+{
+    uint8_t * p_tx_buffer = p_spi_instance->p_tx_buffer;
+    uint16_t tx_length    = p_spi_instance->tx_length;
+    uint16_t tx_index     = p_spi_instance->tx_index;
+
+    if (tx_index < p_spi_instance->max_length)
+    {
+        p_spi_instance->p_nrf_spi->TXD = ((p_tx_buffer != NULL) && (tx_index < tx_length)) ?
+                                         p_tx_buffer[tx_index] : SPI_DEFAULT_TX_BYTE;
+        (p_spi_instance->tx_index)++;
+        return true;
+    }
+    return false;
+}
+
 /**
  * @brief Function insert to a TX buffer another byte or two bytes (depends on flag @ref DOUBLE_BUFFERED).
  */
@@ -209,6 +284,132 @@ static __INLINE void spi_master_send_initial_bytes(
     }
 }
 
+/**
+ * @brief Function for getting the Slave Select pin of a queued transaction.
+ */
+static __INLINE uint8_t spi_master_xfer_ss_pin(volatile spi_master_instance_t * const p_spi_instance,
+                                               uint8_t                                index)
+{
+    uint32_t pin = p_spi_instance->xfer_queue[index].pin_slave_select;
+
+    return (pin == SPI_PIN_DISCONNECTED) ? p_spi_instance->pin_slave_select : (uint8_t)pin;
+}
+
+/**
+ * @brief Function for loading the first byte of the next queued transaction behind the last
+ *        byte of the one in progress, if they form one transaction on the bus.
+ */
+static __INLINE void spi_master_xfer_prefetch(volatile spi_master_instance_t * const p_spi_instance)
+{
+    uint8_t head = p_spi_instance->xfer_head;
+    uint8_t next = (uint8_t)((head + 1) % SPI_MASTER_QUEUE_SIZE);
+
+    if (!p_spi_instance->xfer_active || (p_spi_instance->xfer_prefetched != 0) ||
+        (p_spi_instance->xfer_count < 2) ||
+        ((p_spi_instance->xfer_queue[head].flags & SPI_MASTER_XFER_FLAG_HOLD_SS) == 0) ||
+        (spi_master_xfer_ss_pin(p_spi_instance, next) != p_spi_instance->pin_ss_active))
+    {
+        return;
+    }
+
+    uint8_t * p_tx_buf = p_spi_instance->xfer_queue[next].p_tx_buf;
+
+    p_spi_instance->p_nrf_spi->TXD =
+        ((p_tx_buf != NULL) && (p_spi_instance->xfer_queue[next].tx_buf_len > 0)) ?
+        p_tx_buf[0] : SPI_DEFAULT_TX_BYTE;
+    p_spi_instance->xfer_prefetched = 1;
+}
+
+/**
+ * @brief Function for starting the first queued transaction.
+ *
+ * @param[in] prefetched    Number of bytes of the transaction already loaded in TXD.
+ */
+static __INLINE void spi_master_xfer_start(volatile spi_master_instance_t * const p_spi_instance,
+                                           uint8_t                                prefetched)
+{
+    uint8_t  head     = p_spi_instance->xfer_head;
+    uint8_t  ss_pin   = spi_master_xfer_ss_pin(p_spi_instance, head);
+    uint16_t tx_len   = p_spi_instance->xfer_queue[head].tx_buf_len;
+    uint16_t rx_len   = p_spi_instance->xfer_queue[head].rx_buf_len;
+
+    if (p_spi_instance->ss_held && (ss_pin != p_spi_instance->pin_ss_active))
+    {
+        nrf_gpio_pin_set(p_spi_instance->pin_ss_active);
+    }
+    p_spi_instance->ss_held = false;
+
+    p_spi_instance->state         = SPI_MASTER_STATE_BUSY;
+    p_spi_instance->bytes_count   = 0;
+    p_spi_instance->started_flag  = true; //Queued transactions don't generate events.
+    p_spi_instance->max_length    = (rx_len > tx_len) ? rx_len : tx_len;
+    p_spi_instance->pin_ss_active = ss_pin;
+    p_spi_instance->xfer_active   = true;
+
+    spi_master_buffer_init(p_spi_instance->xfer_queue[head].p_tx_buf,
+                           tx_len,
+                           &(p_spi_instance->p_tx_buffer),
+                           &(p_spi_instance->tx_length),
+                           &(p_spi_instance->tx_index));
+    spi_master_buffer_init(p_spi_instance->xfer_queue[head].p_rx_buf,
+                           rx_len,
+                           &(p_spi_instance->p_rx_buffer),
+                           &(p_spi_instance->rx_length),
+                           &(p_spi_instance->rx_index));
+
+    nrf_gpio_pin_clear(ss_pin);
+
+    if (prefetched == 0)
+    {
+        spi_master_send_initial_bytes(p_spi_instance);
+    }
+    else
+    {
+        //The first byte is shifting out already, keep TXD filled behind it.
+        p_spi_instance->tx_index = prefetched;
+        spi_master_tx_byte_load(p_spi_instance);
+    }
+}
+
+/**
+ * @brief Function for completing the first queued transaction, and starting the next one.
+ */
+static __INLINE void spi_master_xfer_complete(volatile spi_master_instance_t * const p_spi_instance)
+{
+    uint8_t                   head       = p_spi_instance->xfer_head;
+    spi_master_xfer_handler_t handler    = p_spi_instance->xfer_queue[head].handler;
+    void *                    p_context  = p_spi_instance->xfer_queue[head].p_context;
+    bool                      hold_ss    = ((p_spi_instance->xfer_queue[head].flags &
+                                             SPI_MASTER_XFER_FLAG_HOLD_SS) != 0);
+    uint8_t                   prefetched = p_spi_instance->xfer_prefetched;
+
+    p_spi_instance->xfer_head       = (uint8_t)((head + 1) % SPI_MASTER_QUEUE_SIZE);
+    p_spi_instance->xfer_count--;
+    p_spi_instance->xfer_prefetched = 0;
+
+    if (!hold_ss)
+    {
+        nrf_gpio_pin_set(p_spi_instance->pin_ss_active);
+    }
+    p_spi_instance->ss_held = hold_ss;
+
+    //The next transaction is started before the handler runs, so the bus doesn't wait for it.
+    if (p_spi_instance->xfer_count > 0)
+    {
+        spi_master_xfer_start(p_spi_instance, prefetched);
+    }
+    else
+    {
+        p_spi_instance->xfer_active = false;
+        p_spi_instance->state       = SPI_MASTER_STATE_IDLE;
+    }
+
+    if (handler != NULL)
+    {
+        handler(p_context);
+    }
+}
+
 /**
  * @brief Function for receiving and sending data from IRQ. (The same for both IRQs).
  */
@@ -237,30 +438,36 @@ static __INLINE void spi_master_send_recv_irq(volatile spi_master_instance_t * c
         p_rx_buffer[p_spi_instance->rx_index++] = rx_byte;
     }
     
-    uint8_t * p_tx_buffer = p_spi_instance->p_tx_buffer;
-    uint16_t tx_length    = p_spi_instance->tx_length;
-    uint16_t tx_index     = p_spi_instance->tx_index;
-    uint16_t max_length   = p_spi_instance->max_length;
-    
-    if (tx_index < max_length)
+    if (!spi_master_tx_byte_load(p_spi_instance))
     {
-        p_spi_instance->p_nrf_spi->TXD = ((p_tx_buffer != NULL) && (tx_index < tx_length)) ?
-                                         p_tx_buffer[tx_index] : SPI_DEFAULT_TX_BYTE;
-        (p_spi_instance->tx_index)++;
+        spi_master_xfer_prefetch(p_spi_instance);
     }
     
-    if (p_spi_instance->bytes_count >= max_length)
+    if (p_spi_instance->bytes_count >= p_spi_instance->max_length)
     {
-        nrf_gpio_pin_set(p_spi_instance->pin_slave_select);
-
         uint16_t transmited_bytes = p_spi_instance->tx_index;
 
         spi_master_buffer_release(&(p_spi_instance->p_tx_buffer), &(p_spi_instance->tx_length));
         spi_master_buffer_release(&(p_spi_instance->p_rx_buffer), &(p_spi_instance->rx_length));
 
+        if (p_spi_instance->xfer_active)
+        {
+            spi_master_xfer_complete(p_spi_instance);
+            return;
+        }
+
+        nrf_gpio_pin_set(p_spi_instance->pin_ss_active);
+
         p_spi_instance->state = SPI_MASTER_STATE_IDLE;
 
         spi_master_signal_evt(p_spi_instance, SPI_MASTER_EVT_TRANSFER_COMPLETED, transmited_bytes);
+
+        //Transactions queued during the transfer are started, unless the event handler started
+        //another transfer.
+        if ((p_spi_instance->state == SPI_MASTER_STATE_IDLE) && (p_spi_instance->xfer_count > 0))
+        {
+            spi_master_xfer_start(p_spi_instance, 0);
+        }
     }
 }
 #endif //defined(SPI_MASTER_0_ENABLE) || defined(SPI_MASTER_1_ENABLE)
@@ -361,6 +568,10 @@ void spi_master_close(const spi_master_hw_instance_t spi_master_hw_instance)
     p_spi_instance->p_nrf_spi->ENABLE = (SPI_ENABLE_ENABLE_Disabled << SPI_ENABLE_ENABLE_Pos);
 
     /* Set Slave Select pin as input with pull-up. */
+    if (p_spi_instance->ss_held)
+    {
+        nrf_gpio_pin_set(p_spi_instance->pin_ss_active);
+    }
     nrf_gpio_pin_set(p_spi_instance->pin_slave_select);
     nrf_gpio_cfg_input(p_spi_instance->pin_slave_select, NRF_GPIO_PIN_PULLUP);
     p_spi_instance->pin_slave_select = (uint8_t)0xFF;
@@ -420,17 +631,7 @@ uint32_t spi_master_send_recv(const spi_master_hw_instance_t spi_master_hw_insta
     
     uint8_t nested_critical_region = 0;
     
-    //Check if disable all IRQs flag is set
-    if (p_spi_instance->disable_all_irq)
-    {
-        //Disable interrupts.
-        APP_ERROR_CHECK(sd_nvic_critical_region_enter(&nested_critical_region));
-    }
-    else
-    {
-        //Disable interrupt SPI.
-        APP_ERROR_CHECK(sd_nvic_DisableIRQ(p_spi_instance->irq_type));
-    }
+    spi_master_irq_lock(p_spi_instance, &nested_critical_region);
 
     //Initialize and perform data transfer
     if (p_spi_instance->state == SPI_MASTER_STATE_IDLE)
@@ -456,6 +657,13 @@ uint32_t spi_master_send_recv(const spi_master_hw_instance_t spi_master_hw_insta
                                    &(p_spi_instance->rx_length),
                                    &(p_spi_instance->rx_index));
 
+            if (p_spi_instance->ss_held)
+            {
+                nrf_gpio_pin_set(p_spi_instance->pin_ss_active);
+                p_spi_instance->ss_held = false;
+            }
+            p_spi_instance->pin_ss_active = p_spi_instance->pin_slave_select;
+
             nrf_gpio_pin_clear(p_spi_instance->pin_slave_select);
             spi_master_send_initial_bytes(p_spi_instance);
         }
@@ -469,18 +677,61 @@ uint32_t spi_master_send_recv(const spi_master_hw_instance_t spi_master_hw_insta
         err_code = NRF_ERROR_BUSY;
     }
     
-    //Check if disable all IRQs flag is set.
-    if (p_spi_instance->disable_all_irq)
-    {   
-        //Enable interrupts.
-        APP_ERROR_CHECK(sd_nvic_critical_region_exit(nested_critical_region));
+    spi_master_irq_unlock(p_spi_instance, nested_critical_region);
+
+    return err_code;
+    #else
+    return NRF_ERROR_NOT_SUPPORTED;
+    #endif
+}
+
+uint32_t spi_master_xfer_schedule(const spi_master_hw_instance_t  spi_master_hw_instance,
+                                  spi_master_xfer_t const * const p_xfer)
+{
+    #if defined(SPI_MASTER_0_ENABLE) || defined(SPI_MASTER_1_ENABLE)
+
+    if (p_xfer == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if ((p_xfer->tx_buf_len == 0) && (p_xfer->rx_buf_len == 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    volatile spi_master_instance_t * p_spi_instance = spi_master_get_instance(
+        spi_master_hw_instance);
+    APP_ERROR_CHECK_BOOL(p_spi_instance != NULL);
+
+    uint32_t err_code               = NRF_SUCCESS;
+    uint8_t  nested_critical_region = 0;
+
+    spi_master_irq_lock(p_spi_instance, &nested_critical_region);
+
+    if (p_spi_instance->state == SPI_MASTER_STATE_DISABLED)
+    {
+        err_code = NRF_ERROR_INVALID_STATE;
+    }
+    else if (p_spi_instance->xfer_count >= SPI_MASTER_QUEUE_SIZE)
+    {
+        err_code = NRF_ERROR_NO_MEM;
     }
     else
     {
-        //Enable SPI interrupt.
-        APP_ERROR_CHECK(sd_nvic_EnableIRQ(p_spi_instance->irq_type));
+        uint8_t index = (uint8_t)((p_spi_instance->xfer_head + p_spi_instance->xfer_count) %
+                                  SPI_MASTER_QUEUE_SIZE);
+
+        p_spi_instance->xfer_queue[index] = *p_xfer;
+        p_spi_instance->xfer_count++;
+
+        if (p_spi_instance->state == SPI_MASTER_STATE_IDLE)
+        {
+            spi_master_xfer_start(p_spi_instance, 0);
+        }
     }
 
+    spi_master_irq_unlock(p_spi_instance, nested_critical_region);
+
     return err_code;
     #else
     return NRF_ERROR_NOT_SUPPORTED;
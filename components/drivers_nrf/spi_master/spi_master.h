@@ -35,6 +35,13 @@
 #define SPI_DEFAULT_TX_BYTE  0x00       /**< Default byte (used to clock transmission
                                              from slave to the master) */
 
+#ifndef SPI_MASTER_QUEUE_SIZE
+#define SPI_MASTER_QUEUE_SIZE 4         /**< Number of transactions that can be queued per instance. */
+#endif
+
+#define SPI_MASTER_XFER_FLAG_HOLD_SS 0x01 /**< Leave slave select asserted when the transaction is done,
+                                               so that the next queued transaction continues it. */
+
 /**@brief Macro for initializing SPI master by default values. */
 #define SPI_MASTER_INIT_DEFAULT                                             \
 {                                                                           \
@@ -109,6 +116,26 @@ typedef enum
 typedef void (*spi_master_event_handler_t)(spi_master_evt_t spi_master_evt);
 
 
+/**@brief Type of the handler called when a queued transaction has been completed.
+ *
+ * @param[in] p_context    Context given in the transaction descriptor.
+ */
+typedef void (*spi_master_xfer_handler_t)(void * p_context);
+
+/**@brief Struct describing a transaction for @ref spi_master_xfer_schedule. */
+typedef struct
+{
+    uint8_t *                 p_tx_buf;         /**< Pointer to a transmit buffer, NULL to send SPI_DEFAULT_TX_BYTE only. */
+    uint8_t *                 p_rx_buf;         /**< Pointer to a receive buffer, NULL to discard the received data. */
+    uint16_t                  tx_buf_len;       /**< Number of octets to transmit. */
+    uint16_t                  rx_buf_len;       /**< Number of octets to receive. */
+    uint32_t                  pin_slave_select; /**< Slave select pin of the transaction, SPI_PIN_DISCONNECTED for the one given to @ref spi_master_open. Other pins must be configured as outputs, and set, by the application. */
+    uint8_t                   flags;            /**< Transaction flags, see @ref SPI_MASTER_XFER_FLAG_HOLD_SS. */
+    spi_master_xfer_handler_t handler;          /**< Handler called from the SPI interrupt when the transaction is done. Can be NULL. */
+    void *                    p_context;        /**< Context passed to the handler. */
+} spi_master_xfer_t;
+
+
 /**@brief Function for opening and initializing a SPI master driver.
  * @note  Function initializes SPI master hardware and internal module states, unregister events callback.
  *
@@ -174,6 +201,33 @@ void spi_master_evt_handler_reg(const spi_master_hw_instance_t spi_master_hw_ins
                                 spi_master_event_handler_t     event_handler);
 
 
+/**@brief Function for scheduling a transaction on the transaction queue of a SPI master.
+ *
+ * @details Queued transactions are started one after the other from the SPI interrupt, without
+ *          waiting for the application in between, and each one reports its completion to its
+ *          own handler. The TXD register is kept double-buffered all along. A transaction with
+ *          @ref SPI_MASTER_XFER_FLAG_HOLD_SS leaves its slave select asserted, and the first byte
+ *          of the next queued transaction on the same slave select pin is loaded behind its last
+ *          byte, so that the two run without an idle gap on the bus.
+ *
+ * @note  Queued transactions do not generate @ref SPI_MASTER_EVT_TRANSFER_STARTED and
+ *        @ref SPI_MASTER_EVT_TRANSFER_COMPLETED events, and @ref spi_master_send_recv returns
+ *        NRF_ERROR_BUSY until the queue is empty. The transaction descriptor is copied, the
+ *        buffers must stay valid until the handler is called.
+ *
+ * @param[in] spi_master_hw_instance    Instance of SPI master module.
+ * @param[in] p_xfer                    Pointer to the transaction descriptor.
+ *
+ * @retval NRF_SUCCESS                Operation success. The transaction is queued or started.
+ * @retval NRF_ERROR_NULL             Operation failure. NULL pointer supplied.
+ * @retval NRF_ERROR_INVALID_PARAM    Operation failure. Both buffer lengths are 0.
+ * @retval NRF_ERROR_INVALID_STATE    Operation failure. The SPI master is not opened.
+ * @retval NRF_ERROR_NO_MEM           Operation failure. The transaction queue is full.
+ */
+uint32_t spi_master_xfer_schedule(const spi_master_hw_instance_t  spi_master_hw_instance,
+                                  spi_master_xfer_t const * const p_xfer);
+
+
 /**@brief Function for getting current state of the SPI master driver.
  *
  * @note  Function gets current state of the SPI master driver.
@@ -40,6 +40,12 @@ static volatile uint32_t    m_spi_tx_buf_size;      /**< SPI slave TX buffer siz
 static volatile uint32_t    m_spi_rx_buf_size;      /**< SPI slave RX buffer size in bytes. */
 static volatile spi_state_t m_spi_state;            /**< SPI slave state. */
 
+static uint8_t *            mp_next_tx_buf;         /**< Queued TX buffer, armed when the current transaction completes. */
+static uint8_t *            mp_next_rx_buf;         /**< Queued RX buffer, armed when the current transaction completes. */
+static uint32_t             m_next_tx_buf_size;     /**< Queued TX buffer size in bytes. */
+static uint32_t             m_next_rx_buf_size;     /**< Queued RX buffer size in bytes. */
+static volatile bool        m_next_pending;         /**< A buffer pair has been queued with @ref spi_slave_buffers_queue. */
+
 static spi_slave_event_handler_t m_event_callback;  /**< SPI slave event callback function. */
 
 uint32_t spi_slave_evt_handler_register(spi_slave_event_handler_t event_handler)
@@ -164,7 +170,8 @@ uint32_t spi_slave_init(const spi_slave_config_t * p_spi_slave_config)
     // Enable END_ACQUIRE shortcut.        
     NRF_SPIS1->SHORTS = (SPIS_SHORTS_END_ACQUIRE_Enabled << SPIS_SHORTS_END_ACQUIRE_Pos);
     
-    m_spi_state = SPI_STATE_INIT; 
+    m_spi_state    = SPI_STATE_INIT; 
+    m_next_pending = false;
 
     // Set correct IRQ priority and clear any possible pending interrupt.
     NVIC_SetPriority(SPI1_TWI1_IRQn, SPI1_TWI1_IRQ_PRI);    
@@ -198,6 +205,8 @@ static __INLINE void state_entry_action_execute(void)
             event.evt_type  = SPI_SLAVE_BUFFERS_SET_DONE;
             event.rx_amount = 0;
             event.tx_amount = 0;     
+            event.p_tx_buf  = (uint8_t *)mp_spi_tx_buf;
+            event.p_rx_buf  = (uint8_t *)mp_spi_rx_buf;
             
             APP_ERROR_CHECK_BOOL(m_event_callback != NULL);
             m_event_callback(event);         
@@ -207,6 +216,8 @@ static __INLINE void state_entry_action_execute(void)
             event.evt_type  = SPI_SLAVE_XFER_DONE;
             event.rx_amount = NRF_SPIS1->AMOUNTRX;
             event.tx_amount = NRF_SPIS1->AMOUNTTX;
+            event.p_tx_buf  = (uint8_t *)mp_spi_tx_buf;
+            event.p_rx_buf  = (uint8_t *)mp_spi_rx_buf;
             
             APP_ERROR_CHECK_BOOL(m_event_callback != NULL);
             m_event_callback(event);
@@ -270,6 +281,83 @@ uint32_t spi_slave_buffers_set(uint8_t * p_tx_buf,
 }
 
 
+uint32_t spi_slave_buffers_queue(uint8_t * p_tx_buf, 
+                                 uint8_t * p_rx_buf, 
+                                 uint8_t   tx_buf_length, 
+                                 uint8_t   rx_buf_length)
+{
+    uint32_t err_code;
+
+    if ((p_tx_buf == NULL) || (p_rx_buf == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    CRITICAL_REGION_ENTER();
+    switch (m_spi_state)
+    {
+        case SPI_STATE_INIT:
+        case SPI_XFER_COMPLETED:
+            // No buffers armed, so these are the next ones.
+            err_code = spi_slave_buffers_set(p_tx_buf, p_rx_buf, tx_buf_length, rx_buf_length);
+            break;
+
+        case SPI_BUFFER_RESOURCE_REQUESTED:
+        case SPI_BUFFER_RESOURCE_CONFIGURED:
+            if (m_next_pending)
+            {
+                err_code = NRF_ERROR_INVALID_STATE;
+                break;
+            }
+            mp_next_tx_buf     = p_tx_buf;
+            mp_next_rx_buf     = p_rx_buf;
+            m_next_tx_buf_size = tx_buf_length;
+            m_next_rx_buf_size = rx_buf_length;
+            m_next_pending     = true;
+            err_code           = NRF_SUCCESS;
+            break;
+
+        default:
+            // @note: execution of this code path would imply internal error in the design.
+            err_code = NRF_ERROR_INTERNAL;
+            break;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+/**@brief Function for completing a transaction and arming the queued buffers in its place.
+ *
+ * @details The END_ACQUIRE shortcut has already given the semaphore to the CPU, so the acquire
+ *          task gives an ACQUIRED event right away, and the queued buffers are handed to the
+ *          SPI slave device from the interrupt handler before the application is told that the
+ *          transaction completed.
+ */
+static void queued_buffers_arm(void)
+{
+    spi_slave_evt_t event;
+
+    event.evt_type  = SPI_SLAVE_XFER_DONE;
+    event.rx_amount = NRF_SPIS1->AMOUNTRX;
+    event.tx_amount = NRF_SPIS1->AMOUNTTX;
+    event.p_tx_buf  = (uint8_t *)mp_spi_tx_buf;
+    event.p_rx_buf  = (uint8_t *)mp_spi_rx_buf;
+
+    mp_spi_tx_buf     = mp_next_tx_buf;
+    mp_spi_rx_buf     = mp_next_rx_buf;
+    m_spi_tx_buf_size = m_next_tx_buf_size;
+    m_spi_rx_buf_size = m_next_rx_buf_size;
+    m_next_pending    = false;
+
+    sm_state_change(SPI_BUFFER_RESOURCE_REQUESTED);
+
+    APP_ERROR_CHECK_BOOL(m_event_callback != NULL);
+    m_event_callback(event);
+}
+
+
 /**@brief SPI slave interrupt handler.
  *
  * SPI slave interrupt handler, which processes events generated by the SPI device.
@@ -313,7 +401,14 @@ void SPI1_TWI1_IRQHandler(void)
         switch (m_spi_state)
         {
             case SPI_BUFFER_RESOURCE_CONFIGURED:                                  
-                sm_state_change(SPI_XFER_COMPLETED);                                                             
+                if (m_next_pending)
+                {
+                    queued_buffers_arm();
+                }
+                else
+                {
+                    sm_state_change(SPI_XFER_COMPLETED);
+                }
                 break;
 
             default:
@@ -68,6 +68,8 @@ typedef struct
     spi_slave_evt_type_t evt_type;          /**< Type of event. */    
     uint32_t             rx_amount;         /**< Number of bytes received in last transaction (parameter is only valid upon @ref SPI_SLAVE_XFER_DONE event). */
     uint32_t             tx_amount;         /**< Number of bytes transmitted in last transaction (parameter is only valid upon @ref SPI_SLAVE_XFER_DONE event). */    
+    uint8_t *            p_tx_buf;          /**< TX buffer that was set, or that was used in the last transaction upon @ref SPI_SLAVE_XFER_DONE event. */
+    uint8_t *            p_rx_buf;          /**< RX buffer that was set, or that was used in the last transaction upon @ref SPI_SLAVE_XFER_DONE event. */
 } spi_slave_evt_t;
 
 /**@brief SPI slave event callback function type.
@@ -130,6 +132,36 @@ uint32_t spi_slave_buffers_set(uint8_t * p_tx_buf,
                                uint8_t   tx_buf_length, 
                                uint8_t   rx_buf_length);
 
+/**@brief Function for queueing the buffers for the next SPI transaction.
+ *
+ * Function lets the SPI slave device go from one transaction to the next without waiting for the
+ * application. While a transaction is prepared or in progress, the buffers are kept, and handed to
+ * the SPI slave device from the interrupt handler as soon as the transaction completes, before the
+ * @ref SPI_SLAVE_XFER_DONE event. A @ref SPI_SLAVE_BUFFERS_SET_DONE event follows when they are in
+ * use. The application can then queue the buffers of the completed transaction again from the
+ * event handler, and alternate between two buffer pairs. The master only gets the DEF character
+ * if it starts a transaction before the queued buffers are armed, or when no buffers are queued.
+ *
+ * If no buffers are set, the function works like @ref spi_slave_buffers_set.
+ *
+ * @note This function can be called from the callback function @ref spi_slave_event_handler_t 
+ * context.
+ *
+ * @param[in] p_tx_buf              Pointer to the TX buffer.
+ * @param[in] p_rx_buf              Pointer to the RX buffer.
+ * @param[in] tx_buf_length         Length of the TX buffer in bytes.
+ * @param[in] rx_buf_length         Length of the RX buffer in bytes. 
+ *
+ * @retval NRF_SUCCESS              Operation success.
+ * @retval NRF_ERROR_NULL           Operation failure. NULL pointer supplied.   
+ * @retval NRF_ERROR_INVALID_STATE  Operation failure. A buffer pair is already queued.
+ * @retval NRF_ERROR_INTERNAL       Operation failure. Internal error ocurred.
+ */
+uint32_t spi_slave_buffers_queue(uint8_t * p_tx_buf, 
+                                 uint8_t * p_rx_buf, 
+                                 uint8_t   tx_buf_length, 
+                                 uint8_t   rx_buf_length);
+
 /**@brief Function for changing defult pull-up configuration for CSN pin.
  *
  * In the default configuration, pull-up on the CSN pin is disabled.
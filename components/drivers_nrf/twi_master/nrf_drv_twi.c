@@ -16,6 +16,7 @@
 #include "nordic_common.h"
 #include "nrf_delay.h"
 #include "nrf_gpio.h"
+#include <string.h>
 
 /**@brief Determine how long driver will be wait for event (in blocking mode). */
 #define BUSY_LOOP_TIMEOUT   0xFFF
@@ -81,6 +82,16 @@ typedef struct
     transfer_t      transfer; /**< Transfer structure. */
 } control_block_t;
 
+/**@brief TWI transaction queue structure. */
+typedef struct
+{
+    nrf_drv_twi_xfer_t xfers[NRF_DRV_TWI_QUEUE_SIZE]; /**< Scheduled transactions. */
+    uint8_t            head;                          /**< Index of the first transaction. */
+    uint8_t            count;                         /**< Number of scheduled transactions. */
+    bool               is_active;                     /**< The first transaction has been started. */
+    bool               is_rx;                         /**< The read of the first transaction has been started. */
+} xfer_queue_t;
+
 /**@brief Macro for getting the number of elements of the array. */
 #define ARRAY_LENGTH(a) (sizeof(a) / sizeof(a[0]))
 
@@ -93,6 +104,9 @@ static volatile control_block_t           m_cb[TWI_COUNT];
 /** @brief TWI instances pointers storage. */
 static volatile nrf_drv_twi_t *           m_instances[TWI_COUNT];
 
+/** @brief Transaction queues storage. */
+static xfer_queue_t                       m_queues[TWI_COUNT];
+
 static const nrf_drv_twi_config_t m_default_config[] = {
 #if (TWI0_ENABLED == 1)
     NRF_DRV_TWI_DEFAULT_CONFIG(0),
@@ -550,6 +564,112 @@ static ret_code_t twi_transfer(nrf_drv_twi_t const * const p_instance,
 }
 
 
+/**
+ * @brief Function for removing the first transaction from the queue and calling its callback.
+ *
+ * @param[in] p_instance      TWI.
+ * @param[in] result          Result of the transaction.
+ */
+static void xfer_complete(nrf_drv_twi_t const * const p_instance, ret_code_t result)
+{
+    xfer_queue_t       * p_queue = &m_queues[p_instance->instance_id];
+    nrf_drv_twi_xfer_t   xfer    = p_queue->xfers[p_queue->head];
+
+    p_queue->head      = (p_queue->head + 1) % NRF_DRV_TWI_QUEUE_SIZE;
+    p_queue->count--;
+    p_queue->is_active = false;
+
+    if (xfer.callback != NULL)
+    {
+        xfer.callback(result, xfer.p_context);
+    }
+}
+
+
+/**
+ * @brief Function for starting the read of the first transaction, or completing it if it has
+ *        none or the write failed.
+ *
+ * @details The write leaves the transfer suspended when a read follows, so the read starts with
+ *          a repeated start.
+ *
+ * @param[in] p_instance      TWI.
+ * @param[in] error           True if the transfer that just ended failed.
+ */
+static void xfer_transfer_done(nrf_drv_twi_t const * const p_instance, bool error)
+{
+    xfer_queue_t             * p_queue = &m_queues[p_instance->instance_id];
+    nrf_drv_twi_xfer_t const * p_xfer  = &p_queue->xfers[p_queue->head];
+    ret_code_t                 err_code;
+
+    if (error)
+    {
+        xfer_complete(p_instance, NRF_ERROR_INTERNAL);
+    }
+    else if (!p_queue->is_rx && (p_xfer->rx_length > 0))
+    {
+        p_queue->is_rx = true;
+
+        err_code = twi_transfer(p_instance, p_xfer->address,
+                                p_xfer->p_rx_data, p_xfer->rx_length,
+                                false, false);
+        if (err_code != NRF_SUCCESS)
+        {
+            xfer_complete(p_instance, err_code);
+        }
+    }
+    else
+    {
+        xfer_complete(p_instance, NRF_SUCCESS);
+    }
+}
+
+
+/**
+ * @brief Function for starting scheduled transactions while the instance is free.
+ *
+ * @param[in] p_instance      TWI.
+ */
+static void xfer_queue_process(nrf_drv_twi_t const * const p_instance)
+{
+    volatile transfer_t * p_transfer = &(m_cb[p_instance->instance_id].transfer);
+    xfer_queue_t        * p_queue    = &m_queues[p_instance->instance_id];
+
+    while (!p_transfer->transfer_in_progress && !p_queue->is_active && (p_queue->count > 0))
+    {
+        nrf_drv_twi_xfer_t const * p_xfer = &p_queue->xfers[p_queue->head];
+        ret_code_t                 err_code;
+
+        p_queue->is_active = true;
+        p_queue->is_rx     = (p_xfer->tx_length == 0);
+
+        if (p_queue->is_rx)
+        {
+            err_code = twi_transfer(p_instance, p_xfer->address,
+                                    p_xfer->p_rx_data, p_xfer->rx_length,
+                                    false, false);
+        }
+        else
+        {
+            err_code = twi_transfer(p_instance, p_xfer->address,
+                                    p_xfer->p_tx_data, p_xfer->tx_length,
+                                    (p_xfer->rx_length > 0), true);
+        }
+
+        if (err_code == NRF_ERROR_BUSY)
+        {
+            // A transfer was started by the application, retry when it is done.
+            p_queue->is_active = false;
+            break;
+        }
+        else if (err_code != NRF_SUCCESS)
+        {
+            xfer_complete(p_instance, err_code);
+        }
+    }
+}
+
+
 ret_code_t nrf_drv_twi_init(nrf_drv_twi_t const * const  p_instance,
                             nrf_drv_twi_config_t const * p_config,
                             nrf_drv_twi_evt_handler_t    event_handler)
@@ -602,6 +722,9 @@ void nrf_drv_twi_uninit(nrf_drv_twi_t const * const p_instance)
     nrf_drv_twi_disable(p_instance);
     nrf_twi_shorts_clear(p_instance->p_reg, DISABLE_MASK);
 
+    // Scheduled transactions are dropped without calling their callbacks.
+    memset(&m_queues[p_instance->instance_id], 0, sizeof(xfer_queue_t));
+
     m_cb[p_instance->instance_id].state = NRF_DRV_STATE_UNINITIALIZED;
 }
 
@@ -661,6 +784,52 @@ ret_code_t nrf_drv_twi_rx(nrf_drv_twi_t const * const p_instance,
 }
 
 
+ret_code_t nrf_drv_twi_xfer_schedule(nrf_drv_twi_t const * const p_instance,
+                                     nrf_drv_twi_xfer_t const *  p_xfer)
+{
+    xfer_queue_t * p_queue  = &m_queues[p_instance->instance_id];
+    ret_code_t     err_code = NRF_SUCCESS;
+
+    if (p_xfer == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (((p_xfer->tx_length == 0) && (p_xfer->rx_length == 0)) ||
+        ((p_xfer->tx_length > 0) && (p_xfer->p_tx_data == NULL)) ||
+        ((p_xfer->rx_length > 0) && (p_xfer->p_rx_data == NULL)))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if ((m_cb[p_instance->instance_id].state != NRF_DRV_STATE_POWERED_ON) ||
+        (m_handlers[p_instance->instance_id] == NULL))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    CRITICAL_REGION_ENTER();
+    if (p_queue->count < NRF_DRV_TWI_QUEUE_SIZE)
+    {
+        p_queue->xfers[(p_queue->head + p_queue->count) % NRF_DRV_TWI_QUEUE_SIZE] = *p_xfer;
+        p_queue->count++;
+    }
+    else
+    {
+        err_code = NRF_ERROR_NO_MEM;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (err_code == NRF_SUCCESS)
+    {
+        // The queue is processed from the TWI interrupt only.
+        NVIC_SetPendingIRQ(p_instance->irq);
+    }
+
+    return err_code;
+}
+
+
 uint32_t nrf_data_count_get(nrf_drv_twi_t const * const p_instance)
 {
     volatile transfer_t * p_transfer = &(m_cb[p_instance->instance_id].transfer);
@@ -677,6 +846,7 @@ uint32_t nrf_data_count_get(nrf_drv_twi_t const * const p_instance)
 __STATIC_INLINE void nrf_drv_twi_int_handler(NRF_TWI_Type * p_reg, uint32_t instance_id)
 {
     volatile transfer_t * p_transfer = &(m_cb[instance_id].transfer);
+    nrf_drv_twi_t const * p_instance = (nrf_drv_twi_t const *)m_instances[instance_id];
     sm_evt_t sm_event;
 
     bool error_occured   = nrf_twi_event_check(p_reg, NRF_TWI_EVENTS_ERROR);
@@ -699,7 +869,12 @@ __STATIC_INLINE void nrf_drv_twi_int_handler(NRF_TWI_Type * p_reg, uint32_t inst
         }
         state_machine(m_instances[instance_id], sm_event);
 
-        if (p_transfer->error_condition)
+        if (p_transfer->error_condition && m_queues[instance_id].is_active)
+        {
+            p_transfer->transfer_in_progress = false;
+            xfer_transfer_done(p_instance, true);
+        }
+        else if (p_transfer->error_condition)
         {
             p_transfer->transfer_in_progress = false;
             nrf_drv_twi_evt_t evt =
@@ -714,6 +889,11 @@ __STATIC_INLINE void nrf_drv_twi_int_handler(NRF_TWI_Type * p_reg, uint32_t inst
             };
             m_handlers[instance_id](&evt);
         }
+        else if ((p_transfer->count >= p_transfer->length) && m_queues[instance_id].is_active)
+        {
+            p_transfer->transfer_in_progress = false;
+            xfer_transfer_done(p_instance, false);
+        }
         else if (p_transfer->count >= p_transfer->length)
         {
             p_transfer->transfer_in_progress = false;
@@ -726,6 +906,8 @@ __STATIC_INLINE void nrf_drv_twi_int_handler(NRF_TWI_Type * p_reg, uint32_t inst
             m_handlers[instance_id](&evt);
         }
     }
+
+    xfer_queue_process(p_instance);
 }
 
 
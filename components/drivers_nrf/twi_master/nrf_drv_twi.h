@@ -34,6 +34,10 @@
  * @brief Driver for managing the TWI.
  */
 
+#ifndef NRF_DRV_TWI_QUEUE_SIZE
+#define NRF_DRV_TWI_QUEUE_SIZE 4 /**< Number of transactions that can be scheduled per instance with @ref nrf_drv_twi_xfer_schedule. */
+#endif
+
 /**@brief TWI events. */
 typedef enum
 {
@@ -94,6 +98,31 @@ typedef struct
 /**@brief TWI event handler prototype. */
 typedef void (* nrf_drv_twi_evt_handler_t)(nrf_drv_twi_evt_t * p_event);
 
+/**@brief TWI transaction callback prototype.
+ *
+ * @param[in] result     NRF_SUCCESS if the transaction succeeded, NRF_ERROR_INTERNAL if the slave
+ *                       did not acknowledge or a bus error occurred.
+ * @param[in] p_context  Context of the transaction.
+ */
+typedef void (* nrf_drv_twi_xfer_callback_t)(ret_code_t result, void * p_context);
+
+/**@brief Structure for a TWI transaction.
+ *
+ * @details A transaction writes tx_length bytes and then, after a repeated start, reads
+ *          rx_length bytes, which is the usual way of reading registers of a sensor. Either
+ *          part can be left out by setting its length to 0.
+ */
+typedef struct
+{
+    uint8_t                     address;    /**< Address of the slave device (only 7 LSB). */
+    uint8_t                     tx_length;  /**< Number of bytes to write. */
+    uint8_t                     rx_length;  /**< Number of bytes to read after the write. */
+    uint8_t const             * p_tx_data;  /**< Data to write, for example a register address. Must stay valid until the callback. */
+    uint8_t                   * p_rx_data;  /**< Buffer for the data read. Must stay valid until the callback. */
+    nrf_drv_twi_xfer_callback_t callback;   /**< Function called when the transaction is done. Can be NULL. */
+    void                      * p_context;  /**< Context passed to the callback. */
+} nrf_drv_twi_xfer_t;
+
 /**
  * @brief Function for initializing the TWI instance.
  *
@@ -173,6 +202,30 @@ ret_code_t nrf_drv_twi_rx(nrf_drv_twi_t const * const p_instance,
                           uint32_t                    length,
                           bool                        xfer_pending);
 
+/**
+ * @brief Function for scheduling a transaction.
+ *
+ * The transaction is copied to the queue of the instance and run from the TWI interrupt once the
+ * transactions before it, and any transfer started with @ref nrf_drv_twi_tx or
+ * @ref nrf_drv_twi_rx, are done. The write and the read are chained with a repeated start, and
+ * the next transaction is started from the interrupt as well, so a sequence of register reads
+ * does not need the CPU between bytes. The callback of the transaction is called from the TWI
+ * interrupt; the event handler is not called for scheduled transactions.
+ *
+ * @note Only available in non-blocking mode.
+ *
+ * @param[in] p_instance  TWI instance.
+ * @param[in] p_xfer      Transaction.
+ *
+ * @retval  NRF_SUCCESS              If the transaction was scheduled.
+ * @retval  NRF_ERROR_NULL           If p_xfer is NULL.
+ * @retval  NRF_ERROR_INVALID_PARAM  If both lengths are 0 or a buffer is missing.
+ * @retval  NRF_ERROR_INVALID_STATE  If the instance is not enabled or is in blocking mode.
+ * @retval  NRF_ERROR_NO_MEM         If the queue is full.
+ */
+ret_code_t nrf_drv_twi_xfer_schedule(nrf_drv_twi_t const * const p_instance,
+                                     nrf_drv_twi_xfer_t const *  p_xfer);
+
 /**
  * @brief Function for getting transferred data count.
  *
@@ -461,6 +461,56 @@ uint32_t app_uart_put(uint8_t byte)
 }
 
 
+uint32_t app_uart_read(uint8_t * p_data, uint32_t * p_length)
+{
+    uint32_t err_code = NRF_SUCCESS;
+    uint32_t i;
+
+    if ((p_data == NULL) || (p_length == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    for (i = 0; i < *p_length; i++)
+    {
+        err_code = app_uart_get(&p_data[i]);
+        if (err_code != NRF_SUCCESS)
+        {
+            break;
+        }
+    }
+
+    *p_length = i;
+
+    return (i > 0) ? NRF_SUCCESS : err_code;
+}
+
+
+uint32_t app_uart_write(uint8_t const * p_data, uint32_t * p_length)
+{
+    uint32_t err_code = NRF_SUCCESS;
+    uint32_t i;
+
+    if ((p_data == NULL) || (p_length == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    for (i = 0; i < *p_length; i++)
+    {
+        err_code = app_uart_put(p_data[i]);
+        if (err_code != NRF_SUCCESS)
+        {
+            break;
+        }
+    }
+
+    *p_length = i;
+
+    return (i > 0) ? NRF_SUCCESS : err_code;
+}
+
+
 uint32_t app_uart_flush(void)
 {
     return NRF_SUCCESS;
@@ -233,6 +233,37 @@ uint32_t app_uart_get(uint8_t * p_byte);
  */
 uint32_t app_uart_put(uint8_t byte);
 
+/**@brief Function for getting several bytes from the UART.
+ *
+ * @details Copies as many bytes as are available, up to the size of the buffer. If the RX buffer
+ *          is empty, the app_uart module will generate an event upon reception of the first byte
+ *          which is added to the RX buffer. With the FIFO, the bytes are copied in at most two
+ *          spans instead of one call per byte.
+ *
+ * @param[out]   p_data    Buffer for the bytes received.
+ * @param[inout] p_length  Size of p_data. Returns the number of bytes copied.
+ *
+ * @retval NRF_SUCCESS          If at least one byte has been copied.
+ * @retval NRF_ERROR_NULL       If p_length is NULL.
+ * @retval NRF_ERROR_NOT_FOUND  If no byte is available in the RX buffer of the app_uart module.
+ */
+uint32_t app_uart_read(uint8_t * p_data, uint32_t * p_length);
+
+/**@brief Function for putting several bytes on the UART.
+ *
+ * @details This call is non-blocking. Copies as many bytes as there is room for in the TX buffer.
+ *          With the FIFO, the bytes are copied in at most two spans instead of one call per byte.
+ *
+ * @param[in]    p_data    Bytes to be transmitted on the UART.
+ * @param[inout] p_length  Number of bytes to transmit. Returns the number of bytes put on the
+ *                         TX buffer.
+ *
+ * @retval NRF_SUCCESS        If at least one byte was put on the TX buffer for transmission.
+ * @retval NRF_ERROR_NULL     If p_length is NULL.
+ * @retval NRF_ERROR_NO_MEM   If no more space is available in the TX buffer.
+ */
+uint32_t app_uart_write(uint8_t const * p_data, uint32_t * p_length);
+
 /**@brief Function for getting the current state of the UART.
  *
  * @details If flow control is disabled, the state is assumed to always be APP_UART_CONNECTED.
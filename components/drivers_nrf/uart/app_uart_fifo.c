@@ -510,6 +510,34 @@ uint32_t app_uart_put(uint8_t byte)
 }
 
 
+uint32_t app_uart_read(uint8_t * p_data, uint32_t * p_length)
+{
+    if (p_data == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    return app_fifo_read(&m_rx_fifo, p_data, p_length);
+}
+
+
+uint32_t app_uart_write(uint8_t const * p_data, uint32_t * p_length)
+{
+    uint32_t err_code;
+
+    if (p_data == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    err_code = app_fifo_write(&m_tx_fifo, p_data, p_length);
+
+    on_uart_event(ON_UART_PUT);
+
+    return err_code;
+}
+
+
 uint32_t app_uart_flush(void)
 {
     uint32_t err_code;
@@ -209,6 +209,11 @@ static antfs_event_queue_t m_event_queue;                                 /**< E
 
 static antfs_burst_wait_handler_t m_burst_wait_handler = NULL;            /**< Burst wait handler */
 
+// Download pipelining.
+static uint8_t             m_burst_buffers[2][ANTFS_BURST_BLOCK_SIZE * BURST_PACKET_SIZE]; /**< Download blocks, one is filled while the burst handler sends the other. */
+static uint8_t             m_burst_buffer_index;                          /**< Buffer of the next download block. */
+static antfs_burst_stats_t m_burst_stats;                                 /**< Download throughput counters. */
+
 
 const char * antfs_hostname_get(void)
 {
@@ -235,6 +240,20 @@ static void wait_burst_request_to_complete(void)
 }
 
 
+/**@brief Function for waiting for the burst handler to take a pipelined download block, if any.
+ *
+ * Must be called before any burst request that may follow a download block.
+ */
+static void wait_burst_pipeline_to_drain(void)
+{
+    if (m_burst_wait != 0)
+    {
+        m_burst_stats.burst_stalls++;
+        wait_burst_request_to_complete();
+    }
+}
+
+
 /**@brief Function for stopping ANT-FS timeout, which is possibly currently running.
  */
 static void timeout_disable(void)
@@ -315,6 +334,8 @@ static void beacon_transmit(uint32_t message_type)
     }
     else if(message_type == MESG_BURST_DATA_ID)
     {
+        wait_burst_pipeline_to_drain();
+
         // Send as the first packet of a burst.
         const uint32_t err_code = sd_ant_burst_handler_request(ANTFS_CHANNEL,
                                                                 sizeof(tx_buffer),
@@ -866,7 +887,9 @@ uint32_t antfs_input_data_download(uint16_t index,
         // Append data.
         if (m_current_state.sub_state.trans_sub_state == ANTFS_TRANS_SUBSTATE_DOWNLOADING)
         {
-            uint32_t num_of_bytes_to_burst = num_bytes;
+            uint32_t  num_of_bytes_to_burst = num_bytes;
+            uint8_t * p_burst_data          = (uint8_t*)&(p_message[block_offset]);
+            bool      is_pipelined          = false;
 
             if (num_of_bytes_to_burst & (BURST_PACKET_SIZE - 1u))
             {
@@ -876,9 +899,26 @@ uint32_t antfs_input_data_download(uint16_t index,
                 num_of_bytes_to_burst += BURST_PACKET_SIZE;
             }
 
+            if (num_of_bytes_to_burst <= sizeof(m_burst_buffers[0]))
+            {
+                // Copy the block, so that the application can prepare the next one while this one
+                // is sent. The padding is zeroed, instead of read beyond the application buffer.
+                uint8_t * p_buffer = m_burst_buffers[m_burst_buffer_index];
+
+                memcpy(p_buffer, p_burst_data, num_bytes);
+                memset(&p_buffer[num_bytes], 0, num_of_bytes_to_burst - num_bytes);
+
+                p_burst_data         = p_buffer;
+                m_burst_buffer_index ^= 1u;
+                is_pipelined         = true;
+            }
+
+            // The burst handler takes one request at a time.
+            wait_burst_pipeline_to_drain();
+
             uint32_t err_code = sd_ant_burst_handler_request(ANTFS_CHANNEL,
                                                              num_of_bytes_to_burst,
-                                                             (uint8_t*)&(p_message[block_offset]),
+                                                             p_burst_data,
                                                              BURST_SEGMENT_CONTINUE);
             if(err_code != NRF_ANT_ERROR_TRANSFER_SEQUENCE_NUMBER_ERROR)
             {
@@ -886,8 +926,19 @@ uint32_t antfs_input_data_download(uint16_t index,
                 // The message processing will send client back to correct state
                 APP_ERROR_CHECK(err_code);
             }
+            else
+            {
+                m_burst_stats.burst_failures++;
+            }
 
-            wait_burst_request_to_complete();
+            if (!is_pipelined)
+            {
+                // The application buffer must stay untouched until the block is taken.
+                wait_burst_request_to_complete();
+            }
+
+            m_burst_stats.bytes_downloaded += num_bytes;
+            m_burst_stats.blocks_downloaded++;
 
             // Update current burst index.
             m_link_burst_index.data += num_bytes;
@@ -896,6 +947,7 @@ uint32_t antfs_input_data_download(uint16_t index,
 
             m_is_data_request_pending = false;
 
+            // Computed while the block is sent.
             m_transfer_crc = crc_crc16_update(m_transfer_crc,
                                               &(p_message[block_offset]),
                                               num_bytes);
@@ -938,6 +990,8 @@ uint32_t antfs_input_data_download(uint16_t index,
                 tx_buffer[6] = (uint8_t)m_transfer_crc;
                 tx_buffer[7] = (uint8_t)(m_transfer_crc >> 8u);
 
+                wait_burst_pipeline_to_drain();
+
                 err_code = sd_ant_burst_handler_request(ANTFS_CHANNEL,
                                                         sizeof(tx_buffer),
                                                         tx_buffer,
@@ -2331,4 +2385,12 @@ void antfs_init(const antfs_params_t * const p_params,
 
     err_code = sd_ant_burst_handler_wait_flag_enable((uint8_t *)(&m_burst_wait));
     APP_ERROR_CHECK(err_code);
+
+    memset(&m_burst_stats, 0, sizeof(m_burst_stats));
+}
+
+
+void antfs_burst_stats_get(antfs_burst_stats_t * const p_stats)
+{
+    *p_stats = m_burst_stats;
 }
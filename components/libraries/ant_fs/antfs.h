@@ -279,6 +279,11 @@ void antfs_download_req_resp_prepare(uint8_t response,
                                              const antfs_request_info_t * const p_request_info);
 
 /**@brief Function for downloading requested data.
+ *
+ * Data of up to ANTFS_BURST_BLOCK_SIZE burst packets is copied, and the function returns as soon as
+ * the burst handler has taken the previous block, without waiting for this one. The application
+ * thus prepares the next block while the current one is sent, and the burst is not held up between
+ * blocks.
  *
  * @param[in] index               Index of the current file downloaded.
  * @param[in] offset              Offset specified by client.
@@ -343,6 +348,24 @@ void antfs_message_process(uint8_t * p_message);
  */
 void antfs_channel_setup(void);
 
+/**@brief ANT-FS download throughput counters, reset by antfs_init. */
+typedef struct
+{
+    uint32_t bytes_downloaded;                                  /**< Data bytes handed to the burst handler. */
+    uint32_t blocks_downloaded;                                 /**< Data blocks handed to the burst handler. */
+    uint32_t burst_stalls;                                      /**< Blocks that had to wait for the burst handler to take the previous one. Few stalls mean the application is the bottleneck. */
+    uint32_t burst_failures;                                    /**< Burst requests rejected because the burst had already failed. */
+} antfs_burst_stats_t;
+
+/**@brief Function for getting the download throughput counters.
+ *
+ * @details The download rate is the increase of bytes_downloaded over a period timed by the
+ *          application.
+ *
+ * @param[out] p_stats            The counters.
+ */
+void antfs_burst_stats_get(antfs_burst_stats_t * const p_stats);
+
 #endif // ANTFS_H__
 
 /**
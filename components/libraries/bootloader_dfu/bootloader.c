@@ -42,6 +42,8 @@ typedef enum
 
 static pstorage_handle_t        m_bootsettings_handle;  /**< Pstorage handle to use for registration and identifying the bootloader module on subsequent calls to the pstorage module for load and store of bootloader setting in flash. */
 static bootloader_status_t      m_update_status;        /**< Current update status for the bootloader module to ensure correct behaviour when updating settings and when update completes. */
+static bootloader_settings_record_t m_settings_record;  /**< Settings record being written to the settings journal. */
+static uint32_t                 m_settings_offset;      /**< Offset in the settings page for the next settings record, counting records that are still queued in pstorage. */
 
 /**@brief   Function for handling callbacks from pstorage module.
  *
@@ -129,16 +131,32 @@ bool bootloader_app_is_valid(uint32_t app_addr)
 }
 
 
+/**@brief Function for appending settings to the settings journal.
+ *
+ * @details The settings page is only erased when the journal is full, other updates are a few word
+ *          writes.
+ */
 static void bootloader_settings_save(bootloader_settings_t * p_settings)
 {
-    uint32_t err_code = pstorage_clear(&m_bootsettings_handle, sizeof(bootloader_settings_t));
-    APP_ERROR_CHECK(err_code);
+    uint32_t err_code;
+
+    if (m_settings_offset + sizeof(bootloader_settings_record_t) > CODE_PAGE_SIZE)
+    {
+        err_code = pstorage_clear(&m_bootsettings_handle, sizeof(bootloader_settings_t));
+        APP_ERROR_CHECK(err_code);
+
+        m_settings_offset = 0;
+    }
+
+    bootloader_settings_record_init(&m_settings_record, p_settings);
 
     err_code = pstorage_store(&m_bootsettings_handle,
-                              (uint8_t *)p_settings,
-                              sizeof(bootloader_settings_t),
-                              0);
+                              (uint8_t *)&m_settings_record,
+                              sizeof(bootloader_settings_record_t),
+                              m_settings_offset);
     APP_ERROR_CHECK(err_code);
+
+    m_settings_offset += sizeof(bootloader_settings_record_t);
 }
 
 
@@ -254,6 +272,8 @@ uint32_t bootloader_init(void)
     m_bootsettings_handle.block_id = BOOTLOADER_SETTINGS_ADDRESS;
     err_code = pstorage_register(&storage_params, &m_bootsettings_handle);
 
+    m_settings_offset = bootloader_settings_free_offset_get();
+
     return err_code;
 }
 
@@ -344,12 +364,11 @@ uint32_t bootloader_dfu_sd_update_continue(void)
     // a debugger to be attached.
     nrf_delay_ms(100);
 
+    // The swap verifies what it copies, the MBR checks every copy and the block swap ends with a
+    // compare, so the image isn't read back again here.
     err_code = dfu_sd_image_swap();
     APP_ERROR_CHECK(err_code);
 
-    err_code = dfu_sd_image_validate();
-    APP_ERROR_CHECK(err_code);
-
     err_code = dfu_bl_image_swap();
     APP_ERROR_CHECK(err_code);
 
@@ -369,6 +388,46 @@ uint32_t bootloader_dfu_sd_update_finalize(void)
 }
 
 
+uint32_t bootloader_dfu_staged_activate(void)
+{
+    uint32_t                   err_code;
+    const dfu_staged_image_t * p_staged = (const dfu_staged_image_t *)DFU_STAGED_INFO_ADDRESS;
+
+    if ((p_staged->magic != DFU_STAGED_IMAGE_MAGIC) ||
+        (p_staged->image_size == 0)                 ||
+        (p_staged->image_size > DFU_STAGED_IMAGE_MAX_SIZE))
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    // The application validated the image before writing the information, but bank 1 is checked
+    // again as it is about to replace a working application.
+    if (crc16_compute((uint8_t *)DFU_BANK_1_REGION_START, p_staged->image_size, NULL) !=
+        (uint16_t)p_staged->image_crc)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    err_code = dfu_init();
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_update_status = BOOTLOADER_UPDATING;
+
+    err_code = dfu_staged_image_activate(p_staged->image_size, (uint16_t)p_staged->image_crc);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    wait_for_events();
+
+    return NRF_SUCCESS;
+}
+
+
 void bootloader_settings_get(bootloader_settings_t * const p_settings)
 {
     const bootloader_settings_t *  p_bootloader_settings;
@@ -92,6 +92,19 @@ uint32_t bootloader_dfu_sd_update_continue(void);
  */
 uint32_t bootloader_dfu_sd_update_finalize(void);
 
+/**@brief Function for activating an application image staged in bank 1 by the application.
+ *
+ * @details Called when the application has reset into the bootloader with
+ *          @ref BOOTLOADER_DFU_ACTIVATE_STAGED. The staged image is checked against the CRC in its
+ *          @ref dfu_staged_image_t, moved to bank 0, and the function returns when the bootloader
+ *          settings have been saved. The current application is left untouched if the check fails.
+ *
+ * @retval NRF_SUCCESS              The staged image was activated.
+ * @retval NRF_ERROR_NOT_FOUND      There is no staged image information in bank 1.
+ * @retval NRF_ERROR_INVALID_DATA   The staged image doesn't match its CRC.
+ */
+uint32_t bootloader_dfu_staged_activate(void);
+
 #endif // BOOTLOADER_H__
 
 /**@} */
@@ -12,7 +12,13 @@
 
 #include "bootloader_settings.h"
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <dfu_types.h>
+#include "crc16.h"
+
+#define SETTINGS_COMMIT_MARK    0x5E770000                                                          /**< Upper half of a valid commit word, the lower half is the CRC of the settings. */
+#define SETTINGS_RECORD_COUNT   (CODE_PAGE_SIZE / sizeof(bootloader_settings_record_t))             /**< Number of records that fit in the settings page. */
 
 #if defined ( __CC_ARM )
 uint8_t  m_boot_settings[CODE_PAGE_SIZE] __attribute__((at(BOOTLOADER_SETTINGS_ADDRESS))) __attribute__((used));                /**< This variable reserves a codepage for bootloader specific settings, to ensure the compiler doesn't locate any code or variables at his location. */
@@ -26,11 +32,74 @@ __root    const uint32_t m_uicr_bootloader_start_address @ 0x10001014 = BOOTLOAD
 #endif
 
 
+STATIC_ASSERT((sizeof(bootloader_settings_record_t) % sizeof(uint32_t)) == 0);
+
+
+/**@brief Function for computing the commit word of a settings record.
+ */
+static uint32_t settings_commit_get(const bootloader_settings_t * p_settings)
+{
+    return SETTINGS_COMMIT_MARK | crc16_compute((const uint8_t *)p_settings,
+                                                sizeof(bootloader_settings_t),
+                                                NULL);
+}
+
+
+/**@brief Function for checking if a record slot in the settings page has never been written.
+ */
+static bool settings_record_is_blank(const bootloader_settings_record_t * p_record)
+{
+    const uint32_t * p_word = (const uint32_t *)p_record;
+
+    for (uint32_t i = 0; i < sizeof(bootloader_settings_record_t) / sizeof(uint32_t); i++)
+    {
+        if (p_word[i] != EMPTY_FLASH_MASK)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
 void bootloader_util_settings_get(const bootloader_settings_t ** pp_bootloader_settings)
 {
     // Read only pointer to bootloader settings in flash. 
-    bootloader_settings_t const * const p_bootloader_settings =
-        (bootloader_settings_t *)&m_boot_settings[0];        
+    const bootloader_settings_record_t * p_records = (bootloader_settings_record_t *)&m_boot_settings[0];
+
+    // The newest committed record wins. Without any, the settings are at the start of the page.
+    for (uint32_t i = SETTINGS_RECORD_COUNT; i > 0; i--)
+    {
+        if (p_records[i - 1].commit == settings_commit_get(&p_records[i - 1].settings))
+        {
+            *pp_bootloader_settings = &p_records[i - 1].settings;
+            return;
+        }
+    }
+
+    *pp_bootloader_settings = &p_records[0].settings;
+}
+
+
+void bootloader_settings_record_init(bootloader_settings_record_t * p_record,
+                                     const bootloader_settings_t  * p_settings)
+{
+    p_record->settings = *p_settings;
+    p_record->commit   = settings_commit_get(p_settings);
+}
+
+
+uint32_t bootloader_settings_free_offset_get(void)
+{
+    const bootloader_settings_record_t * p_records = (bootloader_settings_record_t *)&m_boot_settings[0];
 
-    *pp_bootloader_settings = p_bootloader_settings;
+    // Records that were cut short are neither valid nor free, so skip past everything written.
+    for (uint32_t i = SETTINGS_RECORD_COUNT; i > 0; i--)
+    {
+        if (!settings_record_is_blank(&p_records[i - 1]))
+        {
+            return (i < SETTINGS_RECORD_COUNT) ? (i * sizeof(bootloader_settings_record_t)) : CODE_PAGE_SIZE;
+        }
+    }
+    return 0;
 }
@@ -24,12 +24,41 @@
 #include <stdint.h>
 #include "bootloader_types.h"
 
+/**@brief Settings journal record.
+ *
+ * @details The settings page holds a journal of records, and the newest record with a valid
+ *          commit word is the current settings. New settings are appended to the journal, and the
+ *          page is only erased when it is full. The commit word is written last, so a record that
+ *          was cut short by a reset is ignored. A page without any valid records, like one written
+ *          by an older bootloader or along with the hex files, holds the settings at its start.
+ */
+typedef struct
+{
+    bootloader_settings_t settings; /**< Bootloader settings. */
+    uint32_t              commit;   /**< Commit word, see @ref bootloader_settings_record_init. */
+} bootloader_settings_record_t;
+
 /**@brief Function for getting the bootloader settings.
  * 
  * @param[out] pp_bootloader_settings Bootloader settings. 
  */
 void bootloader_util_settings_get(const bootloader_settings_t ** pp_bootloader_settings);
 
+/**@brief Function for preparing a settings record to be appended to the journal.
+ *
+ * @param[out] p_record   Record to prepare.
+ * @param[in]  p_settings Settings to store in the record.
+ */
+void bootloader_settings_record_init(bootloader_settings_record_t * p_record,
+                                     const bootloader_settings_t  * p_settings);
+
+/**@brief Function for getting the place of the next record in the journal.
+ *
+ * @return Offset in the settings page of the first record slot after all used ones, or
+ *         CODE_PAGE_SIZE if the page is full and must be erased first.
+ */
+uint32_t bootloader_settings_free_offset_get(void);
+
 #endif // BOOTLOADER_SETTINGS_H__
 
 /**@} */
@@ -129,6 +129,19 @@ uint32_t dfu_sd_image_swap(void);
  */
 uint32_t dfu_init_pkt_complete(void);
 
+/**@brief Function for activating an application image staged in bank 1 by the application.
+ *
+ * @details The image is moved to bank 0 and the bootloader settings are updated, as when an
+ *          application image received by the bootloader is activated. @ref dfu_init must have
+ *          been called, and the image must have been validated.
+ *
+ * @param[in] image_size  Size of the staged image.
+ * @param[in] image_crc   CRC-16 of the staged image.
+ *
+ * @return    NRF_SUCCESS on success, an error_code otherwise.
+ */
+uint32_t dfu_staged_image_activate(uint32_t image_size, uint16_t image_crc);
+
 #endif // DFU_H__
 
 /** @} */
@@ -21,6 +21,13 @@
 #include "dfu_ble_svc.h"
 #include "device_manager.h"
 #include "nrf_delay.h"
+#if DFU_APP_PRESTAGE
+#include "dfu_types.h"
+#include "dfu_init.h"
+#include "pstorage.h"
+#include "crc16.h"
+#include "app_util.h"
+#endif
 
 #define IRQ_ENABLED            0x01                                     /**< Field that identifies if an interrupt is enabled. */
 #define MAX_NUMBER_INTERRUPTS  32                                       /**< Maximum number of interrupts available. */
@@ -30,6 +37,52 @@ static dfu_app_reset_prepare_t m_reset_prepare = dfu_app_reset_prepare; /**< Cal
 static dfu_ble_peer_data_t     m_peer_data;                             /**< Peer data to be used for data exchange when resetting into DFU mode. */
 static dm_handle_t             m_dm_handle;                             /**< Device Manager handle with instance IDs of current BLE connection. */
 
+#if DFU_APP_PRESTAGE
+#define PKT_SIZE_MAX           20                                       /**< Largest write to the DFU Packet characteristic. */
+#define INIT_PACKET_SIZE_MAX   64                                       /**< Largest init packet. */
+#define SD_IMAGE_SIZE_OFFSET   0                                        /**< Offset in start packet for the size information for SoftDevice. */
+#define BL_IMAGE_SIZE_OFFSET   4                                        /**< Offset in start packet for the size information for bootloader. */
+#define APP_IMAGE_SIZE_OFFSET  8                                        /**< Offset in start packet for the size information for application. */
+
+/**@brief Type of the packets written by the peer to the DFU Packet characteristic. */
+typedef enum
+{
+    PKT_TYPE_INVALID,                                                   /**< No procedure expects packets. */
+    PKT_TYPE_START,                                                     /**< Start packet. */
+    PKT_TYPE_INIT,                                                      /**< Init packet. */
+    PKT_TYPE_FIRMWARE_DATA                                              /**< Firmware data packet. */
+} pkt_type_t;
+
+/**@brief State of an image being staged in the swap bank. */
+typedef enum
+{
+    PRESTAGE_IDLE,                                                      /**< No image is being staged. */
+    PRESTAGE_ERASING,                                                   /**< The swap bank is being erased. */
+    PRESTAGE_RECEIVING,                                                 /**< Receiving the init packet and the image. */
+    PRESTAGE_VALIDATING,                                                /**< The image has passed the checks, and its information is being written. */
+    PRESTAGE_VALID                                                      /**< The image is staged, and can be activated. */
+} prestage_state_t;
+
+static ble_dfu_t             * mp_dfu;                                  /**< DFU Service to respond on when a flash operation completes. */
+static pstorage_handle_t       m_swap_handle;                           /**< Pstorage raw handle of the swap bank. */
+static bool                    m_swap_registered;                       /**< The swap bank has been registered with pstorage. */
+static prestage_state_t        m_prestage_state = PRESTAGE_IDLE;        /**< State of the image being staged. */
+static pkt_type_t              m_pkt_type;                              /**< Type of packet expected from the peer. */
+static uint32_t                m_image_size;                            /**< Size of the image being staged. */
+static uint32_t                m_bytes_rcvd;                            /**< Bytes of the image received. */
+static uint32_t                m_bytes_stored;                          /**< Bytes of the image written to the swap bank. */
+static uint32_t                m_init_packet[INIT_PACKET_SIZE_MAX / sizeof(uint32_t)]; /**< Init packet received. */
+static uint32_t                m_init_packet_length;                    /**< Length of the init packet received. */
+static uint32_t                m_pkt_buffer[DFU_APP_PRESTAGE_PKT_BUFFERS][PKT_SIZE_MAX / sizeof(uint32_t)]; /**< Data packets waiting for their flash write, released in order. */
+static uint32_t                m_pkt_buffer_index;                      /**< Next packet buffer to use. */
+static uint32_t                m_pkts_in_flash;                         /**< Packets waiting for their flash write. */
+static bool                    m_pkt_rcpt_notif_enabled;                /**< The peer has enabled packet receipt notifications. */
+static bool                    m_pkt_rcpt_notif_pending;                /**< A packet receipt notification is held back until the pending flash writes are done. */
+static uint16_t                m_pkt_notif_target;                      /**< Packets between packet receipt notifications. */
+static uint16_t                m_pkt_notif_target_cnt;                  /**< Packets left until the next packet receipt notification. */
+static dfu_staged_image_t      m_staged_image;                          /**< Information on the staged image, written at the end of the swap bank. */
+#endif // DFU_APP_PRESTAGE
+
 
 /**@brief Function for reset_prepare handler if the application has not registered a handler.
  */
@@ -154,8 +207,447 @@ static void bootloader_start(uint16_t conn_handle)
 }
 
 
+#if DFU_APP_PRESTAGE
+/**@brief Function for translating an error code to a DFU Response Value.
+ *
+ * @param[in] err_code  Error code to translate.
+ * @param[in] procedure Procedure the error code was returned for.
+ */
+static ble_dfu_resp_val_t prestage_err_code_translate(uint32_t err_code, ble_dfu_procedure_t procedure)
+{
+    switch (err_code)
+    {
+        case NRF_SUCCESS:
+            return BLE_DFU_RESP_VAL_SUCCESS;
+
+        case NRF_ERROR_INVALID_STATE:
+            return BLE_DFU_RESP_VAL_INVALID_STATE;
+
+        case NRF_ERROR_NOT_SUPPORTED:
+        case NRF_ERROR_INVALID_LENGTH:
+            return BLE_DFU_RESP_VAL_NOT_SUPPORTED;
+
+        case NRF_ERROR_DATA_SIZE:
+            return BLE_DFU_RESP_VAL_DATA_SIZE;
+
+        case NRF_ERROR_INVALID_DATA:
+            // The image failed its CRC check, the init packet was rejected.
+            return (procedure == BLE_DFU_VALIDATE_PROCEDURE) ? BLE_DFU_RESP_VAL_CRC_ERROR :
+                                                               BLE_DFU_RESP_VAL_OPER_FAILED;
+
+        default:
+            return BLE_DFU_RESP_VAL_OPER_FAILED;
+    }
+}
+
+
+/**@brief Function for ending the staging of an image with an error response to the peer.
+ *
+ * @details An invalid state error leaves the staging as it is, as it may still have a flash
+ *          operation in progress.
+ *
+ * @param[in] procedure Procedure to respond to.
+ * @param[in] err_code  Error code to respond with.
+ */
+static void prestage_abort(ble_dfu_procedure_t procedure, uint32_t err_code)
+{
+    if (err_code != NRF_ERROR_INVALID_STATE)
+    {
+        m_prestage_state = PRESTAGE_IDLE;
+        m_pkt_type       = PKT_TYPE_INVALID;
+    }
+
+    err_code = ble_dfu_response_send(mp_dfu, procedure, prestage_err_code_translate(err_code, procedure));
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for handling pstorage results for the swap bank.
+ *
+ * @details Responses to the start, receive and validate procedures are sent when their flash
+ *          operations complete. See @ref pstorage_ntf_cb_t for the parameters.
+ */
+static void prestage_pstorage_cb_handler(pstorage_handle_t * p_handle,
+                                         uint8_t             op_code,
+                                         uint32_t            result,
+                                         uint8_t           * p_data,
+                                         uint32_t            data_len)
+{
+    uint32_t err_code;
+
+    if ((op_code == PSTORAGE_CLEAR_OP_CODE) && (m_prestage_state == PRESTAGE_ERASING))
+    {
+        if (result != NRF_SUCCESS)
+        {
+            prestage_abort(BLE_DFU_START_PROCEDURE, result);
+            return;
+        }
+        m_prestage_state = PRESTAGE_RECEIVING;
+
+        err_code = ble_dfu_response_send(mp_dfu, BLE_DFU_START_PROCEDURE, BLE_DFU_RESP_VAL_SUCCESS);
+        APP_ERROR_CHECK(err_code);
+    }
+    else if ((op_code == PSTORAGE_STORE_OP_CODE) && (p_data == (uint8_t *)&m_staged_image))
+    {
+        if (m_prestage_state != PRESTAGE_VALIDATING)
+        {
+            return;
+        }
+        if (result != NRF_SUCCESS)
+        {
+            prestage_abort(BLE_DFU_VALIDATE_PROCEDURE, result);
+            return;
+        }
+        m_prestage_state = PRESTAGE_VALID;
+
+        err_code = ble_dfu_response_send(mp_dfu, BLE_DFU_VALIDATE_PROCEDURE, BLE_DFU_RESP_VAL_SUCCESS);
+        APP_ERROR_CHECK(err_code);
+    }
+    else if (op_code == PSTORAGE_STORE_OP_CODE)
+    {
+        m_pkts_in_flash--;
+        if (m_prestage_state != PRESTAGE_RECEIVING)
+        {
+            // The staging was aborted while the packet waited for the flash.
+            return;
+        }
+        if (result != NRF_SUCCESS)
+        {
+            prestage_abort(BLE_DFU_RECEIVE_APP_PROCEDURE, result);
+            return;
+        }
+        m_bytes_stored += data_len;
+
+        if (m_pkt_rcpt_notif_pending && (m_pkts_in_flash == 0))
+        {
+            m_pkt_rcpt_notif_pending = false;
+
+            err_code = ble_dfu_pkts_rcpt_notify(mp_dfu, m_bytes_rcvd);
+            APP_ERROR_CHECK(err_code);
+        }
+        if (m_bytes_stored == m_image_size)
+        {
+            m_pkt_type = PKT_TYPE_INVALID;
+
+            err_code = ble_dfu_response_send(mp_dfu,
+                                             BLE_DFU_RECEIVE_APP_PROCEDURE,
+                                             BLE_DFU_RESP_VAL_SUCCESS);
+            APP_ERROR_CHECK(err_code);
+        }
+    }
+}
+
+
+/**@brief Function for processing the start packet, and erasing the swap bank for an application
+ *        image.
+ *
+ * @param[in] p_dfu     DFU Service Structure.
+ * @param[in] p_evt     Pointer to the packet write event.
+ *
+ * @return NRF_SUCCESS if the swap bank is being erased, an error code otherwise.
+ */
+static uint32_t prestage_start(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
+{
+    uint32_t  err_code;
+    uint8_t * p_length_data = p_evt->evt.ble_dfu_pkt_write.p_data;
+
+    if (p_evt->evt.ble_dfu_pkt_write.len != (3 * sizeof(uint32_t)))
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    if ((uint32_decode(p_length_data + SD_IMAGE_SIZE_OFFSET) != 0) ||
+        (uint32_decode(p_length_data + BL_IMAGE_SIZE_OFFSET) != 0))
+    {
+        // The bootloader handles SoftDevice and bootloader updates, hence reset into it.
+        bootloader_start(p_dfu->conn_handle);
+    }
+
+    if ((m_prestage_state == PRESTAGE_ERASING) ||
+        (m_prestage_state == PRESTAGE_VALIDATING) ||
+        (m_pkts_in_flash != 0))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_image_size = uint32_decode(p_length_data + APP_IMAGE_SIZE_OFFSET);
+    if ((m_image_size & (sizeof(uint32_t) - 1)) != 0)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    if ((m_image_size == 0) || (m_image_size > DFU_STAGED_IMAGE_MAX_SIZE))
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    if (!m_swap_registered)
+    {
+        pstorage_module_param_t storage_params = {.cb = prestage_pstorage_cb_handler};
+
+        err_code = pstorage_raw_register(&storage_params, &m_swap_handle);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+        m_swap_handle.block_id = DFU_BANK_1_REGION_START;
+        m_swap_registered      = true;
+    }
+
+    // The whole bank is erased, as the information on the staged image is at its end.
+    err_code = pstorage_raw_clear(&m_swap_handle, DFU_IMAGE_MAX_SIZE_BANKED);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_prestage_state     = PRESTAGE_ERASING;
+    m_bytes_rcvd         = 0;
+    m_bytes_stored       = 0;
+    m_init_packet_length = 0;
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for processing a firmware data packet, and queuing its flash write.
+ *
+ * @param[in] p_dfu     DFU Service Structure.
+ * @param[in] p_evt     Pointer to the packet write event.
+ *
+ * @return NRF_SUCCESS if the packet was queued, an error code otherwise.
+ */
+static uint32_t prestage_data(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
+{
+    uint32_t err_code;
+    uint32_t length = p_evt->evt.ble_dfu_pkt_write.len;
+
+    if (m_prestage_state != PRESTAGE_RECEIVING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (((length & (sizeof(uint32_t) - 1)) != 0) || (length > PKT_SIZE_MAX))
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    if (m_bytes_rcvd + length > m_image_size)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    if (m_pkts_in_flash == DFU_APP_PRESTAGE_PKT_BUFFERS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    uint32_t * p_buffer = m_pkt_buffer[m_pkt_buffer_index];
+    memcpy(p_buffer, p_evt->evt.ble_dfu_pkt_write.p_data, length);
+
+    err_code = pstorage_raw_store(&m_swap_handle, (uint8_t *)p_buffer, length, m_bytes_rcvd);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_pkt_buffer_index = (m_pkt_buffer_index + 1) % DFU_APP_PRESTAGE_PKT_BUFFERS;
+    m_pkts_in_flash++;
+    m_bytes_rcvd += length;
+
+    if (m_pkt_rcpt_notif_enabled && (--m_pkt_notif_target_cnt == 0))
+    {
+        // Hold the notification back while packets wait for the flash, so that the next window
+        // of packets does not overrun the packet buffers.
+        m_pkt_rcpt_notif_pending = true;
+        m_pkt_notif_target_cnt   = m_pkt_notif_target;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for validating the received image, and writing its information at the end of
+ *        the swap bank.
+ *
+ * @return NRF_SUCCESS if the information is being written, an error code otherwise.
+ */
+static uint32_t prestage_validate(void)
+{
+    uint32_t err_code;
+    uint16_t image_crc;
+
+    if ((m_prestage_state != PRESTAGE_RECEIVING) || (m_bytes_stored != m_image_size))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    // Check what ended up in flash, rather than what was received.
+    image_crc = crc16_compute((uint8_t *)DFU_BANK_1_REGION_START, m_image_size, NULL);
+
+    err_code = dfu_init_postvalidate_crc(image_crc);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_staged_image.magic      = DFU_STAGED_IMAGE_MAGIC;
+    m_staged_image.image_size = m_image_size;
+    m_staged_image.image_crc  = image_crc;
+
+    err_code = pstorage_raw_store(&m_swap_handle,
+                                  (uint8_t *)&m_staged_image,
+                                  sizeof(m_staged_image),
+                                  DFU_STAGED_INFO_ADDRESS - DFU_BANK_1_REGION_START);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_prestage_state = PRESTAGE_VALIDATING;
+    }
+
+    return err_code;
+}
+
+
+/**@brief Function for resetting into the bootloader to activate the staged image.
+ */
+static void prestage_activate(void)
+{
+    uint32_t err_code;
+
+    m_reset_prepare();
+
+    err_code = sd_power_gpregret_clr(0xFF);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_power_gpregret_set(BOOTLOADER_DFU_ACTIVATE_STAGED);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_nvic_SystemReset();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for handling events from the DFU Service while pre-staging.
+ *
+ * @param[in] p_dfu  DFU Service Structure.
+ * @param[in] p_evt  Pointer to the DFU event.
+ */
+static void prestage_on_dfu_evt(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
+{
+    uint32_t            err_code;
+    ble_dfu_procedure_t procedure;
+
+    mp_dfu = p_dfu;
+
+    switch (p_evt->ble_dfu_evt_type)
+    {
+        case BLE_DFU_START:
+            m_pkt_type = PKT_TYPE_START;
+            break;
+
+        case BLE_DFU_RECEIVE_INIT_DATA:
+            m_pkt_type = PKT_TYPE_INIT;
+            if ((uint8_t)p_evt->evt.ble_dfu_pkt_write.p_data[0] == DFU_INIT_COMPLETE)
+            {
+                err_code = (m_prestage_state == PRESTAGE_RECEIVING) ?
+                           dfu_init_prevalidate((uint8_t *)m_init_packet, m_init_packet_length) :
+                           NRF_ERROR_INVALID_STATE;
+
+                err_code = ble_dfu_response_send(p_dfu,
+                                                 BLE_DFU_INIT_PROCEDURE,
+                                                 prestage_err_code_translate(err_code, BLE_DFU_INIT_PROCEDURE));
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case BLE_DFU_RECEIVE_APP_DATA:
+            m_pkt_type = PKT_TYPE_FIRMWARE_DATA;
+            break;
+
+        case BLE_DFU_PACKET_WRITE:
+            switch (m_pkt_type)
+            {
+                case PKT_TYPE_START:
+                    procedure = BLE_DFU_START_PROCEDURE;
+                    err_code  = prestage_start(p_dfu, p_evt);
+                    break;
+
+                case PKT_TYPE_INIT:
+                    procedure = BLE_DFU_INIT_PROCEDURE;
+                    if (m_init_packet_length + p_evt->evt.ble_dfu_pkt_write.len > INIT_PACKET_SIZE_MAX)
+                    {
+                        err_code = NRF_ERROR_DATA_SIZE;
+                        break;
+                    }
+                    memcpy((uint8_t *)m_init_packet + m_init_packet_length,
+                           p_evt->evt.ble_dfu_pkt_write.p_data,
+                           p_evt->evt.ble_dfu_pkt_write.len);
+                    m_init_packet_length += p_evt->evt.ble_dfu_pkt_write.len;
+                    err_code              = NRF_SUCCESS;
+                    break;
+
+                case PKT_TYPE_FIRMWARE_DATA:
+                    procedure = BLE_DFU_RECEIVE_APP_PROCEDURE;
+                    err_code  = prestage_data(p_dfu, p_evt);
+                    break;
+
+                default:
+                    // Not possible to tell what the packet is, and no way to tell the peer.
+                    return;
+            }
+            if (err_code != NRF_SUCCESS)
+            {
+                prestage_abort(procedure, err_code);
+            }
+            break;
+
+        case BLE_DFU_VALIDATE:
+            err_code = prestage_validate();
+            if (err_code != NRF_SUCCESS)
+            {
+                prestage_abort(BLE_DFU_VALIDATE_PROCEDURE, err_code);
+            }
+            break;
+
+        case BLE_DFU_ACTIVATE_N_RESET:
+            if (m_prestage_state == PRESTAGE_VALID)
+            {
+                prestage_activate();
+            }
+            break;
+
+        case BLE_DFU_SYS_RESET:
+            // The peer has given up on the update, the application keeps running.
+            m_prestage_state = PRESTAGE_IDLE;
+            m_pkt_type       = PKT_TYPE_INVALID;
+            break;
+
+        case BLE_DFU_PKT_RCPT_NOTIF_ENABLED:
+            m_pkt_rcpt_notif_enabled = true;
+            m_pkt_rcpt_notif_pending = false;
+            m_pkt_notif_target       = p_evt->evt.pkt_rcpt_notif_req.num_of_pkts;
+            m_pkt_notif_target_cnt   = p_evt->evt.pkt_rcpt_notif_req.num_of_pkts;
+            break;
+
+        case BLE_DFU_PKT_RCPT_NOTIF_DISABLED:
+            m_pkt_rcpt_notif_enabled = false;
+            m_pkt_rcpt_notif_pending = false;
+            m_pkt_notif_target       = 0;
+            break;
+
+        case BLE_DFU_BYTES_RECEIVED_SEND:
+            err_code = ble_dfu_bytes_rcvd_report(p_dfu, m_bytes_rcvd);
+            APP_ERROR_CHECK(err_code);
+            break;
+
+        default:
+            break;
+    }
+}
+#endif // DFU_APP_PRESTAGE
+
+
 void dfu_app_on_dfu_evt(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
 {
+#if DFU_APP_PRESTAGE
+    prestage_on_dfu_evt(p_dfu, p_evt);
+#else
     switch (p_evt->ble_dfu_evt_type)
     {
         case BLE_DFU_START:
@@ -174,6 +666,7 @@ void dfu_app_on_dfu_evt(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
             }
             break;
     }
+#endif // DFU_APP_PRESTAGE
 }
 
 
@@ -27,8 +27,21 @@
  *          The host must reconnect and continue the update procedure with 
  *          access to the full DFU Service.
  *
+ *          With @ref DFU_APP_PRESTAGE set, an application image is instead received by the
+ *          running application, written to the swap bank (bank 1) and validated there, while the
+ *          application keeps running. The device only resets into the bootloader when the peer
+ *          activates the validated image, and the bootloader then moves it to bank 0. SoftDevice
+ *          and bootloader updates still reset into the bootloader on the start packet.
+ *
  * @note The application must propagate DFU events to this module by calling
  *       @ref dfu_app_on_dfu_evt from the @ref ble_dfu_evt_handler_t callback.
+ *
+ * @note Pre-staging writes the swap bank through the pstorage raw mode, so
+ *       PSTORAGE_RAW_MODE_ENABLE must be defined in the application's pstorage_platform.h, and
+ *       the application must pass system events to pstorage. The init packet is checked with the
+ *       functions of dfu_init.h, which must be linked into the application along with crc16.c.
+ *       The bootloader must be a dual bank bootloader that handles
+ *       @ref BOOTLOADER_DFU_ACTIVATE_STAGED.
  */
  
 #ifndef DFU_APP_HANDLER_H__
@@ -42,6 +55,14 @@
 #define DFU_APP_ATT_TABLE_POS     0                     /**< Position for the ATT table changed setting. */
 #define DFU_APP_ATT_TABLE_CHANGED 1                     /**< Value indicating that the ATT table might have changed. This value will be set in the application-specific context in Device Manager when entering DFU mode. */
 
+#ifndef DFU_APP_PRESTAGE
+#define DFU_APP_PRESTAGE          0                     /**< Set to 1 to receive application images in the background, and only reset into the bootloader to activate a validated image. */
+#endif
+
+#ifndef DFU_APP_PRESTAGE_PKT_BUFFERS
+#define DFU_APP_PRESTAGE_PKT_BUFFERS 16                 /**< Number of data packets that can wait for their flash write while pre-staging. Packet receipt notifications are held back while packets are waiting, and the notification interval set by the peer must not exceed this. PSTORAGE_CMD_QUEUE_SIZE must be at least this large. */
+#endif
+
 /**@brief DFU application reset_prepare function. This function is a callback that allows the 
  *        application to prepare for an upcoming application reset. 
  */
@@ -31,6 +31,22 @@
 #include "pstorage.h"
 #include "nrf_mbr.h"
 #include "dfu_init.h"
+#include "app_trace.h"
+#include "crc16.h"
+
+#define DFU_LOG                             app_trace_log               /**< A debug logger macro that can be used in this file to do logging information over UART. */
+
+#if DFU_STREAMED_FLASH_WRITE
+#define PAGE_BUFFER_COUNT                   2                           /**< Number of page buffers, one being filled while the other is written to flash. */
+
+/**@brief Buffer collecting data packets for one flash page. */
+typedef struct
+{
+    uint32_t                        data[CODE_PAGE_SIZE / sizeof(uint32_t)];    /**< Data of the page. */
+    uint8_t                       * p_pkt;                                      /**< Data packet to release when the page has been written, NULL if none. */
+    bool                            busy;                                       /**< True while the page is being written to flash. */
+} page_buffer_t;
+#endif
 
 static dfu_state_t                  m_dfu_state;                /**< Current DFU state. */
 static uint32_t                     m_image_size;               /**< Size of the image that will be transmitted. */
@@ -39,6 +55,7 @@ static dfu_start_packet_t           m_start_packet;             /**< Start packe
 static uint8_t                      m_init_packet[64];          /**< Init packet, can hold CRC, Hash, Signed Hash and similar, for image validation, integrety check and authorization checking. */ 
 static uint8_t                      m_init_packet_length;       /**< Length of init packet received. */
 static uint16_t                     m_image_crc;                /**< Calculated CRC of the image received. */
+static uint16_t                     m_stream_crc;               /**< CRC of the data packets received so far, validated against the init packet instead of re-reading the bank. */
 
 static app_timer_id_t               m_dfu_timer_id;             /**< Application timer id. */
 static bool                         m_dfu_timed_out = false;    /**< Boolean flag value for tracking DFU timer timeout state. */
@@ -49,6 +66,13 @@ static pstorage_handle_t          * mp_storage_handle_active;   /**< Pointer to
 
 static dfu_callback_t               m_data_pkt_cb;              /**< Callback from DFU Bank module for notification of asynchronous operation such as flash prepare. */
 static dfu_bank_func_t              m_functions;                /**< Structure holding operations for the selected update process. */
+static uint32_t                     m_transfer_start;           /**< RTC1 counter value when the first data packet was received. */
+
+#if DFU_STREAMED_FLASH_WRITE
+static page_buffer_t                m_page_buffer[PAGE_BUFFER_COUNT];   /**< Page buffers for streaming data packets to flash. */
+static uint8_t                      m_page_buffer_index;        /**< Index of the page buffer being filled. */
+static uint32_t                     m_page_buffer_len;          /**< Number of bytes in the page buffer being filled. */
+#endif
 
 
 /**@brief Function for handling callbacks from pstorage module.
@@ -65,6 +89,22 @@ static void pstorage_callback_handler(pstorage_handle_t * p_handle,
     switch (op_code)
     {
         case PSTORAGE_STORE_OP_CODE:
+#if DFU_STREAMED_FLASH_WRITE
+            for (uint32_t i = 0; i < PAGE_BUFFER_COUNT; i++)
+            {
+                if (p_data == (uint8_t *)m_page_buffer[i].data)
+                {
+                    // Release the data packet held until this page was written.
+                    m_page_buffer[i].busy  = false;
+                    p_data                 = m_page_buffer[i].p_pkt;
+                    m_page_buffer[i].p_pkt = NULL;
+                }
+            }
+            if (p_data == NULL)
+            {
+                break;
+            }
+#endif
             if ((m_dfu_state == DFU_STATE_RX_DATA_PKT) && (m_data_pkt_cb != NULL))
             {
                 m_data_pkt_cb(DATA_PACKET, result, p_data);
@@ -130,6 +170,125 @@ static uint32_t dfu_timer_restart(void)
 }
 
 
+/**@brief   Function for logging the time taken to receive and store the image.
+ *
+ * @note    The RTC1 counter wraps after 512 seconds, so longer transfers are not measured right.
+ */
+static void transfer_time_log(void)
+{
+    uint32_t ticks;
+    uint32_t time_ms;
+
+    UNUSED_VARIABLE(app_timer_cnt_get(&ticks));
+    UNUSED_VARIABLE(app_timer_cnt_diff_compute(ticks, m_transfer_start, &ticks));
+
+    time_ms = (uint32_t)(((uint64_t)ticks * 1000 * (APP_TIMER_PRESCALER + 1)) / APP_TIMER_CLOCK_FREQ);
+
+    DFU_LOG("[DFU]: Received %lu bytes in %lu ms, %lu ms per KB\r\n",
+            (unsigned long)m_image_size,
+            (unsigned long)time_ms,
+            (unsigned long)(((uint64_t)time_ms * 1024) / m_image_size));
+    UNUSED_VARIABLE(time_ms);
+}
+
+
+#if DFU_STREAMED_FLASH_WRITE
+/**@brief   Function for writing the page buffer being filled to flash.
+ *
+ * @details The next page buffer becomes the one being filled.
+ *
+ * @param[in] offset  Offset of the page buffer data in the active bank.
+ *
+ * @return    NRF_SUCCESS on success, an error code from pstorage_store otherwise.
+ */
+static uint32_t page_buffer_store(uint32_t offset)
+{
+    page_buffer_t * p_buffer = &m_page_buffer[m_page_buffer_index];
+    uint32_t        err_code;
+
+    err_code = pstorage_store(mp_storage_handle_active,
+                              (uint8_t *)p_buffer->data,
+                              m_page_buffer_len,
+                              offset);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    p_buffer->busy      = true;
+    m_page_buffer_index = (m_page_buffer_index + 1) % PAGE_BUFFER_COUNT;
+    m_page_buffer_len   = 0;
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief   Function for copying a data packet to the page buffers.
+ *
+ * @details A page buffer is written to flash when it is full or when the image is complete. The
+ *          data packet is released right away, or held until its last page has been written if
+ *          it completed one, so that the transport can notify the peer once the final packet is
+ *          in flash.
+ *
+ * @param[in] p_pkt        Data packet.
+ * @param[in] data_length  Length of the data packet.
+ *
+ * @retval    NRF_SUCCESS     The data packet was handled.
+ * @retval    NRF_ERROR_BUSY  The page buffers needed are still being written to flash. The peer
+ *                            is sending faster than the flash can be written.
+ * @return    An error code from pstorage_store otherwise.
+ */
+static uint32_t data_pkt_stream(uint8_t * p_pkt, uint32_t data_length)
+{
+    page_buffer_t * p_stored   = NULL;
+    uint8_t       * p_data     = p_pkt;
+    uint32_t        offset     = m_data_received;
+    uint32_t        next_index = (m_page_buffer_index + 1) % PAGE_BUFFER_COUNT;
+    uint32_t        err_code;
+
+    if (m_page_buffer[m_page_buffer_index].busy ||
+        (((m_page_buffer_len + data_length) > CODE_PAGE_SIZE) && m_page_buffer[next_index].busy))
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    while (data_length > 0)
+    {
+        page_buffer_t * p_buffer = &m_page_buffer[m_page_buffer_index];
+        uint32_t        length   = MIN(data_length, CODE_PAGE_SIZE - m_page_buffer_len);
+
+        memcpy((uint8_t *)p_buffer->data + m_page_buffer_len, p_data, length);
+        m_page_buffer_len += length;
+        offset            += length;
+        p_data            += length;
+        data_length       -= length;
+
+        if ((m_page_buffer_len == CODE_PAGE_SIZE) || (offset == m_image_size))
+        {
+            err_code = page_buffer_store(offset - m_page_buffer_len);
+            if (err_code != NRF_SUCCESS)
+            {
+                return err_code;
+            }
+            p_stored = p_buffer;
+        }
+    }
+
+    if (p_stored != NULL)
+    {
+        // Flash operations complete in order, so the last page written releases the packet.
+        p_stored->p_pkt = p_pkt;
+    }
+    else if (m_data_pkt_cb != NULL)
+    {
+        m_data_pkt_cb(DATA_PACKET, NRF_SUCCESS, p_pkt);
+    }
+
+    return NRF_SUCCESS;
+}
+#endif
+
+
 /**@brief   Function for preparing of flash before receiving SoftDevice image.
  *
  * @details This function will erase current application area to ensure sufficient amount of
@@ -331,6 +490,12 @@ uint32_t dfu_init(void)
     m_data_received = 0;
     m_dfu_state     = DFU_STATE_IDLE;
 
+#if DFU_STREAMED_FLASH_WRITE
+    memset(m_page_buffer, 0, sizeof(m_page_buffer));
+    m_page_buffer_index = 0;
+    m_page_buffer_len   = 0;
+#endif
+
     return NRF_SUCCESS;
 }
 
@@ -475,15 +640,32 @@ uint32_t dfu_data_pkt_handle(dfu_update_packet_t * p_packet)
 
             p_data = (uint32_t *)p_packet->params.data_packet.p_data_packet;
 
+            if (m_data_received == 0)
+            {
+                UNUSED_VARIABLE(app_timer_cnt_get(&m_transfer_start));
+            }
+
+            // Calculate the CRC before the packet is handed on, as the stream may release it at
+            // once. It only takes effect if the packet is accepted. Flash write failures are
+            // fatal in the pstorage callback, so the flash holds what the CRC covers.
+            uint16_t stream_crc = crc16_compute((uint8_t *)p_data,
+                                                data_length,
+                                                (m_data_received == 0) ? NULL : &m_stream_crc);
+
+#if DFU_STREAMED_FLASH_WRITE
+            err_code = data_pkt_stream((uint8_t *)p_data, data_length);
+#else
             err_code = pstorage_store(mp_storage_handle_active,
                                           (uint8_t *)p_data,
                                           data_length,
                                           m_data_received);
+#endif
             if (err_code != NRF_SUCCESS)
             {
                 return err_code;
             }
 
+            m_stream_crc     = stream_crc;
             m_data_received += data_length;
 
             if (m_data_received != m_image_size)
@@ -599,13 +781,13 @@ uint32_t dfu_image_validate()
             else
             {
                 m_dfu_state = DFU_STATE_VALIDATE;
+                transfer_time_log();
 
                 // Valid peer activity detected. Hence restart the DFU timer.
                 err_code = dfu_timer_restart();
                 if (err_code == NRF_SUCCESS)
                 {
-                    err_code = dfu_init_postvalidate((uint8_t *)mp_storage_handle_active->block_id,
-                                                     m_image_size);
+                    err_code = dfu_init_postvalidate_crc(m_stream_crc);
                     if (err_code != NRF_SUCCESS)
                     {
                         return err_code;
@@ -649,6 +831,41 @@ uint32_t dfu_image_activate()
 }
 
 
+uint32_t dfu_staged_image_activate(uint32_t image_size, uint16_t image_crc)
+{
+    uint32_t err_code;
+
+    if ((image_size == 0) || (image_size > DFU_STAGED_IMAGE_MAX_SIZE))
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    switch (m_dfu_state)
+    {
+        case DFU_STATE_IDLE:
+            // No peer to monitor, the image was received by the application.
+            err_code = app_timer_stop(m_dfu_timer_id);
+            APP_ERROR_CHECK(err_code);
+
+            m_start_packet.dfu_update_mode = DFU_UPDATE_APP;
+            m_start_packet.sd_image_size   = 0;
+            m_start_packet.bl_image_size   = 0;
+            m_start_packet.app_image_size  = image_size;
+            m_image_crc                    = image_crc;
+            m_dfu_state                    = DFU_STATE_WAIT_4_ACTIVATE;
+
+            err_code = dfu_activate_app();
+            break;
+
+        default:
+            err_code = NRF_ERROR_INVALID_STATE;
+            break;
+    }
+
+    return err_code;
+}
+
+
 void dfu_reset(void)
 {
     dfu_update_status_t update_status;
@@ -129,6 +129,19 @@ uint32_t dfu_init_prevalidate(uint8_t * p_init_data, uint32_t init_data_len);
  */
 uint32_t dfu_init_postvalidate(uint8_t * p_image, uint32_t image_len);
 
+/**@brief DFU postvalidate call for checking a CRC calculated while the image was received.
+ *
+ * @details  Used instead of @ref dfu_init_postvalidate when the image CRC is accumulated while
+ *           streaming the data packets to flash, see DFU_STREAMED_FLASH_WRITE, which saves reading
+ *           back the whole image.
+ *
+ * @param[in] image_crc  CRC16 calculated over the received image.
+ *
+ * @retval NRF_SUCCESS             If the CRC matches the CRC of the init packet.
+ * @retval NRF_ERROR_INVALID_DATA  If the CRC does not match the CRC of the init packet.
+ */
+uint32_t dfu_init_postvalidate_crc(uint16_t image_crc);
+
 #endif // DFU_INIT_H__
 
 /**@} */
@@ -132,7 +132,6 @@ uint32_t dfu_init_prevalidate(uint8_t * p_init_data, uint32_t init_data_len)
 uint32_t dfu_init_postvalidate(uint8_t * p_image, uint32_t image_len)
 {
     uint16_t image_crc;
-    uint16_t received_crc;
     
     // In order to support hashing (and signing) then the (decrypted) hash should be fetched and
     // the corresponding hash should be calculated over the image at this location.
@@ -141,6 +140,14 @@ uint32_t dfu_init_postvalidate(uint8_t * p_image, uint32_t image_len)
     // calculate CRC from active block.
     image_crc = crc16_compute(p_image, image_len, NULL);
 
+    return dfu_init_postvalidate_crc(image_crc);
+}
+
+
+uint32_t dfu_init_postvalidate_crc(uint16_t image_crc)
+{
+    uint16_t received_crc;
+
     // Decode the received CRC from extended data.    
     received_crc = uint16_decode((uint8_t *)&m_extended_packet[0]);
 
@@ -598,6 +598,13 @@ uint32_t dfu_image_activate()
 }
 
 
+uint32_t dfu_staged_image_activate(uint32_t image_size, uint16_t image_crc)
+{
+    // Single bank has no swap area for the application to stage an image in.
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+
 void dfu_reset(void)
 {
     dfu_update_status_t update_status;
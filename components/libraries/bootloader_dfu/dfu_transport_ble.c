@@ -111,6 +111,10 @@ static dfu_ble_peer_data_t  m_ble_peer_data;
 static bool                 m_ble_peer_data_valid    = false;                                        /**< True if BLE Peer data has been exchanged from application. */
 static uint32_t             m_direct_adv_cnt         = APP_DIRECTED_ADV_TIMEOUT;                     /**< Counter of direct advertisements. */
 static uint8_t            * mp_final_packet;                                                         /**< Pointer to final data packet received. When callback for succesful packet handling is received from dfu bank handling a transfer complete response can be sent to peer. */
+#if DFU_STREAMED_FLASH_WRITE
+static uint16_t             m_pkts_in_flash          = 0;                                            /**< Number of firmware data packets handed to the DFU module and not yet released. Packets are held while their page is written to flash. */
+static bool                 m_pkt_rcpt_notif_pending = false;                                        /**< Variable to indicate that a Packet Receipt Notification is held back until the pending flash writes are done. */
+#endif
 
 
 /**@brief     Function updating Service Changed CCCD and indicate a service change to peer.
@@ -243,6 +247,18 @@ static void dfu_cb_handler(uint32_t packet, uint32_t result, uint8_t * p_data)
                 err_code = hci_mem_pool_rx_consume(p_data);
                 APP_ERROR_CHECK(err_code);
 
+#if DFU_STREAMED_FLASH_WRITE
+                m_pkts_in_flash--;
+                if ((m_pkts_in_flash == 0) && m_pkt_rcpt_notif_pending)
+                {
+                    // The flash has caught up, let the peer send the next window of packets.
+                    m_pkt_rcpt_notif_pending = false;
+
+                    err_code = ble_dfu_pkts_rcpt_notify(&m_dfu, m_num_of_firmware_bytes_rcvd);
+                    APP_ERROR_CHECK(err_code);
+                }
+#endif
+
                 // If the callback matches final data packet received then the peer is notified.
                 if (mp_final_packet == p_data)
                 {
@@ -445,6 +461,11 @@ static void app_data_process(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
     dfu_pkt.params.data_packet.packet_length = length / sizeof(uint32_t);
     dfu_pkt.params.data_packet.p_data_packet = (uint32_t *)mp_rx_buffer;
 
+#if DFU_STREAMED_FLASH_WRITE
+    // Counted before the call, as the DFU module can release the packet before returning.
+    m_pkts_in_flash++;
+#endif
+
     err_code = dfu_data_pkt_handle(&dfu_pkt);
 
     if (err_code == NRF_SUCCESS)
@@ -469,8 +490,16 @@ static void app_data_process(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
 
             if (m_pkt_notif_target_cnt == 0)
             {
-                err_code = ble_dfu_pkts_rcpt_notify(p_dfu, m_num_of_firmware_bytes_rcvd);
-                APP_ERROR_CHECK(err_code);
+#if DFU_STREAMED_FLASH_WRITE
+                // Hold the notification back while pages are being written to flash, so that
+                // the next window of packets does not overrun the page buffers.
+                m_pkt_rcpt_notif_pending = (m_pkts_in_flash != 0);
+                if (!m_pkt_rcpt_notif_pending)
+#endif
+                {
+                    err_code = ble_dfu_pkts_rcpt_notify(p_dfu, m_num_of_firmware_bytes_rcvd);
+                    APP_ERROR_CHECK(err_code);
+                }
 
                 // Reset the counter for the number of firmware packets.
                 m_pkt_notif_target_cnt = m_pkt_notif_target;
@@ -480,6 +509,10 @@ static void app_data_process(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
     else
     {
         uint32_t hci_error = hci_mem_pool_rx_consume(mp_rx_buffer);
+
+#if DFU_STREAMED_FLASH_WRITE
+        m_pkts_in_flash--;
+#endif
         if (hci_error != NRF_SUCCESS)
         {
             dfu_error_notify(p_dfu, hci_error);
@@ -632,11 +665,17 @@ static void on_dfu_evt(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
             m_pkt_rcpt_notif_enabled = true;
             m_pkt_notif_target       = p_evt->evt.pkt_rcpt_notif_req.num_of_pkts;
             m_pkt_notif_target_cnt   = p_evt->evt.pkt_rcpt_notif_req.num_of_pkts;
+#if DFU_STREAMED_FLASH_WRITE
+            m_pkt_rcpt_notif_pending = false;
+#endif
             break;
 
         case BLE_DFU_PKT_RCPT_NOTIF_DISABLED:
             m_pkt_rcpt_notif_enabled = false;
             m_pkt_notif_target       = 0;
+#if DFU_STREAMED_FLASH_WRITE
+            m_pkt_rcpt_notif_pending = false;
+#endif
             break;
 
        case BLE_DFU_BYTES_RECEIVED_SEND:
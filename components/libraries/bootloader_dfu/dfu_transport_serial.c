@@ -19,6 +19,11 @@
 #include "hci_transport.h"
 #include "app_timer.h"
 #include "app_scheduler.h"
+#include "hci_transport_config.h"
+
+#if HCI_LARGE_FRAMES && !DFU_STREAMED_FLASH_WRITE
+#error "HCI_LARGE_FRAMES requires DFU_STREAMED_FLASH_WRITE, so that the data is copied out of the frame before it is released."
+#endif
 
 #define MAX_BUFFERS          4u                                                      /**< Maximum number of buffers that can be received queued without being consumed. */
 
@@ -29,11 +34,11 @@
 
 /** Provides status showing if the queue is full or not. */
 #define DATA_QUEUE_FULL()                                                                         \
-        (((MAX_BUFFERS -1) == m_data_queue.count) ? true : false)
+        ((((m_data_queue.tail + 1) % MAX_BUFFERS) == m_data_queue.head) ? true : false)
 
 /** Provides status showing if the queue is empty or not */
 #define DATA_QUEUE_EMPTY()                                                                        \
-        ((0 == m_data_queue.count) ? true : false)
+        ((m_data_queue.tail == m_data_queue.head) ? true : false)
 
 /** Initializes an element of the data queue. */
 #define DATA_QUEUE_ELEMENT_INIT(i)                                                                \
@@ -61,14 +66,20 @@
 
 /* @} */
 
-/** Abstracts data packet queue */
+/** Abstracts data packet queue. Packets are processed in the order they were received. The
+ *  queue is only added to from the transport event handler and only removed from in the
+ *  scheduler, so each index has a single writer. */
 typedef struct
 {
     dfu_update_packet_t   data_packet[MAX_BUFFERS];                                  /**< Bootloader data packets used when processing data from the UART. */
-    volatile uint8_t      count;                                                     /**< Counter to maintain number of elements in the queue. */
+    volatile uint8_t      head;                                                      /**< Index of the oldest element in the queue, the next one to be processed. */
+    volatile uint8_t      tail;                                                      /**< Index of the element the next received packet is stored in. */
 } dfu_data_queue_t;
 
 static dfu_data_queue_t      m_data_queue;                                           /**< Received-data packet queue. */
+#if DFU_STREAMED_FLASH_WRITE
+static bool                  m_data_pkt_held;                                        /**< True while the oldest data packet waits for a page buffer to be written to flash. */
+#endif
 
 /**@brief Initializes an element of the data buffer queue.
  *
@@ -87,7 +98,8 @@ static void data_queue_init(void)
 {
     uint32_t index;
 
-    m_data_queue.count = 0;
+    m_data_queue.head = 0;
+    m_data_queue.tail = 0;
 
     for (index = 0; index < MAX_BUFFERS; index++)
     {
@@ -95,33 +107,27 @@ static void data_queue_init(void)
     }
 }
 
-/**@brief Function for freeing an element.
- *
- * @param[in] element_index index of the element.
- */
-static uint32_t data_queue_element_free(uint8_t element_index)
+/**@brief Function for freeing the oldest element of the queue. */
+static uint32_t data_queue_element_free(void)
 {
     uint8_t * p_data;
+    uint8_t   element_index;
     uint32_t  retval;
 
-    retval = NRF_ERROR_INVALID_PARAM;
-    
-    if (MAX_BUFFERS > element_index)
-    {
-        p_data = (uint8_t *)DATA_QUEUE_ELEMENT_GET_PDATA(element_index);
-        if (INVALID_PACKET != DATA_QUEUE_ELEMENT_GET_PTYPE(element_index))
-        {
-            m_data_queue.count--;
-            data_queue_element_init (element_index);
-            retval = hci_transport_rx_pkt_consume((p_data - 4));
-            APP_ERROR_CHECK(retval);
-        }
-    }
-    else
+    if (true == DATA_QUEUE_EMPTY())
     {
-        return NRF_ERROR_INVALID_PARAM;
+        return NRF_ERROR_INVALID_STATE;
     }
 
+    element_index = m_data_queue.head;
+    p_data        = (uint8_t *)DATA_QUEUE_ELEMENT_GET_PDATA(element_index);
+
+    data_queue_element_init(element_index);
+    m_data_queue.head = (element_index + 1) % MAX_BUFFERS;
+
+    retval = hci_transport_rx_pkt_consume((p_data - 4));
+    APP_ERROR_CHECK(retval);
+
     return NRF_SUCCESS;
 }
 
@@ -133,10 +139,7 @@ static uint32_t data_queue_element_free(uint8_t element_index)
 static uint32_t data_queue_element_alloc(uint8_t * p_element_index, uint8_t packet_type)
 {
     uint32_t retval;
-    uint32_t index;
 
-    retval = NRF_ERROR_NO_MEM;
-    
     if (INVALID_PACKET == packet_type)
     {
         retval = NRF_ERROR_INVALID_PARAM;
@@ -147,36 +150,34 @@ static uint32_t data_queue_element_alloc(uint8_t * p_element_index, uint8_t pack
     }
     else
     {
-        for (index = 0; index < MAX_BUFFERS; index++)
-        {
-            if (INVALID_PACKET == DATA_QUEUE_ELEMENT_GET_PTYPE(index))
-            {
-                // Found a free element: allocate, and end search.
-                *p_element_index = index;
-                DATA_QUEUE_ELEMENT_SET_PTYPE(index, packet_type);
-                retval = NRF_SUCCESS;
-                m_data_queue.count++;
-                break;
-            }
-        }
+        *p_element_index = m_data_queue.tail;
+        DATA_QUEUE_ELEMENT_SET_PTYPE(m_data_queue.tail, packet_type);
+        retval = NRF_SUCCESS;
     }
 
     return retval;
 }
 
+
+/**@brief Function for adding the last allocated element to the queue, once it has been filled. */
+static void data_queue_element_commit(void)
+{
+    m_data_queue.tail = (m_data_queue.tail + 1) % MAX_BUFFERS;
+}
+
 // Flush everything on disconnect or stop.
 static void data_queue_flush(void)
 {
-    uint32_t index;
-
-    for (index = 0; index < MAX_BUFFERS; index++)
+    while (false == DATA_QUEUE_EMPTY())
     {
-         // In this case it does not matter if free succeeded or not as data packets are being flushed because DFU Trnsport was closed
-        (void)data_queue_element_free(index);
+        (void)data_queue_element_free();
     }
 }
 
 
+static void process_dfu_packet(void * p_event_data, uint16_t event_size);
+
+
 /**@brief       Function for handling the callback events from the dfu module.
  *              Callbacks are expected when \ref dfu_data_pkt_handle has been executed.
  *
@@ -187,6 +188,16 @@ static void data_queue_flush(void)
 static void dfu_cb_handler(uint32_t packet, uint32_t result, uint8_t * p_data)
 {
     APP_ERROR_CHECK(result);
+
+#if DFU_STREAMED_FLASH_WRITE
+    if ((packet == DATA_PACKET) && m_data_pkt_held)
+    {
+        // A page has been written to flash: resume the data packet held back for a page buffer.
+        m_data_pkt_held = false;
+        result = app_sched_event_put(NULL, 0, process_dfu_packet);
+        APP_ERROR_CHECK(result);
+    }
+#endif
 }
 
 
@@ -198,49 +209,54 @@ static void process_dfu_packet(void * p_event_data, uint16_t event_size)
 
         while (false == DATA_QUEUE_EMPTY())
         {
-            // Fetch the element to be processed.
-            for (index = 0; index < MAX_BUFFERS ; index++)
-            {
-                packet = &m_data_queue.data_packet[index];
-                if (INVALID_PACKET != packet->packet_type)
-                {
+            // Fetch the oldest element to be processed.
+            index  = m_data_queue.head;
+            packet = &m_data_queue.data_packet[index];
 
-                    switch (DATA_QUEUE_ELEMENT_GET_PTYPE(index))
+            switch (DATA_QUEUE_ELEMENT_GET_PTYPE(index))
+            {
+                case DATA_PACKET:
+                    retval = dfu_data_pkt_handle(packet);
+#if DFU_STREAMED_FLASH_WRITE
+                    if (retval == NRF_ERROR_BUSY)
                     {
-                        case DATA_PACKET:
-                            (void)dfu_data_pkt_handle(packet);
-                            break;
-
-                        case START_PACKET:
-                            packet->params.start_packet = 
-                                (dfu_start_packet_t*)packet->params.data_packet.p_data_packet;
-                            retval = dfu_start_pkt_handle(packet);
-                            APP_ERROR_CHECK(retval);
-                            break;
-
-                        case INIT_PACKET:
-                            (void)dfu_init_pkt_handle(packet);
-                            retval = dfu_init_pkt_complete();
-                            APP_ERROR_CHECK(retval);
-                            break;
-
-                        case STOP_DATA_PACKET:
-                            (void)dfu_image_validate();
-                            (void)dfu_image_activate();
-
-                            // Break the loop by returning.
-                            return;
-
-                        default:
-                            // No implementation needed.
-                            break;
+                        // Both page buffers are being written to flash. Keep the packet and
+                        // the ones behind it until a page is done. Once the HCI buffers run
+                        // out, frames are not acknowledged and the peer resends them.
+                        m_data_pkt_held = true;
+                        return;
                     }
+#endif
+                    break;
 
-                    // Free the processed element.
-                    retval = data_queue_element_free(index);
+                case START_PACKET:
+                    packet->params.start_packet = 
+                        (dfu_start_packet_t*)packet->params.data_packet.p_data_packet;
+                    retval = dfu_start_pkt_handle(packet);
                     APP_ERROR_CHECK(retval);
-                }
+                    break;
+
+                case INIT_PACKET:
+                    (void)dfu_init_pkt_handle(packet);
+                    retval = dfu_init_pkt_complete();
+                    APP_ERROR_CHECK(retval);
+                    break;
+
+                case STOP_DATA_PACKET:
+                    (void)dfu_image_validate();
+                    (void)dfu_image_activate();
+
+                    // Break the loop by returning.
+                    return;
+
+                default:
+                    // No implementation needed.
+                    break;
             }
+
+            // Free the processed element.
+            retval = data_queue_element_free();
+            APP_ERROR_CHECK(retval);
         }
 }
 
@@ -262,7 +278,12 @@ void rpc_transport_event_handler(hci_transport_evt_t event)
             //subtract 1 since we are interested in payload length and not the type field.
             DATA_QUEUE_ELEMENT_SET_PLEN(element_index,(rpc_cmd_length_read / sizeof(uint32_t)) - 1);
             DATA_QUEUE_ELEMENT_COPY_PDATA(element_index, &p_rpc_cmd_buffer[4]);
-            retval = app_sched_event_put(NULL, 0, process_dfu_packet);
+            data_queue_element_commit();
+
+            // The packet is queued now, and is processed with the next scheduled packet should
+            // scheduling fail.
+            (void)app_sched_event_put(NULL, 0, process_dfu_packet);
+            return;
         }
     }
     
@@ -281,6 +302,9 @@ uint32_t dfu_transport_update_start(void)
 
     // Initialize data buffer queue.
     data_queue_init();
+#if DFU_STREAMED_FLASH_WRITE
+    m_data_pkt_held = false;
+#endif
 
     dfu_register_callback(dfu_cb_handler);
 
@@ -68,6 +68,15 @@ typedef struct
 #define CODE_PAGE_SIZE                  0x0400                                                          /**< Size of a flash codepage. Used for size of the reserved flash space in the bootloader region. Will be runtime checked against NRF_UICR->CODEPAGESIZE to ensure the region is correct. */
 #define EMPTY_FLASH_MASK                0xFFFFFFFF                                                      /**< Bit mask that defines an empty address in flash. */
 
+#define DFU_STAGED_INFO_SIZE            12                                                              /**< Size of the information on an image staged in bank 1 by the application, see @ref dfu_staged_image_t. */
+#define DFU_STAGED_INFO_ADDRESS         (DFU_BANK_1_REGION_START + DFU_IMAGE_MAX_SIZE_BANKED - DFU_STAGED_INFO_SIZE) /**< Location of the information on an image staged by the application, at the end of bank 1. */
+#define DFU_STAGED_IMAGE_MAX_SIZE       (DFU_IMAGE_MAX_SIZE_BANKED - DFU_STAGED_INFO_SIZE)              /**< Maximum size of an application image staged by the application. */
+#define DFU_STAGED_IMAGE_MAGIC          0x57A6ED01                                                      /**< Marks valid information on a staged image. */
+
+#ifndef DFU_STREAMED_FLASH_WRITE
+#define DFU_STREAMED_FLASH_WRITE        0                                                               /**< Set to 1 to collect data packets in two page buffers and write the flash one page at a time. The BLE transport then holds back packet receipt notifications until the buffered pages are written, so that notification windows of up to one page of data are safe. */
+#endif
+
 #define INVALID_PACKET                  0x00                                                            /**< Invalid packet identifies. */
 #define INIT_PACKET                     0x01                                                            /**< Packet identifies for initialization packet. */
 #define STOP_INIT_PACKET                0x02                                                            /**< Packet identifies for stop initialization packet. Used when complete init packet has been received so that the init packet can be used for pre validaiton. */
@@ -140,6 +149,19 @@ typedef struct
     uint32_t                 sd_image_start;                                                            /**< Location in flash where the received SoftDevice image is stored. */
 } dfu_update_status_t;
 
+/**@brief Information on an application image received and validated in bank 1 by the running
+ *        application, written at @ref DFU_STAGED_INFO_ADDRESS. The bootloader moves the image to
+ *        bank 0 when the application resets into it with @ref BOOTLOADER_DFU_ACTIVATE_STAGED.
+ */
+typedef struct
+{
+    uint32_t magic;                                                                                     /**< @ref DFU_STAGED_IMAGE_MAGIC. */
+    uint32_t image_size;                                                                                /**< Size of the staged image. */
+    uint32_t image_crc;                                                                                 /**< CRC-16 of the staged image. */
+} dfu_staged_image_t;
+
+STATIC_ASSERT(sizeof(dfu_staged_image_t) == DFU_STAGED_INFO_SIZE);
+
 /**@brief Update complete handler type. */
 typedef void (*dfu_complete_handler_t)(dfu_update_status_t dfu_update_status);
 
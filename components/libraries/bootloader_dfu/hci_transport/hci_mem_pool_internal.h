@@ -22,8 +22,16 @@
 #ifndef MEM_POOL_INTERNAL_H__
 #define MEM_POOL_INTERNAL_H__
 
+#ifndef HCI_LARGE_FRAMES
+#define HCI_LARGE_FRAMES  0      /**< Set to 1 to receive frames of up to one flash page of data, see \ref hci_transport_config.h. */
+#endif
+
 #define TX_BUF_SIZE       32u    /**< TX buffer size in bytes. */
+#if HCI_LARGE_FRAMES
+#define RX_BUF_SIZE       1040u  /**< RX buffer size in bytes. Holds 1024 bytes of data with the HCI packet header, the DFU packet type and the CRC. */
+#else
 #define RX_BUF_SIZE       600u   /**< RX buffer size in bytes. */
+#endif
 
 #define RX_BUF_QUEUE_SIZE 2u     /**< RX buffer element size. */
  
@@ -28,6 +28,47 @@ static app_timer_id_t                 m_detection_delay_timer_id;  /**< Polling
 
 static uint32_t m_pin_state;
 static uint32_t m_pin_transition;
+static uint32_t m_long_push_delay;                                 /**< Time a button must be held to be reported as long pushed, 0 if disabled. */
+static uint32_t m_long_push_pins;                                  /**< Pushed buttons not yet reported as long pushed. */
+static uint32_t m_long_push_start;                                 /**< RTC counter value when the last button was reported as pushed. */
+
+/**@brief Function for reporting long pushes, or waiting for them with the detection delay timer.
+ *
+ * @details All buttons share one long push countdown, restarted each time a button is reported as
+ *          pushed, so the timer that debounces the buttons also times the long pushes.
+ */
+static void long_push_process(void)
+{
+    uint32_t now;
+    uint32_t elapsed;
+    uint8_t  i;
+
+    if (m_long_push_pins == 0)
+    {
+        return;
+    }
+
+    (void)app_timer_cnt_get(&now);
+    (void)app_timer_cnt_diff_compute(now, m_long_push_start, &elapsed);
+
+    if ((elapsed + APP_TIMER_MIN_TIMEOUT_TICKS) < m_long_push_delay)
+    {
+        // The impact of the app_timer queue running full is losing a long push.
+        (void)app_timer_start(m_detection_delay_timer_id, m_long_push_delay - elapsed, NULL);
+        return;
+    }
+
+    for (i = 0; i < m_button_count; i++)
+    {
+        app_button_cfg_t * p_btn = &mp_buttons[i];
+        uint32_t btn_mask = 1 << p_btn->pin_no;
+        if ((btn_mask & m_long_push_pins) && p_btn->button_handler)
+        {
+            p_btn->button_handler(p_btn->pin_no, APP_BUTTON_LONG_PUSH);
+        }
+    }
+    m_long_push_pins = 0;
+}
 
 /**@brief Function for handling the timeout that delays reporting buttons as pushed.
  *
@@ -58,6 +99,16 @@ static void detection_delay_timeout_handler(void * p_context)
             {
                 uint32_t transition = !(pin_is_set ^ (p_btn->active_state == APP_BUTTON_ACTIVE_HIGH));
 
+                if ((transition == APP_BUTTON_PUSH) && (m_long_push_delay != 0))
+                {
+                    m_long_push_pins |= btn_mask;
+                    (void)app_timer_cnt_get(&m_long_push_start);
+                }
+                else
+                {
+                    m_long_push_pins &= ~btn_mask;
+                }
+
                 if (p_btn->button_handler)
                 {
                     p_btn->button_handler(p_btn->pin_no, transition);
@@ -65,6 +116,8 @@ static void detection_delay_timeout_handler(void * p_context)
             }
         }
     }
+
+    long_push_process();
 }
 
 static void gpiote_event_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
@@ -95,7 +148,16 @@ static void gpiote_event_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t
             m_pin_state &= ~(pin_mask);
         }
         m_pin_transition |= (pin_mask);
+    }
+    else
+    {
+        m_pin_transition &= ~pin_mask;
+    }
 
+    // The timer is shared by all buttons, so it is restarted as long as any of them is bouncing
+    // or waiting for a long push.
+    if ((m_pin_transition != 0) || (m_long_push_pins != 0))
+    {
         err_code = app_timer_start(m_detection_delay_timer_id, m_detection_delay, NULL);
         if (err_code != NRF_SUCCESS)
         {
@@ -103,10 +165,6 @@ static void gpiote_event_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t
             // The current implementation ensures that the system will continue working as normal.
         }
     }
-    else
-    {
-        m_pin_transition &= ~pin_mask;
-    }
 }
 
 uint32_t app_button_init(app_button_cfg_t *             p_buttons,
@@ -134,8 +192,10 @@ uint32_t app_button_init(app_button_cfg_t *             p_buttons,
     m_button_count      = button_count;
     m_detection_delay   = detection_delay;
 
-    m_pin_state      = 0;
-    m_pin_transition = 0;
+    m_pin_state       = 0;
+    m_pin_transition  = 0;
+    m_long_push_delay = 0;
+    m_long_push_pins  = 0;
     
     while (button_count--)
     {
@@ -181,11 +241,31 @@ uint32_t app_button_disable(void)
        nrf_drv_gpiote_in_event_disable(mp_buttons[i].pin_no);
     }
 
+    m_pin_transition = 0;
+    m_long_push_pins = 0;
+
     // Make sure polling timer is not running.
     return app_timer_stop(m_detection_delay_timer_id);
 }
 
 
+uint32_t app_button_long_push_delay_set(uint32_t long_push_delay)
+{
+    if (mp_buttons == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((long_push_delay != 0) && (long_push_delay <= m_detection_delay))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_long_push_delay = long_push_delay;
+
+    return NRF_SUCCESS;
+}
+
+
 uint32_t app_button_is_pushed(uint8_t button_id, bool * p_is_pushed)
 {
     ASSERT(button_id <= m_button_count);
@@ -18,11 +18,14 @@
  *
  * @brief Buttons handling module.
  *
- * @details The button handler uses the @ref app_gpiote to detect that a button has been
- *          pushed. To handle debouncing, it will start a timer in the GPIOTE event handler.
- *          The button will only be reported as pushed if the corresponding pin is still active when
- *          the timer expires. If there is a new GPIOTE event while the timer is running, the timer
- *          is restarted.
+ * @details The button handler uses the GPIOTE PORT event to detect that a button has been
+ *          pushed, so all buttons share one low power interrupt. To handle debouncing, it will start
+ *          a timer in the GPIOTE event handler. The button will only be reported as pushed if the
+ *          corresponding pin is still active when the timer expires. If there is a new GPIOTE event
+ *          while the timer is running, the timer is restarted.
+ *
+ *          Buttons held for the delay given to @ref app_button_long_push_delay_set are reported
+ *          with @ref APP_BUTTON_LONG_PUSH, timed by the same timer.
  *
  * @note    The app_button module uses the app_timer module. The user must ensure that the queue in
  *          app_timer is large enough to hold the app_timer_stop() / app_timer_start() operations
@@ -44,6 +47,7 @@
 
 #define APP_BUTTON_PUSH        1                               /**< Indicates that a button is pushed. */
 #define APP_BUTTON_RELEASE     0                               /**< Indicates that a button is released. */
+#define APP_BUTTON_LONG_PUSH   2                               /**< Indicates that a button has been held for the long push delay. */
 #define APP_BUTTON_ACTIVE_HIGH 1                               /**< Indicates that a button is active high. */
 #define APP_BUTTON_ACTIVE_LOW  0                               /**< Indicates that a button is active low. */
 
@@ -97,6 +101,20 @@ uint32_t app_button_enable(void);
  */
 uint32_t app_button_disable(void);
 
+/**@brief Function for enabling the reporting of long pushes.
+ *
+ * @details A button still pushed this long after it has been reported as pushed is reported with
+ *          @ref APP_BUTTON_LONG_PUSH, once, before its release. The delay is counted from the last
+ *          button reported as pushed, so buttons pushed together are reported together.
+ *
+ * @param[in]  long_push_delay   Delay in app_timer ticks, 0 to disable long pushes (the default).
+ *
+ * @retval     NRF_SUCCESS               Delay set.
+ * @retval     NRF_ERROR_INVALID_STATE   The module is not initialized.
+ * @retval     NRF_ERROR_INVALID_PARAM   The delay is not longer than the detection delay.
+ */
+uint32_t app_button_long_push_delay_set(uint32_t long_push_delay);
+
 /**@brief Function for checking if a button is currently being pushed.
  *
  * @param[in]  button_id     Button index (in the app_button_cfg_t array given to app_button_init) to be checked.
@@ -24,6 +24,14 @@
 
 #include <stdint.h>
 
+#define CRC16_IMPL_BITWISE      0       /**< One byte per round with shifts and XORs, no tables. */
+#define CRC16_IMPL_TABLE        1       /**< One byte per round with a 512 byte lookup table in flash. */
+#define CRC16_IMPL_SLICE_BY_4   2       /**< Four bytes per round with 2 kB of lookup tables in flash. */
+
+#ifndef CRC16_IMPL
+#define CRC16_IMPL              CRC16_IMPL_BITWISE  /**< Implementation of @ref crc16_compute, trading flash for speed. The result is the same for all. */
+#endif
+
 /**@brief Function for calculating CRC-16 in blocks.
  *
  * Feed each consecutive data block into this function, along with the current value of p_crc as 
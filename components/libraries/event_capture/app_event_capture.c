@@ -0,0 +1,309 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "app_event_capture.h"
+#include "nrf_drv_timer.h"
+#include "nrf_drv_ppi.h"
+#include "nrf_drv_gpiote.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nrf_assert.h"
+#include "nordic_common.h"
+
+#define NO_PIN 0xFFFFFFFF                                        /**< Channel not connected to a pin. */
+#define NOW_CC_CHANNEL ((nrf_timer_cc_channel_t)APP_EVENT_CAPTURE_MAX_CHANNELS) /**< CC register used by app_event_capture_now. */
+
+STATIC_ASSERT(IS_POWER_OF_TWO(APP_EVENT_CAPTURE_BUFFER_SIZE));
+
+/**@brief Capture channel control block. */
+typedef struct
+{
+    nrf_ppi_channel_t ppi_channel; /**< PPI channel connecting the event to the CAPTURE task. */
+    uint32_t          pin;         /**< Pin of the channel, NO_PIN for other events. */
+} capture_channel_t;
+
+static nrf_drv_timer_t const *    mp_timer;                                  /**< Timer used as time base, NULL when not initialized. */
+static capture_channel_t          m_channels[APP_EVENT_CAPTURE_MAX_CHANNELS]; /**< Allocated capture channels. */
+static uint8_t                    m_channel_count;                           /**< Number of allocated capture channels. */
+static uint32_t                   m_counter_mask;                            /**< Mask of the timer bit width. */
+static app_event_capture_sample_t m_samples[APP_EVENT_CAPTURE_BUFFER_SIZE];  /**< Buffered timestamps. */
+static volatile uint32_t          m_write_pos;                               /**< Number of timestamps buffered. */
+static volatile uint32_t          m_read_pos;                                /**< Number of timestamps read. */
+static uint32_t                   m_drop_count;                              /**< Number of timestamps dropped. */
+
+
+/**@brief Timer event handler, the timer interrupts are not used. */
+static void timer_event_handler(nrf_timer_event_t event_type, void * p_context)
+{
+    UNUSED_PARAMETER(event_type);
+    UNUSED_PARAMETER(p_context);
+}
+
+
+/**@brief GPIOTE event handler of the pin channels. */
+static void pin_event_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    uint8_t i;
+
+    UNUSED_PARAMETER(action);
+
+    for (i = 0; i < m_channel_count; i++)
+    {
+        if (m_channels[i].pin == pin)
+        {
+            app_event_capture_store(i);
+            return;
+        }
+    }
+}
+
+
+uint32_t app_event_capture_init(nrf_drv_timer_t const * p_timer, nrf_drv_timer_config_t const * p_config)
+{
+    uint32_t err_code;
+
+    if (mp_timer != NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    err_code = nrf_drv_ppi_init();
+    if ((err_code != NRF_SUCCESS) && (err_code != MODULE_ALREADY_INITIALIZED))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    err_code = nrf_drv_timer_init(p_timer, p_config, timer_event_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    switch (p_timer->p_reg->BITMODE)
+    {
+        case NRF_TIMER_BIT_WIDTH_8:
+            m_counter_mask = 0xFF;
+            break;
+
+        case NRF_TIMER_BIT_WIDTH_24:
+            m_counter_mask = 0xFFFFFF;
+            break;
+
+        case NRF_TIMER_BIT_WIDTH_32:
+            m_counter_mask = 0xFFFFFFFF;
+            break;
+
+        default:
+            m_counter_mask = 0xFFFF;
+            break;
+    }
+
+    mp_timer        = p_timer;
+    m_channel_count = 0;
+    m_write_pos     = 0;
+    m_read_pos      = 0;
+    m_drop_count    = 0;
+
+    nrf_drv_timer_enable(p_timer);
+
+    return NRF_SUCCESS;
+}
+
+
+void app_event_capture_uninit(void)
+{
+    uint8_t i;
+
+    if (mp_timer == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < m_channel_count; i++)
+    {
+        (void)nrf_drv_ppi_channel_disable(m_channels[i].ppi_channel);
+        (void)nrf_drv_ppi_channel_free(m_channels[i].ppi_channel);
+        if (m_channels[i].pin != NO_PIN)
+        {
+            nrf_drv_gpiote_in_event_disable(m_channels[i].pin);
+            nrf_drv_gpiote_in_uninit(m_channels[i].pin);
+        }
+    }
+    m_channel_count = 0;
+
+    nrf_drv_timer_disable(mp_timer);
+    nrf_drv_timer_uninit(mp_timer);
+    mp_timer = NULL;
+}
+
+
+uint32_t app_event_capture_channel_alloc(uint32_t event_address, uint8_t * p_channel)
+{
+    uint32_t            err_code;
+    capture_channel_t * p_cb;
+
+    if (mp_timer == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_channel_count >= APP_EVENT_CAPTURE_MAX_CHANNELS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_cb = &m_channels[m_channel_count];
+
+    if (nrf_drv_ppi_channel_alloc(&p_cb->ppi_channel) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    err_code = nrf_drv_ppi_channel_assign(p_cb->ppi_channel,
+                                          event_address,
+                                          nrf_drv_timer_capture_task_address_get(mp_timer,
+                                                                                 m_channel_count));
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = nrf_drv_ppi_channel_enable(p_cb->ppi_channel);
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        (void)nrf_drv_ppi_channel_free(p_cb->ppi_channel);
+        return err_code;
+    }
+
+    p_cb->pin  = NO_PIN;
+    *p_channel = m_channel_count++;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_event_capture_pin_channel_alloc(uint32_t              pin,
+                                             nrf_gpiote_polarity_t polarity,
+                                             nrf_gpio_pin_pull_t   pull,
+                                             uint8_t *             p_channel)
+{
+    nrf_drv_gpiote_in_config_t config = GPIOTE_CONFIG_IN_SENSE_TOGGLE(true);
+    uint32_t                   err_code;
+    uint8_t                    channel;
+
+    if (mp_timer == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_channel_count >= APP_EVENT_CAPTURE_MAX_CHANNELS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    if (!nrf_drv_gpiote_is_init())
+    {
+        err_code = nrf_drv_gpiote_init();
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    config.sense = polarity;
+    config.pull  = pull;
+    if (nrf_drv_gpiote_in_init(pin, &config, pin_event_handler) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    err_code = app_event_capture_channel_alloc(nrf_drv_gpiote_in_event_addr_get(pin), &channel);
+    if (err_code != NRF_SUCCESS)
+    {
+        nrf_drv_gpiote_in_uninit(pin);
+        return err_code;
+    }
+
+    m_channels[channel].pin = pin;
+    *p_channel              = channel;
+
+    nrf_drv_gpiote_in_event_enable(pin, true);
+
+    return NRF_SUCCESS;
+}
+
+
+void app_event_capture_store(uint8_t channel)
+{
+    ASSERT(channel < m_channel_count);
+
+    uint32_t timestamp = nrf_drv_timer_capture_get(mp_timer, (nrf_timer_cc_channel_t)channel);
+
+    CRITICAL_REGION_ENTER();
+    if ((m_write_pos - m_read_pos) < APP_EVENT_CAPTURE_BUFFER_SIZE)
+    {
+        app_event_capture_sample_t * p_sample =
+            &m_samples[m_write_pos & (APP_EVENT_CAPTURE_BUFFER_SIZE - 1)];
+
+        p_sample->channel   = channel;
+        p_sample->timestamp = timestamp;
+        m_write_pos++;
+    }
+    else
+    {
+        m_drop_count++;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+uint32_t app_event_capture_get(uint8_t channel)
+{
+    ASSERT(channel < m_channel_count);
+
+    return nrf_drv_timer_capture_get(mp_timer, (nrf_timer_cc_channel_t)channel);
+}
+
+
+uint32_t app_event_capture_now(void)
+{
+    ASSERT(mp_timer != NULL);
+
+    return nrf_drv_timer_capture(mp_timer, NOW_CC_CHANNEL);
+}
+
+
+uint32_t app_event_capture_read(app_event_capture_sample_t * p_sample)
+{
+    if (m_write_pos == m_read_pos)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *p_sample = m_samples[m_read_pos & (APP_EVENT_CAPTURE_BUFFER_SIZE - 1)];
+    m_read_pos++;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_event_capture_drop_count_get(void)
+{
+    return m_drop_count;
+}
+
+
+uint32_t app_event_capture_diff_us(uint32_t start, uint32_t end)
+{
+    ASSERT(mp_timer != NULL);
+
+    uint64_t ticks = (end - start) & m_counter_mask;
+
+    // The timer runs at 16 MHz divided by 2^PRESCALER.
+    return (uint32_t)((ticks << mp_timer->p_reg->PRESCALER) / 16);
+}
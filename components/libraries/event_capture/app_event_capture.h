@@ -0,0 +1,163 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup app_event_capture Hardware event timestamps
+ * @{
+ * @ingroup app_common
+ *
+ * @brief Module for timestamping hardware events with a timer, without CPU latency.
+ *
+ * @details This module connects hardware events through PPI to the CAPTURE tasks of a timer, so
+ *          that the timer value at the exact time of the event is latched in a CC register,
+ *          whatever the interrupt latency. The latched values are then copied to a buffer of
+ *          timestamps, which the application reads at its own pace, for example to measure the
+ *          latency from a command to a pin edge, or of a radio event.
+ *
+ *          The module uses 1 timer, and 1 PPI channel per capture channel. Each capture channel
+ *          uses one CC register of the timer, the last CC register is used by
+ *          @ref app_event_capture_now to timestamp software events on the same time base.
+ *
+ *          For pin channels, the timestamp is buffered from the GPIOTE interrupt. For other
+ *          events, for example RADIO EVENTS_ADDRESS, the application calls
+ *          @ref app_event_capture_store from its handler of the event, before the next event
+ *          overwrites the CC register.
+ */
+
+#ifndef APP_EVENT_CAPTURE_H__
+#define APP_EVENT_CAPTURE_H__
+
+#include <stdint.h>
+#include "nrf_drv_timer.h"
+#include "nrf_drv_gpiote.h"
+
+#ifndef APP_EVENT_CAPTURE_BUFFER_SIZE
+#define APP_EVENT_CAPTURE_BUFFER_SIZE  16 /**< Number of buffered timestamps, must be a power of two. */
+#endif
+
+#define APP_EVENT_CAPTURE_MAX_CHANNELS 3  /**< Number of capture channels, one CC register of the timer is kept for @ref app_event_capture_now. */
+
+/**@brief Timestamp of a captured event. */
+typedef struct
+{
+    uint8_t  channel;   /**< Capture channel the event was captured on. */
+    uint32_t timestamp; /**< Timer value at the event, in timer ticks. */
+} app_event_capture_sample_t;
+
+/**@brief Function for initializing the module.
+ *
+ * @details The timer is started, and counts until @ref app_event_capture_uninit is called. Its
+ *          interrupt is not used.
+ *
+ * @param[in]  p_timer   Timer instance used as time base.
+ * @param[in]  p_config  Timer configuration, the mode must be NRF_TIMER_MODE_TIMER. Default
+ *                       configuration of the instance used if NULL.
+ *
+ * @retval NRF_SUCCESS              Module initialized.
+ * @retval NRF_ERROR_INVALID_STATE  The timer is already in use.
+ * @retval NRF_ERROR_NO_MEM         The PPI driver could not be initialized.
+ * @return Errors propagated from nrf_drv_timer_init.
+ */
+uint32_t app_event_capture_init(nrf_drv_timer_t const * p_timer, nrf_drv_timer_config_t const * p_config);
+
+/**@brief Function for uninitializing the module, and freeing the timer and all its channels. */
+void app_event_capture_uninit(void);
+
+/**@brief Function for allocating a channel capturing a hardware event.
+ *
+ * @param[in]  event_address  Address of the event register, for example
+ *                            (uint32_t)&NRF_RADIO->EVENTS_ADDRESS.
+ * @param[out] p_channel      Capture channel.
+ *
+ * @retval NRF_SUCCESS              Channel allocated, the event is captured from now on.
+ * @retval NRF_ERROR_INVALID_STATE  The module is not initialized.
+ * @retval NRF_ERROR_NO_MEM         No capture channel or PPI channel left.
+ */
+uint32_t app_event_capture_channel_alloc(uint32_t event_address, uint8_t * p_channel);
+
+/**@brief Function for allocating a channel capturing the edges of a pin.
+ *
+ * @details The pin is configured as an input with a high accuracy GPIOTE channel, and its
+ *          timestamps are buffered from the GPIOTE interrupt. The GPIOTE driver is initialized if
+ *          it is not already.
+ *
+ * @param[in]  pin        Pin to capture the edges of.
+ * @param[in]  polarity   Edges to capture.
+ * @param[in]  pull       Pull configuration of the pin.
+ * @param[out] p_channel  Capture channel.
+ *
+ * @retval NRF_SUCCESS              Channel allocated, the edges are captured from now on.
+ * @retval NRF_ERROR_INVALID_STATE  The module is not initialized.
+ * @retval NRF_ERROR_NO_MEM         No capture channel, PPI channel or GPIOTE channel left.
+ * @return Errors propagated from nrf_drv_gpiote_init.
+ */
+uint32_t app_event_capture_pin_channel_alloc(uint32_t              pin,
+                                             nrf_gpiote_polarity_t polarity,
+                                             nrf_gpio_pin_pull_t   pull,
+                                             uint8_t *             p_channel);
+
+/**@brief Function for buffering the last timestamp of a channel.
+ *
+ * @details To be called once per event for channels allocated with
+ *          @ref app_event_capture_channel_alloc, at any interrupt priority. A timestamp that does
+ *          not fit in the buffer is dropped.
+ *
+ * @param[in]  channel    Capture channel.
+ */
+void app_event_capture_store(uint8_t channel);
+
+/**@brief Function for getting the last timestamp of a channel, without buffering it.
+ *
+ * @param[in]  channel    Capture channel.
+ *
+ * @return Timer value at the last event of the channel.
+ */
+uint32_t app_event_capture_get(uint8_t channel);
+
+/**@brief Function for getting the current timer value, on the time base of the captured events.
+ *
+ * @note Must not be called from different interrupt priorities at the same time.
+ *
+ * @return Current timer value.
+ */
+uint32_t app_event_capture_now(void);
+
+/**@brief Function for reading the oldest buffered timestamp.
+ *
+ * @param[out] p_sample   Timestamp.
+ *
+ * @retval NRF_SUCCESS          A timestamp was copied to p_sample.
+ * @retval NRF_ERROR_NOT_FOUND  No timestamp buffered.
+ */
+uint32_t app_event_capture_read(app_event_capture_sample_t * p_sample);
+
+/**@brief Function for getting the number of timestamps dropped because the buffer was full.
+ *
+ * @return Number of dropped timestamps since the module was initialized.
+ */
+uint32_t app_event_capture_drop_count_get(void);
+
+/**@brief Function for getting the time between two timestamps.
+ *
+ * @details Handles one wrap-around of the timer between the two timestamps.
+ *
+ * @param[in]  start      First timestamp.
+ * @param[in]  end        Second timestamp.
+ *
+ * @return Time from start to end, in microseconds.
+ */
+uint32_t app_event_capture_diff_us(uint32_t start, uint32_t end);
+
+#endif // APP_EVENT_CAPTURE_H__
+
+/** @} */
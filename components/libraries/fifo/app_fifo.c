@@ -11,8 +11,10 @@
  */
 
 #include "app_fifo.h"
+#include <string.h>
 #include "nrf_error.h"
 #include "app_util.h"
+#include "nordic_common.h"
 
 static __INLINE uint32_t fifo_length(app_fifo_t * p_fifo)
 {
@@ -72,6 +74,125 @@ uint32_t app_fifo_get(app_fifo_t * p_fifo, uint8_t * p_byte)
 
 }
 
+uint32_t app_fifo_write(app_fifo_t * p_fifo, uint8_t const * p_byte_array, uint32_t * p_size)
+{
+    uint32_t write_pos;
+    uint32_t index;
+    uint32_t span;
+    uint32_t size;
+
+    if (p_size == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    size = (p_fifo->buf_size_mask + 1) - FIFO_LENGTH;
+
+    if (p_byte_array == NULL)
+    {
+        *p_size = size;
+        return NRF_SUCCESS;
+    }
+
+    if (size == 0)
+    {
+        *p_size = 0;
+        return NRF_ERROR_NO_MEM;
+    }
+
+    size      = MIN(size, *p_size);
+    write_pos = p_fifo->write_pos;
+    index     = write_pos & p_fifo->buf_size_mask;
+    span      = MIN(size, (p_fifo->buf_size_mask + 1) - index);
+
+    memcpy(&p_fifo->p_buf[index], p_byte_array, span);
+    memcpy(&p_fifo->p_buf[0], &p_byte_array[span], size - span);
+
+    p_fifo->write_pos = write_pos + size;
+    *p_size           = size;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_fifo_read(app_fifo_t * p_fifo, uint8_t * p_byte_array, uint32_t * p_size)
+{
+    uint32_t read_pos;
+    uint32_t index;
+    uint32_t span;
+    uint32_t size;
+
+    if (p_size == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    size = FIFO_LENGTH;
+
+    if (p_byte_array == NULL)
+    {
+        *p_size = size;
+        return NRF_SUCCESS;
+    }
+
+    if (size == 0)
+    {
+        *p_size = 0;
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    size     = MIN(size, *p_size);
+    read_pos = p_fifo->read_pos;
+    index    = read_pos & p_fifo->buf_size_mask;
+    span     = MIN(size, (p_fifo->buf_size_mask + 1) - index);
+
+    memcpy(p_byte_array, &p_fifo->p_buf[index], span);
+    memcpy(&p_byte_array[span], &p_fifo->p_buf[0], size - span);
+
+    p_fifo->read_pos = read_pos + size;
+    *p_size          = size;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_fifo_span_get(app_fifo_t * p_fifo, uint8_t ** pp_data, uint32_t * p_size)
+{
+    uint32_t index;
+    uint32_t size;
+
+    if ((pp_data == NULL) || (p_size == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    size = FIFO_LENGTH;
+    if (size == 0)
+    {
+        *p_size = 0;
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    index    = p_fifo->read_pos & p_fifo->buf_size_mask;
+    *pp_data = &p_fifo->p_buf[index];
+    *p_size  = MIN(size, (p_fifo->buf_size_mask + 1) - index);
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_fifo_consume(app_fifo_t * p_fifo, uint32_t size)
+{
+    if (size > FIFO_LENGTH)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    p_fifo->read_pos += size;
+    return NRF_SUCCESS;
+}
+
+
 uint32_t app_fifo_flush(app_fifo_t * p_fifo)
 {
     p_fifo->read_pos = p_fifo->write_pos;
@@ -69,6 +69,66 @@ uint32_t app_fifo_put(app_fifo_t * p_fifo, uint8_t byte);
  */
 uint32_t app_fifo_get(app_fifo_t * p_fifo, uint8_t * p_byte);
 
+/**@brief Function for writing bytes to the FIFO.
+ *
+ * @details As many bytes as there is room for are written, copied in at most two contiguous
+ *          spans. The write position is updated after the copy, so the FIFO can be read from an
+ *          interrupt while it is written.
+ *
+ * @param[in]    p_fifo        Pointer to the FIFO.
+ * @param[in]    p_byte_array  Bytes to write. If NULL, nothing is written and p_size returns the
+ *                             number of bytes there is room for.
+ * @param[inout] p_size        Number of bytes to write. Returns the number of bytes written.
+ *
+ * @retval     NRF_SUCCESS              If bytes were written, or if p_byte_array is NULL.
+ * @retval     NRF_ERROR_NULL           If p_size is NULL.
+ * @retval     NRF_ERROR_NO_MEM         If the FIFO is full.
+ */
+uint32_t app_fifo_write(app_fifo_t * p_fifo, uint8_t const * p_byte_array, uint32_t * p_size);
+
+/**@brief Function for reading bytes from the FIFO.
+ *
+ * @details As many bytes as are available are read, copied out in at most two contiguous spans.
+ *          The read position is updated after the copy, so the FIFO can be written from an
+ *          interrupt while it is read.
+ *
+ * @param[in]    p_fifo        Pointer to the FIFO.
+ * @param[out]   p_byte_array  Buffer for the bytes read. If NULL, nothing is read and p_size
+ *                             returns the number of bytes available.
+ * @param[inout] p_size        Size of p_byte_array. Returns the number of bytes read.
+ *
+ * @retval     NRF_SUCCESS              If bytes were read, or if p_byte_array is NULL.
+ * @retval     NRF_ERROR_NULL           If p_size is NULL.
+ * @retval     NRF_ERROR_NOT_FOUND      If the FIFO is empty.
+ */
+uint32_t app_fifo_read(app_fifo_t * p_fifo, uint8_t * p_byte_array, uint32_t * p_size);
+
+/**@brief Function for getting the next contiguous span of bytes in the FIFO without reading them.
+ *
+ * @details Lets a consumer use the data in place, for example to hand it to the SoftDevice, and
+ *          then call @ref app_fifo_consume with the number of bytes used. The bytes available
+ *          may span two calls if they wrap around the end of the buffer.
+ *
+ * @param[in]  p_fifo   Pointer to the FIFO.
+ * @param[out] pp_data  Pointer to the first byte of the span.
+ * @param[out] p_size   Number of bytes in the span.
+ *
+ * @retval     NRF_SUCCESS              If a span was returned.
+ * @retval     NRF_ERROR_NULL           If pp_data or p_size is NULL.
+ * @retval     NRF_ERROR_NOT_FOUND      If the FIFO is empty.
+ */
+uint32_t app_fifo_span_get(app_fifo_t * p_fifo, uint8_t ** pp_data, uint32_t * p_size);
+
+/**@brief Function for removing bytes from the FIFO after they have been used in place.
+ *
+ * @param[in]  p_fifo   Pointer to the FIFO.
+ * @param[in]  size     Number of bytes to remove.
+ *
+ * @retval     NRF_SUCCESS              If the bytes were removed.
+ * @retval     NRF_ERROR_INVALID_LENGTH If there are fewer bytes than size in the FIFO.
+ */
+uint32_t app_fifo_consume(app_fifo_t * p_fifo, uint32_t size);
+
 /**@brief Function for flushing the FIFO.
  *
  * @param[in]  p_fifo   Pointer to the FIFO.
@@ -0,0 +1,894 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "flash_kv.h"
+#include <stdlib.h>
+#include <string.h>
+#include "nrf_error.h"
+#include "nordic_common.h"
+#include "pstorage.h"
+#include "crc16.h"
+
+#if (FLASH_KV_PAGES < 2)
+#error "FLASH_KV_PAGES must be at least 2, one page is kept erased for garbage collection."
+#endif
+
+/*
+ * Flash layout:
+ *
+ * Each page starts with a header of two words, PAGE_MAGIC and a sequence number that orders the
+ * pages by the time they were taken into use. The records follow, each made of two header words
+ * and the data:
+ *
+ *   word 0: key in the lower half, data length in bytes in the upper half, 0 for a delete.
+ *   word 1: CRC-16 of word 0 and the data in the lower half, 0 in the upper half.
+ *
+ * The first erased word 0 marks the end of the log in a page.
+ */
+
+#define PAGE_MAGIC          0x564B4C46                      /**< Marks a page in use by the store ("FLKV"). */
+#define PAGE_HEADER_SIZE    (2 * sizeof(uint32_t))          /**< Size of the page header. */
+#define RECORD_HEADER_SIZE  (2 * sizeof(uint32_t))          /**< Size of the record header. */
+#define ERASED_WORD         0xFFFFFFFF                      /**< Value of an erased flash word. */
+#define NO_PAGE             0xFF                            /**< Page index meaning no page. */
+#define NO_ENTRY            0xFFFF                          /**< Index entry meaning no entry. */
+
+#define PAGE_SIZE           PSTORAGE_FLASH_PAGE_SIZE        /**< Size of one page of the store. */
+#define MAX_DATA_LENGTH     (PAGE_SIZE - PAGE_HEADER_SIZE - RECORD_HEADER_SIZE) /**< Longest value that fits a page. */
+
+#define RECORD_WORD0(KEY, LENGTH)  ((uint32_t)(KEY) | ((uint32_t)(LENGTH) << 16))
+#define RECORD_KEY(WORD0)          ((uint16_t)((WORD0) & 0xFFFF))
+#define RECORD_LENGTH(WORD0)       ((uint16_t)((WORD0) >> 16))
+
+/**@brief Page states. */
+typedef enum
+{
+    PAGE_STATE_FREE,                /**< Erased, not in use. */
+    PAGE_STATE_USED,                /**< Holds a valid page header. */
+    PAGE_STATE_DIRTY                /**< Neither erased nor valid, must be erased before use. */
+} page_state_t;
+
+/**@brief Operations, only one is running at a time. */
+typedef enum
+{
+    OP_NONE,
+    OP_WRITE,                       /**< Appending a record for flash_kv_write. */
+    OP_DELETE,                      /**< Appending an empty record for flash_kv_delete. */
+    OP_GC,                          /**< Moving the live records out of a page, and erasing it. */
+    OP_CLEAR                        /**< Erasing a dirty page. */
+} op_t;
+
+/**@brief Steps of an operation, each is one pstorage command. */
+typedef enum
+{
+    STEP_PAGE_HEADER,               /**< Storing the header of a page taken into use. */
+    STEP_RECORD_HEADER,             /**< Storing the header of a new record. */
+    STEP_RECORD_DATA,               /**< Storing the data of a new record. */
+    STEP_RECORD_COPY,               /**< Copying a live record from the page being collected. */
+    STEP_PAGE_CLEAR                 /**< Erasing a page. */
+} step_t;
+
+typedef struct
+{
+    uint32_t seq;                   /**< Sequence number of the page, if used. */
+    uint16_t write_offset;          /**< Offset of the next record in the page. */
+    uint8_t  state;                 /**< One of @ref page_state_t. */
+} page_t;
+
+typedef struct
+{
+    uint16_t key;                   /**< Key of the value. */
+    uint16_t length;                /**< Length of the value. */
+    uint32_t addr;                  /**< Flash address of the latest record of the key. */
+} index_entry_t;
+
+static flash_kv_evt_handler_t m_evt_handler;
+static bool                   m_initialized;
+static pstorage_handle_t      m_page_handle[FLASH_KV_PAGES];
+static page_t                 m_pages[FLASH_KV_PAGES];
+static uint8_t                m_head_page = NO_PAGE;          /**< Page records are appended to. */
+static uint32_t               m_next_seq;
+static index_entry_t          m_index[FLASH_KV_MAX_KEYS];
+static uint16_t               m_index_count;
+
+static op_t                   m_op = OP_NONE;
+static step_t                 m_op_step;
+static uint16_t               m_op_key;
+static uint8_t const *        m_op_p_data;
+static uint16_t               m_op_length;
+static uint8_t                m_op_page;                      /**< Page the current step writes to or erases. */
+static uint16_t               m_op_offset;                    /**< Offset of the record in m_op_page. */
+static uint8_t                m_gc_page;                      /**< Page being collected. */
+static uint16_t               m_gc_entry;                     /**< Index entry being copied. */
+static uint32_t               m_page_header[2];               /**< Source of page header stores. */
+static uint32_t               m_record_header[2];             /**< Source of record header stores. */
+
+static bool                   m_radio_active;
+static bool                   m_step_deferred;                /**< A GC step is waiting for the radio to go inactive. */
+
+static void op_continue(void);
+static void op_next(void);
+
+
+/**@brief Function for checking that a flash region is erased. */
+static bool flash_region_is_erased(uint32_t addr, uint32_t size)
+{
+    uint32_t const * p_word = (uint32_t const *)addr;
+
+    for (uint32_t i = 0; i < size / sizeof(uint32_t); ++i)
+    {
+        if (p_word[i] != ERASED_WORD)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static uint32_t page_addr_get(uint8_t page)
+{
+    return (uint32_t)m_page_handle[page].block_id;
+}
+
+
+static bool addr_is_in_page(uint32_t addr, uint8_t page)
+{
+    return (addr >= page_addr_get(page) && addr < page_addr_get(page) + PAGE_SIZE);
+}
+
+
+/**@brief Function for checking the CRC and the header format of the record at the given address. */
+static bool record_is_valid(uint32_t addr)
+{
+    uint32_t const * p_header = (uint32_t const *)addr;
+    uint16_t         length   = RECORD_LENGTH(p_header[0]);
+    uint16_t         crc;
+
+    if ((p_header[1] >> 16) != 0)
+    {
+        return false;
+    }
+
+    crc = crc16_compute((uint8_t const *)&p_header[0], sizeof(uint32_t), NULL);
+    if (length > 0)
+    {
+        crc = crc16_compute((uint8_t const *)&p_header[2], length, &crc);
+    }
+    return (crc == (uint16_t)p_header[1]);
+}
+
+
+static uint16_t index_find(uint16_t key)
+{
+    for (uint16_t i = 0; i < m_index_count; ++i)
+    {
+        if (m_index[i].key == key)
+        {
+            return i;
+        }
+    }
+    return NO_ENTRY;
+}
+
+
+static uint32_t index_set(uint16_t key, uint16_t length, uint32_t addr)
+{
+    uint16_t entry = index_find(key);
+
+    if (entry == NO_ENTRY)
+    {
+        if (m_index_count == FLASH_KV_MAX_KEYS)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        entry = m_index_count++;
+        m_index[entry].key = key;
+    }
+    m_index[entry].length = length;
+    m_index[entry].addr   = addr;
+    return NRF_SUCCESS;
+}
+
+
+static void index_remove(uint16_t key)
+{
+    uint16_t entry = index_find(key);
+
+    if (entry != NO_ENTRY)
+    {
+        m_index[entry] = m_index[--m_index_count];
+    }
+}
+
+
+static uint8_t free_page_count_get(void)
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < FLASH_KV_PAGES; ++i)
+    {
+        if (m_pages[i].state == PAGE_STATE_FREE)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+/**@brief Function for getting the used page with the lowest sequence number. */
+static uint8_t oldest_used_page_get(bool include_head)
+{
+    uint8_t oldest = NO_PAGE;
+
+    for (uint8_t i = 0; i < FLASH_KV_PAGES; ++i)
+    {
+        if (m_pages[i].state == PAGE_STATE_USED &&
+            (include_head || i != m_head_page) &&
+            (oldest == NO_PAGE || (int32_t)(m_pages[i].seq - m_pages[oldest].seq) < 0))
+        {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+
+/**@brief Function for getting the number of bytes taken by records that are no longer live. */
+static uint32_t garbage_size_get(bool include_head)
+{
+    uint32_t garbage = 0;
+
+    for (uint8_t i = 0; i < FLASH_KV_PAGES; ++i)
+    {
+        if (m_pages[i].state != PAGE_STATE_USED || (!include_head && i == m_head_page))
+        {
+            continue;
+        }
+        garbage += m_pages[i].write_offset - PAGE_HEADER_SIZE;
+        for (uint16_t j = 0; j < m_index_count; ++j)
+        {
+            if (addr_is_in_page(m_index[j].addr, i))
+            {
+                garbage -= RECORD_HEADER_SIZE + m_index[j].length;
+            }
+        }
+    }
+    return garbage;
+}
+
+
+/**@brief Function for stopping appends to a page, after a failed or abandoned store to it. */
+static void page_close(uint8_t page)
+{
+    m_pages[page].write_offset = PAGE_SIZE;
+    if (m_head_page == page)
+    {
+        m_head_page = NO_PAGE;
+    }
+}
+
+
+/**@brief Function for reserving space for a record at the end of the log.
+ *
+ * @details Takes a free page into use if the record does not fit the head page. The last free
+ *          page is only taken by garbage collection.
+ *
+ * @param[in]  size            Size of the record, including the header.
+ * @param[in]  use_reserve     Whether the last free page may be taken.
+ * @param[out] p_page          Page of the record.
+ * @param[out] p_offset        Offset of the record in the page.
+ * @param[out] p_header_needed Whether the page was taken into use, and needs its header stored.
+ */
+static uint32_t space_reserve(uint16_t  size,
+                              bool      use_reserve,
+                              uint8_t * p_page,
+                              uint16_t * p_offset,
+                              bool *    p_header_needed)
+{
+    *p_header_needed = false;
+
+    if (m_head_page == NO_PAGE || m_pages[m_head_page].write_offset + size > PAGE_SIZE)
+    {
+        uint8_t free_count = free_page_count_get();
+        uint8_t page;
+
+        if (free_count == 0 || (free_count == 1 && !use_reserve))
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        for (page = 0; m_pages[page].state != PAGE_STATE_FREE; ++page)
+        {
+        }
+        m_pages[page].state        = PAGE_STATE_USED;
+        m_pages[page].seq          = m_next_seq++;
+        m_pages[page].write_offset = PAGE_HEADER_SIZE;
+        m_head_page                = page;
+
+        m_page_header[0] = PAGE_MAGIC;
+        m_page_header[1] = m_pages[page].seq;
+        *p_header_needed = true;
+    }
+
+    *p_page   = m_head_page;
+    *p_offset = m_pages[m_head_page].write_offset;
+    m_pages[m_head_page].write_offset += size;
+    return NRF_SUCCESS;
+}
+
+
+static bool step_is_store(step_t step)
+{
+    return (step != STEP_PAGE_CLEAR);
+}
+
+
+/**@brief Function for issuing the pstorage command of the current step. */
+static uint32_t op_step_run(void)
+{
+    switch (m_op_step)
+    {
+        case STEP_PAGE_HEADER:
+            return pstorage_store(&m_page_handle[m_op_page],
+                                  (uint8_t *)m_page_header,
+                                  PAGE_HEADER_SIZE,
+                                  0);
+
+        case STEP_RECORD_HEADER:
+            return pstorage_store(&m_page_handle[m_op_page],
+                                  (uint8_t *)m_record_header,
+                                  RECORD_HEADER_SIZE,
+                                  m_op_offset);
+
+        case STEP_RECORD_DATA:
+            return pstorage_store(&m_page_handle[m_op_page],
+                                  (uint8_t *)m_op_p_data,
+                                  m_op_length,
+                                  m_op_offset + RECORD_HEADER_SIZE);
+
+        case STEP_RECORD_COPY:
+            // Flash to flash, the page being collected is not erased until all its records are copied.
+            return pstorage_store(&m_page_handle[m_op_page],
+                                  (uint8_t *)m_index[m_gc_entry].addr,
+                                  RECORD_HEADER_SIZE + m_index[m_gc_entry].length,
+                                  m_op_offset);
+
+        case STEP_PAGE_CLEAR:
+            return pstorage_clear(&m_page_handle[m_op_page], PAGE_SIZE);
+
+        default:
+            return NRF_ERROR_INTERNAL;
+    }
+}
+
+
+static void op_finish(uint32_t result)
+{
+    flash_kv_evt_t evt;
+
+    evt.type   = (m_op == OP_WRITE) ? FLASH_KV_EVT_WRITE :
+                 (m_op == OP_DELETE) ? FLASH_KV_EVT_DELETE : FLASH_KV_EVT_GC;
+    evt.result = result;
+    evt.key    = m_op_key;
+
+    m_op = OP_NONE;
+    m_evt_handler(&evt);
+
+    // Failures are not retried automatically, the next operation will pick up what is left.
+    if (result == NRF_SUCCESS)
+    {
+        op_next();
+    }
+}
+
+
+static void op_step_fail(uint32_t result)
+{
+    if (step_is_store(m_op_step))
+    {
+        // The space reserved for the step may be left partially written.
+        page_close(m_op_page);
+    }
+    op_finish(result);
+}
+
+
+/**@brief Function for preparing the next garbage collection step: copying the next live record
+ *        of the page, or erasing the page when there are none left.
+ */
+static uint32_t gc_step_prepare(void)
+{
+    for (m_gc_entry = 0; m_gc_entry < m_index_count; ++m_gc_entry)
+    {
+        if (addr_is_in_page(m_index[m_gc_entry].addr, m_gc_page))
+        {
+            bool     header_needed;
+            uint32_t err_code;
+
+            err_code = space_reserve(RECORD_HEADER_SIZE + m_index[m_gc_entry].length,
+                                     true,
+                                     &m_op_page,
+                                     &m_op_offset,
+                                     &header_needed);
+            if (err_code != NRF_SUCCESS)
+            {
+                return err_code;
+            }
+            m_op_step = header_needed ? STEP_PAGE_HEADER : STEP_RECORD_COPY;
+            return NRF_SUCCESS;
+        }
+    }
+
+    m_op_page = m_gc_page;
+    m_op_step = STEP_PAGE_CLEAR;
+    return NRF_SUCCESS;
+}
+
+
+static void gc_start(uint8_t page)
+{
+    uint32_t err_code;
+
+    m_op      = OP_GC;
+    m_gc_page = page;
+    if (m_head_page == page)
+    {
+        m_head_page = NO_PAGE;
+    }
+
+    err_code = gc_step_prepare();
+    if (err_code != NRF_SUCCESS)
+    {
+        op_finish(err_code);
+        return;
+    }
+    op_continue();
+}
+
+
+/**@brief Function for starting the current step, holding garbage collection back while the radio
+ *        is active.
+ */
+static void op_continue(void)
+{
+    uint32_t err_code;
+
+    if ((m_op == OP_GC || m_op == OP_CLEAR) && m_radio_active)
+    {
+        m_step_deferred = true;
+        return;
+    }
+
+    err_code = op_step_run();
+    if (err_code != NRF_SUCCESS)
+    {
+        op_step_fail(err_code);
+    }
+}
+
+
+/**@brief Function for starting background work when idle: erasing dirty pages, and collecting
+ *        the oldest page when the store is down to its last free page.
+ */
+static void op_next(void)
+{
+    uint8_t page;
+
+    if (m_op != OP_NONE)
+    {
+        return;
+    }
+
+    for (page = 0; page < FLASH_KV_PAGES; ++page)
+    {
+        if (m_pages[page].state == PAGE_STATE_DIRTY)
+        {
+            m_op      = OP_CLEAR;
+            m_op_page = page;
+            m_op_step = STEP_PAGE_CLEAR;
+            op_continue();
+            return;
+        }
+    }
+
+    if (free_page_count_get() < 2)
+    {
+        page = oldest_used_page_get(false);
+        if (page != NO_PAGE && garbage_size_get(false) > 0)
+        {
+            gc_start(page);
+        }
+    }
+}
+
+
+static void op_step_done(uint32_t result)
+{
+    if (result != NRF_SUCCESS)
+    {
+        op_step_fail(result);
+        return;
+    }
+
+    switch (m_op_step)
+    {
+        case STEP_PAGE_HEADER:
+            m_op_step = (m_op == OP_GC) ? STEP_RECORD_COPY : STEP_RECORD_HEADER;
+            op_continue();
+            break;
+
+        case STEP_RECORD_HEADER:
+            if (m_op == OP_WRITE)
+            {
+                m_op_step = STEP_RECORD_DATA;
+                op_continue();
+            }
+            else
+            {
+                index_remove(m_op_key);
+                op_finish(NRF_SUCCESS);
+            }
+            break;
+
+        case STEP_RECORD_DATA:
+            // Can not fail, room for a new key was checked when the write was started.
+            (void)index_set(m_op_key, m_op_length, page_addr_get(m_op_page) + m_op_offset);
+            op_finish(NRF_SUCCESS);
+            break;
+
+        case STEP_RECORD_COPY:
+            m_index[m_gc_entry].addr = page_addr_get(m_op_page) + m_op_offset;
+            result = gc_step_prepare();
+            if (result != NRF_SUCCESS)
+            {
+                op_finish(result);
+                break;
+            }
+            op_continue();
+            break;
+
+        case STEP_PAGE_CLEAR:
+            m_pages[m_op_page].state        = PAGE_STATE_FREE;
+            m_pages[m_op_page].write_offset = 0;
+            op_finish(NRF_SUCCESS);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+static void pstorage_cb_handler(pstorage_handle_t * p_handle,
+                                uint8_t             op_code,
+                                uint32_t            result,
+                                uint8_t           * p_data,
+                                uint32_t            data_len)
+{
+    UNUSED_PARAMETER(p_handle);
+    UNUSED_PARAMETER(op_code);
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(data_len);
+
+    if (m_op != OP_NONE)
+    {
+        op_step_done(result);
+    }
+}
+
+
+/**@brief Function for starting a write or delete, by appending a record. */
+static uint32_t record_op_start(op_t op, uint16_t key, uint8_t const * p_data, uint16_t length)
+{
+    page_t   pages[FLASH_KV_PAGES];
+    uint8_t  head_page = m_head_page;
+    uint32_t next_seq  = m_next_seq;
+    bool     header_needed;
+    uint16_t crc;
+    uint32_t err_code;
+
+    if (m_op != OP_NONE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    memcpy(pages, m_pages, sizeof(pages));
+    err_code = space_reserve(RECORD_HEADER_SIZE + length,
+                             false,
+                             &m_op_page,
+                             &m_op_offset,
+                             &header_needed);
+    if (err_code != NRF_SUCCESS)
+    {
+        if (garbage_size_get(true) > 0)
+        {
+            gc_start(oldest_used_page_get(true));
+        }
+        return err_code;
+    }
+
+    m_op             = op;
+    m_op_key         = key;
+    m_op_p_data      = p_data;
+    m_op_length      = length;
+    m_op_step        = header_needed ? STEP_PAGE_HEADER : STEP_RECORD_HEADER;
+
+    m_record_header[0] = RECORD_WORD0(key, length);
+    crc = crc16_compute((uint8_t const *)&m_record_header[0], sizeof(uint32_t), NULL);
+    if (length > 0)
+    {
+        crc = crc16_compute(p_data, length, &crc);
+    }
+    m_record_header[1] = crc;
+
+    err_code = op_step_run();
+    if (err_code != NRF_SUCCESS)
+    {
+        // Nothing was written, give the space back.
+        memcpy(m_pages, pages, sizeof(pages));
+        m_head_page = head_page;
+        m_next_seq  = next_seq;
+        m_op        = OP_NONE;
+    }
+    return err_code;
+}
+
+
+/**@brief Function for reading the records of a page into the index, and finding its end. */
+static uint32_t page_replay(uint8_t page)
+{
+    uint32_t base   = page_addr_get(page);
+    uint32_t offset = PAGE_HEADER_SIZE;
+
+    while (offset + RECORD_HEADER_SIZE <= PAGE_SIZE)
+    {
+        uint32_t word0  = *(uint32_t const *)(base + offset);
+        uint16_t length = RECORD_LENGTH(word0);
+
+        if (word0 == ERASED_WORD)
+        {
+            // Appending is only safe if the rest of the page was never touched.
+            if (!flash_region_is_erased(base + offset, PAGE_SIZE - offset))
+            {
+                offset = PAGE_SIZE;
+            }
+            break;
+        }
+        if ((length % sizeof(uint32_t)) != 0 || offset + RECORD_HEADER_SIZE + length > PAGE_SIZE)
+        {
+            offset = PAGE_SIZE;
+            break;
+        }
+
+        if (RECORD_KEY(word0) != FLASH_KV_KEY_INVALID && record_is_valid(base + offset))
+        {
+            if (length == 0)
+            {
+                index_remove(RECORD_KEY(word0));
+            }
+            else if (index_set(RECORD_KEY(word0), length, base + offset) != NRF_SUCCESS)
+            {
+                return NRF_ERROR_NO_MEM;
+            }
+        }
+        offset += RECORD_HEADER_SIZE + length;
+    }
+
+    m_pages[page].write_offset = offset;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t flash_kv_init(flash_kv_evt_handler_t evt_handler)
+{
+    pstorage_module_param_t param;
+    bool                    replayed[FLASH_KV_PAGES];
+    uint32_t                err_code;
+    uint8_t                 page;
+
+    if (evt_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    // One module per page, so erasing a page does not go through the pstorage swap page.
+    param.cb          = pstorage_cb_handler;
+    param.block_size  = PAGE_SIZE;
+    param.block_count = 1;
+    for (page = 0; page < FLASH_KV_PAGES; ++page)
+    {
+        err_code = pstorage_register(&param, &m_page_handle[page]);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    m_evt_handler = evt_handler;
+    m_index_count = 0;
+    m_head_page   = NO_PAGE;
+    m_next_seq    = 0;
+
+    for (page = 0; page < FLASH_KV_PAGES; ++page)
+    {
+        uint32_t const * p_header = (uint32_t const *)page_addr_get(page);
+
+        replayed[page]             = false;
+        m_pages[page].write_offset = 0;
+        if (p_header[0] == PAGE_MAGIC && p_header[1] != ERASED_WORD)
+        {
+            m_pages[page].state = PAGE_STATE_USED;
+            m_pages[page].seq   = p_header[1];
+            if (m_next_seq <= p_header[1])
+            {
+                m_next_seq = p_header[1] + 1;
+            }
+        }
+        else if (flash_region_is_erased(page_addr_get(page), PAGE_SIZE))
+        {
+            m_pages[page].state = PAGE_STATE_FREE;
+        }
+        else
+        {
+            m_pages[page].state = PAGE_STATE_DIRTY;
+        }
+    }
+
+    // Replay the pages oldest first, so later records of a key override earlier ones.
+    for (;;)
+    {
+        uint8_t oldest = NO_PAGE;
+
+        for (page = 0; page < FLASH_KV_PAGES; ++page)
+        {
+            if (m_pages[page].state == PAGE_STATE_USED && !replayed[page] &&
+                (oldest == NO_PAGE || (int32_t)(m_pages[page].seq - m_pages[oldest].seq) < 0))
+            {
+                oldest = page;
+            }
+        }
+        if (oldest == NO_PAGE)
+        {
+            break;
+        }
+
+        err_code = page_replay(oldest);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+        replayed[oldest] = true;
+        m_head_page      = oldest;
+    }
+
+    m_initialized = true;
+    op_next();
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t flash_kv_write(uint16_t key, uint8_t const * p_data, uint16_t length)
+{
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_data == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (key == FLASH_KV_KEY_INVALID ||
+        length == 0 ||
+        (length % sizeof(uint32_t)) != 0 ||
+        length > MAX_DATA_LENGTH)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (((uint32_t)p_data % sizeof(uint32_t)) != 0)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (m_op != OP_NONE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (index_find(key) == NO_ENTRY && m_index_count == FLASH_KV_MAX_KEYS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    return record_op_start(OP_WRITE, key, p_data, length);
+}
+
+
+uint32_t flash_kv_read(uint16_t key, uint8_t * p_data, uint16_t * p_length)
+{
+    uint16_t entry;
+
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_data == NULL || p_length == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    entry = index_find(key);
+    if (entry == NO_ENTRY)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (*p_length < m_index[entry].length)
+    {
+        *p_length = m_index[entry].length;
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    memcpy(p_data, (uint8_t const *)(m_index[entry].addr + RECORD_HEADER_SIZE), m_index[entry].length);
+    *p_length = m_index[entry].length;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t flash_kv_delete(uint16_t key)
+{
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (index_find(key) == NO_ENTRY)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    return record_op_start(OP_DELETE, key, NULL, 0);
+}
+
+
+uint32_t flash_kv_gc(void)
+{
+    uint8_t page;
+
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_op != OP_NONE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    page = oldest_used_page_get(true);
+    if (page == NO_PAGE)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    gc_start(page);
+    return NRF_SUCCESS;
+}
+
+
+void flash_kv_radio_evt_handler(bool radio_active)
+{
+    m_radio_active = radio_active;
+
+    if (!radio_active && m_step_deferred)
+    {
+        m_step_deferred = false;
+        op_continue();
+    }
+}
@@ -0,0 +1,168 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup flash_kv Flash Key/Value Store
+ * @{
+ * @ingroup app_common
+ *
+ * @brief Record based key/value storage in flash, built on @ref persistent_storage.
+ *
+ * @details Values are stored as records appended to a log spread over FLASH_KV_PAGES flash
+ *          pages. Writing a value appends a new record, and deleting it appends an empty one, so
+ *          small writes never erase flash or copy the rest of the page like @ref pstorage_update
+ *          does. A RAM index holds the flash address of the latest record of each key, so reads
+ *          are a copy from flash.
+ *
+ *          Each record has a header with the key, the length and a CRC-16 of both and the data.
+ *          Records that fail the CRC, e.g. because of a reset while writing, are skipped.
+ *
+ *          When the log runs out of erased pages, the module collects garbage in the background:
+ *          the live records of the oldest page are copied to the end of the log, and the page is
+ *          erased. One page is always kept erased for this. The collection is done a record at a
+ *          time, and if @ref flash_kv_radio_evt_handler is fed with radio notifications, each
+ *          step is started when the radio has just gone inactive.
+ *
+ * @note    The module registers one pstorage application of one flash page for each of its
+ *          FLASH_KV_PAGES pages, so PSTORAGE_MAX_APPLICATIONS must be raised by FLASH_KV_PAGES. pstorage_init() must be called before
+ *          flash_kv_init(). All functions in this module, and the radio handler, must be called
+ *          from the same interrupt level as pstorage_sys_event_handler().
+ */
+
+#ifndef FLASH_KV_H__
+#define FLASH_KV_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef FLASH_KV_PAGES
+#define FLASH_KV_PAGES       2          /**< Number of flash pages used by the store, including the page always kept erased for garbage collection. At least 2. */
+#endif
+
+#ifndef FLASH_KV_MAX_KEYS
+#define FLASH_KV_MAX_KEYS    16         /**< Maximum number of keys in the store, the RAM index uses 8 bytes per key. */
+#endif
+
+#define FLASH_KV_KEY_INVALID 0xFFFF     /**< Key value that can not be used, as it is the value of erased flash. */
+
+/**@brief Flash key/value store event types. */
+typedef enum
+{
+    FLASH_KV_EVT_WRITE,                 /**< A write requested with @ref flash_kv_write has completed. */
+    FLASH_KV_EVT_DELETE,                /**< A delete requested with @ref flash_kv_delete has completed. */
+    FLASH_KV_EVT_GC                     /**< A garbage collection has completed. Writes that failed with NRF_ERROR_NO_MEM may be retried. */
+} flash_kv_evt_type_t;
+
+/**@brief Flash key/value store event. */
+typedef struct
+{
+    flash_kv_evt_type_t type;           /**< Type of event. */
+    uint32_t            result;         /**< NRF_SUCCESS, or the error reported by pstorage. */
+    uint16_t            key;            /**< Key written or deleted, not used for @ref FLASH_KV_EVT_GC. */
+} flash_kv_evt_t;
+
+/**@brief Flash key/value store event handler type. */
+typedef void (*flash_kv_evt_handler_t)(flash_kv_evt_t const * p_evt);
+
+/**@brief Function for initializing the store.
+ *
+ * @details Registers the flash pages with pstorage and builds the RAM index from the records in
+ *          flash. Pages found partially erased after a reset are erased in the background, and
+ *          writes return NRF_ERROR_BUSY until that is done.
+ *
+ * @param[in]  evt_handler   Handler for the events of the store.
+ *
+ * @retval     NRF_SUCCESS               Store initialized.
+ * @retval     NRF_ERROR_NULL            evt_handler was NULL.
+ * @retval     NRF_ERROR_NO_MEM          The flash holds more keys than FLASH_KV_MAX_KEYS.
+ * @return     Errors from pstorage_register().
+ */
+uint32_t flash_kv_init(flash_kv_evt_handler_t evt_handler);
+
+/**@brief Function for writing a value.
+ *
+ * @details The value is appended to the log, and the RAM index is updated when the write is
+ *          complete, notified with @ref FLASH_KV_EVT_WRITE. Until then, reads return the
+ *          previous value.
+ *
+ * @param[in]  key       Key of the value, any value except @ref FLASH_KV_KEY_INVALID.
+ * @param[in]  p_data    Value to write. Must be word aligned and stay resident until the write is
+ *                       complete, as no copy is made.
+ * @param[in]  length    Length of the value in bytes. Must be a multiple of 4 and not 0.
+ *
+ * @retval     NRF_SUCCESS               Write started.
+ * @retval     NRF_ERROR_INVALID_STATE   Store not initialized.
+ * @retval     NRF_ERROR_NULL            p_data was NULL.
+ * @retval     NRF_ERROR_INVALID_PARAM   Invalid key or length.
+ * @retval     NRF_ERROR_INVALID_ADDR    p_data not word aligned.
+ * @retval     NRF_ERROR_BUSY            Another write, delete or garbage collection is ongoing.
+ * @retval     NRF_ERROR_NO_MEM          Index or flash full. If the flash was full, a garbage
+ *                                       collection has been started, retry on
+ *                                       @ref FLASH_KV_EVT_GC.
+ */
+uint32_t flash_kv_write(uint16_t key, uint8_t const * p_data, uint16_t length);
+
+/**@brief Function for reading a value.
+ *
+ * @param[in]     key        Key of the value.
+ * @param[out]    p_data     Buffer for the value.
+ * @param[in,out] p_length   Size of the buffer in, length of the value out.
+ *
+ * @retval     NRF_SUCCESS               Value read.
+ * @retval     NRF_ERROR_INVALID_STATE   Store not initialized.
+ * @retval     NRF_ERROR_NULL            NULL pointer passed.
+ * @retval     NRF_ERROR_NOT_FOUND       No value stored for the key.
+ * @retval     NRF_ERROR_DATA_SIZE       Buffer too small, *p_length is set to the length needed.
+ */
+uint32_t flash_kv_read(uint16_t key, uint8_t * p_data, uint16_t * p_length);
+
+/**@brief Function for deleting a value.
+ *
+ * @param[in]  key       Key of the value.
+ *
+ * @retval     NRF_SUCCESS               Delete started, completion is notified with
+ *                                       @ref FLASH_KV_EVT_DELETE.
+ * @retval     NRF_ERROR_INVALID_STATE   Store not initialized.
+ * @retval     NRF_ERROR_NOT_FOUND       No value stored for the key.
+ * @retval     NRF_ERROR_BUSY            Another write, delete or garbage collection is ongoing.
+ * @retval     NRF_ERROR_NO_MEM          Flash full, a garbage collection has been started.
+ */
+uint32_t flash_kv_delete(uint16_t key);
+
+/**@brief Function for starting a garbage collection of the oldest page.
+ *
+ * @details Collection is also started automatically when the store runs out of erased pages.
+ *
+ * @retval     NRF_SUCCESS               Collection started, completion is notified with
+ *                                       @ref FLASH_KV_EVT_GC.
+ * @retval     NRF_ERROR_INVALID_STATE   Store not initialized, or nothing to collect.
+ * @retval     NRF_ERROR_BUSY            Another write, delete or garbage collection is ongoing.
+ */
+uint32_t flash_kv_gc(void);
+
+/**@brief Function for handling radio notifications.
+ *
+ * @details Garbage collection steps are held back while the radio is active, and started when
+ *          this is called with radio_active false. Can be passed directly as the handler to
+ *          ble_radio_notification_init() with NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH semantics,
+ *          or called from the application handler. If it is never called, collection runs
+ *          without waiting for the radio.
+ *
+ * @param[in]  radio_active   True when the radio is about to become active, false when it has
+ *                            become inactive.
+ */
+void flash_kv_radio_evt_handler(bool radio_active);
+
+#endif // FLASH_KV_H__
+
+/** @} */
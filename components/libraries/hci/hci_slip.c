@@ -22,6 +22,12 @@
 #define APP_SLIP_ESC_END    0xDC                            /**< SLIP special code. When this code follows 0xDB, this character is interpreted as payload data 0xC0.. */
 #define APP_SLIP_ESC_ESC    0xDD                            /**< SLIP special code. When this code follows 0xDB, this character is interpreted as payload data 0xDB. */
 
+#define SLIP_WORD_END       0xC0C0C0C0UL                    /**< SLIP END code in every byte of a word. */
+#define SLIP_WORD_ESC       0xDBDBDBDBUL                    /**< SLIP ESC code in every byte of a word. */
+
+/**@brief Macro for checking if any byte of a 32 bit word is zero. */
+#define SLIP_WORD_HAS_ZERO_BYTE(WORD) ((((WORD) - 0x01010101UL) & ~(WORD) & 0x80808080UL) != 0)
+
 /** @brief States for the SLIP state machine. */
 typedef enum
 {
@@ -30,14 +36,29 @@ typedef enum
     SLIP_TRANSMITTING,                                      /**< SLIP state is transmitting indicating write() has been called but data transmission has not completed. */
 } slip_states_t;
 
+/** @brief Steps of the SLIP TX state machine, resumed on APP_UART_TX_EMPTY when the UART buffer is full. */
+typedef enum
+{
+    TX_STEP_START,                                          /**< Send the SLIP END byte starting the packet. */
+    TX_STEP_DATA,                                           /**< Send the bytes of the chain that need no escaping. */
+    TX_STEP_ESC,                                            /**< Send the SLIP ESC byte for a byte that collides with the SLIP commands. */
+    TX_STEP_ESC_CODE,                                       /**< Send the code following the SLIP ESC byte. */
+    TX_STEP_END                                             /**< Send the SLIP END byte ending the packet. */
+} slip_tx_step_t;
+
 static uint16_t                 m_uart_id;                  /** UART id returned from the UART module when calling app_uart_init, this id is kept, as it must be provided to the UART module when calling app_uart_close. */
 static slip_states_t            m_current_state = SLIP_OFF; /** Current state for the SLIP TX state machine. */
 
 static hci_slip_event_handler_t m_slip_event_handler;       /** Event callback function for handling of SLIP events, @ref hci_slip_evt_type_t . */
 
-static const uint8_t *          mp_tx_buffer;               /** Pointer to the current TX buffer that is in transmission. */
-static uint32_t                 m_tx_buffer_length;         /** Length of the current TX buffer that is in transmission. */
-static volatile uint32_t        m_tx_buffer_index;          /** Current index for next byte to transmit in the mp_tx_buffer. */
+static hci_slip_buffer_t        m_tx_buffer;                /** Descriptor of the buffer passed to hci_slip_write, sent as a chain of one buffer. */
+static const hci_slip_buffer_t *mp_tx_chain;                /** Pointer to the chain of buffers of the packet in transmission. */
+static uint32_t                 m_tx_chain_count;           /** Number of buffers in mp_tx_chain. */
+static uint32_t                 m_tx_chain_index;           /** Index of the buffer in mp_tx_chain being transmitted. */
+static volatile uint32_t        m_tx_buffer_index;          /** Current index for next byte to transmit in the current buffer of the chain. */
+static uint32_t                 m_tx_run_length;            /** Number of bytes left to transmit from the current buffer before the next byte that must be escaped. */
+static uint32_t                 m_tx_packet_length;         /** Number of bytes of the chain transmitted from the buffers already done. */
+static slip_tx_step_t           m_tx_step;                  /** Current step of the SLIP TX state machine. */
 
 static uint8_t *                mp_rx_buffer;               /** Pointer to the current RX buffer where the next SLIP decoded packet will be stored. */
 static uint32_t                 m_rx_buffer_length;         /** Length of the current RX buffer. */
@@ -69,140 +90,214 @@ static void handle_rx_byte_esc(uint8_t byte);
  */
 static void (*handle_rx_byte) (uint8_t byte) = handle_rx_byte_wait_start;
 
-/**@brief Function pointer for sending a byte through the UART module.
- */
-static uint32_t send_tx_byte_default(void);
-
-/**@brief Function for transferring a SLIP escape byte (0xDB) when special bytes are transferred,
- *        that is 0xC0 and 0xDB.
- */
-static uint32_t send_tx_byte_esc(void);
-
-/**@brief Function for transferring a byte when it collides with SLIP commands and follows the SLIP
- *        escape byte, that is 0xC0 => 0xDC and 0xDB => 0xDD.
- */
-static uint32_t send_tx_byte_encoded(void);
-
-/**@brief Function for transferring the SLIP end frame byte, 0xC0.
+/**@brief Function for finding the length of the run of bytes that can be sent without escaping.
+ *
+ * @details The data is scanned a word at a time once it is word aligned. A word holds a SLIP END
+ *          or ESC byte if the word XORed with that byte in every lane has a zero byte, which is
+ *          found without a branch per byte.
+ *
+ * @param[in]  p_data  Data to scan.
+ * @param[in]  length  Number of bytes to scan.
+ *
+ * @return     Offset of the first SLIP END or ESC byte, or length if there is none.
  */
-static uint32_t send_tx_byte_end(void);
+static uint32_t slip_plain_run_length(const uint8_t * p_data, uint32_t length)
+{
+    uint32_t index = 0;
 
-/**@brief Function pointer for sending a byte through the UART module.
- */
-uint32_t (*send_tx_byte) (void) = send_tx_byte_default;
+    // Bytewise until the data is word aligned.
+    while ((index < length) && ((((uint32_t)&p_data[index]) & 0x03) != 0))
+    {
+        if ((p_data[index] == APP_SLIP_END) || (p_data[index] == APP_SLIP_ESC))
+        {
+            return index;
+        }
+        index++;
+    }
 
+    while ((length - index) >= sizeof(uint32_t))
+    {
+        const uint32_t word = *(const uint32_t *)&p_data[index];
 
-static uint32_t send_tx_byte_end(void)
-{
-    uint32_t err_code = app_uart_put(APP_SLIP_END);
+        if (SLIP_WORD_HAS_ZERO_BYTE(word ^ SLIP_WORD_END) ||
+            SLIP_WORD_HAS_ZERO_BYTE(word ^ SLIP_WORD_ESC))
+        {
+            // The special byte is found bytewise below.
+            break;
+        }
+        index += sizeof(uint32_t);
+    }
 
-    if ((err_code == NRF_SUCCESS) && (m_tx_buffer_index == 0))
+    while (index < length)
     {
-        // Packet transmission started.
-        send_tx_byte = send_tx_byte_default;
+        if ((p_data[index] == APP_SLIP_END) || (p_data[index] == APP_SLIP_ESC))
+        {
+            return index;
+        }
+        index++;
     }
 
-    return err_code;
+    return length;
 }
 
 
-static uint32_t send_tx_byte_default(void)
+/**@brief Function for transferring the SLIP end frame byte, 0xC0.
+ *
+ * @param[in]  next_step  Step to continue with when the byte was put in the UART buffer.
+ */
+static uint32_t send_tx_byte_end(slip_tx_step_t next_step)
 {
-    uint32_t err_code = app_uart_put(mp_tx_buffer[m_tx_buffer_index]);
+    uint32_t err_code = app_uart_put(APP_SLIP_END);
 
     if (err_code == NRF_SUCCESS)
     {
-        m_tx_buffer_index++;
+        m_tx_step = next_step;
     }
 
     return err_code;
 }
 
 
-static uint32_t send_tx_byte_encoded(void)
+/**@brief Function for transferring data from the current buffer of the chain until a byte that
+ *        collides with the SLIP commands is reached, the buffer is done or the UART buffer is
+ *        full.
+ */
+static uint32_t send_tx_run(void)
 {
-    uint32_t err_code;
+    const hci_slip_buffer_t * p_buffer = &mp_tx_chain[m_tx_chain_index];
+    const uint8_t *           p_data   = &p_buffer->p_data[m_tx_buffer_index];
 
-    switch(mp_tx_buffer[m_tx_buffer_index])
+    if (m_tx_run_length == 0)
     {
-        case APP_SLIP_END:
-            err_code = app_uart_put(APP_SLIP_ESC_END);
-            break;
+        m_tx_run_length = slip_plain_run_length(p_data, p_buffer->length - m_tx_buffer_index);
 
-        case APP_SLIP_ESC:
-            err_code = app_uart_put(APP_SLIP_ESC_ESC);
-            break;
-
-        default:
-            err_code = NRF_ERROR_NO_MEM;
-            break;
+        if (m_tx_run_length == 0)
+        {
+            // Special byte, send it as an escape sequence.
+            m_tx_step = TX_STEP_ESC;
+            return NRF_SUCCESS;
+        }
     }
 
-    if (err_code == NRF_SUCCESS)
+    while (m_tx_run_length > 0)
     {
-        m_tx_buffer_index++;
-        send_tx_byte = send_tx_byte_default;
+        uint32_t length   = m_tx_run_length;
+        uint32_t err_code = app_uart_write(p_data, &length);
+
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+        p_data            += length;
+        m_tx_buffer_index += length;
+        m_tx_run_length   -= length;
     }
 
-    return err_code;
+    return NRF_SUCCESS;
 }
 
 
+/**@brief Function for transferring a SLIP escape byte (0xDB) when special bytes are transferred,
+ *        that is 0xC0 and 0xDB.
+ */
 static uint32_t send_tx_byte_esc(void)
 {
     uint32_t err_code = app_uart_put(APP_SLIP_ESC);
 
     if (err_code == NRF_SUCCESS)
     {
-        send_tx_byte = send_tx_byte_encoded;
+        m_tx_step = TX_STEP_ESC_CODE;
     }
 
     return err_code;
 }
 
 
-/** @brief Function for transferring the content of the mp_tx_buffer to the UART.
- *         It continues to transfer bytes until the UART buffer is full or the complete buffer is
- *         transferred.
+/**@brief Function for transferring a byte when it collides with SLIP commands and follows the SLIP
+ *        escape byte, that is 0xC0 => 0xDC and 0xDB => 0xDD.
  */
-static void transmit_buffer(void)
+static uint32_t send_tx_byte_encoded(void)
 {
-    uint32_t err_code = NRF_SUCCESS;
+    const uint8_t byte = mp_tx_chain[m_tx_chain_index].p_data[m_tx_buffer_index];
+    uint32_t      err_code;
 
-    while (m_tx_buffer_index < m_tx_buffer_length)
-    {
-        if ((mp_tx_buffer[m_tx_buffer_index] == APP_SLIP_END  ||
-             mp_tx_buffer[m_tx_buffer_index] == APP_SLIP_ESC) &&
-             send_tx_byte == send_tx_byte_default)
-        {
-            send_tx_byte = send_tx_byte_esc;
-        }
-
-        err_code = send_tx_byte();
+    err_code = app_uart_put((byte == APP_SLIP_END) ? APP_SLIP_ESC_END : APP_SLIP_ESC_ESC);
 
-        if (err_code == NRF_ERROR_NO_MEM)
-        {
-            // No memory left in UART TX buffer. Abort and wait for APP_UART_TX_EMPTY to continue.
-            return;
-        }
+    if (err_code == NRF_SUCCESS)
+    {
+        m_tx_buffer_index++;
+        m_tx_step = TX_STEP_DATA;
     }
 
-    send_tx_byte = send_tx_byte_end;
+    return err_code;
+}
 
-    err_code = send_tx_byte();
 
-    if (err_code == NRF_SUCCESS)
-    {
-        // Packet transmission ended. Notify higher level.
-        m_current_state = SLIP_READY;
+/** @brief Function for transferring the buffer chain to the UART.
+ *         It continues to transfer bytes until the UART buffer is full or the complete chain is
+ *         transferred.
+ */
+static void transmit_buffer(void)
+{
+    uint32_t err_code = NRF_SUCCESS;
 
-        if (m_slip_event_handler != NULL)
+    while (err_code == NRF_SUCCESS)
+    {
+        switch (m_tx_step)
         {
-            hci_slip_evt_t event = {HCI_SLIP_TX_DONE, mp_tx_buffer, m_tx_buffer_index};
-
-            m_slip_event_handler(event);
+            case TX_STEP_START:
+                err_code = send_tx_byte_end(TX_STEP_DATA);
+                break;
+
+            case TX_STEP_DATA:
+                if (m_tx_chain_index == m_tx_chain_count)
+                {
+                    m_tx_step = TX_STEP_END;
+                }
+                else if (m_tx_buffer_index == mp_tx_chain[m_tx_chain_index].length)
+                {
+                    m_tx_packet_length += m_tx_buffer_index;
+                    m_tx_buffer_index   = 0;
+                    m_tx_chain_index++;
+                }
+                else
+                {
+                    err_code = send_tx_run();
+                }
+                break;
+
+            case TX_STEP_ESC:
+                err_code = send_tx_byte_esc();
+                break;
+
+            case TX_STEP_ESC_CODE:
+                err_code = send_tx_byte_encoded();
+                break;
+
+            case TX_STEP_END:
+            default:
+                err_code = send_tx_byte_end(TX_STEP_START);
+
+                if (err_code == NRF_SUCCESS)
+                {
+                    // Packet transmission ended. Notify higher level.
+                    m_current_state = SLIP_READY;
+
+                    if (m_slip_event_handler != NULL)
+                    {
+                        hci_slip_evt_t event = {HCI_SLIP_TX_DONE,
+                                                mp_tx_chain[0].p_data,
+                                                m_tx_packet_length};
+
+                        m_slip_event_handler(event);
+                    }
+                    return;
+                }
+                break;
         }
     }
+
+    // No memory left in UART TX buffer. Wait for APP_UART_TX_EMPTY to continue.
 }
 
 
@@ -402,11 +497,47 @@ uint32_t hci_slip_write(const uint8_t * p_buffer, uint32_t length)
     switch (m_current_state)
     {
         case SLIP_READY:
+            m_tx_buffer.p_data = p_buffer;
+            m_tx_buffer.length = length;
+
+            return hci_slip_write_chain(&m_tx_buffer, 1);
+
+        case SLIP_TRANSMITTING:
+            return NRF_ERROR_NO_MEM;
+
+        case SLIP_OFF:
+        default:
+            return NRF_ERROR_INVALID_STATE;
+    }
+}
+
+
+uint32_t hci_slip_write_chain(const hci_slip_buffer_t * p_buffers, uint32_t count)
+{
+    if ((p_buffers == NULL) || (count == 0))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if ((p_buffers[i].p_data == NULL) && (p_buffers[i].length != 0))
+        {
+            return NRF_ERROR_INVALID_ADDR;
+        }
+    }
+
+    switch (m_current_state)
+    {
+        case SLIP_READY:
+            mp_tx_chain        = p_buffers;
+            m_tx_chain_count   = count;
+            m_tx_chain_index   = 0;
             m_tx_buffer_index  = 0;
-            m_tx_buffer_length = length;
-            mp_tx_buffer       = p_buffer;
+            m_tx_run_length    = 0;
+            m_tx_packet_length = 0;
+            m_tx_step          = TX_STEP_START;
             m_current_state    = SLIP_TRANSMITTING;
-            send_tx_byte       = send_tx_byte_end;
 
             transmit_buffer();
             return NRF_SUCCESS;
@@ -52,6 +52,14 @@ typedef struct
     uint32_t            packet_length;      /**< Packet length, i.e. SLIP_TX_DONE: Bytes transmitted, SLIP_RX_RDY: Bytes received, SLIP_RX_OVERFLOW: index at which the packet overflowed. */
 } hci_slip_evt_t;
 
+/**@brief Descriptor of one buffer in a chain of buffers written with \ref hci_slip_write_chain.
+ */
+typedef struct
+{
+    const uint8_t *     p_data;             /**< Pointer to the data of the buffer. */
+    uint32_t            length;             /**< Length of the buffer, in bytes. */
+} hci_slip_buffer_t;
+
 /**@brief Function for the SLIP layer event callback.
  */
 typedef void (*hci_slip_event_handler_t)(hci_slip_evt_t event);
@@ -107,6 +115,29 @@ uint32_t hci_slip_close(void);
  */
 uint32_t hci_slip_write(const uint8_t * p_buffer, uint32_t length);
 
+/**@brief Function for writing a chain of buffers as one packet with SLIP encoding. The buffers are
+ *        encoded in place, without being copied into one buffer first, e.g. a packet header, the
+ *        payload and a CRC kept in separate buffers. Packet transmission is confirmed when the
+ *        HCI_SLIP_TX_DONE event is received by the function caller, with the data pointer of the
+ *        first buffer and the total length of the chain.
+ *
+ * @note  The descriptors and the buffers they point to must stay valid until HCI_SLIP_TX_DONE is
+ *        received.
+ *
+ * @param[in] p_buffers             Pointer to the array of buffer descriptors.
+ * @param[in] count                 Number of buffers in the array.
+ *
+ * @retval NRF_SUCCESS              Operation success. Packet was encoded and added to the
+ *                                  transmission queue and an event will be sent upon transmission
+ *                                  completion.
+ * @retval NRF_ERROR_NO_MEM         Operation failure. Transmission queue is full and packet was not
+ *                                  added to the transmission queue. Application shall wait for
+ *                                  the \ref HCI_SLIP_TX_DONE event.
+ * @retval NRF_ERROR_INVALID_ADDR   If a NULL pointer or an empty chain is provided.
+ * @retval NRF_ERROR_INVALID_STATE  Operation failure. Module is not open.
+ */
+uint32_t hci_slip_write_chain(const hci_slip_buffer_t * p_buffers, uint32_t count);
+
 /**@brief Function for registering a receive buffer. The receive buffer will be used for storage of
  *        received and SLIP decoded data.
  *        No data can be received by the SLIP layer until a receive buffer has been registered.
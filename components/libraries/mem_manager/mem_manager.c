@@ -14,6 +14,7 @@
 #include "sdk_common.h"
 #include "mem_manager.h"
 #include "app_trace.h"
+#include "app_util_platform.h"
 
 /**
  * @defgroup mem_manager_log Module's Log Macros
@@ -99,19 +100,21 @@
 
 #endif //MEM_MANAGER_DISABLE_API_PARAM_CHECK
 
-#define BLOCK_CAT_COUNT                3                                                            /**< Block category count is 3 (small, medium and large). Having one of the block count to zero has no impact on this count. */
+#define BLOCK_CAT_COUNT                MEM_MANAGER_BLOCK_CAT_COUNT                                  /**< Block category count is 3 (small, medium and large). Having one of the block count to zero has no impact on this count. */
 #define BLOCK_CAT_SMALL                0                                                            /**< Small category identifier. */
 #define BLOCK_CAT_MEDIUM               1                                                            /**< Medium category identifier. */
 #define BLOCK_CAT_LARGE                2                                                            /**< Large category identifier. */
 
+/** Distance between blocks of a category. Blocks are word aligned so a free block can hold the
+    free list link. */
+#define BLOCK_STRIDE(SIZE)             ((((SIZE) + sizeof(uint32_t) - 1) / sizeof(uint32_t)) * sizeof(uint32_t))
 
-/** Memory block type. */
-typedef struct
+
+/** Free block, linked into the free list of its category through its own memory. */
+typedef struct mem_free_block_s
 {
-   uint8_t   * p_block;                                                                             /**< Pointer to memory region of the block. */
-   bool        is_free;                                                                             /**< Indicates whether the memory region has been assigned or is free. */
-   uint8_t     block_cat;                                                                           /**< Identifies to which category the block belongs, small, large or medium. */
-}mem_block_t;
+   struct mem_free_block_s * p_next;                                                                /**< Next free block of the same category. */
+}mem_free_block_t;
 
 /** Based on which blocks are defined, MAX_MEM_SIZE is determined.
     Also, in case none of these are defined, a compile time error is indicated. */
@@ -133,14 +136,41 @@ typedef struct
                            MEMORY_MANAGER_LARGE_BLOCK_COUNT)
 
 
-#define TOTAL_MEMORY_SIZE ((MEMORY_MANAGER_SMALL_BLOCK_COUNT * MEMORY_MANAGER_SMALL_BLOCK_SIZE)   + \
-                           (MEMORY_MANAGER_MEDIUM_BLOCK_COUNT * MEMORY_MANAGER_MEDIUM_BLOCK_SIZE) + \
-                           (MEMORY_MANAGER_LARGE_BLOCK_COUNT  * MEMORY_MANAGER_LARGE_BLOCK_SIZE))
+#define TOTAL_MEMORY_SIZE ((MEMORY_MANAGER_SMALL_BLOCK_COUNT * BLOCK_STRIDE(MEMORY_MANAGER_SMALL_BLOCK_SIZE))   + \
+                           (MEMORY_MANAGER_MEDIUM_BLOCK_COUNT * BLOCK_STRIDE(MEMORY_MANAGER_MEDIUM_BLOCK_SIZE)) + \
+                           (MEMORY_MANAGER_LARGE_BLOCK_COUNT  * BLOCK_STRIDE(MEMORY_MANAGER_LARGE_BLOCK_SIZE)))
+
+
+/**
+ * @defgroup mem_manager_lock Module's Lock/Unlock Macros.
+ *
+ * @details With MEM_MANAGER_INTERRUPT_SAFE, allocation and freeing are done with interrupts
+ *          disabled, which takes a bounded handful of instructions as no list is searched. This
+ *          allows the module to be used from interrupt handlers of any priority. Cortex-M0 has
+ *          no exclusive access instructions, so this is the cheapest safe option.
+ * @{
+ */
+#if (MEM_MANAGER_INTERRUPT_SAFE == 1)
+#define MM_LOCK()   CRITICAL_REGION_ENTER()                                                         /**< Lock module by disabling interrupts. */
+#define MM_UNLOCK() CRITICAL_REGION_EXIT()                                                          /**< Unlock module. */
+#else
+#define MM_LOCK()   MM_MUTEX_LOCK()                                                                 /**< Lock module using mutex. */
+#define MM_UNLOCK() MM_MUTEX_UNLOCK()                                                               /**< Unlock module using mutex. */
+#endif // MEM_MANAGER_INTERRUPT_SAFE
+/** @} */
+
+
+static uint32_t m_memory[TOTAL_MEMORY_SIZE / sizeof(uint32_t)];                                     /**< Memory managed by the module. */
 
+static mem_free_block_t * m_free_list[BLOCK_CAT_COUNT];                                             /**< Head of the free list of each category. */
 
-static uint8_t m_memory[TOTAL_MEMORY_SIZE];                                                         /**< Memory managed by the module. */
+static uint8_t m_block_in_use[(TOTAL_BLOCK_COUNT + 7) / 8];                                         /**< Bit per block, set while the block is allocated. Catches frees of blocks that are not allocated. */
 
-static mem_block_t m_mem_pool[TOTAL_BLOCK_COUNT];                                                   /**< Pool of memory blocks managed by the module. */
+static mem_manager_cat_stats_t m_stats[BLOCK_CAT_COUNT];                                            /**< Usage statistics of each category. */
+
+#if (MEM_MANAGER_ENABLE_DIAGNOSTICS == 1)
+static uint16_t m_requested_size[TOTAL_BLOCK_COUNT];                                                /**< Size requested for each allocated block. */
+#endif // MEM_MANAGER_ENABLE_DIAGNOSTICS
 
 static const uint32_t m_block_size[BLOCK_CAT_COUNT] =                                               /**< Lookup table used to know the max size of block */
 {
@@ -149,17 +179,67 @@ static const uint32_t m_block_size[BLOCK_CAT_COUNT] =
 	MEMORY_MANAGER_LARGE_BLOCK_SIZE
 };
 
+static const uint32_t m_block_count[BLOCK_CAT_COUNT] =                                              /**< Lookup table used to know the block count of a category. */
+{
+    MEMORY_MANAGER_SMALL_BLOCK_COUNT,
+    MEMORY_MANAGER_MEDIUM_BLOCK_COUNT,
+    MEMORY_MANAGER_LARGE_BLOCK_COUNT
+};
+
+static const uint32_t m_block_stride[BLOCK_CAT_COUNT] =                                             /**< Lookup table used to know the distance between blocks of a category. */
+{
+    BLOCK_STRIDE(MEMORY_MANAGER_SMALL_BLOCK_SIZE),
+    BLOCK_STRIDE(MEMORY_MANAGER_MEDIUM_BLOCK_SIZE),
+    BLOCK_STRIDE(MEMORY_MANAGER_LARGE_BLOCK_SIZE)
+};
+
+static uint8_t * m_cat_start[BLOCK_CAT_COUNT];                                                      /**< First block of each category. */
+
 SDK_MUTEX_DEFINE(m_mm_mutex)                                                                        /**< Mutex variable. Currently unused, this declaration does not occupy any space in RAM. */
 #if (MEM_MANAGER_DISABLE_API_PARAM_CHECK == 0)
 static bool     m_module_initialized = false;                                                       /**< State indicating if module is initialized or not. */
 #endif // MEM_MANAGER_DISABLE_API_PARAM_CHECK
 
 
+/**@brief Gets the index of a block among all blocks of the module. */
+static __INLINE uint32_t block_index_get(uint32_t block_cat, uint32_t index_in_cat)
+{
+    uint32_t index = index_in_cat;
+
+    for (uint32_t cat = 0; cat < block_cat; cat++)
+    {
+        index += m_block_count[cat];
+    }
+    return index;
+}
+
 
-/**@brief Initializes the block by setting it to be free. */
-static __INLINE void block_init (mem_block_t * p_block)
+static __INLINE bool block_is_in_use(uint32_t index)
 {
-    p_block->is_free = true;
+    return ((m_block_in_use[index / 8] & (1 << (index % 8))) != 0);
+}
+
+
+static __INLINE void block_in_use_set(uint32_t index, bool in_use)
+{
+    if (in_use)
+    {
+        m_block_in_use[index / 8] |= (uint8_t)(1 << (index % 8));
+    }
+    else
+    {
+        m_block_in_use[index / 8] &= (uint8_t)~(1 << (index % 8));
+    }
+}
+
+
+/**@brief Initializes the block by putting it on the free list of its category. */
+static __INLINE void block_init(uint32_t block_cat, uint8_t * p_block)
+{
+    mem_free_block_t * p_free = (mem_free_block_t *)p_block;
+
+    p_free->p_next         = m_free_list[block_cat];
+    m_free_list[block_cat] = p_free;
 }
 
 
@@ -171,52 +251,27 @@ uint32_t nrf51_sdk_mem_init(void)
 
     MM_MUTEX_LOCK();
 
-    uint32_t index = 0;
-    uint32_t pool_block_size;
-    uint8_t  * p_memory = m_memory;
-    uint32_t block_count = 0;
-
-#if (MEMORY_MANAGER_SMALL_BLOCK_COUNT != 0)
-
-    pool_block_size = MEMORY_MANAGER_SMALL_BLOCK_SIZE;
-    block_count    += MEMORY_MANAGER_SMALL_BLOCK_COUNT;
-	
-    for(; index < block_count; index++)
-    {
-        block_init(&m_mem_pool[index]);
-        m_mem_pool[index].p_block    = p_memory;
-        p_memory                    += pool_block_size;
-		m_mem_pool[index].block_cat  = BLOCK_CAT_SMALL;        
-    }
-#endif // MEMORY_MANAGER_SMALL_BLOCK_COUNT
+    uint8_t  * p_memory = (uint8_t *)m_memory;
+    uint32_t   block_cat;
+    uint32_t   index;
 
-#if (MEMORY_MANAGER_MEDIUM_BLOCK_COUNT != 0)
+    memset(m_block_in_use, 0, sizeof(m_block_in_use));
+    memset(m_stats, 0, sizeof(m_stats));
 
-    pool_block_size = MEMORY_MANAGER_MEDIUM_BLOCK_SIZE;
-    block_count    += MEMORY_MANAGER_MEDIUM_BLOCK_COUNT;
-	
-    for(; index < block_count; index++)
+    for (block_cat = 0; block_cat < BLOCK_CAT_COUNT; block_cat++)
     {
-        block_init(&m_mem_pool[index]);
-        m_mem_pool[index].p_block   = p_memory;
-        p_memory                   += pool_block_size;
-		m_mem_pool[index].block_cat = BLOCK_CAT_MEDIUM;
-    }
-#endif // MEMORY_MANAGER_MEDIUM_BLOCK_COUNT
-
-#if (MEMORY_MANAGER_LARGE_BLOCK_COUNT != 0)
+        m_cat_start[block_cat]        = p_memory;
+        m_free_list[block_cat]        = NULL;
+        m_stats[block_cat].block_size  = m_block_size[block_cat];
+        m_stats[block_cat].block_count = m_block_count[block_cat];
 
-    pool_block_size = MEMORY_MANAGER_LARGE_BLOCK_SIZE;
-    block_count    += MEMORY_MANAGER_LARGE_BLOCK_COUNT;
-	
-    for(; index <block_count; index++)
-    {
-        block_init(&m_mem_pool[index]);
-        m_mem_pool[index].p_block   = p_memory;
-        p_memory                   += pool_block_size;
-		m_mem_pool[index].block_cat = BLOCK_CAT_LARGE;
+        // Pushed in reverse, so blocks are handed out from the start of the category.
+        for (index = m_block_count[block_cat]; index > 0; index--)
+        {
+            block_init(block_cat, p_memory + (index - 1) * m_block_stride[block_cat]);
+        }
+        p_memory += m_block_count[block_cat] * m_block_stride[block_cat];
     }
-#endif // MEMORY_MANAGER_LARGE_BLOCK_COUNT
 
 #if (MEM_MANAGER_DISABLE_API_PARAM_CHECK == 0)
     m_module_initialized = true;
@@ -241,43 +296,70 @@ uint32_t nrf51_sdk_mem_alloc(uint8_t ** pp_buffer, uint32_t * p_size)
 
     MM_LOG("[MM]: >> nrf51_sdk_mem_alloc, size 0x%04lX.\r\n", requested_size);
 
-    MM_MUTEX_LOCK();
-
-    uint32_t err_code = (NRF_ERROR_NO_MEM | MEMORY_MANAGER_ERR_BASE);
-    uint32_t index;
+    uint32_t           err_code = (NRF_ERROR_NO_MEM | MEMORY_MANAGER_ERR_BASE);
+    uint32_t           best_cat;
+    uint32_t           block_cat;
+    mem_free_block_t * p_free   = NULL;
 
     // Check which block size is best suited for requested memory size.
     if (requested_size <= MEMORY_MANAGER_SMALL_BLOCK_SIZE)
     {
-        index = 0;
+        best_cat = BLOCK_CAT_SMALL;
     }
     else if(requested_size <= MEMORY_MANAGER_MEDIUM_BLOCK_SIZE)
     {
-       index = MEMORY_MANAGER_SMALL_BLOCK_COUNT;
+        best_cat = BLOCK_CAT_MEDIUM;
     }
     else
     {
-       index = (MEMORY_MANAGER_SMALL_BLOCK_COUNT + MEMORY_MANAGER_MEDIUM_BLOCK_COUNT);
+        best_cat = BLOCK_CAT_LARGE;
     }
 
-    MM_LOG("[MM]: Start index for the pool = 0x%08lX, total block count 0x%08X\r\n",
-           index, TOTAL_BLOCK_COUNT);
+    MM_LOCK();
 
-    for (; index < TOTAL_BLOCK_COUNT; index++)
+    // Take the first free block of the best suited category, or of a larger one if it is empty.
+    for (block_cat = best_cat; block_cat < BLOCK_CAT_COUNT; block_cat++)
     {
-        if (m_mem_pool[index].is_free == true)
+        p_free = m_free_list[block_cat];
+        if (p_free != NULL)
         {
-            MM_LOG("[MM]: Assigning block 0x%08lX\r\n", index);
-            // Found a free block of memory, assign.
-            m_mem_pool[index].is_free = false;
-            (*pp_buffer)              = m_mem_pool[index].p_block;
-            err_code                  = NRF_SUCCESS;
-			(*p_size)                 = m_block_size[m_mem_pool[index].block_cat];
+            uint32_t index = block_index_get(block_cat,
+                                             ((uint8_t *)p_free - m_cat_start[block_cat]) /
+                                             m_block_stride[block_cat]);
+
+            m_free_list[block_cat] = p_free->p_next;
+            block_in_use_set(index, true);
+
+            m_stats[block_cat].in_use++;
+            if (m_stats[block_cat].in_use > m_stats[block_cat].max_in_use)
+            {
+                m_stats[block_cat].max_in_use = m_stats[block_cat].in_use;
+            }
+            if (block_cat != best_cat)
+            {
+                m_stats[best_cat].fallback_allocs++;
+            }
+#if (MEM_MANAGER_ENABLE_DIAGNOSTICS == 1)
+            m_requested_size[index]             = (uint16_t)requested_size;
+            m_stats[block_cat].bytes_requested += requested_size;
+#endif // MEM_MANAGER_ENABLE_DIAGNOSTICS
             break;
         }
     }
+    if (p_free == NULL)
+    {
+        m_stats[best_cat].alloc_failures++;
+    }
 
-    MM_MUTEX_UNLOCK();
+    MM_UNLOCK();
+
+    if (p_free != NULL)
+    {
+        MM_LOG("[MM]: Assigning block %p of category %ld\r\n", p_free, block_cat);
+        (*pp_buffer) = (uint8_t *)p_free;
+        (*p_size)    = m_block_size[block_cat];
+        err_code     = NRF_SUCCESS;
+    }
 
     MM_LOG("[MM]: << nrf51_sdk_mem_alloc %p, result 0x%08lX.\r\n", (*pp_buffer), err_code);
 
@@ -292,23 +374,88 @@ uint32_t nrf51_sdk_mem_free(uint8_t * p_buffer)
 
     MM_LOG("[MM]: >> nrf51_sdk_mem_free %p.\r\n", p_buffer);
 
-    MM_MUTEX_LOCK();
     uint32_t err_code = (NRF_ERROR_INVALID_ADDR | MEMORY_MANAGER_ERR_BASE);
-    uint32_t index;
+    uint32_t block_cat;
 
-    for (index = 0; index < TOTAL_BLOCK_COUNT; index++)
+    for (block_cat = 0; block_cat < BLOCK_CAT_COUNT; block_cat++)
     {
-        if (m_mem_pool[index].p_block == p_buffer)
+        uint32_t offset = (uint32_t)(p_buffer - m_cat_start[block_cat]);
+
+        // An offset beyond the category also covers addresses before its start.
+        if ((p_buffer >= m_cat_start[block_cat]) &&
+            (offset < m_block_count[block_cat] * m_block_stride[block_cat]))
         {
-            // Found a free block of memory, assign.
-            block_init(&m_mem_pool[index]);
-            err_code = NRF_SUCCESS;
+            if ((offset % m_block_stride[block_cat]) == 0)
+            {
+                uint32_t index = block_index_get(block_cat, offset / m_block_stride[block_cat]);
+
+                MM_LOCK();
+                if (block_is_in_use(index))
+                {
+                    block_in_use_set(index, false);
+                    block_init(block_cat, p_buffer);
+                    m_stats[block_cat].in_use--;
+#if (MEM_MANAGER_ENABLE_DIAGNOSTICS == 1)
+                    m_stats[block_cat].bytes_requested -= m_requested_size[index];
+#endif // MEM_MANAGER_ENABLE_DIAGNOSTICS
+                    err_code = NRF_SUCCESS;
+                }
+                MM_UNLOCK();
+            }
             break;
         }
     }
 
-    MM_MUTEX_UNLOCK();
-
     MM_LOG("[MM]: << nrf51_sdk_mem_free, result 0x%08lX.\r\n", err_code);
     return err_code;
 }
+
+
+uint32_t nrf51_sdk_mem_stats_get(mem_manager_stats_t * p_stats)
+{
+    VERIFY_MODULE_INITIALIZED();
+    NULL_PARAM_CHECK(p_stats);
+
+    MM_LOCK();
+    memcpy(p_stats->cat, m_stats, sizeof(m_stats));
+    MM_UNLOCK();
+
+    return NRF_SUCCESS;
+}
+
+
+void nrf51_sdk_mem_diagnose(void)
+{
+    mem_manager_stats_t stats;
+    uint32_t            block_cat;
+
+    if (nrf51_sdk_mem_stats_get(&stats) != NRF_SUCCESS)
+    {
+        return;
+    }
+
+    MM_LOG("[MM]: Category   Size  Count  In use  Max  Failed  Larger  Unused bytes\r\n");
+    for (block_cat = 0; block_cat < BLOCK_CAT_COUNT; block_cat++)
+    {
+        mem_manager_cat_stats_t * p_cat = &stats.cat[block_cat];
+
+        // Bytes of the blocks in use that were not asked for: the internal fragmentation.
+#if (MEM_MANAGER_ENABLE_DIAGNOSTICS == 1)
+        uint32_t unused = p_cat->in_use * p_cat->block_size - p_cat->bytes_requested;
+#else
+        uint32_t unused = 0;
+#endif // MEM_MANAGER_ENABLE_DIAGNOSTICS
+
+        UNUSED_VARIABLE(p_cat);
+        UNUSED_VARIABLE(unused);
+        MM_LOG("[MM]: %8ld %6ld %6ld %7ld %4ld %7ld %7ld %13ld\r\n",
+               block_cat,
+               p_cat->block_size,
+               p_cat->block_count,
+               p_cat->in_use,
+               p_cat->max_in_use,
+               p_cat->alloc_failures,
+               p_cat->fallback_allocs,
+               unused);
+    }
+}
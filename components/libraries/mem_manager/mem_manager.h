@@ -28,12 +28,44 @@
  * requirements in the configuration file @c sdk_config.h.
  * To disable any of the pools, define the block count to be zero.
  *
+ * Free blocks of each pool are kept in a list linked through the blocks
+ * themselves, so allocating and freeing take constant time. When the best
+ * suited pool is exhausted, a block of a larger pool is given out.
+ *
  */
 #ifndef MEM_MANAGER_H__
 #define MEM_MANAGER_H__
 
 #include "sdk_common.h"
 
+#ifndef MEM_MANAGER_INTERRUPT_SAFE
+#define MEM_MANAGER_INTERRUPT_SAFE      0   /**< Set to 1 to allow use from interrupt handlers of any priority; allocation and freeing then run with interrupts briefly disabled. */
+#endif
+
+#ifndef MEM_MANAGER_ENABLE_DIAGNOSTICS
+#define MEM_MANAGER_ENABLE_DIAGNOSTICS  0   /**< Set to 1 to track the requested size of each block, for the unused bytes in @ref nrf51_sdk_mem_diagnose. Takes 2 bytes of RAM per block. */
+#endif
+
+#define MEM_MANAGER_BLOCK_CAT_COUNT     3   /**< Number of block categories: small, medium and large. */
+
+/**@brief Usage statistics of one block category. */
+typedef struct
+{
+    uint32_t block_size;        /**< Size of the blocks of the category. */
+    uint32_t block_count;       /**< Number of blocks in the category. */
+    uint32_t in_use;            /**< Number of blocks currently allocated. */
+    uint32_t max_in_use;        /**< Highest number of blocks allocated at the same time. */
+    uint32_t alloc_failures;    /**< Allocations best suited for this category that failed, as this and all larger categories were exhausted. */
+    uint32_t fallback_allocs;   /**< Allocations best suited for this category that were given a block of a larger category, as this one was exhausted. */
+    uint32_t bytes_requested;   /**< Sum of the sizes requested for the blocks in use, only tracked with MEM_MANAGER_ENABLE_DIAGNOSTICS. */
+} mem_manager_cat_stats_t;
+
+/**@brief Usage statistics of the Memory Manager. */
+typedef struct
+{
+    mem_manager_cat_stats_t cat[MEM_MANAGER_BLOCK_CAT_COUNT];   /**< Statistics of the small, medium and large categories. */
+} mem_manager_stats_t;
+
 
 /**@brief Initializes Memory Manager.
  *
@@ -85,10 +117,28 @@ uint32_t nrf51_sdk_mem_alloc(uint8_t ** pp_buffer, uint32_t * p_size);
  *                                    Otherwise, an error code that indicates
  *                                    the reason for the failure is returned.
  * @retval     NRF_ERROR_INVALID_ADDR If the memory that was requested to be 
- *                                    freed is not managed by the Memory Manager.
+ *                                    freed is not managed by the Memory Manager,
+ *                                    is not the start of a block, or is not
+ *                                    allocated.
  */
 uint32_t nrf51_sdk_mem_free(uint8_t * p_buffer);
 
 
+/**@brief Gets usage statistics.
+ *
+ * @param[out] p_stats    Statistics of each block category.
+ *
+ * @retval     NRF_SUCCESS             If the statistics were copied.
+ * @retval     NRF_ERROR_NULL          If p_stats is NULL.
+ */
+uint32_t nrf51_sdk_mem_stats_get(mem_manager_stats_t * p_stats);
+
+
+/**@brief Logs the usage statistics of each block category, including the bytes of allocated
+ *        blocks that were not requested, with the module logs.
+ */
+void nrf51_sdk_mem_diagnose(void);
+
+
 #endif // MEM_MANAGER_H__
 /** @} */
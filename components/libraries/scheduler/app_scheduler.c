@@ -30,10 +30,10 @@ STATIC_ASSERT(sizeof(event_header_t) <= APP_SCHED_EVENT_HEADER_SIZE);
 
 static event_header_t * m_queue_event_headers;  /**< Array for holding the queue event headers. */
 static uint8_t        * m_queue_event_data;     /**< Array for holding the queue event data. */
-static volatile uint8_t m_queue_start_index;    /**< Index of queue entry at the start of the queue. */
-static volatile uint8_t m_queue_end_index;      /**< Index of queue entry at the end of the queue. */
+static volatile uint8_t m_queue_start_index[APP_SCHED_LANE_COUNT]; /**< Index of queue entry at the start of each lane. */
+static volatile uint8_t m_queue_end_index[APP_SCHED_LANE_COUNT];   /**< Index of queue entry at the end of each lane. */
 static uint16_t         m_queue_event_size;     /**< Maximum event size in queue. */
-static uint16_t         m_queue_size;           /**< Number of queue entries. */
+static uint16_t         m_queue_size;           /**< Number of queue entries in each lane. */
 
 /**@brief Function for incrementing a queue index, and handle wrap-around.
  *
@@ -46,30 +46,36 @@ static __INLINE uint8_t next_index(uint8_t index)
     return (index < m_queue_size) ? (index + 1) : 0;
 }
 
+/**@brief Function for getting the position of a lane's queue entry in the header and data arrays. */
+static __INLINE uint16_t slot_get(uint8_t lane, uint8_t index)
+{
+    return lane * (m_queue_size + 1) + index;
+}
+
 
-static __INLINE uint8_t app_sched_queue_full()
+static __INLINE uint8_t app_sched_queue_full(uint8_t lane)
 {
-  uint8_t tmp = m_queue_start_index;
-  return next_index(m_queue_end_index) == tmp;
+  uint8_t tmp = m_queue_start_index[lane];
+  return next_index(m_queue_end_index[lane]) == tmp;
 }
 
-/**@brief Macro for checking if a queue is full. */
-#define APP_SCHED_QUEUE_FULL() app_sched_queue_full()
+/**@brief Macro for checking if a lane is full. */
+#define APP_SCHED_QUEUE_FULL(lane) app_sched_queue_full(lane)
 
 
-static __INLINE uint8_t app_sched_queue_empty()
+static __INLINE uint8_t app_sched_queue_empty(uint8_t lane)
 {
-  uint8_t tmp = m_queue_start_index;
-  return m_queue_end_index == tmp;
+  uint8_t tmp = m_queue_start_index[lane];
+  return m_queue_end_index[lane] == tmp;
 }
 
-/**@brief Macro for checking if a queue is empty. */
-#define APP_SCHED_QUEUE_EMPTY() app_sched_queue_empty()
+/**@brief Macro for checking if a lane is empty. */
+#define APP_SCHED_QUEUE_EMPTY(lane) app_sched_queue_empty(lane)
 
 
 uint32_t app_sched_init(uint16_t event_size, uint16_t queue_size, void * p_event_buffer)
 {
-    uint16_t data_start_index = (queue_size + 1) * sizeof(event_header_t);
+    uint16_t data_start_index = (queue_size + 1) * APP_SCHED_LANE_COUNT * sizeof(event_header_t);
 
     // Check that buffer is correctly aligned
     if (!is_word_aligned(p_event_buffer))
@@ -80,8 +86,11 @@ uint32_t app_sched_init(uint16_t event_size, uint16_t queue_size, void * p_event
     // Initialize event scheduler
     m_queue_event_headers = p_event_buffer;
     m_queue_event_data    = &((uint8_t *)p_event_buffer)[data_start_index];
-    m_queue_end_index     = 0;
-    m_queue_start_index   = 0;
+    for (uint8_t lane = 0; lane < APP_SCHED_LANE_COUNT; lane++)
+    {
+        m_queue_end_index[lane]   = 0;
+        m_queue_start_index[lane] = 0;
+    }
     m_queue_event_size    = event_size;
     m_queue_size          = queue_size;
 
@@ -89,104 +98,182 @@ uint32_t app_sched_init(uint16_t event_size, uint16_t queue_size, void * p_event
 }
 
 
-uint32_t app_sched_event_put(void                    * p_event_data,
-                             uint16_t                  event_data_size,
-                             app_sched_event_handler_t handler)
+uint32_t app_sched_event_reserve(uint16_t                  event_data_size,
+                                 uint8_t                   lane,
+                                 app_sched_reservation_t * p_reservation)
 {
-    uint32_t err_code;
+    uint16_t slot = 0xFFFF;
 
-    if (event_data_size <= m_queue_event_size)
+    if (p_reservation == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (lane >= APP_SCHED_LANE_COUNT)
     {
-        uint16_t event_index = 0xFFFF;
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (event_data_size > m_queue_event_size)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
 
-        CRITICAL_REGION_ENTER();
+    CRITICAL_REGION_ENTER();
 
-        if (!APP_SCHED_QUEUE_FULL())
-        {
-            event_index       = m_queue_end_index;
-            m_queue_end_index = next_index(m_queue_end_index);
-        }
+    if (!APP_SCHED_QUEUE_FULL(lane))
+    {
+        slot                    = slot_get(lane, m_queue_end_index[lane]);
+        m_queue_end_index[lane] = next_index(m_queue_end_index[lane]);
 
-        CRITICAL_REGION_EXIT();
+        // The entry isn't executed until it has a handler.
+        m_queue_event_headers[slot].handler = NULL;
+    }
 
-        if (event_index != 0xFFFF)
-        {
-            // NOTE: This can be done outside the critical region since the event consumer will
-            //       always be called from the main loop, and will thus never interrupt this code.
-            m_queue_event_headers[event_index].handler = handler;
-            if ((p_event_data != NULL) && (event_data_size > 0))
-            {
-                memcpy(&m_queue_event_data[event_index * m_queue_event_size],
-                       p_event_data,
-                       event_data_size);
-                m_queue_event_headers[event_index].event_data_size = event_data_size;
-            }
-            else
-            {
-                m_queue_event_headers[event_index].event_data_size = 0;
-            }
+    CRITICAL_REGION_EXIT();
 
-            err_code = NRF_SUCCESS;
-        }
-        else
-        {
-            err_code = NRF_ERROR_NO_MEM;
-        }
+    if (slot == 0xFFFF)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    m_queue_event_headers[slot].event_data_size = event_data_size;
+    p_reservation->p_event_data = &m_queue_event_data[slot * m_queue_event_size];
+    p_reservation->slot         = slot;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_sched_event_commit(app_sched_reservation_t const * p_reservation,
+                                app_sched_event_handler_t       handler)
+{
+    if (p_reservation == NULL || handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (p_reservation->slot >= slot_get(APP_SCHED_LANE_COUNT, 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // Setting the handler last hands the complete entry over to app_sched_execute().
+    m_queue_event_headers[p_reservation->slot].handler = handler;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_sched_event_put_lane(void                    * p_event_data,
+                                  uint16_t                  event_data_size,
+                                  app_sched_event_handler_t handler,
+                                  uint8_t                   lane)
+{
+    app_sched_reservation_t reservation;
+    uint32_t                err_code;
+
+    if (event_data_size > m_queue_event_size)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_event_data == NULL)
+    {
+        event_data_size = 0;
     }
-    else
+
+    err_code = app_sched_event_reserve(event_data_size, lane, &reservation);
+    if (err_code == NRF_SUCCESS)
     {
-        err_code = NRF_ERROR_INVALID_LENGTH;
+        if (event_data_size > 0)
+        {
+            memcpy(reservation.p_event_data, p_event_data, event_data_size);
+        }
+        err_code = app_sched_event_commit(&reservation, handler);
     }
 
     return err_code;
 }
 
 
-/**@brief Function for reading the next event from specified event queue.
+uint32_t app_sched_event_put(void                    * p_event_data,
+                             uint16_t                  event_data_size,
+                             app_sched_event_handler_t handler)
+{
+    return app_sched_event_put_lane(p_event_data, event_data_size, handler, APP_SCHED_LANE_DEFAULT);
+}
+
+
+/**@brief Function for reading the next event from the highest priority lane that has one.
+ *
+ * @details The event stays in its queue entry until it's released with app_sched_event_release(),
+ *          so that producers can't overwrite it while its handler runs.
  *
  * @param[out]  pp_event_data       Pointer to pointer to event data.
  * @param[out]  p_event_data_size   Pointer to size of event data.
  * @param[out]  p_event_handler     Pointer to event handler function pointer.
+ * @param[out]  p_lane              Pointer to the lane of the event.
  *
  * @return      NRF_SUCCESS if new event, NRF_ERROR_NOT_FOUND if event queue is empty.
  */
 static uint32_t app_sched_event_get(void                     ** pp_event_data,
                                     uint16_t *                  p_event_data_size,
-                                    app_sched_event_handler_t * p_event_handler)
+                                    app_sched_event_handler_t * p_event_handler,
+                                    uint8_t *                   p_lane)
 {
-    uint32_t err_code = NRF_ERROR_NOT_FOUND;
-
-    if (!APP_SCHED_QUEUE_EMPTY())
+    for (uint8_t lane = 0; lane < APP_SCHED_LANE_COUNT; lane++)
     {
-        uint16_t event_index;
-
         // NOTE: There is no need for a critical region here, as this function will only be called
-        //       from app_sched_execute() from inside the main loop, so it will never interrupt
-        //       app_sched_event_put(). Also, updating of (i.e. writing to) the start index will be
-        //       an atomic operation.
-        event_index         = m_queue_start_index;
-        m_queue_start_index = next_index(m_queue_start_index);
+        //       from app_sched_execute_budget() from inside the main loop, so it will never
+        //       interrupt app_sched_event_reserve(). The handler of an entry that is reserved but
+        //       not committed is NULL.
+        if (!APP_SCHED_QUEUE_EMPTY(lane))
+        {
+            uint16_t slot = slot_get(lane, m_queue_start_index[lane]);
 
-        *pp_event_data     = &m_queue_event_data[event_index * m_queue_event_size];
-        *p_event_data_size = m_queue_event_headers[event_index].event_data_size;
-        *p_event_handler   = m_queue_event_headers[event_index].handler;
+            if (m_queue_event_headers[slot].handler != NULL)
+            {
+                *pp_event_data     = &m_queue_event_data[slot * m_queue_event_size];
+                *p_event_data_size = m_queue_event_headers[slot].event_data_size;
+                *p_event_handler   = m_queue_event_headers[slot].handler;
+                *p_lane            = lane;
 
-        err_code = NRF_SUCCESS;
+                return NRF_SUCCESS;
+            }
+        }
     }
 
-    return err_code;
+    return NRF_ERROR_NOT_FOUND;
 }
 
 
-void app_sched_execute(void)
+/**@brief Function for freeing the queue entry of the event last read from the given lane. */
+static __INLINE void app_sched_event_release(uint8_t lane)
+{
+    // Updating of (i.e. writing to) the start index is an atomic operation.
+    m_queue_start_index[lane] = next_index(m_queue_start_index[lane]);
+}
+
+
+uint32_t app_sched_execute_budget(uint32_t max_events)
 {
     void                    * p_event_data;
     uint16_t                  event_data_size;
     app_sched_event_handler_t event_handler;
+    uint8_t                   lane;
+    uint32_t                  count = 0;
 
     // Get next event (if any), and execute handler
-    while ((app_sched_event_get(&p_event_data, &event_data_size, &event_handler) == NRF_SUCCESS))
+    while ((count < max_events) &&
+           (app_sched_event_get(&p_event_data, &event_data_size, &event_handler, &lane) == NRF_SUCCESS))
     {
         event_handler(p_event_data, event_data_size);
+        app_sched_event_release(lane);
+        count++;
     }
+
+    return count;
+}
+
+
+void app_sched_execute(void)
+{
+    (void) app_sched_execute_budget(UINT32_MAX);
 }
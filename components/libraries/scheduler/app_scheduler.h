@@ -38,6 +38,17 @@
  *     with the appropriate data and event handler. This will insert an event into the
  *     scheduler's queue. The app_sched_execute() function will pull this event and call its
  *     handler in the main context.
+ *   - Alternatively, reserve a queue entry with app_sched_event_reserve(), write the event data
+ *     directly into it, and hand it to the scheduler with app_sched_event_commit(). This saves
+ *     copying the event data from a temporary buffer.
+ *
+ * @subsection app_scheduler_lanes Priority lanes:
+ *
+ *   Define APP_SCHED_LANE_COUNT to split the queue into several lanes, each with QUEUE_SIZE
+ *   entries. Events in lane 0 are executed first, and an event in a lower lane is executed
+ *   before any more events are taken from the higher lanes. app_sched_event_put() uses
+ *   APP_SCHED_LANE_DEFAULT. app_sched_execute_budget() limits the number of events executed in
+ *   one call, so that the main loop gets to run between bursts of events.
  *
  * @if (SD_S110 && !SD_S310)
  * For an example usage of the scheduler, see the implementations of
@@ -55,20 +66,35 @@
 
 #define APP_SCHED_EVENT_HEADER_SIZE 8       /**< Size of app_scheduler.event_header_t (only for use inside APP_SCHED_BUF_SIZE()). */
 
+#ifndef APP_SCHED_LANE_COUNT
+#define APP_SCHED_LANE_COUNT        1       /**< Number of priority lanes. Lane 0 has the highest priority. */
+#endif
+
+#ifndef APP_SCHED_LANE_DEFAULT
+#define APP_SCHED_LANE_DEFAULT      ((APP_SCHED_LANE_COUNT - 1) / 2) /**< Lane used by app_sched_event_put(). */
+#endif
+
 /**@brief Compute number of bytes required to hold the scheduler buffer.
  *
  * @param[in] EVENT_SIZE   Maximum size of events to be passed through the scheduler.
- * @param[in] QUEUE_SIZE   Number of entries in scheduler queue (i.e. the maximum number of events
- *                         that can be scheduled for execution).
+ * @param[in] QUEUE_SIZE   Number of entries in each lane of the scheduler queue (i.e. the maximum
+ *                         number of events in a lane that can be scheduled for execution).
  *
  * @return    Required scheduler buffer size (in bytes).
  */
 #define APP_SCHED_BUF_SIZE(EVENT_SIZE, QUEUE_SIZE)                                                 \
-            (((EVENT_SIZE) + APP_SCHED_EVENT_HEADER_SIZE) * ((QUEUE_SIZE) + 1))
+            (((EVENT_SIZE) + APP_SCHED_EVENT_HEADER_SIZE) * ((QUEUE_SIZE) + 1) * APP_SCHED_LANE_COUNT)
             
 /**@brief Scheduler event handler type. */
 typedef void (*app_sched_event_handler_t)(void * p_event_data, uint16_t event_size);
 
+/**@brief Queue entry reserved with app_sched_event_reserve(). */
+typedef struct
+{
+    void *   p_event_data;                  /**< Where to write the event data. */
+    uint16_t slot;                          /**< Queue entry, for internal usage. */
+} app_sched_reservation_t;
+
 /**@brief Macro for initializing the event scheduler.
  *
  * @details It will also handle dimensioning and allocation of the memory buffer required by the
@@ -117,6 +143,17 @@ uint32_t app_sched_init(uint16_t max_event_size, uint16_t queue_size, void * p_e
  */
 void app_sched_execute(void);
 
+/**@brief Function for executing a limited number of scheduled events.
+ *
+ * @details Same as app_sched_execute(), but returns after max_events events, even if there are
+ *          more in the queue. Events are taken from the highest priority lane first.
+ *
+ * @param[in]   max_events   Highest number of events to execute.
+ *
+ * @return      Number of events executed.
+ */
+uint32_t app_sched_execute_budget(uint32_t max_events);
+
 /**@brief Function for scheduling an event.
  *
  * @details Puts an event into the event queue.
@@ -131,6 +168,56 @@ uint32_t app_sched_event_put(void *                    p_event_data,
                              uint16_t                  event_size,
                              app_sched_event_handler_t handler);
 
+/**@brief Function for scheduling an event in the given priority lane.
+ *
+ * @details Same as app_sched_event_put(), but puts the event in the given lane instead of
+ *          APP_SCHED_LANE_DEFAULT.
+ *
+ * @param[in]   p_event_data   Pointer to event data to be scheduled.
+ * @param[in]   event_size     Size of event data to be scheduled.
+ * @param[in]   handler        Event handler to receive the event.
+ * @param[in]   lane           Priority lane, less than APP_SCHED_LANE_COUNT.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t app_sched_event_put_lane(void *                    p_event_data,
+                                  uint16_t                  event_size,
+                                  app_sched_event_handler_t handler,
+                                  uint8_t                   lane);
+
+/**@brief Function for reserving an entry in the event queue.
+ *
+ * @details The event data is written directly to p_reservation->p_event_data, and the event is
+ *          scheduled by app_sched_event_commit(). Events behind the reserved entry in the same
+ *          lane are held back until it's committed, so every reservation must be committed,
+ *          and should be committed before returning from the interrupt that made it.
+ *
+ * @param[in]   event_size      Size of the event data to be written.
+ * @param[in]   lane            Priority lane, less than APP_SCHED_LANE_COUNT.
+ * @param[out]  p_reservation   The reserved entry.
+ *
+ * @retval      NRF_SUCCESS                The entry was reserved.
+ * @retval      NRF_ERROR_NULL             p_reservation is NULL.
+ * @retval      NRF_ERROR_INVALID_PARAM    Invalid lane.
+ * @retval      NRF_ERROR_INVALID_LENGTH   event_size is larger than the scheduler's event size.
+ * @retval      NRF_ERROR_NO_MEM           The lane is full.
+ */
+uint32_t app_sched_event_reserve(uint16_t                  event_size,
+                                 uint8_t                   lane,
+                                 app_sched_reservation_t * p_reservation);
+
+/**@brief Function for scheduling an event reserved with app_sched_event_reserve().
+ *
+ * @param[in]   p_reservation   The reserved entry, with its event data written.
+ * @param[in]   handler         Event handler to receive the event.
+ *
+ * @retval      NRF_SUCCESS                The event was scheduled.
+ * @retval      NRF_ERROR_NULL             p_reservation or handler is NULL.
+ * @retval      NRF_ERROR_INVALID_PARAM    p_reservation doesn't hold a reserved entry.
+ */
+uint32_t app_sched_event_commit(app_sched_reservation_t const * p_reservation,
+                                app_sched_event_handler_t       handler);
+
 #ifdef APP_SCHEDULER_WITH_PAUSE
 /**@brief A function to pause the scheduler.
  *
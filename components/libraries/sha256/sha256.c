@@ -22,13 +22,50 @@
 #define ROTLEFT(a,b) (((a) << (b)) | ((a) >> (32-(b))))
 #define ROTRIGHT(a,b) (((a) >> (b)) | ((a) << (32-(b))))
 
-#define CH(x,y,z) (((x) & (y)) ^ (~(x) & (z)))
-#define MAJ(x,y,z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define CH(x,y,z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x,y,z) (((x) & (y)) | ((z) & ((x) | (y))))
 #define EP0(x) (ROTRIGHT(x,2) ^ ROTRIGHT(x,13) ^ ROTRIGHT(x,22))
 #define EP1(x) (ROTRIGHT(x,6) ^ ROTRIGHT(x,11) ^ ROTRIGHT(x,25))
 #define SIG0(x) (ROTRIGHT(x,7) ^ ROTRIGHT(x,18) ^ ((x) >> 3))
 #define SIG1(x) (ROTRIGHT(x,17) ^ ROTRIGHT(x,19) ^ ((x) >> 10))
 
+/* The message schedule is kept in a 16 word ring, word i + 16 replaces word i. */
+#define W(i) (m[(i) & 15])
+#define SCHEDULE(i) (W(i) += SIG1(W((i) - 2)) + W((i) - 7) + SIG0(W((i) - 15)))
+
+/* One round. Instead of shifting the working variables, the next round is given them in rotated
+ * order, so the compiler can keep all eight in registers without moves. */
+#define ROUND(a,b,c,d,e,f,g,h,i,w)                              \
+    do {                                                        \
+        uint32_t t1 = (h) + EP1(e) + CH(e,f,g) + k[i] + (w);    \
+        (d) += t1;                                              \
+        (h)  = t1 + EP0(a) + MAJ(a,b,c);                        \
+    } while (0)
+
+#define ROUNDS_8(i, WORD)                                       \
+    do {                                                        \
+        ROUND(a, b, c, d, e, f, g, h, (i) + 0, WORD((i) + 0));  \
+        ROUND(h, a, b, c, d, e, f, g, (i) + 1, WORD((i) + 1));  \
+        ROUND(g, h, a, b, c, d, e, f, (i) + 2, WORD((i) + 2));  \
+        ROUND(f, g, h, a, b, c, d, e, (i) + 3, WORD((i) + 3));  \
+        ROUND(e, f, g, h, a, b, c, d, (i) + 4, WORD((i) + 4));  \
+        ROUND(d, e, f, g, h, a, b, c, (i) + 5, WORD((i) + 5));  \
+        ROUND(c, d, e, f, g, h, a, b, (i) + 6, WORD((i) + 6));  \
+        ROUND(b, c, d, e, f, g, h, a, (i) + 7, WORD((i) + 7));  \
+    } while (0)
+
+/* ARMv7-M (nRF52) has more registers and single cycle rotates, and can afford the code size of
+ * a fully unrolled compression function. On Cortex-M0, eight rounds per loop iteration keep the
+ * bootloader small with most of the gain. */
+#ifndef SHA256_FULL_UNROLL
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || \
+    defined(__TARGET_ARCH_7_M) || defined(__TARGET_ARCH_7E_M)
+#define SHA256_FULL_UNROLL 1
+#else
+#define SHA256_FULL_UNROLL 0
+#endif
+#endif
+
 
 static const uint32_t k[64] = {
     0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
@@ -45,16 +82,15 @@ static const uint32_t k[64] = {
 /**@brief Function for calculating the hash of a 64-byte section of data.
  *
  * @param[in,out] ctx   Hash instance.
- * @param[in]     data  Aray with data to be hashed. Assumed to be 64 bytes long.
+ * @param[in]     data  Aray with data to be hashed. Assumed to be 64 bytes long, no alignment
+ *                      needed.
  */
-void sha256_transform(sha256_context_t *ctx, const uint8_t * data)
+static void sha256_transform(sha256_context_t *ctx, const uint8_t * data)
 {
-    uint32_t a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
+    uint32_t a, b, c, d, e, f, g, h, i, m[16];
 
-    for (i = 0, j = 0; i < 16; ++i, j += 4)
-        m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
-    for ( ; i < 64; ++i)
-        m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+    for (i = 0; i < 16; ++i, data += 4)
+        m[i] = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (data[3]);
 
     a = ctx->state[0];
     b = ctx->state[1];
@@ -65,18 +101,21 @@ void sha256_transform(sha256_context_t *ctx, const uint8_t * data)
     g = ctx->state[6];
     h = ctx->state[7];
 
-    for (i = 0; i < 64; ++i) {
-        t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
-        t2 = EP0(a) + MAJ(a,b,c);
-        h = g;
-        g = f;
-        f = e;
-        e = d + t1;
-        d = c;
-        c = b;
-        b = a;
-        a = t1 + t2;
-    }
+#if SHA256_FULL_UNROLL
+    ROUNDS_8(0,  W);
+    ROUNDS_8(8,  W);
+    ROUNDS_8(16, SCHEDULE);
+    ROUNDS_8(24, SCHEDULE);
+    ROUNDS_8(32, SCHEDULE);
+    ROUNDS_8(40, SCHEDULE);
+    ROUNDS_8(48, SCHEDULE);
+    ROUNDS_8(56, SCHEDULE);
+#else
+    for (i = 0; i < 16; i += 8)
+        ROUNDS_8(i, W);
+    for ( ; i < 64; i += 8)
+        ROUNDS_8(i, SCHEDULE);
+#endif
 
     ctx->state[0] += a;
     ctx->state[1] += b;
@@ -118,15 +157,49 @@ ret_code_t sha256_update(sha256_context_t *ctx, const uint8_t * data, size_t len
         return NRF_ERROR_NULL;
     }
 
-    uint32_t i;
+    // Top up a partial block first, then hash whole blocks straight from the input.
+    if (ctx->datalen > 0) {
+        size_t n = 64 - ctx->datalen;
+        if (n > len)
+            n = len;
+        memcpy(&ctx->data[ctx->datalen], data, n);
+        ctx->datalen += n;
+        data += n;
+        len -= n;
+        if (ctx->datalen < 64)
+            return NRF_SUCCESS;
+        sha256_transform(ctx, ctx->data);
+        ctx->bitlen += 512;
+        ctx->datalen = 0;
+    }
+
+    for ( ; len >= 64; len -= 64, data += 64) {
+        sha256_transform(ctx, data);
+        ctx->bitlen += 512;
+    }
+
+    if (len > 0) {
+        memcpy(ctx->data, data, len);
+        ctx->datalen = len;
+    }
+
+    return NRF_SUCCESS;
+}
+
 
-    for (i = 0; i < len; ++i) {
-        ctx->data[ctx->datalen] = data[i];
-        ctx->datalen++;
-        if (ctx->datalen == 64) {
-            sha256_transform(ctx, ctx->data);
-            ctx->bitlen += 512;
-            ctx->datalen = 0;
+ret_code_t sha256_update_buffers(sha256_context_t *ctx, const sha256_buffer_t * p_buffers, uint32_t count)
+{
+    if ((ctx == NULL) || ((count > 0) && (p_buffers == NULL)))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ret_code_t err_code = sha256_update(ctx, p_buffers[i].p_data, p_buffers[i].len);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
         }
     }
 
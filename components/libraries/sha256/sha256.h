@@ -35,6 +35,7 @@
 
 
 #include <stdint.h>
+#include <stddef.h>
 #include "sdk_errors.h"
 
 
@@ -48,6 +49,14 @@ typedef struct {
 } sha256_context_t;
 
 
+/**@brief A section of data to be hashed, for @ref sha256_update_buffers.
+ */
+typedef struct {
+    const uint8_t * p_data;     /**< Data to be hashed. */
+    size_t          len;        /**< Length of the data. */
+} sha256_buffer_t;
+
+
 /**@brief Function for initializing a @ref sha256_context_t instance.
  *
  * @param[out] ctx  Context instance to be initialized.
@@ -71,6 +80,21 @@ ret_code_t sha256_init(sha256_context_t *ctx);
  */
 ret_code_t sha256_update(sha256_context_t *ctx, const uint8_t * data, const size_t len);
 
+/**@brief Function for hashing several sections of data in one call.
+ *
+ * @details Equivalent to calling @ref sha256_update on each buffer in order, e.g. for hashing a
+ *          header made of separate fields followed by a payload.
+ *
+ * @param[in,out] ctx        Hash instance.
+ * @param[in]     p_buffers  Sections of data to be hashed, in order.
+ * @param[in]     count      Number of sections.
+ *
+ * @retval NRF_SUCCESS     If the data was successfully hashed.
+ * @retval NRF_ERROR_NULL  If the ctx parameter was NULL, p_buffers was NULL while count was not zero,
+ *                         or a section with data NULL had a length that was not zero.
+ */
+ret_code_t sha256_update_buffers(sha256_context_t *ctx, const sha256_buffer_t * p_buffers, uint32_t count);
+
 /**@brief Function for extracting the hash value from a hash instance.
  *
  * @details This function should be called after all data to be hashed has been passed to the hash
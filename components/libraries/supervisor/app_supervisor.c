@@ -0,0 +1,184 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "app_supervisor.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "nrf_assert.h"
+#include "nrf_error.h"
+#include "nordic_common.h"
+
+STATIC_ASSERT(APP_SUPERVISOR_MAX_SUBSYSTEMS <= 32);
+
+/**@brief Supervised subsystem control block. */
+typedef struct
+{
+    app_supervisor_check_t check;           /**< Function polled once per period, or NULL. */
+    uint8_t                timeout_periods; /**< Periods without progress before the subsystem is stalled. */
+    uint8_t                silent_periods;  /**< Consecutive periods without progress. */
+    volatile bool          checked_in;      /**< Progress reported since the last health check. */
+} subsystem_t;
+
+static subsystem_t            m_subsystems[APP_SUPERVISOR_MAX_SUBSYSTEMS]; /**< Registered subsystems. */
+static uint8_t                m_subsystem_count;                           /**< Number of registered subsystems. */
+static app_timer_id_t         m_timer_id;                                  /**< Timer of the health checks. */
+static uint32_t               m_period_ticks;                              /**< Period of the health checks. */
+static nrf_drv_wdt_channel_id m_channel_id;                                /**< Watchdog channel of the module. */
+static bool                   m_initialized;                               /**< The module is initialized. */
+static bool                   m_started;                                   /**< The watchdog is started. */
+static uint32_t               m_stalled;                                   /**< Subsystems stalled at the last health check. */
+
+
+/**@brief Health check, feeds the watchdog if no subsystem is stalled. */
+static void supervisor_timeout_handler(void * p_context)
+{
+    uint32_t stalled = 0;
+    uint8_t  i;
+
+    UNUSED_PARAMETER(p_context);
+
+    for (i = 0; i < m_subsystem_count; i++)
+    {
+        subsystem_t * p_subsystem = &m_subsystems[i];
+
+        // The flag is cleared before polling, so that a check in during the poll is kept.
+        bool progress = p_subsystem->checked_in;
+        p_subsystem->checked_in = false;
+
+        if ((p_subsystem->check != NULL) && p_subsystem->check())
+        {
+            progress = true;
+        }
+
+        if (progress)
+        {
+            p_subsystem->silent_periods = 0;
+        }
+        else if (p_subsystem->silent_periods < p_subsystem->timeout_periods)
+        {
+            p_subsystem->silent_periods++;
+        }
+
+        if (p_subsystem->silent_periods >= p_subsystem->timeout_periods)
+        {
+            stalled |= (1UL << i);
+        }
+    }
+
+    m_stalled = stalled;
+
+    if (stalled == 0)
+    {
+        nrf_drv_wdt_channel_feed(m_channel_id);
+    }
+}
+
+
+uint32_t app_supervisor_init(nrf_drv_wdt_config_t const * p_wdt_config,
+                             nrf_wdt_event_handler_t      wdt_event_handler,
+                             uint32_t                     period_ticks)
+{
+    uint32_t err_code;
+
+    err_code = nrf_drv_wdt_init(p_wdt_config, wdt_event_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = nrf_drv_wdt_channel_alloc(&m_channel_id);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = app_timer_create(&m_timer_id, APP_TIMER_MODE_REPEATED, supervisor_timeout_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_period_ticks    = period_ticks;
+    m_subsystem_count = 0;
+    m_stalled         = 0;
+    m_started         = false;
+    m_initialized     = true;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_supervisor_register(app_supervisor_id_t *  p_id,
+                                 uint8_t                timeout_periods,
+                                 app_supervisor_check_t check)
+{
+    subsystem_t * p_subsystem;
+
+    if (timeout_periods == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (m_subsystem_count >= APP_SUPERVISOR_MAX_SUBSYSTEMS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_subsystem                  = &m_subsystems[m_subsystem_count];
+    p_subsystem->check           = check;
+    p_subsystem->timeout_periods = timeout_periods;
+    p_subsystem->silent_periods  = 0;
+    p_subsystem->checked_in      = false;
+
+    *p_id = m_subsystem_count++;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_supervisor_start(void)
+{
+    uint32_t err_code;
+
+    if (!m_initialized || m_started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    err_code = app_timer_start(m_timer_id, m_period_ticks, NULL);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    nrf_drv_wdt_enable();
+    m_started = true;
+
+    return NRF_SUCCESS;
+}
+
+
+void app_supervisor_checkin(app_supervisor_id_t id)
+{
+    ASSERT(id < m_subsystem_count);
+
+    m_subsystems[id].checked_in = true;
+}
+
+
+uint32_t app_supervisor_stalled_get(void)
+{
+    return m_stalled;
+}
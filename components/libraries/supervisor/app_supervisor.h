@@ -0,0 +1,120 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup app_supervisor Watchdog supervisor
+ * @{
+ * @ingroup app_common
+ *
+ * @brief Module for feeding the watchdog only while all subsystems of the application are healthy.
+ *
+ * @details Feeding the watchdog from the main loop only proves that the main loop runs. This
+ *          module instead lets each subsystem of the application, for example an event loop, a
+ *          radio protocol or a sensor pipeline, prove that it makes progress. A single repeated
+ *          app_timer checks all subsystems once per period, and feeds the watchdog only if none of
+ *          them has been silent for longer than its timeout. A stalled subsystem thus resets the
+ *          chip, even when the rest of the application keeps running.
+ *
+ *          A subsystem proves progress either by calling @ref app_supervisor_checkin, or through a
+ *          check function called by the module once per period, for subsystems that already keep
+ *          a counter of their activity.
+ *
+ *          The module uses 1 app_timer and 1 watchdog channel, and the watchdog is not fed
+ *          anywhere else. The period must be shorter than the watchdog reload value.
+ */
+
+#ifndef APP_SUPERVISOR_H__
+#define APP_SUPERVISOR_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "nrf_drv_wdt.h"
+
+#ifndef APP_SUPERVISOR_MAX_SUBSYSTEMS
+#define APP_SUPERVISOR_MAX_SUBSYSTEMS 4 /**< Maximum number of supervised subsystems. */
+#endif
+
+/**@brief Supervised subsystem identifier. */
+typedef uint8_t app_supervisor_id_t;
+
+/**@brief Subsystem check function type.
+ *
+ * @details Called from the app_timer interrupt once per period.
+ *
+ * @retval true   The subsystem has made progress since the last call.
+ * @retval false  The subsystem has not made progress.
+ */
+typedef bool (*app_supervisor_check_t)(void);
+
+/**@brief Function for initializing the module.
+ *
+ * @details The watchdog is initialized with one channel, owned by the module. The watchdog is
+ *          started by @ref app_supervisor_start, once all subsystems are registered. Must be called
+ *          after APP_TIMER_INIT.
+ *
+ * @param[in]  p_wdt_config       Watchdog configuration. Default configuration used if NULL.
+ * @param[in]  wdt_event_handler  Handler called just before a watchdog reset. The reset occurs two
+ *                                32.768 kHz cycles after the event, so it must return at once.
+ * @param[in]  period_ticks       Period of the health checks, in app_timer ticks.
+ *
+ * @retval NRF_SUCCESS              Module initialized.
+ * @return Errors propagated from nrf_drv_wdt_init, nrf_drv_wdt_channel_alloc and app_timer_create.
+ */
+uint32_t app_supervisor_init(nrf_drv_wdt_config_t const * p_wdt_config,
+                             nrf_wdt_event_handler_t      wdt_event_handler,
+                             uint32_t                     period_ticks);
+
+/**@brief Function for registering a subsystem.
+ *
+ * @param[out] p_id             Identifier of the subsystem, for @ref app_supervisor_checkin.
+ * @param[in]  timeout_periods  Number of consecutive periods without progress after which the
+ *                              subsystem is considered stalled, at least 1.
+ * @param[in]  check            Function polled once per period, NULL if the subsystem calls
+ *                              @ref app_supervisor_checkin instead.
+ *
+ * @retval NRF_SUCCESS              Subsystem registered.
+ * @retval NRF_ERROR_INVALID_PARAM  The timeout is 0.
+ * @retval NRF_ERROR_INVALID_STATE  The module is already started.
+ * @retval NRF_ERROR_NO_MEM         APP_SUPERVISOR_MAX_SUBSYSTEMS subsystems are already registered.
+ */
+uint32_t app_supervisor_register(app_supervisor_id_t *  p_id,
+                                 uint8_t                timeout_periods,
+                                 app_supervisor_check_t check);
+
+/**@brief Function for starting the watchdog and the health checks.
+ *
+ * @retval NRF_SUCCESS              Watchdog started.
+ * @retval NRF_ERROR_INVALID_STATE  The module is not initialized, or already started.
+ * @return Errors propagated from app_timer_start.
+ */
+uint32_t app_supervisor_start(void);
+
+/**@brief Function for reporting that a subsystem has made progress.
+ *
+ * @details Cheap enough to be called on every iteration of a loop, at any interrupt priority.
+ *
+ * @param[in]  id  Identifier of the subsystem.
+ */
+void app_supervisor_checkin(app_supervisor_id_t id);
+
+/**@brief Function for getting the subsystems considered stalled at the last health check.
+ *
+ * @details Useful in the watchdog event handler, to record which subsystem caused the reset.
+ *
+ * @return Bit mask of the identifiers of the stalled subsystems.
+ */
+uint32_t app_supervisor_stalled_get(void);
+
+#endif // APP_SUPERVISOR_H__
+
+/** @} */
@@ -49,12 +49,18 @@ typedef enum
 typedef struct
 {
     timer_alloc_state_t         state;                                      /**< Timer allocation state. */
-    app_timer_mode_t            mode;                                       /**< Timer mode. */
-    uint32_t                    ticks_to_expire;                            /**< Number of ticks from previous timer interrupt to timer expiry. */
+    uint8_t                     mode;                                       /**< Timer mode (@ref app_timer_mode_t). */
+    uint16_t                    ticks_slack;                                /**< Number of ticks the expiry may be delayed to share a wakeup with other timers. */
+    uint32_t                    ticks_to_expire;                            /**< Number of ticks from previous timer interrupt to timer expiry. With APP_TIMER_WITH_PAIRING_HEAP, the expiry time of a running timer on the m_ticks_epoch timeline. */
     uint32_t                    ticks_at_start;                             /**< Current RTC counter value when the timer was started. */
     uint32_t                    ticks_first_interval;                       /**< Number of ticks in the first timer interval. */
     uint32_t                    ticks_periodic_interval;                    /**< Timer period (for repeating timers). */
     bool                        is_running;                                 /**< True if timer is running, False otherwise. */
+#ifdef APP_TIMER_WITH_PAIRING_HEAP
+    uint8_t                     child;                                      /**< Id of first child in the heap of running timers. Fits in the padding after is_running. */
+    uint8_t                     sibling;                                    /**< Id of next sibling in the heap of running timers. */
+    uint8_t                     prev;                                       /**< Id of previous sibling, or of parent if this is the first child. */
+#endif
     app_timer_timeout_handler_t p_timeout_handler;                          /**< Pointer to function to be executed when the timer expires. */
     void *                      p_context;                                  /**< General purpose pointer. Will be passed to the timeout handler when the timer expires. */
     app_timer_id_t              next;                                       /**< Id of next timer in list of running timers. */
@@ -79,6 +85,7 @@ typedef struct
     uint32_t ticks_first_interval;                                          /**< Number of ticks in the first timer interval. */
     uint32_t ticks_periodic_interval;                                       /**< Timer period (for repeating timers). */
     void *   p_context;                                                     /**< General purpose pointer. Will be passed to the timeout handler when the timer expires. */
+    uint16_t ticks_slack;                                                   /**< Number of ticks each expiry may be delayed. */
 } timer_user_op_start_t;
 
 /**@brief Structure describing a timer operation. */
@@ -125,6 +132,7 @@ typedef uint32_t timer_user_id_t;
 
 #define TIMER_NULL                  ((app_timer_id_t)(0 - 1))                   /**< Invalid timer id. */
 #define CONTEXT_QUEUE_SIZE_MAX      (2)                                         /**< Timer internal elapsed ticks queue size. */
+#define HEAP_NULL                   (0xFF)                                      /**< Invalid timer id in the heap links. max_timers is an uint8_t, so no timer can have this id. */
 
 static uint8_t                       m_node_array_size;                         /**< Size of timer node array. */
 static timer_node_t *                mp_nodes = NULL;                           /**< Array of timer nodes. */
@@ -132,6 +140,10 @@ static uint8_t                       m_user_array_size;
 static timer_user_t *                mp_users;                                  /**< Array of timer users. */
 static app_timer_id_t                m_timer_id_head;                           /**< First timer in list of running timers. */
 static uint32_t                      m_ticks_latest;                            /**< Last known RTC counter value. */
+#ifdef APP_TIMER_WITH_PAIRING_HEAP
+static uint32_t                      m_ticks_epoch;                             /**< Sum of all elapsed ticks consumed, never reset. Running timers expire at a fixed point on this timeline, so the heap needs no update when time passes. */
+#endif
+static uint32_t                      m_op_queue_overflows[APP_TIMER_INT_LEVELS];/**< Number of timer operations rejected because the queue was full, per user. Only written from the interrupt level of the user, so no locking is needed. */
 static uint32_t                      m_ticks_elapsed[CONTEXT_QUEUE_SIZE_MAX];   /**< Timer internal elapsed ticks queue. */
 static uint8_t                       m_ticks_elapsed_q_read_ind;                /**< Timer internal elapsed ticks queue read index. */
 static uint8_t                       m_ticks_elapsed_q_write_ind;               /**< Timer internal elapsed ticks queue write index. */
@@ -219,6 +231,52 @@ static __INLINE void rtc1_compare0_set(uint32_t value)
 }
 
 
+#ifndef APP_TIMER_WITH_PAIRING_HEAP
+
+/**@brief Function for getting the number of ticks from m_ticks_latest to the expiry of a timer.
+ *
+ * @param[in]  timer_id   Id of timer at the head of the list.
+ */
+static __INLINE uint32_t timer_ticks_to_expire_get(app_timer_id_t timer_id)
+{
+    return mp_nodes[timer_id].ticks_to_expire;
+}
+
+
+/**@brief Function for getting the number of ticks from m_ticks_latest to the next wakeup.
+ *
+ * @details Timers expiring before the wakeup may run up to their slack late, so that they can
+ *          share the wakeup with the timers after them. The walk stops at the first timer expiring
+ *          after the wakeup, since no later timer can move it earlier.
+ *
+ * @return     Ticks to the latest wakeup that is within the slack of all timers expiring before it.
+ */
+static uint32_t timer_wakeup_ticks_get(void)
+{
+    app_timer_id_t timer_id        = m_timer_id_head;
+    uint32_t       ticks_to_expire = 0;
+    uint32_t       ticks_wakeup    = UINT32_MAX;
+
+    while (timer_id != TIMER_NULL)
+    {
+        timer_node_t * p_timer = &mp_nodes[timer_id];
+
+        ticks_to_expire += p_timer->ticks_to_expire;
+        if (ticks_to_expire > ticks_wakeup)
+        {
+            break;
+        }
+        if (ticks_to_expire + p_timer->ticks_slack < ticks_wakeup)
+        {
+            ticks_wakeup = ticks_to_expire + p_timer->ticks_slack;
+        }
+        timer_id = p_timer->next;
+    }
+
+    return ticks_wakeup;
+}
+
+
 /**@brief Function for inserting a timer in the timer list.
  *
  * @param[in]  timer_id   Id of timer to insert.
@@ -329,6 +387,280 @@ static void timer_list_remove(app_timer_id_t timer_id)
 }
 
 
+#else /* APP_TIMER_WITH_PAIRING_HEAP */
+
+/* The running timers are kept in a pairing heap, ordered by expiry time, with m_timer_id_head as
+ * the root. The heap is stored in the timer nodes as a tree of first child and sibling links, so
+ * insertion is O(1) and removal is O(log n) amortized, where the sorted list is O(n) for both.
+ * All heap operations are done from the RTC1 and SWI0 interrupts, like the list operations. */
+
+/**@brief Function for getting the number of ticks from m_ticks_latest to the expiry of a timer.
+ *
+ * @param[in]  timer_id   Id of running timer.
+ */
+static __INLINE uint32_t timer_ticks_to_expire_get(app_timer_id_t timer_id)
+{
+    return (mp_nodes[timer_id].ticks_to_expire - m_ticks_epoch);
+}
+
+
+/**@brief Function for merging two heaps.
+ *
+ * @param[in]  a   Root of the first heap.
+ * @param[in]  b   Root of the second heap.
+ *
+ * @return     Root of the merged heap.
+ */
+static uint8_t heap_meld(uint8_t a, uint8_t b)
+{
+    if ((int32_t)(mp_nodes[b].ticks_to_expire - mp_nodes[a].ticks_to_expire) < 0)
+    {
+        uint8_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    // Make b the first child of a.
+    mp_nodes[b].prev    = a;
+    mp_nodes[b].sibling = mp_nodes[a].child;
+    if (mp_nodes[a].child != HEAP_NULL)
+    {
+        mp_nodes[mp_nodes[a].child].prev = b;
+    }
+    mp_nodes[a].child = b;
+
+    return a;
+}
+
+
+/**@brief Function for merging a list of siblings into one heap, two by two.
+ *
+ * @param[in]  first   First sibling in list, or HEAP_NULL.
+ *
+ * @return     Root of the merged heap, or HEAP_NULL if the list was empty.
+ */
+static uint8_t heap_merge_pairs(uint8_t first)
+{
+    uint8_t pairs = HEAP_NULL;
+    uint8_t root  = HEAP_NULL;
+
+    // Merge the siblings pairwise from left to right, stacking the merged pairs.
+    while (first != HEAP_NULL)
+    {
+        uint8_t a = first;
+        uint8_t b = mp_nodes[a].sibling;
+
+        first = (b != HEAP_NULL) ? mp_nodes[b].sibling : HEAP_NULL;
+
+        mp_nodes[a].sibling = HEAP_NULL;
+        mp_nodes[a].prev    = HEAP_NULL;
+        if (b != HEAP_NULL)
+        {
+            mp_nodes[b].sibling = HEAP_NULL;
+            mp_nodes[b].prev    = HEAP_NULL;
+            a = heap_meld(a, b);
+        }
+
+        mp_nodes[a].sibling = pairs;
+        pairs               = a;
+    }
+
+    // Merge the pairs from right to left.
+    while (pairs != HEAP_NULL)
+    {
+        uint8_t a = pairs;
+
+        pairs               = mp_nodes[a].sibling;
+        mp_nodes[a].sibling = HEAP_NULL;
+        root                = (root == HEAP_NULL) ? a : heap_meld(root, a);
+    }
+
+    return root;
+}
+
+
+/**@brief Function for inserting a timer in the timer heap.
+ *
+ * @param[in]  timer_id   Id of timer to insert, with ticks_to_expire relative to m_ticks_latest.
+ */
+static void timer_list_insert(app_timer_id_t timer_id)
+{
+    timer_node_t * p_timer = &mp_nodes[timer_id];
+
+    p_timer->ticks_to_expire += m_ticks_epoch;
+    p_timer->child            = HEAP_NULL;
+    p_timer->sibling          = HEAP_NULL;
+    p_timer->prev             = HEAP_NULL;
+
+    if (m_timer_id_head == TIMER_NULL)
+    {
+        m_timer_id_head = timer_id;
+    }
+    else
+    {
+        m_timer_id_head = heap_meld((uint8_t)m_timer_id_head, (uint8_t)timer_id);
+    }
+}
+
+
+/**@brief Function for removing a timer from the timer heap.
+ *
+ * @param[in]  timer_id   Id of running timer to remove.
+ */
+static void timer_list_remove(app_timer_id_t timer_id)
+{
+    timer_node_t * p_timer = &mp_nodes[timer_id];
+    uint8_t        subheap = heap_merge_pairs(p_timer->child);
+
+    if (timer_id == m_timer_id_head)
+    {
+        m_timer_id_head = (subheap != HEAP_NULL) ? subheap : TIMER_NULL;
+
+        // No more timers in the heap. Reset RTC1 in case Start timer operations are present in the queue.
+        if (m_timer_id_head == TIMER_NULL)
+        {
+            NRF_RTC1->TASKS_CLEAR = 1;
+            m_ticks_latest        = 0;
+            m_rtc1_reset          = true;
+        }
+    }
+    else
+    {
+        // Unlink the timer from its parent or previous sibling.
+        if (mp_nodes[p_timer->prev].child == timer_id)
+        {
+            mp_nodes[p_timer->prev].child = p_timer->sibling;
+        }
+        else
+        {
+            mp_nodes[p_timer->prev].sibling = p_timer->sibling;
+        }
+        if (p_timer->sibling != HEAP_NULL)
+        {
+            mp_nodes[p_timer->sibling].prev = p_timer->prev;
+        }
+
+        if (subheap != HEAP_NULL)
+        {
+            m_timer_id_head = heap_meld((uint8_t)m_timer_id_head, subheap);
+        }
+    }
+
+    p_timer->child   = HEAP_NULL;
+    p_timer->sibling = HEAP_NULL;
+    p_timer->prev    = HEAP_NULL;
+}
+
+
+/**@brief Function for finding the parent of a timer in the heap.
+ *
+ * @param[in]  timer_id   Id of a running timer that is not the root.
+ */
+static uint8_t heap_parent_get(uint8_t timer_id)
+{
+    while (mp_nodes[mp_nodes[timer_id].prev].child != timer_id)
+    {
+        timer_id = mp_nodes[timer_id].prev;
+    }
+    return mp_nodes[timer_id].prev;
+}
+
+
+/**@brief Function for walking the heap of running timers in pre-order.
+ *
+ * @param[in]  timer_id   Id of the last visited timer.
+ * @param[in]  descend    True to visit the children of the last visited timer next, false to skip
+ *                        them.
+ *
+ * @return     Id of the next timer to visit, or HEAP_NULL when the walk is done.
+ */
+static uint8_t heap_walk_next(uint8_t timer_id, bool descend)
+{
+    uint8_t root = (uint8_t)m_timer_id_head;
+
+    if (descend && (mp_nodes[timer_id].child != HEAP_NULL))
+    {
+        return mp_nodes[timer_id].child;
+    }
+
+    // Move on to the next sibling of this timer or of the closest ancestor that has one.
+    while ((timer_id != root) && (mp_nodes[timer_id].sibling == HEAP_NULL))
+    {
+        timer_id = heap_parent_get(timer_id);
+    }
+    return (timer_id == root) ? HEAP_NULL : mp_nodes[timer_id].sibling;
+}
+
+
+/**@brief Function for getting the number of ticks from m_ticks_latest to the next wakeup.
+ *
+ * @details Timers expiring before the wakeup may run up to their slack late, so that they can
+ *          share the wakeup with the timers after them. Since a timer never expires before its
+ *          parent, the children of timers expiring after the wakeup are never visited.
+ *
+ * @return     Ticks to the latest wakeup that is within the slack of all timers expiring before it.
+ */
+static uint32_t timer_wakeup_ticks_get(void)
+{
+    uint32_t ticks_wakeup = UINT32_MAX;
+    uint8_t  timer_id     = (uint8_t)m_timer_id_head;
+
+    while (timer_id != HEAP_NULL)
+    {
+        uint32_t ticks_to_expire = timer_ticks_to_expire_get(timer_id);
+        bool     due             = (ticks_to_expire <= ticks_wakeup);
+
+        if (due && (ticks_to_expire + mp_nodes[timer_id].ticks_slack < ticks_wakeup))
+        {
+            ticks_wakeup = ticks_to_expire + mp_nodes[timer_id].ticks_slack;
+        }
+        timer_id = heap_walk_next(timer_id, due);
+    }
+
+    return ticks_wakeup;
+}
+
+
+/**@brief Function for collecting the expired timers in the heap.
+ *
+ * @details Walks the part of the heap that has expired. Since a timer never expires before its
+ *          parent, the children of running timers are never visited. The expired timers are linked
+ *          through their next field in expiry order.
+ *
+ * @param[in]  ticks_elapsed   Number of ticks elapsed since m_ticks_latest.
+ *
+ * @return     First timer in the list of expired timers, or TIMER_NULL if none expired.
+ */
+static app_timer_id_t heap_expired_collect(uint32_t ticks_elapsed)
+{
+    app_timer_id_t expired_head = TIMER_NULL;
+    uint8_t        timer_id     = (uint8_t)m_timer_id_head;
+
+    while (timer_id != HEAP_NULL)
+    {
+        uint32_t ticks_to_expire = timer_ticks_to_expire_get(timer_id);
+        bool     expired         = (ticks_elapsed >= ticks_to_expire);
+
+        if (expired)
+        {
+            app_timer_id_t * p_link = &expired_head;
+
+            while ((*p_link != TIMER_NULL) && (timer_ticks_to_expire_get(*p_link) <= ticks_to_expire))
+            {
+                p_link = &mp_nodes[*p_link].next;
+            }
+            mp_nodes[timer_id].next = *p_link;
+            *p_link                 = timer_id;
+        }
+        timer_id = heap_walk_next(timer_id, expired);
+    }
+
+    return expired_head;
+}
+
+#endif /* APP_TIMER_WITH_PAIRING_HEAP */
+
+
 /**@brief Function for scheduling a check for timeouts by generating a RTC1 interrupt.
  */
 static void timer_timeouts_check_sched(void)
@@ -381,6 +713,7 @@ static void timer_timeouts_check(void)
         // ticks_elapsed is collected here, job will use it.
         ticks_elapsed = ticks_diff_get(rtc1_counter_get(), m_ticks_latest);
 
+#ifndef APP_TIMER_WITH_PAIRING_HEAP
         // Auto variable containing the head of timers expiring.
         timer_id = m_timer_id_head;
 
@@ -408,6 +741,20 @@ static void timer_timeouts_check(void)
             // Execute Task.
             timeout_handler_exec(p_timer);
         }
+#else
+        // Expire all timers within ticks_elapsed, in expiry order, and collect ticks_expired.
+        timer_id = heap_expired_collect(ticks_elapsed);
+
+        while (timer_id != TIMER_NULL)
+        {
+            timer_node_t * p_timer = &mp_nodes[timer_id];
+
+            ticks_expired = timer_ticks_to_expire_get(timer_id);
+            timer_id      = p_timer->next;
+
+            timeout_handler_exec(p_timer);
+        }
+#endif
 
         // Prepare to queue the ticks expired in the m_ticks_elapsed queue.
         if (m_ticks_elapsed_q_read_ind == m_ticks_elapsed_q_write_ind)
@@ -455,6 +802,9 @@ static bool elapsed_ticks_acquire(uint32_t * p_ticks_elapsed)
 
         m_ticks_latest += *p_ticks_elapsed;
         m_ticks_latest &= MAX_RTC_COUNTER_VAL;
+#ifdef APP_TIMER_WITH_PAIRING_HEAP
+        m_ticks_epoch  += *p_ticks_elapsed;
+#endif
 
         return true;
     }
@@ -511,6 +861,7 @@ static bool list_deletions_handler(void)
                     
                 case TIMER_USER_OP_TYPE_STOP_ALL:
                     // Delete list of running timers, and mark all timers as not running.
+#ifndef APP_TIMER_WITH_PAIRING_HEAP
                     while (m_timer_id_head != TIMER_NULL)
                     {
                         timer_node_t * p_head = &mp_nodes[m_timer_id_head];
@@ -518,6 +869,17 @@ static bool list_deletions_handler(void)
                         p_head->is_running = false;
                         m_timer_id_head    = p_head->next;
                     }
+#else
+                    {
+                        uint8_t i;
+
+                        for (i = 0; i < m_node_array_size; i++)
+                        {
+                            mp_nodes[i].is_running = false;
+                        }
+                        m_timer_id_head = TIMER_NULL;
+                    }
+#endif
                     break;
                     
                 default:
@@ -542,6 +904,7 @@ static void expired_timers_handler(uint32_t         ticks_elapsed,
                                    uint32_t         ticks_previous,
                                    app_timer_id_t * p_restart_list_head)
 {
+#ifndef APP_TIMER_WITH_PAIRING_HEAP
     uint32_t ticks_expired = 0;
 
     while (m_timer_id_head != TIMER_NULL)
@@ -580,6 +943,43 @@ static void expired_timers_handler(uint32_t         ticks_elapsed,
             *p_restart_list_head          = id_expired;
         }
     }
+#else
+    // m_ticks_epoch has already been advanced by ticks_elapsed, so every timer at or before it has
+    // expired.
+    uint32_t ticks_epoch_previous = m_ticks_epoch - ticks_elapsed;
+
+    while (m_timer_id_head != TIMER_NULL)
+    {
+        app_timer_id_t id_expired = m_timer_id_head;
+        timer_node_t * p_timer    = &mp_nodes[id_expired];
+        uint32_t       ticks_expired;
+
+        if ((int32_t)(p_timer->ticks_to_expire - m_ticks_epoch) > 0)
+        {
+            break;
+        }
+
+        ticks_expired = p_timer->ticks_to_expire - ticks_epoch_previous;
+
+        // Remove the expired timer from the root.
+        m_timer_id_head = heap_merge_pairs(p_timer->child);
+        if (m_timer_id_head == HEAP_NULL)
+        {
+            m_timer_id_head = TIMER_NULL;
+        }
+        p_timer->child      = HEAP_NULL;
+        p_timer->is_running = false;
+
+        // Timer will be restarted if periodic.
+        if (p_timer->ticks_periodic_interval != 0)
+        {
+            p_timer->ticks_at_start       = (ticks_previous + ticks_expired) & MAX_RTC_COUNTER_VAL;
+            p_timer->ticks_first_interval = p_timer->ticks_periodic_interval;
+            p_timer->next                 = *p_restart_list_head;
+            *p_restart_list_head          = id_expired;
+        }
+    }
+#endif
 }
 
 
@@ -636,6 +1036,7 @@ static bool list_insertions_handler(app_timer_id_t restart_list_head)
                 p_timer->ticks_first_interval    = p_user_op->params.start.ticks_first_interval;
                 p_timer->ticks_periodic_interval = p_user_op->params.start.ticks_periodic_interval;
                 p_timer->p_context               = p_user_op->params.start.p_context;
+                p_timer->ticks_slack             = p_user_op->params.start.ticks_slack;
 
                 if (m_rtc1_reset)
                 {
@@ -689,7 +1090,7 @@ static void compare_reg_update(app_timer_id_t timer_id_head_old)
     // Setup the timeout for timers on the head of the list 
     if (m_timer_id_head != TIMER_NULL)
     {
-        uint32_t ticks_to_expire = mp_nodes[m_timer_id_head].ticks_to_expire;
+        uint32_t ticks_to_expire = timer_wakeup_ticks_get();
         uint32_t pre_counter_val = rtc1_counter_get();
         uint32_t cc              = m_ticks_latest;
         uint32_t ticks_elapsed   = ticks_diff_get(pre_counter_val, cc) + RTC_COMPARE_OFFSET_MIN;
@@ -820,6 +1221,7 @@ static timer_user_op_t * user_op_alloc(timer_user_t * p_user, app_timer_id_t * p
  * @param[in]  timer_id          Id of timer to start.
  * @param[in]  timeout_initial   Time (in ticks) to first timer expiry.
  * @param[in]  timeout_periodic  Time (in ticks) between periodic expiries.
+ * @param[in]  slack             Time (in ticks) each expiry may be delayed.
  * @param[in]  p_context         General purpose pointer. Will be passed to the timeout handler when
  *                               the timer expires.
  * @return     NRF_SUCCESS on success, otherwise an error code.
@@ -828,6 +1230,7 @@ static uint32_t timer_start_op_schedule(timer_user_id_t user_id,
                                         app_timer_id_t  timer_id,
                                         uint32_t        timeout_initial,
                                         uint32_t        timeout_periodic,
+                                        uint16_t        slack,
                                         void *          p_context)
 {
     app_timer_id_t last_index;
@@ -835,6 +1238,7 @@ static uint32_t timer_start_op_schedule(timer_user_id_t user_id,
     timer_user_op_t * p_user_op = user_op_alloc(&mp_users[user_id], &last_index);
     if (p_user_op == NULL)
     {
+        m_op_queue_overflows[user_id]++;
         return NRF_ERROR_NO_MEM;
     }
     
@@ -844,6 +1248,7 @@ static uint32_t timer_start_op_schedule(timer_user_id_t user_id,
     p_user_op->params.start.ticks_first_interval    = timeout_initial;
     p_user_op->params.start.ticks_periodic_interval = timeout_periodic;
     p_user_op->params.start.p_context               = p_context;
+    p_user_op->params.start.ticks_slack             = slack;
     
     user_op_enque(&mp_users[user_id], last_index);    
 
@@ -868,6 +1273,7 @@ static uint32_t timer_stop_op_schedule(timer_user_id_t user_id, app_timer_id_t t
     timer_user_op_t * p_user_op = user_op_alloc(&mp_users[user_id], &last_index);
     if (p_user_op == NULL)
     {
+        m_op_queue_overflows[user_id]++;
         return NRF_ERROR_NO_MEM;
     }
     
@@ -893,6 +1299,7 @@ static uint32_t timer_stop_all_op_schedule(timer_user_id_t user_id)
     timer_user_op_t * p_user_op = user_op_alloc(&mp_users[user_id], &last_index);
     if (p_user_op == NULL)
     {
+        m_op_queue_overflows[user_id]++;
         return NRF_ERROR_NO_MEM;
     }
     
@@ -998,6 +1405,11 @@ uint32_t app_timer_init(uint32_t                      prescaler,
     m_ticks_elapsed_q_read_ind  = 0;
     m_ticks_elapsed_q_write_ind = 0;
 
+    for (i = 0; i < APP_TIMER_INT_LEVELS; i++)
+    {
+        m_op_queue_overflows[i] = 0;
+    }
+
     NVIC_ClearPendingIRQ(SWI0_IRQn);
     NVIC_SetPriority(SWI0_IRQn, SWI0_IRQ_PRI);
     NVIC_EnableIRQ(SWI0_IRQn);
@@ -1037,6 +1449,7 @@ uint32_t app_timer_create(app_timer_id_t *            p_timer_id,
         {
             mp_nodes[i].state             = STATE_ALLOCATED;
             mp_nodes[i].mode              = mode;
+            mp_nodes[i].ticks_slack       = 0;
             mp_nodes[i].p_timeout_handler = timeout_handler;
             
             *p_timer_id = i;
@@ -1078,6 +1491,15 @@ static timer_user_id_t user_id_get(void)
 
 
 uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    return app_timer_start_with_slack(timer_id, timeout_ticks, 0, p_context);
+}
+
+
+uint32_t app_timer_start_with_slack(app_timer_id_t timer_id,
+                                    uint32_t       timeout_ticks,
+                                    uint32_t       slack_ticks,
+                                    void *         p_context)
 {
     uint32_t timeout_periodic;
     
@@ -1090,6 +1512,10 @@ uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *
     {
         return NRF_ERROR_INVALID_PARAM;
     }
+    if (slack_ticks > APP_TIMER_MAX_SLACK_TICKS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
     if (mp_nodes[timer_id].state != STATE_ALLOCATED)
     {
         return NRF_ERROR_INVALID_STATE;
@@ -1102,6 +1528,7 @@ uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *
                                    timer_id,
                                    timeout_ticks,
                                    timeout_periodic,
+                                   (uint16_t)slack_ticks,
                                    p_context);
 }
 
@@ -1154,3 +1581,23 @@ uint32_t app_timer_cnt_diff_compute(uint32_t   ticks_to,
     return NRF_SUCCESS;
 }
 
+
+uint32_t app_timer_op_queue_overflows_get(uint32_t * p_count)
+{
+    uint32_t count = 0;
+    int      i;
+
+    if (p_count == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    for (i = 0; i < APP_TIMER_INT_LEVELS; i++)
+    {
+        count += m_op_queue_overflows[i];
+    }
+
+    *p_count = count;
+    return NRF_SUCCESS;
+}
+
@@ -36,6 +36,13 @@
  *
  * @note    Even if the scheduler is not used, app_timer.h will include app_scheduler.h, so when
  *          compiling, app_scheduler.h must be available in one of the compiler include paths.
+ *
+ * @details The running timers are kept in a list sorted by expiry time, which makes starting and
+ *          stopping a timer O(n) in the number of running timers. Define
+ *          APP_TIMER_WITH_PAIRING_HEAP when building the module to keep them in a pairing heap
+ *          instead, for applications with many timers that are started and stopped often. The
+ *          heap uses the same buffer size. Within one timer interrupt, the timeout handlers are
+ *          called in expiry order with both implementations.
  */
 
 #ifndef APP_TIMER_H__
@@ -50,9 +57,10 @@
 
 #define APP_TIMER_CLOCK_FREQ         32768                      /**< Clock frequency of the RTC timer used to implement the app timer module. */
 #define APP_TIMER_MIN_TIMEOUT_TICKS  5                          /**< Minimum value of the timeout_ticks parameter of app_timer_start(). */
+#define APP_TIMER_MAX_SLACK_TICKS    0xFFFF                     /**< Maximum value of the slack_ticks parameter of app_timer_start_with_slack(). */
 
 #define APP_TIMER_NODE_SIZE          40                         /**< Size of app_timer.timer_node_t (only for use inside APP_TIMER_BUF_SIZE()). */
-#define APP_TIMER_USER_OP_SIZE       24                         /**< Size of app_timer.timer_user_op_t (only for use inside APP_TIMER_BUF_SIZE()). */
+#define APP_TIMER_USER_OP_SIZE       28                         /**< Size of app_timer.timer_user_op_t (only for use inside APP_TIMER_BUF_SIZE()). */
 #define APP_TIMER_USER_SIZE          8                          /**< Size of app_timer.timer_user_t (only for use inside APP_TIMER_BUF_SIZE()). */
 #define APP_TIMER_INT_LEVELS         3                          /**< Number of interrupt levels from where timer operations may be initiated (only for use inside APP_TIMER_BUF_SIZE()). */
 
@@ -222,6 +230,34 @@ uint32_t app_timer_create(app_timer_id_t *            p_timer_id,
  */
 uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context);
 
+/**@brief Function for starting a timer that may expire late to save wakeups.
+ *
+ * @details Works like app_timer_start(), but lets each expiry of the timer be delayed by up to
+ *          slack_ticks. The module sets the RTC compare to the latest point that is within the
+ *          slack of every timer expiring before it, so timers with nearby expiries are handled in
+ *          one RTC1 interrupt instead of waking the CPU once each. A timer is never run early.
+ *          app_timer_start() is the same as a slack of 0.
+ *
+ * @param[in]  timer_id        Id of timer to start.
+ * @param[in]  timeout_ticks   Number of ticks (of RTC1, including prescaling) to timeout event
+ *                             (minimum 5 ticks).
+ * @param[in]  slack_ticks     Number of ticks each timeout event may be delayed (maximum
+ *                             @ref APP_TIMER_MAX_SLACK_TICKS). For repeated timers, the delay does
+ *                             not accumulate over the periods.
+ * @param[in]  p_context       General purpose pointer. Will be passed to the timeout handler when
+ *                             the timer expires.
+ *
+ * @retval     NRF_SUCCESS               Timer was successfully started.
+ * @retval     NRF_ERROR_INVALID_PARAM   Invalid parameter.
+ * @retval     NRF_ERROR_INVALID_STATE   Application timer module has not been initialized, or timer
+ *                                       has not been created.
+ * @retval     NRF_ERROR_NO_MEM          Timer operations queue was full.
+ */
+uint32_t app_timer_start_with_slack(app_timer_id_t timer_id,
+                                    uint32_t       timeout_ticks,
+                                    uint32_t       slack_ticks,
+                                    void *         p_context);
+
 /**@brief Function for stopping the specified timer.
  *
  * @param[in]  timer_id   Id of timer to stop.
@@ -262,6 +298,20 @@ uint32_t app_timer_cnt_diff_compute(uint32_t   ticks_to,
                                     uint32_t   ticks_from,
                                     uint32_t * p_ticks_diff);
 
+/**@brief Function for getting the number of timer operations that failed because an operations
+ *        queue was full.
+ *
+ * @details app_timer_start(), app_timer_stop() and app_timer_stop_all() return NRF_ERROR_NO_MEM
+ *          when the operations queue of the calling interrupt level is full. The count makes it
+ *          possible to tune OP_QUEUE_SIZE in APP_TIMER_INIT() without treating the error as fatal.
+ *
+ * @param[out] p_count   Number of rejected timer operations since app_timer_init().
+ *
+ * @retval     NRF_SUCCESS      Count was successfully read.
+ * @retval     NRF_ERROR_NULL   p_count was NULL.
+ */
+uint32_t app_timer_op_queue_overflows_get(uint32_t * p_count);
+
 #endif // APP_TIMER_H__
 
 /** @} */
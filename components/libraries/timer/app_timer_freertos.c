@@ -10,94 +10,382 @@
  *
  */
 
+/* app_timer on FreeRTOS, without the timer service task.
+ *
+ * The timers live in the buffer given to app_timer_init() (see APP_TIMER_INIT()), so nothing is
+ * allocated when timers are created or started. Starting or stopping a timer only updates its node
+ * and notifies a dedicated timer task, which cannot fail, unlike posting a command to the timer
+ * service queue. The task blocks until the earliest expiry, and runs the timeout handlers.
+ *
+ * Timeouts are given in app_timer ticks, as with the RTC1 implementation, and converted to kernel
+ * ticks rounding up, so a timer never expires early.
+ */
+
 #include "FreeRTOS.h"
 #include "task.h"
-#include "timers.h"
 
 #include "app_timer.h"
+#include <stdbool.h>
 #include <stdlib.h>
 #include "nrf51.h"
 #include "nrf51_bitfields.h"
-#include "app_error.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nrf_error.h"
 
-portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+#ifndef APP_TIMER_FREERTOS_TASK_PRIORITY
+#define APP_TIMER_FREERTOS_TASK_PRIORITY   (configMAX_PRIORITIES - 1) /**< Priority of the timer task. */
+#endif
 
-/**@brief Creates a FreeRTOS Timer
- *
- * @param[in]  p_timer_id        Id of created timer.
- * @param[in]  mode              Mode of created timer.
- * @param[in]  timeout_handler   Function which will be executed when timer expires.
- *
- * @return     This function returns timer handle (ID).
- */
-uint32_t app_timer_create(app_timer_id_t            * p_timer_id,
-                          app_timer_mode_t            mode,
-                          app_timer_timeout_handler_t timeout_handler)
+#ifndef APP_TIMER_FREERTOS_TASK_STACK_SIZE
+#define APP_TIMER_FREERTOS_TASK_STACK_SIZE (configMINIMAL_STACK_SIZE + 64) /**< Stack size of the timer task, in words, must fit the timeout handlers. */
+#endif
+
+#define MAX_RTC_COUNTER_VAL 0x00FFFFFF /**< Maximum value of the RTC counter. */
+
+/**@brief Timer node type, stored in the buffer given to app_timer_init(). */
+typedef struct
 {
-    uint32_t      err_code;
-    unsigned long timer_mode;
+    app_timer_timeout_handler_t p_timeout_handler; /**< Handler called on expiry. */
+    void *                      p_context;         /**< General purpose pointer passed to the handler. */
+    app_timer_mode_t            mode;              /**< Timer mode. */
+    bool                        is_running;        /**< The timer is started. */
+    TickType_t                  expiry;            /**< Kernel tick of the next expiry. */
+    TickType_t                  period;            /**< Period of a repeated timer, in kernel ticks. */
+    TickType_t                  slack;             /**< Allowed delay of each expiry, in kernel ticks. */
+} timer_node_t;
 
-    if ( mode == APP_TIMER_MODE_SINGLE_SHOT )
-        timer_mode = pdFALSE;
-    else
-        timer_mode = pdTRUE;
+STATIC_ASSERT(sizeof(timer_node_t) <= APP_TIMER_NODE_SIZE);
 
-    *p_timer_id = xTimerCreate(" ", 1000, timer_mode, NULL, timeout_handler);
+static timer_node_t * mp_nodes;          /**< Timer nodes. */
+static uint8_t        m_node_array_size; /**< Number of timer nodes. */
+static uint8_t        m_timer_count;     /**< Number of created timers. */
+static uint32_t       m_prescaler;       /**< Prescaler of the app_timer ticks. */
+static TaskHandle_t   m_task;            /**< Timer task, NULL until app_timer_init(). */
 
-    if( p_timer_id != NULL )
-        err_code = NRF_SUCCESS;
-    else
-        err_code = NRF_ERROR_NULL;
 
-    return err_code;
+/**@brief Function for converting app_timer ticks to kernel ticks, rounding up. */
+static TickType_t ticks_to_kernel(uint32_t ticks)
+{
+    uint64_t divisor = (uint64_t)APP_TIMER_CLOCK_FREQ;
+
+    return (TickType_t)(((uint64_t)ticks * (m_prescaler + 1) * configTICK_RATE_HZ + divisor - 1)
+                        / divisor);
 }
 
 
-/**@brief Start a FreeRTOS timer.
+/**@brief Function for getting the kernel tick count from any context. */
+static TickType_t tick_count_get(void)
+{
+    return (__get_IPSR() != 0) ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+}
+
+
+/**@brief Function for waking the timer task, so that it computes its timeout again. */
+static void timer_task_notify(void)
+{
+    if (__get_IPSR() != 0)
+    {
+        BaseType_t yield_required = pdFALSE;
+
+        vTaskNotifyGiveFromISR(m_task, &yield_required);
+        portYIELD_FROM_ISR(yield_required);
+    }
+    else if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+    {
+        (void)xTaskNotifyGive(m_task);
+    }
+    // Before the scheduler starts, the task computes its first timeout when it runs.
+}
+
+
+/**@brief Function for getting an expired timer, and updating it for its next expiry.
  *
- * @param[in]  p_timer_id        Id of timer.
- * @param[in]  timeout_ticks     The timer period in [ms].
- * @param[in]  p_contex          This pointer should be always NULL.
+ * @param[in]  now        Current kernel tick count.
+ * @param[out] p_handler  Handler of the expired timer.
+ * @param[out] pp_context Context of the expired timer.
+ * @param[out] p_wait     Kernel ticks until the task must run again, if no timer expired.
  *
- * @return     NRF_SUCCESS on success, otherwise error code.
+ * @retval true   A timer expired.
+ * @retval false  No timer expired.
  */
-uint32_t app_timer_start(TimerHandle_t timer_id, uint32_t timeout_ticks, void * p_context)
+static bool timer_expired_get(TickType_t                    now,
+                              app_timer_timeout_handler_t * p_handler,
+                              void **                       pp_context,
+                              TickType_t *                  p_wait)
 {
-    if (__get_IPSR() != 0)
+    bool       expired = false;
+    TickType_t wait    = portMAX_DELAY;
+    uint8_t    i;
+
+    CRITICAL_REGION_ENTER();
+    for (i = 0; i < m_timer_count; i++)
     {
-        if( xTimerChangePeriodFromISR( timer_id, timeout_ticks, 
-                                       &xHigherPriorityTaskWoken) != pdPASS )
+        timer_node_t * p_node = &mp_nodes[i];
+        TickType_t     remaining;
+
+        if (!p_node->is_running)
         {
-            if( xTimerStartFromISR( timer_id, &xHigherPriorityTaskWoken ) != pdPASS )
-                return NRF_ERROR_NOT_FOUND;
+            continue;
+        }
+
+        // The task is woken at the latest point within the slack of each timer, and runs all the
+        // timers that have expired by then.
+        if ((int32_t)(now - p_node->expiry) >= 0)
+        {
+            *p_handler  = p_node->p_timeout_handler;
+            *pp_context = p_node->p_context;
+
+            if (p_node->mode == APP_TIMER_MODE_REPEATED)
+            {
+                p_node->expiry += p_node->period;
+            }
+            else
+            {
+                p_node->is_running = false;
+            }
+            expired = true;
+            break;
+        }
+
+        remaining = (p_node->expiry - now) + p_node->slack;
+        if (remaining < wait)
+        {
+            wait = remaining;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    *p_wait = wait;
+    return expired;
+}
+
+
+/**@brief Timer task, runs the timeout handlers. */
+static void timer_task(void * p_arg)
+{
+    app_timer_timeout_handler_t handler;
+    void *                      p_context;
+    TickType_t                  wait;
+
+    UNUSED_PARAMETER(p_arg);
+
+    while (true)
+    {
+        if (timer_expired_get(xTaskGetTickCount(), &handler, &p_context, &wait))
+        {
+            handler(p_context);
         }
         else
-            return NRF_SUCCESS;
+        {
+            (void)ulTaskNotifyTake(pdTRUE, wait);
+        }
+    }
+}
+
+
+uint32_t app_timer_init(uint32_t                      prescaler,
+                        uint8_t                       max_timers,
+                        uint8_t                       op_queues_size,
+                        void *                        p_buffer,
+                        app_timer_evt_schedule_func_t evt_schedule_func)
+{
+    UNUSED_PARAMETER(op_queues_size);
+
+    // Check that buffer is correctly aligned.
+    if (!is_word_aligned(p_buffer))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    // Check for NULL buffer.
+    if (p_buffer == NULL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
     }
-    else
+    // The handlers run in the timer task, the scheduler is not needed.
+    if (evt_schedule_func != NULL)
     {
-        xTimerChangePeriod(timer_id, timeout_ticks, NULL);
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_task != NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
 
-        if( xTimerStart(timer_id, NULL) != pdPASS )
-            return NRF_ERROR_NOT_FOUND;
-        else
-            return NRF_SUCCESS;
+    mp_nodes          = p_buffer;
+    m_node_array_size = max_timers;
+    m_timer_count     = 0;
+    m_prescaler       = prescaler;
+
+    // The task is the only allocation of the module, done once.
+    if (xTaskCreate(timer_task, "TMR", APP_TIMER_FREERTOS_TASK_STACK_SIZE, NULL,
+                    APP_TIMER_FREERTOS_TASK_PRIORITY, &m_task) != pdPASS)
+    {
+        return NRF_ERROR_NO_MEM;
     }
-    return NRF_ERROR_NOT_FOUND;
+
+    return NRF_SUCCESS;
 }
 
-/**@brief Stop a FreeRTOS timer.
- *
- * @param[in]  p_timer_id        Id of timer.
- *
- * @return     NRF_SUCCESS on success, otherwise error code.
- */
-uint32_t app_timer_stop(TimerHandle_t timer_id)
+
+uint32_t app_timer_create(app_timer_id_t            * p_timer_id,
+                          app_timer_mode_t            mode,
+                          app_timer_timeout_handler_t timeout_handler)
+{
+    timer_node_t * p_node;
+
+    // Check state and parameters
+    if (m_task == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((p_timer_id == NULL) || (timeout_handler == NULL))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_timer_count >= m_node_array_size)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_node                    = &mp_nodes[m_timer_count];
+    p_node->p_timeout_handler = timeout_handler;
+    p_node->p_context         = NULL;
+    p_node->mode              = mode;
+    p_node->is_running        = false;
+
+    *p_timer_id = m_timer_count++;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_start_with_slack(app_timer_id_t timer_id,
+                                    uint32_t       timeout_ticks,
+                                    uint32_t       slack_ticks,
+                                    void *         p_context)
+{
+    timer_node_t * p_node;
+    TickType_t     timeout;
+    TickType_t     slack;
+    bool           started = false;
+
+    // Check state and parameters
+    if (m_task == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (timer_id >= m_timer_count)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if ((timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS) || (slack_ticks > APP_TIMER_MAX_SLACK_TICKS))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_node  = &mp_nodes[timer_id];
+    timeout = ticks_to_kernel(timeout_ticks);
+    slack   = (slack_ticks * (uint64_t)(m_prescaler + 1) * configTICK_RATE_HZ) / APP_TIMER_CLOCK_FREQ;
+
+    CRITICAL_REGION_ENTER();
+    // Starting a running timer is ignored, as with the RTC1 implementation.
+    if (!p_node->is_running)
+    {
+        p_node->p_context  = p_context;
+        p_node->period     = timeout;
+        p_node->slack      = slack;
+        p_node->expiry     = tick_count_get() + timeout;
+        p_node->is_running = true;
+        started            = true;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (started)
+    {
+        timer_task_notify();
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    return app_timer_start_with_slack(timer_id, timeout_ticks, 0, p_context);
+}
+
+
+uint32_t app_timer_stop(app_timer_id_t timer_id)
+{
+    // Check state and parameters
+    if (m_task == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (timer_id >= m_timer_count)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    // A stopped timer only makes the task wake up early, no notification is needed.
+    mp_nodes[timer_id].is_running = false;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_stop_all(void)
+{
+    uint8_t i;
+
+    // Check state
+    if (m_task == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    for (i = 0; i < m_timer_count; i++)
+    {
+        mp_nodes[i].is_running = false;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_get(uint32_t * p_ticks)
+{
+    uint64_t ticks = (uint64_t)tick_count_get() * APP_TIMER_CLOCK_FREQ;
+
+    // Derived from the kernel tick count, so the value only wraps consistently at 24 bits until the
+    // kernel tick count wraps.
+    *p_ticks = (uint32_t)(ticks / ((uint64_t)(m_prescaler + 1) * configTICK_RATE_HZ))
+               & MAX_RTC_COUNTER_VAL;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_diff_compute(uint32_t   ticks_to,
+                                    uint32_t   ticks_from,
+                                    uint32_t * p_ticks_diff)
 {
-    if( xTimerStop(timer_id, NULL) != pdPASS )
-        return NRF_ERROR_NOT_FOUND;
-    else
-        return NRF_SUCCESS;
+    *p_ticks_diff = ((ticks_to - ticks_from) & MAX_RTC_COUNTER_VAL);
+
+    return NRF_SUCCESS;
 }
 
 
+uint32_t app_timer_op_queue_overflows_get(uint32_t * p_count)
+{
+    if (p_count == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    // There is no operations queue, timer operations never fail for lack of room.
+    *p_count = 0;
+
+    return NRF_SUCCESS;
+}
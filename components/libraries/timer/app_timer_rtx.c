@@ -177,6 +177,20 @@ uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *
 }
 
 
+uint32_t app_timer_start_with_slack(app_timer_id_t timer_id,
+                                    uint32_t       timeout_ticks,
+                                    uint32_t       slack_ticks,
+                                    void *         p_context)
+{
+    // Expiries are not coalesced by this implementation, the timer simply never runs late.
+    if (slack_ticks > APP_TIMER_MAX_SLACK_TICKS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return app_timer_start(timer_id, timeout_ticks, p_context);
+}
+
+
 uint32_t app_timer_stop(app_timer_id_t timer_id)
 {
     switch (osTimerStop((osTimerId)timer_id) )
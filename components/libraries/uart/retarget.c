@@ -12,9 +12,16 @@
  
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include "retarget.h"
 #include "app_uart.h"
 #include "nordic_common.h"
 #include "nrf_error.h"
+#if RETARGET_BUFFERED
+#include "app_fifo.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#endif
 
 #if !defined(__ICCARM__)
 struct __FILE 
@@ -26,15 +33,102 @@ struct __FILE
 FILE __stdout;
 FILE __stdin;
 
+#if RETARGET_BUFFERED
+
+STATIC_ASSERT(IS_POWER_OF_TWO(RETARGET_BUFFER_SIZE));
+
+static uint8_t           m_out_buf[RETARGET_BUFFER_SIZE];   /**< Storage for the output FIFO. */
+static app_fifo_t        m_out_fifo;                        /**< printf output waiting for room in app_uart. */
+static bool              m_out_fifo_initialized = false;    /**< The output FIFO has been initialized. */
+static volatile uint32_t m_dropped;                         /**< Output bytes dropped because the FIFO was full. */
+
+
+/**@brief Function for buffering output bytes, dropping what doesn't fit.
+ *
+ * @details printf may be called from any context, so the FIFO is written in a critical region.
+ *          The bytes are copied in at most two spans.
+ */
+static void out_write(const uint8_t * p_data, uint32_t length)
+{
+    uint32_t written = length;
+
+    CRITICAL_REGION_ENTER();
+    if (!m_out_fifo_initialized)
+    {
+        UNUSED_VARIABLE(app_fifo_init(&m_out_fifo, m_out_buf, sizeof(m_out_buf)));
+        m_out_fifo_initialized = true;
+    }
+    if (app_fifo_write(&m_out_fifo, p_data, &written) != NRF_SUCCESS)
+    {
+        written = 0;
+    }
+    m_dropped += length - written;
+    CRITICAL_REGION_EXIT();
+}
+
+
+void retarget_process(void)
+{
+    uint8_t * p_span;
+    uint32_t  span_len;
+
+    // Both the main loop and the UART event may drain the FIFO, only one at a time.
+    CRITICAL_REGION_ENTER();
+    while (m_out_fifo_initialized &&
+           (app_fifo_span_get(&m_out_fifo, &p_span, &span_len) == NRF_SUCCESS))
+    {
+        uint32_t sent = span_len;
+
+        if (app_uart_write(p_span, &sent) != NRF_SUCCESS)
+        {
+            break;
+        }
+        UNUSED_VARIABLE(app_fifo_consume(&m_out_fifo, sent));
+
+        if (sent < span_len)
+        {
+            // app_uart is full, continue on the next call.
+            break;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+#else
+
+void retarget_process(void)
+{
+    // No implementation needed.
+}
+
+#endif // RETARGET_BUFFERED
+
+
+uint32_t retarget_dropped_get(void)
+{
+#if RETARGET_BUFFERED
+    return m_dropped;
+#else
+    return 0;
+#endif
+}
+
 
 #if defined(__CC_ARM) ||  defined(__ICCARM__)
 int fgetc(FILE * p_file)
 {
     uint8_t input;
+#if RETARGET_BUFFERED
+    if (app_uart_get(&input) == NRF_ERROR_NOT_FOUND)
+    {
+        return EOF;
+    }
+#else
     while (app_uart_get(&input) == NRF_ERROR_NOT_FOUND)
     {
         // No implementation needed.
     }
+#endif
     return input;
 }
 
@@ -43,7 +137,12 @@ int fputc(int ch, FILE * p_file)
 {
     UNUSED_PARAMETER(p_file);
 
+#if RETARGET_BUFFERED
+    uint8_t byte = (uint8_t)ch;
+    out_write(&byte, 1);
+#else
     UNUSED_VARIABLE(app_uart_put((uint8_t)ch));
+#endif
     return ch;
 }
 #elif defined(__GNUC__)
@@ -51,14 +150,15 @@ int fputc(int ch, FILE * p_file)
 
 int _write(int file, const char * p_char, int len)
 {
-    int i;
+    uint32_t length = (uint32_t)len;
 
     UNUSED_PARAMETER(file);
 
-    for (i = 0; i < len; i++)
-    {
-        UNUSED_VARIABLE(app_uart_put(*p_char++));
-    }
+#if RETARGET_BUFFERED
+    out_write((const uint8_t *)p_char, length);
+#else
+    UNUSED_VARIABLE(app_uart_write((const uint8_t *)p_char, &length));
+#endif
 
     return len;
 }
@@ -67,10 +167,18 @@ int _write(int file, const char * p_char, int len)
 int _read(int file, char * p_char, int len)
 {
     UNUSED_PARAMETER(file);
+    UNUSED_PARAMETER(len);
+#if RETARGET_BUFFERED
+    if (app_uart_get((uint8_t *)p_char) == NRF_ERROR_NOT_FOUND)
+    {
+        return 0;
+    }
+#else
     while (app_uart_get((uint8_t *)p_char) == NRF_ERROR_NOT_FOUND)
     {
         // No implementation needed.
     }
+#endif
 
     return 1;
 }
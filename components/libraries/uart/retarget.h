@@ -0,0 +1,57 @@
+/* Copyright (c) 2014 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup retarget Retarget of stdio to the UART
+ * @{
+ * @ingroup app_common
+ *
+ * @brief Sends printf output to, and reads stdin from, @ref app_uart.
+ *
+ * @details By default, output is handed straight to app_uart. Define RETARGET_BUFFERED to 1 to
+ *          have printf copy its output into a RAM buffer of RETARGET_BUFFER_SIZE bytes instead.
+ *          The buffer is moved to app_uart in bulk by @ref retarget_process, which the application
+ *          calls from a low priority context, for example its main loop and its
+ *          APP_UART_TX_EMPTY event. Output that doesn't fit in the buffer is dropped and counted,
+ *          so printf never waits for the UART, and doesn't change the timing of the code it
+ *          traces. Reading stdin doesn't wait either, and gives EOF when no byte has been received.
+ */
+
+#ifndef RETARGET_H__
+#define RETARGET_H__
+
+#include <stdint.h>
+
+#ifndef RETARGET_BUFFERED
+#define RETARGET_BUFFERED       0       /**< Buffer printf output in RAM, see @ref retarget_process. */
+#endif
+
+#ifndef RETARGET_BUFFER_SIZE
+#define RETARGET_BUFFER_SIZE    1024    /**< Size of the printf output buffer, must be a power of two. */
+#endif
+
+/**@brief Function for moving buffered printf output to the UART.
+ *
+ * @details Copies as much as app_uart has room for. Does nothing unless RETARGET_BUFFERED is 1.
+ */
+void retarget_process(void);
+
+/**@brief Function for getting the number of output bytes dropped because the buffer was full.
+ *
+ * @return Number of bytes dropped since startup.
+ */
+uint32_t retarget_dropped_get(void);
+
+#endif // RETARGET_H__
+
+/** @} */
@@ -93,6 +93,7 @@
 #define DM_SERVICE_CONTEXT_NOT_APPLIED   (DEVICE_MANAGER_ERR_BASE + 0x0041)
 #define DM_CONTEXT_INFO_LOST             (DEVICE_MANAGER_ERR_BASE + 0x0042)
 #define DM_DEVICE_CONTEXT_FULL           (DEVICE_MANAGER_ERR_BASE + 0x0043)
+#define DM_ATTR_CACHE_STALE              (DEVICE_MANAGER_ERR_BASE + 0x0044)
 /* @} */
 
 /**
@@ -17,6 +17,7 @@
 #include "ser_hal_transport.h"
 #include "nrf_error.h"
 #include "app_error.h"
+#include "app_util_platform.h"
 #include "ble_serialization.h"
 
 #include "ser_app_power_system_off.h"
@@ -33,6 +34,9 @@
 /** SoftDevice event handler. */
 static ser_sd_transport_evt_handler_t m_evt_handler = NULL;
 
+/** Event batch packet handler. */
+static ser_sd_transport_evt_handler_t m_evt_batch_handler = NULL;
+
 /** 'One time' handler called in task context while waiting for response to scheduled command. */
 static ser_sd_transport_rsp_wait_handler_t m_ot_rsp_wait_handler = NULL;
 
@@ -45,10 +49,26 @@ static ser_sd_transport_rsp_set_handler_t m_os_rsp_set_handler = NULL;
 /** Handler called when hal_transport notifies that packet reception has started. */
 static ser_sd_transport_rx_notification_handler_t m_rx_notify_handler = NULL;
 
-/** User decoder handler for expected response packet. */
-static ser_sd_transport_rsp_handler_t m_rsp_dec_handler = NULL;
-
-/** Flag indicated whether module is waiting for response packet. */
+/** Command waiting for its response packet. */
+typedef struct
+{
+    ser_sd_transport_rsp_handler_t     rsp_dec_handler; /**< User decoder handler for the response packet. */
+    ser_sd_transport_cmd_cpl_handler_t cpl_handler;     /**< Completion handler of an asynchronous command. */
+    void *                             p_context;       /**< Context passed to cpl_handler. */
+    uint8_t                            op_code;         /**< Op code of the command, checked against the response. */
+    uint8_t                            cmd_id;          /**< Sequence ID of the command. */
+    bool                               is_async;        /**< False for the command cmd_write is blocking on. */
+} ser_sd_transport_pending_cmd_t;
+
+/** Commands waiting for response, in the order they were sent. */
+static ser_sd_transport_pending_cmd_t m_pending_cmds[SER_SD_TRANSPORT_MAX_PENDING_CMDS];
+static volatile uint8_t               m_pending_head  = 0;
+static volatile uint8_t               m_pending_count = 0;
+
+/** Sequence ID of the next command. */
+static uint8_t m_next_cmd_id = 0;
+
+/** Flag indicated whether module is waiting for response packet to a blocking command. */
 static volatile bool m_rsp_wait = false;
 
 /** SoftDevice call return value decoded by user decoder handler. */
@@ -77,18 +97,49 @@ static void ser_sd_transport_rx_packet_handler(uint8_t * p_data, uint16_t length
             case SER_PKT_TYPE_RESP:
             case SER_PKT_TYPE_DTM_RESP:
 
-                if (m_rsp_wait)
+                if (m_pending_count != 0)
                 {
-                    m_return_value = m_rsp_dec_handler(p_data, length);
-                    (void)ser_sd_transport_rx_free(p_data);
+                    /* The connectivity chip responds in command order, so this is the response to
+                     * the oldest pending command. */
+                    const ser_sd_transport_pending_cmd_t cmd = m_pending_cmds[m_pending_head];
+                    uint32_t                             result;
+
+                    if ((packet_type == SER_PKT_TYPE_RESP) &&
+                        (length > SER_CMD_OP_CODE_POS) &&
+                        (p_data[SER_CMD_OP_CODE_POS] != cmd.op_code))
+                    {
+                        /* Response to another command, lost sync with connectivity chip. */
+                        (void)ser_sd_transport_rx_free(p_data);
+                        APP_ERROR_HANDLER(packet_type);
+                    }
 
-                    /* Reset response flag - cmd_write function is pending on it.*/
-                    m_rsp_wait = false;
+                    CRITICAL_REGION_ENTER();
+                    m_pending_head = (m_pending_head + 1) % SER_SD_TRANSPORT_MAX_PENDING_CMDS;
+                    m_pending_count--;
+                    CRITICAL_REGION_EXIT();
+
+                    result = cmd.rsp_dec_handler(p_data, length);
+                    (void)ser_sd_transport_rx_free(p_data);
 
-                    /* If os handler is set, signal os that response has arrived.*/
-                    if (m_os_rsp_set_handler)
+                    if (cmd.is_async)
                     {
-                        m_os_rsp_set_handler();
+                        if (cmd.cpl_handler)
+                        {
+                            cmd.cpl_handler(cmd.cmd_id, result, cmd.p_context);
+                        }
+                    }
+                    else
+                    {
+                        m_return_value = result;
+
+                        /* Reset response flag - cmd_write function is pending on it.*/
+                        m_rsp_wait = false;
+
+                        /* If os handler is set, signal os that response has arrived.*/
+                        if (m_os_rsp_set_handler)
+                        {
+                            m_os_rsp_set_handler();
+                        }
                     }
                 }
                 else
@@ -105,6 +156,17 @@ static void ser_sd_transport_rx_packet_handler(uint8_t * p_data, uint16_t length
                 m_evt_handler(p_data, length);
                 break;
 
+            case SER_PKT_TYPE_EVT_BATCH:
+                if (m_evt_batch_handler)
+                {
+                    m_evt_batch_handler(p_data, length);
+                }
+                else
+                {
+                    (void)ser_sd_transport_rx_free(p_data);
+                }
+                break;
+
             default:
                 (void)ser_sd_transport_rx_free(p_data);
                 APP_ERROR_HANDLER(packet_type);
@@ -147,6 +209,8 @@ uint32_t ser_sd_transport_open(ser_sd_transport_evt_handler_t             evt_ha
     m_rx_notify_handler   = rx_notify_handler;
     m_ot_rsp_wait_handler = NULL;
     m_evt_handler         = evt_handler;
+    m_pending_head        = 0;
+    m_pending_count       = 0;
 
     if (evt_handler == NULL)
     {
@@ -159,6 +223,7 @@ uint32_t ser_sd_transport_open(ser_sd_transport_evt_handler_t             evt_ha
 uint32_t ser_sd_transport_close(void)
 {
     m_evt_handler         = NULL;
+    m_evt_batch_handler   = NULL;
     m_os_rsp_wait_handler = NULL;
     m_os_rsp_set_handler  = NULL;
     m_ot_rsp_wait_handler = NULL;
@@ -175,6 +240,13 @@ uint32_t ser_sd_transport_ot_rsp_wait_handler_set(ser_sd_transport_rsp_wait_hand
     return NRF_SUCCESS;
 }
 
+uint32_t ser_sd_transport_evt_batch_handler_set(ser_sd_transport_evt_handler_t batch_handler)
+{
+    m_evt_batch_handler = batch_handler;
+
+    return NRF_SUCCESS;
+}
+
 bool ser_sd_transport_is_busy(void)
 {
     return m_rsp_wait;
@@ -184,7 +256,7 @@ uint32_t ser_sd_transport_tx_alloc(uint8_t * * pp_data, uint16_t * p_len)
 {
     uint32_t err_code;
 
-    if (m_rsp_wait)
+    if (m_rsp_wait || (m_pending_count >= SER_SD_TRANSPORT_MAX_PENDING_CMDS))
     {
         err_code = NRF_ERROR_BUSY;
     }
@@ -206,15 +278,61 @@ uint32_t ser_sd_transport_rx_free(uint8_t * p_data)
     return ser_hal_transport_rx_pkt_free(p_data);
 }
 
+/**@brief Function for adding a command to the end of the pending commands.
+ *
+ * @return Sequence ID of the command, or -1 if the maximum number of commands is pending.
+ */
+static int32_t pending_cmd_push(const uint8_t *                    p_buffer,
+                                ser_sd_transport_rsp_handler_t     rsp_dec_handler,
+                                ser_sd_transport_cmd_cpl_handler_t cpl_handler,
+                                void *                             p_context,
+                                bool                               is_async)
+{
+    int32_t cmd_id = -1;
+
+    CRITICAL_REGION_ENTER();
+    if (m_pending_count < SER_SD_TRANSPORT_MAX_PENDING_CMDS)
+    {
+        ser_sd_transport_pending_cmd_t * p_cmd =
+            &m_pending_cmds[(m_pending_head + m_pending_count) % SER_SD_TRANSPORT_MAX_PENDING_CMDS];
+
+        p_cmd->rsp_dec_handler = rsp_dec_handler;
+        p_cmd->cpl_handler     = cpl_handler;
+        p_cmd->p_context       = p_context;
+        p_cmd->op_code         = p_buffer[SER_PKT_OP_CODE_POS];
+        p_cmd->cmd_id          = m_next_cmd_id++;
+        p_cmd->is_async        = is_async;
+        cmd_id                 = p_cmd->cmd_id;
+        m_pending_count++;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return cmd_id;
+}
+
+/**@brief Function for removing the last command added, when it could not be sent.
+ */
+static void pending_cmd_pop_last(void)
+{
+    CRITICAL_REGION_ENTER();
+    m_pending_count--;
+    m_next_cmd_id--;
+    CRITICAL_REGION_EXIT();
+}
+
 uint32_t ser_sd_transport_cmd_write(const uint8_t *                p_buffer,
                                     uint16_t                       length,
                                     ser_sd_transport_rsp_handler_t cmd_rsp_decode_callback)
 {
     uint32_t err_code = NRF_SUCCESS;
 
-    m_rsp_wait        = true;
-    m_rsp_dec_handler = cmd_rsp_decode_callback;
-    err_code          = ser_hal_transport_tx_pkt_send(p_buffer, length);
+    if (cmd_rsp_decode_callback)
+    {
+        m_rsp_wait = true;
+        APP_ERROR_CHECK_BOOL(pending_cmd_push(p_buffer, cmd_rsp_decode_callback, NULL, NULL, false)
+                             >= 0);
+    }
+    err_code = ser_hal_transport_tx_pkt_send(p_buffer, length);
     APP_ERROR_CHECK(err_code);
 
     /* Execute callback for response decoding only if one was provided.*/
@@ -236,3 +354,39 @@ uint32_t ser_sd_transport_cmd_write(const uint8_t *                p_buffer,
     APPL_LOG("\r\n[SD_CALL_ID]: 0x%X, err_code= 0x%X\r\n", p_buffer[1], err_code);
     return err_code;
 }
+
+uint32_t ser_sd_transport_cmd_write_async(const uint8_t *                    p_buffer,
+                                          uint16_t                           length,
+                                          ser_sd_transport_rsp_handler_t     cmd_rsp_decode_callback,
+                                          ser_sd_transport_cmd_cpl_handler_t cmd_cpl_callback,
+                                          void *                             p_context,
+                                          uint8_t *                          p_cmd_id)
+{
+    uint32_t err_code;
+    int32_t  cmd_id;
+
+    if ((p_buffer == NULL) || (cmd_rsp_decode_callback == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    cmd_id = pending_cmd_push(p_buffer, cmd_rsp_decode_callback, cmd_cpl_callback, p_context, true);
+    if (cmd_id < 0)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    err_code = ser_hal_transport_tx_pkt_send(p_buffer, length);
+    if (err_code != NRF_SUCCESS)
+    {
+        pending_cmd_pop_last();
+        return err_code;
+    }
+
+    if (p_cmd_id)
+    {
+        *p_cmd_id = (uint8_t)cmd_id;
+    }
+    APPL_LOG("\r\n[SD_CALL_ID]: 0x%X, cmd_id= %d (async)\r\n", p_buffer[1], cmd_id);
+    return NRF_SUCCESS;
+}
@@ -30,6 +30,11 @@
  *          ser_sd_transport (using response decoder handler provided for each SoftDevice call) but
  *          events are forwarded to the user so it is user's responsibility to free RX buffer.
  *
+ *          Commands can also be written with @ref ser_sd_transport_cmd_write_async, which returns
+ *          once the command is sent, so up to SER_SD_TRANSPORT_MAX_PENDING_CMDS commands can wait
+ *          for a response at the same time. The connectivity chip executes commands in the order
+ *          received, so each response is matched to the oldest pending command.
+ *
  */
 #ifndef SER_SD_TRANSPORT_H_
 #define SER_SD_TRANSPORT_H_
@@ -44,6 +49,19 @@ typedef void (*ser_sd_transport_rx_notification_handler_t)(void);
 
 typedef uint32_t (*ser_sd_transport_rsp_handler_t)(const uint8_t * p_buffer, uint16_t length);
 
+/**@brief Handler called when the response to an asynchronous command has been decoded.
+ *
+ * @param[in] cmd_id      Sequence ID of the command, as returned by
+ *                        @ref ser_sd_transport_cmd_write_async.
+ * @param[in] result      SoftDevice call return value decoded by the response decoder.
+ * @param[in] p_context   Context passed to @ref ser_sd_transport_cmd_write_async.
+ */
+typedef void (*ser_sd_transport_cmd_cpl_handler_t)(uint8_t cmd_id, uint32_t result, void * p_context);
+
+#ifndef SER_SD_TRANSPORT_MAX_PENDING_CMDS
+#define SER_SD_TRANSPORT_MAX_PENDING_CMDS 4 /**< Maximum number of commands waiting for a response at the same time. */
+#endif
+
 /**@brief Function for opening the module.
  *
  * @note 'Wait for response' and 'Response set' callbacks can be set in RTOS environment.
@@ -86,6 +104,18 @@ uint32_t ser_sd_transport_open(ser_sd_transport_evt_handler_t             evt_ha
  */
 uint32_t ser_sd_transport_ot_rsp_wait_handler_set(ser_sd_transport_rsp_wait_handler_t wait_handler);
 
+/**@brief Function for setting the handler of event batch packets.
+ *
+ * @details An event batch packet holds several events, each preceded by its length on
+ *          SER_EVT_BATCH_LEN_SIZE bytes. The handler is called with the whole packet and frees it
+ *          with @ref ser_sd_transport_rx_free. Without a handler, batch packets are dropped.
+ *
+ * @param[in] batch_handler      Handler to be called when an event batch packet is received.
+ *
+ * @retval NRF_SUCCESS          Operation success.
+ */
+uint32_t ser_sd_transport_evt_batch_handler_set(ser_sd_transport_evt_handler_t batch_handler);
+
 
 /**@brief Function for closing the module.
  *
@@ -99,6 +129,8 @@ uint32_t ser_sd_transport_close(void);
  * @param[out] p_len         Pointer to allocated buffer length.
  *
  * @retval NRF_SUCCESS          Operation success.
+ * @retval NRF_ERROR_BUSY       Waiting for the response to a blocking command, or
+ *                              SER_SD_TRANSPORT_MAX_PENDING_CMDS commands are pending.
  */
 uint32_t ser_sd_transport_tx_alloc(uint8_t * * pp_data, uint16_t * p_len);
 
@@ -149,5 +181,33 @@ uint32_t ser_sd_transport_cmd_write(const uint8_t *                p_buffer,
                                     uint16_t                       length,
                                     ser_sd_transport_rsp_handler_t cmd_resp_decode_callback);
 
+/**@brief Function for handling SoftDevice command without waiting for the response.
+ *
+ * @note The response is decoded and cmd_cpl_callback is called in serial peripheral interrupt
+ *       context. Output parameters of the call must therefore stay valid until then, or be
+ *       ignored by the decoder.
+ * @note A blocking command written with @ref ser_sd_transport_cmd_write after asynchronous ones
+ *       returns when its own response is received, after the ones before it have completed.
+ *
+ * @param[in]  p_buffer                Pointer to command.
+ * @param[in]  length                  Command length.
+ * @param[in]  cmd_rsp_decode_callback Pointer to function for decoding response packet.
+ * @param[in]  cmd_cpl_callback        Pointer to function called with the decoded return value.
+ *                                     Can be NULL for calls whose result is not needed.
+ * @param[in]  p_context               Context passed to cmd_cpl_callback.
+ * @param[out] p_cmd_id                Sequence ID the command is tagged with. Can be NULL.
+ *
+ * @retval NRF_SUCCESS          Command sent.
+ * @retval NRF_ERROR_NULL       NULL pointer supplied for p_buffer or cmd_rsp_decode_callback.
+ * @retval NRF_ERROR_BUSY       SER_SD_TRANSPORT_MAX_PENDING_CMDS commands are pending.
+ * @return Errors propagated from ser_hal_transport_tx_pkt_send.
+ */
+uint32_t ser_sd_transport_cmd_write_async(const uint8_t *                    p_buffer,
+                                          uint16_t                           length,
+                                          ser_sd_transport_rsp_handler_t     cmd_rsp_decode_callback,
+                                          ser_sd_transport_cmd_cpl_handler_t cmd_cpl_callback,
+                                          void *                             p_context,
+                                          uint8_t *                          p_cmd_id);
+
 #endif /* SER_SD_TRANSPORT_H_ */
 /** @} */
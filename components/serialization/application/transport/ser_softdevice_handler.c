@@ -18,9 +18,36 @@
 #include "ser_sd_transport.h"
 #include "ser_app_hal.h"
 #include "ser_config.h"
+#include "ble_serialization.h"
+#include "app_util.h"
+#include "app_util_platform.h"
 #include "nrf_soc.h"
 
+#if SER_HAL_TRANSPORT_RX_BUF_COUNT > 1
+
+/** Number of received event packets the mailbox holds. One RX buffer is always left to the
+ *  transport, so that command responses can be received while the mailbox is full. */
+#define SD_BLE_EVT_MAILBOX_QUEUE_SIZE (SER_HAL_TRANSPORT_RX_BUF_COUNT - 1)
+
+/** @brief Structure used to pass a received event packet through mailbox. The packet stays in
+ *         the transport RX buffer, which is freed once all events in it have been fetched.
+ */
+typedef struct
+{
+    uint8_t * p_data;   /**< Event packet, as given by the transport. */
+    uint16_t  length;   /**< Length of the packet. */
+    uint16_t  index;    /**< Position of the next event in an event batch packet. */
+    bool      is_batch; /**< Whether the packet is an event batch packet. */
+} ser_sd_handler_evt_data_t;
+
+static ser_sd_handler_evt_data_t m_evt_pkt;      /**< Packet events are fetched from. p_data is NULL if none. */
+static volatile uint32_t         m_evt_pkts_held; /**< Packets in the mailbox and in m_evt_pkt. */
+
+#else
+
+#ifndef SD_BLE_EVT_MAILBOX_QUEUE_SIZE
 #define SD_BLE_EVT_MAILBOX_QUEUE_SIZE 5 /**< Size of mailbox queue. */
+#endif
 
 /** @brief Structure used to pass packet details through mailbox.
  */
@@ -29,6 +56,8 @@ typedef struct
     uint32_t evt_data[CEIL_DIV(BLE_STACK_EVT_MSG_BUF_SIZE, sizeof (uint32_t))]; /**< Buffer for decoded event */
 } ser_sd_handler_evt_data_t;
 
+#endif /* SER_HAL_TRANSPORT_RX_BUF_COUNT > 1 */
+
 /** @brief
  *   Mailbox used for communication between event handler (called from serial stream
  *   interrupt context) and event processing function (called from scheduler or interrupt context).
@@ -55,6 +84,63 @@ static void connectivity_reset_high(void)
     ser_app_hal_delay(CONN_CHIP_WAKEUP_TIME);
 }
 
+#if SER_HAL_TRANSPORT_RX_BUF_COUNT > 1
+
+/**
+ * @brief Function for passing a received event packet to the mailbox. Called from the serial
+ *        stream interrupt context.
+ */
+static void evt_pkt_put(uint8_t * p_data, uint16_t length, bool is_batch)
+{
+    ser_sd_handler_evt_data_t item;
+    uint32_t                  err_code = NRF_ERROR_NO_MEM;
+
+    item.p_data   = p_data;
+    item.length   = length;
+    item.index    = 0;
+    item.is_batch = is_batch;
+
+    if (m_evt_pkts_held < SD_BLE_EVT_MAILBOX_QUEUE_SIZE)
+    {
+        err_code = app_mailbox_put(m_ble_evt_mailbox_id, &item);
+    }
+    APP_ERROR_CHECK(err_code);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_evt_pkts_held++;
+    }
+
+    ser_app_hal_nrf_evt_pending();
+}
+
+/**
+ * @brief Function for giving the RX buffer of the current event packet back to the transport.
+ */
+static void evt_pkt_release(void)
+{
+    uint32_t err_code;
+
+    err_code = ser_sd_transport_rx_free(m_evt_pkt.p_data);
+    APP_ERROR_CHECK(err_code);
+    m_evt_pkt.p_data = NULL;
+
+    CRITICAL_REGION_ENTER();
+    m_evt_pkts_held--;
+    CRITICAL_REGION_EXIT();
+}
+
+static void ser_softdevice_evt_handler(uint8_t * p_data, uint16_t length)
+{
+    evt_pkt_put(p_data, length, false);
+}
+
+static void ser_softdevice_evt_batch_handler(uint8_t * p_data, uint16_t length)
+{
+    evt_pkt_put(p_data, length, true);
+}
+
+#else
+
 static void ser_softdevice_evt_handler(uint8_t * p_data, uint16_t length)
 {
     ser_sd_handler_evt_data_t item;
@@ -73,6 +159,39 @@ static void ser_softdevice_evt_handler(uint8_t * p_data, uint16_t length)
     ser_app_hal_nrf_evt_pending();
 }
 
+static void ser_softdevice_evt_batch_handler(uint8_t * p_data, uint16_t length)
+{
+    ser_sd_handler_evt_data_t item;
+    uint32_t                  err_code;
+    uint32_t                  index = 0;
+
+    while (index + SER_EVT_BATCH_LEN_SIZE <= length)
+    {
+        uint32_t evt_len = uint16_decode(&p_data[index]);
+        uint32_t len32   = sizeof (item.evt_data);
+
+        index += SER_EVT_BATCH_LEN_SIZE;
+        if (evt_len > length - index)
+        {
+            break;
+        }
+
+        err_code = ble_event_dec(&p_data[index], evt_len, (ble_evt_t *)item.evt_data, &len32);
+        APP_ERROR_CHECK(err_code);
+        index += evt_len;
+
+        err_code = app_mailbox_put(m_ble_evt_mailbox_id, &item);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    err_code = ser_sd_transport_rx_free(p_data);
+    APP_ERROR_CHECK(err_code);
+
+    ser_app_hal_nrf_evt_pending();
+}
+
+#endif /* SER_HAL_TRANSPORT_RX_BUF_COUNT > 1 */
+
 /**
  * @brief Function called while waiting for connectivity chip response. It handles incoming events.
  */
@@ -94,6 +213,67 @@ uint32_t sd_evt_get(uint32_t * p_evt_id)
     return NRF_ERROR_NOT_FOUND;
 }
 
+#if SER_HAL_TRANSPORT_RX_BUF_COUNT > 1
+
+uint32_t sd_ble_evt_get(uint8_t * p_data, uint16_t * p_len)
+{
+    uint32_t        err_code;
+    uint32_t        evt_len = 0;
+    uint32_t        len32   = *p_len;
+    const uint8_t * p_evt = NULL;
+
+    while (p_evt == NULL)
+    {
+        if (m_evt_pkt.p_data == NULL &&
+            app_mailbox_get(m_ble_evt_mailbox_id, &m_evt_pkt) != NRF_SUCCESS)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+
+        if (!m_evt_pkt.is_batch)
+        {
+            p_evt           = m_evt_pkt.p_data;
+            evt_len         = m_evt_pkt.length;
+            m_evt_pkt.index = m_evt_pkt.length;
+        }
+        else if (m_evt_pkt.index + SER_EVT_BATCH_LEN_SIZE <= m_evt_pkt.length)
+        {
+            evt_len          = uint16_decode(&m_evt_pkt.p_data[m_evt_pkt.index]);
+            m_evt_pkt.index += SER_EVT_BATCH_LEN_SIZE;
+            if (evt_len <= m_evt_pkt.length - m_evt_pkt.index)
+            {
+                p_evt            = &m_evt_pkt.p_data[m_evt_pkt.index];
+                m_evt_pkt.index += evt_len;
+            }
+        }
+
+        if (p_evt == NULL)
+        {
+            /* Fully fetched or truncated event batch packet. */
+            evt_pkt_release();
+        }
+    }
+
+    /* Decoded straight into the caller's buffer. */
+    err_code = ble_event_dec(p_evt, evt_len, (ble_evt_t *)p_data, &len32);
+
+    /* The buffer is freed before the event is handled, so that the handler can wait for
+     * command responses even when the other RX buffers are held. */
+    if (m_evt_pkt.index + SER_EVT_BATCH_LEN_SIZE > m_evt_pkt.length || !m_evt_pkt.is_batch)
+    {
+        evt_pkt_release();
+    }
+
+    if (err_code == NRF_SUCCESS)
+    {
+        *p_len = ((ble_evt_t *)p_data)->header.evt_len;
+    }
+
+    return err_code;
+}
+
+#else
+
 uint32_t sd_ble_evt_get(uint8_t * p_data, uint16_t * p_len)
 {
     uint32_t err_code;
@@ -119,11 +299,20 @@ uint32_t sd_ble_evt_get(uint8_t * p_data, uint16_t * p_len)
     return err_code;
 }
 
+#endif /* SER_HAL_TRANSPORT_RX_BUF_COUNT > 1 */
+
 uint32_t sd_ble_evt_mailbox_length_get(uint32_t * p_mailbox_length)
 {
     uint32_t err_code;
     
     err_code = app_mailbox_get_length(m_ble_evt_mailbox_id, p_mailbox_length);
+
+#if SER_HAL_TRANSPORT_RX_BUF_COUNT > 1
+    if (err_code == NRF_SUCCESS && m_evt_pkt.p_data != NULL)
+    {
+        (*p_mailbox_length)++;
+    }
+#endif
     
     return err_code;
 }
@@ -139,6 +328,10 @@ uint32_t sd_softdevice_enable(nrf_clock_lfclksrc_t           clock_source,
     {
         connectivity_reset_low();
 
+#if SER_HAL_TRANSPORT_RX_BUF_COUNT > 1
+        m_evt_pkt.p_data = NULL;
+        m_evt_pkts_held  = 0;
+#endif
         err_code = app_mailbox_create(APP_MAILBOX(sd_ble_evt_mailbox), &m_ble_evt_mailbox_id);
 
         if (err_code == NRF_SUCCESS)
@@ -149,6 +342,7 @@ uint32_t sd_softdevice_enable(nrf_clock_lfclksrc_t           clock_source,
                                              NULL);
             if (err_code == NRF_SUCCESS)
             {
+              (void)ser_sd_transport_evt_batch_handler_set(ser_softdevice_evt_batch_handler);
               connectivity_reset_high();
             }
         }
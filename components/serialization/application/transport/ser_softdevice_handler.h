@@ -32,6 +32,10 @@
 
 
 /**@brief Function for checking if there is any more events in the internal mailbox.
+ *
+ * @note With more than one RX buffer in the HAL Transport layer, the mailbox holds received
+ *       event packets, and the length is the number of packets. An event batch packet counts as
+ *       one until all its events have been fetched.
  *
  * @param[in] p_mailbox_length Pointer to mailbox length.
  *
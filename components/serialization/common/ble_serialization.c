@@ -12,6 +12,7 @@
 #include "ble_serialization.h"
 #include "nrf_error.h"
 #include "app_util.h"
+#include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -86,6 +87,96 @@ uint32_t ser_ble_cmd_rsp_dec(uint8_t const * const p_buf,
     return NRF_SUCCESS;
 }
 
+uint32_t ser_adv_report_filter_set_req_enc(ser_adv_report_filter_t const * const p_filter,
+                                           uint8_t * const                       p_buf,
+                                           uint32_t * const                      p_buf_len)
+{
+    SER_ASSERT_NOT_NULL(p_filter);
+    SER_ASSERT_NOT_NULL(p_buf);
+    SER_ASSERT_NOT_NULL(p_buf_len);
+
+    uint32_t index = 0;
+    uint32_t i;
+
+    if ((p_filter->addr_count > SER_ADV_REPORT_FILTER_ADDR_MAX) ||
+        (p_filter->uuid_count > SER_ADV_REPORT_FILTER_UUID_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    SER_ASSERT_LENGTH_LEQ(SER_OP_CODE_SIZE + 3 +
+                          p_filter->addr_count * (1 + SER_ADV_REPORT_FILTER_ADDR_LEN) +
+                          p_filter->uuid_count * sizeof (uint16_t), *p_buf_len);
+
+    p_buf[index++] = SER_OP_CODE_ADV_REPORT_FILTER_SET;
+    p_buf[index++] = (uint8_t)p_filter->rssi_min;
+    p_buf[index++] = p_filter->addr_count;
+    for (i = 0; i < p_filter->addr_count; i++)
+    {
+        p_buf[index++] = p_filter->addrs[i].addr_type;
+        memcpy(&p_buf[index], p_filter->addrs[i].addr, SER_ADV_REPORT_FILTER_ADDR_LEN);
+        index += SER_ADV_REPORT_FILTER_ADDR_LEN;
+    }
+    p_buf[index++] = p_filter->uuid_count;
+    for (i = 0; i < p_filter->uuid_count; i++)
+    {
+        index += uint16_encode(p_filter->uuids[i], &p_buf[index]);
+    }
+
+    *p_buf_len = index;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t ser_adv_report_filter_set_req_dec(uint8_t const * const           p_buf,
+                                           uint32_t                        packet_len,
+                                           ser_adv_report_filter_t * const p_filter)
+{
+    SER_ASSERT_NOT_NULL(p_buf);
+    SER_ASSERT_NOT_NULL(p_filter);
+
+    uint32_t index = SER_OP_CODE_SIZE;
+    uint32_t i;
+
+    // The counts index the filter arrays, so they are checked even without SER_ASSERTS_ENABLED.
+    if (packet_len < index + 2)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    p_filter->rssi_min   = (int8_t)p_buf[index++];
+    p_filter->addr_count = p_buf[index++];
+    if (p_filter->addr_count > SER_ADV_REPORT_FILTER_ADDR_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (packet_len < index + p_filter->addr_count * (1 + SER_ADV_REPORT_FILTER_ADDR_LEN) + 1)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    for (i = 0; i < p_filter->addr_count; i++)
+    {
+        p_filter->addrs[i].addr_type = p_buf[index++];
+        memcpy(p_filter->addrs[i].addr, &p_buf[index], SER_ADV_REPORT_FILTER_ADDR_LEN);
+        index += SER_ADV_REPORT_FILTER_ADDR_LEN;
+    }
+    p_filter->uuid_count = p_buf[index++];
+    if (p_filter->uuid_count > SER_ADV_REPORT_FILTER_UUID_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (packet_len != index + p_filter->uuid_count * sizeof (uint16_t))
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    for (i = 0; i < p_filter->uuid_count; i++)
+    {
+        p_filter->uuids[i] = uint16_decode(&p_buf[index]);
+        index += sizeof (uint16_t);
+    }
+
+    return NRF_SUCCESS;
+}
+
 uint32_t uint32_t_enc(void const * const p_field,
                       uint8_t * const    p_buf,
                       uint32_t           buf_len,
@@ -518,3 +609,99 @@ uint32_t uint8_vector_dec(uint8_t const * const p_buf,
     return NRF_SUCCESS;
 }
 
+/**@brief Function for getting the encoded length of a structure described by a field table. */
+static uint32_t ser_struct_len(ser_struct_desc_t const * const p_desc)
+{
+    uint32_t len = 0;
+
+    for (uint32_t i = 0; i < p_desc->count; i++)
+    {
+        ser_field_desc_t const * p_field = &p_desc->p_fields[i];
+
+        len += (p_field->type == SER_FIELD_TYPE_STRUCT) ? ser_struct_len(p_field->p_struct)
+                                                        : p_field->size;
+    }
+
+    return len;
+}
+
+/**@brief Function for copying a structure to or from the wire, the length is already checked.
+ *
+ * @return Number of bytes of the wire format copied.
+ */
+static uint32_t ser_struct_copy(ser_struct_desc_t const * const p_desc,
+                                uint8_t *                       p_struct,
+                                uint8_t *                       p_wire,
+                                bool                            encode)
+{
+    ser_field_desc_t const * p_fields = p_desc->p_fields;
+    uint32_t                 index    = 0;
+    uint32_t                 i        = 0;
+
+    while (i < p_desc->count)
+    {
+        uint32_t offset = p_fields[i].offset;
+        uint32_t len;
+
+        if (p_fields[i].type == SER_FIELD_TYPE_STRUCT)
+        {
+            index += ser_struct_copy(p_fields[i].p_struct, p_struct + offset, p_wire + index, encode);
+            i++;
+            continue;
+        }
+
+        // Merge the following fields that start where this one ends. The integers are little
+        // endian both in memory and on the wire, so the run is copied as is.
+        len = p_fields[i++].size;
+        while ((i < p_desc->count) &&
+               (p_fields[i].type != SER_FIELD_TYPE_STRUCT) &&
+               (p_fields[i].offset == offset + len))
+        {
+            len += p_fields[i++].size;
+        }
+
+        if (encode)
+        {
+            memcpy(p_wire + index, p_struct + offset, len);
+        }
+        else
+        {
+            memcpy(p_struct + offset, p_wire + index, len);
+        }
+        index += len;
+    }
+
+    return index;
+}
+
+uint32_t ser_struct_enc(ser_struct_desc_t const * const p_desc,
+                        void const * const              p_struct,
+                        uint8_t * const                 p_buf,
+                        uint32_t                        buf_len,
+                        uint32_t * const                p_index)
+{
+    SER_ASSERT_NOT_NULL(p_struct);
+    SER_ASSERT_NOT_NULL(p_buf);
+    SER_ASSERT_NOT_NULL(p_index);
+    SER_ASSERT_LENGTH_LEQ(ser_struct_len(p_desc), ((int32_t)buf_len - *p_index));
+
+    *p_index += ser_struct_copy(p_desc, (uint8_t *)p_struct, &p_buf[*p_index], true);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t ser_struct_dec(ser_struct_desc_t const * const p_desc,
+                        uint8_t const * const           p_buf,
+                        uint32_t                        buf_len,
+                        uint32_t * const                p_index,
+                        void * const                    p_struct)
+{
+    SER_ASSERT_NOT_NULL(p_struct);
+    SER_ASSERT_NOT_NULL(p_buf);
+    SER_ASSERT_NOT_NULL(p_index);
+    SER_ASSERT_LENGTH_LEQ(ser_struct_len(p_desc), ((int32_t)buf_len - *p_index));
+
+    *p_index += ser_struct_copy(p_desc, (uint8_t *)p_struct, (uint8_t *)&p_buf[*p_index], false);
+
+    return NRF_SUCCESS;
+}
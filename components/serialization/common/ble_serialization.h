@@ -26,6 +26,7 @@ typedef enum
     SER_PKT_TYPE_EVT,         /**< Event packet type. */
     SER_PKT_TYPE_DTM_CMD,     /**< DTM Command packet type. */
     SER_PKT_TYPE_DTM_RESP,    /**< DTM Response packet type. */
+    SER_PKT_TYPE_EVT_BATCH,   /**< Packet of several events, each preceded by its 16-bit length. */
     SER_PKT_TYPE_MAX          /**< Upper bound. */
 } ser_pkt_type_t;
 
@@ -68,6 +69,8 @@ typedef enum
 #define SER_EVT_HEADER_SIZE            (SER_EVT_ID_SIZE)
 /** Size of event connection handler. */
 #define SER_EVT_CONN_HANDLE_SIZE       2
+/** Size in bytes of the length field in front of each event of a batch packet. */
+#define SER_EVT_BATCH_LEN_SIZE         2
 
 /** Position of the Op Code in the DTM command buffer.*/
 #define SER_DTM_CMD_OP_CODE_POS        0
@@ -120,6 +123,72 @@ typedef enum
 /** See Bluetooth 4.0 spec: 3.4.4.7. */
 #define BLE_GATTC_HANDLE_COUNT_LEN_MAX     ((GATT_MTU_SIZE_DEFAULT - 1) / 2)
 
+/** Op code of the command setting the advertising report filter of the connectivity chip. It is
+ *  above the SoftDevice SVC numbers. */
+#define SER_OP_CODE_ADV_REPORT_FILTER_SET  0xF0
+
+/** Maximum number of addresses and of 16-bit service UUIDs in the advertising report filter. */
+#ifndef SER_ADV_REPORT_FILTER_ADDR_MAX
+#define SER_ADV_REPORT_FILTER_ADDR_MAX     4
+#endif
+#ifndef SER_ADV_REPORT_FILTER_UUID_MAX
+#define SER_ADV_REPORT_FILTER_UUID_MAX     4
+#endif
+
+/** Length of a Bluetooth address in the advertising report filter. */
+#define SER_ADV_REPORT_FILTER_ADDR_LEN     6
+
+/**@brief Address in the advertising report filter. */
+typedef struct
+{
+    uint8_t addr_type;                              /**< Address type, see BLE_GAP_ADDR_TYPES. */
+    uint8_t addr[SER_ADV_REPORT_FILTER_ADDR_LEN];   /**< Address, LSB first. */
+} ser_adv_report_filter_addr_t;
+
+/**@brief Advertising report filter of the connectivity chip.
+ *
+ * A report is passed to the application chip if its RSSI is at least rssi_min, its address is one
+ * of addrs, and its advertising data lists one of uuids as a 16-bit service UUID. An empty list
+ * passes all reports, and the UUID test is not applied to scan responses.
+ */
+typedef struct
+{
+    int8_t                       rssi_min;                               /**< Minimum RSSI in dBm, -128 to pass all. */
+    uint8_t                      addr_count;                             /**< Number of addresses in addrs. */
+    ser_adv_report_filter_addr_t addrs[SER_ADV_REPORT_FILTER_ADDR_MAX];  /**< Addresses to pass. */
+    uint8_t                      uuid_count;                             /**< Number of UUIDs in uuids. */
+    uint16_t                     uuids[SER_ADV_REPORT_FILTER_UUID_MAX];  /**< 16-bit service UUIDs to pass. */
+} ser_adv_report_filter_t;
+
+/**@brief Function for encoding the @ref SER_OP_CODE_ADV_REPORT_FILTER_SET command.
+ *
+ * @param[in]      p_filter         Filter to set.
+ * @param[in]      p_buf            Pointer to the beginning of the output buffer.
+ * @param[in,out]  p_buf_len        \c in: Size of buffer.
+ *                                  \c out: Length of the encoded command.
+ *
+ * @retval NRF_SUCCESS              Command encoded successfully.
+ * @retval NRF_ERROR_INVALID_PARAM  Too many addresses or UUIDs.
+ * @retval NRF_ERROR_INVALID_LENGTH Encoding failure. Incorrect buffer length.
+ */
+uint32_t ser_adv_report_filter_set_req_enc(ser_adv_report_filter_t const * const p_filter,
+                                           uint8_t * const                       p_buf,
+                                           uint32_t * const                      p_buf_len);
+
+/**@brief Function for decoding the @ref SER_OP_CODE_ADV_REPORT_FILTER_SET command.
+ *
+ * @param[in]      p_buf            Pointer to the beginning of the command.
+ * @param[in]      packet_len       Length of the command.
+ * @param[out]     p_filter         Decoded filter.
+ *
+ * @retval NRF_SUCCESS              Command decoded successfully.
+ * @retval NRF_ERROR_INVALID_PARAM  Too many addresses or UUIDs.
+ * @retval NRF_ERROR_INVALID_LENGTH Decoding failure. Incorrect buffer length.
+ */
+uint32_t ser_adv_report_filter_set_req_dec(uint8_t const * const           p_buf,
+                                           uint32_t                        packet_len,
+                                           ser_adv_report_filter_t * const p_filter);
+
 /** Generic command response status code encoder. */
 uint32_t ser_ble_cmd_rsp_status_code_enc(uint8_t          op_code,
                                          uint32_t         command_status,
@@ -575,6 +644,87 @@ uint32_t uint8_vector_dec(uint8_t const * const p_buf,
                  uint8_t  * const      p_data,
                  uint16_t              dlen);
 
+/**@brief Types of the fields in a @ref ser_struct_desc_t table. */
+typedef enum
+{
+    SER_FIELD_TYPE_UINT8,     /**< uint8_t field. */
+    SER_FIELD_TYPE_UINT16,    /**< uint16_t field, little endian on the wire. */
+    SER_FIELD_TYPE_UINT32,    /**< uint32_t field, little endian on the wire. */
+    SER_FIELD_TYPE_BUF,       /**< Fixed size uint8_t array, copied as is. */
+    SER_FIELD_TYPE_STRUCT     /**< Nested structure, described by its own table. */
+} ser_field_type_t;
+
+typedef struct ser_struct_desc_s ser_struct_desc_t;
+
+/**@brief Description of one field of a structure. */
+typedef struct
+{
+    uint8_t                   type;      /**< Field type, see @ref ser_field_type_t. */
+    uint8_t                   offset;    /**< Offset of the field in the structure. */
+    uint8_t                   size;      /**< Size of the field on the wire, 0 for @ref SER_FIELD_TYPE_STRUCT. */
+    ser_struct_desc_t const * p_struct;  /**< Table of a @ref SER_FIELD_TYPE_STRUCT field, else NULL. */
+} ser_field_desc_t;
+
+/**@brief Description of a structure, a table of its fields in the order they are encoded. */
+struct ser_struct_desc_s
+{
+    ser_field_desc_t const * p_fields;   /**< Fields of the structure. */
+    uint8_t                  count;      /**< Number of fields. */
+};
+
+/**@brief Macros for the entries of a field table. */
+#define SER_FIELD_UINT8(STRUCT, MEMBER)  { SER_FIELD_TYPE_UINT8,  offsetof(STRUCT, MEMBER), 1, NULL }
+#define SER_FIELD_UINT16(STRUCT, MEMBER) { SER_FIELD_TYPE_UINT16, offsetof(STRUCT, MEMBER), 2, NULL }
+#define SER_FIELD_UINT32(STRUCT, MEMBER) { SER_FIELD_TYPE_UINT32, offsetof(STRUCT, MEMBER), 4, NULL }
+#define SER_FIELD_BUF(STRUCT, MEMBER)    { SER_FIELD_TYPE_BUF,    offsetof(STRUCT, MEMBER), \
+                                           sizeof(((STRUCT *)0)->MEMBER), NULL }
+#define SER_FIELD_STRUCT(STRUCT, MEMBER, DESC) \
+                                         { SER_FIELD_TYPE_STRUCT, offsetof(STRUCT, MEMBER), 0, &(DESC) }
+
+/**@brief Macro for defining a structure description from a field table. */
+#define SER_STRUCT_DESC(FIELDS) { (FIELDS), sizeof(FIELDS) / sizeof((FIELDS)[0]) }
+
+/**@brief Function for encoding a structure described by a field table.
+ *
+ * The length of the whole structure is checked once, and runs of fields that are laid out
+ * back to back in memory are copied with one memcpy, as the wire format is little endian like the
+ * nRF5 CPU. Structures with bit fields, pointers or variable length data can not be described by a
+ * table and keep their own encoders.
+ *
+ * @param[in]      p_desc           Description of the structure.
+ * @param[in]      p_struct         Structure to encode.
+ * @param[in]      p_buf            Pointer to the beginning of the output buffer.
+ * @param[in]      buf_len          Size of buffer.
+ * @param[in,out]  p_index          \c in: Index to start of the structure in buffer.
+ *                                  \c out: Index in buffer to first byte after the encoded data.
+ *
+ * @retval NRF_SUCCESS              Structure encoded successfully.
+ * @retval NRF_ERROR_INVALID_LENGTH Encoding failure. Incorrect buffer length.
+ */
+uint32_t ser_struct_enc(ser_struct_desc_t const * const p_desc,
+                        void const * const              p_struct,
+                        uint8_t * const                 p_buf,
+                        uint32_t                        buf_len,
+                        uint32_t * const                p_index);
+
+/**@brief Function for decoding a structure described by a field table.
+ *
+ * @param[in]      p_desc           Description of the structure.
+ * @param[in]      p_buf            Pointer to the beginning of the input buffer.
+ * @param[in]      buf_len          Size of buffer.
+ * @param[in,out]  p_index          \c in: Index to start of the structure in buffer.
+ *                                  \c out: Index in buffer to first byte after the decoded data.
+ * @param[out]     p_struct         Decoded structure.
+ *
+ * @retval NRF_SUCCESS              Structure decoded successfully.
+ * @retval NRF_ERROR_INVALID_LENGTH Decoding failure. Incorrect buffer length.
+ */
+uint32_t ser_struct_dec(ser_struct_desc_t const * const p_desc,
+                        uint8_t const * const           p_buf,
+                        uint32_t                        buf_len,
+                        uint32_t * const                p_index,
+                        void * const                    p_struct);
+
 
 #endif
 
@@ -53,6 +53,21 @@
     #define SER_HAL_TRANSPORT_RX_MAX_PKT_SIZE         SER_HAL_TRANSPORT_CONN_TO_APP_MAX_PKT_SIZE
 #endif /* SER_CONNECTIVITY */
 
+/** Number of TX buffers in the HAL Transport layer. With 2, the next packet can be encoded while
+ *  the previous one is transmitted, and it is passed to the PHY layer as soon as the PHY layer
+ *  reports that the previous one has been sent. */
+#ifndef SER_HAL_TRANSPORT_TX_BUF_COUNT
+    #define SER_HAL_TRANSPORT_TX_BUF_COUNT            1
+#endif
+
+/** Number of RX buffers in the HAL Transport layer. The PHY layer can receive into a free buffer
+ *  while the upper layer holds the others. On the application side, more than 1 makes the
+ *  SoftDevice handler queue the received event packets themselves instead of copies of the
+ *  decoded events, and hold up to SER_HAL_TRANSPORT_RX_BUF_COUNT - 1 of them. */
+#ifndef SER_HAL_TRANSPORT_RX_BUF_COUNT
+    #define SER_HAL_TRANSPORT_RX_BUF_COUNT            1
+#endif
+
 
 /***********************************************************************************************//**
  * SER_PHY layer configuration.
@@ -60,6 +75,14 @@
 
 #define SER_PHY_HEADER_SIZE             2
 
+/** Number of reliable packets the HCI PHY can send before waiting for an acknowledgement, 1 to 7.
+ *  Above 1, each TX packet is copied into one of SER_PHY_HCI_WINDOW_SIZE buffers of
+ *  SER_HAL_TRANSPORT_TX_MAX_PKT_SIZE bytes. With HCI_LINK_CONTROL both sides must use the same
+ *  value, as it is exchanged in the CONFIG packets. */
+#ifndef SER_PHY_HCI_WINDOW_SIZE
+#define SER_PHY_HCI_WINDOW_SIZE         1
+#endif
+
 /** Max transfer unit for SPI MASTER and SPI SLAVE. */
 #define SER_PHY_SPI_MTU_SIZE            255
 
@@ -103,6 +126,22 @@
     #define SER_PHY_UART_BAUDRATE_VAL 1000000uL
 #endif /* SER_PHY_UART_BAUDRATE */
 
+/***********************************************************************************************//**
+ * Event encoder configuration.
+ **************************************************************************************************/
+
+/** Set to 1 to make the connectivity chip merge adjacent BLE_EVT_TX_COMPLETE events of a
+ *  connection, and send adjacent BLE_GAP_EVT_ADV_REPORT events in one SER_PKT_TYPE_EVT_BATCH
+ *  packet. The application chip always accepts batch packets. */
+#ifndef SER_EVT_COALESCING
+#define SER_EVT_COALESCING              0
+#endif
+
+/** Maximum number of advertising reports in one batch packet. */
+#ifndef SER_EVT_ADV_REPORT_BATCH_SIZE
+#define SER_EVT_ADV_REPORT_BATCH_SIZE   4
+#endif
+
 /** Configuration timeouts of connectivity MCU */
 #define CONN_CHIP_RESET_TIME            50      /**< The time to keep the reset line to the nRF51822 low (in milliseconds). */
 #define CONN_CHIP_WAKEUP_TIME           500     /**< The time for nRF51822 to reset and become ready to receive serialized commands (in milliseconds). */
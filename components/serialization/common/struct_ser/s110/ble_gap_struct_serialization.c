@@ -16,20 +16,19 @@
 #include "app_util.h"
 #include "string.h"
 
+static const ser_field_desc_t ble_gap_irk_t_fields[] =
+{
+    SER_FIELD_BUF(ble_gap_irk_t, irk)
+};
+
+static const ser_struct_desc_t ble_gap_irk_t_desc = SER_STRUCT_DESC(ble_gap_irk_t_fields);
+
 uint32_t ble_gap_irk_enc(void const * const p_data,
                          uint8_t * const    p_buf,
                          uint32_t           buf_len,
                          uint32_t * const   p_index)
 {
-    ble_gap_irk_t * p_gap_irk = (ble_gap_irk_t *)p_data;
-
-    SER_ASSERT_LENGTH_LEQ(BLE_GAP_SEC_KEY_LEN, buf_len - *p_index);
-
-    memcpy(&p_buf[*p_index], p_gap_irk->irk, BLE_GAP_SEC_KEY_LEN);
-
-    *p_index += BLE_GAP_SEC_KEY_LEN;
-
-    return NRF_SUCCESS;
+    return ser_struct_enc(&ble_gap_irk_t_desc, p_data, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_gap_irk_dec(uint8_t const * const p_buf,
@@ -37,32 +36,23 @@ uint32_t ble_gap_irk_dec(uint8_t const * const p_buf,
                          uint32_t * const      p_index,
                          void * const          p_data)
 {
-    ble_gap_irk_t * p_gap_irk = (ble_gap_irk_t *)p_data;
-
-    SER_ASSERT_LENGTH_LEQ(BLE_GAP_SEC_KEY_LEN, buf_len - *p_index);
-
-    memcpy(p_gap_irk->irk, &p_buf[*p_index], BLE_GAP_SEC_KEY_LEN);
+    return ser_struct_dec(&ble_gap_irk_t_desc, p_buf, buf_len, p_index, p_data);
+}
 
-    *p_index += BLE_GAP_SEC_KEY_LEN;
+static const ser_field_desc_t ble_gap_addr_t_fields[] =
+{
+    SER_FIELD_UINT8(ble_gap_addr_t, addr_type),
+    SER_FIELD_BUF(ble_gap_addr_t, addr)
+};
 
-    return NRF_SUCCESS;
-}
+static const ser_struct_desc_t ble_gap_addr_t_desc = SER_STRUCT_DESC(ble_gap_addr_t_fields);
 
 uint32_t ble_gap_addr_enc(void const * const p_data,
                           uint8_t * const    p_buf,
                           uint32_t           buf_len,
                           uint32_t * const   p_index)
 {
-    ble_gap_addr_t * p_addr = (ble_gap_addr_t *)p_data;
-
-    SER_ASSERT_LENGTH_LEQ(1 + BLE_GAP_ADDR_LEN, buf_len - *p_index);
-
-    p_buf[*p_index] = p_addr->addr_type;
-    (*p_index)++;
-    memcpy(&p_buf[*p_index], p_addr->addr, BLE_GAP_ADDR_LEN);
-    *p_index += BLE_GAP_ADDR_LEN;
-
-    return NRF_SUCCESS;
+    return ser_struct_enc(&ble_gap_addr_t_desc, p_data, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_gap_addr_dec(uint8_t const * const p_buf,
@@ -70,13 +60,7 @@ uint32_t ble_gap_addr_dec(uint8_t const * const p_buf,
                           uint32_t * const      p_index,
                           void * const          p_addr)
 {
-    ble_gap_addr_t * p_address = (ble_gap_addr_t *) p_addr;
-
-    SER_ASSERT_LENGTH_LEQ(sizeof (ble_gap_addr_t), buf_len - *p_index);
-    memcpy(p_address, &p_buf[*p_index], sizeof (ble_gap_addr_t));
-    *p_index += sizeof (ble_gap_addr_t);
-
-    return NRF_SUCCESS;
+    return ser_struct_dec(&ble_gap_addr_t_desc, p_buf, buf_len, p_index, p_addr);
 }
 
 uint32_t ble_gap_sec_levels_enc(void const * const p_data,
@@ -591,27 +575,22 @@ uint32_t ble_gap_evt_conn_param_update_request_t_dec(uint8_t const * const p_buf
     return ble_gap_conn_params_t_dec(p_buf, buf_len, p_index, p_void_evt_conn_param_update_request);
 }
 
+static const ser_field_desc_t ble_gap_conn_params_t_fields[] =
+{
+    SER_FIELD_UINT16(ble_gap_conn_params_t, min_conn_interval),
+    SER_FIELD_UINT16(ble_gap_conn_params_t, max_conn_interval),
+    SER_FIELD_UINT16(ble_gap_conn_params_t, slave_latency),
+    SER_FIELD_UINT16(ble_gap_conn_params_t, conn_sup_timeout)
+};
+
+static const ser_struct_desc_t ble_gap_conn_params_t_desc = SER_STRUCT_DESC(ble_gap_conn_params_t_fields);
+
 uint32_t ble_gap_conn_params_t_enc(void const * const p_void_conn_params,
                                    uint8_t * const    p_buf,
                                    uint32_t           buf_len,
                                    uint32_t * const   p_index)
 {
-    ble_gap_conn_params_t * p_conn_params = (ble_gap_conn_params_t *)p_void_conn_params;
-    uint32_t                err_code      = NRF_SUCCESS;
-
-    err_code = uint16_t_enc(&p_conn_params->min_conn_interval, p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    err_code = uint16_t_enc(&p_conn_params->max_conn_interval, p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    err_code = uint16_t_enc(&p_conn_params->slave_latency, p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    err_code = uint16_t_enc(&p_conn_params->conn_sup_timeout, p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    return err_code;
+    return ser_struct_enc(&ble_gap_conn_params_t_desc, p_void_conn_params, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_gap_conn_params_t_dec(uint8_t const * const p_buf,
@@ -619,35 +598,22 @@ uint32_t ble_gap_conn_params_t_dec(uint8_t const * const p_buf,
                                    uint32_t * const      p_index,
                                    void * const          p_void_conn_params)
 {
-    ble_gap_conn_params_t * p_conn_params = (ble_gap_conn_params_t *)p_void_conn_params;
-
-    SER_ASSERT_LENGTH_LEQ(*p_index + 2, buf_len);
-    uint16_dec(p_buf, buf_len, p_index, &p_conn_params->min_conn_interval);
-
-    SER_ASSERT_LENGTH_LEQ(*p_index + 2, buf_len);
-    uint16_dec(p_buf, buf_len, p_index, &p_conn_params->max_conn_interval);
-
-    SER_ASSERT_LENGTH_LEQ(*p_index + 2, buf_len);
-    uint16_dec(p_buf, buf_len, p_index, &p_conn_params->slave_latency);
+    return ser_struct_dec(&ble_gap_conn_params_t_desc, p_buf, buf_len, p_index, p_void_conn_params);
+}
 
-    SER_ASSERT_LENGTH_LEQ(*p_index + 2, buf_len);
-    uint16_dec(p_buf, buf_len, p_index, &p_conn_params->conn_sup_timeout);
+static const ser_field_desc_t ble_gap_evt_disconnected_t_fields[] =
+{
+    SER_FIELD_UINT8(ble_gap_evt_disconnected_t, reason)
+};
 
-    return NRF_SUCCESS;
-}
+static const ser_struct_desc_t ble_gap_evt_disconnected_t_desc = SER_STRUCT_DESC(ble_gap_evt_disconnected_t_fields);
 
 uint32_t ble_gap_evt_disconnected_t_enc(void const * const p_void_disconnected,
                                         uint8_t * const    p_buf,
                                         uint32_t           buf_len,
                                         uint32_t * const   p_index)
 {
-    ble_gap_evt_disconnected_t * p_disconnected = (ble_gap_evt_disconnected_t *)p_void_disconnected;
-    uint32_t                     err_code       = NRF_SUCCESS;
-
-    err_code = uint8_t_enc(&p_disconnected->reason, p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    return err_code;
+    return ser_struct_enc(&ble_gap_evt_disconnected_t_desc, p_void_disconnected, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_gap_evt_disconnected_t_dec(uint8_t const * const p_buf,
@@ -655,35 +621,23 @@ uint32_t ble_gap_evt_disconnected_t_dec(uint8_t const * const p_buf,
                                         uint32_t * const      p_index,
                                         void * const          p_void_disconnected)
 {
-    ble_gap_evt_disconnected_t * p_disconnected = (ble_gap_evt_disconnected_t *)p_void_disconnected;
-    uint32_t                     err_code       = NRF_SUCCESS;
+    return ser_struct_dec(&ble_gap_evt_disconnected_t_desc, p_buf, buf_len, p_index, p_void_disconnected);
+}
 
-    SER_ASSERT_LENGTH_LEQ(1, buf_len - *p_index);
-    uint8_dec(p_buf, buf_len, p_index, &p_disconnected->reason);
+static const ser_field_desc_t ble_gap_opt_ch_map_t_fields[] =
+{
+    SER_FIELD_UINT16(ble_gap_opt_ch_map_t, conn_handle),
+    SER_FIELD_BUF(ble_gap_opt_ch_map_t, ch_map)
+};
 
-    return err_code;
-}
+static const ser_struct_desc_t ble_gap_opt_ch_map_t_desc = SER_STRUCT_DESC(ble_gap_opt_ch_map_t_fields);
 
 uint32_t ble_gap_opt_ch_map_t_enc(void const * const p_data,
                                   uint8_t * const    p_buf,
                                   uint32_t           buf_len,
                                   uint32_t * const   p_index)
 {
-    SER_ASSERT_NOT_NULL(p_buf);
-    SER_ASSERT_NOT_NULL(p_index);
-    
-    ble_gap_opt_ch_map_t * p_gap_opt_ch_map = (ble_gap_opt_ch_map_t *)p_data;
-    uint32_t err_code = NRF_SUCCESS;
-    
-    err_code = uint16_t_enc(&p_gap_opt_ch_map->conn_handle, p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    SER_ASSERT_LENGTH_LEQ(5, buf_len - *p_index);
-    memcpy(&p_buf[*p_index], p_gap_opt_ch_map->ch_map, 5);
-
-    *p_index += 5;
-
-    return err_code;
+    return ser_struct_enc(&ble_gap_opt_ch_map_t_desc, p_data, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_gap_opt_ch_map_t_dec(uint8_t const * const p_buf,
@@ -691,21 +645,7 @@ uint32_t ble_gap_opt_ch_map_t_dec(uint8_t const * const p_buf,
                                   uint32_t * const      p_index,
                                   void * const          p_data)
 {
-    SER_ASSERT_NOT_NULL(p_buf);
-    SER_ASSERT_NOT_NULL(p_index);
-    
-    ble_gap_opt_ch_map_t * p_gap_opt_ch_map = (ble_gap_opt_ch_map_t *)p_data;
-    uint32_t err_code = NRF_SUCCESS;
-    
-    err_code = uint16_t_dec(p_buf, buf_len, p_index, &p_gap_opt_ch_map->conn_handle);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-    
-    SER_ASSERT_LENGTH_LEQ(5, buf_len - *p_index);
-    memcpy(p_gap_opt_ch_map->ch_map, &p_buf[*p_index], 5);
-
-    *p_index += 5;
-
-    return err_code;
+    return ser_struct_dec(&ble_gap_opt_ch_map_t_desc, p_buf, buf_len, p_index, p_data);
 }
 
 uint32_t ble_gap_opt_local_conn_latency_t_enc(void const * const p_void_local_conn_latency,
@@ -951,21 +891,20 @@ uint32_t ble_gap_sec_kdist_t_dec(uint8_t const * const p_buf,
     return err_code;
 }
 
+static const ser_field_desc_t ble_gap_master_id_t_fields[] =
+{
+    SER_FIELD_UINT16(ble_gap_master_id_t, ediv),
+    SER_FIELD_BUF(ble_gap_master_id_t, rand)
+};
+
+static const ser_struct_desc_t ble_gap_master_id_t_desc = SER_STRUCT_DESC(ble_gap_master_id_t_fields);
+
 uint32_t ble_gap_master_id_t_enc(void const * const p_master_idx,
                                  uint8_t * const    p_buf,
                                  uint32_t           buf_len,
                                  uint32_t * const   p_index)
 {
-    ble_gap_master_id_t * p_master_id = (ble_gap_master_id_t *) p_master_idx;
-    uint32_t err_code = NRF_SUCCESS;
-
-    err_code = uint16_t_enc(&(p_master_id->ediv), p_buf, buf_len, p_index);
-
-    SER_ASSERT_LENGTH_LEQ(BLE_GAP_SEC_RAND_LEN, buf_len - *p_index);
-    memcpy(&p_buf[*p_index], p_master_id->rand, BLE_GAP_SEC_RAND_LEN);
-    *p_index += BLE_GAP_SEC_RAND_LEN;
-
-    return err_code;
+    return ser_struct_enc(&ble_gap_master_id_t_desc, p_master_idx, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_gap_master_id_t_dec(uint8_t const * const p_buf,
@@ -973,18 +912,7 @@ uint32_t ble_gap_master_id_t_dec(uint8_t const * const p_buf,
                                uint32_t      * const p_index,
                                void          * const p_master_idx)
 {
-    ble_gap_master_id_t *p_master_id = (ble_gap_master_id_t *)p_master_idx;
-
-    uint32_t err_code = NRF_SUCCESS;
-
-    err_code = uint16_t_dec(p_buf, buf_len, p_index, &(p_master_id->ediv));
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    SER_ASSERT_LENGTH_LEQ(BLE_GAP_SEC_RAND_LEN, buf_len - *p_index);
-    memcpy(p_master_id->rand, &p_buf[*p_index], BLE_GAP_SEC_RAND_LEN);
-    *p_index += BLE_GAP_SEC_RAND_LEN;
-
-    return err_code;
+    return ser_struct_dec(&ble_gap_master_id_t_desc, p_buf, buf_len, p_index, p_master_idx);
 }
 
 uint32_t ble_gap_enc_info_enc(void const * const p_data,
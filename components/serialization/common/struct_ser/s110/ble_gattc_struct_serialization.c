@@ -151,21 +151,20 @@ uint32_t ble_gattc_evt_char_vals_read_rsp_t_dec(uint8_t const * const p_buf,
     return error_code;
 }
 
+static const ser_field_desc_t ble_gattc_handle_range_t_fields[] =
+{
+    SER_FIELD_UINT16(ble_gattc_handle_range_t, start_handle),
+    SER_FIELD_UINT16(ble_gattc_handle_range_t, end_handle)
+};
+
+static const ser_struct_desc_t ble_gattc_handle_range_t_desc = SER_STRUCT_DESC(ble_gattc_handle_range_t_fields);
+
 uint32_t ble_gattc_handle_range_t_enc(void const * const p_void_struct,
                                       uint8_t * const    p_buf,
                                       uint32_t           buf_len,
                                       uint32_t * const   p_index)
 {
-    ble_gattc_handle_range_t * p_range  = (ble_gattc_handle_range_t *) p_void_struct;
-    uint32_t                   err_code = NRF_SUCCESS;
-
-    err_code = uint16_t_enc(&(p_range->start_handle), p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    err_code = uint16_t_enc(&(p_range->end_handle), p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    return err_code;
+    return ser_struct_enc(&ble_gattc_handle_range_t_desc, p_void_struct, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_gattc_handle_range_t_dec(uint8_t const * const p_buf,
@@ -173,31 +172,25 @@ uint32_t ble_gattc_handle_range_t_dec(uint8_t const * const p_buf,
                                       uint32_t * const      p_index,
                                       void * const          p_void_struct)
 {
-    ble_gattc_handle_range_t * p_range  = (ble_gattc_handle_range_t *) p_void_struct;
-    uint32_t                   err_code = NRF_SUCCESS;
+    return ser_struct_dec(&ble_gattc_handle_range_t_desc, p_buf, buf_len, p_index, p_void_struct);
+}
 
-    SER_ASSERT_LENGTH_LEQ(4, buf_len - *p_index);
-    uint16_dec(p_buf, buf_len, p_index, &(p_range->start_handle));
-    uint16_dec(p_buf, buf_len, p_index, &(p_range->end_handle));
 
-    return err_code;
-}
+static const ser_field_desc_t ble_gattc_service_t_fields[] =
+{
+    SER_FIELD_UINT16(ble_gattc_service_t, uuid.uuid),
+    SER_FIELD_UINT8(ble_gattc_service_t, uuid.type),
+    SER_FIELD_STRUCT(ble_gattc_service_t, handle_range, ble_gattc_handle_range_t_desc)
+};
 
+static const ser_struct_desc_t ble_gattc_service_t_desc = SER_STRUCT_DESC(ble_gattc_service_t_fields);
 
 uint32_t ble_gattc_service_t_enc(void const * const p_void_struct,
                                  uint8_t * const    p_buf,
                                  uint32_t           buf_len,
                                  uint32_t * const   p_index)
 {
-    uint32_t              error_code = NRF_SUCCESS;
-    ble_gattc_service_t * p_service  = (ble_gattc_service_t *) p_void_struct;
-
-    error_code = ble_uuid_t_enc(&(p_service->uuid), p_buf, buf_len, p_index);
-    SER_ASSERT(error_code == NRF_SUCCESS, error_code);
-    error_code = ble_gattc_handle_range_t_enc(&(p_service->handle_range), p_buf, buf_len, p_index);
-    SER_ASSERT(error_code == NRF_SUCCESS, error_code);
-
-    return error_code;
+    return ser_struct_enc(&ble_gattc_service_t_desc, p_void_struct, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_gattc_service_t_dec(uint8_t const * const p_buf,
@@ -205,31 +198,23 @@ uint32_t ble_gattc_service_t_dec(uint8_t const * const p_buf,
                                  uint32_t * const      p_index,
                                  void * const          p_void_struct)
 {
-    uint32_t              error_code = NRF_SUCCESS;
-    ble_gattc_service_t * p_service  = (ble_gattc_service_t *) p_void_struct;
+    return ser_struct_dec(&ble_gattc_service_t_desc, p_buf, buf_len, p_index, p_void_struct);
+}
 
-    error_code = ble_uuid_t_dec(p_buf, buf_len, p_index, &(p_service->uuid));
-    SER_ASSERT(error_code == NRF_SUCCESS, error_code);
-    error_code = ble_gattc_handle_range_t_dec(p_buf, buf_len, p_index, &(p_service->handle_range));
-    SER_ASSERT(error_code == NRF_SUCCESS, error_code);
+static const ser_field_desc_t ble_gattc_include_t_fields[] =
+{
+    SER_FIELD_UINT16(ble_gattc_include_t, handle),
+    SER_FIELD_STRUCT(ble_gattc_include_t, included_srvc, ble_gattc_service_t_desc)
+};
 
-    return error_code;
-}
+static const ser_struct_desc_t ble_gattc_include_t_desc = SER_STRUCT_DESC(ble_gattc_include_t_fields);
 
 uint32_t ble_gattc_include_t_enc(void const * const p_void_struct,
                                  uint8_t * const    p_buf,
                                  uint32_t           buf_len,
                                  uint32_t * const   p_index)
 {
-    uint32_t              error_code = NRF_SUCCESS;
-    ble_gattc_include_t * p_include  = (ble_gattc_include_t *) p_void_struct;
-
-    error_code = uint16_t_enc(&(p_include->handle), p_buf, buf_len, p_index);
-    SER_ASSERT(error_code == NRF_SUCCESS, error_code);
-    error_code = ble_gattc_service_t_enc(&(p_include->included_srvc), p_buf, buf_len, p_index);
-    SER_ASSERT(error_code == NRF_SUCCESS, error_code);
-
-    return error_code;
+    return ser_struct_enc(&ble_gattc_include_t_desc, p_void_struct, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_gattc_include_t_dec(uint8_t const * const p_buf,
@@ -237,15 +222,7 @@ uint32_t ble_gattc_include_t_dec(uint8_t const * const p_buf,
                                  uint32_t * const      p_index,
                                  void * const          p_void_struct)
 {
-    uint32_t              error_code = NRF_SUCCESS;
-    ble_gattc_include_t * p_include  = (ble_gattc_include_t *) p_void_struct;
-
-    error_code = uint16_t_dec(p_buf, buf_len, p_index, &(p_include->handle));
-    SER_ASSERT(error_code == NRF_SUCCESS, error_code);
-    error_code = ble_gattc_service_t_dec(p_buf, buf_len, p_index, &(p_include->included_srvc));
-    SER_ASSERT(error_code == NRF_SUCCESS, error_code);
-
-    return error_code;
+    return ser_struct_dec(&ble_gattc_include_t_desc, p_buf, buf_len, p_index, p_void_struct);
 }
 
 uint32_t ble_gattc_evt_rel_disc_rsp_t_enc(void const * const p_void_struct,
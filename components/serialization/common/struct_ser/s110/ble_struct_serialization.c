@@ -20,21 +20,20 @@
 #include <string.h>
 
 
+static const ser_field_desc_t ble_uuid_t_fields[] =
+{
+    SER_FIELD_UINT16(ble_uuid_t, uuid),
+    SER_FIELD_UINT8(ble_uuid_t, type)
+};
+
+static const ser_struct_desc_t ble_uuid_t_desc = SER_STRUCT_DESC(ble_uuid_t_fields);
+
 uint32_t ble_uuid_t_enc(void const * const p_void_uuid,
                         uint8_t * const    p_buf,
                         uint32_t           buf_len,
                         uint32_t * const   p_index)
 {
-    ble_uuid_t * p_uuid   = (ble_uuid_t *)p_void_uuid;
-    uint32_t     err_code = NRF_SUCCESS;
-
-    err_code = uint16_t_enc(&p_uuid->uuid, p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    err_code = uint8_t_enc(&p_uuid->type, p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    return err_code;
+    return ser_struct_enc(&ble_uuid_t_desc, p_void_uuid, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_uuid_t_dec(uint8_t const * const p_buf,
@@ -42,30 +41,22 @@ uint32_t ble_uuid_t_dec(uint8_t const * const p_buf,
                         uint32_t * const      p_index,
                         void * const          p_void_uuid)
 {
-    ble_uuid_t * p_uuid = (ble_uuid_t *)p_void_uuid;
+    return ser_struct_dec(&ble_uuid_t_desc, p_buf, buf_len, p_index, p_void_uuid);
+}
 
-    SER_ASSERT_LENGTH_LEQ(3, buf_len - *p_index);
-    uint16_dec(p_buf, buf_len, p_index, &p_uuid->uuid);
-    uint8_dec(p_buf, buf_len, p_index, &p_uuid->type);
+static const ser_field_desc_t ble_uuid128_t_fields[] =
+{
+    SER_FIELD_BUF(ble_uuid128_t, uuid128)
+};
 
-    return NRF_SUCCESS;
-}
+static const ser_struct_desc_t ble_uuid128_t_desc = SER_STRUCT_DESC(ble_uuid128_t_fields);
 
 uint32_t ble_uuid128_t_enc(void const * const p_void_uuid,
                            uint8_t * const    p_buf,
                            uint32_t           buf_len,
                            uint32_t * const   p_index)
 {
-    ble_uuid128_t * p_uuid   = (ble_uuid128_t *)p_void_uuid;
-    uint32_t        err_code = NRF_SUCCESS;
-
-    SER_ASSERT_LENGTH_LEQ(16, buf_len - *p_index);
-
-    memcpy(&p_buf[*p_index], p_uuid->uuid128, sizeof (p_uuid->uuid128));
-
-    *p_index += sizeof (p_uuid->uuid128);
-
-    return err_code;
+    return ser_struct_enc(&ble_uuid128_t_desc, p_void_uuid, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_uuid128_t_dec(uint8_t const * const p_buf,
@@ -73,37 +64,23 @@ uint32_t ble_uuid128_t_dec(uint8_t const * const p_buf,
                            uint32_t * const      p_index,
                            void * const          p_void_uuid)
 {
-    ble_uuid128_t * p_uuid   = (ble_uuid128_t *)p_void_uuid;
-    uint32_t        err_code = NRF_SUCCESS;
-
-    SER_ASSERT_LENGTH_LEQ(16, buf_len - *p_index);
-
-    memcpy(p_uuid->uuid128, &p_buf[*p_index], sizeof (p_uuid->uuid128));
+    return ser_struct_dec(&ble_uuid128_t_desc, p_buf, buf_len, p_index, p_void_uuid);
+}
 
-    *p_index += sizeof (p_uuid->uuid128);
+static const ser_field_desc_t ble_l2cap_header_t_fields[] =
+{
+    SER_FIELD_UINT16(ble_l2cap_header_t, len),
+    SER_FIELD_UINT16(ble_l2cap_header_t, cid)
+};
 
-    return err_code;
-}
+static const ser_struct_desc_t ble_l2cap_header_t_desc = SER_STRUCT_DESC(ble_l2cap_header_t_fields);
 
 uint32_t ble_l2cap_header_t_enc(void const * const p_void_header,
                                 uint8_t * const    p_buf,
                                 uint32_t           buf_len,
                                 uint32_t * const   p_index)
 {
-    SER_ASSERT_NOT_NULL(p_buf);
-    SER_ASSERT_NOT_NULL(p_index);
-    SER_ASSERT_NOT_NULL(p_void_header);
-
-    ble_l2cap_header_t * p_header = (ble_l2cap_header_t *)p_void_header;
-    uint32_t             err_code = NRF_SUCCESS;
-
-    err_code = uint16_t_enc(&(p_header->len), p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    err_code = uint16_t_enc(&(p_header->cid), p_buf, buf_len, p_index);
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    return err_code;
+    return ser_struct_enc(&ble_l2cap_header_t_desc, p_void_header, p_buf, buf_len, p_index);
 }
 
 uint32_t ble_l2cap_header_t_dec(uint8_t const * const p_buf,
@@ -111,20 +88,7 @@ uint32_t ble_l2cap_header_t_dec(uint8_t const * const p_buf,
                                 uint32_t * const      p_index,
                                 void * const          p_void_header)
 {
-    SER_ASSERT_NOT_NULL(p_buf);
-    SER_ASSERT_NOT_NULL(p_index);
-    SER_ASSERT_NOT_NULL(p_void_header);
-
-    ble_l2cap_header_t * p_header = (ble_l2cap_header_t *)p_void_header;
-    uint32_t             err_code = NRF_SUCCESS;
-
-    err_code = uint16_t_dec(p_buf, buf_len, p_index, &(p_header->len));
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    err_code = uint16_t_dec(p_buf, buf_len, p_index, &(p_header->cid));
-    SER_ASSERT(err_code == NRF_SUCCESS, err_code);
-
-    return err_code;
+    return ser_struct_dec(&ble_l2cap_header_t_desc, p_buf, buf_len, p_index, p_void_header);
 }
 
 uint32_t ble_l2cap_evt_rx_t_enc(void const * const p_void_evt_rx,
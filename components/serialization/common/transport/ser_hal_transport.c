@@ -13,6 +13,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include "app_error.h"
+#include "app_util_platform.h"
 #include "ser_config.h"
 #include "ser_phy.h"
 #include "ser_hal_transport.h"
@@ -40,28 +41,53 @@ typedef enum
     HAL_TRANSP_TX_STATE_CLOSED = 0,
     HAL_TRANSP_TX_STATE_IDLE,
     HAL_TRANSP_TX_STATE_TX_ALLOCATED,
+    HAL_TRANSP_TX_STATE_QUEUED,
     HAL_TRANSP_TX_STATE_TRANSMITTING,
     HAL_TRANSP_TX_STATE_TRANSMITTED,
     HAL_TRANSP_TX_STATE_MAX
 }ser_hal_transp_tx_states_t;
 
 /**
- * @brief RX state.
+ * @brief RX state. The RECEIVED states mean that the upper layer holds every reception buffer.
  */
 static ser_hal_transp_rx_states_t m_rx_state = HAL_TRANSP_RX_STATE_CLOSED;
 /**
- * @brief TX state.
+ * @brief TX state of each transmission buffer.
  */
-static ser_hal_transp_tx_states_t m_tx_state = HAL_TRANSP_TX_STATE_CLOSED;
+static ser_hal_transp_tx_states_t m_tx_state[SER_HAL_TRANSPORT_TX_BUF_COUNT];
 
 /**
- * @brief Transmission buffer.
+ * @brief Transmission buffers.
  */
-static uint8_t m_tx_buffer[SER_HAL_TRANSPORT_TX_MAX_PKT_SIZE];
+static uint8_t m_tx_buffer[SER_HAL_TRANSPORT_TX_BUF_COUNT][SER_HAL_TRANSPORT_TX_MAX_PKT_SIZE];
+
+/**
+ * @brief Length of the packet in each transmission buffer waiting in the queue.
+ */
+static uint16_t m_tx_length[SER_HAL_TRANSPORT_TX_BUF_COUNT];
+
+/**
+ * @brief Indexes of the buffers sent by the upper layer, in sending order. The first one is being
+ *        transmitted by the PHY layer.
+ */
+static uint8_t m_tx_queue[SER_HAL_TRANSPORT_TX_BUF_COUNT];
+static uint8_t m_tx_queue_head  = 0;
+static uint8_t m_tx_queue_count = 0;
+
+/**
+ * @brief Link statistics.
+ */
+static ser_hal_transport_stats_t m_stats;
+/**
+ * @brief Reception buffers.
+ */
+static uint8_t m_rx_buffer[SER_HAL_TRANSPORT_RX_BUF_COUNT][SER_HAL_TRANSPORT_RX_MAX_PKT_SIZE];
+
 /**
- * @brief Reception buffer.
+ * @brief Reception buffers held by the upper layer, and the one the PHY layer is receiving into.
  */
-static uint8_t m_rx_buffer[SER_HAL_TRANSPORT_RX_MAX_PKT_SIZE];
+static bool    m_rx_held[SER_HAL_TRANSPORT_RX_BUF_COUNT];
+static uint8_t m_rx_index = 0;
 
 /**
  * @brief Callback function handler for Serialization HAL Transport layer events.
@@ -69,6 +95,75 @@ static uint8_t m_rx_buffer[SER_HAL_TRANSPORT_RX_MAX_PKT_SIZE];
 static ser_hal_transport_events_handler_t m_events_handler = NULL;
 
 
+/**
+ * @brief Function for getting the index of a transmission buffer.
+ *
+ * @return Index of the buffer, or SER_HAL_TRANSPORT_TX_BUF_COUNT if p_buffer is not the start of
+ *         one.
+ */
+static uint32_t tx_buf_index(const uint8_t * p_buffer)
+{
+    uint32_t i;
+
+    for (i = 0; i < SER_HAL_TRANSPORT_TX_BUF_COUNT; i++)
+    {
+        if (p_buffer == m_tx_buffer[i])
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/**
+ * @brief Function for getting the index of a reception buffer the upper layer does not hold.
+ *
+ * @return Index of the buffer, or SER_HAL_TRANSPORT_RX_BUF_COUNT if all are held.
+ */
+static uint32_t rx_buf_free_index(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < SER_HAL_TRANSPORT_RX_BUF_COUNT; i++)
+    {
+        if (!m_rx_held[i])
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/**
+ * @brief Function for releasing all reception buffers.
+ */
+static void rx_held_clear_all(void)
+{
+    for (uint32_t i = 0; i < SER_HAL_TRANSPORT_RX_BUF_COUNT; i++)
+    {
+        m_rx_held[i] = false;
+    }
+}
+
+
+/**
+ * @brief Function for setting the state of all transmission buffers.
+ */
+static void tx_state_set_all(ser_hal_transp_tx_states_t state)
+{
+    for (uint32_t i = 0; i < SER_HAL_TRANSPORT_TX_BUF_COUNT; i++)
+    {
+        m_tx_state[i] = state;
+    }
+    m_tx_queue_head  = 0;
+    m_tx_queue_count = 0;
+}
+
+
 /**
  * @brief A callback function to be used to handle a PHY module events. This function is called in
  *        an interrupt context.
@@ -85,11 +180,29 @@ static void phy_events_handler(ser_phy_evt_t phy_event)
     {
         case SER_PHY_EVT_TX_PKT_SENT:
         {
-            if (HAL_TRANSP_TX_STATE_TRANSMITTING == m_tx_state)
+            uint32_t index = m_tx_queue[m_tx_queue_head];
+
+            if ((m_tx_queue_count != 0) && (HAL_TRANSP_TX_STATE_TRANSMITTING == m_tx_state[index]))
             {
-                m_tx_state = HAL_TRANSP_TX_STATE_TRANSMITTED;
-                err_code   = ser_hal_transport_tx_pkt_free(m_tx_buffer);
+                m_stats.tx_pkt_count++;
+                m_stats.tx_byte_count += m_tx_length[index];
+
+                m_tx_queue_head = (m_tx_queue_head + 1) % SER_HAL_TRANSPORT_TX_BUF_COUNT;
+                m_tx_queue_count--;
+                m_tx_state[index] = HAL_TRANSP_TX_STATE_TRANSMITTED;
+                err_code          = ser_hal_transport_tx_pkt_free(m_tx_buffer[index]);
                 APP_ERROR_CHECK(err_code);
+
+                /* Pass the next packet to the PHY layer before the upper layer is notified, so
+                 * the link does not wait for the event handler. */
+                if (m_tx_queue_count != 0)
+                {
+                    index             = m_tx_queue[m_tx_queue_head];
+                    m_tx_state[index] = HAL_TRANSP_TX_STATE_TRANSMITTING;
+                    err_code          = ser_phy_tx_pkt_send(m_tx_buffer[index], m_tx_length[index]);
+                    APP_ERROR_CHECK(err_code);
+                }
+
                 /* An event to an upper layer that a packet has been transmitted. */
                 hal_transp_event.evt_type = SER_HAL_TRANSP_EVT_TX_PKT_SENT;
                 m_events_handler(hal_transp_event);
@@ -108,12 +221,13 @@ static void phy_events_handler(ser_phy_evt_t phy_event)
             hal_transp_event.evt_type = SER_HAL_TRANSP_EVT_RX_PKT_RECEIVING;
 
             /* Receive or drop a packet. */
-            if (phy_event.evt_params.rx_buf_request.num_of_bytes <= sizeof (m_rx_buffer))
+            if (phy_event.evt_params.rx_buf_request.num_of_bytes <= sizeof (m_rx_buffer[0]))
             {
                 if (HAL_TRANSP_RX_STATE_IDLE == m_rx_state)
                 {
                     m_events_handler(hal_transp_event);
-                    err_code = ser_phy_rx_buf_set(m_rx_buffer);
+                    m_rx_index = rx_buf_free_index();
+                    err_code   = ser_phy_rx_buf_set(m_rx_buffer[m_rx_index]);
                     APP_ERROR_CHECK(err_code);
                     m_rx_state = HAL_TRANSP_RX_STATE_RECEIVING;
                 }
@@ -160,7 +274,15 @@ static void phy_events_handler(ser_phy_evt_t phy_event)
         {
             if (HAL_TRANSP_RX_STATE_RECEIVING == m_rx_state)
             {
-                m_rx_state = HAL_TRANSP_RX_STATE_RECEIVED;
+                m_stats.rx_pkt_count++;
+                m_stats.rx_byte_count += phy_event.evt_params.rx_pkt_received.num_of_bytes;
+
+                /* The state is set before the upper layer is notified, as it may free the buffer
+                 * from the event handler. */
+                m_rx_held[m_rx_index] = true;
+                m_rx_state            = (rx_buf_free_index() < SER_HAL_TRANSPORT_RX_BUF_COUNT)
+                                        ? HAL_TRANSP_RX_STATE_IDLE
+                                        : HAL_TRANSP_RX_STATE_RECEIVED;
                 /* Generate the event to an upper layer. */
                 hal_transp_event.evt_type =
                     SER_HAL_TRANSP_EVT_RX_PKT_RECEIVED;
@@ -180,6 +302,8 @@ static void phy_events_handler(ser_phy_evt_t phy_event)
 
         case SER_PHY_EVT_RX_PKT_DROPPED:
         {
+            m_stats.rx_drop_count++;
+
             if (HAL_TRANSP_RX_STATE_DROPPING == m_rx_state)
             {
                 /* Generate the event to an upper layer. */
@@ -246,7 +370,7 @@ uint32_t ser_hal_transport_open(ser_hal_transport_events_handler_t events_handle
 {
     uint32_t err_code = NRF_SUCCESS;
 
-    if ((HAL_TRANSP_RX_STATE_CLOSED != m_rx_state) || (HAL_TRANSP_TX_STATE_CLOSED != m_tx_state))
+    if ((HAL_TRANSP_RX_STATE_CLOSED != m_rx_state) || (HAL_TRANSP_TX_STATE_CLOSED != m_tx_state[0]))
     {
         err_code = NRF_ERROR_INVALID_STATE;
     }
@@ -260,7 +384,8 @@ uint32_t ser_hal_transport_open(ser_hal_transport_events_handler_t events_handle
          * going to enable interrupts. On success an event from PHY layer can be emitted immediately
          * after return from ser_phy_open(). */
         m_rx_state = HAL_TRANSP_RX_STATE_IDLE;
-        m_tx_state = HAL_TRANSP_TX_STATE_IDLE;
+        rx_held_clear_all();
+        tx_state_set_all(HAL_TRANSP_TX_STATE_IDLE);
 
         m_events_handler = events_handler;
 
@@ -270,7 +395,7 @@ uint32_t ser_hal_transport_open(ser_hal_transport_events_handler_t events_handle
         if (NRF_SUCCESS != err_code)
         {
             m_rx_state       = HAL_TRANSP_RX_STATE_CLOSED;
-            m_tx_state       = HAL_TRANSP_TX_STATE_CLOSED;
+            tx_state_set_all(HAL_TRANSP_TX_STATE_CLOSED);
             m_events_handler = NULL;
 
             if (NRF_ERROR_INVALID_PARAM != err_code)
@@ -289,7 +414,8 @@ void ser_hal_transport_close(void)
     /* Reset generic handler for all events, reset internal states and close PHY module. */
     ser_phy_interrupts_disable();
     m_rx_state = HAL_TRANSP_RX_STATE_CLOSED;
-    m_tx_state = HAL_TRANSP_TX_STATE_CLOSED;
+    rx_held_clear_all();
+    tx_state_set_all(HAL_TRANSP_TX_STATE_CLOSED);
 
     m_events_handler = NULL;
 
@@ -300,28 +426,46 @@ void ser_hal_transport_close(void)
 uint32_t ser_hal_transport_rx_pkt_free(uint8_t * p_buffer)
 {
     uint32_t err_code = NRF_SUCCESS;
+    uint32_t index;
 
     ser_phy_interrupts_disable();
 
+    for (index = 0; index < SER_HAL_TRANSPORT_RX_BUF_COUNT; index++)
+    {
+        if (p_buffer == m_rx_buffer[index])
+        {
+            break;
+        }
+    }
+
     if (NULL == p_buffer)
     {
         err_code = NRF_ERROR_NULL;
     }
-    else if (p_buffer != m_rx_buffer)
+    else if (index == SER_HAL_TRANSPORT_RX_BUF_COUNT)
     {
         err_code = NRF_ERROR_INVALID_ADDR;
     }
+    else if (!m_rx_held[index] || (HAL_TRANSP_RX_STATE_CLOSED == m_rx_state))
+    {
+        /* Upper layer should not call this function in current state. */
+        err_code = NRF_ERROR_INVALID_STATE;
+    }
     else if (HAL_TRANSP_RX_STATE_RECEIVED == m_rx_state)
     {
-        m_rx_state = HAL_TRANSP_RX_STATE_IDLE;
+        m_rx_held[index] = false;
+        m_rx_state       = HAL_TRANSP_RX_STATE_IDLE;
     }
     else if (HAL_TRANSP_RX_STATE_RECEIVED_DROPPING == m_rx_state)
     {
-        m_rx_state = HAL_TRANSP_RX_STATE_DROPPING;
+        m_rx_held[index] = false;
+        m_rx_state       = HAL_TRANSP_RX_STATE_DROPPING;
     }
     else if (HAL_TRANSP_RX_STATE_RECEIVED_PENDING_BUF_REQ == m_rx_state)
     {
-        err_code = ser_phy_rx_buf_set(m_rx_buffer);
+        m_rx_held[index] = false;
+        m_rx_index       = index;
+        err_code         = ser_phy_rx_buf_set(m_rx_buffer[index]);
 
         if (NRF_SUCCESS == err_code)
         {
@@ -334,8 +478,8 @@ uint32_t ser_hal_transport_rx_pkt_free(uint8_t * p_buffer)
     }
     else
     {
-        /* Upper layer should not call this function in current state. */
-        err_code = NRF_ERROR_INVALID_STATE;
+        /* Other buffers are free, so the PHY layer is not waiting for this one. */
+        m_rx_held[index] = false;
     }
     ser_phy_interrupts_enable();
 
@@ -345,25 +489,32 @@ uint32_t ser_hal_transport_rx_pkt_free(uint8_t * p_buffer)
 
 uint32_t ser_hal_transport_tx_pkt_alloc(uint8_t * * pp_memory, uint16_t * p_num_of_bytes)
 {
-    uint32_t err_code = NRF_SUCCESS;
+    uint32_t err_code = NRF_ERROR_NO_MEM;
 
     if ((NULL == pp_memory) || (NULL == p_num_of_bytes))
     {
         err_code = NRF_ERROR_NULL;
     }
-    else if (HAL_TRANSP_TX_STATE_CLOSED == m_tx_state)
+    else if (HAL_TRANSP_TX_STATE_CLOSED == m_tx_state[0])
     {
         err_code = NRF_ERROR_INVALID_STATE;
     }
-    else if (HAL_TRANSP_TX_STATE_IDLE == m_tx_state)
-    {
-        m_tx_state      = HAL_TRANSP_TX_STATE_TX_ALLOCATED;
-        *pp_memory      = &m_tx_buffer[0];
-        *p_num_of_bytes = (uint16_t)sizeof (m_tx_buffer);
-    }
     else
     {
-        err_code = NRF_ERROR_NO_MEM;
+        /* Buffers are freed in the PHY interrupt. */
+        CRITICAL_REGION_ENTER();
+        for (uint32_t i = 0; i < SER_HAL_TRANSPORT_TX_BUF_COUNT; i++)
+        {
+            if (HAL_TRANSP_TX_STATE_IDLE == m_tx_state[i])
+            {
+                m_tx_state[i]   = HAL_TRANSP_TX_STATE_TX_ALLOCATED;
+                *pp_memory      = &m_tx_buffer[i][0];
+                *p_num_of_bytes = (uint16_t)sizeof (m_tx_buffer[i]);
+                err_code        = NRF_SUCCESS;
+                break;
+            }
+        }
+        CRITICAL_REGION_EXIT();
     }
 
     return err_code;
@@ -373,6 +524,7 @@ uint32_t ser_hal_transport_tx_pkt_alloc(uint8_t * * pp_memory, uint16_t * p_num_
 uint32_t ser_hal_transport_tx_pkt_send(const uint8_t * p_buffer, uint16_t num_of_bytes)
 {
     uint32_t err_code = NRF_SUCCESS;
+    uint32_t index    = tx_buf_index(p_buffer);
 
     /* The buffer provided to this function must be allocated through ser_hal_transport_tx_alloc()
      * function - this assures correct state and that correct memory buffer is used. */
@@ -384,29 +536,46 @@ uint32_t ser_hal_transport_tx_pkt_send(const uint8_t * p_buffer, uint16_t num_of
     {
         err_code = NRF_ERROR_INVALID_PARAM;
     }
-    else if (p_buffer != m_tx_buffer)
+    else if (index == SER_HAL_TRANSPORT_TX_BUF_COUNT)
     {
         err_code = NRF_ERROR_INVALID_ADDR;
     }
-    else if (num_of_bytes > sizeof (m_tx_buffer))
+    else if (num_of_bytes > sizeof (m_tx_buffer[index]))
     {
         err_code = NRF_ERROR_DATA_SIZE;
     }
-    else if (HAL_TRANSP_TX_STATE_TX_ALLOCATED == m_tx_state)
+    else if (HAL_TRANSP_TX_STATE_TX_ALLOCATED == m_tx_state[index])
     {
         ser_phy_interrupts_disable();
-        err_code = ser_phy_tx_pkt_send(p_buffer, num_of_bytes);
+        m_tx_length[index] = num_of_bytes;
 
-        if (NRF_SUCCESS == err_code)
+        if (m_tx_queue_count == 0)
         {
-            m_tx_state = HAL_TRANSP_TX_STATE_TRANSMITTING;
+            err_code = ser_phy_tx_pkt_send(p_buffer, num_of_bytes);
+
+            if (NRF_SUCCESS == err_code)
+            {
+                m_tx_state[index] = HAL_TRANSP_TX_STATE_TRANSMITTING;
+            }
+            else
+            {
+                if (NRF_ERROR_BUSY != err_code)
+                {
+                    err_code = NRF_ERROR_INTERNAL;
+                }
+            }
         }
         else
         {
-            if (NRF_ERROR_BUSY != err_code)
-            {
-                err_code = NRF_ERROR_INTERNAL;
-            }
+            /* Passed to the PHY layer when the packets before it have been sent. */
+            m_tx_state[index] = HAL_TRANSP_TX_STATE_QUEUED;
+        }
+
+        if (NRF_SUCCESS == err_code)
+        {
+            m_tx_queue[(m_tx_queue_head + m_tx_queue_count) % SER_HAL_TRANSPORT_TX_BUF_COUNT] =
+                (uint8_t)index;
+            m_tx_queue_count++;
         }
         ser_phy_interrupts_enable();
     }
@@ -422,20 +591,21 @@ uint32_t ser_hal_transport_tx_pkt_send(const uint8_t * p_buffer, uint16_t num_of
 uint32_t ser_hal_transport_tx_pkt_free(uint8_t * p_buffer)
 {
     uint32_t err_code = NRF_SUCCESS;
+    uint32_t index    = tx_buf_index(p_buffer);
 
     if (NULL == p_buffer)
     {
         err_code = NRF_ERROR_NULL;
     }
-    else if (p_buffer != m_tx_buffer)
+    else if (index == SER_HAL_TRANSPORT_TX_BUF_COUNT)
     {
         err_code = NRF_ERROR_INVALID_ADDR;
     }
-    else if ((HAL_TRANSP_TX_STATE_TX_ALLOCATED == m_tx_state) ||
-             (HAL_TRANSP_TX_STATE_TRANSMITTED == m_tx_state))
+    else if ((HAL_TRANSP_TX_STATE_TX_ALLOCATED == m_tx_state[index]) ||
+             (HAL_TRANSP_TX_STATE_TRANSMITTED == m_tx_state[index]))
     {
         /* Release TX buffer for use. */
-        m_tx_state = HAL_TRANSP_TX_STATE_IDLE;
+        m_tx_state[index] = HAL_TRANSP_TX_STATE_IDLE;
     }
     else
     {
@@ -444,3 +614,54 @@ uint32_t ser_hal_transport_tx_pkt_free(uint8_t * p_buffer)
 
     return err_code;
 }
+
+
+uint32_t ser_hal_transport_stats_get(ser_hal_transport_stats_t * p_stats)
+{
+    if (NULL == p_stats)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    ser_phy_interrupts_disable();
+    *p_stats = m_stats;
+    ser_phy_interrupts_enable();
+
+    return NRF_SUCCESS;
+}
+
+
+void ser_hal_transport_stats_reset(void)
+{
+    ser_phy_interrupts_disable();
+    memset(&m_stats, 0, sizeof (m_stats));
+    ser_phy_interrupts_enable();
+}
+
+
+uint32_t ser_hal_transport_throughput_get(ser_hal_transport_stats_t const * p_start,
+                                          ser_hal_transport_stats_t const * p_end,
+                                          uint32_t                          interval_ms,
+                                          ser_hal_transport_throughput_t *  p_throughput)
+{
+    if ((NULL == p_start) || (NULL == p_end) || (NULL == p_throughput))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (0 == interval_ms)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* Counters wrap, so the unsigned differences are right over one wrap. */
+    p_throughput->tx_pkts_per_s  = (uint32_t)(((uint64_t)(p_end->tx_pkt_count - p_start->tx_pkt_count)
+                                               * 1000) / interval_ms);
+    p_throughput->tx_bytes_per_s = (uint32_t)(((uint64_t)(p_end->tx_byte_count - p_start->tx_byte_count)
+                                               * 1000) / interval_ms);
+    p_throughput->rx_pkts_per_s  = (uint32_t)(((uint64_t)(p_end->rx_pkt_count - p_start->rx_pkt_count)
+                                               * 1000) / interval_ms);
+    p_throughput->rx_bytes_per_s = (uint32_t)(((uint64_t)(p_end->rx_byte_count - p_start->rx_byte_count)
+                                               * 1000) / interval_ms);
+
+    return NRF_SUCCESS;
+}
@@ -108,6 +108,29 @@ typedef struct
  */
 typedef void (*ser_hal_transport_events_handler_t)(ser_hal_transport_evt_t event);
 
+
+/**@brief Link statistics of the Serialization HAL Transport layer, counted from
+ *        @ref ser_hal_transport_stats_reset. The counters wrap.
+ */
+typedef struct
+{
+    uint32_t tx_pkt_count;   /**< Packets transmitted. */
+    uint32_t tx_byte_count;  /**< Octets of the packets transmitted, without the PHY header. */
+    uint32_t rx_pkt_count;   /**< Packets received. */
+    uint32_t rx_byte_count;  /**< Octets of the packets received, without the PHY header. */
+    uint32_t rx_drop_count;  /**< Packets dropped because they did not fit the RX buffer. */
+} ser_hal_transport_stats_t;
+
+
+/**@brief Throughput of the link, computed by @ref ser_hal_transport_throughput_get. */
+typedef struct
+{
+    uint32_t tx_pkts_per_s;  /**< Packets transmitted per second. */
+    uint32_t tx_bytes_per_s; /**< Octets transmitted per second. */
+    uint32_t rx_pkts_per_s;  /**< Packets received per second. */
+    uint32_t rx_bytes_per_s; /**< Octets received per second. */
+} ser_hal_transport_throughput_t;
+
                                         
 /**@brief A function for opening and initializing the Serialization HAL Transport layer.
  *
@@ -163,6 +186,9 @@ uint32_t ser_hal_transport_rx_pkt_free(uint8_t * p_buffer);
 
 
 /**@brief A function for allocating a memory for TX packet.
+ *
+ * @note With SER_HAL_TRANSPORT_TX_BUF_COUNT above 1, a buffer can be allocated and sent while
+ *       the packets sent before it are transmitted. Packets are transmitted in sending order.
  * 
  * @param[out] pp_memory       A pointer to pointer to which an address of the beginning of the
  *                             allocated buffer is written.
@@ -227,5 +253,39 @@ uint32_t ser_hal_transport_tx_pkt_send(const uint8_t * p_buffer, uint16_t num_of
 uint32_t ser_hal_transport_tx_pkt_free(uint8_t * p_buffer);
 
 
+/**@brief A function for getting the link statistics.
+ *
+ * @param[out] p_stats    Statistics counted since the last @ref ser_hal_transport_stats_reset.
+ *
+ * @retval NRF_SUCCESS              Operation success.
+ * @retval NRF_ERROR_NULL           Operation failure. NULL pointer supplied.
+ */
+uint32_t ser_hal_transport_stats_get(ser_hal_transport_stats_t * p_stats);
+
+
+/**@brief A function for resetting the link statistics. */
+void ser_hal_transport_stats_reset(void);
+
+
+/**@brief A function for computing the throughput of the link between two statistics snapshots.
+ *
+ * @note To benchmark the PHY layer in use, take a snapshot with @ref ser_hal_transport_stats_get,
+ *       run traffic for a known time, take another snapshot and pass both with the elapsed time.
+ *
+ * @param[in]  p_start        Statistics at the start of the interval.
+ * @param[in]  p_end          Statistics at the end of the interval.
+ * @param[in]  interval_ms    Length of the interval in milliseconds.
+ * @param[out] p_throughput   Packets and octets per second in each direction.
+ *
+ * @retval NRF_SUCCESS              Operation success.
+ * @retval NRF_ERROR_NULL           Operation failure. NULL pointer supplied.
+ * @retval NRF_ERROR_INVALID_PARAM  Operation failure. interval_ms is equal to 0.
+ */
+uint32_t ser_hal_transport_throughput_get(ser_hal_transport_stats_t const * p_start,
+                                          ser_hal_transport_stats_t const * p_end,
+                                          uint32_t                          interval_ms,
+                                          ser_hal_transport_throughput_t *  p_throughput);
+
+
 #endif /* SER_HAL_TRANSPORT_H__ */
 /** @} */
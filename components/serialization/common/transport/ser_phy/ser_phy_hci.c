@@ -58,7 +58,7 @@
 #define HCI_PKT_SYNC_RSP    0x7D02u                                                    /**< Link Control Packet: type SYNC RESPONSE */
 #define HCI_PKT_CONFIG      0xFC03u                                                    /**< Link Control Packet: type CONFIG */
 #define HCI_PKT_CONFIG_RSP  0x7B04u                                                    /**< Link Control Packet: type CONFIG RESPONSE */
-#define HCI_CONFIG_FIELD    0x11u                                                      /**< Configuration field of CONFIG and CONFIG_RSP packet */
+#define HCI_CONFIG_FIELD    (0x10u | SER_PHY_HCI_WINDOW_SIZE)                          /**< Configuration field of CONFIG and CONFIG_RSP packet */
 #define HCI_PKT_SYNC_SIZE   6u                                                         /**< Size of SYNC and SYNC_RSP packet */
 #define HCI_PKT_CONFIG_SIZE 7u                                                         /**< Size of CONFIG and CONFIG_RSP packet */
 #define HCI_LINK_CONTROL_PKT_INVALID 0xFFFFu                                           /**< Size of CONFIG and CONFIG_RSP packet */
@@ -94,11 +94,7 @@
 typedef enum
 {
     HCI_TX_STATE_DISABLE,
-    HCI_TX_STATE_SEND,
-    HCI_TX_STATE_WAIT_FOR_FIRST_TX_END,
-    HCI_TX_STATE_WAIT_FOR_ACK_OR_TX_END,
-    HCI_TX_STATE_WAIT_FOR_ACK,
-    HCI_TX_STATE_WAIT_FOR_TX_END
+    HCI_TX_STATE_SEND
 } hci_tx_fsm_state_t;
 
 typedef enum
@@ -161,6 +157,17 @@ typedef struct
     } evt;
 } hci_evt_t;
 
+/**@brief A packet in the TX window. */
+typedef struct
+{
+    uint8_t * p_payload; /**< Payload of the packet. */
+    uint16_t  length;    /**< Length of the payload. */
+} hci_tx_slot_t;
+
+#if (SER_PHY_HCI_WINDOW_SIZE < 1) || (SER_PHY_HCI_WINDOW_SIZE > 7)
+#error "SER_PHY_HCI_WINDOW_SIZE must be 1 to 7."
+#endif
+
 _static uint8_t m_tx_packet_header[PKT_HDR_SIZE];
 _static uint8_t m_tx_packet_crc[PKT_CRC_SIZE];
 _static uint8_t m_tx_ack_packet[PKT_HDR_SIZE];
@@ -175,6 +182,20 @@ _static uint32_t m_packet_seq_number; // Sequence number counter of the transmit
 
 _static uint32_t m_tx_retry_count;
 
+// Sliding TX window. Packets in the window have consecutive sequence numbers starting at
+// m_packet_seq_number, and are removed when cumulatively acknowledged by the peer.
+_static hci_tx_slot_t m_tx_window[SER_PHY_HCI_WINDOW_SIZE];
+#if (SER_PHY_HCI_WINDOW_SIZE > 1)
+_static uint8_t       m_tx_window_buf[SER_PHY_HCI_WINDOW_SIZE][SER_HAL_TRANSPORT_TX_MAX_PKT_SIZE];
+#endif
+_static uint32_t      m_tx_window_head;     // Slot of the oldest packet in the window
+_static uint32_t      m_tx_window_count;    // Number of packets in the window
+_static uint32_t      m_tx_window_next;     // Offset in the window of the next packet to transmit
+_static uint8_t       m_tx_window_sent_end; // Sequence number following the last packet fully sent
+_static uint8_t       m_tx_in_flight_seq;   // Sequence number of the packet being sent by SLIP
+_static bool          m_tx_slip_busy = false;
+_static bool          m_tx_report_pending = false;
+
 
 // _static uint32_t m_tx_retx_counter = 0;
 // _static uint32_t m_rx_drop_counter = 0;
@@ -420,13 +441,15 @@ static __INLINE uint8_t packet_seq_nmbr_extract(const uint8_t * p_buffer)
 
 
 /**@brief Function for constructing 1st byte of the packet header of the packet to be transmitted.
+ *
+ * @param[in] seq_number Sequence number of the packet.
  *
  * @return 1st byte of the packet header of the packet to be transmitted
  */
-static __INLINE uint8_t tx_packet_byte_zero_construct(void)
+static __INLINE uint8_t tx_packet_byte_zero_construct(uint8_t seq_number)
 {
     const uint32_t value = DATA_INTEGRITY_MASK | RELIABLE_PKT_MASK |
-                           (packet_ack_get() << 3u) | packet_seq_get();
+                           (packet_ack_get() << 3u) | seq_number;
 
     return (uint8_t) value;
 }
@@ -453,48 +476,18 @@ static __INLINE uint8_t header_checksum_calculate(const uint8_t * p_hdr)
 }
 
 
-/**@brief Function for getting the expected ACK number.
- *
- * @return expected ACK number.
- */
-static __INLINE uint8_t expected_ack_number_get(void)
-{
-    uint8_t seq_nmbr = packet_seq_get();
-
-    ++seq_nmbr;
-    seq_nmbr &= 0x07u;
-
-    return seq_nmbr;
-}
-
-
-/**@brief Function for getting the expected ACK number.
- *
- * @return next expected ACK number.
- */
-
-static __INLINE uint8_t next_expected_ack_number_get(void)
-{
-    uint8_t seq_nmbr = expected_ack_number_get();
-
-    ++seq_nmbr;
-    seq_nmbr &= 0x07u;
-
-    return seq_nmbr;
-}
-
-
 /**@brief Function for processing a received acknowledgement packet.
  *
- * Verifies does the received acknowledgement packet has the expected acknowledgement number and
- * that the header checksum is correct.
+ * Verifies that the header checksum is correct and that the acknowledgement number, the sequence
+ * number of the next packet expected by the peer, acknowledges packets that have been sent.
+ * Acknowledgements are cumulative, so one packet may acknowledge several packets of the window.
  *
  * @param[in] p_buffer Pointer to the packet data.
  *
- * @return true if valid acknowledgement packet received.
+ * @return Number of packets acknowledged, 0 if the packet is invalid or acknowledges nothing new.
  */
 
-static bool rx_ack_pkt_valid(const uint8_t * p_buffer)
+static uint32_t rx_ack_pkt_acked_count(const uint8_t * p_buffer)
 {
     // @note: no pointer validation check needed as allready checked by calling function.
 
@@ -504,14 +497,14 @@ static bool rx_ack_pkt_valid(const uint8_t * p_buffer)
 
     if (expected_checksum != 0)
     {
-        return false;
+        return 0;
     }
 
-    const uint8_t ack_number = (p_buffer[0] >> 3u) & 0x07u;
+    const uint8_t  ack_number  = (p_buffer[0] >> 3u) & 0x07u;
+    const uint32_t acked_count = (ack_number - packet_seq_get()) & 0x07u;
+    const uint32_t sent_count  = (m_tx_window_sent_end - packet_seq_get()) & 0x07u;
 
-    // Verify expected acknowledgment number.
-    return ( (ack_number == expected_ack_number_get()) ||
-             (ack_number == next_expected_ack_number_get()) );
+    return (acked_count <= sent_count) ? acked_count : 0;
 }
 
 
@@ -587,8 +580,8 @@ static uint16_t link_control_packet_decode(const uint8_t * p_buffer, uint32_t le
         {
             packet_type = HCI_LINK_CONTROL_PKT_INVALID;
         }
-        // Verify configuration field (0x11):
-        // - Sliding Window Size       == 1,
+        // Verify configuration field (0x10 | SER_PHY_HCI_WINDOW_SIZE):
+        // - Sliding Window Size       == SER_PHY_HCI_WINDOW_SIZE,
         // - OOF Flow Control          == 0,
         // - Data Integrity Check Type == 1,
         // - Version Number            == 0
@@ -817,16 +810,24 @@ static void hci_slip_event_handler(ser_phy_hci_slip_evt_t * p_event)
 }
 
 
-static void hci_pkt_send(void)
+/**@brief Function for handing a packet of the TX window to the SLIP layer.
+ *
+ * @param[in] offset Offset of the packet from the start of the window.
+ */
+static void hci_pkt_send(uint32_t offset)
 {
-    uint32_t err_code;
-
-    m_tx_packet_header[0] = tx_packet_byte_zero_construct();
-    uint16_t type_and_length_fields = ((m_tx_payload_length << 4u) | PKT_TYPE_VENDOR_SPECIFIC);
+    uint32_t              err_code;
+    const hci_tx_slot_t * p_slot = &m_tx_window[(m_tx_window_head + offset) %
+                                                SER_PHY_HCI_WINDOW_SIZE];
+
+    m_tx_in_flight_seq    = (packet_seq_get() + offset) & 0x07u;
+    m_tx_slip_busy        = true;
+    m_tx_packet_header[0] = tx_packet_byte_zero_construct(m_tx_in_flight_seq);
+    uint16_t type_and_length_fields = ((p_slot->length << 4u) | PKT_TYPE_VENDOR_SPECIFIC);
     (void)uint16_encode(type_and_length_fields, &(m_tx_packet_header[1]));
     m_tx_packet_header[3] = header_checksum_calculate(m_tx_packet_header);
     uint16_t crc = crc16_compute(m_tx_packet_header, PKT_HDR_SIZE, NULL);
-    crc = crc16_compute(m_p_tx_payload, m_tx_payload_length, &crc);
+    crc = crc16_compute(p_slot->p_payload, p_slot->length, &crc);
     (void)uint16_encode(crc, m_tx_packet_crc);
 
     ser_phy_hci_pkt_params_t pkt_header;
@@ -835,8 +836,8 @@ static void hci_pkt_send(void)
 
     pkt_header.p_buffer      = m_tx_packet_header;
     pkt_header.num_of_bytes  = PKT_HDR_SIZE;
-    pkt_payload.p_buffer     = m_p_tx_payload;
-    pkt_payload.num_of_bytes = m_tx_payload_length;
+    pkt_payload.p_buffer     = p_slot->p_payload;
+    pkt_payload.num_of_bytes = p_slot->length;
     pkt_crc.p_buffer         = m_tx_packet_crc;
     pkt_crc.num_of_bytes     = PKT_CRC_SIZE;
     DEBUG_EVT_SLIP_PACKET_TX(0);
@@ -899,9 +900,7 @@ static void hci_link_control_pkt_send(void)
 
 static void hci_pkt_sent_upcall(void)
 {
-    m_packet_seq_number++; // incoming ACK is valid, increment SEQ
-    m_packet_seq_number &= 0x07u;
-    m_p_tx_payload       = NULL;
+    m_p_tx_payload = NULL;
     packet_transmitted_callback();
 
     return;
@@ -920,10 +919,93 @@ static void hci_release_ack_buffer(hci_evt_t * p_event)
 }
 
 
-static void hci_process_orphaned_ack(hci_evt_t * p_event)
+/**@brief Function for resetting the TX window, dropping all packets in it.
+ */
+static void hci_tx_window_reset(void)
 {
-    hci_release_ack_buffer(p_event);
-    return;
+    m_tx_window_head     = 0;
+    m_tx_window_count    = 0;
+    m_tx_window_next     = 0;
+    m_tx_window_sent_end = packet_seq_get();
+    m_tx_report_pending  = false;
+}
+
+
+/**@brief Function for reporting the packet requested by the upper layer as sent.
+ *
+ * With a window of more than one packet the payload has been copied into the window, and the
+ * packet is reported as soon as the window has room for the next one. With a window of one packet
+ * the payload is sent from the buffer of the upper layer, so it is reported when acknowledged.
+ */
+static void hci_tx_window_report(void)
+{
+    if (m_tx_report_pending && (m_tx_window_count < SER_PHY_HCI_WINDOW_SIZE))
+    {
+        m_tx_report_pending = false;
+        hci_pkt_sent_upcall();
+    }
+}
+
+
+/**@brief Function for adding the packet requested by the upper layer to the end of the window.
+ */
+static void hci_tx_window_add(void)
+{
+    const uint32_t slot = (m_tx_window_head + m_tx_window_count) % SER_PHY_HCI_WINDOW_SIZE;
+
+    ser_phy_hci_assert(m_tx_window_count < SER_PHY_HCI_WINDOW_SIZE);
+
+#if (SER_PHY_HCI_WINDOW_SIZE > 1)
+    ser_phy_hci_assert(m_tx_payload_length <= SER_HAL_TRANSPORT_TX_MAX_PKT_SIZE);
+    memcpy(m_tx_window_buf[slot], m_p_tx_payload, m_tx_payload_length);
+    m_tx_window[slot].p_payload = m_tx_window_buf[slot];
+#else
+    m_tx_window[slot].p_payload = m_p_tx_payload;
+#endif
+    m_tx_window[slot].length = m_tx_payload_length;
+
+    if (m_tx_window_count == 0)
+    {
+        m_tx_retry_count = MAX_RETRY_COUNT;
+    }
+    m_tx_window_count++;
+    m_tx_report_pending = true;
+
+    hci_tx_window_report();
+}
+
+
+/**@brief Function for removing acknowledged packets from the start of the window.
+ *
+ * @param[in] acked_count Number of packets acknowledged.
+ */
+static void hci_tx_window_ack(uint32_t acked_count)
+{
+    m_tx_window_head     = (m_tx_window_head + acked_count) % SER_PHY_HCI_WINDOW_SIZE;
+    m_tx_window_count   -= acked_count;
+    m_tx_window_next     = (m_tx_window_next > acked_count) ? (m_tx_window_next - acked_count) : 0;
+    m_packet_seq_number += acked_count; // incoming ACK is valid, advance SEQ
+    m_packet_seq_number &= 0x07u;
+    m_tx_retry_count     = MAX_RETRY_COUNT;
+
+    // Restart the timeout for the remaining packets, if any.
+    hci_timeout_setup((m_tx_window_count != 0) ? 1 : 0);
+    hci_tx_window_report();
+}
+
+
+/**@brief Function for handing the next packet of the window to the SLIP layer.
+ *
+ * Only one packet at a time is handed to the SLIP layer, so its pending slot stays free for ACK
+ * packets from the RX state machine.
+ */
+static void hci_tx_window_send(void)
+{
+    if (!m_tx_slip_busy && (m_tx_window_next < m_tx_window_count))
+    {
+        hci_pkt_send(m_tx_window_next);
+        m_tx_window_next++;
+    }
 }
 
 
@@ -938,100 +1020,59 @@ static void hci_tx_fsm_event_process(hci_evt_t * p_event)
             if ((p_event->evt_source == HCI_SER_PHY_EVT) &&
                 (p_event->evt.ser_phy_evt.evt_type == HCI_SER_PHY_TX_REQUEST))
             {
-                hci_pkt_send();
-                hci_timeout_setup(0);
-                m_tx_retry_count   = MAX_RETRY_COUNT;
-                m_hci_tx_fsm_state = HCI_TX_STATE_WAIT_FOR_FIRST_TX_END;
+                hci_tx_window_add();
             }
             else if ((p_event->evt_source == HCI_SLIP_EVT) &&
-                     (p_event->evt.ser_phy_slip_evt.evt_type == SER_PHY_HCI_SLIP_EVT_PKT_RECEIVED))
+                     (p_event->evt.ser_phy_slip_evt.evt_type == SER_PHY_HCI_SLIP_EVT_PKT_SENT))
             {
-                hci_process_orphaned_ack(p_event);
-            }
+                const uint8_t offset = (m_tx_in_flight_seq - packet_seq_get()) & 0x07u;
 
-            break;
-
-        case HCI_TX_STATE_WAIT_FOR_FIRST_TX_END:
-
-            if ((p_event->evt_source == HCI_SLIP_EVT) &&
-                (p_event->evt.ser_phy_slip_evt.evt_type == SER_PHY_HCI_SLIP_EVT_PKT_SENT))
-            {
-                hci_timeout_setup(1);
-                m_hci_tx_fsm_state = HCI_TX_STATE_WAIT_FOR_ACK;
-            }
-            else if ((p_event->evt_source == HCI_SLIP_EVT) &&
-                     (p_event->evt.ser_phy_slip_evt.evt_type == SER_PHY_HCI_SLIP_EVT_PKT_RECEIVED))
-            {
-                hci_process_orphaned_ack(p_event);
-            }
-            break;
+                m_tx_slip_busy = false;
 
-        case HCI_TX_STATE_WAIT_FOR_ACK_OR_TX_END:
+                // Packets from the window can be acknowledged once they have been fully sent.
+                // A packet acknowledged while it was retransmitted is no longer in the window.
+                if ((offset < m_tx_window_count) &&
+                    (offset >= ((m_tx_window_sent_end - packet_seq_get()) & 0x07u)))
+                {
+                    m_tx_window_sent_end = (m_tx_in_flight_seq + 1) & 0x07u;
+                }
 
-            if ((p_event->evt_source == HCI_SLIP_EVT) &&
-                (p_event->evt.ser_phy_slip_evt.evt_type == SER_PHY_HCI_SLIP_EVT_PKT_SENT))
-            {
-                hci_timeout_setup(1);
-                m_hci_tx_fsm_state = HCI_TX_STATE_WAIT_FOR_ACK;
+                if (m_tx_window_count != 0)
+                {
+                    hci_timeout_setup(1);
+                }
             }
             else if ((p_event->evt_source == HCI_SLIP_EVT) &&
                      (p_event->evt.ser_phy_slip_evt.evt_type == SER_PHY_HCI_SLIP_EVT_PKT_RECEIVED))
             {
-                if (rx_ack_pkt_valid(p_event->evt.ser_phy_slip_evt.evt_params.received_pkt.p_buffer))
-                {
-                    hci_timeout_setup(0);
-                    m_hci_tx_fsm_state = HCI_TX_STATE_WAIT_FOR_TX_END;
-                }
-                hci_release_ack_buffer(p_event);
-            }
-            break;
-
-        case HCI_TX_STATE_WAIT_FOR_ACK:
+                const uint32_t acked_count = rx_ack_pkt_acked_count(
+                    p_event->evt.ser_phy_slip_evt.evt_params.received_pkt.p_buffer);
 
-            if ((p_event->evt_source == HCI_SLIP_EVT) &&
-                (p_event->evt.ser_phy_slip_evt.evt_type == SER_PHY_HCI_SLIP_EVT_PKT_RECEIVED))
-            {
-                if (rx_ack_pkt_valid(p_event->evt.ser_phy_slip_evt.evt_params.received_pkt.p_buffer))
+                if (acked_count != 0)
                 {
-                    hci_timeout_setup(0);
-                    hci_pkt_sent_upcall();
-                    m_hci_tx_fsm_state = HCI_TX_STATE_SEND;
+                    hci_tx_window_ack(acked_count);
                 }
                 hci_release_ack_buffer(p_event);
             }
-            else if (p_event->evt_source == HCI_TIMER_EVT)
+            else if ((p_event->evt_source == HCI_TIMER_EVT) && (m_tx_window_count != 0))
             {
                 m_tx_retry_count--;
 
                 // m_tx_retx_counter++; // global retransmissions counter
                 if (m_tx_retry_count)
                 {
-                    hci_pkt_send();
+                    // Go back and retransmit all packets not acknowledged.
                     DEBUG_HCI_RETX(0);
-                    m_hci_tx_fsm_state = HCI_TX_STATE_WAIT_FOR_ACK_OR_TX_END;
+                    m_tx_window_next = 0;
                 }
                 else
                 {
                     error_callback();
-                    m_hci_tx_fsm_state = HCI_TX_STATE_SEND;
+                    hci_tx_window_reset();
                 }
             }
-            break;
-
-        case HCI_TX_STATE_WAIT_FOR_TX_END:
-
-            if ((p_event->evt_source == HCI_SLIP_EVT) &&
-                (p_event->evt.ser_phy_slip_evt.evt_type == SER_PHY_HCI_SLIP_EVT_PKT_SENT))
-            {
-                hci_pkt_sent_upcall();
-                m_hci_tx_fsm_state = HCI_TX_STATE_SEND;
-            }
-            else if ((p_event->evt_source == HCI_SLIP_EVT) &&
-                     (p_event->evt.ser_phy_slip_evt.evt_type == SER_PHY_HCI_SLIP_EVT_PKT_RECEIVED))
-            {
-                hci_process_orphaned_ack(p_event);
-            }
 
+            hci_tx_window_send();
             break;
 
 #ifdef HCI_LINK_CONTROL
@@ -1353,6 +1394,7 @@ static void hci_link_control_event_handler(hci_evt_t * p_event)
                         m_packet_seq_number = INITIAL_SEQ_NUMBER;
                         m_hci_tx_fsm_state  = HCI_TX_STATE_DISABLE;
                         m_hci_rx_fsm_state  = HCI_RX_STATE_DISABLE;
+                        hci_tx_window_reset();
                         m_hci_uther_side_active = false;
                     }
                     hci_link_control_pkt_send();
@@ -1614,6 +1656,8 @@ uint32_t ser_phy_open(ser_phy_events_handler_t events_handler)
         m_packet_ack_number = INITIAL_ACK_NUMBER_EXPECTED;
         m_packet_seq_number = INITIAL_SEQ_NUMBER;
         m_ser_phy_callback  = events_handler;
+        m_tx_slip_busy      = false;
+        hci_tx_window_reset();
 
 #ifndef HCI_LINK_CONTROL
         m_hci_tx_fsm_state  = HCI_TX_STATE_SEND;
@@ -19,6 +19,7 @@
 #include "conn_mw.h"
 #include "ser_hal_transport.h"
 #include "ser_conn_cmd_decoder.h"
+#include "ser_conn_event_encoder.h"
 
 
 uint32_t ser_conn_command_process(uint8_t * p_command, uint16_t command_len)
@@ -47,8 +48,16 @@ uint32_t ser_conn_command_process(uint8_t * p_command, uint16_t command_len)
         tx_buf_len                -= SER_PKT_TYPE_SIZE;
 
         /* Decode a request, pass a memory for a response command (opcode + data) and encode it. */
-        err_code = conn_mw_handler
-                       (p_command, command_len, &p_tx_buf[SER_PKT_OP_CODE_POS], &tx_buf_len);
+        if (SER_OP_CODE_ADV_REPORT_FILTER_SET == opcode)
+        {
+            err_code = ser_conn_adv_report_filter_cmd_handle
+                           (p_command, command_len, &p_tx_buf[SER_PKT_OP_CODE_POS], &tx_buf_len);
+        }
+        else
+        {
+            err_code = conn_mw_handler
+                           (p_command, command_len, &p_tx_buf[SER_PKT_OP_CODE_POS], &tx_buf_len);
+        }
 
         /* Command decoder not found. */
         if (NRF_ERROR_NOT_SUPPORTED == err_code)
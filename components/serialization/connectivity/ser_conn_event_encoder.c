@@ -12,8 +12,10 @@
 
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include "app_error.h"
 #include "app_scheduler.h"
+#include "app_util_platform.h"
 #include "ble_conn.h"
 #include "ble_serialization.h"
 #include "ser_config.h"
@@ -21,18 +23,122 @@
 #include "ser_conn_event_encoder.h"
 
 
-void ser_conn_ble_event_encoder(void * p_event_data, uint16_t event_size)
+/** Upper bound of the length of an encoded advertising report. */
+#define SER_EVT_ADV_REPORT_ENC_MAX (SER_EVT_HEADER_SIZE + SER_EVT_CONN_HANDLE_SIZE + \
+                                    sizeof (ble_gap_evt_adv_report_t))
+
+static ser_adv_report_filter_t m_adv_report_filter;                 /**< Advertising report filter. */
+static bool                    m_adv_report_filter_enabled = false; /**< Whether m_adv_report_filter is applied. */
+
+#if SER_EVT_COALESCING
+/**@brief Event last put in the scheduler queue, which the next event may be merged into. */
+typedef enum
 {
-    if (NULL == p_event_data)
+    LAST_EVT_OTHER,         /**< An event that can not be merged into, or none. */
+    LAST_EVT_TX_COMPLETE,   /**< A TX complete event. */
+    LAST_EVT_ADV_BATCH      /**< The advertising report batch. */
+} last_evt_t;
+
+static last_evt_t m_last_evt = LAST_EVT_OTHER;
+
+static uint16_t  m_tx_complete_put = 0;         /**< Sequence number of the next TX complete event queued. */
+static uint16_t  m_tx_complete_get = 0;         /**< Sequence number of the next TX complete event encoded. */
+static uint16_t  m_tx_complete_target;          /**< Sequence number of the TX complete event merged into. */
+static uint16_t  m_tx_complete_conn_handle;     /**< Connection of the TX complete event merged into. */
+static uint8_t   m_tx_complete_count;           /**< Count of the TX complete event merged into. */
+static uint8_t   m_tx_complete_merged = 0;      /**< Count merged into it and not encoded yet. */
+
+static ble_evt_t m_adv_batch[SER_EVT_ADV_REPORT_BATCH_SIZE];  /**< Advertising reports of the batch. */
+static uint8_t   m_adv_batch_count  = 0;                       /**< Number of reports in m_adv_batch. */
+static bool      m_adv_batch_queued = false;                   /**< Whether the batch is in the scheduler queue. */
+#endif
+
+
+/**@brief Function for checking if the advertising data lists one of the UUIDs of the filter. */
+static bool adv_report_uuid_match(ble_gap_evt_adv_report_t const * p_report)
+{
+    uint32_t index = 0;
+
+    while (index + 1 < p_report->dlen)
     {
-        APP_ERROR_CHECK(NRF_ERROR_NULL);
+        uint32_t field_end  = index + 1 + p_report->data[index];
+        uint8_t  field_type = p_report->data[index + 1];
+
+        if ((field_end == index + 1) || (field_end > p_report->dlen))
+        {
+            break;
+        }
+
+        if ((field_type == BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE) ||
+            (field_type == BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE))
+        {
+            for (uint32_t i = index + 2; i + 1 < field_end; i += sizeof (uint16_t))
+            {
+                uint16_t uuid = uint16_decode(&p_report->data[i]);
+
+                for (uint32_t j = 0; j < m_adv_report_filter.uuid_count; j++)
+                {
+                    if (uuid == m_adv_report_filter.uuids[j])
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+        index = field_end;
     }
-    UNUSED_PARAMETER(event_size);
 
+    return false;
+}
+
+
+/**@brief Function for checking if an advertising report passes the filter. */
+static bool adv_report_filter_pass(ble_gap_evt_adv_report_t const * p_report)
+{
+    if (!m_adv_report_filter_enabled)
+    {
+        return true;
+    }
+
+    if (p_report->rssi < m_adv_report_filter.rssi_min)
+    {
+        return false;
+    }
+
+    if (m_adv_report_filter.addr_count != 0)
+    {
+        uint32_t i;
+
+        for (i = 0; i < m_adv_report_filter.addr_count; i++)
+        {
+            if ((p_report->peer_addr.addr_type == m_adv_report_filter.addrs[i].addr_type) &&
+                (memcmp(p_report->peer_addr.addr, m_adv_report_filter.addrs[i].addr,
+                        BLE_GAP_ADDR_LEN) == 0))
+            {
+                break;
+            }
+        }
+        if (i == m_adv_report_filter.addr_count)
+        {
+            return false;
+        }
+    }
+
+    if ((m_adv_report_filter.uuid_count != 0) && !p_report->scan_rsp)
+    {
+        return adv_report_uuid_match(p_report);
+    }
+
+    return true;
+}
+
+
+/**@brief Function for encoding an event into a new packet and sending it. */
+static void event_send(ble_evt_t const * p_ble_evt)
+{
     uint32_t    err_code   = NRF_SUCCESS;
     uint8_t *   p_tx_buf   = NULL;
     uint32_t    tx_buf_len = 0;
-    ble_evt_t * p_ble_evt  = (ble_evt_t *)p_event_data;
 
     /* Allocate a memory buffer from HAL Transport layer for transmitting an event.
      * Loop until a buffer is available. */
@@ -73,3 +179,233 @@ void ser_conn_ble_event_encoder(void * p_event_data, uint16_t event_size)
     }
 }
 
+
+void ser_conn_ble_event_encoder(void * p_event_data, uint16_t event_size)
+{
+    if (NULL == p_event_data)
+    {
+        APP_ERROR_CHECK(NRF_ERROR_NULL);
+    }
+    UNUSED_PARAMETER(event_size);
+
+    ble_evt_t * p_ble_evt = (ble_evt_t *)p_event_data;
+
+#if SER_EVT_COALESCING
+    if (p_ble_evt->header.evt_id == BLE_EVT_TX_COMPLETE)
+    {
+        CRITICAL_REGION_ENTER();
+        if (m_tx_complete_get++ == m_tx_complete_target)
+        {
+            p_ble_evt->evt.common_evt.params.tx_complete.count += m_tx_complete_merged;
+            m_tx_complete_merged = 0;
+            if (m_last_evt == LAST_EVT_TX_COMPLETE)
+            {
+                m_last_evt = LAST_EVT_OTHER;
+            }
+        }
+        CRITICAL_REGION_EXIT();
+    }
+#endif
+
+    event_send(p_ble_evt);
+}
+
+
+#if SER_EVT_COALESCING
+/**@brief Function for encoding the advertising report batch into SER_PKT_TYPE_EVT_BATCH packets.
+ *
+ * @details Called by the application scheduler in place of @ref ser_conn_ble_event_encoder for
+ *          the batch. Each event is preceded by its length, so the application chip can pass them
+ *          one by one to its event decoder.
+ */
+static void adv_report_batch_encoder(void * p_event_data, uint16_t event_size)
+{
+    uint32_t  err_code;
+    uint8_t * p_tx_buf;
+    uint32_t  tx_buf_len;
+    uint32_t  count;
+    uint32_t  i = 0;
+
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    /* Close the batch, later reports are queued on their own until it is sent. */
+    CRITICAL_REGION_ENTER();
+    if (m_last_evt == LAST_EVT_ADV_BATCH)
+    {
+        m_last_evt = LAST_EVT_OTHER;
+    }
+    count = m_adv_batch_count;
+    CRITICAL_REGION_EXIT();
+
+    while (i < count)
+    {
+        uint32_t index = SER_PKT_TYPE_SIZE;
+
+        do
+        {
+            err_code = ser_hal_transport_tx_pkt_alloc(&p_tx_buf, (uint16_t *)&tx_buf_len);
+        }
+        while (err_code == NRF_ERROR_NO_MEM);
+        APP_ERROR_CHECK(err_code);
+
+        p_tx_buf[SER_PKT_TYPE_POS] = SER_PKT_TYPE_EVT_BATCH;
+
+        while ((i < count) &&
+               (tx_buf_len - index >= SER_EVT_BATCH_LEN_SIZE + SER_EVT_ADV_REPORT_ENC_MAX))
+        {
+            uint32_t evt_len = tx_buf_len - index - SER_EVT_BATCH_LEN_SIZE;
+
+            err_code = ble_event_enc(&m_adv_batch[i], 0,
+                                     &p_tx_buf[index + SER_EVT_BATCH_LEN_SIZE], &evt_len);
+            APP_ERROR_CHECK(err_code);
+
+            index += uint16_encode((uint16_t)evt_len, &p_tx_buf[index]);
+            index += evt_len;
+            i++;
+        }
+
+        err_code = ser_hal_transport_tx_pkt_send(p_tx_buf, (uint16_t)index);
+        APP_ERROR_CHECK(err_code);
+        /* See event_send(). */
+        app_sched_pause();
+    }
+
+    CRITICAL_REGION_ENTER();
+    m_adv_batch_count  = 0;
+    m_adv_batch_queued = false;
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Function for merging an event into the last one queued, or queuing it.
+ *
+ * @note Called in a critical region.
+ */
+static uint32_t event_coalesce_put(ble_evt_t * p_ble_evt)
+{
+    uint32_t err_code;
+
+    if (p_ble_evt->header.evt_id == BLE_EVT_TX_COMPLETE)
+    {
+        uint8_t count = p_ble_evt->evt.common_evt.params.tx_complete.count;
+
+        if ((m_last_evt == LAST_EVT_TX_COMPLETE) &&
+            (m_tx_complete_conn_handle == p_ble_evt->evt.common_evt.conn_handle) &&
+            (m_tx_complete_count + m_tx_complete_merged + count <= UINT8_MAX))
+        {
+            m_tx_complete_merged += count;
+            return NRF_SUCCESS;
+        }
+    }
+    else if (p_ble_evt->header.evt_id == BLE_GAP_EVT_ADV_REPORT)
+    {
+        if ((m_last_evt == LAST_EVT_ADV_BATCH) &&
+            (m_adv_batch_count < SER_EVT_ADV_REPORT_BATCH_SIZE))
+        {
+            memcpy(&m_adv_batch[m_adv_batch_count++], p_ble_evt,
+                   sizeof (ble_evt_hdr_t) + p_ble_evt->header.evt_len);
+            return NRF_SUCCESS;
+        }
+
+        if (!m_adv_batch_queued)
+        {
+            err_code = app_sched_event_put(NULL, 0, adv_report_batch_encoder);
+            if (err_code == NRF_SUCCESS)
+            {
+                memcpy(&m_adv_batch[0], p_ble_evt, sizeof (ble_evt_hdr_t) + p_ble_evt->header.evt_len);
+                m_adv_batch_count  = 1;
+                m_adv_batch_queued = true;
+                m_last_evt         = LAST_EVT_ADV_BATCH;
+            }
+            return err_code;
+        }
+    }
+
+    err_code = app_sched_event_put(p_ble_evt, sizeof (ble_evt_hdr_t) + p_ble_evt->header.evt_len,
+                                   ser_conn_ble_event_encoder);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_last_evt = LAST_EVT_OTHER;
+
+        if (p_ble_evt->header.evt_id == BLE_EVT_TX_COMPLETE)
+        {
+            uint16_t seq = m_tx_complete_put++;
+
+            /* Only one event at a time can have counts merged into it. */
+            if (m_tx_complete_merged == 0)
+            {
+                m_tx_complete_target      = seq;
+                m_tx_complete_conn_handle = p_ble_evt->evt.common_evt.conn_handle;
+                m_tx_complete_count       = p_ble_evt->evt.common_evt.params.tx_complete.count;
+                m_last_evt                = LAST_EVT_TX_COMPLETE;
+            }
+        }
+    }
+
+    return err_code;
+}
+#endif
+
+
+uint32_t ser_conn_ble_event_put(ble_evt_t * p_ble_evt)
+{
+    uint32_t err_code = NRF_SUCCESS;
+
+    if ((p_ble_evt->header.evt_id == BLE_GAP_EVT_ADV_REPORT) &&
+        !adv_report_filter_pass(&p_ble_evt->evt.gap_evt.params.adv_report))
+    {
+        return NRF_SUCCESS;
+    }
+
+#if SER_EVT_COALESCING
+    CRITICAL_REGION_ENTER();
+    err_code = event_coalesce_put(p_ble_evt);
+    CRITICAL_REGION_EXIT();
+#else
+    err_code = app_sched_event_put(p_ble_evt, sizeof (ble_evt_hdr_t) + p_ble_evt->header.evt_len,
+                                   ser_conn_ble_event_encoder);
+#endif
+
+    return err_code;
+}
+
+
+uint32_t ser_conn_adv_report_filter_set(ser_adv_report_filter_t const * p_filter)
+{
+    if ((p_filter != NULL) &&
+        ((p_filter->addr_count > SER_ADV_REPORT_FILTER_ADDR_MAX) ||
+         (p_filter->uuid_count > SER_ADV_REPORT_FILTER_UUID_MAX)))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+    if (p_filter != NULL)
+    {
+        m_adv_report_filter = *p_filter;
+    }
+    m_adv_report_filter_enabled = (p_filter != NULL);
+    CRITICAL_REGION_EXIT();
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ser_conn_adv_report_filter_cmd_handle(uint8_t const * const p_rx_buf,
+                                               uint32_t              rx_buf_len,
+                                               uint8_t * const       p_tx_buf,
+                                               uint32_t * const      p_tx_buf_len)
+{
+    ser_adv_report_filter_t filter;
+    uint32_t                err_code;
+
+    err_code = ser_adv_report_filter_set_req_dec(p_rx_buf, rx_buf_len, &filter);
+    if (err_code == NRF_SUCCESS)
+    {
+        err_code = ser_conn_adv_report_filter_set(&filter);
+    }
+
+    return ser_ble_cmd_rsp_status_code_enc(SER_OP_CODE_ADV_REPORT_FILTER_SET, err_code,
+                                           p_tx_buf, p_tx_buf_len);
+}
@@ -31,6 +31,8 @@
 #define SER_CONN_EVENT_ENCODER_H__
 
 #include <stdint.h>
+#include "ble.h"
+#include "ble_serialization.h"
 
 /**@brief A function for encoding a @ref ble_evt_t. The function passes the serialized byte stream
  *        to the transport layer after encoding.
@@ -45,6 +47,45 @@
  */
 void ser_conn_ble_event_encoder(void * p_event_data, uint16_t event_size);
 
+/**@brief A function for putting a @ref ble_evt_t in the application scheduler queue, to be encoded
+ *        by @ref ser_conn_ble_event_encoder.
+ *
+ * @details Advertising reports that do not pass the filter set with
+ *          @ref ser_conn_adv_report_filter_set are dropped. With SER_EVT_COALESCING, a TX complete
+ *          event is merged into the previous event if it is a TX complete of the same connection,
+ *          and adjacent advertising reports are collected to be sent in one packet.
+ *
+ * @param[in]   p_ble_evt      Event pulled from the SoftDevice.
+ *
+ * @retval NRF_SUCCESS         Event queued, merged or dropped.
+ * @return Errors from app_sched_event_put().
+ */
+uint32_t ser_conn_ble_event_put(ble_evt_t * p_ble_evt);
+
+/**@brief A function for setting the advertising report filter.
+ *
+ * @param[in]   p_filter       Filter, copied by the function. NULL to pass all reports.
+ *
+ * @retval NRF_SUCCESS              Filter set.
+ * @retval NRF_ERROR_INVALID_PARAM  Too many addresses or UUIDs.
+ */
+uint32_t ser_conn_adv_report_filter_set(ser_adv_report_filter_t const * p_filter);
+
+/**@brief A function for handling the @ref SER_OP_CODE_ADV_REPORT_FILTER_SET command of the
+ *        Application Chip, with the same parameters as the connectivity middleware handlers.
+ *
+ * @param[in]      p_rx_buf        Received command.
+ * @param[in]      rx_buf_len      Length of the command.
+ * @param[out]     p_tx_buf        Buffer for the response.
+ * @param[in,out]  p_tx_buf_len    \c in: Size of the buffer. \c out: Length of the response.
+ *
+ * @retval NRF_SUCCESS         Response encoded.
+ */
+uint32_t ser_conn_adv_report_filter_cmd_handle(uint8_t const * const p_rx_buf,
+                                               uint32_t              rx_buf_len,
+                                               uint8_t * const       p_tx_buf,
+                                               uint32_t * const      p_tx_buf_len);
+
 #endif /* SER_CONN_EVENT_ENCODER_H__ */
 
 /** @} */
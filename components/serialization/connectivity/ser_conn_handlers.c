@@ -121,8 +121,7 @@ void ser_conn_ble_event_handle(ble_evt_t * p_ble_evt)
      * encoding and sending every BLE event because sending a response on received packet has higher
      * priority than sending a BLE event. Solution for that is to put BLE events into application
      * scheduler queue to be processed at a later time. */
-    err_code = app_sched_event_put(p_ble_evt, sizeof (ble_evt_hdr_t) + p_ble_evt->header.evt_len,
-                                   ser_conn_ble_event_encoder);
+    err_code = ser_conn_ble_event_put(p_ble_evt);
     APP_ERROR_CHECK(err_code);
 }
 
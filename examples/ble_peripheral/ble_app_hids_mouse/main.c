@@ -333,6 +333,32 @@ static void bas_init(void)
 }
 
 
+/**@brief Function for encoding the Mouse Input Report containing movement data.
+ *
+ * @details The report holds 12-bit deltas. Movement beyond that range is left for the next report.
+ */
+static uint16_t movement_encode(uint8_t   buttons,
+                                int16_t * p_x_delta,
+                                int16_t * p_y_delta,
+                                uint8_t * p_report)
+{
+    int16_t x_delta = MAX(MIN(*p_x_delta, 0x07ff), -0x0800);
+    int16_t y_delta = MAX(MIN(*p_y_delta, 0x07ff), -0x0800);
+
+    UNUSED_PARAMETER(buttons);
+    APP_ERROR_CHECK_BOOL(INPUT_REP_MOVEMENT_LEN == 3);
+
+    p_report[0] = x_delta & 0x00ff;
+    p_report[1] = ((y_delta & 0x000f) << 4) | ((x_delta & 0x0f00) >> 8);
+    p_report[2] = (y_delta & 0x0ff0) >> 4;
+
+    *p_x_delta -= x_delta;
+    *p_y_delta -= y_delta;
+
+    return INPUT_REP_MOVEMENT_LEN;
+}
+
+
 /**@brief Function for initializing HID Service.
  */
 static void hids_init(void)
@@ -473,6 +499,8 @@ static void hids_init(void)
     hids_init_obj.hid_information.flags          = hid_info_flags;
     hids_init_obj.included_services_count        = 0;
     hids_init_obj.p_included_services_array      = NULL;
+    hids_init_obj.movement_rep_index             = INPUT_REP_MOVEMENT_INDEX;
+    hids_init_obj.movement_encode                = movement_encode;
 
     BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&hids_init_obj.rep_map.security_mode.read_perm);
     BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&hids_init_obj.rep_map.security_mode.write_perm);
@@ -941,41 +969,10 @@ static void mouse_movement_send(int16_t x_delta, int16_t y_delta)
 {
     uint32_t err_code;
 
-    if (m_in_boot_mode)
-    {
-        x_delta = MIN(x_delta, 0x00ff);
-        y_delta = MIN(y_delta, 0x00ff);
-
-        err_code = ble_hids_boot_mouse_inp_rep_send(&m_hids,
-                                                    0x00,
-                                                    (int8_t)x_delta,
-                                                    (int8_t)y_delta,
-                                                    0,
-                                                    NULL);
-    }
-    else
-    {
-        uint8_t buffer[INPUT_REP_MOVEMENT_LEN];
-
-        APP_ERROR_CHECK_BOOL(INPUT_REP_MOVEMENT_LEN == 3);
-
-        x_delta = MIN(x_delta, 0x0fff);
-        y_delta = MIN(y_delta, 0x0fff);
-
-        buffer[0] = x_delta & 0x00ff;
-        buffer[1] = ((y_delta & 0x000f) << 4) | ((x_delta & 0x0f00) >> 8);
-        buffer[2] = (y_delta & 0x0ff0) >> 4;
-
-        err_code = ble_hids_inp_rep_send(&m_hids,
-                                         INPUT_REP_MOVEMENT_INDEX,
-                                         INPUT_REP_MOVEMENT_LEN,
-                                         buffer);
-    }
-
+    // Movement is merged in the service while the transmit buffers are full.
+    err_code = ble_hids_mouse_movement_queue(&m_hids, m_in_boot_mode, 0x00, x_delta, y_delta);
     if ((err_code != NRF_SUCCESS) &&
-        (err_code != NRF_ERROR_INVALID_STATE) &&
-        (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
-        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
+        (err_code != NRF_ERROR_INVALID_STATE)
     )
     {
         APP_ERROR_HANDLER(err_code);
@@ -65,8 +65,10 @@
 
 #define UART_TX_BUF_SIZE                256                                         /**< UART TX buffer size. */
 #define UART_RX_BUF_SIZE                256                                         /**< UART RX buffer size. */
+#define NUS_STREAM_BUF_SIZE             512                                         /**< Size of the buffer of data waiting to be sent over BLE. */
 
 static ble_nus_t                        m_nus;                                      /**< Structure to identify the Nordic UART Service. */
+static uint8_t                          m_nus_stream_buf[NUS_STREAM_BUF_SIZE];      /**< Buffer of data waiting to be sent over BLE. */
 static uint16_t                         m_conn_handle = BLE_CONN_HANDLE_INVALID;    /**< Handle of the current connection. */
 
 static ble_uuid_t                       m_adv_uuids[] = {{BLE_UUID_NUS_SERVICE, NUS_SERVICE_UUID_TYPE}};  /**< Universally unique service identifier. */
@@ -149,7 +151,9 @@ static void services_init(void)
     
     memset(&nus_init, 0, sizeof(nus_init));
 
-    nus_init.data_handler = nus_data_handler;
+    nus_init.data_handler    = nus_data_handler;
+    nus_init.p_stream_buf    = m_nus_stream_buf;
+    nus_init.stream_buf_size = sizeof(m_nus_stream_buf);
     
     err_code = ble_nus_init(&m_nus, &nus_init);
     APP_ERROR_CHECK(err_code);
@@ -380,33 +384,36 @@ void bsp_event_handler(bsp_event_t event)
 
 /**@brief   Function for handling app_uart events.
  *
- * @details This function will receive a single character from the app_uart module and append it to 
- *          a string. The string will be be sent over BLE when the last character received was a 
- *          'new line' i.e '\n' (hex 0x0D) or if the string has reached a length of 
- *          @ref NUS_MAX_DATA_LENGTH.
+ * @details This function will receive the characters from the app_uart module and put them in the
+ *          Nordic UART Service stream, which sends them over BLE in full notifications. The stream
+ *          is flushed when the last character received was a 'new line' i.e '\n' (hex 0x0D).
+ *          Characters are dropped only if the stream buffer is full.
  */
 /**@snippet [Handling the data received over UART] */
 void uart_event_handle(app_uart_evt_t * p_event)
 {
-    static uint8_t data_array[BLE_NUS_MAX_DATA_LEN];
-    static uint8_t index = 0;
-    uint32_t       err_code;
+    uint8_t  data_array[BLE_NUS_MAX_DATA_LEN];
+    uint32_t length = sizeof(data_array);
+    uint32_t err_code;
 
     switch (p_event->evt_type)
     {
         case APP_UART_DATA_READY:
-            UNUSED_VARIABLE(app_uart_get(&data_array[index]));
-            index++;
+            if (app_uart_read(data_array, &length) != NRF_SUCCESS)
+            {
+                break;
+            }
+
+            err_code = ble_nus_stream_put(&m_nus, data_array, (uint16_t)length);
 
-            if ((data_array[index - 1] == '\n') || (index >= (BLE_NUS_MAX_DATA_LEN)))
+            if ((err_code == NRF_SUCCESS) && (memchr(data_array, '\n', length) != NULL))
             {
-                err_code = ble_nus_string_send(&m_nus, data_array, index);
-                if (err_code != NRF_ERROR_INVALID_STATE)
-                {
-                    APP_ERROR_CHECK(err_code);
-                }
-                
-                index = 0;
+                err_code = ble_nus_stream_flush(&m_nus);
+            }
+
+            if ((err_code != NRF_ERROR_INVALID_STATE) && (err_code != NRF_ERROR_NO_MEM))
+            {
+                APP_ERROR_CHECK(err_code);
             }
             break;
 
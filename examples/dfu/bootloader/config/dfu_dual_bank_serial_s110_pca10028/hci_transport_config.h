@@ -34,11 +34,24 @@
 
 #define HCI_SLIP_UART_MODE           APP_UART_FLOW_CONTROL_ENABLED      /**< Defines the UART mode to be used. Use UART Low Power with Flow Control - Valid values are defined in \ref app_uart_flow_control_t. For further information on the UART Low Power mode, please refer to: \ref app_uart . */
 
+#ifndef HCI_LARGE_FRAMES
+#define HCI_LARGE_FRAMES             0                                  /**< Set to 1 to receive frames of up to one flash page of data at 115200 baud, see \ref hci_mem_pool_internal.h. Requires flow control, and DFU_STREAMED_FLASH_WRITE when used for DFU. */
+#endif
+
+#if HCI_LARGE_FRAMES
+#define HCI_SLIP_UART_BAUDRATE       UART_BAUDRATE_BAUDRATE_Baud115200  /**< Defines the UART Baud rate. */
+#else
 #define HCI_SLIP_UART_BAUDRATE       UART_BAUDRATE_BAUDRATE_Baud38400   /**< Defines the UART Baud rate. Default is 38400 baud. */
+#endif
 
 /** This section covers configurable parameters for the HCI Transport layer that are used for calculating correct value for the retransmission timer timeout. */
+#if HCI_LARGE_FRAMES
+#define MAX_PACKET_SIZE_IN_BITS      22000u                             /**< Maximum size of a single application packet in bits, a page of data with worst case SLIP escaping. */
+#define USED_BAUD_RATE               115200u                            /**< The used uart baudrate. */
+#else
 #define MAX_PACKET_SIZE_IN_BITS      8000u                              /**< Maximum size of a single application packet in bits. */      
 #define USED_BAUD_RATE               38400u                             /**< The used uart baudrate. */
+#endif
 
 #endif // HCI_TRANSPORT_CONFIG_H__
 
@@ -187,8 +187,9 @@ int main(void)
     uint32_t err_code;
     bool     dfu_start = false;
     bool     app_reset = (NRF_POWER->GPREGRET == BOOTLOADER_DFU_START);
+    bool     app_staged = (NRF_POWER->GPREGRET == BOOTLOADER_DFU_ACTIVATE_STAGED);
 
-    if (app_reset)
+    if (app_reset || app_staged)
     {
         NRF_POWER->GPREGRET = 0;
     }
@@ -228,6 +229,17 @@ int main(void)
         scheduler_init();
     }
 
+    if (app_staged)
+    {
+        nrf_gpio_pin_clear(UPDATE_IN_PROGRESS_LED);
+
+        // The application has received and validated a new image in bank 1. If the image fails
+        // the check, the current application is started again.
+        (void)bootloader_dfu_staged_activate();
+
+        nrf_gpio_pin_set(UPDATE_IN_PROGRESS_LED);
+    }
+
     dfu_start  = app_reset;
     dfu_start |= ((nrf_gpio_pin_read(BOOTLOADER_BUTTON) == 0) ? true: false);
     
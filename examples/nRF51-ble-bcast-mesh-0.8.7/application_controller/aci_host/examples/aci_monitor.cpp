@@ -0,0 +1,212 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+/* Watches any number of gateways from one process. Each gateway gets a
+   consumer thread, and all serial I/O runs on the main thread. On start,
+   the state of each mesh is read out with value dump commands, after which
+   the value events are printed as they come. */
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+#include "aci_gateway.h"
+#include "aci_reactor.h"
+
+static aci::reactor* mp_reactor;
+static volatile sig_atomic_t m_stopping;
+
+static void on_signal(int sig)
+{
+    (void) sig;
+    m_stopping = 1;
+    mp_reactor->stop();
+}
+
+static void value_print(const char* p_port, const char* p_type, uint16_t handle, int version, const uint8_t* p_data, uint32_t length)
+{
+    char line[256];
+    int used = snprintf(line, sizeof(line), "%s %s handle=0x%04x", p_port, p_type, handle);
+    if (version >= 0)
+    {
+        used += snprintf(&line[used], sizeof(line) - used, " version=%d", version);
+    }
+    used += snprintf(&line[used], sizeof(line) - used, " data=");
+    for (uint32_t i = 0; i < length && used < (int) sizeof(line) - 3; ++i)
+    {
+        used += snprintf(&line[used], sizeof(line) - used, "%02x", p_data[i]);
+    }
+    puts(line);
+}
+
+static void dump_request(aci::gateway* p_gw, uint16_t cursor)
+{
+    aci::frame_t cmd;
+    aci::command_value_dump(&cmd, cursor);
+    if (!p_gw->command_send(cmd))
+    {
+        fprintf(stderr, "%s: couldn't queue value dump\n", p_gw->port().c_str());
+    }
+}
+
+static void consumer(aci::gateway* p_gw)
+{
+    const char* p_port = p_gw->port().c_str();
+    dump_request(p_gw, 0);
+
+    aci::frame_t evt;
+    while (!m_stopping)
+    {
+        if (!p_gw->event_wait(evt, 200))
+        {
+            continue;
+        }
+
+        const uint8_t* p = evt.params();
+        switch (evt.opcode())
+        {
+            case aci::EVT_OPCODE_EVENT_NEW:
+            case aci::EVT_OPCODE_EVENT_UPDATE:
+            case aci::EVT_OPCODE_EVENT_CONFLICTING:
+            case aci::EVT_OPCODE_EVENT_TX:
+                if (evt.params_len() >= 2)
+                {
+                    value_print(p_port, "event", p[0] | (p[1] << 8), -1, &p[2], evt.params_len() - 2);
+                }
+                break;
+
+            case aci::EVT_OPCODE_EVENT_VALUE_DUMP:
+                for (uint32_t i = 2; i + 5 <= evt.params_len() && i + 5 + p[i + 4] <= evt.params_len(); i += 5 + p[i + 4])
+                {
+                    value_print(p_port, "dump", p[i] | (p[i + 1] << 8), p[i + 2] | (p[i + 3] << 8), &p[i + 5], p[i + 4]);
+                }
+                break;
+
+            case aci::EVT_OPCODE_CMD_RSP:
+                if (evt.command_opcode() == aci::CMD_OPCODE_VALUE_DUMP && evt.params_len() >= 4)
+                {
+                    const uint16_t cursor = p[2] | (p[3] << 8);
+                    if (evt.status() == aci::STATUS_SUCCESS && cursor != aci::VALUE_DUMP_CURSOR_END)
+                    {
+                        dump_request(p_gw, cursor);
+                    }
+                    else if (evt.status() == aci::STATUS_ERROR_BUSY)
+                    {
+                        usleep(10000);
+                        dump_request(p_gw, cursor);
+                    }
+                }
+                else if (evt.status() != aci::STATUS_SUCCESS)
+                {
+                    printf("%s command 0x%02x failed: 0x%02x\n", p_port, evt.command_opcode(), evt.status());
+                }
+                break;
+
+            case aci::EVT_OPCODE_DEVICE_STARTED:
+                printf("%s device started\n", p_port);
+                dump_request(p_gw, 0);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    aci::gateway_config_t config;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:nh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b':
+                config.baudrate = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                config.rtscts = false;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-b baudrate] [-n (no flow control)] port...\n", argv[0]);
+                return (opt == 'h' ? 0 : 1);
+        }
+    }
+    if (optind == argc)
+    {
+        fprintf(stderr, "No ports given\n");
+        return 1;
+    }
+
+    aci::reactor reactor;
+    std::vector<aci::gateway*> gateways;
+    for (int i = optind; i < argc; ++i)
+    {
+        aci::gateway* p_gw = new aci::gateway(argv[i], config);
+        if (!p_gw->open() || !reactor.add(*p_gw))
+        {
+            fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+            return 1;
+        }
+        gateways.push_back(p_gw);
+    }
+
+    mp_reactor = &reactor;
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    std::vector<std::thread> consumers;
+    for (size_t i = 0; i < gateways.size(); ++i)
+    {
+        consumers.push_back(std::thread(consumer, gateways[i]));
+    }
+    reactor.run();
+    for (size_t i = 0; i < consumers.size(); ++i)
+    {
+        consumers[i].join();
+    }
+
+    for (size_t i = 0; i < gateways.size(); ++i)
+    {
+        const aci::gateway_stats_t stats = gateways[i]->stats_get();
+        fprintf(stderr, "%s: rx %llu bytes, %llu frames in %llu reads; tx %llu bytes, %llu frames in %llu writes; "
+                "%llu events dropped, %llu command timeouts, %llu framing errors\n",
+                gateways[i]->port().c_str(),
+                (unsigned long long) stats.rx_bytes, (unsigned long long) stats.rx_frames, (unsigned long long) stats.rx_reads,
+                (unsigned long long) stats.tx_bytes, (unsigned long long) stats.tx_frames, (unsigned long long) stats.tx_writes,
+                (unsigned long long) stats.events_dropped, (unsigned long long) stats.command_timeouts,
+                (unsigned long long) stats.framing_errors);
+        delete gateways[i];
+    }
+    return 0;
+}
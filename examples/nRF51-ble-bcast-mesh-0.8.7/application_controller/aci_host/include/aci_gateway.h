@@ -0,0 +1,193 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef ACI_GATEWAY_H__
+#define ACI_GATEWAY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "aci_protocol.h"
+#include "spsc_queue.h"
+
+namespace aci
+{
+
+class reactor;
+
+/** Settings for a gateway connection. */
+struct gateway_config_t
+{
+    gateway_config_t(void) :
+        baudrate(115200),
+        rtscts(true),
+        event_queue_length(1024),
+        command_queue_length(256),
+        credits(DEFAULT_CREDITS),
+        command_timeout_ms(1000),
+        unbatch(true)
+    {}
+
+    uint32_t baudrate;              /**< UART baud rate, as SERIAL_UART_BAUDRATE on the device. */
+    bool rtscts;                    /**< Hardware flow control, always on for the framework's UART transport. */
+    uint32_t event_queue_length;    /**< Events that can wait for the consumer before new ones are dropped. */
+    uint32_t command_queue_length;  /**< Commands that can wait for a credit before command_send() fails. */
+    uint32_t credits;               /**< Commands in flight until the device reports its own number. */
+    uint32_t command_timeout_ms;    /**< Time before the credit of an unanswered command is given back. */
+    bool unbatch;                   /**< Split event_batch frames into the value events they hold. */
+};
+
+/** Counters for a gateway connection. */
+struct gateway_stats_t
+{
+    uint64_t rx_bytes;
+    uint64_t rx_reads;              /**< read() calls that returned data. */
+    uint64_t rx_frames;
+    uint64_t tx_bytes;
+    uint64_t tx_writes;             /**< write() calls that took data. */
+    uint64_t tx_frames;
+    uint64_t events_dropped;        /**< Events lost to a full event queue. */
+    uint64_t command_timeouts;      /**< Commands that were never answered. */
+    uint64_t framing_errors;        /**< Zero length frames skipped in the byte stream. */
+};
+
+/**
+* @brief Connection to one device running the serial interface over UART.
+*
+* @details All I/O is done by the @ref reactor the gateway is added to. Events
+*   are handed to one consumer thread through a lock free queue, and any
+*   thread may send commands. Commands are pipelined: up to the device's
+*   number of credits are sent back to back, and a new one goes out as soon
+*   as a command response frees a credit.
+*/
+class gateway
+{
+public:
+    gateway(const std::string& port, const gateway_config_t& config = gateway_config_t());
+    ~gateway();
+
+    /** Open and set up the serial port. Returns false and sets errno on failure. */
+    bool open(void);
+
+    const std::string& port(void) const { return m_port; }
+
+    /**
+    * Queue a command for the device. May be called from any thread. The
+    *   response comes back through event_get().
+    *
+    * @return false if the command queue is full or the gateway is closed.
+    */
+    bool command_send(const frame_t& cmd);
+
+    /**
+    * Take the next event from the device, without blocking. Must always be
+    *   called from the same thread.
+    */
+    bool event_get(frame_t& evt);
+
+    /**
+    * Wait up to timeout_ms milliseconds for the next event, or forever if
+    *   timeout_ms is negative. Must always be called from the same thread.
+    */
+    bool event_wait(frame_t& evt, int timeout_ms);
+
+    /**
+    * File descriptor that's readable while events may be waiting, for
+    *   consumers that wait on several sources. Read it to clear it before
+    *   calling event_get() until it returns false.
+    */
+    int event_fd(void) const { return m_event_fd; }
+
+    /** Get a copy of the counters. */
+    gateway_stats_t stats_get(void) const;
+
+private:
+    friend class reactor;
+
+    /** Tells the reactor what an epoll event is for. */
+    struct watch_t
+    {
+        gateway* p_gateway;
+        bool is_serial;
+    };
+
+    gateway(const gateway&);
+    gateway& operator=(const gateway&);
+
+    /* reactor thread */
+    void serial_readable(void);
+    void serial_writable(void);
+    void commands_flush(void);
+    void timeouts_check(uint64_t now_ms);
+    void frame_received(const uint8_t* p_frame);
+    void event_push(const uint8_t* p_frame, uint32_t size);
+    void tx_flush(void);
+    void serial_close(void);
+
+    std::string m_port;
+    gateway_config_t m_config;
+    int m_serial_fd;
+    int m_event_fd;                 /**< Signals the consumer. */
+    int m_command_fd;               /**< Signals the reactor about new commands. */
+    reactor* mp_reactor;
+    std::atomic<bool> m_open;
+    watch_t m_serial_watch;
+    watch_t m_command_watch;
+
+    /* Commands from any thread to the reactor. */
+    std::mutex m_command_lock;
+    std::deque<frame_t> m_commands;
+
+    /* Reactor only. */
+    std::deque<std::pair<uint8_t, uint64_t> > m_in_flight; /**< Opcode and deadline of each unanswered command. */
+    uint32_t m_credits;
+    std::vector<uint8_t> m_rx_buf;
+    uint32_t m_rx_len;
+    std::vector<uint8_t> m_tx_buf;     /**< Bytes the serial driver hasn't taken yet. */
+    bool m_watching_writable;
+    bool m_event_signal;            /**< An event was pushed since the consumer was last signalled. */
+
+    spsc_queue<frame_t> m_events;
+
+    struct
+    {
+        std::atomic<uint64_t> rx_bytes, rx_reads, rx_frames;
+        std::atomic<uint64_t> tx_bytes, tx_writes, tx_frames;
+        std::atomic<uint64_t> events_dropped, command_timeouts, framing_errors;
+    } m_stats;
+};
+
+} /* namespace aci */
+
+#endif /* ACI_GATEWAY_H__ */
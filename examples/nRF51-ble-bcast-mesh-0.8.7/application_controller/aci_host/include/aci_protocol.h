@@ -0,0 +1,180 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef ACI_PROTOCOL_H__
+#define ACI_PROTOCOL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+* @file Frame layout and opcodes of the serial interface, as in
+*   serial_command.h and serial_evt.h of the framework. Every frame is a
+*   length byte, followed by the opcode and the parameters. The length counts
+*   the opcode and the parameters.
+*/
+
+namespace aci
+{
+
+/** Opcodes of the commands going to the device. */
+enum cmd_opcode_t
+{
+    CMD_OPCODE_ECHO                 = 0x02,
+    CMD_OPCODE_RADIO_RESET          = 0x0E,
+    CMD_OPCODE_VALUE_DUMP           = 0x6C,
+    CMD_OPCODE_SURVEY_SET           = 0x6D,
+    CMD_OPCODE_SURVEY_GET           = 0x6E,
+    CMD_OPCODE_VALUE_GET_BULK       = 0x6F,
+    CMD_OPCODE_INIT                 = 0x70,
+    CMD_OPCODE_VALUE_SET            = 0x71,
+    CMD_OPCODE_VALUE_ENABLE         = 0x72,
+    CMD_OPCODE_VALUE_DISABLE        = 0x73,
+    CMD_OPCODE_START                = 0x74,
+    CMD_OPCODE_STOP                 = 0x75,
+    CMD_OPCODE_FLAG_SET             = 0x76,
+    CMD_OPCODE_FLAG_GET             = 0x77,
+    CMD_OPCODE_DFU                  = 0x78,
+    CMD_OPCODE_VALUE_SET_BULK       = 0x79,
+    CMD_OPCODE_VALUE_GET            = 0x7A,
+    CMD_OPCODE_BUILD_VERSION_GET    = 0x7B,
+    CMD_OPCODE_ACCESS_ADDR_GET      = 0x7C,
+    CMD_OPCODE_CHANNEL_GET          = 0x7D,
+    CMD_OPCODE_STATS_GET            = 0x7E,
+    CMD_OPCODE_INTERVAL_GET         = 0x7F
+};
+
+/** Opcodes of the events coming from the device. */
+enum evt_opcode_t
+{
+    EVT_OPCODE_DFU                  = 0x78,
+    EVT_OPCODE_DEVICE_STARTED       = 0x81,
+    EVT_OPCODE_ECHO_RSP             = 0x82,
+    EVT_OPCODE_CMD_RSP              = 0x84,
+    EVT_OPCODE_EVENT_NEW            = 0xB3,
+    EVT_OPCODE_EVENT_UPDATE         = 0xB4,
+    EVT_OPCODE_EVENT_CONFLICTING    = 0xB5,
+    EVT_OPCODE_EVENT_TX             = 0xB6,
+    EVT_OPCODE_EVENT_BATCH          = 0xB7,
+    EVT_OPCODE_EVENT_VALUE_DUMP     = 0xB8
+};
+
+/** Status codes in command responses, as aci_status_code_t in mesh_aci.h. */
+enum status_t
+{
+    STATUS_SUCCESS                  = 0x00,
+    STATUS_ERROR_UNKNOWN            = 0x80,
+    STATUS_ERROR_INTERNAL           = 0x81,
+    STATUS_ERROR_CMD_UNKNOWN        = 0x82,
+    STATUS_ERROR_DEVICE_STATE_INVALID = 0x83,
+    STATUS_ERROR_INVALID_LENGTH     = 0x84,
+    STATUS_ERROR_INVALID_PARAMETER  = 0x85,
+    STATUS_ERROR_BUSY               = 0x86,
+    STATUS_ERROR_INVALID_DATA       = 0x87,
+    STATUS_ERROR_PIPE_INVALID       = 0x90
+};
+
+/** Longest frame the device sends or accepts, less the length byte (SERIAL_DATA_MAX_LEN). */
+static const uint32_t FRAME_DATA_MAX_LEN = 36;
+/** Opcode + handle + length of each record in an event batch. */
+static const uint32_t BATCH_RECORD_OVERHEAD = 4;
+/** Commands the device can hold before it has handled any, with the
+    default SERIAL_HANDLER_RX_QUEUE_LENGTH. */
+static const uint32_t DEFAULT_CREDITS = 4;
+/** Cursor of a finished value dump, SERIAL_VALUE_DUMP_CURSOR_END. */
+static const uint16_t VALUE_DUMP_CURSOR_END = 0xFFFF;
+
+/** A command or event frame, as it goes over the wire. */
+struct frame_t
+{
+    uint8_t bytes[1 + 255]; /**< Length byte, opcode, parameters. */
+
+    uint8_t length(void) const { return bytes[0]; }
+    uint8_t opcode(void) const { return bytes[1]; }
+    uint32_t size(void) const { return 1 + bytes[0]; }
+    const uint8_t* params(void) const { return &bytes[2]; }
+    uint32_t params_len(void) const { return (bytes[0] > 0 ? bytes[0] - 1 : 0); }
+
+    /** Status of a command response. */
+    uint8_t status(void) const { return bytes[3]; }
+    /** Opcode of the command a command response is for. */
+    uint8_t command_opcode(void) const { return bytes[2]; }
+};
+
+/** Build a command frame. Returns false if the parameters are too long. */
+inline bool command_build(frame_t* p_frame, uint8_t opcode, const void* p_params, uint32_t params_len)
+{
+    if (1 + params_len > FRAME_DATA_MAX_LEN)
+    {
+        return false;
+    }
+    p_frame->bytes[0] = 1 + params_len;
+    p_frame->bytes[1] = opcode;
+    if (params_len > 0)
+    {
+        memcpy(&p_frame->bytes[2], p_params, params_len);
+    }
+    return true;
+}
+
+inline bool command_value_set(frame_t* p_frame, uint16_t handle, const uint8_t* p_data, uint32_t length)
+{
+    uint8_t params[FRAME_DATA_MAX_LEN];
+    if (2 + length > sizeof(params))
+    {
+        return false;
+    }
+    params[0] = handle & 0xFF;
+    params[1] = handle >> 8;
+    memcpy(&params[2], p_data, length);
+    return command_build(p_frame, CMD_OPCODE_VALUE_SET, params, 2 + length);
+}
+
+inline bool command_value_get(frame_t* p_frame, uint16_t handle)
+{
+    const uint8_t params[] = {(uint8_t) (handle & 0xFF), (uint8_t) (handle >> 8)};
+    return command_build(p_frame, CMD_OPCODE_VALUE_GET, params, sizeof(params));
+}
+
+inline bool command_value_dump(frame_t* p_frame, uint16_t cursor)
+{
+    const uint8_t params[] = {(uint8_t) (cursor & 0xFF), (uint8_t) (cursor >> 8)};
+    return command_build(p_frame, CMD_OPCODE_VALUE_DUMP, params, sizeof(params));
+}
+
+/** Whether a frame is a response to a command, and frees a credit on the device. */
+inline bool is_command_response(const frame_t& evt)
+{
+    return (evt.opcode() == EVT_OPCODE_CMD_RSP || evt.opcode() == EVT_OPCODE_ECHO_RSP);
+}
+
+} /* namespace aci */
+
+#endif /* ACI_PROTOCOL_H__ */
@@ -0,0 +1,90 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef ACI_REACTOR_H__
+#define ACI_REACTOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <atomic>
+#include <vector>
+
+namespace aci
+{
+
+class gateway;
+
+/**
+* @brief Event loop doing the serial I/O of any number of gateways on one
+*   thread, with epoll.
+*
+* @details Each wakeup reads everything the serial ports have buffered in
+*   one read() per port, splits it into frames, and signals each consumer
+*   once for the whole batch. Commands queued since the last wakeup go out
+*   in one write() per port.
+*/
+class reactor
+{
+public:
+    reactor(void);
+    ~reactor();
+
+    /**
+    * Start serving an opened gateway. Call before run(), or from the
+    *   reactor thread. Returns false and sets errno on failure.
+    */
+    bool add(gateway& gw);
+
+    /** Run the event loop on the calling thread until stop() is called. */
+    void run(void);
+
+    /** Make run() return. May be called from any thread. */
+    void stop(void);
+
+private:
+    friend class gateway;
+
+    reactor(const reactor&);
+    reactor& operator=(const reactor&);
+
+    /** Change the epoll events of a gateway's serial port. */
+    void serial_watch(gateway& gw, bool writable);
+
+    /** Stop watching a gateway's serial port before it's closed. */
+    void serial_remove(gateway& gw);
+
+    int m_epoll_fd;
+    int m_stop_fd;
+    std::atomic<bool> m_running;
+    std::vector<gateway*> m_gateways;
+};
+
+} /* namespace aci */
+
+#endif /* ACI_REACTOR_H__ */
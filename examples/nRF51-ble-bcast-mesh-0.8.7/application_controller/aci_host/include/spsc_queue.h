@@ -0,0 +1,142 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef SPSC_QUEUE_H__
+#define SPSC_QUEUE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+namespace aci
+{
+
+static const size_t CACHE_LINE_SIZE = 64;
+
+/**
+* @brief Lock free ring buffer between one producer thread and one consumer
+*   thread. The capacity is rounded up to a power of two.
+*
+* @details The head is only written by the consumer and the tail only by the
+*   producer, a cache line apart, so the two threads don't bounce a
+*   shared line for every element. Each side keeps a copy of the other side's
+*   index, and only reloads it when the ring looks full or empty.
+*/
+template <typename T>
+class spsc_queue
+{
+public:
+    explicit spsc_queue(size_t capacity) :
+        m_head(0), m_tail_cached(0), m_tail(0), m_head_cached(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        m_items.resize(size);
+        m_mask = size - 1;
+    }
+
+    /** Producer side. Returns a slot to fill in, or NULL if the ring is full.
+        The slot is handed to the consumer by push_commit(). */
+    T* push_slot(void)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_cached > m_mask)
+        {
+            m_head_cached = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_cached > m_mask)
+            {
+                return NULL;
+            }
+        }
+        return &m_items[tail & m_mask];
+    }
+
+    void push_commit(void)
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T& item)
+    {
+        T* p_slot = push_slot();
+        if (p_slot == NULL)
+        {
+            return false;
+        }
+        *p_slot = item;
+        push_commit();
+        return true;
+    }
+
+    /** Consumer side. Returns false if the ring is empty. */
+    bool pop(T& item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail_cached)
+        {
+            m_tail_cached = m_tail.load(std::memory_order_acquire);
+            if (head == m_tail_cached)
+            {
+                return false;
+            }
+        }
+        item = m_items[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Number of items in the ring. Only exact when called from one of the two threads. */
+    size_t size(void) const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    spsc_queue(const spsc_queue&);
+    spsc_queue& operator=(const spsc_queue&);
+
+    /* padded rather than aligned, as the queue may be allocated with a
+       plain new, which doesn't honour over-alignment before C++17. */
+    std::atomic<size_t> m_head;             /**< Next item to pop, written by the consumer. */
+    size_t m_tail_cached;                   /**< Consumer's copy of the tail. */
+    char m_pad0[CACHE_LINE_SIZE];
+    std::atomic<size_t> m_tail;             /**< Next slot to fill, written by the producer. */
+    size_t m_head_cached;                   /**< Producer's copy of the head. */
+    char m_pad1[CACHE_LINE_SIZE];
+    std::vector<T> m_items;
+    size_t m_mask;
+};
+
+} /* namespace aci */
+
+#endif /* SPSC_QUEUE_H__ */
@@ -0,0 +1,491 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "aci_gateway.h"
+#include "aci_reactor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+/** Bytes taken from the serial port in one read(). Room for many frames, so
+    a busy port is emptied with few system calls. */
+#define RX_READ_SIZE        (4096)
+
+namespace aci
+{
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint64_t time_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool baudrate_to_speed(uint32_t baudrate, speed_t* p_speed)
+{
+    switch (baudrate)
+    {
+        case 9600:      *p_speed = B9600;       return true;
+        case 19200:     *p_speed = B19200;      return true;
+        case 38400:     *p_speed = B38400;      return true;
+        case 57600:     *p_speed = B57600;      return true;
+        case 115200:    *p_speed = B115200;     return true;
+        case 230400:    *p_speed = B230400;     return true;
+        case 460800:    *p_speed = B460800;     return true;
+        case 921600:    *p_speed = B921600;     return true;
+        case 1000000:   *p_speed = B1000000;    return true;
+        default:        return false;
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+gateway::gateway(const std::string& port, const gateway_config_t& config) :
+    m_port(port),
+    m_config(config),
+    m_serial_fd(-1),
+    m_event_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+    m_command_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+    mp_reactor(NULL),
+    m_open(false),
+    m_credits(config.credits),
+    m_rx_buf(RX_READ_SIZE),
+    m_rx_len(0),
+    m_watching_writable(false),
+    m_event_signal(false),
+    m_events(config.event_queue_length)
+{
+    m_serial_watch.p_gateway = this;
+    m_serial_watch.is_serial = true;
+    m_command_watch.p_gateway = this;
+    m_command_watch.is_serial = false;
+
+    m_stats.rx_bytes = 0;
+    m_stats.rx_reads = 0;
+    m_stats.rx_frames = 0;
+    m_stats.tx_bytes = 0;
+    m_stats.tx_writes = 0;
+    m_stats.tx_frames = 0;
+    m_stats.events_dropped = 0;
+    m_stats.command_timeouts = 0;
+    m_stats.framing_errors = 0;
+}
+
+gateway::~gateway()
+{
+    if (m_serial_fd >= 0)
+    {
+        close(m_serial_fd);
+    }
+    close(m_event_fd);
+    close(m_command_fd);
+}
+
+bool gateway::open(void)
+{
+    speed_t speed;
+    if (m_event_fd < 0 || m_command_fd < 0)
+    {
+        return false;
+    }
+    if (!baudrate_to_speed(m_config.baudrate, &speed))
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    int fd = ::open(m_port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    if (m_config.rtscts)
+    {
+        tio.c_cflag |= CRTSCTS;
+    }
+    else
+    {
+        tio.c_cflag &= ~CRTSCTS;
+    }
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio) != 0)
+    {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        return false;
+    }
+    /* whatever the device sent before we were listening is likely cut off */
+    tcflush(fd, TCIOFLUSH);
+
+    m_serial_fd = fd;
+    m_open = true;
+    return true;
+}
+
+bool gateway::command_send(const frame_t& cmd)
+{
+    if (!m_open || cmd.length() == 0 || cmd.length() > FRAME_DATA_MAX_LEN)
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_command_lock);
+        if (m_commands.size() >= m_config.command_queue_length)
+        {
+            return false;
+        }
+        m_commands.push_back(cmd);
+    }
+    (void) eventfd_write(m_command_fd, 1);
+    return true;
+}
+
+bool gateway::event_get(frame_t& evt)
+{
+    return m_events.pop(evt);
+}
+
+bool gateway::event_wait(frame_t& evt, int timeout_ms)
+{
+    const uint64_t deadline = time_now_ms() + (timeout_ms > 0 ? timeout_ms : 0);
+    int wait_ms = timeout_ms;
+    while (true)
+    {
+        /* the reactor signals after pushing, so an event pushed after this
+           check wakes up the poll below. */
+        if (m_events.pop(evt))
+        {
+            return true;
+        }
+        if (timeout_ms == 0)
+        {
+            return false;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = m_event_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, wait_ms) < 0 && errno != EINTR)
+        {
+            return false;
+        }
+        eventfd_t count;
+        (void) eventfd_read(m_event_fd, &count);
+
+        if (m_events.pop(evt))
+        {
+            return true;
+        }
+        if (timeout_ms > 0)
+        {
+            const uint64_t now = time_now_ms();
+            if (now >= deadline)
+            {
+                return false;
+            }
+            wait_ms = (int) (deadline - now);
+        }
+    }
+}
+
+gateway_stats_t gateway::stats_get(void) const
+{
+    gateway_stats_t stats;
+    stats.rx_bytes = m_stats.rx_bytes;
+    stats.rx_reads = m_stats.rx_reads;
+    stats.rx_frames = m_stats.rx_frames;
+    stats.tx_bytes = m_stats.tx_bytes;
+    stats.tx_writes = m_stats.tx_writes;
+    stats.tx_frames = m_stats.tx_frames;
+    stats.events_dropped = m_stats.events_dropped;
+    stats.command_timeouts = m_stats.command_timeouts;
+    stats.framing_errors = m_stats.framing_errors;
+    return stats;
+}
+
+/*****************************************************************************
+* Reactor thread functions
+*****************************************************************************/
+void gateway::serial_readable(void)
+{
+    while (m_serial_fd >= 0)
+    {
+        const size_t space = m_rx_buf.size() - m_rx_len;
+        const ssize_t len = read(m_serial_fd, &m_rx_buf[m_rx_len], space);
+        if (len < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        if (len <= 0)
+        {
+            /* the device is gone, a USB serial port that was unplugged */
+            serial_close();
+            break;
+        }
+        m_stats.rx_bytes += len;
+        m_stats.rx_reads++;
+        m_rx_len += len;
+
+        uint32_t i = 0;
+        while (i < m_rx_len)
+        {
+            const uint8_t frame_len = m_rx_buf[i];
+            if (frame_len == 0)
+            {
+                m_stats.framing_errors++;
+                i++;
+                continue;
+            }
+            if (m_rx_len - i < 1U + frame_len)
+            {
+                break;
+            }
+            frame_received(&m_rx_buf[i]);
+            i += 1 + frame_len;
+        }
+        m_rx_len -= i;
+        memmove(&m_rx_buf[0], &m_rx_buf[i], m_rx_len);
+
+        if ((size_t) len < space)
+        {
+            /* the driver had less than we asked for, so it's empty */
+            break;
+        }
+    }
+
+    if (m_event_signal)
+    {
+        /* one wakeup for all the events of this read */
+        m_event_signal = false;
+        (void) eventfd_write(m_event_fd, 1);
+    }
+    /* the responses may have freed credits */
+    commands_flush();
+}
+
+void gateway::serial_writable(void)
+{
+    tx_flush();
+}
+
+void gateway::commands_flush(void)
+{
+    if (m_serial_fd < 0)
+    {
+        return;
+    }
+    const uint64_t deadline = time_now_ms() + m_config.command_timeout_ms;
+    {
+        std::lock_guard<std::mutex> lock(m_command_lock);
+        while (!m_commands.empty() && m_in_flight.size() < m_credits)
+        {
+            const frame_t& cmd = m_commands.front();
+            m_tx_buf.insert(m_tx_buf.end(), &cmd.bytes[0], &cmd.bytes[cmd.size()]);
+            /* a radio reset is answered by a device started event, not a command response */
+            if (cmd.opcode() != CMD_OPCODE_RADIO_RESET)
+            {
+                m_in_flight.push_back(std::make_pair(cmd.opcode(), deadline));
+            }
+            m_stats.tx_frames++;
+            m_commands.pop_front();
+        }
+    }
+    tx_flush();
+}
+
+void gateway::tx_flush(void)
+{
+    size_t sent = 0;
+    while (sent < m_tx_buf.size() && m_serial_fd >= 0)
+    {
+        const ssize_t len = write(m_serial_fd, &m_tx_buf[sent], m_tx_buf.size() - sent);
+        if (len < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (len < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                serial_close();
+                return;
+            }
+            break;
+        }
+        sent += len;
+        m_stats.tx_bytes += len;
+        m_stats.tx_writes++;
+    }
+    m_tx_buf.erase(m_tx_buf.begin(), m_tx_buf.begin() + sent);
+
+    /* only ask for writable events while the driver holds us back */
+    const bool blocked = !m_tx_buf.empty();
+    if (blocked != m_watching_writable && m_serial_fd >= 0)
+    {
+        m_watching_writable = blocked;
+        mp_reactor->serial_watch(*this, blocked);
+    }
+}
+
+void gateway::timeouts_check(uint64_t now_ms)
+{
+    bool freed = false;
+    while (!m_in_flight.empty() && m_in_flight.front().second <= now_ms)
+    {
+        m_in_flight.pop_front();
+        m_stats.command_timeouts++;
+        freed = true;
+    }
+    if (freed)
+    {
+        commands_flush();
+    }
+}
+
+void gateway::serial_close(void)
+{
+    mp_reactor->serial_remove(*this);
+    close(m_serial_fd);
+    m_serial_fd = -1;
+    m_open = false;
+    m_in_flight.clear();
+    m_tx_buf.clear();
+}
+
+void gateway::frame_received(const uint8_t* p_frame)
+{
+    const uint8_t length = p_frame[0];
+    const uint8_t opcode = p_frame[1];
+    m_stats.rx_frames++;
+
+    switch (opcode)
+    {
+        case EVT_OPCODE_CMD_RSP:
+        case EVT_OPCODE_ECHO_RSP:
+        {
+            /* responses come in command order. Commands ahead of the one
+               answered got lost on the way, and won't be answered. */
+            const uint8_t cmd_opcode = (opcode == EVT_OPCODE_ECHO_RSP ? (uint8_t) CMD_OPCODE_ECHO : p_frame[2]);
+            for (size_t i = 0; i < m_in_flight.size(); ++i)
+            {
+                if (m_in_flight[i].first == cmd_opcode)
+                {
+                    m_in_flight.erase(m_in_flight.begin(), m_in_flight.begin() + i + 1);
+                    break;
+                }
+            }
+            break;
+        }
+
+        case EVT_OPCODE_DEVICE_STARTED:
+            /* the device forgot about the commands it had, and says how
+               many it can take now. */
+            m_in_flight.clear();
+            m_credits = (length >= 4 && p_frame[4] > 0 ? p_frame[4] : m_config.credits);
+            break;
+
+        case EVT_OPCODE_EVENT_BATCH:
+            if (m_config.unbatch)
+            {
+                uint32_t i = 2;
+                const uint32_t end = 1 + length;
+                while (i + BATCH_RECORD_OVERHEAD <= end)
+                {
+                    const uint8_t data_len = p_frame[i + 3];
+                    if (i + BATCH_RECORD_OVERHEAD + data_len > end)
+                    {
+                        m_stats.framing_errors++;
+                        break;
+                    }
+                    /* the record is a value event without the length byte */
+                    frame_t evt;
+                    evt.bytes[0] = 3 + data_len;
+                    memcpy(&evt.bytes[1], &p_frame[i], 3);
+                    memcpy(&evt.bytes[4], &p_frame[i + BATCH_RECORD_OVERHEAD], data_len);
+                    event_push(evt.bytes, evt.size());
+                    i += BATCH_RECORD_OVERHEAD + data_len;
+                }
+                return;
+            }
+            break;
+
+        default:
+            break;
+    }
+    event_push(p_frame, 1 + length);
+}
+
+void gateway::event_push(const uint8_t* p_frame, uint32_t size)
+{
+    frame_t* p_slot = m_events.push_slot();
+    if (p_slot == NULL)
+    {
+        m_stats.events_dropped++;
+        return;
+    }
+    memcpy(p_slot->bytes, p_frame, size);
+    m_events.push_commit();
+    m_event_signal = true;
+}
+
+} /* namespace aci */
@@ -0,0 +1,177 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "aci_reactor.h"
+#include "aci_gateway.h"
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define EPOLL_EVENTS_MAX            (64)
+/** Interval of the command timeout checks. */
+#define HOUSEKEEPING_INTERVAL_MS    (100)
+
+namespace aci
+{
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint64_t time_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool epoll_watch(int epoll_fd, int op, int fd, uint32_t events, void* p_data)
+{
+    struct epoll_event evt;
+    evt.events = events;
+    evt.data.ptr = p_data;
+    return (epoll_ctl(epoll_fd, op, fd, &evt) == 0);
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+reactor::reactor(void) :
+    m_epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+    m_stop_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+    m_running(false)
+{
+    /* the stop signal is the only watch without a gateway */
+    (void) epoll_watch(m_epoll_fd, EPOLL_CTL_ADD, m_stop_fd, EPOLLIN, NULL);
+}
+
+reactor::~reactor()
+{
+    close(m_stop_fd);
+    close(m_epoll_fd);
+}
+
+bool reactor::add(gateway& gw)
+{
+    if (gw.m_serial_fd < 0)
+    {
+        errno = EBADF;
+        return false;
+    }
+    gw.mp_reactor = this;
+    if (!epoll_watch(m_epoll_fd, EPOLL_CTL_ADD, gw.m_serial_fd, EPOLLIN, &gw.m_serial_watch))
+    {
+        return false;
+    }
+    /* commands queued before now keep the event fd readable, and go out on the first wakeup */
+    if (!epoll_watch(m_epoll_fd, EPOLL_CTL_ADD, gw.m_command_fd, EPOLLIN, &gw.m_command_watch))
+    {
+        (void) epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, gw.m_serial_fd, NULL);
+        return false;
+    }
+    m_gateways.push_back(&gw);
+    return true;
+}
+
+void reactor::run(void)
+{
+    struct epoll_event events[EPOLL_EVENTS_MAX];
+    uint64_t next_housekeeping = time_now_ms() + HOUSEKEEPING_INTERVAL_MS;
+
+    m_running = true;
+    while (m_running)
+    {
+        const int count = epoll_wait(m_epoll_fd, events, EPOLL_EVENTS_MAX, HOUSEKEEPING_INTERVAL_MS);
+        for (int i = 0; i < count; ++i)
+        {
+            gateway::watch_t* p_watch = (gateway::watch_t*) events[i].data.ptr;
+            if (p_watch == NULL)
+            {
+                eventfd_t value;
+                (void) eventfd_read(m_stop_fd, &value);
+            }
+            else if (p_watch->is_serial)
+            {
+                if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                {
+                    p_watch->p_gateway->serial_readable();
+                }
+                if (events[i].events & EPOLLOUT)
+                {
+                    p_watch->p_gateway->serial_writable();
+                }
+            }
+            else
+            {
+                eventfd_t value;
+                (void) eventfd_read(p_watch->p_gateway->m_command_fd, &value);
+                p_watch->p_gateway->commands_flush();
+            }
+        }
+
+        const uint64_t now = time_now_ms();
+        if (now >= next_housekeeping)
+        {
+            for (size_t i = 0; i < m_gateways.size(); ++i)
+            {
+                m_gateways[i]->timeouts_check(now);
+            }
+            next_housekeeping = now + HOUSEKEEPING_INTERVAL_MS;
+        }
+    }
+}
+
+void reactor::stop(void)
+{
+    m_running = false;
+    (void) eventfd_write(m_stop_fd, 1);
+}
+
+/*****************************************************************************
+* Gateway functions
+*****************************************************************************/
+void reactor::serial_watch(gateway& gw, bool writable)
+{
+    (void) epoll_watch(m_epoll_fd, EPOLL_CTL_MOD, gw.m_serial_fd,
+            EPOLLIN | (writable ? (uint32_t) EPOLLOUT : 0), &gw.m_serial_watch);
+}
+
+void reactor::serial_remove(gateway& gw)
+{
+    /* the events already returned by this epoll_wait() may still point at
+       the gateway, which is fine as it stays around. */
+    (void) epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, gw.m_serial_fd, NULL);
+}
+
+} /* namespace aci */
@@ -18,6 +18,9 @@ def AciCommandLookUp(CommandOpCode):
         AciAccessAddressGet.OpCode: "AccessAddressGet",
         AciChannelGet.OpCode: "ChannelGet",
         AciIntervalMinMsGet.OpCode: "IntervalMinMsGet",
+        AciValueSetBulk.OpCode: "ValueSetBulk",
+        AciValueGetBulk.OpCode: "ValueGetBulk",
+        AciValueDump.OpCode: "ValueDump",
     }
 
     if CommandOpCode in commandNameLUT:
@@ -166,3 +169,39 @@ class AciIntervalMinMsGet(AciCommandPkt):
     Length = 1
     def __init__(self):
         super(AciIntervalMinMsGet, self).__init__(length=self.Length,OpCode=self.OpCode)
+
+class AciValueSetBulk(AciCommandPkt):
+    OpCode = 0x79
+    MAX_COUNT = 16
+    MAX_LENGTH = 36
+    # values is a list of (handle, data) pairs
+    def __init__(self, values):
+        payload = []
+        for handle, data in values:
+            payload.extend(valueToByteArray(handle,2))
+            payload.append(len(data))
+            payload.extend(data)
+        if len(values) > self.MAX_COUNT or len(payload) + 1 > self.MAX_LENGTH:
+            logging.error("VALUE_SET_BULK command can have a maximum of %d values and %d bytes (including the opcode)", self.MAX_COUNT, self.MAX_LENGTH)
+        else:
+            super(AciValueSetBulk, self).__init__(length=len(payload) + 1, OpCode=self.OpCode, data=payload)
+
+class AciValueGetBulk(AciCommandPkt):
+    OpCode = 0x6F
+    MAX_COUNT = 16
+    def __init__(self, handles):
+        if len(handles) > self.MAX_COUNT:
+            logging.error("VALUE_GET_BULK command can have a maximum of %d handles", self.MAX_COUNT)
+        else:
+            payload = []
+            for handle in handles:
+                payload.extend(valueToByteArray(handle,2))
+            super(AciValueGetBulk, self).__init__(length=len(payload) + 1, OpCode=self.OpCode, data=payload)
+
+class AciValueDump(AciCommandPkt):
+    OpCode = 0x6C
+    Length = 3
+    CURSOR_END = 0xFFFF
+    # cursor is 0 to start, or the cursor from the last response or dump event to resume
+    def __init__(self, cursor=0):
+        super(AciValueDump, self).__init__(length=self.Length, OpCode=self.OpCode, data=valueToByteArray(cursor,2))
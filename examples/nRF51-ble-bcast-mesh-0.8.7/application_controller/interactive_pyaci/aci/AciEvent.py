@@ -1,17 +1,20 @@
 import logging
 from aci import AciCommand
 
-MAX_DATA_LENGTH = 30
+MAX_DATA_LENGTH = 36
 
 def AciEventDeserialize(pkt):
     eventLUT = {
         0x81: AciDeviceStarted,
         0x82: AciEchoRsp,
         0x84: AciCmdRsp,
+        0x78: AciEventDfu,
         0xB3: AciEventNew,
         0xB4: AciEventUpdate,
         0xB5: AciEventConflicting,
-        0xB6: AciEventTX
+        0xB6: AciEventTX,
+        0xB7: AciEventBatch,
+        0xB8: AciEventValueDump
     }
 
     opcode = pkt[1]
@@ -118,4 +121,60 @@ class AciEventConflicting(AciEventNew):
 class AciEventTX(AciEventNew):
     #OpCode = 0xB6
     def __init__(self,pkt):
-        super(AciEventTX, self).__init__(pkt)
\ No newline at end of file
+        super(AciEventTX, self).__init__(pkt)
+
+class AciEventBatch(AciEventPkt):
+    #OpCode = 0xB7
+    def __init__(self,pkt):
+        super(AciEventBatch, self).__init__(pkt)
+        self.Events = []
+        # records: opcode, handle (2 bytes), length, data
+        i = 2
+        end = self.Len + 1
+        while i + 4 <= end:
+            length = pkt[i + 3]
+            if i + 4 + length > end:
+                logging.error("Invalid record in %s event: %s", self.__class__.__name__, str(pkt))
+                break
+            record = [3 + length, pkt[i], pkt[i + 1], pkt[i + 2]] + list(pkt[i + 4:i + 4 + length])
+            self.Events.append(AciEventDeserialize(record))
+            i += 4 + length
+
+    def __repr__(self):
+        return str.format("I am %s and my Lenght is %d, OpCode is 0x%02x, and Events are %s" %(self.__class__.__name__, self.Len, self.OpCode, self.Events))
+
+class AciEventValueDump(AciEventPkt):
+    #OpCode = 0xB8
+    def __init__(self,pkt):
+        super(AciEventValueDump, self).__init__(pkt)
+        self.Values = []
+        if self.Len < 3:
+            logging.error("Invalid length for %s event: %s", self.__class__.__name__, str(pkt))
+            return
+        self.Cursor = pkt[2] | (pkt[3] << 8)
+        # records: handle (2 bytes), version (2 bytes), length, data
+        i = 4
+        end = self.Len + 1
+        while i + 5 <= end:
+            length = pkt[i + 4]
+            if i + 5 + length > end:
+                logging.error("Invalid record in %s event: %s", self.__class__.__name__, str(pkt))
+                break
+            self.Values.append((pkt[i] | (pkt[i + 1] << 8), pkt[i + 2] | (pkt[i + 3] << 8), list(pkt[i + 5:i + 5 + length])))
+            i += 5 + length
+
+    def __repr__(self):
+        return str.format("I am %s and my Lenght is %d, OpCode is 0x%02x, Cursor is 0x%04x, and Values are %s" %(self.__class__.__name__, self.Len, self.OpCode, self.Cursor, self.Values))
+
+class AciEventDfu(AciEventPkt):
+    #OpCode = 0x78
+    def __init__(self,pkt):
+        super(AciEventDfu, self).__init__(pkt)
+        if self.Len < 3:
+            logging.error("Invalid length for %s event: %s", self.__class__.__name__, str(pkt))
+        else:
+            self.PacketType = pkt[2] | (pkt[3] << 8)
+            self.Data = pkt[4:]
+
+    def __repr__(self):
+        return str.format("I am %s and my Lenght is %d, OpCode is 0x%02x, PacketType is 0x%04x, and Data is %s" %(self.__class__.__name__, self.Len, self.OpCode, self.PacketType, self.Data))
@@ -0,0 +1,237 @@
+import sys
+import time
+import random
+import struct
+import logging
+import collections
+from queue import Queue, Empty
+from argparse import ArgumentParser
+from aci import AciCommand, AciEvent
+from aci_serial import AciUart
+
+SEGMENT_LENGTH = 16
+
+DFU_PACKET_TYPE_DATA_REQ_BITMAP = 0xFFF9
+DFU_PACKET_TYPE_DATA_REQ        = 0xFFFB
+DFU_PACKET_TYPE_DATA            = 0xFFFC
+DFU_PACKET_TYPE_STATE           = 0xFFFD
+DFU_PACKET_TYPE_FWID            = 0xFFFE
+
+DFU_TYPE_APP = 0x04
+
+START_FLAG_FIRST = 0x04
+START_FLAG_LAST  = 0x08
+
+STATUS_SUCCESS = 0x00
+
+DFU_OPCODE = AciCommand.AciDfuData.OpCode
+
+# The UART serial handler only queues this many commands before it stops
+# receiving, so there's no point in having more than this in flight without
+# flow control.
+DEFAULT_WINDOW = 4
+
+
+class DfuImage(object):
+    """Application image split into DFU segments, numbered from 1 like in the
+    bootloader. Segment 1 starts at the start address, the rest are aligned to
+    SEGMENT_LENGTH."""
+    def __init__(self, data, start_addr):
+        self.start_addr = start_addr
+        head = start_addr & (SEGMENT_LENGTH - 1)
+        # The bootloader counts the length in words.
+        pad = (-len(data)) % 4
+        self.data = bytes(data) + b'\xFF' * pad
+        self.length = len(self.data)
+        self.head = head
+        self.segment_count = (head + self.length + SEGMENT_LENGTH - 1) // SEGMENT_LENGTH
+
+    def segment(self, index):
+        if index == 1:
+            chunk = self.data[:SEGMENT_LENGTH - self.head]
+        else:
+            offset = (index - 1) * SEGMENT_LENGTH - self.head
+            chunk = self.data[offset:offset + SEGMENT_LENGTH]
+        return chunk + b'\xFF' * (SEGMENT_LENGTH - len(chunk))
+
+
+def app_fwid(company_id, app_id, app_version):
+    return struct.pack('<IHI', company_id, app_id, app_version)
+
+def fwid_packet(sd, bl_id, bl_version, fwid):
+    return struct.pack('<HHBB', DFU_PACKET_TYPE_FWID, sd, bl_id, bl_version) + fwid
+
+def state_packet(tid, fwid, authority=7):
+    return struct.pack('<HBBI', DFU_PACKET_TYPE_STATE, DFU_TYPE_APP, authority & 0x07, tid) + fwid
+
+def start_packet(tid, image):
+    return struct.pack('<HHIIIHB', DFU_PACKET_TYPE_DATA, 0, tid, image.start_addr,
+                       image.length // 4, 0, START_FLAG_FIRST | START_FLAG_LAST)
+
+def data_packet(tid, image, segment):
+    return struct.pack('<HHI', DFU_PACKET_TYPE_DATA, segment, tid) + image.segment(segment)
+
+
+class DfuPush(object):
+    """Windowed DFU sender.
+
+    Keeps up to window DFU commands in flight, instead of waiting for each
+    command response. The serial handler responds to commands in order, so
+    each response belongs to the oldest outstanding command. Segments that
+    are rejected, or requested by the mesh through a DATA_REQ or
+    DATA_REQ_BITMAP, are sent again.
+    """
+    def __init__(self, acidev, image, tid, window=DEFAULT_WINDOW, ack_timeout=0.5):
+        self.acidev = acidev
+        self.image = image
+        self.tid = tid
+        self.window = window
+        self.ack_timeout = ack_timeout
+        self.events = Queue()
+        self.in_flight = collections.deque()
+        self.pending = collections.deque(range(1, image.segment_count + 1))
+        self.acked = set()
+        self.retransmits = 0
+        self.sent_bytes = 0
+        self.last_ack_time = 0
+        acidev.AddPacketRecipient(self.events.put)
+
+    def send_packet(self, packet):
+        cmd = AciCommand.AciDfuData(data=list(packet), length=len(packet) + 1)
+        self.acidev.WriteData(cmd.serialize())
+        # the device doesn't wait for anyone to read its event list
+        self.acidev.events.clear()
+
+    def send_and_wait(self, packet, timeout=1.0):
+        """Stop-and-wait send, used for the packets leading up to the data."""
+        self.send_packet(packet)
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            evt = self.next_event(deadline - time.time())
+            if isinstance(evt, AciEvent.AciCmdRsp) and evt.CommandOpCode == DFU_OPCODE:
+                return evt.StatusCode
+        return None
+
+    def next_event(self, timeout):
+        try:
+            return self.events.get(timeout=max(timeout, 0))
+        except Empty:
+            return None
+
+    def request_segments(self, segments):
+        for segment in segments:
+            if 1 <= segment <= self.image.segment_count and segment not in self.pending:
+                self.acked.discard(segment)
+                self.pending.appendleft(segment)
+                self.retransmits += 1
+
+    def handle_event(self, evt):
+        if isinstance(evt, AciEvent.AciCmdRsp) and evt.CommandOpCode == DFU_OPCODE:
+            if self.in_flight:
+                segment = self.in_flight.popleft()
+                if evt.StatusCode == STATUS_SUCCESS:
+                    self.acked.add(segment)
+                else:
+                    self.request_segments([segment])
+            self.last_ack_time = time.time()
+        elif isinstance(evt, AciEvent.AciEventDfu) and len(evt.Data) >= 6:
+            segment, tid = struct.unpack('<HI', bytes(evt.Data[:6]))
+            if tid != self.tid:
+                return
+            if evt.PacketType == DFU_PACKET_TYPE_DATA_REQ:
+                self.request_segments([segment])
+            elif evt.PacketType == DFU_PACKET_TYPE_DATA_REQ_BITMAP and len(evt.Data) >= 10:
+                missing = struct.unpack('<I', bytes(evt.Data[6:10]))[0]
+                self.request_segments([segment + i for i in range(32) if missing & (1 << i)])
+
+    def progress(self, start_time):
+        elapsed = max(time.time() - start_time, 1e-3)
+        sys.stdout.write("\r%5.1f%% (%d/%d segments) %6.0f B/s, %d retransmits " % (
+            100.0 * len(self.acked) / self.image.segment_count,
+            len(self.acked), self.image.segment_count,
+            self.sent_bytes / elapsed,
+            self.retransmits))
+        sys.stdout.flush()
+
+    def run(self, linger=2.0):
+        start_time = time.time()
+        self.last_ack_time = start_time
+        last_progress = 0
+        while True:
+            while self.pending and len(self.in_flight) < self.window:
+                segment = self.pending.popleft()
+                self.send_packet(data_packet(self.tid, self.image, segment))
+                self.in_flight.append(segment)
+                self.sent_bytes += SEGMENT_LENGTH
+
+            evt = self.next_event(self.ack_timeout / 4)
+            if evt:
+                self.handle_event(evt)
+
+            now = time.time()
+            if self.in_flight and now - self.last_ack_time > self.ack_timeout:
+                # responses got lost, send everything that's outstanding again
+                logging.debug("Response timeout, resending %d segments", len(self.in_flight))
+                self.request_segments(list(self.in_flight))
+                self.in_flight.clear()
+                self.last_ack_time = now
+
+            if now - last_progress > 0.2:
+                self.progress(start_time)
+                last_progress = now
+
+            # keep serving requests from the mesh for a while after the last segment
+            if not self.pending and not self.in_flight and now - self.last_ack_time > linger:
+                break
+        self.progress(start_time)
+        sys.stdout.write("\n")
+        return len(self.acked) == self.image.segment_count
+
+
+def push(options):
+    with open(options.image, 'rb') as f:
+        image = DfuImage(f.read(), options.start_addr)
+
+    tid = options.tid if options.tid else random.randint(1, 0xFFFFFFFF)
+    fwid = app_fwid(options.company_id, options.app_id, options.app_version)
+    acidev = AciUart.AciUart(port=options.device, baudrate=options.baudrate, rtscts=options.rtscts)
+    sender = DfuPush(acidev, image, tid, window=options.window)
+    try:
+        print("Pushing %d bytes (%d segments) to 0x%08x, TID 0x%08x, window %d" %
+              (image.length, image.segment_count, image.start_addr, tid, options.window))
+        sender.send_and_wait(fwid_packet(options.sd_version, options.bl_id, options.bl_version, fwid))
+        sender.send_and_wait(state_packet(tid, fwid))
+        # give the mesh time to pick up the ready beacon before starting
+        time.sleep(options.start_delay)
+        status = sender.send_and_wait(start_packet(tid, image))
+        if status != STATUS_SUCCESS:
+            print("DFU start failed (%s)" % (AciEvent.AciStatusLookUp(status) if status is not None else "no response"))
+            return 1
+        return 0 if sender.run() else 1
+    finally:
+        acidev.stop()
+
+
+def auto_int(x):
+    return int(x, 0)
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser(description="Push an application image into the mesh through a serial DFU node")
+    parser.add_argument("-d", "--device", dest="device", required=True, help="Device Communication port, e.g. COM216")
+    parser.add_argument("-b", "--baudrate", dest="baudrate", required=False, default='115200', help="Baud rate")
+    parser.add_argument("--rtscts", dest="rtscts", action="store_true", help="Use hardware flow control")
+    parser.add_argument("-i", "--image", dest="image", required=True, help="Application binary (objcopy -O binary)")
+    parser.add_argument("--start-addr", dest="start_addr", type=auto_int, required=True, help="Start address of the application")
+    parser.add_argument("--company-id", dest="company_id", type=auto_int, required=True)
+    parser.add_argument("--app-id", dest="app_id", type=auto_int, required=True)
+    parser.add_argument("--app-version", dest="app_version", type=auto_int, required=True)
+    parser.add_argument("--sd-version", dest="sd_version", type=auto_int, default=0xFFFE, help="Softdevice FWID to announce")
+    parser.add_argument("--bl-id", dest="bl_id", type=auto_int, default=0)
+    parser.add_argument("--bl-version", dest="bl_version", type=auto_int, default=0)
+    parser.add_argument("--tid", dest="tid", type=auto_int, default=0, help="Transaction ID, random if not set")
+    parser.add_argument("-w", "--window", dest="window", type=int, default=DEFAULT_WINDOW, help="Number of segments in flight")
+    parser.add_argument("--start-delay", dest="start_delay", type=float, default=1.0, help="Seconds between the ready beacon and the start packet")
+    options = parser.parse_args()
+    logging.basicConfig(level=logging.INFO)
+    sys.exit(push(options))
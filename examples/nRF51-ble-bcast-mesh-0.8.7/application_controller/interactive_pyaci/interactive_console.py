@@ -40,6 +40,15 @@ class Interactive(object):
     def ValueGet(self, Handle):
         self.acidev.write_aci_cmd(AciCommand.AciValueGet(handle=Handle))
 
+    def ValueSetBulk(self, Values):
+        self.acidev.write_aci_cmd(AciCommand.AciValueSetBulk(values=Values))
+
+    def ValueGetBulk(self, Handles):
+        self.acidev.write_aci_cmd(AciCommand.AciValueGetBulk(handles=Handles))
+
+    def ValueDump(self, Cursor=0):
+        self.acidev.write_aci_cmd(AciCommand.AciValueDump(cursor=Cursor))
+
     def Start(self):
         self.acidev.write_aci_cmd(AciCommand.AciStart())
 
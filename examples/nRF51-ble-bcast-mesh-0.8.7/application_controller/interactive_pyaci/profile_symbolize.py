@@ -0,0 +1,95 @@
+import re
+import sys
+import bisect
+import collections
+from argparse import ArgumentParser
+from elftools.elf.elffile import ELFFile
+from elftools.elf.sections import SymbolTableSection
+
+# Sums the dumps of the sampling profiler (MESH_PROFILER, see mesh_profiler.h)
+# per function. Save the RTT terminal output of the device, with for example
+#   JLinkRTTLogger -Device NRF51822_XXAA -If SWD -Speed 4000 -RTTChannel 0 rtt.log
+# and symbolize it with
+#   python profile_symbolize.py _build/app.elf rtt.log
+
+HEADER = re.compile(r'PROFILE samples (\d+) other (\d+) interval_us (\d+) shift (\d+)')
+END = re.compile(r'PROFILE end')
+SAMPLE = re.compile(r'^([0-9a-fA-F]+) (\d+)$')
+
+
+class Symbols(object):
+    def __init__(self, elf_file):
+        functions = []
+        for section in ELFFile(elf_file).iter_sections():
+            if not isinstance(section, SymbolTableSection):
+                continue
+            for symbol in section.iter_symbols():
+                if symbol['st_info']['type'] == 'STT_FUNC' and symbol['st_size'] > 0:
+                    # clear the thumb bit
+                    functions.append((symbol['st_value'] & ~1, symbol['st_size'], symbol.name))
+        functions.sort()
+        self.starts = [f[0] for f in functions]
+        self.functions = functions
+
+    def get(self, address):
+        i = bisect.bisect_right(self.starts, address) - 1
+        if i >= 0:
+            (start, size, name) = self.functions[i]
+            if address < start + size:
+                return name
+        return '0x%08x' % address
+
+
+def parse(log):
+    """Yield (samples, other, {location: count}) for each complete dump."""
+    dump = None
+    for line in log:
+        line = line.strip()
+        header = HEADER.search(line)
+        if header:
+            dump = (int(header.group(1)), int(header.group(2)), {})
+            continue
+        if dump is None:
+            continue
+        if END.search(line):
+            yield dump
+            dump = None
+            continue
+        sample = SAMPLE.match(line)
+        if sample:
+            dump[2][int(sample.group(1), 16)] = int(sample.group(2))
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser(description='Sum the sampling profiler dumps per function.')
+    parser.add_argument('elf', help='ELF file of the running build')
+    parser.add_argument('log', help='RTT terminal output with the dumps')
+    parser.add_argument('-n', '--count', type=int, default=30, help='Number of functions to list')
+    options = parser.parse_args()
+
+    with open(options.elf, 'rb') as elf_file:
+        symbols = Symbols(elf_file)
+
+    per_function = collections.Counter()
+    total = 0
+    other = 0
+    with open(options.log, 'r', errors='replace') as log:
+        for (samples, dump_other, locations) in parse(log):
+            total += samples
+            other += dump_other
+            # the counts are halved on overflow, so scale them back to the samples
+            counted = sum(locations.values())
+            if counted == 0:
+                continue
+            scale = float(samples - dump_other) / counted
+            for (location, count) in locations.items():
+                per_function[symbols.get(location)] += count * scale
+
+    counted = sum(per_function.values())
+    if counted == 0:
+        print('No samples found.')
+        sys.exit(1)
+
+    print('%u samples, %u outside the table' % (total, other))
+    for (name, count) in per_function.most_common(options.count):
+        print('%6.2f%% %s' % (100.0 * count / counted, name))
@@ -0,0 +1,97 @@
+import re
+import sys
+import struct
+from argparse import ArgumentParser
+from elftools.elf.elffile import ELFFile
+
+# Decodes the records of the deferred RTT logger (RTT_LOG_DEFERRED, see
+# rtt_log.h), as written to the RTT channel by rtt_log_flush(). Save the
+# channel with for example
+#   JLinkRTTLogger -Device NRF51822_XXAA -If SWD -Speed 4000 -RTTChannel 1 log.bin
+# and decode it with
+#   python rtt_log_decode.py _build/app.elf log.bin
+
+RECORD_MAGIC = 0xA5
+
+FORMAT_SPEC = re.compile(r'%([-0]*)(\d*)(?:\.(\d+))?([cdiuxXsp%])')
+
+
+class ElfStrings(object):
+    def __init__(self, elf_file):
+        self.sections = []
+        for section in ELFFile(elf_file).iter_sections():
+            if section['sh_type'] == 'SHT_PROGBITS' and section['sh_flags'] & 0x2: # SHF_ALLOC
+                self.sections.append((section['sh_addr'], section.data()))
+
+    def get(self, address):
+        for (start, data) in self.sections:
+            if start <= address < start + len(data):
+                end = data.find(b'\0', address - start)
+                if end < 0:
+                    end = len(data)
+                return data[address - start:end].decode('ascii', 'replace')
+        return None
+
+
+def format_record(strings, format_address, args):
+    fmt = strings.get(format_address)
+    if fmt is None:
+        return '<unknown format 0x%08x> %s\n' % (format_address, ' '.join('0x%x' % a for a in args))
+
+    args = list(args)
+    def expand(match):
+        (flags, width, precision, conversion) = match.groups()
+        if conversion == '%':
+            return '%'
+        if not args:
+            return match.group(0)
+        arg = args.pop(0)
+        if conversion == 's':
+            text = strings.get(arg)
+            value = text if text is not None else '<0x%08x>' % arg
+            spec = '%' + flags.replace('0', '') + width + 's'
+        elif conversion == 'c':
+            value = chr(arg & 0xFF)
+            spec = '%' + flags.replace('0', '') + width + 'c'
+        elif conversion in 'di':
+            value = arg - (1 << 32) if arg & 0x80000000 else arg
+            spec = '%' + flags + width + (('.' + precision) if precision else '') + 'd'
+        elif conversion == 'p':
+            value = arg
+            spec = '%08x'
+        else:
+            value = arg
+            spec = '%' + flags + width + (('.' + precision) if precision else '') + ('d' if conversion == 'u' else conversion)
+        return spec % value
+    return FORMAT_SPEC.sub(expand, fmt)
+
+
+def decode(strings, data, output):
+    offset = 0
+    while offset + 8 <= len(data):
+        (header, format_address) = struct.unpack_from('<II', data, offset)
+        if header >> 24 != RECORD_MAGIC:
+            # lost data, find the next record
+            offset += 4
+            continue
+        arg_count = (header >> 16) & 0xFF
+        dropped = header & 0xFFFF
+        if offset + 8 + 4 * arg_count > len(data):
+            break
+        args = struct.unpack_from('<%dI' % arg_count, data, offset + 8)
+        offset += 8 + 4 * arg_count
+        if dropped:
+            output.write('<%d records dropped>\n' % dropped)
+        output.write(format_record(strings, format_address, args))
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser(description='Expand the records of the deferred RTT logger.')
+    parser.add_argument('elf', help='ELF file of the running build')
+    parser.add_argument('log', help='Binary dump of the RTT log channel')
+    options = parser.parse_args()
+
+    with open(options.elf, 'rb') as elf_file:
+        strings = ElfStrings(elf_file)
+        with open(options.log, 'rb') as log_file:
+            decode(strings, log_file.read(), sys.stdout)
@@ -32,9 +32,39 @@
 #include "serial_command.h"
 
 #include "boards.h"
+#include <Arduino.h>
 
 #include "rbc_mesh_interface.h"
 
+#if (RBC_MESH_CMD_QUEUE_LENGTH & (RBC_MESH_CMD_QUEUE_LENGTH - 1)) || \
+    (RBC_MESH_EVT_QUEUE_LENGTH & (RBC_MESH_EVT_QUEUE_LENGTH - 1))
+#error "The command and event queue lengths must be powers of two"
+#endif
+
+/* Commands wait here until the slave has credits for them. Only the main
+   context adds commands, and only rbc_mesh_poll() takes them out, so the
+   free running head and tail indexes need no locking. */
+static hal_aci_data_t m_cmd_queue[RBC_MESH_CMD_QUEUE_LENGTH];
+static volatile uint8_t m_cmd_head;
+static volatile uint8_t m_cmd_tail;
+
+/* Events are put here by rbc_mesh_poll(), and taken out by rbc_mesh_evt_get() */
+static serial_evt_t m_evt_queue[RBC_MESH_EVT_QUEUE_LENGTH];
+static volatile uint8_t m_evt_head;
+static volatile uint8_t m_evt_tail;
+static volatile uint16_t m_evt_dropped;
+
+/* Commands the slave can take before its command queue is full. Each
+   command takes one, each response gives it back. */
+static volatile uint8_t m_credits = RBC_MESH_SLAVE_CREDITS;
+static volatile bool m_polling;
+
+/* Command response a blocking call is waiting for */
+static volatile uint8_t m_wait_opcode;
+static volatile bool m_wait_done;
+static serial_evt_t* volatile mp_wait_rsp;
+static serial_evt_t m_wait_rsp;
+
 static void unaligned_memcpy(uint8_t* p_dst, uint8_t const* p_src, uint8_t len){
   while(len--)
   {
@@ -42,18 +72,100 @@ static void unaligned_memcpy(uint8_t* p_dst, uint8_t const* p_src, uint8_t len){
   }
 }
 
+/** Get the next free command slot, or NULL if the queue is full. The
+   command is only queued by cmd_commit(). */
+static serial_cmd_t* cmd_alloc(void)
+{
+    if ((uint8_t) (m_cmd_head - m_cmd_tail) >= RBC_MESH_CMD_QUEUE_LENGTH)
+        return NULL;
+
+    return (serial_cmd_t*) m_cmd_queue[m_cmd_head & (RBC_MESH_CMD_QUEUE_LENGTH - 1)].buffer;
+}
+
+static bool cmd_commit(void)
+{
+    m_cmd_head++;
+    rbc_mesh_poll();
+    return true;
+}
+
+static void evt_handle(serial_evt_t* p_evt)
+{
+    switch (p_evt->opcode)
+    {
+        case SERIAL_EVT_OPCODE_DEVICE_STARTED:
+            /* the slave has forgotten all commands it got before the reset */
+            m_credits = p_evt->params.device_started.data_credit_available;
+            break;
+        case SERIAL_EVT_OPCODE_CMD_RSP:
+        case SERIAL_EVT_OPCODE_ECHO_RSP:
+            if (m_credits < RBC_MESH_SLAVE_CREDITS)
+                m_credits++;
+            break;
+        default:
+            break;
+    }
+
+    if (m_wait_opcode != 0 &&
+        p_evt->opcode == SERIAL_EVT_OPCODE_CMD_RSP &&
+        p_evt->params.cmd_rsp.command_opcode == m_wait_opcode)
+    {
+        memcpy((uint8_t*) mp_wait_rsp, (uint8_t*) p_evt, sizeof(serial_evt_t));
+        m_wait_opcode = 0;
+        m_wait_done = true;
+        return;
+    }
+
+    if ((uint8_t) (m_evt_head - m_evt_tail) >= RBC_MESH_EVT_QUEUE_LENGTH)
+    {
+        m_evt_dropped++;
+        return;
+    }
+    memcpy((uint8_t*) &m_evt_queue[m_evt_head & (RBC_MESH_EVT_QUEUE_LENGTH - 1)], (uint8_t*) p_evt, sizeof(serial_evt_t));
+    m_evt_head++;
+}
+
+/** Make the next command response with the given opcode go to p_rsp
+   instead of the event queue. Must be called before the command is queued. */
+static bool wait_begin(uint8_t opcode, serial_evt_t* p_rsp)
+{
+    if (m_wait_opcode != 0)
+        return false; /* only one blocking call at a time */
+
+    mp_wait_rsp = (p_rsp != NULL) ? p_rsp : &m_wait_rsp;
+    m_wait_done = false;
+    m_wait_opcode = opcode;
+    return true;
+}
+
+static bool wait_end(bool queued)
+{
+    if (queued)
+    {
+        unsigned long start = millis();
+        while (!m_wait_done && millis() - start < RBC_MESH_CMD_TIMEOUT_MS)
+        {
+            rbc_mesh_poll();
+        }
+    }
+    m_wait_opcode = 0;
+
+    return (m_wait_done && mp_wait_rsp->params.cmd_rsp.status == ACI_STATUS_SUCCESS);
+}
+
 bool rbc_mesh_echo(uint8_t* buffer, int len){
 	if (len > HAL_ACI_MAX_LENGTH - 1 || len < 0)
 		return false;
     
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = len + 1; // account for opcode
     p_cmd->opcode = SERIAL_CMD_OPCODE_ECHO;
     memcpy(p_cmd->params.echo.data, buffer, len);
 
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
 }
 
 bool rbc_mesh_init(
@@ -61,8 +173,9 @@ bool rbc_mesh_init(
 	uint8_t chanNr,
         uint32_t int_min_ms){
 	
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 10;
     p_cmd->opcode = SERIAL_CMD_OPCODE_INIT;
@@ -70,29 +183,31 @@ bool rbc_mesh_init(
     p_cmd->params.init.channel = chanNr;
     p_cmd->params.init.int_min = int_min_ms;
 
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
 }
 
 bool rbc_mesh_start(void)
 {
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 1;
     p_cmd->opcode = SERIAL_CMD_OPCODE_START;
 
-    return hal_aci_tl_send(&msg_for_mesh);
+    return cmd_commit();
 }
 
 bool rbc_mesh_stop(void)
 {
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 1;
     p_cmd->opcode = SERIAL_CMD_OPCODE_STOP;
 
-    return hal_aci_tl_send(&msg_for_mesh);
+    return cmd_commit();
 }
 
 bool rbc_mesh_value_set(uint16_t handle, uint8_t* buffer, int len){
@@ -100,157 +215,325 @@ bool rbc_mesh_value_set(uint16_t handle, uint8_t* buffer, int len){
 	if (len > HAL_ACI_MAX_LENGTH - 1 || len < 1)
 		return false;
 
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = len + 2; // account for opcode and handle 
     p_cmd->opcode = SERIAL_CMD_OPCODE_VALUE_SET;
     p_cmd->params.value_set.handle = handle;
     memcpy(p_cmd->params.value_set.value, buffer, len);
 
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
 }
 
 
 bool rbc_mesh_value_enable(uint16_t handle){
 
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 2;
     p_cmd->opcode = SERIAL_CMD_OPCODE_VALUE_ENABLE;
     p_cmd->params.value_enable.handle = handle;
 
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
 }
 
 bool rbc_mesh_value_disable(uint16_t handle){
 
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 2;
     p_cmd->opcode = SERIAL_CMD_OPCODE_VALUE_DISABLE;
     p_cmd->params.value_enable.handle = handle;
 
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
 }
 
 bool rbc_mesh_value_get(uint16_t handle){
 
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 2;
     p_cmd->opcode = SERIAL_CMD_OPCODE_VALUE_GET;
     p_cmd->params.value_enable.handle = handle;
 
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
+}
+
+
+bool rbc_mesh_value_set_bulk(const uint16_t* handles, uint8_t* const* buffers, const uint8_t* lens, int count){
+
+	if (count < 1 || count > SERIAL_CMD_VALUE_BULK_MAX_COUNT)
+		return false;
+
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
+
+    int used = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (used + SERIAL_CMD_VALUE_RECORD_OVERHEAD + lens[i] > SERIAL_CMD_VALUE_SET_BULK_CAPACITY)
+            return false;
+
+        uint8_t* p_record = &p_cmd->params.value_set_bulk.records[used];
+        p_record[0] = handles[i] & 0xFF;
+        p_record[1] = handles[i] >> 8;
+        p_record[2] = lens[i];
+        memcpy(&p_record[3], buffers[i], lens[i]);
+        used += SERIAL_CMD_VALUE_RECORD_OVERHEAD + lens[i];
+    }
+
+    p_cmd->length = used + 1; // account for opcode
+    p_cmd->opcode = SERIAL_CMD_OPCODE_VALUE_SET_BULK;
+
+	return cmd_commit();
+}
+
+bool rbc_mesh_value_get_bulk(const uint16_t* handles, int count){
+
+	if (count < 1 || count > SERIAL_CMD_VALUE_BULK_MAX_COUNT)
+		return false;
+
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
+
+    p_cmd->length = 1 + 2 * count;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_VALUE_GET_BULK;
+    memcpy(p_cmd->params.value_get_bulk.handles, handles, 2 * count);
+
+	return cmd_commit();
+}
+
+bool rbc_mesh_value_dump(uint16_t cursor){
+
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
+
+    p_cmd->length = 3;
+    p_cmd->opcode = SERIAL_CMD_OPCODE_VALUE_DUMP;
+    p_cmd->params.value_dump.cursor = cursor;
+
+	return cmd_commit();
 }
 
 
 bool rbc_mesh_build_version_get(){
 
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 1;
     p_cmd->opcode = SERIAL_CMD_OPCODE_BUILD_VERSION_GET;
 	
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
 }
 
 
 bool rbc_mesh_access_addr_get(){
 
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 1;
     p_cmd->opcode = SERIAL_CMD_OPCODE_ACCESS_ADDR_GET;
 	
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
 }
 
 bool rbc_mesh_channel_get(){
 
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 1;
     p_cmd->opcode = SERIAL_CMD_OPCODE_CHANNEL_GET;
 	
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
 }
 
 bool rbc_mesh_interval_min_get(){
 
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
 
     p_cmd->length = 1;
     p_cmd->opcode = SERIAL_CMD_OPCODE_INTERVAL_GET;
 	
-	return hal_aci_tl_send(&msg_for_mesh);
+	return cmd_commit();
 }
 
 bool rbc_mesh_tx_event_flag_set(uint16_t handle, bool value)
 {
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
     p_cmd->length = 5;
     p_cmd->opcode = SERIAL_CMD_OPCODE_FLAG_SET;
     p_cmd->params.flag_set.handle = handle;
     p_cmd->params.flag_set.flag = ACI_FLAG_TX_EVENT;
     p_cmd->params.flag_set.value = value;
 
-    return hal_aci_tl_send(&msg_for_mesh);
+    return cmd_commit();
 }
 
 bool rbc_mesh_persistent_flag_set(uint16_t handle, bool value)
 {
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
     p_cmd->length = 5;
     p_cmd->opcode = SERIAL_CMD_OPCODE_FLAG_SET;
     p_cmd->params.flag_set.handle = handle;
     p_cmd->params.flag_set.flag = ACI_FLAG_PERSISTENT;
     p_cmd->params.flag_set.value = value;
 
-    return hal_aci_tl_send(&msg_for_mesh);
+    return cmd_commit();
 }
 
 bool rbc_mesh_tx_event_flag_get(uint16_t handle)
 {
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
     p_cmd->length = 4;
     p_cmd->opcode = SERIAL_CMD_OPCODE_FLAG_GET;
     p_cmd->params.flag_get.handle = handle;
     p_cmd->params.flag_get.flag = ACI_FLAG_TX_EVENT;
 
-    return hal_aci_tl_send(&msg_for_mesh);
+    return cmd_commit();
 }
 
 bool rbc_mesh_persistent_flag_get(uint16_t handle)
 {
-    hal_aci_data_t msg_for_mesh;
-    serial_cmd_t* p_cmd = (serial_cmd_t*) msg_for_mesh.buffer;
+    serial_cmd_t* p_cmd = cmd_alloc();
+    if (p_cmd == NULL)
+        return false;
     p_cmd->length = 4;
     p_cmd->opcode = SERIAL_CMD_OPCODE_FLAG_GET;
     p_cmd->params.flag_get.handle = handle;
     p_cmd->params.flag_get.flag = ACI_FLAG_PERSISTENT;
 
-    return hal_aci_tl_send(&msg_for_mesh);
+    return cmd_commit();
+}
+
+void rbc_mesh_poll(void)
+{
+    noInterrupts();
+    if (m_polling)
+    {
+        /* called from an interrupt while the main context was polling */
+        interrupts();
+        return;
+    }
+    m_polling = true;
+    interrupts();
+
+    bool progress;
+    do
+    {
+        progress = false;
+        while (m_cmd_tail != m_cmd_head && m_credits > 0)
+        {
+            if (!hal_aci_tl_send(&m_cmd_queue[m_cmd_tail & (RBC_MESH_CMD_QUEUE_LENGTH - 1)]))
+                break; /* the ACI queue is full, try again on the next poll */
+
+            m_credits--;
+            m_cmd_tail++;
+        }
+
+        hal_aci_data_t msg;
+        while (hal_aci_tl_event_get(&msg))
+        {
+            evt_handle((serial_evt_t*) msg.buffer);
+            progress = true;
+        }
+    } while (progress && m_cmd_tail != m_cmd_head && m_credits > 0);
+
+    m_polling = false;
 }
 
 bool rbc_mesh_evt_get(serial_evt_t* p_evt){
-    hal_aci_data_t msg;
-    bool status = hal_aci_tl_event_get(&msg);
-    if (status)
-        memcpy((uint8_t*) p_evt, msg.buffer, sizeof(serial_evt_t));
+    rbc_mesh_poll();
+
+    if (m_evt_tail == m_evt_head)
+        return false;
+
+    memcpy((uint8_t*) p_evt, (uint8_t*) &m_evt_queue[m_evt_tail & (RBC_MESH_EVT_QUEUE_LENGTH - 1)], sizeof(serial_evt_t));
+    m_evt_tail++;
+    return true;
+}
 
-    return status;
+uint8_t rbc_mesh_credits_get(void)
+{
+    return m_credits;
+}
+
+uint16_t rbc_mesh_evt_dropped_get(void)
+{
+    return m_evt_dropped;
+}
+
+bool rbc_mesh_init_blocking(uint32_t accessAddr, uint8_t chanNr, uint32_t int_min_ms, serial_evt_t* p_rsp)
+{
+    if (!wait_begin(SERIAL_CMD_OPCODE_INIT, p_rsp))
+        return false;
+    return wait_end(rbc_mesh_init(accessAddr, chanNr, int_min_ms));
+}
+
+bool rbc_mesh_start_blocking(serial_evt_t* p_rsp)
+{
+    if (!wait_begin(SERIAL_CMD_OPCODE_START, p_rsp))
+        return false;
+    return wait_end(rbc_mesh_start());
+}
+
+bool rbc_mesh_stop_blocking(serial_evt_t* p_rsp)
+{
+    if (!wait_begin(SERIAL_CMD_OPCODE_STOP, p_rsp))
+        return false;
+    return wait_end(rbc_mesh_stop());
+}
+
+bool rbc_mesh_value_set_blocking(uint16_t handle, uint8_t* buffer, int len, serial_evt_t* p_rsp)
+{
+    if (!wait_begin(SERIAL_CMD_OPCODE_VALUE_SET, p_rsp))
+        return false;
+    return wait_end(rbc_mesh_value_set(handle, buffer, len));
+}
+
+bool rbc_mesh_value_get_blocking(uint16_t handle, serial_evt_t* p_rsp)
+{
+    if (!wait_begin(SERIAL_CMD_OPCODE_VALUE_GET, p_rsp))
+        return false;
+    return wait_end(rbc_mesh_value_get(handle));
+}
+
+bool rbc_mesh_value_enable_blocking(uint16_t handle, serial_evt_t* p_rsp)
+{
+    if (!wait_begin(SERIAL_CMD_OPCODE_VALUE_ENABLE, p_rsp))
+        return false;
+    return wait_end(rbc_mesh_value_enable(handle));
+}
+
+bool rbc_mesh_value_disable_blocking(uint16_t handle, serial_evt_t* p_rsp)
+{
+    if (!wait_begin(SERIAL_CMD_OPCODE_VALUE_DISABLE, p_rsp))
+        return false;
+    return wait_end(rbc_mesh_value_disable(handle));
 }
 
 void rbc_mesh_hw_init(aci_pins_t* pins){
@@ -260,6 +543,8 @@ void rbc_mesh_hw_init(aci_pins_t* pins){
 
 void rbc_mesh_radio_reset()
 {
+    /* the slave drops its command queue, so should we */
+    m_cmd_tail = m_cmd_head;
     lib_aci_radio_reset();
 }
 
@@ -24,6 +24,26 @@
 
 #include "serial_evt.h"
 
+/** Number of commands that can wait for the slave to take them */
+#ifndef RBC_MESH_CMD_QUEUE_LENGTH
+#define RBC_MESH_CMD_QUEUE_LENGTH   (4)
+#endif
+
+/** Number of received events waiting for rbc_mesh_evt_get() */
+#ifndef RBC_MESH_EVT_QUEUE_LENGTH
+#define RBC_MESH_EVT_QUEUE_LENGTH   (8)
+#endif
+
+/** Length of the slave's command queue (SERIAL_HANDLER_RX_QUEUE_LENGTH) */
+#ifndef RBC_MESH_SLAVE_CREDITS
+#define RBC_MESH_SLAVE_CREDITS      (4)
+#endif
+
+/** How long the blocking calls wait for their command response */
+#ifndef RBC_MESH_CMD_TIMEOUT_MS
+#define RBC_MESH_CMD_TIMEOUT_MS     (500)
+#endif
+
 /** @brief executes an echo-test
  *  @details
  *  Promts the slave to echo whatever the buffer contains
@@ -86,6 +106,44 @@ bool rbc_mesh_value_set(uint16_t handle, uint8_t* buffer, int len);
  */
 bool rbc_mesh_value_get(uint16_t handle);
 
+/** @brief set several values in one command
+ *  @details
+ *  promts the slave to call rbc_mesh_value_set_bulk. The response holds a
+ *  bitmap of the values that were set.
+ *  @param handles handle IDs of the variables to be updated
+ *  @param buffers pointers to the memory areas containing data to send
+ *  @param lens Amount of bytes to be send for each handle
+ *  @param count Number of handles, at most SERIAL_CMD_VALUE_BULK_MAX_COUNT
+ *  @return True if the data was successfully queued for sending, 
+ *  false if the values don't fit in one command, or there is no more space
+ *  to store messages to send.
+ */
+bool rbc_mesh_value_set_bulk(const uint16_t* handles, uint8_t* const* buffers, const uint8_t* lens, int count);
+
+/** @brief read several values in one command
+ *  @details
+ *  the response holds a bitmap of the values found, followed by a
+ *  handle, length, data record for each of them.
+ *  @param handles handle IDs of the variables to be read
+ *  @param count Number of handles, at most SERIAL_CMD_VALUE_BULK_MAX_COUNT
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_value_get_bulk(const uint16_t* handles, int count);
+
+/** @brief read out all values cached in the slave
+ *  @details
+ *  the slave answers with a few value dump events, each holding a
+ *  handle, version, length, data record per value, followed by a response
+ *  with the cursor to continue from. Repeat the command with that cursor
+ *  until it comes back as 0xFFFF.
+ *  @param cursor 0 to start from the first value, or the cursor from the
+ *  previous response
+ *  @return True if the data was successfully queued for sending, 
+ *  false if there is no more space to store messages to send.
+ */
+bool rbc_mesh_value_dump(uint16_t cursor);
+
 /** @brief start broadcasting value of a handle
  *  @details
  *  promts the slave to call rbc_mesh_value_enable
@@ -175,12 +233,45 @@ bool rbc_mesh_persistent_flag_get(uint16_t handle);
 
 /** @brief checkes if new events arrived
  *  @details
- *  checks for new events and takes them off the queue
+ *  polls the slave, and takes the oldest event off the event queue
  *  needs to be called in the main loop
  *  @return True if there is an event
  */
 bool rbc_mesh_evt_get(serial_evt_t* p_evt);
 
+/** @brief exchange queued commands and events with the slave
+ *  @details
+ *  sends queued commands for as long as the slave has room for them, and
+ *  moves received events to the event queue. Never blocks, and may be called
+ *  from a timer interrupt to keep the slave busy while the main loop does
+ *  other work. Calls from an interrupt that preempts a poll are ignored.
+ */
+void rbc_mesh_poll(void);
+
+/** @brief number of commands the slave can take right now */
+uint8_t rbc_mesh_credits_get(void);
+
+/** @brief number of events lost because the event queue was full */
+uint16_t rbc_mesh_evt_dropped_get(void);
+
+/** @brief blocking versions of the commands above
+ *  @details
+ *  queue the command, and poll the slave until its command response arrives,
+ *  or RBC_MESH_CMD_TIMEOUT_MS has passed. The command response is not put in
+ *  the event queue, but other events received in the meantime are. Only one
+ *  blocking call may be in progress at a time, so they must not be used from
+ *  interrupts.
+ *  @param p_rsp memory to put the command response in, may be NULL
+ *  @return True if the command response arrived with status success.
+ */
+bool rbc_mesh_init_blocking(uint32_t accessAddr, uint8_t chanNr, uint32_t int_min_ms, serial_evt_t* p_rsp);
+bool rbc_mesh_start_blocking(serial_evt_t* p_rsp);
+bool rbc_mesh_stop_blocking(serial_evt_t* p_rsp);
+bool rbc_mesh_value_set_blocking(uint16_t handle, uint8_t* buffer, int len, serial_evt_t* p_rsp);
+bool rbc_mesh_value_get_blocking(uint16_t handle, serial_evt_t* p_rsp);
+bool rbc_mesh_value_enable_blocking(uint16_t handle, serial_evt_t* p_rsp);
+bool rbc_mesh_value_disable_blocking(uint16_t handle, serial_evt_t* p_rsp);
+
 /** @brief initialisation of local hardware
  *  @details
  *  Sets the SPI-pins
@@ -30,6 +30,8 @@ typedef enum
     SERIAL_CMD_OPCODE_ECHO                  = 0x02,
     SERIAL_CMD_OPCODE_RADIO_RESET           = 0x0E,
     
+    SERIAL_CMD_OPCODE_VALUE_DUMP            = 0x6C,
+    SERIAL_CMD_OPCODE_VALUE_GET_BULK        = 0x6F,
     SERIAL_CMD_OPCODE_INIT                  = 0x70,
     SERIAL_CMD_OPCODE_VALUE_SET             = 0x71,
     SERIAL_CMD_OPCODE_VALUE_ENABLE          = 0x72,
@@ -38,6 +40,7 @@ typedef enum
     SERIAL_CMD_OPCODE_STOP                  = 0x75,
     SERIAL_CMD_OPCODE_FLAG_SET              = 0x76,
     SERIAL_CMD_OPCODE_FLAG_GET              = 0x77,
+    SERIAL_CMD_OPCODE_VALUE_SET_BULK        = 0x79,
 
     SERIAL_CMD_OPCODE_VALUE_GET             = 0x7A,
     SERIAL_CMD_OPCODE_BUILD_VERSION_GET     = 0x7B,
@@ -94,6 +97,25 @@ typedef struct
     uint16_t handle;
 } __packed serial_cmd_params_value_get_t;
 
+#define SERIAL_CMD_VALUE_BULK_MAX_COUNT     (16)
+#define SERIAL_CMD_VALUE_SET_BULK_CAPACITY  (35)
+#define SERIAL_CMD_VALUE_RECORD_OVERHEAD    (3)
+
+typedef struct 
+{
+    uint8_t records[SERIAL_CMD_VALUE_SET_BULK_CAPACITY]; /* { uint16_t handle, uint8_t length, data } */
+} __packed serial_cmd_params_value_set_bulk_t;
+
+typedef struct 
+{
+    uint16_t handles[SERIAL_CMD_VALUE_BULK_MAX_COUNT];
+} __packed serial_cmd_params_value_get_bulk_t;
+
+typedef struct 
+{
+    uint16_t cursor;
+} __packed serial_cmd_params_value_dump_t;
+
 
 typedef struct 
 {
@@ -109,6 +131,9 @@ typedef struct
         serial_cmd_params_value_enable_t    value_enable;
         serial_cmd_params_value_disable_t   value_disable;
         serial_cmd_params_value_get_t       value_get;
+        serial_cmd_params_value_set_bulk_t  value_set_bulk;
+        serial_cmd_params_value_get_bulk_t  value_get_bulk;
+        serial_cmd_params_value_dump_t      value_dump;
     } __packed params;
 } __packed  serial_cmd_t;
 
@@ -182,6 +182,9 @@ __STATIC_INLINE void pwm_ppi_disable(app_pwm_t const * const p_instance)
 }
 
 
+static bool pwm_ramp_step(app_pwm_t const * const p_instance);
+
+
 /**
  * @brief This function is called on interrupt after duty set.
  *
@@ -210,6 +213,11 @@ void pwm_ready_tick(nrf_timer_event_t event_type, void * p_context)
         }
     }
     
+    if (pwm_ramp_step(m_instances[timer_instance_id]))
+    {
+        disable = 0;
+    }
+    
     if (disable)
     {
         pwm_irq_disable(m_instances[timer_instance_id]);
@@ -460,9 +468,16 @@ static void pwm_transition_0or100_to_0or100(app_pwm_t const * const p_instance,
 }
 
 
-ret_code_t app_pwm_channel_duty_ticks_set(app_pwm_t const * const p_instance,
-                                          uint8_t           channel,
-                                          uint16_t          ticks)
+/**
+ * @brief Function for changing the duty cycle of a channel, without touching the ramp.
+ *
+ * @param[in] p_instance       PWM instance.
+ * @param[in] channel          PWM channel number.
+ * @param[in] ticks            Number of clock ticks.
+ */
+static ret_code_t pwm_channel_duty_ticks_apply(app_pwm_t const * const p_instance,
+                                               uint8_t           channel,
+                                               uint16_t          ticks)
 {
     app_pwm_cb_t         * p_cb    = p_instance->p_cb;
     app_pwm_channel_cb_t * p_ch_cb = &p_cb->channels_cb[channel];
@@ -527,6 +542,132 @@ ret_code_t app_pwm_channel_duty_ticks_set(app_pwm_t const * const p_instance,
     return NRF_SUCCESS;
 }
 
+
+/**
+ * @brief Function for moving a running ramp along, called in every PWM period.
+ *
+ * Only one duty cycle change may be in progress per instance, so the channels
+ * of a step are changed one at a time, in consecutive periods.
+ *
+ * @param[in] p_instance       PWM instance.
+ *
+ * @retval    True If the ramp needs the PWM interrupt for more periods.
+ */
+static bool pwm_ramp_step(app_pwm_t const * const p_instance)
+{
+    app_pwm_cb_t      * p_cb   = p_instance->p_cb;
+    app_pwm_ramp_cb_t * p_ramp = &p_cb->ramp;
+    uint16_t const    * p_table = p_ramp->p_table;
+
+    if (p_table == NULL)
+    {
+        return false;
+    }
+    if (p_ramp->periods_left)
+    {
+        --p_ramp->periods_left;
+    }
+
+    uint32_t ticks = p_table[p_ramp->index];
+    if (ticks > p_cb->period)
+    {
+        ticks = p_cb->period;
+    }
+    for (uint8_t channel = 0; channel < APP_PWM_CHANNELS_PER_INSTANCE; ++channel)
+    {
+        if ((p_ramp->channel_mask & (1 << channel)) &&
+            p_cb->channels_cb[channel].pulsewidth != ticks)
+        {
+            if (!app_pwm_busy_check(p_instance))
+            {
+                (void) pwm_channel_duty_ticks_apply(p_instance, channel, ticks);
+            }
+            return true;
+        }
+    }
+    if (p_ramp->periods_left)
+    {
+        return true;
+    }
+    if (p_ramp->index + 1 >= p_ramp->length)
+    {
+        p_ramp->p_table = NULL;
+        if (p_ramp->p_done_callback)
+        {
+            p_ramp->p_done_callback(p_instance->p_timer->instance_id);
+        }
+        return false;
+    }
+    ++p_ramp->index;
+    p_ramp->periods_left = p_ramp->periods_per_step;
+    return true;
+}
+
+
+ret_code_t app_pwm_channel_duty_ticks_set(app_pwm_t const * const p_instance,
+                                          uint8_t           channel,
+                                          uint16_t          ticks)
+{
+    app_pwm_cb_t * p_cb = p_instance->p_cb;
+
+    if (p_cb->ramp.p_table && (p_cb->ramp.channel_mask & (1 << channel)))
+    {
+        app_pwm_ramp_stop(p_instance);
+    }
+    return pwm_channel_duty_ticks_apply(p_instance, channel, ticks);
+}
+
+
+ret_code_t app_pwm_ramp_start(app_pwm_t const * const p_instance,
+                              uint8_t                 channel_mask,
+                              uint16_t const *        p_table,
+                              uint16_t                length,
+                              uint16_t                periods_per_step,
+                              app_pwm_ramp_callback_t p_done_callback)
+{
+    app_pwm_cb_t      * p_cb   = p_instance->p_cb;
+    app_pwm_ramp_cb_t * p_ramp = &p_cb->ramp;
+
+    if (p_cb->state != NRF_DRV_STATE_POWERED_ON)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (!p_table || !length || !periods_per_step || !channel_mask ||
+        (channel_mask >> APP_PWM_CHANNELS_PER_INSTANCE))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    for (uint8_t channel = 0; channel < APP_PWM_CHANNELS_PER_INSTANCE; ++channel)
+    {
+        if ((channel_mask & (1 << channel)) &&
+            p_cb->channels_cb[channel].initialized != APP_PWM_CHANNEL_INITIALIZED)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    // Stop the interrupt from stepping a half configured ramp:
+    p_ramp->p_table          = NULL;
+    p_ramp->length           = length;
+    p_ramp->index            = 0;
+    p_ramp->periods_per_step = periods_per_step;
+    p_ramp->periods_left     = periods_per_step;
+    p_ramp->channel_mask     = channel_mask;
+    p_ramp->p_done_callback  = p_done_callback;
+    p_ramp->p_table          = p_table;
+
+    pwm_irq_enable(p_instance);
+    return NRF_SUCCESS;
+}
+
+
+void app_pwm_ramp_stop(app_pwm_t const * const p_instance)
+{
+    // The interrupt is disabled on the next period, if no duty change needs it.
+    p_instance->p_cb->ramp.p_table = NULL;
+}
+
+
 uint16_t app_pwm_channel_duty_ticks_get(app_pwm_t const * const p_instance, uint8_t channel)
 {
     app_pwm_cb_t         * p_cb      = p_instance->p_cb;
@@ -688,6 +829,7 @@ ret_code_t app_pwm_init(app_pwm_t const * const p_instance, app_pwm_config_t con
     p_cb->ppi_channels[0] = (nrf_ppi_channel_t)UNALLOCATED;
     p_cb->ppi_channels[1] = (nrf_ppi_channel_t)UNALLOCATED;
     p_cb->ppi_group       = (nrf_ppi_channel_group_t)UNALLOCATED;
+    p_cb->ramp.p_table    = NULL;
 
     for (uint8_t i = 0; i < APP_PWM_CHANNELS_PER_INSTANCE; ++i)
     {
@@ -793,6 +935,7 @@ void app_pwm_disable(app_pwm_t const * const p_instance)
 
     ASSERT(p_cb->state != NRF_DRV_STATE_UNINITIALIZED);
 
+    app_pwm_ramp_stop(p_instance);
     nrf_drv_timer_disable(p_instance->p_timer);
     pwm_irq_disable(p_instance);
     for (uint8_t ppi_channel = 0; ppi_channel < APP_PWM_REQUIRED_PPI_CHANNELS_PER_INSTANCE; ++ppi_channel)
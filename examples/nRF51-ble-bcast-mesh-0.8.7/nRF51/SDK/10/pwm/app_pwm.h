@@ -83,6 +83,13 @@ typedef uint16_t app_pwm_duty_t;
  */
 typedef void (* app_pwm_callback_t)(uint32_t);
 
+/**
+ * @brief PWM callback that is executed when a ramp has reached its last step.
+ *
+ * @param[in] pwm_id  PWM instance ID.
+ */
+typedef void (* app_pwm_ramp_callback_t)(uint32_t);
+
 /**
  * @brief Channel polarity.
  */
@@ -130,6 +137,22 @@ typedef struct
         uint8_t            initialized;     //!< The internal information if the selected channel was initialized.
     } app_pwm_channel_cb_t;
 
+    /**
+     * @brief PWM ramp
+     *
+     * This structure holds the state of a duty cycle ramp run from the PWM timer interrupt.
+     */
+    typedef struct
+    {
+        uint16_t const * volatile p_table;          //!< Duty cycle of each step (in ticks), NULL when no ramp is running.
+        uint16_t                  length;           //!< Number of steps in the table.
+        uint16_t                  index;            //!< Step currently being output.
+        uint16_t                  periods_per_step; //!< Number of PWM periods each step is held.
+        uint16_t                  periods_left;     //!< Number of PWM periods left of the current step.
+        uint8_t                   channel_mask;     //!< Channels following the ramp.
+        app_pwm_ramp_callback_t   p_done_callback;  //!< Callback function called when the ramp is done.
+    } app_pwm_ramp_cb_t;
+
     /**
      * @brief Variable part of PWM instance
      *
@@ -143,6 +166,7 @@ typedef struct
         nrf_ppi_channel_t       ppi_channels[2];                            //!< PPI channels used temporary while changing duty
         nrf_ppi_channel_group_t ppi_group;                                  //!< PPI group used to synchronize changes on channels
         nrf_drv_state_t         state;                                      //!< Current driver status
+        app_pwm_ramp_cb_t       ramp;                                       //!< Duty cycle ramp
     } app_pwm_cb_t;
 /** @}
  * @endcond
@@ -226,6 +250,45 @@ void app_pwm_disable(app_pwm_t const * const p_instance);
 ret_code_t app_pwm_channel_duty_set(app_pwm_t const * const p_instance,
                                   uint8_t channel, app_pwm_duty_t duty);
 
+/**
+ * @brief Function for starting a duty cycle ramp.
+ *
+ * The ramp steps the selected channels through a table of duty cycles, holding each
+ * step for a number of PWM periods. The steps are applied from the PWM timer interrupt
+ * at the start of a period, so the application doesn't have to time them, and the
+ * duty cycle changes in small, evenly spaced steps. The table is typically precomputed
+ * with gamma correction, to make the brightness of a LED change evenly.
+ *
+ * A running ramp is replaced. Setting the duty cycle of a channel that follows the
+ * ramp stops the ramp.
+ *
+ * @param[in] p_instance        PWM instance.
+ * @param[in] channel_mask      Channels to ramp, bit n set for channel n.
+ * @param[in] p_table           Duty cycle of each step in ticks. Must stay valid until the ramp is done.
+ * @param[in] length            Number of steps in the table.
+ * @param[in] periods_per_step  Number of PWM periods to hold each step.
+ * @param[in] p_done_callback   Pointer to function called when the last step is reached (or NULL).
+ *
+ * @retval    NRF_SUCCESS If the ramp was started.
+ * @retval    NRF_ERROR_INVALID_PARAM If the table, a step count or the channel mask is invalid.
+ * @retval    NRF_ERROR_INVALID_STATE If the given instance is not enabled.
+ */
+ret_code_t app_pwm_ramp_start(app_pwm_t const * const p_instance,
+                              uint8_t                 channel_mask,
+                              uint16_t const *        p_table,
+                              uint16_t                length,
+                              uint16_t                periods_per_step,
+                              app_pwm_ramp_callback_t p_done_callback);
+
+/**
+ * @brief Function for stopping a duty cycle ramp.
+ *
+ * The channels keep the duty cycle of the last step that was applied.
+ *
+ * @param[in] p_instance  PWM instance.
+ */
+void app_pwm_ramp_stop(app_pwm_t const * const p_instance);
+
 /**
  * @brief Function for retrieving the PWM channel duty cycle in percents.
  *
@@ -0,0 +1,530 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "app_pwm_sync.h"
+#include "nrf_drv_timer.h"
+#include "nrf_drv_ppi.h"
+#include "nrf_drv_common.h"
+#include "nrf_drv_gpiote.h"
+#include "nrf_timer.h"
+#include "nrf_gpio.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "nrf_assert.h"
+
+#define APP_PWM_CHANNEL_INITIALIZED                1
+#define APP_PWM_CHANNEL_UNINITIALIZED              0
+
+#define TIMER_MAX_PULSEWIDTH_US_ON_16M             4095
+
+#define APP_PWM_REQUIRED_PPI_CHANNELS_PER_CHANNEL  2
+
+#define UNALLOCATED                                0xFFFFFFFFUL
+
+/** Compare channel ending the period. The channels use the compare channel of their own number. */
+#define PWM_PERIOD_CC_CHANNEL                      3
+
+// Macros for getting the polarity of given instance/channel.
+#define POLARITY_ACTIVE(INST,CH)   (( ((INST)->p_cb)->channels_cb[(CH)].polarity == \
+                 APP_PWM_POLARITY_ACTIVE_LOW)?(0):(1))
+#define POLARITY_INACTIVE(INST,CH) (( ((INST)->p_cb)->channels_cb[(CH)].polarity == \
+                 APP_PWM_POLARITY_ACTIVE_LOW)?(1):(0))
+
+//lint -save -e534
+
+/**
+ * @brief Workaround for PAN-73.
+ *
+ * @param[in] timer     Timer.
+ * @param[in] enable    Enable or disable.
+ */
+static void pan73_workaround(NRF_TIMER_Type * p_timer, bool enable)
+{
+#ifdef NRF51
+    if (p_timer == NRF_TIMER0)
+    {
+        *(uint32_t *)0x40008C0C = (enable ? 1 : 0);
+    }
+    else if (p_timer == NRF_TIMER1)
+    {
+        *(uint32_t *)0x40009C0C = (enable ? 1 : 0);
+    }
+    else if (p_timer == NRF_TIMER2)
+    {
+        *(uint32_t *)0x4000AC0C = (enable ? 1 : 0);
+    }
+#endif
+    return;
+}
+
+
+/**
+ * @brief Function for setting the output of a channel for the period that starts next.
+ *
+ * Must only be called while the timer is stopped at a period boundary, where the
+ * outputs of all running channels are inactive. The channel goes active when the
+ * timer reaches (period - ticks), and the period compare makes it inactive again.
+ * 0% and 100% have no edges, so the PPI channels are off and the level is forced.
+ *
+ * @param[in] p_instance  PWM instance.
+ * @param[in] channel     Channel number.
+ * @param[in] ticks       Duty cycle in ticks.
+ */
+static void pwm_channel_apply(app_pwm_sync_t const * const p_instance, uint8_t channel, uint16_t ticks)
+{
+    app_pwm_sync_cb_t         * p_cb    = p_instance->p_cb;
+    app_pwm_sync_channel_cb_t * p_ch_cb = &p_cb->channels_cb[channel];
+
+    if (ticks > p_cb->period)
+    {
+        ticks = p_cb->period;
+    }
+    p_ch_cb->pulsewidth = ticks;
+
+    if (ticks == 0 || ticks == p_cb->period)
+    {
+        nrf_drv_ppi_channel_disable(p_ch_cb->ppi_channels[0]);
+        nrf_drv_ppi_channel_disable(p_ch_cb->ppi_channels[1]);
+        nrf_drv_gpiote_out_task_force(p_ch_cb->gpio_pin,
+            (ticks == 0) ? POLARITY_INACTIVE(p_instance, channel) : POLARITY_ACTIVE(p_instance, channel));
+    }
+    else
+    {
+        nrf_drv_timer_compare(p_instance->p_timer, (nrf_timer_cc_channel_t) channel,
+                              p_cb->period - ticks, false);
+        nrf_drv_gpiote_out_task_force(p_ch_cb->gpio_pin, POLARITY_INACTIVE(p_instance, channel));
+        nrf_drv_ppi_channel_enable(p_ch_cb->ppi_channels[0]);
+        nrf_drv_ppi_channel_enable(p_ch_cb->ppi_channels[1]);
+    }
+}
+
+
+/**
+ * @brief Function for making the timer stop at the next period boundary.
+ *
+ * The stop shortcut may take effect at a boundary passed while it is being
+ * enabled, which can't be told apart from one passed just before. In that
+ * case the timer is started again (which has no effect if it is running), and
+ * the next boundary is waited for. When this returns, the next period compare
+ * event is known to come with the timer stopped.
+ *
+ * @param[in] p_instance  PWM instance.
+ */
+static void pwm_stop_arm(app_pwm_sync_t const * const p_instance)
+{
+    NRF_TIMER_Type * p_reg = p_instance->p_timer->p_reg;
+
+    for (;;)
+    {
+        nrf_timer_event_clear(p_reg, NRF_TIMER_EVENT_COMPARE3);
+        nrf_timer_shorts_enable(p_reg, NRF_TIMER_SHORT_COMPARE3_STOP_MASK);
+        if (!nrf_timer_event_check(p_reg, NRF_TIMER_EVENT_COMPARE3))
+        {
+            break;
+        }
+        nrf_timer_task_trigger(p_reg, NRF_TIMER_TASK_START);
+    }
+    nrf_timer_int_enable(p_reg, NRF_TIMER_INT_COMPARE3_MASK);
+}
+
+
+/**
+ * @brief Function for latching the pending duty cycles at the period boundary.
+ *
+ * @param[in] event_type  Timer event.
+ * @param[in] p_context   PWM instance.
+ */
+static void pwm_sync_tick(nrf_timer_event_t event_type, void * p_context)
+{
+    app_pwm_sync_t const * const p_instance = (app_pwm_sync_t const *) p_context;
+    app_pwm_sync_cb_t    * p_cb  = p_instance->p_cb;
+    NRF_TIMER_Type       * p_reg = p_instance->p_timer->p_reg;
+
+    if (event_type != NRF_TIMER_EVENT_COMPARE3)
+    {
+        return;
+    }
+
+    // The timer is stopped and cleared, all edges of the next period are ahead.
+    for (uint8_t channel = 0; channel < APP_PWM_SYNC_CHANNELS_PER_INSTANCE; ++channel)
+    {
+        if (p_cb->channels_cb[channel].initialized)
+        {
+            pwm_channel_apply(p_instance, channel, p_cb->channels_cb[channel].pending);
+        }
+    }
+    nrf_timer_int_disable(p_reg, NRF_TIMER_INT_COMPARE3_MASK);
+    nrf_timer_shorts_disable(p_reg, NRF_TIMER_SHORT_COMPARE3_STOP_MASK);
+    nrf_timer_task_trigger(p_reg, NRF_TIMER_TASK_START);
+    p_cb->update_pending = false;
+
+    if (p_cb->p_ready_callback)
+    {
+        p_cb->p_ready_callback(p_instance->p_timer->instance_id);
+    }
+}
+
+
+/**
+ * @brief Function for releasing the resources of a PWM instance.
+ *
+ * @param[in] p_instance  PWM instance.
+ */
+static void pwm_dealloc(app_pwm_sync_t const * const p_instance)
+{
+    app_pwm_sync_cb_t * p_cb = p_instance->p_cb;
+
+    for (uint8_t ch = 0; ch < APP_PWM_SYNC_CHANNELS_PER_INSTANCE; ++ch)
+    {
+        for (uint8_t i = 0; i < APP_PWM_REQUIRED_PPI_CHANNELS_PER_CHANNEL; ++i)
+        {
+            if (p_cb->channels_cb[ch].ppi_channels[i] != (nrf_ppi_channel_t)UNALLOCATED)
+            {
+                nrf_drv_ppi_channel_free(p_cb->channels_cb[ch].ppi_channels[i]);
+                p_cb->channels_cb[ch].ppi_channels[i] = (nrf_ppi_channel_t)UNALLOCATED;
+            }
+        }
+        if (p_cb->channels_cb[ch].gpio_pin != UNALLOCATED)
+        {
+            nrf_drv_gpiote_out_uninit(p_cb->channels_cb[ch].gpio_pin);
+            p_cb->channels_cb[ch].gpio_pin = UNALLOCATED;
+        }
+        p_cb->channels_cb[ch].initialized = APP_PWM_CHANNEL_UNINITIALIZED;
+    }
+    nrf_drv_timer_uninit(p_instance->p_timer);
+    return;
+}
+
+
+/**
+ * @brief Function for initializing a PWM channel.
+ *
+ * @param[in] p_instance  PWM instance.
+ * @param[in] channel     Channel number.
+ * @param[in] pin         GPIO pin number.
+ * @param[in] polarity    Polarity of active state on pin.
+ *
+ * @retval    NRF_SUCCESS If initialization was successful.
+ * @retval    NRF_ERROR_NO_MEM If there were not enough free resources.
+ */
+static ret_code_t pwm_channel_init(app_pwm_sync_t const * const p_instance, uint8_t channel,
+                                   uint32_t pin, app_pwm_polarity_t polarity)
+{
+    app_pwm_sync_channel_cb_t * p_channel_cb = &p_instance->p_cb->channels_cb[channel];
+
+    p_channel_cb->pulsewidth = 0;
+    p_channel_cb->pending    = 0;
+    p_channel_cb->polarity   = polarity;
+
+    /* GPIOTE setup: */
+    nrf_drv_gpiote_out_config_t out_cfg = GPIOTE_CONFIG_OUT_TASK_TOGGLE( POLARITY_INACTIVE(p_instance, channel) );
+    if (nrf_drv_gpiote_out_init((nrf_drv_gpiote_pin_t)pin, &out_cfg) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_channel_cb->gpio_pin = pin;
+
+    /* PPI setup: */
+    for (uint8_t i = 0; i < APP_PWM_REQUIRED_PPI_CHANNELS_PER_CHANNEL; ++i)
+    {
+        if (nrf_drv_ppi_channel_alloc(&p_channel_cb->ppi_channels[i]) != NRF_SUCCESS)
+        {
+            return NRF_ERROR_NO_MEM; // Resource de-allocation is done by callee.
+        }
+    }
+
+    nrf_drv_ppi_channel_disable(p_channel_cb->ppi_channels[0]);
+    nrf_drv_ppi_channel_disable(p_channel_cb->ppi_channels[1]);
+    nrf_drv_ppi_channel_assign(p_channel_cb->ppi_channels[0],
+                               nrf_drv_timer_compare_event_address_get(p_instance->p_timer, channel),
+                               nrf_drv_gpiote_out_task_addr_get(p_channel_cb->gpio_pin));
+    nrf_drv_ppi_channel_assign(p_channel_cb->ppi_channels[1],
+                               nrf_drv_timer_compare_event_address_get(p_instance->p_timer, PWM_PERIOD_CC_CHANNEL),
+                               nrf_drv_gpiote_out_task_addr_get(p_channel_cb->gpio_pin));
+
+    p_channel_cb->initialized = APP_PWM_CHANNEL_INITIALIZED;
+
+    return NRF_SUCCESS;
+}
+
+
+/**
+ * @brief Function for calculating target timer frequency, which will allow to set given period length.
+ *
+ * @param[in] period_us       Desired period in microseconds.
+ *
+ * @retval    Timer frequency.
+ */
+static nrf_timer_frequency_t pwm_calculate_timer_frequency(uint32_t period_us)
+{
+    uint32_t f   = (uint32_t)NRF_TIMER_FREQ_16MHz;
+    uint32_t min = (uint32_t)NRF_TIMER_FREQ_31250Hz;
+
+    while ((period_us > TIMER_MAX_PULSEWIDTH_US_ON_16M) && (f < min))
+    {
+        period_us >>= 1;
+        ++f;
+    }
+    return (nrf_timer_frequency_t)f;
+}
+
+
+ret_code_t app_pwm_sync_init(app_pwm_sync_t const * const p_instance, app_pwm_sync_config_t const * const p_config,
+                             app_pwm_callback_t p_ready_callback)
+{
+    ASSERT(p_instance);
+
+    if (!p_config)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+    if (p_config->num_of_channels == 0 ||
+        p_config->num_of_channels > APP_PWM_SYNC_CHANNELS_PER_INSTANCE ||
+        p_config->period_us == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    app_pwm_sync_cb_t * p_cb = p_instance->p_cb;
+
+    if (p_cb->state != NRF_DRV_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    uint32_t err_code = nrf_drv_ppi_init();
+    if ((err_code != NRF_SUCCESS) && (err_code != MODULE_ALREADY_INITIALIZED))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    if (!nrf_drv_gpiote_is_init())
+    {
+        err_code = nrf_drv_gpiote_init();
+        if (err_code != NRF_SUCCESS)
+        {
+            return NRF_ERROR_INTERNAL;
+        }
+    }
+
+    // Initialize timer first, the channels take their compare event addresses from it:
+    nrf_drv_timer_config_t timer_cfg = {
+        .frequency          = pwm_calculate_timer_frequency(p_config->period_us),
+        .mode               = NRF_TIMER_MODE_TIMER,
+        .bit_width          = NRF_TIMER_BIT_WIDTH_16,
+        .interrupt_priority = APP_IRQ_PRIORITY_LOW,
+        .p_context          = (void *) p_instance
+    };
+    err_code = nrf_drv_timer_init(p_instance->p_timer, &timer_cfg, pwm_sync_tick);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Initialize resource status:
+    for (uint8_t i = 0; i < APP_PWM_SYNC_CHANNELS_PER_INSTANCE; ++i)
+    {
+        p_cb->channels_cb[i].initialized     = APP_PWM_CHANNEL_UNINITIALIZED;
+        p_cb->channels_cb[i].ppi_channels[0] = (nrf_ppi_channel_t)UNALLOCATED;
+        p_cb->channels_cb[i].ppi_channels[1] = (nrf_ppi_channel_t)UNALLOCATED;
+        p_cb->channels_cb[i].gpio_pin        = UNALLOCATED;
+    }
+
+    // Initialize channels:
+    for (uint8_t i = 0; i < p_config->num_of_channels; ++i)
+    {
+        if (p_config->pins[i] != APP_PWM_NOPIN)
+        {
+            err_code = pwm_channel_init(p_instance, i, p_config->pins[i], p_config->pin_polarity[i]);
+            if (err_code != NRF_SUCCESS)
+            {
+                pwm_dealloc(p_instance);
+                return err_code;
+            }
+        }
+    }
+
+    p_cb->period = nrf_drv_timer_us_to_ticks(p_instance->p_timer, p_config->period_us);
+    nrf_drv_timer_clear(p_instance->p_timer);
+    nrf_drv_timer_extended_compare(p_instance->p_timer, (nrf_timer_cc_channel_t) PWM_PERIOD_CC_CHANNEL,
+                                   p_cb->period, NRF_TIMER_SHORT_COMPARE3_CLEAR_MASK, false);
+
+    p_cb->p_ready_callback = p_ready_callback;
+    p_cb->update_pending   = false;
+    p_cb->state            = NRF_DRV_STATE_INITIALIZED;
+
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t app_pwm_sync_uninit(app_pwm_sync_t const * const p_instance)
+{
+    app_pwm_sync_cb_t * p_cb = p_instance->p_cb;
+
+    if (p_cb->state == NRF_DRV_STATE_POWERED_ON)
+    {
+        app_pwm_sync_disable(p_instance);
+    }
+    else if (p_cb->state == NRF_DRV_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    pwm_dealloc(p_instance);
+
+    p_cb->state = NRF_DRV_STATE_UNINITIALIZED;
+    return NRF_SUCCESS;
+}
+
+
+void app_pwm_sync_enable(app_pwm_sync_t const * const p_instance)
+{
+    app_pwm_sync_cb_t * p_cb = p_instance->p_cb;
+
+    ASSERT(p_cb->state != NRF_DRV_STATE_UNINITIALIZED);
+
+    // The timer is shut down, so it is safe to set the outputs up like at a boundary.
+    for (uint8_t channel = 0; channel < APP_PWM_SYNC_CHANNELS_PER_INSTANCE; ++channel)
+    {
+        if (p_cb->channels_cb[channel].initialized)
+        {
+            pwm_channel_apply(p_instance, channel, p_cb->channels_cb[channel].pulsewidth);
+        }
+    }
+    pan73_workaround(p_instance->p_timer->p_reg, true);
+    nrf_drv_timer_clear(p_instance->p_timer);
+    nrf_drv_timer_enable(p_instance->p_timer);
+
+    p_cb->state = NRF_DRV_STATE_POWERED_ON;
+    return;
+}
+
+
+void app_pwm_sync_disable(app_pwm_sync_t const * const p_instance)
+{
+    app_pwm_sync_cb_t * p_cb  = p_instance->p_cb;
+    NRF_TIMER_Type    * p_reg = p_instance->p_timer->p_reg;
+
+    ASSERT(p_cb->state != NRF_DRV_STATE_UNINITIALIZED);
+
+    CRITICAL_REGION_ENTER();
+    nrf_drv_timer_disable(p_instance->p_timer);
+    nrf_timer_int_disable(p_reg, NRF_TIMER_INT_COMPARE3_MASK);
+    nrf_timer_shorts_disable(p_reg, NRF_TIMER_SHORT_COMPARE3_STOP_MASK);
+    for (uint8_t channel = 0; channel < APP_PWM_SYNC_CHANNELS_PER_INSTANCE; ++channel)
+    {
+        app_pwm_sync_channel_cb_t * p_ch_cb = &p_cb->channels_cb[channel];
+        if (p_ch_cb->initialized)
+        {
+            // An update that didn't make it to a boundary is output on the next enable.
+            if (p_cb->update_pending)
+            {
+                p_ch_cb->pulsewidth = p_ch_cb->pending;
+            }
+            if (POLARITY_INACTIVE(p_instance, channel))
+            {
+                nrf_gpio_pin_set(p_ch_cb->gpio_pin);
+            }
+            else
+            {
+                nrf_gpio_pin_clear(p_ch_cb->gpio_pin);
+            }
+            nrf_drv_gpiote_out_task_disable(p_ch_cb->gpio_pin);
+            nrf_drv_ppi_channel_disable(p_ch_cb->ppi_channels[0]);
+            nrf_drv_ppi_channel_disable(p_ch_cb->ppi_channels[1]);
+        }
+    }
+    p_cb->update_pending = false;
+    CRITICAL_REGION_EXIT();
+    pan73_workaround(p_reg, false);
+
+    p_cb->state = NRF_DRV_STATE_INITIALIZED;
+    return;
+}
+
+
+ret_code_t app_pwm_sync_duty_ticks_set(app_pwm_sync_t const * const p_instance, uint16_t const * p_ticks)
+{
+    app_pwm_sync_cb_t * p_cb = p_instance->p_cb;
+
+    ASSERT(p_ticks);
+
+    if (p_cb->state == NRF_DRV_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    CRITICAL_REGION_ENTER();
+    for (uint8_t channel = 0; channel < APP_PWM_SYNC_CHANNELS_PER_INSTANCE; ++channel)
+    {
+        app_pwm_sync_channel_cb_t * p_ch_cb = &p_cb->channels_cb[channel];
+        if (p_ch_cb->initialized)
+        {
+            p_ch_cb->pending = (p_ticks[channel] > p_cb->period) ? p_cb->period : p_ticks[channel];
+            if (p_cb->state != NRF_DRV_STATE_POWERED_ON)
+            {
+                p_ch_cb->pulsewidth = p_ch_cb->pending;
+            }
+        }
+    }
+    // A pending update is replaced, the timer is already armed for it.
+    if (p_cb->state == NRF_DRV_STATE_POWERED_ON && !p_cb->update_pending)
+    {
+        p_cb->update_pending = true;
+        pwm_stop_arm(p_instance);
+    }
+    CRITICAL_REGION_EXIT();
+
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t app_pwm_sync_duty_set(app_pwm_sync_t const * const p_instance, app_pwm_duty_t const * p_duties)
+{
+    app_pwm_sync_cb_t * p_cb = p_instance->p_cb;
+    uint16_t ticks[APP_PWM_SYNC_CHANNELS_PER_INSTANCE] = {0};
+
+    ASSERT(p_duties);
+
+    for (uint8_t channel = 0; channel < APP_PWM_SYNC_CHANNELS_PER_INSTANCE; ++channel)
+    {
+        if (p_cb->channels_cb[channel].initialized)
+        {
+            if (p_duties[channel] > 100)
+            {
+                return NRF_ERROR_INVALID_PARAM;
+            }
+            ticks[channel] = ((uint32_t)p_cb->period * p_duties[channel]) / 100;
+        }
+    }
+    return app_pwm_sync_duty_ticks_set(p_instance, ticks);
+}
+
+
+bool app_pwm_sync_busy_check(app_pwm_sync_t const * const p_instance)
+{
+    return p_instance->p_cb->update_pending;
+}
+
+
+uint16_t app_pwm_sync_duty_ticks_get(app_pwm_sync_t const * const p_instance, uint8_t channel)
+{
+    ASSERT(channel < APP_PWM_SYNC_CHANNELS_PER_INSTANCE);
+    return p_instance->p_cb->channels_cb[channel].pulsewidth;
+}
+
+
+uint16_t app_pwm_sync_cycle_ticks_get(app_pwm_sync_t const * const p_instance)
+{
+    return p_instance->p_cb->period;
+}
+
+//lint -restore
@@ -0,0 +1,244 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup app_pwm_sync Synchronized multi-channel PWM
+ * @{
+ * @ingroup app_common
+ *
+ * @brief Module for generating up to three PWM outputs from one timer, with
+ *        all duty cycle changes applied at the same period boundary.
+ *
+ * @details All channels share the period of the timer, and are right-aligned:
+ * a channel goes active when the timer reaches its compare value, and inactive
+ * at the end of the period. New duty cycles for all channels are set in one
+ * call, and are latched together: when an update is pending, the timer stops
+ * itself at the end of the period, the timer interrupt writes the new compare
+ * values while all outputs are in their start-of-period state, and starts the
+ * timer again. A late interrupt only stretches the inactive part of that one
+ * period, so a fade over several channels (RGB, warm/cold white) never shows
+ * a wrong color or an inverted output, however busy the CPU is.
+ *
+ * Resource usage:
+ * - 1 timer per instance (compare channel 3 is the period).
+ * - 2 PPI channels per PWM channel.
+ * - 1 GPIOTE channel per PWM channel.
+ *
+ * For example, an RGB instance uses 1 timer, 6 PPI channels and 3 GPIOTE channels,
+ * where two @ref app_pwm instances would use 2 timers, 10 PPI channels and 2 PPI groups.
+ *
+ * The maximum number of PWM channels per instance is 3, as the nRF51 timers
+ * have four compare registers.
+ */
+
+#ifndef APP_PWM_SYNC_H__
+#define APP_PWM_SYNC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "app_pwm.h"
+#include "nrf_drv_timer.h"
+#include "nrf_drv_common.h"
+#include "nrf_drv_ppi.h"
+
+
+/** @brief Maximum number of channels for one timer instance (one compare register is the period). */
+#define APP_PWM_SYNC_CHANNELS_PER_INSTANCE 3
+
+/**@brief Macro for creating a synchronized PWM instance. */
+#define APP_PWM_SYNC_INSTANCE(name, num)                                           \
+    const nrf_drv_timer_t m_pwm_sync_##name##_timer = NRF_DRV_TIMER_INSTANCE(num); \
+    app_pwm_sync_cb_t m_pwm_sync_##name##_cb;                                      \
+    /*lint -e{545}*/                                                               \
+    const app_pwm_sync_t name = {                                                  \
+        .p_cb    = &m_pwm_sync_##name##_cb,                                        \
+        .p_timer = &m_pwm_sync_##name##_timer,                                     \
+    }
+
+/**@brief Synchronized PWM instance default configuration (3 channels, e.g. RGB). */
+#define APP_PWM_SYNC_DEFAULT_CONFIG_3CH(period_in_us, pin0, pin1, pin2)                    \
+    {                                                                                      \
+        .pins            = {pin0, pin1, pin2},                                             \
+        .pin_polarity    = {APP_PWM_POLARITY_ACTIVE_LOW, APP_PWM_POLARITY_ACTIVE_LOW,      \
+                            APP_PWM_POLARITY_ACTIVE_LOW},                                  \
+        .num_of_channels = 3,                                                              \
+        .period_us       = period_in_us                                                    \
+    }
+
+/**@brief Synchronized PWM configuration structure used for initialization. */
+typedef struct
+{
+    uint32_t           pins[APP_PWM_SYNC_CHANNELS_PER_INSTANCE];         //!< Pins configured as PWM output (APP_PWM_NOPIN if unused).
+    app_pwm_polarity_t pin_polarity[APP_PWM_SYNC_CHANNELS_PER_INSTANCE]; //!< Polarity of active state on pin.
+    uint32_t           num_of_channels;                                  //!< Number of channels that can be used.
+    uint32_t           period_us;                                        //!< PWM signal output period to configure (in microseconds).
+} app_pwm_sync_config_t;
+
+
+/**
+ * @cond (NODOX)
+ * @defgroup app_pwm_sync_internal Auxiliary internal types declarations
+ * @{
+ * @internal
+ *
+ * @brief Module for internal usage inside the library only
+ *
+ * Any functions and variables defined here may change at any time
+ * without a warning, so you should not access them directly.
+ */
+
+    /**
+     * @brief Synchronized PWM channel instance
+     */
+    typedef struct
+    {
+        uint32_t           gpio_pin;        //!< Pin that is used by this PWM channel.
+        uint16_t           pulsewidth;      //!< Duty cycle currently output (in ticks).
+        uint16_t           pending;         //!< Duty cycle to latch at the next period boundary (in ticks).
+        nrf_ppi_channel_t  ppi_channels[2]; //!< PPI channels setting the output at the compare and clearing it at the period end.
+        app_pwm_polarity_t polarity;        //!< The active state of the pin.
+        uint8_t            initialized;     //!< The internal information if the selected channel was initialized.
+    } app_pwm_sync_channel_cb_t;
+
+    /**
+     * @brief Variable part of synchronized PWM instance
+     */
+    typedef struct
+    {
+        app_pwm_sync_channel_cb_t channels_cb[APP_PWM_SYNC_CHANNELS_PER_INSTANCE]; //!< Channels data
+        uint16_t                  period;                                          //!< Selected period in ticks
+        volatile bool             update_pending;                                  //!< New duty cycles wait for the period boundary
+        app_pwm_callback_t        p_ready_callback;                                //!< Callback function called when an update is latched
+        nrf_drv_state_t           state;                                           //!< Current driver status
+    } app_pwm_sync_cb_t;
+/** @}
+ * @endcond
+ */
+
+
+/**@brief Synchronized PWM instance structure. */
+typedef struct
+{
+    app_pwm_sync_cb_t *p_cb;               //!< Pointer to control block internals.
+    nrf_drv_timer_t const * const p_timer; //!< Timer used by this PWM instance.
+} app_pwm_sync_t;
+
+/**
+ * @brief Function for initializing a synchronized PWM instance.
+ *
+ * All channels start at 0% duty cycle.
+ *
+ * @param[in] p_instance        PWM instance.
+ * @param[in] p_config          Initial configuration.
+ * @param[in] p_ready_callback  Pointer to function called from the timer interrupt when
+ *                              an update has been latched (or NULL to disable).
+ *
+ * @retval    NRF_SUCCESS If initialization was successful.
+ * @retval    NRF_ERROR_NO_MEM If there were not enough free resources.
+ * @retval    NRF_ERROR_INVALID_DATA If no configuration structure was passed.
+ * @retval    NRF_ERROR_INVALID_PARAM If the channel count or the period is invalid.
+ * @retval    NRF_ERROR_INVALID_STATE If the timer/PWM is already in use or if initialization failed.
+ */
+ret_code_t app_pwm_sync_init(app_pwm_sync_t const * const p_instance, app_pwm_sync_config_t const * const p_config,
+                             app_pwm_callback_t p_ready_callback);
+
+/**
+ * @brief Function for uninitializing a synchronized PWM instance and releasing the allocated resources.
+ *
+ * @param[in] p_instance  PWM instance.
+ *
+ * @retval    NRF_SUCCESS If uninitialization was successful.
+ * @retval    NRF_ERROR_INVALID_STATE If the given instance was not initialized.
+ */
+ret_code_t app_pwm_sync_uninit(app_pwm_sync_t const * const p_instance);
+
+/**
+ * @brief Function for enabling a synchronized PWM instance after initialization.
+ *
+ * @param[in] p_instance  PWM instance.
+ */
+void app_pwm_sync_enable(app_pwm_sync_t const * const p_instance);
+
+/**
+ * @brief Function for disabling a synchronized PWM instance after initialization.
+ *
+ * The outputs are left in their inactive state. The duty cycles are kept, and are
+ * output again when the instance is enabled.
+ *
+ * @param[in] p_instance  PWM instance.
+ */
+void app_pwm_sync_disable(app_pwm_sync_t const * const p_instance);
+
+/**
+ * @brief Function for setting the duty cycle of all channels in percents.
+ *
+ * The new duty cycles are applied together at the next period boundary. Unlike
+ * @ref app_pwm_channel_duty_set, this never returns NRF_ERROR_BUSY: a call made
+ * before the previous update is latched replaces it.
+ *
+ * @param[in] p_instance  PWM instance.
+ * @param[in] p_duties    Duty cycle (0 - 100) of each initialized channel, indexed by channel.
+ *
+ * @retval    NRF_SUCCESS If the update was scheduled.
+ * @retval    NRF_ERROR_INVALID_PARAM If a duty cycle is above 100.
+ * @retval    NRF_ERROR_INVALID_STATE If the given instance was not initialized.
+ */
+ret_code_t app_pwm_sync_duty_set(app_pwm_sync_t const * const p_instance, app_pwm_duty_t const * p_duties);
+
+/**
+ * @brief Function for setting the duty cycle of all channels in clock ticks.
+ *
+ * Values of @ref app_pwm_sync_cycle_ticks_get or above give 100% duty cycle.
+ *
+ * @param[in] p_instance  PWM instance.
+ * @param[in] p_ticks     Number of PWM clock ticks of each initialized channel, indexed by channel.
+ *
+ * @retval    NRF_SUCCESS If the update was scheduled.
+ * @retval    NRF_ERROR_INVALID_STATE If the given instance was not initialized.
+ */
+ret_code_t app_pwm_sync_duty_ticks_set(app_pwm_sync_t const * const p_instance, uint16_t const * p_ticks);
+
+/**
+ * @brief Function for checking if an update is waiting for the period boundary.
+ *
+ * @param[in] p_instance  PWM instance.
+ *
+ * @retval    True  If the last update has not been latched yet.
+ * @retval    False If the outputs show the last update.
+ */
+bool app_pwm_sync_busy_check(app_pwm_sync_t const * const p_instance);
+
+/**
+ * @brief Function for retrieving the duty cycle of a channel in ticks.
+ *
+ * @param[in] p_instance  PWM instance.
+ * @param[in] channel     Channel number.
+ *
+ * @return    Number of ticks currently output on the selected channel.
+ */
+uint16_t app_pwm_sync_duty_ticks_get(app_pwm_sync_t const * const p_instance, uint8_t channel);
+
+/**
+ * @brief Function for returning the number of ticks in a whole cycle.
+ *
+ * @param[in] p_instance  PWM instance.
+ *
+ * @return    Number of ticks that corresponds to 100% of the duty cycle.
+ */
+uint16_t app_pwm_sync_cycle_ticks_get(app_pwm_sync_t const * const p_instance);
+
+
+#endif
+
+/** @} */
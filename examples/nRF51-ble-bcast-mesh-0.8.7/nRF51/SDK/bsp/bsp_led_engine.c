@@ -0,0 +1,169 @@
+/* Copyright (c) 2014 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+
+#include "bsp_led_engine.h"
+#include <stddef.h>
+#include "nrf.h"
+#include "nrf_gpio.h"
+#include "nrf_error.h"
+#include "nrf_drv_timer.h"
+#include "nrf_drv_ppi.h"
+#include "nrf_drv_gpiote.h"
+#include "app_util_platform.h"
+
+/* expands the instance number before the driver pastes it */
+#define LED_ENGINE_TIMER_INSTANCE(id)  NRF_DRV_TIMER_INSTANCE(id)
+
+static const nrf_drv_timer_t m_timer = LED_ENGINE_TIMER_INSTANCE(BSP_LED_ENGINE_TIMER);
+
+static uint32_t          m_pin;
+static bool              m_active_high;
+static nrf_ppi_channel_t m_ppi_off;     /**< CC[0] toggles the LED off. */
+static nrf_ppi_channel_t m_ppi_period;  /**< CC[1] toggles it on again, or CC[0] powers the TIMER down after a pulse. */
+
+static void timer_event_handler(nrf_timer_event_t event_type, void * p_context)
+{
+    // Compare interrupts aren't enabled, the PPI channels do all the work.
+}
+
+/**@brief Power the TIMER down, and hand the pin back to the GPIO OUT register. */
+static void pattern_stop(void)
+{
+    nrf_timer_task_trigger(m_timer.p_reg, NRF_TIMER_TASK_SHUTDOWN);
+    nrf_timer_shorts_disable(m_timer.p_reg, NRF_TIMER_SHORT_COMPARE1_CLEAR_MASK);
+    (void) nrf_drv_ppi_channel_disable(m_ppi_off);
+    (void) nrf_drv_ppi_channel_disable(m_ppi_period);
+    nrf_drv_gpiote_out_task_disable(m_pin);
+}
+
+/**@brief Start the TIMER from 0 with the LED on. */
+static void pattern_start(void)
+{
+    nrf_drv_timer_clear(&m_timer);
+    (void) nrf_drv_ppi_channel_enable(m_ppi_off);
+    (void) nrf_drv_ppi_channel_enable(m_ppi_period);
+    // The pin rests at the off level when the GPIOTE channel lets go of it.
+    nrf_gpio_pin_write(m_pin, !m_active_high);
+    nrf_drv_gpiote_out_task_force(m_pin, m_active_high);
+    nrf_timer_task_trigger(m_timer.p_reg, NRF_TIMER_TASK_START);
+}
+
+uint32_t bsp_led_engine_init(uint32_t pin, bool active_high)
+{
+    uint32_t err_code;
+    nrf_drv_timer_config_t timer_config = NRF_DRV_TIMER_DEFAULT_CONFIG(BSP_LED_ENGINE_TIMER);
+    nrf_drv_gpiote_out_config_t out_config = GPIOTE_CONFIG_OUT_TASK_TOGGLE(!active_high);
+
+    m_pin = pin;
+    m_active_high = active_high;
+
+    timer_config.frequency = NRF_TIMER_FREQ_31250Hz;
+    timer_config.mode = NRF_TIMER_MODE_TIMER;
+    timer_config.bit_width = NRF_TIMER_BIT_WIDTH_16;
+    err_code = nrf_drv_timer_init(&m_timer, &timer_config, timer_event_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    if (!nrf_drv_gpiote_is_init())
+    {
+        err_code = nrf_drv_gpiote_init();
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+    err_code = nrf_drv_gpiote_out_init(pin, &out_config);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    nrf_drv_gpiote_out_task_disable(pin);
+
+    err_code = nrf_drv_ppi_init();
+    if (err_code != NRF_SUCCESS && err_code != MODULE_ALREADY_INITIALIZED)
+    {
+        return err_code;
+    }
+    err_code = nrf_drv_ppi_channel_alloc(&m_ppi_off);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    err_code = nrf_drv_ppi_channel_alloc(&m_ppi_period);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    return nrf_drv_ppi_channel_assign(m_ppi_off,
+                                      nrf_drv_timer_compare_event_address_get(&m_timer, NRF_TIMER_CC_CHANNEL0),
+                                      nrf_drv_gpiote_out_task_addr_get(pin));
+}
+
+void bsp_led_engine_set(bool on)
+{
+    CRITICAL_REGION_ENTER();
+    pattern_stop();
+    nrf_gpio_pin_write(m_pin, (on == m_active_high));
+    CRITICAL_REGION_EXIT();
+}
+
+uint32_t bsp_led_engine_pulse(uint32_t on_ms)
+{
+    if (on_ms == 0 || on_ms > BSP_LED_ENGINE_MAX_MS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+    pattern_stop();
+    nrf_drv_timer_extended_compare(&m_timer,
+                                   NRF_TIMER_CC_CHANNEL0,
+                                   nrf_drv_timer_ms_to_ticks(&m_timer, on_ms),
+                                   (nrf_timer_short_mask_t) 0,
+                                   false);
+    (void) nrf_drv_ppi_channel_assign(m_ppi_period,
+                                      nrf_drv_timer_compare_event_address_get(&m_timer, NRF_TIMER_CC_CHANNEL0),
+                                      nrf_drv_timer_task_address_get(&m_timer, NRF_TIMER_TASK_SHUTDOWN));
+    pattern_start();
+    CRITICAL_REGION_EXIT();
+    return NRF_SUCCESS;
+}
+
+uint32_t bsp_led_engine_blink(uint32_t on_ms, uint32_t period_ms)
+{
+    if (on_ms == 0 || on_ms >= period_ms || period_ms > BSP_LED_ENGINE_MAX_MS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+    pattern_stop();
+    nrf_drv_timer_extended_compare(&m_timer,
+                                   NRF_TIMER_CC_CHANNEL0,
+                                   nrf_drv_timer_ms_to_ticks(&m_timer, on_ms),
+                                   (nrf_timer_short_mask_t) 0,
+                                   false);
+    nrf_drv_timer_extended_compare(&m_timer,
+                                   NRF_TIMER_CC_CHANNEL1,
+                                   nrf_drv_timer_ms_to_ticks(&m_timer, period_ms),
+                                   NRF_TIMER_SHORT_COMPARE1_CLEAR_MASK,
+                                   false);
+    (void) nrf_drv_ppi_channel_assign(m_ppi_period,
+                                      nrf_drv_timer_compare_event_address_get(&m_timer, NRF_TIMER_CC_CHANNEL1),
+                                      nrf_drv_gpiote_out_task_addr_get(m_pin));
+    pattern_start();
+    CRITICAL_REGION_EXIT();
+    return NRF_SUCCESS;
+}
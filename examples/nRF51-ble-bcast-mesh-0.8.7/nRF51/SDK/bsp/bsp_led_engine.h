@@ -0,0 +1,87 @@
+/* Copyright (c) 2014 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+
+/**@file
+ *
+ * @defgroup bsp_led_engine Hardware-timed LED patterns
+ * @{
+ * @ingroup bsp
+ *
+ * @brief Plays blink patterns on one LED without the CPU.
+ * @details A TIMER running at 31.25 kHz has the on time in CC[0] and the
+ *          period in CC[1], and the compare events toggle the LED pin through
+ *          PPI channels and a GPIOTE task. A repeating blink clears the TIMER
+ *          at the end of each period. A single pulse powers the TIMER down
+ *          from its own compare event. The CPU is only needed to change the
+ *          pattern.
+ *
+ *          While a pattern plays, the TIMER keeps the 16 MHz clock requested.
+ *          The GPIOTE channel drives the pin from the start of a pattern until
+ *          @ref bsp_led_engine_set is called, so all other writes to the LED
+ *          must go through that function too.
+ */
+
+#ifndef BSP_LED_ENGINE_H__
+#define BSP_LED_ENGINE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** TIMER instance playing the patterns. Must be enabled in nrf_drv_config.h. */
+#ifndef BSP_LED_ENGINE_TIMER
+#define BSP_LED_ENGINE_TIMER        1
+#endif
+
+/** Longest period or on time, where the 16-bit TIMER wraps at 31.25 kHz. */
+#define BSP_LED_ENGINE_MAX_MS       (2000)
+
+/**@brief Take over an LED pin for the engine, and turn it off.
+ *
+ * @param[in] pin           LED pin.
+ * @param[in] active_high   Whether the LED is on when the pin is high.
+ *
+ * @retval NRF_SUCCESS             The engine is ready.
+ * @retval NRF_ERROR_NO_MEM        No free PPI or GPIOTE channels.
+ * @retval NRF_ERROR_INVALID_STATE The TIMER or the pin is already in use.
+ */
+uint32_t bsp_led_engine_init(uint32_t pin, bool active_high);
+
+/**@brief Stop the pattern, and turn the LED on or off.
+ *
+ * @param[in] on Whether the LED is turned on.
+ */
+void bsp_led_engine_set(bool on);
+
+/**@brief Turn the LED on, and have the hardware turn it off again.
+ *
+ * @param[in] on_ms Time the LED is on, at most @ref BSP_LED_ENGINE_MAX_MS.
+ *
+ * @retval NRF_SUCCESS              The pulse started.
+ * @retval NRF_ERROR_INVALID_PARAM  The time is 0 or too long.
+ */
+uint32_t bsp_led_engine_pulse(uint32_t on_ms);
+
+/**@brief Blink the LED until the pattern is changed.
+ *
+ * @param[in] on_ms     Time the LED is on in each period.
+ * @param[in] period_ms Length of a period, at most @ref BSP_LED_ENGINE_MAX_MS.
+ *
+ * @retval NRF_SUCCESS              The blinking started.
+ * @retval NRF_ERROR_INVALID_PARAM  The on time is 0 or not shorter than the period,
+ *                                  or the period is too long.
+ */
+uint32_t bsp_led_engine_blink(uint32_t on_ms, uint32_t period_ms);
+
+#endif // BSP_LED_ENGINE_H__
+
+/** @} */
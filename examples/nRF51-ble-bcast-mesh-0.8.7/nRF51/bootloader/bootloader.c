@@ -144,6 +144,64 @@ static void interrupts_disable(void)
     }
 }
 
+/** Hand over to the application at the given address. Doesn't return. */
+static void app_start(uint32_t start_addr)
+{
+    interrupts_disable();
+
+    sd_mbr_command_t com = {SD_MBR_COMMAND_INIT_SD, };
+
+    uint32_t err_code = sd_mbr_command(&com);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = sd_softdevice_vector_table_base_set(start_addr);
+    APP_ERROR_CHECK(err_code);
+#ifdef DEBUG_LEDS
+    NRF_GPIO->OUTSET = LEDS_MASK;
+#endif
+    bootloader_util_app_start(start_addr);
+}
+
+#ifndef NO_FAST_BOOT
+/**
+ * Check whether the application can be started without initializing the
+ * bootloader. Only reads the info page, as nothing is initialized yet.
+ */
+static bool fast_boot_app_segment_get(bl_info_segment_t** pp_segment)
+{
+    /* The info page must be intact, or it will need a recovery. */
+    if (bootloader_info_entry_get(BL_INFO_TYPE_LAST) == NULL)
+    {
+        return false;
+    }
+
+    /* A bank that's been partially flashed must be finished first. */
+    for (uint32_t i = 1; i <= 4; i <<= 1)
+    {
+        bl_info_entry_t* p_bank_entry = bootloader_info_entry_get((bl_info_type_t) (BL_INFO_TYPE_BANK_BASE + i));
+        if (p_bank_entry && p_bank_entry->bank.state != BL_INFO_BANK_STATE_IDLE)
+        {
+            return false;
+        }
+    }
+
+    bl_info_entry_t* p_segment_entry = bootloader_info_entry_get(BL_INFO_TYPE_SEGMENT_APP);
+    bl_info_entry_t* p_fwid_entry    = bootloader_info_entry_get(BL_INFO_TYPE_VERSION);
+    if (p_segment_entry == NULL ||
+        p_fwid_entry == NULL ||
+        p_segment_entry->segment.start == 0xFFFFFFFF ||
+        *((uint32_t*) p_segment_entry->segment.start) == 0xFFFFFFFF ||
+        p_fwid_entry->version.app.app_version == APP_VERSION_INVALID ||
+        !fw_is_verified())
+    {
+        return false;
+    }
+
+    *pp_segment = &p_segment_entry->segment;
+    return true;
+}
+#endif
+
 /** Interrupt indicating new serial command */
 #ifdef RBC_MESH_SERIAL
 void SWI2_IRQHandler(void)
@@ -225,6 +283,7 @@ static void rx_cb(mesh_packet_t* p_packet)
         rx_cmd.type = BL_CMD_TYPE_RX;
         rx_cmd.params.rx.p_dfu_packet = (dfu_packet_t*) &p_adv_data->handle;
         rx_cmd.params.rx.length = p_adv_data->adv_data_length - 3;
+        rx_cmd.params.rx.from_serial = false;
         bl_cmd_handler(&rx_cmd);
     }
 }
@@ -450,6 +509,17 @@ static uint32_t bl_evt_handler(bl_evt_t* p_evt)
 /*****************************************************************************
 * Interface functions
 *****************************************************************************/
+void bootloader_fast_boot(void)
+{
+#ifndef NO_FAST_BOOT
+    bl_info_segment_t* p_segment;
+    if (fast_boot_app_segment_get(&p_segment))
+    {
+        app_start(p_segment->start);
+    }
+#endif
+}
+
 void bootloader_init(void)
 {
     rtc_init();
@@ -567,19 +637,7 @@ void bootloader_abort(dfu_end_t end_reason)
             {
                 if (fifo_is_empty(&m_flash_fifo))
                 {
-                    interrupts_disable();
-
-                    sd_mbr_command_t com = {SD_MBR_COMMAND_INIT_SD, };
-
-                    uint32_t err_code = sd_mbr_command(&com);
-                    APP_ERROR_CHECK(err_code);
-
-                    err_code = sd_softdevice_vector_table_base_set(p_segment_entry->segment.start);
-                    APP_ERROR_CHECK(err_code);
-#ifdef DEBUG_LEDS
-                    NRF_GPIO->OUTSET = LEDS_MASK;
-#endif
-                    bootloader_util_app_start(p_segment_entry->segment.start);
+                    app_start(p_segment_entry->segment.start);
                 }
                 else
                 {
@@ -110,7 +110,7 @@ uint32_t bl_cmd_handler(bl_cmd_t* p_bl_cmd)
             break;
 
         case BL_CMD_TYPE_RX:
-            return dfu_mesh_rx(p_bl_cmd->params.rx.p_dfu_packet, p_bl_cmd->params.rx.length, true);
+            return dfu_mesh_rx(p_bl_cmd->params.rx.p_dfu_packet, p_bl_cmd->params.rx.length, p_bl_cmd->params.rx.from_serial);
 
         case BL_CMD_TYPE_TIMEOUT:
             dfu_mesh_timeout();
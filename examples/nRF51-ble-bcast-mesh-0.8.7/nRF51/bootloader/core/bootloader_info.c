@@ -53,7 +53,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PIN_INIT            (5)
 
 #define INFO_WRITE_BUFLEN   (128)
-#define INFO_CACHE_SIZE     (0)
+
+/** Number of invalidated entries the info page may hold before
+ * bootloader_info_compact() rewrites it. */
+#ifndef INFO_COMPACT_THRESHOLD
+#define INFO_COMPACT_THRESHOLD  (8)
+#endif
 
 typedef enum
 {
@@ -97,12 +102,6 @@ typedef struct
     bool wait_for_idle;
 } info_copy_t;
 
-typedef struct
-{
-    bl_info_type_t type;
-    uint16_t offset;
-} info_cache_entry_t;
-
 static bootloader_info_t*               mp_bl_info_page;
 static bootloader_info_t*               mp_bl_info_bank_page;
 static uint8_t                          mp_info_entry_buffer[INFO_WRITE_BUFLEN] __attribute__((aligned(4)));
@@ -113,52 +112,127 @@ static bl_info_state_t                  m_state;
 static bool                             m_write_in_progress;
 static info_copy_t                      m_info_copy;
 static void*                            mp_write_pos;
-#if INFO_CACHE_SIZE > 0
-static info_cache_entry_t               m_info_cache[INFO_CACHE_SIZE];
-static uint8_t                          m_info_cache_index;
-#endif
+/** Types kept in the RAM index, all other types are looked up in flash. */
+static const bl_info_type_t             m_index_types[] =
+{
+    BL_INFO_TYPE_ECDSA_PUBLIC_KEY,
+    BL_INFO_TYPE_VERSION,
+    BL_INFO_TYPE_FLAGS,
+    BL_INFO_TYPE_SEGMENT_SD,
+    BL_INFO_TYPE_SEGMENT_BL,
+    BL_INFO_TYPE_SEGMENT_APP,
+    BL_INFO_TYPE_SEGMENT_APP_ALT,
+    BL_INFO_TYPE_SIGNATURE_SD,
+    BL_INFO_TYPE_SIGNATURE_BL,
+    BL_INFO_TYPE_SIGNATURE_APP,
+    BL_INFO_TYPE_SIGNATURE_BL_INFO,
+    BL_INFO_TYPE_BANK_SD,
+    BL_INFO_TYPE_BANK_BL,
+    BL_INFO_TYPE_BANK_APP,
+    BL_INFO_TYPE_BANK_BL_INFO,
+    BL_INFO_TYPE_LAST,
+};
+#define INFO_INDEX_SIZE     (sizeof(m_index_types) / sizeof(m_index_types[0]))
+static uint16_t                         m_index[INFO_INDEX_SIZE];   /**< Entry offsets in the info page, 0 if not present. */
+static bool                             m_index_valid;
+static bool                             m_index_settling;           /**< The page has changed, and the index can't be rebuilt until flash is idle. */
+static uint16_t                         m_invalid_entries;          /**< Number of invalidated entries found when building the index. */
 #ifdef RTT_LOG
 static char*                            mp_copy_state_str[] = {"IDLE", "ERASE", "METAWRITE", "DATAWRITE", "WAIT FOR IDLE"};
 #endif
 /******************************************************************************
 * Static functions
 ******************************************************************************/
-static bl_info_entry_t* info_entry_get_from_cache(bl_info_type_t type)
+static inline info_buffer_t* bootloader_info_iterate(info_buffer_t* p_buf)
 {
-#if INFO_CACHE_SIZE > 0
-#ifdef RTT_LOG
-    static uint32_t hits = 0, misses = 0;
-#endif
-    for (uint32_t i = 0; i < INFO_CACHE_SIZE; ++i)
+    return (info_buffer_t*) (((uint32_t) p_buf) + ((uint32_t) p_buf->header.len) * 4);
+}
+
+static int32_t index_slot_get(bl_info_type_t type)
+{
+    for (uint32_t i = 0; i < INFO_INDEX_SIZE; ++i)
     {
-        if (m_info_cache[i].type == type)
+        if (m_index_types[i] == type)
         {
-            __LOG("INFO CACHE HIT! Hits/misses: %u/%u\n", ++hits, misses);
-            return (bl_info_entry_t*) ((uint32_t) mp_bl_info_page + m_info_cache[i].offset);
+            return i;
         }
     }
-    ++misses;
-#endif
-    return NULL;
+    return -1;
 }
 
-static void info_entry_cache_invalidate(bl_info_type_t type)
+/** Mark the index as outdated after changing the info page. */
+static void index_invalidate(void)
 {
-#if INFO_CACHE_SIZE > 0
-    for (uint32_t i = 0; i < INFO_CACHE_SIZE; ++i)
+    m_index_valid = false;
+    m_index_settling = true;
+}
+
+/** Walk the entry chain once, and note the first entry of each indexed type,
+ * like info_entry_get() would find it. */
+static void index_build(void)
+{
+    memset(m_index, 0, sizeof(m_index));
+    m_invalid_entries = 0;
+    if (mp_bl_info_page->metadata.metadata_len == 0xFF)
+    {
+        return;
+    }
+
+    info_buffer_t* p_buffer =
+        (info_buffer_t*) ((uint32_t) mp_bl_info_page + mp_bl_info_page->metadata.metadata_len);
+
+    for (uint32_t iterations = 0; iterations <= PAGE_SIZE / 2; ++iterations)
     {
-        if (m_info_cache[i].type == type)
+        if ((uint32_t) p_buffer > ((uint32_t) mp_bl_info_page) + PAGE_SIZE)
+        {
+            break;
+        }
+        bl_info_type_t type = (bl_info_type_t) p_buffer->header.type;
+        if (type == BL_INFO_TYPE_INVALID)
+        {
+            m_invalid_entries++;
+        }
+        else
         {
-            m_info_cache[i].type = BL_INFO_TYPE_INVALID;
+            int32_t slot = index_slot_get(type);
+            if (slot >= 0 && m_index[slot] == 0)
+            {
+                m_index[slot] = (uint32_t) &p_buffer->entry - (uint32_t) mp_bl_info_page;
+            }
         }
+        if (type == BL_INFO_TYPE_LAST)
+        {
+            break;
+        }
+        p_buffer = bootloader_info_iterate(p_buffer);
     }
-#endif
+    m_index_valid = true;
 }
 
-
-static inline info_buffer_t* bootloader_info_iterate(info_buffer_t* p_buf)
+/**
+ * Look up an entry in the RAM index, building it first if necessary.
+ *
+ * @return Whether the index could answer, in which case *pp_entry is set to
+ * the entry, or NULL if there's no entry of this type.
+ */
+static bool index_lookup(bl_info_type_t type, bl_info_entry_t** pp_entry)
 {
-    return (info_buffer_t*) (((uint32_t) p_buf) + ((uint32_t) p_buf->header.len) * 4);
+    int32_t slot = index_slot_get(type);
+    if (slot < 0)
+    {
+        return false;
+    }
+    if (!m_index_valid)
+    {
+        if (m_state != BL_INFO_STATE_IDLE || m_index_settling)
+        {
+            return false;
+        }
+        index_build();
+    }
+    *pp_entry = (m_index[slot] == 0) ? NULL :
+        (bl_info_entry_t*) ((uint32_t) mp_bl_info_page + m_index[slot]);
+    return true;
 }
 
 static bl_info_entry_t* info_entry_get(bootloader_info_t* p_bl_info_page, bl_info_type_t type)
@@ -504,6 +578,7 @@ static uint32_t copy_page(bootloader_info_t* p_dst, bootloader_info_t* p_src)
 
 static uint32_t backup(void)
 {
+    index_invalidate();
     uint32_t error_code = copy_page(mp_bl_info_bank_page, mp_bl_info_page);
     if (error_code == NRF_SUCCESS)
     {
@@ -515,9 +590,7 @@ static uint32_t backup(void)
 /** Pull in all entries from the bank. */
 static uint32_t recover(void)
 {
-#if INFO_CACHE_SIZE > 0
-    memset(&m_info_cache, 0, sizeof(m_info_cache));
-#endif
+    index_invalidate();
     uint32_t error_code = copy_page(mp_bl_info_page, mp_bl_info_bank_page);
     if (error_code == NRF_SUCCESS)
     {
@@ -533,6 +606,7 @@ uint32_t entry_invalidate(bootloader_info_t* p_info_page, bl_info_type_t type)
     bootloader_info_header_t* p_header = bootloader_info_header_get(info_entry_get(p_info_page, type));
     if (p_header)
     {
+        index_invalidate();
         return entry_header_invalidate(p_header);
     }
     return NRF_ERROR_NOT_FOUND;
@@ -574,6 +648,8 @@ uint32_t entry_write(info_buffer_t* p_dst,
 uint32_t bootloader_info_init(uint32_t* p_bl_info_page, uint32_t* p_bl_info_bank_page)
 {
     m_state = BL_INFO_STATE_UNINITIALIZED;
+    m_index_valid = false;
+    m_index_settling = false;
 
     if (!IS_PAGE_ALIGNED(p_bl_info_page) ||
         !IS_PAGE_ALIGNED(p_bl_info_bank_page))
@@ -599,6 +675,7 @@ uint32_t bootloader_info_init(uint32_t* p_bl_info_page, uint32_t* p_bl_info_bank
             return NRF_ERROR_INVALID_DATA;
         }
 
+        index_invalidate();
         APP_ERROR_CHECK(flash_erase((uint32_t*) mp_bl_info_page, PAGE_SIZE));
         APP_ERROR_CHECK(flash_write((uint32_t*) mp_bl_info_page,
                             (uint8_t*) mp_bl_info_bank_page,
@@ -616,19 +693,12 @@ bootloader_info_t* bootloader_info_get(void)
 
 bl_info_entry_t* bootloader_info_entry_get(bl_info_type_t type)
 {
-    bl_info_entry_t* p_entry = info_entry_get_from_cache(type);
-    if (p_entry != NULL)
+    bl_info_entry_t* p_entry;
+    if (index_lookup(type, &p_entry))
     {
         return p_entry;
     }
-    p_entry = info_entry_get((bootloader_info_t*) BOOTLOADER_INFO_ADDRESS, type);
-#if INFO_CACHE_SIZE > 0
-    if (p_entry != NULL)
-    {
-        m_info_cache[(m_info_cache_index++) & (INFO_CACHE_SIZE - 1)] = (info_cache_entry_t) { type, (uint32_t) p_entry - (uint32_t) BOOTLOADER_INFO_ADDRESS };
-    }
-#endif
-    return p_entry;
+    return info_entry_get((bootloader_info_t*) BOOTLOADER_INFO_ADDRESS, type);
 }
 
 bl_info_entry_t* bootloader_info_entry_put(bl_info_type_t type,
@@ -662,6 +732,7 @@ bl_info_entry_t* bootloader_info_entry_put(bl_info_type_t type,
     }
 
     m_write_in_progress = true;
+    index_invalidate();
 
     /* store new entry in the available space, and pad */
     if (entry_write(p_new_buf, type, p_entry, length, true) != NRF_SUCCESS)
@@ -676,7 +747,6 @@ bl_info_entry_t* bootloader_info_entry_put(bl_info_type_t type,
     /* invalidate old entry of this type */
     if (p_old_header != NULL)
     {
-        info_entry_cache_invalidate(type);
         if (entry_header_invalidate(p_old_header) != NRF_SUCCESS)
         {
             APP_ERROR_CHECK(NRF_ERROR_NO_MEM);
@@ -709,7 +779,6 @@ uint32_t bootloader_info_entry_overwrite(bl_info_type_t type, bl_info_entry_t* p
 uint32_t bootloader_info_entry_invalidate(bl_info_type_t type)
 {
     __LOG("INVALIDATE 0x%x\n", type);
-    info_entry_cache_invalidate(type);
     return entry_invalidate((bootloader_info_t*) BOOTLOADER_INFO_ADDRESS, type);
 }
 
@@ -723,6 +792,22 @@ uint32_t bootloader_info_reset(void)
     return backup();
 }
 
+bool bootloader_info_compact(void)
+{
+    if (!bootloader_info_stable())
+    {
+        return false;
+    }
+    bl_info_entry_t* p_entry;
+    if (!index_lookup(BL_INFO_TYPE_LAST, &p_entry) ||
+        m_invalid_entries < INFO_COMPACT_THRESHOLD)
+    {
+        return false;
+    }
+    __LOG("COMPACT (%u invalid entries)\n", m_invalid_entries);
+    return (bootloader_info_reset() == NRF_SUCCESS);
+}
+
 bool bootloader_info_available(void)
 {
     return (m_state == BL_INFO_STATE_IDLE);
@@ -762,6 +847,7 @@ void bootloader_info_on_flash_op_end(flash_op_type_t type, void* p_context)
 void bootloader_info_on_flash_idle(void)
 {
     m_write_in_progress = false;
+    m_index_settling = false;
 
     mp_info_entry_head = (info_buffer_t*) mp_info_entry_buffer;
     mp_info_entry_tail = (info_buffer_t*) mp_info_entry_buffer;
@@ -64,6 +64,54 @@ static bool             m_waiting_for_idle;
 * Static functions
 *****************************************************************************/
 
+#if DFU_APP_SLOTS
+/**
+ * Make the application bank the active slot, if it's in the alternate slot.
+ * The previously active slot becomes the alternate one. The application
+ * segment entry is written last, so this can be repeated after a reset at any
+ * point: if both entries point to the same slot, only the last write is left.
+ *
+ * @return NRF_SUCCESS The bank is now the active slot.
+ * @return NRF_ERROR_NOT_FOUND The bank isn't in the alternate slot, and must be copied.
+ * @return NRF_ERROR_BUSY The info page is busy, try again later.
+ */
+static uint32_t app_slot_swap(bl_info_bank_t* p_bank_entry)
+{
+    bl_info_entry_t* p_app_entry = bootloader_info_entry_get(BL_INFO_TYPE_SEGMENT_APP);
+    bl_info_entry_t* p_alt_entry = bootloader_info_entry_get(BL_INFO_TYPE_SEGMENT_APP_ALT);
+    if (p_app_entry == NULL || p_alt_entry == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    if (p_app_entry->segment.start == (uint32_t) p_bank_entry->p_bank_addr)
+    {
+        return NRF_SUCCESS;
+    }
+
+    bool swap_started = (p_alt_entry->segment.start == p_app_entry->segment.start);
+    if (!swap_started && p_alt_entry->segment.start != (uint32_t) p_bank_entry->p_bank_addr)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    bl_info_entry_t segment_entry;
+    memcpy(&segment_entry, p_app_entry, sizeof(bl_info_segment_t));
+    if (!swap_started &&
+        !bootloader_info_entry_put(BL_INFO_TYPE_SEGMENT_APP_ALT, &segment_entry, BL_INFO_LEN_SEGMENT))
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    __LOG("Bank: Swap app slot 0x%x -> 0x%x\n", segment_entry.segment.start, p_bank_entry->p_bank_addr);
+    segment_entry.segment.start = (uint32_t) p_bank_entry->p_bank_addr;
+    if (!bootloader_info_entry_put(BL_INFO_TYPE_SEGMENT_APP, &segment_entry, BL_INFO_LEN_SEGMENT))
+    {
+        return NRF_ERROR_BUSY;
+    }
+    return NRF_SUCCESS;
+}
+#endif
+
 static void flash_bank_entry(void)
 {
     bl_info_bank_t* p_bank_entry = mp_bank_entry; /* make local copy to avoid race conditions */
@@ -165,6 +213,21 @@ static void flash_bank_entry(void)
                     }
                     else
                     {
+#if DFU_APP_SLOTS
+                        /* No copy needed if the bank is the other app slot. */
+                        uint32_t swap_status = app_slot_swap(p_bank_entry);
+                        if (swap_status == NRF_ERROR_BUSY)
+                        {
+                            m_waiting_for_idle = true;
+                            return;
+                        }
+                        if (swap_status == NRF_SUCCESS)
+                        {
+                            bank_entry_replacement.bank.state = BL_INFO_BANK_STATE_FLASH_META;
+                            bootloader_info_entry_overwrite((bl_info_type_t) (BL_INFO_TYPE_BANK_BASE + m_dfu_type), &bank_entry_replacement);
+                            break;
+                        }
+#endif
                         /* Erase, Flash the FW, flash FW flag, flash the signature, erase the bank entry. */
                         bl_info_entry_t* p_app_entry = bootloader_info_entry_get(BL_INFO_TYPE_SEGMENT_APP);
 
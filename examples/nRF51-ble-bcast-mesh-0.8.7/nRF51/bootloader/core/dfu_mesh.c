@@ -44,16 +44,30 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /*****************************************************************************
 * Local defines
 *****************************************************************************/
+/** Let the source send an XOR parity packet after each group of
+ * DFU_FEC_GROUP_SIZE data segments, so targets can recover one lost segment
+ * per group without a request. Data packets are repeated less in this mode. */
+#ifndef DFU_FEC
+#define DFU_FEC                     (0)
+#endif
+#ifndef DFU_FEC_GROUP_SIZE
+#define DFU_FEC_GROUP_SIZE          (8)
+#endif
+
 #define TX_REPEATS_DEFAULT          (3)
 #define TX_REPEATS_FWID             (TX_REPEATS_INF)
 #define TX_REPEATS_DFU_REQ          (TX_REPEATS_INF)
 #define TX_REPEATS_READY            (TX_REPEATS_INF)
+#if DFU_FEC
+#define TX_REPEATS_DATA             (2)
+#else
 #define TX_REPEATS_DATA             (TX_REPEATS_DEFAULT)
+#endif
 #define TX_REPEATS_RSP              (TX_REPEATS_DEFAULT)
 #define TX_REPEATS_REQ              (TX_REPEATS_DEFAULT)
 #define TX_REPEATS_START            (TX_REPEATS_DEFAULT);
 
-#define TX_INTERVAL_TYPE_FWID       (BL_RADIO_INTERVAL_TYPE_REGULAR_SLOW)
+#define TX_INTERVAL_TYPE_FWID       (BL_RADIO_INTERVAL_TYPE_TRICKLE)
 #define TX_INTERVAL_TYPE_DFU_REQ    (BL_RADIO_INTERVAL_TYPE_REGULAR_SLOW)
 #define TX_INTERVAL_TYPE_READY      (BL_RADIO_INTERVAL_TYPE_REGULAR)
 #define TX_INTERVAL_TYPE_DATA       (BL_RADIO_INTERVAL_TYPE_EXPONENTIAL)
@@ -70,7 +84,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define REQ_CACHE_SIZE              (4)
 #define REQ_RX_COUNT_RETRY          (8)
 
+#define TX_SLOTS_MAX                (8) /* slots we keep track of responses in */
+#define RSP_SEGMENT_NONE            (0)
+
 #define DATA_REQ_SEGMENT_NONE            (0)
+#define DATA_REQ_RETRY_PACKETS           (8) /* give up on an unanswered request after this many data packets */
+
+/** Request missing segments with a bitmap of the window after the oldest
+ * missing one, instead of one segment at a time. All nodes answer both kinds
+ * of requests, clear this for networks with older bootloaders. */
+#ifndef DFU_DATA_REQ_BITMAP
+#define DFU_DATA_REQ_BITMAP              (1)
+#endif
 
 /*****************************************************************************
 * Local typedefs
@@ -101,6 +126,10 @@ typedef struct
     fwid_union_t    target_fwid_union;
     bool            segment_is_valid_after_transfer;
     bool            flood;
+    bool            diff;
+    bool            alt_slot;       /**< The transfer goes straight into the alternate app slot. */
+    bool            hash_streamed;
+    sha256_context_t hash_context;
 } transaction_t;
 
 typedef struct
@@ -122,6 +151,17 @@ typedef struct
     uint16_t segment;
     uint16_t rx_count;
 } req_cache_entry_t;
+
+#if DFU_FEC
+typedef struct
+{
+    uint32_t        transaction_id;
+    uint16_t        data_segments;  /**< Number of data segments in the transfer, or 0 if unknown. */
+    uint16_t        group_first;    /**< First segment of the group being accumulated. */
+    uint32_t        seen;           /**< Bitmap of the group members accumulated so far. */
+    uint8_t         parity[SEGMENT_LENGTH];
+} fec_encoder_t;
+#endif
 /*****************************************************************************
 * Static globals
 *****************************************************************************/
@@ -131,7 +171,13 @@ static bl_info_pointers_t       m_bl_info_pointers;
 static req_cache_entry_t        m_req_cache[REQ_CACHE_SIZE];
 static uint8_t                  m_req_index;
 static uint8_t                  m_tx_slots;
-static bool                     m_data_req_segment;
+static bool                     m_info_compacting;  /**< Waiting for the bootloader info page to be compacted. */
+static uint16_t                 m_data_req_segment;
+static uint16_t                 m_rsp_segments[TX_SLOTS_MAX]; /**< Segment each TX slot is responding with, if any. */
+static uint8_t                  m_data_req_age;
+#if DFU_FEC
+static fec_encoder_t            m_fec_encoder;
+#endif
 
 #ifdef RTT_LOG
 static const char*              m_state_strs[] =
@@ -265,12 +311,30 @@ static void send_progress_event(uint16_t segment, uint16_t total_segments)
     bootloader_evt_send(&segment_rx);
 }
 
-static void packet_tx_dynamic(dfu_packet_t* p_packet,
+/** Copy a packet to the serial host, if there is one. */
+static void serial_tx(dfu_packet_t* p_packet, uint32_t length)
+{
+#ifdef RBC_MESH_SERIAL
+    bl_evt_t tx_evt;
+    tx_evt.type = BL_EVT_TYPE_TX_SERIAL;
+    tx_evt.params.tx.serial.p_dfu_packet = p_packet;
+    tx_evt.params.tx.serial.length = length;
+    bootloader_evt_send(&tx_evt);
+#endif
+}
+
+/** Transmit in the next dynamic slot, and return the slot. */
+static uint8_t packet_tx_dynamic(dfu_packet_t* p_packet,
     uint32_t length,
     bl_radio_interval_type_t interval_type,
     uint8_t repeats)
 {
     static uint8_t tx_slot = 1;
+    const uint8_t slot_used = tx_slot;
+    if (tx_slot < TX_SLOTS_MAX)
+    {
+        m_rsp_segments[tx_slot] = RSP_SEGMENT_NONE;
+    }
     bl_evt_t tx_evt;
     tx_evt.type = BL_EVT_TYPE_TX_RADIO;
     tx_evt.params.tx.radio.p_dfu_packet = p_packet;
@@ -284,6 +348,33 @@ static void packet_tx_dynamic(dfu_packet_t* p_packet,
     {
         tx_slot = 1;
     }
+    return slot_used;
+}
+
+/** Start the signature hash with the transfer parameters that precede the image. */
+static void signature_hash_header(sha256_context_t* p_hash_context)
+{
+    sha256_init(p_hash_context);
+    sha256_update(p_hash_context, (uint8_t*) &m_transaction.type, 1);
+    sha256_update(p_hash_context, (uint8_t*) &m_transaction.p_indicated_start_addr, 4);
+    sha256_update(p_hash_context, (uint8_t*) &m_transaction.length, 4);
+    uint8_t padding = 0;
+    sha256_update(p_hash_context, &padding, 1);
+
+    switch (m_transaction.type)
+    {
+        case DFU_TYPE_APP:
+            sha256_update(p_hash_context, (uint8_t*) &m_transaction.target_fwid_union, DFU_FWID_LEN_APP);
+            break;
+        case DFU_TYPE_SD:
+            sha256_update(p_hash_context, (uint8_t*) &m_transaction.target_fwid_union, DFU_FWID_LEN_SD);
+            break;
+        case DFU_TYPE_BOOTLOADER:
+            sha256_update(p_hash_context, (uint8_t*) &m_transaction.target_fwid_union, DFU_FWID_LEN_BL);
+            break;
+        default:
+            break;
+    }
 }
 
 static bool signature_check(void)
@@ -304,34 +395,18 @@ static bool signature_check(void)
     }
 
     uint8_t hash[uECC_BYTES];
-    sha256_context_t hash_context;
-    sha256_init(&hash_context);
-    sha256_update(&hash_context, (uint8_t*) &m_transaction.type, 1);
-    sha256_update(&hash_context, (uint8_t*) &m_transaction.p_indicated_start_addr, 4);
-    sha256_update(&hash_context, (uint8_t*) &m_transaction.length, 4);
-    uint8_t padding = 0;
-    sha256_update(&hash_context, &padding, 1);
-
-    switch (m_transaction.type)
+    if (!m_transaction.hash_streamed)
     {
-        case DFU_TYPE_APP:
-            sha256_update(&hash_context, (uint8_t*) &m_transaction.target_fwid_union, DFU_FWID_LEN_APP);
-            break;
-        case DFU_TYPE_SD:
-            sha256_update(&hash_context, (uint8_t*) &m_transaction.target_fwid_union, DFU_FWID_LEN_SD);
-            break;
-        case DFU_TYPE_BOOTLOADER:
-            sha256_update(&hash_context, (uint8_t*) &m_transaction.target_fwid_union, DFU_FWID_LEN_BL);
-            break;
-        default:
-            break;
+        signature_hash_header(&m_transaction.hash_context);
     }
+    m_transaction.hash_streamed = false;
 
-    dfu_transfer_sha256(&hash_context);
+    /* only the part of the image that wasn't streamed is hashed here */
+    dfu_transfer_sha256(&m_transaction.hash_context);
 #if NORDIC_SDK_VERSION >= 11
-    sha256_final(&hash_context, hash, false);
+    sha256_final(&m_transaction.hash_context, hash, false);
 #else
-    sha256_final(&hash_context, hash);
+    sha256_final(&m_transaction.hash_context, hash);
 #endif
     bool success = (bool) (uECC_verify(m_bl_info_pointers.p_ecdsa_public_key, hash, m_transaction.signature));
     if (success)
@@ -407,13 +482,7 @@ static void beacon_set(beacon_type_t type)
     tx_evt.params.tx.radio.tx_slot = TX_SLOT_BEACON;
 
     bootloader_evt_send(&tx_evt);
-
-#ifdef RBC_MESH_SERIAL
-    tx_evt.type = BL_EVT_TYPE_TX_SERIAL;
-    tx_evt.params.tx.serial.p_dfu_packet = &dfu_packet;
-    tx_evt.params.tx.serial.length = length;
-    bootloader_evt_send(&tx_evt);
-#endif
+    serial_tx(&dfu_packet, length);
     __LOG("BEACON SET: TYPE %s\n", m_beacon_type_strs[(uint32_t) type]);
     if (type >= BEACON_TYPE_READY_APP &&
         type <= BEACON_TYPE_READY_BL)
@@ -509,9 +578,18 @@ static void start_ready(dfu_packet_t* p_ready_packet)
     beacon_set(state_beacon_type(m_transaction.type));
 }
 
+/** Whether the transfer is kept in a bank until it's flashed. */
+static inline bool transaction_is_banked(void)
+{
+    return (m_transaction.p_bank_addr != m_transaction.p_start_addr ||
+            m_transaction.alt_slot);
+}
+
 static void start_target(void)
 {
     SET_STATE(DFU_STATE_TARGET);
+    m_data_req_segment = DATA_REQ_SEGMENT_NONE;
+    m_data_req_age = 0;
 
     bl_info_entry_t flags_entry;
     memset(&flags_entry, 0xFF, (BL_INFO_LEN_FLAGS + 3) & ~0x03UL);
@@ -529,7 +607,7 @@ static void start_target(void)
             break;
     }
 
-    if (m_transaction.p_bank_addr != m_transaction.p_start_addr)
+    if (transaction_is_banked())
     {
         /* check whether we're destroying some bank: */
         const bl_info_entry_t* p_banks[] =
@@ -593,7 +671,7 @@ static void start_target(void)
     }
 
     /* Tag the transfer as incomplete in device page if we're about to overwrite it. */
-    if (m_transaction.p_start_addr == m_transaction.p_bank_addr)
+    if (!transaction_is_banked())
     {
         if (m_bl_info_pointers.p_flags == NULL)
         {
@@ -612,6 +690,17 @@ static void start_target(void)
                 m_transaction.length,
                 m_transaction.segment_is_valid_after_transfer) == NRF_SUCCESS)
     {
+        /* hash the image as it arrives, so the validation doesn't stall on
+           hashing all of it at the end. */
+        m_transaction.hash_streamed = false;
+        if (m_bl_info_pointers.p_ecdsa_public_key != NULL &&
+            m_transaction.signature_length != 0)
+        {
+            signature_hash_header(&m_transaction.hash_context);
+            dfu_transfer_sha256_stream(&m_transaction.hash_context);
+            m_transaction.hash_streamed = true;
+        }
+
         bl_evt_t abort_evt;
         abort_evt.type = BL_EVT_TYPE_TX_ABORT;
         abort_evt.params.tx.abort.tx_slot = TX_SLOT_BEACON;
@@ -642,7 +731,17 @@ static void start_rampdown(void)
 }
 
 /*************** Packet handlers ******************/
-static void target_rx_start(dfu_packet_t* p_packet, bool* p_do_relay)
+/** Check that a diff transfer applies to the installed firmware. */
+static bool diff_base_is_valid(dfu_packet_t* p_packet, uint16_t length)
+{
+    return (length >= DFU_PACKET_LEN_START_DIFF &&
+            m_transaction.type == DFU_TYPE_APP &&
+            m_bl_info_pointers.p_fwid != NULL &&
+            m_bl_info_pointers.p_fwid->app.app_version == p_packet->payload.start.base_version &&
+            (m_bl_info_pointers.p_flags == NULL || m_bl_info_pointers.p_flags->app_intact));
+}
+
+static void target_rx_start(dfu_packet_t* p_packet, uint16_t length, bool* p_do_relay)
 {
     bl_info_segment_t* p_segment = NULL;
     switch (m_transaction.type)
@@ -677,17 +776,44 @@ static void target_rx_start(dfu_packet_t* p_packet, bool* p_do_relay)
     m_transaction.segment_is_valid_after_transfer   = p_packet->payload.start.last;
     m_transaction.p_last_requested_entry            = NULL;
     m_transaction.signature_bitmap                  = 0;
+    m_transaction.diff                              = p_packet->payload.start.diff;
+    m_transaction.alt_slot                          = false;
+
+    if (m_transaction.diff && !diff_base_is_valid(p_packet, length))
+    {
+        __LOG(RTT_CTRL_TEXT_RED "ERROR: Diff transfer doesn't apply to the installed firmware.\n");
+        tid_cache_entry_put(p_packet->payload.start.transaction_id);
+        start_req(m_transaction.type, &m_transaction.target_fwid_union);
+        return;
+    }
 
     /* Reset all transfer specific caches. */
     memset(m_req_cache, 0, REQ_CACHE_SIZE * sizeof(m_req_cache[0]));
     packet_cache_flush();
 
+#if DFU_APP_SLOTS
+    /* Images linked for the alternate slot are their own bank, and will be
+       started from there. */
+    bl_info_entry_t* p_alt_entry = bootloader_info_entry_get(BL_INFO_TYPE_SEGMENT_APP_ALT);
+    if (m_transaction.type == DFU_TYPE_APP &&
+        p_alt_entry != NULL &&
+        start_address == p_alt_entry->segment.start &&
+        start_address != p_segment->start)
+    {
+        __LOG("Transfer to alternate app slot.\n");
+        m_transaction.alt_slot = true;
+        m_transaction.p_bank_addr = m_transaction.p_start_addr;
+        p_segment = &p_alt_entry->segment;
+    }
+#endif
+
     /* If no bank was specified, we either have to do it single-banked or find a bank */
     if (m_transaction.p_bank_addr == (uint32_t*) 0xFFFFFFFF)
     {
-        if (m_transaction.type == DFU_TYPE_BOOTLOADER)
+        /* Diff transfers copy from the installed image, and can't overwrite it. */
+        if (m_transaction.type == DFU_TYPE_BOOTLOADER || m_transaction.diff)
         {
-            __LOG("Placing BL bank at end of application segment.\n");
+            __LOG("Placing bank at end of application segment.\n");
             uint32_t upper_limit =
                 (m_bl_info_pointers.p_segment_app->start) +
                 (m_bl_info_pointers.p_segment_app->length);
@@ -733,6 +859,7 @@ static void target_rx_start(dfu_packet_t* p_packet, bool* p_do_relay)
     __LOG("\tbank addr:  0x%x\n", m_transaction.p_bank_addr);
     __LOG("\tlength:     %u\n", m_transaction.length);
     __LOG("\tsigned:     %s\n", m_transaction.signature_length > 0 ? "YES" : "NO");
+    __LOG("\tdiff:       %s\n", m_transaction.diff ? "YES" : "NO");
 
     if ((uint32_t) m_transaction.p_start_addr >= p_segment->start &&
         (uint32_t) m_transaction.p_start_addr + m_transaction.length <= p_segment->start + p_segment->length)
@@ -797,8 +924,41 @@ static uint32_t target_rx_data(dfu_packet_t* p_packet, uint16_t length, bool* p_
     uint32_t* p_req_entry = NULL;
     uint32_t req_entry_len = 0;
 
+    if (m_data_req_segment != DATA_REQ_SEGMENT_NONE &&
+        ++m_data_req_age >= DATA_REQ_RETRY_PACKETS)
+    {
+        m_data_req_segment = DATA_REQ_SEGMENT_NONE;
+    }
+
     if (m_data_req_segment == DATA_REQ_SEGMENT_NONE)
     {
+#if DFU_DATA_REQ_BITMAP
+        uint32_t missing = 0;
+        if (dfu_transfer_get_missing_bitmap(
+                    m_transaction.p_start_addr,
+                    &p_req_entry,
+                    &missing) &&
+                (
+                 /* don't request the previous packet yet */
+                 ADDR_SEGMENT(p_req_entry, m_transaction.p_start_addr) < p_packet->payload.data.segment - 1 ||
+                 m_transaction.segment_count == p_packet->payload.data.segment
+                )
+           )
+        {
+            (void) req_entry_len;
+            dfu_packet_t req_packet;
+            req_packet.packet_type = DFU_PACKET_TYPE_DATA_REQ_BITMAP;
+            req_packet.payload.req_data_bitmap.segment = ADDR_SEGMENT(p_req_entry, m_transaction.p_start_addr);
+            req_packet.payload.req_data_bitmap.transaction_id = m_transaction.transaction_id;
+            req_packet.payload.req_data_bitmap.missing = missing;
+
+            packet_tx_dynamic(&req_packet, DFU_PACKET_LEN_DATA_REQ_BITMAP, TX_INTERVAL_TYPE_REQ, TX_REPEATS_REQ);
+            serial_tx(&req_packet, DFU_PACKET_LEN_DATA_REQ_BITMAP);
+            m_data_req_segment = req_packet.payload.req_data_bitmap.segment;
+            m_data_req_age = 0;
+            __LOG("TX REQ FOR 0x%x (bitmap 0x%x)\n", m_data_req_segment, missing);
+        }
+#else
         if (dfu_transfer_get_oldest_missing_entry(
                     m_transaction.p_last_requested_entry,
                     &p_req_entry,
@@ -816,10 +976,13 @@ static uint32_t target_rx_data(dfu_packet_t* p_packet, uint16_t length, bool* p_
             req_packet.payload.req_data.transaction_id = m_transaction.transaction_id;
 
             packet_tx_dynamic(&req_packet, DFU_PACKET_LEN_DATA_REQ, TX_INTERVAL_TYPE_REQ, TX_REPEATS_REQ);
+            serial_tx(&req_packet, DFU_PACKET_LEN_DATA_REQ);
             m_transaction.p_last_requested_entry = (uint32_t*) p_req_entry;
             m_data_req_segment = req_packet.payload.req_data.segment;
+            m_data_req_age = 0;
             __LOG("TX REQ FOR 0x%x\n", m_data_req_segment);
         }
+#endif
     }
     return error_code;
 }
@@ -842,7 +1005,7 @@ static void handle_data_packet(dfu_packet_t* p_packet, uint16_t length)
         case DFU_STATE_READY:
             if (p_packet->payload.start.segment == 0)
             {
-                target_rx_start(p_packet, &do_relay);
+                target_rx_start(p_packet, length, &do_relay);
             }
             else
             {
@@ -904,6 +1067,73 @@ static void handle_data_packet(dfu_packet_t* p_packet, uint16_t length)
     }
 }
 
+static void handle_data_copy_packet(dfu_packet_t* p_packet)
+{
+    if (p_packet->payload.data_copy.transaction_id != m_transaction.transaction_id ||
+        packet_in_cache(p_packet))
+    {
+        return;
+    }
+
+    bool do_relay = false;
+    switch (m_state)
+    {
+        case DFU_STATE_TARGET:
+        {
+            uint16_t first = p_packet->payload.data_copy.segment;
+            uint16_t count = p_packet->payload.data_copy.count;
+            uint32_t* p_src = addr_from_seg(p_packet->payload.data_copy.source_segment, m_transaction.p_start_addr);
+            if (!m_transaction.diff ||
+                first == 0 ||
+                count == 0 ||
+                p_packet->payload.data_copy.source_segment == 0 ||
+                first + count - 1 > m_transaction.segment_count - m_transaction.signature_length / SEGMENT_LENGTH ||
+                section_overlap((uint32_t) p_src, count * SEGMENT_LENGTH,
+                                (uint32_t) m_transaction.p_bank_addr, m_transaction.length))
+            {
+                break;
+            }
+            uint32_t error_code = dfu_transfer_copy(
+                    (uint32_t) addr_from_seg(first, m_transaction.p_start_addr),
+                    (uint32_t) p_src,
+                    count);
+            if (error_code == NRF_ERROR_BUSY)
+            {
+                /* let a repeat of the packet try again */
+                return;
+            }
+            if (error_code != NRF_SUCCESS)
+            {
+                break;
+            }
+            if (m_data_req_segment >= first && m_data_req_segment < first + count)
+            {
+                m_data_req_segment = DATA_REQ_SEGMENT_NONE;
+            }
+            __LOG("Copy #%u-#%u from #%u\n", first, first + count - 1, p_packet->payload.data_copy.source_segment);
+            send_progress_event(first + count - 1, m_transaction.segment_count);
+            m_transaction.segments_remaining -= count;
+            do_relay = true;
+            if (m_transaction.segments_remaining == 0)
+            {
+                start_rampdown();
+            }
+            break;
+        }
+        case DFU_STATE_RELAY:
+            do_relay = true;
+            break;
+        default:
+            break;
+    }
+    packet_cache_put(p_packet);
+
+    if (do_relay)
+    {
+        relay_packet(p_packet, DFU_PACKET_LEN_DATA_COPY);
+    }
+}
+
 static void handle_state_packet(dfu_packet_t* p_packet)
 {
     switch (m_state)
@@ -1009,10 +1239,27 @@ static void handle_state_packet(dfu_packet_t* p_packet)
 
 }
 
+/** Whether the device with the given FWID could take an upgrade from us. */
+static bool fwid_is_older(fwid_t* p_fwid)
+{
+    return ((p_fwid->bootloader.id == m_bl_info_pointers.p_fwid->bootloader.id &&
+             p_fwid->bootloader.ver < m_bl_info_pointers.p_fwid->bootloader.ver) ||
+            (p_fwid->app.company_id == m_bl_info_pointers.p_fwid->app.company_id &&
+             p_fwid->app.app_id == m_bl_info_pointers.p_fwid->app.app_id &&
+             p_fwid->app.app_version < m_bl_info_pointers.p_fwid->app.app_version));
+}
+
 static void handle_fwid_packet(dfu_packet_t* p_packet)
 {
     if (m_state == DFU_STATE_FIND_FWID)
     {
+        /* The FWID beacon backs off while the neighbours are up to date.
+           Restart it when one of them could upgrade from us. */
+        if (fwid_is_older(&p_packet->payload.fwid))
+        {
+            beacon_set(BEACON_TYPE_FWID);
+        }
+
         /* always upgrade bootloader first */
         if (bootloader_is_newer(p_packet->payload.fwid.bootloader))
         {
@@ -1052,6 +1299,78 @@ static void handle_fwid_packet(dfu_packet_t* p_packet)
     }
 }
 
+/** Check whether a request for the given segment was answered recently, and
+ * log it as answered if it wasn't. */
+static bool req_recently_served(uint16_t segment)
+{
+    req_cache_entry_t* p_req_entry = NULL;
+    for (uint32_t i = 0; i < REQ_CACHE_SIZE; ++i)
+    {
+        if (m_req_cache[i].segment == segment)
+        {
+            if (m_req_cache[i].rx_count++ < REQ_RX_COUNT_RETRY)
+            {
+                return true;
+            }
+            p_req_entry = &m_req_cache[i];
+            break;
+        }
+    }
+
+    /* log our attempt at responding */
+    if (!p_req_entry)
+    {
+        p_req_entry = &m_req_cache[(m_req_index++) & (REQ_CACHE_SIZE - 1)];
+        p_req_entry->segment = segment;
+    }
+    p_req_entry->rx_count = 0;
+    return false;
+}
+
+static bool serve_data_req(uint16_t segment)
+{
+    dfu_packet_t dfu_rsp;
+    if (
+        dfu_transfer_has_entry(
+            (uint32_t*) SEGMENT_ADDR(segment, m_transaction.p_start_addr),
+            dfu_rsp.payload.rsp_data.data, SEGMENT_LENGTH)
+       )
+    {
+        dfu_rsp.packet_type = DFU_PACKET_TYPE_DATA_RSP;
+        dfu_rsp.payload.rsp_data.segment = segment;
+        dfu_rsp.payload.rsp_data.transaction_id = m_transaction.transaction_id;
+
+        uint8_t slot = packet_tx_dynamic(&dfu_rsp, DFU_PACKET_LEN_DATA_RSP, TX_INTERVAL_TYPE_RSP, TX_REPEATS_RSP);
+        if (slot < TX_SLOTS_MAX)
+        {
+            m_rsp_segments[slot] = segment;
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+* Another device has answered a request for the segment. Stop our own
+* response to it, which would only collide with or repeat theirs, and leave
+* the next requests for the segment to them too.
+*/
+static void rsp_heard(uint16_t segment)
+{
+    for (uint32_t i = 1; i < TX_SLOTS_MAX; ++i)
+    {
+        if (m_rsp_segments[i] == segment)
+        {
+            bl_evt_t abort_evt;
+            abort_evt.type = BL_EVT_TYPE_TX_ABORT;
+            abort_evt.params.tx.abort.tx_slot = i;
+            bootloader_evt_send(&abort_evt);
+            m_rsp_segments[i] = RSP_SEGMENT_NONE;
+        }
+    }
+    (void) req_recently_served(segment);
+}
+
 static void handle_data_req_packet(dfu_packet_t* p_packet)
 {
     if (p_packet->payload.data.transaction_id == m_transaction.transaction_id)
@@ -1063,46 +1382,53 @@ static void handle_data_req_packet(dfu_packet_t* p_packet)
             if (!packet_in_cache(p_packet))
             {
                 relay_packet(p_packet, 8);
+                serial_tx(p_packet, DFU_PACKET_LEN_DATA_REQ);
             }
         }
         else
         {
-            req_cache_entry_t* p_req_entry = NULL;
-            /* check that we haven't served this request recently. */
-            for (uint32_t i = 0; i < REQ_CACHE_SIZE; ++i)
+            if (req_recently_served(p_packet->payload.req_data.segment))
             {
-                if (m_req_cache[i].segment == p_packet->payload.req_data.segment)
-                {
-                    if (m_req_cache[i].rx_count++ < REQ_RX_COUNT_RETRY)
-                    {
-                        return;
-                    }
-                    p_req_entry = &m_req_cache[i];
-                    break;
-                }
+                return;
             }
-            /* serve request */
-            dfu_packet_t dfu_rsp;
-            if (
-                dfu_transfer_has_entry(
-                    (uint32_t*) SEGMENT_ADDR(p_packet->payload.req_data.segment, m_transaction.p_start_addr),
-                    dfu_rsp.payload.rsp_data.data, SEGMENT_LENGTH)
-               )
-            {
-                dfu_rsp.packet_type = DFU_PACKET_TYPE_DATA_RSP;
-                dfu_rsp.payload.rsp_data.segment = p_packet->payload.req_data.segment;
-                dfu_rsp.payload.rsp_data.transaction_id = p_packet->payload.req_data.transaction_id;
+            serve_data_req(p_packet->payload.req_data.segment);
+        }
+    }
+}
 
-                packet_tx_dynamic(&dfu_rsp, DFU_PACKET_LEN_DATA_RSP, TX_INTERVAL_TYPE_RSP, TX_REPEATS_RSP);
+static void handle_data_req_bitmap_packet(dfu_packet_t* p_packet)
+{
+    if (p_packet->payload.req_data_bitmap.transaction_id == m_transaction.transaction_id)
+    {
+        __LOG("RX data REQ #%u (bitmap 0x%x)\n",
+                p_packet->payload.req_data_bitmap.segment,
+                p_packet->payload.req_data_bitmap.missing);
+        if (m_state == DFU_STATE_RELAY)
+        {
+            /* only relay new packets, look for it in cache */
+            if (!packet_in_cache(p_packet))
+            {
+                relay_packet(p_packet, DFU_PACKET_LEN_DATA_REQ_BITMAP);
+                serial_tx(p_packet, DFU_PACKET_LEN_DATA_REQ_BITMAP);
             }
-
-            /* log our attempt at responding */
-            if (!p_req_entry)
+        }
+        else
+        {
+            if (req_recently_served(p_packet->payload.req_data_bitmap.segment))
+            {
+                return;
+            }
+            /* serve as many of the segments as we have tx slots for, the
+               target will ask for the rest. Slot 0 is the beacon. */
+            uint32_t burst = 0;
+            for (uint32_t i = 0; i < 32 && burst < m_tx_slots - 1; ++i)
             {
-                p_req_entry = &m_req_cache[(m_req_index++) & (REQ_CACHE_SIZE - 1)];
-                p_req_entry->segment = p_packet->payload.req_data.segment;
+                if ((p_packet->payload.req_data_bitmap.missing & (1UL << i)) &&
+                    serve_data_req(p_packet->payload.req_data_bitmap.segment + i))
+                {
+                    burst++;
+                }
             }
-            p_req_entry->rx_count = 0;
         }
     }
 }
@@ -1121,10 +1447,129 @@ static void handle_data_rsp_packet(dfu_packet_t* p_packet, uint16_t length)
     }
     else
     {
+        if (p_packet->payload.rsp_data.transaction_id == m_transaction.transaction_id)
+        {
+            rsp_heard(p_packet->payload.rsp_data.segment);
+        }
         handle_data_packet(p_packet, length);
     }
 }
 
+#if DFU_FEC
+static uint16_t fec_group_size(uint16_t group_first, uint16_t data_segments)
+{
+    uint16_t size = data_segments - group_first + 1;
+    return (size < DFU_FEC_GROUP_SIZE) ? size : DFU_FEC_GROUP_SIZE;
+}
+
+/** Accumulate the data packets we're the source of, and send a parity packet
+ * for each complete group. */
+static void fec_encode(dfu_packet_t* p_packet, uint16_t length)
+{
+    uint16_t segment = p_packet->payload.data.segment;
+    if (segment == 0)
+    {
+        memset(&m_fec_encoder, 0, sizeof(m_fec_encoder));
+        m_fec_encoder.transaction_id = p_packet->payload.start.transaction_id;
+        m_fec_encoder.data_segments = segment_count_from_start_packet(p_packet) -
+            p_packet->payload.start.signature_length / SEGMENT_LENGTH;
+        m_fec_encoder.group_first = 1;
+        return;
+    }
+    if (m_fec_encoder.data_segments == 0 ||
+        p_packet->payload.data.transaction_id != m_fec_encoder.transaction_id ||
+        segment > m_fec_encoder.data_segments)
+    {
+        return;
+    }
+
+    uint16_t group_first = ((segment - 1) / DFU_FEC_GROUP_SIZE) * DFU_FEC_GROUP_SIZE + 1;
+    if (group_first != m_fec_encoder.group_first)
+    {
+        /* moved on without completing the previous group, start over */
+        m_fec_encoder.group_first = group_first;
+        m_fec_encoder.seen = 0;
+        memset(m_fec_encoder.parity, 0, SEGMENT_LENGTH);
+    }
+    uint32_t bit = (1UL << (segment - group_first));
+    if (m_fec_encoder.seen & bit)
+    {
+        return;
+    }
+    uint32_t data_len = length - (DFU_PACKET_LEN_DATA - SEGMENT_LENGTH);
+    for (uint32_t i = 0; i < data_len && i < SEGMENT_LENGTH; ++i)
+    {
+        m_fec_encoder.parity[i] ^= p_packet->payload.data.data[i];
+    }
+    m_fec_encoder.seen |= bit;
+
+    uint16_t group_size = fec_group_size(group_first, m_fec_encoder.data_segments);
+    if (m_fec_encoder.seen == (1UL << group_size) - 1)
+    {
+        dfu_packet_t parity_packet;
+        parity_packet.packet_type = DFU_PACKET_TYPE_DATA_PARITY;
+        parity_packet.payload.data.segment = group_first;
+        parity_packet.payload.data.transaction_id = m_fec_encoder.transaction_id;
+        memcpy(parity_packet.payload.data.data, m_fec_encoder.parity, SEGMENT_LENGTH);
+        relay_packet(&parity_packet, DFU_PACKET_LEN_DATA_PARITY);
+
+        m_fec_encoder.group_first += DFU_FEC_GROUP_SIZE;
+        m_fec_encoder.seen = 0;
+        memset(m_fec_encoder.parity, 0, SEGMENT_LENGTH);
+    }
+}
+#endif
+
+static void handle_data_parity_packet(dfu_packet_t* p_packet)
+{
+#if DFU_FEC
+    if (p_packet->payload.data.transaction_id != m_transaction.transaction_id ||
+        packet_in_cache(p_packet))
+    {
+        return;
+    }
+
+    if (m_state == DFU_STATE_TARGET)
+    {
+        uint16_t data_segments = m_transaction.segment_count - m_transaction.signature_length / SEGMENT_LENGTH;
+        uint16_t group_first = p_packet->payload.data.segment;
+        dfu_packet_t data_packet;
+        uint32_t* p_addr;
+        uint16_t data_len;
+        if (group_first > 0 &&
+            group_first <= data_segments &&
+            dfu_transfer_parity_recover(
+                addr_from_seg(group_first, m_transaction.p_start_addr),
+                fec_group_size(group_first, data_segments),
+                p_packet->payload.data.data,
+                &p_addr,
+                data_packet.payload.data.data,
+                &data_len))
+        {
+            data_packet.packet_type = DFU_PACKET_TYPE_DATA;
+            data_packet.payload.data.segment = ADDR_SEGMENT(p_addr, m_transaction.p_start_addr);
+            data_packet.payload.data.transaction_id = m_transaction.transaction_id;
+            __LOG("Recovered #%u from parity\n", data_packet.payload.data.segment);
+
+            /* don't relay the recovered packet, the parity packet is relayed instead. */
+            bool do_relay = false;
+            target_rx_data(&data_packet, data_len + (DFU_PACKET_LEN_DATA - SEGMENT_LENGTH), &do_relay);
+            if (m_transaction.segments_remaining == 0)
+            {
+                start_rampdown();
+            }
+        }
+    }
+
+    if (m_state == DFU_STATE_TARGET ||
+        m_state == DFU_STATE_RELAY ||
+        m_state == DFU_STATE_VALIDATE)
+    {
+        relay_packet(p_packet, DFU_PACKET_LEN_DATA_PARITY);
+    }
+#endif
+}
+
 /*****************************************************************************
 * Interface Functions
 *****************************************************************************/
@@ -1135,6 +1580,7 @@ void dfu_mesh_init(uint8_t tx_slots)
     memset(&m_transaction, 0, sizeof(transaction_t));
     memset(m_req_cache, 0, REQ_CACHE_SIZE * sizeof(m_req_cache[0]));
     m_req_index = 0;
+    memset(m_rsp_segments, 0, sizeof(m_rsp_segments));
     m_tx_slots = tx_slots;
 
     get_info_pointers();
@@ -1143,6 +1589,14 @@ void dfu_mesh_init(uint8_t tx_slots)
 void dfu_mesh_start(void)
 {
     memset(&m_transaction, 0, sizeof(transaction_t));
+    if (!dfu_bank_transfer_in_progress() && bootloader_info_compact())
+    {
+        /* the info pointers are invalid until the page has been rewritten,
+           restart once it's done. */
+        __LOG("DFU mesh: compacting bl info\n");
+        m_info_compacting = true;
+        return;
+    }
     get_info_pointers();
     send_bank_notifications();
 
@@ -1223,6 +1677,10 @@ uint32_t dfu_mesh_rx(dfu_packet_t* p_packet, uint16_t length, bool from_serial)
     }
     led = !led;
 #endif
+    if (m_info_compacting)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
 
     switch (p_packet->packet_type)
     {
@@ -1236,12 +1694,30 @@ uint32_t dfu_mesh_rx(dfu_packet_t* p_packet, uint16_t length, bool from_serial)
 
         case DFU_PACKET_TYPE_DATA:
             handle_data_packet(p_packet, length);
+#if DFU_FEC
+            if (from_serial)
+            {
+                fec_encode(p_packet, length);
+            }
+#endif
+            break;
+
+        case DFU_PACKET_TYPE_DATA_PARITY:
+            handle_data_parity_packet(p_packet);
+            break;
+
+        case DFU_PACKET_TYPE_DATA_COPY:
+            handle_data_copy_packet(p_packet);
             break;
 
         case DFU_PACKET_TYPE_DATA_REQ:
             handle_data_req_packet(p_packet);
             break;
 
+        case DFU_PACKET_TYPE_DATA_REQ_BITMAP:
+            handle_data_req_bitmap_packet(p_packet);
+            break;
+
         case DFU_PACKET_TYPE_DATA_RSP:
             handle_data_rsp_packet(p_packet, length);
             break;
@@ -1316,10 +1792,13 @@ dfu_type_t dfu_mesh_missing_type_get(void)
 bool dfu_mesh_app_is_valid(void)
 {
     bl_info_entry_t* p_fwid_entry = bootloader_info_entry_get(BL_INFO_TYPE_VERSION);
+    /* don't use the cached pointer, the active app slot may have changed. */
+    bl_info_entry_t* p_segment_entry = bootloader_info_entry_get(BL_INFO_TYPE_SEGMENT_APP);
 
     return (p_fwid_entry != NULL &&
-            (uint32_t*) m_bl_info_pointers.p_segment_app->start != (uint32_t*) 0xFFFFFFFF &&
-            *((uint32_t*) m_bl_info_pointers.p_segment_app->start) != 0xFFFFFFFF &&
+            p_segment_entry != NULL &&
+            (uint32_t*) p_segment_entry->segment.start != (uint32_t*) 0xFFFFFFFF &&
+            *((uint32_t*) p_segment_entry->segment.start) != 0xFFFFFFFF &&
             p_fwid_entry->version.app.app_version != APP_VERSION_INVALID &&
             fw_is_verified());
 }
@@ -1332,7 +1811,7 @@ uint32_t dfu_mesh_finalize(void)
     memcpy(&new_version_entry.version, m_bl_info_pointers.p_fwid, sizeof(fwid_t));
     bl_info_type_t sign_info_type = BL_INFO_TYPE_INVALID;
 
-    if (m_transaction.p_bank_addr != m_transaction.p_start_addr) /* Dual bank! */
+    if (transaction_is_banked()) /* Dual bank! */
     {
         bl_info_entry_t bank_entry;
         memset(&bank_entry, 0xFF, sizeof(bl_info_bank_t));
@@ -1440,6 +1919,15 @@ void dfu_mesh_restart(void)
 
 void dfu_mesh_on_flash_idle(void)
 {
+    if (m_info_compacting)
+    {
+        if (bootloader_info_stable())
+        {
+            m_info_compacting = false;
+            dfu_mesh_start();
+        }
+        return;
+    }
     /* check whether the blinfo module is done with all its stuff. */
     if (m_state == DFU_STATE_STABILIZE)
     {
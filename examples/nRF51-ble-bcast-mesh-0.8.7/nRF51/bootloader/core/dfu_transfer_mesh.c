@@ -63,6 +63,10 @@ typedef struct
     uint8_t         write_buffer[SEGMENT_LENGTH];
     uint16_t        segment_max;
     uint16_t        segment_prev;
+    uint16_t        segments_in_flight; /**< Number of segments ending at segment_prev that are being written. */
+    uint8_t*        p_copy_src;
+    sha256_context_t* p_hash_context;
+    uint32_t        hashed_len;
 } dfu_transfer_t;
 
 /*****************************************************************************
@@ -93,6 +97,41 @@ static bool segment_is_missing(uint16_t segment)
     return !!((1ULL << (m_transfer.segment_max - segment)) & m_transfer.missing_segments);
 }
 
+/** Length of the image contents in the given segment. */
+static uint32_t segment_length(uint16_t segment)
+{
+    uint32_t addr = SEGMENT_ADDR(segment, m_transfer.p_start_addr);
+    uint32_t end = (addr & 0xFFFFFFF0) + SEGMENT_LENGTH;
+    uint32_t image_end = (uint32_t) m_transfer.p_start_addr + m_transfer.size;
+    if (addr >= image_end)
+    {
+        return 0;
+    }
+    return ((end < image_end) ? end : image_end) - addr;
+}
+
+/** Feed the in-order prefix of the image that has reached flash to the hash. */
+static void hash_advance(void)
+{
+    if (m_transfer.p_hash_context == NULL)
+    {
+        return;
+    }
+    while (m_transfer.hashed_len < m_transfer.size)
+    {
+        uint16_t segment = ADDR_SEGMENT((uint32_t) m_transfer.p_start_addr + m_transfer.hashed_len, m_transfer.p_start_addr);
+        if (segment_is_missing(segment) || segment == m_transfer.segment_prev)
+        {
+            break;
+        }
+        uint32_t len = segment_length(segment);
+        sha256_update(m_transfer.p_hash_context,
+                (uint8_t*) m_transfer.p_bank_addr + m_transfer.hashed_len,
+                len);
+        m_transfer.hashed_len += len;
+    }
+}
+
 /*****************************************************************************
 * Interface functions
 *****************************************************************************/
@@ -138,6 +177,8 @@ uint32_t dfu_transfer_start(
     m_transfer.missing_segments = 0;
     m_transfer.segment_prev = INVALID_SEGMENT_INDEX;
     m_transfer.segment_max = 0;
+    m_transfer.p_hash_context = NULL;
+    m_transfer.hashed_len = 0;
     return NRF_SUCCESS;
 }
 
@@ -190,6 +231,7 @@ uint32_t dfu_transfer_data(uint32_t p_addr, uint8_t* p_data, uint16_t length)
     }
 
     m_transfer.segment_prev = segment;
+    m_transfer.segments_in_flight = 1;
     memcpy(m_transfer.write_buffer, p_data, length);
     if (flash_write(
             (void*) ((uint32_t) m_transfer.p_bank_addr + (p_addr - (uint32_t) m_transfer.p_start_addr)),
@@ -202,6 +244,80 @@ uint32_t dfu_transfer_data(uint32_t p_addr, uint8_t* p_data, uint16_t length)
     return NRF_SUCCESS;
 }
 
+uint32_t dfu_transfer_copy(uint32_t p_addr, uint32_t p_src_addr, uint16_t segments)
+{
+    if (m_transfer.segment_max == INVALID_SEGMENT_INDEX)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (segments == 0 || segments > MISSING_BITFIELD_WIDTH)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    uint16_t first = ADDR_SEGMENT(p_addr, m_transfer.p_start_addr);
+    uint16_t last = first + segments - 1;
+    if ((p_addr & (SEGMENT_LENGTH - 1)) != 0 ||
+        (p_src_addr & (WORD_SIZE - 1)) != 0 ||
+        p_addr < (uint32_t) m_transfer.p_start_addr ||
+        segment_length(last) == 0)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (m_transfer.segment_prev != INVALID_SEGMENT_INDEX)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    for (uint16_t segment = first; segment <= last; ++segment)
+    {
+        if (!segment_is_missing(segment))
+        {
+            return NRF_ERROR_INVALID_STATE;
+        }
+    }
+
+    if (last > m_transfer.segment_max)
+    {
+        /* Same as for data, but the copied segments stay marked as missing
+           until the write is complete. */
+        uint16_t segment_offset = last - m_transfer.segment_max;
+        if (segment_offset >= MISSING_BITFIELD_WIDTH)
+        {
+            if (m_transfer.missing_segments)
+            {
+                transfer_abort(DFU_END_ERROR_PACKET_LOSS);
+                return NRF_ERROR_NOT_FOUND;
+            }
+            m_transfer.missing_segments = ~0ULL;
+        }
+        else
+        {
+            bitfield_t shift_mask = (1ULL << segment_offset) - 1ULL;
+            if (m_transfer.missing_segments & (shift_mask << (MISSING_BITFIELD_WIDTH - segment_offset)))
+            {
+                transfer_abort(DFU_END_ERROR_PACKET_LOSS);
+                return NRF_ERROR_NOT_FOUND;
+            }
+            m_transfer.missing_segments = (m_transfer.missing_segments << segment_offset) | shift_mask;
+        }
+        m_transfer.segment_max = last;
+    }
+
+    uint32_t length = SEGMENT_ADDR(last, m_transfer.p_start_addr) + segment_length(last) - p_addr;
+    m_transfer.segment_prev = last;
+    m_transfer.segments_in_flight = segments;
+    m_transfer.p_copy_src = (uint8_t*) p_src_addr;
+    /* The source is the installed image, which stays put until the write is done. */
+    if (flash_write(
+            (void*) ((uint32_t) m_transfer.p_bank_addr + (p_addr - (uint32_t) m_transfer.p_start_addr)),
+            m_transfer.p_copy_src,
+            length) != NRF_SUCCESS)
+    {
+        transfer_abort(DFU_END_ERROR_NO_MEM);
+        return NRF_ERROR_INTERNAL;
+    }
+    return NRF_SUCCESS;
+}
+
 bool dfu_transfer_has_entry(uint32_t* p_addr, uint8_t* p_out_buffer, uint16_t len)
 {
     if (m_transfer.segment_max == INVALID_SEGMENT_INDEX)
@@ -251,15 +367,105 @@ bool dfu_transfer_get_oldest_missing_entry(
     return false;
 }
 
+bool dfu_transfer_get_missing_bitmap(
+        uint32_t* p_start_addr,
+        uint32_t** pp_entry,
+        uint32_t* p_bitmap)
+{
+    uint32_t len;
+    if (!dfu_transfer_get_oldest_missing_entry(p_start_addr, pp_entry, &len))
+    {
+        return false;
+    }
+    uint16_t first_segment = ADDR_SEGMENT(*pp_entry, m_transfer.p_start_addr);
+    *p_bitmap = 0;
+    for (uint32_t i = 0; i < 32 && first_segment + i <= m_transfer.segment_max; ++i)
+    {
+        if (segment_is_missing(first_segment + i))
+        {
+            *p_bitmap |= (1UL << i);
+        }
+    }
+    return true;
+}
+
+bool dfu_transfer_parity_recover(
+        uint32_t* p_first_addr,
+        uint32_t segments,
+        const uint8_t* p_parity,
+        uint32_t** pp_addr,
+        uint8_t* p_data,
+        uint16_t* p_length)
+{
+    /* the flash contents of a segment being written aren't there yet */
+    if (m_transfer.segment_max == INVALID_SEGMENT_INDEX ||
+        m_transfer.segment_prev != INVALID_SEGMENT_INDEX)
+    {
+        return false;
+    }
+    uint16_t first_segment = ADDR_SEGMENT(p_first_addr, m_transfer.p_start_addr);
+    uint16_t missing_segment = INVALID_SEGMENT_INDEX;
+    for (uint32_t i = 0; i < segments; ++i)
+    {
+        if (segment_length(first_segment + i) > 0 &&
+            segment_is_missing(first_segment + i))
+        {
+            if (missing_segment != INVALID_SEGMENT_INDEX)
+            {
+                return false;
+            }
+            missing_segment = first_segment + i;
+        }
+    }
+    if (missing_segment == INVALID_SEGMENT_INDEX)
+    {
+        return false;
+    }
+
+    /* The parity is the XOR of all segments in the group, zero padded. */
+    memcpy(p_data, p_parity, SEGMENT_LENGTH);
+    for (uint32_t i = 0; i < segments; ++i)
+    {
+        uint16_t segment = first_segment + i;
+        uint32_t len = segment_length(segment);
+        if (segment != missing_segment)
+        {
+            uint8_t* p_stored = (uint8_t*) ((uint32_t) m_transfer.p_bank_addr +
+                    (SEGMENT_ADDR(segment, m_transfer.p_start_addr) - (uint32_t) m_transfer.p_start_addr));
+            for (uint32_t j = 0; j < len; ++j)
+            {
+                p_data[j] ^= p_stored[j];
+            }
+        }
+    }
+    *pp_addr = (uint32_t*) SEGMENT_ADDR(missing_segment, m_transfer.p_start_addr);
+    *p_length = segment_length(missing_segment);
+    return true;
+}
+
+void dfu_transfer_sha256_stream(sha256_context_t* p_hash_context)
+{
+    m_transfer.p_hash_context = p_hash_context;
+    m_transfer.hashed_len = 0;
+    hash_advance();
+}
+
 uint32_t dfu_transfer_sha256(sha256_context_t* p_hash_context)
 {
     if (m_transfer.segment_max == INVALID_SEGMENT_INDEX)
     {
         return NRF_ERROR_INVALID_STATE;
     }
+    /* a streamed hash already covers the start of the image */
+    uint32_t hashed_len = 0;
+    if (p_hash_context == m_transfer.p_hash_context)
+    {
+        hashed_len = m_transfer.hashed_len;
+        m_transfer.p_hash_context = NULL;
+    }
     return sha256_update(p_hash_context,
-                  (uint8_t*) m_transfer.p_bank_addr,
-                  m_transfer.size);
+                  (uint8_t*) m_transfer.p_bank_addr + hashed_len,
+                  m_transfer.size - hashed_len);
 }
 
 void dfu_transfer_end(void)
@@ -270,11 +476,21 @@ void dfu_transfer_end(void)
 
 void dfu_transfer_flash_write_complete(uint8_t* p_write_src)
 {
-    if (p_write_src == m_transfer.write_buffer)
+    if (m_transfer.segment_prev != INVALID_SEGMENT_INDEX &&
+        (p_write_src == m_transfer.write_buffer ||
+         p_write_src == m_transfer.p_copy_src))
     {
-        uint32_t offset = m_transfer.segment_max - m_transfer.segment_prev;
-        m_transfer.missing_segments &= ~(1 << offset);
+        for (uint32_t i = 0; i < m_transfer.segments_in_flight; ++i)
+        {
+            uint32_t offset = m_transfer.segment_max - m_transfer.segment_prev + i;
+            if (offset < MISSING_BITFIELD_WIDTH)
+            {
+                m_transfer.missing_segments &= ~(1ULL << offset);
+            }
+        }
         m_transfer.segment_prev = INVALID_SEGMENT_INDEX;
+        m_transfer.p_copy_src = NULL;
+        hash_advance();
     }
 }
 
@@ -57,6 +57,10 @@ bool bootloader_info_available(void);
 bool bootloader_info_stable(void);
 uint32_t bootloader_info_reset(void);
 uint32_t bootloader_info_entry_invalidate(bl_info_type_t type);
+/** Rewrite the info page without its invalidated entries, if there are enough
+ * of them to slow down lookups. Entry pointers are invalid until
+ * bootloader_info_stable() returns true again. Returns whether it started. */
+bool bootloader_info_compact(void);
 
 void bootloader_info_on_flash_op_end(flash_op_type_t type, void* p_context);
 void bootloader_info_on_flash_idle(void);
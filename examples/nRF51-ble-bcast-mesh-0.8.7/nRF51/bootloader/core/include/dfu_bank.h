@@ -34,6 +34,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dfu_types_mesh.h"
 #include "bl_if.h"
 
+/**
+ * A/B application slots. When enabled, and the info page has a
+ * BL_INFO_TYPE_SEGMENT_APP_ALT entry, application transfers linked for the
+ * alternate slot are received straight into it. Flashing the bank then only
+ * swaps the two segment entries, and the bootloader starts the application
+ * from the new slot, instead of copying the image over the old one. The
+ * alternate slot must be the same size as the application segment.
+ */
+#ifndef DFU_APP_SLOTS
+#define DFU_APP_SLOTS   (0)
+#endif
+
 /**
  * Look for available banks, finalize any ongoing flash operations.
  *
@@ -44,6 +44,20 @@ uint32_t dfu_transfer_start(
 
 uint32_t dfu_transfer_data(uint32_t p_addr, uint8_t* p_data, uint16_t length);
 
+/**
+ * Copy a range of segments into the transfer from existing flash, in a single
+ * write.
+ *
+ * @param[in] p_addr Address of the first segment to fill.
+ * @param[in] p_src_addr Word aligned address to copy the data from.
+ * @param[in] segments Number of segments to copy, at most 64.
+ *
+ * @return NRF_SUCCESS The copy was started.
+ * @return NRF_ERROR_BUSY Another write is in progress.
+ * @return NRF_ERROR_INVALID_STATE Some of the segments are already present.
+ */
+uint32_t dfu_transfer_copy(uint32_t p_addr, uint32_t p_src_addr, uint16_t segments);
+
 bool dfu_transfer_has_entry(uint32_t* p_addr, uint8_t* p_out_buffer, uint16_t len);
 
 bool dfu_transfer_get_oldest_missing_entry(
@@ -51,6 +65,27 @@ bool dfu_transfer_get_oldest_missing_entry(
         uint32_t** pp_entry,
         uint32_t* p_len);
 
+/** Get the oldest missing entry at or after p_start_addr, and a bitmap of
+ * the missing segments in the window starting at it. Bit 0 is the entry itself. */
+bool dfu_transfer_get_missing_bitmap(
+        uint32_t* p_start_addr,
+        uint32_t** pp_entry,
+        uint32_t* p_bitmap);
+
+/** Recover the one missing segment in a group of segments from the XOR
+ * parity of the group. Fails if the number of missing segments isn't one. */
+bool dfu_transfer_parity_recover(
+        uint32_t* p_first_addr,
+        uint32_t segments,
+        const uint8_t* p_parity,
+        uint32_t** pp_addr,
+        uint8_t* p_data,
+        uint16_t* p_length);
+
+/** Hash the image into the given context as it lands in flash, in order.
+ * Finish with dfu_transfer_sha256() on the same context. */
+void dfu_transfer_sha256_stream(sha256_context_t* p_hash_context);
+
 uint32_t dfu_transfer_sha256(sha256_context_t* p_hash_context);
 
 void dfu_transfer_end(void);
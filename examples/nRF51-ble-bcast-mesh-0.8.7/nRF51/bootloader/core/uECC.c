@@ -575,7 +575,7 @@ static uECC_word_t vli_sub(uECC_word_t *p_result, const uECC_word_t *p_left, con
 }
 #endif
 
-#if (!asm_mult || !asm_square || uECC_CURVE == uECC_secp256k1)
+#if (!asm_muladd && (!asm_mult || !asm_square || uECC_CURVE == uECC_secp256k1))
 static void muladd(uECC_word_t a, uECC_word_t b, uECC_word_t *r0, uECC_word_t *r1, uECC_word_t *r2)
 {
 #if uECC_WORD_SIZE == 8 && !SUPPORTS_INT128
@@ -656,6 +656,7 @@ static void vli_mult(uECC_word_t *p_result, const uECC_word_t *p_left, const uEC
 #if uECC_SQUARE_FUNC
 
 #if !asm_square
+#if !asm_mul2add
 static void mul2add(uECC_word_t a, uECC_word_t b, uECC_word_t *r0, uECC_word_t *r1, uECC_word_t *r2)
 {
 #if uECC_WORD_SIZE == 8 && !SUPPORTS_INT128
@@ -699,6 +700,7 @@ static void mul2add(uECC_word_t a, uECC_word_t b, uECC_word_t *r0, uECC_word_t *
     *r0 = (uECC_word_t)r01;
 #endif
 }
+#endif /* !asm_mul2add */
 
 static void vli_square(uECC_word_t *p_result, const uECC_word_t *p_left)
 {
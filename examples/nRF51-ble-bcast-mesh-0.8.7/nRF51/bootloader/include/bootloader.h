@@ -34,6 +34,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdint.h>
 #include "bl_if.h"
 
+/**
+ * Start the application right away if it's valid and the info page has no
+ * unfinished work for the bootloader. Must be called before anything else is
+ * initialized. Only returns if the bootloader has to run.
+ */
+void bootloader_fast_boot(void);
 void bootloader_init(void);
 void bootloader_enable(void);
 uint32_t bootloader_cmd_send(bl_cmd_t* p_bl_cmd);
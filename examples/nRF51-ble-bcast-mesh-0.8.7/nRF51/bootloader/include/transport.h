@@ -35,6 +35,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mesh_packet.h"
 
 #define TX_REPEATS_EXPONENTIAL_MAX      (12)
+#define TX_TRICKLE_DOUBLINGS_MAX        (8)
 #define TX_REPEATS_INF                  (0xFF)
 #define TRANSPORT_TX_SLOTS              (8)
 
@@ -42,7 +43,8 @@ typedef enum
 {
     TX_INTERVAL_TYPE_EXPONENTIAL,
     TX_INTERVAL_TYPE_REGULAR,
-    TX_INTERVAL_TYPE_REGULAR_SLOW
+    TX_INTERVAL_TYPE_REGULAR_SLOW,
+    TX_INTERVAL_TYPE_TRICKLE
 } tx_interval_type_t;
 
 typedef void(*release_cb_t)(mesh_packet_t* p_packet);
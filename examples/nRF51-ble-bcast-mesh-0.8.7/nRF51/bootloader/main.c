@@ -71,6 +71,7 @@ void app_error_handler_bare(uint32_t error_code)
 void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
 {
     __LOG(RTT_CTRL_TEXT_RED "APP ERROR %d, @%s:L%d\n", error_code, p_file_name, line_num);
+    rtt_log_flush();
     app_error_handler_bare(error_code);
 }
 
@@ -115,6 +116,13 @@ static void init_clock(void)
 
 int main(void)
 {
+    /* Don't wait for the clocks and the mesh unless someone asked for the
+       bootloader on purpose. */
+    if (NRF_POWER->GPREGRET == RBC_MESH_GPREGRET_CODE_GO_TO_APP)
+    {
+        bootloader_fast_boot();
+    }
+
     init_clock();
 
     NVIC_SetPriority(SWI2_IRQn, 2);
@@ -146,6 +154,7 @@ int main(void)
 
     while (1)
     {
+        rtt_log_flush();
         __WFE();
     }
 }
@@ -50,6 +50,7 @@ typedef enum
     BL_INFO_TYPE_SEGMENT_SD         = 0x10,
     BL_INFO_TYPE_SEGMENT_BL         = 0x11,
     BL_INFO_TYPE_SEGMENT_APP        = 0x12,
+    BL_INFO_TYPE_SEGMENT_APP_ALT    = 0x13,
 
     BL_INFO_TYPE_LAST8              = 0x7F,
     BL_INFO_TYPE_LAST16             = 0x7FFF,
@@ -205,6 +206,11 @@ static uint32_t put_segment(char** lines, uint32_t line_count, bl_info_type_t ty
             sprintf(start_str, "APP_START");
             sprintf(size_str, "APP_SIZE");
             break;
+        case BL_INFO_TYPE_SEGMENT_APP_ALT:
+            /* the slots are the same size */
+            sprintf(start_str, "APP_ALT_START");
+            sprintf(size_str, "APP_SIZE");
+            break;
         case BL_INFO_TYPE_SEGMENT_SD:
             sprintf(start_str, "SD_START");
             sprintf(size_str, "SD_SIZE");
@@ -307,6 +313,10 @@ static uint32_t create_info(char* p_file_name, uint8_t* p_data_buf)
 
 
     i += put_segment(lines, line_count, BL_INFO_TYPE_SEGMENT_APP, &p_data_buf[i]);
+    if (get_file_entry(lines, line_count, "APP_ALT_START"))
+    {
+        i += put_segment(lines, line_count, BL_INFO_TYPE_SEGMENT_APP_ALT, &p_data_buf[i]);
+    }
     i += put_segment(lines, line_count, BL_INFO_TYPE_SEGMENT_SD, &p_data_buf[i]);
     i += put_segment(lines, line_count, BL_INFO_TYPE_SEGMENT_BL, &p_data_buf[i]);
 
@@ -68,7 +68,6 @@ static tx_t             m_tx[TRANSPORT_TX_SLOTS];
 static fifo_t           m_rx_fifo;
 static mesh_packet_t*   m_rx_fifo_buf[RADIO_RX_FIFO_LEN];
 static uint32_t         m_ticks_at_order_time;
-static prng_t           m_prng;
 static bool             m_started = false;
 uint16_t                m_tx_evt_bitfield; /**< Bitfield of events for each handle in the reserved handle range 0xFFF0-0xFFFE. */
 /******************************************************************************
@@ -87,14 +86,20 @@ static void set_next_tx(tx_t* p_tx)
         uint32_t diff = ((offset_next & RTC_MASK) - (offset & RTC_MASK)) & RTC_MASK;
 
         p_tx->ticks_next = (p_tx->ticks_start + offset +
-            (rand_prng_get(&m_prng) % (diff / 2)) + diff / 2) & RTC_MASK;
+            rand_range(diff / 2) + diff / 2) & RTC_MASK;
+    }
+    else if (p_tx->type == TX_INTERVAL_TYPE_TRICKLE)
+    {
+        /* counted from the previous transmit, doubling up to the cap */
+        const uint32_t interval = INTERVAL << (p_tx->count < TX_TRICKLE_DOUBLINGS_MAX ? p_tx->count : TX_TRICKLE_DOUBLINGS_MAX);
+        p_tx->ticks_next = (p_tx->ticks_start + rand_range(interval / 2) + interval / 2) & RTC_MASK;
     }
     else
     {
         const uint32_t interval_scaling = (p_tx->type == TX_INTERVAL_TYPE_REGULAR_SLOW ? 10 : 1);
         /* double interval for regulars */
         p_tx->ticks_next = (p_tx->ticks_start + (interval_scaling * 2 * INTERVAL * p_tx->count) +
-            (rand_prng_get(&m_prng) % (interval_scaling * INTERVAL)) + interval_scaling * INTERVAL) & RTC_MASK;
+            rand_range(interval_scaling * INTERVAL) + interval_scaling * INTERVAL) & RTC_MASK;
     }
 }
 
@@ -107,6 +112,8 @@ static void order_scan(void)
         APP_ERROR_CHECK(NRF_ERROR_NO_MEM);
     }
     evt.access_address = 0;
+    evt.backbone = false;
+    evt.bridge = false;
     evt.channel = 37;
     if (radio_order(&evt) != NRF_SUCCESS)
     {
@@ -227,7 +234,7 @@ void transport_init(rx_cb_t rx_cb, uint32_t access_addr)
     fifo_init(&m_rx_fifo);
     mesh_packet_init();
 
-    APP_ERROR_CHECK(rand_prng_seed(&m_prng));
+    APP_ERROR_CHECK(rand_init());
 
     NVIC_SetPriority(SWI0_IRQn, 2);
     NVIC_EnableIRQ(SWI0_IRQn);
@@ -333,6 +340,8 @@ void transport_rtc_irq_handler(void)
             radio_evt.event_type = RADIO_EVENT_TYPE_TX;
             radio_evt.packet_ptr = (uint8_t*) m_tx[i].p_packet;
             radio_evt.access_address = 0;
+            radio_evt.backbone = false;
+            radio_evt.bridge = false;
 
 #ifdef DEBUG_LEDS
             NRF_GPIO->OUT ^= LED_1;
@@ -352,7 +361,15 @@ void transport_rtc_irq_handler(void)
 
             m_tx[i].redundancy = 0;
 
-            if (m_tx[i].count++ == 0xFF)
+            if (m_tx[i].type == TX_INTERVAL_TYPE_TRICKLE)
+            {
+                m_tx[i].ticks_start = m_tx[i].ticks_next;
+                if (m_tx[i].count < TX_TRICKLE_DOUBLINGS_MAX)
+                {
+                    m_tx[i].count++;
+                }
+            }
+            else if (m_tx[i].count++ == 0xFF)
             {
                 m_tx[i].ticks_start = (m_tx[i].ticks_start + INTERVAL * 2 * 0x100) & RTC_MASK;
             }
@@ -0,0 +1,188 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "adc_scan.h"
+#include "nrf_drv_adc.h"
+#include "nrf_drv_timer.h"
+#include "app_util_platform.h"
+#include "nrf_error.h"
+#include <string.h>
+
+#if (ADC_SCAN_FRAME_COUNT & (ADC_SCAN_FRAME_COUNT - 1))
+#error "ADC_SCAN_FRAME_COUNT must be a power of two"
+#endif
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static const nrf_drv_timer_t m_timer = NRF_DRV_TIMER_INSTANCE(2);
+
+static uint8_t m_input_count;
+static nrf_adc_config_input_t m_first_input;
+static bool m_paused;
+
+/** Scan buffer of the ADC driver. */
+static int16_t m_scan_buffer[ADC_SCAN_INPUTS_MAX];
+static adc_scan_frame_t m_frames[ADC_SCAN_FRAME_COUNT];
+/** Total number of frames written and read, the difference is the number of unread frames. */
+static volatile uint32_t m_frames_written;
+static uint32_t m_frames_read;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void timer_event_handler(nrf_timer_event_t event_type, void* p_context)
+{
+    /* compare interrupt isn't enabled, the PPI channel does all the work */
+}
+
+static void adc_event_handler(int16_t* p_buffer, uint8_t count)
+{
+    memcpy(m_frames[m_frames_written & (ADC_SCAN_FRAME_COUNT - 1)].sample, p_buffer, count * sizeof(int16_t));
+    m_frames_written++;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+uint32_t adc_scan_init(const nrf_adc_config_input_t* p_inputs, uint8_t input_count, uint32_t interval_us)
+{
+    if (input_count == 0 || input_count > ADC_SCAN_INPUTS_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    m_input_count = input_count;
+    m_first_input = p_inputs[0];
+    m_paused = false;
+    m_frames_written = 0;
+    m_frames_read = 0;
+
+    uint32_t error_code = nrf_drv_adc_init(NULL, adc_event_handler);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    error_code = nrf_drv_adc_scan_setup(p_inputs, input_count, m_scan_buffer);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
+    error_code = nrf_drv_timer_init(&m_timer, NULL, timer_event_handler);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    nrf_drv_timer_extended_compare(&m_timer,
+            NRF_TIMER_CC_CHANNEL0,
+            nrf_drv_timer_us_to_ticks(&m_timer, interval_us),
+            NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK,
+            false);
+
+    error_code = nrf_drv_adc_trigger_enable(nrf_drv_timer_compare_event_address_get(&m_timer, NRF_TIMER_CC_CHANNEL0));
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
+    nrf_drv_timer_enable(&m_timer);
+    return NRF_SUCCESS;
+}
+
+uint32_t adc_scan_pause(void)
+{
+    if (m_paused)
+    {
+        return NRF_SUCCESS;
+    }
+
+    nrf_drv_timer_disable(&m_timer);
+    if (nrf_drv_adc_is_busy())
+    {
+        /* let the scan finish, the next call will find it idle */
+        nrf_drv_timer_enable(&m_timer);
+        return NRF_ERROR_BUSY;
+    }
+    nrf_adc_input_select(NRF_ADC_CONFIG_INPUT_DISABLED);
+    m_paused = true;
+    return NRF_SUCCESS;
+}
+
+void adc_scan_resume(void)
+{
+    if (m_paused)
+    {
+        nrf_adc_input_select(m_first_input);
+        nrf_drv_timer_enable(&m_timer);
+        m_paused = false;
+    }
+}
+
+uint32_t adc_scan_sample_get(uint8_t index, int32_t* p_sample)
+{
+    if (index >= m_input_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t error_code = NRF_ERROR_NOT_FOUND;
+    CRITICAL_REGION_ENTER();
+    if (m_frames_written > 0)
+    {
+        *p_sample = m_frames[(m_frames_written - 1) & (ADC_SCAN_FRAME_COUNT - 1)].sample[index];
+        error_code = NRF_SUCCESS;
+    }
+    CRITICAL_REGION_EXIT();
+    return error_code;
+}
+
+uint32_t adc_scan_frame_pop(adc_scan_frame_t* p_frame)
+{
+    uint32_t error_code = NRF_ERROR_NOT_FOUND;
+    CRITICAL_REGION_ENTER();
+    if (m_frames_written - m_frames_read > ADC_SCAN_FRAME_COUNT)
+    {
+        /* overrun, skip to the oldest frame still in the buffer */
+        m_frames_read = m_frames_written - ADC_SCAN_FRAME_COUNT;
+    }
+    if (m_frames_read != m_frames_written)
+    {
+        memcpy(p_frame, &m_frames[m_frames_read & (ADC_SCAN_FRAME_COUNT - 1)], sizeof(adc_scan_frame_t));
+        m_frames_read++;
+        error_code = NRF_SUCCESS;
+    }
+    CRITICAL_REGION_EXIT();
+    return error_code;
+}
+
+uint32_t adc_scan_frame_count_get(void)
+{
+    return m_frames_written;
+}
@@ -0,0 +1,185 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "envelope_detect.h"
+#include <string.h>
+
+#if defined(NRF52) && defined(ARM_MATH_CM4)
+#include "arm_math.h"
+#define ENVELOPE_DETECT_CMSIS_DSP
+#endif
+
+#define BASELINE_SHIFT          (8) /* fraction bits of the baseline */
+#define MEAN_SQUARE_SHIFT       (4) /* fraction bits of the mean square, leaves room for 12 bit samples */
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint32_t isqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+static void block_sums(const int16_t* p_samples, uint32_t count, int64_t* p_sum, uint64_t* p_sum_squares)
+{
+#ifdef ENVELOPE_DETECT_CMSIS_DSP
+    /* the samples are plain integers, so the q15 mean is the integer mean,
+       and the 34.30 power is the integer sum of squares. */
+    q15_t mean;
+    q63_t power;
+    arm_mean_q15((q15_t*) p_samples, count, &mean);
+    arm_power_q15((q15_t*) p_samples, count, &power);
+    *p_sum = (int64_t) mean * count;
+    *p_sum_squares = (uint64_t) power;
+#else
+    int64_t sum = 0;
+    uint64_t sum_squares = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        sum += p_samples[i];
+        sum_squares += (uint32_t) ((int32_t) p_samples[i] * p_samples[i]);
+    }
+    *p_sum = sum;
+    *p_sum_squares = sum_squares;
+#endif
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void envelope_detect_init(envelope_detect_t* p_detect, const envelope_detect_config_t* p_config)
+{
+    memcpy(&p_detect->config, p_config, sizeof(envelope_detect_config_t));
+    envelope_detect_reset(p_detect);
+}
+
+void envelope_detect_reset(envelope_detect_t* p_detect)
+{
+    p_detect->baseline = 0;
+    p_detect->mean_square = 0;
+    p_detect->rms = 0;
+    p_detect->hold_count = 0;
+    p_detect->active = false;
+    p_detect->primed = false;
+}
+
+envelope_detect_event_t envelope_detect_process(envelope_detect_t* p_detect, const int16_t* p_samples, uint32_t count)
+{
+    if (count == 0)
+    {
+        return ENVELOPE_DETECT_EVENT_NONE;
+    }
+
+    int64_t sum;
+    uint64_t sum_squares;
+    block_sums(p_samples, count, &sum, &sum_squares);
+    int32_t mean = (int32_t) (sum / (int64_t) count);
+
+    int64_t baseline = 0;
+    if (p_detect->config.baseline_shift != 0)
+    {
+        if (!p_detect->primed)
+        {
+            p_detect->baseline = mean * (1 << BASELINE_SHIFT);
+        }
+        baseline = p_detect->baseline >> BASELINE_SHIFT;
+        p_detect->baseline += (mean * (1 << BASELINE_SHIFT) - p_detect->baseline) >> p_detect->config.baseline_shift;
+    }
+
+    /* mean square around the baseline from the block sums:
+       sum((x - b)^2) = sum(x^2) - 2 * b * sum(x) + n * b^2 */
+    int64_t block_square = ((int64_t) sum_squares - 2 * baseline * sum + (int64_t) count * baseline * baseline) / (int64_t) count;
+    int32_t block_mean_square = (int32_t) ((block_square < 0 ? 0 : block_square) << MEAN_SQUARE_SHIFT);
+    if (!p_detect->primed)
+    {
+        p_detect->mean_square = block_mean_square;
+        p_detect->primed = true;
+    }
+    else
+    {
+        p_detect->mean_square += (block_mean_square - (int32_t) p_detect->mean_square) >> p_detect->config.window_shift;
+    }
+    p_detect->rms = isqrt(p_detect->mean_square >> MEAN_SQUARE_SHIFT);
+
+    bool on = p_detect->config.falling ?
+        (p_detect->rms <= p_detect->config.on_level) :
+        (p_detect->rms >= p_detect->config.on_level);
+    bool off = p_detect->config.falling ?
+        (p_detect->rms > p_detect->config.off_level) :
+        (p_detect->rms < p_detect->config.off_level);
+
+    if (!p_detect->active)
+    {
+        if (on)
+        {
+            p_detect->active = true;
+            p_detect->hold_count = p_detect->config.hold_samples;
+            return ENVELOPE_DETECT_EVENT_START;
+        }
+        return ENVELOPE_DETECT_EVENT_NONE;
+    }
+
+    if (!off)
+    {
+        p_detect->hold_count = p_detect->config.hold_samples;
+        return ENVELOPE_DETECT_EVENT_NONE;
+    }
+    p_detect->hold_count = (p_detect->hold_count > count) ? p_detect->hold_count - count : 0;
+    if (p_detect->hold_count == 0)
+    {
+        p_detect->active = false;
+        return ENVELOPE_DETECT_EVENT_END;
+    }
+    return ENVELOPE_DETECT_EVENT_NONE;
+}
+
+bool envelope_detect_is_active(const envelope_detect_t* p_detect)
+{
+    return p_detect->active;
+}
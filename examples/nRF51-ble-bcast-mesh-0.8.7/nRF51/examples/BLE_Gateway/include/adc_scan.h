@@ -0,0 +1,116 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _ADC_SCAN_H__
+#define _ADC_SCAN_H__
+
+#include "nrf_adc.h"
+#include <stdint.h>
+
+/**
+* @file Timer triggered ADC sampling of a set of inputs. A TIMER compare event
+* starts each scan of the nrf_drv_adc driver through PPI, and the driver steps
+* through the inputs from the ADC END interrupt, so no CPU time is spent
+* waiting for conversions. Finished scans are kept in a ring buffer of frames.
+*/
+
+#define ADC_SCAN_INPUTS_MAX     (8) /* Number of analog inputs on the nRF51 */
+
+#ifndef ADC_SCAN_FRAME_COUNT
+#define ADC_SCAN_FRAME_COUNT    (8) /* Number of scan frames kept in the ring buffer, must be a power of two */
+#endif
+
+/** One sample for each of the scanned inputs, in the order they were given to adc_scan_init(). */
+typedef struct
+{
+    int16_t sample[ADC_SCAN_INPUTS_MAX];
+} adc_scan_frame_t;
+
+/**
+* @brief Set up the ADC driver, TIMER2 and a PPI channel, and start scanning.
+*
+* @param[in] p_inputs List of inputs to sample in each scan.
+* @param[in] input_count Number of inputs in the list.
+* @param[in] interval_us Time between the start of each scan.
+*
+* @return NRF_SUCCESS The scan was started.
+* @return NRF_ERROR_INVALID_PARAM The input count is 0 or larger than ADC_SCAN_INPUTS_MAX.
+* @return NRF_ERROR_NO_MEM No PPI channels available.
+*/
+uint32_t adc_scan_init(const nrf_adc_config_input_t* p_inputs, uint8_t input_count, uint32_t interval_us);
+
+/**
+* @brief Stop scanning, and power down the ADC and TIMER2. The ADC is released
+* for other users of the analog inputs, like the LPCOMP. The latest samples
+* stay available.
+*
+* @return NRF_SUCCESS The scans are paused.
+* @return NRF_ERROR_BUSY A scan is in progress, try again later.
+*/
+uint32_t adc_scan_pause(void);
+
+/**
+* @brief Start scanning again after adc_scan_pause(). Does nothing if the scans
+* aren't paused.
+*/
+void adc_scan_resume(void);
+
+/**
+* @brief Get the latest sample of an input.
+*
+* @param[in] index Index of the input in the list given to adc_scan_init().
+* @param[out] p_sample Latest sample.
+*
+* @return NRF_SUCCESS The sample was returned.
+* @return NRF_ERROR_INVALID_PARAM The index is out of range.
+* @return NRF_ERROR_NOT_FOUND No scan has finished yet.
+*/
+uint32_t adc_scan_sample_get(uint8_t index, int32_t* p_sample);
+
+/**
+* @brief Get the oldest scan frame that hasn't been popped yet. Frames that
+* haven't been popped by the time the ring buffer wraps around are lost.
+*
+* @param[out] p_frame Oldest frame.
+*
+* @return NRF_SUCCESS The frame was returned.
+* @return NRF_ERROR_NOT_FOUND There are no new frames.
+*/
+uint32_t adc_scan_frame_pop(adc_scan_frame_t* p_frame);
+
+/**
+* @brief Get the number of scans completed since adc_scan_init(), for
+* example to check that the scans are still running.
+*
+* @return Number of completed scans, wrapping around on overflow.
+*/
+uint32_t adc_scan_frame_count_get(void);
+
+#endif /* _ADC_SCAN_H__ */
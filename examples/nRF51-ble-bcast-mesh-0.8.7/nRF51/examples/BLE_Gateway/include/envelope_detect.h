@@ -0,0 +1,115 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _ENVELOPE_DETECT_H__
+#define _ENVELOPE_DETECT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* @file Fixed point event detection on sampled analog sensors. Instead of
+* comparing single samples to a threshold, the detector follows the RMS of the
+* signal over a moving window, optionally after removing its slowly moving
+* baseline. The event starts when the RMS passes the on level, and ends once
+* it has stayed past the off level for the hold time, so noise spikes and
+* signals hovering around the threshold don't toggle the event. Samples are
+* handed over in blocks, such as all ADC scan frames since the last call. On
+* nRF52 builds with ARM_MATH_CM4, the block sums use the CMSIS-DSP kernels.
+*/
+
+/** Result of a block of samples. */
+typedef enum
+{
+    ENVELOPE_DETECT_EVENT_NONE,     /**< No change. */
+    ENVELOPE_DETECT_EVENT_START,    /**< The RMS passed the on level. */
+    ENVELOPE_DETECT_EVENT_END       /**< The RMS has stayed past the off level for the hold time. */
+} envelope_detect_event_t;
+
+typedef struct
+{
+    uint8_t baseline_shift; /**< Baseline time constant, 2^shift blocks, or 0 to measure the RMS of the raw samples. */
+    uint8_t window_shift; /**< RMS window, 2^shift blocks. */
+    bool falling; /**< Detect the RMS falling below the on level instead of rising above it. */
+    uint32_t on_level; /**< RMS where the event starts, in sample units. */
+    uint32_t off_level; /**< RMS past which the event may end, in sample units. Set it a bit short of the on level. */
+    uint32_t hold_samples; /**< Number of samples the RMS must stay past the off level for the event to end. */
+} envelope_detect_config_t;
+
+typedef struct
+{
+    envelope_detect_config_t config;
+    int32_t baseline; /**< Signal baseline, in 1/256 sample units. */
+    uint32_t mean_square; /**< Mean square of the signal around the baseline, in 1/16 square sample units. */
+    uint32_t rms; /**< Latest RMS, in sample units. */
+    uint32_t hold_count; /**< Samples left before an active event may end. */
+    bool active;
+    bool primed; /**< The first block has been seen. */
+} envelope_detect_t;
+
+/**
+* @brief Set up a detector. The window and baseline start at the first block.
+*
+* @param[out] p_detect Detector state.
+* @param[in] p_config Detector configuration, copied into the state.
+*/
+void envelope_detect_init(envelope_detect_t* p_detect, const envelope_detect_config_t* p_config);
+
+/**
+* @brief Forget the signal history, for example after the sampling was
+* paused. The next block starts the window and baseline again, and the event
+* ends without an ENVELOPE_DETECT_EVENT_END.
+*
+* @param[in,out] p_detect Detector state.
+*/
+void envelope_detect_reset(envelope_detect_t* p_detect);
+
+/**
+* @brief Hand a block of samples to the detector. The window and baseline
+* move once per block, so the blocks should be about the same size.
+*
+* @param[in,out] p_detect Detector state.
+* @param[in] p_samples Samples, oldest first.
+* @param[in] count Number of samples. An empty block is ignored.
+*
+* @return Whether the event started or ended with this block.
+*/
+envelope_detect_event_t envelope_detect_process(envelope_detect_t* p_detect, const int16_t* p_samples, uint32_t count);
+
+/**
+* @brief Check whether the event is active.
+*
+* @param[in] p_detect Detector state.
+*
+* @return true if the event has started and not ended.
+*/
+bool envelope_detect_is_active(const envelope_detect_t* p_detect);
+
+#endif /* _ENVELOPE_DETECT_H__ */
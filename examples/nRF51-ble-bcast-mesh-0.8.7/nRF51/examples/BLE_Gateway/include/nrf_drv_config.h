@@ -51,7 +51,7 @@
 #define TIMER1_INSTANCE_INDEX      (TIMER0_ENABLED)
 #endif
  
-#define TIMER2_ENABLED 0
+#define TIMER2_ENABLED 1
 
 #if (TIMER2_ENABLED == 1)
 #define TIMER2_CONFIG_FREQUENCY    NRF_TIMER_FREQ_16MHz
@@ -125,6 +125,13 @@
 #define LPCOMP_CONFIG_INPUT        NRF_LPCOMP_INPUT_0
 #endif
 
+/* ADC */
+#define ADC_ENABLED 1
+
+#if (ADC_ENABLED == 1)
+#define ADC_CONFIG_IRQ_PRIORITY APP_IRQ_PRIORITY_LOW
+#endif
+
 /* WDT */
 #define WDT_ENABLED 1
 
@@ -0,0 +1,105 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _SENSOR_CURVE_H__
+#define _SENSOR_CURVE_H__
+
+#include <stdint.h>
+
+/**
+* @file Piecewise linear conversion of raw sensor readings. The slope of each
+* segment is calculated once at init, so a conversion is a binary search and
+* a multiply. Each curve may have a per-device gain and offset, stored in the
+* UICR customer registers when the device is produced.
+*/
+
+#define SENSOR_CURVE_SLOPE_SHIFT    (16) /* Fraction bits of the precomputed slopes */
+#define SENSOR_CURVE_GAIN_SHIFT     (15) /* Fraction bits of the calibration gain, 0x8000 is 1.0 */
+#define SENSOR_CURVE_GAIN_UNITY     (1 << SENSOR_CURVE_GAIN_SHIFT)
+
+#define SENSOR_CURVE_NTC_10K_POINTS (20)
+#define SENSOR_CURVE_TPS851_POINTS  (2)
+
+/** Point on a curve, converting raw reading x to y. */
+typedef struct
+{
+    int16_t x;
+    int16_t y;
+} sensor_curve_point_t;
+
+typedef struct
+{
+    const sensor_curve_point_t* p_points; /**< Points sorted by x, at least two. */
+    int32_t* p_slopes; /**< One slope per segment, count - 1 entries, filled in by sensor_curve_init(). */
+    uint8_t count;
+    uint16_t gain; /**< Calibration gain, see SENSOR_CURVE_GAIN_SHIFT. */
+    int16_t offset; /**< Calibration offset, added after the gain. */
+} sensor_curve_t;
+
+/** 10k NTC thermistor, 10 bit ADC reading to 0.1 degrees centigrade. */
+extern const sensor_curve_point_t g_sensor_curve_ntc_10k[SENSOR_CURVE_NTC_10K_POINTS];
+/** TPS851 ambient light sensor, 10 bit ADC reading to lux. The sensor output is linear. */
+extern const sensor_curve_point_t g_sensor_curve_tps851[SENSOR_CURVE_TPS851_POINTS];
+
+/**
+* @brief Set up a curve with unity calibration.
+*
+* @note The slope times the distance between two neighbouring points must
+* fit in 32 bits, with SENSOR_CURVE_SLOPE_SHIFT fraction bits.
+*
+* @param[out] p_curve Curve to set up.
+* @param[in] p_points Points of the curve, sorted by x.
+* @param[in] p_slopes Space for count - 1 slopes, must live as long as the curve.
+* @param[in] count Number of points.
+*/
+void sensor_curve_init(sensor_curve_t* p_curve, const sensor_curve_point_t* p_points, int32_t* p_slopes, uint8_t count);
+
+/**
+* @brief Load the calibration of a curve from a UICR customer register. The
+* upper halfword is the gain and the lower halfword the offset. An erased
+* register leaves the curve uncalibrated.
+*
+* @param[in,out] p_curve Curve to calibrate.
+* @param[in] uicr_index Index of the UICR customer register.
+*/
+void sensor_curve_calibration_load(sensor_curve_t* p_curve, uint8_t uicr_index);
+
+/**
+* @brief Convert a raw reading. Readings outside the curve are clamped to the
+* first or last point.
+*
+* @param[in] p_curve Curve to convert with.
+* @param[in] x Raw reading.
+*
+* @return Calibrated value.
+*/
+int32_t sensor_curve_convert(const sensor_curve_t* p_curve, int32_t x);
+
+#endif /* _SENSOR_CURVE_H__ */
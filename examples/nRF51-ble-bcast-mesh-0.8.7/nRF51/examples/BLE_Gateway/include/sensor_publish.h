@@ -0,0 +1,88 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _SENSOR_PUBLISH_H__
+#define _SENSOR_PUBLISH_H__
+
+#include "rbc_mesh.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* @file Publishing of sensor values to mesh handles. A sample is only
+* published when it has moved more than the deadband away from the last
+* published value and the minimum interval has passed, or when the last
+* published value has gone stale. Values are published as little endian
+* int16.
+*/
+
+typedef struct
+{
+    rbc_mesh_value_handle_t handle; /**< Mesh handle the sensor is published on. */
+    uint32_t deadband; /**< Smallest change worth publishing, in sensor units. */
+    uint32_t min_interval; /**< Shortest time between two publishes, in app_timer ticks. */
+    uint32_t max_interval; /**< Longest time a value may go without being republished, in app_timer ticks. 0 to never republish an unchanged value. */
+    int32_t last_value;
+    uint32_t last_sample_ticks;
+    uint32_t age; /**< Time since the last publish in app_timer ticks, saturates. */
+    bool published;
+} sensor_publish_t;
+
+/**
+* @brief Set up publishing of a sensor. The first sample is always published.
+*
+* @param[out] p_sensor Sensor publish state.
+* @param[in] handle Mesh handle to publish on.
+* @param[in] deadband Smallest change worth publishing.
+* @param[in] min_interval Shortest time between two publishes, in app_timer ticks.
+* @param[in] max_interval Longest time between two publishes, in app_timer ticks, or 0.
+*/
+void sensor_publish_init(sensor_publish_t* p_sensor,
+        rbc_mesh_value_handle_t handle,
+        uint32_t deadband,
+        uint32_t min_interval,
+        uint32_t max_interval);
+
+/**
+* @brief Hand a new sample to the publish layer. Must be called at least once
+* every app_timer counter wraparound for the age of the value to be correct.
+*
+* @param[in,out] p_sensor Sensor publish state.
+* @param[in] value New sample.
+* @param[out] p_published Whether the sample was published to the mesh.
+*
+* @return NRF_SUCCESS The sample was handled. It's only published if
+*   p_published is set.
+* @return Any error from @ref rbc_mesh_value_set. The sample will be
+*   considered again with the next one.
+*/
+uint32_t sensor_publish_sample(sensor_publish_t* p_sensor, int32_t value, bool* p_published);
+
+#endif /* _SENSOR_PUBLISH_H__ */
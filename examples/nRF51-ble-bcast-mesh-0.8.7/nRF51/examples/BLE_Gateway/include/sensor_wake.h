@@ -0,0 +1,95 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _SENSOR_WAKE_H__
+#define _SENSOR_WAKE_H__
+
+#include "nrf_lpcomp.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+* @file Low power sensor mode. When no sensor activity has been reported for a
+* while, the ADC scans are paused, and the LPCOMP watches one analog input
+* instead. A threshold crossing on that input resumes the scans from the
+* LPCOMP interrupt, so the CPU only samples the sensors while something is
+* going on. The other inputs are refreshed by resuming the scans for a single
+* tick every now and then.
+*
+* The LPCOMP and the ADC can't run at the same time on the nRF51, and there's
+* only one comparator, so only one input can wake the scans.
+*/
+
+/** Called from the LPCOMP interrupt when the wake input crosses its threshold. */
+typedef void (*sensor_wake_handler_t)(void);
+
+typedef struct
+{
+    nrf_lpcomp_input_t  input;          /**< Analog input to watch while idle. */
+    nrf_lpcomp_ref_t    reference;      /**< Threshold, as a fraction of the supply. */
+    nrf_lpcomp_detect_t detection;      /**< Crossing direction that wakes the scans. */
+    uint16_t            idle_ticks;     /**< Ticks without activity before the scans are paused. */
+    uint16_t            refresh_ticks;  /**< Idle ticks between each single tick refresh of the scans. */
+} sensor_wake_config_t;
+
+/**
+* @brief Set up the LPCOMP. Must be called after adc_scan_init(). The scans
+* keep running until the first idle period.
+*
+* @param[in] p_config Wake input and timing.
+* @param[in] handler Function to call on a wake up, or NULL.
+*
+* @return NRF_SUCCESS The module is ready.
+* @return NRF_ERROR_INVALID_PARAM The tick counts are 0.
+* @return Any error from nrf_drv_lpcomp_init.
+*/
+uint32_t sensor_wake_init(const sensor_wake_config_t* p_config, sensor_wake_handler_t handler);
+
+/**
+* @brief Report sensor activity. Restarts the idle countdown, and resumes the
+* scans if they're paused.
+*/
+void sensor_wake_activity(void);
+
+/**
+* @brief Advance the idle countdown and the refresh timing. Call periodically,
+* at the same interrupt priority as the LPCOMP and the sensor handlers.
+*/
+void sensor_wake_tick(void);
+
+/**
+* @brief Check whether the scans are paused.
+*
+* @return true The LPCOMP is watching the wake input, and the ADC samples are
+*   stale.
+*/
+bool sensor_wake_is_idle(void);
+
+#endif /* _SENSOR_WAKE_H__ */
@@ -0,0 +1,112 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _TASK_TABLE_H__
+#define _TASK_TABLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+* @file Cooperative task table driven by a single repeated app_timer. Tasks
+* are started and stopped by writing to the table, so there's no app_timer
+* operation queue involved, and the RTC only wakes the CPU once per tick.
+* Repeated tasks are given different phase offsets at creation, so tasks
+* started at the same time with related periods don't run on the same tick.
+*/
+
+#ifndef TASK_TABLE_SIZE
+#define TASK_TABLE_SIZE         (16) /* Maximum number of tasks */
+#endif
+
+#ifndef TASK_TABLE_TICK_MS
+#define TASK_TABLE_TICK_MS      (12) /* Length of a task tick in milliseconds */
+#endif
+
+/** Convert milliseconds to task ticks, rounded to the closest tick, at least 1. */
+#define TASK_TICKS(MS)          ((((MS) + TASK_TABLE_TICK_MS / 2) / TASK_TABLE_TICK_MS) ? \
+                                 (((MS) + TASK_TABLE_TICK_MS / 2) / TASK_TABLE_TICK_MS) : 1)
+
+typedef uint8_t task_id_t;
+
+typedef void (*task_handler_t)(void* p_context);
+
+typedef enum
+{
+    TASK_MODE_SINGLE_SHOT,
+    TASK_MODE_REPEATED
+} task_mode_t;
+
+/**
+* @brief Create the tick timer and start ticking. Must be called after
+* APP_TIMER_INIT, and uses one of its timers.
+*
+* @param[in] app_timer_prescaler Prescaler app_timer was initialized with.
+*
+* @return NRF_SUCCESS The task table is ticking.
+* @return Any error from app_timer_create or app_timer_start.
+*/
+uint32_t task_table_init(uint32_t app_timer_prescaler);
+
+/**
+* @brief Add a task to the table. The task doesn't run until it's started.
+*
+* @param[out] p_id Id of the new task.
+* @param[in] mode Whether the task runs once or repeatedly after a start.
+* @param[in] handler Function to call when the task runs.
+*
+* @return NRF_SUCCESS The task was added.
+* @return NRF_ERROR_NO_MEM The table is full.
+*/
+uint32_t task_create(task_id_t* p_id, task_mode_t mode, task_handler_t handler);
+
+/**
+* @brief Start or restart a task.
+*
+* @param[in] id Task to start.
+* @param[in] ticks Ticks until the first run, and the period of repeated tasks.
+* @param[in] p_context Context passed to the handler.
+*
+* @return NRF_SUCCESS The task was started.
+* @return NRF_ERROR_INVALID_PARAM The id or tick count is invalid.
+*/
+uint32_t task_start(task_id_t id, uint32_t ticks, void* p_context);
+
+/**
+* @brief Stop a task. Stopping a task that isn't running has no effect.
+*
+* @param[in] id Task to stop.
+*
+* @return NRF_SUCCESS The task is stopped.
+* @return NRF_ERROR_INVALID_PARAM The id is invalid.
+*/
+uint32_t task_stop(task_id_t id);
+
+#endif /* _TASK_TABLE_H__ */
@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ************************************************************************************/
 
 #include "rbc_mesh.h"
+#include "toolchain.h"
 #ifdef MESH_DFU
 #include "dfu_app.h"
 #endif
@@ -55,17 +56,31 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 
 #include "app_timer.h"
+#include "app_button.h"
 #include "bsp.h"
 #include "nrf_drv_config.h"
-#if DEBUG_LOG_RTT
+#if DEBUG_LOG_RTT || defined(STARTUP_PROFILE)
 #include "SEGGER_RTT.h"
 #endif
+#include "rtt_log.h"
 #include "nrf_delay.h"
 #include "app_pwm.h"
 #include "nrf_error.h"
 #include "nrf_adc.h"
+#include "adc_scan.h"
+#ifdef SENSOR_WAKE
+#include "sensor_wake.h"
+#endif
+#include "sensor_curve.h"
+#include "sensor_publish.h"
+#include "envelope_detect.h"
+#include "task_table.h"
+#ifdef BSP_LED_ENGINE
+#include "bsp_led_engine.h"
+#endif
+#include "nrf_drv_gpiote.h"
 #include "nrf_wdt.h"
-#include "nrf_drv_wdt.h"
+#include "app_supervisor.h"
 #include "app_util_platform.h"
 //#include "ble_bas.h"
 #include "ble_dis.h"
@@ -73,6 +88,21 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ble_temperature.h"
 #include "ble_light.h"
 
+/* Sensor events are logged from interrupt handlers, so they use the deferred
+   logger when it's enabled. The fault handlers keep printing at once. */
+#ifdef RTT_LOG_DEFERRED
+#define DEBUG_LOG(...)  __LOG(__VA_ARGS__)
+#else
+#define DEBUG_LOG(...)  SEGGER_RTT_printf(0, __VA_ARGS__)
+#endif
+
+/* The startup profile prints the RTC1 counter (32768 Hz) after each init step. */
+#ifdef STARTUP_PROFILE
+#define STARTUP_STEP(NAME)  SEGGER_RTT_printf(0, "STARTUP %s:%u\r\n", NAME, NRF_RTC1->COUNTER)
+#else
+#define STARTUP_STEP(NAME)
+#endif
+
 #define DEVICE_NAME                  "LIGHT_SWITCH" /**< Name of device. Will be included in the advertising data. */
 #define MANUFACTURER_NAME            "TEMCOCONTROLS"     	 /**< Manufacturer. Will be passed to Device Information Service. */
 #define DEVICE_HARDWARE_VERSION		 "v3B"					 /* Device hardware version */
@@ -85,22 +115,76 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MESH_CHANNEL            	(38)                                /**< BLE channel to operate on. Single channel only. */
 
 #define APP_TIMER_PRESCALER        	(0)                                 /**< Value of the RTC1 PRESCALER register. */
-#define APP_TIMER_MAX_TIMERS       	(12 + BSP_APP_TIMERS_NUMBER)      	/**< Maximum number of simultaneously created timers. */
+#define APP_TIMER_MAX_TIMERS       	(2 + BSP_APP_TIMERS_NUMBER)      	/**< Maximum number of simultaneously created timers, one drives the task table and one the watchdog supervisor. */
 #define APP_TIMER_OP_QUEUE_SIZE    	(4)                                 /**< Size of timer operation queues. */
 
-#define HEARTBEAT_INTERVAL      APP_TIMER_TICKS(130, APP_TIMER_PRESCALER) 	/**< led1 heartbeat interval (ticks). */
-#define RELAY_INTERVAL      	APP_TIMER_TICKS(90, APP_TIMER_PRESCALER) 	/**< RELAY interval (ticks). */
-#define COMMUNICATE_INTERVAL    APP_TIMER_TICKS(50, APP_TIMER_PRESCALER) 	/**< communicate led interval (ticks). */
-#define MOTION_SOUND_INTERVAL   APP_TIMER_TICKS(3760, APP_TIMER_PRESCALER) 	/**< SOUND&MOTION led interval (ticks). */
-/* a man breath rates 16-20 per minute, T = 3s - 3.75s, step length 40, so interval 75-93 */
-#define PWM_UPDATE_INTERVAL     APP_TIMER_TICKS(85, APP_TIMER_PRESCALER) 	
-#define PIR_MES_INTERVAL    	APP_TIMER_TICKS(180, APP_TIMER_PRESCALER) 	/**< sound measure interval (ticks). */
-#define SOUND_MES_INTERVAL    	APP_TIMER_TICKS(12, APP_TIMER_PRESCALER) 	/**< sound measure interval (ticks). */
-#define LIGHT_MES_INTERVAL    	APP_TIMER_TICKS(540, APP_TIMER_PRESCALER) 	/**< light sonsor measure interval (ticks). */
-#define TEMP_MES_INTERVAL    	APP_TIMER_TICKS(620, APP_TIMER_PRESCALER) 	/**< temperature measure interval (ticks). */
-#define WATCHDOG_INTERVAL    	APP_TIMER_TICKS(505, APP_TIMER_PRESCALER) 	/**< watchdog interval (ticks). */
-#define KEY_PERIOD_HANG_SENSOR	APP_TIMER_TICKS(3009, APP_TIMER_PRESCALER)  /**< detect key hang motion and sound interval (ticks). */
-#define TRIGGER_INTERVAL		APP_TIMER_TICKS(300000, APP_TIMER_PRESCALER)  /**< TRIGGER THEN DELAY OFF(ticks). */
+#define HEARTBEAT_INTERVAL      TASK_TICKS(130) 	/**< led1 heartbeat interval (task ticks). */
+#define RELAY_INTERVAL      	TASK_TICKS(90) 	/**< RELAY interval (task ticks). */
+#define COMMUNICATE_INTERVAL    TASK_TICKS(50) 	/**< communicate led interval (task ticks). */
+#ifdef BSP_LED_ENGINE
+#if defined(BREATH_LED) && (BSP_LED_ENGINE_TIMER == 1)
+#error "The breathing light PWM and the LED engine both use TIMER1"
+#endif
+/* the engine turns each blink off in hardware, so the heartbeat task only runs once per beat */
+#define HEARTBEAT_TASK_INTERVAL (HEARTBEAT_INTERVAL * (HEARTBEAT_EVENT_ON + HEARTBEAT_EVENT_OFF + 2)) /**< heartbeat period (task ticks). */
+#define HEARTBEAT_ON_MS         (130 * (HEARTBEAT_EVENT_ON + 1))	/**< heartbeat led on time (ms). */
+#define COMMUNICATE_ON_MS       (50)				/**< communicate led on time (ms). */
+#define INDICATOR_LED_SET(ON)   bsp_led_engine_set(ON)
+#else
+#define HEARTBEAT_TASK_INTERVAL HEARTBEAT_INTERVAL
+#define INDICATOR_LED_SET(ON)   nrf_gpio_pin_write(BSP_LED_1, (ON))
+#endif
+#define MOTION_SOUND_INTERVAL   TASK_TICKS(3760) 	/**< SOUND&MOTION led interval (task ticks). */
+/* a man breath rates 16-20 per minute, T = 3s - 3.75s, 64 steps of 11 PWM periods of 5 ms give 3.5s */
+#define BREATH_STEPS            (64)                /**< Steps in one breath of the breathing light. */
+#define BREATH_PERIODS_PER_STEP (11)                /**< PWM periods each breath step is held. */
+#define BREATH_CHANNEL_MASK     (0x03)              /**< Both PWM channels breathe. */
+#define PIR_MES_INTERVAL    	TASK_TICKS(180) 	/**< PIR event check interval (task ticks). */
+#define SOUND_MES_INTERVAL    	TASK_TICKS(40) 	/**< ADC scan frame processing interval, must be shorter than the ADC_SCAN_FRAME_COUNT frames (task ticks). */
+#define LIGHT_MES_INTERVAL    	TASK_TICKS(540) 	/**< light sonsor measure interval (task ticks). */
+#define TEMP_MES_INTERVAL    	TASK_TICKS(620) 	/**< temperature measure interval (task ticks). */
+#define ADC_SCAN_INTERVAL_US    (8000)                                         /**< Time between each scan of the sensor inputs (us). */
+#define SOUND_DETECT_ON_LEVEL   (400)               /**< Sound RMS that starts a sound event (ADC units). */
+#define SOUND_DETECT_OFF_LEVEL  (340)               /**< Sound RMS the sound must fall below to end a sound event (ADC units). */
+#define SOUND_DETECT_HOLD_US    (250000)            /**< Time the sound must stay below the off level to end a sound event (us). */
+#define PIR_DETECT_ON_LEVEL     (200)               /**< PIR RMS that starts a motion event, the PIR output falls on motion (ADC units). */
+#define PIR_DETECT_OFF_LEVEL    (260)               /**< PIR RMS the PIR output must rise above to end a motion event (ADC units). */
+#define PIR_DETECT_HOLD_US      (1000000)           /**< Time the PIR output must stay above the off level to end a motion event (us). */
+#ifdef SENSOR_WAKE
+#define SENSOR_WAKE_INTERVAL    TASK_TICKS(1000)    /**< Sensor wake tick interval (task ticks). */
+#define SENSOR_WAKE_IDLE_TICKS  (30)                /**< Sensor wake ticks without motion or sound before the ADC scans are paused. */
+#define SENSOR_WAKE_REFRESH_TICKS (10)              /**< Sensor wake ticks between each refresh of the light and temperature samples while idle. */
+#define SENSOR_WAKE_INPUT       NRF_LPCOMP_INPUT_4  /**< The PIR input, the same analog input as ADC_SCAN_INPUT_PIR. */
+#define SENSOR_WAKE_REFERENCE   NRF_LPCOMP_REF_SUPPLY_TWO_EIGHT /**< Just above the ADC motion threshold at a 3V supply. */
+#endif
+#define TEMP_CAL_UICR_INDEX     (0)                                            /**< UICR customer register holding the temperature sensor calibration. */
+#define LIGHT_CAL_UICR_INDEX    (1)                                            /**< UICR customer register holding the light sensor calibration. */
+#define FAHRENHEIT_SCALE_Q16    (117965)                                       /**< 9/5 in 16.16 fixed point. */
+
+#define LIGHT_MESH_HANDLE          (2)                                         /**< Mesh handle the light sensor level is published on. */
+#define LIGHT_PUBLISH_DEADBAND     (5)                                         /**< Smallest light level change worth publishing (lux). */
+#define LIGHT_PUBLISH_MIN_INTERVAL APP_TIMER_TICKS(5000, APP_TIMER_PRESCALER)  /**< Shortest time between light level publishes (ticks). */
+#define LIGHT_PUBLISH_MAX_INTERVAL APP_TIMER_TICKS(120000, APP_TIMER_PRESCALER) /**< Longest time between light level publishes (ticks). */
+#define TEMP_MESH_HANDLE           (3)                                         /**< Mesh handle the temperature is published on. */
+#define TEMP_PUBLISH_DEADBAND      (5)                                         /**< Smallest temperature change worth publishing (0.1 degrees). */
+#define TEMP_PUBLISH_MIN_INTERVAL  APP_TIMER_TICKS(10000, APP_TIMER_PRESCALER) /**< Shortest time between temperature publishes (ticks). */
+#define TEMP_PUBLISH_MAX_INTERVAL  APP_TIMER_TICKS(120000, APP_TIMER_PRESCALER) /**< Longest time between temperature publishes (ticks). */
+#define SUPERVISOR_PERIOD          APP_TIMER_TICKS(500, APP_TIMER_PRESCALER) /**< Period of the subsystem health checks, shorter than the WDT reload value (ticks). */
+#define SUPERVISOR_TIMEOUT_PERIODS (3)                                       /**< Health checks a subsystem may miss before the WDT is no longer fed. */
+#define KEY_PERIOD_HANG_SENSOR	TASK_TICKS(3009)  /**< detect key hang motion and sound interval (task ticks). */
+#define TRIGGER_INTERVAL		TASK_TICKS(300000)  /**< TRIGGER THEN DELAY OFF(task ticks). */
+#define PWM_APPLY_INTERVAL      TASK_TICKS(12)      /**< Retry interval for PWM changes the PWM wasn't ready for (task ticks). */
+
+#ifndef TOUCH_FAST_ACTUATION
+#define TOUCH_FAST_ACTUATION    (1)                 /**< Switch the relay from the touch key GPIOTE interrupt instead of the BSP button events. */
+#endif
+#define TOUCH_DEBOUNCE_INTERVAL APP_TIMER_TICKS(150, APP_TIMER_PRESCALER) /**< Touches closer than this to the previous one are ignored (ticks). */
+#define RELAY_MESH_HANDLE       (4)                 /**< Mesh handle the relay state is published on. */
+#define GATT_START_TIMEOUT      APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER) /**< Longest wait for the first mesh event before the GATT side is started anyway (ticks). */
+#ifdef BUTTONS
+#define MESH_BUTTON_COUNT           (BUTTON_STOP - BUTTON_START + 1)                  /**< Number of DK buttons setting the LED values on the mesh. */
+#define MESH_BUTTON_DETECTION_DELAY APP_TIMER_TICKS(50, APP_TIMER_PRESCALER)          /**< Debounce delay of the DK buttons (ticks). */
+#endif
 
 /**@brief Timer status. */
 typedef enum
@@ -109,39 +193,65 @@ typedef enum
 	APP_TIMER_START                 /**< The timer already started. */
 } app_timer_status_t;
 
-static app_timer_id_t           m_heartbeat_timer_id;         /**< heartbeat timer. */
+static task_id_t                m_heartbeat_timer_id;         /**< heartbeat timer. */
 static app_timer_status_t		s_heartbeat_timer;			  /**< status of heartbeat timer. */	
 #ifdef RELAY_LATCH
-static app_timer_id_t           m_relay_timer_id;             /**< relay execute timer. */
+static task_id_t                m_relay_timer_id;             /**< relay execute timer. */
 static app_timer_status_t		s_relay_timer;				  /**< status of relay execute timer. */
 #endif
-static app_timer_id_t           m_communicate_timer_id;       /**< led communicate timer. */
+#ifndef BSP_LED_ENGINE
+static task_id_t                m_communicate_timer_id;       /**< led communicate timer. */
+#endif
 static app_timer_status_t		s_communicate_timer;		  /**< status of led communicate timer. */
-static app_timer_id_t           m_motion_sound_timer_id;      /**< motion and sound event timer. */
+static task_id_t                m_motion_sound_timer_id;      /**< motion and sound event timer. */
 static app_timer_status_t		s_motion_sound_timer;		  /**< status of motion and sound event timer. */
-#ifdef BREATH_LED
-static app_timer_id_t           m_pwm_update_timer_id;        /**< PWM update timer. */
-static app_timer_status_t		s_pwm_update_timer;			  /**< status of PWM update timer. */
-#endif
-static app_timer_id_t           m_pir_mes_timer_id;           /**< PIR measure timer. */
+static task_id_t                m_pir_mes_timer_id;           /**< PIR measure timer. */
 static app_timer_status_t		s_pir_mes_timer;			  /**< status of PIR measure timer. */
-static app_timer_id_t           m_sound_mes_timer_id;         /**< sound measure timer. */
+static task_id_t                m_sound_mes_timer_id;         /**< sound measure timer. */
 static app_timer_status_t		s_sound_mes_timer;			  /**< status of sound measure timer. */
-static app_timer_id_t           m_light_mes_timer_id;         /**< light sensor measure timer. */
+static task_id_t                m_light_mes_timer_id;         /**< light sensor measure timer. */
 static app_timer_status_t		s_light_mes_timer; 			  /**< status of light sensor measure timer. */
-static app_timer_id_t           m_temp_mes_timer_id;          /**< temperature measure timer. */
+static task_id_t                m_temp_mes_timer_id;          /**< temperature measure timer. */
 static app_timer_status_t		s_temp_mes_timer;			  /**< status of temperature measure timer. */
-static app_timer_id_t           m_watchdog_timer_id;          /**< watchdog timer. */
-static app_timer_status_t		s_watchdog_timer; 			  /**< status of watchdog timer. */
-static app_timer_id_t           m_hang_on_timer_id;           /**< hang on sound & pir timer. */
+static task_id_t                m_hang_on_timer_id;           /**< hang on sound & pir timer. */
 static app_timer_status_t		s_hang_on_timer;			  /**< status of hang on sound & pir timer. */
-static app_timer_id_t           m_trigger_timer_id; 		  /**< darkness occpuy sensor trigger timer. */	
+static task_id_t                m_trigger_timer_id; 		  /**< darkness occpuy sensor trigger timer. */	
 static app_timer_status_t		s_trigger_timer;  			  /**< status of trigger timer. */
+#ifdef SENSOR_WAKE
+static task_id_t                m_sensor_wake_timer_id;       /**< Sensor wake tick timer. */
+#endif
+#ifdef BREATH_LED
+static task_id_t                m_pwm_apply_timer_id;         /**< PWM change retry timer. */
+static volatile uint32_t        m_pwm_target;                 /**< Duty cycle to apply by the retry timer. */
+static uint16_t                 m_breath_on_table[BREATH_STEPS];  /**< Breath from full brightness, in PWM ticks. */
+static uint16_t                 m_breath_off_table[BREATH_STEPS]; /**< Breath from darkness, in PWM ticks. */
+#endif
+static volatile bool            m_relay_publish_pending;      /**< The relay state has changed, and should be published on the mesh. */
+#if TOUCH_FAST_ACTUATION && !defined(BUTTONS)
+static uint32_t                 m_last_touch_ticks;           /**< app_timer counter at the last accepted touch. */
+#endif
+#ifdef BUTTONS
+static volatile uint32_t        m_button_publish_pending;     /**< One bit per DK button pushed, whose LED value should be published on the mesh. */
+#endif
 
 static ble_temp_t               m_temp;     /**< Structure used to identify the battery service. */
 static ble_light_t              m_light;
+static volatile bool            m_gatt_started;   /**< The services are registered, and the gateway advertises. */
 static volatile bool ready_flag;            /* A flag indicating PWM status. */
-volatile int32_t adc_sample[4];
+/* Sensor inputs, in the order they're scanned */
+#define ADC_SCAN_INPUT_SOUND    (0)
+#define ADC_SCAN_INPUT_LIGHT    (1)
+#define ADC_SCAN_INPUT_PIR      (2)
+#define ADC_SCAN_INPUT_TEMP     (3)
+#define ADC_SCAN_INPUT_COUNT    (4)
+static const nrf_adc_config_input_t m_adc_scan_inputs[ADC_SCAN_INPUT_COUNT] =
+{
+	NRF_ADC_CONFIG_INPUT_2,
+	NRF_ADC_CONFIG_INPUT_3,
+	NRF_ADC_CONFIG_INPUT_4,
+	NRF_ADC_CONFIG_INPUT_5
+};
+volatile int32_t adc_sample[ADC_SCAN_INPUT_COUNT];
 volatile int32_t PIR_Buffer[2];
 volatile int32_t sound_sample = 0;
 volatile uint32_t light_sample = 0;
@@ -152,18 +262,22 @@ volatile int16_t calibration_temperature = 0;
 
 static  uint8_t  pir_triggle_mode = 0;
 led_event_t			 led_event;
-pwm_enevt_t			 pwm_event;
 uint8_t 			 relay_status = 0;
-nrf_drv_wdt_channel_id m_channel_id;		//wdt
+static app_supervisor_id_t      m_main_loop_supervisor_id;    /**< Supervisor check in of the main loop, which runs the mesh event queue. */
+static uint32_t                 m_timeslot_count;             /**< Mesh timeslots started at the last supervisor check. */
+static uint32_t                 m_adc_frame_count;            /**< ADC scans completed at the last supervisor check. */
 void update_led_event(led_event_e led_event_type);
 void relay_on(void);
 void relay_off(void);
 
-uint16_t const ntc_table_10K[20] =	
-{
-	25,	39,	61,	83,	102, 113, 112, 101,	85,
-	67,	51,	38,	28,	21,	15,	11,	8, 6, 5, 19
-};
+static sensor_curve_t m_temp_curve;
+static int32_t m_temp_curve_slopes[SENSOR_CURVE_NTC_10K_POINTS - 1];
+static sensor_curve_t m_light_curve;
+static int32_t m_light_curve_slopes[SENSOR_CURVE_TPS851_POINTS - 1];
+static sensor_publish_t m_light_publish;
+static sensor_publish_t m_temp_publish;
+static envelope_detect_t m_sound_detect;
+static envelope_detect_t m_pir_detect;
 
 uint16_t const lightsensor_table_tps851[27] =	
 {
@@ -178,15 +292,30 @@ uint16_t const lightsensor_table_tps851[27] =
 APP_PWM_INSTANCE(PWM1,1);                   // Create the instance "PWM1" using TIMER1.
 
 
+/* Boards without a 32 kHz crystal are built with MESH_CLOCK_RC. The
+   Softdevice checks the temperature every 4 s, and recalibrates the RC
+   oscillator when it has changed. The timeslot module measures the remaining
+   drift against the HF crystal to size its timing margins. */
 #if NORDIC_SDK_VERSION >= 11
 nrf_nvic_state_t nrf_nvic_state = {0};
+#ifdef MESH_CLOCK_RC
+static nrf_clock_lf_cfg_t m_clock_cfg = 
+{
+    .source = NRF_CLOCK_LF_SRC_RC,
+    .rc_ctiv = 16,          /* temperature checked every 16 * 0.25 s */
+    .rc_temp_ctiv = 2       /* calibrated at least every 2nd check */
+};
+#else
 static nrf_clock_lf_cfg_t m_clock_cfg = 
 {
     .source = NRF_CLOCK_LF_SRC_XTAL,    
     .xtal_accuracy = NRF_CLOCK_LF_XTAL_ACCURACY_75_PPM
 };
+#endif
 
 #define MESH_CLOCK_SOURCE       (m_clock_cfg)    /**< Clock source used by the Softdevice. For calibrating timeslot time. */
+#elif defined(MESH_CLOCK_RC)
+#define MESH_CLOCK_SOURCE       (NRF_CLOCK_LFCLKSRC_RC_250_PPM_TEMP_4000MS_CALIBRATION)    /**< Clock source used by the Softdevice. For calibrating timeslot time. */
 #else
 #define MESH_CLOCK_SOURCE       (NRF_CLOCK_LFCLKSRC_XTAL_75_PPM)    /**< Clock source used by the Softdevice. For calibrating timeslot time. */
 #endif
@@ -216,74 +345,49 @@ static void trigger_handler(void * p_context)
 void shut_pir_sound_timer(void)
 {
 	uint32_t err_code;	
-	err_code = app_timer_stop(m_pir_mes_timer_id);
+	err_code = task_stop(m_pir_mes_timer_id);
 	APP_ERROR_CHECK(err_code);	
-	err_code = app_timer_stop(m_sound_mes_timer_id);
+	err_code = task_stop(m_sound_mes_timer_id);
 	APP_ERROR_CHECK(err_code);	
 }
 	
 void open_pir_sound_timer(void)
 {
     uint32_t err_code;
-	err_code = app_timer_start(m_pir_mes_timer_id, PIR_MES_INTERVAL, NULL);				
+	/* the frames scanned while the timers were stopped are lost, start over */
+	envelope_detect_reset(&m_sound_detect);
+	envelope_detect_reset(&m_pir_detect);
+	err_code = task_start(m_pir_mes_timer_id, PIR_MES_INTERVAL, NULL);				
     APP_ERROR_CHECK(err_code);	
-    err_code = app_timer_start(m_sound_mes_timer_id, SOUND_MES_INTERVAL, NULL);			
+    err_code = task_start(m_sound_mes_timer_id, SOUND_MES_INTERVAL, NULL);			
     APP_ERROR_CHECK(err_code);	
 }
 #ifdef BREATH_LED
-void update_pwm_value(uint32_t value)	
-{	
-	while (app_pwm_channel_duty_set(&PWM1, 0, value) == NRF_ERROR_BUSY);
-	while (app_pwm_channel_duty_set(&PWM1, 1, value) == NRF_ERROR_BUSY);	
-}
-#endif
-int16_t look_up_table(int16_t adc)
-{                                        
-    int16_t val, work_var;
-    int16_t index = 19;
-       
-    work_var = ntc_table_10K[index]; 
-    if(work_var > adc)
-    {
-        val = (index - 4) * 100; // >= max range, so use the last point of array
-        return ((int16_t)val);                                                         
-    }                         
-    do                        
+/* Set both PWM channels without waiting for the PWM to get ready, safe to call
+   from interrupts that the PWM timer interrupt can't preempt. Changes the PWM
+   isn't ready for are retried from the task table. */
+static void pwm_apply_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+    if (app_pwm_channel_duty_set(&PWM1, 0, m_pwm_target) == NRF_ERROR_BUSY ||
+        app_pwm_channel_duty_set(&PWM1, 1, m_pwm_target) == NRF_ERROR_BUSY)
     {
-        index--;
-        work_var += ntc_table_10K[index];    //check which range match current value:L14 + (L13 - L14) + (L12-L13) + ... + [L (x - 1) - Lx] + [Lx - L (x + 1) ] = L (x + 1)
-        if(work_var > adc)    //can check relative document in : Z:\Designs\Temperature\Curves\ThermistorCurves_VoltageCalcs.xls
-        {
-            val = (work_var - adc) * 100;    //get the difference value between current value and nearest default point
-            val /= ntc_table_10K[index];
-            if(index >= 4)
-            {
-                val += ((index - 4) * 100);    //get nearest temperature point value
-                val &= 0x7fff;
-            }
-            else
-            {
-                val += index * 100;
-                val = 400 - val;
-                val |= 0x8000;
-            }                     
-            return ((int16_t)val);        
-        }                 
-    } while(index);                                                                      
-
-//	val = index * 100; 
-	val = 400 | 0x8000;
-    return ((int16_t)val);  
+        APP_ERROR_CHECK(task_start(m_pwm_apply_timer_id, PWM_APPLY_INTERVAL, NULL));
+    }
 }
 
+void request_pwm_value(uint32_t value)
+{
+    m_pwm_target = value;
+    pwm_apply_handler(NULL);
+}
+#endif
 int16_t update_temperature(int16_t adc, _Bool c)
 {
-	int16_t deg_temp = (int16_t)(look_up_table(adc));
-	if(deg_temp & 0x8000) // minus temperature
-		deg_temp = -(signed int)(deg_temp & 0x7fff);
+	int16_t deg_temp = (int16_t) sensor_curve_convert(&m_temp_curve, adc);
 	
 	temp_centigrade = deg_temp + calibration_temperature;
-	temp_fahrenheit = temp_centigrade * 9 / 5 + 320;
+	temp_fahrenheit = ((temp_centigrade * FAHRENHEIT_SCALE_Q16) >> 16) + 320;
 
 //	if((output_auto_manual & 0x01) == 0x01)
 //		temp_centigrade = output_manual_value_temp;
@@ -299,14 +403,6 @@ int16_t update_temperature(int16_t adc, _Bool c)
 void wdt_event_handler(void)
 {
     LEDS_OFF(LEDS_MASK);
- 
-#if 1	
-	for(uint8_t i= 0; i <= 20; i++)
-	{
-		nrf_delay_ms(50);
-		nrf_gpio_pin_toggle(BSP_LED_0);
-	}	
-#endif	
     //NOTE: The max amount of time we can spend in WDT interrupt is two cycles of 32768[Hz] clock - after that, reset occurs
 }
 /**
@@ -314,29 +410,84 @@ void wdt_event_handler(void)
  */
 void get_channel_adc(void)
 {
-		adc_sample[0] = nrf_adc_convert_single(NRF_ADC_CONFIG_INPUT_2);	
-		adc_sample[1] = nrf_adc_convert_single(NRF_ADC_CONFIG_INPUT_3);	
-		adc_sample[2] = nrf_adc_convert_single(NRF_ADC_CONFIG_INPUT_4);
-		adc_sample[3] = nrf_adc_convert_single(NRF_ADC_CONFIG_INPUT_5);	
+		int32_t sample;
+		for (uint8_t i = 0; i < ADC_SCAN_INPUT_COUNT; i++)
+		{
+			if (adc_scan_sample_get(i, &sample) == NRF_SUCCESS)
+			{
+				adc_sample[i] = sample;
+			}
+		}
 
 //#ifdef DEBUG_LOG_RTT									
 //		SEGGER_RTT_printf(0, "adc:%4d,%4d,%4d,%4d \r\n",(uint16_t)adc_sample[0],(uint16_t)adc_sample[1],(uint16_t)adc_sample[2],(uint16_t)adc_sample[3]);		
 //#endif		
 }	
 	
+#ifdef SENSOR_WAKE
+/**@brief Function for handling a wake up of the ADC scans by the PIR input.
+ */
+static void sensor_wake_handler(void)
+{
+#ifdef DEBUG_LOG_RTT
+	DEBUG_LOG("SENSOR_WAKE\r\n");
+#endif
+}
+
+/**@brief Function for handling the sensor wake timer timeout.
+ *
+ * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
+ *                       app_start_timer() call to the timeout handler.
+ */
+static void sensor_wake_timeout_handler(void * p_context)
+{
+	UNUSED_PARAMETER(p_context);
+	sensor_wake_tick();
+}
+#endif
+
 /**
  * @brief ADC initialization.
  */
 void adc_config(void)
 {
-    const nrf_adc_config_t nrf_adc_config = NRF_ADC_CONFIG_DEFAULT;
-
-// 	Initialize and configure ADC
-    nrf_adc_configure( (nrf_adc_config_t *)&nrf_adc_config);
-//    nrf_adc_input_select(NRF_ADC_CONFIG_INPUT_4);
-//    nrf_adc_int_enable(ADC_INTENSET_END_Enabled << ADC_INTENSET_END_Pos);
-//    NVIC_SetPriority(ADC_IRQn, NRF_APP_PRIORITY_HIGH);
-//    NVIC_EnableIRQ(ADC_IRQn);
+    uint32_t err_code;
+
+    sensor_curve_init(&m_temp_curve, g_sensor_curve_ntc_10k, m_temp_curve_slopes, SENSOR_CURVE_NTC_10K_POINTS);
+    sensor_curve_calibration_load(&m_temp_curve, TEMP_CAL_UICR_INDEX);
+    sensor_curve_init(&m_light_curve, g_sensor_curve_tps851, m_light_curve_slopes, SENSOR_CURVE_TPS851_POINTS);
+    sensor_curve_calibration_load(&m_light_curve, LIGHT_CAL_UICR_INDEX);
+
+    /* both follow their input over a couple of frame blocks, the PIR output falls on motion */
+    envelope_detect_config_t detect_config;
+    detect_config.baseline_shift = 0;
+    detect_config.window_shift = 1;
+    detect_config.falling = false;
+    detect_config.on_level = SOUND_DETECT_ON_LEVEL;
+    detect_config.off_level = SOUND_DETECT_OFF_LEVEL;
+    detect_config.hold_samples = SOUND_DETECT_HOLD_US / ADC_SCAN_INTERVAL_US;
+    envelope_detect_init(&m_sound_detect, &detect_config);
+    detect_config.falling = true;
+    detect_config.on_level = PIR_DETECT_ON_LEVEL;
+    detect_config.off_level = PIR_DETECT_OFF_LEVEL;
+    detect_config.hold_samples = PIR_DETECT_HOLD_US / ADC_SCAN_INTERVAL_US;
+    envelope_detect_init(&m_pir_detect, &detect_config);
+
+// 	Sample all sensors in the background, the handlers only pick up the results
+    err_code = adc_scan_init(m_adc_scan_inputs, ADC_SCAN_INPUT_COUNT, ADC_SCAN_INTERVAL_US);
+    APP_ERROR_CHECK(err_code);
+
+#ifdef SENSOR_WAKE
+    /* a falling PIR output wakes the scans while the room is quiet */
+    sensor_wake_config_t wake_config;
+    wake_config.input = SENSOR_WAKE_INPUT;
+    wake_config.reference = SENSOR_WAKE_REFERENCE;
+    wake_config.detection = NRF_LPCOMP_DETECT_DOWN;
+    wake_config.idle_ticks = SENSOR_WAKE_IDLE_TICKS;
+    wake_config.refresh_ticks = SENSOR_WAKE_REFRESH_TICKS;
+    err_code = sensor_wake_init(&wake_config, sensor_wake_handler);
+    APP_ERROR_CHECK(err_code);
+#endif
 }
 #ifdef BREATH_LED
 void pwm_ready_callback(uint32_t pwm_id)    // PWM callback function
@@ -390,24 +541,33 @@ void relay_idle(void)
 
 void led_communicate_blink(led_event_e led_event_type)
 {
+#ifdef BSP_LED_ENGINE
+	/* the heartbeat is only a short pulse every few seconds, and carries on */
+	UNUSED_PARAMETER(led_event_type);
+	uint32_t err_code = bsp_led_engine_pulse(COMMUNICATE_ON_MS);
+	APP_ERROR_CHECK(err_code);	
+#else
 	//UNUSED_PARAMETER(led_event_type);
 	update_led_event(led_event_type);
 	
-	nrf_gpio_pin_set(BSP_LED_1);
-	uint32_t err_code = app_timer_start(m_communicate_timer_id, COMMUNICATE_INTERVAL, NULL);
+	INDICATOR_LED_SET(true);
+	uint32_t err_code = task_start(m_communicate_timer_id, COMMUNICATE_INTERVAL, NULL);
 	APP_ERROR_CHECK(err_code);	
+#endif
 }
 void motion_sound_event_set(led_event_e led_event_type)
 {
 	update_led_event(led_event_type);
-	nrf_gpio_pin_set(BSP_LED_1);	
+	INDICATOR_LED_SET(true);	
 	
-	uint32_t err_code = app_timer_start(m_motion_sound_timer_id, MOTION_SOUND_INTERVAL, NULL);
+	uint32_t err_code = task_start(m_motion_sound_timer_id, MOTION_SOUND_INTERVAL, NULL);
 	APP_ERROR_CHECK(err_code);	
 
 #ifdef BREATH_LED	
-	memset(&pwm_event,0,sizeof(pwm_event));
-	err_code = app_timer_start(m_pwm_update_timer_id, PWM_UPDATE_INTERVAL, &pwm_event);
+	/* the breath is run by the PWM interrupt, a touch stops it */
+	err_code = app_pwm_ramp_start(&PWM1, BREATH_CHANNEL_MASK,
+			relay_status ? m_breath_on_table : m_breath_off_table,
+			BREATH_STEPS, BREATH_PERIODS_PER_STEP, NULL);
 	APP_ERROR_CHECK(err_code);	
 #endif	
 }
@@ -454,6 +614,13 @@ static void led_heartbeat_handler(void * p_context)
 {
     UNUSED_PARAMETER(p_context);		
 		
+#ifdef BSP_LED_ENGINE
+	if(led_event.event_type == HEARTBEAT_EVENT)
+	{
+		uint32_t err_code = bsp_led_engine_pulse(HEARTBEAT_ON_MS);
+		APP_ERROR_CHECK(err_code);
+	}
+#else
 	if((led_event.event_type == SOUND_EVENT) || (led_event.event_type == MOTION_EVENT))
 	{
 
@@ -466,7 +633,7 @@ static void led_heartbeat_handler(void * p_context)
 		{
 			if(!led_event.on_time--)
 			{					
-				nrf_gpio_pin_clear(BSP_LED_1);
+				INDICATOR_LED_SET(false);
 				led_event.status = false;
 				led_event.off_time = (uint16_t)HEARTBEAT_EVENT_OFF; 
 				led_event.on_time = (uint16_t)HEARTBEAT_EVENT_ON; 
@@ -475,7 +642,7 @@ static void led_heartbeat_handler(void * p_context)
 		{
 			if(!led_event.off_time--)
 			{			
-				nrf_gpio_pin_set(BSP_LED_1);
+				INDICATOR_LED_SET(true);
 				led_event.status = true;
 				led_event.on_time = (uint16_t)HEARTBEAT_EVENT_ON;
 				led_event.off_time = (uint16_t)HEARTBEAT_EVENT_OFF; 		
@@ -488,22 +655,9 @@ static void led_heartbeat_handler(void * p_context)
 	{
 		
 	}
+#endif
 		
 }
-/**@brief Function for handling the watchdog timer timeout.
- *
- * @details This function will be called each time the watchdog timer expires.
- *
- * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
- *                       app_start_timer() call to the timeout handler.
- */
-static void watch_dog_handler(void * p_context)
-{
-	UNUSED_PARAMETER(p_context);	
-	nrf_drv_wdt_channel_feed(m_channel_id);	//feed the dog
-}
-
-
 /**@brief Function for handling the relay execute timer timeout.
  *
  * @details This function will be called each time relay execute timer expires.
@@ -530,7 +684,7 @@ static void led_off_handler(void * p_context)
     uint32_t err_code;
 	
 	UNUSED_PARAMETER(p_context);		
-    nrf_gpio_pin_clear(BSP_LED_1);	
+    INDICATOR_LED_SET(false);	
 	//update_led_event(HEARTBEAT_EVENT);
 	
 	led_event.status = false;
@@ -538,9 +692,9 @@ static void led_off_handler(void * p_context)
 	led_event.off_time = HEARTBEAT_EVENT_OFF - 40;			//queick start blink ASAP.
 	led_event.on_time = HEARTBEAT_EVENT_ON;		
 	
-    err_code = app_timer_start(m_pir_mes_timer_id, PIR_MES_INTERVAL, NULL);				
+    err_code = task_start(m_pir_mes_timer_id, PIR_MES_INTERVAL, NULL);				
     APP_ERROR_CHECK(err_code);	
-    err_code = app_timer_start(m_sound_mes_timer_id, SOUND_MES_INTERVAL, NULL);			
+    err_code = task_start(m_sound_mes_timer_id, SOUND_MES_INTERVAL, NULL);			
     APP_ERROR_CHECK(err_code);	
 }
 /**@brief Function for handling the led communicate timer timeout.
@@ -550,12 +704,14 @@ static void led_off_handler(void * p_context)
  * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
  *                       app_start_timer() call to the timeout handler.
  */
+#ifndef BSP_LED_ENGINE
 static void blink_off_handler(void * p_context)
 {	
 	UNUSED_PARAMETER(p_context);		
-    nrf_gpio_pin_clear(BSP_LED_1);	
+    INDICATOR_LED_SET(false);	
 	update_led_event(HEARTBEAT_EVENT);			
 }
+#endif
 
 /**@brief Function for handling the pir&sound hang on timer timeout.
  *
@@ -572,55 +728,6 @@ static void hang_on_handler(void * p_context)
 	open_pir_sound_timer();
 	
 }
-#ifdef BREATH_LED
-/**@brief Function for handling the pwm update timer timeout.
- *
- * @details This function will be called each pem update timer expires.
- *
- * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
- *                       app_start_timer() call to the timeout handler.
- */
-static void pwm_update_handler(void * p_context)
-{
-    uint32_t		err_code;
-	uint32_t		value ;	
-	pwm_enevt_t	*	p_pe;     
-	
-	p_pe = (pwm_enevt_t*) p_context;
-	p_pe->loop++;		
-
-	if(p_pe->loop <= 40)
-	{										
-		//if(p_pe->tendency)
-		if(relay_status)
-		{									
-			value = (p_pe->loop < 20) ? (100 - p_pe->loop * 5) : (p_pe->loop * 5 - 100);	/* */	
-		}else
-		{			
-			value = (p_pe->loop < 20) ? (p_pe->loop * 5) : (100 - (p_pe->loop - 20) * 5);	/* */
-		}
-					
-		ready_flag = false;
-		/* Set the duty cycle - keep trying until PWM is ready... */
-		while (app_pwm_channel_duty_set(&PWM1, 0, value) == NRF_ERROR_BUSY);
-		;
-		while (app_pwm_channel_duty_set(&PWM1, 1, value) == NRF_ERROR_BUSY);
-		;
-		/* ... or wait for callback. */
-		//while(!ready_flag);
-		//APP_ERROR_CHECK(app_pwm_channel_duty_set(&PWM1, 1, value));
-
-//#ifdef DEBUG_LOG_RTT
-//		SEGGER_RTT_printf(0, "pwm_update %d,%d.\r\n",(uint8_t)p_pe->loop,(uint16_t)value);
-//#endif					
-		
-	}else
-	{
-		err_code = app_timer_stop(m_pwm_update_timer_id);
-		APP_ERROR_CHECK(err_code);			
-	}			
-}
-#endif
 /**@brief Function for handling the PIR update timer timeout.
  *
  * @details This function will be called each PIR update timer expires.
@@ -633,17 +740,20 @@ static void pir_event_handler(void * p_context)
 	uint32_t err_code;
 	
 	UNUSED_PARAMETER(p_context);	
-	//PIR_Buffer[0] = PIR_Buffer[1];
 	
-	PIR_Buffer[1] = nrf_adc_convert_single(NRF_ADC_CONFIG_INPUT_4);	
+	/* the PIR detector is fed with the scan frames by the sound handler */
+	PIR_Buffer[1] = m_pir_detect.rms;
 	
-	if(PIR_Buffer[1] < 200) 
+	if (envelope_detect_is_active(&m_pir_detect))
 	{
 		update_led_event(MOTION_EVENT);
 		motion_sound_event_set(MOTION_EVENT);
+#ifdef SENSOR_WAKE
+		sensor_wake_activity();
+#endif
 				
 #ifdef DEBUG_LOG_RTT
-		SEGGER_RTT_printf(0, "MOTION_EVENT %2d\r\n",(uint16_t)PIR_Buffer[1]);															
+		DEBUG_LOG("MOTION_EVENT %2d\r\n",(uint16_t)PIR_Buffer[1]);															
 #endif	
 		if((light_sample < 10)&&(!pir_triggle_mode)) /* NO Enter */
 		{
@@ -655,11 +765,11 @@ static void pir_event_handler(void * p_context)
 			nrf_gpio_pin_set(LED_1);
 			nrf_gpio_pin_set(LED_3);			
 			
-			err_code = app_timer_start(m_trigger_timer_id, TRIGGER_INTERVAL, NULL);		/* TRIGGER OFF */
+			err_code = task_start(m_trigger_timer_id, TRIGGER_INTERVAL, NULL);		/* TRIGGER OFF */
 			APP_ERROR_CHECK(err_code);			
 
 #ifdef DEBUG_LOG_RTT
-		SEGGER_RTT_printf(0, "enter trigger mode.\r\n");															
+		DEBUG_LOG("enter trigger mode.\r\n");															
 #endif				
 			
 		}		
@@ -680,20 +790,36 @@ static void sound_event_handler(void * p_context)
 	
 	UNUSED_PARAMETER(p_context);	
 	
-	sound_sample = nrf_adc_convert_single(NRF_ADC_CONFIG_INPUT_2);	
+	/* hand every scan since the last time to the detectors, as one block each */
+	adc_scan_frame_t frame;
+	int16_t sound_block[ADC_SCAN_FRAME_COUNT];
+	int16_t pir_block[ADC_SCAN_FRAME_COUNT];
+	uint32_t count = 0;
+	while (count < ADC_SCAN_FRAME_COUNT && adc_scan_frame_pop(&frame) == NRF_SUCCESS)
+	{
+		sound_block[count] = frame.sample[ADC_SCAN_INPUT_SOUND];
+		pir_block[count] = frame.sample[ADC_SCAN_INPUT_PIR];
+		count++;
+	}
+	(void) envelope_detect_process(&m_pir_detect, pir_block, count);
+	envelope_detect_event_t sound_event = envelope_detect_process(&m_sound_detect, sound_block, count);
+	sound_sample = m_sound_detect.rms;
 	
-	if(sound_sample > 400) 
+	if (sound_event == ENVELOPE_DETECT_EVENT_START) 
 	{
 		update_led_event(SOUND_EVENT);
 		motion_sound_event_set(SOUND_EVENT);
+#ifdef SENSOR_WAKE
+		sensor_wake_activity();
+#endif
 		
 #ifdef DEBUG_LOG_RTT
-		SEGGER_RTT_printf(0, "SOUND_EVENT %2d\r\n",(uint16_t)sound_sample);															
+		DEBUG_LOG("SOUND_EVENT %2d\r\n",(uint16_t)sound_sample);															
 #endif	
 
-		err_code = app_timer_stop(m_pir_mes_timer_id);
+		err_code = task_stop(m_pir_mes_timer_id);
 		APP_ERROR_CHECK(err_code);	
-		err_code = app_timer_stop(m_sound_mes_timer_id);
+		err_code = task_stop(m_sound_mes_timer_id);
 		APP_ERROR_CHECK(err_code);		
 	}
 		
@@ -712,10 +838,24 @@ static void light_event_handler(void * p_context)
 	uint32_t err_code;
 	UNUSED_PARAMETER(p_context);	
 	
-	light_sample = (uint32_t) nrf_adc_convert_single(NRF_ADC_CONFIG_INPUT_3);		
-	light_sample *= 527;
-	light_sample /= 2000;		/* k = 1891 */
+	int32_t sample;
+	if (adc_scan_sample_get(ADC_SCAN_INPUT_LIGHT, &sample) != NRF_SUCCESS)
+	{
+		return;
+	}
+	light_sample = (uint32_t) sensor_curve_convert(&m_light_curve, sample);
 
+	/* the BLE service only hears about the values that go out on the mesh */
+	bool published;
+	if (sensor_publish_sample(&m_light_publish, (int32_t) light_sample, &published) != NRF_SUCCESS || !published)
+	{
+		return;
+	}
+
+	if (!m_gatt_started)
+	{
+		return;
+	}
 	err_code = ble_light_sensor_level_update(&m_light,(uint16_t)light_sample);
     if ((err_code != NRF_SUCCESS) &&
         (err_code != NRF_ERROR_INVALID_STATE) &&
@@ -727,7 +867,7 @@ static void light_event_handler(void * p_context)
     }	
 	
 #ifdef DEBUG_LOG_RTT	
-	SEGGER_RTT_printf(0, "LUX:%2d\r\n",(uint16_t)light_sample);															
+	DEBUG_LOG("LUX:%2d\r\n",(uint16_t)light_sample);															
 #endif		
 			
 }
@@ -741,10 +881,25 @@ static void light_event_handler(void * p_context)
 static void temperature_event_handler(void * p_context)
 {
 	uint32_t err_code;
+	int32_t sample;
 	
 	UNUSED_PARAMETER(p_context);				
-	temp_sample = update_temperature((int16_t)nrf_adc_convert_single(NRF_ADC_CONFIG_INPUT_5), true);
+	if (adc_scan_sample_get(ADC_SCAN_INPUT_TEMP, &sample) != NRF_SUCCESS)
+	{
+		return;
+	}
+	temp_sample = update_temperature((int16_t)sample, true);
+	
+	bool published;
+	if (sensor_publish_sample(&m_temp_publish, temp_sample, &published) != NRF_SUCCESS || !published)
+	{
+		return;
+	}
 	
+	if (!m_gatt_started)
+	{
+		return;
+	}
 	err_code = ble_temp_Temperature_level_update(&m_temp, (uint16_t)temp_sample);
     if ((err_code != NRF_SUCCESS) &&
         (err_code != NRF_ERROR_INVALID_STATE) &&
@@ -771,6 +926,10 @@ static void error_loop(void)
     led_config(3, 1);
     
     __disable_irq(); /* Prevent the mesh from continuing operation. */
+#ifdef MESH_FAULTLOG
+    /* the fault is committed to flash on the way back up */
+    NVIC_SystemReset();
+#endif
     while (true)
     {
         __WFE(); /* sleep */
@@ -788,6 +947,7 @@ void sd_assert_handler(uint32_t pc, uint16_t line_num, const uint8_t* p_file_nam
 #ifdef DEBUG_LOG_RTT
 		SEGGER_RTT_printf(0, "[sd_assert_handler],pc:%2d,line_num:%6d,file_name:%s.\r\n",(uint16_t)pc,(uint16_t)line_num,p_file_name);
 #endif    
+    (void) rbc_mesh_fault_capture(RBC_MESH_FAULT_TYPE_SD_ASSERT, 0, pc, 0, line_num);
 	error_loop();
 }
 
@@ -805,6 +965,8 @@ void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p
 	SEGGER_RTT_printf(0, "[app_error_handler],error_code: %d, line_num: %d, file_name:%s\r\n",(uint16_t)error_code,
 																	(uint16_t)line_num, p_file_name);
 #endif  
+    /* the gateway carries on, the fault is logged if the node resets before another one replaces it */
+    (void) rbc_mesh_fault_capture(RBC_MESH_FAULT_TYPE_APP_ERROR, error_code, _RETURN_ADDRESS(), 0, (uint16_t) line_num);
 #if 0	
 	while(true)
 	{
@@ -818,7 +980,8 @@ void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p
 	//error_loop();
 }
 
-/** @brief Hardware fault handler. */
+#if !defined(MESH_FAULTLOG) || !RBC_MESH_FAULTLOG_HARDFAULT_HANDLER
+/** @brief Hardware fault handler. The fault log has its own, that logs the fault and resets. */
 void HardFault_Handler(void)
 {
 #ifdef DEBUG_LOG_RTT
@@ -827,6 +990,7 @@ void HardFault_Handler(void)
 
 	error_loop();
 }
+#endif
 
 void app_error_fault_handler(uint32_t id, uint32_t pc, uint32_t info)
 {
@@ -936,88 +1100,119 @@ void gpio_init(void)
 	nrf_gpio_cfg_input(IR_REC,NRF_GPIO_PIN_PULLUP);		
 #endif
 
-#if defined(BOARD_PCA10028) || defined(BOARD_PCA10040)
-    #ifdef BUTTONS
-        nrf_gpio_cfg_input(BUTTON_1, NRF_GPIO_PIN_PULLUP);
-        nrf_gpio_cfg_input(BUTTON_2, NRF_GPIO_PIN_PULLUP);
-        nrf_gpio_cfg_input(BUTTON_3, NRF_GPIO_PIN_PULLUP);
-        nrf_gpio_cfg_input(BUTTON_4, NRF_GPIO_PIN_PULLUP);
-    #endif
-#endif
 }
 
-/**@brief Function for handling events from the BSP module.
+/**@brief Function for toggling the relay on a touch.
  *
- * @param[in]   event   Event generated by button press.
+ * @details Switches the relay and the light indication at once, and leaves the
+ *          mesh publish of the new state to the main loop. Called from the
+ *          touch key interrupt, so it may only use functions that don't wait for
+ *          lower priority interrupts.
  */
-void bsp_event_handler(bsp_event_t event)
+static void relay_toggle(void)
 {
     uint32_t err_code;
-    switch (event)
-    {
-        case BSP_EVENT_KEY_0:
-		
-        case BSP_EVENT_KEY_1:	
 
-		pir_triggle_mode = 0;				/* if key press exit trigger mode */
-		app_timer_stop(m_trigger_timer_id);
-		
-		if(relay_status)
-		{			
-			relay_status = 0;
-
-#ifdef BREATH_LED			
-			update_pwm_value(0x00);
-#else			
-	
-			
-			nrf_gpio_pin_set(LED_1);
-			nrf_gpio_pin_set(LED_3);				
-			
-#endif			
-			shut_pir_sound_timer();		
-			err_code = app_timer_start(m_hang_on_timer_id, KEY_PERIOD_HANG_SENSOR, NULL);			
-			APP_ERROR_CHECK(err_code);	
+	pir_triggle_mode = 0;				/* if key press exit trigger mode */
+	task_stop(m_trigger_timer_id);
 
+	if(relay_status)
+	{			
+		relay_status = 0;
 #ifdef RELAY_LATCH	
-			relay_off();
-			err_code = app_timer_start(m_relay_timer_id, RELAY_INTERVAL, NULL);
-			APP_ERROR_CHECK(err_code);	
+		relay_off();
+		err_code = task_start(m_relay_timer_id, RELAY_INTERVAL, NULL);
+		APP_ERROR_CHECK(err_code);	
 #else
-			relay_off();
+		relay_off();
 #endif			
 
-#ifdef DEBUG_LOG_RTT
-			SEGGER_RTT_printf(0, "SWITCH,OFF.\r\n");	
-#endif			
-		}else
-		{
-			
-			relay_status = 1;
 #ifdef BREATH_LED			
-			update_pwm_value(100);	
+		request_pwm_value(0x00);
 #else			
-
-			nrf_gpio_pin_clear(LED_1);
-			nrf_gpio_pin_clear(LED_3);
-
-			
+		nrf_gpio_pin_set(LED_1);
+		nrf_gpio_pin_set(LED_3);				
 #endif			
+#ifdef DEBUG_LOG_RTT
+		DEBUG_LOG("SWITCH,OFF.\r\n");	
+#endif			
+	}else
+	{
+		relay_status = 1;
 #ifdef RELAY_LATCH
-			relay_on();
-			err_code = app_timer_start(m_relay_timer_id, RELAY_INTERVAL, NULL);
-			APP_ERROR_CHECK(err_code);
+		relay_on();
+		err_code = task_start(m_relay_timer_id, RELAY_INTERVAL, NULL);
+		APP_ERROR_CHECK(err_code);
 #else
-			relay_on();
+		relay_on();
 #endif
-			shut_pir_sound_timer();	
-			err_code = app_timer_start(m_hang_on_timer_id, KEY_PERIOD_HANG_SENSOR, NULL);			
-			APP_ERROR_CHECK(err_code);
-			
+#ifdef BREATH_LED			
+		request_pwm_value(100);	
+#else			
+		nrf_gpio_pin_clear(LED_1);
+		nrf_gpio_pin_clear(LED_3);
+#endif			
 #ifdef DEBUG_LOG_RTT
-			SEGGER_RTT_printf(0, "SWITCH,ON.\r\n");
+		DEBUG_LOG("SWITCH,ON.\r\n");
 #endif
-		}		
+	}
+	shut_pir_sound_timer();	
+	err_code = task_start(m_hang_on_timer_id, KEY_PERIOD_HANG_SENSOR, NULL);			
+	APP_ERROR_CHECK(err_code);
+
+	m_relay_publish_pending = true;
+}
+
+#if defined(BUTTONS)
+/**@brief Function for handling the DK button events.
+ *
+ * @details Only records the push, the mesh publish is left to the main loop.
+ */
+static void mesh_button_handler(uint8_t pin_no, uint8_t button_action)
+{
+    if (button_action == APP_BUTTON_PUSH)
+    {
+        m_button_publish_pending |= (1UL << (pin_no - BUTTON_START));
+    }
+}
+#elif TOUCH_FAST_ACTUATION
+/**@brief Function for handling the touch key GPIOTE events.
+ *
+ * @details Runs in the GPIOTE interrupt, so the relay switches on the edge instead
+ *          of after the button detection delay and the main loop.
+ */
+static void touch_event_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    uint32_t now, elapsed;
+
+    UNUSED_PARAMETER(action);
+    if (nrf_gpio_pin_read(pin) != 0)
+    {
+        return; /* bounced back before the interrupt got to run */
+    }
+    (void) app_timer_cnt_get(&now);
+    (void) app_timer_cnt_diff_compute(now, m_last_touch_ticks, &elapsed);
+    if (elapsed < TOUCH_DEBOUNCE_INTERVAL)
+    {
+        return;
+    }
+    m_last_touch_ticks = now;
+    relay_toggle();
+}
+#endif
+
+/**@brief Function for handling events from the BSP module.
+ *
+ * @param[in]   event   Event generated by button press.
+ */
+void bsp_event_handler(bsp_event_t event)
+{
+    switch (event)
+    {
+        case BSP_EVENT_KEY_0:
+		
+        case BSP_EVENT_KEY_1:	
+		relay_toggle();
         break;
         case BSP_EVENT_KEY_2:
 				
@@ -1043,46 +1238,54 @@ static void timers_init(void)
 		List handling is done using a software interrupt (SWI0). Both interrupt handlers are running in APP_LOW priority level. */	
     // Initialize timer module.
     APP_TIMER_INIT(APP_TIMER_PRESCALER, APP_TIMER_MAX_TIMERS, APP_TIMER_OP_QUEUE_SIZE, false);
+
+    // All application timers are tasks in the task table, ticked by a single app_timer.
+    err_code = task_table_init(APP_TIMER_PRESCALER);
+    APP_ERROR_CHECK(err_code);
 		
     // Create timers.
-    err_code = app_timer_create(&m_heartbeat_timer_id, APP_TIMER_MODE_REPEATED, led_heartbeat_handler);                                                                
+    err_code = task_create(&m_heartbeat_timer_id, TASK_MODE_REPEATED, led_heartbeat_handler);                                                                
     APP_ERROR_CHECK(err_code);
 	// Create relay execute timer.
 #ifdef RELAY_LATCH
-    err_code = app_timer_create(&m_relay_timer_id, APP_TIMER_MODE_SINGLE_SHOT, relay_execute_handler);                                                                
+    err_code = task_create(&m_relay_timer_id, TASK_MODE_SINGLE_SHOT, relay_execute_handler);                                                                
     APP_ERROR_CHECK(err_code);	
 #endif
 	
-    err_code = app_timer_create(&m_communicate_timer_id, APP_TIMER_MODE_SINGLE_SHOT, blink_off_handler);                                                                
+#ifndef BSP_LED_ENGINE
+    err_code = task_create(&m_communicate_timer_id, TASK_MODE_SINGLE_SHOT, blink_off_handler);                                                                
     APP_ERROR_CHECK(err_code);	
+#endif
 	
-#ifdef BREATH_LED
-    err_code = app_timer_create(&m_pwm_update_timer_id, APP_TIMER_MODE_REPEATED, pwm_update_handler);                                                                
-    APP_ERROR_CHECK(err_code);
-#endif	
-    err_code = app_timer_create(&m_motion_sound_timer_id, APP_TIMER_MODE_SINGLE_SHOT, led_off_handler);                                                                
+    err_code = task_create(&m_motion_sound_timer_id, TASK_MODE_SINGLE_SHOT, led_off_handler);                                                                
     APP_ERROR_CHECK(err_code);	
 	
-    err_code = app_timer_create(&m_pir_mes_timer_id, APP_TIMER_MODE_REPEATED, pir_event_handler);                                                                
+    err_code = task_create(&m_pir_mes_timer_id, TASK_MODE_REPEATED, pir_event_handler);                                                                
     APP_ERROR_CHECK(err_code);	
 	
-    err_code = app_timer_create(&m_sound_mes_timer_id, APP_TIMER_MODE_REPEATED, sound_event_handler);                                                                
+    err_code = task_create(&m_sound_mes_timer_id, TASK_MODE_REPEATED, sound_event_handler);                                                                
     APP_ERROR_CHECK(err_code);		
 		
-    err_code = app_timer_create(&m_light_mes_timer_id, APP_TIMER_MODE_REPEATED, light_event_handler);                                                                
+    err_code = task_create(&m_light_mes_timer_id, TASK_MODE_REPEATED, light_event_handler);                                                                
     APP_ERROR_CHECK(err_code);		
 	
-    err_code = app_timer_create(&m_temp_mes_timer_id, APP_TIMER_MODE_REPEATED, temperature_event_handler);                                                                
+    err_code = task_create(&m_temp_mes_timer_id, TASK_MODE_REPEATED, temperature_event_handler);                                                                
     APP_ERROR_CHECK(err_code);		
 	
-    err_code = app_timer_create(&m_watchdog_timer_id, APP_TIMER_MODE_REPEATED, watch_dog_handler);                                                                
-    APP_ERROR_CHECK(err_code);	
-
-    err_code = app_timer_create(&m_hang_on_timer_id, APP_TIMER_MODE_SINGLE_SHOT, hang_on_handler);                                                                
+    err_code = task_create(&m_hang_on_timer_id, TASK_MODE_SINGLE_SHOT, hang_on_handler);                                                                
     APP_ERROR_CHECK(err_code);	
 	
-    err_code = app_timer_create(&m_trigger_timer_id, APP_TIMER_MODE_SINGLE_SHOT, trigger_handler);                                                                
+    err_code = task_create(&m_trigger_timer_id, TASK_MODE_SINGLE_SHOT, trigger_handler);                                                                
     APP_ERROR_CHECK(err_code);	
+
+#ifdef SENSOR_WAKE
+    err_code = task_create(&m_sensor_wake_timer_id, TASK_MODE_REPEATED, sensor_wake_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+#endif
+#ifdef BREATH_LED
+    err_code = task_create(&m_pwm_apply_timer_id, TASK_MODE_SINGLE_SHOT, pwm_apply_handler);
+    APP_ERROR_CHECK(err_code);
+#endif
 }
 /**@brief Function for starting application timers.
  */
@@ -1091,23 +1294,25 @@ static void application_timers_start(void)
     uint32_t err_code;
 
     // Start application timers.
-    err_code = app_timer_start(m_sound_mes_timer_id, SOUND_MES_INTERVAL, NULL);	/* sound detect timer */
+    err_code = task_start(m_sound_mes_timer_id, SOUND_MES_INTERVAL, NULL);	/* sound detect timer */
     APP_ERROR_CHECK(err_code);		
 	
-    err_code = app_timer_start(m_watchdog_timer_id, WATCHDOG_INTERVAL, NULL);	/* watchdog feed */
-    APP_ERROR_CHECK(err_code);
-	
-    err_code = app_timer_start(m_heartbeat_timer_id, HEARTBEAT_INTERVAL, NULL);	/* hearybeat timer */
+    err_code = task_start(m_heartbeat_timer_id, HEARTBEAT_TASK_INTERVAL, NULL);	/* hearybeat timer */
     APP_ERROR_CHECK(err_code);
 		
-    err_code = app_timer_start(m_pir_mes_timer_id, PIR_MES_INTERVAL, NULL);		/* PIR detect timer */
+    err_code = task_start(m_pir_mes_timer_id, PIR_MES_INTERVAL, NULL);		/* PIR detect timer */
     APP_ERROR_CHECK(err_code);		
 	
-    err_code = app_timer_start(m_light_mes_timer_id, LIGHT_MES_INTERVAL, NULL); /* light sensor measurement */
+    err_code = task_start(m_light_mes_timer_id, LIGHT_MES_INTERVAL, NULL); /* light sensor measurement */
     APP_ERROR_CHECK(err_code);	
 	
-    err_code = app_timer_start(m_temp_mes_timer_id, TEMP_MES_INTERVAL, NULL);	/* temperature measurement */
+    err_code = task_start(m_temp_mes_timer_id, TEMP_MES_INTERVAL, NULL);	/* temperature measurement */
+    APP_ERROR_CHECK(err_code);
+
+#ifdef SENSOR_WAKE
+    err_code = task_start(m_sensor_wake_timer_id, SENSOR_WAKE_INTERVAL, NULL);	/* ADC scan pause and refresh */
     APP_ERROR_CHECK(err_code);
+#endif
 
 
 }
@@ -1117,11 +1322,46 @@ static void application_timers_start(void)
  */
 static void buttons_leds_init(void)
 {
+#if defined(BUTTONS)
+    /* the DK buttons double as the touch keys, here they set the LED values on
+       the mesh. app_button serves them all from the GPIOTE PORT interrupt and
+       debounces them with one timer */
+    static app_button_cfg_t mesh_buttons[MESH_BUTTON_COUNT];
+    uint32_t err_code;
+
+    for (uint32_t i = 0; i < MESH_BUTTON_COUNT; ++i)
+    {
+        mesh_buttons[i].pin_no         = (uint8_t)(BUTTON_START + i);
+        mesh_buttons[i].active_state   = APP_BUTTON_ACTIVE_LOW;
+        mesh_buttons[i].pull_cfg       = NRF_GPIO_PIN_PULLUP;
+        mesh_buttons[i].button_handler = mesh_button_handler;
+    }
+    err_code = app_button_init(mesh_buttons, MESH_BUTTON_COUNT, MESH_BUTTON_DETECTION_DELAY);
+    APP_ERROR_CHECK(err_code);
+#elif TOUCH_FAST_ACTUATION
+    /* the touch keys get their own GPIOTE events, and bypass the BSP */
+    const uint32_t touch_pins[] = {BSP_BUTTON_0, BSP_BUTTON_1};
+    nrf_drv_gpiote_in_config_t config = GPIOTE_CONFIG_IN_SENSE_HITOLO(false);
+    uint32_t err_code;
+
+    config.pull = BUTTON_PULL;
+    if (!nrf_drv_gpiote_is_init())
+    {
+        err_code = nrf_drv_gpiote_init();
+        APP_ERROR_CHECK(err_code);
+    }
+    for (uint32_t i = 0; i < sizeof(touch_pins) / sizeof(touch_pins[0]); ++i)
+    {
+        err_code = nrf_drv_gpiote_in_init(touch_pins[i], &config, touch_event_handler);
+        APP_ERROR_CHECK(err_code);
+        nrf_drv_gpiote_in_event_enable(touch_pins[i], true);
+    }
+#else
     uint32_t err_code = bsp_init(/*BSP_INIT_LED |*/ BSP_INIT_BUTTONS,
                                  APP_TIMER_TICKS(100, APP_TIMER_PRESCALER), 
                                  bsp_event_handler);
     APP_ERROR_CHECK(err_code);
-
+#endif
 }
 #ifdef BREATH_LED
 void bsp_pwm_init(void)
@@ -1143,11 +1383,54 @@ void bsp_pwm_init(void)
 	
 	while (app_pwm_channel_duty_set(&PWM1, 0, 100) == NRF_ERROR_BUSY);	
 	while (app_pwm_channel_duty_set(&PWM1, 1, 100) == NRF_ERROR_BUSY);
+
+    /* The breath goes linearly in brightness, down and back up, or up and back
+       down. The eye sees brightness roughly as the square of the duty cycle,
+       so the tables hold the squared values. */
+    const uint32_t period = app_pwm_cycle_ticks_get(&PWM1);
+    const uint32_t half = BREATH_STEPS / 2 - 1;
+    for (uint32_t i = 0; i < BREATH_STEPS; ++i)
+    {
+        uint32_t level = (i < BREATH_STEPS / 2) ? i : (BREATH_STEPS - 1 - i);
+        m_breath_off_table[i] = (period * level * level) / (half * half);
+        m_breath_on_table[i]  = (period * (half - level) * (half - level)) / (half * half);
+    }
 }
 #endif
+/**@brief Supervisor check of the mesh, which has stalled if it stops getting timeslots. */
+static bool timeslot_supervisor_check(void)
+{
+    rbc_mesh_stats_t stats;
+    bool progress;
+
+    rbc_mesh_stats_get(&stats);
+    progress = (stats.timeslot_count != m_timeslot_count);
+    m_timeslot_count = stats.timeslot_count;
+    return progress;
+}
+
+/**@brief Supervisor check of the sensor pipeline, which has stalled if the ADC scans stop. */
+static bool sensor_supervisor_check(void)
+{
+    uint32_t frame_count = adc_scan_frame_count_get();
+    bool progress = (frame_count != m_adc_frame_count);
+#ifdef SENSOR_WAKE
+    /* the scans are paused on purpose while the LPCOMP watches the PIR */
+    progress = progress || sensor_wake_is_idle();
+#endif
+
+    m_adc_frame_count = frame_count;
+    return progress;
+}
+
+/**@brief Set up the WDT, fed by the supervisor only while the main loop, the
+ * mesh timeslots and the ADC scans all make progress. The WDT is started by
+ * app_supervisor_start() once the application is running.
+ */
 void bsp_wdt_init(void)
 {
 	uint32_t err_code = NRF_SUCCESS;
+	app_supervisor_id_t id;
 	
     //Configure WDT.
 	nrf_drv_wdt_config_t config;	
@@ -1155,11 +1438,14 @@ void bsp_wdt_init(void)
 	config.interrupt_priority = APP_IRQ_PRIORITY_HIGH;
 	config.reload_value = 2000;	
 	
-    err_code = nrf_drv_wdt_init(&config, wdt_event_handler);
+    err_code = app_supervisor_init(&config, wdt_event_handler, SUPERVISOR_PERIOD);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_supervisor_register(&m_main_loop_supervisor_id, SUPERVISOR_TIMEOUT_PERIODS, NULL);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_supervisor_register(&id, SUPERVISOR_TIMEOUT_PERIODS, timeslot_supervisor_check);
     APP_ERROR_CHECK(err_code);
-    err_code = nrf_drv_wdt_channel_alloc(&m_channel_id);
+    err_code = app_supervisor_register(&id, SUPERVISOR_TIMEOUT_PERIODS, sensor_supervisor_check);
     APP_ERROR_CHECK(err_code);
-    nrf_drv_wdt_enable();	
 }
 
 /**@brief Function for initializing services that will be used by the application.
@@ -1230,18 +1516,56 @@ static void services_init(void)
 	
 }
 
+/**@brief Function for starting the GATT side of the gateway: its services and the
+ *        connectable advertising.
+ *
+ * @details The mesh doesn't depend on it, so it's started from the main loop once the
+ *          first mesh event is in, or after GATT_START_TIMEOUT on a device that's alone.
+ */
+static void gatt_start(void)
+{
+    services_init();
+    nrf_adv_conn_init();
+    m_gatt_started = true;
+    STARTUP_STEP("gatt_start");
+}
+
+#ifdef STARTUP_PROFILE
+/**@brief Function for running RTC1 from the start of main, so the startup steps
+ *        before the Softdevice can be timed too.
+ *
+ * @details The LF clock is started from the RC oscillator. The Softdevice switches
+ *          it to its own source when it's enabled, and app_timer takes over RTC1
+ *          with the same prescaler.
+ */
+static void startup_profile_init(void)
+{
+    NRF_CLOCK->LFCLKSRC = (CLOCK_LFCLKSRC_SRC_RC << CLOCK_LFCLKSRC_SRC_Pos);
+    NRF_CLOCK->TASKS_LFCLKSTART = 1;
+    NRF_RTC1->PRESCALER = APP_TIMER_PRESCALER;
+    NRF_RTC1->TASKS_START = 1;
+}
+#endif
+
 /** @brief main function */
 int main(void)
 {		
-	
+#ifdef STARTUP_PROFILE
+    startup_profile_init();
+#endif
     /* init leds and pins */
     gpio_init();
 	/* power on led light on for a while */
 	leds_on_for_while();
+	STARTUP_STEP("leds");
     /* Initialize timer module.*/
     timers_init();
 	/* Initialize button and leds.*/
 	buttons_leds_init();
+#ifdef BSP_LED_ENGINE
+	/* after the buttons, which may initialize the GPIOTE driver themselves */
+	APP_ERROR_CHECK(bsp_led_engine_init(BSP_LED_1, true));
+#endif
 #ifdef BREATH_LED	
 	/* Initialize breath led pwm */
 	bsp_pwm_init();
@@ -1250,6 +1574,7 @@ int main(void)
 	adc_config();
 	/* Initialize wdt modle */
 	bsp_wdt_init();
+	STARTUP_STEP("peripherals");
 	
 #ifdef DEBUG_LOG_RTT	// RTT debug interface.
 	SEGGER_RTT_ConfigUpBuffer(0, NULL, NULL, 0, SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL);
@@ -1270,6 +1595,7 @@ int main(void)
     softdevice_ble_evt_handler_set(sd_ble_evt_handler); 
 	/* app-defined event handler, as we need to send it to the nrf_adv_conn module and the rbc_mesh */
     softdevice_sys_evt_handler_set(rbc_mesh_sd_evt_handler);
+    STARTUP_STEP("softdevice");
 
 #ifdef RBC_MESH_SERIAL
     mesh_aci_init();
@@ -1285,22 +1611,23 @@ int main(void)
     
     uint32_t error_code = rbc_mesh_init(init_params);
     APP_ERROR_CHECK(error_code);
+    STARTUP_STEP("rbc_mesh_init");
 
-	nrf_drv_wdt_channel_feed(m_channel_id);
     /* request values for both LEDs on the mesh */
     for (uint32_t i = 0; i < 2; ++i)
     {
         error_code = rbc_mesh_value_enable(i);
         APP_ERROR_CHECK(error_code);
     }
-    /* init BLE gateway softdevice application: */
-    nrf_adv_conn_init();
+    /* publish the sensors on their own handles */
+    sensor_publish_init(&m_light_publish, LIGHT_MESH_HANDLE, LIGHT_PUBLISH_DEADBAND,
+            LIGHT_PUBLISH_MIN_INTERVAL, LIGHT_PUBLISH_MAX_INTERVAL);
+    sensor_publish_init(&m_temp_publish, TEMP_MESH_HANDLE, TEMP_PUBLISH_DEADBAND,
+            TEMP_PUBLISH_MIN_INTERVAL, TEMP_PUBLISH_MAX_INTERVAL);
     
 #ifdef RBC_MESH_SERIAL
     APP_ERROR_CHECK(mesh_aci_start());
 #endif
-    
-	services_init();
 	
 #ifdef BLINKY   
     led_init ();
@@ -1308,42 +1635,79 @@ int main(void)
     start_blink_interval_s(1);    
 #endif  
 		
+#if defined(BUTTONS) || !TOUCH_FAST_ACTUATION
     app_button_enable();
+#endif
 //	app_pwm_enable(&PWM1);
 	application_timers_start();	
+	APP_ERROR_CHECK(app_supervisor_start());
+	STARTUP_STEP("main loop");
 //	motion_sound_event_set(HEARTBEAT_EVENT);
 //	rbc_mesh_stop();
     rbc_mesh_event_t evt;
+    uint32_t start_ticks;
+    APP_ERROR_CHECK(app_timer_cnt_get(&start_ticks));
     while (true)
     {
 #ifdef BUTTONS
-        for (uint32_t pin = BUTTON_START; pin <= BUTTON_STOP; ++pin)
+        if (m_button_publish_pending)
         {
-            if(nrf_gpio_pin_read(pin) == 0)
-            {
-                while(nrf_gpio_pin_read(pin) == 0);
-                uint8_t mesh_data[1];
-                uint32_t led_status = !!((pin - BUTTON_START) & 0x01); /* even buttons are OFF, odd buttons are ON */
-                uint32_t led_offset = !!((pin - BUTTON_START) & 0x02); /* two buttons per led */
+            uint32_t pending;
 
-                mesh_data[0] = led_status;
-                if (rbc_mesh_value_set(led_offset, mesh_data, 1) == NRF_SUCCESS)
+            CRITICAL_REGION_ENTER();
+            pending = m_button_publish_pending;
+            m_button_publish_pending = 0;
+            CRITICAL_REGION_EXIT();
+
+            for (uint32_t i = 0; i < MESH_BUTTON_COUNT; ++i)
+            {
+                if (pending & (1UL << i))
                 {
-                    led_config(led_offset, led_status);
+                    uint8_t mesh_data[1];
+                    uint32_t led_status = !!(i & 0x01); /* even buttons are OFF, odd buttons are ON */
+                    uint32_t led_offset = !!(i & 0x02); /* two buttons per led */
+
+                    mesh_data[0] = led_status;
+                    if (rbc_mesh_value_set(led_offset, mesh_data, 1) == NRF_SUCCESS)
+                    {
+                        led_config(led_offset, led_status);
+                    }
                 }
             }
         }
 #endif       
-        if (rbc_mesh_event_get(&evt) == NRF_SUCCESS)
+        if (m_relay_publish_pending)
+        {
+            /* the relay is already switched, only the mesh is left. The flag is
+               cleared first, so a touch during the update gets published too. */
+            m_relay_publish_pending = false;
+            uint8_t mesh_data[1] = {relay_status};
+            if (rbc_mesh_value_set(RELAY_MESH_HANDLE, mesh_data, 1) != NRF_SUCCESS)
+            {
+                m_relay_publish_pending = true;
+            }
+        }
+        bool mesh_event = (rbc_mesh_event_get(&evt) == NRF_SUCCESS);
+        if (mesh_event)
         {   
             rbc_mesh_event_handler(&evt);
-			nrf_drv_wdt_channel_feed(m_channel_id);
             rbc_mesh_event_release(&evt);			
         }						
+        if (!m_gatt_started)
+        {
+            uint32_t now_ticks;
+            uint32_t elapsed_ticks;
+            APP_ERROR_CHECK(app_timer_cnt_get(&now_ticks));
+            APP_ERROR_CHECK(app_timer_cnt_diff_compute(now_ticks, start_ticks, &elapsed_ticks));
+            if (mesh_event || elapsed_ticks >= GATT_START_TIMEOUT)
+            {
+                gatt_start();
+            }
+        }
+		/* the task table tick wakes the loop at least every TASK_TABLE_TICK_MS */
+		app_supervisor_checkin(m_main_loop_supervisor_id);
+		rtt_log_flush();
 		sd_app_evt_wait();
-		
-		nrf_drv_wdt_channel_feed(m_channel_id);
-				
     }
 }
 
@@ -0,0 +1,122 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "sensor_curve.h"
+#include "nrf.h"
+
+#define UICR_CUSTOMER_COUNT     (sizeof(NRF_UICR->CUSTOMER) / sizeof(NRF_UICR->CUSTOMER[0]))
+#define UICR_ERASED             (0xFFFFFFFF)
+
+/*****************************************************************************
+* Curves
+*****************************************************************************/
+/* Points every 10 degrees from 150 down to -40 degrees. Can check relative
+   document in : Z:\Designs\Temperature\Curves\ThermistorCurves_VoltageCalcs.xls */
+const sensor_curve_point_t g_sensor_curve_ntc_10k[SENSOR_CURVE_NTC_10K_POINTS] =
+{
+    {  19,  1500}, {  24,  1400}, {  30,  1300}, {  38,  1200}, {  49,  1100},
+    {  64,  1000}, {  85,   900}, { 113,   800}, { 151,   700}, { 202,   600},
+    { 269,   500}, { 354,   400}, { 455,   300}, { 567,   200}, { 680,   100},
+    { 782,     0}, { 865,  -100}, { 926,  -200}, { 965,  -300}, { 990,  -400}
+};
+
+/* k = 527/2000 lux per LSB */
+const sensor_curve_point_t g_sensor_curve_tps851[SENSOR_CURVE_TPS851_POINTS] =
+{
+    {   0,     0}, {2000,   527}
+};
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void sensor_curve_init(sensor_curve_t* p_curve, const sensor_curve_point_t* p_points, int32_t* p_slopes, uint8_t count)
+{
+    p_curve->p_points = p_points;
+    p_curve->p_slopes = p_slopes;
+    p_curve->count = count;
+    p_curve->gain = SENSOR_CURVE_GAIN_UNITY;
+    p_curve->offset = 0;
+
+    for (uint32_t i = 0; i + 1 < count; ++i)
+    {
+        p_slopes[i] = (((int32_t) p_points[i + 1].y - p_points[i].y) << SENSOR_CURVE_SLOPE_SHIFT) /
+                      ((int32_t) p_points[i + 1].x - p_points[i].x);
+    }
+}
+
+void sensor_curve_calibration_load(sensor_curve_t* p_curve, uint8_t uicr_index)
+{
+    if (uicr_index >= UICR_CUSTOMER_COUNT)
+    {
+        return;
+    }
+    uint32_t cal = NRF_UICR->CUSTOMER[uicr_index];
+    if (cal != UICR_ERASED)
+    {
+        p_curve->gain = (uint16_t) (cal >> 16);
+        p_curve->offset = (int16_t) (cal & 0xFFFF);
+    }
+}
+
+int32_t sensor_curve_convert(const sensor_curve_t* p_curve, int32_t x)
+{
+    const sensor_curve_point_t* p_points = p_curve->p_points;
+    int32_t y;
+
+    if (x <= p_points[0].x)
+    {
+        y = p_points[0].y;
+    }
+    else if (x >= p_points[p_curve->count - 1].x)
+    {
+        y = p_points[p_curve->count - 1].y;
+    }
+    else
+    {
+        /* find the segment with p_points[low].x <= x < p_points[low + 1].x */
+        uint32_t low = 0;
+        uint32_t high = p_curve->count - 1;
+        while (high - low > 1)
+        {
+            uint32_t mid = (low + high) >> 1;
+            if (p_points[mid].x <= x)
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        y = p_points[low].y + ((p_curve->p_slopes[low] * (x - p_points[low].x)) >> SENSOR_CURVE_SLOPE_SHIFT);
+    }
+
+    return ((y * p_curve->gain) >> SENSOR_CURVE_GAIN_SHIFT) + p_curve->offset;
+}
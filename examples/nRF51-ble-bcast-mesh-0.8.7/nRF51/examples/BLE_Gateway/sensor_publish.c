@@ -0,0 +1,104 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "sensor_publish.h"
+#include "app_timer.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static bool should_publish(const sensor_publish_t* p_sensor, int32_t value)
+{
+    if (!p_sensor->published)
+    {
+        return true;
+    }
+    if (p_sensor->max_interval != 0 && p_sensor->age >= p_sensor->max_interval)
+    {
+        return true;
+    }
+    if (p_sensor->age < p_sensor->min_interval)
+    {
+        return false;
+    }
+    uint32_t change = (value > p_sensor->last_value) ?
+        (uint32_t) (value - p_sensor->last_value) :
+        (uint32_t) (p_sensor->last_value - value);
+    return (change >= p_sensor->deadband);
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void sensor_publish_init(sensor_publish_t* p_sensor,
+        rbc_mesh_value_handle_t handle,
+        uint32_t deadband,
+        uint32_t min_interval,
+        uint32_t max_interval)
+{
+    p_sensor->handle = handle;
+    p_sensor->deadband = deadband;
+    p_sensor->min_interval = min_interval;
+    p_sensor->max_interval = max_interval;
+    p_sensor->last_value = 0;
+    p_sensor->age = 0;
+    p_sensor->published = false;
+    (void) app_timer_cnt_get(&p_sensor->last_sample_ticks);
+}
+
+uint32_t sensor_publish_sample(sensor_publish_t* p_sensor, int32_t value, bool* p_published)
+{
+    uint32_t now;
+    uint32_t elapsed;
+    (void) app_timer_cnt_get(&now);
+    (void) app_timer_cnt_diff_compute(now, p_sensor->last_sample_ticks, &elapsed);
+    p_sensor->last_sample_ticks = now;
+    p_sensor->age = (p_sensor->age + elapsed < p_sensor->age) ? UINT32_MAX : p_sensor->age + elapsed;
+
+    *p_published = false;
+    if (!should_publish(p_sensor, value))
+    {
+        return NRF_SUCCESS;
+    }
+
+    int16_t mesh_value = (int16_t) value;
+    uint32_t error_code = rbc_mesh_value_set(p_sensor->handle, (uint8_t*) &mesh_value, sizeof(mesh_value));
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
+    p_sensor->last_value = value;
+    p_sensor->age = 0;
+    p_sensor->published = true;
+    *p_published = true;
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "sensor_wake.h"
+#include "adc_scan.h"
+#include "nrf_drv_lpcomp.h"
+#include "app_util_platform.h"
+#include "nrf_error.h"
+#include <stddef.h>
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static sensor_wake_config_t m_config;
+static sensor_wake_handler_t m_handler;
+static bool m_idle;
+/** Ticks without activity while scanning, or ticks since the last refresh while idle. */
+static uint16_t m_ticks;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void scans_resume(void)
+{
+    if (m_idle)
+    {
+        nrf_drv_lpcomp_disable();
+        adc_scan_resume();
+        m_idle = false;
+    }
+}
+
+static void scans_pause(void)
+{
+    /* a scan in progress is left to finish, and the pause retried on the next tick */
+    if (adc_scan_pause() == NRF_SUCCESS)
+    {
+        nrf_drv_lpcomp_enable();
+        m_idle = true;
+        m_ticks = 0;
+    }
+}
+
+static void lpcomp_event_handler(nrf_lpcomp_event_t event)
+{
+    scans_resume();
+    m_ticks = 0;
+    if (m_handler != NULL)
+    {
+        m_handler();
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+uint32_t sensor_wake_init(const sensor_wake_config_t* p_config, sensor_wake_handler_t handler)
+{
+    if (p_config->idle_ticks == 0 || p_config->refresh_ticks == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    m_config = *p_config;
+    m_handler = handler;
+    m_idle = false;
+    m_ticks = 0;
+
+    nrf_drv_lpcomp_config_t lpcomp_config;
+    lpcomp_config.hal.reference = p_config->reference;
+    lpcomp_config.hal.detection = p_config->detection;
+    lpcomp_config.input = p_config->input;
+    lpcomp_config.interrupt_priority = APP_IRQ_PRIORITY_LOW;
+
+    return nrf_drv_lpcomp_init(&lpcomp_config, lpcomp_event_handler);
+}
+
+void sensor_wake_activity(void)
+{
+    scans_resume();
+    m_ticks = 0;
+}
+
+void sensor_wake_tick(void)
+{
+    if (m_idle)
+    {
+        if (++m_ticks >= m_config.refresh_ticks)
+        {
+            /* scan for one tick, so the inputs the LPCOMP doesn't watch get fresh samples */
+            scans_resume();
+            m_ticks = m_config.idle_ticks - 1;
+        }
+    }
+    else if (++m_ticks >= m_config.idle_ticks)
+    {
+        scans_pause();
+    }
+}
+
+bool sensor_wake_is_idle(void)
+{
+    return m_idle;
+}
@@ -0,0 +1,134 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "task_table.h"
+#include "app_timer.h"
+#include "nrf_error.h"
+
+typedef struct
+{
+    task_handler_t handler;
+    void* p_context;
+    uint32_t period; /**< Ticks between runs of repeated tasks, 0 for single shot tasks. */
+    uint32_t due; /**< Tick the task runs next. */
+    uint8_t phase; /**< Extra ticks before the first run of a repeated task. */
+    bool repeated;
+    bool running;
+} task_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static task_t m_tasks[TASK_TABLE_SIZE];
+static uint8_t m_task_count;
+static volatile uint32_t m_tick;
+static app_timer_id_t m_tick_timer_id;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void tick_handler(void* p_context)
+{
+    uint32_t now = ++m_tick;
+
+    for (uint32_t i = 0; i < m_task_count; ++i)
+    {
+        task_t* p_task = &m_tasks[i];
+        /* due is compared with wraparound, tasks started by a handler in
+           this tick are never due before the next one. */
+        if (p_task->running && (int32_t) (now - p_task->due) >= 0)
+        {
+            if (p_task->repeated)
+            {
+                p_task->due += p_task->period;
+            }
+            else
+            {
+                p_task->running = false;
+            }
+            p_task->handler(p_task->p_context);
+        }
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+uint32_t task_table_init(uint32_t app_timer_prescaler)
+{
+    uint32_t error_code = app_timer_create(&m_tick_timer_id, APP_TIMER_MODE_REPEATED, tick_handler);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    return app_timer_start(m_tick_timer_id, APP_TIMER_TICKS(TASK_TABLE_TICK_MS, app_timer_prescaler), NULL);
+}
+
+uint32_t task_create(task_id_t* p_id, task_mode_t mode, task_handler_t handler)
+{
+    if (m_task_count >= TASK_TABLE_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    task_t* p_task = &m_tasks[m_task_count];
+    p_task->handler = handler;
+    p_task->repeated = (mode == TASK_MODE_REPEATED);
+    p_task->running = false;
+    /* spread the repeated tasks over the first few ticks of their periods */
+    p_task->phase = p_task->repeated ? m_task_count : 0;
+    *p_id = m_task_count++;
+    return NRF_SUCCESS;
+}
+
+uint32_t task_start(task_id_t id, uint32_t ticks, void* p_context)
+{
+    if (id >= m_task_count || ticks == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    task_t* p_task = &m_tasks[id];
+    p_task->running = false;
+    p_task->p_context = p_context;
+    p_task->period = ticks;
+    /* ticks are counted from the next tick, like the first app_timer timeout */
+    p_task->due = m_tick + ticks + ((p_task->phase < ticks) ? p_task->phase : 0);
+    p_task->running = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t task_stop(task_id_t id)
+{
+    if (id >= m_task_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    m_tasks[id].running = false;
+    return NRF_SUCCESS;
+}
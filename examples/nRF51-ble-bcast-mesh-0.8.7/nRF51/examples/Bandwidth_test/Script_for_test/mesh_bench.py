@@ -0,0 +1,354 @@
+"""Multi-node mesh benchmark.
+
+Flashes a set of boards with the bench_source, bench_relay and bench_sink
+builds of the Bandwidth_test example, collects the records they write on RTT
+and reports propagation latency, delivery ratio and airtime per delivered
+update. The record format is documented in ../README.adoc.
+
+Run:    python mesh_bench.py run --softdevice s110.hex --source-hex ... --relay-hex ...
+            --sink-hex ... --sink 680740323 --sources 680740324,680740325 --time 60
+            --output interval_100.json
+Compare: python mesh_bench.py compare interval_100.json interval_50.json
+Power:  python mesh_bench.py power --node 680740327 --time 120
+"""
+from __future__ import division
+from __future__ import print_function
+
+import sys
+import json
+import time
+import collections
+from argparse import ArgumentParser
+
+NODE_HANDLE_ADDR = 0x3F000
+ECHO_HANDLE_OFFSET = 0x1000
+RTT_READ_SIZE = 1024
+
+ROLE_SOURCE = 0
+ROLE_RELAY = 1
+ROLE_SINK = 2
+ROLE_POWER = 4
+ROLE_NAMES = {ROLE_SOURCE: 'source', ROLE_RELAY: 'relay', ROLE_SINK: 'sink', ROLE_POWER: 'power'}
+POWER_MODE_NAMES = {0: 'normal', 1: 'low power', 2: 'leaf'}
+
+# preamble, access address, header, advertiser address, adv data header
+# (length, type, UUID, handle, version) and CRC
+PACKET_OVERHEAD_BYTES = 1 + 4 + 2 + 6 + 8 + 3
+US_PER_BYTE = 8
+
+
+class Node(object):
+    def __init__(self, snr, role, handle):
+        self.snr = snr
+        self.role = role
+        self.handle = handle
+        self.api = None
+        self.partial = ''
+        self.log = []
+
+
+def flash(node, softdevice, hex_file):
+    from pynrfjprog import MultiAPI, Hex
+    api = MultiAPI.MultiAPI('NRF51')
+    api.open()
+    try:
+        api.connect_to_emu_with_snr(node.snr)
+        api.erase_all()
+        for path in (softdevice, hex_file):
+            for segment in Hex.Hex(path):
+                api.write(segment.address, segment.data, True)
+        api.write_u32(NODE_HANDLE_ADDR, node.handle, True)
+    finally:
+        api.close()
+    print('Flashed %d as %s with handle %d' % (node.snr, ROLE_NAMES[node.role], node.handle))
+
+
+def collect(nodes, duration):
+    from pynrfjprog import MultiAPI
+    for node in nodes:
+        node.api = MultiAPI.MultiAPI('NRF51')
+        node.api.open()
+        node.api.connect_to_emu_with_snr(node.snr, 8000)
+        node.api.sys_reset()
+        node.api.rtt_start()
+    # start all nodes as close together as possible
+    for node in nodes:
+        node.api.go()
+    for node in nodes:
+        while not node.api.rtt_is_control_block_found():
+            pass
+
+    start = time.time()
+    while time.time() - start < duration:
+        for node in nodes:
+            data = node.api.rtt_read(0, RTT_READ_SIZE)
+            if data:
+                lines = (node.partial + data).split('\n')
+                node.partial = lines.pop()
+                node.log.extend(line.strip() for line in lines if line.strip())
+    for node in nodes:
+        node.api.rtt_stop()
+        node.api.close()
+    return time.time() - start
+
+
+def percentile(values, p):
+    if not values:
+        return None
+    values = sorted(values)
+    index = int(round((p / 100.0) * (len(values) - 1)))
+    return values[index]
+
+
+def parse(nodes):
+    """Returns the records of each node, keyed by record type."""
+    parsed = {}
+    for node in nodes:
+        records = collections.defaultdict(list)
+        for line in node.log:
+            fields = line.split(',')
+            try:
+                records[fields[0]].append([int(f) for f in fields[1:]])
+            except ValueError:
+                pass  # a record corrupted by a reset, or debug output
+        parsed[node.snr] = records
+    return parsed
+
+
+def analyze(nodes, parsed, run_time):
+    sink = [n for n in nodes if n.role == ROLE_SINK][0]
+    headers = [parsed[n.snr]['B'][-1] for n in nodes if parsed[n.snr]['B']]
+    config = {}
+    if headers:
+        _, _, interval_min_ms, pool_size, data_cache, payload_len, update_interval_ms = headers[0]
+        config = {
+            'interval_min_ms': interval_min_ms,
+            'packet_pool_size': pool_size,
+            'data_cache_entries': data_cache,
+            'payload_len': payload_len,
+            'update_interval_ms': update_interval_ms,
+            'consistent': all(h[2:] == headers[0][2:] for h in headers),
+        }
+
+    received = set((r[0], r[1]) for r in parsed[sink.snr]['R'])
+    sources = {}
+    latencies = []
+    sent_total = 0
+    for node in [n for n in nodes if n.role == ROLE_SOURCE]:
+        records = parsed[node.snr]
+        sent = set(u[1] for u in records['U'])
+        first_tx = dict((t[1], t[2]) for t in records['T'])
+        echoes = {}
+        for e in records['E']:
+            echoes.setdefault(e[1], e[2])
+        # the sink echo and the source TX are timestamped on the source clock,
+        # the one way latency is estimated as half the round trip
+        rtts = [((echoes[seq] - first_tx[seq]) & 0xFFFFFFFF) / 1000.0
+                for seq in echoes if seq in first_tx]
+        delivered = len([seq for seq in sent if (node.handle, seq) in received])
+        latencies.extend(rtt / 2 for rtt in rtts)
+        sent_total += len(sent)
+        sources[node.handle] = {
+            'snr': node.snr,
+            'sent': len(sent),
+            'delivered': delivered,
+            'delivery_ratio': delivered / len(sent) if sent else None,
+            'latency_samples': len(rtts),
+        }
+
+    tx_total = 0
+    records_dropped = 0
+    for node in nodes:
+        stats = parsed[node.snr]['S']
+        if stats:
+            tx_total += stats[-1][2]
+            records_dropped += stats[-1][6]
+
+    delivered_total = sum(s['delivered'] for s in sources.values())
+    packet_us = (PACKET_OVERHEAD_BYTES + config.get('payload_len', 0)) * US_PER_BYTE
+    return {
+        'run_time_s': run_time,
+        'node_count': len(nodes),
+        'config': config,
+        'sources': sources,
+        'sent': sent_total,
+        'delivered': delivered_total,
+        'delivery_ratio': delivered_total / sent_total if sent_total else None,
+        'latency_ms': dict(('p%d' % p, percentile(latencies, p)) for p in (50, 90, 99, 100)),
+        'latency_samples': len(latencies),
+        'tx_count': tx_total,
+        # echoes are shorter than the updates, so this is an upper bound
+        'airtime_per_delivered_ms': (tx_total * packet_us / 1000.0 / delivered_total) if delivered_total else None,
+        'records_dropped': records_dropped,
+    }
+
+
+def report(results):
+    def fmt(value, spec='%.1f'):
+        return '-' if value is None else spec % value
+    print('%-24s %5s %8s %6s %8s %8s %8s %8s %10s' % (
+        'run', 'nodes', 'interval', 'pool', 'deliv', 'p50 ms', 'p90 ms', 'p99 ms', 'air/upd ms'))
+    for name, r in results:
+        print('%-24s %5d %8s %6s %8s %8s %8s %8s %10s' % (
+            name[:24],
+            r['node_count'],
+            r['config'].get('interval_min_ms', '-'),
+            r['config'].get('packet_pool_size', '-'),
+            fmt(r['delivery_ratio'], '%.3f'),
+            fmt(r['latency_ms']['p50']),
+            fmt(r['latency_ms']['p90']),
+            fmt(r['latency_ms']['p99']),
+            fmt(r['airtime_per_delivered_ms'], '%.2f')))
+        if r['records_dropped']:
+            print('  warning: %d records dropped on RTT, numbers are incomplete' % r['records_dropped'])
+        if r['config'] and not r['config']['consistent']:
+            print('  warning: the nodes were not built with the same configuration')
+
+
+def run(options):
+    sources = [int(s, 0) for s in options.sources.split(',') if s]
+    relays = [int(s, 0) for s in options.relays.split(',') if s]
+    nodes = [Node(options.sink, ROLE_SINK, 0)]
+    nodes += [Node(snr, ROLE_SOURCE, i + 1) for i, snr in enumerate(sources)]
+    nodes += [Node(snr, ROLE_RELAY, len(sources) + i + 1) for i, snr in enumerate(relays)]
+    hex_files = {ROLE_SOURCE: options.source_hex, ROLE_RELAY: options.relay_hex, ROLE_SINK: options.sink_hex}
+
+    if not options.no_flash:
+        for node in nodes:
+            flash(node, options.softdevice, hex_files[node.role])
+
+    run_time = collect(nodes, options.time)
+    result = analyze(nodes, parse(nodes), run_time)
+    result['label'] = options.label or options.output
+
+    if options.output:
+        with open(options.output, 'w') as f:
+            json.dump(result, f, indent=2, sort_keys=True)
+    if options.log:
+        with open(options.log, 'w') as f:
+            for node in nodes:
+                for line in node.log:
+                    f.write('%d,%s\n' % (node.snr, line))
+    report([(result['label'] or 'run', result)])
+    return 0
+
+
+def analyze_power(parsed):
+    """Averages the P records of a power node over the idle and update phases.
+    The first phase is left out, it includes the startup of the mesh."""
+    phases = parsed['P'][1:]
+    config = parsed['C'][-1] if parsed['C'] else None
+    result = {'phases': len(phases)}
+    if config:
+        result['config'] = {
+            'phase_ms': config[0],
+            'power_mode': POWER_MODE_NAMES.get(config[1], config[1]),
+            'radio_ua': config[2],
+            'timeslot_ua': config[3],
+            'cpu_ua': config[4],
+            'sleep_ua': config[5],
+        }
+    for loaded, name in ((0, 'idle'), (1, 'update')):
+        records = [p for p in phases if p[0] == loaded]
+        duration_us = sum(p[1] for p in records) * 1000
+        if not duration_us:
+            continue
+        summary = {
+            'phases': len(records),
+            'updates': sum(p[2] for p in records),
+            'delivered': sum(p[3] for p in records),
+            'timeslot_permille': sum(p[4] for p in records) * 1000.0 / duration_us,
+            'radio_on_permille': sum(p[5] for p in records) * 1000.0 / duration_us,
+            'dispatch_permille': sum(p[6] for p in records) * 1000.0 / duration_us,
+            'tx_count': sum(p[8] for p in records),
+            # nC per us is mA
+            'average_ua': sum(p[9] for p in records) * 1000.0 / duration_us,
+        }
+        if loaded:
+            per_update = [p[10] for p in records if p[3]]
+            summary['charge_per_update_uc'] = (sum(per_update) / len(per_update) / 1000.0) if per_update else None
+        result[name] = summary
+    return result
+
+
+def report_power(result):
+    config = result.get('config')
+    if config:
+        print('%s mode, %d ms phases, model %d/%d/%d/%d uA radio/timeslot/cpu/sleep' % (
+            config['power_mode'], config['phase_ms'], config['radio_ua'],
+            config['timeslot_ua'], config['cpu_ua'], config['sleep_ua']))
+    print('%-8s %6s %8s %8s %8s %8s %8s %10s %10s' % (
+        'phase', 'count', 'updates', 'deliv', 'ts %', 'radio %', 'cpu %', 'avg uA', 'uC/update'))
+    for name in ('idle', 'update'):
+        s = result.get(name)
+        if not s:
+            continue
+        per_update = s.get('charge_per_update_uc')
+        print('%-8s %6d %8d %8d %8.2f %8.2f %8.3f %10.1f %10s' % (
+            name, s['phases'], s['updates'], s['delivered'],
+            s['timeslot_permille'] / 10, s['radio_on_permille'] / 10, s['dispatch_permille'] / 10,
+            s['average_ua'], '-' if per_update is None else '%.2f' % per_update))
+    if not result['phases']:
+        print('  warning: no complete phases, run for at least three phase lengths')
+
+
+def power(options):
+    node = Node(options.node, ROLE_POWER, None)
+    collect([node], options.time)
+    result = analyze_power(parse([node])[node.snr])
+    if options.output:
+        with open(options.output, 'w') as f:
+            json.dump(result, f, indent=2, sort_keys=True)
+    if options.log:
+        with open(options.log, 'w') as f:
+            for line in node.log:
+                f.write('%s\n' % line)
+    report_power(result)
+    return 0
+
+
+def compare(options):
+    results = []
+    for path in options.results:
+        with open(path) as f:
+            results.append((path, json.load(f)))
+    report(results)
+    return 0
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser(description="Mesh latency, delivery and airtime benchmark")
+    sub = parser.add_subparsers(dest='command')
+
+    run_parser = sub.add_parser('run', help="Flash the nodes, run the benchmark and report")
+    run_parser.add_argument("--softdevice", required=True, help="S110 Softdevice hex")
+    run_parser.add_argument("--source-hex", dest="source_hex", required=True)
+    run_parser.add_argument("--relay-hex", dest="relay_hex", required=True)
+    run_parser.add_argument("--sink-hex", dest="sink_hex", required=True)
+    run_parser.add_argument("--sink", type=lambda x: int(x, 0), required=True, help="Segger ID of the sink")
+    run_parser.add_argument("--sources", required=True, help="Comma separated Segger IDs of the sources")
+    run_parser.add_argument("--relays", default='', help="Comma separated Segger IDs of the relays")
+    run_parser.add_argument("-t", "--time", type=int, default=60, help="Run time in seconds")
+    run_parser.add_argument("-o", "--output", help="Write the results as json to this file")
+    run_parser.add_argument("--log", help="Write all raw records to this file")
+    run_parser.add_argument("--label", help="Name of the run in the report")
+    run_parser.add_argument("--no-flash", dest="no_flash", action="store_true", help="Reuse the firmware on the nodes")
+
+    compare_parser = sub.add_parser('compare', help="Report several runs side by side")
+    compare_parser.add_argument("results", nargs='+', help="Json files written by run")
+
+    power_parser = sub.add_parser('power', help="Collect and average the phase reports of a power node")
+    power_parser.add_argument("--node", type=lambda x: int(x, 0), required=True, help="Segger ID of the power node")
+    power_parser.add_argument("-t", "--time", type=int, default=120, help="Run time in seconds")
+    power_parser.add_argument("-o", "--output", help="Write the results as json to this file")
+    power_parser.add_argument("--log", help="Write all raw records to this file")
+
+    options = parser.parse_args()
+    if options.command == 'run':
+        sys.exit(run(options))
+    elif options.command == 'compare':
+        sys.exit(compare(options))
+    elif options.command == 'power':
+        sys.exit(power(options))
+    parser.print_help()
+    sys.exit(1)
@@ -0,0 +1,466 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "bench.h"
+
+#include "rbc_mesh.h"
+#include "app_error.h"
+#include "nrf_soc.h"
+#include "nrf.h"
+#include "SEGGER_RTT.h"
+#if BENCH_ROLE == BENCH_ROLE_MICRO
+#include "mesh_microbench.h"
+#endif
+#if BENCH_ROLE == BENCH_ROLE_POWER
+#include "nrf_gpio.h"
+#endif
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#ifndef BENCH_ROLE
+#error "BENCH_ROLE must be set to one of the BENCH_ROLE_* values"
+#endif
+
+#if BENCH_PAYLOAD_LEN < 4 || BENCH_PAYLOAD_LEN > RBC_MESH_VALUE_MAX_LEN
+#error "BENCH_PAYLOAD_LEN must be between 4 and RBC_MESH_VALUE_MAX_LEN"
+#endif
+
+#if BENCH_ROLE == BENCH_ROLE_POWER && BENCH_POWER_PHASE_MS > 300000
+/* the RTC wraps at 512s, and the charge of a phase has to fit in 32 bits */
+#error "BENCH_POWER_PHASE_MS can't be longer than 300000"
+#endif
+
+#define BENCH_RTC_FREQUENCY     (32768)
+#define BENCH_RTC_MASK          (0x00FFFFFF)
+#define BENCH_MS_TO_TICKS(MS)   ((uint32_t) (((uint64_t) (MS) * BENCH_RTC_FREQUENCY) / 1000))
+#define BENCH_RECORD_MAXLEN     (96)
+
+/** Write a record for every update, leaving them out of the power measurements. */
+#define BENCH_TRACE_RECORDS     (BENCH_ROLE != BENCH_ROLE_POWER)
+
+#if BENCH_ROLE == BENCH_ROLE_MICRO
+/** TIMER2 at the full 16MHz counts CPU cycles. It only has 16 bits on the nRF51. */
+#define BENCH_MICRO_TIMER       (NRF_TIMER2)
+#endif
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static char                 m_rtt_buffer[BUFFER_SIZE_UP];
+static rbc_mesh_value_handle_t m_handle;
+static uint32_t             m_seq;
+static bool                 m_seq_on_air;       /**< The first TX of m_seq has been recorded. */
+static uint32_t             m_records_dropped;  /**< Records that didn't fit in the RTT buffer. */
+static volatile bool        m_update_due;
+static volatile bool        m_stats_due;
+#if BENCH_ROLE == BENCH_ROLE_POWER
+static volatile bool        m_phase_due;
+static bool                 m_phase_loaded;     /**< The current phase writes updates. */
+static uint32_t             m_phase_start_rtc;
+static rbc_mesh_stats_t     m_phase_start_stats;
+static uint32_t             m_phase_updates;
+static uint32_t             m_phase_delivered;  /**< Updates of the phase echoed back by the sink. */
+static uint32_t             m_echo_seq;         /**< Highest sequence number echoed back. */
+static bool                 m_echo_received;
+static uint32_t             m_idle_charge_nc;   /**< Estimated charge of the last idle phase. */
+static uint32_t             m_idle_duration_us;
+#endif
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+/** Write a single record. Records are dropped whole when RTT is full, the
+  script sees the drop count in the next stats record. */
+static void record_write(const char* p_format, ...)
+{
+    char record[BENCH_RECORD_MAXLEN];
+    va_list args;
+    va_start(args, p_format);
+    int length = vsnprintf(record, sizeof(record), p_format, args);
+    va_end(args);
+
+    if (length <= 0 || length >= (int) sizeof(record) ||
+        SEGGER_RTT_Write(0, record, length) == 0)
+    {
+        m_records_dropped++;
+    }
+}
+
+static uint32_t seq_get(const uint8_t* p_data, uint8_t length)
+{
+    uint32_t seq = 0;
+    if (length >= sizeof(seq))
+    {
+        memcpy(&seq, p_data, sizeof(seq));
+    }
+    return seq;
+}
+
+static void update_write(void)
+{
+    uint8_t payload[BENCH_PAYLOAD_LEN];
+    memset(payload, 0, sizeof(payload));
+    memcpy(payload, &m_seq, sizeof(m_seq));
+
+    m_seq_on_air = false;
+    APP_ERROR_CHECK(rbc_mesh_value_set(m_handle, payload, sizeof(payload)));
+#if BENCH_TRACE_RECORDS
+    record_write("U,%u,%u\n", m_handle, m_seq);
+#endif
+}
+
+static void stats_write(void)
+{
+    rbc_mesh_stats_t stats;
+    if (rbc_mesh_stats_get(&stats) == NRF_SUCCESS)
+    {
+        record_write("S,%u,%u,%u,%u,%u,%u,%u\n",
+                stats.rx_ok,
+                stats.rx_crc_fail,
+                stats.tx_count,
+                stats.pool_exhausted,
+                stats.event_queue_drop,
+                stats.duty_cycle_permille,
+                m_records_dropped);
+    }
+}
+
+static void rx_handle(rbc_mesh_value_handle_t handle, uint8_t* p_data, uint8_t length, uint32_t timestamp)
+{
+    uint32_t seq = seq_get(p_data, length);
+
+    if (handle >= BENCH_ECHO_HANDLE_OFFSET)
+    {
+#if BENCH_ROLE == BENCH_ROLE_SOURCE
+        if (handle == m_handle + BENCH_ECHO_HANDLE_OFFSET)
+        {
+            record_write("E,%u,%u,%u\n", m_handle, seq, timestamp);
+        }
+#elif BENCH_ROLE == BENCH_ROLE_POWER
+        /* the sink echoes every version it sees, count each update once */
+        if (handle == m_handle + BENCH_ECHO_HANDLE_OFFSET &&
+            (!m_echo_received || seq > m_echo_seq))
+        {
+            m_echo_received = true;
+            m_echo_seq = seq;
+            m_phase_delivered++;
+        }
+#endif
+        return;
+    }
+
+#if BENCH_TRACE_RECORDS
+    record_write("R,%u,%u,%u\n", handle, seq, timestamp);
+#endif
+
+#if BENCH_ROLE == BENCH_ROLE_SINK
+    /* the echo only carries the sequence number, keeping it short on air */
+    (void) rbc_mesh_value_set(handle + BENCH_ECHO_HANDLE_OFFSET, (uint8_t*) &seq, sizeof(seq));
+#endif
+}
+
+#if BENCH_ROLE == BENCH_ROLE_POWER
+/** Estimate the charge drawn over a phase from the time spent in each state,
+    in nanocoulombs. */
+static uint32_t charge_estimate_nc(uint32_t duration_us, uint32_t timeslot_us, uint32_t radio_on_us, uint32_t dispatch_us)
+{
+    if (timeslot_us < radio_on_us)
+    {
+        timeslot_us = radio_on_us;
+    }
+    if (duration_us < timeslot_us)
+    {
+        duration_us = timeslot_us;
+    }
+    uint64_t charge_pc =
+        (uint64_t) radio_on_us * BENCH_POWER_RADIO_UA +
+        (uint64_t) (timeslot_us - radio_on_us) * BENCH_POWER_TIMESLOT_UA +
+        (uint64_t) dispatch_us * BENCH_POWER_CPU_UA +
+        (uint64_t) (duration_us - timeslot_us) * BENCH_POWER_SLEEP_UA;
+    return (uint32_t) (charge_pc / 1000);
+}
+
+/** Report the phase that just ended, and start the next one. The phase pin
+    changes right after the counters are read, so the analyzer and the
+    estimate cover the same time. */
+static void phase_end(void)
+{
+    rbc_mesh_stats_t stats;
+    APP_ERROR_CHECK(rbc_mesh_stats_get(&stats));
+    uint32_t now_rtc = NRF_RTC1->COUNTER;
+    if (m_phase_loaded)
+    {
+        nrf_gpio_pin_clear(BENCH_POWER_PHASE_PIN);
+    }
+    else
+    {
+        nrf_gpio_pin_set(BENCH_POWER_PHASE_PIN);
+    }
+
+    uint32_t duration_us = (uint32_t) ((((uint64_t) ((now_rtc - m_phase_start_rtc) & BENCH_RTC_MASK)) * 1000000) / BENCH_RTC_FREQUENCY);
+    uint32_t timeslot_us = stats.timeslot_us - m_phase_start_stats.timeslot_us;
+    uint32_t radio_on_us = stats.radio_on_us - m_phase_start_stats.radio_on_us;
+    uint32_t dispatch_us = stats.dispatch_us - m_phase_start_stats.dispatch_us;
+    uint32_t charge_nc = charge_estimate_nc(duration_us, timeslot_us, radio_on_us, dispatch_us);
+
+    /* the updates pay for what the phase drew above the idle phase before it */
+    int32_t update_charge_nc = 0;
+    if (m_phase_loaded && m_phase_delivered > 0 && m_idle_duration_us > 0)
+    {
+        int64_t baseline_nc = ((int64_t) m_idle_charge_nc * duration_us) / m_idle_duration_us;
+        update_charge_nc = (int32_t) (((int64_t) charge_nc - baseline_nc) / (int64_t) m_phase_delivered);
+    }
+
+    record_write("P,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%d\n",
+            m_phase_loaded,
+            duration_us / 1000,
+            m_phase_updates,
+            m_phase_delivered,
+            timeslot_us,
+            radio_on_us,
+            dispatch_us,
+            stats.dispatch_events - m_phase_start_stats.dispatch_events,
+            stats.tx_count - m_phase_start_stats.tx_count,
+            charge_nc,
+            update_charge_nc);
+
+    if (!m_phase_loaded)
+    {
+        m_idle_charge_nc = charge_nc;
+        m_idle_duration_us = duration_us;
+    }
+    m_phase_loaded = !m_phase_loaded;
+    m_phase_start_rtc = now_rtc;
+    m_phase_start_stats = stats;
+    m_phase_updates = 0;
+    m_phase_delivered = 0;
+}
+#endif
+
+#if BENCH_ROLE == BENCH_ROLE_MICRO
+static uint32_t micro_clock_get(void)
+{
+    BENCH_MICRO_TIMER->TASKS_CAPTURE[0] = 1;
+    return BENCH_MICRO_TIMER->CC[0];
+}
+
+static void micro_result_write(const mesh_microbench_result_t* p_result)
+{
+    record_write("M,%s,%u,%u,%u\n",
+            p_result->p_name,
+            p_result->entries,
+            p_result->ops,
+            (uint32_t) p_result->ticks);
+}
+#endif
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void RTC1_IRQHandler(void)
+{
+    if (NRF_RTC1->EVENTS_COMPARE[0])
+    {
+        NRF_RTC1->EVENTS_COMPARE[0] = 0;
+        NRF_RTC1->CC[0] = (NRF_RTC1->CC[0] + BENCH_MS_TO_TICKS(BENCH_UPDATE_INTERVAL_MS)) & BENCH_RTC_MASK;
+        m_update_due = true;
+    }
+    if (NRF_RTC1->EVENTS_COMPARE[1])
+    {
+        NRF_RTC1->EVENTS_COMPARE[1] = 0;
+        NRF_RTC1->CC[1] = (NRF_RTC1->CC[1] + BENCH_MS_TO_TICKS(BENCH_STATS_INTERVAL_MS)) & BENCH_RTC_MASK;
+        m_stats_due = true;
+    }
+#if BENCH_ROLE == BENCH_ROLE_POWER
+    if (NRF_RTC1->EVENTS_COMPARE[2])
+    {
+        NRF_RTC1->EVENTS_COMPARE[2] = 0;
+        NRF_RTC1->CC[2] = (NRF_RTC1->CC[2] + BENCH_MS_TO_TICKS(BENCH_POWER_PHASE_MS)) & BENCH_RTC_MASK;
+        m_phase_due = true;
+    }
+#endif
+}
+
+#if BENCH_ROLE == BENCH_ROLE_MICRO
+void bench_micro_run(void)
+{
+    SEGGER_RTT_Init();
+    SEGGER_RTT_ConfigUpBuffer(0, "UpBuffer0", m_rtt_buffer, BUFFER_SIZE_UP, SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+
+    BENCH_MICRO_TIMER->TASKS_STOP = 1;
+    BENCH_MICRO_TIMER->MODE = TIMER_MODE_MODE_Timer;
+    BENCH_MICRO_TIMER->BITMODE = TIMER_BITMODE_BITMODE_16Bit;
+    BENCH_MICRO_TIMER->PRESCALER = 0;
+    BENCH_MICRO_TIMER->TASKS_CLEAR = 1;
+    BENCH_MICRO_TIMER->TASKS_START = 1;
+
+    mesh_microbench_params_t params;
+    params.clock = micro_clock_get;
+    params.clock_mask = 0xFFFF;
+    params.rounds = BENCH_MICRO_ROUNDS;
+    params.result_cb = micro_result_write;
+    APP_ERROR_CHECK(mesh_microbench_run(&params));
+
+    BENCH_MICRO_TIMER->TASKS_STOP = 1;
+    BENCH_MICRO_TIMER->TASKS_SHUTDOWN = 1;
+}
+#endif
+
+void bench_init(uint32_t interval_min_ms)
+{
+    m_handle = (rbc_mesh_value_handle_t) *((uint32_t*) BENCH_NODE_HANDLE_ADDR);
+
+    SEGGER_RTT_Init();
+    SEGGER_RTT_ConfigUpBuffer(0, "UpBuffer0", m_rtt_buffer, BUFFER_SIZE_UP, SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+
+    record_write("B,%u,%u,%u,%u,%u,%u,%u\n",
+            BENCH_ROLE,
+            m_handle,
+            interval_min_ms,
+            RBC_MESH_PACKET_POOL_SIZE,
+            RBC_MESH_DATA_CACHE_ENTRIES,
+            BENCH_PAYLOAD_LEN,
+            BENCH_UPDATE_INTERVAL_MS);
+
+#if BENCH_ROLE == BENCH_ROLE_SOURCE
+    update_write();
+    APP_ERROR_CHECK(rbc_mesh_tx_event_set(m_handle, true));
+    APP_ERROR_CHECK(rbc_mesh_persistence_set(m_handle, true));
+#elif BENCH_ROLE == BENCH_ROLE_POWER
+    record_write("C,%u,%u,%u,%u,%u,%u\n",
+            BENCH_POWER_PHASE_MS,
+            BENCH_POWER_MODE,
+            BENCH_POWER_RADIO_UA,
+            BENCH_POWER_TIMESLOT_UA,
+            BENCH_POWER_CPU_UA,
+            BENCH_POWER_SLEEP_UA);
+
+    nrf_gpio_cfg_output(BENCH_POWER_PHASE_PIN);
+    nrf_gpio_pin_clear(BENCH_POWER_PHASE_PIN);
+#ifdef BENCH_POWER_UPDATE_PIN
+    nrf_gpio_cfg_output(BENCH_POWER_UPDATE_PIN);
+    nrf_gpio_pin_clear(BENCH_POWER_UPDATE_PIN);
+#endif
+
+    /* no TX events, the power role doesn't record them */
+    update_write();
+    APP_ERROR_CHECK(rbc_mesh_persistence_set(m_handle, true));
+    APP_ERROR_CHECK(rbc_mesh_power_mode_set(BENCH_POWER_MODE));
+    APP_ERROR_CHECK(rbc_mesh_stats_get(&m_phase_start_stats));
+    m_phase_start_rtc = 0;
+#endif
+
+    /* The LFCLK is already running for the Softdevice. */
+    NRF_RTC1->TASKS_STOP = 1;
+    NRF_RTC1->PRESCALER = 0;
+    NRF_RTC1->TASKS_CLEAR = 1;
+    NRF_RTC1->CC[0] = BENCH_MS_TO_TICKS(BENCH_UPDATE_INTERVAL_MS);
+    NRF_RTC1->CC[1] = BENCH_MS_TO_TICKS(BENCH_STATS_INTERVAL_MS);
+    NRF_RTC1->EVENTS_COMPARE[0] = 0;
+    NRF_RTC1->EVENTS_COMPARE[1] = 0;
+#if BENCH_ROLE == BENCH_ROLE_POWER
+    /* the phase reports replace the periodic stats */
+    NRF_RTC1->CC[2] = BENCH_MS_TO_TICKS(BENCH_POWER_PHASE_MS);
+    NRF_RTC1->EVENTS_COMPARE[2] = 0;
+    NRF_RTC1->INTENSET = RTC_INTENSET_COMPARE0_Msk | RTC_INTENSET_COMPARE2_Msk;
+#else
+    NRF_RTC1->INTENSET = RTC_INTENSET_COMPARE0_Msk | RTC_INTENSET_COMPARE1_Msk;
+#endif
+    NVIC_SetPriority(RTC1_IRQn, 3);
+    NVIC_EnableIRQ(RTC1_IRQn);
+    NRF_RTC1->TASKS_START = 1;
+}
+
+void bench_event_handle(rbc_mesh_event_t* p_evt)
+{
+    switch (p_evt->type)
+    {
+        case RBC_MESH_EVENT_TYPE_CONFLICTING_VAL:
+        case RBC_MESH_EVENT_TYPE_NEW_VAL:
+        case RBC_MESH_EVENT_TYPE_UPDATE_VAL:
+            rx_handle(p_evt->params.rx.value_handle,
+                    p_evt->params.rx.p_data,
+                    p_evt->params.rx.data_len,
+                    p_evt->params.rx.timestamp_us);
+            break;
+
+        case RBC_MESH_EVENT_TYPE_TX:
+            if (p_evt->params.tx.value_handle == m_handle && !m_seq_on_air &&
+                seq_get(p_evt->params.tx.p_data, p_evt->params.tx.data_len) == m_seq)
+            {
+                m_seq_on_air = true;
+                record_write("T,%u,%u,%u\n", m_handle, m_seq, p_evt->params.tx.timestamp_us);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void bench_poll(void)
+{
+    if (m_update_due)
+    {
+        m_update_due = false;
+#if BENCH_ROLE == BENCH_ROLE_SOURCE
+        m_seq++;
+        update_write();
+#elif BENCH_ROLE == BENCH_ROLE_POWER
+        if (m_phase_loaded)
+        {
+#ifdef BENCH_POWER_UPDATE_PIN
+            nrf_gpio_pin_set(BENCH_POWER_UPDATE_PIN);
+#endif
+            m_seq++;
+            m_phase_updates++;
+            update_write();
+#ifdef BENCH_POWER_UPDATE_PIN
+            nrf_gpio_pin_clear(BENCH_POWER_UPDATE_PIN);
+#endif
+        }
+#endif
+    }
+    if (m_stats_due)
+    {
+        m_stats_due = false;
+        stats_write();
+    }
+#if BENCH_ROLE == BENCH_ROLE_POWER
+    if (m_phase_due)
+    {
+        m_phase_due = false;
+        phase_end();
+    }
+#endif
+}
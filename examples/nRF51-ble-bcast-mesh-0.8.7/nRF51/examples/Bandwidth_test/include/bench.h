@@ -0,0 +1,137 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef _BENCH_H__
+#define _BENCH_H__
+
+#include "rbc_mesh.h"
+#include <stdint.h>
+
+/**
+* @file Mesh benchmark roles. Every node records the values it receives, the
+*   sources record when their updates first go on air, and the sink echoes
+*   the updates back so the sources can measure the latency on their own
+*   clock. All records are written as comma separated lines on RTT channel 0,
+*   and are picked up by Script_for_test/mesh_bench.py. The power role only
+*   reports once per phase, to keep its own records out of the measurement.
+*   Select the role of the build with BENCH_ROLE.
+*/
+
+#define BENCH_ROLE_SOURCE           (0) /**< Writes a new update to its own handle periodically. */
+#define BENCH_ROLE_RELAY            (1) /**< Only takes part in the mesh. */
+#define BENCH_ROLE_SINK             (2) /**< Echoes all updates it receives. */
+#define BENCH_ROLE_MICRO            (3) /**< Times the framework's data structures at startup, then acts as a relay. */
+#define BENCH_ROLE_POWER            (4) /**< Alternates idle and update phases, and reports the energy use of each. */
+
+/** Flash location of the node handle, written by the test script. */
+#define BENCH_NODE_HANDLE_ADDR      (0x3F000)
+
+/** Offset between a source handle and the handle the sink echoes it on. */
+#define BENCH_ECHO_HANDLE_OFFSET    (0x1000)
+
+/** Time between two updates from a source. */
+#ifndef BENCH_UPDATE_INTERVAL_MS
+#define BENCH_UPDATE_INTERVAL_MS    (1000)
+#endif
+
+/** Time between two reports of the mesh counters. */
+#ifndef BENCH_STATS_INTERVAL_MS
+#define BENCH_STATS_INTERVAL_MS     (5000)
+#endif
+
+/** Batches timed in each data structure benchmark. */
+#ifndef BENCH_MICRO_ROUNDS
+#define BENCH_MICRO_ROUNDS          (1000)
+#endif
+
+/** Length of each idle and update phase of the power role. */
+#ifndef BENCH_POWER_PHASE_MS
+#define BENCH_POWER_PHASE_MS        (10000)
+#endif
+
+/** Pin held high through the update phases of the power role, to trigger a
+    power analyzer on. Define BENCH_POWER_UPDATE_PIN to also pulse a pin at
+    every update. */
+#ifndef BENCH_POWER_PHASE_PIN
+#define BENCH_POWER_PHASE_PIN       (25)
+#endif
+
+/** Power mode of the power role, one of the rbc_mesh_power_mode_t values. */
+#ifndef BENCH_POWER_MODE
+#define BENCH_POWER_MODE            (RBC_MESH_POWER_MODE_NORMAL)
+#endif
+
+/** @{ Supply currents behind the charge estimate of the power role, in
+    microamps. The defaults are for the nRF51822 at 3V without the DC/DC
+    converter. The radio is counted at the RX current, which is above the
+    0dBm TX current. */
+#ifndef BENCH_POWER_RADIO_UA
+#define BENCH_POWER_RADIO_UA        (13000) /**< Radio ramping up, receiving or transmitting. */
+#endif
+#ifndef BENCH_POWER_TIMESLOT_UA
+#define BENCH_POWER_TIMESLOT_UA     (1000)  /**< Crystal oscillator running in a timeslot, with the radio off. */
+#endif
+#ifndef BENCH_POWER_CPU_UA
+#define BENCH_POWER_CPU_UA          (4400)  /**< CPU running from flash, on top of the rest. */
+#endif
+#ifndef BENCH_POWER_SLEEP_UA
+#define BENCH_POWER_SLEEP_UA        (5)     /**< Waiting for events between timeslots. */
+#endif
+/** @} */
+
+/** Length of the source updates, must be at least 4 to fit the sequence number. */
+#ifndef BENCH_PAYLOAD_LEN
+#define BENCH_PAYLOAD_LEN           (RBC_MESH_VALUE_MAX_LEN)
+#endif
+
+/**
+* @brief Set up RTT and the benchmark timer, and write the header record.
+*   Must be called after rbc_mesh_init.
+*
+* @param[in] interval_min_ms The interval the mesh was initialized with.
+*/
+void bench_init(uint32_t interval_min_ms);
+
+#if BENCH_ROLE == BENCH_ROLE_MICRO
+/**
+* @brief Time the framework's data structures, and write an M record for
+*   each case. Must be called before rbc_mesh_init, which resets the
+*   structures the benchmarks fill.
+*/
+void bench_micro_run(void);
+#endif
+
+/** @brief Record and act on a mesh event. */
+void bench_event_handle(rbc_mesh_event_t* p_evt);
+
+/** @brief Run the periodic benchmark work, call from the main loop. */
+void bench_poll(void);
+
+#endif /* _BENCH_H__ */
@@ -48,13 +48,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "handle.h"
 #endif
 
+#if defined(BENCH_ROLE)
+#include "bench.h"
+#endif
+
 /* Debug macros for debugging with logic analyzer */
 #define SET_PIN(x) NRF_GPIO->OUTSET = (1 << (x))
 #define CLEAR_PIN(x) NRF_GPIO->OUTCLR = (1 << (x))
 #define TICK_PIN(x) do { SET_PIN((x)); CLEAR_PIN((x)); }while(0)
 
 #define MESH_ACCESS_ADDR        (RBC_MESH_ACCESS_ADDRESS_BLE_ADV)
+#ifndef MESH_INTERVAL_MIN_MS
 #define MESH_INTERVAL_MIN_MS    (100)
+#endif
 #define MESH_CHANNEL            (38)
 #define MESH_CLOCK_SOURCE       (NRF_CLOCK_LFCLKSRC_XTAL_75_PPM)
 
@@ -155,6 +161,7 @@ void sd_ble_evt_handler(ble_evt_t* p_ble_evt)
 *
 * @param[in] evt RBC event propagated from framework
 */
+#if !defined(BENCH_ROLE)
 static void rbc_mesh_event_handler(rbc_mesh_event_t* p_evt)
 {
     TICK_PIN(28);
@@ -368,6 +375,7 @@ static void rbc_mesh_event_handler(rbc_mesh_event_t* p_evt)
             break;
     }
 }
+#endif
 
 
 /**
@@ -431,6 +439,10 @@ int main(void)
 		}
     #endif
         
+#if defined(BENCH_ROLE) && (BENCH_ROLE == BENCH_ROLE_MICRO)
+    bench_micro_run();
+#endif
+
     rbc_mesh_init_params_t init_params;
 
     init_params.access_addr = MESH_ACCESS_ADDR;
@@ -482,6 +494,8 @@ int main(void)
     #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)|| defined (WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)    
     SEGGER_RTT_Init();
     SEGGER_RTT_ConfigUpBuffer(0, "UpBuffer0", UpBuffer0, BUFFER_SIZE_UP, SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    #elif defined(BENCH_ROLE)
+    bench_init(MESH_INTERVAL_MIN_MS);
     #else
     /* init BLE gateway softdevice application: */
     nrf_adv_conn_init();
@@ -493,9 +507,16 @@ int main(void)
     {
         if (rbc_mesh_event_get(&evt) == NRF_SUCCESS)
         {
+#if defined(BENCH_ROLE)
+            bench_event_handle(&evt);
+#else
             rbc_mesh_event_handler(&evt);
+#endif
             rbc_mesh_event_release(&evt);
         }
+#if defined(BENCH_ROLE)
+        bench_poll();
+#endif
 
         sd_app_evt_wait();
     }
@@ -109,6 +109,7 @@ typedef enum
     BL_RADIO_INTERVAL_TYPE_EXPONENTIAL,
     BL_RADIO_INTERVAL_TYPE_REGULAR,
     BL_RADIO_INTERVAL_TYPE_REGULAR_SLOW,
+    BL_RADIO_INTERVAL_TYPE_TRICKLE,     /**< Interval doubles after every transmit, up to a cap. Restarted by ordering the packet again. */
 } bl_radio_interval_type_t;
 
 typedef enum
@@ -167,6 +168,7 @@ struct bl_cmd
         {
             dfu_packet_t* p_dfu_packet;
             uint32_t length;
+            bool from_serial; /**< The packet came from the serial interface, not the radio. */
         } rx;
         struct
         {
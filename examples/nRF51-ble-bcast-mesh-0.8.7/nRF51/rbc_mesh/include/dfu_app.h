@@ -56,7 +56,8 @@ uint32_t dfu_init(void);
 uint32_t dfu_jump_to_bootloader(void);
 
 /**
-* Pass a dfu packet to the dfu module.
+* Pass a dfu packet to the dfu module. The packet is treated as coming from the
+* serial interface, which makes this device the source of the transfer.
 *
 * @param[in] p_packet A pointer to a DFU packet.
 * @param[in] length The length of the DFU packet.
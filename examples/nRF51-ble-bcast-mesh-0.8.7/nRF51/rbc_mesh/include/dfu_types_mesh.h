@@ -92,9 +92,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DFU_PACKET_LEN_STATE_BL     (2 + 1 + 1 + 4 + DFU_FWID_LEN_BL)
 #define DFU_PACKET_LEN_STATE_APP    (2 + 1 + 1 + 4 + DFU_FWID_LEN_APP)
 #define DFU_PACKET_LEN_START        (2 + 2 + 4 + 4 + 4 + 2 + 1)
+#define DFU_PACKET_LEN_START_DIFF   (DFU_PACKET_LEN_START + 4)
 #define DFU_PACKET_LEN_DATA         (2 + 2 + 4 + SEGMENT_LENGTH)
 #define DFU_PACKET_LEN_DATA_REQ     (2 + 2 + 4)
 #define DFU_PACKET_LEN_DATA_RSP     (2 + 2 + 4 + SEGMENT_LENGTH)
+#define DFU_PACKET_LEN_DATA_REQ_BITMAP (2 + 2 + 4 + 4)
+#define DFU_PACKET_LEN_DATA_PARITY  (2 + 2 + 4 + SEGMENT_LENGTH)
+#define DFU_PACKET_LEN_DATA_COPY    (2 + 2 + 4 + 2 + 1)
 
 #define DFU_PACKET_ADV_OVERHEAD     (1 /* adv_type */ + 2 /* UUID */) /* overhead inside adv data */
 #define DFU_PACKET_OVERHEAD         (MESH_PACKET_BLE_OVERHEAD + 1 + DFU_PACKET_ADV_OVERHEAD) /* dfu packet total overhead */
@@ -116,6 +120,9 @@ typedef uint16_t seq_t;
 
 typedef enum
 {
+    DFU_PACKET_TYPE_DATA_COPY   = 0xFFF7, /* diff transfers: segments copied from the installed image */
+    DFU_PACKET_TYPE_DATA_PARITY = 0xFFF8, /* data payload, XOR of a group of data segments */
+    DFU_PACKET_TYPE_DATA_REQ_BITMAP = 0xFFF9,
     DFU_PACKET_TYPE_DATA_RSP    = 0xFFFA,
     DFU_PACKET_TYPE_DATA_REQ    = 0xFFFB,
     DFU_PACKET_TYPE_DATA        = 0xFFFC,
@@ -188,6 +195,7 @@ typedef struct __attribute((packed))
             uint8_t first       : 1;
             uint8_t last        : 1;
             uint8_t _rfu        : 4;
+            uint32_t base_version; /* diff transfers only: app version the diff applies to */
         } start;
         struct __attribute((packed))
         {
@@ -201,6 +209,19 @@ typedef struct __attribute((packed))
             uint32_t transaction_id;
         } req_data;
         struct __attribute((packed))
+        {
+            uint16_t segment; /* first missing segment */
+            uint32_t transaction_id;
+            uint32_t missing; /* bit i is set if segment + i is missing */
+        } req_data_bitmap;
+        struct __attribute((packed))
+        {
+            uint16_t segment; /* first segment to fill */
+            uint32_t transaction_id;
+            uint16_t source_segment; /* first segment to copy from in the installed image */
+            uint8_t count;
+        } data_copy;
+        struct __attribute((packed))
         {
             uint16_t segment;
             uint32_t transaction_id;
@@ -219,6 +240,7 @@ typedef enum
     BL_INFO_TYPE_SEGMENT_SD         = 0x10,
     BL_INFO_TYPE_SEGMENT_BL         = 0x11,
     BL_INFO_TYPE_SEGMENT_APP        = 0x12,
+    BL_INFO_TYPE_SEGMENT_APP_ALT    = 0x13, /**< Inactive application slot, see DFU_APP_SLOTS. */
 
     BL_INFO_TYPE_SIGNATURE_SD       = 0x1A,
     BL_INFO_TYPE_SIGNATURE_BL       = 0x1B,
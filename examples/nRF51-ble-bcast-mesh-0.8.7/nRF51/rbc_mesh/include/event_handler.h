@@ -44,7 +44,8 @@ typedef enum
     EVENT_TYPE_TIMER_SCH,
     EVENT_TYPE_GENERIC,
     EVENT_TYPE_PACKET,
-    EVENT_TYPE_SET_FLAG
+    EVENT_TYPE_SET_FLAG,
+    EVENT_TYPE_SET_QOS
 } event_type_t;
 
 /** @brief callback type for generic asynchronous events */
@@ -87,6 +88,11 @@ typedef struct
             uint8_t flag;
             bool value;
         } set_flag;
+        struct
+        {
+            uint16_t handle;
+            uint8_t qos_class;
+        } set_qos;
     } callback;
 } async_event_t;
 
@@ -102,6 +108,12 @@ void event_handler_on_ts_end(void);
 /** @brief called from ts handler upon ts begin */
 void event_handler_on_ts_begin(void);
 
+/** @brief Whether the caller runs in the event dispatcher, executing an async event */
+bool event_handler_is_dispatching(void);
+
+/** @brief Get the number of events waiting in the async event and packet queues */
+uint32_t event_handler_queue_len_get(void);
+
 void event_handler_critical_section_begin(void);
 
 void event_handler_critical_section_end(void);
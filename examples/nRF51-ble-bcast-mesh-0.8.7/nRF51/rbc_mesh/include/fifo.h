@@ -44,6 +44,7 @@ typedef struct
   uint32_t head;
   uint32_t tail;
   fifo_memcpy memcpy_fptr; /* must be a valid function or NULL */
+  uint32_t peak_len; /* highest number of elements since init, kept with MESH_WATERMARK */
 } fifo_t;
 
 void fifo_init(fifo_t* p_fifo);
@@ -51,11 +52,48 @@ uint32_t fifo_push(fifo_t* p_fifo, const void* p_elem);
 uint32_t fifo_pop(fifo_t* p_fifo, void* p_elem);
 uint32_t fifo_peek_at(fifo_t* p_fifo, void* p_elem, uint32_t elem);
 uint32_t fifo_peek(fifo_t* p_fifo, void* p_elem);
+
+/* get a pointer to the oldest element without copying it. The element stays
+   in place until it's popped. Returns NULL if the fifo is empty. */
+void* fifo_peek_ptr(fifo_t* p_fifo);
+
+/* get a pointer to the newest element, to modify it in place. The caller must
+   mask IRQs for as long as it uses the pointer, as the element may be popped.
+   Returns NULL if the fifo is empty. */
+void* fifo_peek_newest_ptr(fifo_t* p_fifo);
+
+/* get a pointer to the element at the given index from the oldest, to modify
+   it in place. The caller must mask IRQs for as long as it uses the pointer.
+   Returns NULL if there aren't that many elements. */
+void* fifo_peek_ptr_at(fifo_t* p_fifo, uint32_t elem);
 void fifo_flush(fifo_t* p_fifo);
 uint32_t fifo_get_len(fifo_t* p_fifo);
 bool fifo_is_full(fifo_t* p_fifo);
 bool fifo_is_empty(fifo_t* p_fifo);
 
+/* Single producer, single consumer mode, without IRQ masking. A fifo used
+   with these functions must be pushed from exactly one context and popped
+   from exactly one other context, and must not be used with the masked
+   push/pop/peek/flush functions above. The length getters are safe from
+   both sides. */
+uint32_t fifo_spsc_push(fifo_t* p_fifo, const void* p_elem);
+uint32_t fifo_spsc_pop(fifo_t* p_fifo, void* p_elem);
+
+/* producer side: get the next free slot to build an element in place, and
+   publish it with fifo_spsc_push_commit(). Returns NULL if the fifo is full. */
+void* fifo_spsc_push_reserve(fifo_t* p_fifo);
+void fifo_spsc_push_commit(fifo_t* p_fifo);
+
+/* consumer side: get the oldest element in place, and free its slot with
+   fifo_spsc_pop_release(). Returns NULL if the fifo is empty. */
+void* fifo_spsc_pop_reserve(fifo_t* p_fifo);
+void fifo_spsc_pop_release(fifo_t* p_fifo);
+
+/* consumer side: drop all elements up to the given head value, as returned
+   by fifo_spsc_head_get() in the producer context. */
+uint32_t fifo_spsc_head_get(fifo_t* p_fifo);
+void fifo_spsc_flush_to(fifo_t* p_fifo, uint32_t head);
+
 
 
 #endif /* _FIFO_H_ */
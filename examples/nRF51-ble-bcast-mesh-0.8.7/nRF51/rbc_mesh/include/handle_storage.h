@@ -39,6 +39,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define MESH_VALUE_LOLLIPOP_LIMIT       (200)
 
+/** Upper limit to the number of packets returned by a single call to
+  @ref handle_storage_tx_packets_get. */
+#define HANDLE_STORAGE_TX_PACKETS_MAX   (RBC_MESH_RADIO_QUEUE_LENGTH)
+
 typedef struct
 {
     uint16_t version;
@@ -63,9 +67,44 @@ uint32_t handle_storage_min_interval_set(uint32_t min_interval_us);
 */
 uint32_t handle_storage_info_get(uint16_t handle, handle_info_t* p_info);
 
+/**
+* Copy the value and version of the given handle out of the cache without
+*   the critical section. Starts over if an update of the value races the
+*   copy, and gives up with NRF_ERROR_BUSY after RBC_MESH_VALUE_READ_ATTEMPTS
+*   tries. May be called from any context.
+*/
+uint32_t handle_storage_value_read(uint16_t handle, uint8_t* p_data, uint16_t* p_length, uint16_t* p_version);
+
+/**
+* Get a pointer to the cached value of a persistent or static handle without
+*   copying it. The returned token must be checked with
+*   handle_storage_value_peek_check() after reading the value, as an update
+*   may change it under the reader. May be called from any context.
+*/
+uint32_t handle_storage_value_peek(uint16_t handle, const uint8_t** pp_data, uint16_t* p_length, uint32_t* p_token);
+
+/** Returns NRF_SUCCESS if the value peeked with the given token hasn't changed since. */
+uint32_t handle_storage_value_peek_check(uint32_t token);
+
+/**
+* Copy the next cached value at or after the cursor, and move the cursor past
+*   it. Start with the cursor at 0, and stop at NRF_ERROR_NOT_FOUND. The
+*   cursor is a position in the handle cache, and stays valid between calls,
+*   but values cached or changed during the walk may or may not be visited.
+*/
+uint32_t handle_storage_value_next(uint16_t* p_cursor, uint16_t* p_handle, uint8_t* p_data, uint16_t* p_length, uint16_t* p_version);
+
 /** MUST BE CALLED FROM EVENT HANDLER CONTEXT */
 uint32_t handle_storage_info_set(uint16_t handle, handle_info_t* p_info);
 
+/**
+* Same as handle_storage_info_set, for handles the application doesn't
+*   subscribe to. New entries for these share RBC_MESH_RELAY_CACHE_ENTRIES
+*   handle cache entries, and never push out the subscribed handles.
+*   MUST BE CALLED FROM EVENT HANDLER CONTEXT
+*/
+uint32_t handle_storage_relay_info_set(uint16_t handle, handle_info_t* p_info);
+
 uint32_t handle_storage_local_packet_push(mesh_packet_t* p_packet);
 
 /** MUST BE CALLED FROM EVENT HANDLER CONTEXT */
@@ -73,12 +112,84 @@ uint32_t handle_storage_flag_set(uint16_t handle, handle_flag_t flag, bool value
 
 uint32_t handle_storage_flag_set_async(uint16_t handle, handle_flag_t flag, bool value);
 
+/**
+* Apply the given flag changes in order, in one critical section. Stops at
+*   the first failing change. May be called from any context at or below the
+*   event handler priority.
+*/
+uint32_t handle_storage_flag_set_bulk(const rbc_mesh_flag_op_t* p_ops, uint32_t count, uint32_t* p_applied_count);
+
+/** Same as handle_storage_flag_set_bulk, for one flag over a range of handles. */
+uint32_t handle_storage_flag_set_range(uint16_t first, uint16_t last, rbc_mesh_handle_flag_t flag, bool value);
+
 uint32_t handle_storage_flag_get(uint16_t handle, handle_flag_t flag, bool* p_value);
 
-uint32_t handle_storage_rx_consistent(uint16_t handle, uint32_t timestamp);
+/** MUST BE CALLED FROM EVENT HANDLER CONTEXT */
+uint32_t handle_storage_qos_set(uint16_t handle, rbc_mesh_qos_class_t qos_class);
+
+uint32_t handle_storage_qos_set_async(uint16_t handle, rbc_mesh_qos_class_t qos_class);
+
+uint32_t handle_storage_qos_get(uint16_t handle, rbc_mesh_qos_class_t* p_qos_class);
+
+uint32_t handle_storage_trickle_stats_get(uint16_t handle, rbc_mesh_handle_stats_t* p_stats);
+
+/** Register a consistent RX, counting as weight/TRICKLE_RX_WEIGHT_FULL of one toward suppression. */
+uint32_t handle_storage_rx_consistent(uint16_t handle, uint32_t timestamp, uint8_t weight);
+
+/** Register a consistent RX like handle_storage_rx_consistent(), if the stored
+ * version is the given one. Returns NRF_ERROR_INVALID_STATE if it isn't. */
+uint32_t handle_storage_rx_duplicate(uint16_t handle, uint16_t version, uint32_t timestamp, uint8_t weight);
 
 uint32_t handle_storage_rx_inconsistent(uint16_t handle, uint32_t timestamp);
 
+/** Move the next TX of the given handle to the first half of its interval. */
+uint32_t handle_storage_tx_advance(uint16_t handle, uint32_t timestamp);
+
+/**
+* Restart the trickle interval of enabled values in the data cache, to have
+*   them sent to a neighbour that just started. Values are counted in the
+*   order they were last used, most recent first.
+*
+* @param[in] offset Number of values to skip.
+* @param[in] count Highest number of values to restart.
+* @param[in] timestamp Time to restart the intervals at.
+*/
+void handle_storage_sync_reset(uint32_t offset, uint32_t count, uint32_t timestamp);
+
+/**
+* Summarize the enabled values in the data cache in a set of handle ranges.
+*   The digest of a range is an order independent hash of the handles and
+*   versions of its values, so two nodes holding the same values in a range
+*   get the same digest.
+*
+* @param[in] p_ranges Handle ranges to summarize. Ranges with first > last
+*   are empty.
+* @param[in] range_count Number of ranges.
+* @param[out] p_digests Digest of each range.
+* @param[out] p_counts Number of values in each range.
+*/
+void handle_storage_digest_get(const rbc_mesh_handle_range_t* p_ranges, uint32_t range_count, uint32_t* p_digests, uint16_t* p_counts);
+
+/**
+* Register a consistent RX on all enabled values in the given handle range,
+*   enough to suppress their transmissions for the rest of their current
+*   trickle intervals. MUST BE CALLED FROM EVENT HANDLER CONTEXT
+*/
+void handle_storage_range_consistent(uint16_t first, uint16_t last, uint32_t timestamp);
+
+/**
+* Register an inconsistent RX on all enabled values in the given handle
+*   range. MUST BE CALLED FROM EVENT HANDLER CONTEXT
+*/
+void handle_storage_range_inconsistent(uint16_t first, uint16_t last, uint32_t timestamp);
+
+/**
+* Get the earliest TX deadline among the enabled values in the data cache.
+*
+* @param[out] p_found_value Set to whether there are any values to transmit.
+*
+* @return The earliest TX deadline, if p_found_value was set.
+*/
 uint32_t handle_storage_next_timeout_get(bool* p_found_value);
 
 /**
@@ -90,8 +201,9 @@ uint32_t handle_storage_next_timeout_get(bool* p_found_value);
 * @param[out] pp_tx_packets An array of packet pointers to be filled by the
 *   function.
 * @param[in,out] p_count The maximum number of elements the given array can
-*   hold. When returned, the argument contains the number of packets filled
-*   into the array by the function.
+*   hold, capped at HANDLE_STORAGE_TX_PACKETS_MAX. When returned, the argument
+*   contains the number of packets filled into the array by the function.
+*   Packets are returned in order of QoS class priority, then TX deadline.
 */
 uint32_t handle_storage_tx_packets_get(uint32_t time_now, mesh_packet_t** pp_packets, uint32_t* p_count);
 
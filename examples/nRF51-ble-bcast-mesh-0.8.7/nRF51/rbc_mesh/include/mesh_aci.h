@@ -36,6 +36,36 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdint.h>
 #include <stdbool.h>
 
+/** @brief Pack value events into SERIAL_EVT_OPCODE_EVENT_BATCH frames instead
+ * of sending one frame per event. The host must be able to decode batches. */
+#ifndef MESH_ACI_EVENT_BATCH
+#define MESH_ACI_EVENT_BATCH                (0)
+#endif
+
+/** @brief Longest time a value event may wait in a partially filled batch frame. */
+#ifndef MESH_ACI_EVENT_BATCH_TIMEOUT_US
+#define MESH_ACI_EVENT_BATCH_TIMEOUT_US     (2000)
+#endif
+
+/** @brief Most value dump frames sent for each value dump command. Must be
+ * less than SERIAL_HANDLER_TX_QUEUE_LENGTH, to leave room for the response. */
+#ifndef MESH_ACI_VALUE_DUMP_FRAMES
+#define MESH_ACI_VALUE_DUMP_FRAMES          (3)
+#endif
+
+/** @brief Enable the packet sniffer commands. While started, the sniffer
+ * takes over the packet peek callback, and streams a record of every received
+ * mesh packet that passes its filter to the host in
+ * SERIAL_EVT_OPCODE_EVENT_SNIFFER frames. */
+#ifndef MESH_ACI_SNIFFER
+#define MESH_ACI_SNIFFER                    (0)
+#endif
+
+/** @brief Longest time a packet record may wait in a partially filled sniffer frame. */
+#ifndef MESH_ACI_SNIFFER_TIMEOUT_US
+#define MESH_ACI_SNIFFER_TIMEOUT_US         (10000)
+#endif
+
 typedef __packed_armcc enum
 {
   ACI_STATUS_SUCCESS                                        = 0x00,
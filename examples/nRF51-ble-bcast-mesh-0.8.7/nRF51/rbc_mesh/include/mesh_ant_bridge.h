@@ -0,0 +1,133 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_ANT_BRIDGE_H__
+#define MESH_ANT_BRIDGE_H__
+
+#include <stdint.h>
+#include "rbc_mesh.h"
+#include "ant_stack_handler_types.h"
+
+/**
+ * @defgroup MESH_ANT_BRIDGE ANT+ to mesh bridge
+ * Optional ANT receive channel, enabled by defining RBC_MESH_ANT_BRIDGE, that
+ * brings the broadcast data pages of an ANT+ sensor into the mesh. Needs a
+ * Softdevice with both the BLE and ANT stacks, whose scheduler shares the
+ * radio between the ANT channel and the mesh timeslots, so the bridge never
+ * touches the radio itself.
+ *
+ * Each data page number is mapped to a mesh handle. A page is published as
+ * its 8 byte payload, and only when it has changed since it was last
+ * published. Byte 0, the page number with its toggle bit, and the bytes in
+ * the mapping's ignore mask, like event counters, are left out of the
+ * comparison. A handle is published at
+ * most once every RBC_MESH_ANT_BRIDGE_INTERVAL_MS, and changes within that
+ * time are coalesced, so that only the latest is published when the interval
+ * has passed. The sensor's 4 Hz message rate thereby only becomes mesh
+ * traffic when the measurement changes.
+ *
+ * The application keeps the network key and the event pump, and passes every
+ * ANT event to mesh_ant_bridge_ant_evt_handler(), from thread context, as
+ * the values are set with rbc_mesh_value_set(). Build with
+ * ANT_STACK_SUPPORT_REQD for the Softdevice handler's ant_evt_t.
+ * @{
+ */
+
+/** Maps one ANT+ data page to a mesh handle. */
+typedef struct
+{
+    uint8_t page;                       /**< Data page number, without the toggle bit. */
+    uint8_t ignore_mask;                /**< Payload bytes left out of the change check, bit 1 for byte 1 and so on. */
+    rbc_mesh_value_handle_t handle;     /**< Handle to publish the page on. */
+} mesh_ant_bridge_page_t;
+
+/** ANT channel and page mapping of the bridge. */
+typedef struct
+{
+    uint8_t channel;                    /**< ANT channel to receive on. */
+    uint8_t network;                    /**< Network number, with the key already set by the application. */
+    uint16_t device_number;             /**< Device number of the sensor, 0 for the first one found. */
+    uint8_t device_type;                /**< ANT+ device type of the sensor. */
+    uint8_t transmission_type;          /**< Transmission type, 0 for any. */
+    uint8_t rf_freq;                    /**< RF channel, 57 for ANT+. */
+    uint16_t period;                    /**< Channel period of the sensor profile, in 1/32768 s. */
+    uint8_t page_count;                 /**< Number of entries in p_pages. */
+    const mesh_ant_bridge_page_t* p_pages; /**< Page mapping, kept by the application. */
+} mesh_ant_bridge_config_t;
+
+/** Counters of the bridge, reset by mesh_ant_bridge_init(). */
+typedef struct
+{
+    uint32_t messages;                  /**< Broadcast and acknowledged messages received. */
+    uint32_t unmapped;                  /**< Messages with a page that isn't mapped. */
+    uint32_t unchanged;                 /**< Messages with a page equal to the one last published. */
+    uint32_t coalesced;                 /**< Changes replaced by a later change before being published. */
+    uint32_t values_set;                /**< Values set in the mesh. */
+    uint32_t set_failures;              /**< Values the mesh refused, retried on the next event. */
+    uint32_t rx_fails;                  /**< Messages the channel missed. */
+} mesh_ant_bridge_stats_t;
+
+/**
+ * Open the ANT receive channel. Must be called after rbc_mesh_init(), the
+ * Softdevice ANT stack enable and the network key set, and the mapped handles
+ * must be within the application handle range.
+ *
+ * @param[in] p_config Channel and page mapping.
+ *
+ * @return NRF_SUCCESS The channel was opened.
+ * @return NRF_ERROR_NULL p_config or its page mapping is NULL.
+ * @return NRF_ERROR_INVALID_PARAM The mapping is empty, larger than
+ *  RBC_MESH_ANT_BRIDGE_PAGES_MAX, or maps a handle outside the application
+ *  range.
+ * @return NRF_ERROR_INVALID_STATE The bridge has already been started.
+ * @return Any error from the Softdevice ANT channel setup.
+ */
+uint32_t mesh_ant_bridge_init(const mesh_ant_bridge_config_t* p_config);
+
+/**
+ * Get the bridge counters.
+ *
+ * @param[out] p_stats Structure to fill.
+ *
+ * @return NRF_SUCCESS The counters were fetched.
+ * @return NRF_ERROR_NULL p_stats is NULL.
+ */
+uint32_t mesh_ant_bridge_stats_get(mesh_ant_bridge_stats_t* p_stats);
+
+/**
+ * Handle an ANT event. Events for other channels are ignored, so all ANT
+ * events may be passed on. Has the signature of an ant_evt_handler_t.
+ *
+ * @param[in] p_ant_evt Event fetched from the Softdevice.
+ */
+void mesh_ant_bridge_ant_evt_handler(ant_evt_t* p_ant_evt);
+
+/** @} */
+
+#endif /* MESH_ANT_BRIDGE_H__ */
@@ -0,0 +1,115 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_AUTH_H__
+#define MESH_AUTH_H__
+
+#include <stdint.h>
+#include "mesh_packet.h"
+
+/**
+ * @defgroup MESH_AUTH Value authentication
+ * Authenticates mesh values with a network key shared by all devices, when
+ * built with MESH_AUTH. Every value packet ends in a trailer of
+ * RBC_MESH_AUTH_OVERHEAD bytes: the sequence number of the originating
+ * device, and a 4 byte AES-CCM MIC over the handle, version and value, with
+ * the originator address and the sequence number as nonce. The originator
+ * signs a value once, and relays pass the packet on untouched, so the MIC
+ * holds end to end. A sequence number of 0 marks a packet that hasn't been
+ * signed yet.
+ *
+ * Receivers keep the highest sequence number of the last
+ * RBC_MESH_AUTH_SOURCES originators, and drop values more than
+ * RBC_MESH_AUTH_REPLAY_WINDOW below it.
+ *
+ * The AES blocks are computed by the ECB peripheral, through the Softdevice
+ * when it's present, which takes some 4 blocks for a legacy packet. Unsigned
+ * packets and replays are rejected before any blocks are computed. The CCM
+ * peripheral can't do the work inline with the radio: it needs the nonce
+ * before the packet arrives, while every originator has its own sequence
+ * number, and the nRF51 CCM only takes 27 byte payloads, which a mesh
+ * advertisement exceeds.
+ * @{
+ */
+
+/** Forget the key and the replay table. */
+void mesh_auth_init(void);
+
+/**
+ * Set the network key and the next sequence number to sign with.
+ *
+ * @param[in] p_key 16 byte AES key. Copied by the module.
+ * @param[in] seq_start First sequence number to sign with.
+ *
+ * @return NRF_SUCCESS The key was set.
+ * @return NRF_ERROR_INVALID_PARAM seq_start is 0.
+ * @return NRF_ERROR_NOT_SUPPORTED Built without MESH_AUTH.
+ */
+uint32_t mesh_auth_key_set(const uint8_t* p_key, uint32_t seq_start);
+
+/**
+ * Get the next sequence number to sign with.
+ *
+ * @param[out] p_seq The next sequence number.
+ *
+ * @return NRF_SUCCESS The sequence number was read.
+ * @return NRF_ERROR_NOT_SUPPORTED Built without MESH_AUTH.
+ */
+uint32_t mesh_auth_seq_get(uint32_t* p_seq);
+
+/**
+ * Sign a value packet originated by this device, unless it's signed already.
+ * The handle, version and value may not change after signing.
+ *
+ * @param[in,out] p_packet Value packet to sign.
+ *
+ * @return NRF_SUCCESS The packet is signed.
+ * @return NRF_ERROR_INVALID_STATE No key has been set.
+ * @return NRF_ERROR_INVALID_DATA The packet isn't a value packet.
+ * @return NRF_ERROR_INTERNAL The Softdevice refused the ECB operation.
+ */
+uint32_t mesh_auth_packet_sign(mesh_packet_t* p_packet);
+
+/**
+ * Check the MIC and sequence number of a received value packet, and record
+ * the sequence number of its originator if it passes.
+ *
+ * @param[in] p_packet Received value packet.
+ *
+ * @return NRF_SUCCESS The packet is authentic.
+ * @return NRF_ERROR_INVALID_STATE No key has been set.
+ * @return NRF_ERROR_INVALID_DATA The packet is unsigned, its MIC doesn't
+ *   match, or its sequence number is a replay.
+ * @return NRF_ERROR_INTERNAL The Softdevice refused the ECB operation.
+ */
+uint32_t mesh_auth_packet_verify(const mesh_packet_t* p_packet);
+
+/** @} */
+
+#endif /* MESH_AUTH_H__ */
@@ -0,0 +1,119 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_COEX_H__
+#define MESH_COEX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_COEX Radio coexistence arbiter
+ * Fits the mesh timeslots around the other users of the Softdevice scheduler.
+ * The timing of the Softdevice's own radio events, like the connection events
+ * of a connected phone, is learned from the radio notifications passed on by
+ * the application. While the events come at a regular interval, the timeslots
+ * are requested no longer than the gap between two events, so they are
+ * granted between them instead of being blocked. While the application has
+ * Softdevice flash operations pending, a gap is left after each timeslot for
+ * the flash operation to be scheduled in. The radio time taken by each user is
+ * counted in @ref rbc_mesh_coex_stats_t.
+ * @{
+ */
+
+/** Reset the learned timing and the counters. */
+void mesh_coex_init(void);
+
+/**
+ * Register a radio notification. See rbc_mesh_radio_notification_handler().
+ *
+ * @param[in] radio_active Whether the Softdevice radio event is about to
+ *  start, or has ended.
+ */
+void mesh_coex_radio_notification(bool radio_active);
+
+/**
+ * Set whether the application has Softdevice flash operations pending.
+ *
+ * @param[in] pending Whether flash operations are pending.
+ */
+void mesh_coex_sd_flash_pending_set(bool pending);
+
+/**
+ * Get the length to request for a timeslot.
+ *
+ * @param[in] preferred_us The length the timeslot module would request with
+ *  the radio to itself.
+ *
+ * @return The preferred length, shortened to fit between the Softdevice's
+ *  regular radio events, if any.
+ */
+timestamp_t mesh_coex_slot_length_get(timestamp_t preferred_us);
+
+/**
+ * Check whether the current timeslot may be extended.
+ *
+ * @return false if the extension would run into a regular Softdevice radio
+ *  event or delay pending flash operations, true otherwise.
+ */
+bool mesh_coex_extend_allowed(void);
+
+/**
+ * Get the time to leave free after a timeslot.
+ *
+ * @return The gap to leave for pending Softdevice flash operations, or 0 to
+ *  request the next timeslot as early as possible.
+ */
+timestamp_t mesh_coex_gap_get(void);
+
+/**
+ * Register the end of a timeslot.
+ *
+ * @param[in] length_us Time spent in the timeslot.
+ */
+void mesh_coex_timeslot_end(timestamp_t length_us);
+
+/** Register a timeslot request blocked by the Softdevice. */
+void mesh_coex_blocked(void);
+
+/** Register a timeslot canceled by the Softdevice. */
+void mesh_coex_canceled(void);
+
+/**
+ * Get the radio time counters.
+ *
+ * @param[out] p_stats Structure to fill.
+ */
+void mesh_coex_stats_get(rbc_mesh_coex_stats_t* p_stats);
+
+/** @} */
+
+#endif /* MESH_COEX_H__ */
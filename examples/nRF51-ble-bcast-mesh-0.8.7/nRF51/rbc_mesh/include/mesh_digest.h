@@ -0,0 +1,81 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_DIGEST_H__
+#define MESH_DIGEST_H__
+
+#include <stdint.h>
+#include "timer.h"
+#include "mesh_packet.h"
+
+/**
+ * @defgroup MESH_DIGEST Value digest exchange
+ * Lets neighbours with the same values stop retransmitting them. While
+ * started, the node periodically sends a digest packet summarizing the
+ * values it holds in MESH_DIGEST_BUCKETS parts of a handle range, starting
+ * with all application handles. A node receiving a digest compares it to its
+ * own values: the values in the parts that match are suppressed for the rest
+ * of their trickle intervals, as if their packets had been heard k times. For
+ * a part that doesn't match, the node answers with a digest of only that
+ * part, so the exchange drills down to the differing values. Once a part
+ * holds few values, they are sent right away instead. Digests are always
+ * processed, whether the node sends them itself or not.
+ * @{
+ */
+
+/** Number of parts of the handle range in a digest packet. */
+#define MESH_DIGEST_BUCKETS     (4)
+
+/** Stop sending digests. */
+void mesh_digest_init(void);
+
+/**
+ * Start sending digests, or change the interval.
+ *
+ * @param[in] interval_us Average time between two digests of all
+ *   application handles.
+ */
+void mesh_digest_start(timestamp_t interval_us);
+
+/** Stop sending digests. */
+void mesh_digest_stop(void);
+
+/**
+ * Compare a received digest to the local values. Called by the transport in
+ * the event handler context.
+ *
+ * @param[in] p_adv_data Received advertisement data, with the
+ *   MESH_DIGEST_HANDLE handle.
+ * @param[in] timestamp Time of reception.
+ */
+void mesh_digest_rx(mesh_adv_data_t* p_adv_data, timestamp_t timestamp);
+
+/** @} */
+
+#endif /* MESH_DIGEST_H__ */
@@ -0,0 +1,79 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_FAULTLOG_H__
+#define MESH_FAULTLOG_H__
+
+#include <stdint.h>
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_FAULTLOG Fault log
+ * Optional log of the faults that brought the node down, enabled by defining
+ * MESH_FAULTLOG. A fault is only captured in RAM when it happens, in the
+ * .noinit section like the values of @ref MESH_RETAIN, so the error handler
+ * never waits for the flash, which may be what failed. When the framework is
+ * initialized after the reset, the record is written through mesh_flash to a
+ * slot of the flash ring at RBC_MESH_FAULTLOG_FLASH_ADDR that was erased
+ * ahead of time, and the page holding the oldest faults is erased in normal
+ * operation when the ring fills up. The log is read with
+ * rbc_mesh_fault_get(), or over the serial and GATT interfaces.
+ *
+ * After a power loss the RAM is random, and the record in it fails its check.
+ * @{
+ */
+
+/** Find the end of the log in flash, and commit the fault captured before the last reset. */
+void mesh_faultlog_init(void);
+
+/** Capture a fault in RAM, see @ref rbc_mesh_fault_capture. */
+void mesh_faultlog_capture(rbc_mesh_fault_type_t type, uint32_t error_code, uint32_t pc, uint32_t lr, uint16_t line);
+
+/**
+ * Capture a hard fault from its exception frame, and reset. Called by the
+ * HardFault_Handler of the module, with the stack the frame was pushed to.
+ *
+ * @param[in] p_frame Exception frame: r0-r3, r12, lr, pc and xpsr.
+ */
+void mesh_faultlog_hardfault_capture(const uint32_t* p_frame);
+
+/**
+ * Read a fault from the log in flash.
+ *
+ * @param[in] index Index of the fault, 0 for the latest one.
+ * @param[out] p_record Fault record to fill.
+ *
+ * @return NRF_SUCCESS The record was filled.
+ * @return NRF_ERROR_NOT_FOUND The log holds fewer faults than index + 1.
+ */
+uint32_t mesh_faultlog_get(uint8_t index, rbc_mesh_fault_record_t* p_record);
+
+/** @} */
+
+#endif /* MESH_FAULTLOG_H__ */
@@ -35,12 +35,72 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "timer.h"
 #include "bl_if.h"
 
+/** Length of each slice of a page erase, on chips with partial erase. The
+ * slices fit in the spare time of ordinary timeslots, instead of holding the
+ * radio for the full page erase time. 0 to always erase whole pages. */
+#ifndef MESH_FLASH_PARTIAL_ERASE_MS
+#define MESH_FLASH_PARTIAL_ERASE_MS         (10)
+#endif
+
 typedef void(*mesh_flash_op_cb_t)(flash_op_type_t type, void* p_location);
+/** End callback for a single operation, called with the data pointer of a
+ * write, or the start address of an erase. */
+typedef void(*mesh_flash_op_end_cb_t)(void* p_location);
+
+/** Flash operation queue usage. */
+typedef struct
+{
+    uint32_t length;        /**< Number of queue entries in use. */
+    uint32_t peak_length;   /**< Highest number of queue entries in use since bootup. */
+    uint32_t pushed;        /**< Number of operations pushed since bootup. */
+    uint32_t merged;        /**< Number of pushed operations merged into an already queued entry. */
+    uint32_t rejected;      /**< Number of operations rejected because the queue was full. */
+} mesh_flash_queue_stats_t;
 
 uint32_t mesh_flash_init(mesh_flash_op_cb_t cb);
 uint32_t mesh_flash_op_push(flash_op_type_t type, const flash_op_t* p_op);
+
+/**
+ * Push a flash operation that is reported to its own end callback instead of
+ * the one given to @ref mesh_flash_init. Allows modules other than the DFU to
+ * share the flash operation queue, and doesn't require the module to be
+ * initialized.
+ *
+ * @param[in] type Type of operation.
+ * @param[in] p_op Operation parameters. The data of a write must stay valid
+ *  until the end callback is called.
+ * @param[in] cb End callback, called from the event handler context.
+ */
+uint32_t mesh_flash_op_push_cb(flash_op_type_t type, const flash_op_t* p_op, mesh_flash_op_end_cb_t cb);
+/**
+ * Set a write to be executed before all queued operations, as soon as a
+ * timeslot has time for it. Meant for short writes that can't wait for the
+ * queue, like the record written when the supply voltage drops. There is no
+ * end callback, see @ref mesh_flash_urgent_pending.
+ *
+ * @param[in] p_op Write parameters. The data must stay valid until the write
+ *  is done.
+ *
+ * @return NRF_SUCCESS The write will be executed.
+ * @return NRF_ERROR_INVALID_ADDR The flash or RAM address isn't word aligned.
+ * @return NRF_ERROR_INVALID_LENGTH The length isn't a whole number of words,
+ *  or the write would be broken up.
+ * @return NRF_ERROR_BUSY Another urgent write hasn't been executed yet.
+ */
+uint32_t mesh_flash_op_push_urgent(const flash_op_t* p_op);
+/** Whether the write set with @ref mesh_flash_op_push_urgent is yet to be executed. */
+bool mesh_flash_urgent_pending(void);
 uint32_t mesh_flash_op_available_slots(void);
 bool mesh_flash_in_progress(void);
+
+/**
+ * Get the flash operation queue usage. Writes and erases that continue the
+ * newest queued operation in both flash and RAM, with the same length, are
+ * merged into its queue entry, but are still reported as ended one by one.
+ *
+ * @param[out] p_stats Structure to fill.
+ */
+void mesh_flash_queue_stats_get(mesh_flash_queue_stats_t* p_stats);
 void mesh_flash_op_execute(timestamp_t available_time);
 
 /**
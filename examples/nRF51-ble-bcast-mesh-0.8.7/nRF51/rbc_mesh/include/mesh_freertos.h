@@ -0,0 +1,87 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_FREERTOS_H__
+#define MESH_FREERTOS_H__
+
+#include <stdint.h>
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_FREERTOS FreeRTOS integration
+ * Optional delivery of the mesh events to a FreeRTOS task, enabled by
+ * defining RBC_MESH_FREERTOS. The framework itself keeps running in the
+ * timeslot and event handler interrupts, but the application no longer polls
+ * rbc_mesh_event_get() from a main loop. Each event pushed to the application
+ * queue pends a software interrupt, which notifies a task created by this
+ * module. The task blocks on the notification without a timeout, gets all
+ * queued events, and passes them to the application's handler.
+ *
+ * The task doesn't need the tick while blocked, so it doesn't keep the kernel
+ * out of tickless idle (configUSE_TICKLESS_IDLE). The software interrupt wakes
+ * the CPU from portSUPPRESS_TICKS_AND_SLEEP like any other interrupt.
+ *
+ * The task runs at RBC_MESH_FREERTOS_TASK_PRIORITY, with a stack of
+ * RBC_MESH_FREERTOS_TASK_STACK_SIZE words. The software interrupt is SWI3, at
+ * APP_IRQ_PRIORITY_LOW.
+ * @{
+ */
+
+/**
+ * Application handler for mesh events, called from the mesh event task. The
+ * event is released by the module when the handler returns.
+ *
+ * @param[in] p_evt Mesh event.
+ */
+typedef void (*mesh_freertos_event_handler_t)(rbc_mesh_event_t* p_evt);
+
+/**
+ * Create the mesh event task. Must be called after rbc_mesh_init(), and
+ * before vTaskStartScheduler(). Events already queued are delivered when the
+ * scheduler starts.
+ *
+ * @param[in] event_handler Handler called for each mesh event.
+ *
+ * @return NRF_SUCCESS The task was created.
+ * @return NRF_ERROR_NULL The handler is NULL.
+ * @return NRF_ERROR_INVALID_STATE The task has already been created.
+ * @return NRF_ERROR_NO_MEM The FreeRTOS heap is too small for the task.
+ */
+uint32_t mesh_freertos_init(mesh_freertos_event_handler_t event_handler);
+
+/**
+ * Wake the mesh event task. Called by the framework for each event pushed to
+ * the application queue, from any interrupt priority, including the
+ * timeslot context.
+ */
+void mesh_freertos_event_notify(void);
+
+/** @} */
+
+#endif /* MESH_FREERTOS_H__ */
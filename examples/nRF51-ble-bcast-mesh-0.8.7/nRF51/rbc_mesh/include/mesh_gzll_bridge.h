@@ -0,0 +1,142 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_GZLL_BRIDGE_H__
+#define MESH_GZLL_BRIDGE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_GZLL_BRIDGE Gazell to mesh bridge
+ * Optional Gazell host, enabled by defining RBC_MESH_GZLL_BRIDGE, that lets
+ * battery powered Gazell devices, like wall remotes, set mesh values without
+ * running the mesh themselves. Every RBC_MESH_GZLL_BRIDGE_PERIOD_MS, one mesh
+ * timeslot is handed to Gazell in host mode instead of to the mesh. The
+ * window is not extended, and ends with Gazell disabled before the timeslot
+ * ends. Mesh timeslots are not extended past the start of a due window.
+ *
+ * Each Gazell packet carries one or more commands, each a little endian
+ * 16 bit handle, a length byte, and that many bytes of value contents.
+ * Commands are batched by handle, so that only the latest value of each handle
+ * is kept, and the batch is passed to rbc_mesh_value_set_bulk() from the event
+ * handler after each window.
+ *
+ * The devices must keep retransmitting for at least a full period, so set
+ * their maximum number of transmit attempts (nrf_gzll_set_max_tx_attempts)
+ * to cover RBC_MESH_GZLL_BRIDGE_PERIOD_MS at the Gazell timeslot period.
+ *
+ * Link the default Gazell library (gzll_gcc.a or gzll_arm.lib). It uses
+ * TIMER2, SWI0 and PPI channels 0 to 2, none of which the mesh uses, but SWI0
+ * is also used by app_timer, which can't be used on the bridge.
+ * @{
+ */
+
+/** Gazell addressing of the bridge. */
+typedef struct
+{
+    uint32_t base_address_0;    /**< Base address of pipe 0. */
+    uint32_t base_address_1;    /**< Base address of pipes 1 to 7. */
+    uint8_t rx_pipes;           /**< Bit mask of the pipes to receive commands on. */
+} mesh_gzll_bridge_config_t;
+
+/** Counters of the bridge, reset by mesh_gzll_bridge_init(). */
+typedef struct
+{
+    uint32_t windows;           /**< Gazell windows. */
+    uint32_t window_us;         /**< Time spent in Gazell windows. */
+    uint32_t packets;           /**< Gazell packets received. */
+    uint32_t commands;          /**< Commands received. */
+    uint32_t merged;            /**< Commands replacing an earlier command for the same handle in the batch. */
+    uint32_t dropped;           /**< Malformed commands, and commands dropped because the batch was full. */
+    uint32_t values_set;        /**< Values set in the mesh. */
+    uint32_t forced_stops;      /**< Windows where Gazell didn't disable in time, and was stopped. Disables the bridge. */
+} mesh_gzll_bridge_stats_t;
+
+/**
+ * Start handing timeslots to Gazell. Must be called after rbc_mesh_init().
+ * Gazell itself is initialized in the first window, as it needs the radio.
+ *
+ * @param[in] p_config Gazell addressing, or NULL for the Gazell defaults on
+ *  all pipes.
+ *
+ * @return NRF_SUCCESS The bridge was started.
+ * @return NRF_ERROR_INVALID_PARAM No pipes are enabled.
+ * @return NRF_ERROR_INVALID_STATE The bridge has already been started.
+ */
+uint32_t mesh_gzll_bridge_init(const mesh_gzll_bridge_config_t* p_config);
+
+/**
+ * Get the bridge counters.
+ *
+ * @param[out] p_stats Structure to fill.
+ *
+ * @return NRF_SUCCESS The counters were fetched.
+ * @return NRF_ERROR_NULL p_stats is NULL.
+ */
+uint32_t mesh_gzll_bridge_stats_get(mesh_gzll_bridge_stats_t* p_stats);
+
+/**
+ * Check whether a Gazell window is due. Called by the timeslot module.
+ *
+ * @param[in] now Current time.
+ *
+ * @return true if the bridge is started, and a period has passed since the
+ *  start of the last window.
+ */
+bool mesh_gzll_bridge_window_due(timestamp_t now);
+
+/**
+ * Hand the timeslot that just started to Gazell. Called by the timeslot
+ * module instead of starting the mesh.
+ *
+ * @param[in] start_time Start time of the timeslot.
+ * @param[in] deadline_us Time into the timeslot by which Gazell must be
+ *  disabled.
+ */
+void mesh_gzll_bridge_window_start(timestamp_t start_time, timestamp_t deadline_us);
+
+/** Pass a RADIO signal in a Gazell window on to Gazell. */
+void mesh_gzll_bridge_radio_event(void);
+
+/**
+ * Handle a TIMER0 signal in a Gazell window.
+ *
+ * @return true if Gazell has been disabled, and the timeslot may end.
+ */
+bool mesh_gzll_bridge_timer_event(void);
+
+/** Stop Gazell at once, for a timeslot forced to end in a Gazell window. */
+void mesh_gzll_bridge_window_abort(void);
+
+/** @} */
+
+#endif /* MESH_GZLL_BRIDGE_H__ */
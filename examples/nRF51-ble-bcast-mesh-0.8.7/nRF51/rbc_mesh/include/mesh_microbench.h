@@ -0,0 +1,96 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef MESH_MICROBENCH_H__
+#define MESH_MICROBENCH_H__
+
+#include <stdint.h>
+
+/**
+ * @defgroup MESH_MICROBENCH Data structure microbenchmarks
+ * Optional timing of the framework's data structures, enabled by defining
+ * MESH_MICROBENCH: handle lookups, TX collection, the event fifos and the
+ * packet pool, at the handle and data cache sizes of the build. The same
+ * cases run on the host (sim/, `make bench`) and on the device (the
+ * Bandwidth_test example with BENCH_ROLE=MICRO), with the clock and the
+ * output provided by the caller. Each batch is timed less the time of an
+ * empty batch, so the results are the cost of the operations alone.
+ *
+ * The benchmarks initialize and fill the handle storage and the packet pool
+ * themselves, and must run before rbc_mesh_init().
+ * @{
+ */
+
+/** Operations timed together between two clock readings, keeps each reading within a 16 bit clock on the device. */
+#ifndef MESH_MICROBENCH_BATCH
+#define MESH_MICROBENCH_BATCH       (32)
+#endif
+
+/** Result of one benchmark case. */
+typedef struct
+{
+    const char* p_name;     /**< Name of the case. */
+    uint32_t    entries;    /**< Values in the handle storage during the case. */
+    uint32_t    ops;        /**< Operations timed. */
+    uint64_t    ticks;      /**< Clock ticks spent on the operations. */
+} mesh_microbench_result_t;
+
+/** Free running clock, read before and after each batch. */
+typedef uint32_t (*mesh_microbench_clock_t)(void);
+
+/** Called with the result of each case. */
+typedef void (*mesh_microbench_result_cb_t)(const mesh_microbench_result_t* p_result);
+
+/** Benchmark parameters. */
+typedef struct
+{
+    mesh_microbench_clock_t     clock;      /**< Clock to time the batches with. */
+    uint32_t                    clock_mask; /**< Bits the clock counts in, for the wrap-around. */
+    uint32_t                    rounds;     /**< Batches timed in each case. */
+    mesh_microbench_result_cb_t result_cb;  /**< Result callback. */
+} mesh_microbench_params_t;
+
+#ifdef MESH_MICROBENCH
+
+/**
+ * Run all benchmark cases.
+ *
+ * @param[in] p_params Clock, length and output of the run.
+ *
+ * @return NRF_SUCCESS, NRF_ERROR_NULL if a parameter is missing, or
+ *         NRF_ERROR_NO_MEM if no values could be stored.
+ */
+uint32_t mesh_microbench_run(const mesh_microbench_params_t* p_params);
+
+#endif /* MESH_MICROBENCH */
+
+/** @} */
+
+#endif /* MESH_MICROBENCH_H__ */
@@ -0,0 +1,103 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_NEIGHBOUR_H__
+#define MESH_NEIGHBOUR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_NEIGHBOUR Neighbour table
+ * Keeps the address, average RSSI, packet count and time of the last packet
+ * of the nodes heard directly, from the source address of every received mesh
+ * packet. Relayed packets carry the address of the relaying node, so only
+ * direct neighbours enter the table. The least recently heard neighbour is
+ * replaced when the table is full, and neighbours not heard for
+ * RBC_MESH_NEIGHBOUR_TIMEOUT_MS are inactive.
+ *
+ * When adaptive TX power is enabled, the table is evaluated every
+ * RBC_MESH_NEIGHBOUR_ADAPT_INTERVAL_MS, and the TX power is lowered one level
+ * when many neighbours are heard strongly, or raised one level when few
+ * neighbours are heard at all, between RBC_MESH_NEIGHBOUR_TX_POWER_MIN and the
+ * power set by the application.
+ * @{
+ */
+
+/**
+ * Clear the table, disable adaptive TX power and start the periodic
+ * evaluation.
+ *
+ * @param[in] tx_power TX power set by the application, the highest the
+ *   adaptive TX power will use.
+ */
+void mesh_neighbour_init(rbc_mesh_txpower_t tx_power);
+
+/**
+ * Record a received mesh packet. Called by the transport in the event
+ * handler context.
+ *
+ * @param[in] p_addr Source address of the packet.
+ * @param[in] timestamp Time of reception.
+ * @param[in] rssi Negative RSSI of the packet.
+ */
+void mesh_neighbour_rx(const ble_gap_addr_t* p_addr, timestamp_t timestamp, uint8_t rssi);
+
+/**
+ * Set the TX power chosen by the application. Used as is while adaptive TX
+ * power is disabled, and as the highest power while it is enabled.
+ *
+ * @param[in] tx_power TX power to set.
+ */
+void mesh_neighbour_tx_power_max_set(rbc_mesh_txpower_t tx_power);
+
+/**
+ * Enable or disable adaptive TX power. Disabling it restores the TX power
+ * set by the application.
+ *
+ * @param[in] enabled Whether to adapt the TX power to the neighbours.
+ */
+void mesh_neighbour_tx_power_adaptive_set(bool enabled);
+
+/**
+ * Get a table entry.
+ *
+ * @param[in] index Index of the entry.
+ * @param[out] p_neighbour Structure to fill.
+ *
+ * @return NRF_SUCCESS The entry was fetched.
+ * @return NRF_ERROR_NOT_FOUND There are no more entries.
+ */
+uint32_t mesh_neighbour_get(uint8_t index, rbc_mesh_neighbour_t* p_neighbour);
+
+/** @} */
+
+#endif /* MESH_NEIGHBOUR_H__ */
@@ -0,0 +1,85 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_OBJECT_H__
+#define MESH_OBJECT_H__
+
+#include <stdint.h>
+#include "rbc_mesh.h"
+#include "mesh_packet.h"
+
+/**
+ * @defgroup MESH_OBJECT Segmented object transport
+ * Sends objects longer than a mesh value as a sequence of segments on the
+ * MESH_OBJECT_HANDLE_SEGMENT reserved handle. Receivers put the segments
+ * together in a buffer of RBC_MESH_OBJECT_MAX_LEN bytes, and keep a bitmap of
+ * the segments they have. New segments are relayed once. A receiver that
+ * hears nothing new for RBC_MESH_OBJECT_REQ_TIMEOUT_MS asks for the rest with
+ * a bitmap of its missing segments on the MESH_OBJECT_HANDLE_REQ handle, like
+ * the DATA_REQ_BITMAP of the DFU transfers, and any device holding some of
+ * them sends them again.
+ *
+ * There's one object buffer, which holds the last object sent or received.
+ * A transfer is not interrupted by other objects before it completes, or
+ * before it's dropped after RBC_MESH_OBJECT_REQ_RETRIES unanswered requests.
+ *
+ * All functions except @ref mesh_object_set must be called from the event
+ * handler context.
+ * @{
+ */
+
+/** Reset the object buffer. */
+void mesh_object_init(void);
+
+/**
+ * Copy an object into the object buffer, and start sending it.
+ *
+ * @param[in] object_id Application ID of the object.
+ * @param[in] p_data Object contents.
+ * @param[in] length Length of the object contents.
+ *
+ * @return NRF_SUCCESS The object will be sent.
+ * @return NRF_ERROR_NULL p_data is NULL.
+ * @return NRF_ERROR_INVALID_LENGTH The object is empty, or longer than RBC_MESH_OBJECT_MAX_LEN.
+ * @return NRF_ERROR_BUSY Another object is being received.
+ * @return NRF_ERROR_NOT_SUPPORTED The framework is built without object support.
+ */
+uint32_t mesh_object_set(uint16_t object_id, const uint8_t* p_data, uint16_t length);
+
+/**
+ * Process a received segment or segment request.
+ *
+ * @param[in] p_adv_data Mesh adv data with one of the reserved object handles.
+ * @param[in] timestamp Time of reception.
+ */
+void mesh_object_rx(mesh_adv_data_t* p_adv_data, uint32_t timestamp);
+
+/** @} */
+
+#endif /* MESH_OBJECT_H__ */
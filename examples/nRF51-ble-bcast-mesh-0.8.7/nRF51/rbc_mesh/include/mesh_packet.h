@@ -39,11 +39,29 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define MESH_UUID                           (0xFEE4)
 #define MESH_ADV_DATA_TYPE                  (0x16)
-#define BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH   (31)
+#define BLE_ADV_PACKET_LEGACY_PAYLOAD_MAX_LENGTH (31)                                                           /* longest payload a BLE advertiser may send */
+#if RBC_MESH_LONG_PACKETS
+#define BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH   (1 + MESH_PACKET_ADV_OVERHEAD + RBC_MESH_VALUE_MAX_LEN)
+#else
+#define BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH   (BLE_ADV_PACKET_LEGACY_PAYLOAD_MAX_LENGTH)
+#endif
 
 #define MESH_PACKET_BLE_OVERHEAD            (BLE_GAP_ADDR_LEN)                                                      /* overhead before advertisement payload */
-#define MESH_PACKET_ADV_OVERHEAD            (1 /* adv_type */ + 2 /* UUID */ + 2 /* handle */ + 2 /* version */)    /* overhead inside adv data */
+#define MESH_PACKET_ADV_OVERHEAD            (1 /* adv_type */ + 2 /* UUID */ + 2 /* handle */ + 2 /* version */ + RBC_MESH_AUTH_OVERHEAD) /* overhead inside adv data */
 #define MESH_PACKET_OVERHEAD                (MESH_PACKET_BLE_OVERHEAD + 1 + MESH_PACKET_ADV_OVERHEAD)               /* mesh packet total overhead */
+
+#define MESH_PROBE_HANDLE                   (0xFFEE)                                                                /* reserved handle marking a latency probe request or reply */
+#define MESH_TIME_HANDLE                    (0xFFEF)                                                                /* reserved handle marking a time beacon */
+#define MESH_BATCH_HANDLE                   (0xFFF0)                                                                /* reserved handle marking a batch of value records */
+#define MESH_OBJECT_HANDLE_SEGMENT          (0xFFF1)                                                                /* reserved handle marking a segment of an object */
+#define MESH_OBJECT_HANDLE_REQ              (0xFFF2)                                                                /* reserved handle marking a request for missing object segments */
+#define MESH_SYNC_HANDLE                    (0xFFF3)                                                                /* reserved handle marking a request for the neighbours' cached values */
+#define MESH_SURVEY_HANDLE                  (0xFFF4)                                                                /* reserved handle marking a link survey packet */
+#define MESH_DIGEST_HANDLE                  (0xFFF5)                                                                /* reserved handle marking a digest of the sender's values */
+#define MESH_REPORT_HANDLE                  (0xFFF6)                                                                /* reserved handle marking a convergecast report or gradient beacon */
+#define MESH_BATCH_ADV_OVERHEAD             (1 /* adv_type */ + 2 /* UUID */ + 2 /* handle */)                      /* overhead inside batch adv data */
+#define MESH_BATCH_RECORD_OVERHEAD          (2 /* handle */ + 2 /* version */ + 1 /* length */)                     /* overhead per value record in a batch */
+#define MESH_BATCH_CAPACITY                 (BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH - 1 - MESH_BATCH_ADV_OVERHEAD)       /* space for records in a batch packet */
 /******************************************************************************
 * Public typedefs
 ******************************************************************************/
@@ -82,6 +100,25 @@ typedef __packed_armcc struct
     dfu_packet_t            dfu_packet;
 } __packed_gcc mesh_dfu_adv_data_t;
 
+/** Value record in a batch packet. The data field is length bytes long. */
+typedef __packed_armcc struct
+{
+    rbc_mesh_value_handle_t handle;
+    uint16_t                version;
+    uint8_t                 length;
+    uint8_t                 data[];
+} __packed_gcc mesh_batch_record_t;
+
+/** Batch adv data, shares its header layout with mesh_adv_data_t up to the handle. */
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle; /**< Always MESH_BATCH_HANDLE. */
+    uint8_t                 records[MESH_BATCH_CAPACITY];
+} __packed_gcc mesh_batch_adv_data_t;
+
 typedef __packed_armcc struct
 {
     ble_packet_header_t header;
@@ -107,6 +144,9 @@ bool mesh_packet_ref_count_dec(mesh_packet_t* p_packet);
 
 uint8_t mesh_packet_ref_count_get(mesh_packet_t* p_packet);
 
+/** Get a snapshot of the packet pool usage counters. */
+void mesh_packet_pool_stats_get(rbc_mesh_packet_pool_stats_t* p_stats);
+
 uint32_t mesh_packet_set_local_addr(mesh_packet_t* p_packet);
 
 uint32_t mesh_packet_build(mesh_packet_t* p_packet,
@@ -115,6 +155,32 @@ uint32_t mesh_packet_build(mesh_packet_t* p_packet,
         uint8_t* data,
         uint8_t length);
 
+/** Build an empty batch packet, to be filled with mesh_packet_batch_append(). */
+uint32_t mesh_packet_batch_build(mesh_packet_t* p_packet);
+
+/**
+* @brief Append a value record to a batch packet.
+*
+* @return NRF_SUCCESS The record was added.
+* @return NRF_ERROR_INVALID_LENGTH The value is too long to fit in a batch.
+* @return NRF_ERROR_NO_MEM There's not enough space left in the packet.
+*/
+uint32_t mesh_packet_batch_append(mesh_packet_t* p_packet,
+        rbc_mesh_value_handle_t handle,
+        uint16_t version,
+        uint8_t* data,
+        uint8_t length);
+
+/**
+* @brief Iterate over the value records in a batch packet.
+*
+* @param[in] p_batch_adv_data Batch adv data to iterate over.
+* @param[in] p_prev Previous record, or NULL to get the first one.
+*
+* @return The next record, or NULL if there are no more valid records.
+*/
+mesh_batch_record_t* mesh_packet_batch_record_next(mesh_batch_adv_data_t* p_batch_adv_data, mesh_batch_record_t* p_prev);
+
 uint32_t mesh_packet_adv_data_sanitize(mesh_packet_t* p_packet);
 
 mesh_adv_data_t* mesh_packet_adv_data_get(mesh_packet_t* p_packet);
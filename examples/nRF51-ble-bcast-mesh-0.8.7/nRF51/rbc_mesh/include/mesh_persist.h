@@ -0,0 +1,96 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_PERSIST_H__
+#define MESH_PERSIST_H__
+
+#include <stdint.h>
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_PERSIST Persistent handle value store
+ * Optional flash journal of the values of persistent handles, enabled by
+ * defining MESH_PERSIST. The values are appended to a log in one of two flash
+ * banks. When the log is full, the latest value of every handle is copied to
+ * the other bank, and its header is written last, so a power loss at any
+ * point leaves one valid bank. Writes are done through mesh_flash, and are
+ * delayed and merged, to limit the flash wear from often changing values.
+ *
+ * All functions must be called from the event handler context.
+ * @{
+ */
+
+/** A value restored from flash. */
+typedef struct
+{
+    rbc_mesh_value_handle_t handle;
+    uint16_t                version;
+    uint8_t                 length;
+    uint8_t                 data[RBC_MESH_VALUE_MAX_LEN];
+} mesh_persist_value_t;
+
+/**
+ * Locate the active flash bank. Must be called before any other function in
+ * the module.
+ */
+void mesh_persist_init(void);
+
+/**
+ * Get the next value stored in flash.
+ *
+ * @param[in,out] p_iterator Iterator, must be 0 on the first call.
+ * @param[out] p_value Value to fill.
+ *
+ * @return NRF_SUCCESS The value was filled.
+ * @return NRF_ERROR_NOT_FOUND There are no more stored values.
+ */
+uint32_t mesh_persist_value_next(uint32_t* p_iterator, mesh_persist_value_t* p_value);
+
+/**
+ * Schedule a value to be written to flash. Replaces any value with the same
+ * handle that hasn't been written yet.
+ *
+ * @return NRF_SUCCESS The value will be written.
+ * @return NRF_ERROR_INVALID_LENGTH The value is too long.
+ * @return NRF_ERROR_NO_MEM There are too many values waiting to be written.
+ */
+uint32_t mesh_persist_value_store(rbc_mesh_value_handle_t handle, uint16_t version, const uint8_t* p_data, uint8_t length);
+
+/**
+ * Schedule the removal of a value from flash, so it isn't restored at the
+ * next boot.
+ *
+ * @return NRF_SUCCESS The value will be removed.
+ * @return NRF_ERROR_NO_MEM There are too many values waiting to be written.
+ */
+uint32_t mesh_persist_value_remove(rbc_mesh_value_handle_t handle);
+
+/** @} */
+
+#endif /* MESH_PERSIST_H__ */
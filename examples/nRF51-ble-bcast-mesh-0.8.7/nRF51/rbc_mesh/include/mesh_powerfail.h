@@ -0,0 +1,90 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef MESH_POWERFAIL_H__
+#define MESH_POWERFAIL_H__
+
+#include <stdint.h>
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_POWERFAIL Power-fail state record
+ * Optional record of a small application state, written to flash only when
+ * the supply voltage drops, enabled by defining MESH_POWERFAIL. The
+ * SoftDevice power failure comparator warns when the supply falls below
+ * RBC_MESH_POWERFAIL_THRESHOLD, and the state is then written as one record
+ * to a slot that was erased ahead of time, through the urgent write of
+ * mesh_flash. That takes well under a millisecond, and fits in the hold-up
+ * time of the supply. Records are appended to two flash pages in turn, and
+ * the other page is erased in normal operation when one is full, so there's
+ * always a valid record to restore.
+ *
+ * Meant for state that changes often, like a dimming level or a relay state,
+ * where writing every change would wear the flash. Values of persistent
+ * handles are kept by @ref MESH_PERSIST.
+ * @{
+ */
+
+/**
+ * Restore the last record from flash, prepare the slot for the next one, and
+ * enable the power failure warning.
+ *
+ * @return NRF_SUCCESS The warning is enabled.
+ * @return Errors from the SoftDevice power failure configuration.
+ */
+uint32_t mesh_powerfail_init(void);
+
+/** Handle SoftDevice events, writes the record on a power failure warning. */
+void mesh_powerfail_sd_evt_handler(uint32_t sd_evt);
+
+/**
+ * Set the state to write on the next power failure. Only copies the state.
+ *
+ * @return NRF_SUCCESS The state was set.
+ * @return NRF_ERROR_INVALID_LENGTH The state is longer than
+ *  RBC_MESH_POWERFAIL_STATE_LEN_MAX.
+ */
+uint32_t mesh_powerfail_state_set(const uint8_t* p_data, uint8_t length);
+
+/**
+ * Get the state, as restored from flash at init or last set.
+ *
+ * @param[out] p_data Buffer of RBC_MESH_POWERFAIL_STATE_LEN_MAX bytes to fill.
+ * @param[out] p_length Length of the state.
+ *
+ * @return NRF_SUCCESS The state was copied.
+ * @return NRF_ERROR_NOT_FOUND No state was stored before the last power loss,
+ *  and none has been set since.
+ */
+uint32_t mesh_powerfail_state_get(uint8_t* p_data, uint8_t* p_length);
+
+/** @} */
+
+#endif /* MESH_POWERFAIL_H__ */
@@ -0,0 +1,110 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef MESH_PROBE_H__
+#define MESH_PROBE_H__
+
+#include <stdint.h>
+#include "timer.h"
+#include "mesh_packet.h"
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_PROBE Round-trip latency probe
+ * Measures the latency of the mesh from a prober, like a gateway, to the
+ * other nodes. Probe requests are flooded: every node relays the first copy
+ * of each probe once, with the hop count it got it with, up to
+ * RBC_MESH_PROBE_HOPS_MAX hops. The target nodes reply with their hop count
+ * and the time they held the probe for, and the replies go back down the hop
+ * counts of the request: only the nodes that got the request one hop closer
+ * to the prober relay them. The prober takes the time the responder held the
+ * probe off the round trip, and keeps the distribution of the round-trip
+ * times per node.
+ *
+ * Nodes built with RBC_MESH_PROBE relay and answer probes. Only nodes built
+ * with RBC_MESH_PROBE_NODES above 0 can send probes.
+ * @{
+ */
+
+/** Clear the tables, and stop probing. */
+void mesh_probe_init(void);
+
+/**
+ * Start sending probes, or change the target or the interval.
+ *
+ * @param[in] target Short address of the node to probe, or
+ *   RBC_MESH_PROBE_TARGET_ALL.
+ * @param[in] interval_us Time between two probes.
+ *
+ * @return NRF_SUCCESS Probing was started.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_PROBE_NODES is 0.
+ */
+uint32_t mesh_probe_start(uint16_t target, timestamp_t interval_us);
+
+/**
+ * Stop sending probes. Replies to the probes already sent are still taken.
+ *
+ * @return NRF_SUCCESS Probing was stopped.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_PROBE_NODES is 0.
+ */
+uint32_t mesh_probe_stop(void);
+
+/**
+ * Get the statistics of a probed node.
+ *
+ * @param[in] index Index of the node in the table.
+ * @param[out] p_stats Structure to fill.
+ *
+ * @return NRF_SUCCESS The statistics were fetched.
+ * @return NRF_ERROR_NOT_FOUND There are no more nodes.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_PROBE_NODES is 0.
+ */
+uint32_t mesh_probe_stats_get(uint8_t index, rbc_mesh_probe_stats_t* p_stats);
+
+/**
+ * Clear the node table, to start a new measurement.
+ *
+ * @return NRF_SUCCESS The table was cleared.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_PROBE_NODES is 0.
+ */
+uint32_t mesh_probe_reset(void);
+
+/**
+ * Handle a received probe request or reply. Called by the transport in the
+ * event handler context.
+ *
+ * @param[in] p_packet Received packet, with the MESH_PROBE_HANDLE handle.
+ * @param[in] timestamp Time of reception.
+ */
+void mesh_probe_rx(mesh_packet_t* p_packet, timestamp_t timestamp);
+
+/** @} */
+
+#endif /* MESH_PROBE_H__ */
@@ -0,0 +1,103 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_PROFILER_H__
+#define MESH_PROFILER_H__
+
+#include <stdint.h>
+
+/**
+ * @defgroup MESH_PROFILER Sampling profiler
+ * Optional statistical profiler, enabled by defining MESH_PROFILER. A timer
+ * of its own interrupts the CPU at a fixed rate, with some jitter to avoid
+ * locking on to periodic work, and the interrupt records the program counter
+ * stacked for the interrupted code. The samples are counted per
+ * 1 << MESH_PROFILER_PC_SHIFT bytes of code in a small hash table, which
+ * mesh_profiler_dump() prints over SEGGER RTT and clears. The script
+ * interactive_pyaci/profile_symbolize.py turns the dumps into a list of
+ * functions, with the symbols of the ELF file of the build.
+ *
+ * Code running at a higher interrupt priority than the profiler, like the
+ * Softdevice, isn't sampled directly: its samples land on the code that
+ * runs when it returns. Requires SEGGER_RTT.c in the build.
+ * @{
+ */
+
+/** Timer instance reserved for the profiler, with its IRQ number and handler. Must not be used by the application. */
+#ifndef MESH_PROFILER_TIMER
+#define MESH_PROFILER_TIMER                 (NRF_TIMER1)
+#define MESH_PROFILER_TIMER_IRQn            (TIMER1_IRQn)
+#define MESH_PROFILER_TIMER_IRQHandler      TIMER1_IRQHandler
+#endif
+
+/** Interrupt priority of the profiler. Code at this or a higher priority isn't sampled. */
+#ifndef MESH_PROFILER_IRQ_PRIORITY
+#define MESH_PROFILER_IRQ_PRIORITY          (1)
+#endif
+
+/** Number of code locations counted between two dumps. Must be a power of two. */
+#ifndef MESH_PROFILER_SLOTS
+#define MESH_PROFILER_SLOTS                 (128)
+#endif
+
+/** Size of the code locations, as a shift. The default counts 16 bytes, a few instructions, together. */
+#ifndef MESH_PROFILER_PC_SHIFT
+#define MESH_PROFILER_PC_SHIFT              (4)
+#endif
+
+#ifdef MESH_PROFILER
+
+/**
+ * Clear the counts and start sampling.
+ *
+ * @param[in] rate_hz Samples per second, between 1 and 10000.
+ */
+void mesh_profiler_start(uint32_t rate_hz);
+
+/** Stop sampling. The counts are kept until the next dump or start. */
+void mesh_profiler_stop(void);
+
+/**
+ * Print the counts over RTT and clear them. Takes several milliseconds, so
+ * call it from the main loop, for example every few seconds. Sampling is
+ * paused while printing.
+ */
+void mesh_profiler_dump(void);
+
+#else /* MESH_PROFILER */
+
+#define mesh_profiler_start(rate_hz)
+#define mesh_profiler_stop()
+#define mesh_profiler_dump()
+
+#endif /* MESH_PROFILER */
+
+/** @} */
+
+#endif /* MESH_PROFILER_H__ */
@@ -0,0 +1,109 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_REPORT_H__
+#define MESH_REPORT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "mesh_packet.h"
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_REPORT Convergecast reports
+ * Carries report type data, like sensor readings, toward gateway nodes
+ * instead of flooding it to every node. Gateways send a gradient beacon
+ * with hop count 0 every RBC_MESH_REPORT_INTERVAL_MS, and every node that
+ * has heard one picks the neighbour with the lowest hop count as its parent,
+ * and sends beacons with its own hop count in turn. Reported values are
+ * merged per zone into a minimum, maximum, count and sum, and sent to the
+ * parent once per interval, in a packet addressed to it. The parent merges
+ * them with its own before passing them on, so each relay sends at most one
+ * report per zone and interval, however many nodes are behind it. Gateways
+ * hand the merged zones to the application as RBC_MESH_EVENT_TYPE_REPORT
+ * events once per interval.
+ *
+ * Reports are best effort: they are sent once, and a parent that is lost
+ * is replaced after RBC_MESH_REPORT_GRADIENT_TIMEOUT_MS. Nothing is sent
+ * while no gateway has been heard, so the reports cost no air time in
+ * meshes without a gateway.
+ * @{
+ */
+
+/** Clear the report table and the gradient, and start the report timer. */
+void mesh_report_init(void);
+
+/**
+ * Make the node a gateway, or a regular node.
+ *
+ * @param[in] gateway Whether the node is a gateway.
+ *
+ * @return NRF_SUCCESS The role was set.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_REPORT_ZONES is 0.
+ */
+uint32_t mesh_report_gateway_set(bool gateway);
+
+/**
+ * Merge a value into the report of a zone.
+ *
+ * @param[in] zone Zone the value belongs to.
+ * @param[in] value Reported value.
+ *
+ * @return NRF_SUCCESS The value was merged.
+ * @return NRF_ERROR_NO_MEM RBC_MESH_REPORT_ZONES other zones are waiting
+ *   to be sent.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_REPORT_ZONES is 0.
+ */
+uint32_t mesh_report_submit(uint8_t zone, int16_t value);
+
+/**
+ * Get the number of hops to the closest gateway.
+ *
+ * @param[out] p_hops The hop count, 0 on gateways.
+ *
+ * @return NRF_SUCCESS The hop count was fetched.
+ * @return NRF_ERROR_NOT_FOUND No gateway has been heard.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_REPORT_ZONES is 0.
+ */
+uint32_t mesh_report_hops_get(uint8_t* p_hops);
+
+/**
+ * Handle a received report or beacon. Called by the transport in the event
+ * handler context.
+ *
+ * @param[in] p_packet Received packet, with the MESH_REPORT_HANDLE handle.
+ * @param[in] timestamp Time of reception.
+ * @param[in] rssi Negative RSSI of the packet.
+ */
+void mesh_report_rx(mesh_packet_t* p_packet, timestamp_t timestamp, uint8_t rssi);
+
+/** @} */
+
+#endif /* MESH_REPORT_H__ */
@@ -0,0 +1,107 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_RETAIN_H__
+#define MESH_RETAIN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_RETAIN Retained handle values
+ * Optional copy of the handle values in RAM that isn't cleared at startup,
+ * enabled by defining MESH_RETAIN. The nRF51 keeps its RAM through all resets
+ * but power on and brownout, so after a soft reset, a fault or a watchdog
+ * reset, the mesh is initialized with the values, versions and flags it had,
+ * and the neighbours see no version changes. There's one slot per data cache
+ * entry, each with its own CRC, so a reset in the middle of an update only
+ * loses that value. After a power loss the RAM is random, and no slot is
+ * valid.
+ *
+ * The slots live in the .noinit section, which the linker script must place
+ * outside the zero initialized .bss, and outside the RAM of a bootloader that
+ * runs between the resets. Keil projects must map it to an UNINIT region.
+ *
+ * All functions must be called from the event handler context.
+ * @{
+ */
+
+#define MESH_RETAIN_FLAG_PERSISTENT     (1 << 0)
+#define MESH_RETAIN_FLAG_TX_EVENT       (1 << 1)
+#define MESH_RETAIN_FLAG_RELAY          (1 << 2)
+#define MESH_RETAIN_FLAG_DISABLED       (1 << 3)
+#define MESH_RETAIN_FLAG_QOS_POS        (4)
+#define MESH_RETAIN_FLAG_QOS_MASK       (0x03 << MESH_RETAIN_FLAG_QOS_POS)
+
+/** A retained handle value. */
+typedef struct
+{
+    rbc_mesh_value_handle_t handle;
+    uint16_t                version;
+    uint8_t                 flags;      /**< MESH_RETAIN_FLAG_* of the handle. */
+    uint8_t                 length;
+    uint8_t                 data[RBC_MESH_VALUE_MAX_LEN];
+} mesh_retain_value_t;
+
+/**
+ * Check the retained RAM, and clear it if it wasn't written by this build.
+ * Must be called before any other function in the module.
+ */
+void mesh_retain_init(void);
+
+/**
+ * Get the next valid retained value.
+ *
+ * @param[in,out] p_iterator Iterator, must be 0 on the first call.
+ * @param[out] p_value Value to fill.
+ *
+ * @return NRF_SUCCESS The value was filled.
+ * @return NRF_ERROR_NOT_FOUND There are no more retained values.
+ */
+uint32_t mesh_retain_value_next(uint32_t* p_iterator, mesh_retain_value_t* p_value);
+
+/**
+ * Retain a value.
+ *
+ * @param[in] slot Slot to write, the index of the data cache entry.
+ * @param[in] p_value Value to retain.
+ */
+void mesh_retain_value_store(uint16_t slot, const mesh_retain_value_t* p_value);
+
+/**
+ * Forget the value in a slot.
+ *
+ * @param[in] slot Slot to clear, the index of the data cache entry.
+ */
+void mesh_retain_value_clear(uint16_t slot);
+
+/** @} */
+
+#endif /* MESH_RETAIN_H__ */
@@ -0,0 +1,97 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_SCENE_H__
+#define MESH_SCENE_H__
+
+#include <stdint.h>
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_SCENE Scenes
+ * Drives many handles with a single mesh value. Every device keeps a table
+ * of up to RBC_MESH_SCENE_ACTIONS_MAX local actions, each a value for one
+ * handle in one scene. A scene is recalled by setting the value of
+ * RBC_MESH_SCENE_HANDLE to the scene ID, which propagates like any other
+ * value. Every device that receives a new version of it, or sets it locally,
+ * generates an RBC_MESH_EVENT_TYPE_SCENE_ACTION event for each of its actions
+ * in the scene, so all devices act on the same propagation.
+ *
+ * The scene value is a 16 bit little endian scene ID, optionally followed by
+ * a 32 bit little endian mesh time to apply the scene at, see MESH_TIME.
+ * Devices that are synchronized hold such a recall until their mesh time
+ * reaches it.
+ * @{
+ */
+
+/** Clear the action table. */
+void mesh_scene_init(void);
+
+/**
+ * Add an action to a scene, or replace the scene's action for the handle.
+ *
+ * @param[in] scene_id Scene to add the action to.
+ * @param[in] handle Handle the action is for.
+ * @param[in] p_data Value of the action. Copied by the framework.
+ * @param[in] length Length of the value, at most
+ *   RBC_MESH_SCENE_VALUE_MAX_LEN.
+ *
+ * @return NRF_SUCCESS The action was stored.
+ * @return NRF_ERROR_INVALID_LENGTH The value is too long.
+ * @return NRF_ERROR_NO_MEM The action table is full.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_SCENE_ACTIONS_MAX is 0.
+ */
+uint32_t mesh_scene_action_set(uint16_t scene_id, rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length);
+
+/**
+ * Remove actions from a scene.
+ *
+ * @param[in] scene_id Scene to remove the actions from.
+ * @param[in] handle Handle of the action to remove, or
+ *   RBC_MESH_INVALID_HANDLE to remove all actions of the scene.
+ *
+ * @return NRF_SUCCESS At least one action was removed.
+ * @return NRF_ERROR_NOT_FOUND The scene has no such action.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_SCENE_ACTIONS_MAX is 0.
+ */
+uint32_t mesh_scene_action_clear(uint16_t scene_id, rbc_mesh_value_handle_t handle);
+
+/**
+ * Act on a new value. Does nothing unless the handle is
+ * RBC_MESH_SCENE_HANDLE.
+ *
+ * @param[in] handle Handle of the new value.
+ * @param[in] p_data Contents of the new value.
+ * @param[in] length Length of the new value.
+ */
+void mesh_scene_value_rx(rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length);
+
+/** @} */
+
+#endif /* MESH_SCENE_H__ */
@@ -0,0 +1,81 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef MESH_STATS_H__
+#define MESH_STATS_H__
+
+#include <stdint.h>
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_STATS Mesh performance counters
+ * Counters for the health of the mesh, collected by the modules that observe
+ * the events, and read out through rbc_mesh_stats_get() or the serial interface.
+ * @{
+ */
+
+#ifdef BOOTLOADER
+/* The bootloader shares the radio code, but doesn't keep stats. */
+#define MESH_STATS_INC(counter)
+#define MESH_STATS_SET(counter, value)
+#define MESH_STATS_MAX(counter, value)
+#define MESH_STATS_ADD(counter, value)
+#else
+/** Counter storage, only to be accessed through the macros below. */
+extern rbc_mesh_stats_t g_mesh_stats;
+
+/** Increment a counter in the stats, wrapping around on overflow. */
+#define MESH_STATS_INC(counter)     (++g_mesh_stats.counter)
+
+/** Add to an accumulating counter in the stats, wrapping around on overflow. */
+#define MESH_STATS_ADD(counter, value)  (g_mesh_stats.counter += (value))
+
+/** Set a gauge in the stats to the latest sample. */
+#define MESH_STATS_SET(counter, value)  (g_mesh_stats.counter = (value))
+
+/** Raise a gauge in the stats to the given sample if it's higher. */
+#define MESH_STATS_MAX(counter, value)  do {\
+    if ((value) > g_mesh_stats.counter) g_mesh_stats.counter = (value);\
+    } while (0)
+#endif
+
+/** Reset all counters. */
+void mesh_stats_init(void);
+
+/**
+ * Get a snapshot of all counters, including the ones owned by other modules.
+ *
+ * @param[out] p_stats Stats structure to fill.
+ */
+void mesh_stats_get(rbc_mesh_stats_t* p_stats);
+
+/** @} */
+
+#endif /* MESH_STATS_H__ */
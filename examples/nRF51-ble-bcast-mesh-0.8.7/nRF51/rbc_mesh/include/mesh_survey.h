@@ -0,0 +1,88 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_SURVEY_H__
+#define MESH_SURVEY_H__
+
+#include <stdint.h>
+#include "timer.h"
+#include "mesh_packet.h"
+#include "rbc_mesh.h"
+
+/**
+ * @defgroup MESH_SURVEY Link survey
+ * Measures the link quality to the neighbours. While the survey is started,
+ * the node sends a survey packet with a sequence number on each of its
+ * transmit channels every interval. The survey packets of the neighbours are
+ * always recorded, in a table of received and expected packets and RSSI per
+ * neighbour and channel, with the least recently heard pair replaced when the
+ * table is full.
+ * @{
+ */
+
+/** Stop the survey, and clear the table. */
+void mesh_survey_init(void);
+
+/**
+ * Start sending survey packets, or change the interval.
+ *
+ * @param[in] interval_us Average time between two survey packets.
+ */
+void mesh_survey_start(timestamp_t interval_us);
+
+/** Stop sending survey packets. */
+void mesh_survey_stop(void);
+
+/**
+ * Record a received survey packet. Called by the transport in the event
+ * handler context.
+ *
+ * @param[in] p_packet Received packet, with the MESH_SURVEY_HANDLE handle.
+ * @param[in] timestamp Time of reception.
+ * @param[in] rssi Negative RSSI of the packet.
+ */
+void mesh_survey_rx(mesh_packet_t* p_packet, timestamp_t timestamp, uint8_t rssi);
+
+/**
+ * Get a table entry.
+ *
+ * @param[in] index Index of the entry.
+ * @param[out] p_entry Structure to fill.
+ *
+ * @return NRF_SUCCESS The entry was fetched.
+ * @return NRF_ERROR_NOT_FOUND There are no more entries.
+ */
+uint32_t mesh_survey_entry_get(uint8_t index, rbc_mesh_survey_entry_t* p_entry);
+
+/** Clear the table. */
+void mesh_survey_reset(void);
+
+/** @} */
+
+#endif /* MESH_SURVEY_H__ */
@@ -0,0 +1,114 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_TIME_H__
+#define MESH_TIME_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "mesh_packet.h"
+
+/**
+ * @defgroup MESH_TIME Mesh time
+ * Flooding time synchronization to the clock of a root node. Every
+ * synchronized node sends a round of time beacons, one on each of the first
+ * three channels of the channel map, every RBC_MESH_TIME_BEACON_INTERVAL_MS.
+ * A beacon can't know when it goes on air, so it carries the sender's mesh
+ * time at the end of each packet of the previous round instead, taken in
+ * the radio callback. A receiver pairs the one for the packet it heard in
+ * the previous round with the time it received that packet, which makes a
+ * sample of the sender's mesh time against its own clock that is free of
+ * queuing and processing delays. The offset and skew to the root are the
+ * linear regression of the latest RBC_MESH_TIME_SAMPLES samples.
+ *
+ * Each beacon carries the root's sequence number the sender has synchronized
+ * to, and nodes only take samples that bring a newer one, so the time
+ * floods outward from the root once per round.
+ * @{
+ */
+
+/** Forget the root and the samples, and start the beacon timer. */
+void mesh_time_init(void);
+
+/**
+ * Make the node the root of the mesh time, or a regular node.
+ *
+ * @param[in] root Whether the node is the root.
+ *
+ * @return NRF_SUCCESS The role was set.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_TIME_SYNC is 0.
+ */
+uint32_t mesh_time_root_set(bool root);
+
+/**
+ * Convert a local timestamp to mesh time.
+ *
+ * @param[in] local Local timestamp, like timer_now().
+ * @param[out] p_time The mesh time at the local timestamp.
+ *
+ * @return NRF_SUCCESS The time was converted.
+ * @return NRF_ERROR_INVALID_STATE The node isn't synchronized.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_TIME_SYNC is 0.
+ */
+uint32_t mesh_time_get(timestamp_t local, uint32_t* p_time);
+
+/**
+ * Convert a mesh time to a local timestamp.
+ *
+ * @param[in] time Mesh time.
+ * @param[out] p_local The local timestamp of the mesh time.
+ *
+ * @return NRF_SUCCESS The time was converted.
+ * @return NRF_ERROR_INVALID_STATE The node isn't synchronized.
+ * @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_TIME_SYNC is 0.
+ */
+uint32_t mesh_time_local_get(uint32_t time, timestamp_t* p_local);
+
+/**
+ * Handle a received time beacon. Called by the transport in the event
+ * handler context.
+ *
+ * @param[in] p_packet Received packet, with the MESH_TIME_HANDLE handle.
+ * @param[in] timestamp Time of reception, taken at the end of the packet.
+ */
+void mesh_time_rx(mesh_packet_t* p_packet, timestamp_t timestamp);
+
+/**
+ * Note the time a time beacon went on air. Called by the transport from the
+ * radio callback, in STACK_LOW.
+ *
+ * @param[in] p_packet Sent packet, with the MESH_TIME_HANDLE handle.
+ * @param[in] timestamp Time the packet was sent, taken at the end of it.
+ */
+void mesh_time_tx_end(mesh_packet_t* p_packet, timestamp_t timestamp);
+
+/** @} */
+
+#endif /* MESH_TIME_H__ */
@@ -0,0 +1,106 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef MESH_TRACE_H__
+#define MESH_TRACE_H__
+
+#include <stdint.h>
+
+/**
+ * @defgroup MESH_TRACE Hot path latency tracing
+ * Optional tracing of the entry and exit times of the mesh hot paths, enabled
+ * by defining MESH_TRACE. The nRF51 has no cycle counter, and TIMER0 is only
+ * available inside timeslots, so the trace runs a free running 16 bit timer
+ * of its own. The durations are collected in log2 histograms per site, and
+ * the last events are kept in a ring buffer, for radio to app latency. Both
+ * are dumped over SEGGER RTT with mesh_trace_dump(), which requires
+ * SEGGER_RTT.c in the build.
+ * @{
+ */
+
+/** Timer instance reserved for the trace. Must not be used by the application. */
+#ifndef MESH_TRACE_TIMER
+#define MESH_TRACE_TIMER            (NRF_TIMER2)
+#endif
+
+/** Prescaler for the trace timer. The default gives 1us ticks, and durations up to 65ms. */
+#ifndef MESH_TRACE_TIMER_PRESCALER
+#define MESH_TRACE_TIMER_PRESCALER  (4)
+#endif
+
+/** Number of trace events kept in the ring buffer. Must be a power of two. */
+#ifndef MESH_TRACE_RING_LENGTH
+#define MESH_TRACE_RING_LENGTH      (64)
+#endif
+
+/** Number of log2 buckets in each duration histogram. The last bucket holds everything above. */
+#define MESH_TRACE_HIST_BUCKETS     (12)
+
+/** Traced functions. */
+typedef enum
+{
+    MESH_TRACE_SITE_RX_CB,              /**< Radio RX callback, in transport_control. */
+    MESH_TRACE_SITE_VH_RX,              /**< Version handler packet processing. */
+    MESH_TRACE_SITE_TRANSMIT_ALL,       /**< Version handler periodic transmit. */
+    MESH_TRACE_SITE_ASYNC_EVT,          /**< Async event execution. */
+    MESH_TRACE_SITE_RADIO_SIGNAL,       /**< Timeslot radio signal callback. */
+    MESH_TRACE_SITE__COUNT
+} mesh_trace_site_t;
+
+#ifdef MESH_TRACE
+
+#define TRACE_ENTER(site)   mesh_trace_enter(site)
+#define TRACE_EXIT(site)    mesh_trace_exit(site)
+
+/** Start the trace timer and clear all records. */
+void mesh_trace_init(void);
+
+/** Register entry to a traced function. Nested entries to the same site are ignored. */
+void mesh_trace_enter(mesh_trace_site_t site);
+
+/** Register exit from a traced function, and add its duration to the histogram. */
+void mesh_trace_exit(mesh_trace_site_t site);
+
+/** Print the histograms and the ring buffer over RTT. */
+void mesh_trace_dump(void);
+
+#else /* MESH_TRACE */
+
+#define TRACE_ENTER(site)
+#define TRACE_EXIT(site)
+
+#define mesh_trace_init()
+#define mesh_trace_dump()
+
+#endif /* MESH_TRACE */
+
+/** @} */
+
+#endif /* MESH_TRACE_H__ */
@@ -0,0 +1,182 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef MESH_TYPED_H__
+#define MESH_TYPED_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup MESH_TYPED Typed values
+ * Compact encoding of numeric values, to fit several of them in one value
+ * payload. Each field starts with a tag byte holding its type in the upper
+ * 3 bits and an application defined ID in the lower 5 bits. Integers are
+ * sent as varints, 7 bits per byte with the top bit set on all but the last
+ * byte, and signed integers are zig-zag coded first, so small magnitudes of
+ * either sign take a single byte. A series holds consecutive samples as the
+ * first sample followed by the difference to the previous one, so slowly
+ * changing readings take about a byte per sample.
+ *
+ * Every value is self-contained: the mesh doesn't acknowledge updates, and
+ * a node may only ever see the latest version of a handle, so a series is
+ * never relative to an earlier version.
+ * @{
+ */
+
+/** Highest field ID. */
+#define MESH_TYPED_ID_MAX           (0x1F)
+/** Most bytes a 32 bit varint takes. */
+#define MESH_TYPED_VARINT_LEN_MAX   (5)
+
+/** Field types, in the upper 3 bits of the tag byte. */
+typedef enum
+{
+    MESH_TYPED_TYPE_UINT,   /**< Unsigned varint. */
+    MESH_TYPED_TYPE_SINT,   /**< Zig-zag coded varint. */
+    MESH_TYPED_TYPE_SERIES, /**< Sample count byte, then the first sample and the deltas as zig-zag coded varints. */
+    MESH_TYPED_TYPE_BYTES   /**< Length byte, then the bytes. */
+} mesh_typed_type_t;
+
+/** Buffer to encode fields into. */
+typedef struct
+{
+    uint8_t* p_buf;
+    uint8_t size;
+    uint8_t length; /**< Bytes encoded so far. */
+} mesh_typed_writer_t;
+
+/** Encoded buffer to decode fields from. */
+typedef struct
+{
+    const uint8_t* p_buf;
+    uint8_t length;
+    uint8_t offset; /**< Start of the next field. */
+} mesh_typed_reader_t;
+
+/** A decoded field. */
+typedef struct
+{
+    uint8_t id;
+    mesh_typed_type_t type;
+    union
+    {
+        uint32_t u;     /**< MESH_TYPED_TYPE_UINT value. */
+        int32_t s;      /**< MESH_TYPED_TYPE_SINT value. */
+        struct
+        {
+            const uint8_t* p_data;
+            uint8_t length;
+            uint8_t count;  /**< Number of samples, for MESH_TYPED_TYPE_SERIES. */
+        } raw;          /**< Encoded MESH_TYPED_TYPE_SERIES samples, or MESH_TYPED_TYPE_BYTES data. */
+    } value;
+} mesh_typed_field_t;
+
+/**
+ * Start encoding into a buffer.
+ *
+ * @param[out] p_writer Writer to initialize.
+ * @param[in] p_buf Buffer to encode into, usually a value payload.
+ * @param[in] size Size of the buffer.
+ */
+void mesh_typed_writer_init(mesh_typed_writer_t* p_writer, uint8_t* p_buf, uint8_t size);
+
+/**
+ * Add an unsigned integer field.
+ *
+ * @param[in,out] p_writer Writer to add the field to.
+ * @param[in] id Field ID, at most MESH_TYPED_ID_MAX.
+ * @param[in] value Value to add.
+ *
+ * @return NRF_SUCCESS The field was added.
+ * @return NRF_ERROR_INVALID_PARAM The ID is out of range.
+ * @return NRF_ERROR_NO_MEM The field doesn't fit. The writer is unchanged, so
+ *   the buffer can be sent, and the field added to a new one.
+ */
+uint32_t mesh_typed_put_uint(mesh_typed_writer_t* p_writer, uint8_t id, uint32_t value);
+
+/**
+ * Add a signed integer field. Returns as @ref mesh_typed_put_uint.
+ */
+uint32_t mesh_typed_put_sint(mesh_typed_writer_t* p_writer, uint8_t id, int32_t value);
+
+/**
+ * Add a series of consecutive samples. Returns as @ref mesh_typed_put_uint.
+ *
+ * @param[in,out] p_writer Writer to add the field to.
+ * @param[in] id Field ID, at most MESH_TYPED_ID_MAX.
+ * @param[in] p_samples Samples, oldest first.
+ * @param[in] count Number of samples, at least 1.
+ */
+uint32_t mesh_typed_put_series(mesh_typed_writer_t* p_writer, uint8_t id, const int32_t* p_samples, uint8_t count);
+
+/**
+ * Add a field of raw bytes. Returns as @ref mesh_typed_put_uint.
+ */
+uint32_t mesh_typed_put_bytes(mesh_typed_writer_t* p_writer, uint8_t id, const uint8_t* p_data, uint8_t length);
+
+/**
+ * Start decoding a buffer.
+ *
+ * @param[out] p_reader Reader to initialize.
+ * @param[in] p_buf Encoded buffer, usually a received value.
+ * @param[in] length Length of the buffer.
+ */
+void mesh_typed_reader_init(mesh_typed_reader_t* p_reader, const uint8_t* p_buf, uint8_t length);
+
+/**
+ * Decode the next field.
+ *
+ * @param[in,out] p_reader Reader to decode from.
+ * @param[out] p_field Field to fill. Raw data points into the reader's buffer.
+ *
+ * @return NRF_SUCCESS The field was decoded.
+ * @return NRF_ERROR_NOT_FOUND There are no more fields.
+ * @return NRF_ERROR_INVALID_DATA The field is truncated or malformed.
+ * @return NRF_ERROR_NOT_SUPPORTED The field has an unknown type. As its length
+ *   is unknown, the rest of the buffer can't be decoded.
+ */
+uint32_t mesh_typed_get(mesh_typed_reader_t* p_reader, mesh_typed_field_t* p_field);
+
+/**
+ * Decode the samples of a MESH_TYPED_TYPE_SERIES field.
+ *
+ * @param[in] p_field Series field from @ref mesh_typed_get.
+ * @param[out] p_samples Array to fill with the samples, oldest first.
+ * @param[in] max_count Length of the array.
+ *
+ * @return NRF_SUCCESS The samples were decoded, value.raw.count of them.
+ * @return NRF_ERROR_INVALID_PARAM The field isn't a series.
+ * @return NRF_ERROR_NO_MEM The array is too short.
+ */
+uint32_t mesh_typed_series_get(const mesh_typed_field_t* p_field, int32_t* p_samples, uint8_t max_count);
+
+/** @} */
+
+#endif /* MESH_TYPED_H__ */
@@ -0,0 +1,118 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#ifndef MESH_WATERMARK_H__
+#define MESH_WATERMARK_H__
+
+#include <stdint.h>
+#include "fifo.h"
+
+/**
+ * @defgroup MESH_WATERMARK Stack and RAM high-water marks
+ * Optional RAM usage instrumentation, enabled by defining MESH_WATERMARK.
+ * mesh_watermark_init() fills the heap and the unused part of the stack with
+ * a known pattern, and the deepest word that no longer holds it gives the
+ * peak usage. All interrupts share the main stack on the nRF51, so each
+ * measured context paints MESH_WATERMARK_WINDOW bytes below its stack
+ * pointer on entry, and finds its own peak in them on exit. The window is
+ * painted again on exit, so the context it interrupted only sees its own
+ * usage. Together with the peak occupancy of every fifo_t and of the packet
+ * pool, the results are printed over SEGGER RTT with mesh_watermark_dump(),
+ * which requires SEGGER_RTT.c in the build.
+ *
+ * A context's peak is counted from its stack pointer at WATERMARK_ENTER().
+ * The exception frames of the interrupts that come in, the Softdevice and
+ * uninstrumented interrupts all use the stack of the context they interrupt,
+ * and count in its peak. Painting takes some microseconds per entry, so
+ * don't leave MESH_WATERMARK in production builds.
+ * @{
+ */
+
+/** Bytes painted below the stack pointer when a context is entered. Deeper usage is reported as the window size. */
+#ifndef MESH_WATERMARK_WINDOW
+#define MESH_WATERMARK_WINDOW       (512)
+#endif
+
+/** Number of fifos tracked. Fifos initialized after this many are left out of the dump. */
+#ifndef MESH_WATERMARK_FIFOS_MAX
+#define MESH_WATERMARK_FIFOS_MAX    (16)
+#endif
+
+/** Measured execution contexts. */
+typedef enum
+{
+    MESH_WATERMARK_CONTEXT_RADIO,       /**< Timeslot radio signal callback, or the radio and timer IRQs without a Softdevice. */
+    MESH_WATERMARK_CONTEXT_EVENT,       /**< Async event handler in APP LOW, QDEC_IRQHandler. */
+    MESH_WATERMARK_CONTEXT_SERIAL,      /**< UART IRQ of the serial interface. */
+    MESH_WATERMARK_CONTEXT_APP_0,       /**< Free for the application, like an SWI0_IRQHandler running app_timer. */
+    MESH_WATERMARK_CONTEXT_APP_1,       /**< Free for the application, like the Softdevice event handler. */
+    MESH_WATERMARK_CONTEXT__COUNT
+} mesh_watermark_context_t;
+
+#ifdef MESH_WATERMARK
+
+#define WATERMARK_ENTER(context)    mesh_watermark_enter(context)
+#define WATERMARK_EXIT(context)     mesh_watermark_exit(context)
+
+/**
+ * Paint the heap and the stack below the caller. Call it as early as
+ * possible, rbc_mesh_init() does.
+ */
+void mesh_watermark_init(void);
+
+/** Register entry to a measured context, first thing in its handler. */
+void mesh_watermark_enter(mesh_watermark_context_t context);
+
+/** Register exit from a measured context, on every return path of its handler. */
+void mesh_watermark_exit(mesh_watermark_context_t context);
+
+/** Track the peak occupancy of a fifo. Called by fifo_init(). */
+void mesh_watermark_fifo_register(fifo_t* p_fifo);
+
+/**
+ * Print the peaks over RTT. Scans the whole stack and heap, so call it from
+ * the main loop, for example every few seconds. The peaks aren't cleared.
+ */
+void mesh_watermark_dump(void);
+
+#else /* MESH_WATERMARK */
+
+#define WATERMARK_ENTER(context)
+#define WATERMARK_EXIT(context)
+
+#define mesh_watermark_init()
+#define mesh_watermark_fifo_register(p_fifo)
+#define mesh_watermark_dump()
+
+#endif /* MESH_WATERMARK */
+
+/** @} */
+
+#endif /* MESH_WATERMARK_H__ */
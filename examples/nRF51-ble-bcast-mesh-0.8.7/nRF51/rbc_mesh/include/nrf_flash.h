@@ -41,10 +41,23 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 void nrf_flash_erase(uint32_t * page_address, uint32_t size);
 
-/** @brief Function for filling a page in flash with a value.
+#ifdef NVMC_ERASEPAGEPARTIALCFG_DURATION_Pos
+/** @brief Function for erasing a page in flash in slices. The page is erased
+ * once the slices add up to the full page erase time.
  *
- * @param[in] address Address of the first word in the page to be filled.
- * @param[in] value Value to be written to flash.
+ * @param page_address Address of the first word in the page to be erased.
+ * @param duration_ms Length of the slice.
+ */
+void nrf_flash_erase_partial(uint32_t * page_address, uint32_t duration_ms);
+#endif
+
+/** @brief Function for writing a block of data to flash. Write is enabled
+ * once per page, and words that are all 0xFF are skipped.
+ *
+ * @param[in] p_dest Start of the flash area.
+ * @param[in] p_src Data to write.
+ * @param[in] size Number of bytes to write.
+ * @param[in] offset Word aligned offset into p_dest to write at.
  */
 void nrf_flash_store(uint32_t * p_dest, uint8_t * p_src, uint32_t size, uint32_t offset);
 
@@ -58,6 +58,8 @@ typedef struct
     radio_event_type_t event_type;  /**< RX/TX */
     uint8_t channel;                /**< Channel to execute event on */
     uint8_t tx_power;               /**< Transmit power for TX events */
+    bool backbone;                  /**< Operate on the backbone access address in the nRF 2 Mbit mode, instead of the BLE 1 Mbit mode. Overrides access_address. */
+    bool bridge;                    /**< Operate on the bridged network's access address, set through radio_bridge_aa_set(). Overrides access_address. */
 } radio_event_t;
 
 /**
@@ -84,6 +86,28 @@ void radio_init(radio_idle_cb_t idle_cb,
 */
 void radio_alt_aa_set(uint32_t access_address);
 
+/**
+* @brief Set the access address of the backbone bearer.
+*
+* @details Backbone events use the nRF 2 Mbit mode with the same packet
+*   format as the BLE events, so a packet takes half the air time. Only
+*   nodes using the same backbone address hear them.
+*
+* @param[in] access_address The 32bit backbone access address.
+*/
+void radio_backbone_aa_set(uint32_t access_address);
+
+/**
+* @brief Set the access address of the bridged network.
+*
+* @details Bridge events use the BLE 1 Mbit mode, with the bridge address in
+*   place of the default BLE advertisement address, so they only hear and
+*   reach the nodes of the other network.
+*
+* @param[in] access_address The 32bit access address of the bridged network.
+*/
+void radio_bridge_aa_set(uint32_t access_address);
+
 /**
 * @brief Schedule a radio event (tx/rx)
 *
@@ -92,6 +116,12 @@ void radio_alt_aa_set(uint32_t access_address);
 */
 uint32_t radio_order(radio_event_t* radio_event);
 
+/**
+* @brief Get the number of events in the radio queue, including the one in
+*   progress.
+*/
+uint32_t radio_queue_len_get(void);
+
 /**
 * @brief Disable the radio. Overrides any ongoing rx or tx procedures
 */
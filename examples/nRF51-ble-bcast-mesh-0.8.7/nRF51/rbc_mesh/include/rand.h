@@ -75,6 +75,46 @@ uint32_t rand_prng_seed(prng_t* p_prng);
  */
 uint32_t rand_prng_get(prng_t* p_prng);
 
+/**
+ * Get a pseudo-random value in the range [0, range) from the given PRNG instance, without the
+ * bias of taking the modulo of a 32bit value.
+ *
+ * @param[in,out] p_prng The PRNG instance to get a value from.
+ * @param[in] range The upper bound of the value, exclusive. Must be larger than 0.
+ *
+ * @return A pseudo-random value lower than range.
+ */
+uint32_t rand_prng_range(prng_t* p_prng, uint32_t range);
+
+/**
+ * Seed the shared PRNG instance from the HW RNG module. Only the first call has any effect,
+ * so every module using the shared instance may call it in its own init.
+ *
+ * @return NRF_SUCCESS The shared instance is seeded.
+ */
+uint32_t rand_init(void);
+
+/**
+ * Get a 32bit pseudo-random value from the shared PRNG instance.
+ *
+ * @warning Not for cryptographic purposes, see @ref rand_prng_get.
+ */
+uint32_t rand_get(void);
+
+/**
+ * Get a pseudo-random value in the range [0, range) from the shared PRNG instance.
+ *
+ * @param[in] range The upper bound of the value, exclusive. Must be larger than 0.
+ */
+uint32_t rand_range(uint32_t range);
+
+/**
+ * Collect fresh entropy from the HW RNG module for the shared PRNG instance, without waiting
+ * for it. The entropy is mixed into the instance on the next get. Should be called
+ * regularly from a context that is allowed to call the Softdevice.
+ */
+void rand_refill(void);
+
 /**
  * Get a variable length array of random bytes from the HW RNG module.
  *
@@ -41,12 +41,81 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define __MODULE__ __FILE__
 #endif
 
+#ifdef RTT_LOG_DEFERRED
+#include <stdint.h>
+
+/**
+ * @defgroup RTT_LOG_DEFERRED Deferred logging
+ * With RTT_LOG_DEFERRED defined as well as RTT_LOG, __LOG doesn't format the
+ * string at the call site. It only stores the address of the format string
+ * and the arguments in a RAM ring buffer, which takes a few dozen cycles, so
+ * logging can stay enabled in timing critical contexts. The application
+ * calls rtt_log_flush() from its main loop, which is the lowest priority
+ * context, to move the records to RTT channel RTT_LOG_CHANNEL, and
+ * interactive_pyaci/rtt_log_decode.py expands them on the host, with the
+ * format strings read from the ELF file of the build.
+ *
+ * Arguments are stored as 32 bit words, so 64 bit arguments aren't
+ * supported, and strings printed with %s must be constant, as the host only
+ * sees the strings of the ELF file. Records that don't fit in the ring
+ * buffer are dropped, and counted in the next record.
+ * @{
+ */
+
+/** RTT up buffer the records are written to. Channel 0 stays free for text. */
+#ifndef RTT_LOG_CHANNEL
+#define RTT_LOG_CHANNEL             (1)
+#endif
+
+/** Size of the ring buffer of records, in 32 bit words. Must be a power of two. */
+#ifndef RTT_LOG_BUFFER_WORDS
+#define RTT_LOG_BUFFER_WORDS        (256)
+#endif
+
+/** Size of the RTT up buffer of RTT_LOG_CHANNEL, in bytes. */
+#ifndef RTT_LOG_RTT_BUFFER_SIZE
+#define RTT_LOG_RTT_BUFFER_SIZE     (256)
+#endif
+
+/** Highest number of arguments to a single __LOG call. */
+#define RTT_LOG_ARGS_MAX            (8)
+
+#define RTT_LOG_NARGS(...) RTT_LOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define RTT_LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#define __LOG(str, ...) rtt_log_deferred(str, RTT_LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__)
+
+/**
+ * Store a record in the ring buffer. Called through __LOG, from any context.
+ *
+ * @param[in] p_format Format string, must be constant.
+ * @param[in] arg_count Number of arguments that follow, at most
+ *   RTT_LOG_ARGS_MAX.
+ */
+void rtt_log_deferred(const char* p_format, uint32_t arg_count, ...);
+
+/**
+ * Write the stored records to RTT, as far as the RTT buffer has room. Must
+ * only be called from one context at a time, typically the main loop.
+ */
+void rtt_log_flush(void);
+
+/** @} */
+
+#else /* RTT_LOG_DEFERRED */
+
 #define __LOG(str, ...) SEGGER_RTT_printf(0, RTT_CTRL_RESET str, ##__VA_ARGS__)
 
+#define rtt_log_flush()
+
+#endif /* RTT_LOG_DEFERRED */
+
 #else /* RTT_LOG */
 
 #define __LOG(str, ...)
 
+#define rtt_log_flush()
+
 #endif /* RTT_LOG */
 
 #endif /* RTT_LOG_H__ */
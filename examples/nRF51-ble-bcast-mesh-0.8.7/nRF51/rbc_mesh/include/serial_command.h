@@ -41,6 +41,13 @@ typedef __packed_armcc enum
     SERIAL_CMD_OPCODE_ECHO                  = 0x02,
     SERIAL_CMD_OPCODE_RADIO_RESET           = 0x0E,
     
+    SERIAL_CMD_OPCODE_SNIFFER_STATS_GET     = 0x69,
+    SERIAL_CMD_OPCODE_SNIFFER_SET           = 0x6A,
+    SERIAL_CMD_OPCODE_FAULT_GET             = 0x6B,
+    SERIAL_CMD_OPCODE_VALUE_DUMP            = 0x6C,
+    SERIAL_CMD_OPCODE_SURVEY_SET            = 0x6D,
+    SERIAL_CMD_OPCODE_SURVEY_GET            = 0x6E,
+    SERIAL_CMD_OPCODE_VALUE_GET_BULK        = 0x6F,
     SERIAL_CMD_OPCODE_INIT                  = 0x70,
     SERIAL_CMD_OPCODE_VALUE_SET             = 0x71,
     SERIAL_CMD_OPCODE_VALUE_ENABLE          = 0x72,
@@ -50,11 +57,13 @@ typedef __packed_armcc enum
     SERIAL_CMD_OPCODE_FLAG_SET              = 0x76,
     SERIAL_CMD_OPCODE_FLAG_GET              = 0x77,
     SERIAL_CMD_OPCODE_DFU                   = 0x78,
+    SERIAL_CMD_OPCODE_VALUE_SET_BULK        = 0x79,
 
     SERIAL_CMD_OPCODE_VALUE_GET             = 0x7A,
     SERIAL_CMD_OPCODE_BUILD_VERSION_GET     = 0x7B,
     SERIAL_CMD_OPCODE_ACCESS_ADDR_GET       = 0x7C,
     SERIAL_CMD_OPCODE_CHANNEL_GET           = 0x7D,
+    SERIAL_CMD_OPCODE_STATS_GET             = 0x7E,
     SERIAL_CMD_OPCODE_INTERVAL_GET          = 0x7F,    
 } __packed_gcc serial_cmd_opcode_t;
 
@@ -88,7 +97,7 @@ typedef __packed_armcc struct
 typedef __packed_armcc struct 
 {
     rbc_mesh_value_handle_t handle;
-    uint8_t value[RBC_MESH_VALUE_MAX_LEN];
+    uint8_t value[RBC_MESH_LEGACY_VALUE_MAX_LEN];
 } __packed_gcc serial_cmd_params_value_set_t;
 
 typedef __packed_armcc struct 
@@ -111,6 +120,61 @@ typedef __packed_armcc struct
     dfu_packet_t packet;
 } __packed_gcc serial_cmd_params_dfu_t;
 
+typedef __packed_armcc struct 
+{
+    uint16_t interval_ms; /**< Survey interval, or 0 to stop the survey. */
+} __packed_gcc serial_cmd_params_survey_set_t;
+
+typedef __packed_armcc struct 
+{
+    uint8_t index; /**< Index of the survey table entry. */
+} __packed_gcc serial_cmd_params_survey_get_t;
+
+typedef __packed_armcc struct 
+{
+    uint8_t index; /**< Index of the fault, 0 for the latest one. */
+} __packed_gcc serial_cmd_params_fault_get_t;
+
+typedef __packed_armcc struct 
+{
+    uint8_t enable;                     /**< 1 to start the sniffer, 0 to stop it. */
+    rbc_mesh_value_handle_t handle_min; /**< Lowest handle to pass. */
+    rbc_mesh_value_handle_t handle_max; /**< Highest handle to pass. */
+    int8_t rssi_min;                    /**< Weakest RSSI to pass, in dBm. */
+    uint8_t addr_filter;                /**< 1 to only pass packets from addr. */
+    uint8_t addr_type;
+    uint8_t addr[BLE_GAP_ADDR_LEN];
+} __packed_gcc serial_cmd_params_sniffer_set_t;
+
+/** Highest number of values in a bulk command, one bit each in the response bitmap. */
+#define SERIAL_CMD_VALUE_BULK_MAX_COUNT     (16)
+/** Space for records in a value set bulk command, SERIAL_DATA_MAX_LEN less the opcode. */
+#define SERIAL_CMD_VALUE_SET_BULK_CAPACITY  (35)
+#define SERIAL_CMD_VALUE_RECORD_OVERHEAD    (2 /* handle */ + 1 /* length */)
+
+/** Value record in a bulk command or response. The data field is length bytes long. */
+typedef __packed_armcc struct
+{
+    rbc_mesh_value_handle_t handle;
+    uint8_t length;
+    uint8_t data[];
+} __packed_gcc serial_value_record_t;
+
+typedef __packed_armcc struct 
+{
+    uint8_t records[SERIAL_CMD_VALUE_SET_BULK_CAPACITY];
+} __packed_gcc serial_cmd_params_value_set_bulk_t;
+
+typedef __packed_armcc struct 
+{
+    rbc_mesh_value_handle_t handles[SERIAL_CMD_VALUE_BULK_MAX_COUNT];
+} __packed_gcc serial_cmd_params_value_get_bulk_t;
+
+
+typedef __packed_armcc struct 
+{
+    uint16_t cursor; /**< Where to start, 0 for the first value. */
+} __packed_gcc serial_cmd_params_value_dump_t;
 
 
 
@@ -129,6 +193,13 @@ typedef __packed_armcc struct
         serial_cmd_params_value_disable_t   value_disable;
         serial_cmd_params_value_get_t       value_get;
         serial_cmd_params_dfu_t             dfu;
+        serial_cmd_params_value_set_bulk_t  value_set_bulk;
+        serial_cmd_params_value_get_bulk_t  value_get_bulk;
+        serial_cmd_params_survey_set_t      survey_set;
+        serial_cmd_params_survey_get_t      survey_get;
+        serial_cmd_params_value_dump_t      value_dump;
+        serial_cmd_params_fault_get_t       fault_get;
+        serial_cmd_params_sniffer_set_t     sniffer_set;
     } __packed_gcc params;
 } __packed_gcc  serial_cmd_t;
 
@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "toolchain.h"
 #include "mesh_aci.h"
 #include "dfu_types_mesh.h"
@@ -46,6 +47,9 @@ typedef __packed_armcc enum
     SERIAL_EVT_OPCODE_EVENT_UPDATE          = 0xB4,
     SERIAL_EVT_OPCODE_EVENT_CONFLICTING     = 0xB5,
     SERIAL_EVT_OPCODE_EVENT_TX              = 0xB6,
+    SERIAL_EVT_OPCODE_EVENT_BATCH           = 0xB7,
+    SERIAL_EVT_OPCODE_EVENT_VALUE_DUMP      = 0xB8,
+    SERIAL_EVT_OPCODE_EVENT_SNIFFER         = 0xB9,
     SERIAL_EVT_OPCODE_DFU                   = 0x78
 } __packed_gcc serial_evt_opcode_t;
 
@@ -91,7 +95,7 @@ typedef __packed_armcc struct
 typedef __packed_armcc struct
 {
     rbc_mesh_value_handle_t handle;
-    uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+    uint8_t data[RBC_MESH_LEGACY_VALUE_MAX_LEN];
 } __packed_gcc serial_evt_cmd_rsp_params_val_get_t;
 
 typedef __packed_armcc struct
@@ -99,6 +103,59 @@ typedef __packed_armcc struct
     uint16_t packet_type;
 } __packed_gcc serial_evt_cmd_rsp_params_dfu_t;
 
+/** Space for value records in a value get bulk response. */
+#define SERIAL_EVT_VALUE_GET_BULK_CAPACITY  (31)
+
+typedef __packed_armcc struct
+{
+    uint16_t success_mask; /**< Bit i is set if value i in the command was set. */
+} __packed_gcc serial_evt_cmd_rsp_params_val_set_bulk_t;
+
+typedef __packed_armcc struct
+{
+    uint16_t success_mask; /**< Bit i is set if value i in the command has a record in the response. */
+    uint8_t records[SERIAL_EVT_VALUE_GET_BULK_CAPACITY]; /**< serial_value_record_t records, in command order. */
+} __packed_gcc serial_evt_cmd_rsp_params_val_get_bulk_t;
+
+typedef __packed_armcc struct
+{
+    rbc_mesh_stats_t stats;
+} __packed_gcc serial_evt_cmd_rsp_params_stats_t;
+
+typedef __packed_armcc struct
+{
+    uint8_t addr_type;
+    uint8_t addr[BLE_GAP_ADDR_LEN];
+    uint8_t channel;
+    uint8_t tx_power;
+    uint8_t rssi_avg;
+    uint8_t rssi_worst;
+    uint16_t received;
+    uint16_t expected;
+} __packed_gcc serial_evt_cmd_rsp_params_survey_get_t;
+
+typedef __packed_armcc struct
+{
+    uint16_t cursor; /**< Cursor to continue the dump from, or SERIAL_VALUE_DUMP_CURSOR_END. */
+} __packed_gcc serial_evt_cmd_rsp_params_value_dump_t;
+
+typedef __packed_armcc struct
+{
+    rbc_mesh_fault_record_t record;
+} __packed_gcc serial_evt_cmd_rsp_params_fault_get_t;
+
+typedef __packed_armcc struct
+{
+    uint32_t passed;    /**< Packets that passed the filter. */
+    uint32_t filtered;  /**< Packets that didn't pass the filter. */
+    uint32_t dropped;   /**< Records dropped because the serial queue was full. */
+    uint32_t frames;    /**< Sniffer frames sent. */
+} __packed_gcc serial_evt_cmd_rsp_params_sniffer_stats_t;
+
+/** Part of the stats sent in the stats response. The newer counters don't
+   fit in a serial event, and are only available through rbc_mesh_stats_get(). */
+#define SERIAL_EVT_STATS_LEN    (offsetof(rbc_mesh_stats_t, rx_filtered))
+
 /****** EVT PARAMS ******/
 typedef __packed_armcc struct
 {
@@ -118,33 +175,99 @@ typedef __packed_armcc struct
         serial_evt_cmd_rsp_params_int_min_t int_min;
         serial_evt_cmd_rsp_params_val_get_t val_get;
         serial_evt_cmd_rsp_params_dfu_t dfu;
+        serial_evt_cmd_rsp_params_val_set_bulk_t val_set_bulk;
+        serial_evt_cmd_rsp_params_val_get_bulk_t val_get_bulk;
+        serial_evt_cmd_rsp_params_stats_t stats;
+        serial_evt_cmd_rsp_params_survey_get_t survey_get;
+        serial_evt_cmd_rsp_params_value_dump_t value_dump;
+        serial_evt_cmd_rsp_params_fault_get_t fault_get;
+        serial_evt_cmd_rsp_params_sniffer_stats_t sniffer_stats;
     } __packed_gcc response;        
 } __packed_gcc serial_evt_params_cmd_rsp_t;
 
 typedef __packed_armcc struct
 {
     rbc_mesh_value_handle_t handle;
-    uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+    uint8_t data[RBC_MESH_LEGACY_VALUE_MAX_LEN];
 } __packed_gcc serial_evt_params_event_new_t;
 
 typedef __packed_armcc struct
 {
     rbc_mesh_value_handle_t handle;
-    uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+    uint8_t data[RBC_MESH_LEGACY_VALUE_MAX_LEN];
 } __packed_gcc serial_evt_params_event_update_t;
 
 typedef __packed_armcc struct 
 {
     rbc_mesh_value_handle_t handle;
-    uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+    uint8_t data[RBC_MESH_LEGACY_VALUE_MAX_LEN];
 } __packed_gcc serial_evt_params_event_conflicting_t;
 
 typedef __packed_armcc struct 
 {
     rbc_mesh_value_handle_t handle;
-    uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+    uint8_t data[RBC_MESH_LEGACY_VALUE_MAX_LEN];
 } __packed_gcc serial_evt_params_event_tx_t;
 
+/** Space for records in an event batch, SERIAL_DATA_MAX_LEN less the opcode. */
+#define SERIAL_EVT_BATCH_CAPACITY           (35)
+#define SERIAL_EVT_BATCH_RECORD_OVERHEAD    (1 /* opcode */ + 2 /* handle */ + 1 /* length */)
+
+/** Value event record in an event batch. The data field is length bytes long. */
+typedef __packed_armcc struct
+{
+    uint8_t opcode; /**< Opcode the event would have had on its own. */
+    rbc_mesh_value_handle_t handle;
+    uint8_t length;
+    uint8_t data[];
+} __packed_gcc serial_evt_batch_record_t;
+
+typedef __packed_armcc struct
+{
+    uint8_t records[SERIAL_EVT_BATCH_CAPACITY];
+} __packed_gcc serial_evt_params_event_batch_t;
+
+/** Cursor value for a finished value dump. */
+#define SERIAL_VALUE_DUMP_CURSOR_END        (0xFFFF)
+/** Space for records in a value dump frame, SERIAL_DATA_MAX_LEN less the opcode and cursor. */
+#define SERIAL_EVT_VALUE_DUMP_CAPACITY      (33)
+#define SERIAL_EVT_VALUE_DUMP_RECORD_OVERHEAD (2 /* handle */ + 2 /* version */ + 1 /* length */)
+
+/** Value record in a value dump frame. The data field is length bytes long. */
+typedef __packed_armcc struct
+{
+    rbc_mesh_value_handle_t handle;
+    uint16_t version;
+    uint8_t length;
+    uint8_t data[];
+} __packed_gcc serial_evt_value_dump_record_t;
+
+typedef __packed_armcc struct
+{
+    uint16_t cursor; /**< Cursor to resume from after this frame, or SERIAL_VALUE_DUMP_CURSOR_END. */
+    uint8_t records[SERIAL_EVT_VALUE_DUMP_CAPACITY];
+} __packed_gcc serial_evt_params_event_value_dump_t;
+
+/** Space for records in a sniffer frame, SERIAL_DATA_MAX_LEN less the opcode, base time and drop count. */
+#define SERIAL_EVT_SNIFFER_CAPACITY         (29)
+
+/** Packet record in a sniffer frame. */
+typedef __packed_armcc struct
+{
+    uint16_t time_offset;           /**< Microseconds from the base time of the frame to the reception. */
+    uint8_t rssi;                   /**< Negative RSSI of the packet. */
+    uint16_t src;                   /**< Lowest two bytes of the advertiser address. */
+    rbc_mesh_value_handle_t handle;
+    uint16_t version;
+} __packed_gcc serial_evt_sniffer_record_t;
+
+typedef __packed_armcc struct
+{
+    uint32_t base_time; /**< Reception time of the first record, in microseconds. */
+    uint16_t dropped;   /**< Records dropped since the previous frame, saturating. */
+    uint8_t records[SERIAL_EVT_SNIFFER_CAPACITY];
+} __packed_gcc serial_evt_params_event_sniffer_t;
+
 typedef __packed_armcc struct 
 {
     operating_mode_t operating_mode;
@@ -169,6 +292,9 @@ typedef __packed_armcc struct
         serial_evt_params_event_update_t            event_update;
         serial_evt_params_event_conflicting_t       event_conflicting;
         serial_evt_params_event_tx_t                event_tx;
+        serial_evt_params_event_batch_t             event_batch;
+        serial_evt_params_event_value_dump_t        event_value_dump;
+        serial_evt_params_event_sniffer_t           event_sniffer;
         serial_evt_params_event_device_started_t    device_started;
         serial_evt_params_dfu_t                     dfu;
 	} __packed_gcc params;
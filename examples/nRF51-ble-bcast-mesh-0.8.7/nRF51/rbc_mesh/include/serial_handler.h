@@ -32,6 +32,37 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define SERIAL_DATA_MAX_LEN  (36)
 
+/** Number of events that can wait for transmit. Must be power of two. A
+ * gateway forwarding a busy mesh to its host should raise it, to avoid
+ * dropped events. */
+#ifndef SERIAL_HANDLER_TX_QUEUE_LENGTH
+#define SERIAL_HANDLER_TX_QUEUE_LENGTH  (4)
+#endif
+
+/** Number of received commands that can wait for processing. Must be power of two. */
+#ifndef SERIAL_HANDLER_RX_QUEUE_LENGTH
+#define SERIAL_HANDLER_RX_QUEUE_LENGTH  (4)
+#endif
+
+/** UART baud rate, as a UART_BAUDRATE_BAUDRATE_* value. Rates up to
+ * UART_BAUDRATE_BAUDRATE_Baud1M are supported, as the UART transport always
+ * runs with hardware flow control. */
+#ifndef SERIAL_UART_BAUDRATE
+#define SERIAL_UART_BAUDRATE            (UART_BAUDRATE_BAUDRATE_Baud115200)
+#endif
+
+/** Pack several frames into each SPI transaction, and report the number of
+ * free command slots in the first byte of every transaction, so the host can
+ * keep a window of commands in flight instead of one per transaction. */
+#ifndef SERIAL_SPI_STREAMING
+#define SERIAL_SPI_STREAMING            (0)
+#endif
+
+/** Size of the SPI stream buffers in each direction, at most 255. */
+#ifndef SERIAL_SPI_STREAM_BUFFER_SIZE
+#define SERIAL_SPI_STREAM_BUFFER_SIZE   (128)
+#endif
+
 #include "serial_evt.h"
 #include "serial_command.h"
 
@@ -47,6 +78,7 @@ typedef __packed_armcc struct
 
 void serial_handler_init(void);
 
+/** Number of commands the host may send before the next one would be dropped. */
 uint32_t serial_handler_credit_available(void);
 
 void serial_wait_for_completion(void);
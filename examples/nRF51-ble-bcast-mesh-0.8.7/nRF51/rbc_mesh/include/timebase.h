@@ -0,0 +1,83 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef TIMEBASE_H__
+#define TIMEBASE_H__
+
+#include <stdint.h>
+#include "timer.h"
+
+/**
+* @defgroup TIMEBASE 64 bit monotonic timebase.
+* Microsecond time that never wraps. Follows the Softdevice's RTC0 between
+* timeslots, extended to 64 bits in software, and TIMER0 inside timeslots. The
+* framework's 32 bit timestamps are the lower half of the timebase, so any
+* timestamp may be extended with @ref timebase_extend.
+*
+* @note The RTC0 counter wraps every 512 seconds, and the timebase must be
+*   read at least that often to catch the wraps. The framework reads it at the
+*   start of every timeslot, so this only matters while it's stopped.
+* @{
+*/
+
+/** Start the timebase at 0. Called by the timeslot module on init. */
+void timebase_init(void);
+
+/**
+* Start following TIMER0. Called by the timeslot module at the start of each
+*   timeslot, before the timer module is told about the timeslot.
+*
+* @return The time at the start of the timeslot.
+*/
+uint64_t timebase_on_ts_begin(void);
+
+/** Go back to following RTC0. Called by the timeslot module at the end of each timeslot. */
+void timebase_on_ts_end(void);
+
+/**
+* Get the current time. Never goes backwards, even when TIMER0 and RTC0 have
+*   drifted apart over a timeslot.
+*
+* @return Microseconds since the timebase was started.
+*/
+uint64_t timebase_now(void);
+
+/**
+* Extend a 32 bit framework timestamp to the timebase, assuming it's within
+*   35 minutes of the current time.
+*
+* @param[in] timestamp Timestamp to extend.
+*
+* @return The timestamp in the 64 bit timebase.
+*/
+uint64_t timebase_extend(timestamp_t timestamp);
+
+/** @} */
+
+#endif /* TIMEBASE_H__ */
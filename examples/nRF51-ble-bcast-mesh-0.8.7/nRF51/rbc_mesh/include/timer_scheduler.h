@@ -36,7 +36,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 /**
  * @defgroup TIMER_SCHEDULER Asynchronous event scheduler.
- * Scalable event scheduling on the high frequency timer.
+ * Scalable event scheduling on the high frequency timer. Events are kept in
+ * a hashed timing wheel, so scheduling, aborting and rescheduling are O(1).
  * @{
  */
 
@@ -59,6 +60,7 @@ typedef struct timer_event
     timestamp_t         interval;  /**< Interval in us between each fire for periodic timers, or 0 if single-shot */
     void *              p_context; /**< Pointer to data passed on to the callback. */
     struct timer_event* p_next;    /**< Pointer to next event in linked list. Only for internal usage. */
+    struct timer_event** pp_prev;  /**< Pointer to the link pointing to this event, or NULL if not scheduled. Only for internal usage. */
 } timer_event_t;
 
 /**
@@ -69,10 +71,12 @@ typedef struct timer_event
 uint32_t timer_sch_init(void);
 
 /**
- * Schedule a timer event.
+ * Schedule a timer event. Scheduling an event that is already scheduled moves it to the new
+ * timestamp.
  *
  * @param[in] p_timer_evt A pointer to a statically allocated timer event, which will be used as
- *  context for the schedulable event.
+ *  context for the schedulable event. The internal fields must be zero before first use, as they
+ *  are for static allocations.
  *
  * @warning The structure parameters should not change after the structure has been given to the
  *  scheduler, as this may cause a race condition. If a change in timing is needed, please use the
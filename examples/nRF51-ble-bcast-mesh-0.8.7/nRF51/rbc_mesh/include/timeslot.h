@@ -42,7 +42,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *   Module responsible for providing a safe interface to Softdevice
  *   Timeslot API. Handles all system events, makes sure all timeslots are
  *   ended in time, provides some simple functions for manipulating the way
- *   timeslots behave.
+ *   timeslots behave. Built without SOFTDEVICE_PRESENT, the framework
+ *   owns the radio and TIMER0, and runs in one timeslot from
+ *   timeslot_resume() to timeslot_stop().
  */
 
 /**
@@ -102,6 +104,49 @@ timestamp_t timeslot_end_time_get(void);
  */
 timestamp_t timeslot_remaining_time_get(void);
 
+/**
+ * Get the share of time spent in timeslots, averaged over the last
+ * TIMESLOT_DUTY_CYCLE_WINDOW_US or so.
+ *
+ * @return The radio duty cycle in permille.
+ */
+uint32_t timeslot_duty_cycle_get(void);
+
+/**
+ * Get the measured drift of an RC oscillator LF clock against the HF crystal.
+ * The timeslot end margin is based on this measurement instead of the rated
+ * accuracy of the oscillator, once available.
+ *
+ * @return The drift in ppm, or 0 if the LF clock isn't the RC oscillator or
+ *         hasn't been measured yet.
+ */
+uint32_t timeslot_lfclk_drift_get(void);
+
+/**
+ * Get the length currently requested for each timeslot extension, as set by
+ * the traffic load.
+ *
+ * @return The current extension length in microseconds.
+ */
+timestamp_t timeslot_extend_length_get(void);
+
+/**
+ * Limit the timeslot duty cycle to RBC_MESH_LP_DUTY_CYCLE_PERMILLE, by not
+ * extending timeslots, and requesting each one some time after the previous.
+ *
+ * @param[in] low_power Whether to limit the duty cycle.
+ */
+void timeslot_low_power_set(bool low_power);
+
+/**
+ * Tell the timeslot module when the framework next needs the radio. In low
+ * power mode, the next timeslot is requested to start at this time, if the
+ * duty cycle allows it.
+ *
+ * @param[in] timestamp When the framework next needs the radio.
+ */
+void timeslot_wakeup_set(timestamp_t timestamp);
+
 /**
  * Get whether the framework is currently in a timeslot.
  *
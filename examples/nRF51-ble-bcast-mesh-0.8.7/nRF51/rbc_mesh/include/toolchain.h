@@ -42,6 +42,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     #define _DISABLE_IRQS(_was_masked) _was_masked = __disable_irq()
     #define _ENABLE_IRQS(_was_masked) if (!_was_masked) { __enable_irq(); }
 
+    #define _NOINIT __attribute__((section(".noinit"), zero_init))
+
+    #define _RETURN_ADDRESS() ((uint32_t) __return_address())
+
 #elif defined(__GNUC__)
 
     #define __packed_armcc
@@ -53,11 +57,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     } while(0)
 
     #define _ENABLE_IRQS(_was_masked) if (!_was_masked) { __enable_irq(); }
+
+    #define _NOINIT __attribute__((section(".noinit")))
+
+    #define _RETURN_ADDRESS() ((uint32_t) __builtin_return_address(0))
 #elif defined(__IAR_SYSTEMS_ICC__)
   #define __packed_gcc
   #define __packed_armcc __packed
   #define _DISABLE_IRQS(_was_masked) do { _was_masked = __get_PRIMASK(); __disable_irq(); } while (0)
   #define _ENABLE_IRQS(_was_masked) __set_PRIMASK(_was_masked)
+  #define _NOINIT __no_init
+  #define _RETURN_ADDRESS() (0)
   #if defined(__cplusplus) && !defined(__STDC_LIMIT_MACROS)
     #error "Please define __STDC_LIMIT_MACROS in your project options!"
   #endif
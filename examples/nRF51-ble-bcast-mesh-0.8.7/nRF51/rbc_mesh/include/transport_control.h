@@ -71,6 +71,40 @@ void tc_radio_params_set(uint32_t access_address, uint8_t channel);
 
 void tc_on_ts_begin(void);
 
+/**
+* @brief Scan on the given advertising channels, rotating between them, or on
+*   the channel given to tc_init() if the map is 0.
+*
+* @param[in] adv_channel_map Bitmap of RBC_MESH_ADV_CHANNEL_* values.
+*/
+void tc_adv_channel_map_set(uint8_t adv_channel_map);
+
+/**
+* @brief Send every packet on the backbone bearer as well, and interleave the
+*   scan on the backbone with the scan on the BLE channels.
+*
+* @param[in] enabled Whether to use the backbone.
+* @param[in] access_address Access address of the backbone.
+* @param[in] channel Channel of the backbone.
+*/
+void tc_backbone_set(bool enabled, uint32_t access_address, uint8_t channel);
+
+/**
+* @brief Forward the values of the given handle ranges to and from a second
+*   network. Bridged values are sent on the other network's access address
+*   as well, and every other scan is on it, where only the bridged values
+*   are let in. An empty list turns the bridge off.
+*
+* @param[in] access_address Access address of the other network.
+* @param[in] channel Channel of the other network.
+* @param[in] p_ranges Handle ranges to forward. Copied.
+* @param[in] count Number of ranges, at most RBC_MESH_BRIDGE_RANGES_MAX.
+*/
+uint32_t tc_bridge_set(uint32_t access_address, uint8_t channel, const rbc_mesh_handle_range_t* p_ranges, uint8_t count);
+
+/** Whether the given handle is forwarded to the bridged network. */
+bool tc_bridge_handle_is_set(rbc_mesh_value_handle_t handle);
+
 /**
 * @brief: Assemble a packet by getting data from server based on params,
 *   and place it on the radio queue.
@@ -80,6 +114,8 @@ void tc_on_ts_begin(void);
 *
 * @return NRF_SUCCESS The packets was scheduled for transmission on all indicated channels.
 * @return NRF_ERROR_NO_MEM One or more packets failed.
+* @return NRF_ERROR_INVALID_LENGTH The packet is too long for the BLE
+*   advertisement access address.
 */
 uint32_t tc_tx(mesh_packet_t* p_packet, const tc_tx_config_t* p_tx_config);
 
@@ -102,4 +138,10 @@ void tc_packet_handler(uint8_t* data, uint32_t crc, uint32_t timestamp, uint8_t
 */
 void tc_packet_peek_cb_set(rbc_mesh_packet_peek_cb_t packet_peek_cb);
 
+/**
+* @brief Set the advertiser addresses to accept packets from in the radio
+*   interrupt. An empty list accepts all addresses.
+*/
+uint32_t tc_rx_whitelist_set(const ble_gap_addr_t* p_addrs, uint8_t count);
+
 #endif /* _TRANSPORT_CONTROL_H__ */
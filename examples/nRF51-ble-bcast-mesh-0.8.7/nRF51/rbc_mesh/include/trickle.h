@@ -44,6 +44,29 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #define TRICKLE_C_DISABLED  (0xFF)
+#define TRICKLE_RX_WEIGHT_FULL (4) /**< Weight of a consistent RX that counts as one full C */
+#define TRICKLE_PARAM_SETS  (4) /**< Number of separate i_min, i_max, k parameter sets */
+
+/** Scale the redundancy constant and first interval by the observed neighbour
+  density. Set to 0 to run with the fixed k of the parameter set. */
+#ifndef TRICKLE_ADAPTIVE
+#define TRICKLE_ADAPTIVE    (1)
+#endif
+
+/** Consistent RXs per interval above which the instance starts lowering its k. */
+#ifndef TRICKLE_DENSITY_REF
+#define TRICKLE_DENSITY_REF (6)
+#endif
+
+/** Lowest k an adaptive instance will run with. */
+#ifndef TRICKLE_K_MIN
+#define TRICKLE_K_MIN       (1)
+#endif
+
+/** Max number of doublings of the first interval after a reset in dense areas. */
+#ifndef TRICKLE_FIRST_INTERVAL_SHIFT_MAX
+#define TRICKLE_FIRST_INTERVAL_SHIFT_MAX (2)
+#endif
 
 /**
 * @brief trickle instance type. Contains all values necessary for maintaining
@@ -55,21 +78,63 @@ typedef __packed_armcc struct
     uint32_t        i;              /* Absolute value of i. Equals g_trickle_time (at set time) + i_relative */
     uint32_t        i_relative;     /* Relative value of i. Represents the actual i value in IETF RFC6206 */
     uint8_t         c;              /* Consistent messages counter */
+    uint8_t         c_frac;         /* Weight of consistent RXs not yet counted in c */
+    uint8_t         param_set;      /* Index of the parameter set the instance runs with */
+    uint8_t         density;        /* Average consistent RXs per interval, in quarters */
+    uint16_t        tx_count;       /* TX timeouts that led to a transmit */
+    uint16_t        suppressed_count; /* TX timeouts suppressed by consistent RXs */
 } __packed_gcc trickle_t;
 
 
 /** 
 * @brief Setup the algorithm. Is only called once, and before all other trickle
-*   related functions.
+*   related functions. Applies the given parameters to all parameter sets.
 */
 void trickle_setup(uint32_t i_min, uint32_t i_max, uint8_t k);
 
+/**
+* @brief Change the parameters of a single parameter set. Instances running
+*   with the set pick up the new values the next time they touch them.
+*/
+void trickle_params_set(uint8_t param_set, uint32_t i_min, uint32_t i_max, uint8_t k);
+
+/**
+* @brief Select the parameter set for the given trickle instance. Takes effect
+*   from the next interval, reset the timer to apply it immediately.
+*/
+void trickle_param_set_select(trickle_t* trickle, uint8_t param_set);
+
+/**
+* @brief Get the redundancy constant the given instance currently runs with.
+*   Equals the k of its parameter set unless the instance has seen more than
+*   TRICKLE_DENSITY_REF consistent RXs per interval.
+*/
+uint8_t trickle_k_get(trickle_t* trickle);
+
+/**
+* @brief Reset the density estimate and TX counters of the given instance, to
+*   be done when it starts serving a new value.
+*/
+void trickle_stats_reset(trickle_t* trickle);
+
 /**
 * @brief Register a consistent RX on the given trickle algorithm instance.
 *   Increments the instance's C value.
 */
 void trickle_rx_consistent(trickle_t* id, uint32_t time_now);
 
+/**
+* @brief Register a consistent RX that only counts as a fraction of one. C is
+*   incremented each time the accumulated weight reaches TRICKLE_RX_WEIGHT_FULL.
+*/
+void trickle_rx_consistent_weighted(trickle_t* id, uint32_t time_now, uint8_t weight);
+
+/**
+* @brief Register consistent RXs up to the redundancy constant, suppressing
+*   the transmissions of the given instance for the rest of its interval.
+*/
+void trickle_rx_suppress(trickle_t* id, uint32_t time_now);
+
 /**
 * @brief register an inconsistent RX on the given trickle algorithm instance.
 *   Resets interval time.
@@ -81,6 +146,12 @@ void trickle_rx_inconsistent(trickle_t* id, uint32_t time_now);
 */
 void trickle_timer_reset(trickle_t* trickle, uint32_t time_now);
 
+/**
+* @brief Move the TX timeout of the current interval to its first half, for
+*   values that should be passed on sooner than the interval would allow.
+*/
+void trickle_tx_advance(trickle_t* trickle, uint32_t time_now);
+
 /**
 * @brief register a successful TX on the given trickle algorithm instance.
 */
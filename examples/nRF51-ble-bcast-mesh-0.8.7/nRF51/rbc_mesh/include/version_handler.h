@@ -33,9 +33,28 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rbc_mesh.h"
 #include "ble_gap.h"
 #include "mesh_packet.h"
+#include "transport_control.h"
 #include <stdint.h>
 #include <stdbool.h>
 
+/** Weigh received values by their RSSI. Consistent RXs from close neighbours
+  count fully toward trickle suppression, distant ones count less, and new
+  values from distant nodes are passed on earlier in the interval. */
+#ifndef VH_RSSI_WEIGHTING
+#define VH_RSSI_WEIGHTING       (0)
+#endif
+
+/** RSSI in dBm at and above which a consistent RX counts fully. */
+#ifndef VH_RSSI_STRONG_DBM
+#define VH_RSSI_STRONG_DBM      (-60)
+#endif
+
+/** RSSI in dBm at and below which a consistent RX counts as 1/TRICKLE_RX_WEIGHT_FULL,
+  and a new value is treated as coming from a distant node. */
+#ifndef VH_RSSI_WEAK_DBM
+#define VH_RSSI_WEAK_DBM        (-85)
+#endif
+
 uint32_t vh_init(uint32_t min_interval_us,
                  uint32_t access_address,
                  uint8_t channel,
@@ -45,10 +64,28 @@ uint32_t vh_min_interval_set(uint32_t min_interval_us);
 
 void vh_tx_power_set(rbc_mesh_txpower_t tx_power);
 
+/** @brief: Get the TX configuration mesh values are sent with. */
+const tc_tx_config_t* vh_tx_config_get(void);
+
+/** @brief: Transmit on the given advertising channels, or on the init channel if 0. */
+void vh_adv_channel_map_set(uint8_t adv_channel_map);
+
 uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi);
 
+/** @brief: Unpack a batch packet, and process each of its values as a separate packet. */
+uint32_t vh_rx_batch(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi);
+
+/** @brief: Restart the intervals of the values a neighbour asks for in a sync request. */
+void vh_rx_sync(mesh_adv_data_t* p_adv_data, uint32_t timestamp);
+
+/** @brief: Send RBC_MESH_SYNC_REQUESTS sync requests, to learn the neighbours' values quickly. */
+uint32_t vh_sync_start(void);
+
 uint32_t vh_local_update(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length);
 
+/** Update several local values in one critical section. Bit i of *p_success_mask is set if value i was updated. Returns the first error. */
+uint32_t vh_local_update_bulk(const rbc_mesh_value_t* p_values, uint32_t count, uint32_t* p_success_mask);
+
 uint32_t vh_on_timeslot_begin(void);
 
 uint32_t vh_order_update(uint32_t time_now);
@@ -56,6 +93,17 @@ uint32_t vh_order_update(uint32_t time_now);
 /** @brief: Make copy of payload for given handle. */
 uint32_t vh_value_get(rbc_mesh_value_handle_t handle, uint8_t* data, uint16_t* length);
 
+/** @brief: Make copy of payload for given handle, without blocking the event handler. */
+uint32_t vh_value_read(rbc_mesh_value_handle_t handle, uint8_t* data, uint16_t* length, uint16_t* p_version);
+
+/** @brief: Get a pointer to the cached payload of a persistent or static handle. */
+uint32_t vh_value_peek(rbc_mesh_value_handle_t handle, const uint8_t** pp_data, uint16_t* p_length, uint32_t* p_token);
+
+uint32_t vh_value_peek_check(uint32_t token);
+
+/** @brief: Copy the next cached payload after the given cursor, see handle_storage_value_next(). */
+uint32_t vh_value_next(uint16_t* p_cursor, rbc_mesh_value_handle_t* p_handle, uint8_t* data, uint16_t* length, uint16_t* p_version);
+
 uint32_t vh_tx_event_set(rbc_mesh_value_handle_t handle, bool do_tx_event);
 
 uint32_t vh_tx_event_flag_get(rbc_mesh_value_handle_t handle, bool* is_doing_tx_event);
@@ -68,7 +116,23 @@ uint32_t vh_value_is_enabled(rbc_mesh_value_handle_t handle, bool* p_is_enabled)
 
 uint32_t vh_value_persistence_set(rbc_mesh_value_handle_t handle, bool persistent);
 
+uint32_t vh_flag_set_bulk(const rbc_mesh_flag_op_t* p_ops, uint32_t count, uint32_t* p_applied_count);
+
+uint32_t vh_flag_set_range(rbc_mesh_value_handle_t first, rbc_mesh_value_handle_t last, rbc_mesh_handle_flag_t flag, bool value);
+
 uint32_t vh_value_persistence_get(rbc_mesh_value_handle_t handle, bool* p_persistent);
 
+uint32_t vh_value_qos_set(rbc_mesh_value_handle_t handle, rbc_mesh_qos_class_t qos_class);
+
+uint32_t vh_value_qos_get(rbc_mesh_value_handle_t handle, rbc_mesh_qos_class_t* p_qos_class);
+
+uint32_t vh_value_stats_get(rbc_mesh_value_handle_t handle, rbc_mesh_handle_stats_t* p_stats);
+
+/** @brief: Stop relaying values from other devices. Received values are still reported, but disabled. */
+void vh_leaf_set(bool is_leaf);
+
+/** @brief: Set the handle ranges to generate application events for. Other handles are only relayed. */
+uint32_t vh_subscription_set(const rbc_mesh_handle_range_t* p_ranges, uint8_t count);
+
 #endif /* _VERSION_HANDLER_H__ */
 
@@ -41,12 +41,56 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ble.h"
 #include "dfu_types_mesh.h"
 
+/** @brief Carry values longer than a legacy advertisement can hold, in
+ * packets with an 8 bit length field. Long packets are only sent on the
+ * mesh access address, which then can't be the BLE advertisement address.
+ * nRF52 only, as the radio has to keep the S1 byte in RAM. */
+#ifndef RBC_MESH_LONG_PACKETS
+    #define RBC_MESH_LONG_PACKETS                   (0)
+#endif
+
+/** @brief Longest value in long packet mode. The length field counts at
+ * most 255 bytes, 14 of which are the advertiser address and mesh header. */
+#ifndef RBC_MESH_LONG_VALUE_MAX_LEN
+    #define RBC_MESH_LONG_VALUE_MAX_LEN             (240)
+#endif
+
+/** @brief Bytes every value packet carries for authentication when built
+ * with MESH_AUTH: a 4 byte source sequence number and a 4 byte AES-CCM MIC.
+ * Taken from the space left for the value. */
+#ifdef MESH_AUTH
+    #define RBC_MESH_AUTH_OVERHEAD                  (8)
+#else
+    #define RBC_MESH_AUTH_OVERHEAD                  (0)
+#endif
+
+#if RBC_MESH_LONG_PACKETS
+#ifndef NRF52
+#error "RBC_MESH_LONG_PACKETS requires an nRF52"
+#endif
+#if RBC_MESH_LONG_VALUE_MAX_LEN + RBC_MESH_AUTH_OVERHEAD > 241
+#error "RBC_MESH_LONG_VALUE_MAX_LEN can't be higher than 241, minus the authentication overhead"
+#endif
+#endif
+
 #define RBC_MESH_ACCESS_ADDRESS_BLE_ADV             (0x8E89BED6) /**< BLE spec defined access address. */
 #define RBC_MESH_INTERVAL_MIN_MIN_MS                (5) /**< Lowest min-interval allowed. */
 #define RBC_MESH_INTERVAL_MIN_MAX_MS                (60000) /**< Highest min-interval allowed. */
-#define RBC_MESH_VALUE_MAX_LEN                      (23) /**< Longest legal payload. */
+#define RBC_MESH_LEGACY_VALUE_MAX_LEN               (23) /**< Longest payload that fits in a legacy advertisement packet. Also the longest the serial and GATT interfaces carry. */
+#if RBC_MESH_LONG_PACKETS
+#define RBC_MESH_VALUE_MAX_LEN                      (RBC_MESH_LONG_VALUE_MAX_LEN) /**< Longest legal payload. */
+#else
+#define RBC_MESH_VALUE_MAX_LEN                      (RBC_MESH_LEGACY_VALUE_MAX_LEN - RBC_MESH_AUTH_OVERHEAD) /**< Longest legal payload. */
+#endif
 #define RBC_MESH_INVALID_HANDLE                     (0xFFFF) /**< Designated "invalid" handle, may never be used */
-#define RBC_MESH_APP_MAX_HANDLE                     (0xFFEF) /**< Upper limit to application defined handles. The last 16 handles are reserved for mesh-maintenance. */
+#define RBC_MESH_APP_MAX_HANDLE                     (0xFFED) /**< Upper limit to application defined handles. The last 18 handles are reserved for mesh-maintenance. */
+
+#define RBC_MESH_ADV_CHANNEL_37                     (1 << 0) /**< Advertising channel 37 bit in an advertising channel map. */
+#define RBC_MESH_ADV_CHANNEL_38                     (1 << 1) /**< Advertising channel 38 bit in an advertising channel map. */
+#define RBC_MESH_ADV_CHANNEL_39                     (1 << 2) /**< Advertising channel 39 bit in an advertising channel map. */
+#define RBC_MESH_PROBE_TARGET_ALL                   (0xFFFF) /**< Latency probe target meaning every node, see @ref rbc_mesh_probe_start. */
+#define RBC_MESH_PROBE_HIST_BUCKETS                 (8) /**< Buckets in the round-trip time histogram of @ref rbc_mesh_probe_stats_t. */
+#define RBC_MESH_ADV_CHANNEL_ALL                    (RBC_MESH_ADV_CHANNEL_37 | RBC_MESH_ADV_CHANNEL_38 | RBC_MESH_ADV_CHANNEL_39) /**< All three advertising channels. */
 
 #define RBC_MESH_GPREGRET_CODE_GO_TO_APP            (0x00) /**< Retention register code for immediately starting application when entering bootloader. The default behavior. */
 #define RBC_MESH_GPREGRET_CODE_FORCED_REBOOT        (0x01) /**< Retention register code for telling the bootloader it's been started on purpose */
@@ -60,10 +104,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
    to the handle are new or old.
 */
 
-/** @brief Default value for the number of handle cache entries */
+/** @brief Default value for the number of handle cache entries. The nRF52
+ * has the RAM to keep track of more handles. */
 #ifndef RBC_MESH_HANDLE_CACHE_ENTRIES
     #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)
           #define RBC_MESH_HANDLE_CACHE_ENTRIES           (105)
+    #elif defined(NRF52)
+          #define RBC_MESH_HANDLE_CACHE_ENTRIES           (32)
     #else
           #define RBC_MESH_HANDLE_CACHE_ENTRIES           (10)
     #endif      
@@ -73,11 +120,94 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef RBC_MESH_DATA_CACHE_ENTRIES
     #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)
          #define RBC_MESH_DATA_CACHE_ENTRIES             (105)
+    #elif defined(NRF52)
+         #define RBC_MESH_DATA_CACHE_ENTRIES             (16)
     #else
          #define RBC_MESH_DATA_CACHE_ENTRIES             (10)
     #endif
 #endif
 
+/** @brief Header declaring the application's static handle range, for
+ * instance generated from the application's handle list. Included when
+ * defined, and should define RBC_MESH_STATIC_HANDLE_FIRST and
+ * RBC_MESH_STATIC_HANDLE_COUNT. */
+#ifdef RBC_MESH_STATIC_HANDLES_H
+    #include RBC_MESH_STATIC_HANDLES_H
+#endif
+
+/** @brief First handle of the static handle range. */
+#ifndef RBC_MESH_STATIC_HANDLE_FIRST
+    #define RBC_MESH_STATIC_HANDLE_FIRST            (0)
+#endif
+
+/** @brief Number of handles in the static handle range. The handles
+ * RBC_MESH_STATIC_HANDLE_FIRST to RBC_MESH_STATIC_HANDLE_FIRST +
+ * RBC_MESH_STATIC_HANDLE_COUNT - 1 get a handle cache entry and a data cache
+ * entry each for the lifetime of the framework. They're looked up by
+ * direct indexing, and are never evicted. All other handles share the
+ * remaining cache entries as usual. Set to 0 to disable. */
+#ifndef RBC_MESH_STATIC_HANDLE_COUNT
+    #define RBC_MESH_STATIC_HANDLE_COUNT            (0)
+#endif
+
+/** @brief Keep cached values of up to RBC_MESH_COMPACT_VALUE_MAX_LEN bytes
+ * inline in the data cache, building their packets only when they're needed
+ * for TX, instead of holding a pool packet for every cached value. Roughly
+ * halves the RAM per data cache entry. */
+#ifndef RBC_MESH_COMPACT_STORAGE
+    #define RBC_MESH_COMPACT_STORAGE                (0)
+#endif
+
+/** @brief Longest value stored inline in compact storage mode. Longer values
+ * keep a packet from the packet pool. */
+#ifndef RBC_MESH_COMPACT_VALUE_MAX_LEN
+    #define RBC_MESH_COMPACT_VALUE_MAX_LEN          (8)
+#endif
+
+/** @brief Number of cached values longer than RBC_MESH_COMPACT_VALUE_MAX_LEN
+ * the default packet pool size accounts for in compact storage mode. */
+#ifndef RBC_MESH_COMPACT_LONG_VALUES
+    #define RBC_MESH_COMPACT_LONG_VALUES            (RBC_MESH_DATA_CACHE_ENTRIES / 4)
+#endif
+
+/** @brief Number of handle cache entries that may be used by handles outside
+ * the subscribed ranges, see @ref rbc_mesh_subscription_set. These are only
+ * kept for relaying. Set to 0 to not relay unsubscribed handles at all. */
+#ifndef RBC_MESH_RELAY_CACHE_ENTRIES
+    #define RBC_MESH_RELAY_CACHE_ENTRIES            (RBC_MESH_HANDLE_CACHE_ENTRIES / 4)
+#endif
+
+/** @brief Number of times rbc_mesh_value_read() and rbc_mesh_value_peek()
+ * try to get past a racing update before giving up. */
+#ifndef RBC_MESH_VALUE_READ_ATTEMPTS
+    #define RBC_MESH_VALUE_READ_ATTEMPTS            (8)
+#endif
+
+/** @brief Cache replacement policies, see RBC_MESH_CACHE_POLICY. */
+#define RBC_MESH_CACHE_POLICY_LRU                   (0)
+#define RBC_MESH_CACHE_POLICY_2Q                    (1)
+
+/** @brief Replacement policy of the handle and data caches.
+ * RBC_MESH_CACHE_POLICY_LRU replaces the handle that entered the cache the
+ * longest ago. RBC_MESH_CACHE_POLICY_2Q protects the handles that are updated
+ * again while cached, or come back after losing their value, and replaces
+ * the handles that have only been seen once first, so that a burst of new
+ * handles can't push the values the node keeps seeing out of the caches. */
+#ifndef RBC_MESH_CACHE_POLICY
+    #define RBC_MESH_CACHE_POLICY                   (RBC_MESH_CACHE_POLICY_LRU)
+#endif
+
+/** @brief Highest number of protected handles with RBC_MESH_CACHE_POLICY_2Q.
+ * The rest of the data cache is left for new handles to prove themselves. */
+#ifndef RBC_MESH_CACHE_PROTECTED_ENTRIES
+    #define RBC_MESH_CACHE_PROTECTED_ENTRIES        ((RBC_MESH_DATA_CACHE_ENTRIES - RBC_MESH_STATIC_HANDLE_COUNT) * 3 / 4)
+#endif
+
+/** @brief Highest number of subscribed handle ranges. */
+#ifndef RBC_MESH_SUBSCRIPTION_RANGES_MAX
+    #define RBC_MESH_SUBSCRIPTION_RANGES_MAX        (4)
+#endif
+
 /** @brief Length of app-event FIFO. Must be power of two. */
 #ifndef RBC_MESH_APP_EVENT_QUEUE_LENGTH
     #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)
@@ -87,9 +217,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     #endif
 #endif
 
-/** @brief Length of low level radio event FIFO. Must be power of two. */
+/** @brief Let an UPDATE_VAL event for a handle take the place of a pending
+ * UPDATE_VAL for the same handle in the app-event FIFO, instead of queueing
+ * behind it, so the application only sees the latest value. The version
+ * deltas are added up. The oldest event in the FIFO is never replaced. */
+#ifndef RBC_MESH_APP_EVENT_COALESCE
+    #define RBC_MESH_APP_EVENT_COALESCE             (0)
+#endif
+
+/** @brief Length of low level radio event FIFO. Must be power of two. The
+ * faster radio ramp-up of the nRF52 fits more events in a timeslot. */
 #ifndef RBC_MESH_RADIO_QUEUE_LENGTH
-    #define RBC_MESH_RADIO_QUEUE_LENGTH             (8)
+    #ifdef NRF52
+        #define RBC_MESH_RADIO_QUEUE_LENGTH         (16)
+    #else
+        #define RBC_MESH_RADIO_QUEUE_LENGTH         (8)
+    #endif
 #endif
 
 /** @brief Length of internal async-event FIFO. Must be power of two. */
@@ -97,15 +240,480 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
     #define RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH    (8)
 #endif
 
+/** @brief Length of internal FIFO for received packets, which are processed
+ * ahead of the other async-events. Must be power of two. */
+#ifndef RBC_MESH_INTERNAL_RX_EVENT_QUEUE_LENGTH
+    #ifdef NRF52
+        #define RBC_MESH_INTERNAL_RX_EVENT_QUEUE_LENGTH (16)
+    #else
+        #define RBC_MESH_INTERNAL_RX_EVENT_QUEUE_LENGTH (8)
+    #endif
+#endif
+
+/** @brief Highest number of events processed from each internal FIFO before
+ * the dispatcher moves on to the next one. Received packets get the largest
+ * share, but can never starve timers and TX bookkeeping. */
+#ifndef RBC_MESH_INTERNAL_RX_EVENT_BUDGET
+    #define RBC_MESH_INTERNAL_RX_EVENT_BUDGET       (4)
+#endif
+#ifndef RBC_MESH_INTERNAL_TIMER_EVENT_BUDGET
+    #define RBC_MESH_INTERNAL_TIMER_EVENT_BUDGET    (2)
+#endif
+#ifndef RBC_MESH_INTERNAL_EVENT_BUDGET
+    #define RBC_MESH_INTERNAL_EVENT_BUDGET          (1)
+#endif
+
+/** @brief Time spent scanning on each advertising channel before rotating to
+ * the next one when running in multi-channel mode. */
+#ifndef RBC_MESH_ADV_CHANNEL_SCAN_INTERVAL_US
+    #define RBC_MESH_ADV_CHANNEL_SCAN_INTERVAL_US   (5000)
+#endif
+
+/** @brief Longest value that may be packed together with other values in a
+ * single batch advertisement. Set to 0 to always transmit values separately. */
+#ifndef RBC_MESH_BATCH_VALUE_MAX_LEN
+    #define RBC_MESH_BATCH_VALUE_MAX_LEN            (4)
+#endif
+
+/** @brief Highest share of time spent in timeslots in the low power modes,
+ * see @ref rbc_mesh_power_mode_set. */
+#ifndef RBC_MESH_LP_DUTY_CYCLE_PERMILLE
+    #define RBC_MESH_LP_DUTY_CYCLE_PERMILLE         (50)
+#endif
+
+/** @brief Longest time between two listening windows in the low power modes,
+ * even when there's nothing to transmit. Bounds the time it takes a sleeping
+ * node to pick up new values, and to send values set in between. */
+#ifndef RBC_MESH_LP_SYNC_INTERVAL_MS
+    #define RBC_MESH_LP_SYNC_INTERVAL_MS            (1000)
+#endif
+
+/** @brief Shortest timeslot requested to fit between regular Softdevice radio
+ * events, like connection events. See @ref rbc_mesh_radio_notification_handler. */
+#ifndef RBC_MESH_COEX_SLOT_MIN_US
+    #define RBC_MESH_COEX_SLOT_MIN_US               (2500)
+#endif
+
+/** @brief Time left free after each timeslot while the application has
+ * Softdevice flash operations pending, enough for a page erase. See
+ * @ref rbc_mesh_sd_flash_pending_set. */
+#ifndef RBC_MESH_COEX_FLASH_GAP_US
+    #define RBC_MESH_COEX_FLASH_GAP_US              (25000)
+#endif
+
+/** @brief Number of neighbour and channel pairs in the link survey table,
+ * see @ref rbc_mesh_survey_start. The least recently heard pair is replaced
+ * when the table is full. */
+#ifndef RBC_MESH_SURVEY_TABLE_SIZE
+    #define RBC_MESH_SURVEY_TABLE_SIZE              (16)
+#endif
+
+/** @brief Average time before a node answers a differing digest with a
+ * digest of the differing handles, see @ref rbc_mesh_digest_start. */
+#ifndef RBC_MESH_DIGEST_DRILL_DELAY_MS
+    #define RBC_MESH_DIGEST_DRILL_DELAY_MS          (100)
+#endif
+
+/** @brief Number of values in a differing part of a digest at or below which
+ * the values are retransmitted instead of digested in smaller parts. */
+#ifndef RBC_MESH_DIGEST_LEAF_VALUES
+    #define RBC_MESH_DIGEST_LEAF_VALUES             (2)
+#endif
+
+/** @brief Number of direct neighbours in the neighbour table, see
+ * @ref rbc_mesh_neighbour_get. The least recently heard neighbour is replaced
+ * when the table is full. */
+#ifndef RBC_MESH_NEIGHBOUR_TABLE_SIZE
+    #define RBC_MESH_NEIGHBOUR_TABLE_SIZE           (16)
+#endif
+
+/** @brief Time without packets after which a neighbour is inactive. */
+#ifndef RBC_MESH_NEIGHBOUR_TIMEOUT_MS
+    #define RBC_MESH_NEIGHBOUR_TIMEOUT_MS           (30000)
+#endif
+
+/** @brief Time between two evaluations of the neighbour table for adaptive
+ * TX power, see @ref rbc_mesh_tx_power_adaptive_set. */
+#ifndef RBC_MESH_NEIGHBOUR_ADAPT_INTERVAL_MS
+    #define RBC_MESH_NEIGHBOUR_ADAPT_INTERVAL_MS    (10000)
+#endif
+
+/** @brief Highest negative average RSSI of a strong neighbour, in dBm. */
+#ifndef RBC_MESH_NEIGHBOUR_STRONG_RSSI
+    #define RBC_MESH_NEIGHBOUR_STRONG_RSSI          (65)
+#endif
+
+/** @brief Number of strong neighbours at which adaptive TX power lowers the
+ * TX power. */
+#ifndef RBC_MESH_NEIGHBOUR_DENSE_COUNT
+    #define RBC_MESH_NEIGHBOUR_DENSE_COUNT          (4)
+#endif
+
+/** @brief Number of active neighbours under which adaptive TX power raises
+ * the TX power. */
+#ifndef RBC_MESH_NEIGHBOUR_SPARSE_COUNT
+    #define RBC_MESH_NEIGHBOUR_SPARSE_COUNT         (2)
+#endif
+
+/** @brief Lowest TX power adaptive TX power will use. */
+#ifndef RBC_MESH_NEIGHBOUR_TX_POWER_MIN
+    #define RBC_MESH_NEIGHBOUR_TX_POWER_MIN         (RBC_MESH_TXPOWER_Neg20dBm)
+#endif
+
+/** @brief Time between the starts of two Gazell host windows, when built
+ * with RBC_MESH_GZLL_BRIDGE. See mesh_gzll_bridge.h. */
+#ifndef RBC_MESH_GZLL_BRIDGE_PERIOD_MS
+    #define RBC_MESH_GZLL_BRIDGE_PERIOD_MS          (100)
+#endif
+
+/** @brief Number of handles the Gazell bridge batches commands for between
+ * two mesh value updates. At most 32. */
+#ifndef RBC_MESH_GZLL_BRIDGE_BATCH_SIZE
+    #define RBC_MESH_GZLL_BRIDGE_BATCH_SIZE         (8)
+#endif
+
+/** @brief Longest value the Gazell bridge accepts in a command. */
+#ifndef RBC_MESH_GZLL_BRIDGE_VALUE_MAX_LEN
+    #define RBC_MESH_GZLL_BRIDGE_VALUE_MAX_LEN      (8)
+#endif
+
+/** @brief Number of ANT+ data pages the ANT bridge can map to handles, when
+ * built with RBC_MESH_ANT_BRIDGE. See mesh_ant_bridge.h. */
+#ifndef RBC_MESH_ANT_BRIDGE_PAGES_MAX
+    #define RBC_MESH_ANT_BRIDGE_PAGES_MAX           (8)
+#endif
+
+/** @brief Shortest time between two values the ANT bridge publishes on the
+ * same handle. Changes within it are coalesced. */
+#ifndef RBC_MESH_ANT_BRIDGE_INTERVAL_MS
+    #define RBC_MESH_ANT_BRIDGE_INTERVAL_MS         (1000)
+#endif
+
+/** @brief Number of scene actions the device can hold, see
+ * @ref rbc_mesh_scene_action_set. Set to 0 to leave out scene support. */
+#ifndef RBC_MESH_SCENE_ACTIONS_MAX
+    #define RBC_MESH_SCENE_ACTIONS_MAX              (0)
+#endif
+
+/** @brief Longest value of a scene action. */
+#ifndef RBC_MESH_SCENE_VALUE_MAX_LEN
+    #define RBC_MESH_SCENE_VALUE_MAX_LEN            (4)
+#endif
+
+/** @brief Handle carrying the ID of the last recalled scene, see
+ * @ref rbc_mesh_scene_recall. */
+#ifndef RBC_MESH_SCENE_HANDLE
+    #define RBC_MESH_SCENE_HANDLE                   (RBC_MESH_APP_MAX_HANDLE)
+#endif
+
+/** @brief Number of zones a node can hold merged reports for between two
+ * report intervals, see @ref rbc_mesh_report_submit. Set to 0 to leave out
+ * convergecast reports. */
+#ifndef RBC_MESH_REPORT_ZONES
+    #define RBC_MESH_REPORT_ZONES                   (0)
+#endif
+
+/** @brief Time between two reports or gradient beacons of a node. Reports
+ * take up to one interval per hop to reach a gateway. */
+#ifndef RBC_MESH_REPORT_INTERVAL_MS
+    #define RBC_MESH_REPORT_INTERVAL_MS             (10000)
+#endif
+
+/** @brief Time without beacons from the parent after which a node looks for
+ * a new one. */
+#ifndef RBC_MESH_REPORT_GRADIENT_TIMEOUT_MS
+    #define RBC_MESH_REPORT_GRADIENT_TIMEOUT_MS     (3 * RBC_MESH_REPORT_INTERVAL_MS + RBC_MESH_REPORT_INTERVAL_MS / 2)
+#endif
+
+/** @brief Number of child nodes whose last report is remembered, to merge
+ * reports heard on several channels only once. */
+#ifndef RBC_MESH_REPORT_CHILDREN
+    #define RBC_MESH_REPORT_CHILDREN                (8)
+#endif
+
+/** @brief Set to 1 to synchronize a common mesh time to a root node, see
+ * @ref rbc_mesh_time_get. */
+#ifndef RBC_MESH_TIME_SYNC
+    #define RBC_MESH_TIME_SYNC                      (0)
+#endif
+
+/** @brief Average time between two time beacons from each synchronized node. */
+#ifndef RBC_MESH_TIME_BEACON_INTERVAL_MS
+    #define RBC_MESH_TIME_BEACON_INTERVAL_MS        (5000)
+#endif
+
+/** @brief Number of the latest time samples the clock skew to the root is
+ * estimated from. */
+#ifndef RBC_MESH_TIME_SAMPLES
+    #define RBC_MESH_TIME_SAMPLES                   (8)
+#endif
+
+/** @brief Set to 0 to stop the device from relaying and answering latency
+ * probes, see @ref rbc_mesh_probe_start. */
+#ifndef RBC_MESH_PROBE
+    #define RBC_MESH_PROBE                          (1)
+#endif
+
+/** @brief Number of nodes the device keeps latency statistics for when
+ * sending probes. Set above 0 on the devices that send probes, like gateways. */
+#ifndef RBC_MESH_PROBE_NODES
+    #define RBC_MESH_PROBE_NODES                    (0)
+#endif
+
+/** @brief Number of hops probes are relayed over. */
+#ifndef RBC_MESH_PROBE_HOPS_MAX
+    #define RBC_MESH_PROBE_HOPS_MAX                 (8)
+#endif
+
+/** @brief Longest object for @ref rbc_mesh_object_set, and the size of the
+ * buffer holding the object being sent or received. Must fit in 32 segments.
+ * Set to 0 to leave out the segmented object transport. */
+#ifndef RBC_MESH_OBJECT_MAX_LEN
+    #define RBC_MESH_OBJECT_MAX_LEN                 (0)
+#endif
+
+/** @brief Average time between two object segment transmissions. */
+#ifndef RBC_MESH_OBJECT_SEGMENT_INTERVAL_MS
+    #define RBC_MESH_OBJECT_SEGMENT_INTERVAL_MS     (20)
+#endif
+
+/** @brief Number of times the source of an object sends all its segments
+ * before only answering requests for missing segments. */
+#ifndef RBC_MESH_OBJECT_TX_ROUNDS
+    #define RBC_MESH_OBJECT_TX_ROUNDS               (2)
+#endif
+
+/** @brief Time without new segments before a receiver asks for the ones it's
+ * missing. */
+#ifndef RBC_MESH_OBJECT_REQ_TIMEOUT_MS
+    #define RBC_MESH_OBJECT_REQ_TIMEOUT_MS          (200)
+#endif
+
+/** @brief Number of unanswered requests before an incomplete object is dropped. */
+#ifndef RBC_MESH_OBJECT_REQ_RETRIES
+    #define RBC_MESH_OBJECT_REQ_RETRIES             (10)
+#endif
+
+/** @brief Number of sync requests sent when the mesh starts. Each asks the
+ * neighbours to restart the trickle interval of the next RBC_MESH_SYNC_WINDOW
+ * of their cached values, most recently used first. Set to 0 to only learn
+ * values as the neighbours' intervals expire. */
+#ifndef RBC_MESH_SYNC_REQUESTS
+    #define RBC_MESH_SYNC_REQUESTS                  (3)
+#endif
+
+/** @brief Number of cached values a sync request asks the neighbours for. */
+#ifndef RBC_MESH_SYNC_WINDOW
+    #define RBC_MESH_SYNC_WINDOW                    (32)
+#endif
+
+/** @brief Average time between the sync requests sent on start. */
+#ifndef RBC_MESH_SYNC_REQ_INTERVAL_MS
+    #define RBC_MESH_SYNC_REQ_INTERVAL_MS           (250)
+#endif
+
+/** @brief Time a node ignores sync requests for the window it last answered,
+ * so that several nodes starting together only restart it once. */
+#ifndef RBC_MESH_SYNC_HOLDOFF_MS
+    #define RBC_MESH_SYNC_HOLDOFF_MS                (1000)
+#endif
+
+/** @brief Number of handles to remember the last consistent packet of. An
+ * exact copy of that packet, as heard many times per interval in a dense
+ * mesh, is counted as a consistent RX without the rest of the RX processing.
+ * Set to 0 to process every copy in full. */
+#ifndef RBC_MESH_RX_DUP_CACHE_SIZE
+    #define RBC_MESH_RX_DUP_CACHE_SIZE              (8)
+#endif
+
+/** @brief Settle values published with the same version by different
+ * devices. The longest payload wins, then the one with the highest bytes: a
+ * node that holds the losing value takes the winning one as an UPDATE_VAL
+ * event with a version_delta of 0, and a node that holds the winning value
+ * sends it again soon, so the mesh converges without a version bump. Set to 0
+ * to keep the stored value, and report a CONFLICTING_VAL event instead. */
+#ifndef RBC_MESH_CONFLICT_RESOLVE
+    #define RBC_MESH_CONFLICT_RESOLVE               (1)
+#endif
+
+/** @brief Window for coalescing local updates of a handle, 0 to send every
+ * update. The first rbc_mesh_value_set() of a handle is sent at once, and
+ * opens a window where further sets only replace the pending value. The last
+ * one is sent at the end of the window, with a single version bump and
+ * trickle restart, and opens the next window. Until then, rbc_mesh_value_get()
+ * returns the last value sent. */
+#ifndef RBC_MESH_LOCAL_UPDATE_WINDOW_MS
+    #define RBC_MESH_LOCAL_UPDATE_WINDOW_MS         (0)
+#endif
+
+/** @brief Highest number of handles with an open local update window.
+ * Updates of other handles are sent at once. */
+#ifndef RBC_MESH_LOCAL_UPDATE_WINDOWS
+    #define RBC_MESH_LOCAL_UPDATE_WINDOWS           (4)
+#endif
+
+/** @brief Highest number of advertiser addresses in the RX whitelist, see
+ * @ref rbc_mesh_rx_whitelist_set. Set to 0 to leave out the whitelist. */
+#ifndef RBC_MESH_RX_WHITELIST_SIZE
+    #define RBC_MESH_RX_WHITELIST_SIZE              (4)
+#endif
+
+/** @brief Highest number of handle ranges forwarded to a second network, see
+ * @ref rbc_mesh_bridge_set. Set to 0 to leave out the bridge. */
+#ifndef RBC_MESH_BRIDGE_RANGES_MAX
+    #define RBC_MESH_BRIDGE_RANGES_MAX              (4)
+#endif
+
+/** @brief Number of value sources whose highest sequence number is kept for
+ * replay protection, when built with MESH_AUTH. The least recently heard
+ * source is forgotten when the table is full. */
+#ifndef RBC_MESH_AUTH_SOURCES
+    #define RBC_MESH_AUTH_SOURCES                   (16)
+#endif
+
+/** @brief Sequence numbers below the highest one accepted from a source that
+ * are still accepted, when built with MESH_AUTH. Values keep the sequence
+ * number of their originator while relayed, so the window must cover the
+ * number of values a source sends while its older values still propagate. */
+#ifndef RBC_MESH_AUTH_REPLAY_WINDOW
+    #define RBC_MESH_AUTH_REPLAY_WINDOW             (1024)
+#endif
+
+/** @brief Start of the flash area storing the values of persistent handles,
+ * when built with MESH_PERSIST. The area is two banks of
+ * RBC_MESH_PERSIST_BANK_PAGES pages, and must be page aligned and left out of
+ * the application, bootloader and DFU bank regions. The default is the top of
+ * the application region in the DFU linker scripts, which must be shrunk
+ * accordingly. */
+#ifndef RBC_MESH_PERSIST_FLASH_ADDR
+    #define RBC_MESH_PERSIST_FLASH_ADDR             (0x39800)
+#endif
+
+/** @brief Size of each persistent value flash bank, in pages. A bank holds
+ * PAGE_SIZE / 32 - 1 values per page, and every persistent handle must fit in
+ * a single bank. */
+#ifndef RBC_MESH_PERSIST_BANK_PAGES
+    #define RBC_MESH_PERSIST_BANK_PAGES             (1)
+#endif
+
+/** @brief Shortest time between two batches of persistent value writes. Values
+ * updated in between are merged, to limit flash wear. */
+#ifndef RBC_MESH_PERSIST_WRITE_INTERVAL_MS
+    #define RBC_MESH_PERSIST_WRITE_INTERVAL_MS      (10000)
+#endif
+
+/** @brief Start of the two flash pages holding the power-fail state records,
+ * when built with MESH_POWERFAIL. Must be page aligned and left out of the
+ * application, bootloader and DFU bank regions. The default is just below
+ * the persistent value banks. */
+#ifndef RBC_MESH_POWERFAIL_FLASH_ADDR
+    #define RBC_MESH_POWERFAIL_FLASH_ADDR           (0x39000)
+#endif
+
+/** @brief Longest state written on a power failure, see
+ * @ref rbc_mesh_powerfail_state_set. Each record takes the state rounded up
+ * to words, plus two words. */
+#ifndef RBC_MESH_POWERFAIL_STATE_LEN_MAX
+    #define RBC_MESH_POWERFAIL_STATE_LEN_MAX        (16)
+#endif
+
+/** @brief Supply voltage below which the power-fail state is written, one of
+ * the SoftDevice NRF_POWER_THRESHOLD_* values. The highest threshold leaves
+ * the most time before the supply runs out. */
+#ifndef RBC_MESH_POWERFAIL_THRESHOLD
+    #define RBC_MESH_POWERFAIL_THRESHOLD            (NRF_POWER_THRESHOLD_V27)
+#endif
+
+/** @brief Start of the flash pages holding the fault log, when built with
+ * MESH_FAULTLOG. Must be page aligned and left out of the application,
+ * bootloader and DFU bank regions. The default is just below the power-fail
+ * state records. */
+#ifndef RBC_MESH_FAULTLOG_FLASH_ADDR
+    #define RBC_MESH_FAULTLOG_FLASH_ADDR            (0x38800)
+#endif
+
+/** @brief Number of flash pages in the fault log ring, at least 2. Each page
+ * holds PAGE_SIZE / 36 faults, and the page with the oldest ones is erased
+ * when the ring is full. */
+#ifndef RBC_MESH_FAULTLOG_PAGES
+    #define RBC_MESH_FAULTLOG_PAGES                 (2)
+#endif
+
+/** @brief Let the fault log provide the HardFault_Handler, when built with
+ * MESH_FAULTLOG. The handler captures the faulting PC and LR, and resets the
+ * chip. Set to 0 if the application has a hard fault handler of its own. */
+#ifndef RBC_MESH_FAULTLOG_HARDFAULT_HANDLER
+    #define RBC_MESH_FAULTLOG_HARDFAULT_HANDLER     (1)
+#endif
+
+/** @brief FreeRTOS priority of the task delivering mesh events to the
+ * application, when built with RBC_MESH_FREERTOS. See mesh_freertos.h. */
+#ifndef RBC_MESH_FREERTOS_TASK_PRIORITY
+    #define RBC_MESH_FREERTOS_TASK_PRIORITY         (2)
+#endif
+
+/** @brief Stack size of the mesh event task, in words. Must fit the
+ * application's event handler. */
+#ifndef RBC_MESH_FREERTOS_TASK_STACK_SIZE
+    #define RBC_MESH_FREERTOS_TASK_STACK_SIZE       (256)
+#endif
+
+/** @brief Trickle parameters for the RBC_MESH_QOS_CLASS_LOW_LATENCY class.
+ * The longest interval is I_MIN_MS * I_MAX_FACTOR. */
+#ifndef RBC_MESH_QOS_LOW_LATENCY_I_MIN_MS
+    #define RBC_MESH_QOS_LOW_LATENCY_I_MIN_MS       (RBC_MESH_INTERVAL_MIN_MIN_MS)
+#endif
+#ifndef RBC_MESH_QOS_LOW_LATENCY_I_MAX_FACTOR
+    #define RBC_MESH_QOS_LOW_LATENCY_I_MAX_FACTOR   (2048)
+#endif
+#ifndef RBC_MESH_QOS_LOW_LATENCY_K
+    #define RBC_MESH_QOS_LOW_LATENCY_K              (3)
+#endif
+
+/** @brief Trickle parameters for the RBC_MESH_QOS_CLASS_BACKGROUND class.
+ * The longest interval is I_MIN_MS * I_MAX_FACTOR. */
+#ifndef RBC_MESH_QOS_BACKGROUND_I_MIN_MS
+    #define RBC_MESH_QOS_BACKGROUND_I_MIN_MS        (1000)
+#endif
+#ifndef RBC_MESH_QOS_BACKGROUND_I_MAX_FACTOR
+    #define RBC_MESH_QOS_BACKGROUND_I_MAX_FACTOR    (256)
+#endif
+#ifndef RBC_MESH_QOS_BACKGROUND_K
+    #define RBC_MESH_QOS_BACKGROUND_K               (1)
+#endif
+
 /** @brief Size of packet pool. Only accounts for one packet in the app-space at a time. */
+#if RBC_MESH_COMPACT_STORAGE
+    #define RBC_MESH_POOL_CACHED_VALUES             (RBC_MESH_COMPACT_LONG_VALUES)
+#else
+    #define RBC_MESH_POOL_CACHED_VALUES             (RBC_MESH_DATA_CACHE_ENTRIES)
+#endif
 #ifndef RBC_MESH_PACKET_POOL_SIZE
-    #define RBC_MESH_PACKET_POOL_SIZE               (RBC_MESH_DATA_CACHE_ENTRIES +\
+    #define RBC_MESH_PACKET_POOL_SIZE               (RBC_MESH_POOL_CACHED_VALUES +\
                                                      RBC_MESH_APP_EVENT_QUEUE_LENGTH + \
                                                      RBC_MESH_RADIO_QUEUE_LENGTH + \
                                                      RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH +\
+                                                     RBC_MESH_INTERNAL_RX_EVENT_QUEUE_LENGTH +\
                                                      3)
 #endif
 
+/** @brief Place the packet pool and the handle cache in the .noinit section,
+ * which the startup code doesn't zero. They're written in full before use, so
+ * this only shortens the zero fill before main. */
+#ifndef RBC_MESH_NOINIT_BUFFERS
+    #define RBC_MESH_NOINIT_BUFFERS                 (0)
+#endif
+
+/** @brief Move the packet pool to the RAM between the end of the application
+ * image and the end of the chip's RAM at init, when it fits more packets than
+ * RBC_MESH_PACKET_POOL_SIZE. Link for the smallest RAM variant, and the image
+ * uses all the RAM of the larger ones. The RAM size is read with
+ * nrf_ic_info_get() on the nRF51, so add nrf51_ic_info.c to the build. The
+ * static pool stays as the fallback. */
+#ifndef RBC_MESH_RUNTIME_POOL
+    #define RBC_MESH_RUNTIME_POOL                   (0)
+#endif
+
 #if (RBC_MESH_HANDLE_CACHE_ENTRIES < RBC_MESH_DATA_CACHE_ENTRIES)
     #error "The number of handle cache entries cannot be lower than the number of data entries"
 #endif
@@ -132,6 +740,9 @@ typedef enum
     RBC_MESH_EVENT_TYPE_DFU_START,              /**< The dfu module has started its target role. Parameters in dfu.start sub-structure. */
     RBC_MESH_EVENT_TYPE_DFU_END,                /**< The dfu module has ended its target role. Paramters in dfu.end sub-structure. */
     RBC_MESH_EVENT_TYPE_DFU_BANK_AVAILABLE,     /**< The dfu module found a bank available for flashing. Parameters in dfu.bank sub-structure. */
+    RBC_MESH_EVENT_TYPE_OBJECT_RX,              /**< An object has been received in full. Parameters in object sub-structure. */
+    RBC_MESH_EVENT_TYPE_SCENE_ACTION,           /**< A scene with an action for this device has been recalled. Parameters in scene sub-structure. */
+    RBC_MESH_EVENT_TYPE_REPORT,                 /**< The reports of a zone have reached this gateway. Parameters in report sub-structure. */
 } rbc_mesh_event_type_t;
 
 /** @brief The various states of the mesh framework. */
@@ -165,6 +776,28 @@ typedef struct
             uint8_t data_len;                       /**< Length of data array. */
             uint32_t timestamp_us;                  /** Timestamp of the sent packet. */
         } tx;
+        struct
+        {
+            uint16_t object_id;                     /**< Application ID of the object. */
+            uint16_t version;                       /**< Version of the object. */
+            uint8_t* p_data;                        /**< Object contents. Only valid until the next object transfer starts. */
+            uint16_t length;                        /**< Length of the object contents. */
+        } object;
+        struct
+        {
+            uint16_t scene_id;                      /**< Scene that was recalled. */
+            rbc_mesh_value_handle_t value_handle;   /**< Handle the action is for. */
+            uint8_t* p_data;                        /**< Value of the action. Only valid until the action is changed. */
+            uint8_t data_len;                       /**< Length of the value. */
+        } scene;
+        struct
+        {
+            uint8_t zone;                           /**< Zone the values were reported for. */
+            uint16_t count;                         /**< Number of values merged into the report. */
+            int16_t min;                            /**< Lowest value. */
+            int16_t max;                            /**< Highest value. */
+            int32_t sum;                            /**< Sum of the values. Divide by count for the average. */
+        } report;
         union
         {
             struct
@@ -209,6 +842,18 @@ typedef struct
     } params;
 } rbc_mesh_event_t;
 
+/**
+* @brief Function pointer type for direct event delivery, see
+*   @ref rbc_mesh_event_cb_set.
+*
+* @param[in] p_evt The event. It and the data it points to are only valid
+*   during the call.
+*
+* @return true if the event was handled, false to put it in the event queue
+*   for @ref rbc_mesh_event_get.
+*/
+typedef bool (*rbc_mesh_event_cb_t)(const rbc_mesh_event_t* p_evt);
+
 /** Radio TX power enum */
 typedef enum
 {
@@ -257,6 +902,38 @@ typedef struct
     rbc_mesh_txpower_t tx_power;
 } rbc_mesh_init_params_t;
 
+/**
+* @brief A handle-value pair for @ref rbc_mesh_value_set_bulk.
+*/
+typedef struct
+{
+    rbc_mesh_value_handle_t handle; /**< Handle of the value. */
+    uint8_t* p_data;                /**< Value contents. */
+    uint8_t length;                 /**< Length of the value contents. */
+} rbc_mesh_value_t;
+
+/**
+* @brief Handle flags that can be set in batches with
+*   @ref rbc_mesh_flag_set_bulk and @ref rbc_mesh_flag_set_range.
+*/
+typedef enum
+{
+    RBC_MESH_HANDLE_FLAG_PERSISTENT,    /**< See @ref rbc_mesh_persistence_set. */
+    RBC_MESH_HANDLE_FLAG_TX_EVENT,      /**< See @ref rbc_mesh_tx_event_set. */
+    RBC_MESH_HANDLE_FLAG_ENABLED,       /**< See @ref rbc_mesh_value_enable and @ref rbc_mesh_value_disable. */
+    RBC_MESH_HANDLE_FLAG__COUNT
+} rbc_mesh_handle_flag_t;
+
+/**
+* @brief A flag change for @ref rbc_mesh_flag_set_bulk.
+*/
+typedef struct
+{
+    rbc_mesh_value_handle_t handle; /**< Handle to change the flag of. */
+    rbc_mesh_handle_flag_t flag;    /**< Flag to change. */
+    bool value;                     /**< New value of the flag. */
+} rbc_mesh_flag_op_t;
+
 typedef enum
 {
     BLE_PACKET_TYPE_ADV_IND,
@@ -283,6 +960,164 @@ typedef struct
 /** @brief Function pointer type for packet peek callback. */
 typedef void (*rbc_mesh_packet_peek_cb_t)(rbc_mesh_packet_peek_params_t* p_peek_params);
 
+/**
+* @brief Quality of service classes for mesh values. Each class has its own
+*   trickle parameters, and due values in higher priority classes are
+*   transmitted first.
+*/
+typedef enum
+{
+    RBC_MESH_QOS_CLASS_DEFAULT,     /**< Runs with the interval given at init. Default for all handles. */
+    RBC_MESH_QOS_CLASS_LOW_LATENCY, /**< Short intervals and highest TX priority. For commands, like switch events. */
+    RBC_MESH_QOS_CLASS_BACKGROUND,  /**< Long intervals and lowest TX priority. For periodic reports, like sensor values. */
+    RBC_MESH_QOS_CLASS__COUNT
+} rbc_mesh_qos_class_t;
+
+/** @brief Radio power modes. */
+typedef enum
+{
+    RBC_MESH_POWER_MODE_NORMAL,     /**< Take all the radio time the Softdevice gives. For mains powered nodes. */
+    RBC_MESH_POWER_MODE_LOW_POWER,  /**< Listen in short windows, limited to RBC_MESH_LP_DUTY_CYCLE_PERMILLE. */
+    RBC_MESH_POWER_MODE_LEAF,       /**< Like RBC_MESH_POWER_MODE_LOW_POWER, but only transmit the values set locally. */
+    RBC_MESH_POWER_MODE__COUNT
+} rbc_mesh_power_mode_t;
+
+/** @brief Packet pool usage counters. */
+typedef struct
+{
+    uint16_t in_use;            /**< Number of packets currently referenced. */
+    uint16_t high_water_mark;   /**< Highest number of simultaneously referenced packets since init. */
+    uint32_t exhausted_count;   /**< Number of packet allocations that failed because the pool was empty. */
+    uint16_t size;              /**< Number of packets in the pool. */
+} rbc_mesh_packet_pool_stats_t;
+
+/** @brief Mesh performance counters. All counters wrap around on overflow. */
+typedef struct
+{
+    uint32_t rx_ok;                     /**< Packets received with a valid CRC. */
+    uint32_t rx_crc_fail;               /**< Packets received with an invalid CRC. */
+    uint32_t tx_count;                  /**< Packets transmitted by the radio. */
+    uint32_t pool_exhausted;            /**< Packet allocations that failed because the pool was empty. */
+    uint32_t timeslot_count;            /**< Timeslots started since init. */
+    uint32_t timeslot_extend_denied;    /**< Timeslot extensions denied by the Softdevice. */
+    uint16_t event_queue_drop;          /**< Received packets dropped because the internal event queue was full. */
+    uint16_t app_queue_drop;            /**< Events dropped because the application event queue was full. */
+    uint16_t radio_queue_drop;          /**< Radio operations dropped because the radio queue was full. */
+    uint16_t duty_cycle_permille;       /**< Share of time spent in timeslots, in permille. */
+    uint32_t rx_filtered;               /**< Received packets dropped before processing, for not being mesh packets or not coming from a whitelisted address. */
+    uint32_t rx_auth_fail;              /**< Received values dropped for a bad MIC or a replayed sequence number, when built with MESH_AUTH. */
+    uint32_t radio_warm_starts;         /**< Timeslots that found the radio configuration of the previous one intact, and skipped setting it up again. */
+    uint16_t rx_ready_us;               /**< Time from the start of the last timeslot beginning with an RX to the radio being ready to receive, in microseconds. */
+    uint16_t rx_ready_us_max;           /**< Longest rx_ready_us seen. */
+    uint32_t app_events_coalesced;      /**< UPDATE_VAL events that replaced a pending one for the same handle, with RBC_MESH_APP_EVENT_COALESCE. */
+    uint32_t conflicts_resolved;        /**< Values of the same version as the stored one, with a different payload, settled by RBC_MESH_CONFLICT_RESOLVE. */
+    uint32_t rx_duplicate;              /**< Exact copies of a stored value, counted as consistent through RBC_MESH_RX_DUP_CACHE_SIZE. */
+    uint32_t cache_hits;                /**< New values for handles that already had a data cache entry. */
+    uint32_t cache_misses;              /**< New values for handles that needed a data cache entry. */
+    uint32_t cache_evictions;           /**< Cached values dropped to make room for other handles. */
+    uint32_t timeslot_us;               /**< Time spent in timeslots, wrapping around. */
+    uint32_t radio_on_us;               /**< Time the radio spent ramping up, receiving or transmitting, wrapping around. */
+    uint32_t dispatch_us;               /**< Time spent in the event dispatcher, wrapping around. Only counted when built with MESH_DISPATCH_TIMING. */
+    uint32_t dispatch_events;           /**< Internal events executed by the event dispatcher. */
+} rbc_mesh_stats_t;
+
+/** @brief Radio time of the users of the Softdevice scheduler. Counters wrap
+ * around on overflow. */
+typedef struct
+{
+    uint32_t sd_radio_events;           /**< Softdevice radio events, from the radio notifications. */
+    uint32_t sd_radio_us;               /**< Time from the radio notifications to the end of the Softdevice radio events. */
+    uint32_t sd_interval_us;            /**< Current interval between regular Softdevice radio events, 0 if they're not regular. */
+    uint32_t mesh_timeslot_us;          /**< Time spent in mesh timeslots. */
+    uint32_t mesh_blocked;              /**< Timeslot requests blocked by the Softdevice. */
+    uint32_t mesh_canceled;             /**< Timeslots canceled by the Softdevice. */
+    uint32_t fitted_requests;           /**< Timeslot requests shortened to fit between Softdevice radio events. */
+    uint32_t flash_gaps;                /**< Gaps left after timeslots for Softdevice flash operations. */
+} rbc_mesh_coex_stats_t;
+
+/** @brief Link quality of a neighbour on a channel, from its survey packets. */
+typedef struct
+{
+    ble_gap_addr_t addr;                /**< Advertisement address of the neighbour. */
+    uint8_t channel;                    /**< Channel the survey packets were sent on. */
+    uint8_t tx_power;                   /**< TX power of the neighbour, as a @ref rbc_mesh_txpower_t value. */
+    uint8_t rssi_avg;                   /**< Negative RSSI, averaged over the last packets. */
+    uint8_t rssi_worst;                 /**< Negative RSSI of the weakest packet. */
+    uint16_t received;                  /**< Survey packets received. */
+    uint16_t expected;                  /**< Survey packets sent by the neighbour since the first one received, from their sequence numbers. */
+    uint16_t per_permille;              /**< Packet error rate, 1 - received / expected, in permille. */
+} rbc_mesh_survey_entry_t;
+
+/** @brief A node heard directly, from the source address of its mesh packets. */
+typedef struct
+{
+    ble_gap_addr_t addr;                /**< Advertisement address of the neighbour. */
+    bool active;                        /**< Heard within RBC_MESH_NEIGHBOUR_TIMEOUT_MS. */
+    uint8_t rssi_avg;                   /**< Negative RSSI, averaged over the last packets. */
+    uint16_t packets;                   /**< Packets received, saturating. */
+    uint32_t last_seen_ms;              /**< Time since the last packet, UINT32_MAX if inactive. */
+} rbc_mesh_neighbour_t;
+
+/** @brief Trickle counters for a single handle, reset when the value enters the data cache. */
+typedef struct
+{
+    uint16_t tx_count;              /**< Trickle timeouts that led to a transmit. */
+    uint16_t suppressed_count;      /**< Trickle timeouts suppressed because enough neighbours sent the same value. */
+    uint16_t suppression_permille;  /**< Share of suppressed timeouts, in permille. */
+    uint8_t  density;               /**< Average consistent RXs per trickle interval, in quarters. */
+    uint8_t  k;                     /**< Redundancy constant the handle currently runs with. */
+} rbc_mesh_handle_stats_t;
+
+/** @brief Inclusive range of value handles. */
+typedef struct
+{
+    rbc_mesh_value_handle_t first;  /**< First handle in the range. */
+    rbc_mesh_value_handle_t last;   /**< Last handle in the range. */
+} rbc_mesh_handle_range_t;
+
+/** @brief Round-trip latency statistics of a probed node. Times don't
+ * include the time the node held the probe for before replying. */
+typedef struct
+{
+    uint16_t node;                      /**< Short address of the node. */
+    uint8_t hops;                       /**< Hops from the prober to the node, in the latest reply. */
+    uint16_t sent;                      /**< Probes sent to the node since it entered the table. */
+    uint16_t received;                  /**< Replies received from the node. */
+    uint32_t rtt_min_us;                /**< Shortest round trip. */
+    uint32_t rtt_max_us;                /**< Longest round trip. */
+    uint32_t rtt_avg_us;                /**< Average round trip. */
+    uint32_t dispatch_avg_us;           /**< Average time from the node receiving a probe to sending its reply. */
+    uint32_t dispatch_max_us;           /**< Longest time from the node receiving a probe to sending its reply. */
+    uint16_t histogram[RBC_MESH_PROBE_HIST_BUCKETS]; /**< Round trips shorter than 4, 8, 16 ... 256 ms, and the longer ones in the last bucket. */
+} rbc_mesh_probe_stats_t;
+
+/** @brief Source of a logged fault. */
+typedef enum
+{
+    RBC_MESH_FAULT_TYPE_APP_ERROR,      /**< A failed APP_ERROR_CHECK, error_code and line are set. */
+    RBC_MESH_FAULT_TYPE_HARDFAULT,      /**< A hard fault, pc and lr are taken from the exception frame. */
+    RBC_MESH_FAULT_TYPE_SD_ASSERT,      /**< A Softdevice assert, pc and line are set. */
+    RBC_MESH_FAULT_TYPE_USER            /**< Logged by the application for reasons of its own. */
+} rbc_mesh_fault_type_t;
+
+/** @brief A logged fault, with a snapshot of the mesh counters when it
+ * happened. Takes 32 bytes, laid out without padding. */
+typedef struct
+{
+    uint32_t error_code;                /**< Error code of the fault, 0 for hard faults. */
+    uint32_t pc;                        /**< Program counter at the fault, or the address the error handler was called from. */
+    uint32_t lr;                        /**< Link register at the fault, 0 if unknown. */
+    uint32_t uptime_ms;                 /**< Time since the framework was initialized. */
+    uint32_t rx_ok;                     /**< rbc_mesh_stats_t::rx_ok at the fault. */
+    uint16_t seq;                       /**< Number of the fault in the log, counting up from 1. */
+    uint16_t line;                      /**< Source line of the fault, 0 if unknown. */
+    uint16_t pool_exhausted;            /**< rbc_mesh_stats_t::pool_exhausted at the fault, saturated. */
+    uint16_t event_queue_drop;          /**< rbc_mesh_stats_t::event_queue_drop at the fault. */
+    uint16_t app_queue_drop;            /**< rbc_mesh_stats_t::app_queue_drop at the fault. */
+    uint8_t type;                       /**< Source of the fault, an rbc_mesh_fault_type_t. */
+    uint8_t radio_queue_drop;           /**< rbc_mesh_stats_t::radio_queue_drop at the fault, saturated. */
+} rbc_mesh_fault_record_t;
+
 /*****************************************************************************
      Interface Functions
 *****************************************************************************/
@@ -296,7 +1131,8 @@ typedef void (*rbc_mesh_packet_peek_cb_t)(rbc_mesh_packet_peek_params_t* p_peek_
 *    return NRF_ERROR_SOFTDEVICE_NOT_ENABLED.
 *
 * @return NRF_SUCCESS the initialization is successful
-* @return NRF_ERROR_INVALID_PARAM a parameter does not meet its required range.
+* @return NRF_ERROR_INVALID_PARAM a parameter does not meet its required range,
+*    or the access address is the BLE advertisement address in long packet mode.
 * @return NRF_ERROR_INVALID_STATE the framework has already been initialized.
 * @return NRF_ERROR_SOFTDEVICE_NOT_ENABLED the Softdevice has not been enabled.
 */
@@ -358,12 +1194,141 @@ uint32_t rbc_mesh_stop(void);
 uint32_t rbc_mesh_value_set(rbc_mesh_value_handle_t handle, uint8_t* data, uint16_t len);
 
 /**
-* @brief Start broadcasting the handle-value pair. If the handle has not been
-*   assigned a value yet, it will start broadcasting a version 0 value with
-*   0 length payload, so that adjacent nodes may push an updated version of
-*   the handle-value pair.
+* @brief Set the contents of several values at once.
 *
-* @note The value broadcast is sent asynchronously, and a response is likely
+* @details All values are handed to the handle storage in the same critical
+*   section, so the mesh never transmits a state where only some of them have
+*   been updated, and the transmit order is only updated once.
+*
+* @param[in] p_values Array of handle-value pairs to update.
+* @param[in] count Number of entries in p_values. Must not exceed 32.
+* @param[out] p_success_mask Bit i is set if entry i was updated successfully.
+*
+* @return NRF_SUCCESS all values have been successfully updated.
+* @return NRF_ERROR_NULL p_values or p_success_mask is NULL.
+* @return NRF_ERROR_INVALID_STATE if the framework has not been initialized.
+* @return NRF_ERROR_INVALID_LENGTH count is 0 or above 32.
+* @return Other error codes the first error returned for a failing entry, as
+*   for @ref rbc_mesh_value_set. The entries that succeeded are in
+*   p_success_mask.
+*/
+uint32_t rbc_mesh_value_set_bulk(const rbc_mesh_value_t* p_values, uint32_t count, uint32_t* p_success_mask);
+
+/**
+* @brief Send an object that's too long for a single value to all devices in
+*   the mesh.
+*
+* @details The object is split in segments, which are sent on reserved
+*   handles and relayed by all devices built with object support. The
+*   devices put the segments back together, and ask for the segments they
+*   miss. When a device has received all segments, it generates an
+*   RBC_MESH_EVENT_TYPE_OBJECT_RX event. Sending the same object ID again
+*   gives the object a higher version, which replaces the old one.
+*
+* @note There's only room for one object at a time. An incomplete object
+*   being received blocks other objects until it's complete, or until it's
+*   dropped after RBC_MESH_OBJECT_REQ_RETRIES unanswered requests.
+*
+* @param[in] object_id Application ID of the object.
+* @param[in] p_data Object contents. Copied by the framework.
+* @param[in] length Length of the object contents, at most RBC_MESH_OBJECT_MAX_LEN.
+*
+* @return NRF_SUCCESS the object will be sent.
+* @return NRF_ERROR_NULL p_data is NULL.
+* @return NRF_ERROR_INVALID_LENGTH the object is empty or too long.
+* @return NRF_ERROR_BUSY another object is being received.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_OBJECT_MAX_LEN is 0.
+*/
+uint32_t rbc_mesh_object_set(uint16_t object_id, const uint8_t* p_data, uint16_t length);
+
+/**
+* @brief Add an action to a scene, or replace the scene's action for a
+*   handle.
+*
+* @details When the scene is recalled, the device generates an
+*   RBC_MESH_EVENT_TYPE_SCENE_ACTION event with the handle and value of each
+*   of its actions in the scene, for the application to apply, for instance
+*   by switching the light the handle stands for. The actions are local to the
+*   device and are not sent to the mesh, so every device is set up with the
+*   actions of its own handles.
+*
+* @param[in] scene_id Scene to add the action to.
+* @param[in] handle Handle the action is for.
+* @param[in] p_data Value of the action. Copied by the framework.
+* @param[in] length Length of the value, at most RBC_MESH_SCENE_VALUE_MAX_LEN.
+*
+* @return NRF_SUCCESS the action was stored.
+* @return NRF_ERROR_NULL p_data is NULL.
+* @return NRF_ERROR_INVALID_ADDR the handle is not an application handle.
+* @return NRF_ERROR_INVALID_LENGTH the value is too long.
+* @return NRF_ERROR_NO_MEM all RBC_MESH_SCENE_ACTIONS_MAX actions are in use.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_SCENE_ACTIONS_MAX is 0.
+*/
+uint32_t rbc_mesh_scene_action_set(uint16_t scene_id, rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length);
+
+/**
+* @brief Remove actions from a scene.
+*
+* @param[in] scene_id Scene to remove the actions from.
+* @param[in] handle Handle of the action to remove, or RBC_MESH_INVALID_HANDLE
+*   to remove all actions of the scene.
+*
+* @return NRF_SUCCESS at least one action was removed.
+* @return NRF_ERROR_NOT_FOUND the scene has no such action.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_SCENE_ACTIONS_MAX is 0.
+*/
+uint32_t rbc_mesh_scene_action_clear(uint16_t scene_id, rbc_mesh_value_handle_t handle);
+
+/**
+* @brief Recall a scene on all devices in the mesh.
+*
+* @details Sets the value of RBC_MESH_SCENE_HANDLE to the scene ID. The value
+*   propagates like any other, and each device that gets it, this one
+*   included, applies its actions for the scene at once, so a single value
+*   update drives all handles in the scene. Recalling the same scene again
+*   applies it again. Devices only apply scenes if they're subscribed to
+*   RBC_MESH_SCENE_HANDLE. Give the handle the
+*   RBC_MESH_QOS_CLASS_LOW_LATENCY QoS class for the fastest propagation.
+*
+* @param[in] scene_id Scene to recall.
+*
+* @return NRF_SUCCESS the scene will be recalled.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_SCENE_ACTIONS_MAX is 0.
+*/
+uint32_t rbc_mesh_scene_recall(uint16_t scene_id);
+
+/**
+* @brief Recall a scene on all devices in the mesh at a given mesh time.
+*
+* @details Like @ref rbc_mesh_scene_recall, but the devices apply their
+*   actions when their mesh time reaches time_us, see
+*   @ref rbc_mesh_time_get, so devices that get the value at different times
+*   act at once. Leave enough time for the value to reach all devices.
+*   Devices that aren't synchronized, or get the value after time_us, apply
+*   the scene as soon as they get it. A recall waiting for its time is
+*   replaced by the next recall.
+*
+* @param[in] scene_id Scene to recall.
+* @param[in] time_us Mesh time to apply the scene at.
+*
+* @return NRF_SUCCESS the scene will be recalled.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_SCENE_ACTIONS_MAX or
+*   RBC_MESH_TIME_SYNC is 0.
+*/
+uint32_t rbc_mesh_scene_recall_at(uint16_t scene_id, uint32_t time_us);
+
+/**
+* @brief Start broadcasting the handle-value pair. If the handle has not been
+*   assigned a value yet, it will start broadcasting a version 0 value with
+*   0 length payload, so that adjacent nodes may push an updated version of
+*   the handle-value pair.
+*
+* @note The value broadcast is sent asynchronously, and a response is likely
 *   to be received after several milliseconds depending on the adv_int_ms
 *   value set in @ref rbc_mesh_init.
 *
@@ -416,6 +1381,80 @@ uint32_t rbc_mesh_value_disable(rbc_mesh_value_handle_t handle);
 */
 uint32_t rbc_mesh_persistence_set(rbc_mesh_value_handle_t handle, bool persistent);
 
+/**
+* @brief Set the quality of service class of the given handle.
+*
+* @note The class is a local setting, and only affects how this device
+*   retransmits the value. For a value to propagate quickly through the whole
+*   mesh, all devices should put it in the same class.
+* @note Like the other handle flags, the class is lost if the handle falls out
+*   of the handle cache. Combine with @ref rbc_mesh_persistence_set to keep
+*   it.
+*
+* @param[in] handle Handle to change the QoS class for.
+* @param[in] qos_class The new QoS class of the handle.
+*
+* @return NRF_SUCCESS the QoS class change has been scheduled.
+* @return NRF_ERROR_INVALID_ADDR the handle is invalid.
+* @return NRF_ERROR_INVALID_PARAM the QoS class is invalid.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_qos_set(rbc_mesh_value_handle_t handle, rbc_mesh_qos_class_t qos_class);
+
+/**
+* @brief Get the quality of service class of the given handle.
+*
+* @param[in] handle The handle whose class should be fetched.
+* @param[out] p_qos_class The QoS class of the handle.
+*
+* @return NRF_SUCCESS The class was successfully copied to the parameter.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initilalized.
+* @return NRF_ERROR_NOT_FOUND The given handle is not present in the cache.
+* @return NRF_ERROR_INVALID_ADDR The given handle is invalid.
+*/
+uint32_t rbc_mesh_qos_get(rbc_mesh_value_handle_t handle, rbc_mesh_qos_class_t* p_qos_class);
+
+/**
+* @brief Get the trickle counters of the given handle. The suppression ratio
+*   tells how much of the handle's traffic is covered by its neighbours.
+* @note The counters halve instead of wrapping when they saturate.
+*
+* @param[in] handle The handle whose counters should be fetched.
+* @param[out] p_stats Pointer location to put the counters in.
+*
+* @return NRF_SUCCESS The counters were successfully copied to the parameter.
+* @return NRF_ERROR_NULL p_stats is NULL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initilalized.
+* @return NRF_ERROR_NOT_FOUND The given handle has no value in the cache.
+* @return NRF_ERROR_INVALID_ADDR The given handle is invalid.
+*/
+uint32_t rbc_mesh_handle_stats_get(rbc_mesh_value_handle_t handle, rbc_mesh_handle_stats_t* p_stats);
+
+/**
+* @brief Set the handle ranges the application subscribes to. Values outside
+*   the ranges are still relayed, but produce no application events or GATT
+*   updates, and only use the RBC_MESH_RELAY_CACHE_ENTRIES entries of the
+*   handle cache set aside for relaying, so that they can't push the
+*   subscribed handles out of the cache.
+*
+* @note Handles the application sets, or makes persistent, are treated as
+*   subscribed for as long as they stay in the cache.
+* @note All handles are subscribed to by default. Set count to 0 to go back to
+*   subscribing to all handles.
+*
+* @param[in] p_ranges Array of handle ranges to subscribe to. Copied by the
+*   framework.
+* @param[in] count Number of ranges in the array, at most
+*   RBC_MESH_SUBSCRIPTION_RANGES_MAX.
+*
+* @return NRF_SUCCESS The subscription was updated.
+* @return NRF_ERROR_NULL p_ranges is NULL and count is not 0.
+* @return NRF_ERROR_INVALID_LENGTH count is above RBC_MESH_SUBSCRIPTION_RANGES_MAX.
+* @return NRF_ERROR_INVALID_PARAM A range ends before it starts.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_subscription_set(const rbc_mesh_handle_range_t* p_ranges, uint8_t count);
+
 /**
 * @brief Set whether the given handle should produce TX events for each time
 *   the value is transmitted.
@@ -436,6 +1475,52 @@ uint32_t rbc_mesh_persistence_set(rbc_mesh_value_handle_t handle, bool persisten
 */
 uint32_t rbc_mesh_tx_event_set(rbc_mesh_value_handle_t handle, bool do_tx_event);
 
+/**
+* @brief Change several handle flags at once. Unlike the single flag
+*   functions, which queue each change for the framework's event handler,
+*   the changes are applied right away, in order, in a single critical
+*   section, so configuring many handles at startup can't overflow the
+*   internal event queue.
+*
+* @note The mesh waits while the changes are applied. Setting persistence
+*   writes the value to flash when built with MESH_PERSIST, so keep large
+*   batches to startup.
+*
+* @param[in] p_ops Array of flag changes.
+* @param[in] count Number of changes in the array.
+* @param[out] p_applied_count Number of changes applied, may be NULL. The
+*   changes after the first failing one are not applied.
+*
+* @return NRF_SUCCESS All changes were applied.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_NULL p_ops is NULL.
+* @return NRF_ERROR_INVALID_ADDR A handle is invalid. Nothing was applied.
+* @return NRF_ERROR_INVALID_PARAM A flag is invalid. Nothing was applied.
+* @return NRF_ERROR_NO_MEM The handle cache is full of persistent handles.
+*/
+uint32_t rbc_mesh_flag_set_bulk(const rbc_mesh_flag_op_t* p_ops, uint32_t count, uint32_t* p_applied_count);
+
+/**
+* @brief Set a handle flag to the same value for a range of handles in a
+*   single critical section, like @ref rbc_mesh_flag_set_bulk.
+*
+* @param[in] first First handle of the range.
+* @param[in] last Last handle of the range, inclusive.
+* @param[in] flag Flag to change.
+* @param[in] value New value of the flag.
+*
+* @return NRF_SUCCESS The flag was set for all handles in the range.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_INVALID_ADDR The range is invalid. Nothing was applied.
+* @return NRF_ERROR_INVALID_PARAM The flag is invalid.
+* @return NRF_ERROR_NO_MEM The handle cache is full of persistent handles.
+*   The handles before the failing one have the new flag value.
+*/
+uint32_t rbc_mesh_flag_set_range(rbc_mesh_value_handle_t first,
+    rbc_mesh_value_handle_t last,
+    rbc_mesh_handle_flag_t flag,
+    bool value);
+
 /**
 * @brief Get the contents of the data array pointed to by the provided handle
 *
@@ -452,6 +1537,106 @@ uint32_t rbc_mesh_value_get(rbc_mesh_value_handle_t handle,
     uint8_t* data,
     uint16_t* len);
 
+/**
+* @brief Get a snapshot of the value and version of a handle without locking.
+*   Unlike @ref rbc_mesh_value_get(), the copy is made without entering the
+*   framework's critical section, so frequent readers, like UI refreshes,
+*   never hold up the mesh, and are never held up by it. A read that races an
+*   update of the value is started over.
+*
+* @note Safe to call from any context. A caller running at a higher interrupt
+*   priority than the framework's event handler can't let an update it
+*   interrupted finish, and gets NRF_ERROR_BUSY once
+*   RBC_MESH_VALUE_READ_ATTEMPTS attempts have failed.
+*
+* @param[in] handle The handle of the value to read.
+* @param[out] data Buffer to copy the value to.
+* @param[in,out] len Size of the buffer in, length of the value out.
+* @param[out] p_version Version of the value, may be NULL.
+*
+* @return NRF_SUCCESS the value has been successfully fetched.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_INVALID_ADDR the handle is invalid.
+* @return NRF_ERROR_NOT_FOUND the handle has no value in the cache.
+* @return NRF_ERROR_INVALID_LENGTH the value doesn't fit in the buffer.
+* @return NRF_ERROR_BUSY the value kept changing during the attempts.
+*/
+uint32_t rbc_mesh_value_read(rbc_mesh_value_handle_t handle,
+    uint8_t* data,
+    uint16_t* len,
+    uint16_t* p_version);
+
+/**
+* @brief Get a pointer to the cached value of a persistent or static handle,
+*   without copying it. These handles keep their cache entries, but an update
+*   may still change the value while the application reads it: call
+*   @ref rbc_mesh_value_peek_check() with the returned token when done
+*   reading, and start over if it fails.
+*
+* @note Safe to call from any context, see @ref rbc_mesh_value_read().
+*
+* @param[in] handle The handle of the value to read.
+* @param[out] pp_data Set to point to the value in the cache.
+* @param[out] p_len Length of the value.
+* @param[out] p_token Token for @ref rbc_mesh_value_peek_check().
+*
+* @return NRF_SUCCESS the value pointer was fetched.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_INVALID_ADDR the handle is invalid.
+* @return NRF_ERROR_NOT_FOUND the handle has no value in the cache.
+* @return NRF_ERROR_FORBIDDEN the handle is neither persistent nor static.
+* @return NRF_ERROR_BUSY the value kept changing during the attempts.
+*/
+uint32_t rbc_mesh_value_peek(rbc_mesh_value_handle_t handle,
+    const uint8_t** pp_data,
+    uint16_t* p_len,
+    uint32_t* p_token);
+
+/**
+* @brief Check that a value read through @ref rbc_mesh_value_peek() wasn't
+*   changed during the read.
+*
+* @param[in] token Token returned by @ref rbc_mesh_value_peek().
+*
+* @return NRF_SUCCESS the value is unchanged, and the read is good.
+* @return NRF_ERROR_INVALID_DATA the value changed, and must be read again.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_INVALID_PARAM the token is invalid.
+*/
+uint32_t rbc_mesh_value_peek_check(uint32_t token);
+
+/**
+* @brief Walk through all cached values, one per call. Used to copy the whole
+*   mesh state out of the device, e.g. to resynchronize a host after it
+*   reconnects, without knowing which handles are in use.
+*
+* @details Start with the cursor at 0, and call again with the updated cursor
+*   until NRF_ERROR_NOT_FOUND is returned. The cursor is a position in the
+*   handle cache, so a walk can be paused and resumed at any time. Values that
+*   are cached or updated during the walk may or may not be visited, and
+*   should be picked up from the framework's events instead. Each call holds
+*   the framework's critical section only while copying a single value.
+*
+* @param[in,out] p_cursor Position to start at in, position after the
+*   returned value out.
+* @param[out] p_handle Handle of the returned value.
+* @param[out] data Buffer to copy the value to.
+* @param[in,out] len Size of the buffer in, length of the value out.
+* @param[out] p_version Version of the value, may be NULL.
+*
+* @return NRF_SUCCESS a value was copied, and the cursor moved past it.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+* @return NRF_ERROR_NULL a required parameter was NULL.
+* @return NRF_ERROR_NOT_FOUND there are no more values.
+* @return NRF_ERROR_INVALID_LENGTH the next value doesn't fit in the buffer.
+*   The cursor is left at the value.
+*/
+uint32_t rbc_mesh_value_next(uint16_t* p_cursor,
+    rbc_mesh_value_handle_t* p_handle,
+    uint8_t* data,
+    uint16_t* len,
+    uint16_t* p_version);
+
 /**
 * @brief Get current mesh access address
 *
@@ -511,7 +1696,578 @@ uint32_t rbc_mesh_persistence_get(rbc_mesh_value_handle_t handle, bool* is_persi
 uint32_t rbc_mesh_tx_event_flag_get(rbc_mesh_value_handle_t handle, bool* is_doing_tx_event);
 
 /**
-* @brief Set TX power for mesh packets.
+* @brief Run the mesh on a set of advertising channels instead of the single
+*   channel given in @ref rbc_mesh_init.
+*
+* @details In multi-channel mode, every trickle transmission is sent once on
+*   each channel in the map, and scanning rotates between the channels every
+*   RBC_MESH_ADV_CHANNEL_SCAN_INTERVAL_US. This trades a few extra radio
+*   events per transmission for robustness against interference on a single
+*   channel. All devices in the mesh should use overlapping channel maps.
+*
+* @param[in] adv_channel_map Bitmap of RBC_MESH_ADV_CHANNEL_* values, or 0 to
+*   return to the single channel given at initialization.
+*
+* @return NRF_SUCCESS the channel map was applied.
+* @return NRF_ERROR_INVALID_PARAM the map contains bits outside
+*   RBC_MESH_ADV_CHANNEL_ALL.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_adv_channel_map_set(uint8_t adv_channel_map);
+
+/**
+* @brief Add a high rate backbone bearer between nodes that hear each other
+*   well, like mains powered switches.
+*
+* @details The backbone uses the nRF 2 Mbit radio mode on a proprietary access
+*   address, with the same packet format as the advertising bearer, so each
+*   packet takes half the air time. With the backbone enabled, every
+*   transmission is sent on the backbone first, and then on the advertising
+*   bearer as before, so nodes without the backbone still take part in the
+*   mesh. Scanning alternates between the backbone and the advertising
+*   channels every RBC_MESH_ADV_CHANNEL_SCAN_INTERVAL_US. Values heard on
+*   either bearer are handled the same way.
+*
+* @param[in] enabled Whether to use the backbone.
+* @param[in] access_address Access address of the backbone. Ignored if
+*   enabled is false.
+* @param[in] channel Radio channel of the backbone, numbered like the mesh
+*   channel in @ref rbc_mesh_init. Ignored if enabled is false.
+*
+* @return NRF_SUCCESS the backbone setting was applied.
+* @return NRF_ERROR_INVALID_PARAM the channel is higher than 39.
+* @return NRF_ERROR_INVALID_ADDR the access address is the BLE advertising
+*   access address.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_backbone_set(bool enabled, uint32_t access_address, uint8_t channel);
+
+/**
+* @brief Make the device a gateway for convergecast reports, or a regular
+*   node.
+*
+* @details Gateways collect the reports of all nodes in reach of the mesh,
+*   and generate an RBC_MESH_EVENT_TYPE_REPORT event for each zone with
+*   reports every RBC_MESH_REPORT_INTERVAL_MS, covering the values reported
+*   since the last one. A mesh may have several gateways, in which case each
+*   node reports to the closest one.
+*
+* @param[in] gateway Whether the device is a gateway.
+*
+* @return NRF_SUCCESS The role was set.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_REPORT_ZONES is 0.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_report_gateway_set(bool gateway);
+
+/**
+* @brief Report a value, like a sensor reading, to the gateways.
+*
+* @details Unlike handle values, reports are not spread to every node. They
+*   travel toward the closest gateway only, following the hop counts in
+*   the gateways' beacons, and the values of the same zone are merged into
+*   a minimum, maximum, count and sum on the way. Each node sends its merged
+*   reports once per RBC_MESH_REPORT_INTERVAL_MS, so the reports of a zone
+*   cost a relay one record per interval however many nodes are behind it.
+*   Reports are best effort, and are kept on the node while no gateway is
+*   in reach.
+*
+* @param[in] zone Zone the value belongs to, like a room.
+* @param[in] value The value.
+*
+* @return NRF_SUCCESS The value was merged into the zone's report.
+* @return NRF_ERROR_NO_MEM Reports for RBC_MESH_REPORT_ZONES other zones are
+*   waiting to be sent.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_REPORT_ZONES is 0.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_report_submit(uint8_t zone, int16_t value);
+
+/**
+* @brief Get the number of hops from the device to the closest gateway.
+*
+* @param[out] p_hops The hop count, 0 on gateways.
+*
+* @return NRF_SUCCESS The hop count was fetched.
+* @return NRF_ERROR_NULL p_hops is NULL.
+* @return NRF_ERROR_NOT_FOUND No gateway is in reach.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_REPORT_ZONES is 0.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_report_hops_get(uint8_t* p_hops);
+
+/**
+* @brief Make the device the root of the mesh time, or a regular node.
+*
+* @details The mesh time is the clock of the root, in microseconds. The root
+*   sends a time beacon every RBC_MESH_TIME_BEACON_INTERVAL_MS, and every
+*   node that has synchronized to it sends its own, so the time spreads hop
+*   by hop. Receivers pair the time in each beacon with their own time of
+*   reception, and estimate their offset and clock skew to the root from the
+*   latest RBC_MESH_TIME_SAMPLES pairs. Set exactly one root in a mesh.
+*
+* @param[in] root Whether the device is the root.
+*
+* @return NRF_SUCCESS The role was set.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_TIME_SYNC is 0.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_time_root_set(bool root);
+
+/**
+* @brief Get the mesh time.
+*
+* @details Gives a timebase shared by all synchronized devices, for
+*   correlating readings or acting at once. The time wraps around every
+*   71 minutes. Like other framework timestamps, it advances in steps
+*   between the framework's radio timeslots.
+*
+* @param[out] p_time_us The mesh time, in microseconds.
+*
+* @return NRF_SUCCESS The time was fetched.
+* @return NRF_ERROR_NULL p_time_us is NULL.
+* @return NRF_ERROR_INVALID_STATE The device isn't synchronized to a root,
+*   or the framework has not been initialized.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_TIME_SYNC is 0.
+*/
+uint32_t rbc_mesh_time_get(uint32_t* p_time_us);
+
+/**
+* @brief Get the local time as a 64 bit timestamp.
+*
+* @details Gives a monotonic microsecond time that never wraps around. It
+*   follows the low frequency clock between the framework's radio timeslots,
+*   and the high frequency crystal inside them. Use it instead of the 32 bit
+*   framework timestamps or app_timer ticks when measuring long intervals.
+*
+* @note The time is kept in software on top of the 24 bit RTC0 counter, and
+*   must be read at least every 512 seconds. The framework does so at every
+*   timeslot, but the application has to while the framework is stopped.
+*
+* @param[out] p_time_us Microseconds since the framework was initialized.
+*
+* @return NRF_SUCCESS The time was fetched.
+* @return NRF_ERROR_NULL p_time_us is NULL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_timestamp_get(uint64_t* p_time_us);
+
+/**
+* @brief Convert a 32 bit framework timestamp to the 64 bit local time.
+*
+* @details The timestamps in framework events, like the RX timestamp, are
+*   the lower 32 bits of the time given by @ref rbc_mesh_timestamp_get.
+*   The timestamp must be less than 35 minutes away from the current time.
+*
+* @param[in] timestamp_us 32 bit timestamp to convert.
+* @param[out] p_time_us The timestamp as 64 bit local time.
+*
+* @return NRF_SUCCESS The timestamp was converted.
+* @return NRF_ERROR_NULL p_time_us is NULL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_timestamp_extend(uint32_t timestamp_us, uint64_t* p_time_us);
+
+/**
+* @brief Start measuring the round-trip latency to a node, or to all nodes.
+*
+* @details Sends a probe every interval. Probes are flooded through the
+*   mesh, and the target nodes reply with their hop count. Replies are
+*   relayed back along the hop counts of the probe, and the device keeps the
+*   round-trip times of each replying node, see @ref rbc_mesh_probe_stats_get.
+*   Replies to probes for all nodes are spread over 100 ms, which is left out
+*   of the round-trip times. Calling the function again changes the target
+*   and the interval.
+*
+* @note Probes take radio time from the mesh values, so keep the interval
+*   long compared to the round trips, particularly for probes to all nodes.
+*
+* @param[in] target Short address of the node to probe, the two lowest bytes
+*   of its advertisement address, or RBC_MESH_PROBE_TARGET_ALL.
+* @param[in] interval_ms Time between two probes.
+*
+* @return NRF_SUCCESS Probing was started.
+* @return NRF_ERROR_INVALID_PARAM interval_ms is 0.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_PROBE or RBC_MESH_PROBE_NODES is 0.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_probe_start(uint16_t target, uint32_t interval_ms);
+
+/**
+* @brief Stop sending latency probes. Replies to the probes already sent are
+*   still counted.
+*
+* @return NRF_SUCCESS Probing was stopped.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_PROBE or RBC_MESH_PROBE_NODES is 0.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_probe_stop(void);
+
+/**
+* @brief Get the latency statistics of a probed node. Nodes enter the table
+*   in the order they are probed or first reply, and the table holds up to
+*   RBC_MESH_PROBE_NODES nodes.
+*
+* @param[in] index Index of the node in the table, starting at 0.
+* @param[out] p_stats Statistics of the node.
+*
+* @return NRF_SUCCESS The statistics were fetched.
+* @return NRF_ERROR_NULL p_stats is NULL.
+* @return NRF_ERROR_NOT_FOUND There's no node at the index.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_PROBE or RBC_MESH_PROBE_NODES is 0.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_probe_stats_get(uint8_t index, rbc_mesh_probe_stats_t* p_stats);
+
+/**
+* @brief Clear the latency statistics of all nodes. Probing goes on.
+*
+* @return NRF_SUCCESS The statistics were cleared.
+* @return NRF_ERROR_NOT_SUPPORTED RBC_MESH_PROBE or RBC_MESH_PROBE_NODES is 0.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_probe_reset(void);
+
+/**
+* @brief Set the state to write to flash when the supply voltage drops, when
+*   built with MESH_POWERFAIL.
+*
+* @details Meant for a small state that changes often, like a relay state or
+*   a dimming level, that would wear the flash if written on every change.
+*   The call only copies the state to RAM. When the supply falls below
+*   RBC_MESH_POWERFAIL_THRESHOLD, the state is written as a single record to
+*   flash that was erased ahead of time, which takes well under a millisecond
+*   of the supply hold-up time. Get it back after the next boot with
+*   @ref rbc_mesh_powerfail_state_get.
+*
+* @param[in] p_data State to write.
+* @param[in] length Length of the state, at most RBC_MESH_POWERFAIL_STATE_LEN_MAX.
+*
+* @return NRF_SUCCESS The state was set.
+* @return NRF_ERROR_NULL p_data is NULL.
+* @return NRF_ERROR_INVALID_LENGTH The state is too long.
+* @return NRF_ERROR_NOT_SUPPORTED The framework was built without MESH_POWERFAIL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_powerfail_state_set(const uint8_t* p_data, uint8_t length);
+
+/**
+* @brief Get the power-fail state, as restored from flash at init or last set
+*   with @ref rbc_mesh_powerfail_state_set.
+*
+* @param[out] p_data Buffer of RBC_MESH_POWERFAIL_STATE_LEN_MAX bytes to fill.
+* @param[out] p_length Length of the state.
+*
+* @return NRF_SUCCESS The state was copied.
+* @return NRF_ERROR_NULL A parameter is NULL.
+* @return NRF_ERROR_NOT_FOUND No state was written before the last power loss,
+*   and none has been set since.
+* @return NRF_ERROR_NOT_SUPPORTED The framework was built without MESH_POWERFAIL.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_powerfail_state_get(uint8_t* p_data, uint8_t* p_length);
+
+/**
+* @brief Capture a fault in RAM, when built with MESH_FAULTLOG. Meant for the
+*   application's error handlers, and safe to call from any context, even
+*   before the framework is initialized.
+*
+* @details The fault is written to a record in RAM that survives the reset,
+*   along with the uptime and a snapshot of the mesh counters, so the call
+*   takes a few microseconds, and never waits for the flash. The record is
+*   committed to the fault log in flash when the framework is initialized
+*   after the next reset, and read back with @ref rbc_mesh_fault_get. A
+*   fault captured before the last one is committed replaces it.
+*
+* @param[in] type Source of the fault.
+* @param[in] error_code Error code of the fault.
+* @param[in] pc Address of the fault, or 0 if unknown.
+* @param[in] lr Link register at the fault, or 0 if unknown.
+* @param[in] line Source line of the fault, or 0 if unknown.
+*
+* @return NRF_SUCCESS The fault was captured.
+* @return NRF_ERROR_NOT_SUPPORTED The framework was built without MESH_FAULTLOG.
+*/
+uint32_t rbc_mesh_fault_capture(rbc_mesh_fault_type_t type, uint32_t error_code, uint32_t pc, uint32_t lr, uint16_t line);
+
+/**
+* @brief Read a fault from the fault log in flash, when built with
+*   MESH_FAULTLOG.
+*
+* @param[in] index Index of the fault, 0 for the latest one.
+* @param[out] p_record Fault record to fill.
+*
+* @return NRF_SUCCESS The record was filled.
+* @return NRF_ERROR_NULL p_record is NULL.
+* @return NRF_ERROR_NOT_FOUND The log holds fewer faults than index + 1.
+* @return NRF_ERROR_NOT_SUPPORTED The framework was built without MESH_FAULTLOG.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_fault_get(uint8_t index, rbc_mesh_fault_record_t* p_record);
+
+/**
+* @brief Bridge the given handle ranges between the mesh and a second mesh
+*   network on another access address, like the mesh of the next floor.
+*
+* @details The node stays a full member of its own mesh, and takes part in
+*   the other network for the bridged handles only: every transmission of a
+*   bridged value is sent on the other network's access address as well, and
+*   every other scan is on the other network, where only values of the
+*   bridged handles are let in. Both networks share the handle cache of the
+*   node, so a bridged value set in either network spreads to the other,
+*   while the rest of the handles stay in their own network. With the
+*   backbone enabled too, the scans off the advertising channels alternate
+*   between the backbone and the other network.
+*
+* @note All nodes bridging the same pair of networks must bridge the same
+*   handles, and the handle numbers of the bridged ranges must mean the same
+*   in both networks. When built with MESH_AUTH, the networks must share the
+*   network key, as the values are forwarded with their signatures.
+* @note Bridged values are always sent in their own packet, never batched.
+*
+* @param[in] access_address Access address of the other network.
+* @param[in] channel Radio channel of the other network, numbered like the
+*   mesh channel in @ref rbc_mesh_init.
+* @param[in] p_ranges Array of handle ranges to bridge. Copied by the
+*   framework.
+* @param[in] count Number of ranges in the array, at most
+*   RBC_MESH_BRIDGE_RANGES_MAX. Set to 0 to turn the bridge off.
+*
+* @return NRF_SUCCESS The bridge setting was applied.
+* @return NRF_ERROR_NULL p_ranges is NULL and count is not 0.
+* @return NRF_ERROR_INVALID_LENGTH count is above RBC_MESH_BRIDGE_RANGES_MAX.
+* @return NRF_ERROR_INVALID_PARAM The channel is higher than 39, or a range
+*   ends before it starts or goes past RBC_MESH_APP_MAX_HANDLE.
+* @return NRF_ERROR_INVALID_ADDR The access address is the BLE advertising
+*   access address or the access address of the mesh.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+*/
+uint32_t rbc_mesh_bridge_set(uint32_t access_address, uint8_t channel, const rbc_mesh_handle_range_t* p_ranges, uint8_t count);
+
+/**
+* @brief Set the radio power mode of the device.
+*
+* @details In the low power modes, the framework stops extending its
+*   timeslots, and sleeps between them for long enough to keep the share of
+*   time in timeslots at or below RBC_MESH_LP_DUTY_CYCLE_PERMILLE. The next
+*   timeslot is placed at the next trickle transmit deadline, but never later
+*   than RBC_MESH_LP_SYNC_INTERVAL_MS after the previous one. Values
+*   received from other devices are only relayed in
+*   RBC_MESH_POWER_MODE_LOW_POWER. In RBC_MESH_POWER_MODE_LEAF, they are
+*   reported to the application and then disabled, and values outside the
+*   subscribed ranges are ignored.
+*
+* @note The mode takes effect from the end of the current timeslot. Values
+*   received in RBC_MESH_POWER_MODE_LEAF stay disabled when going back to
+*   normal mode, until they are enabled or set by the application.
+*
+* @param[in] power_mode The new power mode.
+*
+* @return NRF_SUCCESS the power mode was applied.
+* @return NRF_ERROR_INVALID_PARAM the power mode is invalid.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_power_mode_set(rbc_mesh_power_mode_t power_mode);
+
+/**
+* @brief Get the packet pool usage counters.
+*
+* @param[out] p_stats Pointer location to put the pool counters in.
+*
+* @return NRF_SUCCESS the counters were fetched successfully
+* @return NRF_ERROR_NULL p_stats is NULL
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized
+*/
+uint32_t rbc_mesh_packet_pool_stats_get(rbc_mesh_packet_pool_stats_t* p_stats);
+
+/**
+* @brief Get the mesh performance counters. The counters are reset by
+*   rbc_mesh_init.
+*
+* @param[out] p_stats Pointer location to put the counters in.
+*
+* @return NRF_SUCCESS the counters were fetched successfully
+* @return NRF_ERROR_NULL p_stats is NULL
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized
+*/
+uint32_t rbc_mesh_stats_get(rbc_mesh_stats_t* p_stats);
+
+/**
+* @brief Get the radio time used by the mesh and the Softdevice. The counters
+*   are reset by rbc_mesh_init.
+*
+* @param[out] p_stats Pointer location to put the counters in.
+*
+* @return NRF_SUCCESS the counters were fetched successfully
+* @return NRF_ERROR_NULL p_stats is NULL
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized
+*/
+uint32_t rbc_mesh_coex_stats_get(rbc_mesh_coex_stats_t* p_stats);
+
+/**
+* @brief Handler for the Softdevice radio notifications, to fit the timeslots
+*   around the Softdevice's own radio events.
+*
+* @details Pass to ble_radio_notification_init(), with the
+*   NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH type. While the Softdevice radio
+*   events come at a regular interval, as in a connection, each timeslot is
+*   requested no longer than the gap between two events, down to
+*   RBC_MESH_COEX_SLOT_MIN_US. Without the notifications, timeslots are
+*   requested with their full length, and often blocked in a connection.
+*
+* @param[in] radio_active Whether a Softdevice radio event is about to start,
+*   or has ended.
+*/
+void rbc_mesh_radio_notification_handler(bool radio_active);
+
+/**
+* @brief Tell the framework that the application has Softdevice flash
+*   operations pending, like pstorage operations.
+*
+* @details While set, timeslots are not extended, and each is followed by a
+*   gap of RBC_MESH_COEX_FLASH_GAP_US for the Softdevice to schedule the flash
+*   operations in. Set again when the operations have ended, for example from
+*   the NRF_EVT_FLASH_OPERATION_SUCCESS event.
+*
+* @param[in] pending Whether flash operations are pending.
+*/
+void rbc_mesh_sd_flash_pending_set(bool pending);
+
+/**
+* @brief Start sending link survey packets.
+*
+* @details Every interval, with some random jitter, the node sends a survey
+*   packet with a sequence number on each of its transmit channels, on the
+*   mesh access address. Every node records the survey packets it hears, in a
+*   table of packet error rate and RSSI per neighbour and channel, whether it
+*   sends survey packets itself or not. The table is read with
+*   @ref rbc_mesh_survey_entry_get, or over the serial interface, to choose
+*   the channel, the TX power and the placement of the nodes. The survey
+*   packets take air time from the mesh, so stop the survey when done.
+*
+* @param[in] interval_ms Average time between two survey packets, between
+*   100 and 60000.
+*
+* @return NRF_SUCCESS the survey was started, or its interval changed.
+* @return NRF_ERROR_INVALID_PARAM the interval is out of range.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_survey_start(uint32_t interval_ms);
+
+/**
+* @brief Stop sending link survey packets. Survey packets from the
+*   neighbours are still recorded.
+*
+* @return NRF_SUCCESS the survey was stopped.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_survey_stop(void);
+
+/**
+* @brief Get an entry of the link survey table.
+*
+* @param[in] index Index of the entry, from 0.
+* @param[out] p_entry Structure to fill.
+*
+* @return NRF_SUCCESS the entry was fetched.
+* @return NRF_ERROR_NULL p_entry is NULL.
+* @return NRF_ERROR_NOT_FOUND there are no more entries.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_survey_entry_get(uint8_t index, rbc_mesh_survey_entry_t* p_entry);
+
+/**
+* @brief Clear the link survey table, to start a new measurement.
+*
+* @return NRF_SUCCESS the table was cleared.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_survey_reset(void);
+
+/**
+* @brief Start sending value digests.
+*
+* @details Every interval, with some random jitter, the node sends a digest
+*   packet, a hash of the handles and versions of all the values it
+*   retransmits. A neighbour holding the same values suppresses its own
+*   retransmissions of them for the rest of their current trickle intervals,
+*   so a stable mesh mostly exchanges digests instead of values. When the
+*   digests differ, the neighbours exchange digests of smaller and smaller
+*   handle ranges until the differing values are found, and retransmit those
+*   right away. Digests are always processed, whether the node sends them or
+*   not, but only nodes that send them take part in finding differences. The
+*   interval should be shorter than half the trickle intervals of the values
+*   to suppress, or the digests will come too late.
+*
+* @param[in] interval_ms Average time between two digests, between 100 and
+*   60000.
+*
+* @return NRF_SUCCESS the digests were started, or their interval changed.
+* @return NRF_ERROR_INVALID_PARAM the interval is out of range.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_digest_start(uint32_t interval_ms);
+
+/**
+* @brief Stop sending value digests. Digests from the neighbours still
+*   suppress retransmissions of matching values.
+*
+* @return NRF_SUCCESS the digests were stopped.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_digest_stop(void);
+
+/**
+* @brief Get an entry of the neighbour table.
+*
+* @details Every node keeps a table of the nodes it hears directly, with
+*   their average RSSI and the time of their last packet, from all mesh
+*   packets received.
+*
+* @param[in] index Index of the entry, from 0.
+* @param[out] p_neighbour Structure to fill.
+*
+* @return NRF_SUCCESS the entry was fetched.
+* @return NRF_ERROR_NULL p_neighbour is NULL.
+* @return NRF_ERROR_NOT_FOUND there are no more entries.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_neighbour_get(uint8_t index, rbc_mesh_neighbour_t* p_neighbour);
+
+/**
+* @brief Enable or disable adaptive TX power.
+*
+* @details While enabled, the neighbour table is evaluated every
+*   RBC_MESH_NEIGHBOUR_ADAPT_INTERVAL_MS. The TX power is lowered one level
+*   when at least RBC_MESH_NEIGHBOUR_DENSE_COUNT neighbours are heard stronger
+*   than RBC_MESH_NEIGHBOUR_STRONG_RSSI, and raised one level when fewer than
+*   RBC_MESH_NEIGHBOUR_SPARSE_COUNT neighbours are active. The TX power stays
+*   between RBC_MESH_NEIGHBOUR_TX_POWER_MIN and the power set with
+*   @ref rbc_mesh_tx_power_set. Disabling it restores the power set with
+*   @ref rbc_mesh_tx_power_set.
+*
+* @param[in] enabled Whether to adapt the TX power to the neighbours.
+*
+* @return NRF_SUCCESS the setting was changed.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_tx_power_adaptive_set(bool enabled);
+
+/**
+* @brief Get the TX power in use for mesh packets, which differs from the one
+*   set with @ref rbc_mesh_tx_power_set while adaptive TX power is enabled.
+*
+* @param[out] p_tx_power Current TX power.
+*
+* @return NRF_SUCCESS the TX power was fetched.
+* @return NRF_ERROR_NULL p_tx_power is NULL.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_tx_power_get(rbc_mesh_txpower_t* p_tx_power);
+
+/**
+* @brief Set TX power for mesh packets. The highest TX power used while
+*   adaptive TX power is enabled, see @ref rbc_mesh_tx_power_adaptive_set.
 *
 * @param[in] tx_power TX power from @rbc_mesh_txpower_t enum.
 */
@@ -557,6 +2313,8 @@ void rbc_mesh_sd_evt_handler(uint32_t evt);
 * @return NRF_SUCCESS An event was successfully popped and copied into the
 *   p_evt-parameter.
 * @return NRF_ERROR_NOT_FOUND No events ready to be pulled.
+* @return NRF_ERROR_BUSY An event acquired with rbc_mesh_event_acquire hasn't
+*   been released.
 * @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
 */
 uint32_t rbc_mesh_event_get(rbc_mesh_event_t* p_evt);
@@ -578,6 +2336,26 @@ uint32_t rbc_mesh_event_get(rbc_mesh_event_t* p_evt);
 */
 uint32_t rbc_mesh_event_peek(rbc_mesh_event_t* p_evt);
 
+/**
+* @brief Get the next event from the mesh without copying it.
+*
+* @details Hands out the event where it lies in the event queue, together
+*   with the pool reference to the packet its data points into. Neither the
+*   event nor its data is copied on the way from the radio to the
+*   application. The event stays valid, and blocks the next event, until it
+*   is passed to @ref rbc_mesh_event_release. Only one event can be acquired
+*   at a time, and @ref rbc_mesh_event_get is unavailable while one is held.
+*
+* @param[out] pp_evt Set to point at the event.
+*
+* @return NRF_SUCCESS An event was handed out.
+* @return NRF_ERROR_NOT_FOUND No events ready to be pulled.
+* @return NRF_ERROR_NULL The pp_evt parameter is NULL.
+* @return NRF_ERROR_BUSY The previously acquired event hasn't been released.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_event_acquire(rbc_mesh_event_t** pp_evt);
+
 /**
 * @brief Free the memory associated with the given mesh event.
 *   Provides the same functionality as @rbc_mesh_packet_release, but hides the
@@ -590,10 +2368,43 @@ uint32_t rbc_mesh_event_peek(rbc_mesh_event_t* p_evt);
 *   use. Failure to do so will result in a NO_MEM error when the framework runs
 *   out of available packets in the packet pool.
 *
-* @param[in] p_evt Pointer to a mesh event fetched with rbc_mesh_event_get.
+* @param[in] p_evt Pointer to a mesh event fetched with rbc_mesh_event_get, or
+*   acquired with rbc_mesh_event_acquire.
 */
 void rbc_mesh_event_release(rbc_mesh_event_t* p_evt);
 
+/**
+* @brief Set a function to deliver events to as they happen, instead of
+*   through the event queue. The function is called from the framework's
+*   event dispatcher, in APP_LOW priority, the moment a value is received or
+*   transmitted, without waiting for the application's main loop to wake up
+*   and poll @ref rbc_mesh_event_get. Events it returns false for, and
+*   events raised outside the dispatcher, such as the ones for GATT writes,
+*   go to the event queue as before, so the queue is only needed for
+*   deferred work. Events delivered directly may overtake queued ones.
+*
+* @warning The mesh is stopped while the function runs, and it must return
+*   quickly. It may:
+*   - read values with @ref rbc_mesh_value_get, @ref rbc_mesh_value_read or
+*     @ref rbc_mesh_value_peek,
+*   - set values with @ref rbc_mesh_value_set or
+*     @ref rbc_mesh_value_set_bulk,
+*   - change handle settings, such as @ref rbc_mesh_persistence_set and
+*     @ref rbc_mesh_tx_event_set,
+*   - drive GPIOs, trigger peripherals and notify the application's own
+*     tasks.
+*   It must not wait for anything, call @ref rbc_mesh_init,
+*   @ref rbc_mesh_start or @ref rbc_mesh_stop, or keep pointers to the event
+*   data after returning. Events raised while the function runs are queued.
+*
+* @param[in] event_cb Function to deliver events to, or NULL to queue all
+*   events.
+*
+* @return NRF_SUCCESS The function was set.
+* @return NRF_ERROR_INVALID_STATE the framework has not been initialized.
+*/
+uint32_t rbc_mesh_event_cb_set(rbc_mesh_event_cb_t event_cb);
+
 /**
 * @brief Set packet peek function pointer. Every received packet will be
 *   passed to the peek function before being processed by the stack -
@@ -611,5 +2422,62 @@ void rbc_mesh_event_release(rbc_mesh_event_t* p_evt);
 */
 void rbc_mesh_packet_peek_cb_set(rbc_mesh_packet_peek_cb_t packet_peek_cb);
 
+/**
+* @brief Only process packets from the given advertiser addresses. Packets
+*   from other addresses are dropped in the radio interrupt, and are not passed
+*   to the packet peek function.
+*
+* @note Advertisements without mesh data are always dropped in the radio
+*   interrupt, unless a packet peek function is set.
+* @note All nodes the device should hear mesh values from must be in the
+*   whitelist, not only the ones originating the values.
+*
+* @param[in] p_addrs Array of advertiser addresses to accept. Copied by the
+*   framework.
+* @param[in] count Number of addresses in the array, at most
+*   RBC_MESH_RX_WHITELIST_SIZE. Set to 0 to accept all addresses.
+*
+* @return NRF_SUCCESS The whitelist was updated.
+* @return NRF_ERROR_NULL p_addrs is NULL and count is not 0.
+* @return NRF_ERROR_INVALID_LENGTH count is above RBC_MESH_RX_WHITELIST_SIZE.
+*/
+uint32_t rbc_mesh_rx_whitelist_set(const ble_gap_addr_t* p_addrs, uint8_t count);
+
+/**
+* @brief Set the network key values are authenticated with, when built with
+*   MESH_AUTH. Every value the device originates is signed with the key and
+*   the next sequence number on its first transmission, and received values
+*   that fail the check are dropped. Values aren't transmitted until a key
+*   is set.
+*
+* @note The sequence number must never repeat for the same key and device,
+*   or neighbours will drop the values as replays. Store the value returned
+*   by @ref rbc_mesh_auth_seq_get before power loss, or start every boot
+*   from a boot counter shifted above the number of values sent per boot.
+*
+* @param[in] p_key 16 byte AES key, shared by all devices in the mesh. Copied
+*   by the framework.
+* @param[in] seq_start First sequence number to sign with. Must be above 0.
+*
+* @return NRF_SUCCESS The key was set.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+* @return NRF_ERROR_NULL p_key is NULL.
+* @return NRF_ERROR_INVALID_PARAM seq_start is 0.
+* @return NRF_ERROR_NOT_SUPPORTED The framework was built without MESH_AUTH.
+*/
+uint32_t rbc_mesh_auth_key_set(const uint8_t* p_key, uint32_t seq_start);
+
+/**
+* @brief Get the next sequence number the device will sign a value with.
+*
+* @param[out] p_seq The next sequence number.
+*
+* @return NRF_SUCCESS The sequence number was read.
+* @return NRF_ERROR_INVALID_STATE The framework has not been initialized.
+* @return NRF_ERROR_NULL p_seq is NULL.
+* @return NRF_ERROR_NOT_SUPPORTED The framework was built without MESH_AUTH.
+*/
+uint32_t rbc_mesh_auth_seq_get(uint32_t* p_seq);
+
 #endif /* _RBC_MESH_H__ */
 
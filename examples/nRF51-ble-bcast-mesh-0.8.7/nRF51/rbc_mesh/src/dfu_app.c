@@ -63,7 +63,11 @@ extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_event);
 
 #define DFU_TX_SLOTS                (8)         /**< Number of concurrent transmits available. */
 #define DFU_TX_INTERVAL_US          (100000)    /**< Time between transmits on regular interval, and base-interval on exponential. */
+#define DFU_TX_RATE_TRANSFERS       (2)         /**< Number of transfers to keep separate rate limits for. */
+#define DFU_TX_RATE_BURST           (4)         /**< Number of transmits a transfer may do back to back. */
+#define DFU_TX_RATE_INTERVAL_US     (20000)     /**< Time to earn a new transmit, per transfer. */
 #define DFU_TX_START_DELAY_MASK_US  (0xFFFF)    /**< Must be power of two. */
+#define DFU_TX_TRICKLE_DOUBLINGS    (8)         /**< Number of times the trickle interval doubles from DFU_TX_INTERVAL_US. */
 #define DFU_TX_TIMER_MARGIN_US      (1000)      /**< Time margin for a timeout to be considered instant. */
 
 #define TIMER_REQ_TIMEOUT           (100000000) /**< Time to wait before giving up on an ongoing request. */
@@ -73,15 +77,36 @@ extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_event);
 * Local typedefs
 *****************************************************************************/
 
+/** Transmit priority, lower values go first. */
+typedef enum
+{
+    DFU_TX_PRIO_RSP,        /**< Data someone asked for. */
+    DFU_TX_PRIO_REQ,        /**< Requests for data we're missing. */
+    DFU_TX_PRIO_DATA,       /**< Data being relayed. */
+    DFU_TX_PRIO_BEACON,     /**< FWID and state beacons. */
+    DFU_TX_PRIO_COUNT
+} dfu_tx_prio_t;
+
 typedef struct
 {
     mesh_packet_t* p_packet;
     uint32_t order_time;
+    uint32_t transaction_id;
     bl_radio_interval_type_t interval_type;
     uint8_t repeats;
     uint8_t tx_count;
+    uint8_t prio;
+    bool has_transaction;
 } dfu_tx_t;
 
+/** Token bucket limiting the airtime of a single transfer. */
+typedef struct
+{
+    uint32_t transaction_id;
+    uint32_t refill_time;
+    uint8_t tokens;
+} dfu_tx_rate_t;
+
 /*****************************************************************************
 * Static globals
 *****************************************************************************/
@@ -90,25 +115,37 @@ static timer_event_t                m_timer_evt;                    /**< Timer e
 static timer_event_t                m_tx_timer_evt;                 /**< TX event for scheduler. */
 static bool                         m_tx_scheduled;                 /**< Whether the TX event is scheduled. */
 static dfu_tx_t                     m_tx_slots[DFU_TX_SLOTS];       /**< TX slots for concurrent transmits. */
-static prng_t                       m_prng;                         /**< PRNG for time delays. */
+static dfu_tx_rate_t                m_tx_rate[DFU_TX_RATE_TRANSFERS];   /**< Rate limits for the most recent transfers. */
 static tc_tx_config_t               m_tx_config;
-static fwid_t*                      mp_curr_fwid;
 static dfu_transfer_state_t         m_transfer_state;               /**< State of the ongoing dfu transfer. */
 /*****************************************************************************
 * Static functions
 *****************************************************************************/
 static uint32_t get_curr_fwid(dfu_type_t type, fwid_union_t* p_fwid)
 {
+    /* Look the entry up every time, the bootloader may move it when
+       compacting the info page. The lookup is served from its RAM index. */
+    bl_cmd_t fwid_cmd;
+    fwid_cmd.type = BL_CMD_TYPE_INFO_GET;
+    fwid_cmd.params.info.get.type = BL_INFO_TYPE_VERSION;
+    fwid_cmd.params.info.get.p_entry = NULL;
+    uint32_t error_code = dfu_cmd_send(&fwid_cmd);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    fwid_t* p_curr_fwid = &fwid_cmd.params.info.get.p_entry->version;
+
     switch (type)
     {
         case DFU_TYPE_SD:
-            p_fwid->sd = mp_curr_fwid->sd;
+            p_fwid->sd = p_curr_fwid->sd;
             break;
         case DFU_TYPE_BOOTLOADER:
-            p_fwid->bootloader = mp_curr_fwid->bootloader;
+            p_fwid->bootloader = p_curr_fwid->bootloader;
             break;
         case DFU_TYPE_APP:
-            p_fwid->app = mp_curr_fwid->app;
+            p_fwid->app = p_curr_fwid->app;
             break;
         default:
             return NRF_ERROR_NOT_SUPPORTED;
@@ -122,6 +159,11 @@ static uint32_t next_tx_timeout(dfu_tx_t* p_tx)
     {
         return (p_tx->order_time + DFU_TX_INTERVAL_US * ((1 << (p_tx->tx_count)) - 1));
     }
+    else if (p_tx->interval_type == BL_RADIO_INTERVAL_TYPE_TRICKLE)
+    {
+        /* order time is the previous transmit, see tx_timeout() */
+        return (p_tx->tx_count == 0 ? p_tx->order_time : p_tx->order_time + (DFU_TX_INTERVAL_US << (p_tx->tx_count - 1)));
+    }
     else
     {
         return (p_tx->order_time + DFU_TX_INTERVAL_US * p_tx->tx_count);
@@ -145,21 +187,131 @@ static void interrupts_disable(void)
     }
 }
 
+static dfu_tx_prio_t tx_prio_get(dfu_packet_t* p_packet)
+{
+    switch (p_packet->packet_type)
+    {
+        case DFU_PACKET_TYPE_DATA_RSP:
+            return DFU_TX_PRIO_RSP;
+        case DFU_PACKET_TYPE_DATA_REQ:
+        case DFU_PACKET_TYPE_DATA_REQ_BITMAP:
+            return DFU_TX_PRIO_REQ;
+        case DFU_PACKET_TYPE_DATA:
+        case DFU_PACKET_TYPE_DATA_PARITY:
+        case DFU_PACKET_TYPE_DATA_COPY:
+            return DFU_TX_PRIO_DATA;
+        default:
+            return DFU_TX_PRIO_BEACON;
+    }
+}
+
+/** Get the rate limit of the given transfer, and refill its tokens. */
+static dfu_tx_rate_t* tx_rate_get(uint32_t transaction_id, uint32_t timestamp)
+{
+    dfu_tx_rate_t* p_rate = NULL;
+    for (uint32_t i = 0; i < DFU_TX_RATE_TRANSFERS; ++i)
+    {
+        if (m_tx_rate[i].transaction_id == transaction_id)
+        {
+            p_rate = &m_tx_rate[i];
+            break;
+        }
+        /* replace the one that's been transmitting the least lately */
+        if (p_rate == NULL || m_tx_rate[i].tokens > p_rate->tokens)
+        {
+            p_rate = &m_tx_rate[i];
+        }
+    }
+
+    if (p_rate->transaction_id != transaction_id)
+    {
+        p_rate->transaction_id = transaction_id;
+        p_rate->tokens = DFU_TX_RATE_BURST;
+        p_rate->refill_time = timestamp;
+    }
+
+    while (p_rate->tokens < DFU_TX_RATE_BURST &&
+           TIMER_OLDER_THAN(p_rate->refill_time + DFU_TX_RATE_INTERVAL_US, timestamp + 1))
+    {
+        p_rate->tokens++;
+        p_rate->refill_time += DFU_TX_RATE_INTERVAL_US;
+    }
+    if (p_rate->tokens == DFU_TX_RATE_BURST)
+    {
+        p_rate->refill_time = timestamp;
+    }
+    return p_rate;
+}
+
+/** Make room in the packet pool for a more important packet, by dropping the
+ * relayed data packet that has been sent the most. Relayed data is resent on
+ * request, while beacons are only set up once. */
+static bool tx_slot_evict(uint8_t prio)
+{
+    dfu_tx_t* p_victim = NULL;
+    for (uint32_t i = 0; i < DFU_TX_SLOTS; ++i)
+    {
+        if (m_tx_slots[i].p_packet &&
+            m_tx_slots[i].prio == DFU_TX_PRIO_DATA &&
+            m_tx_slots[i].prio > prio &&
+            (p_victim == NULL || m_tx_slots[i].tx_count > p_victim->tx_count))
+        {
+            p_victim = &m_tx_slots[i];
+        }
+    }
+    if (p_victim == NULL)
+    {
+        return false;
+    }
+    mesh_packet_t* p_packet = p_victim->p_packet;
+    memset(p_victim, 0, sizeof(dfu_tx_t));
+    mesh_packet_ref_count_dec(p_packet);
+    return true;
+}
+
 static void tx_timeout(uint32_t timestamp, void* p_context)
 {
     uint32_t next_timeout = timestamp + (UINT32_MAX / 2);
-    for (uint32_t i = 0; i < DFU_TX_SLOTS; ++i)
+    /* Serve the packets that unblock other devices first, and let each
+       transfer only use its share of the airtime. */
+    for (uint32_t prio = 0; prio < DFU_TX_PRIO_COUNT; ++prio)
     {
-        if (m_tx_slots[i].p_packet)
+        for (uint32_t i = 0; i < DFU_TX_SLOTS; ++i)
         {
+            if (m_tx_slots[i].p_packet == NULL || m_tx_slots[i].prio != prio)
+            {
+                continue;
+            }
             uint32_t timeout = next_tx_timeout(&m_tx_slots[i]);
             if (TIMER_OLDER_THAN(timeout, (timestamp + DFU_TX_TIMER_MARGIN_US)))
             {
-                if (tc_tx(m_tx_slots[i].p_packet, &m_tx_config) == NRF_SUCCESS)
+                dfu_tx_rate_t* p_rate = NULL;
+                if (m_tx_slots[i].has_transaction)
+                {
+                    p_rate = tx_rate_get(m_tx_slots[i].transaction_id, timestamp);
+                }
+                if (p_rate != NULL && p_rate->tokens == 0)
+                {
+                    /* try again when the transfer has earned a new token */
+                    timeout = p_rate->refill_time + DFU_TX_RATE_INTERVAL_US;
+                }
+                else if (tc_tx(m_tx_slots[i].p_packet, &m_tx_config) == NRF_SUCCESS)
                 {
+                    if (p_rate != NULL)
+                    {
+                        p_rate->tokens--;
+                    }
                     m_tx_slots[i].tx_count++;
 
-                    if (m_tx_slots[i].tx_count == TX_REPEATS_INF &&
+                    if (m_tx_slots[i].interval_type == BL_RADIO_INTERVAL_TYPE_TRICKLE)
+                    {
+                        m_tx_slots[i].order_time = timeout;
+                        if (m_tx_slots[i].tx_count > DFU_TX_TRICKLE_DOUBLINGS + 1)
+                        {
+                            m_tx_slots[i].tx_count = DFU_TX_TRICKLE_DOUBLINGS + 1;
+                        }
+                    }
+                    else if (m_tx_slots[i].tx_count == TX_REPEATS_INF &&
                         m_tx_slots[i].repeats  == TX_REPEATS_INF)
                     {
                         m_tx_slots[i].order_time = timeout;
@@ -169,6 +321,7 @@ static void tx_timeout(uint32_t timestamp, void* p_context)
                     {
                         mesh_packet_ref_count_dec(m_tx_slots[i].p_packet);
                         memset(&m_tx_slots[i], 0, sizeof(dfu_tx_t));
+                        continue;
                     }
                     timeout = next_tx_timeout(&m_tx_slots[i]);
                 }
@@ -252,7 +405,8 @@ uint32_t dfu_init(void)
         return NRF_ERROR_NOT_SUPPORTED;
     }
 
-    rand_prng_seed(&m_prng);
+    rand_init();
+    memset(m_tx_rate, 0, sizeof(m_tx_rate));
 
     m_timer_evt.cb           = timer_timeout;
     m_timer_evt.interval     = 0;
@@ -304,8 +458,6 @@ uint32_t dfu_init(void)
         return error_code;
     }
 
-    mp_curr_fwid = &fwid_cmd.params.info.get.p_entry->version;
-
     bl_cmd_t enable_cmd =
     {
         .type = BL_CMD_TYPE_ENABLE,
@@ -362,7 +514,8 @@ uint32_t dfu_rx(dfu_packet_t* p_packet, uint32_t length)
     {
         .type = BL_CMD_TYPE_RX,
         .params.rx.p_dfu_packet = p_packet,
-        .params.rx.length = length
+        .params.rx.length = length,
+        .params.rx.from_serial = true
     };
 
     return dfu_cmd_send(&rx_cmd);
@@ -652,7 +805,13 @@ uint32_t dfu_evt_handler(bl_evt_t* p_evt)
                 m_tx_slots[p_evt->params.tx.radio.tx_slot].p_packet = NULL;
                 mesh_packet_ref_count_dec(p_packet);
             }
-            if (mesh_packet_acquire(&m_tx_slots[p_evt->params.tx.radio.tx_slot].p_packet))
+            uint8_t prio = tx_prio_get(p_evt->params.tx.radio.p_dfu_packet);
+            bool acquired = mesh_packet_acquire(&m_tx_slots[p_evt->params.tx.radio.tx_slot].p_packet);
+            if (!acquired && tx_slot_evict(prio))
+            {
+                acquired = mesh_packet_acquire(&m_tx_slots[p_evt->params.tx.radio.tx_slot].p_packet);
+            }
+            if (acquired)
             {
                 uint32_t time_now = timer_now();
                 /* build packet */
@@ -669,7 +828,15 @@ uint32_t dfu_evt_handler(bl_evt_t* p_evt)
                 m_tx_slots[p_evt->params.tx.radio.tx_slot].interval_type = p_evt->params.tx.radio.interval_type;
                 m_tx_slots[p_evt->params.tx.radio.tx_slot].repeats = p_evt->params.tx.radio.tx_count;
                 m_tx_slots[p_evt->params.tx.radio.tx_slot].tx_count = 0;
-                m_tx_slots[p_evt->params.tx.radio.tx_slot].order_time = time_now + DFU_TX_TIMER_MARGIN_US + (rand_prng_get(&m_prng) & (DFU_TX_START_DELAY_MASK_US));
+                m_tx_slots[p_evt->params.tx.radio.tx_slot].prio = prio;
+                /* all packets but the FWID beacon belong to a transfer */
+                m_tx_slots[p_evt->params.tx.radio.tx_slot].has_transaction =
+                    (p_evt->params.tx.radio.p_dfu_packet->packet_type != DFU_PACKET_TYPE_FWID);
+                m_tx_slots[p_evt->params.tx.radio.tx_slot].transaction_id =
+                    (p_evt->params.tx.radio.p_dfu_packet->packet_type == DFU_PACKET_TYPE_STATE) ?
+                    p_evt->params.tx.radio.p_dfu_packet->payload.state.transaction_id :
+                    p_evt->params.tx.radio.p_dfu_packet->payload.data.transaction_id;
+                m_tx_slots[p_evt->params.tx.radio.tx_slot].order_time = time_now + DFU_TX_TIMER_MARGIN_US + (rand_get() & (DFU_TX_START_DELAY_MASK_US));
 
                 /* Fire away */
                 if (!m_tx_scheduled || TIMER_DIFF(m_tx_slots[p_evt->params.tx.radio.tx_slot].order_time, time_now) < TIMER_DIFF(m_tx_timer_evt.timestamp, time_now))
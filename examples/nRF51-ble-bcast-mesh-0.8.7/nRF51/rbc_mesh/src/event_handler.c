@@ -37,6 +37,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "nrf_soc.h"
 #include "toolchain.h"
 #include "handle_storage.h"
+#include "mesh_trace.h"
+#include "mesh_watermark.h"
+#include "mesh_stats.h"
+#ifdef MESH_DISPATCH_TIMING
+#include "timebase.h"
+#endif
 #include <string.h>
 #include "rbc_mesh.h"
 
@@ -48,86 +54,61 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 static fifo_t g_async_evt_fifo;
 
 static async_event_t g_async_evt_fifo_buffer[RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH];
+static fifo_t g_async_evt_fifo_rx;
+
+static async_event_t g_async_evt_fifo_buffer_rx[RBC_MESH_INTERNAL_RX_EVENT_QUEUE_LENGTH];
 static fifo_t g_async_evt_fifo_ts;
 
 static async_event_t g_async_evt_fifo_buffer_ts[RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH];
+static volatile uint32_t g_async_evt_fifo_ts_flush_head; /* written in the timeslot context, flushed to by the dispatcher */
 static bool g_is_initialized;
 static uint32_t g_critical = 0;
+static bool g_is_dispatching;
 
 
-#if defined(WITH_ACK_MASTER)
-static uint32_t event_handler_counter[5] __attribute__((at(0x200031D0)))={0};
-#endif
-
-#if defined(WITHOUT_ACK_MASTER)
-static uint32_t event_handler_counter[5]__attribute__((at(0x200028B8)))={0};
-#endif
-
-#if defined(WITH_ACK_SLAVE)
-static uint32_t event_handler_counter[5] __attribute__((at(0x200028CC))) ={0};
-#endif
-
-#if defined(WITHOUT_ACK_SLAVE)
-static uint32_t event_handler_counter[5] __attribute__((at(0x200028B4)))={0};
-#endif
-
 /**
 * @brief execute asynchronous event, based on type
 */
 static void async_event_execute(async_event_t* p_evt)
 {
-
+    TRACE_ENTER(MESH_TRACE_SITE_ASYNC_EVT);
+    MESH_STATS_INC(dispatch_events);
+    g_is_dispatching = true;
     switch (p_evt->type)
     {
         case EVENT_TYPE_TIMER:
             CHECK_FP(p_evt->callback.timer.cb);
             p_evt->callback.timer.cb(p_evt->callback.timer.timestamp);
-        
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-		    event_handler_counter[0]++;
-            #endif
             break;
         case EVENT_TYPE_GENERIC:
             CHECK_FP(p_evt->callback.generic.cb);
             p_evt->callback.generic.cb(p_evt->callback.generic.p_context);
-        
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-		    event_handler_counter[1]++;
-            #endif
-        
             break;
         case EVENT_TYPE_PACKET:
             tc_packet_handler(p_evt->callback.packet.payload,
                               p_evt->callback.packet.crc,
                               p_evt->callback.packet.timestamp,
                               p_evt->callback.packet.rssi);
-        
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-		    event_handler_counter[2]++;
-            #endif
-        
             break;
         case EVENT_TYPE_SET_FLAG:
             handle_storage_flag_set(p_evt->callback.set_flag.handle,
                                     (handle_flag_t) p_evt->callback.set_flag.flag,
                                     p_evt->callback.set_flag.value);
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-			event_handler_counter[3]++;
-            #endif
-        
+            break;
+        case EVENT_TYPE_SET_QOS:
+            handle_storage_qos_set(p_evt->callback.set_qos.handle,
+                                   (rbc_mesh_qos_class_t) p_evt->callback.set_qos.qos_class);
             break;
         case EVENT_TYPE_TIMER_SCH:
             CHECK_FP(p_evt->callback.timer_sch.cb);
             p_evt->callback.timer_sch.cb(p_evt->callback.timer_sch.timestamp,
                                          p_evt->callback.timer_sch.p_context);
-        
-            #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)||defined(WITH_ACK_SLAVE)||defined(WITHOUT_ACK_SLAVE)
-		    event_handler_counter[4]++;
-            #endif
             break;
         default:
             break;
     }
+    g_is_dispatching = false;
+    TRACE_EXIT(MESH_TRACE_SITE_ASYNC_EVT);
 }
 
 static bool event_fifo_pop(fifo_t* evt_fifo)
@@ -145,20 +126,71 @@ static bool event_fifo_pop(fifo_t* evt_fifo)
     return false;
 }
 
+/** Execute the next event of an SPSC fifo in place. */
+static bool event_fifo_spsc_pop(fifo_t* evt_fifo)
+{
+    async_event_t* p_evt = (async_event_t*) fifo_spsc_pop_reserve(evt_fifo);
+    if (p_evt == NULL)
+    {
+        return false;
+    }
+    SET_PIN(PIN_SWI0);
+    async_event_execute(p_evt);
+    fifo_spsc_pop_release(evt_fifo);
+    CLEAR_PIN(PIN_SWI0);
+    return true;
+}
+
 /**
-* @brief Async event dispatcher, works in APP LOW
+* @brief Async event dispatcher, works in APP LOW. Each round executes up to
+*   a budget of events from each queue, in order of priority: received
+*   packets, timeslot-local timers, then everything else.
 */
 void QDEC_IRQHandler(void)
 {
+    WATERMARK_ENTER(MESH_WATERMARK_CONTEXT_EVENT);
+#ifdef MESH_DISPATCH_TIMING
+    /* Outside timeslots the timebase follows RTC0, and most rounds are
+       shorter than a tick. The rounds start at random points in the tick, so
+       the sum still comes out right on average. */
+    uint64_t dispatch_start = timebase_now();
+#endif
     while (true)
     {
         bool got_evt = false;
 
-        got_evt |= event_fifo_pop(&g_async_evt_fifo);
+        /* rx-fifo is only pushed from the radio callback, SPSC */
+        for (uint32_t i = 0; i < RBC_MESH_INTERNAL_RX_EVENT_BUDGET; ++i)
+        {
+            if (!event_fifo_spsc_pop(&g_async_evt_fifo_rx))
+            {
+                break;
+            }
+            got_evt = true;
+        }
 
         if (timeslot_is_in_ts()) /* in timeslot */
         {
-            got_evt |= event_fifo_pop(&g_async_evt_fifo_ts);
+            /* the ts-fifo is SPSC, only this side may drop elements */
+            fifo_spsc_flush_to(&g_async_evt_fifo_ts, g_async_evt_fifo_ts_flush_head);
+
+            for (uint32_t i = 0; i < RBC_MESH_INTERNAL_TIMER_EVENT_BUDGET; ++i)
+            {
+                if (!event_fifo_spsc_pop(&g_async_evt_fifo_ts))
+                {
+                    break;
+                }
+                got_evt = true;
+            }
+        }
+
+        for (uint32_t i = 0; i < RBC_MESH_INTERNAL_EVENT_BUDGET; ++i)
+        {
+            if (!event_fifo_pop(&g_async_evt_fifo))
+            {
+                break;
+            }
+            got_evt = true;
         }
 
         if (!got_evt)
@@ -166,6 +198,10 @@ void QDEC_IRQHandler(void)
             break;
         }
     }
+#ifdef MESH_DISPATCH_TIMING
+    MESH_STATS_ADD(dispatch_us, (uint32_t) (timebase_now() - dispatch_start));
+#endif
+    WATERMARK_EXIT(MESH_WATERMARK_CONTEXT_EVENT);
 }
 
 void event_handler_init(void)
@@ -183,12 +219,18 @@ void event_handler_init(void)
     g_async_evt_fifo.memcpy_fptr = NULL;
     fifo_init(&g_async_evt_fifo);
 
+    g_async_evt_fifo_rx.array_len = RBC_MESH_INTERNAL_RX_EVENT_QUEUE_LENGTH;
+    g_async_evt_fifo_rx.elem_array = g_async_evt_fifo_buffer_rx;
+    g_async_evt_fifo_rx.elem_size = sizeof(async_event_t);
+    g_async_evt_fifo_rx.memcpy_fptr = NULL;
+    fifo_init(&g_async_evt_fifo_rx);
  
     g_async_evt_fifo_ts.array_len = RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH; 
     g_async_evt_fifo_ts.elem_array = g_async_evt_fifo_buffer_ts;
     g_async_evt_fifo_ts.elem_size = sizeof(async_event_t);
     g_async_evt_fifo_ts.memcpy_fptr = NULL;
     fifo_init(&g_async_evt_fifo_ts);
+    g_async_evt_fifo_ts_flush_head = 0;
 
     NVIC_EnableIRQ(EVENT_HANDLER_IRQ);
 #ifdef NRF51
@@ -209,9 +251,12 @@ uint32_t event_handler_push(async_event_t* p_evt)
     fifo_t* p_fifo = NULL;
     switch (p_evt->type)
     {
-    case EVENT_TYPE_GENERIC:
     case EVENT_TYPE_PACKET:
+        p_fifo = &g_async_evt_fifo_rx;
+        break;
+    case EVENT_TYPE_GENERIC:
     case EVENT_TYPE_SET_FLAG:
+    case EVENT_TYPE_SET_QOS:
     case EVENT_TYPE_TIMER_SCH:
         p_fifo = &g_async_evt_fifo;
         break;
@@ -221,7 +266,16 @@ uint32_t event_handler_push(async_event_t* p_evt)
     default:
         return NRF_ERROR_INVALID_PARAM;
     }
-    uint32_t result = fifo_push(p_fifo, p_evt);
+    uint32_t result;
+    if (p_fifo != &g_async_evt_fifo)
+    {
+        /* packet and timer events are only pushed from the timeslot context */
+        result = fifo_spsc_push(p_fifo, p_evt);
+    }
+    else
+    {
+        result = fifo_push(p_fifo, p_evt);
+    }
     if (result != NRF_SUCCESS)
     {
         return result;
@@ -237,18 +291,30 @@ uint32_t event_handler_push(async_event_t* p_evt)
 
 void event_handler_on_ts_end(void)
 {
-    fifo_flush(&g_async_evt_fifo_ts);
+    /* leave the actual flush to the dispatcher, as the fifo is SPSC */
+    g_async_evt_fifo_ts_flush_head = fifo_spsc_head_get(&g_async_evt_fifo_ts);
 }
 
 void event_handler_on_ts_begin(void)
 {
     if (!fifo_is_empty(&g_async_evt_fifo) ||
+        !fifo_is_empty(&g_async_evt_fifo_rx) ||
         !fifo_is_empty(&g_async_evt_fifo_ts))
     {
         NVIC_SetPendingIRQ(EVENT_HANDLER_IRQ);
     }
 }
 
+bool event_handler_is_dispatching(void)
+{
+    return g_is_dispatching;
+}
+
+uint32_t event_handler_queue_len_get(void)
+{
+    return fifo_get_len(&g_async_evt_fifo) + fifo_get_len(&g_async_evt_fifo_rx);
+}
+
 void event_handler_critical_section_begin(void)
 {
     uint32_t was_masked;
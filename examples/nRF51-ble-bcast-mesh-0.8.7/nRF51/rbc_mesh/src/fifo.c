@@ -29,6 +29,7 @@
  ************************************************************************************/
 #include "fifo.h"
 #include "rbc_mesh_common.h"
+#include "mesh_watermark.h"
 #include "nrf_error.h"
 #include <string.h>
 
@@ -38,6 +39,20 @@
 #define FIFO_ELEM_AT(p_fifo, index) ((uint8_t*) ((uint8_t*) p_fifo->elem_array) + (p_fifo->elem_size) * (index))
 #define FIFO_IS_FULL(p_fifo) (p_fifo->tail + p_fifo->array_len == p_fifo->head)
 #define FIFO_IS_EMPTY(p_fifo) (p_fifo->tail == p_fifo->head)
+
+/* In SPSC mode, the indices are written by the other side without locking. */
+#define FIFO_HEAD_GET(p_fifo) (*((volatile uint32_t*) &p_fifo->head))
+#define FIFO_TAIL_GET(p_fifo) (*((volatile uint32_t*) &p_fifo->tail))
+
+#ifdef MESH_WATERMARK
+/* called by the producer after a push, an approximation in SPSC mode */
+#define FIFO_PEAK_UPDATE(p_fifo) do {\
+    uint32_t len = FIFO_HEAD_GET(p_fifo) - FIFO_TAIL_GET(p_fifo);\
+    if (len > p_fifo->peak_len) p_fifo->peak_len = len;\
+    } while (0)
+#else
+#define FIFO_PEAK_UPDATE(p_fifo)
+#endif
 /*****************************************************************************
  * Interface functions
  *****************************************************************************/
@@ -50,6 +65,8 @@ void fifo_init(fifo_t* p_fifo)
 
     p_fifo->head = 0;
     p_fifo->tail = 0;
+    p_fifo->peak_len = 0;
+    mesh_watermark_fifo_register(p_fifo);
 }
 
 uint32_t fifo_push(fifo_t* p_fifo, const void* p_elem)
@@ -74,6 +91,7 @@ uint32_t fifo_push(fifo_t* p_fifo, const void* p_elem)
         memcpy(p_dest, p_elem, p_fifo->elem_size);
 
     ++p_fifo->head;
+    FIFO_PEAK_UPDATE(p_fifo);
     _ENABLE_IRQS(was_masked);
     return NRF_SUCCESS;
 }
@@ -138,6 +156,37 @@ uint32_t fifo_peek(fifo_t* p_fifo, void* p_elem)
     return fifo_peek_at(p_fifo, p_elem, 0);
 }
 
+void* fifo_peek_ptr(fifo_t* p_fifo)
+{
+    void* p_elem = NULL;
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (!FIFO_IS_EMPTY(p_fifo))
+    {
+        p_elem = FIFO_ELEM_AT(p_fifo, p_fifo->tail & (p_fifo->array_len - 1));
+    }
+    _ENABLE_IRQS(was_masked);
+    return p_elem;
+}
+
+void* fifo_peek_ptr_at(fifo_t* p_fifo, uint32_t elem)
+{
+    if (fifo_get_len(p_fifo) <= elem)
+    {
+        return NULL;
+    }
+    return FIFO_ELEM_AT(p_fifo, (p_fifo->tail + elem) & (p_fifo->array_len - 1));
+}
+
+void* fifo_peek_newest_ptr(fifo_t* p_fifo)
+{
+    if (FIFO_IS_EMPTY(p_fifo))
+    {
+        return NULL;
+    }
+    return FIFO_ELEM_AT(p_fifo, (p_fifo->head - 1) & (p_fifo->array_len - 1));
+}
+
 void fifo_flush(fifo_t* p_fifo)
 {
     p_fifo->tail = p_fifo->head;
@@ -157,3 +206,103 @@ bool fifo_is_empty(fifo_t* p_fifo)
 {
     return FIFO_IS_EMPTY(p_fifo);
 }
+
+void* fifo_spsc_push_reserve(fifo_t* p_fifo)
+{
+    uint32_t head = p_fifo->head; /* only written by us */
+    if (head - FIFO_TAIL_GET(p_fifo) >= p_fifo->array_len)
+    {
+        return NULL;
+    }
+    /* don't let the slot writes go ahead of the tail read */
+    __DMB();
+    return FIFO_ELEM_AT(p_fifo, head & (p_fifo->array_len - 1));
+}
+
+void fifo_spsc_push_commit(fifo_t* p_fifo)
+{
+    /* the element must be complete before the consumer can see it */
+    __DMB();
+    FIFO_HEAD_GET(p_fifo) = p_fifo->head + 1;
+    FIFO_PEAK_UPDATE(p_fifo);
+}
+
+uint32_t fifo_spsc_push(fifo_t* p_fifo, const void* p_elem)
+{
+    if (p_elem == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    void* p_dest = fifo_spsc_push_reserve(p_fifo);
+    if (p_dest == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    if (p_fifo->memcpy_fptr)
+        p_fifo->memcpy_fptr(p_dest, p_elem);
+    else
+        memcpy(p_dest, p_elem, p_fifo->elem_size);
+
+    fifo_spsc_push_commit(p_fifo);
+    return NRF_SUCCESS;
+}
+
+void* fifo_spsc_pop_reserve(fifo_t* p_fifo)
+{
+    uint32_t tail = p_fifo->tail; /* only written by us */
+    if (FIFO_HEAD_GET(p_fifo) == tail)
+    {
+        return NULL;
+    }
+    /* don't read the element before we've seen the head that published it */
+    __DMB();
+    return FIFO_ELEM_AT(p_fifo, tail & (p_fifo->array_len - 1));
+}
+
+void fifo_spsc_pop_release(fifo_t* p_fifo)
+{
+    /* the element must be read out before the producer can reuse the slot */
+    __DMB();
+    FIFO_TAIL_GET(p_fifo) = p_fifo->tail + 1;
+}
+
+uint32_t fifo_spsc_pop(fifo_t* p_fifo, void* p_elem)
+{
+    void* p_src = fifo_spsc_pop_reserve(p_fifo);
+    if (p_src == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (p_elem != NULL)
+    {
+        if (p_fifo->memcpy_fptr)
+        {
+            p_fifo->memcpy_fptr(p_elem, p_src);
+        }
+        else
+        {
+            memcpy(p_elem, p_src, p_fifo->elem_size);
+        }
+    }
+
+    fifo_spsc_pop_release(p_fifo);
+    return NRF_SUCCESS;
+}
+
+uint32_t fifo_spsc_head_get(fifo_t* p_fifo)
+{
+    return FIFO_HEAD_GET(p_fifo);
+}
+
+void fifo_spsc_flush_to(fifo_t* p_fifo, uint32_t head)
+{
+    /* only move forward, the tail may already be past the given head */
+    if ((int32_t) (head - p_fifo->tail) > 0)
+    {
+        __DMB();
+        FIFO_TAIL_GET(p_fifo) = head;
+    }
+}
@@ -37,20 +37,121 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "fifo.h"
 #include "rbc_mesh_common.h"
 #include "timer.h"
+#include "mesh_persist.h"
+#include "mesh_retain.h"
+#include "mesh_stats.h"
 #include "app_error.h"
 
 #define MESH_TRICKLE_I_MAX              (2048)
 #define MESH_TRICKLE_K                  (3)
 
+#define MIN_INTERVAL_IS_VALID(us)       ((us) >= RBC_MESH_INTERVAL_MIN_MIN_MS * 1000 && \
+                                         (us) <= RBC_MESH_INTERVAL_MIN_MAX_MS * 1000)
+
+#if (RBC_MESH_QOS_CLASS__COUNT > TRICKLE_PARAM_SETS)
+    #error "Not enough trickle parameter sets for all QoS classes"
+#endif
+
 
 #define HANDLE_CACHE_ENTRY_INVALID      (RBC_MESH_HANDLE_CACHE_ENTRIES)
 #define DATA_CACHE_ENTRY_INVALID        (RBC_MESH_DATA_CACHE_ENTRIES)
 
+#if RBC_MESH_NOINIT_BUFFERS
+    #define HANDLE_CACHE_SECTION        _NOINIT /* every field is set in handle_storage_init */
+#else
+    #define HANDLE_CACHE_SECTION
+#endif
+
+#if (RBC_MESH_CACHE_POLICY == RBC_MESH_CACHE_POLICY_2Q)
+    /* the protected flag takes a bit from the data entry field */
+    #define DATA_ENTRY_BITS             (12)
+    #define HANDLE_ENTRY_PROTECTED(index)   (m_handle_cache[index].protected)
+    #define CACHE_VICTIM_FIRST_PASS     (0) /* look past the protected entries first */
+#elif (RBC_MESH_CACHE_POLICY == RBC_MESH_CACHE_POLICY_LRU)
+    #define DATA_ENTRY_BITS             (13)
+    #define HANDLE_ENTRY_PROTECTED(index)   (false)
+    #define CACHE_VICTIM_FIRST_PASS     (1)
+#else
+    #error "Unknown RBC_MESH_CACHE_POLICY"
+#endif
+
+#if (DATA_CACHE_ENTRY_INVALID >= (1 << DATA_ENTRY_BITS))
+    #error "RBC_MESH_DATA_CACHE_ENTRIES is too large for the handle cache data entry field"
+#endif
+
+/* The static handles own the first handle and data cache entries, in handle
+   order. They're outside the LRU list and the handle index. */
+#if (RBC_MESH_STATIC_HANDLE_COUNT >= RBC_MESH_HANDLE_CACHE_ENTRIES || \
+     RBC_MESH_STATIC_HANDLE_COUNT >= RBC_MESH_DATA_CACHE_ENTRIES)
+    #error "RBC_MESH_STATIC_HANDLE_COUNT must leave cache entries for the other handles"
+#endif
+#if (RBC_MESH_STATIC_HANDLE_COUNT > 0 && \
+     RBC_MESH_STATIC_HANDLE_FIRST + RBC_MESH_STATIC_HANDLE_COUNT - 1 > RBC_MESH_APP_MAX_HANDLE)
+    #error "The static handle range must be within the application handles"
+#endif
+
+#if (RBC_MESH_STATIC_HANDLE_COUNT > 0)
+#define HANDLE_IS_STATIC(handle)        ((uint16_t) ((handle) - RBC_MESH_STATIC_HANDLE_FIRST) < RBC_MESH_STATIC_HANDLE_COUNT)
+#else
+#define HANDLE_IS_STATIC(handle)        (false)
+#endif
+#define HANDLE_ENTRY_IS_STATIC(index)   ((index) < RBC_MESH_STATIC_HANDLE_COUNT)
+
 #define CACHE_TASK_FIFO_SIZE            (8)
 
 #define HANDLE_CACHE_ITERATE(index)     do { index = m_handle_cache[index].index_next; } while (0)
 #define HANDLE_CACHE_ITERATE_BACK(index)     do { index = m_handle_cache[index].index_prev; } while (0)
 
+/* The handle index is an open addressing hash table mapping handles to handle
+   cache entries. It is sized to the lowest power of two that keeps the load
+   factor at or below 50%. */
+#if   (RBC_MESH_HANDLE_CACHE_ENTRIES <= 8)
+    #define HANDLE_INDEX_BITS           (4)
+#elif (RBC_MESH_HANDLE_CACHE_ENTRIES <= 16)
+    #define HANDLE_INDEX_BITS           (5)
+#elif (RBC_MESH_HANDLE_CACHE_ENTRIES <= 32)
+    #define HANDLE_INDEX_BITS           (6)
+#elif (RBC_MESH_HANDLE_CACHE_ENTRIES <= 64)
+    #define HANDLE_INDEX_BITS           (7)
+#elif (RBC_MESH_HANDLE_CACHE_ENTRIES <= 128)
+    #define HANDLE_INDEX_BITS           (8)
+#elif (RBC_MESH_HANDLE_CACHE_ENTRIES <= 256)
+    #define HANDLE_INDEX_BITS           (9)
+#elif (RBC_MESH_HANDLE_CACHE_ENTRIES <= 512)
+    #define HANDLE_INDEX_BITS           (10)
+#elif (RBC_MESH_HANDLE_CACHE_ENTRIES <= 1024)
+    #define HANDLE_INDEX_BITS           (11)
+#else
+    #error "RBC_MESH_HANDLE_CACHE_ENTRIES is too large for the handle index"
+#endif
+
+#define HANDLE_INDEX_SIZE               (1UL << HANDLE_INDEX_BITS)
+#define HANDLE_INDEX_MASK               (HANDLE_INDEX_SIZE - 1)
+#define HANDLE_INDEX_SLOT_EMPTY         (HANDLE_CACHE_ENTRY_INVALID)
+
+/* Fibonacci hashing, top bits of the product are the best distributed. */
+#define HANDLE_INDEX_HASH(handle)       ((((uint32_t) (handle)) * 0x9E3779B1U) >> (32 - HANDLE_INDEX_BITS))
+#define HANDLE_INDEX_NEXT(slot)         (((slot) + 1) & HANDLE_INDEX_MASK)
+
+/* The TX heap is a binary min-heap of data entries ordered by trickle
+   deadline. Only data entries that are enabled and hold a packet are in it. */
+#define TX_HEAP_INDEX_INVALID           (0xFFFF)
+#define TX_HEAP_PARENT(i)               (((i) - 1) >> 1)
+#define TX_HEAP_LEFT(i)                 (((i) << 1) + 1)
+#define TX_HEAP_DEADLINE(i)             (m_data_cache[m_tx_heap[i]].trickle.t)
+
+#if RBC_MESH_COMPACT_STORAGE
+#if (RBC_MESH_COMPACT_VALUE_MAX_LEN > RBC_MESH_VALUE_MAX_LEN)
+    #error "RBC_MESH_COMPACT_VALUE_MAX_LEN can't be longer than RBC_MESH_VALUE_MAX_LEN"
+#endif
+/* Markers in the data entry length field for entries without an inline value. */
+#define DATA_LENGTH_NONE                (0xFF)
+#define DATA_LENGTH_PACKET              (0xFE)
+#define DATA_ENTRY_PACKET(i)            (m_data_cache[i].value.p_packet)
+#else
+#define DATA_ENTRY_PACKET(i)            (m_data_cache[i].p_packet)
+#endif
+
 /*****************************************************************************
 * Local Typedefs
 *****************************************************************************/
@@ -62,22 +163,75 @@ typedef struct
     uint16_t                tx_event   : 1;     /** TX event flag */
     uint16_t                index_prev : 15;    /** linked list index prev */
     uint16_t                persistent : 1;     /** Persistent flag */
-    uint16_t                data_entry;         /** index of the associated data entry */
+    uint16_t                data_entry : DATA_ENTRY_BITS; /** index of the associated data entry */
+#if (RBC_MESH_CACHE_POLICY == RBC_MESH_CACHE_POLICY_2Q)
+    uint16_t                protected  : 1;     /** Seen again while cached, replaced after the other entries */
+#endif
+    uint16_t                relay      : 1;     /** Only cached for relaying, not subscribed to */
+    uint16_t                qos_class  : 2;     /** QoS class, as rbc_mesh_qos_class_t */
 } handle_entry_t;
 
+#if RBC_MESH_COMPACT_STORAGE
+/* Values up to RBC_MESH_COMPACT_VALUE_MAX_LEN bytes are kept inline, and only
+   built into a packet when they're needed. Longer values keep the packet they
+   came in. */
+typedef __packed_armcc struct
+{
+    trickle_t trickle;
+    uint16_t heap_index;                        /** position in the TX heap */
+    uint16_t handle_index;                      /** handle entry owning the value */
+    volatile uint16_t seq;                      /** odd while the entry is written, see data_entry_write_begin */
+    uint8_t length;                             /** inline value length, or one of the DATA_LENGTH_* markers */
+    __packed_armcc union
+    {
+        uint8_t data[RBC_MESH_COMPACT_VALUE_MAX_LEN];
+        mesh_packet_t* p_packet;                /** value packet, if length is DATA_LENGTH_PACKET */
+    } __packed_gcc value;
+} __packed_gcc data_entry_t;
+#else
 typedef struct
 {
     trickle_t trickle;
     mesh_packet_t* p_packet;
+    uint16_t heap_index;                        /** position in the TX heap */
+    volatile uint16_t seq;                      /** odd while the entry is written, see data_entry_write_begin */
 } data_entry_t;
+#endif
 
 /******************************************************************************
 * Static globals
 ******************************************************************************/
-static handle_entry_t   m_handle_cache[RBC_MESH_HANDLE_CACHE_ENTRIES];
+static HANDLE_CACHE_SECTION handle_entry_t m_handle_cache[RBC_MESH_HANDLE_CACHE_ENTRIES];
 static data_entry_t     m_data_cache[RBC_MESH_DATA_CACHE_ENTRIES];
 static uint32_t         m_handle_cache_head;
 static uint32_t         m_handle_cache_tail;
+static uint16_t         m_handle_index[HANDLE_INDEX_SIZE];
+static uint16_t         m_tx_heap[RBC_MESH_DATA_CACHE_ENTRIES];
+static uint16_t         m_tx_heap_count;
+static uint16_t         m_relay_count;          /** Number of handle entries with the relay flag */
+static volatile uint16_t m_index_seq;          /** Odd while the handle index is written */
+#if (RBC_MESH_CACHE_POLICY == RBC_MESH_CACHE_POLICY_2Q)
+static uint16_t         m_protected_count;      /** Number of handle entries with the protected flag */
+#endif
+#ifdef MESH_RETAIN
+static bool             m_retain_paused;        /** Don't mirror changes to the retained RAM */
+#endif
+
+/** Internal flag for each public handle flag. The enabled flag is stored inverted, as disabled. */
+static const handle_flag_t m_flag_map[RBC_MESH_HANDLE_FLAG__COUNT] =
+{
+    [RBC_MESH_HANDLE_FLAG_PERSISTENT] = HANDLE_FLAG_PERSISTENT,
+    [RBC_MESH_HANDLE_FLAG_TX_EVENT]   = HANDLE_FLAG_TX_EVENT,
+    [RBC_MESH_HANDLE_FLAG_ENABLED]    = HANDLE_FLAG_DISABLED,
+};
+
+/** TX priority of each QoS class, lowest goes first. */
+static const uint8_t    m_qos_tx_priority[RBC_MESH_QOS_CLASS__COUNT] =
+{
+    [RBC_MESH_QOS_CLASS_LOW_LATENCY] = 0,
+    [RBC_MESH_QOS_CLASS_DEFAULT]     = 1,
+    [RBC_MESH_QOS_CLASS_BACKGROUND]  = 2
+};
 
 /*****************************************************************************
 * Static Functions
@@ -94,30 +248,237 @@ static void version_increment(uint16_t* version)
     }
 }
 
+/** Mark the start of a change to a data entry, its owner or its handle's
+  version. The lock free readers start over if the sequence number is odd, or
+  has changed by the time they're done. Writers only run in event handler
+  context, and never nest. */
+static void data_entry_write_begin(uint16_t data_index)
+{
+    m_data_cache[data_index].seq++;
+    __DMB();
+}
+
+static void data_entry_write_end(uint16_t data_index)
+{
+    __DMB();
+    m_data_cache[data_index].seq++;
+}
+
+static bool data_entry_has_value(const data_entry_t* p_entry)
+{
+#if RBC_MESH_COMPACT_STORAGE
+    return (p_entry->length != DATA_LENGTH_NONE);
+#else
+    return (p_entry->p_packet != NULL);
+#endif
+}
+
+static void data_entry_value_clear(data_entry_t* p_entry)
+{
+#if RBC_MESH_COMPACT_STORAGE
+    if (p_entry->length == DATA_LENGTH_PACKET)
+    {
+        mesh_packet_ref_count_dec(p_entry->value.p_packet); /* data cache ref remove */
+    }
+    p_entry->length = DATA_LENGTH_NONE;
+#else
+    if (p_entry->p_packet != NULL)
+    {
+        mesh_packet_ref_count_dec(p_entry->p_packet); /* data cache ref remove */
+        p_entry->p_packet = NULL;
+    }
+#endif
+}
+
+/** Replace the value of the data entry with the value in the given packet. */
+static void data_entry_value_store(data_entry_t* p_entry, mesh_packet_t* p_packet)
+{
+    /* the caller holds a reference, the packet survives the clear even if it's the current value */
+    data_entry_value_clear(p_entry);
+#if RBC_MESH_COMPACT_STORAGE
+    mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(p_packet);
+    if (p_adv != NULL &&
+        p_adv->adv_data_length <= MESH_PACKET_ADV_OVERHEAD + RBC_MESH_COMPACT_VALUE_MAX_LEN)
+    {
+        p_entry->length = p_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD;
+        memcpy(p_entry->value.data, p_adv->data, p_entry->length);
+        return;
+    }
+    mesh_packet_ref_count_inc(p_packet); /* reference for the cache */
+    p_entry->value.p_packet = p_packet;
+    p_entry->length = DATA_LENGTH_PACKET;
+#else
+    mesh_packet_ref_count_inc(p_packet); /* reference for the cache */
+    p_entry->p_packet = p_packet;
+#endif
+}
+
+/** Get a packet holding the value of the given data entry, with a reference
+  for the caller. Inline values are built into a new packet. Returns NULL if
+  the entry has no value, or there are no free packets to build it in. */
+static mesh_packet_t* data_entry_packet_get(uint16_t data_index)
+{
+    data_entry_t* p_entry = &m_data_cache[data_index];
+#if RBC_MESH_COMPACT_STORAGE
+    if (p_entry->length == DATA_LENGTH_NONE)
+    {
+        return NULL;
+    }
+    if (p_entry->length == DATA_LENGTH_PACKET)
+    {
+        mesh_packet_t* p_packet = p_entry->value.p_packet;
+        return (mesh_packet_ref_count_inc(p_packet) ? p_packet : NULL);
+    }
+
+    mesh_packet_t* p_packet = NULL;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return NULL;
+    }
+    const handle_entry_t* p_handle_entry = &m_handle_cache[p_entry->handle_index];
+    if (mesh_packet_build(p_packet,
+                p_handle_entry->handle,
+                p_handle_entry->version,
+                p_entry->value.data,
+                p_entry->length) != NRF_SUCCESS)
+    {
+        mesh_packet_ref_count_dec(p_packet);
+        return NULL;
+    }
+    return p_packet;
+#else
+    return (mesh_packet_ref_count_inc(p_entry->p_packet) ? p_entry->p_packet : NULL);
+#endif
+}
+
+static void tx_heap_swap(uint32_t a, uint32_t b)
+{
+    uint16_t temp = m_tx_heap[a];
+    m_tx_heap[a] = m_tx_heap[b];
+    m_tx_heap[b] = temp;
+    m_data_cache[m_tx_heap[a]].heap_index = a;
+    m_data_cache[m_tx_heap[b]].heap_index = b;
+}
+
+static void tx_heap_sift_up(uint32_t i)
+{
+    while (i > 0 && TIMER_OLDER_THAN(TX_HEAP_DEADLINE(i), TX_HEAP_DEADLINE(TX_HEAP_PARENT(i))))
+    {
+        tx_heap_swap(i, TX_HEAP_PARENT(i));
+        i = TX_HEAP_PARENT(i);
+    }
+}
+
+static void tx_heap_sift_down(uint32_t i)
+{
+    while (true)
+    {
+        uint32_t earliest = i;
+        uint32_t child = TX_HEAP_LEFT(i);
+        for (uint32_t j = 0; j < 2 && child < m_tx_heap_count; ++j, ++child)
+        {
+            if (TIMER_OLDER_THAN(TX_HEAP_DEADLINE(child), TX_HEAP_DEADLINE(earliest)))
+            {
+                earliest = child;
+            }
+        }
+        if (earliest == i)
+        {
+            return;
+        }
+        tx_heap_swap(i, earliest);
+        i = earliest;
+    }
+}
+
+static void tx_heap_remove(uint16_t data_index)
+{
+    uint32_t i = m_data_cache[data_index].heap_index;
+    if (i == TX_HEAP_INDEX_INVALID)
+    {
+        return;
+    }
+    m_data_cache[data_index].heap_index = TX_HEAP_INDEX_INVALID;
+
+    /* replace with the last element, and let it find its place */
+    if (i != --m_tx_heap_count)
+    {
+        m_tx_heap[i] = m_tx_heap[m_tx_heap_count];
+        m_data_cache[m_tx_heap[i]].heap_index = i;
+        tx_heap_sift_up(i);
+        tx_heap_sift_down(m_data_cache[m_tx_heap[i]].heap_index);
+    }
+}
+
+/** Put the given data entry in its right place in the TX heap. Must be called
+  whenever the entry's trickle deadline, enabled state or packet changes. */
+static void tx_heap_update(uint16_t data_index)
+{
+    data_entry_t* p_entry = &m_data_cache[data_index];
+
+    if (!data_entry_has_value(p_entry) || !trickle_is_enabled(&p_entry->trickle))
+    {
+        tx_heap_remove(data_index);
+        return;
+    }
+
+    uint32_t i = p_entry->heap_index;
+    if (i == TX_HEAP_INDEX_INVALID)
+    {
+        i = m_tx_heap_count++;
+        m_tx_heap[i] = data_index;
+        p_entry->heap_index = i;
+        tx_heap_sift_up(i);
+    }
+    else
+    {
+        tx_heap_sift_up(i);
+        tx_heap_sift_down(p_entry->heap_index);
+    }
+}
+
 static void data_entry_free(data_entry_t* p_data_entry)
 {
     if (p_data_entry == NULL)
         return;
 
-    if (p_data_entry->p_packet != NULL)
+    data_entry_write_begin(p_data_entry - &m_data_cache[0]);
+    data_entry_value_clear(p_data_entry);
+    data_entry_write_end(p_data_entry - &m_data_cache[0]);
+#ifdef MESH_RETAIN
+    if (!m_retain_paused)
     {
-        mesh_packet_ref_count_dec(p_data_entry->p_packet); /* data cache ref remove */
-        p_data_entry->p_packet = NULL;
+        mesh_retain_value_clear(p_data_entry - &m_data_cache[0]);
     }
+#endif
     /* reset trickle params */
     trickle_enable(&p_data_entry->trickle);
+    tx_heap_update(p_data_entry - &m_data_cache[0]);
+}
+
+#if (RBC_MESH_CACHE_POLICY == RBC_MESH_CACHE_POLICY_2Q)
+static void handle_entry_unprotect(uint16_t handle_index)
+{
+    if (m_handle_cache[handle_index].protected)
+    {
+        m_handle_cache[handle_index].protected = 0;
+        m_protected_count--;
+    }
 }
+#else
+#define handle_entry_unprotect(handle_index)
+#endif
 
 /** Allocate a new data entry. Will take the least recently updated entry if all are allocated.
   Returns the index of the resulting entry. */
 static uint16_t data_entry_allocate(void)
 {
-    static uint16_t allocated = 0;
+    static uint16_t allocated = RBC_MESH_STATIC_HANDLE_COUNT; /* the static handles own the first entries */
     TICK_PIN(7);
 
     for (uint32_t i = allocated; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
     {
-        if (m_data_cache[i].p_packet == NULL)
+        if (!data_entry_has_value(&m_data_cache[i]))
         {
             trickle_timer_reset(&m_data_cache[i].trickle, 0);
             allocated++;
@@ -125,102 +486,165 @@ static uint16_t data_entry_allocate(void)
         }
     }
 
-    /* no unused entries, take the least recently updated (and disregard persistent handles) */
-    uint32_t handle_index = m_handle_cache_tail;
-    while (m_handle_cache[handle_index].data_entry == DATA_CACHE_ENTRY_INVALID ||
-           m_handle_cache[handle_index].persistent)
+    /* no unused entries, take the least recently updated (and disregard
+       persistent handles). Protected handles are only considered when
+       there's nothing else. */
+    uint32_t handle_index = HANDLE_CACHE_ENTRY_INVALID;
+    for (uint32_t pass = CACHE_VICTIM_FIRST_PASS; pass < 2 && handle_index == HANDLE_CACHE_ENTRY_INVALID; ++pass)
     {
-        HANDLE_CACHE_ITERATE_BACK(handle_index);
-
-        if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+        handle_index = m_handle_cache_tail;
+        while (m_handle_cache[handle_index].data_entry == DATA_CACHE_ENTRY_INVALID ||
+               m_handle_cache[handle_index].persistent ||
+               (pass == 0 && HANDLE_ENTRY_PROTECTED(handle_index)))
         {
-            return DATA_CACHE_ENTRY_INVALID;
+            HANDLE_CACHE_ITERATE_BACK(handle_index);
+
+            if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+            {
+                break;
+            }
         }
     }
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        return DATA_CACHE_ENTRY_INVALID;
+    }
 
     uint32_t data_index = m_handle_cache[handle_index].data_entry;
     APP_ERROR_CHECK_BOOL(data_index < RBC_MESH_DATA_CACHE_ENTRIES);
 
-    /* cleanup */
+    /* cleanup, the handle entry stays behind to recognize the handle if it comes back */
     m_handle_cache[handle_index].data_entry = DATA_CACHE_ENTRY_INVALID;
+    handle_entry_unprotect(handle_index);
+    MESH_STATS_INC(cache_evictions);
 
     data_entry_free(&m_data_cache[data_index]);
     trickle_timer_reset(&m_data_cache[data_index].trickle, 0);
     return data_index;
 }
 
-/** Get the index of the handle entry representing the given handle.
-  Returns HANDLE_CACHE_ENTRY_INVALID if not found */
-static uint16_t handle_entry_get(rbc_mesh_value_handle_t handle, bool shortcut)
+/** Associate a data entry with a handle entry, and let the entry's trickle
+  instance run with the parameters of the handle's QoS class. */
+static void data_entry_link(uint16_t handle_index, uint16_t data_index)
 {
-    static uint16_t prev_index = HANDLE_CACHE_ENTRY_INVALID;
-    static uint16_t prev_handle = RBC_MESH_INVALID_HANDLE;
+    data_entry_write_begin(data_index);
+    m_handle_cache[handle_index].data_entry = data_index;
+#if RBC_MESH_COMPACT_STORAGE
+    m_data_cache[data_index].handle_index = handle_index;
+#endif
+    data_entry_write_end(data_index);
+    trickle_param_set_select(&m_data_cache[data_index].trickle, m_handle_cache[handle_index].qos_class);
+    trickle_stats_reset(&m_data_cache[data_index].trickle);
+    trickle_timer_reset(&m_data_cache[data_index].trickle, 0);
+}
 
-    event_handler_critical_section_begin();
+/** Add a handle cache entry to the handle index. The entry's handle must be
+  set, and must not already be present in the index. */
+static void handle_index_insert(uint16_t handle_index)
+{
+    uint32_t slot = HANDLE_INDEX_HASH(m_handle_cache[handle_index].handle);
+    while (m_handle_index[slot] != HANDLE_INDEX_SLOT_EMPTY)
+    {
+        slot = HANDLE_INDEX_NEXT(slot);
+    }
+    m_index_seq++;
+    __DMB();
+    m_handle_index[slot] = handle_index;
+    __DMB();
+    m_index_seq++;
+}
 
-    if (shortcut)
+/** Remove the given handle from the handle index. Uses backward shift
+  deletion to keep probe sequences intact without tombstones. */
+static void handle_index_remove(rbc_mesh_value_handle_t handle)
+{
+    uint32_t slot = HANDLE_INDEX_HASH(handle);
+    while (m_handle_index[slot] != HANDLE_INDEX_SLOT_EMPTY &&
+           m_handle_cache[m_handle_index[slot]].handle != handle)
     {
-        /* shortcut when accessing the same element in succession. */
-        if (prev_handle == handle &&
-            prev_index < RBC_MESH_HANDLE_CACHE_ENTRIES &&
-            m_handle_cache[prev_index].handle == handle)
-        {
-            event_handler_critical_section_end();
-            return prev_index;
-        }
+        slot = HANDLE_INDEX_NEXT(slot);
     }
 
-    uint16_t i = m_handle_cache_head;
+    if (m_handle_index[slot] == HANDLE_INDEX_SLOT_EMPTY)
+    {
+        return; /* not in the index */
+    }
 
-    while (m_handle_cache[i].handle != handle)
+    m_index_seq++;
+    __DMB();
+    uint32_t hole = slot;
+    while (true)
     {
-        if (m_handle_cache_tail == i)
+        slot = HANDLE_INDEX_NEXT(slot);
+        uint16_t entry = m_handle_index[slot];
+        if (entry == HANDLE_INDEX_SLOT_EMPTY)
         {
-            event_handler_critical_section_end();
-            return HANDLE_CACHE_ENTRY_INVALID; /* checked all entries */
+            break;
+        }
+        /* move the entry into the hole if the hole is on its probe path */
+        uint32_t home = HANDLE_INDEX_HASH(m_handle_cache[entry].handle);
+        if (((slot - home) & HANDLE_INDEX_MASK) >= ((slot - hole) & HANDLE_INDEX_MASK))
+        {
+            m_handle_index[hole] = entry;
+            hole = slot;
         }
-        HANDLE_CACHE_ITERATE(i);
     }
+    m_handle_index[hole] = HANDLE_INDEX_SLOT_EMPTY;
+    __DMB();
+    m_index_seq++;
+}
 
-    if (shortcut)
+/** Search the handle index for the given handle. Returns
+  HANDLE_CACHE_ENTRY_INVALID if not found. */
+static uint16_t handle_index_find(rbc_mesh_value_handle_t handle)
+{
+    uint32_t slot = HANDLE_INDEX_HASH(handle);
+    uint16_t i;
+
+    while ((i = m_handle_index[slot]) != HANDLE_INDEX_SLOT_EMPTY &&
+           m_handle_cache[i].handle != handle)
     {
-        prev_handle = handle;
-        prev_index = i;
+        slot = HANDLE_INDEX_NEXT(slot);
     }
+    return i; /* the empty slot marker is HANDLE_CACHE_ENTRY_INVALID */
+}
 
+/** Get the index of the handle entry representing the given handle.
+  Returns HANDLE_CACHE_ENTRY_INVALID if not found */
+static uint16_t handle_entry_get(rbc_mesh_value_handle_t handle)
+{
+    if (HANDLE_IS_STATIC(handle))
+    {
+        return handle - RBC_MESH_STATIC_HANDLE_FIRST;
+    }
+
+    event_handler_critical_section_begin();
+    uint16_t i = handle_index_find(handle);
     event_handler_critical_section_end();
+
     return i;
 }
 
-/** Moves the given handle to the head of the handle cache.
-  If it doesn't exist, it allocates the tail, and moves it to head.
-  Returns the index in the cache, or HANDLE_CACHE_ENTRY_INVALID if the cache
-  is full of persistent handles */
-static uint16_t handle_entry_to_head(rbc_mesh_value_handle_t handle)
+static void handle_entry_relay_set(uint16_t handle_index, bool relay)
 {
-    uint16_t i = handle_entry_get(handle, true);
-    if (i == HANDLE_CACHE_ENTRY_INVALID)
+    if (m_handle_cache[handle_index].relay != relay)
     {
-        i = m_handle_cache_tail;
-        while (m_handle_cache[i].persistent)
+        m_handle_cache[handle_index].relay = relay;
+        if (relay)
         {
-            HANDLE_CACHE_ITERATE_BACK(i);
-            if (i == HANDLE_CACHE_ENTRY_INVALID)
-            {
-                return i; /* reached the head without hitting a non-persistent handle */
-            }
+            m_relay_count++;
         }
-        /* clean up old data */
-        m_handle_cache[i].handle = handle;
-        m_handle_cache[i].tx_event = 0;
-        m_handle_cache[i].version = 0;
-        if (m_handle_cache[i].data_entry != DATA_CACHE_ENTRY_INVALID)
+        else
         {
-            data_entry_free(&m_data_cache[m_handle_cache[i].data_entry]);
-            m_handle_cache[i].data_entry = DATA_CACHE_ENTRY_INVALID;
+            m_relay_count--;
         }
     }
-    /* detach and move to head */
+}
+
+/** Detach the given handle entry from the handle cache list, and put it
+  back at the head. */
+static void handle_entry_move_to_head(uint16_t i)
+{
     if (i != m_handle_cache_tail)
     {
         if (i != m_handle_cache_head)
@@ -249,10 +673,434 @@ static uint16_t handle_entry_to_head(rbc_mesh_value_handle_t handle)
 
     m_handle_cache[m_handle_cache_head].index_prev = HANDLE_CACHE_ENTRY_INVALID;
     m_handle_cache[m_handle_cache_tail].index_next = HANDLE_CACHE_ENTRY_INVALID;
+}
 
+/** Moves the given handle to the head of the handle cache.
+  If it doesn't exist, it allocates the tail, and moves it to head. New relay
+  entries may only replace other relay entries once there are
+  RBC_MESH_RELAY_CACHE_ENTRIES of them, so that they can't push out the
+  handles the application subscribes to. With the 2Q policy, protected
+  entries are only replaced when all others are persistent. An existing entry
+  is only marked as relay if it was allocated as one.
+  Returns the index in the cache, or HANDLE_CACHE_ENTRY_INVALID if the cache
+  is full of persistent handles */
+static uint16_t handle_entry_to_head(rbc_mesh_value_handle_t handle, bool relay)
+{
+    uint16_t i = handle_entry_get(handle);
+    if (i == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        const bool relay_only = (relay && m_relay_count >= RBC_MESH_RELAY_CACHE_ENTRIES);
+        /* protected handles are only replaced when there's nothing else */
+        for (uint32_t pass = CACHE_VICTIM_FIRST_PASS; pass < 2 && i == HANDLE_CACHE_ENTRY_INVALID; ++pass)
+        {
+            i = m_handle_cache_tail;
+            while (m_handle_cache[i].persistent ||
+                   (relay_only && !m_handle_cache[i].relay) ||
+                   (pass == 0 && HANDLE_ENTRY_PROTECTED(i)))
+            {
+                HANDLE_CACHE_ITERATE_BACK(i);
+                if (i == HANDLE_CACHE_ENTRY_INVALID)
+                {
+                    break;
+                }
+            }
+        }
+        if (i == HANDLE_CACHE_ENTRY_INVALID)
+        {
+            return i; /* reached the head without hitting a replaceable handle */
+        }
+        /* clean up old data */
+        if (m_handle_cache[i].handle != RBC_MESH_INVALID_HANDLE)
+        {
+            handle_index_remove(m_handle_cache[i].handle);
+        }
+        m_handle_cache[i].handle = handle;
+        handle_index_insert(i);
+        m_handle_cache[i].tx_event = 0;
+        m_handle_cache[i].version = 0;
+        handle_entry_relay_set(i, relay);
+        handle_entry_unprotect(i);
+        if (m_handle_cache[i].data_entry != DATA_CACHE_ENTRY_INVALID)
+        {
+            data_entry_free(&m_data_cache[m_handle_cache[i].data_entry]);
+            m_handle_cache[i].data_entry = DATA_CACHE_ENTRY_INVALID;
+            MESH_STATS_INC(cache_evictions);
+        }
+    }
+    else if (HANDLE_ENTRY_IS_STATIC(i))
+    {
+        return i; /* never evicted, no need to track its use */
+    }
+    else if (!relay)
+    {
+        handle_entry_relay_set(i, false);
+    }
+    handle_entry_move_to_head(i);
     return i;
 }
 
+#if (RBC_MESH_CACHE_POLICY == RBC_MESH_CACHE_POLICY_2Q)
+/** Protect a handle that has been seen again while in the handle cache, and
+  move it to the head. Makes room by demoting the protected handle closest to
+  the tail when there are RBC_MESH_CACHE_PROTECTED_ENTRIES of them already.
+  Handles only cached for relaying are never protected. */
+static void handle_entry_protect(uint16_t handle_index)
+{
+    if (HANDLE_ENTRY_IS_STATIC(handle_index) || m_handle_cache[handle_index].relay)
+    {
+        return;
+    }
+    if (!m_handle_cache[handle_index].protected)
+    {
+        if (m_protected_count > 0 && m_protected_count >= RBC_MESH_CACHE_PROTECTED_ENTRIES)
+        {
+            uint32_t demoted = m_handle_cache_tail;
+            while (!m_handle_cache[demoted].protected)
+            {
+                HANDLE_CACHE_ITERATE_BACK(demoted);
+            }
+            handle_entry_unprotect(demoted);
+        }
+        if (m_protected_count < RBC_MESH_CACHE_PROTECTED_ENTRIES)
+        {
+            m_handle_cache[handle_index].protected = 1;
+            m_protected_count++;
+        }
+    }
+    handle_entry_move_to_head(handle_index);
+}
+#endif
+
+/** Find the handle and data entries of the given handle for a lock free
+  reader, and the data entry's sequence number to check the read against.
+  Returns NRF_ERROR_BUSY if a writer got in the way, and the reader should
+  start over. */
+static uint32_t value_locate(uint16_t handle, uint16_t* p_handle_index, uint16_t* p_data_index, uint16_t* p_seq)
+{
+    const uint16_t index_seq = m_index_seq;
+    __DMB();
+    const uint16_t handle_index = (HANDLE_IS_STATIC(handle) ?
+            handle - RBC_MESH_STATIC_HANDLE_FIRST :
+            handle_index_find(handle));
+    const uint16_t data_index = (handle_index == HANDLE_CACHE_ENTRY_INVALID ?
+            DATA_CACHE_ENTRY_INVALID :
+            m_handle_cache[handle_index].data_entry);
+
+    if (data_index >= DATA_CACHE_ENTRY_INVALID)
+    {
+        /* a search that raced a change of the index may have missed the handle */
+        __DMB();
+        return ((index_seq & 1) || m_index_seq != index_seq) ? NRF_ERROR_BUSY : NRF_ERROR_NOT_FOUND;
+    }
+
+    const uint16_t seq = m_data_cache[data_index].seq;
+    __DMB();
+    if ((seq & 1) ||
+        m_handle_cache[handle_index].handle != handle ||
+        m_handle_cache[handle_index].data_entry != data_index)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    *p_handle_index = handle_index;
+    *p_data_index = data_index;
+    *p_seq = seq;
+    return NRF_SUCCESS;
+}
+
+/** Find the value bytes of a data entry for a lock free reader. The entry may
+  change under the reader, so each field is only read once, packet pointers
+  are forced into the packet pool, and the length is kept within the value
+  buffer. The result is only good if the entry's sequence number is the same
+  after the read. */
+static bool data_entry_value_peek(uint16_t data_index, const uint8_t** pp_data, uint8_t* p_length)
+{
+    mesh_packet_t* p_packet;
+#if RBC_MESH_COMPACT_STORAGE
+    const uint8_t length = m_data_cache[data_index].length;
+    if (length == DATA_LENGTH_NONE)
+    {
+        return false;
+    }
+    if (length != DATA_LENGTH_PACKET)
+    {
+        *pp_data = m_data_cache[data_index].value.data;
+        *p_length = (length > RBC_MESH_COMPACT_VALUE_MAX_LEN ? RBC_MESH_COMPACT_VALUE_MAX_LEN : length);
+        return true;
+    }
+    p_packet = m_data_cache[data_index].value.p_packet;
+#else
+    p_packet = m_data_cache[data_index].p_packet;
+#endif
+    mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(mesh_packet_get_aligned(p_packet));
+    if (p_adv == NULL || p_adv->adv_data_length < MESH_PACKET_ADV_OVERHEAD)
+    {
+        return false;
+    }
+    const uint8_t length_in_packet = p_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD;
+    *pp_data = p_adv->data;
+    *p_length = (length_in_packet > RBC_MESH_VALUE_MAX_LEN ? RBC_MESH_VALUE_MAX_LEN : length_in_packet);
+    return true;
+}
+
+#if defined(MESH_PERSIST) || defined(MESH_RETAIN)
+/** Get the value bytes of a data entry, wherever they're kept. Returns false
+  if the entry has no value. */
+static bool data_entry_value_get(uint16_t data_index, const uint8_t** pp_data, uint8_t* p_length)
+{
+    if (!data_entry_has_value(&m_data_cache[data_index]))
+    {
+        return false;
+    }
+#if RBC_MESH_COMPACT_STORAGE
+    if (m_data_cache[data_index].length != DATA_LENGTH_PACKET)
+    {
+        *pp_data = m_data_cache[data_index].value.data;
+        *p_length = m_data_cache[data_index].length;
+        return true;
+    }
+#endif
+    mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(DATA_ENTRY_PACKET(data_index));
+    if (p_adv == NULL)
+    {
+        return false;
+    }
+    *pp_data = p_adv->data;
+    *p_length = p_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD;
+    return true;
+}
+#endif
+
+#ifdef MESH_PERSIST
+/** Give the current value of a persistent handle to the flash store. */
+static void persistent_value_store(uint16_t handle_index)
+{
+    uint16_t data_index = m_handle_cache[handle_index].data_entry;
+    const uint8_t* p_data;
+    uint8_t length;
+    if (data_index == DATA_CACHE_ENTRY_INVALID ||
+        !data_entry_value_get(data_index, &p_data, &length))
+    {
+        return;
+    }
+
+    /* Best effort, a lost write only means the value is learnt from the
+       neighbours after the next power loss, as without persistence. */
+    (void) mesh_persist_value_store(m_handle_cache[handle_index].handle,
+            m_handle_cache[handle_index].version,
+            p_data,
+            length);
+}
+
+/** Restore the persistent values stored in flash to the caches. */
+static void persistent_values_restore(void)
+{
+    mesh_persist_value_t value;
+    uint32_t iterator = 0;
+    while (mesh_persist_value_next(&iterator, &value) == NRF_SUCCESS)
+    {
+        uint16_t handle_index = handle_entry_get(value.handle);
+        if (handle_index != HANDLE_CACHE_ENTRY_INVALID &&
+            m_handle_cache[handle_index].data_entry != DATA_CACHE_ENTRY_INVALID &&
+            data_entry_has_value(&m_data_cache[m_handle_cache[handle_index].data_entry]))
+        {
+            /* retained through the reset, and newer than the flash copy */
+            m_handle_cache[handle_index].persistent = 1;
+            continue;
+        }
+
+        mesh_packet_t* p_packet = NULL;
+        if (!mesh_packet_acquire(&p_packet))
+        {
+            return;
+        }
+        if (mesh_packet_build(p_packet, value.handle, value.version, value.data, value.length) == NRF_SUCCESS)
+        {
+            handle_info_t info =
+            {
+                .version = value.version,
+                .p_packet = p_packet
+            };
+            if (handle_storage_info_set(value.handle, &info) == NRF_SUCCESS)
+            {
+                /* set after the info, to avoid writing the value back to flash */
+                m_handle_cache[handle_entry_get(value.handle)].persistent = 1;
+            }
+        }
+        mesh_packet_ref_count_dec(p_packet); /* the cache holds its own reference */
+    }
+}
+#endif
+
+#ifdef MESH_RETAIN
+/** Mirror the value and flags of a handle to the retained RAM. */
+static void retained_value_store(uint16_t handle_index)
+{
+    const handle_entry_t* p_handle_entry = &m_handle_cache[handle_index];
+    uint16_t data_index = p_handle_entry->data_entry;
+    if (m_retain_paused || data_index == DATA_CACHE_ENTRY_INVALID)
+    {
+        return;
+    }
+
+    mesh_retain_value_t value;
+    const uint8_t* p_data;
+    if (!data_entry_value_get(data_index, &p_data, &value.length))
+    {
+        mesh_retain_value_clear(data_index);
+        return;
+    }
+    value.handle = p_handle_entry->handle;
+    value.version = p_handle_entry->version;
+    value.flags = (p_handle_entry->qos_class << MESH_RETAIN_FLAG_QOS_POS);
+    if (p_handle_entry->persistent)
+    {
+        value.flags |= MESH_RETAIN_FLAG_PERSISTENT;
+    }
+    if (p_handle_entry->tx_event)
+    {
+        value.flags |= MESH_RETAIN_FLAG_TX_EVENT;
+    }
+    if (p_handle_entry->relay)
+    {
+        value.flags |= MESH_RETAIN_FLAG_RELAY;
+    }
+    if (!trickle_is_enabled(&m_data_cache[data_index].trickle))
+    {
+        value.flags |= MESH_RETAIN_FLAG_DISABLED;
+    }
+    memcpy(value.data, p_data, value.length);
+    mesh_retain_value_store(data_index, &value);
+}
+#endif
+
+static uint32_t info_set(uint16_t handle, handle_info_t* p_info, bool relay)
+{
+    if (p_info == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    uint16_t handle_index = handle_entry_get(handle);
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        /* couldn't find an existing entry, allocate one */
+        handle_index = handle_entry_to_head(handle, relay);
+        if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+    }
+#if (RBC_MESH_CACHE_POLICY == RBC_MESH_CACHE_POLICY_2Q)
+    else
+    {
+        /* updated again, or back after losing its value */
+        handle_entry_protect(handle_index);
+    }
+#endif
+
+    uint16_t data_index = m_handle_cache[handle_index].data_entry;
+
+    if (data_index == DATA_CACHE_ENTRY_INVALID)
+    {
+        MESH_STATS_INC(cache_misses);
+        data_index = data_entry_allocate();
+        if (data_index == DATA_CACHE_ENTRY_INVALID)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        data_entry_link(handle_index, data_index);
+    }
+    else
+    {
+        MESH_STATS_INC(cache_hits);
+    }
+    trickle_timer_reset(&m_data_cache[data_index].trickle, timer_now());
+
+    data_entry_write_begin(data_index);
+    m_handle_cache[handle_index].version = p_info->version;
+    if (p_info->p_packet != NULL)
+    {
+        data_entry_value_store(&m_data_cache[data_index], p_info->p_packet);
+    }
+    data_entry_write_end(data_index);
+    tx_heap_update(data_index);
+
+#ifdef MESH_PERSIST
+    if (m_handle_cache[handle_index].persistent)
+    {
+        persistent_value_store(handle_index);
+    }
+#endif
+#ifdef MESH_RETAIN
+    retained_value_store(handle_index);
+#endif
+    return NRF_SUCCESS;
+}
+
+#ifdef MESH_RETAIN
+/** Put the values retained through the reset back in the caches. */
+static void retained_values_restore(void)
+{
+    mesh_retain_value_t value;
+    uint32_t iterator = 0;
+    while (mesh_retain_value_next(&iterator, &value) == NRF_SUCCESS)
+    {
+        mesh_packet_t* p_packet = NULL;
+        if (!mesh_packet_acquire(&p_packet))
+        {
+            return;
+        }
+        handle_info_t info =
+        {
+            .version = value.version,
+            .p_packet = p_packet
+        };
+        if (mesh_packet_build(p_packet, value.handle, value.version, value.data, value.length) == NRF_SUCCESS &&
+            info_set(value.handle, &info, (value.flags & MESH_RETAIN_FLAG_RELAY)) == NRF_SUCCESS)
+        {
+            handle_entry_t* p_handle_entry = &m_handle_cache[handle_entry_get(value.handle)];
+            uint16_t data_index = p_handle_entry->data_entry;
+            p_handle_entry->persistent = !!(value.flags & MESH_RETAIN_FLAG_PERSISTENT);
+            p_handle_entry->tx_event = !!(value.flags & MESH_RETAIN_FLAG_TX_EVENT);
+            p_handle_entry->qos_class = (value.flags & MESH_RETAIN_FLAG_QOS_MASK) >> MESH_RETAIN_FLAG_QOS_POS;
+            trickle_param_set_select(&m_data_cache[data_index].trickle, p_handle_entry->qos_class);
+            if (value.flags & MESH_RETAIN_FLAG_DISABLED)
+            {
+                trickle_disable(&m_data_cache[data_index].trickle);
+            }
+            else
+            {
+                trickle_enable(&m_data_cache[data_index].trickle);
+                trickle_timer_reset(&m_data_cache[data_index].trickle, timer_now());
+            }
+            tx_heap_update(data_index);
+        }
+        mesh_packet_ref_count_dec(p_packet); /* the cache holds its own reference */
+    }
+}
+
+/** Rewrite all slots of the retained RAM from the caches, as the restored
+  values may have ended up in other data entries. */
+static void retained_values_sync(void)
+{
+    for (uint32_t i = 0; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
+    {
+        mesh_retain_value_clear(i);
+    }
+    for (uint32_t i = 0; i < RBC_MESH_HANDLE_CACHE_ENTRIES; ++i)
+    {
+        if (m_handle_cache[i].handle != RBC_MESH_INVALID_HANDLE)
+        {
+            retained_value_store(i);
+        }
+    }
+}
+#endif
+
 void local_packet_push(void* p_context)
 {
     mesh_packet_t* p_packet = (mesh_packet_t*) p_context;
@@ -264,7 +1112,7 @@ void local_packet_push(void* p_context)
             .version = p_adv->version,
             .p_packet = p_packet
         };
-        uint16_t handle_index = handle_entry_get(p_adv->handle, true);
+        uint16_t handle_index = handle_entry_get(p_adv->handle);
         if (handle_index != HANDLE_CACHE_ENTRY_INVALID)
         {
             info.version = m_handle_cache[handle_index].version;
@@ -272,57 +1120,139 @@ void local_packet_push(void* p_context)
         }
         p_adv->version = info.version;
 
-        handle_storage_info_set(p_adv->handle, &info);
+        if (handle_storage_info_set(p_adv->handle, &info) == NRF_SUCCESS)
+        {
+            /* setting a value enables it, as documented in rbc_mesh_value_set() */
+            uint16_t data_index = m_handle_cache[handle_entry_get(p_adv->handle)].data_entry;
+            if (!trickle_is_enabled(&m_data_cache[data_index].trickle))
+            {
+                trickle_enable(&m_data_cache[data_index].trickle);
+                trickle_timer_reset(&m_data_cache[data_index].trickle, timer_now());
+                tx_heap_update(data_index);
+#ifdef MESH_RETAIN
+                retained_value_store(handle_entry_get(p_adv->handle));
+#endif
+            }
+        }
     }
     mesh_packet_ref_count_dec(p_packet); /* for the event queue */
 }
 
+/** Hash of a single handle and version, for the range digests. The digest of
+  a range is the sum of the hashes of its values, which doesn't depend on the
+  cache order. */
+static uint32_t digest_hash(rbc_mesh_value_handle_t handle, uint16_t version)
+{
+    uint32_t h = (((uint32_t) handle) << 16) | version;
+    /* Murmur3 finalizer, spreads every input bit over the whole word */
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35U;
+    h ^= h >> 16;
+    return h;
+}
+
 /*****************************************************************************
 * Interface Functions
 *****************************************************************************/
 uint32_t handle_storage_init(uint32_t min_interval_us)
 {
-    event_handler_critical_section_begin();
-    uint32_t error_code = handle_storage_min_interval_set(min_interval_us);
-    if (error_code != NRF_SUCCESS)
+    if (!MIN_INTERVAL_IS_VALID(min_interval_us))
     {
-        event_handler_critical_section_end();
-        return error_code;
+        return NRF_ERROR_INVALID_PARAM;
     }
+    event_handler_critical_section_begin();
+
+    trickle_setup(min_interval_us, MESH_TRICKLE_I_MAX, MESH_TRICKLE_K);
+    trickle_params_set(RBC_MESH_QOS_CLASS_LOW_LATENCY,
+            RBC_MESH_QOS_LOW_LATENCY_I_MIN_MS * 1000,
+            RBC_MESH_QOS_LOW_LATENCY_I_MAX_FACTOR,
+            RBC_MESH_QOS_LOW_LATENCY_K);
+    trickle_params_set(RBC_MESH_QOS_CLASS_BACKGROUND,
+            RBC_MESH_QOS_BACKGROUND_I_MIN_MS * 1000,
+            RBC_MESH_QOS_BACKGROUND_I_MAX_FACTOR,
+            RBC_MESH_QOS_BACKGROUND_K);
 
     for (uint32_t i = 0; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
     {
+#if RBC_MESH_COMPACT_STORAGE
+        m_data_cache[i].length = DATA_LENGTH_NONE;
+        m_data_cache[i].handle_index = HANDLE_CACHE_ENTRY_INVALID;
+#else
         m_data_cache[i].p_packet = NULL;
+#endif
+        m_data_cache[i].heap_index = TX_HEAP_INDEX_INVALID;
+        m_data_cache[i].seq = 0;
+        trickle_param_set_select(&m_data_cache[i].trickle, RBC_MESH_QOS_CLASS_DEFAULT);
     }
+    m_tx_heap_count = 0;
+    m_relay_count = 0;
+#if (RBC_MESH_CACHE_POLICY == RBC_MESH_CACHE_POLICY_2Q)
+    m_protected_count = 0;
+#endif
 
     for (uint32_t i = 0; i < RBC_MESH_HANDLE_CACHE_ENTRIES; ++i)
     {
         m_handle_cache[i].handle = RBC_MESH_INVALID_HANDLE;
         m_handle_cache[i].version = 0;
         m_handle_cache[i].persistent = 0;
+        m_handle_cache[i].relay = 0;
+#if (RBC_MESH_CACHE_POLICY == RBC_MESH_CACHE_POLICY_2Q)
+        m_handle_cache[i].protected = 0;
+#endif
         m_handle_cache[i].tx_event = 0;
         m_handle_cache[i].data_entry = DATA_CACHE_ENTRY_INVALID;
+        m_handle_cache[i].qos_class = RBC_MESH_QOS_CLASS_DEFAULT;
         m_handle_cache[i].index_prev = i - 1;
         m_handle_cache[i].index_next = i + 1;
     }
 
-    m_handle_cache_head = 0;
+    for (uint32_t i = 0; i < RBC_MESH_STATIC_HANDLE_COUNT; ++i)
+    {
+        m_handle_cache[i].handle = RBC_MESH_STATIC_HANDLE_FIRST + i;
+        m_handle_cache[i].index_prev = HANDLE_CACHE_ENTRY_INVALID;
+        m_handle_cache[i].index_next = HANDLE_CACHE_ENTRY_INVALID;
+        data_entry_link(i, i);
+    }
+
+    for (uint32_t i = 0; i < HANDLE_INDEX_SIZE; ++i)
+    {
+        m_handle_index[i] = HANDLE_INDEX_SLOT_EMPTY;
+    }
+    m_index_seq = 0;
+
+    m_handle_cache_head = RBC_MESH_STATIC_HANDLE_COUNT;
     m_handle_cache_tail = RBC_MESH_HANDLE_CACHE_ENTRIES - 1;
     m_handle_cache[m_handle_cache_head].index_prev = HANDLE_CACHE_ENTRY_INVALID;
     m_handle_cache[m_handle_cache_tail].index_next = HANDLE_CACHE_ENTRY_INVALID;
 
+#ifdef MESH_RETAIN
+    /* the retained values are the newest, restore them first */
+    m_retain_paused = true;
+    mesh_retain_init();
+    retained_values_restore();
+#endif
+#ifdef MESH_PERSIST
+    mesh_persist_init();
+    persistent_values_restore();
+#endif
+#ifdef MESH_RETAIN
+    m_retain_paused = false;
+    retained_values_sync();
+#endif
+
     event_handler_critical_section_end();
     return NRF_SUCCESS;
 }
 
 uint32_t handle_storage_min_interval_set(uint32_t min_interval_us)
 {
-    if (min_interval_us < RBC_MESH_INTERVAL_MIN_MIN_MS * 1000 ||
-        min_interval_us > RBC_MESH_INTERVAL_MIN_MAX_MS * 1000)
+    if (!MIN_INTERVAL_IS_VALID(min_interval_us))
     {
         return NRF_ERROR_INVALID_PARAM;
     }
-    trickle_setup(min_interval_us, MESH_TRICKLE_I_MAX, MESH_TRICKLE_K);
+    trickle_params_set(RBC_MESH_QOS_CLASS_DEFAULT, min_interval_us, MESH_TRICKLE_I_MAX, MESH_TRICKLE_K);
 
     return NRF_SUCCESS;
 }
@@ -340,7 +1270,7 @@ uint32_t handle_storage_info_get(uint16_t handle, handle_info_t* p_info)
     }
     event_handler_critical_section_begin();
 
-    uint16_t handle_index = handle_entry_get(handle, false);
+    uint16_t handle_index = handle_entry_get(handle);
     if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
     {
         event_handler_critical_section_end();
@@ -350,19 +1280,16 @@ uint32_t handle_storage_info_get(uint16_t handle, handle_info_t* p_info)
     p_info->version = m_handle_cache[handle_index].version;
     if (m_handle_cache[handle_index].data_entry != DATA_CACHE_ENTRY_INVALID)
     {
-        if (mesh_packet_ref_count_inc(m_data_cache[m_handle_cache[handle_index].data_entry].p_packet))
-        {
-            p_info->p_packet = m_data_cache[m_handle_cache[handle_index].data_entry].p_packet;
-        }
+        p_info->p_packet = data_entry_packet_get(m_handle_cache[handle_index].data_entry);
     }
 
     event_handler_critical_section_end();
     return NRF_SUCCESS;
 }
 
-uint32_t handle_storage_info_set(uint16_t handle, handle_info_t* p_info)
+uint32_t handle_storage_value_read(uint16_t handle, uint8_t* p_data, uint16_t* p_length, uint16_t* p_version)
 {
-    if (p_info == NULL)
+    if (p_data == NULL || p_length == NULL)
     {
         return NRF_ERROR_NULL;
     }
@@ -371,40 +1298,170 @@ uint32_t handle_storage_info_set(uint16_t handle, handle_info_t* p_info)
         return NRF_ERROR_INVALID_ADDR;
     }
 
-    uint16_t handle_index = handle_entry_get(handle, true);
-    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    for (uint32_t attempt = 0; attempt < RBC_MESH_VALUE_READ_ATTEMPTS; ++attempt)
     {
-        /* couldn't find an existing entry, allocate one */
-        handle_index = handle_entry_to_head(handle);
-        if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+        uint16_t handle_index;
+        uint16_t data_index;
+        uint16_t seq;
+        uint32_t error_code = value_locate(handle, &handle_index, &data_index, &seq);
+        if (error_code == NRF_ERROR_NOT_FOUND)
         {
-            return NRF_ERROR_NO_MEM;
+            return error_code;
+        }
+        if (error_code != NRF_SUCCESS)
+        {
+            continue;
+        }
+
+        const uint8_t* p_value;
+        uint8_t length;
+        const bool has_value = data_entry_value_peek(data_index, &p_value, &length);
+        const uint16_t version = m_handle_cache[handle_index].version;
+        if (has_value && length <= *p_length)
+        {
+            memcpy(p_data, p_value, length);
+        }
+
+        __DMB();
+        if (m_data_cache[data_index].seq != seq)
+        {
+            continue; /* raced an update, the copy may be torn */
         }
+        if (!has_value)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+        if (length > *p_length)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        *p_length = length;
+        if (p_version != NULL)
+        {
+            *p_version = version;
+        }
+        return NRF_SUCCESS;
     }
+    return NRF_ERROR_BUSY;
+}
 
-    uint16_t data_index = m_handle_cache[handle_index].data_entry;
+uint32_t handle_storage_value_peek(uint16_t handle, const uint8_t** pp_data, uint16_t* p_length, uint32_t* p_token)
+{
+    if (pp_data == NULL || p_length == NULL || p_token == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
 
-    if (data_index == DATA_CACHE_ENTRY_INVALID)
+    for (uint32_t attempt = 0; attempt < RBC_MESH_VALUE_READ_ATTEMPTS; ++attempt)
     {
-        data_index = data_entry_allocate();
-        if (data_index == DATA_CACHE_ENTRY_INVALID)
+        uint16_t handle_index;
+        uint16_t data_index;
+        uint16_t seq;
+        uint32_t error_code = value_locate(handle, &handle_index, &data_index, &seq);
+        if (error_code == NRF_ERROR_NOT_FOUND)
         {
-            return NRF_ERROR_NO_MEM;
+            return error_code;
+        }
+        if (error_code != NRF_SUCCESS)
+        {
+            continue;
+        }
+        if (!HANDLE_ENTRY_IS_STATIC(handle_index) && !m_handle_cache[handle_index].persistent)
+        {
+            /* the entry could be handed to another handle while the caller reads it */
+            return NRF_ERROR_FORBIDDEN;
+        }
+
+        const uint8_t* p_value;
+        uint8_t length;
+        const bool has_value = data_entry_value_peek(data_index, &p_value, &length);
+        __DMB();
+        if (m_data_cache[data_index].seq != seq)
+        {
+            continue;
         }
-        m_handle_cache[handle_index].data_entry = data_index;
+        if (!has_value)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+        *pp_data = p_value;
+        *p_length = length;
+        *p_token = ((uint32_t) data_index << 16) | seq;
+        return NRF_SUCCESS;
     }
-    trickle_timer_reset(&m_data_cache[data_index].trickle, timer_now());
+    return NRF_ERROR_BUSY;
+}
 
-    m_handle_cache[handle_index].version = p_info->version;
-    if (m_data_cache[data_index].p_packet != NULL)
+uint32_t handle_storage_value_peek_check(uint32_t token)
+{
+    const uint16_t data_index = token >> 16;
+    if (data_index >= RBC_MESH_DATA_CACHE_ENTRIES)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    /* the reads of the value must be done before the sequence number is checked */
+    __DMB();
+    return (m_data_cache[data_index].seq == (token & 0xFFFF) ? NRF_SUCCESS : NRF_ERROR_INVALID_DATA);
+}
+
+uint32_t handle_storage_value_next(uint16_t* p_cursor, uint16_t* p_handle, uint8_t* p_data, uint16_t* p_length, uint16_t* p_version)
+{
+    if (p_cursor == NULL || p_handle == NULL || p_data == NULL || p_length == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    /* entries stay in place in the array while the LRU list is reordered, so
+       the array index is a cursor that survives between calls. */
+    for (uint32_t handle_index = *p_cursor; handle_index < RBC_MESH_HANDLE_CACHE_ENTRIES; ++handle_index)
     {
-        mesh_packet_ref_count_dec(m_data_cache[data_index].p_packet);
+        event_handler_critical_section_begin();
+        const uint16_t data_index = m_handle_cache[handle_index].data_entry;
+        const uint8_t* p_value;
+        uint8_t length;
+        if (data_index == DATA_CACHE_ENTRY_INVALID ||
+            m_handle_cache[handle_index].handle == RBC_MESH_INVALID_HANDLE ||
+            !data_entry_has_value(&m_data_cache[data_index]) ||
+            !data_entry_value_peek(data_index, &p_value, &length))
+        {
+            event_handler_critical_section_end();
+            continue;
+        }
+        if (length > *p_length)
+        {
+            event_handler_critical_section_end();
+            *p_cursor = handle_index;
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        memcpy(p_data, p_value, length);
+        *p_length = length;
+        *p_handle = m_handle_cache[handle_index].handle;
+        if (p_version != NULL)
+        {
+            *p_version = m_handle_cache[handle_index].version;
+        }
+        event_handler_critical_section_end();
+
+        *p_cursor = handle_index + 1;
+        return NRF_SUCCESS;
     }
 
-    /* reference for the cache */
-    mesh_packet_ref_count_inc(p_info->p_packet);
-    m_data_cache[m_handle_cache[handle_index].data_entry].p_packet = p_info->p_packet;
-    return NRF_SUCCESS;
+    *p_cursor = RBC_MESH_HANDLE_CACHE_ENTRIES;
+    return NRF_ERROR_NOT_FOUND;
+}
+
+uint32_t handle_storage_info_set(uint16_t handle, handle_info_t* p_info)
+{
+    return info_set(handle, p_info, false);
+}
+
+uint32_t handle_storage_relay_info_set(uint16_t handle, handle_info_t* p_info)
+{
+    return info_set(handle, p_info, true);
 }
 
 uint32_t handle_storage_local_packet_push(mesh_packet_t* p_packet)
@@ -438,27 +1495,47 @@ uint32_t handle_storage_flag_set(uint16_t handle, handle_flag_t flag, bool value
         return NRF_ERROR_INVALID_ADDR;
     }
 
-    uint16_t handle_index = handle_entry_get(handle, true);
+    uint16_t handle_index = handle_entry_get(handle);
 
     switch (flag)
     {
         case HANDLE_FLAG_PERSISTENT:
             if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
             {
-                handle_index = handle_entry_to_head(handle);
+                handle_index = handle_entry_to_head(handle, false);
 
                 if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
                 {
                     return NRF_ERROR_NO_MEM;
                 }
             }
+            if (value)
+            {
+                /* the application wants to keep it, it's no longer just relayed */
+                handle_entry_relay_set(handle_index, false);
+            }
+#ifdef MESH_PERSIST
+            if (value != m_handle_cache[handle_index].persistent)
+            {
+                m_handle_cache[handle_index].persistent = value;
+                if (value)
+                {
+                    persistent_value_store(handle_index);
+                }
+                else
+                {
+                    (void) mesh_persist_value_remove(handle);
+                }
+            }
+#else
             m_handle_cache[handle_index].persistent = value;
+#endif
             break;
 
         case HANDLE_FLAG_TX_EVENT:
             if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
             {
-                handle_index = handle_entry_to_head(handle);
+                handle_index = handle_entry_to_head(handle, false);
 
                 if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
                 {
@@ -480,6 +1557,7 @@ uint32_t handle_storage_flag_set(uint16_t handle, handle_flag_t flag, bool value
                     return NRF_SUCCESS; /* the value is already disabled */
                 }
                 trickle_disable(&m_data_cache[m_handle_cache[handle_index].data_entry].trickle);
+                tx_heap_update(m_handle_cache[handle_index].data_entry);
             }
             else
             {
@@ -511,22 +1589,24 @@ uint32_t handle_storage_flag_set(uint16_t handle, handle_flag_t flag, bool value
                 {
                     if (m_handle_cache[handle_index].data_entry == DATA_CACHE_ENTRY_INVALID)
                     {
-                        m_handle_cache[handle_index].data_entry = data_entry_allocate();
-                        if (m_handle_cache[handle_index].data_entry == DATA_CACHE_ENTRY_INVALID)
+                        uint16_t data_index = data_entry_allocate();
+                        if (data_index == DATA_CACHE_ENTRY_INVALID)
                         {
+                            mesh_packet_ref_count_dec(p_packet);
                             return NRF_ERROR_NO_MEM;
                         }
+                        data_entry_link(handle_index, data_index);
                     }
-                    if (m_data_cache[m_handle_cache[handle_index].data_entry].p_packet != NULL)
-                    {
-                        /* someone set the packet already, let's not overwrite it. */
-                        mesh_packet_ref_count_dec(p_packet);
-                    }
-                    else
+                    /* if someone set the value already, let's not overwrite it. */
+                    if (!data_entry_has_value(&m_data_cache[m_handle_cache[handle_index].data_entry]))
                     {
-                        m_data_cache[m_handle_cache[handle_index].data_entry].p_packet = p_packet;
+                        data_entry_write_begin(m_handle_cache[handle_index].data_entry);
+                        data_entry_value_store(&m_data_cache[m_handle_cache[handle_index].data_entry], p_packet);
+                        data_entry_write_end(m_handle_cache[handle_index].data_entry);
                     }
+                    mesh_packet_ref_count_dec(p_packet);
                     trickle_enable(&m_data_cache[m_handle_cache[handle_index].data_entry].trickle);
+                    tx_heap_update(m_handle_cache[handle_index].data_entry);
                 }
             }
             break;
@@ -534,6 +1614,9 @@ uint32_t handle_storage_flag_set(uint16_t handle, handle_flag_t flag, bool value
             return NRF_ERROR_INVALID_PARAM;
     }
 
+#ifdef MESH_RETAIN
+    retained_value_store(handle_index);
+#endif
     return NRF_SUCCESS;
 }
 
@@ -547,6 +1630,71 @@ uint32_t handle_storage_flag_set_async(uint16_t handle, handle_flag_t flag, bool
     return event_handler_push(&evt);
 }
 
+uint32_t handle_storage_flag_set_bulk(const rbc_mesh_flag_op_t* p_ops, uint32_t count, uint32_t* p_applied_count)
+{
+    if (p_ops == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (p_ops[i].handle == RBC_MESH_INVALID_HANDLE)
+        {
+            return NRF_ERROR_INVALID_ADDR;
+        }
+        if (p_ops[i].flag >= RBC_MESH_HANDLE_FLAG__COUNT)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    uint32_t error_code = NRF_SUCCESS;
+    uint32_t applied = 0;
+    event_handler_critical_section_begin();
+    for (; applied < count; ++applied)
+    {
+        error_code = handle_storage_flag_set(p_ops[applied].handle,
+                m_flag_map[p_ops[applied].flag],
+                (p_ops[applied].flag == RBC_MESH_HANDLE_FLAG_ENABLED) ? !p_ops[applied].value : p_ops[applied].value);
+        if (error_code != NRF_SUCCESS)
+        {
+            break;
+        }
+    }
+    event_handler_critical_section_end();
+
+    if (p_applied_count != NULL)
+    {
+        *p_applied_count = applied;
+    }
+    return error_code;
+}
+
+uint32_t handle_storage_flag_set_range(uint16_t first, uint16_t last, rbc_mesh_handle_flag_t flag, bool value)
+{
+    if (first == RBC_MESH_INVALID_HANDLE || last < first)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (flag >= RBC_MESH_HANDLE_FLAG__COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (flag == RBC_MESH_HANDLE_FLAG_ENABLED)
+    {
+        value = !value;
+    }
+
+    uint32_t error_code = NRF_SUCCESS;
+    event_handler_critical_section_begin();
+    for (uint32_t handle = first; handle <= last && error_code == NRF_SUCCESS; ++handle)
+    {
+        error_code = handle_storage_flag_set(handle, m_flag_map[flag], value);
+    }
+    event_handler_critical_section_end();
+    return error_code;
+}
+
 uint32_t handle_storage_flag_get(uint16_t handle, handle_flag_t flag, bool* p_value)
 {
     if (flag >= HANDLE_FLAG__MAX)
@@ -564,7 +1712,7 @@ uint32_t handle_storage_flag_get(uint16_t handle, handle_flag_t flag, bool* p_va
 
     event_handler_critical_section_begin();
 
-    uint16_t handle_index = handle_entry_get(handle, false);
+    uint16_t handle_index = handle_entry_get(handle);
     if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
     {
         event_handler_critical_section_end();
@@ -588,14 +1736,152 @@ uint32_t handle_storage_flag_get(uint16_t handle, handle_flag_t flag, bool* p_va
     return NRF_SUCCESS;
 }
 
-uint32_t handle_storage_rx_consistent(uint16_t handle, uint32_t timestamp)
+uint32_t handle_storage_qos_set(uint16_t handle, rbc_mesh_qos_class_t qos_class)
+{
+    if (qos_class >= RBC_MESH_QOS_CLASS__COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    uint16_t handle_index = handle_entry_get(handle);
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        handle_index = handle_entry_to_head(handle, false);
+
+        if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+    }
+
+    if (m_handle_cache[handle_index].qos_class == qos_class)
+    {
+        return NRF_SUCCESS;
+    }
+    m_handle_cache[handle_index].qos_class = qos_class;
+
+    uint16_t data_index = m_handle_cache[handle_index].data_entry;
+    if (data_index != DATA_CACHE_ENTRY_INVALID)
+    {
+        /* restart the interval with the new parameters */
+        trickle_param_set_select(&m_data_cache[data_index].trickle, qos_class);
+        if (trickle_is_enabled(&m_data_cache[data_index].trickle))
+        {
+            trickle_timer_reset(&m_data_cache[data_index].trickle, timer_now());
+        }
+        tx_heap_update(data_index);
+    }
+#ifdef MESH_RETAIN
+    retained_value_store(handle_index);
+#endif
+
+    return NRF_SUCCESS;
+}
+
+uint32_t handle_storage_qos_set_async(uint16_t handle, rbc_mesh_qos_class_t qos_class)
+{
+    async_event_t evt;
+    evt.type = EVENT_TYPE_SET_QOS;
+    evt.callback.set_qos.handle = handle;
+    evt.callback.set_qos.qos_class = qos_class;
+    return event_handler_push(&evt);
+}
+
+uint32_t handle_storage_qos_get(uint16_t handle, rbc_mesh_qos_class_t* p_qos_class)
+{
+    if (p_qos_class == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    event_handler_critical_section_begin();
+
+    uint16_t handle_index = handle_entry_get(handle);
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        event_handler_critical_section_end();
+        return NRF_ERROR_NOT_FOUND;
+    }
+    *p_qos_class = (rbc_mesh_qos_class_t) m_handle_cache[handle_index].qos_class;
+
+    event_handler_critical_section_end();
+    return NRF_SUCCESS;
+}
+
+uint32_t handle_storage_trickle_stats_get(uint16_t handle, rbc_mesh_handle_stats_t* p_stats)
+{
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    event_handler_critical_section_begin();
+
+    uint16_t handle_index = handle_entry_get(handle);
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID ||
+        m_handle_cache[handle_index].data_entry == DATA_CACHE_ENTRY_INVALID)
+    {
+        event_handler_critical_section_end();
+        return NRF_ERROR_NOT_FOUND;
+    }
+    trickle_t* p_trickle = &m_data_cache[m_handle_cache[handle_index].data_entry].trickle;
+    uint32_t timeouts = p_trickle->tx_count + p_trickle->suppressed_count;
+
+    p_stats->tx_count = p_trickle->tx_count;
+    p_stats->suppressed_count = p_trickle->suppressed_count;
+    p_stats->suppression_permille = (timeouts == 0) ? 0 : (p_trickle->suppressed_count * 1000) / timeouts;
+    p_stats->density = p_trickle->density;
+    p_stats->k = trickle_k_get(p_trickle);
+
+    event_handler_critical_section_end();
+    return NRF_SUCCESS;
+}
+
+uint32_t handle_storage_rx_consistent(uint16_t handle, uint32_t timestamp, uint8_t weight)
+{
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    uint16_t handle_index = handle_entry_get(handle);
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    uint16_t data_index = m_handle_cache[handle_index].data_entry;
+
+    if (data_index == DATA_CACHE_ENTRY_INVALID)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    trickle_rx_consistent_weighted(&m_data_cache[data_index].trickle, timestamp, weight);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t handle_storage_rx_duplicate(uint16_t handle, uint16_t version, uint32_t timestamp, uint8_t weight)
 {
     if (handle == RBC_MESH_INVALID_HANDLE)
     {
         return NRF_ERROR_INVALID_ADDR;
     }
 
-    uint16_t handle_index = handle_entry_get(handle, true);
+    uint16_t handle_index = handle_entry_get(handle);
     if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
     {
         return NRF_ERROR_NOT_FOUND;
@@ -607,8 +1893,12 @@ uint32_t handle_storage_rx_consistent(uint16_t handle, uint32_t timestamp)
     {
         return NRF_ERROR_NOT_FOUND;
     }
+    if (m_handle_cache[handle_index].version != version)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
 
-    trickle_rx_consistent(&m_data_cache[data_index].trickle, timestamp);
+    trickle_rx_consistent_weighted(&m_data_cache[data_index].trickle, timestamp, weight);
 
     return NRF_SUCCESS;
 }
@@ -620,7 +1910,7 @@ uint32_t handle_storage_rx_inconsistent(uint16_t handle, uint32_t timestamp)
         return NRF_ERROR_INVALID_ADDR;
     }
 
-    uint16_t handle_index = handle_entry_get(handle, true);
+    uint16_t handle_index = handle_entry_get(handle);
     if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
     {
         return NRF_ERROR_NOT_FOUND;
@@ -634,57 +1924,200 @@ uint32_t handle_storage_rx_inconsistent(uint16_t handle, uint32_t timestamp)
     }
 
     trickle_rx_inconsistent(&m_data_cache[data_index].trickle, timestamp);
+    tx_heap_update(data_index);
 
     return NRF_SUCCESS;
 }
-uint32_t handle_storage_next_timeout_get(bool* p_found_value)
+
+uint32_t handle_storage_tx_advance(uint16_t handle, uint32_t timestamp)
 {
-    uint32_t time_earliest = 0;
-    *p_found_value = false;
-    for (uint32_t i = 0; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    uint16_t handle_index = handle_entry_get(handle);
+    if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    uint16_t data_index = m_handle_cache[handle_index].data_entry;
+
+    if (data_index == DATA_CACHE_ENTRY_INVALID)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    trickle_tx_advance(&m_data_cache[data_index].trickle, timestamp);
+    tx_heap_update(data_index);
+
+    return NRF_SUCCESS;
+}
+void handle_storage_sync_reset(uint32_t offset, uint32_t count, uint32_t timestamp)
+{
+    /* the static entries first, then the LRU list */
+    uint32_t handle_index = (RBC_MESH_STATIC_HANDLE_COUNT > 0 ? 0 : m_handle_cache_head);
+    while (handle_index != HANDLE_CACHE_ENTRY_INVALID && count > 0)
+    {
+        uint16_t data_index = m_handle_cache[handle_index].data_entry;
+        /* the TX heap holds exactly the enabled entries with a value */
+        if (data_index != DATA_CACHE_ENTRY_INVALID &&
+            m_data_cache[data_index].heap_index != TX_HEAP_INDEX_INVALID)
+        {
+            if (offset > 0)
+            {
+                offset--;
+            }
+            else
+            {
+                trickle_timer_reset(&m_data_cache[data_index].trickle, timestamp);
+                tx_heap_update(data_index);
+                count--;
+            }
+        }
+        if (!HANDLE_ENTRY_IS_STATIC(handle_index))
+        {
+            HANDLE_CACHE_ITERATE(handle_index);
+        }
+        else if (++handle_index == RBC_MESH_STATIC_HANDLE_COUNT)
+        {
+            handle_index = m_handle_cache_head;
+        }
+    }
+}
+
+void handle_storage_digest_get(const rbc_mesh_handle_range_t* p_ranges, uint32_t range_count, uint32_t* p_digests, uint16_t* p_counts)
+{
+    for (uint32_t r = 0; r < range_count; ++r)
+    {
+        p_digests[r] = 0;
+        p_counts[r] = 0;
+    }
+
+    event_handler_critical_section_begin();
+    for (uint32_t i = 0; i < RBC_MESH_HANDLE_CACHE_ENTRIES; ++i)
     {
-        if (trickle_is_enabled(&m_data_cache[i].trickle) &&
-            m_data_cache[i].p_packet != NULL &&
-            (!(*p_found_value) || TIMER_OLDER_THAN(m_data_cache[i].trickle.t, time_earliest)))
+        uint16_t data_index = m_handle_cache[i].data_entry;
+        /* the TX heap holds exactly the enabled entries with a value */
+        if (data_index == DATA_CACHE_ENTRY_INVALID ||
+            m_data_cache[data_index].heap_index == TX_HEAP_INDEX_INVALID)
+        {
+            continue;
+        }
+        rbc_mesh_value_handle_t handle = m_handle_cache[i].handle;
+        for (uint32_t r = 0; r < range_count; ++r)
         {
-            *p_found_value = true;
-            time_earliest = m_data_cache[i].trickle.t;
+            if (handle >= p_ranges[r].first && handle <= p_ranges[r].last)
+            {
+                p_digests[r] += digest_hash(handle, m_handle_cache[i].version);
+                p_counts[r]++;
+                break;
+            }
         }
     }
-    return time_earliest;
+    event_handler_critical_section_end();
 }
 
-uint32_t handle_storage_tx_packets_get(uint32_t time_now, mesh_packet_t** pp_packets, uint32_t* p_count)
+void handle_storage_range_consistent(uint16_t first, uint16_t last, uint32_t timestamp)
 {
-    /* Continue where we left off */
-    static uint16_t data_index = 0;
+    for (uint32_t i = 0; i < RBC_MESH_HANDLE_CACHE_ENTRIES; ++i)
+    {
+        uint16_t data_index = m_handle_cache[i].data_entry;
+        if (data_index != DATA_CACHE_ENTRY_INVALID &&
+            m_data_cache[data_index].heap_index != TX_HEAP_INDEX_INVALID &&
+            m_handle_cache[i].handle >= first &&
+            m_handle_cache[i].handle <= last)
+        {
+            trickle_rx_suppress(&m_data_cache[data_index].trickle, timestamp);
+            tx_heap_update(data_index);
+        }
+    }
+}
 
-    uint32_t count = 0;
+void handle_storage_range_inconsistent(uint16_t first, uint16_t last, uint32_t timestamp)
+{
+    for (uint32_t i = 0; i < RBC_MESH_HANDLE_CACHE_ENTRIES; ++i)
+    {
+        uint16_t data_index = m_handle_cache[i].data_entry;
+        if (data_index != DATA_CACHE_ENTRY_INVALID &&
+            m_data_cache[data_index].heap_index != TX_HEAP_INDEX_INVALID &&
+            m_handle_cache[i].handle >= first &&
+            m_handle_cache[i].handle <= last)
+        {
+            trickle_rx_inconsistent(&m_data_cache[data_index].trickle, timestamp);
+            tx_heap_update(data_index);
+        }
+    }
+}
 
-    for (uint32_t i = 0; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
+uint32_t handle_storage_next_timeout_get(bool* p_found_value)
+{
+    if (m_tx_heap_count == 0)
     {
-        while (data_index >= RBC_MESH_DATA_CACHE_ENTRIES)
-            data_index -= RBC_MESH_DATA_CACHE_ENTRIES;
+        *p_found_value = false;
+        return 0;
+    }
+    *p_found_value = true;
+    return TX_HEAP_DEADLINE(0);
+}
+
+uint32_t handle_storage_tx_packets_get(uint32_t time_now, mesh_packet_t** pp_packets, uint32_t* p_count)
+{
+    /* Entries due for TX keep their deadline until they're reported as
+       transmitted, pull them out of the heap while collecting. Collect as many
+       as possible, so that high priority classes can go before the rest. */
+    uint16_t tx_entries[HANDLE_STORAGE_TX_PACKETS_MAX];
+    uint32_t collected = 0;
+
+    if (*p_count > HANDLE_STORAGE_TX_PACKETS_MAX)
+    {
+        *p_count = HANDLE_STORAGE_TX_PACKETS_MAX;
+    }
 
-        if ((m_data_cache[data_index].p_packet != NULL) &&
-            (trickle_is_enabled(&m_data_cache[data_index].trickle)) &&
-            !TIMER_OLDER_THAN(time_now, m_data_cache[data_index].trickle.t))
+    while (collected < HANDLE_STORAGE_TX_PACKETS_MAX &&
+           m_tx_heap_count > 0 &&
+           !TIMER_OLDER_THAN(time_now, TX_HEAP_DEADLINE(0)))
+    {
+        uint16_t data_index = m_tx_heap[0];
+        bool do_tx = false;
+        trickle_tx_timeout(&m_data_cache[data_index].trickle, &do_tx, time_now);
+        if (do_tx)
         {
-            bool do_tx = false;
-            trickle_tx_timeout(&m_data_cache[data_index].trickle, &do_tx, time_now);
-            if (do_tx)
+            tx_heap_remove(data_index);
+
+            /* stable insertion by class priority keeps deadline order within a class */
+            uint8_t priority = m_qos_tx_priority[m_data_cache[data_index].trickle.param_set];
+            uint32_t i = collected++;
+            while (i > 0 && m_qos_tx_priority[m_data_cache[tx_entries[i - 1]].trickle.param_set] > priority)
             {
-                mesh_packet_ref_count_inc(m_data_cache[data_index].p_packet); /* return the packet with an additional reference */
-                pp_packets[count++] = m_data_cache[data_index].p_packet;
-                if (count == *p_count)
-                {
-                    /* packet array is full */
-                    data_index++;
-                    return NRF_SUCCESS;
-                }
+                tx_entries[i] = tx_entries[i - 1];
+                i--;
             }
+            tx_entries[i] = data_index;
+        }
+        else
+        {
+            tx_heap_update(data_index);
+        }
+    }
+
+    /* entries that don't fit in the caller's array are still due, and will
+       be collected again next time */
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < collected && count < *p_count; ++i)
+    {
+        /* inline values that can't get a packet right now are due again next time */
+        mesh_packet_t* p_packet = data_entry_packet_get(tx_entries[i]);
+        if (p_packet != NULL)
+        {
+            pp_packets[count++] = p_packet; /* returned with an additional reference */
         }
-        data_index++;
+    }
+
+    for (uint32_t i = 0; i < collected; ++i)
+    {
+        tx_heap_update(tx_entries[i]);
     }
     *p_count = count;
 
@@ -698,7 +2131,7 @@ uint32_t handle_storage_transmitted(uint16_t handle, uint32_t timestamp)
         return NRF_ERROR_INVALID_ADDR;
     }
 
-    uint16_t handle_index = handle_entry_get(handle, true);
+    uint16_t handle_index = handle_entry_get(handle);
     if (handle_index == HANDLE_CACHE_ENTRY_INVALID)
     {
         return NRF_ERROR_NOT_FOUND;
@@ -710,6 +2143,7 @@ uint32_t handle_storage_transmitted(uint16_t handle, uint32_t timestamp)
         return NRF_ERROR_NOT_FOUND;
     }
     trickle_tx_register(&m_data_cache[data_index].trickle, timestamp);
+    tx_heap_update(data_index);
 
     return NRF_SUCCESS;
 }
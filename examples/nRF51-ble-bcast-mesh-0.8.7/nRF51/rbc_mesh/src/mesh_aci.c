@@ -36,6 +36,7 @@
 #include "version.h"
 #include "mesh_packet.h"
 #include "rtt_log.h"
+#include "timer_scheduler.h"
 
 #ifdef BOOTLOADER
 #include "transport.h"
@@ -51,6 +52,15 @@
 #include "nrf_nvic.h"
 #endif
 
+#if MESH_ACI_EVENT_BATCH && !defined(BOOTLOADER)
+#define EVENT_BATCH_ENABLED
+#endif
+
+#if MESH_ACI_SNIFFER && !defined(BOOTLOADER)
+#define SNIFFER_ENABLED
+#define SNIFFER_EVT_HEADER_LEN  (1 /* opcode */ + 4 /* base time */ + 2 /* dropped */)
+#endif
+
 /* event push isn't present in the API header file. */
 extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt);
 
@@ -61,10 +71,188 @@ const nrf_clock_lf_cfg_t defaultClockSource = {.source        = NRF_CLOCK_LF_SRC
                                                .xtal_accuracy = 0};
 #endif
 
+#ifdef EVENT_BATCH_ENABLED
+static serial_evt_t m_batch_evt;
+static timer_event_t m_batch_timer;
+#endif
+
+#ifdef SNIFFER_ENABLED
+/* the sniffer is driven by the packet peek callback and the serial commands,
+   which both run in the event handler, so none of this needs IRQ masking. */
+static serial_cmd_params_sniffer_set_t m_sniffer_filter;
+static serial_evt_t m_sniffer_evt;
+static timer_event_t m_sniffer_timer;
+static uint16_t m_sniffer_unreported_drops;
+static struct
+{
+    uint32_t passed;
+    uint32_t filtered;
+    uint32_t dropped;
+    uint32_t frames;
+} m_sniffer_stats;
+#endif
+
 /*****************************************************************************
  * Static functions
  *****************************************************************************/
 
+#ifdef EVENT_BATCH_ENABLED
+static bool event_batch_flush(void)
+{
+    if (m_batch_evt.length <= 1)
+    {
+        return true;
+    }
+    if (!serial_handler_event_send(&m_batch_evt))
+    {
+        return false;
+    }
+    m_batch_evt.length = 1;
+    /* if the abort can't be queued, the timer fires on an empty batch, which is harmless. */
+    (void) timer_sch_abort(&m_batch_timer);
+    return true;
+}
+
+static void event_batch_timeout(timestamp_t timestamp, void* p_context)
+{
+    if (!event_batch_flush())
+    {
+        /* serial queue is full, try again later */
+        (void) timer_sch_reschedule(&m_batch_timer, timestamp + MESH_ACI_EVENT_BATCH_TIMEOUT_US);
+    }
+}
+
+static void event_batch_append(uint8_t opcode, rbc_mesh_value_handle_t handle, uint8_t* p_data, uint8_t length)
+{
+    uint32_t used = m_batch_evt.length - 1;
+    if (used + SERIAL_EVT_BATCH_RECORD_OVERHEAD + length > SERIAL_EVT_BATCH_CAPACITY)
+    {
+        if (!event_batch_flush())
+        {
+            /* drop the oldest events, like a full serial queue drops single events. */
+            m_batch_evt.length = 1;
+        }
+        used = 0;
+    }
+
+    serial_evt_batch_record_t* p_record = (serial_evt_batch_record_t*) &m_batch_evt.params.event_batch.records[used];
+    p_record->opcode = opcode;
+    p_record->handle = handle;
+    p_record->length = length;
+    memcpy(p_record->data, p_data, length);
+    m_batch_evt.length += SERIAL_EVT_BATCH_RECORD_OVERHEAD + length;
+
+    if (used == 0)
+    {
+        /* time out relative to the oldest event in the batch */
+        (void) timer_sch_reschedule(&m_batch_timer, timer_now() + MESH_ACI_EVENT_BATCH_TIMEOUT_US);
+    }
+}
+#endif
+
+#ifdef SNIFFER_ENABLED
+static bool sniffer_flush(void)
+{
+    if (m_sniffer_evt.length <= SNIFFER_EVT_HEADER_LEN)
+    {
+        return true;
+    }
+    m_sniffer_evt.params.event_sniffer.dropped = m_sniffer_unreported_drops;
+    if (!serial_handler_event_send(&m_sniffer_evt))
+    {
+        return false;
+    }
+    m_sniffer_stats.frames++;
+    m_sniffer_unreported_drops = 0;
+    m_sniffer_evt.length = SNIFFER_EVT_HEADER_LEN;
+    (void) timer_sch_abort(&m_sniffer_timer);
+    return true;
+}
+
+static void sniffer_frame_drop(void)
+{
+    uint32_t count = (m_sniffer_evt.length - SNIFFER_EVT_HEADER_LEN) / sizeof(serial_evt_sniffer_record_t);
+    m_sniffer_stats.dropped += count;
+    if (m_sniffer_unreported_drops + count > UINT16_MAX)
+    {
+        m_sniffer_unreported_drops = UINT16_MAX;
+    }
+    else
+    {
+        m_sniffer_unreported_drops += count;
+    }
+    m_sniffer_evt.length = SNIFFER_EVT_HEADER_LEN;
+}
+
+static void sniffer_timeout(timestamp_t timestamp, void* p_context)
+{
+    if (!sniffer_flush())
+    {
+        /* serial queue is full, try again later */
+        (void) timer_sch_reschedule(&m_sniffer_timer, timestamp + MESH_ACI_SNIFFER_TIMEOUT_US);
+    }
+}
+
+static bool sniffer_filter_match(rbc_mesh_packet_peek_params_t* p_peek_params, mesh_adv_data_t* p_adv_data)
+{
+    if (p_adv_data == NULL ||
+        p_adv_data->handle < m_sniffer_filter.handle_min ||
+        p_adv_data->handle > m_sniffer_filter.handle_max ||
+        -((int32_t) p_peek_params->rssi) < m_sniffer_filter.rssi_min)
+    {
+        return false;
+    }
+    if (m_sniffer_filter.addr_filter &&
+        (p_peek_params->adv_addr.addr_type != m_sniffer_filter.addr_type ||
+         memcmp(p_peek_params->adv_addr.addr, m_sniffer_filter.addr, BLE_GAP_ADDR_LEN) != 0))
+    {
+        return false;
+    }
+    return true;
+}
+
+static void sniffer_packet_peek(rbc_mesh_packet_peek_params_t* p_peek_params)
+{
+    /* runs inline in the packet processing, keep it short */
+    mesh_adv_data_t* p_adv_data =
+        mesh_packet_adv_data_get(mesh_packet_get_aligned(p_peek_params->p_payload));
+    if (!sniffer_filter_match(p_peek_params, p_adv_data))
+    {
+        m_sniffer_stats.filtered++;
+        return;
+    }
+    m_sniffer_stats.passed++;
+
+    timestamp_t timestamp = (timestamp_t) p_peek_params->timestamp;
+    uint32_t used = m_sniffer_evt.length - SNIFFER_EVT_HEADER_LEN;
+    if (used > 0 &&
+        (used + sizeof(serial_evt_sniffer_record_t) > SERIAL_EVT_SNIFFER_CAPACITY ||
+         timestamp - m_sniffer_evt.params.event_sniffer.base_time > UINT16_MAX))
+    {
+        if (!sniffer_flush())
+        {
+            /* drop the oldest records, the host sees the gap in the next frame. */
+            sniffer_frame_drop();
+        }
+        used = 0;
+    }
+
+    if (used == 0)
+    {
+        m_sniffer_evt.params.event_sniffer.base_time = timestamp;
+        (void) timer_sch_reschedule(&m_sniffer_timer, timer_now() + MESH_ACI_SNIFFER_TIMEOUT_US);
+    }
+
+    serial_evt_sniffer_record_t* p_record = (serial_evt_sniffer_record_t*) &m_sniffer_evt.params.event_sniffer.records[used];
+    p_record->time_offset = timestamp - m_sniffer_evt.params.event_sniffer.base_time;
+    p_record->rssi = p_peek_params->rssi;
+    p_record->src = p_peek_params->adv_addr.addr[0] | (p_peek_params->adv_addr.addr[1] << 8);
+    p_record->handle = p_adv_data->handle;
+    p_record->version = p_adv_data->version;
+    m_sniffer_evt.length += sizeof(serial_evt_sniffer_record_t);
+}
+#endif
+
 static aci_status_code_t error_code_translate(uint32_t nrf_error_code)
 {
     switch (nrf_error_code)
@@ -90,6 +278,136 @@ static aci_status_code_t error_code_translate(uint32_t nrf_error_code)
     }
 }
 
+#ifndef BOOTLOADER
+/** Split the records of a value set bulk command into handle-value pairs. */
+static bool value_records_parse(serial_cmd_t* p_serial_cmd, rbc_mesh_value_t* p_values, uint32_t* p_count)
+{
+    const uint32_t total_len = p_serial_cmd->length - 1;
+    uint32_t i = 0;
+    *p_count = 0;
+    while (i < total_len)
+    {
+        if (*p_count == SERIAL_CMD_VALUE_BULK_MAX_COUNT ||
+            i + SERIAL_CMD_VALUE_RECORD_OVERHEAD > total_len)
+        {
+            return false;
+        }
+        serial_value_record_t* p_record = (serial_value_record_t*) &p_serial_cmd->params.value_set_bulk.records[i];
+        i += SERIAL_CMD_VALUE_RECORD_OVERHEAD + p_record->length;
+        if (p_record->length > RBC_MESH_VALUE_MAX_LEN || i > total_len)
+        {
+            return false;
+        }
+        p_values[*p_count].handle = p_record->handle;
+        p_values[*p_count].p_data = p_record->data;
+        p_values[*p_count].length = p_record->length;
+        (*p_count)++;
+    }
+    return (*p_count > 0);
+}
+
+/** Tell the application about a value set over the serial interface. */
+static uint32_t app_value_update_notify(const rbc_mesh_value_t* p_value)
+{
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    rbc_mesh_event_t app_evt;
+    memcpy(p_packet->payload, p_value->p_data, p_value->length);
+    memset(&app_evt, 0, sizeof(app_evt));
+    app_evt.type = RBC_MESH_EVENT_TYPE_UPDATE_VAL;
+    app_evt.params.rx.p_data = p_packet->payload;
+    app_evt.params.rx.data_len = p_value->length;
+    app_evt.params.rx.value_handle = p_value->handle;
+    app_evt.params.rx.timestamp_us = timer_now();
+
+    uint32_t error_code = rbc_mesh_event_push(&app_evt);
+    mesh_packet_ref_count_dec(p_packet);
+    return error_code;
+}
+
+/** Send value dump frames from the given cursor, and move the cursor past the
+  values that were sent. Stops after MESH_ACI_VALUE_DUMP_FRAMES frames, or
+  when the serial queue is full, to let the host pull the rest at its own
+  pace. */
+static uint32_t value_dump_send(uint16_t* p_cursor)
+{
+    serial_evt_t dump_evt;
+    dump_evt.opcode = SERIAL_EVT_OPCODE_EVENT_VALUE_DUMP;
+    uint16_t cursor = *p_cursor;
+    uint32_t frames = 0;
+
+    while (cursor != SERIAL_VALUE_DUMP_CURSOR_END && frames < MESH_ACI_VALUE_DUMP_FRAMES)
+    {
+        uint32_t used = 0;
+        uint16_t next = cursor;
+        uint32_t error_code;
+        while (true)
+        {
+            uint16_t value_cursor = next;
+            rbc_mesh_value_handle_t handle;
+            uint16_t version;
+            uint8_t data[RBC_MESH_LEGACY_VALUE_MAX_LEN];
+            uint16_t length = RBC_MESH_LEGACY_VALUE_MAX_LEN;
+            error_code = rbc_mesh_value_next(&value_cursor, &handle, data, &length, &version);
+            if (error_code == NRF_ERROR_INVALID_LENGTH)
+            {
+                /* long packet values don't fit in a serial frame */
+                next = value_cursor + 1;
+                continue;
+            }
+            if (error_code != NRF_SUCCESS ||
+                used + SERIAL_EVT_VALUE_DUMP_RECORD_OVERHEAD + length > SERIAL_EVT_VALUE_DUMP_CAPACITY)
+            {
+                break;
+            }
+
+            serial_evt_value_dump_record_t* p_record = (serial_evt_value_dump_record_t*) &dump_evt.params.event_value_dump.records[used];
+            p_record->handle = handle;
+            p_record->version = version;
+            p_record->length = length;
+            memcpy(p_record->data, data, length);
+            used += SERIAL_EVT_VALUE_DUMP_RECORD_OVERHEAD + length;
+            next = value_cursor;
+        }
+
+        if (error_code == NRF_ERROR_NOT_FOUND)
+        {
+            next = SERIAL_VALUE_DUMP_CURSOR_END;
+            if (used == 0)
+            {
+                /* the previous frame had the last value */
+                cursor = next;
+                break;
+            }
+        }
+        else if (error_code != NRF_SUCCESS)
+        {
+            return error_code;
+        }
+
+        dump_evt.params.event_value_dump.cursor = next;
+        dump_evt.length = 1 + sizeof(uint16_t) + used;
+        if (!serial_handler_event_send(&dump_evt))
+        {
+            break;
+        }
+        cursor = next;
+        frames++;
+    }
+
+    if (frames == 0 && cursor != SERIAL_VALUE_DUMP_CURSOR_END)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    *p_cursor = cursor;
+    return NRF_SUCCESS;
+}
+#endif
+
 /**
  * Handle events coming in on the serial line
  */
@@ -108,6 +426,10 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
     uint32_t error_code;
     rbc_mesh_event_t app_evt;
     (void) app_evt;
+#ifdef EVENT_BATCH_ENABLED
+    /* keep value events ahead of the command response */
+    (void) event_batch_flush();
+#endif
     switch (p_serial_cmd->opcode)
     {
         case SERIAL_CMD_OPCODE_ECHO:
@@ -295,7 +617,7 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
         case SERIAL_CMD_OPCODE_VALUE_GET:
             serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
             serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
-            serial_evt.length = RBC_MESH_VALUE_MAX_LEN; /* signal to the framework that we can fit the entire payload in our buffer */
+            serial_evt.length = RBC_MESH_LEGACY_VALUE_MAX_LEN; /* signal to the framework that we can fit the entire payload in our buffer */
 
             if (p_serial_cmd->length != sizeof(serial_cmd_params_value_get_t) + 1)
             {
@@ -317,6 +639,120 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
             serial_handler_event_send(&serial_evt);
             break;
 
+        case SERIAL_CMD_OPCODE_VALUE_SET_BULK:
+            {
+                serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+                serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+                serial_evt.length = 3;
+
+                rbc_mesh_value_t values[SERIAL_CMD_VALUE_BULK_MAX_COUNT];
+                uint32_t count = 0;
+                if (!value_records_parse(p_serial_cmd, values, &count))
+                {
+                    serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+                }
+                else
+                {
+                    uint32_t success_mask;
+                    error_code = rbc_mesh_value_set_bulk(values, count, &success_mask);
+
+                    /* notify application */
+                    for (uint32_t i = 0; i < count; ++i)
+                    {
+                        if ((success_mask & (1 << i)) &&
+                            app_value_update_notify(&values[i]) != NRF_SUCCESS &&
+                            error_code == NRF_SUCCESS)
+                        {
+                            error_code = NRF_ERROR_NO_MEM;
+                        }
+                    }
+
+                    serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+                    serial_evt.params.cmd_rsp.response.val_set_bulk.success_mask = success_mask;
+                    serial_evt.length += sizeof(serial_evt_cmd_rsp_params_val_set_bulk_t);
+                }
+
+                serial_handler_event_send(&serial_evt);
+                break;
+            }
+
+        case SERIAL_CMD_OPCODE_VALUE_GET_BULK:
+            {
+                serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+                serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+                serial_evt.length = 3;
+
+                const uint32_t count = (p_serial_cmd->length - 1) / sizeof(rbc_mesh_value_handle_t);
+                if (count == 0 ||
+                    count > SERIAL_CMD_VALUE_BULK_MAX_COUNT ||
+                    (p_serial_cmd->length - 1) % sizeof(rbc_mesh_value_handle_t) != 0)
+                {
+                    serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+                }
+                else
+                {
+                    uint16_t success_mask = 0;
+                    uint32_t used = 0;
+                    aci_status_code_t status = ACI_STATUS_SUCCESS;
+                    for (uint32_t i = 0; i < count; ++i)
+                    {
+                        uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+                        uint16_t length = RBC_MESH_VALUE_MAX_LEN;
+                        error_code = rbc_mesh_value_get(p_serial_cmd->params.value_get_bulk.handles[i], data, &length);
+                        if (error_code == NRF_SUCCESS &&
+                            used + SERIAL_CMD_VALUE_RECORD_OVERHEAD + length > SERIAL_EVT_VALUE_GET_BULK_CAPACITY)
+                        {
+                            /* left out, the host can ask for it again */
+                            error_code = NRF_ERROR_INVALID_LENGTH;
+                        }
+
+                        if (error_code == NRF_SUCCESS)
+                        {
+                            serial_value_record_t* p_record = (serial_value_record_t*) &serial_evt.params.cmd_rsp.response.val_get_bulk.records[used];
+                            p_record->handle = p_serial_cmd->params.value_get_bulk.handles[i];
+                            p_record->length = length;
+                            memcpy(p_record->data, data, length);
+                            used += SERIAL_CMD_VALUE_RECORD_OVERHEAD + length;
+                            success_mask |= (1 << i);
+                        }
+                        else if (status == ACI_STATUS_SUCCESS)
+                        {
+                            status = error_code_translate(error_code);
+                        }
+                    }
+
+                    serial_evt.params.cmd_rsp.status = status;
+                    serial_evt.params.cmd_rsp.response.val_get_bulk.success_mask = success_mask;
+                    serial_evt.length += sizeof(uint16_t) + used;
+                }
+
+                serial_handler_event_send(&serial_evt);
+                break;
+            }
+
+        case SERIAL_CMD_OPCODE_VALUE_DUMP:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != sizeof(serial_cmd_params_value_dump_t) + 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else
+            {
+                /* the dump frames go out ahead of the response, which tells
+                   the host where to continue */
+                uint16_t cursor = p_serial_cmd->params.value_dump.cursor;
+                error_code = value_dump_send(&cursor);
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+                serial_evt.params.cmd_rsp.response.value_dump.cursor = cursor;
+                serial_evt.length += sizeof(serial_evt_cmd_rsp_params_value_dump_t);
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
         case SERIAL_CMD_OPCODE_BUILD_VERSION_GET:
             serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
             serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
@@ -399,6 +835,175 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
             serial_handler_event_send(&serial_evt);
             break;
 
+        case SERIAL_CMD_OPCODE_STATS_GET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3 + SERIAL_EVT_STATS_LEN;
+
+            if (p_serial_cmd->length != 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+                serial_evt.length = 3;
+            }
+            else
+            {
+                /* response is unaligned, copy it in bytewise */
+                rbc_mesh_stats_t stats;
+                error_code = rbc_mesh_stats_get(&stats);
+                memcpy(&serial_evt.params.cmd_rsp.response.stats.stats, &stats, SERIAL_EVT_STATS_LEN);
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+                if (error_code != NRF_SUCCESS)
+                {
+                    serial_evt.length = 3;
+                }
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+        case SERIAL_CMD_OPCODE_SURVEY_SET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != sizeof(serial_cmd_params_survey_set_t) + 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else
+            {
+                if (p_serial_cmd->params.survey_set.interval_ms == 0)
+                {
+                    error_code = rbc_mesh_survey_stop();
+                }
+                else
+                {
+                    error_code = rbc_mesh_survey_start(p_serial_cmd->params.survey_set.interval_ms);
+                }
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+        case SERIAL_CMD_OPCODE_SURVEY_GET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != sizeof(serial_cmd_params_survey_get_t) + 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else
+            {
+                /* response is unaligned, fill it in field by field */
+                rbc_mesh_survey_entry_t entry;
+                serial_evt_cmd_rsp_params_survey_get_t* p_rsp = &serial_evt.params.cmd_rsp.response.survey_get;
+                error_code = rbc_mesh_survey_entry_get(p_serial_cmd->params.survey_get.index, &entry);
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+                if (error_code == NRF_SUCCESS)
+                {
+                    p_rsp->addr_type = entry.addr.addr_type;
+                    memcpy(p_rsp->addr, entry.addr.addr, BLE_GAP_ADDR_LEN);
+                    p_rsp->channel = entry.channel;
+                    p_rsp->tx_power = entry.tx_power;
+                    p_rsp->rssi_avg = entry.rssi_avg;
+                    p_rsp->rssi_worst = entry.rssi_worst;
+                    p_rsp->received = entry.received;
+                    p_rsp->expected = entry.expected;
+                    serial_evt.length += sizeof(serial_evt_cmd_rsp_params_survey_get_t);
+                }
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+        case SERIAL_CMD_OPCODE_FAULT_GET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != sizeof(serial_cmd_params_fault_get_t) + 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else
+            {
+                /* response is unaligned, copy it in bytewise */
+                rbc_mesh_fault_record_t record;
+                error_code = rbc_mesh_fault_get(p_serial_cmd->params.fault_get.index, &record);
+                serial_evt.params.cmd_rsp.status = error_code_translate(error_code);
+                if (error_code == NRF_SUCCESS)
+                {
+                    memcpy(&serial_evt.params.cmd_rsp.response.fault_get.record, &record, sizeof(record));
+                    serial_evt.length += sizeof(serial_evt_cmd_rsp_params_fault_get_t);
+                }
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+#ifdef SNIFFER_ENABLED
+        case SERIAL_CMD_OPCODE_SNIFFER_SET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != sizeof(serial_cmd_params_sniffer_set_t) + 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else if (p_serial_cmd->params.sniffer_set.enable &&
+                     p_serial_cmd->params.sniffer_set.handle_min > p_serial_cmd->params.sniffer_set.handle_max)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_PARAMETER;
+            }
+            else
+            {
+                if (p_serial_cmd->params.sniffer_set.enable)
+                {
+                    memcpy(&m_sniffer_filter, &p_serial_cmd->params.sniffer_set, sizeof(m_sniffer_filter));
+                    memset(&m_sniffer_stats, 0, sizeof(m_sniffer_stats));
+                    rbc_mesh_packet_peek_cb_set(sniffer_packet_peek);
+                }
+                else
+                {
+                    rbc_mesh_packet_peek_cb_set(NULL);
+                    /* if the queue is full, the timer sends the last frame */
+                    (void) sniffer_flush();
+                }
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_SUCCESS;
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+
+        case SERIAL_CMD_OPCODE_SNIFFER_STATS_GET:
+            serial_evt.opcode = SERIAL_EVT_OPCODE_CMD_RSP;
+            serial_evt.params.cmd_rsp.command_opcode = p_serial_cmd->opcode;
+            serial_evt.length = 3;
+
+            if (p_serial_cmd->length != 1)
+            {
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_ERROR_INVALID_LENGTH;
+            }
+            else
+            {
+                /* response is unaligned, fill it in field by field */
+                serial_evt_cmd_rsp_params_sniffer_stats_t* p_rsp = &serial_evt.params.cmd_rsp.response.sniffer_stats;
+                p_rsp->passed = m_sniffer_stats.passed;
+                p_rsp->filtered = m_sniffer_stats.filtered;
+                p_rsp->dropped = m_sniffer_stats.dropped;
+                p_rsp->frames = m_sniffer_stats.frames;
+                serial_evt.params.cmd_rsp.status = ACI_STATUS_SUCCESS;
+                serial_evt.length += sizeof(serial_evt_cmd_rsp_params_sniffer_stats_t);
+            }
+
+            serial_handler_event_send(&serial_evt);
+            break;
+#endif
+
 #endif /* BOOTLOADER */
 
         case SERIAL_CMD_OPCODE_FLAG_SET:
@@ -503,6 +1108,7 @@ static void serial_command_handler(serial_cmd_t* p_serial_cmd)
                 rx_cmd.type = BL_CMD_TYPE_RX;
                 rx_cmd.params.rx.p_dfu_packet = &p_serial_cmd->params.dfu.packet;
                 rx_cmd.params.rx.length = p_serial_cmd->length - SERIAL_PACKET_OVERHEAD;
+                rx_cmd.params.rx.from_serial = true;
                 error_code = bootloader_cmd_send(&rx_cmd);
 #elif defined(MESH_DFU)
                 error_code = dfu_rx(&p_serial_cmd->params.dfu.packet, p_serial_cmd->length - SERIAL_PACKET_OVERHEAD);
@@ -542,6 +1148,18 @@ void mesh_aci_init(void)
     NVIC_EnableIRQ(SWI1_IRQn);
 #else
     event_handler_init();
+#endif
+#ifdef EVENT_BATCH_ENABLED
+    m_batch_evt.length = 1;
+    m_batch_evt.opcode = SERIAL_EVT_OPCODE_EVENT_BATCH;
+    memset(&m_batch_timer, 0, sizeof(m_batch_timer));
+    m_batch_timer.cb = event_batch_timeout;
+#endif
+#ifdef SNIFFER_ENABLED
+    m_sniffer_evt.length = SNIFFER_EVT_HEADER_LEN;
+    m_sniffer_evt.opcode = SERIAL_EVT_OPCODE_EVENT_SNIFFER;
+    memset(&m_sniffer_timer, 0, sizeof(m_sniffer_timer));
+    m_sniffer_timer.cb = sniffer_timeout;
 #endif
     serial_handler_init();
 }
@@ -609,6 +1227,15 @@ void mesh_aci_rbc_event_handler(rbc_mesh_event_t* evt)
             break;
     }
 
+    if (evt->params.rx.data_len > RBC_MESH_LEGACY_VALUE_MAX_LEN)
+    {
+        /* long packet values don't fit in a serial event */
+        return;
+    }
+
+#ifdef EVENT_BATCH_ENABLED
+    event_batch_append(serial_evt.opcode, evt->params.rx.value_handle, evt->params.rx.p_data, evt->params.rx.data_len);
+#else
     /* serial overhead: opcode + handle = 3 */
     serial_evt.length = 3 + evt->params.rx.data_len;
 
@@ -617,5 +1244,6 @@ void mesh_aci_rbc_event_handler(rbc_mesh_event_t* evt)
     memcpy(serial_evt.params.event_update.data, evt->params.rx.p_data, evt->params.rx.data_len);
 
     serial_handler_event_send(&serial_evt);
+#endif
 }
 
@@ -0,0 +1,283 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_ant_bridge.h"
+
+#ifdef RBC_MESH_ANT_BRIDGE
+
+#include <string.h>
+#include <stdbool.h>
+#include "timebase.h"
+#include "toolchain.h"
+#include "ant_interface.h"
+#include "ant_parameters.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+/** Toggle bit sent in the page number byte by some ANT+ profiles. */
+#define ANT_BRIDGE_PAGE_TOGGLE_MASK     (0x80)
+/** Payload bytes compared by default, all but the page number. */
+#define ANT_BRIDGE_COMPARE_MASK         (0xFE)
+
+/** Publishing state of a mapped page. */
+typedef struct
+{
+    uint8_t published[ANT_STANDARD_DATA_PAYLOAD_SIZE];  /** Last value set in the mesh. */
+    uint8_t pending[ANT_STANDARD_DATA_PAYLOAD_SIZE];    /** Changed value waiting for the interval to pass. */
+    uint32_t publish_time_ms;                           /** Time of the last publish. */
+    bool has_published;
+    bool has_pending;
+} page_state_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static mesh_ant_bridge_config_t m_config;
+static mesh_ant_bridge_stats_t m_stats;
+static bool             m_started;      /** mesh_ant_bridge_init() has been called. */
+static page_state_t     m_pages[RBC_MESH_ANT_BRIDGE_PAGES_MAX];
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint32_t now_ms(void)
+{
+    return (uint32_t) (timebase_now() / 1000);
+}
+
+static bool payload_changed(const uint8_t* p_old, const uint8_t* p_new, uint8_t ignore_mask)
+{
+    uint8_t compare_mask = ANT_BRIDGE_COMPARE_MASK & ~ignore_mask;
+    for (uint32_t i = 0; i < ANT_STANDARD_DATA_PAYLOAD_SIZE; ++i)
+    {
+        if ((compare_mask & (1 << i)) && p_old[i] != p_new[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void page_publish(uint32_t index, uint32_t time_ms)
+{
+    page_state_t* p_page = &m_pages[index];
+    if (rbc_mesh_value_set(m_config.p_pages[index].handle,
+                p_page->pending,
+                ANT_STANDARD_DATA_PAYLOAD_SIZE) != NRF_SUCCESS)
+    {
+        /* keep it pending, and try again on the next event */
+        m_stats.set_failures++;
+        return;
+    }
+    memcpy(p_page->published, p_page->pending, ANT_STANDARD_DATA_PAYLOAD_SIZE);
+    p_page->publish_time_ms = time_ms;
+    p_page->has_published = true;
+    p_page->has_pending = false;
+    m_stats.values_set++;
+}
+
+/** Publish the pending pages whose interval has passed. */
+static void pending_flush(uint32_t time_ms)
+{
+    for (uint32_t i = 0; i < m_config.page_count; ++i)
+    {
+        if (m_pages[i].has_pending &&
+            time_ms - m_pages[i].publish_time_ms >= RBC_MESH_ANT_BRIDGE_INTERVAL_MS)
+        {
+            page_publish(i, time_ms);
+        }
+    }
+}
+
+static void page_rx(const uint8_t* p_payload, uint32_t time_ms)
+{
+    m_stats.messages++;
+
+    uint8_t page_number = p_payload[0] & ~ANT_BRIDGE_PAGE_TOGGLE_MASK;
+    uint32_t index;
+    for (index = 0; index < m_config.page_count; ++index)
+    {
+        if (m_config.p_pages[index].page == page_number)
+        {
+            break;
+        }
+    }
+    if (index == m_config.page_count)
+    {
+        m_stats.unmapped++;
+        return;
+    }
+
+    page_state_t* p_page = &m_pages[index];
+    uint8_t ignore_mask = m_config.p_pages[index].ignore_mask;
+    if (p_page->has_published &&
+        !payload_changed(p_page->published, p_payload, ignore_mask))
+    {
+        /* changed back before the pending change was published */
+        if (p_page->has_pending)
+        {
+            p_page->has_pending = false;
+            m_stats.coalesced++;
+        }
+        m_stats.unchanged++;
+        return;
+    }
+
+    if (p_page->has_pending)
+    {
+        if (!payload_changed(p_page->pending, p_payload, ignore_mask))
+        {
+            m_stats.unchanged++;
+            return;
+        }
+        m_stats.coalesced++;
+    }
+    memcpy(p_page->pending, p_payload, ANT_STANDARD_DATA_PAYLOAD_SIZE);
+    p_page->has_pending = true;
+
+    if (!p_page->has_published)
+    {
+        page_publish(index, time_ms);
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+uint32_t mesh_ant_bridge_init(const mesh_ant_bridge_config_t* p_config)
+{
+    if (m_started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_config == NULL || p_config->p_pages == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (p_config->page_count == 0 ||
+        p_config->page_count > RBC_MESH_ANT_BRIDGE_PAGES_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    for (uint32_t i = 0; i < p_config->page_count; ++i)
+    {
+        if (p_config->p_pages[i].handle > RBC_MESH_APP_MAX_HANDLE)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    uint32_t error_code;
+    error_code = sd_ant_channel_assign(p_config->channel,
+            CHANNEL_TYPE_SLAVE_RX_ONLY,
+            p_config->network,
+            0);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    error_code = sd_ant_channel_id_set(p_config->channel,
+            p_config->device_number,
+            p_config->device_type,
+            p_config->transmission_type);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    error_code = sd_ant_channel_radio_freq_set(p_config->channel, p_config->rf_freq);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    error_code = sd_ant_channel_period_set(p_config->channel, p_config->period);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
+    m_config = *p_config;
+    memset(&m_stats, 0, sizeof(m_stats));
+    memset(m_pages, 0, sizeof(m_pages));
+
+    error_code = sd_ant_channel_open(p_config->channel);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    m_started = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_ant_bridge_stats_get(mesh_ant_bridge_stats_t* p_stats)
+{
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    memcpy(p_stats, &m_stats, sizeof(m_stats));
+    return NRF_SUCCESS;
+}
+
+void mesh_ant_bridge_ant_evt_handler(ant_evt_t* p_ant_evt)
+{
+    if (!m_started || p_ant_evt->channel != m_config.channel)
+    {
+        return;
+    }
+
+    uint32_t time_ms = now_ms();
+    ANT_MESSAGE* p_message = (ANT_MESSAGE*) p_ant_evt->evt_buffer;
+    switch (p_ant_evt->event)
+    {
+        case EVENT_RX:
+            if (p_message->ANT_MESSAGE_ucMesgID == MESG_BROADCAST_DATA_ID ||
+                p_message->ANT_MESSAGE_ucMesgID == MESG_ACKNOWLEDGED_DATA_ID)
+            {
+                page_rx(p_message->ANT_MESSAGE_aucPayload, time_ms);
+            }
+            break;
+        case EVENT_RX_FAIL:
+            m_stats.rx_fails++;
+            break;
+        case EVENT_CHANNEL_CLOSED:
+            /* the search timed out, keep looking for the sensor */
+            (void) sd_ant_channel_open(m_config.channel);
+            break;
+        default:
+            break;
+    }
+
+    /* every channel event is a chance to publish, the sensor's message
+       period bounds how late a coalesced change can be */
+    pending_flush(time_ms);
+}
+
+#endif /* RBC_MESH_ANT_BRIDGE */
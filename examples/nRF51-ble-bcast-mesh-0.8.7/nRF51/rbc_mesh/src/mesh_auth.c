@@ -0,0 +1,395 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_auth.h"
+
+#include <string.h>
+#include "nrf_error.h"
+
+#ifdef MESH_AUTH
+
+#include "mesh_stats.h"
+#include "toolchain.h"
+#include "nrf_soc.h"
+
+#if RBC_MESH_COMPACT_STORAGE
+#error "MESH_AUTH can't be combined with RBC_MESH_COMPACT_STORAGE, values rebuilt from the compact cache lose their signature"
+#endif
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define AUTH_KEY_LEN            (16)
+#define AUTH_SEQ_LEN            (4)
+#define AUTH_MIC_LEN            (4)
+#define AES_BLOCK_LEN           (16)
+#define CCM_NONCE_OFFSET        (1) /* nonce follows the flags byte in both B0 and A0 */
+#define CCM_B0_FLAGS            (0x40 /* AAD present */ | (((AUTH_MIC_LEN - 2) / 2) << 3) | (2 - 1) /* 2 byte length field */)
+#define CCM_A0_FLAGS            (2 - 1)
+#define AAD_OFFSET              (4) /* handle and version follow the adv data length, type and UUID */
+
+#if (RBC_MESH_AUTH_OVERHEAD != AUTH_SEQ_LEN + AUTH_MIC_LEN)
+#error "RBC_MESH_AUTH_OVERHEAD doesn't match the trailer layout"
+#endif
+
+#ifdef SOFTDEVICE_PRESENT
+typedef nrf_ecb_hal_data_t ecb_data_t;
+#else
+/** Data structure the ECB peripheral works on. */
+typedef struct
+{
+    uint8_t key[AES_BLOCK_LEN];
+    uint8_t cleartext[AES_BLOCK_LEN];
+    uint8_t ciphertext[AES_BLOCK_LEN];
+} ecb_data_t;
+#endif
+
+typedef struct
+{
+    ble_gap_addr_t  addr;
+    uint32_t        seq;    /**< Highest sequence number accepted from the source. */
+} auth_source_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static uint8_t          m_key[AUTH_KEY_LEN];
+static bool             m_key_is_set;
+static uint32_t         m_seq;              /**< Next sequence number to sign with, 0 when exhausted. */
+static auth_source_t    m_sources[RBC_MESH_AUTH_SOURCES]; /**< Most recently heard first. */
+static uint32_t         m_source_count;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+/** Encrypt the cleartext block of p_ecb, through the Softdevice if it's present. */
+static uint32_t ecb_encrypt(ecb_data_t* p_ecb)
+{
+#ifdef SOFTDEVICE_PRESENT
+    return sd_ecb_block_encrypt(p_ecb);
+#else
+    NRF_ECB->ECBDATAPTR = (uint32_t) p_ecb;
+    NRF_ECB->EVENTS_ENDECB = 0;
+    NRF_ECB->EVENTS_ERRORECB = 0;
+    NRF_ECB->TASKS_STARTECB = 1;
+    while (!NRF_ECB->EVENTS_ENDECB && !NRF_ECB->EVENTS_ERRORECB);
+    return (NRF_ECB->EVENTS_ENDECB ? NRF_SUCCESS : NRF_ERROR_INTERNAL);
+#endif
+}
+
+/** Get the trailer of a value packet, or NULL if it isn't one. */
+static uint8_t* trailer_get(mesh_packet_t* p_packet)
+{
+    mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(p_packet);
+    if (p_adv == NULL ||
+        p_adv->adv_data_length < MESH_PACKET_ADV_OVERHEAD ||
+        p_adv->handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NULL;
+    }
+    return ((uint8_t*) p_adv) + 1 + p_adv->adv_data_length - RBC_MESH_AUTH_OVERHEAD;
+}
+
+static uint32_t seq_read(const uint8_t* p_trailer)
+{
+    return (p_trailer[0] | (p_trailer[1] << 8) | (p_trailer[2] << 16) | ((uint32_t) p_trailer[3] << 24));
+}
+
+static void seq_write(uint8_t* p_trailer, uint32_t seq)
+{
+    for (uint32_t i = 0; i < AUTH_SEQ_LEN; ++i)
+    {
+        p_trailer[i] = (seq >> (8 * i)) & 0xFF;
+    }
+}
+
+/** Fill the nonce of a B0 or A0 block: originator address, address type and
+  sequence number, zero padded to 13 bytes. */
+static void nonce_set(uint8_t* p_block, const mesh_packet_t* p_packet, const uint8_t* p_trailer)
+{
+    memset(&p_block[CCM_NONCE_OFFSET], 0, AES_BLOCK_LEN - CCM_NONCE_OFFSET);
+    memcpy(&p_block[CCM_NONCE_OFFSET], p_packet->addr, BLE_GAP_ADDR_LEN);
+    p_block[CCM_NONCE_OFFSET + BLE_GAP_ADDR_LEN] = p_packet->header.addr_type;
+    memcpy(&p_block[CCM_NONCE_OFFSET + BLE_GAP_ADDR_LEN + 1], p_trailer, AUTH_SEQ_LEN);
+}
+
+/** Compute the AES-CCM MIC of a value packet, with the handle, version and
+  value as additional data and no payload. */
+static uint32_t mic_compute(mesh_packet_t* p_packet, const uint8_t* p_trailer, uint8_t* p_mic)
+{
+    mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(p_packet);
+    const uint8_t* p_aad = ((const uint8_t*) p_adv) + AAD_OFFSET;
+    const uint32_t aad_len = p_adv->adv_data_length + 1 - AAD_OFFSET - RBC_MESH_AUTH_OVERHEAD;
+
+    ecb_data_t ecb;
+    memcpy(ecb.key, m_key, AUTH_KEY_LEN);
+
+    /* B0, the message length field is 0 */
+    memset(ecb.cleartext, 0, AES_BLOCK_LEN);
+    ecb.cleartext[0] = CCM_B0_FLAGS;
+    nonce_set(ecb.cleartext, p_packet, p_trailer);
+    if (ecb_encrypt(&ecb) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    /* CBC-MAC over the 2 byte AAD length and the AAD, zero padded */
+    memcpy(ecb.cleartext, ecb.ciphertext, AES_BLOCK_LEN);
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < 2 + aad_len; ++i)
+    {
+        uint8_t byte;
+        if (i == 0)
+        {
+            byte = (aad_len >> 8) & 0xFF;
+        }
+        else if (i == 1)
+        {
+            byte = aad_len & 0xFF;
+        }
+        else
+        {
+            byte = p_aad[i - 2];
+        }
+        ecb.cleartext[pos++] ^= byte;
+        if (pos == AES_BLOCK_LEN || i + 1 == 2 + aad_len)
+        {
+            if (ecb_encrypt(&ecb) != NRF_SUCCESS)
+            {
+                return NRF_ERROR_INTERNAL;
+            }
+            memcpy(ecb.cleartext, ecb.ciphertext, AES_BLOCK_LEN);
+            pos = 0;
+        }
+    }
+
+    uint8_t tag[AUTH_MIC_LEN];
+    memcpy(tag, ecb.ciphertext, AUTH_MIC_LEN);
+
+    /* encrypt the tag with the first counter block */
+    memset(ecb.cleartext, 0, AES_BLOCK_LEN);
+    ecb.cleartext[0] = CCM_A0_FLAGS;
+    nonce_set(ecb.cleartext, p_packet, p_trailer);
+    if (ecb_encrypt(&ecb) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+    for (uint32_t i = 0; i < AUTH_MIC_LEN; ++i)
+    {
+        p_mic[i] = tag[i] ^ ecb.ciphertext[i];
+    }
+    return NRF_SUCCESS;
+}
+
+/** Find the replay table entry of the packet's originator, or m_source_count
+  if it's not in the table. */
+static uint32_t source_find(const mesh_packet_t* p_packet)
+{
+    for (uint32_t i = 0; i < m_source_count; ++i)
+    {
+        if (m_sources[i].addr.addr_type == p_packet->header.addr_type &&
+            memcmp(m_sources[i].addr.addr, p_packet->addr, BLE_GAP_ADDR_LEN) == 0)
+        {
+            return i;
+        }
+    }
+    return m_source_count;
+}
+
+static bool source_seq_is_replay(uint32_t index, uint32_t seq)
+{
+    return (index < m_source_count &&
+            seq <= m_sources[index].seq &&
+            m_sources[index].seq - seq >= RBC_MESH_AUTH_REPLAY_WINDOW);
+}
+
+/** Record an authentic sequence number, and make its source the most
+  recently heard. */
+static void source_seq_record(uint32_t index, const mesh_packet_t* p_packet, uint32_t seq)
+{
+    auth_source_t source;
+    if (index < m_source_count)
+    {
+        source = m_sources[index];
+        if (seq > source.seq)
+        {
+            source.seq = seq;
+        }
+    }
+    else
+    {
+        /* new source, forget the least recently heard one if full */
+        source.addr.addr_type = p_packet->header.addr_type;
+        memcpy(source.addr.addr, p_packet->addr, BLE_GAP_ADDR_LEN);
+        source.seq = seq;
+        if (m_source_count < RBC_MESH_AUTH_SOURCES)
+        {
+            m_source_count++;
+        }
+        index = m_source_count - 1;
+    }
+
+    /* move to the front */
+    memmove(&m_sources[1], &m_sources[0], index * sizeof(auth_source_t));
+    m_sources[0] = source;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_auth_init(void)
+{
+    memset(m_key, 0, AUTH_KEY_LEN);
+    m_key_is_set = false;
+    m_seq = 0;
+    m_source_count = 0;
+}
+
+uint32_t mesh_auth_key_set(const uint8_t* p_key, uint32_t seq_start)
+{
+    if (seq_start == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(m_key, p_key, AUTH_KEY_LEN);
+    m_seq = seq_start;
+    m_key_is_set = true;
+    /* sequence numbers heard under the old key mean nothing under the new one */
+    m_source_count = 0;
+    _ENABLE_IRQS(was_masked);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_auth_seq_get(uint32_t* p_seq)
+{
+    *p_seq = m_seq;
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_auth_packet_sign(mesh_packet_t* p_packet)
+{
+    uint8_t* p_trailer = trailer_get(p_packet);
+    if (p_trailer == NULL)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+    if (seq_read(p_trailer) != 0)
+    {
+        return NRF_SUCCESS; /* signed by us on an earlier transmission, or by its originator */
+    }
+    if (!m_key_is_set || m_seq == 0)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    seq_write(p_trailer, m_seq);
+    uint32_t error_code = mic_compute(p_packet, p_trailer, &p_trailer[AUTH_SEQ_LEN]);
+    if (error_code != NRF_SUCCESS)
+    {
+        seq_write(p_trailer, 0);
+        return error_code;
+    }
+    m_seq++; /* wraps to 0, which stops signing rather than reusing a nonce */
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_auth_packet_verify(const mesh_packet_t* p_packet)
+{
+    if (!m_key_is_set)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    mesh_packet_t* p_rx_packet = (mesh_packet_t*) p_packet;
+    const uint8_t* p_trailer = trailer_get(p_rx_packet);
+    if (p_trailer == NULL)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+    /* reject unsigned packets and replays before spending the AES blocks */
+    uint32_t seq = seq_read(p_trailer);
+    uint32_t source_index = source_find(p_packet);
+    if (seq == 0 || source_seq_is_replay(source_index, seq))
+    {
+        MESH_STATS_INC(rx_auth_fail);
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    uint8_t mic[AUTH_MIC_LEN];
+    uint32_t error_code = mic_compute(p_rx_packet, p_trailer, mic);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+
+    /* compare all bytes, so the time taken doesn't tell how many matched */
+    uint8_t diff = 0;
+    for (uint32_t i = 0; i < AUTH_MIC_LEN; ++i)
+    {
+        diff |= mic[i] ^ p_trailer[AUTH_SEQ_LEN + i];
+    }
+    if (diff != 0)
+    {
+        MESH_STATS_INC(rx_auth_fail);
+        return NRF_ERROR_INVALID_DATA;
+    }
+    source_seq_record(source_index, p_packet, seq);
+    return NRF_SUCCESS;
+}
+
+#else
+
+void mesh_auth_init(void)
+{
+}
+
+uint32_t mesh_auth_key_set(const uint8_t* p_key, uint32_t seq_start)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_auth_seq_get(uint32_t* p_seq)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_auth_packet_sign(mesh_packet_t* p_packet)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_auth_packet_verify(const mesh_packet_t* p_packet)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+#endif /* MESH_AUTH */
@@ -0,0 +1,208 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_coex.h"
+
+#include <string.h>
+#include "rbc_mesh_common.h"
+#include "nrf.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define RTC_MASK                        (0xFFFFFF)
+#define RTC_TICKS_TO_US(ticks)          ((uint32_t) (((uint64_t) (ticks) * 1000000) >> 15))
+/** Consecutive radio events at the same interval before the interval is trusted. */
+#define COEX_REGULAR_COUNT_MIN          (3)
+/** Interval changes within this fraction (as a shift) still count as regular, for the window widening of the slave. */
+#define COEX_INTERVAL_TOLERANCE_SHIFT   (4)
+/** Time kept free on both sides of the Softdevice radio events. */
+#define COEX_GUARD_US                   (500)
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static rbc_mesh_coex_stats_t m_stats;
+static bool                  m_active_valid;     /** m_active_rtc holds the start of a radio event. */
+static uint32_t              m_active_rtc;       /** RTC0 counter at the last radio notification of an upcoming event. */
+static uint32_t              m_interval_us;      /** Last interval between two radio events. */
+static uint32_t              m_regular_count;    /** Consecutive radio events at the same interval. */
+static uint32_t              m_busy_us;          /** Peak time from radio notification to the end of the event, decaying. */
+static bool                  m_flash_pending;    /** The application has Softdevice flash operations pending. */
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static inline uint32_t rtc_now(void)
+{
+    /* RTC0 belongs to the Softdevice, but may be read. */
+    return NRF_RTC0->COUNTER;
+}
+
+/** Whether the Softdevice radio events are regular, and still going on. */
+static bool interval_is_regular(void)
+{
+    if (!m_active_valid || m_regular_count < COEX_REGULAR_COUNT_MIN)
+    {
+        return false;
+    }
+    /* the events stop when the connection ends, without any notification */
+    uint32_t since_last_us = RTC_TICKS_TO_US((rtc_now() - m_active_rtc) & RTC_MASK);
+    return (since_last_us < 2 * m_interval_us);
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_coex_init(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_active_valid = false;
+    m_regular_count = 0;
+    m_interval_us = 0;
+    m_busy_us = 0;
+    m_flash_pending = false;
+}
+
+void mesh_coex_radio_notification(bool radio_active)
+{
+    uint32_t now = rtc_now();
+
+    if (radio_active)
+    {
+        if (m_active_valid)
+        {
+            uint32_t interval_us = RTC_TICKS_TO_US((now - m_active_rtc) & RTC_MASK);
+            uint32_t difference = (interval_us > m_interval_us) ?
+                interval_us - m_interval_us : m_interval_us - interval_us;
+
+            if (difference <= (m_interval_us >> COEX_INTERVAL_TOLERANCE_SHIFT))
+            {
+                if (m_regular_count < COEX_REGULAR_COUNT_MIN)
+                {
+                    m_regular_count++;
+                }
+            }
+            else
+            {
+                m_regular_count = 0;
+            }
+            m_interval_us = interval_us;
+        }
+        m_active_rtc = now;
+        m_active_valid = true;
+        m_stats.sd_radio_events++;
+    }
+    else if (m_active_valid)
+    {
+        uint32_t busy_us = RTC_TICKS_TO_US((now - m_active_rtc) & RTC_MASK);
+
+        /* follow the longest events, but let the estimate come down when
+           they get shorter */
+        m_busy_us -= (m_busy_us >> 3);
+        if (busy_us > m_busy_us)
+        {
+            m_busy_us = busy_us;
+        }
+        m_stats.sd_radio_us += busy_us;
+    }
+}
+
+void mesh_coex_sd_flash_pending_set(bool pending)
+{
+    m_flash_pending = pending;
+}
+
+timestamp_t mesh_coex_slot_length_get(timestamp_t preferred_us)
+{
+    if (!interval_is_regular())
+    {
+        return preferred_us;
+    }
+
+    uint32_t gap_us = 0;
+    if (m_interval_us > m_busy_us + 2 * COEX_GUARD_US)
+    {
+        gap_us = m_interval_us - m_busy_us - 2 * COEX_GUARD_US;
+    }
+
+    if (gap_us >= preferred_us)
+    {
+        return preferred_us;
+    }
+    m_stats.fitted_requests++;
+
+    /* A slot shorter than the gap would be useless, let the Softdevice find a
+       longer gap, if there is one. */
+    if (gap_us < RBC_MESH_COEX_SLOT_MIN_US)
+    {
+        gap_us = RBC_MESH_COEX_SLOT_MIN_US;
+    }
+    return (gap_us < preferred_us) ? gap_us : preferred_us;
+}
+
+bool mesh_coex_extend_allowed(void)
+{
+    /* extending into the next regular radio event would only be denied */
+    return !(m_flash_pending || interval_is_regular());
+}
+
+timestamp_t mesh_coex_gap_get(void)
+{
+    if (!m_flash_pending)
+    {
+        return 0;
+    }
+    m_stats.flash_gaps++;
+    return RBC_MESH_COEX_FLASH_GAP_US;
+}
+
+void mesh_coex_timeslot_end(timestamp_t length_us)
+{
+    m_stats.mesh_timeslot_us += length_us;
+}
+
+void mesh_coex_blocked(void)
+{
+    m_stats.mesh_blocked++;
+}
+
+void mesh_coex_canceled(void)
+{
+    m_stats.mesh_canceled++;
+}
+
+void mesh_coex_stats_get(rbc_mesh_coex_stats_t* p_stats)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(p_stats, &m_stats, sizeof(rbc_mesh_coex_stats_t));
+    p_stats->sd_interval_us = interval_is_regular() ? m_interval_us : 0;
+    _ENABLE_IRQS(was_masked);
+}
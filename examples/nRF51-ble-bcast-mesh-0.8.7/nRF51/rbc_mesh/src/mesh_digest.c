@@ -0,0 +1,281 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_digest.h"
+
+#include <stddef.h>
+#include "handle_storage.h"
+#include "transport_control.h"
+#include "version_handler.h"
+#include "timer_scheduler.h"
+#include "rand.h"
+#include "toolchain.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define DRILL_DELAY_US              (RBC_MESH_DIGEST_DRILL_DELAY_MS * 1000)
+
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle;     /**< Always MESH_DIGEST_HANDLE. */
+    rbc_mesh_value_handle_t first;      /**< First handle of the summarized range. */
+    rbc_mesh_value_handle_t last;       /**< Last handle of the summarized range. */
+    uint32_t                digests[MESH_DIGEST_BUCKETS]; /**< Digest of each part of the range. */
+    uint8_t                 counts[MESH_DIGEST_BUCKETS];  /**< Number of values in each part, saturated at 255. */
+} __packed_gcc digest_adv_data_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static timer_event_t            m_tx_timer_evt;
+static timestamp_t              m_interval_us;      /** 0 while stopped. */
+static rbc_mesh_handle_range_t  m_drill_range;      /** Range of the next digest, if a drill is pending. */
+static bool                     m_drill_pending;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+/** Split a handle range in MESH_DIGEST_BUCKETS parts. Parts left empty in
+  ranges of less than MESH_DIGEST_BUCKETS handles have first > last. */
+static void buckets_get(rbc_mesh_value_handle_t first, rbc_mesh_value_handle_t last, rbc_mesh_handle_range_t* p_buckets)
+{
+    uint32_t width = (uint32_t) last - first + 1;
+    for (uint32_t i = 0; i < MESH_DIGEST_BUCKETS; ++i)
+    {
+        uint32_t start = (width * i) / MESH_DIGEST_BUCKETS;
+        uint32_t end = (width * (i + 1)) / MESH_DIGEST_BUCKETS;
+        if (start == end)
+        {
+            p_buckets[i].first = RBC_MESH_INVALID_HANDLE;
+            p_buckets[i].last = 0;
+        }
+        else
+        {
+            p_buckets[i].first = first + start;
+            p_buckets[i].last = first + end - 1;
+        }
+    }
+}
+
+static void digest_tx(rbc_mesh_value_handle_t first, rbc_mesh_value_handle_t last)
+{
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return; /* the next digest covers for it */
+    }
+
+    rbc_mesh_handle_range_t buckets[MESH_DIGEST_BUCKETS];
+    uint32_t digests[MESH_DIGEST_BUCKETS];
+    uint16_t counts[MESH_DIGEST_BUCKETS];
+    buckets_get(first, last, buckets);
+    handle_storage_digest_get(buckets, MESH_DIGEST_BUCKETS, digests, counts);
+
+    digest_adv_data_t* p_adv = (digest_adv_data_t*) &p_packet->payload[0];
+
+    (void) mesh_packet_set_local_addr(p_packet);
+    p_packet->header.length = MESH_PACKET_BLE_OVERHEAD + sizeof(digest_adv_data_t);
+    p_packet->header.type = BLE_PACKET_TYPE_ADV_NONCONN_IND;
+
+    p_adv->adv_data_length = sizeof(digest_adv_data_t) - 1;
+    p_adv->adv_data_type = MESH_ADV_DATA_TYPE;
+    p_adv->mesh_uuid = MESH_UUID;
+    p_adv->handle = MESH_DIGEST_HANDLE;
+    p_adv->first = first;
+    p_adv->last = last;
+    for (uint32_t i = 0; i < MESH_DIGEST_BUCKETS; ++i)
+    {
+        p_adv->digests[i] = digests[i];
+        p_adv->counts[i] = (counts[i] > UINT8_MAX) ? UINT8_MAX : counts[i];
+    }
+
+    (void) tc_tx(p_packet, vh_tx_config_get());
+    mesh_packet_ref_count_dec(p_packet);
+}
+
+/** Order the timer within [delay_us / 2, 3 * delay_us / 2) from now, to
+  spread the digests of nodes started at the same time. */
+static void tx_timer_order(timestamp_t time_now, timestamp_t delay_us)
+{
+    timestamp_t delay = delay_us / 2 + rand_range(delay_us);
+    (void) timer_sch_reschedule(&m_tx_timer_evt, time_now + delay);
+}
+
+static void tx_timeout(timestamp_t timestamp, void* p_context)
+{
+    if (m_interval_us == 0)
+    {
+        return;
+    }
+
+    rbc_mesh_handle_range_t range = {0, RBC_MESH_APP_MAX_HANDLE};
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (m_drill_pending)
+    {
+        range = m_drill_range;
+        m_drill_pending = false;
+    }
+    _ENABLE_IRQS(was_masked);
+
+    digest_tx(range.first, range.last);
+    tx_timer_order(timestamp, m_interval_us);
+}
+
+/** Send a digest of the given range soon, unless another drill is pending. */
+static void drill_order(const rbc_mesh_handle_range_t* p_range, timestamp_t time_now)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    bool order = !m_drill_pending;
+    if (order)
+    {
+        m_drill_range = *p_range;
+        m_drill_pending = true;
+    }
+    _ENABLE_IRQS(was_masked);
+
+    if (order)
+    {
+        tx_timer_order(time_now, DRILL_DELAY_US);
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_digest_init(void)
+{
+    m_tx_timer_evt.cb = tx_timeout;
+    m_tx_timer_evt.interval = 0;
+    m_tx_timer_evt.p_context = NULL;
+    m_tx_timer_evt.p_next = NULL;
+    m_interval_us = 0;
+    m_drill_pending = false;
+}
+
+void mesh_digest_start(timestamp_t interval_us)
+{
+    bool was_started = (m_interval_us != 0);
+    m_interval_us = interval_us;
+    if (!was_started)
+    {
+        tx_timer_order(timer_now(), m_interval_us);
+    }
+}
+
+void mesh_digest_stop(void)
+{
+    m_interval_us = 0;
+    m_drill_pending = false;
+    (void) timer_sch_abort(&m_tx_timer_evt);
+}
+
+void mesh_digest_rx(mesh_adv_data_t* p_adv_data, timestamp_t timestamp)
+{
+    digest_adv_data_t* p_digest = (digest_adv_data_t*) p_adv_data;
+    if (p_digest->adv_data_length < sizeof(digest_adv_data_t) - 1 ||
+        p_digest->first > p_digest->last ||
+        p_digest->last > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return;
+    }
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    bool drill_covered = (m_drill_pending &&
+                          m_drill_range.first == p_digest->first &&
+                          m_drill_range.last == p_digest->last);
+    if (drill_covered)
+    {
+        m_drill_pending = false;
+    }
+    _ENABLE_IRQS(was_masked);
+    if (drill_covered && m_interval_us != 0)
+    {
+        /* a neighbour asked first, answering it covers ours */
+        tx_timer_order(timestamp, m_interval_us);
+    }
+
+    rbc_mesh_handle_range_t buckets[MESH_DIGEST_BUCKETS];
+    uint32_t digests[MESH_DIGEST_BUCKETS];
+    uint16_t counts[MESH_DIGEST_BUCKETS];
+    buckets_get(p_digest->first, p_digest->last, buckets);
+    handle_storage_digest_get(buckets, MESH_DIGEST_BUCKETS, digests, counts);
+
+    uint32_t mismatches = 0;
+    uint32_t drill_bucket = 0;
+    bool values_reset = false;
+    for (uint32_t i = 0; i < MESH_DIGEST_BUCKETS; ++i)
+    {
+        if (buckets[i].first > buckets[i].last)
+        {
+            continue;
+        }
+        uint8_t count = (counts[i] > UINT8_MAX) ? UINT8_MAX : counts[i];
+        if (digests[i] == p_digest->digests[i] && count == p_digest->counts[i])
+        {
+            if (count > 0)
+            {
+                handle_storage_range_consistent(buckets[i].first, buckets[i].last, timestamp);
+            }
+        }
+        else if (m_interval_us != 0)
+        {
+            if (buckets[i].first == buckets[i].last ||
+                (count <= RBC_MESH_DIGEST_LEAF_VALUES &&
+                 p_digest->counts[i] <= RBC_MESH_DIGEST_LEAF_VALUES))
+            {
+                /* cheaper to send the values than to narrow it down further */
+                handle_storage_range_inconsistent(buckets[i].first, buckets[i].last, timestamp);
+                values_reset = values_reset || (count > 0);
+            }
+            else if (rand_range(++mismatches) == 0)
+            {
+                /* pick one of the differing parts at random, so that
+                   repeated drills don't all end up in the first one */
+                drill_bucket = i;
+            }
+        }
+    }
+
+    if (values_reset)
+    {
+        vh_order_update(timestamp);
+    }
+    if (mismatches > 0)
+    {
+        drill_order(&buckets[drill_bucket], timestamp);
+    }
+}
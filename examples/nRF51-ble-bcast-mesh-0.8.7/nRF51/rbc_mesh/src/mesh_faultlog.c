@@ -0,0 +1,400 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "mesh_faultlog.h"
+
+#ifdef MESH_FAULTLOG
+
+#include <stdbool.h>
+#include <string.h>
+#include "mesh_flash.h"
+#include "mesh_stats.h"
+#include "timebase.h"
+#include "timer.h"
+#include "timer_scheduler.h"
+#include "dfu_types_mesh.h"
+#include "toolchain.h"
+#include "nrf_error.h"
+#include "app_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define FAULTLOG_PAGE_ADDR(page)            (RBC_MESH_FAULTLOG_FLASH_ADDR + (page) * PAGE_SIZE)
+
+/* Each record ends with a commit word, so a write cut short by a reset is
+   never mistaken for a fault. */
+#define FAULTLOG_RECORD_WORDS               (sizeof(rbc_mesh_fault_record_t) / 4 + 1)
+#define FAULTLOG_RECORD_SIZE                (FAULTLOG_RECORD_WORDS * 4)
+#define FAULTLOG_RECORD_COMMIT_MARK         (0xFA170000)
+
+#define FAULTLOG_SLOT_COUNT                 (PAGE_SIZE / FAULTLOG_RECORD_SIZE)
+#define FAULTLOG_SLOT_ADDR(page, slot)      (FAULTLOG_PAGE_ADDR(page) + (slot) * FAULTLOG_RECORD_SIZE)
+
+#define FAULTLOG_RETAINED_MAGIC             (0x464C5447) /* "FLTG" */
+
+/** Time to wait before retrying when the flash operation queue is full. */
+#define FAULTLOG_RETRY_DELAY_US             (10000)
+
+#if (RBC_MESH_FAULTLOG_FLASH_ADDR & (PAGE_SIZE - 1))
+    #error "RBC_MESH_FAULTLOG_FLASH_ADDR must be page aligned"
+#endif
+
+#if (RBC_MESH_FAULTLOG_PAGES < 2)
+    #error "RBC_MESH_FAULTLOG_PAGES must be at least 2, to keep the latest faults while a page is erased"
+#endif
+
+/*****************************************************************************
+* Local typedefs
+*****************************************************************************/
+typedef union
+{
+    struct
+    {
+        rbc_mesh_fault_record_t record;
+        uint32_t commit;
+    } fault;
+    uint32_t words[FAULTLOG_RECORD_WORDS];
+} faultlog_slot_t;
+
+/** The fault waiting to be committed, kept through the reset. */
+typedef struct
+{
+    uint32_t magic;
+    rbc_mesh_fault_record_t record;
+    uint32_t commit;    /**< Commit word of the record, a capture cut short leaves it wrong. */
+} faultlog_retained_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static faultlog_retained_t  m_retained _NOINIT;
+static faultlog_slot_t      m_write_buffer;     /**< Source of the commit in progress. */
+static uint16_t             m_seq;              /**< Number of the latest fault in flash. */
+static bool                 m_has_faults;       /**< The flash holds at least one fault. */
+static uint8_t              m_page;             /**< Page of the next fault. */
+static uint16_t             m_slot;             /**< Slot of the next fault. */
+static bool                 m_slot_ready;       /**< The slot of the next fault is erased. */
+static bool                 m_commit_pending;   /**< The retained fault waits for the slot. */
+static volatile bool        m_captured;         /**< A fault was captured since the last commit started. */
+static timer_event_t        m_retry_timer;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static inline const faultlog_slot_t* slot_get(uint8_t page, uint16_t slot)
+{
+    return (const faultlog_slot_t*) FAULTLOG_SLOT_ADDR(page, slot);
+}
+
+static uint32_t record_commit_get(const rbc_mesh_fault_record_t* p_record)
+{
+    const uint8_t* p_byte = (const uint8_t*) p_record;
+    uint16_t sum = 0;
+    for (uint32_t i = 0; i < sizeof(rbc_mesh_fault_record_t); ++i)
+    {
+        sum = (uint16_t) ((sum << 1) | (sum >> 15)) + p_byte[i];
+    }
+    return FAULTLOG_RECORD_COMMIT_MARK | sum;
+}
+
+static bool slot_is_valid(const faultlog_slot_t* p_slot)
+{
+    return (p_slot->fault.commit == record_commit_get(&p_slot->fault.record));
+}
+
+static bool retained_is_valid(void)
+{
+    return (m_retained.magic == FAULTLOG_RETAINED_MAGIC &&
+            m_retained.commit == record_commit_get(&m_retained.record));
+}
+
+static bool words_are_blank(uint32_t addr, uint32_t length)
+{
+    for (const uint32_t* p_word = (const uint32_t*) addr; p_word < (const uint32_t*) (addr + length); ++p_word)
+    {
+        if (*p_word != 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline uint16_t saturate_u16(uint32_t value)
+{
+    return (value > UINT16_MAX) ? UINT16_MAX : (uint16_t) value;
+}
+
+static void commit_write(void);
+
+static void erase_end(void* p_location)
+{
+    m_slot_ready = true;
+    if (m_commit_pending)
+    {
+        commit_write();
+    }
+}
+
+static void erase_schedule(void)
+{
+    flash_op_t op;
+    op.erase.start_addr = FAULTLOG_PAGE_ADDR(m_page);
+    op.erase.length = PAGE_SIZE;
+    if (mesh_flash_op_push_cb(FLASH_OP_TYPE_ERASE, &op, erase_end) != NRF_SUCCESS)
+    {
+        /* the flash queue is full, try again later */
+        APP_ERROR_CHECK(timer_sch_reschedule(&m_retry_timer, timer_now() + FAULTLOG_RETRY_DELAY_US));
+    }
+}
+
+/**
+* Move on to the first erased slot from the current one. When the page is
+* full, the next fault goes to the start of the next page of the ring, which
+* is erased if needed, losing the oldest faults.
+*/
+static void next_slot_prepare(void)
+{
+    while (m_slot < FAULTLOG_SLOT_COUNT &&
+           !words_are_blank(FAULTLOG_SLOT_ADDR(m_page, m_slot), FAULTLOG_RECORD_SIZE))
+    {
+        m_slot++;
+    }
+    if (m_slot < FAULTLOG_SLOT_COUNT)
+    {
+        m_slot_ready = true;
+        return;
+    }
+
+    m_page = (m_page + 1) % RBC_MESH_FAULTLOG_PAGES;
+    m_slot = 0;
+    m_slot_ready = words_are_blank(FAULTLOG_PAGE_ADDR(m_page), PAGE_SIZE);
+    if (!m_slot_ready)
+    {
+        erase_schedule();
+    }
+}
+
+static void write_end(void* p_location)
+{
+    m_seq = m_write_buffer.fault.record.seq;
+    m_has_faults = true;
+
+    /* a fault captured during the write waits for the next boot */
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (!m_captured)
+    {
+        m_retained.magic = 0;
+    }
+    _ENABLE_IRQS(was_masked);
+
+    m_slot++;
+    next_slot_prepare();
+}
+
+static void commit_write(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memset(&m_write_buffer, 0, sizeof(m_write_buffer));
+    m_write_buffer.fault.record = m_retained.record;
+    m_captured = false;
+    _ENABLE_IRQS(was_masked);
+
+    m_write_buffer.fault.record.seq = m_has_faults ? (uint16_t) (m_seq + 1) : 1;
+    m_write_buffer.fault.commit = record_commit_get(&m_write_buffer.fault.record);
+
+    flash_op_t op;
+    op.write.start_addr = FAULTLOG_SLOT_ADDR(m_page, m_slot);
+    op.write.p_data = (uint8_t*) &m_write_buffer;
+    op.write.length = FAULTLOG_RECORD_SIZE;
+    if (mesh_flash_op_push_cb(FLASH_OP_TYPE_WRITE, &op, write_end) == NRF_SUCCESS)
+    {
+        m_commit_pending = false;
+    }
+    else
+    {
+        /* the flash queue is full, try again later */
+        m_commit_pending = true;
+        APP_ERROR_CHECK(timer_sch_reschedule(&m_retry_timer, timer_now() + FAULTLOG_RETRY_DELAY_US));
+    }
+}
+
+static void retry_timeout(timestamp_t timestamp, void* p_context)
+{
+    if (!m_slot_ready)
+    {
+        erase_schedule();
+    }
+    else if (m_commit_pending)
+    {
+        commit_write();
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_faultlog_init(void)
+{
+    m_seq = 0;
+    m_has_faults = false;
+    m_page = 0;
+    m_slot = 0;
+    memset(&m_retry_timer, 0, sizeof(m_retry_timer));
+    m_retry_timer.cb = retry_timeout;
+
+    for (uint8_t page = 0; page < RBC_MESH_FAULTLOG_PAGES; ++page)
+    {
+        for (uint16_t slot = 0; slot < FAULTLOG_SLOT_COUNT; ++slot)
+        {
+            const faultlog_slot_t* p_slot = slot_get(page, slot);
+            if (slot_is_valid(p_slot) &&
+                (!m_has_faults || (int16_t) (p_slot->fault.record.seq - m_seq) > 0))
+            {
+                m_page = page;
+                m_slot = slot;
+                m_seq = p_slot->fault.record.seq;
+                m_has_faults = true;
+            }
+        }
+    }
+    if (m_has_faults)
+    {
+        m_slot++;
+    }
+
+    m_commit_pending = retained_is_valid();
+    next_slot_prepare();
+    if (m_commit_pending && m_slot_ready)
+    {
+        commit_write();
+    }
+}
+
+void mesh_faultlog_capture(rbc_mesh_fault_type_t type, uint32_t error_code, uint32_t pc, uint32_t lr, uint16_t line)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    rbc_mesh_fault_record_t* p_record = &m_retained.record;
+    m_retained.magic = 0;
+    memset(p_record, 0, sizeof(rbc_mesh_fault_record_t));
+    p_record->type = (uint8_t) type;
+    p_record->error_code = error_code;
+    p_record->pc = pc;
+    p_record->lr = lr;
+    p_record->line = line;
+    p_record->uptime_ms = (uint32_t) (timebase_now() / 1000);
+    p_record->rx_ok = g_mesh_stats.rx_ok;
+    p_record->pool_exhausted = saturate_u16(g_mesh_stats.pool_exhausted);
+    p_record->event_queue_drop = g_mesh_stats.event_queue_drop;
+    p_record->app_queue_drop = g_mesh_stats.app_queue_drop;
+    p_record->radio_queue_drop = (g_mesh_stats.radio_queue_drop > UINT8_MAX) ? UINT8_MAX : (uint8_t) g_mesh_stats.radio_queue_drop;
+    m_retained.commit = record_commit_get(p_record);
+    m_retained.magic = FAULTLOG_RETAINED_MAGIC;
+    m_captured = true;
+    _ENABLE_IRQS(was_masked);
+}
+
+void mesh_faultlog_hardfault_capture(const uint32_t* p_frame)
+{
+    mesh_faultlog_capture(RBC_MESH_FAULT_TYPE_HARDFAULT, 0, p_frame[6], p_frame[5], 0);
+    NVIC_SystemReset();
+}
+
+uint32_t mesh_faultlog_get(uint8_t index, rbc_mesh_fault_record_t* p_record)
+{
+    if (!m_has_faults || index >= m_seq)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    uint16_t seq = m_seq - index;
+    for (uint8_t page = 0; page < RBC_MESH_FAULTLOG_PAGES; ++page)
+    {
+        for (uint16_t slot = 0; slot < FAULTLOG_SLOT_COUNT; ++slot)
+        {
+            const faultlog_slot_t* p_slot = slot_get(page, slot);
+            if (p_slot->fault.record.seq == seq && slot_is_valid(p_slot))
+            {
+                memcpy(p_record, &p_slot->fault.record, sizeof(rbc_mesh_fault_record_t));
+                return NRF_SUCCESS;
+            }
+        }
+    }
+    return NRF_ERROR_NOT_FOUND;
+}
+
+#if RBC_MESH_FAULTLOG_HARDFAULT_HANDLER
+/* Find the stack the exception frame was pushed to from EXC_RETURN, and pass
+   it on before the compiler touches the stack. */
+#if defined(__GNUC__)
+void HardFault_Handler(void) __attribute__((naked));
+void HardFault_Handler(void)
+{
+    __ASM volatile(
+        "   .syntax unified                             \n"
+        "   movs r0, #4                                 \n"
+        "   mov  r1, lr                                 \n"
+        "   tst  r0, r1                                 \n"
+        "   beq  1f                                     \n"
+        "   mrs  r0, psp                                \n"
+        "   b    2f                                     \n"
+        "1: mrs  r0, msp                                \n"
+        "2: ldr  r1, =mesh_faultlog_hardfault_capture   \n"
+        "   bx   r1                                     \n"
+        "   .ltorg                                      \n"
+    );
+}
+#elif defined(__CC_ARM)
+__asm void HardFault_Handler(void)
+{
+    PRESERVE8
+    IMPORT  mesh_faultlog_hardfault_capture
+    MOVS    r0, #4
+    MOV     r1, lr
+    TST     r0, r1
+    BEQ     faultlog_msp
+    MRS     r0, PSP
+    B       faultlog_capture
+faultlog_msp
+    MRS     r0, MSP
+faultlog_capture
+    LDR     r1, =mesh_faultlog_hardfault_capture
+    BX      r1
+    ALIGN
+}
+#else
+    #error "Set RBC_MESH_FAULTLOG_HARDFAULT_HANDLER to 0, and capture hard faults in the application."
+#endif
+#endif /* RBC_MESH_FAULTLOG_HARDFAULT_HANDLER */
+
+#endif /* MESH_FAULTLOG */
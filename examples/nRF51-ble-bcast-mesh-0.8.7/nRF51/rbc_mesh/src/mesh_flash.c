@@ -48,6 +48,9 @@
 /** Number of flash operations that can be queued at once. */
 #define FLASH_OP_QUEUE_LEN					(8)
 
+/** Highest number of operations merged into a single queue entry. */
+#define FLASH_OP_MERGE_MAX                  (32)
+
 /** Maximum time spent after a flash operation for cleanup. */
 #define FLASH_OP_POST_PROCESS_TIME_US		(500)
 /** Longest time spent on a single flash operation. Longer operations will be
@@ -70,6 +73,12 @@
 /** Timer to write a single flash word. */
 #define FLASH_TIME_TO_WRITE_ONE_WORD_US     (50)
 #endif
+
+#if defined(NVMC_ERASEPAGEPARTIALCFG_DURATION_Pos) && (MESH_FLASH_PARTIAL_ERASE_MS > 0)
+#define FLASH_PARTIAL_ERASE
+/** Time to erase a slice of a flash page. */
+#define FLASH_TIME_TO_ERASE_SLICE_US        (MESH_FLASH_PARTIAL_ERASE_MS * 1000)
+#endif
 /*****************************************************************************
 * Local typedefs
 *****************************************************************************/
@@ -78,6 +87,8 @@ typedef struct
 {
     flash_op_type_t type;     /**< Type of flash operation. */
     flash_op_t operation;     /**< Operation parameters. */
+    mesh_flash_op_end_cb_t cb; /**< Operation specific end callback, or NULL to report to the init callback. */
+    uint8_t piece_count;      /**< Number of equally long pushed operations merged into this one. */
 } operation_t;
 
 /*****************************************************************************
@@ -88,15 +99,23 @@ static operation_t			m_flash_op_fifo_queue[FLASH_OP_QUEUE_LEN]; /**< FIFO buffer
 static mesh_flash_op_cb_t	mp_cb;                                     /**< Flash operation end callback pointer. Called when a flash operation ended. */
 static operation_t          m_curr_op;                                 /**< Current flash operation. */
 static uint32_t             m_op_addr;                                 /**< Start address of current operation. */
+static uint32_t             m_piece_len;                               /**< Length of each merged piece of the current operation. */
+static uint8_t              m_pieces_reported;                         /**< Number of merged pieces of the current operation reported as ended. */
+static mesh_flash_queue_stats_t m_queue_stats;                         /**< Queue usage counters. */
 static bool                 m_suspended;                               /**< Suspend flag, preventing flash operations while set. */
+static operation_t          m_urgent_op;                               /**< Write executed before the queued operations, or FLASH_OP_TYPE_NONE. */
+#ifdef FLASH_PARTIAL_ERASE
+static uint32_t             m_partial_erase_time;                      /**< Time spent erasing slices of the first page of the current erase. */
+#endif
 
 /* In order to check that all flash events have been reported to the user, the
- * module need to keep track of how many events have been popped from the operation queue.
+ * module need to keep track of how many events have been pushed to the operation queue.
  * There might be multiple operation reports queued to the bearer event, without this module
  * being able to tell. The @c m_operation_count and @c m_operations_reported variables are
- * responsible for keeping track of this.
+ * responsible for keeping track of this. Operations with their own end callback aren't
+ * counted.
  */
-static uint32_t             m_operation_count;                         /**< Number of flash operations executed since bootup. */
+static uint32_t             m_operation_count;                         /**< Number of flash operations pushed since bootup. */
 static uint32_t             m_operations_reported;                     /**< Number of flash operations reported to app as ended since bootup. */
 /*****************************************************************************
 * Static functions
@@ -172,6 +191,30 @@ static void erase_as_much_as_possible(flash_op_t* p_erase_op, timestamp_t* p_ava
         bytes_to_erase = p_erase_op->erase.length;
     }
 
+#ifdef FLASH_PARTIAL_ERASE
+    /* a page doesn't fit, or is already partially erased: continue it in slices */
+    if (p_erase_op->erase.length > 0 && max_time >= FLASH_OP_POST_PROCESS_TIME_US &&
+        (bytes_to_erase == 0 || m_partial_erase_time > 0))
+    {
+        *p_bytes_erased = 0;
+        timestamp_t slice_time = FLASH_TIME_TO_ERASE_SLICE_US + FLASH_OP_POST_PROCESS_TIME_US;
+        while (*p_available_time >= slice_time && m_partial_erase_time < FLASH_TIME_TO_ERASE_PAGE_US)
+        {
+            nrf_flash_erase_partial((uint32_t*) p_erase_op->erase.start_addr, MESH_FLASH_PARTIAL_ERASE_MS);
+            m_partial_erase_time += FLASH_TIME_TO_ERASE_SLICE_US;
+            *p_available_time -= FLASH_TIME_TO_ERASE_SLICE_US;
+        }
+        if (m_partial_erase_time >= FLASH_TIME_TO_ERASE_PAGE_US)
+        {
+            m_partial_erase_time = 0;
+            *p_bytes_erased = PAGE_SIZE;
+            p_erase_op->erase.length -= PAGE_SIZE;
+            p_erase_op->erase.start_addr += PAGE_SIZE;
+        }
+        return;
+    }
+#endif
+
     if (bytes_to_erase == 0 || max_time < FLASH_OP_POST_PROCESS_TIME_US)
     {
         *p_bytes_erased = 0;
@@ -192,7 +235,7 @@ static void erase_as_much_as_possible(flash_op_t* p_erase_op, timestamp_t* p_ava
 
 static inline bool all_operations_ended(void)
 {
-    return (fifo_is_empty(&m_flash_op_fifo) && (m_operations_reported == m_operation_count));
+    return (m_operations_reported == m_operation_count);
 }
 
 static void write_operation_ended(void* p_location)
@@ -217,25 +260,36 @@ static void erase_operation_ended(void* p_source)
 
 static bool send_end_evt(void)
 {
-    if (m_operation_count == 0 || m_curr_op.type == FLASH_OP_TYPE_NONE)
+    if (m_curr_op.type == FLASH_OP_TYPE_NONE)
     {
         return true; /* no events to send */
     }
     async_event_t end_evt;
     end_evt.type = EVENT_TYPE_GENERIC;
-    if (m_curr_op.type == FLASH_OP_TYPE_ERASE)
+    if (m_curr_op.cb != NULL)
+    {
+        end_evt.callback.generic.cb = m_curr_op.cb;
+    }
+    else if (m_curr_op.type == FLASH_OP_TYPE_ERASE)
     {
         end_evt.callback.generic.cb = erase_operation_ended;
-        end_evt.callback.generic.p_context = (void*) m_op_addr;
     }
     else
     {
         end_evt.callback.generic.cb = write_operation_ended;
-        end_evt.callback.generic.p_context = (void*) m_op_addr;
     }
-    if (event_handler_push(&end_evt) != NRF_SUCCESS)
+
+    /* Report every merged piece as it was pushed. Both the source and the
+       destination of merged operations are contiguous, so the location of
+       each piece follows from the first one. */
+    while (m_pieces_reported < m_curr_op.piece_count)
     {
-        return false;
+        end_evt.callback.generic.p_context = (void*) (m_op_addr + m_pieces_reported * m_piece_len);
+        if (event_handler_push(&end_evt) != NRF_SUCCESS)
+        {
+            return false;
+        }
+        m_pieces_reported++;
     }
 
     return true;
@@ -251,44 +305,77 @@ static bool next_operation_get(void)
     }
     APP_ERROR_CHECK_BOOL(m_curr_op.type != FLASH_OP_TYPE_NONE);
 
-    m_operation_count++;
     /* Save initial start address for the end-event */
     if (m_curr_op.type == FLASH_OP_TYPE_WRITE)
     {
         m_op_addr = (uint32_t) m_curr_op.operation.write.p_data;
+        m_piece_len = m_curr_op.operation.write.length / m_curr_op.piece_count;
     }
     else
     {
         m_op_addr = m_curr_op.operation.erase.start_addr;
+        m_piece_len = m_curr_op.operation.erase.length / m_curr_op.piece_count;
     }
+    m_pieces_reported = 0;
     return true;
 }
-/*****************************************************************************
-* Interface functions
-*****************************************************************************/
 
-uint32_t mesh_flash_init(mesh_flash_op_cb_t cb)
+/**
+* Try to append an operation to the newest one in the queue. Operations can be
+* merged if both their (flash and RAM) areas continue the queued operation,
+* and they have the same length as each of its pieces.
+* Must be called with IRQs masked, as the queue is popped from the timeslot.
+*/
+static bool op_merge(flash_op_type_t type, const flash_op_t* p_op, mesh_flash_op_end_cb_t cb)
 {
-    if (cb == NULL)
+    operation_t* p_last = fifo_peek_newest_ptr(&m_flash_op_fifo);
+    if (p_last == NULL ||
+        p_last->type != type ||
+        p_last->cb != cb ||
+        p_last->piece_count >= FLASH_OP_MERGE_MAX)
     {
-        return NRF_ERROR_NULL;
+        return false;
     }
-    m_flash_op_fifo.elem_array = m_flash_op_fifo_queue;
-    m_flash_op_fifo.elem_size = sizeof(operation_t);
-    m_flash_op_fifo.array_len = FLASH_OP_QUEUE_LEN;
-    fifo_init(&m_flash_op_fifo);
-    mp_cb = cb;
-    m_curr_op.type = FLASH_OP_TYPE_NONE;
 
-    return NRF_SUCCESS;
+    if (type == FLASH_OP_TYPE_WRITE)
+    {
+        flash_op_t* p_last_op = &p_last->operation;
+        if (p_op->write.length * p_last->piece_count != p_last_op->write.length ||
+            p_last_op->write.start_addr + p_last_op->write.length != p_op->write.start_addr ||
+            p_last_op->write.p_data + p_last_op->write.length != p_op->write.p_data)
+        {
+            return false;
+        }
+        p_last_op->write.length += p_op->write.length;
+    }
+    else
+    {
+        flash_op_t* p_last_op = &p_last->operation;
+        if (p_op->erase.length * p_last->piece_count != p_last_op->erase.length ||
+            p_last_op->erase.start_addr + p_last_op->erase.length != p_op->erase.start_addr)
+        {
+            return false;
+        }
+        p_last_op->erase.length += p_op->erase.length;
+    }
+    p_last->piece_count++;
+    return true;
 }
-
-uint32_t mesh_flash_op_push(flash_op_type_t type, const flash_op_t* p_op)
+static void op_queue_init(void)
 {
-    if (mp_cb == NULL)
+    if (m_flash_op_fifo.array_len == 0)
     {
-        return NRF_ERROR_INVALID_STATE;
+        m_flash_op_fifo.elem_array = m_flash_op_fifo_queue;
+        m_flash_op_fifo.elem_size = sizeof(operation_t);
+        m_flash_op_fifo.array_len = FLASH_OP_QUEUE_LEN;
+        fifo_init(&m_flash_op_fifo);
+        m_curr_op.type = FLASH_OP_TYPE_NONE;
+        m_urgent_op.type = FLASH_OP_TYPE_NONE;
     }
+}
+
+static uint32_t op_push(flash_op_type_t type, const flash_op_t* p_op, mesh_flash_op_end_cb_t cb)
+{
     if (p_op == NULL)
     {
         return NRF_ERROR_NULL;
@@ -322,10 +409,116 @@ uint32_t mesh_flash_op_push(flash_op_type_t type, const flash_op_t* p_op)
         return NRF_ERROR_INVALID_PARAM;
     }
 
-    operation_t op;
-    op.type = type;
-    memcpy(&op.operation, p_op, sizeof(flash_op_t));
-    return fifo_push(&m_flash_op_fifo, &op);
+    uint32_t error_code = NRF_SUCCESS;
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (op_merge(type, p_op, cb))
+    {
+        m_queue_stats.merged++;
+    }
+    else
+    {
+        operation_t op;
+        op.type = type;
+        op.cb = cb;
+        op.piece_count = 1;
+        memcpy(&op.operation, p_op, sizeof(flash_op_t));
+        error_code = fifo_push(&m_flash_op_fifo, &op);
+    }
+
+    if (error_code == NRF_SUCCESS)
+    {
+        m_queue_stats.pushed++;
+        if (cb == NULL)
+        {
+            m_operation_count++;
+        }
+        uint32_t len = fifo_get_len(&m_flash_op_fifo);
+        if (len > m_queue_stats.peak_length)
+        {
+            m_queue_stats.peak_length = len;
+        }
+    }
+    else
+    {
+        m_queue_stats.rejected++;
+    }
+    _ENABLE_IRQS(was_masked);
+    return error_code;
+}
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+
+uint32_t mesh_flash_init(mesh_flash_op_cb_t cb)
+{
+    if (cb == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    op_queue_init();
+    mp_cb = cb;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_flash_op_push(flash_op_type_t type, const flash_op_t* p_op)
+{
+    if (mp_cb == NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return op_push(type, p_op, NULL);
+}
+
+uint32_t mesh_flash_op_push_cb(flash_op_type_t type, const flash_op_t* p_op, mesh_flash_op_end_cb_t cb)
+{
+    if (cb == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    op_queue_init();
+    return op_push(type, p_op, cb);
+}
+
+uint32_t mesh_flash_op_push_urgent(const flash_op_t* p_op)
+{
+    if (p_op == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (!IS_WORD_ALIGNED(p_op->write.start_addr) ||
+        !IS_WORD_ALIGNED(p_op->write.p_data))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (!IS_WORD_ALIGNED(p_op->write.length) ||
+        p_op->write.length == 0 ||
+        (p_op->write.length / WORD_SIZE) * FLASH_TIME_TO_WRITE_ONE_WORD_US > FLASH_OP_MAX_TIME_US)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    op_queue_init();
+
+    uint32_t error_code = NRF_SUCCESS;
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (m_urgent_op.type != FLASH_OP_TYPE_NONE)
+    {
+        error_code = NRF_ERROR_BUSY;
+    }
+    else
+    {
+        m_urgent_op.operation = *p_op;
+        m_urgent_op.type = FLASH_OP_TYPE_WRITE;
+    }
+    _ENABLE_IRQS(was_masked);
+    return error_code;
+}
+
+bool mesh_flash_urgent_pending(void)
+{
+    return (m_urgent_op.type != FLASH_OP_TYPE_NONE);
 }
 
 uint32_t mesh_flash_op_available_slots(void)
@@ -346,6 +539,19 @@ void mesh_flash_op_execute(timestamp_t available_time)
         {
             return;
         }
+        if (m_urgent_op.type != FLASH_OP_TYPE_NONE)
+        {
+            /* goes in between the pieces of the current operation, which
+               never share flash words with it */
+            if (available_time < operation_time(&m_urgent_op) + FLASH_OP_POST_PROCESS_TIME_US)
+            {
+                return;
+            }
+            operation_execute(&m_urgent_op);
+            available_time -= operation_time(&m_urgent_op) + FLASH_OP_POST_PROCESS_TIME_US;
+            m_urgent_op.type = FLASH_OP_TYPE_NONE;
+            continue;
+        }
         if (operation_time(&m_curr_op) == 0) /* done with previous event */
         {
             if (!send_end_evt())
@@ -380,6 +586,15 @@ void mesh_flash_op_execute(timestamp_t available_time)
     }
 }
 
+void mesh_flash_queue_stats_get(mesh_flash_queue_stats_t* p_stats)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(p_stats, &m_queue_stats, sizeof(m_queue_stats));
+    p_stats->length = fifo_get_len(&m_flash_op_fifo);
+    _ENABLE_IRQS(was_masked);
+}
+
 void mesh_flash_set_suspended(bool suspend)
 {
     static uint32_t suspend_count = 0;
@@ -0,0 +1,125 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_freertos.h"
+
+#ifdef RBC_MESH_FREERTOS
+
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "app_util_platform.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#ifdef NRF52
+#define MESH_FREERTOS_IRQ           SWI3_EGU3_IRQn
+#define MESH_FREERTOS_IRQHandler    SWI3_EGU3_IRQHandler
+#else
+#define MESH_FREERTOS_IRQ           SWI3_IRQn
+#define MESH_FREERTOS_IRQHandler    SWI3_IRQHandler
+#endif
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static TaskHandle_t m_task;
+static mesh_freertos_event_handler_t m_event_handler;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void mesh_task(void* p_arg)
+{
+    rbc_mesh_event_t evt;
+
+    while (true)
+    {
+        /* events pushed after the queue was found empty leave a notification
+           pending, so none are missed */
+        (void) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (rbc_mesh_event_get(&evt) == NRF_SUCCESS)
+        {
+            m_event_handler(&evt);
+            rbc_mesh_event_release(&evt);
+        }
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+uint32_t mesh_freertos_init(mesh_freertos_event_handler_t event_handler)
+{
+    if (event_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (m_task != NULL)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_event_handler = event_handler;
+    if (xTaskCreate(mesh_task, "MESH", RBC_MESH_FREERTOS_TASK_STACK_SIZE, NULL,
+                RBC_MESH_FREERTOS_TASK_PRIORITY, &m_task) != pdPASS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    NVIC_SetPriority(MESH_FREERTOS_IRQ, APP_IRQ_PRIORITY_LOW);
+    NVIC_ClearPendingIRQ(MESH_FREERTOS_IRQ);
+    NVIC_EnableIRQ(MESH_FREERTOS_IRQ);
+
+    /* deliver the events queued before the task existed */
+    NVIC_SetPendingIRQ(MESH_FREERTOS_IRQ);
+    return NRF_SUCCESS;
+}
+
+void mesh_freertos_event_notify(void)
+{
+    /* the kernel can't be called from the timeslot context, so defer the
+       notification to an interrupt at a priority the kernel allows */
+    NVIC_SetPendingIRQ(MESH_FREERTOS_IRQ);
+}
+
+void MESH_FREERTOS_IRQHandler(void)
+{
+    BaseType_t yield_required = pdFALSE;
+
+    if (m_task != NULL)
+    {
+        vTaskNotifyGiveFromISR(m_task, &yield_required);
+    }
+    portYIELD_FROM_ISR(yield_required);
+}
+
+#endif /* RBC_MESH_FREERTOS */
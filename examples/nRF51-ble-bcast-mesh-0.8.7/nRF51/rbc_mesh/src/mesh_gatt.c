@@ -41,21 +41,62 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "ble_gatts.h"
 #include "ble_err.h"
+#include "nordic_common.h"
 #include <string.h>
 
 extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_event);
 
+#ifndef MESH_GATT_CONN_COUNT
+/** Number of GATT clients served at the same time, should match the
+ * periph_conn_count the application enables the softdevice with. */
+#define MESH_GATT_CONN_COUNT    (1)
+#endif
+
+#ifndef MESH_GATT_QUEUE_SIZE
+/** Number of events kept per connection while waiting for the softdevice to
+ * free up TX buffers. */
+#define MESH_GATT_QUEUE_SIZE    (8)
+#endif
+
+#ifndef MESH_GATT_ATT_MTU_MAX
+/** Largest ATT MTU accepted in an MTU exchange, must match the att_mtu the
+ * application enables the softdevice with. */
+#define MESH_GATT_ATT_MTU_MAX   (GATT_MTU_SIZE_DEFAULT)
+#endif
+
+#ifndef MESH_GATT_EVT_PACKING
+/** Pack consecutive queued events into a single notification when the ATT MTU allows it. */
+#define MESH_GATT_EVT_PACKING   (1)
+#endif
+
+#ifndef MESH_GATT_QUEUED_WRITES
+/** Accept long (queued) writes to the value characteristic, carrying a batch
+ * of commands. Disable if the application answers the softdevice's user memory
+ * requests itself. */
+#define MESH_GATT_QUEUED_WRITES (1)
+#endif
+
+#ifndef MESH_GATT_BATCH_LEN_MAX
+/** Longest command batch accepted in a single long write, at most 512 bytes. */
+#define MESH_GATT_BATCH_LEN_MAX (256)
+#endif
+
+#if (NORDIC_SDK_VERSION >= 11)
+#define MESH_GATT_ERROR_NO_TX   (BLE_ERROR_NO_TX_PACKETS)
+#else
+#define MESH_GATT_ERROR_NO_TX   (BLE_ERROR_NO_TX_BUFFERS)
+#endif
+
 typedef struct
 {
     uint16_t service_handle;
-    bool notification_enabled;
     ble_gatts_char_handles_t ble_md_char_handles;
     ble_gatts_char_handles_t ble_val_char_handles;
 } mesh_srv_t;
 /*****************************************************************************
 * Static globals
 *****************************************************************************/
-static mesh_srv_t m_mesh_service = {0, false, {0}, {0}};
+static mesh_srv_t m_mesh_service = {0, {0}, {0}};
 
 static const ble_uuid128_t m_mesh_base_uuid = {{0x1E, 0xCD, 0x00, 0x00,
                                             0x8C, 0xB9, 0xA8, 0x8B,
@@ -63,15 +104,16 @@ static const ble_uuid128_t m_mesh_base_uuid = {{0x1E, 0xCD, 0x00, 0x00,
                                             0xA1, 0x77, 0x1E, 0x2A}};
 static uint8_t m_mesh_base_uuid_type;
 
-static uint16_t m_active_conn_handle = CONN_HANDLE_INVALID;
-
 typedef enum
 {
     MESH_GATT_EVT_OPCODE_DATA = 0x00,
     MESH_GATT_EVT_OPCODE_FLAG_SET = 0x01,
     MESH_GATT_EVT_OPCODE_FLAG_REQ = 0x02,
+    MESH_GATT_EVT_OPCODE_FAULT_REQ = 0x03,
     MESH_GATT_EVT_OPCODE_CMD_RSP  = 0x11,
     MESH_GATT_EVT_OPCODE_FLAG_RSP = 0x12,
+    MESH_GATT_EVT_OPCODE_BATCH_RSP = 0x13,
+    MESH_GATT_EVT_OPCODE_FAULT_RSP = 0x14,
 } mesh_gatt_evt_opcode_t;
 
 typedef enum
@@ -82,8 +124,15 @@ typedef enum
     MESH_GATT_RESULT_ERROR_INVALID_HANDLE = 0xF2,
     MESH_GATT_RESULT_ERROR_UNKNOWN_FLAG = 0xF3,
     MESH_GATT_RESULT_ERROR_INVALID_OPCODE = 0xF4,
+    MESH_GATT_RESULT_ERROR_INVALID_LENGTH = 0xF5,
 } mesh_gatt_result_t;
 
+/** First failed command index in a batch response where all commands succeeded. */
+#define MESH_GATT_BATCH_NO_FAILURE  (0xFF)
+
+/** Bytes of a fault record in each fault response, two of which fit a notification at the default ATT MTU. */
+#define MESH_GATT_FAULT_PART_LEN    (sizeof(rbc_mesh_fault_record_t) / 2)
+
 typedef enum
 {
     MESH_GATT_EVT_FLAG_PERSISTENT,
@@ -101,7 +150,7 @@ typedef __packed_armcc struct
 {
     rbc_mesh_value_handle_t handle;
     uint8_t data_len;
-    uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+    uint8_t data[RBC_MESH_LEGACY_VALUE_MAX_LEN];
 } __packed_gcc gatt_evt_data_update_t;
 
 typedef __packed_armcc struct
@@ -110,6 +159,26 @@ typedef __packed_armcc struct
     uint8_t result;
 } __packed_gcc gatt_evt_cmd_rsp_t;
 
+typedef __packed_armcc struct
+{
+    uint8_t count;          /**< Number of commands in the batch. */
+    uint8_t failed;         /**< Number of commands that failed. */
+    uint8_t first_failed;   /**< Index of the first failed command. */
+    uint8_t result;         /**< Result of the first failed command. */
+} __packed_gcc gatt_evt_batch_rsp_t;
+
+typedef __packed_armcc struct
+{
+    uint8_t index;          /**< Index of the fault, 0 for the latest one. */
+} __packed_gcc gatt_evt_fault_req_t;
+
+typedef __packed_armcc struct
+{
+    uint8_t index;          /**< Index of the fault, 0 for the latest one. */
+    uint8_t part;           /**< Which half of the record this is. */
+    uint8_t data[MESH_GATT_FAULT_PART_LEN];
+} __packed_gcc gatt_evt_fault_rsp_t;
+
 typedef __packed_armcc struct
 {
     uint8_t opcode;
@@ -117,80 +186,540 @@ typedef __packed_armcc struct
         gatt_evt_flag_update_t  flag_update;
         gatt_evt_data_update_t  data_update;
         gatt_evt_cmd_rsp_t      cmd_rsp;
+        gatt_evt_batch_rsp_t    batch_rsp;
+        gatt_evt_fault_req_t    fault_req;
+        gatt_evt_fault_rsp_t    fault_rsp;
     } __packed_gcc param;
 } __packed_gcc mesh_gatt_evt_t;
 
+#define MESH_GATT_HVX_BUFFER_LEN    (MAX(sizeof(mesh_gatt_evt_t), MESH_GATT_ATT_MTU_MAX - 3))
+
+#if MESH_GATT_QUEUED_WRITES
+#define MESH_GATT_VALUE_CHAR_LEN_MAX        (MAX(MESH_GATT_HVX_BUFFER_LEN, MESH_GATT_BATCH_LEN_MAX))
+/** Size of each prepared write's (handle, offset, length) header in the user memory block. */
+#define MESH_GATT_QUEUED_WRITE_HEADER_LEN   (6)
+/** User memory needed for a full batch in prepared writes of the smallest ATT MTU, and the end marker. */
+#define MESH_GATT_QUEUED_WRITE_MEM_LEN      (MESH_GATT_BATCH_LEN_MAX                                        \
+        + MESH_GATT_QUEUED_WRITE_HEADER_LEN * ((MESH_GATT_BATCH_LEN_MAX + GATT_MTU_SIZE_DEFAULT - 6) / (GATT_MTU_SIZE_DEFAULT - 5)) \
+        + 2)
+#else
+#define MESH_GATT_VALUE_CHAR_LEN_MAX        (MESH_GATT_HVX_BUFFER_LEN)
+#endif
+
+/** One notification worth of events, waiting for a TX buffer. */
+typedef struct
+{
+    uint8_t length;
+    mesh_gatt_evt_t evt;
+} gatt_evt_queue_entry_t;
+
+typedef struct
+{
+    gatt_evt_queue_entry_t entries[MESH_GATT_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t count;
+    uint8_t sending; /**< Entries at the head currently being passed to the softdevice. */
+} gatt_evt_queue_t;
+
+/** Connected GATT client, each with their own event queue. */
+typedef struct
+{
+    uint16_t conn_handle;
+    bool notification_enabled;
+    uint16_t att_mtu;
+    gatt_evt_queue_t evt_queue;
+} mesh_gatt_conn_t;
+
+static mesh_gatt_conn_t m_conns[MESH_GATT_CONN_COUNT];
+
+/** Value characteristic storage, kept out of the softdevice attribute table to fit long writes. */
+static uint8_t m_value_char_buf[MESH_GATT_VALUE_CHAR_LEN_MAX];
+
+#if MESH_GATT_QUEUED_WRITES
+/** Prepared writes, lent to one connection at a time. */
+static uint8_t m_queued_write_mem[MESH_GATT_QUEUED_WRITE_MEM_LEN];
+static uint16_t m_queued_write_conn_handle;
+#endif
+
 /*****************************************************************************
 * Static functions
 *****************************************************************************/
-static uint32_t mesh_gatt_evt_push(mesh_gatt_evt_t* p_gatt_evt)
+static uint8_t mesh_gatt_evt_length_get(mesh_gatt_evt_t* p_gatt_evt)
 {
-    if (m_active_conn_handle == CONN_HANDLE_INVALID)
+    switch (p_gatt_evt->opcode)
+    {
+        case MESH_GATT_EVT_OPCODE_DATA:
+            return p_gatt_evt->param.data_update.data_len + 4;
+        case MESH_GATT_EVT_OPCODE_FLAG_SET:
+        case MESH_GATT_EVT_OPCODE_FLAG_REQ:
+        case MESH_GATT_EVT_OPCODE_FLAG_RSP:
+            return 5;
+        case MESH_GATT_EVT_OPCODE_CMD_RSP:
+            return 3;
+        case MESH_GATT_EVT_OPCODE_BATCH_RSP:
+            return 5;
+        case MESH_GATT_EVT_OPCODE_FAULT_REQ:
+            return 2;
+        case MESH_GATT_EVT_OPCODE_FAULT_RSP:
+            return MESH_GATT_FAULT_PART_LEN + 3;
+        default:
+            return 1;
+    }
+}
+
+/** Get the connection with the given handle, or a free one for CONN_HANDLE_INVALID. */
+static mesh_gatt_conn_t* conn_get(uint16_t conn_handle)
+{
+    for (uint32_t i = 0; i < MESH_GATT_CONN_COUNT; ++i)
+    {
+        if (m_conns[i].conn_handle == conn_handle)
+        {
+            return &m_conns[i];
+        }
+    }
+    return NULL;
+}
+
+static inline gatt_evt_queue_entry_t* evt_queue_entry_get(gatt_evt_queue_t* p_queue, uint32_t index)
+{
+    return &p_queue->entries[(p_queue->head + index) % MESH_GATT_QUEUE_SIZE];
+}
+
+static void evt_queue_reset(gatt_evt_queue_t* p_queue)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    p_queue->head = 0;
+    p_queue->count = 0;
+    p_queue->sending = 0;
+    _ENABLE_IRQS(was_masked);
+}
+
+/**
+* Send queued events until the softdevice runs out of TX buffers. Called again
+* on TX complete to continue where it left off.
+*/
+static void evt_queue_flush(mesh_gatt_conn_t* p_conn)
+{
+    uint8_t hvx_data[MESH_GATT_HVX_BUFFER_LEN];
+    gatt_evt_queue_t* p_queue = &p_conn->evt_queue;
+    uint32_t was_masked;
+
+    while (p_conn->conn_handle != CONN_HANDLE_INVALID)
+    {
+        uint16_t hvx_len = 0;
+        uint8_t packed = 0;
+
+        _DISABLE_IRQS(was_masked);
+        if (p_queue->sending > 0 || p_queue->count == 0)
+        {
+            _ENABLE_IRQS(was_masked);
+            return;
+        }
+        do
+        {
+            gatt_evt_queue_entry_t* p_entry = evt_queue_entry_get(p_queue, packed);
+            if (packed > 0 && hvx_len + p_entry->length > p_conn->att_mtu - 3)
+            {
+                break;
+            }
+            memcpy(&hvx_data[hvx_len], &p_entry->evt, p_entry->length);
+            hvx_len += p_entry->length;
+            packed++;
+        } while (MESH_GATT_EVT_PACKING && packed < p_queue->count);
+        p_queue->sending = packed;
+        _ENABLE_IRQS(was_masked);
+
+        /* can't do SVC calls with interrupts masked */
+        ble_gatts_hvx_params_t hvx_params;
+        hvx_params.handle = m_mesh_service.ble_val_char_handles.value_handle;
+        hvx_params.type = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len = &hvx_len;
+        hvx_params.p_data = hvx_data;
+        uint32_t error_code = sd_ble_gatts_hvx(p_conn->conn_handle, &hvx_params);
+
+        bool wait_for_tx = (error_code == MESH_GATT_ERROR_NO_TX || error_code == NRF_ERROR_BUSY);
+
+        _DISABLE_IRQS(was_masked);
+        /* The queue may have been reset in the meantime. Events the
+           softdevice won't take for any other reason than a lack of buffers
+           are dropped, or they'd block the queue. */
+        if (p_queue->sending > 0 && !wait_for_tx)
+        {
+            if (packed > p_queue->count)
+            {
+                packed = p_queue->count;
+            }
+            p_queue->head = (p_queue->head + packed) % MESH_GATT_QUEUE_SIZE;
+            p_queue->count -= packed;
+        }
+        p_queue->sending = 0;
+        _ENABLE_IRQS(was_masked);
+
+        if (wait_for_tx)
+        {
+            return;
+        }
+    }
+}
+
+static uint32_t mesh_gatt_evt_push(mesh_gatt_conn_t* p_conn, mesh_gatt_evt_t* p_gatt_evt)
+{
+    if (p_conn == NULL)
     {
         return BLE_ERROR_INVALID_CONN_HANDLE;
     }
 
-    if (!m_mesh_service.notification_enabled)
+    if (!p_conn->notification_enabled)
     {
         return BLE_ERROR_NOT_ENABLED;
     }
 
-    uint8_t count;
-    uint8_t err_code;
+    uint8_t length = mesh_gatt_evt_length_get(p_gatt_evt);
+    gatt_evt_queue_entry_t* p_entry = NULL;
+    gatt_evt_queue_t* p_queue = &p_conn->evt_queue;
+    uint32_t was_masked;
 
-#if (NORDIC_SDK_VERSION >= 11) 
-    err_code = sd_ble_tx_packet_count_get(m_active_conn_handle, &count);
-#else
-    err_code = sd_ble_tx_buffer_count_get(&count);
-#endif
-    if (err_code != NRF_SUCCESS) 
+    _DISABLE_IRQS(was_masked);
+    if (p_gatt_evt->opcode == MESH_GATT_EVT_OPCODE_DATA)
     {
-        return NRF_ERROR_BUSY;
+        /* Only the latest value of a handle is of interest, replace any
+           update that isn't already on its way to the softdevice. */
+        for (uint32_t i = p_queue->sending; i < p_queue->count; ++i)
+        {
+            gatt_evt_queue_entry_t* p_queued = evt_queue_entry_get(p_queue, i);
+            if (p_queued->evt.opcode == MESH_GATT_EVT_OPCODE_DATA &&
+                p_queued->evt.param.data_update.handle == p_gatt_evt->param.data_update.handle)
+            {
+                p_entry = p_queued;
+                break;
+            }
+        }
     }
-    if (count == 0)
+    if (p_entry == NULL && p_queue->count < MESH_GATT_QUEUE_SIZE)
     {
-#if (NORDIC_SDK_VERSION >= 11) 
-        return BLE_ERROR_NO_TX_PACKETS;
-#else
-        return BLE_ERROR_NO_TX_BUFFERS;
-#endif
+        p_entry = evt_queue_entry_get(p_queue, p_queue->count++);
+    }
+    if (p_entry != NULL)
+    {
+        memcpy(&p_entry->evt, p_gatt_evt, length);
+        p_entry->length = length;
     }
+    _ENABLE_IRQS(was_masked);
 
-    ble_gatts_hvx_params_t hvx_params;
-    hvx_params.handle = m_mesh_service.ble_val_char_handles.value_handle;
-    hvx_params.type = BLE_GATT_HVX_NOTIFICATION;
-    hvx_params.offset = 0;
-    uint16_t hvx_len;
-    switch (p_gatt_evt->opcode)
+    if (p_entry == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    evt_queue_flush(p_conn);
+    return NRF_SUCCESS;
+}
+
+static uint32_t mesh_gatt_cmd_rsp_push(mesh_gatt_conn_t* p_conn, mesh_gatt_evt_opcode_t opcode, mesh_gatt_result_t result)
+{
+    mesh_gatt_evt_t rsp;
+    rsp.opcode = MESH_GATT_EVT_OPCODE_CMD_RSP;
+    rsp.param.cmd_rsp.opcode = opcode;
+    rsp.param.cmd_rsp.result = result;
+    return mesh_gatt_evt_push(p_conn, &rsp);
+}
+
+/**
+* Get the length of the command at the start of the given write data, or 0 if
+* the opcode is unknown or the command doesn't fit in the data.
+*/
+static uint16_t mesh_gatt_cmd_length_get(const uint8_t* p_data, uint16_t len)
+{
+    uint16_t cmd_len;
+    switch (p_data[0])
     {
         case MESH_GATT_EVT_OPCODE_DATA:
-            hvx_len = p_gatt_evt->param.data_update.data_len + 4;
+            if (len < 4 || p_data[3] > RBC_MESH_LEGACY_VALUE_MAX_LEN)
+            {
+                return 0;
+            }
+            cmd_len = p_data[3] + 4;
             break;
         case MESH_GATT_EVT_OPCODE_FLAG_SET:
         case MESH_GATT_EVT_OPCODE_FLAG_REQ:
-        case MESH_GATT_EVT_OPCODE_FLAG_RSP:
-            hvx_len = 5;
+            cmd_len = 5;
             break;
-        case MESH_GATT_EVT_OPCODE_CMD_RSP:
-            hvx_len = 3;
+        case MESH_GATT_EVT_OPCODE_FAULT_REQ:
+            cmd_len = 2;
             break;
         default:
-            hvx_len = 1;
+            return 0;
     }
-    hvx_params.p_len = &hvx_len;
-    hvx_params.p_data = (uint8_t*) p_gatt_evt;
+    return (cmd_len <= len ? cmd_len : 0);
+}
 
-    return sd_ble_gatts_hvx(m_active_conn_handle, &hvx_params);
+/**
+* Execute a single command from the client. Flag requests answer with a flag
+* response event on success, all other results are left to the caller.
+*/
+static mesh_gatt_result_t mesh_gatt_cmd_handle(mesh_gatt_conn_t* p_conn, mesh_gatt_evt_t* p_gatt_evt, bool batched)
+{
+    switch ((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode)
+    {
+        case MESH_GATT_EVT_OPCODE_DATA:
+            {
+                if (p_gatt_evt->param.data_update.handle == RBC_MESH_INVALID_HANDLE)
+                {
+                    return MESH_GATT_RESULT_ERROR_INVALID_HANDLE;
+                }
+                uint32_t error_code = vh_local_update(
+                        p_gatt_evt->param.data_update.handle,
+                        p_gatt_evt->param.data_update.data,
+                        p_gatt_evt->param.data_update.data_len);
+
+                if (error_code != NRF_SUCCESS)
+                {
+                    return MESH_GATT_RESULT_ERROR_BUSY;
+                }
+
+                rbc_mesh_event_t mesh_evt;
+                mesh_evt.type = RBC_MESH_EVENT_TYPE_UPDATE_VAL;
+                mesh_evt.params.rx.p_data        = p_gatt_evt->param.data_update.data;
+                mesh_evt.params.rx.data_len      = p_gatt_evt->param.data_update.data_len;
+                mesh_evt.params.rx.value_handle  = p_gatt_evt->param.data_update.handle;
+                mesh_evt.params.rx.version_delta = 1;
+                mesh_evt.params.rx.timestamp_us  = timer_now();
+                /* A batch may hold more updates than the application event
+                   queue, the values are in the mesh either way, so a full
+                   queue only fails single commands. */
+                if (rbc_mesh_event_push(&mesh_evt) != NRF_SUCCESS && !batched)
+                {
+                    return MESH_GATT_RESULT_ERROR_BUSY;
+                }
+                return MESH_GATT_RESULT_SUCCESS;
+            }
+
+        case MESH_GATT_EVT_OPCODE_FLAG_SET:
+            switch ((mesh_gatt_evt_flag_t) p_gatt_evt->param.flag_update.flag)
+            {
+                case MESH_GATT_EVT_FLAG_PERSISTENT:
+                    if (vh_value_persistence_set(p_gatt_evt->param.flag_update.handle,
+                                !!(p_gatt_evt->param.flag_update.value))
+                            != NRF_SUCCESS)
+                    {
+                        return MESH_GATT_RESULT_ERROR_INVALID_HANDLE;
+                    }
+                    return MESH_GATT_RESULT_SUCCESS;
+
+                case MESH_GATT_EVT_FLAG_DO_TX:
+                    if (p_gatt_evt->param.flag_update.value)
+                    {
+                        if (vh_value_enable(p_gatt_evt->param.flag_update.handle)
+                                != NRF_SUCCESS)
+                        {
+                            return MESH_GATT_RESULT_ERROR_INVALID_HANDLE;
+                        }
+                    }
+                    else
+                    {
+                        if (vh_value_disable(p_gatt_evt->param.flag_update.handle)
+                                != NRF_SUCCESS)
+                        {
+                            return MESH_GATT_RESULT_ERROR_INVALID_HANDLE;
+                        }
+                    }
+                    return MESH_GATT_RESULT_SUCCESS;
+
+                default:
+                    return MESH_GATT_RESULT_ERROR_UNKNOWN_FLAG;
+            }
+
+        case MESH_GATT_EVT_OPCODE_FLAG_REQ:
+            {
+                bool flag_value;
+                switch ((mesh_gatt_evt_flag_t) p_gatt_evt->param.flag_update.flag)
+                {
+                    case MESH_GATT_EVT_FLAG_PERSISTENT:
+                        if (p_gatt_evt->param.flag_update.handle == RBC_MESH_INVALID_HANDLE)
+                        {
+                            return MESH_GATT_RESULT_ERROR_INVALID_HANDLE;
+                        }
+                        if (vh_value_persistence_get(p_gatt_evt->param.flag_update.handle, &flag_value)
+                                != NRF_SUCCESS)
+                        {
+                            return MESH_GATT_RESULT_ERROR_NOT_FOUND;
+                        }
+                        break;
+
+                    case MESH_GATT_EVT_FLAG_DO_TX:
+                        if (vh_value_is_enabled(p_gatt_evt->param.flag_update.handle, &flag_value)
+                                != NRF_SUCCESS)
+                        {
+                            return MESH_GATT_RESULT_ERROR_INVALID_HANDLE;
+                        }
+                        break;
+
+                    default:
+                        return MESH_GATT_RESULT_ERROR_UNKNOWN_FLAG;
+                }
+
+                mesh_gatt_evt_t rsp_evt;
+                rsp_evt.opcode = MESH_GATT_EVT_OPCODE_FLAG_RSP;
+                rsp_evt.param.flag_update.handle = p_gatt_evt->param.flag_update.handle;
+                rsp_evt.param.flag_update.flag = p_gatt_evt->param.flag_update.flag;
+                rsp_evt.param.flag_update.value = (uint8_t) flag_value;
+                mesh_gatt_evt_push(p_conn, &rsp_evt);
+                return MESH_GATT_RESULT_SUCCESS;
+            }
+
+        case MESH_GATT_EVT_OPCODE_FAULT_REQ:
+            {
+                rbc_mesh_fault_record_t record;
+                uint32_t error_code = rbc_mesh_fault_get(p_gatt_evt->param.fault_req.index, &record);
+                if (error_code == NRF_ERROR_NOT_SUPPORTED)
+                {
+                    return MESH_GATT_RESULT_ERROR_INVALID_OPCODE;
+                }
+                if (error_code != NRF_SUCCESS)
+                {
+                    return MESH_GATT_RESULT_ERROR_NOT_FOUND;
+                }
+
+                /* the record doesn't fit a notification at the default ATT MTU, send it in two halves */
+                mesh_gatt_evt_t rsp_evt;
+                rsp_evt.opcode = MESH_GATT_EVT_OPCODE_FAULT_RSP;
+                rsp_evt.param.fault_rsp.index = p_gatt_evt->param.fault_req.index;
+                for (uint8_t part = 0; part < 2; ++part)
+                {
+                    rsp_evt.param.fault_rsp.part = part;
+                    memcpy(rsp_evt.param.fault_rsp.data,
+                           (uint8_t*) &record + part * MESH_GATT_FAULT_PART_LEN,
+                           MESH_GATT_FAULT_PART_LEN);
+                    mesh_gatt_evt_push(p_conn, &rsp_evt);
+                }
+                return MESH_GATT_RESULT_SUCCESS;
+            }
+
+        default:
+            return MESH_GATT_RESULT_ERROR_INVALID_OPCODE;
+    }
 }
 
-static uint32_t mesh_gatt_cmd_rsp_push(mesh_gatt_evt_opcode_t opcode, mesh_gatt_result_t result)
+/**
+* Handle a value characteristic write. A write holding a single command gets
+* its own command response. Several commands back to back are applied in one
+* pass, and acknowledged with a single batch response.
+*/
+static void mesh_gatt_value_write_handle(mesh_gatt_conn_t* p_conn, uint8_t* p_data, uint16_t len)
 {
+    if (len == 0)
+    {
+        return;
+    }
+
+    uint16_t cmd_len = mesh_gatt_cmd_length_get(p_data, len);
+    if (cmd_len == 0 || cmd_len == len)
+    {
+        mesh_gatt_result_t result;
+        if (cmd_len == 0)
+        {
+            result = (p_data[0] <= MESH_GATT_EVT_OPCODE_FAULT_REQ) ?
+                MESH_GATT_RESULT_ERROR_INVALID_LENGTH :
+                MESH_GATT_RESULT_ERROR_INVALID_OPCODE;
+        }
+        else
+        {
+            result = mesh_gatt_cmd_handle(p_conn, (mesh_gatt_evt_t*) p_data, false);
+        }
+        if (result != MESH_GATT_RESULT_SUCCESS ||
+            (p_data[0] != MESH_GATT_EVT_OPCODE_FLAG_REQ && p_data[0] != MESH_GATT_EVT_OPCODE_FAULT_REQ))
+        {
+            mesh_gatt_cmd_rsp_push(p_conn, (mesh_gatt_evt_opcode_t) p_data[0], result);
+        }
+        return;
+    }
+
     mesh_gatt_evt_t rsp;
-    rsp.opcode = MESH_GATT_EVT_OPCODE_CMD_RSP;
-    rsp.param.cmd_rsp.opcode = opcode;
-    rsp.param.cmd_rsp.result = result;
-    return mesh_gatt_evt_push(&rsp);
+    rsp.opcode = MESH_GATT_EVT_OPCODE_BATCH_RSP;
+    rsp.param.batch_rsp.count = 0;
+    rsp.param.batch_rsp.failed = 0;
+    rsp.param.batch_rsp.first_failed = MESH_GATT_BATCH_NO_FAILURE;
+    rsp.param.batch_rsp.result = MESH_GATT_RESULT_SUCCESS;
+
+    uint16_t offset = 0;
+    while (offset < len)
+    {
+        mesh_gatt_result_t result;
+        cmd_len = mesh_gatt_cmd_length_get(&p_data[offset], len - offset);
+        if (cmd_len == 0)
+        {
+            /* can't find the start of the next command, give up on the rest */
+            result = (p_data[offset] <= MESH_GATT_EVT_OPCODE_FAULT_REQ) ?
+                MESH_GATT_RESULT_ERROR_INVALID_LENGTH :
+                MESH_GATT_RESULT_ERROR_INVALID_OPCODE;
+            offset = len;
+        }
+        else
+        {
+            result = mesh_gatt_cmd_handle(p_conn, (mesh_gatt_evt_t*) &p_data[offset], true);
+            offset += cmd_len;
+        }
+
+        if (result != MESH_GATT_RESULT_SUCCESS)
+        {
+            if (rsp.param.batch_rsp.failed++ == 0)
+            {
+                rsp.param.batch_rsp.first_failed = rsp.param.batch_rsp.count;
+                rsp.param.batch_rsp.result = result;
+            }
+        }
+        rsp.param.batch_rsp.count++;
+    }
+
+    mesh_gatt_evt_push(p_conn, &rsp);
+}
+
+#if MESH_GATT_QUEUED_WRITES
+/**
+* Collect the prepared writes to the value characteristic into one buffer. The
+* Softdevice stores them as a list of (handle, offset, length, data) entries
+* ending in an invalid handle, in the order they were received. The data is
+* moved to the start of the block, which is never ahead of the entry it is
+* copied from.
+*
+* @return Length of the assembled write, or 0 if the writes weren't one
+*         contiguous value.
+*/
+static uint16_t mesh_gatt_queued_writes_assemble(void)
+{
+    uint16_t len = 0;
+    uint32_t index = 0;
+    while (index + MESH_GATT_QUEUED_WRITE_HEADER_LEN <= sizeof(m_queued_write_mem))
+    {
+        const uint8_t* p_entry = &m_queued_write_mem[index];
+        uint16_t handle = p_entry[0] | (p_entry[1] << 8);
+        uint16_t offset = p_entry[2] | (p_entry[3] << 8);
+        uint16_t entry_len = p_entry[4] | (p_entry[5] << 8);
+
+        if (handle == BLE_GATT_HANDLE_INVALID)
+        {
+            break;
+        }
+        if (index + MESH_GATT_QUEUED_WRITE_HEADER_LEN + entry_len > sizeof(m_queued_write_mem))
+        {
+            return 0;
+        }
+        if (handle == m_mesh_service.ble_val_char_handles.value_handle)
+        {
+            if (offset != len)
+            {
+                return 0;
+            }
+            memmove(&m_queued_write_mem[len], &p_entry[MESH_GATT_QUEUED_WRITE_HEADER_LEN], entry_len);
+            len += entry_len;
+        }
+        index += MESH_GATT_QUEUED_WRITE_HEADER_LEN + entry_len;
+    }
+    return len;
 }
+#endif
 
 static uint32_t mesh_md_char_add(mesh_metadata_char_t* metadata)
 {
@@ -287,6 +816,7 @@ static uint32_t mesh_value_char_add(void)
     memset(&ble_char_md, 0, sizeof(ble_char_md));
 
     ble_char_md.char_props.write_wo_resp = 1;
+    ble_char_md.char_props.write = MESH_GATT_QUEUED_WRITES;
     ble_char_md.char_props.notify = 1;
 
     ble_char_md.p_cccd_md = NULL;
@@ -304,7 +834,7 @@ static uint32_t mesh_value_char_add(void)
     ble_attr_md.write_perm.lv = 1;
     ble_attr_md.write_perm.sm = 1;
 
-    ble_attr_md.vloc = BLE_GATTS_VLOC_STACK;
+    ble_attr_md.vloc = BLE_GATTS_VLOC_USER;
     ble_attr_md.rd_auth = 0;
     ble_attr_md.wr_auth = 0;
     ble_attr_md.vlen = 1;
@@ -317,16 +847,16 @@ static uint32_t mesh_value_char_add(void)
 
     /* ble attribute */
     ble_gatts_attr_t ble_attr;
-    uint8_t default_value = 0;
 
     memset(&ble_attr, 0, sizeof(ble_attr));
+    memset(m_value_char_buf, 0, sizeof(m_value_char_buf));
 
     ble_attr.init_len = 1;
     ble_attr.init_offs = 0;
-    ble_attr.max_len = sizeof(mesh_gatt_evt_t);
+    ble_attr.max_len = MESH_GATT_VALUE_CHAR_LEN_MAX;
     ble_attr.p_attr_md = &ble_attr_md;
     ble_attr.p_uuid = &ble_uuid;
-    ble_attr.p_value = &default_value;
+    ble_attr.p_value = m_value_char_buf;
 
     /* add to service */
     uint32_t error_code = sd_ble_gatts_characteristic_add(
@@ -353,6 +883,15 @@ uint32_t mesh_gatt_init(uint32_t access_address, uint8_t channel, uint32_t inter
     md_char.mesh_interval_min_ms = interval_min_ms;
     md_char.mesh_channel = channel;
 
+    for (uint32_t i = 0; i < MESH_GATT_CONN_COUNT; ++i)
+    {
+        m_conns[i].conn_handle = CONN_HANDLE_INVALID;
+        m_conns[i].notification_enabled = false;
+    }
+#if MESH_GATT_QUEUED_WRITES
+    m_queued_write_conn_handle = CONN_HANDLE_INVALID;
+#endif
+
     ble_uuid_t ble_srv_uuid;
     ble_srv_uuid.type = BLE_UUID_TYPE_BLE;
     ble_srv_uuid.uuid = MESH_SRV_UUID;
@@ -387,171 +926,62 @@ uint32_t mesh_gatt_init(uint32_t access_address, uint8_t channel, uint32_t inter
 
 uint32_t mesh_gatt_value_set(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
 {
-    if (length > RBC_MESH_VALUE_MAX_LEN)
+    if (length > RBC_MESH_LEGACY_VALUE_MAX_LEN)
     {
         return NRF_ERROR_INVALID_LENGTH;
     }
-    if (m_active_conn_handle != CONN_HANDLE_INVALID)
-    {
-        mesh_gatt_evt_t gatt_evt;
-        gatt_evt.opcode = MESH_GATT_EVT_OPCODE_DATA;
-        gatt_evt.param.data_update.handle = handle;
-        gatt_evt.param.data_update.data_len = length;
-        memcpy(gatt_evt.param.data_update.data, data, length);
 
-        return mesh_gatt_evt_push(&gatt_evt);
-    }
-    else
+    mesh_gatt_evt_t gatt_evt;
+    gatt_evt.opcode = MESH_GATT_EVT_OPCODE_DATA;
+    gatt_evt.param.data_update.handle = handle;
+    gatt_evt.param.data_update.data_len = length;
+    memcpy(gatt_evt.param.data_update.data, data, length);
+
+    /* Every client gets its own copy, a client without room in its queue
+       doesn't keep the others from getting the update. */
+    uint32_t error_code = BLE_ERROR_INVALID_CONN_HANDLE;
+    for (uint32_t i = 0; i < MESH_GATT_CONN_COUNT; ++i)
     {
-        return BLE_ERROR_INVALID_CONN_HANDLE;
+        if (m_conns[i].conn_handle == CONN_HANDLE_INVALID)
+        {
+            continue;
+        }
+        uint32_t conn_error_code = mesh_gatt_evt_push(&m_conns[i], &gatt_evt);
+        if (conn_error_code == NRF_ERROR_NO_MEM)
+        {
+            error_code = NRF_ERROR_NO_MEM;
+        }
+        else if (error_code != NRF_ERROR_NO_MEM && error_code != NRF_SUCCESS)
+        {
+            error_code = conn_error_code;
+        }
     }
+    return error_code;
 }
 
 void mesh_gatt_sd_ble_event_handle(ble_evt_t* p_ble_evt)
 {
     if (p_ble_evt->header.evt_id == BLE_GATTS_EVT_WRITE)
     {
-        if (p_ble_evt->evt.gatts_evt.params.write.handle == m_mesh_service.ble_val_char_handles.value_handle)
+        mesh_gatt_conn_t* p_conn = conn_get(p_ble_evt->evt.gatts_evt.conn_handle);
+
+#if MESH_GATT_QUEUED_WRITES
+        if (p_ble_evt->evt.gatts_evt.params.write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW)
         {
-            mesh_gatt_evt_t* p_gatt_evt = (mesh_gatt_evt_t*) p_ble_evt->evt.gatts_evt.params.write.data;
-            switch ((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode)
+            if (m_queued_write_conn_handle == p_ble_evt->evt.gatts_evt.conn_handle)
             {
-                case MESH_GATT_EVT_OPCODE_DATA:
-                    {
-                        if (p_gatt_evt->param.data_update.handle == RBC_MESH_INVALID_HANDLE)
-                        {
-                            mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_INVALID_HANDLE);
-                            break;
-                        }
-                        uint32_t error_code = vh_local_update(
-                                p_gatt_evt->param.data_update.handle,
-                                p_gatt_evt->param.data_update.data,
-                                p_gatt_evt->param.data_update.data_len);
-
-                        if (error_code == NRF_SUCCESS)
-                        {
-                            rbc_mesh_event_t mesh_evt;
-                            mesh_evt.type = RBC_MESH_EVENT_TYPE_UPDATE_VAL;
-                            mesh_evt.params.rx.p_data        = p_gatt_evt->param.data_update.data;
-                            mesh_evt.params.rx.data_len      = p_gatt_evt->param.data_update.data_len;
-                            mesh_evt.params.rx.value_handle  = p_gatt_evt->param.data_update.handle;
-                            mesh_evt.params.rx.version_delta = 1;
-                            mesh_evt.params.rx.timestamp_us  = timer_now();
-                            if (rbc_mesh_event_push(&mesh_evt) != NRF_SUCCESS)
-                            {
-                                mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_BUSY);
-                            }
-                            else
-                            {
-                                mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_SUCCESS);
-                            }
-                        }
-                        else
-                        {
-                            mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_BUSY);
-                        }
-
-                    }
-                    break;
-
-                case MESH_GATT_EVT_OPCODE_FLAG_SET:
-                    switch ((mesh_gatt_evt_flag_t) p_gatt_evt->param.flag_update.flag)
-                    {
-                        case MESH_GATT_EVT_FLAG_PERSISTENT:
-                            if (vh_value_persistence_set(p_gatt_evt->param.flag_update.handle,
-                                        !!(p_gatt_evt->param.flag_update.value))
-                                    != NRF_SUCCESS)
-                            {
-                                mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_INVALID_HANDLE);
-                                break;
-                            }
-                            mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_SUCCESS);
-                            break;
-
-                        case MESH_GATT_EVT_FLAG_DO_TX:
-                            if (p_gatt_evt->param.flag_update.value)
-                            {
-                                if (vh_value_enable(p_gatt_evt->param.flag_update.handle)
-                                        != NRF_SUCCESS)
-                                {
-                                    mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_INVALID_HANDLE);
-                                    break;
-                                }
-                                mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_SUCCESS);
-                            }
-                            else
-                            {
-                                if (vh_value_disable(p_gatt_evt->param.flag_update.handle)
-                                        != NRF_SUCCESS)
-                                {
-                                    mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_INVALID_HANDLE);
-                                    break;
-                                }
-                                mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_SUCCESS);
-                            }
-                            break;
-
-                        default:
-                            mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_UNKNOWN_FLAG);
-                    }
-                    break;
-
-                case MESH_GATT_EVT_OPCODE_FLAG_REQ:
-                    switch ((mesh_gatt_evt_flag_t) p_gatt_evt->param.flag_update.flag)
-                    {
-                        case MESH_GATT_EVT_FLAG_PERSISTENT:
-                            {
-                                if (p_gatt_evt->param.flag_update.handle == RBC_MESH_INVALID_HANDLE)
-                                {
-                                    mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_INVALID_HANDLE);
-                                    break;
-                                }
-
-                                bool is_persistent = false;
-                                if (vh_value_persistence_get(p_gatt_evt->param.flag_update.handle, &is_persistent)
-                                        != NRF_SUCCESS)
-                                {
-                                    mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_NOT_FOUND);
-                                    break;
-                                }
-
-                                mesh_gatt_evt_t rsp_evt;
-                                rsp_evt.opcode = MESH_GATT_EVT_OPCODE_FLAG_RSP;
-                                rsp_evt.param.flag_update.handle = p_gatt_evt->param.flag_update.handle;
-                                rsp_evt.param.flag_update.flag = p_gatt_evt->param.flag_update.flag;
-                                rsp_evt.param.flag_update.value = (uint8_t) is_persistent;
-                                mesh_gatt_evt_push(&rsp_evt);
-                            }
-                            break;
-
-                        case MESH_GATT_EVT_FLAG_DO_TX:
-                            {
-                                bool is_enabled;
-                                if (vh_value_is_enabled(p_gatt_evt->param.flag_update.handle, &is_enabled)
-                                        != NRF_SUCCESS)
-                                {
-                                    mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_INVALID_HANDLE);
-                                    break;
-                                }
-
-                                mesh_gatt_evt_t rsp_evt;
-                                rsp_evt.opcode = MESH_GATT_EVT_OPCODE_FLAG_RSP;
-                                rsp_evt.param.flag_update.handle = p_gatt_evt->param.flag_update.handle;
-                                rsp_evt.param.flag_update.flag = p_gatt_evt->param.flag_update.flag;
-                                rsp_evt.param.flag_update.value = (uint8_t) is_enabled;
-                                mesh_gatt_evt_push(&rsp_evt);
-                            }
-                            break;
-
-                        default:
-                            mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_UNKNOWN_FLAG);
-                    }
-                    break;
-
-                default:
-                    mesh_gatt_cmd_rsp_push((mesh_gatt_evt_opcode_t) p_gatt_evt->opcode, MESH_GATT_RESULT_ERROR_INVALID_OPCODE);
+                uint16_t len = mesh_gatt_queued_writes_assemble();
+                mesh_gatt_value_write_handle(p_conn, m_queued_write_mem, len);
             }
         }
+        else
+#endif
+        if (p_ble_evt->evt.gatts_evt.params.write.handle == m_mesh_service.ble_val_char_handles.value_handle)
+        {
+            mesh_gatt_value_write_handle(p_conn,
+                    p_ble_evt->evt.gatts_evt.params.write.data,
+                    p_ble_evt->evt.gatts_evt.params.write.len);
+        }
         else if (p_ble_evt->evt.gatts_evt.params.write.handle == m_mesh_service.ble_md_char_handles.value_handle)
         {
             mesh_metadata_char_t* p_md = (mesh_metadata_char_t*) p_ble_evt->evt.gatts_evt.params.write.data;
@@ -560,16 +990,98 @@ void mesh_gatt_sd_ble_event_handle(ble_evt_t* p_ble_evt)
         }
         else if (p_ble_evt->evt.gatts_evt.params.write.handle == m_mesh_service.ble_val_char_handles.cccd_handle)
         {
-            m_mesh_service.notification_enabled = (p_ble_evt->evt.gatts_evt.params.write.data[0] != 0);
+            if (p_conn != NULL)
+            {
+                p_conn->notification_enabled = (p_ble_evt->evt.gatts_evt.params.write.data[0] != 0);
+                if (!p_conn->notification_enabled)
+                {
+                    evt_queue_reset(&p_conn->evt_queue);
+                }
+            }
+        }
+    }
+#if MESH_GATT_QUEUED_WRITES
+    else if (p_ble_evt->header.evt_id == BLE_EVT_USER_MEM_REQUEST)
+    {
+        /* Lend the prepared write memory to one client at a time, the
+           softdevice rejects prepared writes from the others. */
+        uint16_t conn_handle = p_ble_evt->evt.common_evt.conn_handle;
+        if (m_queued_write_conn_handle == CONN_HANDLE_INVALID &&
+            p_ble_evt->evt.common_evt.params.user_mem_request.type == BLE_USER_MEM_TYPE_GATTS_QUEUED_WRITES)
+        {
+            ble_user_mem_block_t mem_block;
+            mem_block.p_mem = m_queued_write_mem;
+            mem_block.len = sizeof(m_queued_write_mem);
+            if (sd_ble_user_mem_reply(conn_handle, &mem_block) == NRF_SUCCESS)
+            {
+                m_queued_write_conn_handle = conn_handle;
+            }
+        }
+        else
+        {
+            (void) sd_ble_user_mem_reply(conn_handle, NULL);
+        }
+    }
+    else if (p_ble_evt->header.evt_id == BLE_EVT_USER_MEM_RELEASE)
+    {
+        if (p_ble_evt->evt.common_evt.params.user_mem_release.mem_block.p_mem == m_queued_write_mem)
+        {
+            m_queued_write_conn_handle = CONN_HANDLE_INVALID;
+        }
+    }
+#endif
+    else if (p_ble_evt->header.evt_id == BLE_EVT_TX_COMPLETE)
+    {
+        mesh_gatt_conn_t* p_conn = conn_get(p_ble_evt->evt.common_evt.conn_handle);
+        if (p_conn != NULL)
+        {
+            evt_queue_flush(p_conn);
         }
     }
+#if (NORDIC_SDK_VERSION >= 11)
+    else if (p_ble_evt->header.evt_id == BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST)
+    {
+        /* the application replies to the request, it ends up with the smallest of the two */
+        mesh_gatt_conn_t* p_conn = conn_get(p_ble_evt->evt.gatts_evt.conn_handle);
+        if (p_conn != NULL)
+        {
+            uint16_t client_rx_mtu = p_ble_evt->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu;
+            p_conn->att_mtu = MAX(GATT_MTU_SIZE_DEFAULT, MIN(client_rx_mtu, MESH_GATT_ATT_MTU_MAX));
+        }
+    }
+#endif
     else if (p_ble_evt->header.evt_id == BLE_GAP_EVT_CONNECTED)
     {
-        m_active_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+#ifndef S110
+        /* central links on S130 aren't GATT clients of this service */
+        if (p_ble_evt->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_PERIPH)
+#endif
+        {
+            mesh_gatt_conn_t* p_conn = conn_get(CONN_HANDLE_INVALID);
+            if (p_conn != NULL)
+            {
+                p_conn->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+                p_conn->notification_enabled = false;
+                p_conn->att_mtu = GATT_MTU_SIZE_DEFAULT;
+                evt_queue_reset(&p_conn->evt_queue);
+            }
+        }
     }
     else if (p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
     {
-        m_active_conn_handle = CONN_HANDLE_INVALID;
+        mesh_gatt_conn_t* p_conn = conn_get(p_ble_evt->evt.gap_evt.conn_handle);
+        if (p_conn != NULL)
+        {
+            p_conn->conn_handle = CONN_HANDLE_INVALID;
+            p_conn->notification_enabled = false;
+            evt_queue_reset(&p_conn->evt_queue);
+        }
+#if MESH_GATT_QUEUED_WRITES
+        if (m_queued_write_conn_handle == p_ble_evt->evt.gap_evt.conn_handle)
+        {
+            m_queued_write_conn_handle = CONN_HANDLE_INVALID;
+        }
+#endif
     }
 }
 
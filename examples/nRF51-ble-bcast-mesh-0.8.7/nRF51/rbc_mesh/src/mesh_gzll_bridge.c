@@ -0,0 +1,420 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_gzll_bridge.h"
+
+#ifdef RBC_MESH_GZLL_BRIDGE
+
+#include <string.h>
+#include "event_handler.h"
+#include "toolchain.h"
+#include "nrf_gzll.h"
+#include "nrf_error.h"
+#include "nrf.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+/** Time given Gazell to disable, at least one Gazell timeslot period. */
+#define GZLL_BRIDGE_DISABLE_TIME_US     (2000)
+/** Interval between checks of whether Gazell has disabled. */
+#define GZLL_BRIDGE_POLL_INTERVAL_US    (250)
+/** Shortest window worth enabling Gazell for. */
+#define GZLL_BRIDGE_WINDOW_MIN_US       (1000)
+/** TIMER0 compare register used for the capture of the current time. */
+#define GZLL_BRIDGE_CAPTURE_CC          (3)
+/** Handle, length and contents of a command. */
+#define GZLL_BRIDGE_COMMAND_OVERHEAD    (3)
+
+#if (RBC_MESH_GZLL_BRIDGE_BATCH_SIZE > 32)
+    #error "RBC_MESH_GZLL_BRIDGE_BATCH_SIZE can't be higher than 32, the size of the bulk update mask"
+#endif
+
+/** Gazell window states. */
+typedef enum
+{
+    WINDOW_STATE_IDLE,          /** Not in a Gazell window. */
+    WINDOW_STATE_RUNNING,       /** Gazell is enabled. */
+    WINDOW_STATE_DISABLING      /** Gazell is being disabled. */
+} window_state_t;
+
+/** A batched command. */
+typedef struct
+{
+    rbc_mesh_value_handle_t handle;
+    uint8_t length;
+    uint8_t data[RBC_MESH_GZLL_BRIDGE_VALUE_MAX_LEN];
+} batch_entry_t;
+
+/** Gazell's radio interrupt handler, given the RADIO signals of the window. */
+void RADIO_IRQHandler(void);
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static mesh_gzll_bridge_config_t m_config;
+static mesh_gzll_bridge_stats_t m_stats;
+static bool             m_started;          /** mesh_gzll_bridge_init() has been called. */
+static bool             m_use_config;       /** Apply m_config, instead of the Gazell defaults. */
+static bool             m_gzll_initialized; /** Gazell has been initialized, in the first window. */
+static bool             m_broken;           /** Gazell failed, and gets no more windows. */
+static window_state_t   m_window_state;
+static timestamp_t      m_window_start;     /** Start time of the last window. */
+static uint32_t         m_deadline_us;      /** Time into the window by which Gazell must be disabled. */
+static batch_entry_t    m_batch[RBC_MESH_GZLL_BRIDGE_BATCH_SIZE];
+static uint32_t         m_batch_count;
+static bool             m_flush_pending;    /** A flush event is in the event queue. */
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+/** Time into the timeslot. TIMER0 is started by the Softdevice at the start of each timeslot. */
+static uint32_t timer0_now(void)
+{
+    NRF_TIMER0->TASKS_CAPTURE[GZLL_BRIDGE_CAPTURE_CC] = 1;
+    return NRF_TIMER0->CC[GZLL_BRIDGE_CAPTURE_CC];
+}
+
+static void timer0_order(uint32_t time_us)
+{
+    NRF_TIMER0->EVENTS_COMPARE[0] = 0;
+    NRF_TIMER0->CC[0] = time_us;
+    NRF_TIMER0->INTENSET = TIMER_INTENSET_COMPARE0_Msk;
+}
+
+static bool gzll_setup(void)
+{
+    if (!nrf_gzll_init(NRF_GZLL_MODE_HOST))
+    {
+        return false;
+    }
+    if (m_use_config)
+    {
+        return (nrf_gzll_set_base_address_0(m_config.base_address_0) &&
+                nrf_gzll_set_base_address_1(m_config.base_address_1) &&
+                nrf_gzll_set_rx_pipes_enabled(m_config.rx_pipes));
+    }
+    return true;
+}
+
+/** Stop Gazell's timer and the radio, when Gazell didn't disable in time. */
+static void gzll_force_stop(void)
+{
+    NVIC_DisableIRQ(TIMER2_IRQn);
+    NRF_TIMER2->INTENCLR = 0xFFFFFFFF;
+    NRF_TIMER2->TASKS_STOP = 1;
+    NRF_PPI->CHENCLR = (PPI_CHENCLR_CH0_Msk | PPI_CHENCLR_CH1_Msk | PPI_CHENCLR_CH2_Msk);
+    NRF_RADIO->SHORTS = 0;
+    NRF_RADIO->INTENCLR = 0xFFFFFFFF;
+    NRF_RADIO->TASKS_DISABLE = 1;
+
+    /* Gazell still believes it's enabled, and can't be enabled again */
+    m_broken = true;
+    m_stats.forced_stops++;
+}
+
+static void batch_flush(void* p_context)
+{
+    rbc_mesh_value_t values[RBC_MESH_GZLL_BRIDGE_BATCH_SIZE];
+    batch_entry_t batch[RBC_MESH_GZLL_BRIDGE_BATCH_SIZE];
+    uint32_t count;
+    uint32_t success_mask = 0;
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    count = m_batch_count;
+    memcpy(batch, m_batch, count * sizeof(batch_entry_t));
+    m_batch_count = 0;
+    m_flush_pending = false;
+    _ENABLE_IRQS(was_masked);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        values[i].handle = batch[i].handle;
+        values[i].p_data = batch[i].data;
+        values[i].length = batch[i].length;
+    }
+    if (count == 0 ||
+        rbc_mesh_value_set_bulk(values, count, &success_mask) != NRF_SUCCESS)
+    {
+        return;
+    }
+
+    while (success_mask)
+    {
+        success_mask &= (success_mask - 1);
+        m_stats.values_set++;
+    }
+}
+
+/** Queue a flush of the batch to the event handler, where values may be set. */
+static void batch_flush_order(void)
+{
+    if (m_batch_count == 0 || m_flush_pending)
+    {
+        return;
+    }
+    async_event_t evt;
+    evt.type = EVENT_TYPE_GENERIC;
+    evt.callback.generic.cb = batch_flush;
+    evt.callback.generic.p_context = NULL;
+    if (event_handler_push(&evt) == NRF_SUCCESS)
+    {
+        m_flush_pending = true;
+    }
+    /* else retried after the next window */
+}
+
+static void batch_add(rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length)
+{
+    m_stats.commands++;
+    if (length == 0 ||
+        length > RBC_MESH_GZLL_BRIDGE_VALUE_MAX_LEN ||
+        handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        m_stats.dropped++;
+        return;
+    }
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    batch_entry_t* p_entry = NULL;
+    for (uint32_t i = 0; i < m_batch_count; ++i)
+    {
+        if (m_batch[i].handle == handle)
+        {
+            /* only the latest command for the handle matters */
+            p_entry = &m_batch[i];
+            m_stats.merged++;
+            break;
+        }
+    }
+    if (p_entry == NULL && m_batch_count < RBC_MESH_GZLL_BRIDGE_BATCH_SIZE)
+    {
+        p_entry = &m_batch[m_batch_count++];
+        p_entry->handle = handle;
+    }
+    if (p_entry != NULL)
+    {
+        p_entry->length = length;
+        memcpy(p_entry->data, p_data, length);
+    }
+    else
+    {
+        m_stats.dropped++;
+    }
+    _ENABLE_IRQS(was_masked);
+}
+
+static void window_end(uint32_t now_us)
+{
+    NRF_TIMER0->INTENCLR = TIMER_INTENCLR_COMPARE0_Msk;
+    NRF_TIMER0->EVENTS_COMPARE[0] = 0;
+    m_stats.window_us += now_us;
+    m_window_state = WINDOW_STATE_IDLE;
+    batch_flush_order();
+}
+
+/*****************************************************************************
+* Gazell callbacks
+*****************************************************************************/
+void nrf_gzll_host_rx_data_ready(uint32_t pipe, nrf_gzll_host_rx_info_t rx_info)
+{
+    uint8_t payload[NRF_GZLL_CONST_MAX_PAYLOAD_LENGTH];
+    uint32_t length = sizeof(payload);
+
+    if (!nrf_gzll_fetch_packet_from_rx_fifo(pipe, payload, &length))
+    {
+        return;
+    }
+    m_stats.packets++;
+
+    uint32_t i = 0;
+    while (i < length)
+    {
+        if (length - i < GZLL_BRIDGE_COMMAND_OVERHEAD ||
+            payload[i + 2] > length - i - GZLL_BRIDGE_COMMAND_OVERHEAD)
+        {
+            /* truncated command, the rest of the packet can't be trusted */
+            m_stats.dropped++;
+            break;
+        }
+        rbc_mesh_value_handle_t handle = payload[i] | (payload[i + 1] << 8);
+        uint8_t value_length = payload[i + 2];
+        batch_add(handle, &payload[i + GZLL_BRIDGE_COMMAND_OVERHEAD], value_length);
+        i += GZLL_BRIDGE_COMMAND_OVERHEAD + value_length;
+    }
+}
+
+void nrf_gzll_device_tx_success(uint32_t pipe, nrf_gzll_device_tx_info_t tx_info)
+{
+    /* host only */
+}
+
+void nrf_gzll_device_tx_failed(uint32_t pipe, nrf_gzll_device_tx_info_t tx_info)
+{
+    /* host only */
+}
+
+void nrf_gzll_disabled(void)
+{
+    /* polled with nrf_gzll_is_enabled() at the end of the window */
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+uint32_t mesh_gzll_bridge_init(const mesh_gzll_bridge_config_t* p_config)
+{
+    if (m_started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_config != NULL && p_config->rx_pipes == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_use_config = (p_config != NULL);
+    if (m_use_config)
+    {
+        m_config = *p_config;
+    }
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_batch_count = 0;
+    m_flush_pending = false;
+    m_window_state = WINDOW_STATE_IDLE;
+    m_broken = false;
+    m_started = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_gzll_bridge_stats_get(mesh_gzll_bridge_stats_t* p_stats)
+{
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(p_stats, &m_stats, sizeof(m_stats));
+    _ENABLE_IRQS(was_masked);
+    return NRF_SUCCESS;
+}
+
+bool mesh_gzll_bridge_window_due(timestamp_t now)
+{
+    if (!m_started || m_broken)
+    {
+        return false;
+    }
+    /* the first window is due at once */
+    return (m_stats.windows == 0 ||
+            TIMER_DIFF(now, m_window_start) >= RBC_MESH_GZLL_BRIDGE_PERIOD_MS * 1000UL);
+}
+
+void mesh_gzll_bridge_window_start(timestamp_t start_time, timestamp_t deadline_us)
+{
+    m_window_start = start_time;
+    m_deadline_us = deadline_us;
+    m_stats.windows++;
+
+    if (!m_gzll_initialized)
+    {
+        m_gzll_initialized = gzll_setup();
+        m_broken = !m_gzll_initialized;
+    }
+
+    if (!m_broken &&
+        deadline_us >= GZLL_BRIDGE_DISABLE_TIME_US + GZLL_BRIDGE_WINDOW_MIN_US &&
+        nrf_gzll_enable())
+    {
+        m_window_state = WINDOW_STATE_RUNNING;
+        timer0_order(deadline_us - GZLL_BRIDGE_DISABLE_TIME_US);
+    }
+    else
+    {
+        /* give the timeslot back at the first check */
+        m_window_state = WINDOW_STATE_DISABLING;
+        timer0_order(timer0_now() + GZLL_BRIDGE_POLL_INTERVAL_US);
+    }
+}
+
+void mesh_gzll_bridge_radio_event(void)
+{
+    /* Gazell's own radio interrupt handler */
+    RADIO_IRQHandler();
+}
+
+bool mesh_gzll_bridge_timer_event(void)
+{
+    if (!NRF_TIMER0->EVENTS_COMPARE[0] || m_window_state == WINDOW_STATE_IDLE)
+    {
+        return false;
+    }
+    NRF_TIMER0->EVENTS_COMPARE[0] = 0;
+
+    uint32_t now_us = timer0_now();
+    if (m_window_state == WINDOW_STATE_RUNNING)
+    {
+        /* takes effect at the end of the ongoing Gazell timeslot */
+        (void) nrf_gzll_disable();
+        m_window_state = WINDOW_STATE_DISABLING;
+    }
+
+    if (!nrf_gzll_is_enabled())
+    {
+        window_end(now_us);
+        return true;
+    }
+    if (now_us + GZLL_BRIDGE_POLL_INTERVAL_US >= m_deadline_us)
+    {
+        gzll_force_stop();
+        window_end(now_us);
+        return true;
+    }
+
+    timer0_order(now_us + GZLL_BRIDGE_POLL_INTERVAL_US);
+    return false;
+}
+
+void mesh_gzll_bridge_window_abort(void)
+{
+    if (m_window_state == WINDOW_STATE_IDLE)
+    {
+        return;
+    }
+    if (nrf_gzll_is_enabled())
+    {
+        gzll_force_stop();
+    }
+    window_end(timer0_now());
+}
+
+#endif /* RBC_MESH_GZLL_BRIDGE */
@@ -0,0 +1,308 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "mesh_microbench.h"
+
+#ifdef MESH_MICROBENCH
+
+#include <stdbool.h>
+#include <string.h>
+#include "rbc_mesh.h"
+#include "handle_storage.h"
+#include "mesh_packet.h"
+#include "event_handler.h"
+#include "fifo.h"
+#include "app_error.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+/** Trickle interval of the stored values. */
+#define BENCH_INTERVAL_MIN_US   (100000)
+/** Lookups in the access pattern. Must be a power of two. */
+#define PATTERN_LENGTH          (256)
+/** Share of the lookups going to the hot handles. */
+#define HOT_LOOKUP_PERCENT      (80)
+/** Share of the handles that are hot. */
+#define HOT_HANDLE_PERCENT      (20)
+/** Distance between stored handles. Other handles are never stored. */
+#define HANDLE_STRIDE           (7)
+/** Length of the stored values. */
+#define VALUE_LENGTH            (8)
+/** Event fifo length, the length of the framework's internal event queue. */
+#define FIFO_LENGTH             (RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH)
+/** Events pushed before they're all popped again. */
+#define FIFO_BURST              (4)
+/** Packets held at a time in the packet pool case, like a few in the radio queue. */
+#define PACKETS_HELD            (4)
+/** Time between two TX collections, the radio queue drains in about this long. */
+#define TX_STEP_US              (10000)
+
+typedef void (*bench_op_t)(uint32_t i);
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static const mesh_microbench_params_t* mp_params;
+static uint32_t         m_entries;
+static uint32_t         m_overhead; /**< Ticks of an empty batch. */
+static uint32_t         m_lcg;
+static uint16_t         m_pattern[PATTERN_LENGTH];
+static uint32_t         m_time;
+static fifo_t           m_fifo;
+static async_event_t    m_fifo_buffer[FIFO_LENGTH];
+static async_event_t    m_evt;
+static mesh_packet_t*   mp_held[PACKETS_HELD];
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint32_t lcg_next(void)
+{
+    m_lcg = m_lcg * 1664525 + 1013904223;
+    return m_lcg >> 8;
+}
+
+static uint16_t stored_handle(uint32_t i)
+{
+    return (uint16_t) (1 + i * HANDLE_STRIDE);
+}
+
+/** Fill the data cache with short values, as the mesh would. */
+static uint32_t storage_fill(void)
+{
+    APP_ERROR_CHECK(handle_storage_init(BENCH_INTERVAL_MIN_US));
+    mesh_packet_init();
+
+    uint8_t data[VALUE_LENGTH];
+    memset(data, 0, sizeof(data));
+    uint32_t count = 0;
+    for (; count < RBC_MESH_DATA_CACHE_ENTRIES; ++count)
+    {
+        mesh_packet_t* p_packet = NULL;
+        if (!mesh_packet_acquire(&p_packet))
+        {
+            break;
+        }
+        memcpy(data, &count, sizeof(count));
+        uint32_t error_code = mesh_packet_build(p_packet, stored_handle(count), 1, data, sizeof(data));
+        if (error_code == NRF_SUCCESS)
+        {
+            handle_info_t info = {.version = 1, .p_packet = p_packet};
+            error_code = handle_storage_info_set(stored_handle(count), &info);
+        }
+        mesh_packet_ref_count_dec(p_packet);
+        if (error_code != NRF_SUCCESS)
+        {
+            break;
+        }
+    }
+    return count;
+}
+
+/** Most lookups go to a few handles, like a handful of busy values in a larger network. */
+static void pattern_build(void)
+{
+    uint32_t hot = (m_entries * HOT_HANDLE_PERCENT) / 100;
+    if (hot == 0)
+    {
+        hot = 1;
+    }
+    for (uint32_t i = 0; i < PATTERN_LENGTH; ++i)
+    {
+        uint32_t index = (lcg_next() % 100 < HOT_LOOKUP_PERCENT) ? lcg_next() % hot : lcg_next() % m_entries;
+        m_pattern[i] = stored_handle(index);
+    }
+}
+
+static void op_none(uint32_t i)
+{
+}
+
+static void op_handle_hit(uint32_t i)
+{
+    handle_info_t info;
+    if (handle_storage_info_get(m_pattern[i & (PATTERN_LENGTH - 1)], &info) == NRF_SUCCESS &&
+        info.p_packet != NULL)
+    {
+        mesh_packet_ref_count_dec(info.p_packet);
+    }
+}
+
+static void op_handle_miss(uint32_t i)
+{
+    handle_info_t info;
+    (void) handle_storage_info_get(stored_handle(i & (PATTERN_LENGTH - 1)) + 1, &info);
+}
+
+static void op_tx_collect(uint32_t i)
+{
+    mesh_packet_t* p_packets[HANDLE_STORAGE_TX_PACKETS_MAX];
+    uint32_t count = HANDLE_STORAGE_TX_PACKETS_MAX;
+    m_time += TX_STEP_US;
+    if (handle_storage_tx_packets_get(m_time, p_packets, &count) != NRF_SUCCESS)
+    {
+        return;
+    }
+    for (uint32_t j = 0; j < count; ++j)
+    {
+        (void) handle_storage_transmitted(mesh_packet_handle_get(p_packets[j]), m_time);
+        mesh_packet_ref_count_dec(p_packets[j]);
+    }
+}
+
+static void op_fifo(uint32_t i)
+{
+    if ((i / FIFO_BURST) & 0x01)
+    {
+        (void) fifo_pop(&m_fifo, &m_evt);
+    }
+    else
+    {
+        (void) fifo_push(&m_fifo, &m_evt);
+    }
+}
+
+static void op_fifo_spsc(uint32_t i)
+{
+    if ((i / FIFO_BURST) & 0x01)
+    {
+        (void) fifo_spsc_pop(&m_fifo, &m_evt);
+    }
+    else
+    {
+        (void) fifo_spsc_push(&m_fifo, &m_evt);
+    }
+}
+
+/** Release the oldest of the held packets and take a new one. */
+static void op_packet(uint32_t i)
+{
+    mesh_packet_t** pp_held = &mp_held[i % PACKETS_HELD];
+    if (*pp_held != NULL)
+    {
+        mesh_packet_ref_count_dec(*pp_held);
+        *pp_held = NULL;
+    }
+    (void) mesh_packet_acquire(pp_held);
+}
+
+static uint32_t batch_time(bench_op_t op, uint32_t first)
+{
+    uint32_t start = mp_params->clock();
+    for (uint32_t i = first; i < first + MESH_MICROBENCH_BATCH; ++i)
+    {
+        op(i);
+    }
+    return (mp_params->clock() - start) & mp_params->clock_mask;
+}
+
+/** Time an operation, less the loop and call overhead. */
+static void bench_case(const char* p_name, bench_op_t op)
+{
+    mesh_microbench_result_t result;
+    result.p_name = p_name;
+    result.entries = m_entries;
+    result.ops = 0;
+    result.ticks = 0;
+
+    for (uint32_t round = 0; round < mp_params->rounds; ++round)
+    {
+        uint32_t ticks = batch_time(op, result.ops);
+        result.ticks += (ticks > m_overhead) ? ticks - m_overhead : 0;
+        result.ops += MESH_MICROBENCH_BATCH;
+    }
+    mp_params->result_cb(&result);
+}
+
+static void fifo_reset(void)
+{
+    m_fifo.elem_array = m_fifo_buffer;
+    m_fifo.elem_size = sizeof(async_event_t);
+    m_fifo.array_len = FIFO_LENGTH;
+    m_fifo.memcpy_fptr = NULL;
+    fifo_init(&m_fifo);
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+uint32_t mesh_microbench_run(const mesh_microbench_params_t* p_params)
+{
+    if (p_params == NULL || p_params->clock == NULL || p_params->result_cb == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    mp_params = p_params;
+    m_lcg = 1;
+    m_time = 0;
+
+    /* the smallest of a few empty batches, to subtract from the others */
+    m_overhead = UINT32_MAX;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        uint32_t ticks = batch_time(op_none, 0);
+        if (ticks < m_overhead)
+        {
+            m_overhead = ticks;
+        }
+    }
+
+    m_entries = storage_fill();
+    if (m_entries == 0)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    pattern_build();
+
+    bench_case("handle_get_hit", op_handle_hit);
+    bench_case("handle_get_miss", op_handle_miss);
+    bench_case("tx_packets_get", op_tx_collect);
+
+    fifo_reset();
+    memset(&m_evt, 0, sizeof(m_evt));
+    bench_case("fifo_push_pop", op_fifo);
+    fifo_reset();
+    bench_case("fifo_spsc_push_pop", op_fifo_spsc);
+
+    memset(mp_held, 0, sizeof(mp_held));
+    bench_case("packet_acquire_release", op_packet);
+    for (uint32_t i = 0; i < PACKETS_HELD; ++i)
+    {
+        if (mp_held[i] != NULL)
+        {
+            mesh_packet_ref_count_dec(mp_held[i]);
+        }
+    }
+    return NRF_SUCCESS;
+}
+
+#endif /* MESH_MICROBENCH */
@@ -0,0 +1,254 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_neighbour.h"
+
+#include <string.h>
+#include "version_handler.h"
+#include "timer_scheduler.h"
+#include "toolchain.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+/** Weight of the newest packet in the RSSI average, as a shift. */
+#define NEIGHBOUR_RSSI_AVG_SHIFT    (3)
+
+typedef struct
+{
+    ble_gap_addr_t  addr;
+    bool            active;         /** Heard within RBC_MESH_NEIGHBOUR_TIMEOUT_MS. */
+    uint16_t        rssi_avg;       /** Negative RSSI, scaled by 1 << NEIGHBOUR_RSSI_AVG_SHIFT. */
+    uint16_t        packets;
+    timestamp_t     last_seen;
+} neighbour_entry_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+/** TX power levels, from the weakest. */
+static const rbc_mesh_txpower_t m_tx_power_levels[] =
+{
+    RBC_MESH_TXPOWER_Neg30dBm,
+    RBC_MESH_TXPOWER_Neg20dBm,
+    RBC_MESH_TXPOWER_Neg16dBm,
+    RBC_MESH_TXPOWER_Neg12dBm,
+    RBC_MESH_TXPOWER_Neg8dBm,
+    RBC_MESH_TXPOWER_Neg4dBm,
+    RBC_MESH_TXPOWER_0dBm,
+    RBC_MESH_TXPOWER_Pos4dBm
+};
+
+static neighbour_entry_t    m_table[RBC_MESH_NEIGHBOUR_TABLE_SIZE];
+static uint8_t              m_entry_count;
+static timer_event_t        m_adapt_timer_evt;
+static bool                 m_adaptive;
+static uint8_t              m_level_max;    /** Level set by the application. */
+static uint8_t              m_level;        /** Level in use. */
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint8_t tx_power_level_get(rbc_mesh_txpower_t tx_power)
+{
+    for (uint32_t i = 0; i < sizeof(m_tx_power_levels) / sizeof(m_tx_power_levels[0]); ++i)
+    {
+        if (m_tx_power_levels[i] == tx_power)
+        {
+            return i;
+        }
+    }
+    return sizeof(m_tx_power_levels) / sizeof(m_tx_power_levels[0]) - 1;
+}
+
+static void tx_power_level_set(uint8_t level)
+{
+    m_level = level;
+    vh_tx_power_set(m_tx_power_levels[level]);
+}
+
+static uint8_t tx_power_level_min(void)
+{
+    uint8_t level_min = tx_power_level_get(RBC_MESH_NEIGHBOUR_TX_POWER_MIN);
+    return (level_min < m_level_max) ? level_min : m_level_max;
+}
+
+static void adapt_timeout(timestamp_t timestamp, void* p_context)
+{
+    uint32_t active_count = 0;
+    uint32_t strong_count = 0;
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    for (uint32_t i = 0; i < m_entry_count; ++i)
+    {
+        /* marked here, before the timestamps wrap */
+        if (m_table[i].active &&
+            TIMER_OLDER_THAN(m_table[i].last_seen + RBC_MESH_NEIGHBOUR_TIMEOUT_MS * 1000, timestamp))
+        {
+            m_table[i].active = false;
+        }
+        if (m_table[i].active)
+        {
+            active_count++;
+            if ((m_table[i].rssi_avg >> NEIGHBOUR_RSSI_AVG_SHIFT) <= RBC_MESH_NEIGHBOUR_STRONG_RSSI)
+            {
+                strong_count++;
+            }
+        }
+    }
+    _ENABLE_IRQS(was_masked);
+
+    if (!m_adaptive)
+    {
+        return;
+    }
+
+    /* one level per evaluation, to let the neighbours settle */
+    if (strong_count >= RBC_MESH_NEIGHBOUR_DENSE_COUNT && m_level > tx_power_level_min())
+    {
+        tx_power_level_set(m_level - 1);
+    }
+    else if (active_count < RBC_MESH_NEIGHBOUR_SPARSE_COUNT && m_level < m_level_max)
+    {
+        tx_power_level_set(m_level + 1);
+    }
+}
+
+/** Find the entry of a neighbour, or the one to replace with it. */
+static neighbour_entry_t* entry_get(const ble_gap_addr_t* p_addr, bool* p_is_new)
+{
+    *p_is_new = false;
+    neighbour_entry_t* p_oldest = &m_table[0];
+    for (uint32_t i = 0; i < m_entry_count; ++i)
+    {
+        if (m_table[i].addr.addr_type == p_addr->addr_type &&
+            memcmp(m_table[i].addr.addr, p_addr->addr, BLE_GAP_ADDR_LEN) == 0)
+        {
+            return &m_table[i];
+        }
+        if (p_oldest->active &&
+            (!m_table[i].active || TIMER_OLDER_THAN(m_table[i].last_seen, p_oldest->last_seen)))
+        {
+            p_oldest = &m_table[i];
+        }
+    }
+
+    *p_is_new = true;
+    if (m_entry_count < RBC_MESH_NEIGHBOUR_TABLE_SIZE)
+    {
+        return &m_table[m_entry_count++];
+    }
+    return p_oldest;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_neighbour_init(rbc_mesh_txpower_t tx_power)
+{
+    m_entry_count = 0;
+    m_adaptive = false;
+    m_level_max = tx_power_level_get(tx_power);
+    m_level = m_level_max;
+
+    m_adapt_timer_evt.cb = adapt_timeout;
+    m_adapt_timer_evt.interval = RBC_MESH_NEIGHBOUR_ADAPT_INTERVAL_MS * 1000;
+    m_adapt_timer_evt.p_context = NULL;
+    m_adapt_timer_evt.p_next = NULL;
+    m_adapt_timer_evt.timestamp = timer_now() + m_adapt_timer_evt.interval;
+    (void) timer_sch_schedule(&m_adapt_timer_evt);
+}
+
+void mesh_neighbour_rx(const ble_gap_addr_t* p_addr, timestamp_t timestamp, uint8_t rssi)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    bool is_new;
+    neighbour_entry_t* p_entry = entry_get(p_addr, &is_new);
+    if (is_new)
+    {
+        p_entry->addr = *p_addr;
+        p_entry->rssi_avg = rssi << NEIGHBOUR_RSSI_AVG_SHIFT;
+        p_entry->packets = 0;
+    }
+    else
+    {
+        p_entry->rssi_avg += rssi - (p_entry->rssi_avg >> NEIGHBOUR_RSSI_AVG_SHIFT);
+    }
+
+    if (p_entry->packets < UINT16_MAX)
+    {
+        p_entry->packets++;
+    }
+    p_entry->active = true;
+    p_entry->last_seen = timestamp;
+    _ENABLE_IRQS(was_masked);
+}
+
+void mesh_neighbour_tx_power_max_set(rbc_mesh_txpower_t tx_power)
+{
+    m_level_max = tx_power_level_get(tx_power);
+    if (!m_adaptive || m_level > m_level_max)
+    {
+        tx_power_level_set(m_level_max);
+    }
+}
+
+void mesh_neighbour_tx_power_adaptive_set(bool enabled)
+{
+    m_adaptive = enabled;
+    if (!enabled)
+    {
+        tx_power_level_set(m_level_max);
+    }
+}
+
+uint32_t mesh_neighbour_get(uint8_t index, rbc_mesh_neighbour_t* p_neighbour)
+{
+    uint32_t error_code = NRF_SUCCESS;
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (index >= m_entry_count)
+    {
+        error_code = NRF_ERROR_NOT_FOUND;
+    }
+    else
+    {
+        neighbour_entry_t* p_entry = &m_table[index];
+        p_neighbour->addr = p_entry->addr;
+        p_neighbour->active = p_entry->active;
+        p_neighbour->rssi_avg = (uint8_t) (p_entry->rssi_avg >> NEIGHBOUR_RSSI_AVG_SHIFT);
+        p_neighbour->packets = p_entry->packets;
+        p_neighbour->last_seen_ms = p_entry->active ? (timer_now() - p_entry->last_seen) / 1000 : UINT32_MAX;
+    }
+    _ENABLE_IRQS(was_masked);
+    return error_code;
+}
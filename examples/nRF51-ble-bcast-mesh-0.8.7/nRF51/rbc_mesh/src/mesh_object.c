@@ -0,0 +1,438 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_object.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include "transport_control.h"
+#include "version_handler.h"
+#include "event_handler.h"
+#include "timer.h"
+#include "timer_scheduler.h"
+#include "rand.h"
+#include "toolchain.h"
+#include "nrf_error.h"
+#include "app_error.h"
+
+#if RBC_MESH_OBJECT_MAX_LEN > 0
+
+/* event push isn't present in the API header file. */
+extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt);
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define OBJECT_ADV_OVERHEAD             (1 /* adv_type */ + 2 /* UUID */ + 2 /* handle */ + 2 /* object ID */ + 2 /* version */ + 2 /* length */ + 1 /* segment */)
+#define OBJECT_SEGMENT_LEN              (BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH - 1 - OBJECT_ADV_OVERHEAD)
+#define OBJECT_SEGMENTS_MAX             (32) /* one bit each in the segment bitmaps */
+#define OBJECT_SEGMENT_INTERVAL_US      (RBC_MESH_OBJECT_SEGMENT_INTERVAL_MS * 1000)
+#define OBJECT_REQ_TIMEOUT_US           (RBC_MESH_OBJECT_REQ_TIMEOUT_MS * 1000)
+
+#if RBC_MESH_OBJECT_MAX_LEN > OBJECT_SEGMENTS_MAX * OBJECT_SEGMENT_LEN
+#error "RBC_MESH_OBJECT_MAX_LEN is too long to fit in 32 segments"
+#endif
+
+/*****************************************************************************
+* Local typedefs
+*****************************************************************************/
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle; /**< Always MESH_OBJECT_HANDLE_SEGMENT. */
+    uint16_t                object_id;
+    uint16_t                version;
+    uint16_t                length; /**< Length of the entire object. */
+    uint8_t                 segment;
+    uint8_t                 data[OBJECT_SEGMENT_LEN];
+} __packed_gcc object_segment_adv_data_t;
+
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle; /**< Always MESH_OBJECT_HANDLE_REQ. */
+    uint16_t                object_id;
+    uint16_t                version;
+    uint32_t                missing; /**< Bit i is set if segment i is missing. */
+} __packed_gcc object_req_adv_data_t;
+
+typedef enum
+{
+    OBJECT_STATE_IDLE,
+    OBJECT_STATE_RX,
+    OBJECT_STATE_COMPLETE
+} object_state_t;
+
+typedef struct
+{
+    object_state_t  state;
+    uint16_t        object_id;
+    uint16_t        version;
+    uint16_t        length;
+    uint8_t         segment_count;
+    uint8_t         tx_rounds;  /**< Times left to send all segments unprompted. */
+    uint8_t         req_count;  /**< Requests sent since the last new segment. */
+    uint32_t        received;   /**< Bit i is set if segment i is in the buffer. */
+    uint32_t        tx_pending; /**< Bit i is set if segment i should be sent. */
+    timestamp_t     last_rx;    /**< Time of the last new segment or overheard request. */
+    uint8_t         data[RBC_MESH_OBJECT_MAX_LEN];
+} object_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static object_t         m_object;
+static timer_event_t    m_timer;
+static bool             m_timer_running;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint32_t segment_mask(uint8_t segment_count)
+{
+    return (segment_count >= OBJECT_SEGMENTS_MAX) ? 0xFFFFFFFF : ((1UL << segment_count) - 1);
+}
+
+static uint16_t segment_length(uint16_t object_length, uint8_t segment)
+{
+    uint16_t left = object_length - segment * OBJECT_SEGMENT_LEN;
+    return (left > OBJECT_SEGMENT_LEN) ? OBJECT_SEGMENT_LEN : left;
+}
+
+static bool version_is_newer(uint16_t version, uint16_t reference)
+{
+    return ((int16_t) (version - reference) > 0);
+}
+
+static void timer_order(timestamp_t time_now)
+{
+    if (!m_timer_running)
+    {
+        /* spread the transmissions, so that neighbors relaying the same segment don't collide */
+        timestamp_t delay = OBJECT_SEGMENT_INTERVAL_US / 2 + rand_range(OBJECT_SEGMENT_INTERVAL_US);
+        m_timer_running = (timer_sch_reschedule(&m_timer, time_now + delay) == NRF_SUCCESS);
+    }
+}
+
+static void packet_header_fill(mesh_packet_t* p_packet, uint8_t adv_data_length, rbc_mesh_value_handle_t handle)
+{
+    mesh_adv_data_t* p_adv_data = (mesh_adv_data_t*) &p_packet->payload[0];
+
+    (void) mesh_packet_set_local_addr(p_packet);
+    p_packet->header.length = MESH_PACKET_BLE_OVERHEAD + 1 + adv_data_length;
+    p_packet->header.type = BLE_PACKET_TYPE_ADV_NONCONN_IND;
+
+    p_adv_data->adv_data_length = adv_data_length;
+    p_adv_data->adv_data_type = MESH_ADV_DATA_TYPE;
+    p_adv_data->mesh_uuid = MESH_UUID;
+    p_adv_data->handle = handle;
+}
+
+static bool segment_tx(uint8_t segment)
+{
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return false;
+    }
+
+    uint16_t length = segment_length(m_object.length, segment);
+    packet_header_fill(p_packet, OBJECT_ADV_OVERHEAD + length, MESH_OBJECT_HANDLE_SEGMENT);
+
+    object_segment_adv_data_t* p_segment = (object_segment_adv_data_t*) &p_packet->payload[0];
+    p_segment->object_id = m_object.object_id;
+    p_segment->version = m_object.version;
+    p_segment->length = m_object.length;
+    p_segment->segment = segment;
+    memcpy(p_segment->data, &m_object.data[segment * OBJECT_SEGMENT_LEN], length);
+
+    bool sent = (tc_tx(p_packet, vh_tx_config_get()) == NRF_SUCCESS);
+    mesh_packet_ref_count_dec(p_packet);
+    return sent;
+}
+
+static bool req_tx(void)
+{
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return false;
+    }
+
+    packet_header_fill(p_packet, sizeof(object_req_adv_data_t) - 1, MESH_OBJECT_HANDLE_REQ);
+
+    object_req_adv_data_t* p_req = (object_req_adv_data_t*) &p_packet->payload[0];
+    p_req->object_id = m_object.object_id;
+    p_req->version = m_object.version;
+    p_req->missing = segment_mask(m_object.segment_count) & ~m_object.received;
+
+    bool sent = (tc_tx(p_packet, vh_tx_config_get()) == NRF_SUCCESS);
+    mesh_packet_ref_count_dec(p_packet);
+    return sent;
+}
+
+static void object_timeout(timestamp_t timestamp, void* p_context)
+{
+    m_timer_running = false;
+    if (m_object.state == OBJECT_STATE_IDLE)
+    {
+        return;
+    }
+
+    if (m_object.tx_pending == 0 && m_object.tx_rounds > 0)
+    {
+        m_object.tx_pending = m_object.received;
+        m_object.tx_rounds--;
+    }
+
+    if (m_object.tx_pending != 0)
+    {
+        /* one segment at a time, lowest first */
+        uint8_t segment = 0;
+        while (!(m_object.tx_pending & (1UL << segment)))
+        {
+            segment++;
+        }
+        if (segment_tx(segment))
+        {
+            m_object.tx_pending &= ~(1UL << segment);
+        }
+    }
+    else if (m_object.state == OBJECT_STATE_RX &&
+             TIMER_DIFF(timestamp, m_object.last_rx) >= OBJECT_REQ_TIMEOUT_US)
+    {
+        if (m_object.req_count >= RBC_MESH_OBJECT_REQ_RETRIES)
+        {
+            /* nobody around has the rest, make room for other objects */
+            m_object.state = OBJECT_STATE_IDLE;
+            return;
+        }
+        if (req_tx())
+        {
+            m_object.req_count++;
+        }
+        m_object.last_rx = timestamp;
+    }
+
+    if (m_object.tx_pending != 0 ||
+        m_object.tx_rounds > 0 ||
+        m_object.state == OBJECT_STATE_RX)
+    {
+        timer_order(timestamp);
+    }
+}
+
+static void segment_rx(object_segment_adv_data_t* p_segment, uint32_t timestamp)
+{
+    if (p_segment->length == 0 ||
+        p_segment->length > RBC_MESH_OBJECT_MAX_LEN ||
+        p_segment->segment * OBJECT_SEGMENT_LEN >= p_segment->length)
+    {
+        return;
+    }
+    uint16_t length = segment_length(p_segment->length, p_segment->segment);
+    if (p_segment->adv_data_length != OBJECT_ADV_OVERHEAD + length)
+    {
+        return;
+    }
+
+    bool is_current = (m_object.state != OBJECT_STATE_IDLE &&
+                       m_object.object_id == p_segment->object_id &&
+                       m_object.version == p_segment->version);
+    if (!is_current)
+    {
+        if (m_object.state == OBJECT_STATE_RX)
+        {
+            /* busy with another object */
+            return;
+        }
+        if (m_object.state == OBJECT_STATE_COMPLETE &&
+            m_object.object_id == p_segment->object_id &&
+            !version_is_newer(p_segment->version, m_object.version))
+        {
+            /* an old copy still going around */
+            return;
+        }
+        m_object.state = OBJECT_STATE_RX;
+        m_object.object_id = p_segment->object_id;
+        m_object.version = p_segment->version;
+        m_object.length = p_segment->length;
+        m_object.segment_count = (p_segment->length + OBJECT_SEGMENT_LEN - 1) / OBJECT_SEGMENT_LEN;
+        m_object.tx_rounds = 0;
+        m_object.req_count = 0;
+        m_object.received = 0;
+        m_object.tx_pending = 0;
+    }
+    else if (m_object.length != p_segment->length)
+    {
+        /* conflicting objects with the same version */
+        return;
+    }
+
+    uint32_t bit = (1UL << p_segment->segment);
+    if (m_object.received & bit)
+    {
+        /* a neighbor sent it, no need for us to do the same */
+        m_object.tx_pending &= ~bit;
+        return;
+    }
+
+    memcpy(&m_object.data[p_segment->segment * OBJECT_SEGMENT_LEN], p_segment->data, length);
+    m_object.received |= bit;
+    m_object.tx_pending |= bit; /* relay it once */
+    m_object.last_rx = timestamp;
+    m_object.req_count = 0;
+
+    if (m_object.received == segment_mask(m_object.segment_count))
+    {
+        m_object.state = OBJECT_STATE_COMPLETE;
+
+        rbc_mesh_event_t evt;
+        evt.type = RBC_MESH_EVENT_TYPE_OBJECT_RX;
+        evt.params.object.object_id = m_object.object_id;
+        evt.params.object.version = m_object.version;
+        evt.params.object.p_data = m_object.data;
+        evt.params.object.length = m_object.length;
+        (void) rbc_mesh_event_push(&evt);
+    }
+
+    timer_order(timestamp);
+}
+
+static void req_rx(object_req_adv_data_t* p_req, uint32_t timestamp)
+{
+    if (p_req->adv_data_length != sizeof(object_req_adv_data_t) - 1 ||
+        m_object.state == OBJECT_STATE_IDLE ||
+        m_object.object_id != p_req->object_id ||
+        m_object.version != p_req->version)
+    {
+        return;
+    }
+
+    uint32_t answer = (p_req->missing & m_object.received);
+    m_object.tx_pending |= answer;
+    if (m_object.state == OBJECT_STATE_RX)
+    {
+        /* give the answers to someone else's request time to arrive before asking again */
+        m_object.last_rx = timestamp;
+    }
+    if (answer != 0)
+    {
+        timer_order(timestamp);
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_object_init(void)
+{
+    memset(&m_object, 0, sizeof(m_object));
+    memset(&m_timer, 0, sizeof(m_timer));
+    m_timer.cb = object_timeout;
+    m_timer_running = false;
+}
+
+uint32_t mesh_object_set(uint16_t object_id, const uint8_t* p_data, uint16_t length)
+{
+    if (p_data == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (length == 0 || length > RBC_MESH_OBJECT_MAX_LEN)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    uint32_t error_code = NRF_SUCCESS;
+    event_handler_critical_section_begin();
+    if (m_object.state == OBJECT_STATE_RX)
+    {
+        error_code = NRF_ERROR_BUSY;
+    }
+    else
+    {
+        if (m_object.state == OBJECT_STATE_COMPLETE && m_object.object_id == object_id)
+        {
+            m_object.version++;
+        }
+        else
+        {
+            /* we don't know the last version in the mesh, start somewhere unlikely to be behind it */
+            m_object.version = (uint16_t) rand_get();
+        }
+        m_object.state = OBJECT_STATE_COMPLETE;
+        m_object.object_id = object_id;
+        m_object.length = length;
+        m_object.segment_count = (length + OBJECT_SEGMENT_LEN - 1) / OBJECT_SEGMENT_LEN;
+        m_object.received = segment_mask(m_object.segment_count);
+        m_object.tx_pending = 0;
+        m_object.tx_rounds = RBC_MESH_OBJECT_TX_ROUNDS;
+        m_object.req_count = 0;
+        memcpy(m_object.data, p_data, length);
+        timer_order(timer_now());
+    }
+    event_handler_critical_section_end();
+
+    return error_code;
+}
+
+void mesh_object_rx(mesh_adv_data_t* p_adv_data, uint32_t timestamp)
+{
+    if (p_adv_data->handle == MESH_OBJECT_HANDLE_SEGMENT)
+    {
+        segment_rx((object_segment_adv_data_t*) p_adv_data, timestamp);
+    }
+    else if (p_adv_data->handle == MESH_OBJECT_HANDLE_REQ)
+    {
+        req_rx((object_req_adv_data_t*) p_adv_data, timestamp);
+    }
+}
+
+#else
+
+void mesh_object_init(void)
+{
+}
+
+uint32_t mesh_object_set(uint16_t object_id, const uint8_t* p_data, uint16_t length)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+void mesh_object_rx(mesh_adv_data_t* p_adv_data, uint32_t timestamp)
+{
+    /* objects from others are ignored, we've got nowhere to put them */
+}
+
+#endif /* RBC_MESH_OBJECT_MAX_LEN > 0 */
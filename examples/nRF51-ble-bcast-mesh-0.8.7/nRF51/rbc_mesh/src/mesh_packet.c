@@ -31,50 +31,148 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mesh_packet.h"
 #include "app_error.h"
 #include <string.h>
+#if RBC_MESH_RUNTIME_POOL && defined(NRF51)
+#include "nrf_ic_info.h"
+#endif
+
+#define PACKET_INDEX(p_packet) ((((uint32_t) p_packet) - ((uint32_t) &gp_packet_pool[0])) / sizeof(mesh_packet_t))
+#define PACKET_FREE_LIST_END    (0xFFFF)
+
+#if RBC_MESH_RUNTIME_POOL
+    #define RAM_START               (0x20000000)
+    #define PACKET_POOL_ENTRY_SIZE  (sizeof(mesh_packet_t) + sizeof(uint8_t) + sizeof(uint16_t)) /* packet, ref count and free-list link */
+    #define PACKET_POOL_SIZE_MAX    (PACKET_FREE_LIST_END - 1)
+
+    /* end of the RAM the application was linked for, stack included */
+    #if defined(__CC_ARM)
+        extern uint32_t Image$$RW_IRAM1$$ZI$$Limit;
+        #define RAM_IMAGE_END   ((uint32_t) &Image$$RW_IRAM1$$ZI$$Limit)
+    #elif defined(__GNUC__)
+        extern uint32_t __StackTop;
+        #define RAM_IMAGE_END   ((uint32_t) &__StackTop)
+    #else
+        #error "RBC_MESH_RUNTIME_POOL needs the end of the RAM image from the linker"
+    #endif
+#endif
 
-#define PACKET_INDEX(p_packet) ((((uint32_t) p_packet) - ((uint32_t) &g_packet_pool[0])) / sizeof(mesh_packet_t))
+#if RBC_MESH_NOINIT_BUFFERS
+    #define PACKET_POOL_SECTION _NOINIT /* whoever acquires a packet writes it */
+#else
+    #define PACKET_POOL_SECTION
+#endif
 /******************************************************************************
 * Static globals
 ******************************************************************************/
-static mesh_packet_t g_packet_pool[RBC_MESH_PACKET_POOL_SIZE];
-static uint8_t g_packet_refs[RBC_MESH_PACKET_POOL_SIZE];
+static PACKET_POOL_SECTION mesh_packet_t g_packet_pool[RBC_MESH_PACKET_POOL_SIZE];
+static uint8_t g_packet_refs_static[RBC_MESH_PACKET_POOL_SIZE];
+/** Intrusive free-list of unreferenced packets, linked by pool index. */
+static uint16_t g_packet_free_next_static[RBC_MESH_PACKET_POOL_SIZE];
+/** The pool in use, either the static arrays above or the RAM beyond the image. */
+static mesh_packet_t* gp_packet_pool = g_packet_pool;
+static uint8_t* g_packet_refs = g_packet_refs_static;
+static uint16_t* g_packet_free_next = g_packet_free_next_static;
+static uint32_t g_packet_pool_size = RBC_MESH_PACKET_POOL_SIZE;
+static uint16_t g_packet_free_head;
+static uint16_t g_packets_in_use;
+static rbc_mesh_packet_pool_stats_t g_packet_pool_stats;
+/******************************************************************************
+* Static functions
+******************************************************************************/
+#if RBC_MESH_RUNTIME_POOL
+/** Get the end of the RAM of the chip the image is running on. */
+static uint32_t ram_end_get(void)
+{
+#ifdef NRF51
+    nrf_ic_info_t ic_info;
+    nrf_ic_info_get(&ic_info);
+    return RAM_START + ic_info.ram_size * 1024;
+#else
+    return RAM_START + NRF_FICR->INFO.RAM * 1024;
+#endif
+}
+
+/**
+ * Move the pool to the RAM between the end of the image and the end of the
+ * chip's RAM, if it fits more packets than the static pool. An image linked
+ * for the smallest RAM variant then uses all the RAM on the larger ones.
+ */
+static void pool_place(void)
+{
+    uint32_t start = (RAM_IMAGE_END + 3) & ~3UL;
+    uint32_t end = ram_end_get();
+    if (end <= start)
+    {
+        return;
+    }
+
+    uint32_t size = (end - start) / PACKET_POOL_ENTRY_SIZE;
+    if (size > PACKET_POOL_SIZE_MAX)
+    {
+        size = PACKET_POOL_SIZE_MAX;
+    }
+    if (size <= RBC_MESH_PACKET_POOL_SIZE)
+    {
+        return;
+    }
+
+    /* packets first, to keep them word aligned */
+    gp_packet_pool = (mesh_packet_t*) start;
+    g_packet_free_next = (uint16_t*) &gp_packet_pool[size];
+    g_packet_refs = (uint8_t*) &g_packet_free_next[size];
+    g_packet_pool_size = size;
+}
+#endif
+
 /******************************************************************************
 * Interface functions
 ******************************************************************************/
 void mesh_packet_init(void)
 {
-    for (uint32_t i = 0; i < RBC_MESH_PACKET_POOL_SIZE; ++i)
+#if RBC_MESH_RUNTIME_POOL
+    pool_place();
+#endif
+    for (uint32_t i = 0; i < g_packet_pool_size; ++i)
     {
         /* reset ref count field */
         g_packet_refs[i] = 0;
+        g_packet_free_next[i] = (i + 1 < g_packet_pool_size) ? (i + 1) : PACKET_FREE_LIST_END;
     }
+    g_packet_free_head = 0;
+    g_packets_in_use = 0;
+    memset(&g_packet_pool_stats, 0, sizeof(g_packet_pool_stats));
 }
 
 bool mesh_packet_acquire(mesh_packet_t** pp_packet)
 {
     uint32_t was_masked;
-    for (uint32_t i = 0; i < RBC_MESH_PACKET_POOL_SIZE; ++i)
+    _DISABLE_IRQS(was_masked);
+    uint16_t index = g_packet_free_head;
+    if (index == PACKET_FREE_LIST_END)
     {
-        _DISABLE_IRQS(was_masked);
-        if (g_packet_refs[i] == 0) /* no refs, free to use */
-        {
-            g_packet_refs[i] = 1;
-            *pp_packet = &g_packet_pool[i];
-            _ENABLE_IRQS(was_masked);
-            return true;
-        }
+        g_packet_pool_stats.exhausted_count++;
         _ENABLE_IRQS(was_masked);
+        APP_ERROR_CHECK(NRF_ERROR_NO_MEM);
+        return false;
     }
-    APP_ERROR_CHECK(NRF_ERROR_NO_MEM);
-    return false;
+
+    g_packet_free_head = g_packet_free_next[index];
+    g_packet_refs[index] = 1;
+    if (++g_packets_in_use > g_packet_pool_stats.high_water_mark)
+    {
+        g_packet_pool_stats.high_water_mark = g_packets_in_use;
+    }
+    _ENABLE_IRQS(was_masked);
+
+    *pp_packet = &gp_packet_pool[index];
+    return true;
 }
 
 mesh_packet_t* mesh_packet_get_aligned(void* p_buf_pointer)
 {
     uint32_t index = PACKET_INDEX(p_buf_pointer);
-    if (index < RBC_MESH_PACKET_POOL_SIZE)
+    if (index < g_packet_pool_size)
     {
-        return &g_packet_pool[index];
+        return &gp_packet_pool[index];
     }
     else
     {
@@ -86,7 +184,7 @@ bool mesh_packet_ref_count_inc(mesh_packet_t* p_packet)
 {
     /* the given pointer may not be aligned, have to force alignment with index */
     uint32_t index = PACKET_INDEX(p_packet);
-    if (index >= RBC_MESH_PACKET_POOL_SIZE)
+    if (index >= g_packet_pool_size)
     {
         return false;
     }
@@ -105,7 +203,7 @@ bool mesh_packet_ref_count_inc(mesh_packet_t* p_packet)
 bool mesh_packet_ref_count_dec(mesh_packet_t* p_packet)
 {
     uint32_t index = PACKET_INDEX(p_packet);
-    if (index >= RBC_MESH_PACKET_POOL_SIZE)
+    if (index >= g_packet_pool_size)
     {
         return false;
     }
@@ -119,16 +217,23 @@ bool mesh_packet_ref_count_dec(mesh_packet_t* p_packet)
         _ENABLE_IRQS(was_masked);
         return false;
     }
-    g_packet_refs[index]--;
+    bool still_referenced = (--g_packet_refs[index] > 0);
+    if (!still_referenced)
+    {
+        /* last reference gone, return the packet to the free-list */
+        g_packet_free_next[index] = g_packet_free_head;
+        g_packet_free_head = index;
+        g_packets_in_use--;
+    }
     _ENABLE_IRQS(was_masked);
 
-    return (g_packet_refs[index] > 0);
+    return still_referenced;
 }
 
 uint8_t mesh_packet_ref_count_get(mesh_packet_t* p_packet)
 {
     uint32_t index = PACKET_INDEX(p_packet);
-    if (index >= RBC_MESH_PACKET_POOL_SIZE)
+    if (index >= g_packet_pool_size)
     {
         return 0;
     }
@@ -136,6 +241,16 @@ uint8_t mesh_packet_ref_count_get(mesh_packet_t* p_packet)
     return g_packet_refs[index];
 }
 
+void mesh_packet_pool_stats_get(rbc_mesh_packet_pool_stats_t* p_stats)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    *p_stats = g_packet_pool_stats;
+    p_stats->in_use = g_packets_in_use;
+    p_stats->size = g_packet_pool_size;
+    _ENABLE_IRQS(was_masked);
+}
+
 uint32_t mesh_packet_set_local_addr(mesh_packet_t* p_packet)
 {
 #ifdef SOFTDEVICE_PRESENT
@@ -194,10 +309,105 @@ uint32_t mesh_packet_build(mesh_packet_t* p_packet,
     {
         memcpy(p_mesh_adv_data->data, data, length);
     }
+#ifdef MESH_AUTH
+    /* sequence number 0 marks the packet as not signed yet */
+    memset(&p_mesh_adv_data->data[length], 0, RBC_MESH_AUTH_OVERHEAD);
+#endif
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_packet_batch_build(mesh_packet_t* p_packet)
+{
+    if (p_packet == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    mesh_batch_adv_data_t* p_batch_adv_data = (mesh_batch_adv_data_t*) &p_packet->payload[0];
+
+    mesh_packet_set_local_addr(p_packet);
+
+    p_packet->header.length = MESH_PACKET_BLE_OVERHEAD + 1 + MESH_BATCH_ADV_OVERHEAD;
+    p_packet->header.type = BLE_PACKET_TYPE_ADV_NONCONN_IND;
+
+    p_batch_adv_data->adv_data_length = MESH_BATCH_ADV_OVERHEAD;
+    p_batch_adv_data->adv_data_type = MESH_ADV_DATA_TYPE;
+    p_batch_adv_data->mesh_uuid = MESH_UUID;
+    p_batch_adv_data->handle = MESH_BATCH_HANDLE;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_packet_batch_append(mesh_packet_t* p_packet,
+        rbc_mesh_value_handle_t handle,
+        uint16_t version,
+        uint8_t* data,
+        uint8_t length)
+{
+    if (p_packet == NULL || (data == NULL && length > 0))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (length > MESH_BATCH_CAPACITY - MESH_BATCH_RECORD_OVERHEAD)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    mesh_batch_adv_data_t* p_batch_adv_data = (mesh_batch_adv_data_t*) &p_packet->payload[0];
+    const uint32_t used = p_batch_adv_data->adv_data_length - MESH_BATCH_ADV_OVERHEAD;
+    if (used + MESH_BATCH_RECORD_OVERHEAD + length > MESH_BATCH_CAPACITY)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    mesh_batch_record_t* p_record = (mesh_batch_record_t*) &p_batch_adv_data->records[used];
+    p_record->handle = handle;
+    p_record->version = version;
+    p_record->length = length;
+    if (length > 0)
+    {
+        memcpy(p_record->data, data, length);
+    }
+
+    p_batch_adv_data->adv_data_length += MESH_BATCH_RECORD_OVERHEAD + length;
+    p_packet->header.length += MESH_BATCH_RECORD_OVERHEAD + length;
 
     return NRF_SUCCESS;
 }
 
+mesh_batch_record_t* mesh_packet_batch_record_next(mesh_batch_adv_data_t* p_batch_adv_data, mesh_batch_record_t* p_prev)
+{
+    if (p_batch_adv_data == NULL ||
+        p_batch_adv_data->handle != MESH_BATCH_HANDLE ||
+        p_batch_adv_data->adv_data_length < MESH_BATCH_ADV_OVERHEAD ||
+        p_batch_adv_data->adv_data_length > MESH_BATCH_ADV_OVERHEAD + MESH_BATCH_CAPACITY)
+    {
+        return NULL;
+    }
+
+    const uint32_t records_len = p_batch_adv_data->adv_data_length - MESH_BATCH_ADV_OVERHEAD;
+    uint32_t offset = 0;
+    if (p_prev != NULL)
+    {
+        offset = ((uint8_t*) p_prev - &p_batch_adv_data->records[0]) +
+                 MESH_BATCH_RECORD_OVERHEAD + p_prev->length;
+    }
+
+    /* the record header and its data must fit inside the adv data */
+    if (offset + MESH_BATCH_RECORD_OVERHEAD > records_len)
+    {
+        return NULL;
+    }
+    mesh_batch_record_t* p_record = (mesh_batch_record_t*) &p_batch_adv_data->records[offset];
+    if (offset + MESH_BATCH_RECORD_OVERHEAD + p_record->length > records_len ||
+        p_record->length > RBC_MESH_VALUE_MAX_LEN)
+    {
+        return NULL;
+    }
+
+    return p_record;
+}
+
 uint32_t mesh_packet_adv_data_sanitize(mesh_packet_t* p_packet)
 {
     mesh_adv_data_t* p_mesh_adv_data = mesh_packet_adv_data_get(p_packet);
@@ -251,7 +461,8 @@ mesh_adv_data_t* mesh_packet_adv_data_get(mesh_packet_t* p_packet)
             /* invalid ad length */
             return NULL;
         }
-        p_mesh_adv_data += p_mesh_adv_data->adv_data_length + 1; /* length field in ad data is not considered */
+        /* length field in ad data is not considered */
+        p_mesh_adv_data = (mesh_adv_data_t*) ((uint8_t*) p_mesh_adv_data + p_mesh_adv_data->adv_data_length + 1);
     }
 
     /* The network packet overlaps with AD-data */
@@ -302,10 +513,10 @@ void mesh_packet_take_ownership(mesh_packet_t* p_packet)
 
 mesh_packet_t* mesh_packet_get_start_pointer(void* p_content)
 {
-    uint32_t index = ((((uint32_t) p_content) - ((uint32_t) &g_packet_pool[0])) / sizeof(mesh_packet_t));
-    if (index < RBC_MESH_PACKET_POOL_SIZE)
+    uint32_t index = ((((uint32_t) p_content) - ((uint32_t) &gp_packet_pool[0])) / sizeof(mesh_packet_t));
+    if (index < g_packet_pool_size)
     {
-        return &g_packet_pool[index];
+        return &gp_packet_pool[index];
     }
     else
     {
@@ -0,0 +1,520 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_persist.h"
+
+#ifdef MESH_PERSIST
+
+#include <stdbool.h>
+#include <string.h>
+#include "mesh_flash.h"
+#include "timer_scheduler.h"
+#include "dfu_types_mesh.h"
+#include "nrf_error.h"
+#include "app_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define PERSIST_BANK_SIZE               (RBC_MESH_PERSIST_BANK_PAGES * PAGE_SIZE)
+#define PERSIST_BANK_ADDR(bank)         (RBC_MESH_PERSIST_FLASH_ADDR + (bank) * PERSIST_BANK_SIZE)
+#define PERSIST_BANK_NONE               (0xFF)
+#define PERSIST_BANK_MAGIC              (0x5E7A1BED)
+
+/* Flash is written one word at a time, in order. Each record ends with a
+   commit word, so a record cut short by a power loss is never mistaken for a
+   complete one. */
+#define PERSIST_RECORD_HEADER_LEN       (5)
+#define PERSIST_RECORD_WORDS            ((PERSIST_RECORD_HEADER_LEN + RBC_MESH_VALUE_MAX_LEN + 3) / 4 + 1)
+#define PERSIST_RECORD_SIZE             (PERSIST_RECORD_WORDS * 4)
+#define PERSIST_RECORD_COMMIT(p_record) ((p_record)->words[PERSIST_RECORD_WORDS - 1])
+#define PERSIST_RECORD_COMMIT_MARK      (0xC0DE0000)
+#define PERSIST_RECORD_LENGTH_REMOVED   (0xFE) /**< Length of a record marking a removed value. */
+
+/** The first slot of each bank holds the bank header, the rest hold records. */
+#define PERSIST_SLOT_FIRST              (1)
+#define PERSIST_SLOT_COUNT              (PERSIST_BANK_SIZE / PERSIST_RECORD_SIZE)
+#define PERSIST_SLOT_ADDR(bank, slot)   (PERSIST_BANK_ADDR(bank) + (slot) * PERSIST_RECORD_SIZE)
+#define PERSIST_SLOT_NONE               (0xFFFF)
+
+/** Number of values that can wait to be written at once. */
+#define PERSIST_PENDING_MAX             (4)
+
+/** Time to wait before retrying when the flash operation queue is full. */
+#define PERSIST_RETRY_DELAY_US          (10000)
+
+#if (RBC_MESH_PERSIST_FLASH_ADDR & (PAGE_SIZE - 1))
+    #error "RBC_MESH_PERSIST_FLASH_ADDR must be page aligned"
+#endif
+
+/*****************************************************************************
+* Local typedefs
+*****************************************************************************/
+typedef union
+{
+    struct
+    {
+        rbc_mesh_value_handle_t handle;
+        uint16_t                version;
+        uint8_t                 length;
+        uint8_t                 data[RBC_MESH_VALUE_MAX_LEN];
+    } value;
+    uint32_t words[PERSIST_RECORD_WORDS];
+} persist_record_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;   /**< Incremented for every compaction, the highest valid one is active. */
+} persist_bank_header_t;
+
+typedef enum
+{
+    PERSIST_STATE_IDLE,     /**< Nothing to write. */
+    PERSIST_STATE_WRITE,    /**< Writing pending values to the active bank. */
+    PERSIST_STATE_ERASE,    /**< Erasing the other bank for compaction. */
+    PERSIST_STATE_COPY,     /**< Copying the latest values to the other bank. */
+    PERSIST_STATE_HEADER    /**< Writing the header that makes the other bank active. */
+} persist_state_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static persist_state_t          m_state;
+static bool                     m_op_in_progress;
+static bool                     m_compacted;        /**< No records have been written since the last compaction. */
+static uint8_t                  m_active_bank;
+static uint32_t                 m_seq;
+static uint16_t                 m_next_slot;        /**< First free slot in the active bank. */
+static uint16_t                 m_copy_slot;        /**< Next slot to consider for copying in the active bank. */
+static uint16_t                 m_dest_slot;        /**< Next slot to copy to in the other bank. */
+static mesh_persist_value_t     m_pending[PERSIST_PENDING_MAX];
+static persist_record_t         m_record_buffer;    /**< Source of the write in progress. */
+static persist_bank_header_t    m_header_buffer;
+static timer_event_t            m_flush_timer;
+static timestamp_t              m_last_flush;
+static bool                     m_has_flushed;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void state_run(void);
+
+static inline const persist_record_t* slot_get(uint8_t bank, uint16_t slot)
+{
+    return (const persist_record_t*) PERSIST_SLOT_ADDR(bank, slot);
+}
+
+static inline uint8_t other_bank_get(void)
+{
+    return (m_active_bank == 0) ? 1 : 0;
+}
+
+static uint32_t record_commit_get(const persist_record_t* p_record)
+{
+    uint16_t sum = p_record->value.handle + p_record->value.version + p_record->value.length;
+    if (p_record->value.length <= RBC_MESH_VALUE_MAX_LEN)
+    {
+        for (uint32_t i = 0; i < p_record->value.length; ++i)
+        {
+            sum = (uint16_t) ((sum << 1) | (sum >> 15)) + p_record->value.data[i];
+        }
+    }
+    return PERSIST_RECORD_COMMIT_MARK | sum;
+}
+
+static bool record_is_valid(const persist_record_t* p_record)
+{
+    return (p_record->value.handle != RBC_MESH_INVALID_HANDLE &&
+            (p_record->value.length <= RBC_MESH_VALUE_MAX_LEN ||
+             p_record->value.length == PERSIST_RECORD_LENGTH_REMOVED) &&
+            PERSIST_RECORD_COMMIT(p_record) == record_commit_get(p_record));
+}
+
+/** Check whether a valid record holds the latest value of its handle in the active bank. */
+static bool record_is_latest(uint16_t slot)
+{
+    rbc_mesh_value_handle_t handle = slot_get(m_active_bank, slot)->value.handle;
+    for (uint16_t i = slot + 1; i < m_next_slot; ++i)
+    {
+        const persist_record_t* p_record = slot_get(m_active_bank, i);
+        if (p_record->value.handle == handle && record_is_valid(p_record))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static mesh_persist_value_t* pending_get(rbc_mesh_value_handle_t handle)
+{
+    for (uint32_t i = 0; i < PERSIST_PENDING_MAX; ++i)
+    {
+        if (m_pending[i].handle == handle)
+        {
+            return &m_pending[i];
+        }
+    }
+    return NULL;
+}
+
+static mesh_persist_value_t* pending_next(void)
+{
+    for (uint32_t i = 0; i < PERSIST_PENDING_MAX; ++i)
+    {
+        if (m_pending[i].handle != RBC_MESH_INVALID_HANDLE)
+        {
+            return &m_pending[i];
+        }
+    }
+    return NULL;
+}
+
+static void pending_clear(void)
+{
+    for (uint32_t i = 0; i < PERSIST_PENDING_MAX; ++i)
+    {
+        m_pending[i].handle = RBC_MESH_INVALID_HANDLE;
+    }
+}
+
+static void flush_timeout(timestamp_t timestamp, void* p_context)
+{
+    m_last_flush = timestamp;
+    m_has_flushed = true;
+    state_run();
+}
+
+static void flush_schedule(timestamp_t delay_us)
+{
+    timestamp_t time_now = timer_now();
+    timestamp_t timeout = time_now + delay_us;
+    if (m_has_flushed &&
+        TIMER_OLDER_THAN(timeout, m_last_flush + RBC_MESH_PERSIST_WRITE_INTERVAL_MS * 1000))
+    {
+        timeout = m_last_flush + RBC_MESH_PERSIST_WRITE_INTERVAL_MS * 1000;
+    }
+    APP_ERROR_CHECK(timer_sch_reschedule(&m_flush_timer, timeout));
+}
+
+static void flash_op_end(void* p_location)
+{
+    m_op_in_progress = false;
+    state_run();
+}
+
+static uint32_t flash_write(uint32_t addr, const void* p_data, uint32_t length)
+{
+    flash_op_t op;
+    op.write.start_addr = addr;
+    op.write.p_data = (uint8_t*) p_data;
+    op.write.length = length;
+    uint32_t error_code = mesh_flash_op_push_cb(FLASH_OP_TYPE_WRITE, &op, flash_op_end);
+    m_op_in_progress = (error_code == NRF_SUCCESS);
+    return error_code;
+}
+
+static uint32_t flash_erase(uint32_t addr, uint32_t length)
+{
+    flash_op_t op;
+    op.erase.start_addr = addr;
+    op.erase.length = length;
+    uint32_t error_code = mesh_flash_op_push_cb(FLASH_OP_TYPE_ERASE, &op, flash_op_end);
+    m_op_in_progress = (error_code == NRF_SUCCESS);
+    return error_code;
+}
+
+/** Find the next record in the active bank that should survive a compaction. */
+static uint16_t copy_slot_get(void)
+{
+    if (m_active_bank == PERSIST_BANK_NONE)
+    {
+        return PERSIST_SLOT_NONE;
+    }
+    for (uint16_t i = m_copy_slot; i < m_next_slot; ++i)
+    {
+        const persist_record_t* p_record = slot_get(m_active_bank, i);
+        if (record_is_valid(p_record) &&
+            p_record->value.length != PERSIST_RECORD_LENGTH_REMOVED &&
+            record_is_latest(i))
+        {
+            return i;
+        }
+    }
+    return PERSIST_SLOT_NONE;
+}
+
+static uint32_t write_step(void)
+{
+    mesh_persist_value_t* p_pending = pending_next();
+    if (p_pending == NULL)
+    {
+        m_state = PERSIST_STATE_IDLE;
+        return NRF_SUCCESS;
+    }
+
+    if (m_active_bank == PERSIST_BANK_NONE || m_next_slot >= PERSIST_SLOT_COUNT)
+    {
+        if (m_compacted)
+        {
+            /* Every slot holds a live value, there's no room for more. */
+            pending_clear();
+            m_state = PERSIST_STATE_IDLE;
+        }
+        else
+        {
+            m_state = PERSIST_STATE_ERASE;
+        }
+        return NRF_SUCCESS;
+    }
+
+    memset(&m_record_buffer, 0xFF, sizeof(m_record_buffer));
+    m_record_buffer.value.handle = p_pending->handle;
+    m_record_buffer.value.version = p_pending->version;
+    m_record_buffer.value.length = p_pending->length;
+    if (p_pending->length <= RBC_MESH_VALUE_MAX_LEN)
+    {
+        memcpy(m_record_buffer.value.data, p_pending->data, p_pending->length);
+    }
+    PERSIST_RECORD_COMMIT(&m_record_buffer) = record_commit_get(&m_record_buffer);
+
+    uint32_t error_code = flash_write(PERSIST_SLOT_ADDR(m_active_bank, m_next_slot),
+            m_record_buffer.words, PERSIST_RECORD_SIZE);
+    if (error_code == NRF_SUCCESS)
+    {
+        p_pending->handle = RBC_MESH_INVALID_HANDLE;
+        m_next_slot++;
+        m_compacted = false;
+    }
+    return error_code;
+}
+
+static uint32_t erase_step(void)
+{
+    uint32_t error_code = flash_erase(PERSIST_BANK_ADDR(other_bank_get()), PERSIST_BANK_SIZE);
+    if (error_code == NRF_SUCCESS)
+    {
+        m_copy_slot = PERSIST_SLOT_FIRST;
+        m_dest_slot = PERSIST_SLOT_FIRST;
+        m_state = PERSIST_STATE_COPY;
+    }
+    return error_code;
+}
+
+static uint32_t copy_step(void)
+{
+    uint16_t slot = copy_slot_get();
+    if (slot == PERSIST_SLOT_NONE)
+    {
+        m_state = PERSIST_STATE_HEADER;
+        return NRF_SUCCESS;
+    }
+
+    /* records can be copied straight from flash, no need to buffer them */
+    uint32_t error_code = flash_write(PERSIST_SLOT_ADDR(other_bank_get(), m_dest_slot),
+            slot_get(m_active_bank, slot), PERSIST_RECORD_SIZE);
+    if (error_code == NRF_SUCCESS)
+    {
+        m_copy_slot = slot + 1;
+        m_dest_slot++;
+    }
+    return error_code;
+}
+
+static uint32_t header_step(void)
+{
+    uint8_t bank = other_bank_get();
+    m_header_buffer.magic = PERSIST_BANK_MAGIC;
+    m_header_buffer.seq = m_seq + 1;
+    uint32_t error_code = flash_write(PERSIST_BANK_ADDR(bank), &m_header_buffer, sizeof(m_header_buffer));
+    if (error_code == NRF_SUCCESS)
+    {
+        /* flash operations are executed in order, so the next writes will
+           end up after the header. */
+        m_active_bank = bank;
+        m_seq++;
+        m_next_slot = m_dest_slot;
+        m_compacted = true;
+        m_state = PERSIST_STATE_WRITE;
+    }
+    return error_code;
+}
+
+static void state_run(void)
+{
+    while (!m_op_in_progress && m_state != PERSIST_STATE_IDLE)
+    {
+        uint32_t error_code = NRF_SUCCESS;
+        switch (m_state)
+        {
+            case PERSIST_STATE_WRITE:
+                error_code = write_step();
+                break;
+            case PERSIST_STATE_ERASE:
+                error_code = erase_step();
+                break;
+            case PERSIST_STATE_COPY:
+                error_code = copy_step();
+                break;
+            case PERSIST_STATE_HEADER:
+                error_code = header_step();
+                break;
+            default:
+                APP_ERROR_CHECK(NRF_ERROR_INVALID_STATE);
+        }
+
+        if (error_code != NRF_SUCCESS)
+        {
+            /* the flash queue is full, try again later */
+            flush_schedule(PERSIST_RETRY_DELAY_US);
+            return;
+        }
+    }
+}
+
+static uint32_t pending_push(rbc_mesh_value_handle_t handle, uint16_t version, const uint8_t* p_data, uint8_t length)
+{
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    mesh_persist_value_t* p_pending = pending_get(handle);
+    if (p_pending == NULL)
+    {
+        p_pending = pending_get(RBC_MESH_INVALID_HANDLE);
+        if (p_pending == NULL)
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+    }
+
+    p_pending->handle = handle;
+    p_pending->version = version;
+    p_pending->length = length;
+    if (length <= RBC_MESH_VALUE_MAX_LEN)
+    {
+        memcpy(p_pending->data, p_data, length);
+    }
+
+    if (m_state == PERSIST_STATE_IDLE)
+    {
+        m_state = PERSIST_STATE_WRITE;
+        flush_schedule(0);
+    }
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_persist_init(void)
+{
+    m_state = PERSIST_STATE_IDLE;
+    m_op_in_progress = false;
+    m_compacted = false;
+    m_has_flushed = false;
+    m_active_bank = PERSIST_BANK_NONE;
+    m_seq = 0;
+    m_next_slot = PERSIST_SLOT_COUNT;
+    pending_clear();
+    memset(&m_flush_timer, 0, sizeof(m_flush_timer));
+    m_flush_timer.cb = flush_timeout;
+
+    for (uint8_t bank = 0; bank < 2; ++bank)
+    {
+        const persist_bank_header_t* p_header = (const persist_bank_header_t*) PERSIST_BANK_ADDR(bank);
+        if (p_header->magic == PERSIST_BANK_MAGIC &&
+            (m_active_bank == PERSIST_BANK_NONE || (int32_t) (p_header->seq - m_seq) > 0))
+        {
+            m_active_bank = bank;
+            m_seq = p_header->seq;
+        }
+    }
+
+    if (m_active_bank != PERSIST_BANK_NONE)
+    {
+        m_next_slot = PERSIST_SLOT_FIRST;
+        while (m_next_slot < PERSIST_SLOT_COUNT &&
+               slot_get(m_active_bank, m_next_slot)->value.handle != RBC_MESH_INVALID_HANDLE)
+        {
+            m_next_slot++;
+        }
+    }
+}
+
+uint32_t mesh_persist_value_next(uint32_t* p_iterator, mesh_persist_value_t* p_value)
+{
+    if (p_iterator == NULL || p_value == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (m_active_bank == PERSIST_BANK_NONE)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    uint32_t slot = (*p_iterator < PERSIST_SLOT_FIRST) ? PERSIST_SLOT_FIRST : *p_iterator;
+    for (; slot < m_next_slot; ++slot)
+    {
+        const persist_record_t* p_record = slot_get(m_active_bank, slot);
+        if (record_is_valid(p_record) &&
+            p_record->value.length != PERSIST_RECORD_LENGTH_REMOVED &&
+            record_is_latest(slot))
+        {
+            p_value->handle = p_record->value.handle;
+            p_value->version = p_record->value.version;
+            p_value->length = p_record->value.length;
+            memcpy(p_value->data, p_record->value.data, p_record->value.length);
+            *p_iterator = slot + 1;
+            return NRF_SUCCESS;
+        }
+    }
+    *p_iterator = slot;
+    return NRF_ERROR_NOT_FOUND;
+}
+
+uint32_t mesh_persist_value_store(rbc_mesh_value_handle_t handle, uint16_t version, const uint8_t* p_data, uint8_t length)
+{
+    if (length > RBC_MESH_VALUE_MAX_LEN)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_data == NULL && length > 0)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return pending_push(handle, version, p_data, length);
+}
+
+uint32_t mesh_persist_value_remove(rbc_mesh_value_handle_t handle)
+{
+    return pending_push(handle, 0, NULL, PERSIST_RECORD_LENGTH_REMOVED);
+}
+
+#endif /* MESH_PERSIST */
@@ -0,0 +1,314 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "mesh_powerfail.h"
+
+#ifdef MESH_POWERFAIL
+
+#include <stdbool.h>
+#include <string.h>
+#include "mesh_flash.h"
+#include "timer.h"
+#include "timer_scheduler.h"
+#include "dfu_types_mesh.h"
+#include "toolchain.h"
+#include "nrf_soc.h"
+#include "nrf_error.h"
+#include "app_error.h"
+
+#ifndef SOFTDEVICE_PRESENT
+    #error "MESH_POWERFAIL needs the power failure warning of the SoftDevice"
+#endif
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define POWERFAIL_PAGE_ADDR(page)           (RBC_MESH_POWERFAIL_FLASH_ADDR + (page) * PAGE_SIZE)
+#define POWERFAIL_PAGE_NONE                 (0xFF)
+
+/* Like the records of mesh_persist, each record ends with a commit word, so a
+   record cut short by the power running out is never mistaken for a complete
+   one. */
+#define POWERFAIL_RECORD_HEADER_LEN         (5)
+#define POWERFAIL_RECORD_WORDS              ((POWERFAIL_RECORD_HEADER_LEN + RBC_MESH_POWERFAIL_STATE_LEN_MAX + 3) / 4 + 1)
+#define POWERFAIL_RECORD_SIZE               (POWERFAIL_RECORD_WORDS * 4)
+#define POWERFAIL_RECORD_COMMIT(p_record)   ((p_record)->words[POWERFAIL_RECORD_WORDS - 1])
+#define POWERFAIL_RECORD_COMMIT_MARK        (0xB0FF0000)
+
+#define POWERFAIL_SLOT_COUNT                (PAGE_SIZE / POWERFAIL_RECORD_SIZE)
+#define POWERFAIL_SLOT_ADDR(page, slot)     (POWERFAIL_PAGE_ADDR(page) + (slot) * POWERFAIL_RECORD_SIZE)
+
+/** Time to wait before retrying when the flash operation queue is full. */
+#define POWERFAIL_RETRY_DELAY_US            (10000)
+
+#if (RBC_MESH_POWERFAIL_FLASH_ADDR & (PAGE_SIZE - 1))
+    #error "RBC_MESH_POWERFAIL_FLASH_ADDR must be page aligned"
+#endif
+
+/*****************************************************************************
+* Local typedefs
+*****************************************************************************/
+typedef union
+{
+    struct
+    {
+        uint32_t seq;   /**< Incremented for every record, the highest valid one is restored. */
+        uint8_t  length;
+        uint8_t  data[RBC_MESH_POWERFAIL_STATE_LEN_MAX];
+    } state;
+    uint32_t words[POWERFAIL_RECORD_WORDS];
+} powerfail_record_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static uint8_t              m_state[RBC_MESH_POWERFAIL_STATE_LEN_MAX];
+static uint8_t              m_state_length;
+static bool                 m_has_state;
+static powerfail_record_t   m_record_buffer;    /**< Source of the last record write. */
+static uint32_t             m_seq;
+static uint8_t              m_page;             /**< Page of the next record. */
+static uint16_t             m_slot;             /**< Slot of the next record. */
+static volatile bool        m_slot_ready;       /**< The slot of the next record is erased. */
+static timer_event_t        m_kick_timer;
+static timer_event_t        m_retry_timer;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static inline const powerfail_record_t* slot_get(uint8_t page, uint16_t slot)
+{
+    return (const powerfail_record_t*) POWERFAIL_SLOT_ADDR(page, slot);
+}
+
+static uint32_t record_commit_get(const powerfail_record_t* p_record)
+{
+    uint16_t sum = (uint16_t) (p_record->state.seq + (p_record->state.seq >> 16)) + p_record->state.length;
+    if (p_record->state.length <= RBC_MESH_POWERFAIL_STATE_LEN_MAX)
+    {
+        for (uint32_t i = 0; i < p_record->state.length; ++i)
+        {
+            sum = (uint16_t) ((sum << 1) | (sum >> 15)) + p_record->state.data[i];
+        }
+    }
+    return POWERFAIL_RECORD_COMMIT_MARK | sum;
+}
+
+static bool record_is_valid(const powerfail_record_t* p_record)
+{
+    return (p_record->state.length <= RBC_MESH_POWERFAIL_STATE_LEN_MAX &&
+            POWERFAIL_RECORD_COMMIT(p_record) == record_commit_get(p_record));
+}
+
+static bool words_are_blank(uint32_t addr, uint32_t length)
+{
+    for (const uint32_t* p_word = (const uint32_t*) addr; p_word < (const uint32_t*) (addr + length); ++p_word)
+    {
+        if (*p_word != 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void erase_end(void* p_location)
+{
+    m_slot_ready = true;
+}
+
+static void erase_schedule(void)
+{
+    flash_op_t op;
+    op.erase.start_addr = POWERFAIL_PAGE_ADDR(m_page);
+    op.erase.length = PAGE_SIZE;
+    if (mesh_flash_op_push_cb(FLASH_OP_TYPE_ERASE, &op, erase_end) != NRF_SUCCESS)
+    {
+        /* the flash queue is full, try again later */
+        APP_ERROR_CHECK(timer_sch_reschedule(&m_retry_timer, timer_now() + POWERFAIL_RETRY_DELAY_US));
+    }
+}
+
+static void retry_timeout(timestamp_t timestamp, void* p_context)
+{
+    erase_schedule();
+}
+
+/** The timer only makes the timeslot run the urgent flash write right away. */
+static void kick_timeout(timestamp_t timestamp, void* p_context)
+{
+}
+
+/**
+* Move on to the first erased slot from the current one. When the page is
+* full, the next record goes to the start of the other page, which is erased
+* if needed. The page being left holds the latest record, so a power loss
+* during the erase loses nothing.
+*/
+static void next_slot_prepare(void)
+{
+    while (m_slot < POWERFAIL_SLOT_COUNT &&
+           !words_are_blank(POWERFAIL_SLOT_ADDR(m_page, m_slot), POWERFAIL_RECORD_SIZE))
+    {
+        m_slot++;
+    }
+    if (m_slot < POWERFAIL_SLOT_COUNT)
+    {
+        m_slot_ready = true;
+        return;
+    }
+
+    m_page = (m_page == 0) ? 1 : 0;
+    m_slot = 0;
+    m_slot_ready = words_are_blank(POWERFAIL_PAGE_ADDR(m_page), PAGE_SIZE);
+    if (!m_slot_ready)
+    {
+        erase_schedule();
+    }
+}
+
+static void record_write(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memset(&m_record_buffer, 0, sizeof(m_record_buffer));
+    m_record_buffer.state.seq = ++m_seq;
+    m_record_buffer.state.length = m_state_length;
+    memcpy(m_record_buffer.state.data, m_state, m_state_length);
+    POWERFAIL_RECORD_COMMIT(&m_record_buffer) = record_commit_get(&m_record_buffer);
+    _ENABLE_IRQS(was_masked);
+
+    flash_op_t op;
+    op.write.start_addr = POWERFAIL_SLOT_ADDR(m_page, m_slot);
+    op.write.p_data = (uint8_t*) &m_record_buffer;
+    op.write.length = POWERFAIL_RECORD_SIZE;
+    if (mesh_flash_op_push_urgent(&op) == NRF_SUCCESS)
+    {
+        (void) timer_sch_reschedule(&m_kick_timer, timer_now());
+        /* in case the supply recovers, the next warning gets a slot of its own */
+        m_slot++;
+        next_slot_prepare();
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+uint32_t mesh_powerfail_init(void)
+{
+    m_state_length = 0;
+    m_has_state = false;
+    m_seq = 0;
+    m_page = POWERFAIL_PAGE_NONE;
+    m_slot = 0;
+    memset(&m_kick_timer, 0, sizeof(m_kick_timer));
+    m_kick_timer.cb = kick_timeout;
+    memset(&m_retry_timer, 0, sizeof(m_retry_timer));
+    m_retry_timer.cb = retry_timeout;
+
+    for (uint8_t page = 0; page < 2; ++page)
+    {
+        for (uint16_t slot = 0; slot < POWERFAIL_SLOT_COUNT; ++slot)
+        {
+            const powerfail_record_t* p_record = slot_get(page, slot);
+            if (record_is_valid(p_record) &&
+                (m_page == POWERFAIL_PAGE_NONE || (int32_t) (p_record->state.seq - m_seq) > 0))
+            {
+                m_page = page;
+                m_slot = slot;
+                m_seq = p_record->state.seq;
+            }
+        }
+    }
+
+    if (m_page == POWERFAIL_PAGE_NONE)
+    {
+        m_page = 0;
+    }
+    else
+    {
+        const powerfail_record_t* p_record = slot_get(m_page, m_slot);
+        memcpy(m_state, p_record->state.data, p_record->state.length);
+        m_state_length = p_record->state.length;
+        m_has_state = true;
+        m_slot++;
+    }
+    next_slot_prepare();
+
+    uint32_t error_code = sd_power_pof_threshold_set(RBC_MESH_POWERFAIL_THRESHOLD);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+    return sd_power_pof_enable(1);
+}
+
+void mesh_powerfail_sd_evt_handler(uint32_t sd_evt)
+{
+    /* a record that is still waiting is written with the state it had */
+    if (sd_evt == NRF_EVT_POWER_FAILURE_WARNING &&
+        m_has_state &&
+        m_slot_ready &&
+        !mesh_flash_urgent_pending())
+    {
+        record_write();
+    }
+}
+
+uint32_t mesh_powerfail_state_set(const uint8_t* p_data, uint8_t length)
+{
+    if (length > RBC_MESH_POWERFAIL_STATE_LEN_MAX)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(m_state, p_data, length);
+    m_state_length = length;
+    m_has_state = true;
+    _ENABLE_IRQS(was_masked);
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_powerfail_state_get(uint8_t* p_data, uint8_t* p_length)
+{
+    if (!m_has_state)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(p_data, m_state, m_state_length);
+    *p_length = m_state_length;
+    _ENABLE_IRQS(was_masked);
+    return NRF_SUCCESS;
+}
+
+#endif /* MESH_POWERFAIL */
@@ -0,0 +1,622 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_probe.h"
+
+#include <string.h>
+#include "transport_control.h"
+#include "version_handler.h"
+#include "event_handler.h"
+#include "timer_scheduler.h"
+#include "rand.h"
+#include "toolchain.h"
+#include "nrf_error.h"
+
+#if RBC_MESH_PROBE
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define PROBE_KIND_REQUEST          (0)
+#define PROBE_KIND_REPLY            (1)
+
+#define PROBE_ADV_LEN               (1 /* adv_type */ + 2 /* UUID */ + 2 /* handle */ + 1 /* kind */ + 1 /* seq */ + 2 /* origin */ + 2 /* node */ + 1 /* hops */ + 1 /* relay_hops */ + 4 /* hold_us */ + 4 /* dispatch_us */)
+
+/** Probers whose last probe is remembered, to relay and answer it once. */
+#define PROBE_ORIGINS               (4)
+/** Replies remembered, to relay each of them once. */
+#define PROBE_REPLIES_SEEN          (8)
+/** Probes a prober takes replies for, the older ones count as lost. */
+#define PROBE_IN_FLIGHT             (4)
+/** Replies to probes for all nodes are spread over this time, so they
+  don't all go out at once. */
+#define PROBE_REPLY_SPREAD_US       (100000)
+
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle;     /**< Always MESH_PROBE_HANDLE. */
+    uint8_t                 kind;       /**< PROBE_KIND_REQUEST or PROBE_KIND_REPLY. */
+    uint8_t                 seq;        /**< Sequence number of the prober's probes. */
+    uint16_t                origin;     /**< Short address of the prober. */
+    uint16_t                node;       /**< Request: the node to reply, or RBC_MESH_PROBE_TARGET_ALL. Reply: the responder. */
+    uint8_t                 hops;       /**< Request: hop count of the sender. Reply: hop count of the responder. */
+    uint8_t                 relay_hops; /**< Reply: hop count the next relay must have gotten the request with. */
+    uint32_t                hold_us;    /**< Reply: time from receiving the request to sending the reply. */
+    uint32_t                dispatch_us;/**< Reply: hold_us, not counting the reply spread. */
+} __packed_gcc probe_adv_data_t;
+
+typedef struct
+{
+    uint16_t    origin;
+    uint8_t     seq;
+    uint8_t     hops;       /**< Hop count the request was gotten with, 0 for unused entries. */
+} origin_t;
+
+typedef struct
+{
+    uint16_t    origin;
+    uint16_t    node;
+    uint8_t     seq;
+} reply_seen_t;
+
+typedef struct
+{
+    bool        pending;
+    uint16_t    origin;
+    uint8_t     seq;
+    uint8_t     hops;
+    timestamp_t rx_time;
+    timestamp_t spread;
+} reply_t;
+
+#if RBC_MESH_PROBE_NODES > 0
+typedef struct
+{
+    rbc_mesh_probe_stats_t stats;
+    uint32_t    rtt_sum_us;
+    uint32_t    dispatch_sum_us;
+    uint8_t     last_seq;   /**< Sequence number of the last reply, to count copies once. */
+} node_entry_t;
+
+typedef struct
+{
+    uint8_t     seq;
+    bool        valid;
+    timestamp_t time;
+} in_flight_t;
+#endif
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static origin_t         m_origins[PROBE_ORIGINS];
+static uint8_t          m_origin_next;
+static reply_seen_t     m_replies_seen[PROBE_REPLIES_SEEN];
+static uint8_t          m_reply_seen_next;
+static reply_t          m_reply;
+static timer_event_t    m_reply_timer_evt;
+static uint16_t         m_local_id;
+static bool             m_local_id_valid;
+
+#if RBC_MESH_PROBE_NODES > 0
+static node_entry_t     m_nodes[RBC_MESH_PROBE_NODES];
+static uint8_t          m_node_count;
+static in_flight_t      m_in_flight[PROBE_IN_FLIGHT];
+static uint8_t          m_in_flight_next;
+static uint16_t         m_target;
+static uint8_t          m_seq;
+static timer_event_t    m_probe_timer_evt;
+#endif
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint16_t short_addr_get(const uint8_t* p_addr)
+{
+    return (p_addr[0] | (p_addr[1] << 8));
+}
+
+static bool local_id_get(uint16_t* p_id)
+{
+    if (!m_local_id_valid)
+    {
+        mesh_packet_t packet;
+        if (mesh_packet_set_local_addr(&packet) != NRF_SUCCESS)
+        {
+            return false;
+        }
+        m_local_id = short_addr_get(packet.addr);
+        m_local_id_valid = true;
+    }
+    *p_id = m_local_id;
+    return true;
+}
+
+static mesh_packet_t* probe_packet_get(uint8_t kind, uint8_t seq, uint16_t origin, uint16_t node, uint8_t hops)
+{
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return NULL;
+    }
+
+    probe_adv_data_t* p_adv = (probe_adv_data_t*) &p_packet->payload[0];
+    (void) mesh_packet_set_local_addr(p_packet);
+    p_packet->header.length = MESH_PACKET_BLE_OVERHEAD + 1 + PROBE_ADV_LEN;
+    p_packet->header.type = BLE_PACKET_TYPE_ADV_NONCONN_IND;
+
+    memset(p_adv, 0, sizeof(probe_adv_data_t));
+    p_adv->adv_data_length = PROBE_ADV_LEN;
+    p_adv->adv_data_type = MESH_ADV_DATA_TYPE;
+    p_adv->mesh_uuid = MESH_UUID;
+    p_adv->handle = MESH_PROBE_HANDLE;
+    p_adv->kind = kind;
+    p_adv->seq = seq;
+    p_adv->origin = origin;
+    p_adv->node = node;
+    p_adv->hops = hops;
+    return p_packet;
+}
+
+static void probe_packet_send(mesh_packet_t* p_packet)
+{
+    (void) tc_tx(p_packet, vh_tx_config_get());
+    mesh_packet_ref_count_dec(p_packet);
+}
+
+/** Find the record of a prober's last request, NULL if there's none. */
+static origin_t* origin_get(uint16_t origin)
+{
+    for (uint32_t i = 0; i < PROBE_ORIGINS; ++i)
+    {
+        if (m_origins[i].hops != 0 && m_origins[i].origin == origin)
+        {
+            return &m_origins[i];
+        }
+    }
+    return NULL;
+}
+
+/** Record a reply, and tell whether it had been seen before. */
+static bool reply_is_repeat(uint16_t origin, uint16_t node, uint8_t seq)
+{
+    for (uint32_t i = 0; i < PROBE_REPLIES_SEEN; ++i)
+    {
+        if (m_replies_seen[i].origin == origin &&
+            m_replies_seen[i].node == node &&
+            m_replies_seen[i].seq == seq)
+        {
+            return true;
+        }
+    }
+    m_replies_seen[m_reply_seen_next].origin = origin;
+    m_replies_seen[m_reply_seen_next].node = node;
+    m_replies_seen[m_reply_seen_next].seq = seq;
+    m_reply_seen_next = (m_reply_seen_next + 1) % PROBE_REPLIES_SEEN;
+    return false;
+}
+
+static void reply_timeout(timestamp_t timestamp, void* p_context)
+{
+    uint16_t local_id;
+    event_handler_critical_section_begin();
+    reply_t reply = m_reply;
+    m_reply.pending = false;
+    event_handler_critical_section_end();
+
+    if (!reply.pending || !local_id_get(&local_id))
+    {
+        return;
+    }
+
+    mesh_packet_t* p_packet = probe_packet_get(PROBE_KIND_REPLY, reply.seq, reply.origin, local_id, reply.hops);
+    if (p_packet != NULL)
+    {
+        probe_adv_data_t* p_adv = (probe_adv_data_t*) &p_packet->payload[0];
+        p_adv->relay_hops = reply.hops - 1;
+        p_adv->hold_us = timer_now() - reply.rx_time;
+        p_adv->dispatch_us = (p_adv->hold_us > reply.spread ? p_adv->hold_us - reply.spread : 0);
+        (void) reply_is_repeat(reply.origin, local_id, reply.seq);
+        probe_packet_send(p_packet);
+    }
+}
+
+static void request_rx(const probe_adv_data_t* p_adv, timestamp_t timestamp)
+{
+    uint16_t local_id;
+    if (!local_id_get(&local_id) ||
+        p_adv->origin == local_id ||
+        p_adv->hops >= RBC_MESH_PROBE_HOPS_MAX)
+    {
+        return;
+    }
+
+    event_handler_critical_section_begin();
+    origin_t* p_origin = origin_get(p_adv->origin);
+    if (p_origin != NULL && p_origin->seq == p_adv->seq)
+    {
+        /* a copy from another channel or relay */
+        event_handler_critical_section_end();
+        return;
+    }
+    if (p_origin == NULL)
+    {
+        p_origin = &m_origins[m_origin_next];
+        m_origin_next = (m_origin_next + 1) % PROBE_ORIGINS;
+        p_origin->origin = p_adv->origin;
+    }
+    p_origin->seq = p_adv->seq;
+    p_origin->hops = p_adv->hops + 1;
+
+    bool reply = (p_adv->node == local_id || p_adv->node == RBC_MESH_PROBE_TARGET_ALL);
+    timestamp_t spread = 0;
+    if (reply)
+    {
+        /* a newer probe replaces a reply that hasn't gone out yet */
+        m_reply.pending = true;
+        m_reply.origin = p_adv->origin;
+        m_reply.seq = p_adv->seq;
+        m_reply.hops = p_origin->hops;
+        m_reply.rx_time = timestamp;
+        if (p_adv->node == RBC_MESH_PROBE_TARGET_ALL)
+        {
+            spread = rand_range(PROBE_REPLY_SPREAD_US);
+        }
+        m_reply.spread = spread;
+    }
+    event_handler_critical_section_end();
+
+    if (reply)
+    {
+        (void) timer_sch_reschedule(&m_reply_timer_evt, timestamp + spread);
+    }
+
+    /* a probe for this node alone needs no relay, unless its reply does */
+    if (p_adv->node != local_id && p_adv->hops + 1 < RBC_MESH_PROBE_HOPS_MAX)
+    {
+        mesh_packet_t* p_packet = probe_packet_get(PROBE_KIND_REQUEST, p_adv->seq, p_adv->origin, p_adv->node, p_adv->hops + 1);
+        if (p_packet != NULL)
+        {
+            probe_packet_send(p_packet);
+        }
+    }
+}
+
+#if RBC_MESH_PROBE_NODES > 0
+static node_entry_t* node_get(uint16_t node, bool create)
+{
+    for (uint32_t i = 0; i < m_node_count; ++i)
+    {
+        if (m_nodes[i].stats.node == node)
+        {
+            return &m_nodes[i];
+        }
+    }
+    if (!create || m_node_count == RBC_MESH_PROBE_NODES)
+    {
+        /* keep the nodes already measured, a reset makes room */
+        return NULL;
+    }
+    node_entry_t* p_entry = &m_nodes[m_node_count++];
+    memset(p_entry, 0, sizeof(node_entry_t));
+    p_entry->stats.node = node;
+    p_entry->stats.rtt_min_us = UINT32_MAX;
+    p_entry->last_seq = m_seq - 1;
+    return p_entry;
+}
+
+static void probe_timeout(timestamp_t timestamp, void* p_context)
+{
+    uint16_t local_id;
+    if (!local_id_get(&local_id))
+    {
+        return;
+    }
+
+    event_handler_critical_section_begin();
+    uint8_t seq = m_seq++;
+    uint16_t target = m_target;
+    m_in_flight[m_in_flight_next].seq = seq;
+    m_in_flight[m_in_flight_next].time = timestamp;
+    m_in_flight[m_in_flight_next].valid = true;
+    m_in_flight_next = (m_in_flight_next + 1) % PROBE_IN_FLIGHT;
+    if (target == RBC_MESH_PROBE_TARGET_ALL)
+    {
+        for (uint32_t i = 0; i < m_node_count; ++i)
+        {
+            m_nodes[i].stats.sent++;
+        }
+    }
+    else
+    {
+        node_entry_t* p_entry = node_get(target, true);
+        if (p_entry != NULL)
+        {
+            p_entry->stats.sent++;
+        }
+    }
+    event_handler_critical_section_end();
+
+    mesh_packet_t* p_packet = probe_packet_get(PROBE_KIND_REQUEST, seq, local_id, target, 0);
+    if (p_packet != NULL)
+    {
+        probe_packet_send(p_packet);
+    }
+}
+
+static void reply_record(const probe_adv_data_t* p_adv, timestamp_t timestamp)
+{
+    event_handler_critical_section_begin();
+    in_flight_t* p_probe = NULL;
+    for (uint32_t i = 0; i < PROBE_IN_FLIGHT; ++i)
+    {
+        if (m_in_flight[i].valid && m_in_flight[i].seq == p_adv->seq)
+        {
+            p_probe = &m_in_flight[i];
+            break;
+        }
+    }
+
+    node_entry_t* p_entry = node_get(p_adv->node, (p_probe != NULL));
+    if (p_probe == NULL || p_entry == NULL || p_entry->last_seq == p_adv->seq)
+    {
+        event_handler_critical_section_end();
+        return;
+    }
+    p_entry->last_seq = p_adv->seq;
+
+    /* the time the responder held the probe isn't the mesh's */
+    uint32_t rtt = timestamp - p_probe->time;
+    rtt = (rtt > p_adv->hold_us ? rtt - p_adv->hold_us : 0);
+
+    rbc_mesh_probe_stats_t* p_stats = &p_entry->stats;
+    if (p_stats->sent == 0)
+    {
+        /* first heard in a probe for all nodes */
+        p_stats->sent = 1;
+    }
+    p_stats->received++;
+    p_stats->hops = p_adv->hops;
+    if (rtt < p_stats->rtt_min_us)
+    {
+        p_stats->rtt_min_us = rtt;
+    }
+    if (rtt > p_stats->rtt_max_us)
+    {
+        p_stats->rtt_max_us = rtt;
+    }
+    if (p_adv->dispatch_us > p_stats->dispatch_max_us)
+    {
+        p_stats->dispatch_max_us = p_adv->dispatch_us;
+    }
+    p_entry->rtt_sum_us += rtt;
+    p_entry->dispatch_sum_us += p_adv->dispatch_us;
+
+    uint32_t bucket = 0;
+    for (uint32_t limit = 4000; rtt >= limit && bucket < RBC_MESH_PROBE_HIST_BUCKETS - 1; limit <<= 1)
+    {
+        bucket++;
+    }
+    p_stats->histogram[bucket]++;
+    event_handler_critical_section_end();
+}
+#endif
+
+static void reply_rx(const probe_adv_data_t* p_adv, timestamp_t timestamp)
+{
+    uint16_t local_id;
+    if (!local_id_get(&local_id))
+    {
+        return;
+    }
+
+    if (p_adv->origin == local_id)
+    {
+#if RBC_MESH_PROBE_NODES > 0
+        reply_record(p_adv, timestamp);
+#endif
+        return;
+    }
+
+    /* relay toward the prober, if this node got the request one hop closer to it */
+    event_handler_critical_section_begin();
+    origin_t* p_origin = origin_get(p_adv->origin);
+    bool relay = (p_adv->relay_hops > 0 &&
+                  p_origin != NULL &&
+                  p_origin->seq == p_adv->seq &&
+                  p_origin->hops == p_adv->relay_hops &&
+                  !reply_is_repeat(p_adv->origin, p_adv->node, p_adv->seq));
+    event_handler_critical_section_end();
+
+    if (relay)
+    {
+        mesh_packet_t* p_packet = probe_packet_get(PROBE_KIND_REPLY, p_adv->seq, p_adv->origin, p_adv->node, p_adv->hops);
+        if (p_packet != NULL)
+        {
+            probe_adv_data_t* p_relay = (probe_adv_data_t*) &p_packet->payload[0];
+            p_relay->relay_hops = p_adv->relay_hops - 1;
+            p_relay->hold_us = p_adv->hold_us;
+            p_relay->dispatch_us = p_adv->dispatch_us;
+            probe_packet_send(p_packet);
+        }
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_probe_init(void)
+{
+    memset(m_origins, 0, sizeof(m_origins));
+    memset(m_replies_seen, 0, sizeof(m_replies_seen));
+    memset(&m_reply, 0, sizeof(m_reply));
+    m_origin_next = 0;
+    m_reply_seen_next = 0;
+    m_local_id_valid = false;
+
+    m_reply_timer_evt.cb = reply_timeout;
+    m_reply_timer_evt.interval = 0;
+    m_reply_timer_evt.p_context = NULL;
+    m_reply_timer_evt.p_next = NULL;
+
+#if RBC_MESH_PROBE_NODES > 0
+    memset(m_nodes, 0, sizeof(m_nodes));
+    memset(m_in_flight, 0, sizeof(m_in_flight));
+    m_node_count = 0;
+    m_in_flight_next = 0;
+    m_seq = 0;
+    m_probe_timer_evt.cb = probe_timeout;
+    m_probe_timer_evt.interval = 0;
+    m_probe_timer_evt.p_context = NULL;
+    m_probe_timer_evt.p_next = NULL;
+#endif
+}
+
+#if RBC_MESH_PROBE_NODES > 0
+uint32_t mesh_probe_start(uint16_t target, timestamp_t interval_us)
+{
+    (void) timer_sch_abort(&m_probe_timer_evt);
+    event_handler_critical_section_begin();
+    m_target = target;
+    event_handler_critical_section_end();
+    m_probe_timer_evt.interval = interval_us;
+    return timer_sch_reschedule(&m_probe_timer_evt, timer_now() + interval_us);
+}
+
+uint32_t mesh_probe_stop(void)
+{
+    (void) timer_sch_abort(&m_probe_timer_evt);
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_probe_stats_get(uint8_t index, rbc_mesh_probe_stats_t* p_stats)
+{
+    event_handler_critical_section_begin();
+    if (index >= m_node_count)
+    {
+        event_handler_critical_section_end();
+        return NRF_ERROR_NOT_FOUND;
+    }
+    node_entry_t* p_entry = &m_nodes[index];
+    memcpy(p_stats, &p_entry->stats, sizeof(rbc_mesh_probe_stats_t));
+    if (p_stats->received > 0)
+    {
+        p_stats->rtt_avg_us = p_entry->rtt_sum_us / p_stats->received;
+        p_stats->dispatch_avg_us = p_entry->dispatch_sum_us / p_stats->received;
+    }
+    else
+    {
+        p_stats->rtt_min_us = 0;
+    }
+    event_handler_critical_section_end();
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_probe_reset(void)
+{
+    event_handler_critical_section_begin();
+    m_node_count = 0;
+    event_handler_critical_section_end();
+    return NRF_SUCCESS;
+}
+#else
+uint32_t mesh_probe_start(uint16_t target, timestamp_t interval_us)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_probe_stop(void)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_probe_stats_get(uint8_t index, rbc_mesh_probe_stats_t* p_stats)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_probe_reset(void)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+#endif
+
+void mesh_probe_rx(mesh_packet_t* p_packet, timestamp_t timestamp)
+{
+    probe_adv_data_t* p_adv = (probe_adv_data_t*) mesh_packet_adv_data_get(p_packet);
+    if (p_adv == NULL || p_adv->adv_data_length < PROBE_ADV_LEN)
+    {
+        return;
+    }
+
+    if (p_adv->kind == PROBE_KIND_REQUEST)
+    {
+        request_rx(p_adv, timestamp);
+    }
+    else if (p_adv->kind == PROBE_KIND_REPLY)
+    {
+        reply_rx(p_adv, timestamp);
+    }
+}
+
+#else
+
+void mesh_probe_init(void)
+{
+}
+
+uint32_t mesh_probe_start(uint16_t target, timestamp_t interval_us)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_probe_stop(void)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_probe_stats_get(uint8_t index, rbc_mesh_probe_stats_t* p_stats)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_probe_reset(void)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+void mesh_probe_rx(mesh_packet_t* p_packet, timestamp_t timestamp)
+{
+    /* not taking part in the probes */
+}
+
+#endif /* RBC_MESH_PROBE */
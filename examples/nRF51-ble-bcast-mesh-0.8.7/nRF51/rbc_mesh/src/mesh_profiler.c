@@ -0,0 +1,224 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_profiler.h"
+
+#ifdef MESH_PROFILER
+
+#include <stdbool.h>
+#include <string.h>
+#include "nrf.h"
+#include "SEGGER_RTT.h"
+
+#if (MESH_PROFILER_SLOTS & (MESH_PROFILER_SLOTS - 1))
+#error "MESH_PROFILER_SLOTS must be a power of two"
+#endif
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+/** Slots tried for a location before it's counted as other. */
+#define PROBE_LIMIT         (8)
+/** Timer ticks per second, with prescaler 4. */
+#define TIMER_FREQUENCY     (1000000)
+/** Index of the return address in the exception stack frame. */
+#define FRAME_PC_INDEX      (6)
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static uint32_t m_locations[MESH_PROFILER_SLOTS]; /* 0 for an empty slot */
+static uint16_t m_counts[MESH_PROFILER_SLOTS];
+static uint32_t m_samples;
+static uint32_t m_other;        /* samples that didn't fit in the table */
+static uint32_t m_interval;     /* average timer ticks between samples */
+static uint32_t m_jitter_mask;  /* largest power of two - 1 up to half the interval */
+static uint32_t m_lfsr = 0xACE1;
+
+/* Called from the interrupt handler below, with the stack frame of the interrupted code. */
+void mesh_profiler_sample(const uint32_t* p_frame);
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void count_halve(void)
+{
+    for (uint32_t i = 0; i < MESH_PROFILER_SLOTS; ++i)
+    {
+        m_counts[i] >>= 1;
+    }
+}
+
+static uint32_t jitter_get(void)
+{
+    /* Galois LFSR, enough to break up the beat with periodic work */
+    m_lfsr = (m_lfsr >> 1) ^ (-(m_lfsr & 1) & 0xB400);
+    return m_lfsr & m_jitter_mask;
+}
+
+static void counts_clear(void)
+{
+    memset(m_locations, 0, sizeof(m_locations));
+    memset(m_counts, 0, sizeof(m_counts));
+    m_samples = 0;
+    m_other = 0;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+#if defined(__GNUC__)
+void MESH_PROFILER_TIMER_IRQHandler(void) __attribute__((naked));
+void MESH_PROFILER_TIMER_IRQHandler(void)
+{
+    /* find the stack the interrupted code used, from EXC_RETURN */
+    __asm volatile(
+        "   movs r0, #4                     \n"
+        "   mov r1, lr                      \n"
+        "   tst r0, r1                      \n"
+        "   beq 1f                          \n"
+        "   mrs r0, psp                     \n"
+        "   b 2f                            \n"
+        "1: mrs r0, msp                     \n"
+        "2: ldr r1, =mesh_profiler_sample   \n"
+        "   bx r1                           \n"
+        "   .align 2                        \n"
+        "   .ltorg                          \n"
+    );
+}
+#elif defined(__CC_ARM)
+__asm void MESH_PROFILER_TIMER_IRQHandler(void)
+{
+    IMPORT mesh_profiler_sample
+    MOVS r0, #4
+    MOV r1, lr
+    TST r0, r1
+    BEQ use_msp
+    MRS r0, PSP
+    B sample
+use_msp
+    MRS r0, MSP
+sample
+    LDR r1, =mesh_profiler_sample
+    BX r1
+    ALIGN
+}
+#else
+#error "Unsupported toolchain."
+#endif
+
+void mesh_profiler_sample(const uint32_t* p_frame)
+{
+    MESH_PROFILER_TIMER->EVENTS_COMPARE[0] = 0;
+    MESH_PROFILER_TIMER->CC[0] = m_interval - (m_jitter_mask + 1) / 2 + jitter_get();
+
+    uint32_t location = p_frame[FRAME_PC_INDEX] >> MESH_PROFILER_PC_SHIFT;
+    uint32_t slot = location;
+    m_samples++;
+    for (uint32_t i = 0; i < PROBE_LIMIT; ++i, ++slot)
+    {
+        slot &= (MESH_PROFILER_SLOTS - 1);
+        if (m_locations[slot] == 0)
+        {
+            m_locations[slot] = location;
+        }
+        if (m_locations[slot] == location)
+        {
+            if (++m_counts[slot] == UINT16_MAX)
+            {
+                /* keep the ratios, and room to count */
+                count_halve();
+            }
+            return;
+        }
+    }
+    m_other++;
+}
+
+void mesh_profiler_start(uint32_t rate_hz)
+{
+    if (rate_hz == 0 || rate_hz > 10000)
+    {
+        return;
+    }
+    mesh_profiler_stop();
+    counts_clear();
+    m_interval = TIMER_FREQUENCY / rate_hz;
+    m_jitter_mask = 0;
+    while (m_jitter_mask * 2 + 1 <= m_interval / 2)
+    {
+        m_jitter_mask = m_jitter_mask * 2 + 1;
+    }
+
+    MESH_PROFILER_TIMER->MODE = TIMER_MODE_MODE_Timer;
+    MESH_PROFILER_TIMER->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+    MESH_PROFILER_TIMER->PRESCALER = 4;
+    MESH_PROFILER_TIMER->SHORTS = TIMER_SHORTS_COMPARE0_CLEAR_Msk;
+    MESH_PROFILER_TIMER->CC[0] = m_interval;
+    MESH_PROFILER_TIMER->EVENTS_COMPARE[0] = 0;
+    MESH_PROFILER_TIMER->INTENSET = TIMER_INTENSET_COMPARE0_Msk;
+    NVIC_SetPriority(MESH_PROFILER_TIMER_IRQn, MESH_PROFILER_IRQ_PRIORITY);
+    NVIC_ClearPendingIRQ(MESH_PROFILER_TIMER_IRQn);
+    NVIC_EnableIRQ(MESH_PROFILER_TIMER_IRQn);
+    MESH_PROFILER_TIMER->TASKS_CLEAR = 1;
+    MESH_PROFILER_TIMER->TASKS_START = 1;
+}
+
+void mesh_profiler_stop(void)
+{
+    MESH_PROFILER_TIMER->TASKS_STOP = 1;
+    MESH_PROFILER_TIMER->INTENCLR = 0xFFFFFFFF;
+    NVIC_DisableIRQ(MESH_PROFILER_TIMER_IRQn);
+}
+
+void mesh_profiler_dump(void)
+{
+    /* pause rather than copy the table, RAM is scarcer than samples */
+    bool was_enabled = (MESH_PROFILER_TIMER->INTENSET & TIMER_INTENSET_COMPARE0_Msk);
+    NVIC_DisableIRQ(MESH_PROFILER_TIMER_IRQn);
+
+    SEGGER_RTT_printf(0, "PROFILE samples %u other %u interval_us %u shift %u\n",
+            m_samples, m_other, m_interval, MESH_PROFILER_PC_SHIFT);
+    for (uint32_t i = 0; i < MESH_PROFILER_SLOTS; ++i)
+    {
+        if (m_counts[i] != 0)
+        {
+            SEGGER_RTT_printf(0, "%x %u\n", m_locations[i] << MESH_PROFILER_PC_SHIFT, m_counts[i]);
+        }
+    }
+    SEGGER_RTT_printf(0, "PROFILE end\n");
+    counts_clear();
+
+    if (was_enabled)
+    {
+        NVIC_EnableIRQ(MESH_PROFILER_TIMER_IRQn);
+    }
+}
+
+#endif /* MESH_PROFILER */
@@ -0,0 +1,529 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_report.h"
+
+#include <string.h>
+#include "transport_control.h"
+#include "version_handler.h"
+#include "event_handler.h"
+#include "timer_scheduler.h"
+#include "rand.h"
+#include "toolchain.h"
+#include "nrf_error.h"
+
+#if RBC_MESH_REPORT_ZONES > 0
+
+/* event push isn't present in the API header file. */
+extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt);
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define REPORT_INTERVAL_US          (RBC_MESH_REPORT_INTERVAL_MS * 1000)
+#define GRADIENT_TIMEOUT_US         (RBC_MESH_REPORT_GRADIENT_TIMEOUT_MS * 1000)
+#define HOPS_NONE                   (0xFF)
+/** Hop counts at or above this are treated as no gradient, to end loops
+  left behind by a lost gateway. */
+#define HOPS_MAX                    (32)
+/** How much stronger, in dB, a neighbour with the parent's hop count must
+  be heard to replace it. Keeps the parent from flapping between equals. */
+#define PARENT_RSSI_MARGIN          (6)
+
+#define REPORT_ADV_OVERHEAD         (1 /* adv_type */ + 2 /* UUID */ + 2 /* handle */ + 1 /* hops */ + 2 /* parent */ + 1 /* seq */)
+#define REPORT_RECORD_LEN           (1 /* zone */ + 1 /* count */ + 2 /* min */ + 2 /* max */ + 4 /* sum */)
+#define REPORT_RECORDS_MAX          ((BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH - 1 - REPORT_ADV_OVERHEAD) / REPORT_RECORD_LEN)
+
+typedef __packed_armcc struct
+{
+    uint8_t     zone;
+    uint8_t     count;
+    int16_t     min;
+    int16_t     max;
+    int32_t     sum;
+} __packed_gcc report_record_t;
+
+/** A report packet without records is a gradient beacon. */
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle;     /**< Always MESH_REPORT_HANDLE. */
+    uint8_t                 hops;       /**< Sender's hop count to the closest gateway. */
+    uint16_t                parent;     /**< Short address of the node the records are for. */
+    uint8_t                 seq;        /**< Sequence number of the sender's reports. */
+    report_record_t         records[REPORT_RECORDS_MAX];
+} __packed_gcc report_adv_data_t;
+
+typedef struct
+{
+    uint16_t    count;      /**< 0 for unused entries. */
+    uint8_t     zone;
+    int16_t     min;
+    int16_t     max;
+    int32_t     sum;
+} zone_entry_t;
+
+typedef struct
+{
+    ble_gap_addr_t  addr;
+    uint8_t         hops;
+    uint8_t         rssi;
+    timestamp_t     last_heard;
+} parent_t;
+
+typedef struct
+{
+    uint16_t    id;
+    uint8_t     seq;            /**< Highest sequence number heard. */
+    timestamp_t last_heard;
+} child_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static zone_entry_t     m_zones[RBC_MESH_REPORT_ZONES];
+static parent_t         m_parent;
+static bool             m_has_parent;
+static bool             m_gateway;
+static child_t          m_children[RBC_MESH_REPORT_CHILDREN];
+static uint8_t          m_child_next;
+static uint16_t         m_local_id;         /** Short address of this node, known after its first report. */
+static bool             m_local_id_valid;
+static uint8_t          m_seq;
+static timer_event_t    m_timer_evt;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint16_t short_addr_get(const uint8_t* p_addr)
+{
+    return (p_addr[0] | (p_addr[1] << 8));
+}
+
+/** Merge a partial report into the table. Must be called in a critical section. */
+static uint32_t zone_merge(uint8_t zone, uint16_t count, int16_t min, int16_t max, int32_t sum)
+{
+    zone_entry_t* p_entry = NULL;
+    for (uint32_t i = 0; i < RBC_MESH_REPORT_ZONES; ++i)
+    {
+        if (m_zones[i].count > 0 && m_zones[i].zone == zone)
+        {
+            p_entry = &m_zones[i];
+            break;
+        }
+        if (p_entry == NULL && m_zones[i].count == 0)
+        {
+            p_entry = &m_zones[i]; /* keep looking for an existing one */
+        }
+    }
+
+    if (p_entry == NULL ||
+        (uint32_t) p_entry->count + count > UINT16_MAX)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    if (p_entry->count == 0)
+    {
+        p_entry->zone = zone;
+        p_entry->min = min;
+        p_entry->max = max;
+        p_entry->sum = 0;
+    }
+    p_entry->count += count;
+    p_entry->sum += sum;
+    if (min < p_entry->min)
+    {
+        p_entry->min = min;
+    }
+    if (max > p_entry->max)
+    {
+        p_entry->max = max;
+    }
+    return NRF_SUCCESS;
+}
+
+/** Hop count of this node, HOPS_NONE without a gradient. */
+static uint8_t hops_current(timestamp_t time_now)
+{
+    if (m_gateway)
+    {
+        return 0;
+    }
+    if (m_has_parent && TIMER_DIFF(time_now, m_parent.last_heard) >= GRADIENT_TIMEOUT_US)
+    {
+        m_has_parent = false;
+    }
+    return (m_has_parent ? m_parent.hops + 1 : HOPS_NONE);
+}
+
+static void gradient_update(const mesh_packet_t* p_packet, uint8_t hops, timestamp_t timestamp, uint8_t rssi)
+{
+    if (m_gateway)
+    {
+        return;
+    }
+
+    bool from_parent = (m_has_parent &&
+                        m_parent.addr.addr_type == p_packet->header.addr_type &&
+                        memcmp(m_parent.addr.addr, p_packet->addr, BLE_GAP_ADDR_LEN) == 0);
+    if (hops >= HOPS_MAX)
+    {
+        if (from_parent)
+        {
+            m_has_parent = false; /* the parent has lost its way too */
+        }
+        return;
+    }
+
+    if (!from_parent &&
+        hops_current(timestamp) != HOPS_NONE &&
+        hops > m_parent.hops)
+    {
+        return;
+    }
+    if (!from_parent &&
+        m_has_parent &&
+        hops == m_parent.hops &&
+        rssi + PARENT_RSSI_MARGIN >= m_parent.rssi)
+    {
+        return;
+    }
+
+    memcpy(m_parent.addr.addr, p_packet->addr, BLE_GAP_ADDR_LEN);
+    m_parent.addr.addr_type = p_packet->header.addr_type;
+    m_parent.hops = hops;
+    m_parent.rssi = rssi;
+    m_parent.last_heard = timestamp;
+    m_has_parent = true;
+}
+
+/** Whether the report has already been merged, from another channel. A
+  child's reports of one interval are sent within moments of each other, so
+  an old sequence number heard long after is from a restarted child. */
+static bool report_is_repeat(uint16_t id, uint8_t seq, timestamp_t timestamp)
+{
+    child_t* p_child = NULL;
+    for (uint32_t i = 0; i < RBC_MESH_REPORT_CHILDREN; ++i)
+    {
+        if (m_children[i].id == id)
+        {
+            p_child = &m_children[i];
+            break;
+        }
+    }
+
+    if (p_child == NULL)
+    {
+        p_child = &m_children[m_child_next];
+        m_child_next = (m_child_next + 1) % RBC_MESH_REPORT_CHILDREN;
+        p_child->id = id;
+    }
+    else if ((int8_t) (seq - p_child->seq) <= 0 &&
+             TIMER_DIFF(timestamp, p_child->last_heard) < REPORT_INTERVAL_US / 2)
+    {
+        return true;
+    }
+
+    p_child->seq = seq;
+    p_child->last_heard = timestamp;
+    return false;
+}
+
+static mesh_packet_t* report_packet_get(uint8_t hops, uint16_t parent)
+{
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return NULL;
+    }
+
+    report_adv_data_t* p_adv = (report_adv_data_t*) &p_packet->payload[0];
+    (void) mesh_packet_set_local_addr(p_packet);
+    p_packet->header.length = MESH_PACKET_BLE_OVERHEAD + 1 + REPORT_ADV_OVERHEAD;
+    p_packet->header.type = BLE_PACKET_TYPE_ADV_NONCONN_IND;
+
+    p_adv->adv_data_length = REPORT_ADV_OVERHEAD;
+    p_adv->adv_data_type = MESH_ADV_DATA_TYPE;
+    p_adv->mesh_uuid = MESH_UUID;
+    p_adv->handle = MESH_REPORT_HANDLE;
+    p_adv->hops = hops;
+    p_adv->parent = parent;
+    p_adv->seq = m_seq++;
+
+    m_local_id = short_addr_get(p_packet->addr);
+    m_local_id_valid = true;
+    return p_packet;
+}
+
+static void report_packet_send(mesh_packet_t* p_packet)
+{
+    (void) tc_tx(p_packet, vh_tx_config_get());
+    mesh_packet_ref_count_dec(p_packet);
+}
+
+/** Send the zones to the parent, split into as many records and packets as
+  they need. Zones that don't get a packet are put back in the table. */
+static void reports_send(zone_entry_t* p_zones, uint8_t hops)
+{
+    uint16_t parent = short_addr_get(m_parent.addr.addr);
+    mesh_packet_t* p_packet = NULL;
+    bool sent = false;
+
+    for (uint32_t i = 0; i < RBC_MESH_REPORT_ZONES; ++i)
+    {
+        zone_entry_t* p_zone = &p_zones[i];
+        while (p_zone->count > 0)
+        {
+            if (p_packet == NULL)
+            {
+                p_packet = report_packet_get(hops, parent);
+                if (p_packet == NULL)
+                {
+                    event_handler_critical_section_begin();
+                    for (; i < RBC_MESH_REPORT_ZONES; ++i)
+                    {
+                        if (p_zones[i].count > 0)
+                        {
+                            (void) zone_merge(p_zones[i].zone, p_zones[i].count, p_zones[i].min, p_zones[i].max, p_zones[i].sum);
+                        }
+                    }
+                    event_handler_critical_section_end();
+                    return;
+                }
+            }
+
+            /* min and max hold for every part of a zone, and the sum is
+               split by count, so the parent merges the parts back exactly */
+            report_adv_data_t* p_adv = (report_adv_data_t*) &p_packet->payload[0];
+            report_record_t* p_record = &p_adv->records[(p_adv->adv_data_length - REPORT_ADV_OVERHEAD) / REPORT_RECORD_LEN];
+            uint8_t count = (p_zone->count > UINT8_MAX) ? UINT8_MAX : p_zone->count;
+            int32_t sum = (int32_t) (((int64_t) p_zone->sum * count) / p_zone->count);
+            p_record->zone = p_zone->zone;
+            p_record->count = count;
+            p_record->min = p_zone->min;
+            p_record->max = p_zone->max;
+            p_record->sum = sum;
+            p_zone->count -= count;
+            p_zone->sum -= sum;
+
+            p_adv->adv_data_length += REPORT_RECORD_LEN;
+            p_packet->header.length += REPORT_RECORD_LEN;
+            if (p_adv->adv_data_length == REPORT_ADV_OVERHEAD + REPORT_RECORDS_MAX * REPORT_RECORD_LEN)
+            {
+                report_packet_send(p_packet);
+                p_packet = NULL;
+                sent = true;
+            }
+        }
+    }
+
+    if (p_packet == NULL && !sent)
+    {
+        /* nothing to report, send a beacon to keep the gradient up */
+        p_packet = report_packet_get(hops, 0);
+    }
+    if (p_packet != NULL)
+    {
+        report_packet_send(p_packet);
+    }
+}
+
+/** Hand the zones to the application, on gateways. */
+static void reports_deliver(const zone_entry_t* p_zones)
+{
+    rbc_mesh_event_t evt;
+    evt.type = RBC_MESH_EVENT_TYPE_REPORT;
+    for (uint32_t i = 0; i < RBC_MESH_REPORT_ZONES; ++i)
+    {
+        if (p_zones[i].count > 0)
+        {
+            evt.params.report.zone = p_zones[i].zone;
+            evt.params.report.count = p_zones[i].count;
+            evt.params.report.min = p_zones[i].min;
+            evt.params.report.max = p_zones[i].max;
+            evt.params.report.sum = p_zones[i].sum;
+            (void) rbc_mesh_event_push(&evt); /* counted as a queue drop if it fails */
+        }
+    }
+}
+
+/** Order the timer within [REPORT_INTERVAL_US / 2, 3 * REPORT_INTERVAL_US / 2)
+  from now, so neighbours don't all send at once. */
+static void timer_order(timestamp_t time_now)
+{
+    timestamp_t delay = REPORT_INTERVAL_US / 2 + rand_range(REPORT_INTERVAL_US);
+    (void) timer_sch_reschedule(&m_timer_evt, time_now + delay);
+}
+
+static void report_timeout(timestamp_t timestamp, void* p_context)
+{
+    zone_entry_t zones[RBC_MESH_REPORT_ZONES];
+
+    event_handler_critical_section_begin();
+    uint8_t hops = hops_current(timestamp);
+    if (hops != HOPS_NONE)
+    {
+        memcpy(zones, m_zones, sizeof(zones));
+        memset(m_zones, 0, sizeof(m_zones));
+    }
+    event_handler_critical_section_end();
+
+    if (hops == 0)
+    {
+        reports_deliver(zones);
+        mesh_packet_t* p_packet = report_packet_get(0, 0);
+        if (p_packet != NULL)
+        {
+            report_packet_send(p_packet);
+        }
+    }
+    else if (hops != HOPS_NONE)
+    {
+        reports_send(zones, hops);
+    }
+    /* without a gradient, the reports wait in the table for one */
+
+    timer_order(timestamp);
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_report_init(void)
+{
+    memset(m_zones, 0, sizeof(m_zones));
+    memset(m_children, 0, sizeof(m_children));
+    m_child_next = 0;
+    m_has_parent = false;
+    m_gateway = false;
+    m_local_id_valid = false;
+    m_seq = 0;
+
+    m_timer_evt.cb = report_timeout;
+    m_timer_evt.interval = 0;
+    m_timer_evt.p_context = NULL;
+    m_timer_evt.p_next = NULL;
+    timer_order(timer_now());
+}
+
+uint32_t mesh_report_gateway_set(bool gateway)
+{
+    event_handler_critical_section_begin();
+    m_gateway = gateway;
+    m_has_parent = false;
+    event_handler_critical_section_end();
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_report_submit(uint8_t zone, int16_t value)
+{
+    event_handler_critical_section_begin();
+    uint32_t error_code = zone_merge(zone, 1, value, value, value);
+    event_handler_critical_section_end();
+    return error_code;
+}
+
+uint32_t mesh_report_hops_get(uint8_t* p_hops)
+{
+    event_handler_critical_section_begin();
+    uint8_t hops = hops_current(timer_now());
+    event_handler_critical_section_end();
+
+    if (hops == HOPS_NONE)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    *p_hops = hops;
+    return NRF_SUCCESS;
+}
+
+void mesh_report_rx(mesh_packet_t* p_packet, timestamp_t timestamp, uint8_t rssi)
+{
+    report_adv_data_t* p_adv = (report_adv_data_t*) mesh_packet_adv_data_get(p_packet);
+    if (p_adv == NULL || p_adv->adv_data_length < REPORT_ADV_OVERHEAD)
+    {
+        return;
+    }
+    uint32_t record_count = (p_adv->adv_data_length - REPORT_ADV_OVERHEAD) / REPORT_RECORD_LEN;
+    if (record_count > REPORT_RECORDS_MAX)
+    {
+        return;
+    }
+
+    event_handler_critical_section_begin();
+    gradient_update(p_packet, p_adv->hops, timestamp, rssi);
+
+    if (record_count > 0 &&
+        m_local_id_valid &&
+        p_adv->parent == m_local_id &&
+        !report_is_repeat(short_addr_get(p_packet->addr), p_adv->seq, timestamp))
+    {
+        for (uint32_t i = 0; i < record_count; ++i)
+        {
+            report_record_t* p_record = &p_adv->records[i];
+            if (p_record->count > 0 && p_record->min <= p_record->max)
+            {
+                /* records that don't fit are lost, like a lost packet */
+                (void) zone_merge(p_record->zone, p_record->count, p_record->min, p_record->max, p_record->sum);
+            }
+        }
+    }
+    event_handler_critical_section_end();
+}
+
+#else
+
+void mesh_report_init(void)
+{
+}
+
+uint32_t mesh_report_gateway_set(bool gateway)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_report_submit(uint8_t zone, int16_t value)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_report_hops_get(uint8_t* p_hops)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+void mesh_report_rx(mesh_packet_t* p_packet, timestamp_t timestamp, uint8_t rssi)
+{
+    /* not taking part in the reports */
+}
+
+#endif /* RBC_MESH_REPORT_ZONES > 0 */
@@ -0,0 +1,149 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_retain.h"
+
+#ifdef MESH_RETAIN
+
+#include <stddef.h>
+#include <string.h>
+#include "crc16.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define RETAIN_MAGIC            (0x4D455348) /* "MESH" */
+/** Changes with the settings that change the layout of the area. */
+#define RETAIN_LAYOUT           ((uint32_t) ((RBC_MESH_DATA_CACHE_ENTRIES << 16) | \
+                                             (RBC_MESH_VALUE_MAX_LEN << 8) | \
+                                             sizeof(retain_slot_t)))
+
+#if defined(__GNUC__)
+    #define RETAIN_SECTION      __attribute__((section(".noinit")))
+#elif defined(__CC_ARM)
+    #define RETAIN_SECTION      __attribute__((section(".noinit"), zero_init))
+#else
+    #error "Unsupported toolchain."
+#endif
+
+typedef struct
+{
+    mesh_retain_value_t value;
+    uint16_t            crc;    /**< Over the value, up to its length. */
+} retain_slot_t;
+
+typedef struct
+{
+    uint32_t            magic;
+    uint32_t            layout;
+    uint32_t            check;  /**< Inverse of the layout. */
+    retain_slot_t       slots[RBC_MESH_DATA_CACHE_ENTRIES];
+} retain_area_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static retain_area_t m_area RETAIN_SECTION;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint16_t slot_crc_get(const retain_slot_t* p_slot)
+{
+    uint32_t length = p_slot->value.length;
+    if (length > RBC_MESH_VALUE_MAX_LEN)
+    {
+        length = RBC_MESH_VALUE_MAX_LEN;
+    }
+    return crc16_compute((const uint8_t*) &p_slot->value,
+            offsetof(mesh_retain_value_t, data) + length,
+            NULL);
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_retain_init(void)
+{
+    if (m_area.magic == RETAIN_MAGIC &&
+        m_area.layout == RETAIN_LAYOUT &&
+        m_area.check == (uint32_t) ~RETAIN_LAYOUT)
+    {
+        return;
+    }
+
+    /* power on, or a different build */
+    for (uint32_t i = 0; i < RBC_MESH_DATA_CACHE_ENTRIES; ++i)
+    {
+        mesh_retain_value_clear(i);
+    }
+    m_area.layout = RETAIN_LAYOUT;
+    m_area.check = (uint32_t) ~RETAIN_LAYOUT;
+    m_area.magic = RETAIN_MAGIC;
+}
+
+uint32_t mesh_retain_value_next(uint32_t* p_iterator, mesh_retain_value_t* p_value)
+{
+    while (*p_iterator < RBC_MESH_DATA_CACHE_ENTRIES)
+    {
+        const retain_slot_t* p_slot = &m_area.slots[(*p_iterator)++];
+        if (p_slot->value.handle != RBC_MESH_INVALID_HANDLE &&
+            p_slot->value.length <= RBC_MESH_VALUE_MAX_LEN &&
+            p_slot->crc == slot_crc_get(p_slot))
+        {
+            memcpy(p_value, &p_slot->value, sizeof(mesh_retain_value_t));
+            return NRF_SUCCESS;
+        }
+    }
+    return NRF_ERROR_NOT_FOUND;
+}
+
+void mesh_retain_value_store(uint16_t slot, const mesh_retain_value_t* p_value)
+{
+    if (slot >= RBC_MESH_DATA_CACHE_ENTRIES || p_value->length > RBC_MESH_VALUE_MAX_LEN)
+    {
+        return;
+    }
+    retain_slot_t* p_slot = &m_area.slots[slot];
+    memcpy(&p_slot->value, p_value, offsetof(mesh_retain_value_t, data) + p_value->length);
+    p_slot->crc = slot_crc_get(p_slot);
+}
+
+void mesh_retain_value_clear(uint16_t slot)
+{
+    if (slot >= RBC_MESH_DATA_CACHE_ENTRIES)
+    {
+        return;
+    }
+    /* an invalid CRC is as good as an empty slot */
+    m_area.slots[slot].value.handle = RBC_MESH_INVALID_HANDLE;
+}
+
+#endif /* MESH_RETAIN */
@@ -0,0 +1,234 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_scene.h"
+
+#include <string.h>
+#include "event_handler.h"
+#include "timer_scheduler.h"
+#include "mesh_time.h"
+#include "nrf_error.h"
+
+#if RBC_MESH_SCENE_ACTIONS_MAX > 0
+
+/* event push isn't present in the API header file. */
+extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt);
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define SCENE_VALUE_LEN             (2) /* scene ID */
+#define SCENE_TIMED_VALUE_LEN       (6) /* scene ID, mesh time */
+
+typedef struct
+{
+    uint16_t                scene_id;
+    rbc_mesh_value_handle_t handle;     /**< RBC_MESH_INVALID_HANDLE for unused entries. */
+    uint8_t                 length;
+    uint8_t                 data[RBC_MESH_SCENE_VALUE_MAX_LEN];
+} scene_action_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static scene_action_t m_actions[RBC_MESH_SCENE_ACTIONS_MAX];
+static timer_event_t  m_recall_timer_evt;
+static uint16_t       m_recall_scene_id;
+static bool           m_recall_pending;   /**< A recall is waiting for its time. */
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void scene_apply(uint16_t scene_id)
+{
+    rbc_mesh_event_t evt;
+    evt.type = RBC_MESH_EVENT_TYPE_SCENE_ACTION;
+    evt.params.scene.scene_id = scene_id;
+
+    event_handler_critical_section_begin();
+    for (uint32_t i = 0; i < RBC_MESH_SCENE_ACTIONS_MAX; ++i)
+    {
+        if (m_actions[i].handle != RBC_MESH_INVALID_HANDLE &&
+            m_actions[i].scene_id == scene_id)
+        {
+            evt.params.scene.value_handle = m_actions[i].handle;
+            evt.params.scene.p_data = m_actions[i].data;
+            evt.params.scene.data_len = m_actions[i].length;
+            (void) rbc_mesh_event_push(&evt); /* counted as a queue drop if it fails */
+        }
+    }
+    event_handler_critical_section_end();
+}
+
+static void recall_timeout(timestamp_t timestamp, void* p_context)
+{
+    event_handler_critical_section_begin();
+    bool pending = m_recall_pending;
+    m_recall_pending = false;
+    event_handler_critical_section_end();
+
+    if (pending)
+    {
+        scene_apply(m_recall_scene_id);
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_scene_init(void)
+{
+    for (uint32_t i = 0; i < RBC_MESH_SCENE_ACTIONS_MAX; ++i)
+    {
+        m_actions[i].handle = RBC_MESH_INVALID_HANDLE;
+    }
+    m_recall_pending = false;
+    m_recall_timer_evt.cb = recall_timeout;
+    m_recall_timer_evt.interval = 0;
+    m_recall_timer_evt.p_context = NULL;
+    m_recall_timer_evt.p_next = NULL;
+}
+
+uint32_t mesh_scene_action_set(uint16_t scene_id, rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length)
+{
+    if (length > RBC_MESH_SCENE_VALUE_MAX_LEN)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    event_handler_critical_section_begin();
+    scene_action_t* p_action = NULL;
+    for (uint32_t i = 0; i < RBC_MESH_SCENE_ACTIONS_MAX; ++i)
+    {
+        if (m_actions[i].handle == handle && m_actions[i].scene_id == scene_id)
+        {
+            p_action = &m_actions[i];
+            break;
+        }
+        if (p_action == NULL && m_actions[i].handle == RBC_MESH_INVALID_HANDLE)
+        {
+            p_action = &m_actions[i]; /* keep looking for an existing one */
+        }
+    }
+
+    if (p_action == NULL)
+    {
+        event_handler_critical_section_end();
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_action->scene_id = scene_id;
+    p_action->handle = handle;
+    p_action->length = length;
+    memcpy(p_action->data, p_data, length);
+    event_handler_critical_section_end();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_scene_action_clear(uint16_t scene_id, rbc_mesh_value_handle_t handle)
+{
+    uint32_t error_code = NRF_ERROR_NOT_FOUND;
+
+    event_handler_critical_section_begin();
+    for (uint32_t i = 0; i < RBC_MESH_SCENE_ACTIONS_MAX; ++i)
+    {
+        if (m_actions[i].handle != RBC_MESH_INVALID_HANDLE &&
+            m_actions[i].scene_id == scene_id &&
+            (handle == RBC_MESH_INVALID_HANDLE || m_actions[i].handle == handle))
+        {
+            m_actions[i].handle = RBC_MESH_INVALID_HANDLE;
+            error_code = NRF_SUCCESS;
+        }
+    }
+    event_handler_critical_section_end();
+
+    return error_code;
+}
+
+void mesh_scene_value_rx(rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length)
+{
+    if (handle != RBC_MESH_SCENE_HANDLE || length < SCENE_VALUE_LEN)
+    {
+        return;
+    }
+
+    uint16_t scene_id = p_data[0] | (p_data[1] << 8);
+
+    /* a newer recall replaces the one waiting for its time */
+    event_handler_critical_section_begin();
+    if (m_recall_pending)
+    {
+        m_recall_pending = false;
+        (void) timer_sch_abort(&m_recall_timer_evt);
+    }
+    event_handler_critical_section_end();
+
+    timestamp_t local;
+    if (length >= SCENE_TIMED_VALUE_LEN &&
+        mesh_time_local_get(p_data[2] | (p_data[3] << 8) | (p_data[4] << 16) | ((uint32_t) p_data[5] << 24), &local) == NRF_SUCCESS &&
+        TIMER_OLDER_THAN(timer_now(), local))
+    {
+        event_handler_critical_section_begin();
+        m_recall_scene_id = scene_id;
+        if (timer_sch_reschedule(&m_recall_timer_evt, local) == NRF_SUCCESS)
+        {
+            m_recall_pending = true;
+            event_handler_critical_section_end();
+            return;
+        }
+        event_handler_critical_section_end();
+    }
+
+    /* late, unsynchronized or immediate recalls are applied now */
+    scene_apply(scene_id);
+}
+
+#else
+
+void mesh_scene_init(void)
+{
+}
+
+uint32_t mesh_scene_action_set(uint16_t scene_id, rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_scene_action_clear(uint16_t scene_id, rbc_mesh_value_handle_t handle)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+void mesh_scene_value_rx(rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length)
+{
+    /* no actions to take */
+}
+
+#endif /* RBC_MESH_SCENE_ACTIONS_MAX > 0 */
@@ -0,0 +1,62 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_stats.h"
+
+#include <string.h>
+#include "mesh_packet.h"
+#include "timeslot.h"
+#include "rbc_mesh_common.h"
+
+/*****************************************************************************
+* Globals
+*****************************************************************************/
+rbc_mesh_stats_t g_mesh_stats;
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_stats_init(void)
+{
+    memset(&g_mesh_stats, 0, sizeof(g_mesh_stats));
+}
+
+void mesh_stats_get(rbc_mesh_stats_t* p_stats)
+{
+    rbc_mesh_packet_pool_stats_t pool_stats;
+    mesh_packet_pool_stats_get(&pool_stats);
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(p_stats, &g_mesh_stats, sizeof(rbc_mesh_stats_t));
+    _ENABLE_IRQS(was_masked);
+
+    p_stats->pool_exhausted = pool_stats.exhausted_count;
+    p_stats->duty_cycle_permille = timeslot_duty_cycle_get();
+}
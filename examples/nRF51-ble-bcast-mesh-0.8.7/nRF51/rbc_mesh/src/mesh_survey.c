@@ -0,0 +1,283 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_survey.h"
+
+#include <string.h>
+#include "transport_control.h"
+#include "version_handler.h"
+#include "timer_scheduler.h"
+#include "rand.h"
+#include "toolchain.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+/** A larger jump in the sequence number means the neighbour restarted. */
+#define SURVEY_SEQ_JUMP_MAX         (1000)
+/** Weight of the newest packet in the RSSI average, as a shift. */
+#define SURVEY_RSSI_AVG_SHIFT       (3)
+
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle;     /**< Always MESH_SURVEY_HANDLE. */
+    uint16_t                seq;        /**< Survey round of the sender. */
+    uint8_t                 channel;    /**< Channel the packet is sent on. */
+    uint8_t                 tx_power;   /**< TX power of the sender. */
+} __packed_gcc survey_adv_data_t;
+
+typedef struct
+{
+    ble_gap_addr_t  addr;
+    uint8_t         channel;
+    uint8_t         tx_power;
+    uint8_t         rssi_worst;
+    uint16_t        rssi_avg;       /** Negative RSSI, scaled by 1 << SURVEY_RSSI_AVG_SHIFT. */
+    uint16_t        last_seq;
+    uint16_t        received;
+    uint16_t        expected;
+    timestamp_t     last_heard;
+} survey_entry_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static survey_entry_t   m_table[RBC_MESH_SURVEY_TABLE_SIZE];
+static uint8_t          m_entry_count;
+static timer_event_t    m_tx_timer_evt;
+static timestamp_t      m_interval_us;      /** 0 while the survey is stopped. */
+static uint16_t         m_seq;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void survey_tx(uint8_t channel)
+{
+    const tc_tx_config_t* p_vh_config = vh_tx_config_get();
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return; /* shows up as a lost packet at the neighbours */
+    }
+
+    survey_adv_data_t* p_adv = (survey_adv_data_t*) &p_packet->payload[0];
+    (void) mesh_packet_set_local_addr(p_packet);
+    p_packet->header.length = MESH_PACKET_BLE_OVERHEAD + sizeof(survey_adv_data_t);
+    p_packet->header.type = BLE_PACKET_TYPE_ADV_NONCONN_IND;
+
+    p_adv->adv_data_length = sizeof(survey_adv_data_t) - 1;
+    p_adv->adv_data_type = MESH_ADV_DATA_TYPE;
+    p_adv->mesh_uuid = MESH_UUID;
+    p_adv->handle = MESH_SURVEY_HANDLE;
+    p_adv->seq = m_seq;
+    p_adv->channel = channel;
+    p_adv->tx_power = (uint8_t) p_vh_config->tx_power;
+
+    /* one packet per channel, so the neighbours know which one they heard */
+    tc_tx_config_t tx_config = *p_vh_config;
+    tx_config.first_channel = channel;
+    tx_config.channel_map = 1;
+    (void) tc_tx(p_packet, &tx_config);
+    mesh_packet_ref_count_dec(p_packet);
+}
+
+static void tx_timer_order(timestamp_t time_now)
+{
+    /* spread the packets of nodes started at the same time */
+    timestamp_t delay = m_interval_us - m_interval_us / 4 + rand_range(m_interval_us / 2);
+    (void) timer_sch_reschedule(&m_tx_timer_evt, time_now + delay);
+}
+
+static void tx_timeout(timestamp_t timestamp, void* p_context)
+{
+    if (m_interval_us == 0)
+    {
+        return;
+    }
+
+    const tc_tx_config_t* p_vh_config = vh_tx_config_get();
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        if (p_vh_config->channel_map & (1 << i))
+        {
+            survey_tx(p_vh_config->first_channel + i);
+        }
+    }
+    m_seq++;
+    tx_timer_order(timestamp);
+}
+
+/** Find the entry of a neighbour and channel, or the one to replace with it. */
+static survey_entry_t* entry_get(const ble_gap_addr_t* p_addr, uint8_t channel, bool* p_is_new)
+{
+    *p_is_new = false;
+    survey_entry_t* p_oldest = &m_table[0];
+    for (uint32_t i = 0; i < m_entry_count; ++i)
+    {
+        if (m_table[i].channel == channel &&
+            m_table[i].addr.addr_type == p_addr->addr_type &&
+            memcmp(m_table[i].addr.addr, p_addr->addr, BLE_GAP_ADDR_LEN) == 0)
+        {
+            return &m_table[i];
+        }
+        if (TIMER_OLDER_THAN(m_table[i].last_heard, p_oldest->last_heard))
+        {
+            p_oldest = &m_table[i];
+        }
+    }
+
+    *p_is_new = true;
+    if (m_entry_count < RBC_MESH_SURVEY_TABLE_SIZE)
+    {
+        return &m_table[m_entry_count++];
+    }
+    return p_oldest;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_survey_init(void)
+{
+    m_tx_timer_evt.cb = tx_timeout;
+    m_tx_timer_evt.interval = 0;
+    m_tx_timer_evt.p_context = NULL;
+    m_tx_timer_evt.p_next = NULL;
+    m_interval_us = 0;
+    m_seq = 0;
+    mesh_survey_reset();
+}
+
+void mesh_survey_start(timestamp_t interval_us)
+{
+    bool was_started = (m_interval_us != 0);
+    m_interval_us = interval_us;
+    if (!was_started)
+    {
+        tx_timer_order(timer_now());
+    }
+}
+
+void mesh_survey_stop(void)
+{
+    m_interval_us = 0;
+    (void) timer_sch_abort(&m_tx_timer_evt);
+}
+
+void mesh_survey_rx(mesh_packet_t* p_packet, timestamp_t timestamp, uint8_t rssi)
+{
+    survey_adv_data_t* p_adv = (survey_adv_data_t*) mesh_packet_adv_data_get(p_packet);
+    if (p_adv == NULL || p_adv->adv_data_length < sizeof(survey_adv_data_t) - 1)
+    {
+        return;
+    }
+
+    ble_gap_addr_t addr;
+    memcpy(addr.addr, p_packet->addr, BLE_GAP_ADDR_LEN);
+    addr.addr_type = p_packet->header.addr_type;
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    bool is_new;
+    survey_entry_t* p_entry = entry_get(&addr, p_adv->channel, &is_new);
+    uint16_t seq_delta = (uint16_t) (p_adv->seq - p_entry->last_seq);
+
+    if (is_new || seq_delta > SURVEY_SEQ_JUMP_MAX)
+    {
+        memset(p_entry, 0, sizeof(survey_entry_t));
+        p_entry->addr = addr;
+        p_entry->channel = p_adv->channel;
+        p_entry->rssi_avg = rssi << SURVEY_RSSI_AVG_SHIFT;
+        p_entry->expected = 1;
+    }
+    else if (seq_delta == 0)
+    {
+        /* the same packet, relayed or heard twice */
+        _ENABLE_IRQS(was_masked);
+        return;
+    }
+    else
+    {
+        p_entry->rssi_avg += rssi - (p_entry->rssi_avg >> SURVEY_RSSI_AVG_SHIFT);
+        p_entry->expected += seq_delta;
+    }
+
+    p_entry->received++;
+    p_entry->last_seq = p_adv->seq;
+    p_entry->tx_power = p_adv->tx_power;
+    p_entry->last_heard = timestamp;
+    if (rssi > p_entry->rssi_worst)
+    {
+        p_entry->rssi_worst = rssi;
+    }
+    if (p_entry->expected >= UINT16_MAX / 2)
+    {
+        /* keep the ratio, and room to count */
+        p_entry->expected >>= 1;
+        p_entry->received >>= 1;
+    }
+    _ENABLE_IRQS(was_masked);
+}
+
+uint32_t mesh_survey_entry_get(uint8_t index, rbc_mesh_survey_entry_t* p_entry)
+{
+    uint32_t error_code = NRF_SUCCESS;
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (index >= m_entry_count)
+    {
+        error_code = NRF_ERROR_NOT_FOUND;
+    }
+    else
+    {
+        survey_entry_t* p_survey_entry = &m_table[index];
+        p_entry->addr = p_survey_entry->addr;
+        p_entry->channel = p_survey_entry->channel;
+        p_entry->tx_power = p_survey_entry->tx_power;
+        p_entry->rssi_avg = (uint8_t) (p_survey_entry->rssi_avg >> SURVEY_RSSI_AVG_SHIFT);
+        p_entry->rssi_worst = p_survey_entry->rssi_worst;
+        p_entry->received = p_survey_entry->received;
+        p_entry->expected = p_survey_entry->expected;
+        p_entry->per_permille = (uint16_t) (1000 - (p_survey_entry->received * 1000UL) / p_survey_entry->expected);
+    }
+    _ENABLE_IRQS(was_masked);
+    return error_code;
+}
+
+void mesh_survey_reset(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    m_entry_count = 0;
+    _ENABLE_IRQS(was_masked);
+}
@@ -0,0 +1,493 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_time.h"
+
+#include <string.h>
+#include "rbc_mesh.h"
+#include "transport_control.h"
+#include "version_handler.h"
+#include "event_handler.h"
+#include "timer_scheduler.h"
+#include "rand.h"
+#include "toolchain.h"
+#include "nrf_error.h"
+
+#if RBC_MESH_TIME_SYNC > 0
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define BEACON_INTERVAL_US          (RBC_MESH_TIME_BEACON_INTERVAL_MS * 1000)
+/** Time without a new round from the root before the node stops counting
+  itself as synchronized, and takes samples from any root. */
+#define ROOT_TIMEOUT_US             (8 * BEACON_INTERVAL_US)
+/** Samples needed before the node counts itself as synchronized, and sends
+  beacons of its own. */
+#define SYNC_SAMPLES_MIN            (3)
+/** Samples further than this from the estimate are left out. */
+#define SAMPLE_ERROR_MAX_US         (1000)
+/** Samples left out in a row before the estimate is dropped, as the root's
+  clock must have jumped. */
+#define SAMPLE_ERRORS_MAX           (3)
+/** Senders whose last beacon is remembered, to pair with the time in their
+  next one. */
+#define RX_RECORDS                  (4)
+/** Beacons go on the first this many channels of the channel map. */
+#define BEACON_CHANNELS_MAX         (3)
+#define ROOT_NONE                   (0xFFFF)
+/** Local time differences are scaled down by this many bits in the skew
+  regression, to keep the sums within 64 bits. */
+#define SKEW_LOCAL_SHIFT            (8)
+/** Fraction bits of the skew. */
+#define SKEW_SHIFT                  (24)
+/** Largest skew accepted, 1000 ppm. */
+#define SKEW_MAX                    ((1 << SKEW_SHIFT) / 1000)
+
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle;     /**< Always MESH_TIME_HANDLE. */
+    uint16_t                root;       /**< Short address of the root the sender follows. */
+    uint16_t                root_seq;   /**< Newest round of the root the sender has synchronized to. */
+    uint8_t                 seq;        /**< The sender's beacon round. */
+    uint8_t                 index;      /**< Index of the packet in the round, one per channel. */
+    uint8_t                 prev_mask;  /**< Packets of the previous round with a time in prev_times. */
+    uint32_t                prev_times[BEACON_CHANNELS_MAX]; /**< Sender's mesh time at the end of each packet of the previous round. */
+} __packed_gcc time_adv_data_t;
+
+typedef struct
+{
+    timestamp_t local;
+    uint32_t    offset;     /**< Mesh time - local time. */
+} sample_t;
+
+typedef struct
+{
+    uint16_t    id;
+    uint8_t     seq;
+    uint8_t     index;
+    timestamp_t rx_time;    /**< 0 for unused entries. */
+} rx_record_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static bool             m_root;
+static uint16_t         m_root_id;          /**< Root the node follows, ROOT_NONE if none. */
+static uint16_t         m_root_seq;
+static timestamp_t      m_root_last_heard;
+static sample_t         m_samples[RBC_MESH_TIME_SAMPLES];
+static uint8_t          m_sample_count;
+static uint8_t          m_sample_next;
+static uint8_t          m_sample_errors;
+static timestamp_t      m_local_avg;
+static uint32_t         m_offset_avg;
+static int32_t          m_skew;             /**< Mesh time drift per local microsecond, in 1 / (1 << SKEW_SHIFT). */
+static rx_record_t      m_rx_records[RX_RECORDS];
+static timestamp_t      m_tx_times[BEACON_CHANNELS_MAX]; /**< End of each packet of the current round. */
+static volatile uint8_t m_tx_mask;          /**< Packets of the current round that have gone on air. */
+static uint8_t          m_seq;
+static timer_event_t    m_timer_evt;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint16_t short_addr_get(const uint8_t* p_addr)
+{
+    return (p_addr[0] | (p_addr[1] << 8));
+}
+
+/** Must be called in a critical section. */
+static bool is_synced(timestamp_t time_now)
+{
+    return (m_root ||
+            (m_sample_count >= SYNC_SAMPLES_MIN &&
+             TIMER_DIFF(time_now, m_root_last_heard) < ROOT_TIMEOUT_US));
+}
+
+/** Must be called in a critical section. */
+static uint32_t local_to_mesh(timestamp_t local)
+{
+    int32_t drift = (int32_t) (((int64_t) (int32_t) (local - m_local_avg) * m_skew) / (1 << SKEW_SHIFT));
+    return local + m_offset_avg + drift;
+}
+
+static void samples_clear(void)
+{
+    m_sample_count = 0;
+    m_sample_next = 0;
+    m_sample_errors = 0;
+    m_local_avg = 0;
+    m_offset_avg = 0;
+    m_skew = 0;
+}
+
+/** Fit the mesh time to the samples. Must be called in a critical section. */
+static void estimate_update(void)
+{
+    /* averages relative to the newest sample, to stay clear of wraparounds */
+    const sample_t* p_ref = &m_samples[(m_sample_next + RBC_MESH_TIME_SAMPLES - 1) % RBC_MESH_TIME_SAMPLES];
+    int64_t local_sum = 0;
+    int64_t offset_sum = 0;
+    for (uint32_t i = 0; i < m_sample_count; ++i)
+    {
+        local_sum += (int32_t) (m_samples[i].local - p_ref->local);
+        offset_sum += (int32_t) (m_samples[i].offset - p_ref->offset);
+    }
+    m_local_avg = p_ref->local + (int32_t) (local_sum / m_sample_count);
+    m_offset_avg = p_ref->offset + (int32_t) (offset_sum / m_sample_count);
+
+    int64_t num = 0;
+    int64_t den = 0;
+    for (uint32_t i = 0; i < m_sample_count; ++i)
+    {
+        int64_t local_diff = (int32_t) (m_samples[i].local - m_local_avg) / (1 << SKEW_LOCAL_SHIFT);
+        int64_t offset_diff = (int32_t) (m_samples[i].offset - m_offset_avg);
+        num += local_diff * offset_diff;
+        den += local_diff * local_diff;
+    }
+
+    int64_t skew = 0;
+    if (den > 0)
+    {
+        /* the slope is num / (den << SKEW_LOCAL_SHIFT) */
+        skew = (num * (1 << (SKEW_SHIFT - SKEW_LOCAL_SHIFT))) / den;
+    }
+    if (skew > SKEW_MAX || skew < -SKEW_MAX)
+    {
+        skew = 0;
+    }
+    m_skew = (int32_t) skew;
+}
+
+/** Add a sample of the mesh time. Must be called in a critical section. */
+static void sample_add(timestamp_t local, uint32_t time)
+{
+    if (m_sample_count >= SYNC_SAMPLES_MIN)
+    {
+        int32_t error = (int32_t) (time - local_to_mesh(local));
+        if (error > SAMPLE_ERROR_MAX_US || error < -SAMPLE_ERROR_MAX_US)
+        {
+            if (++m_sample_errors < SAMPLE_ERRORS_MAX)
+            {
+                return;
+            }
+            samples_clear();
+        }
+    }
+    m_sample_errors = 0;
+
+    m_samples[m_sample_next].local = local;
+    m_samples[m_sample_next].offset = time - local;
+    m_sample_next = (m_sample_next + 1) % RBC_MESH_TIME_SAMPLES;
+    if (m_sample_count < RBC_MESH_TIME_SAMPLES)
+    {
+        m_sample_count++;
+    }
+    estimate_update();
+}
+
+/** Find the sender's last beacon, or the entry to replace with it. */
+static rx_record_t* rx_record_get(uint16_t id, bool* p_found)
+{
+    rx_record_t* p_oldest = &m_rx_records[0];
+    for (uint32_t i = 0; i < RX_RECORDS; ++i)
+    {
+        if (m_rx_records[i].rx_time != 0 && m_rx_records[i].id == id)
+        {
+            *p_found = true;
+            return &m_rx_records[i];
+        }
+        if (m_rx_records[i].rx_time == 0 ||
+            (p_oldest->rx_time != 0 && TIMER_OLDER_THAN(m_rx_records[i].rx_time, p_oldest->rx_time)))
+        {
+            p_oldest = &m_rx_records[i];
+        }
+    }
+    *p_found = false;
+    return p_oldest;
+}
+
+static void beacon_tx(uint8_t channel, uint8_t index, uint8_t prev_mask, const uint32_t* p_prev_times)
+{
+    const tc_tx_config_t* p_vh_config = vh_tx_config_get();
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return;
+    }
+
+    time_adv_data_t* p_adv = (time_adv_data_t*) &p_packet->payload[0];
+    (void) mesh_packet_set_local_addr(p_packet);
+    p_packet->header.length = MESH_PACKET_BLE_OVERHEAD + sizeof(time_adv_data_t);
+    p_packet->header.type = BLE_PACKET_TYPE_ADV_NONCONN_IND;
+
+    p_adv->adv_data_length = sizeof(time_adv_data_t) - 1;
+    p_adv->adv_data_type = MESH_ADV_DATA_TYPE;
+    p_adv->mesh_uuid = MESH_UUID;
+    p_adv->handle = MESH_TIME_HANDLE;
+    event_handler_critical_section_begin();
+    p_adv->root = (m_root ? short_addr_get(p_packet->addr) : m_root_id);
+    p_adv->root_seq = m_root_seq;
+    event_handler_critical_section_end();
+    p_adv->seq = m_seq;
+    p_adv->index = index;
+    p_adv->prev_mask = prev_mask;
+    memcpy(p_adv->prev_times, p_prev_times, sizeof(p_adv->prev_times));
+
+    /* one packet per channel, as each goes on air at its own time */
+    tc_tx_config_t tx_config = *p_vh_config;
+    tx_config.first_channel = channel;
+    tx_config.channel_map = 1;
+    (void) tc_tx(p_packet, &tx_config);
+    mesh_packet_ref_count_dec(p_packet);
+}
+
+static void timer_order(timestamp_t time_now)
+{
+    /* spread the beacons of nodes started at the same time */
+    timestamp_t delay = BEACON_INTERVAL_US - BEACON_INTERVAL_US / 4 + rand_range(BEACON_INTERVAL_US / 2);
+    (void) timer_sch_reschedule(&m_timer_evt, time_now + delay);
+}
+
+static void beacon_timeout(timestamp_t timestamp, void* p_context)
+{
+    event_handler_critical_section_begin();
+    bool synced = is_synced(timestamp);
+    if (m_root)
+    {
+        m_root_seq++;
+    }
+    event_handler_critical_section_end();
+
+    if (synced)
+    {
+        /* the times of the previous round, as they are known now. A round
+           more than a few intervals old is of no use to the receivers. */
+        timestamp_t tx_times[BEACON_CHANNELS_MAX];
+        uint32_t prev_times[BEACON_CHANNELS_MAX];
+        uint32_t was_masked;
+        _DISABLE_IRQS(was_masked);
+        uint8_t prev_mask = m_tx_mask;
+        m_tx_mask = 0;
+        memcpy(tx_times, m_tx_times, sizeof(tx_times));
+        _ENABLE_IRQS(was_masked);
+
+        for (uint32_t i = 0; i < BEACON_CHANNELS_MAX; ++i)
+        {
+            if (TIMER_DIFF(timestamp, tx_times[i]) >= ROOT_TIMEOUT_US)
+            {
+                prev_mask &= ~(1 << i);
+            }
+            prev_times[i] = 0;
+            (void) mesh_time_get(tx_times[i], &prev_times[i]);
+        }
+
+        const tc_tx_config_t* p_vh_config = vh_tx_config_get();
+        uint8_t index = 0;
+        for (uint32_t i = 0; i < 8 && index < BEACON_CHANNELS_MAX; ++i)
+        {
+            if (p_vh_config->channel_map & (1 << i))
+            {
+                beacon_tx(p_vh_config->first_channel + i, index++, prev_mask, prev_times);
+            }
+        }
+        m_seq++;
+    }
+    else
+    {
+        m_tx_mask = 0; /* the next round won't follow this one */
+    }
+    timer_order(timestamp);
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_time_init(void)
+{
+    m_root = false;
+    m_root_id = ROOT_NONE;
+    m_root_seq = 0;
+    samples_clear();
+    memset(m_rx_records, 0, sizeof(m_rx_records));
+    memset(m_tx_times, 0, sizeof(m_tx_times));
+    m_tx_mask = 0;
+    m_seq = 0;
+
+    m_timer_evt.cb = beacon_timeout;
+    m_timer_evt.interval = 0;
+    m_timer_evt.p_context = NULL;
+    m_timer_evt.p_next = NULL;
+    timer_order(timer_now());
+}
+
+uint32_t mesh_time_root_set(bool root)
+{
+    event_handler_critical_section_begin();
+    if (root != m_root)
+    {
+        m_root = root;
+        m_root_id = ROOT_NONE;
+        samples_clear();
+    }
+    event_handler_critical_section_end();
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_time_get(timestamp_t local, uint32_t* p_time)
+{
+    uint32_t error_code = NRF_ERROR_INVALID_STATE;
+    event_handler_critical_section_begin();
+    if (is_synced(timer_now()))
+    {
+        *p_time = (m_root ? local : local_to_mesh(local));
+        error_code = NRF_SUCCESS;
+    }
+    event_handler_critical_section_end();
+    return error_code;
+}
+
+uint32_t mesh_time_local_get(uint32_t time, timestamp_t* p_local)
+{
+    uint32_t error_code = NRF_ERROR_INVALID_STATE;
+    event_handler_critical_section_begin();
+    if (is_synced(timer_now()))
+    {
+        if (m_root)
+        {
+            *p_local = time;
+        }
+        else
+        {
+            /* the drift hardly changes over the error of the first guess */
+            timestamp_t guess = time - m_offset_avg;
+            *p_local = guess - (local_to_mesh(guess) - time);
+        }
+        error_code = NRF_SUCCESS;
+    }
+    event_handler_critical_section_end();
+    return error_code;
+}
+
+void mesh_time_rx(mesh_packet_t* p_packet, timestamp_t timestamp)
+{
+    time_adv_data_t* p_adv = (time_adv_data_t*) mesh_packet_adv_data_get(p_packet);
+    if (p_adv == NULL || p_adv->adv_data_length < sizeof(time_adv_data_t) - 1)
+    {
+        return;
+    }
+    if (timestamp == 0)
+    {
+        timestamp = 1; /* 0 marks unused records */
+    }
+
+    event_handler_critical_section_begin();
+    bool found;
+    rx_record_t* p_record = rx_record_get(short_addr_get(p_packet->addr), &found);
+    bool root_lost = (m_root_id == ROOT_NONE ||
+                      TIMER_DIFF(timestamp, m_root_last_heard) >= ROOT_TIMEOUT_US);
+
+    if (!m_root &&
+        found &&
+        p_record->seq == (uint8_t) (p_adv->seq - 1) &&
+        p_record->index < BEACON_CHANNELS_MAX &&
+        (p_adv->prev_mask & (1 << p_record->index)) &&
+        TIMER_DIFF(timestamp, p_record->rx_time) < ROOT_TIMEOUT_US &&
+        p_adv->root != ROOT_NONE &&
+        (p_adv->root == m_root_id || root_lost || p_adv->root < m_root_id))
+    {
+        if (p_adv->root != m_root_id)
+        {
+            /* the offset to another root has nothing to do with this one */
+            samples_clear();
+            m_root_id = p_adv->root;
+            m_root_seq = p_adv->root_seq - 1;
+        }
+        if ((int16_t) (p_adv->root_seq - m_root_seq) > 0)
+        {
+            /* the receiver's clock at the end of the previous beacon, paired
+               with the sender's mesh time at the same moment */
+            sample_add(p_record->rx_time, p_adv->prev_times[p_record->index]);
+            m_root_seq = p_adv->root_seq;
+            m_root_last_heard = timestamp;
+        }
+    }
+
+    p_record->id = short_addr_get(p_packet->addr);
+    p_record->seq = p_adv->seq;
+    p_record->index = p_adv->index;
+    p_record->rx_time = timestamp;
+    event_handler_critical_section_end();
+}
+
+void mesh_time_tx_end(mesh_packet_t* p_packet, timestamp_t timestamp)
+{
+    time_adv_data_t* p_adv = (time_adv_data_t*) mesh_packet_adv_data_get(p_packet);
+    /* the round is counted up as soon as it's queued */
+    if (p_adv != NULL && p_adv->seq == (uint8_t) (m_seq - 1) && p_adv->index < BEACON_CHANNELS_MAX)
+    {
+        m_tx_times[p_adv->index] = timestamp;
+        m_tx_mask |= (1 << p_adv->index);
+    }
+}
+
+#else
+
+void mesh_time_init(void)
+{
+}
+
+uint32_t mesh_time_root_set(bool root)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_time_get(timestamp_t local, uint32_t* p_time)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+uint32_t mesh_time_local_get(uint32_t time, timestamp_t* p_local)
+{
+    return NRF_ERROR_NOT_SUPPORTED;
+}
+
+void mesh_time_rx(mesh_packet_t* p_packet, timestamp_t timestamp)
+{
+}
+
+void mesh_time_tx_end(mesh_packet_t* p_packet, timestamp_t timestamp)
+{
+}
+
+#endif /* RBC_MESH_TIME_SYNC > 0 */
@@ -0,0 +1,192 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_trace.h"
+
+#ifdef MESH_TRACE
+
+#include <stdbool.h>
+#include <string.h>
+#include "nrf.h"
+#include "toolchain.h"
+#include "SEGGER_RTT.h"
+
+#if (MESH_TRACE_RING_LENGTH & (MESH_TRACE_RING_LENGTH - 1))
+#error "MESH_TRACE_RING_LENGTH must be a power of two"
+#endif
+
+/*****************************************************************************
+* Local type definitions
+*****************************************************************************/
+typedef struct
+{
+    uint16_t timestamp;     /**< Trace timer value at the event. */
+    uint8_t site;           /**< mesh_trace_site_t of the event. */
+    uint8_t is_exit;        /**< Whether this was the exit from the site. */
+} trace_evt_t;
+
+typedef struct
+{
+    uint32_t histogram[MESH_TRACE_HIST_BUCKETS];
+    uint16_t enter_time;    /**< Timestamp of the outermost entry. */
+    uint16_t max_duration;
+    uint8_t depth;          /**< Nesting depth, only the outermost call is measured. */
+} trace_site_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static trace_evt_t  m_ring[MESH_TRACE_RING_LENGTH];
+static uint32_t     m_ring_head; /* total number of events, wraps safely as the length is a power of two */
+static trace_site_t m_sites[MESH_TRACE_SITE__COUNT];
+
+static const char*  m_site_names[MESH_TRACE_SITE__COUNT] =
+{
+    "rx_cb",
+    "vh_rx",
+    "transmit_all",
+    "async_evt",
+    "radio_signal"
+};
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static inline uint16_t trace_time_get(void)
+{
+    MESH_TRACE_TIMER->TASKS_CAPTURE[0] = 1;
+    return (uint16_t) MESH_TRACE_TIMER->CC[0];
+}
+
+static inline void ring_push(uint16_t timestamp, mesh_trace_site_t site, bool is_exit)
+{
+    trace_evt_t* p_evt = &m_ring[m_ring_head++ & (MESH_TRACE_RING_LENGTH - 1)];
+    p_evt->timestamp = timestamp;
+    p_evt->site = (uint8_t) site;
+    p_evt->is_exit = is_exit;
+}
+
+static uint32_t bucket_get(uint16_t duration)
+{
+    uint32_t bucket = 0;
+    while (duration > 1 && bucket < MESH_TRACE_HIST_BUCKETS - 1)
+    {
+        duration >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_trace_init(void)
+{
+    memset(m_ring, 0, sizeof(m_ring));
+    memset(m_sites, 0, sizeof(m_sites));
+    m_ring_head = 0;
+
+    MESH_TRACE_TIMER->TASKS_STOP = 1;
+    MESH_TRACE_TIMER->MODE = TIMER_MODE_MODE_Timer;
+    MESH_TRACE_TIMER->BITMODE = TIMER_BITMODE_BITMODE_16Bit;
+    MESH_TRACE_TIMER->PRESCALER = MESH_TRACE_TIMER_PRESCALER;
+    MESH_TRACE_TIMER->INTENCLR = 0xFFFFFFFF;
+    MESH_TRACE_TIMER->TASKS_CLEAR = 1;
+    MESH_TRACE_TIMER->TASKS_START = 1;
+}
+
+void mesh_trace_enter(mesh_trace_site_t site)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    uint16_t now = trace_time_get();
+    if (m_sites[site].depth++ == 0)
+    {
+        m_sites[site].enter_time = now;
+    }
+    ring_push(now, site, false);
+    _ENABLE_IRQS(was_masked);
+}
+
+void mesh_trace_exit(mesh_trace_site_t site)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    uint16_t now = trace_time_get();
+    trace_site_t* p_site = &m_sites[site];
+    if (p_site->depth > 0 && --p_site->depth == 0)
+    {
+        uint16_t duration = (uint16_t) (now - p_site->enter_time);
+        p_site->histogram[bucket_get(duration)]++;
+        if (duration > p_site->max_duration)
+        {
+            p_site->max_duration = duration;
+        }
+    }
+    ring_push(now, site, true);
+    _ENABLE_IRQS(was_masked);
+}
+
+void mesh_trace_dump(void)
+{
+    static trace_site_t sites[MESH_TRACE_SITE__COUNT];
+    static trace_evt_t ring[MESH_TRACE_RING_LENGTH];
+
+    /* take a snapshot, printing is far too slow to do with IRQs disabled */
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    memcpy(sites, m_sites, sizeof(sites));
+    memcpy(ring, m_ring, sizeof(ring));
+    uint32_t ring_head = m_ring_head;
+    _ENABLE_IRQS(was_masked);
+
+    SEGGER_RTT_printf(0, "TRACE histograms (ticks of prescaler %u, bucket n: [2^n, 2^(n+1))):\n",
+            MESH_TRACE_TIMER_PRESCALER);
+    for (uint32_t i = 0; i < MESH_TRACE_SITE__COUNT; ++i)
+    {
+        SEGGER_RTT_printf(0, "%s (max %u):", m_site_names[i], sites[i].max_duration);
+        for (uint32_t j = 0; j < MESH_TRACE_HIST_BUCKETS; ++j)
+        {
+            SEGGER_RTT_printf(0, " %u", sites[i].histogram[j]);
+        }
+        SEGGER_RTT_printf(0, "\n");
+    }
+
+    uint32_t count = (ring_head < MESH_TRACE_RING_LENGTH) ? ring_head : MESH_TRACE_RING_LENGTH;
+    SEGGER_RTT_printf(0, "TRACE ring (oldest first):\n");
+    for (uint32_t i = ring_head - count; i != ring_head; ++i)
+    {
+        trace_evt_t* p_evt = &ring[i & (MESH_TRACE_RING_LENGTH - 1)];
+        SEGGER_RTT_printf(0, "%u %s %s\n", p_evt->timestamp,
+                p_evt->is_exit ? "<" : ">",
+                m_site_names[p_evt->site]);
+    }
+}
+
+#endif /* MESH_TRACE */
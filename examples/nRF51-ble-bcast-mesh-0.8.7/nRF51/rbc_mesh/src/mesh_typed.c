@@ -0,0 +1,277 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_typed.h"
+
+#include <string.h>
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define TAG(type, id)           ((uint8_t) (((type) << 5) | (id)))
+#define TAG_TYPE(tag)           ((tag) >> 5)
+#define TAG_ID(tag)             ((tag) & MESH_TYPED_ID_MAX)
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint32_t zigzag_encode(int32_t value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t value)
+{
+    return (int32_t) (value >> 1) ^ -((int32_t) (value & 1));
+}
+
+static uint32_t varint_len(uint32_t value)
+{
+    uint32_t length = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        length++;
+    }
+    return length;
+}
+
+/* caller has checked the space with varint_len() */
+static void varint_write(mesh_typed_writer_t* p_writer, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        p_writer->p_buf[p_writer->length++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    p_writer->p_buf[p_writer->length++] = (uint8_t) value;
+}
+
+static bool varint_read(const uint8_t* p_buf, uint8_t length, uint8_t* p_offset, uint32_t* p_value)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < MESH_TYPED_VARINT_LEN_MAX; ++i)
+    {
+        if (*p_offset >= length)
+        {
+            return false;
+        }
+        uint8_t byte = p_buf[(*p_offset)++];
+        value |= (uint32_t) (byte & 0x7F) << (7 * i);
+        if (!(byte & 0x80))
+        {
+            *p_value = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t varint_put(mesh_typed_writer_t* p_writer, uint8_t tag, uint32_t value)
+{
+    if (p_writer->length + 1 + varint_len(value) > p_writer->size)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_writer->p_buf[p_writer->length++] = tag;
+    varint_write(p_writer, value);
+    return NRF_SUCCESS;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_typed_writer_init(mesh_typed_writer_t* p_writer, uint8_t* p_buf, uint8_t size)
+{
+    p_writer->p_buf = p_buf;
+    p_writer->size = size;
+    p_writer->length = 0;
+}
+
+uint32_t mesh_typed_put_uint(mesh_typed_writer_t* p_writer, uint8_t id, uint32_t value)
+{
+    if (id > MESH_TYPED_ID_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return varint_put(p_writer, TAG(MESH_TYPED_TYPE_UINT, id), value);
+}
+
+uint32_t mesh_typed_put_sint(mesh_typed_writer_t* p_writer, uint8_t id, int32_t value)
+{
+    if (id > MESH_TYPED_ID_MAX)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return varint_put(p_writer, TAG(MESH_TYPED_TYPE_SINT, id), zigzag_encode(value));
+}
+
+uint32_t mesh_typed_put_series(mesh_typed_writer_t* p_writer, uint8_t id, const int32_t* p_samples, uint8_t count)
+{
+    if (id > MESH_TYPED_ID_MAX || p_samples == NULL || count == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* deltas wrap like the samples would, and decode back to the same samples. */
+    uint32_t length = 2 /* tag, count */ + varint_len(zigzag_encode(p_samples[0]));
+    for (uint32_t i = 1; i < count; ++i)
+    {
+        length += varint_len(zigzag_encode((int32_t) ((uint32_t) p_samples[i] - (uint32_t) p_samples[i - 1])));
+    }
+    if (p_writer->length + length > p_writer->size)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_writer->p_buf[p_writer->length++] = TAG(MESH_TYPED_TYPE_SERIES, id);
+    p_writer->p_buf[p_writer->length++] = count;
+    varint_write(p_writer, zigzag_encode(p_samples[0]));
+    for (uint32_t i = 1; i < count; ++i)
+    {
+        varint_write(p_writer, zigzag_encode((int32_t) ((uint32_t) p_samples[i] - (uint32_t) p_samples[i - 1])));
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_typed_put_bytes(mesh_typed_writer_t* p_writer, uint8_t id, const uint8_t* p_data, uint8_t length)
+{
+    if (id > MESH_TYPED_ID_MAX || (p_data == NULL && length > 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_writer->length + 2 + length > p_writer->size)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_writer->p_buf[p_writer->length++] = TAG(MESH_TYPED_TYPE_BYTES, id);
+    p_writer->p_buf[p_writer->length++] = length;
+    memcpy(&p_writer->p_buf[p_writer->length], p_data, length);
+    p_writer->length += length;
+    return NRF_SUCCESS;
+}
+
+void mesh_typed_reader_init(mesh_typed_reader_t* p_reader, const uint8_t* p_buf, uint8_t length)
+{
+    p_reader->p_buf = p_buf;
+    p_reader->length = length;
+    p_reader->offset = 0;
+}
+
+uint32_t mesh_typed_get(mesh_typed_reader_t* p_reader, mesh_typed_field_t* p_field)
+{
+    if (p_reader->offset >= p_reader->length)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    uint8_t offset = p_reader->offset;
+    uint8_t tag = p_reader->p_buf[offset++];
+    uint32_t value;
+    p_field->id = TAG_ID(tag);
+    p_field->type = (mesh_typed_type_t) TAG_TYPE(tag);
+
+    switch (p_field->type)
+    {
+        case MESH_TYPED_TYPE_UINT:
+        case MESH_TYPED_TYPE_SINT:
+            if (!varint_read(p_reader->p_buf, p_reader->length, &offset, &value))
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+            if (p_field->type == MESH_TYPED_TYPE_UINT)
+            {
+                p_field->value.u = value;
+            }
+            else
+            {
+                p_field->value.s = zigzag_decode(value);
+            }
+            break;
+
+        case MESH_TYPED_TYPE_SERIES:
+            if (offset >= p_reader->length || p_reader->p_buf[offset] == 0)
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+            p_field->value.raw.count = p_reader->p_buf[offset++];
+            p_field->value.raw.p_data = &p_reader->p_buf[offset];
+            for (uint32_t i = 0; i < p_field->value.raw.count; ++i)
+            {
+                if (!varint_read(p_reader->p_buf, p_reader->length, &offset, &value))
+                {
+                    return NRF_ERROR_INVALID_DATA;
+                }
+            }
+            p_field->value.raw.length = offset - (p_field->value.raw.p_data - p_reader->p_buf);
+            break;
+
+        case MESH_TYPED_TYPE_BYTES:
+            if (offset >= p_reader->length ||
+                offset + 1 + p_reader->p_buf[offset] > p_reader->length)
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+            p_field->value.raw.length = p_reader->p_buf[offset++];
+            p_field->value.raw.p_data = &p_reader->p_buf[offset];
+            p_field->value.raw.count = 0;
+            offset += p_field->value.raw.length;
+            break;
+
+        default:
+            return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    p_reader->offset = offset;
+    return NRF_SUCCESS;
+}
+
+uint32_t mesh_typed_series_get(const mesh_typed_field_t* p_field, int32_t* p_samples, uint8_t max_count)
+{
+    if (p_field->type != MESH_TYPED_TYPE_SERIES || p_samples == NULL)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (p_field->value.raw.count > max_count)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    /* the field was validated by mesh_typed_get() */
+    uint8_t offset = 0;
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < p_field->value.raw.count; ++i)
+    {
+        (void) varint_read(p_field->value.raw.p_data, p_field->value.raw.length, &offset, &value);
+        int32_t delta = zigzag_decode(value);
+        p_samples[i] = (i == 0) ? delta : (int32_t) ((uint32_t) p_samples[i - 1] + (uint32_t) delta);
+    }
+    return NRF_SUCCESS;
+}
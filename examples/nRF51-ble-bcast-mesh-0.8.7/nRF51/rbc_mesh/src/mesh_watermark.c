@@ -0,0 +1,294 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#include "mesh_watermark.h"
+
+#ifdef MESH_WATERMARK
+
+#include <stdbool.h>
+#include "nrf.h"
+#include "toolchain.h"
+#include "mesh_packet.h"
+#include "SEGGER_RTT.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define PAINT               (0xA5C3A5C3)
+#define WINDOW_WORDS        (MESH_WATERMARK_WINDOW / sizeof(uint32_t))
+/** Nesting depth of the measured contexts, main included. */
+#define LEVELS_MAX          (MESH_WATERMARK_CONTEXT__COUNT + 1)
+
+#if defined(__CC_ARM)
+extern uint32_t STACK$$Base;
+extern uint32_t STACK$$Limit;
+extern uint32_t HEAP$$Base;
+extern uint32_t HEAP$$Limit;
+#define STACK_LIMIT         (&STACK$$Base)
+#define STACK_TOP           (&STACK$$Limit)
+#define HEAP_BASE           (&HEAP$$Base)
+#define HEAP_LIMIT          (&HEAP$$Limit)
+#elif defined(__GNUC__)
+extern uint32_t __StackLimit;
+extern uint32_t __StackTop;
+extern uint32_t __HeapBase;
+/* the RAM between the heap and the stack is unused too, count it as heap */
+#define STACK_LIMIT         (&__StackLimit)
+#define STACK_TOP           (&__StackTop)
+#define HEAP_BASE           (&__HeapBase)
+#define HEAP_LIMIT          (&__StackLimit)
+#else
+#error "Unsupported toolchain"
+#endif
+
+/*****************************************************************************
+* Local type definitions
+*****************************************************************************/
+typedef struct
+{
+    uint32_t* p_sp;         /**< Stack pointer at entry. */
+    uint32_t* p_window;     /**< Bottom of the painted window. */
+    uint32_t* p_lowest;     /**< Deepest use found so far, by contexts interrupting this one. */
+    uint8_t context;
+    volatile bool painted;  /**< Whether the window is ready, only then may nested contexts scan it. */
+} level_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static level_t      m_levels[LEVELS_MAX];
+static uint32_t     m_level;
+static uint32_t*    mp_main_lowest;
+static uint32_t*    mp_deepest;     /* deepest use by anything, nested contexts included */
+static uint16_t     m_peaks[MESH_WATERMARK_CONTEXT__COUNT];
+static uint32_t     m_entries[MESH_WATERMARK_CONTEXT__COUNT];
+static uint32_t     m_mismatches; /* exits that didn't match the last entry */
+static fifo_t*      mp_fifos[MESH_WATERMARK_FIFOS_MAX];
+static uint32_t     m_fifo_count;
+
+static const char*  m_context_names[MESH_WATERMARK_CONTEXT__COUNT] =
+{
+    "radio",
+    "event",
+    "serial",
+    "app0",
+    "app1",
+};
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+/* Both loops run below the stack pointer of their caller, so they must not
+   be turned into library calls, which would put a stack frame in the way. */
+static void paint(uint32_t* p_from, uint32_t* p_to)
+{
+    for (volatile uint32_t* p = p_from; p < p_to; ++p)
+    {
+        *p = PAINT;
+    }
+}
+
+/** Find the first word that doesn't hold the paint, from the bottom. */
+static uint32_t* scan_up(uint32_t* p_from, uint32_t* p_to)
+{
+    volatile uint32_t* p = p_from;
+    while (p < p_to && *p == PAINT)
+    {
+        ++p;
+    }
+    return (uint32_t*) p;
+}
+
+static uint32_t* window_get(uint32_t* p_sp)
+{
+    if (p_sp - STACK_LIMIT < (int32_t) WINDOW_WORDS)
+    {
+        return STACK_LIMIT;
+    }
+    return p_sp - WINDOW_WORDS;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void mesh_watermark_init(void)
+{
+    uint32_t* p_sp = (uint32_t*) __get_MSP();
+    paint(HEAP_BASE, HEAP_LIMIT);
+    paint(STACK_LIMIT, p_sp);
+    mp_main_lowest = p_sp;
+    mp_deepest = p_sp;
+}
+
+void mesh_watermark_enter(mesh_watermark_context_t context)
+{
+    uint32_t* p_sp = (uint32_t*) __get_MSP();
+    /* Reserve the level before using it. A nested context that comes in
+       between leaves m_level the way it found it. */
+    uint32_t level = m_level;
+    if (level >= LEVELS_MAX || context >= MESH_WATERMARK_CONTEXT__COUNT)
+    {
+        return;
+    }
+    m_level = level + 1;
+
+    level_t* p_level = &m_levels[level];
+    p_level->p_sp = p_sp;
+    p_level->p_window = window_get(p_sp);
+    p_level->p_lowest = p_sp;
+    p_level->context = context;
+
+    /* The window may hold the earlier peak of the interrupted context. Take
+       it before painting over it. */
+    uint32_t* p_lowest = scan_up(p_level->p_window, p_sp);
+    if (p_lowest < mp_deepest)
+    {
+        mp_deepest = p_lowest;
+    }
+    if (level == 0)
+    {
+        if (p_lowest < mp_main_lowest)
+        {
+            mp_main_lowest = p_lowest;
+        }
+    }
+    else if (m_levels[level - 1].painted && p_lowest < m_levels[level - 1].p_lowest)
+    {
+        m_levels[level - 1].p_lowest = p_lowest;
+    }
+
+    paint(p_level->p_window, p_sp);
+    p_level->painted = true;
+    m_entries[context]++;
+}
+
+void mesh_watermark_exit(mesh_watermark_context_t context)
+{
+    uint32_t level = m_level;
+    if (level == 0 || level > LEVELS_MAX || m_levels[level - 1].context != context)
+    {
+        m_mismatches++;
+        return;
+    }
+
+    level_t* p_level = &m_levels[level - 1];
+    uint32_t* p_sp = (uint32_t*) __get_MSP();
+    uint32_t* p_lowest = scan_up(p_level->p_window, p_level->p_sp);
+    if (p_level->p_lowest < p_lowest)
+    {
+        p_lowest = p_level->p_lowest;
+    }
+    if (p_lowest < mp_deepest)
+    {
+        mp_deepest = p_lowest;
+    }
+
+    uint32_t peak = (uint32_t) (p_level->p_sp - p_lowest) * sizeof(uint32_t);
+    if (peak > m_peaks[context])
+    {
+        m_peaks[context] = peak;
+    }
+
+    /* leave the window the way the interrupted context should find it */
+    paint(p_lowest, (p_sp < p_level->p_sp ? p_sp : p_level->p_sp));
+    p_level->painted = false;
+    m_level = level - 1;
+}
+
+void mesh_watermark_fifo_register(fifo_t* p_fifo)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    for (uint32_t i = 0; i < m_fifo_count; ++i)
+    {
+        if (mp_fifos[i] == p_fifo)
+        {
+            _ENABLE_IRQS(was_masked);
+            return;
+        }
+    }
+    if (m_fifo_count < MESH_WATERMARK_FIFOS_MAX)
+    {
+        mp_fifos[m_fifo_count++] = p_fifo;
+    }
+    _ENABLE_IRQS(was_masked);
+}
+
+void mesh_watermark_dump(void)
+{
+    uint32_t* p_sp = (uint32_t*) __get_MSP();
+
+    /* What's left below the main loop was used by main, or by something
+       that doesn't repaint, like the Softdevice. */
+    uint32_t* p_main_lowest = scan_up(STACK_LIMIT, p_sp);
+    if (p_main_lowest < mp_main_lowest)
+    {
+        mp_main_lowest = p_main_lowest;
+    }
+    if (p_main_lowest < mp_deepest)
+    {
+        mp_deepest = p_main_lowest;
+    }
+
+    /* the heap is used from the bottom, and an overflowing stack writes its top */
+    volatile uint32_t* p_heap_top = HEAP_LIMIT;
+    while (p_heap_top > HEAP_BASE && *(p_heap_top - 1) == PAINT)
+    {
+        --p_heap_top;
+    }
+
+    SEGGER_RTT_printf(0, "WATERMARK stack %u/%u%s main %u heap %u/%u\n",
+            (uint32_t) (STACK_TOP - mp_deepest) * sizeof(uint32_t),
+            (uint32_t) (STACK_TOP - STACK_LIMIT) * sizeof(uint32_t),
+            (mp_deepest <= STACK_LIMIT ? " overflow" : ""),
+            (uint32_t) (STACK_TOP - mp_main_lowest) * sizeof(uint32_t),
+            (uint32_t) (p_heap_top - HEAP_BASE) * sizeof(uint32_t),
+            (uint32_t) (HEAP_LIMIT - HEAP_BASE) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < MESH_WATERMARK_CONTEXT__COUNT; ++i)
+    {
+        if (m_entries[i] != 0)
+        {
+            SEGGER_RTT_printf(0, "%s %u%s entries %u\n", m_context_names[i], m_peaks[i],
+                    (m_peaks[i] >= MESH_WATERMARK_WINDOW ? "+" : ""), m_entries[i]);
+        }
+    }
+
+    rbc_mesh_packet_pool_stats_t pool_stats;
+    mesh_packet_pool_stats_get(&pool_stats);
+    SEGGER_RTT_printf(0, "pool %u/%u exhausted %u\n",
+            pool_stats.high_water_mark, pool_stats.size, pool_stats.exhausted_count);
+    for (uint32_t i = 0; i < m_fifo_count; ++i)
+    {
+        SEGGER_RTT_printf(0, "fifo %x %u/%u\n",
+                (uint32_t) mp_fifos[i], mp_fifos[i]->peak_len, mp_fifos[i]->array_len);
+    }
+    SEGGER_RTT_printf(0, "WATERMARK end mismatches %u\n", m_mismatches);
+}
+
+#endif /* MESH_WATERMARK */
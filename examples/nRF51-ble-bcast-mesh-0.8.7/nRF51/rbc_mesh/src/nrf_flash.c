@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ************************************************************************************/
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "nrf_flash.h"
 #ifdef NRF51
 #include "nrf.h"
@@ -74,57 +75,93 @@ void nrf_flash_erase(uint32_t * page_address, uint32_t size)
     }
 }
 
+#ifdef NVMC_ERASEPAGEPARTIALCFG_DURATION_Pos
+void nrf_flash_erase_partial(uint32_t * page_address, uint32_t duration_ms)
+{
+    NRF_NVMC->ERASEPAGEPARTIALCFG = (duration_ms << NVMC_ERASEPAGEPARTIALCFG_DURATION_Pos);
+    NRF_NVMC->CONFIG = (NVMC_CONFIG_WEN_Een << NVMC_CONFIG_WEN_Pos);
+
+    while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+    {
+        // Do nothing.
+    }
+
+    NRF_NVMC->ERASEPAGEPARTIAL = (uint32_t)page_address;
+
+    while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+    {
+        // Do nothing.
+    }
 
-/** @brief Function for filling a page in flash with a value.
+    NRF_NVMC->CONFIG = (NVMC_CONFIG_WEN_Ren << NVMC_CONFIG_WEN_Pos);
+
+    while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+    {
+        // Do nothing.
+    }
+}
+#endif
+
+/** @brief Function for writing a block of data to flash.
+ *
+ * @details Write is enabled once per page rather than once per word. Words
+ * that are all 0xFF are left untouched, and a trailing partial word is
+ * padded with 0xFF, which leaves the flash bytes after the block unchanged.
  *
- * @param[in] address Address of the first word in the page to be filled.
- * @param[in] value Value to be written to flash.
+ * @param[in] p_dest Start of the flash area.
+ * @param[in] p_src Data to write.
+ * @param[in] size Number of bytes to write.
+ * @param[in] offset Word aligned offset into p_dest to write at.
  */
 void nrf_flash_store(uint32_t * p_dest, uint8_t * p_src, uint32_t size, uint32_t offset)
 {
-    static uint8_t buffer[4]  __attribute__((aligned (4)));
-    uint8_t cnt = 0;
-    uint8_t has_content = 0;
+    bool write_enabled = false;
 
     p_dest += offset / 4;
 
-    for(uint32_t i=0; i < size ; i++)
+    for (uint32_t i = 0; i < size; i += 4)
     {
-        has_content |= ~(*p_src);
-        buffer[cnt++]  = *p_src;
-
-        p_src++;
+        /* the source may be unaligned, assemble the word byte by byte */
+        uint32_t word = 0xFFFFFFFF;
+        for (uint32_t j = 0; j < 4 && i + j < size; j++)
+        {
+            word = (word & ~((uint32_t) 0xFF << (8 * j))) | ((uint32_t) p_src[i + j] << (8 * j));
+        }
 
-        if(cnt == 4)
+        if (word != 0xFFFFFFFF)
         {
-            cnt = 0;
-            if (has_content)
+            if (!write_enabled)
             {
                 // Turn on flash write enable and wait until the NVMC is ready:
                 NRF_NVMC->CONFIG = (NVMC_CONFIG_WEN_Wen << NVMC_CONFIG_WEN_Pos);
 
                 while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
                 {
-                // Do nothing.
+                    // Do nothing.
                 }
+                write_enabled = true;
+            }
 
-                *p_dest = *(uint32_t *)buffer;
+            *p_dest = word;
 
-                while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
-                {
-                    // Do nothing.
-                }
+            while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+            {
+                // Do nothing.
+            }
+        }
+        p_dest++;
 
-                // Turn off flash write enable and wait until the NVMC is ready:
-                NRF_NVMC->CONFIG = (NVMC_CONFIG_WEN_Ren << NVMC_CONFIG_WEN_Pos);
+        if (write_enabled &&
+            (((uint32_t) p_dest % NRF_FLASH_PAGE_SIZE) == 0 || i + 4 >= size))
+        {
+            // Turn off flash write enable at the end of each page and wait until the NVMC is ready:
+            NRF_NVMC->CONFIG = (NVMC_CONFIG_WEN_Ren << NVMC_CONFIG_WEN_Pos);
 
-                while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
-                {
-                    // Do nothing.
-                }
+            while (NRF_NVMC->READY == NVMC_READY_READY_Busy)
+            {
+                // Do nothing.
             }
-            has_content = 0;
-            p_dest++;
+            write_enabled = false;
         }
     }
 }
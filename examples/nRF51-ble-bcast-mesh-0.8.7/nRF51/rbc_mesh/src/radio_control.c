@@ -39,6 +39,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "toolchain.h"
 #include "rbc_mesh.h"
 #include "mesh_packet.h"
+#include "mesh_stats.h"
+#ifndef BOOTLOADER
+#include "timer.h"
+#endif
 
 #include <stdbool.h>
 #include <string.h>
@@ -48,12 +52,51 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define LIGHTWEIGHT_RADIO               (1)
 
-#define RADIO_RX_TIMEOUT                (150 + 80)
+/** Let the nRF52 radio ramp up in 40us instead of 140us. */
+#ifdef NRF52
+#define RADIO_FAST_RAMP_UP              (1)
+#else
+#define RADIO_FAST_RAMP_UP              (0)
+#endif
+
+#if RADIO_FAST_RAMP_UP && !defined(RADIO_MODECNF0_RU_Pos)
+/* not in the older nRF52 register headers */
+#define RADIO_MODECNF0_RU_Pos           (0UL)
+#define RADIO_MODECNF0_RU_Msk           (0x1UL << RADIO_MODECNF0_RU_Pos)
+#define RADIO_MODECNF0_RU_Fast          (1UL)
+#endif
+
+/** Time from an enable task to the radio being ready, in microseconds. */
+#if RADIO_FAST_RAMP_UP
+#define RADIO_RAMP_UP_US                (40)
+#else
+#define RADIO_RAMP_UP_US                (150)
+#endif
+
+#define RADIO_RX_TIMEOUT                (RADIO_RAMP_UP_US + 80)
+
+/** Longest packet after the header, the length field of a received packet is capped to this. */
+#define RADIO_PACKET_MAX_LEN            (MESH_PACKET_BLE_OVERHEAD + BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH)
+
+#if RBC_MESH_LONG_PACKETS && !defined(RADIO_PCNF0_S1INCL_Pos)
+/* not in the older nRF52 register headers */
+#define RADIO_PCNF0_S1INCL_Pos          (20UL)
+#define RADIO_PCNF0_S1INCL_Msk          (0x1UL << RADIO_PCNF0_S1INCL_Pos)
+#endif
 
 #define RADIO_EVENT(evt)                (NRF_RADIO->evt == 1)
 
 #define PPI_CH_STOP_RX_ABORT            (TIMER_PPI_CH_START + 4)
 
+/** Let the radio ramp straight from the end of a TX into the next queued
+ * event with the DISABLED_TXEN/RXEN shorts, instead of waiting for the CPU. */
+#define RADIO_CHAINING                  (1)
+
+/** Number of registers in the static configuration snapshot. */
+#define RADIO_CONFIG_REG_COUNT          (6 + RADIO_FAST_RAMP_UP)
+
+#define RADIO_SHORTS_DEFAULT            (RADIO_SHORTS_READY_START_Msk | RADIO_SHORTS_END_DISABLE_Msk | RADIO_SHORTS_ADDRESS_RSSISTART_Msk)
+
 #define DEBUG_RADIO_SET_STATE(state) do {\
     DEBUG_RADIO_CLEAR_PIN(PIN_RADIO_STATE_TX);\
     DEBUG_RADIO_CLEAR_PIN(PIN_RADIO_STATE_RX);\
@@ -85,9 +128,56 @@ static radio_idle_cb_t  m_idle_cb;
 static radio_rx_cb_t    m_rx_cb;
 static radio_tx_cb_t    m_tx_cb;
 static uint32_t         m_alt_aa = RADIO_DEFAULT_ADDRESS;
+static uint32_t         m_backbone_aa = RADIO_DEFAULT_ADDRESS;
+static uint32_t         m_bridge_aa = RADIO_DEFAULT_ADDRESS;
+static bool             m_chained; /** The radio will ramp into the second event in the queue on its own. */
+
+/** Registers holding the configuration that stays the same for all events. */
+static volatile uint32_t* const m_config_regs[RADIO_CONFIG_REG_COUNT] =
+{
+    &NRF_RADIO->PCNF0,
+    &NRF_RADIO->PCNF1,
+    &NRF_RADIO->CRCPOLY,
+    &NRF_RADIO->CRCCNF,
+    &NRF_RADIO->CRCINIT,
+    &NRF_RADIO->TIFS,
+#if RADIO_FAST_RAMP_UP
+    &NRF_RADIO->MODECNF0,
+#endif
+};
+static uint32_t         m_config_snapshot[RADIO_CONFIG_REG_COUNT]; /** Values of m_config_regs after config_set(). */
+#ifndef BOOTLOADER
+static bool             m_ready_measure; /** Measure the ramp-up of the first event in the timeslot, if it's an RX. */
+static bool             m_radio_on;     /** The radio has been enabled, and not disabled since. */
+static timestamp_t      m_radio_on_time; /** When the radio was enabled. */
+#endif
 /*****************************************************************************
 * Static functions
 *****************************************************************************/
+/** Start counting radio time, unless the radio is already on. */
+static inline void radio_on_register(void)
+{
+#ifndef BOOTLOADER
+    if (!m_radio_on)
+    {
+        m_radio_on = true;
+        m_radio_on_time = timer_now();
+    }
+#endif
+}
+
+/** Add the time since the radio was enabled to the stats. */
+static inline void radio_off_register(void)
+{
+#ifndef BOOTLOADER
+    if (m_radio_on)
+    {
+        m_radio_on = false;
+        MESH_STATS_ADD(radio_on_us, TIMER_DIFF(timer_now(), m_radio_on_time));
+    }
+#endif
+}
+
 static void purge_preemptable(void)
 {
     uint32_t events_in_queue = fifo_get_len(&m_radio_fifo);
@@ -135,28 +225,59 @@ static void radio_channel_set(uint8_t ch)
 
 }
 
-static void setup_event(radio_event_t* p_evt)
+/**
+* Get the shorts needed to chain the event at the given queue index into the
+* one after it. Only TX events have a predictable end, and the frequency and
+* TX power can't change during the ramp-up, so only events on the same
+* channel are chained.
+*/
+static uint32_t chain_shorts_get(radio_event_t* p_evt, uint32_t index)
 {
-    NRF_RADIO->SHORTS = RADIO_SHORTS_READY_START_Msk | RADIO_SHORTS_END_DISABLE_Msk | RADIO_SHORTS_ADDRESS_RSSISTART_Msk;
-    radio_channel_set(p_evt->channel);
-    NRF_RADIO->PACKETPTR = (uint32_t) p_evt->packet_ptr;
-    NRF_RADIO->INTENSET = RADIO_INTENSET_END_Msk;
-    NRF_RADIO->EVENTS_END = 0;
-    NRF_RADIO->PREFIX1	= ((m_alt_aa >> 24) & 0x000000FF);
-    NRF_RADIO->BASE1    = ((m_alt_aa <<  8) & 0xFFFFFF00);
+#if RADIO_CHAINING
+    radio_event_t next_evt;
+    if (p_evt->event_type != RADIO_EVENT_TYPE_TX ||
+        fifo_peek_at(&m_radio_fifo, &next_evt, index + 1) != NRF_SUCCESS ||
+        next_evt.channel != p_evt->channel ||
+        next_evt.backbone != p_evt->backbone ||
+        next_evt.bridge != p_evt->bridge)
+    {
+        return 0;
+    }
 
-    if (p_evt->event_type == RADIO_EVENT_TYPE_TX)
+    if (next_evt.event_type == RADIO_EVENT_TYPE_TX)
+    {
+        return (next_evt.tx_power == p_evt->tx_power) ? RADIO_SHORTS_DISABLED_TXEN_Msk : 0;
+    }
+    return RADIO_SHORTS_DISABLED_RXEN_Msk;
+#else
+    return 0;
+#endif
+}
+
+/**
+* Set the per-packet registers of an event. PACKETPTR is double buffered, so
+* this may be done for a chained event while the previous one is running.
+*/
+static void event_registers_set(radio_event_t* p_evt)
+{
+    NRF_RADIO->PACKETPTR = (uint32_t) p_evt->packet_ptr;
+    if (p_evt->backbone || p_evt->bridge)
+    {
+        /* the backbone or bridge address takes the place of logical address 0 */
+        NRF_RADIO->TXADDRESS = 0;
+        NRF_RADIO->RXADDRESSES = 0x01;
+        if (p_evt->event_type == RADIO_EVENT_TYPE_TX)
+        {
+            NRF_RADIO->TXPOWER = p_evt->tx_power;
+        }
+    }
+    else if (p_evt->event_type == RADIO_EVENT_TYPE_TX)
     {
-        DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_TX);
         NRF_RADIO->TXADDRESS = p_evt->access_address;
         NRF_RADIO->TXPOWER  = p_evt->tx_power;
-        NRF_RADIO->TASKS_TXEN = 1;
-        m_radio_state = RADIO_STATE_TX;
-        
     }
     else
     {
-        DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_RX);
         if (m_alt_aa != RADIO_DEFAULT_ADDRESS)
         {
             /* only enable alt-addr if it's different */
@@ -166,18 +287,96 @@ static void setup_event(radio_event_t* p_evt)
         {
             NRF_RADIO->RXADDRESSES = 0x01;
         }
-        NRF_RADIO->TASKS_RXEN = 1;
+    }
+}
+
+/** Update radio state to reflect that the given event has started. */
+static void event_state_set(radio_event_t* p_evt)
+{
+    if (p_evt->event_type == RADIO_EVENT_TYPE_TX)
+    {
+        DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_TX);
+        m_radio_state = RADIO_STATE_TX;
+    }
+    else
+    {
+        DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_RX);
         m_radio_state = RADIO_STATE_RX;
     }
 }
 
-/*****************************************************************************
-* Interface functions
-*****************************************************************************/
+/**
+* Set the mode and the logical address 0 of the bearer of an event. Must be
+* done with the radio disabled.
+*/
+static void bearer_set(radio_event_t* p_evt)
+{
+    uint32_t address = RADIO_DEFAULT_ADDRESS;
+    if (p_evt->backbone)
+    {
+        address = m_backbone_aa;
+    }
+    else if (p_evt->bridge)
+    {
+        address = m_bridge_aa;
+    }
 
-void radio_init(radio_idle_cb_t idle_cb,
-                radio_rx_cb_t   rx_cb,
-                radio_tx_cb_t   tx_cb)
+    NRF_RADIO->MODE     = (((p_evt->backbone ? RADIO_MODE_MODE_Nrf_2Mbit : RADIO_MODE_MODE_Ble_1Mbit)
+                            << RADIO_MODE_MODE_Pos) & RADIO_MODE_MODE_Msk);
+    NRF_RADIO->PREFIX0  = ((NRF_RADIO->PREFIX0 & ~RADIO_PREFIX0_AP0_Msk) | ((address >> 24) & 0x000000FF));
+    NRF_RADIO->BASE0    = ((address <<  8) & 0xFFFFFF00);
+}
+
+static void setup_event(radio_event_t* p_evt)
+{
+    uint32_t chain_shorts = chain_shorts_get(p_evt, 0);
+    m_chained = (chain_shorts != 0);
+    NRF_RADIO->SHORTS = RADIO_SHORTS_DEFAULT | chain_shorts;
+    bearer_set(p_evt);
+    radio_channel_set(p_evt->channel);
+    event_registers_set(p_evt);
+    NRF_RADIO->INTENSET = RADIO_INTENSET_END_Msk;
+    NRF_RADIO->EVENTS_END = 0;
+    NRF_RADIO->PREFIX1	= ((m_alt_aa >> 24) & 0x000000FF);
+    NRF_RADIO->BASE1    = ((m_alt_aa <<  8) & 0xFFFFFF00);
+
+    event_state_set(p_evt);
+#ifndef BOOTLOADER
+    if (m_ready_measure)
+    {
+        m_ready_measure = false;
+        if (p_evt->event_type != RADIO_EVENT_TYPE_TX)
+        {
+            NRF_RADIO->EVENTS_READY = 0;
+            NRF_RADIO->INTENSET = RADIO_INTENSET_READY_Msk;
+        }
+    }
+#endif
+    radio_on_register();
+    if (p_evt->event_type == RADIO_EVENT_TYPE_TX)
+    {
+        NRF_RADIO->TASKS_TXEN = 1;
+    }
+    else
+    {
+        NRF_RADIO->TASKS_RXEN = 1;
+    }
+}
+
+/**
+* Called at the END of a chained event, while the radio ramps up for the next
+* one. Prepares the next event, and chains it further if possible.
+*/
+static void setup_chained_event(radio_event_t* p_evt)
+{
+    event_registers_set(p_evt);
+    uint32_t chain_shorts = chain_shorts_get(p_evt, 1);
+    m_chained = (chain_shorts != 0);
+    NRF_RADIO->SHORTS = RADIO_SHORTS_DEFAULT | chain_shorts;
+}
+
+/** Reset the radio, and set up the configuration that stays the same for all events. */
+static void config_set(void)
 {
     /* Reset all states in the radio peripheral */
     NRF_RADIO->POWER            = ((RADIO_POWER_POWER_Disabled << RADIO_POWER_POWER_Pos) & RADIO_POWER_POWER_Msk);
@@ -200,15 +399,27 @@ void radio_init(radio_idle_cb_t idle_cb,
     NRF_RADIO->RXADDRESSES  = 0x01;				// Enable reception on logical address 0 (PREFIX0 + BASE0)
 
     /* PCNF-> Packet Configuration. Now we need to configure the sizes S0, S1 and length field to match the datapacket format of the advertisement packets. */
+#if RBC_MESH_LONG_PACKETS
+    /* Let the length field take the two RFU bits after it. On air, this is
+     * the same header as a legacy advertisement, but the radio no longer
+     * stores an S1 byte unless told to, and the RAM layout has to stay. */
+    NRF_RADIO->PCNF0 =  (
+                          (((1UL) << RADIO_PCNF0_S0LEN_Pos) & RADIO_PCNF0_S0LEN_Msk)    // length of S0 field in bytes 0-1.
+                        | (((0UL) << RADIO_PCNF0_S1LEN_Pos) & RADIO_PCNF0_S1LEN_Msk)    // length of S1 field in bits 0-8.
+                        | (((8UL) << RADIO_PCNF0_LFLEN_Pos) & RADIO_PCNF0_LFLEN_Msk)    // length of length field in bits 0-8.
+                        | (((1UL) << RADIO_PCNF0_S1INCL_Pos) & RADIO_PCNF0_S1INCL_Msk)  // always include S1 in RAM.
+                      );
+#else
     NRF_RADIO->PCNF0 =  (
                           (((1UL) << RADIO_PCNF0_S0LEN_Pos) & RADIO_PCNF0_S0LEN_Msk)    // length of S0 field in bytes 0-1.
                         | (((2UL) << RADIO_PCNF0_S1LEN_Pos) & RADIO_PCNF0_S1LEN_Msk)    // length of S1 field in bits 0-8.
                         | (((6UL) << RADIO_PCNF0_LFLEN_Pos) & RADIO_PCNF0_LFLEN_Msk)    // length of length field in bits 0-8.
                       );
+#endif
 
     /* Packet configuration */
     NRF_RADIO->PCNF1 =  (
-                          (((37UL)                          << RADIO_PCNF1_MAXLEN_Pos)  & RADIO_PCNF1_MAXLEN_Msk)   // maximum length of payload in bytes [0-255]
+                          (((RADIO_PACKET_MAX_LEN)          << RADIO_PCNF1_MAXLEN_Pos)  & RADIO_PCNF1_MAXLEN_Msk)   // maximum length of payload in bytes [0-255]
                         | (((0UL)                           << RADIO_PCNF1_STATLEN_Pos) & RADIO_PCNF1_STATLEN_Msk)	// expand the payload with N bytes in addition to LENGTH [0-255]
                         | (((3UL)                           << RADIO_PCNF1_BALEN_Pos)   & RADIO_PCNF1_BALEN_Msk)    // base address length in number of bytes.
                         | (((RADIO_PCNF1_ENDIAN_Little)     << RADIO_PCNF1_ENDIAN_Pos)  & RADIO_PCNF1_ENDIAN_Msk)   // endianess of the S0, LENGTH, S1 and PAYLOAD fields.
@@ -224,6 +435,65 @@ void radio_init(radio_idle_cb_t idle_cb,
     /* Lock interframe spacing, so that the radio won't send too soon / start RX too early */
     NRF_RADIO->TIFS = 148;
 
+#if RADIO_FAST_RAMP_UP
+    /* TIFS is only qualified for the default ramp-up, chained events may
+       follow each other sooner than that. */
+    NRF_RADIO->MODECNF0 = ((RADIO_MODECNF0_RU_Fast << RADIO_MODECNF0_RU_Pos) & RADIO_MODECNF0_RU_Msk);
+#endif
+
+    for (uint32_t i = 0; i < RADIO_CONFIG_REG_COUNT; ++i)
+    {
+        m_config_snapshot[i] = *m_config_regs[i];
+    }
+}
+
+/**
+* Check whether the radio still holds the configuration set by config_set(),
+* which it won't if the Softdevice or anyone else has used it in between our
+* timeslots. Registers that are set for every event aren't checked.
+*/
+static bool config_is_intact(void)
+{
+    if (NRF_RADIO->POWER != RADIO_POWER_POWER_Enabled ||
+        NRF_RADIO->STATE != RADIO_STATE_STATE_Disabled ||
+        (NRF_RADIO->PREFIX0 & ~RADIO_PREFIX0_AP0_Msk) != 0)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < RADIO_CONFIG_REG_COUNT; ++i)
+    {
+        if (*m_config_regs[i] != m_config_snapshot[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+
+void radio_init(radio_idle_cb_t idle_cb,
+                radio_rx_cb_t   rx_cb,
+                radio_tx_cb_t   tx_cb)
+{
+    if (m_radio_state == RADIO_STATE_NEVER_USED || !config_is_intact())
+    {
+        config_set();
+    }
+    else
+    {
+        /* Nobody else has used the radio since our last timeslot, only clear
+           what the last event left behind. */
+        NRF_RADIO->SHORTS = 0;
+        NRF_RADIO->INTENCLR = 0xFFFFFFFF;
+        NRF_RADIO->EVENTS_READY = 0;
+        NRF_RADIO->EVENTS_RSSIEND = 0;
+        MESH_STATS_INC(radio_warm_starts);
+    }
+
     /* init radio packet fifo */
     if (m_radio_state == RADIO_STATE_NEVER_USED)
     {
@@ -237,6 +507,9 @@ void radio_init(radio_idle_cb_t idle_cb,
 
     m_radio_state = RADIO_STATE_DISABLED;
     NRF_RADIO->EVENTS_END = 0;
+#ifndef BOOTLOADER
+    m_ready_measure = true;
+#endif
 
     NVIC_ClearPendingIRQ(RADIO_IRQn);
     NVIC_EnableIRQ(RADIO_IRQn);
@@ -265,6 +538,16 @@ void radio_alt_aa_set(uint32_t access_address)
     m_alt_aa = access_address;
 }
 
+void radio_backbone_aa_set(uint32_t access_address)
+{
+    m_backbone_aa = access_address;
+}
+
+void radio_bridge_aa_set(uint32_t access_address)
+{
+    m_bridge_aa = access_address;
+}
+
 uint32_t radio_order(radio_event_t* p_radio_event)
 {
     if (p_radio_event == NULL)
@@ -280,6 +563,7 @@ uint32_t radio_order(radio_event_t* p_radio_event)
 
     if (fifo_push(&m_radio_fifo, p_radio_event) != NRF_SUCCESS)
     {
+        MESH_STATS_INC(radio_queue_drop);
         return NRF_ERROR_NO_MEM;
     }
 
@@ -294,12 +578,19 @@ uint32_t radio_order(radio_event_t* p_radio_event)
     return NRF_SUCCESS;
 }
 
+uint32_t radio_queue_len_get(void)
+{
+    return fifo_get_len(&m_radio_fifo);
+}
+
 void radio_disable(void)
 {
+    m_chained = false;
     NRF_RADIO->SHORTS = 0;
     NRF_RADIO->INTENCLR = 0xFFFFFFFF;
     NRF_RADIO->TASKS_DISABLE = 1;
     m_radio_state = RADIO_STATE_DISABLED;
+    radio_off_register();
     DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_IDLE);
 }
 
@@ -308,6 +599,23 @@ void radio_disable(void)
 */
 void radio_event_handler(void)
 {
+#ifndef BOOTLOADER
+    if (NRF_RADIO->EVENTS_READY &&
+        (NRF_RADIO->INTENSET & RADIO_INTENSET_READY_Msk))
+    {
+        /* first RX of the timeslot is ready to receive */
+        NRF_RADIO->INTENCLR = RADIO_INTENCLR_READY_Msk;
+        NRF_RADIO->EVENTS_READY = 0;
+        uint32_t ready_time = TIMER_DIFF(timer_now(), timeslot_start_time_get());
+        if (ready_time > UINT16_MAX)
+        {
+            ready_time = UINT16_MAX;
+        }
+        MESH_STATS_SET(rx_ready_us, ready_time);
+        MESH_STATS_MAX(rx_ready_us_max, ready_time);
+    }
+#endif
+
     if (NRF_RADIO->EVENTS_END)
     {
         bool crc_status = NRF_RADIO->CRCSTATUS;
@@ -321,8 +629,22 @@ void radio_event_handler(void)
         }
 
         radio_event_t prev_evt;
+        radio_event_t chained_evt;
         NRF_RADIO->EVENTS_END = 0;
 
+        /* The radio is already on its way into the next event, set it up
+           before anything else, to be done before the ramp-up completes. */
+        bool is_chained = (m_chained &&
+            fifo_peek_at(&m_radio_fifo, &chained_evt, 1) == NRF_SUCCESS);
+        if (is_chained)
+        {
+            setup_chained_event(&chained_evt);
+        }
+        else
+        {
+            m_chained = false;
+        }
+
         /* pop the event that just finished */
         uint32_t error_code = fifo_pop(&m_radio_fifo, &prev_evt);
         APP_ERROR_CHECK(error_code);
@@ -338,8 +660,16 @@ void radio_event_handler(void)
             m_tx_cb(prev_evt.packet_ptr);
         }
 
-        DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_IDLE);
-        m_radio_state = RADIO_STATE_DISABLED;
+        if (is_chained)
+        {
+            event_state_set(&chained_evt);
+        }
+        else
+        {
+            DEBUG_RADIO_SET_STATE(PIN_RADIO_STATE_IDLE);
+            m_radio_state = RADIO_STATE_DISABLED;
+            radio_off_register();
+        }
     }
     else
     {
@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ************************************************************************************/
 #include "rand.h"
 
+#include <stdbool.h>
 #include <nrf_error.h>
 
 #ifndef __linux__
@@ -44,6 +45,25 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ROT(x,k) (((x)<<(k))|((x)>>(32-(k)))) /** PRNG cyclic leftshift */
 #define SMALL_PRNG_BASE_SEED    (0xf1ea5eed)  /** Base seed for PRNG, defined by the author of the generator. */
 /*****************************************************************************
+* Static globals
+*****************************************************************************/
+static prng_t               m_prng;             /** Shared PRNG instance. */
+static bool                 m_prng_seeded;
+static volatile uint32_t    m_entropy;          /** HW RNG word waiting to be mixed into the shared instance. */
+static volatile bool        m_entropy_ready;
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+/** Mix entropy collected by rand_refill() into the shared instance. */
+static void entropy_mix(void)
+{
+    if (m_entropy_ready)
+    {
+        m_prng.a ^= m_entropy;
+        m_entropy_ready = false;
+    }
+}
+/*****************************************************************************
 * Interface functions
 *****************************************************************************/
 uint32_t rand_prng_seed(prng_t* p_prng)
@@ -83,8 +103,85 @@ uint32_t rand_prng_get(prng_t* p_prng)
     return p_prng->d;
 }
 
+uint32_t rand_prng_range(prng_t* p_prng, uint32_t range)
+{
+    /* Lemire's multiply-shift, only divides when the value lands in the biased zone. */
+    uint64_t product = (uint64_t) rand_prng_get(p_prng) * range;
+    if ((uint32_t) product < range)
+    {
+        uint32_t threshold = (0 - range) % range;
+        while ((uint32_t) product < threshold)
+        {
+            product = (uint64_t) rand_prng_get(p_prng) * range;
+        }
+    }
+    return (uint32_t) (product >> 32);
+}
+
+uint32_t rand_init(void)
+{
+    if (m_prng_seeded)
+    {
+        return NRF_SUCCESS;
+    }
+    uint32_t error_code = rand_prng_seed(&m_prng);
+    if (error_code == NRF_SUCCESS)
+    {
+        m_prng_seeded = true;
+    }
+    return error_code;
+}
+
+uint32_t rand_get(void)
+{
+    entropy_mix();
+    return rand_prng_get(&m_prng);
+}
+
+uint32_t rand_range(uint32_t range)
+{
+    entropy_mix();
+    return rand_prng_range(&m_prng, range);
+}
+
 #ifndef __linux__ /* TODO: Add Windows random generator for software testing on windows */
 
+void rand_refill(void)
+{
+    if (m_entropy_ready)
+    {
+        return;
+    }
+#ifdef SOFTDEVICE_PRESENT
+    uint8_t bytes_available = 0;
+    uint32_t entropy;
+    sd_rand_application_bytes_available_get(&bytes_available);
+    if (bytes_available >= sizeof(entropy) &&
+        sd_rand_application_vector_get((uint8_t*) &entropy, sizeof(entropy)) == NRF_SUCCESS)
+    {
+        m_entropy = entropy;
+        m_entropy_ready = true;
+    }
+#else
+    static uint32_t entropy;
+    static uint8_t count;
+    if (NRF_RNG->EVENTS_VALRDY)
+    {
+        entropy = (entropy << 8) | NRF_RNG->VALUE;
+        NRF_RNG->EVENTS_VALRDY = 0;
+        if (++count == sizeof(entropy))
+        {
+            NRF_RNG->TASKS_STOP = 1;
+            count = 0;
+            m_entropy = entropy;
+            m_entropy_ready = true;
+            return;
+        }
+    }
+    NRF_RNG->TASKS_START = 1;
+#endif
+}
+
 uint32_t rand_hw_rng_get(uint8_t* p_result, uint16_t len)
 {
 #ifdef SOFTDEVICE_PRESENT
@@ -127,6 +224,16 @@ uint32_t rand_hw_rng_get(uint8_t* p_result, uint16_t len)
 }
 
 #else
+void rand_refill(void)
+{
+    uint32_t entropy;
+    if (!m_entropy_ready && rand_hw_rng_get((uint8_t*) &entropy, sizeof(entropy)) == NRF_SUCCESS)
+    {
+        m_entropy = entropy;
+        m_entropy_ready = true;
+    }
+}
+
 uint32_t rand_hw_rng_get(uint8_t * p_result, uint16_t len)
 {
     int random_file = open("/dev/random", O_RDONLY);
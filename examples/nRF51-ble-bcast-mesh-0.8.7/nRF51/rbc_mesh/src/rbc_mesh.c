@@ -32,13 +32,31 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "rbc_mesh_common.h"
 #include "timeslot.h"
 #include "timer_scheduler.h"
+#include "timebase.h"
 #include "event_handler.h"
 #include "version_handler.h"
 #include "transport_control.h"
 #include "mesh_packet.h"
+#include "mesh_stats.h"
+#include "mesh_trace.h"
+#include "mesh_watermark.h"
 #include "mesh_gatt.h"
+#include "mesh_object.h"
+#include "mesh_scene.h"
+#include "mesh_coex.h"
+#include "mesh_survey.h"
+#include "mesh_digest.h"
+#include "mesh_report.h"
+#include "mesh_time.h"
+#include "mesh_probe.h"
+#include "mesh_auth.h"
+#include "mesh_neighbour.h"
+#include "mesh_powerfail.h"
+#include "mesh_faultlog.h"
+#include "mesh_freertos.h"
 #include "dfu_app.h"
 #include "fifo.h"
+#include "rand.h"
 
 #include "app_error.h"
 #include "nrf_sdm.h"
@@ -54,35 +72,60 @@ static uint8_t          m_channel;
 static uint32_t         m_interval_min_ms;
 static fifo_t           m_rbc_event_fifo;
 static rbc_mesh_event_t m_rbc_event_buffer[RBC_MESH_APP_EVENT_QUEUE_LENGTH];
+static rbc_mesh_event_t* mp_acquired_event; /* event handed out in place by rbc_mesh_event_acquire */
+static rbc_mesh_event_cb_t m_event_cb;      /* direct event delivery, see rbc_mesh_event_cb_set */
+static bool             m_in_event_cb;      /* the application is handling an event in m_event_cb */
 
 /*****************************************************************************
 * Static Functions
 *****************************************************************************/
-#if defined(WITH_ACK_MASTER) 
-static uint32_t top_queue_counter[4] __attribute__((at(0x20002F98)))={0};
-static uint32_t top_queue_drop __attribute__((at(0x20002FA8))) =0;
-#endif
-
-#if defined (WITHOUT_ACK_MASTER)
-static uint32_t top_queue_counter[4] __attribute__((at(0x200026B4))) ={0};
-static uint32_t top_queue_drop __attribute__((at(0x200026C4))) =0;
-#endif
-
-#if defined(WITH_ACK_SLAVE)
-static uint32_t top_queue_counter[4] __attribute__((at(0x200026A0)))  ={0};
-static uint32_t top_queue_drop __attribute__((at(0x200026B0)))  =0;
+#if RBC_MESH_APP_EVENT_COALESCE
+/**
+* Replace a pending update of the same handle with the given one, adding up
+* their version deltas. The oldest event is left alone, as the application
+* may be holding it or a copy of it.
+*
+* @return Whether the event took the place of a pending one.
+*/
+static bool event_coalesce(rbc_mesh_event_t* p_event)
+{
+    bool coalesced = false;
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    for (uint32_t i = fifo_get_len(&m_rbc_event_fifo); i-- > 1; )
+    {
+        rbc_mesh_event_t* p_pending = (rbc_mesh_event_t*) fifo_peek_ptr_at(&m_rbc_event_fifo, i);
+        if (p_pending->type == RBC_MESH_EVENT_TYPE_UPDATE_VAL &&
+            p_pending->params.rx.value_handle == p_event->params.rx.value_handle)
+        {
+            if (p_event->params.rx.p_data != NULL)
+            {
+                mesh_packet_ref_count_inc((mesh_packet_t*) p_event->params.rx.p_data);
+            }
+            if (p_pending->params.rx.p_data != NULL)
+            {
+                mesh_packet_ref_count_dec((mesh_packet_t*) p_pending->params.rx.p_data);
+            }
+            uint16_t version_delta = p_pending->params.rx.version_delta + p_event->params.rx.version_delta;
+            *p_pending = *p_event;
+            p_pending->params.rx.version_delta = version_delta;
+            MESH_STATS_INC(app_events_coalesced);
+            coalesced = true;
+            break;
+        }
+    }
+    _ENABLE_IRQS(was_masked);
+    return coalesced;
+}
 #endif
 
-#if defined(WITHOUT_ACK_SLAVE)
-static uint32_t top_queue_counter[4] __attribute__((at(0x200026A0)))  ={0};
-static uint32_t top_queue_drop __attribute__((at(0x200026B0))) =0;
-#endif
 /*****************************************************************************
 * Interface Functions
 *****************************************************************************/
 
 uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
 {
+#ifdef SOFTDEVICE_PRESENT
     uint8_t sd_is_enabled = 0;
     sd_softdevice_is_enabled(&sd_is_enabled);
 
@@ -90,6 +133,7 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
     {
         return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
     }
+#endif
 
     if (m_mesh_state != MESH_STATE_UNINITIALIZED)
     {
@@ -102,9 +146,29 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
         return NRF_ERROR_INVALID_PARAM;
     }
 
+#if RBC_MESH_LONG_PACKETS
+    if (init_params.access_addr == RBC_MESH_ACCESS_ADDRESS_BLE_ADV)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+#endif
+
     timer_sch_init();
     event_handler_init();
+    mesh_stats_init();
+    mesh_coex_init();
+    mesh_trace_init();
+    mesh_watermark_init();
     mesh_packet_init();
+    mesh_object_init();
+    mesh_scene_init();
+    mesh_survey_init();
+    mesh_digest_init();
+    mesh_report_init();
+    mesh_time_init();
+    mesh_probe_init();
+    mesh_auth_init();
+    mesh_neighbour_init(init_params.tx_power);
     tc_init(init_params.access_addr, init_params.channel);
 
 
@@ -118,6 +182,7 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
         return error_code;
     }
 
+#ifdef SOFTDEVICE_PRESENT
     ble_enable_params_t ble_enable;
     memset(&ble_enable, 0, sizeof(ble_enable));
     ble_enable.gatts_enable_params.attr_tab_size = BLE_GATTS_ATTR_TAB_SIZE_DEFAULT;
@@ -135,6 +200,7 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
     {
         return error_code;
     }
+#endif
 
     error_code = mesh_gatt_init(init_params.access_addr, init_params.channel, init_params.interval_min_ms);
     if (error_code != NRF_SUCCESS)
@@ -142,6 +208,18 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
         return error_code;
     }
 
+#ifdef MESH_POWERFAIL
+    error_code = mesh_powerfail_init();
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+#endif
+
+#ifdef MESH_FAULTLOG
+    mesh_faultlog_init();
+#endif
+
     timeslot_init(init_params.lfclksrc);
 
     m_access_addr = init_params.access_addr;
@@ -155,7 +233,10 @@ uint32_t rbc_mesh_init(rbc_mesh_init_params_t init_params)
     m_rbc_event_fifo.elem_size = sizeof(rbc_mesh_event_t);
     m_rbc_event_fifo.memcpy_fptr = NULL;
     fifo_init(&m_rbc_event_fifo);
+    mp_acquired_event = NULL;
+    m_event_cb = NULL;
     timeslot_resume();
+    (void) vh_sync_start(); /* best effort, the values come in with the regular intervals anyway */
 
 #ifdef MESH_DFU
     return dfu_init();
@@ -176,6 +257,7 @@ uint32_t rbc_mesh_start(void)
         return NRF_ERROR_INVALID_STATE;
     }
     timeslot_resume();
+    (void) vh_sync_start();
 
     m_mesh_state = MESH_STATE_RUNNING;
 
@@ -228,6 +310,88 @@ uint32_t rbc_mesh_persistence_set(rbc_mesh_value_handle_t handle, bool persisten
     return vh_value_persistence_set(handle, persistent);
 }
 
+uint32_t rbc_mesh_flag_set_bulk(const rbc_mesh_flag_op_t* p_ops, uint32_t count, uint32_t* p_applied_count)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_ops == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (p_applied_count != NULL)
+    {
+        *p_applied_count = 0;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (p_ops[i].handle > RBC_MESH_APP_MAX_HANDLE)
+        {
+            return NRF_ERROR_INVALID_ADDR;
+        }
+    }
+    return vh_flag_set_bulk(p_ops, count, p_applied_count);
+}
+
+uint32_t rbc_mesh_flag_set_range(rbc_mesh_value_handle_t first, rbc_mesh_value_handle_t last, rbc_mesh_handle_flag_t flag, bool value)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (last > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return vh_flag_set_range(first, last, flag, value);
+}
+
+uint32_t rbc_mesh_qos_set(rbc_mesh_value_handle_t handle, rbc_mesh_qos_class_t qos_class)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (qos_class >= RBC_MESH_QOS_CLASS__COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    return vh_value_qos_set(handle, qos_class);
+}
+
+uint32_t rbc_mesh_qos_get(rbc_mesh_value_handle_t handle, rbc_mesh_qos_class_t* p_qos_class)
+{
+    if (handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return vh_value_qos_get(handle, p_qos_class);
+}
+
+uint32_t rbc_mesh_handle_stats_get(rbc_mesh_value_handle_t handle, rbc_mesh_handle_stats_t* p_stats)
+{
+    if (handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return vh_value_stats_get(handle, p_stats);
+}
+
+uint32_t rbc_mesh_subscription_set(const rbc_mesh_handle_range_t* p_ranges, uint8_t count)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return vh_subscription_set(p_ranges, count);
+}
+
 uint32_t rbc_mesh_tx_event_set(rbc_mesh_value_handle_t handle, bool do_tx_event)
 {
     if (m_mesh_state == MESH_STATE_UNINITIALIZED)
@@ -261,6 +425,111 @@ uint32_t rbc_mesh_value_set(rbc_mesh_value_handle_t handle, uint8_t* data, uint1
     return vh_local_update(handle, data, len);
 }
 
+uint32_t rbc_mesh_value_set_bulk(const rbc_mesh_value_t* p_values, uint32_t count, uint32_t* p_success_mask)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_values == NULL || p_success_mask == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (p_values[i].handle > RBC_MESH_APP_MAX_HANDLE)
+        {
+            *p_success_mask = 0;
+            return NRF_ERROR_INVALID_ADDR;
+        }
+    }
+
+    uint32_t error_code = vh_local_update_bulk(p_values, count, p_success_mask);
+
+    /* no critical errors if these calls fail, ignore return */
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (*p_success_mask & (1 << i))
+        {
+            mesh_gatt_value_set(p_values[i].handle, p_values[i].p_data, p_values[i].length);
+        }
+    }
+
+    return error_code;
+}
+
+uint32_t rbc_mesh_object_set(uint16_t object_id, const uint8_t* p_data, uint16_t length)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return mesh_object_set(object_id, p_data, length);
+}
+
+uint32_t rbc_mesh_scene_action_set(uint16_t scene_id, rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_data == NULL && length > 0)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return mesh_scene_action_set(scene_id, handle, p_data, length);
+}
+
+uint32_t rbc_mesh_scene_action_clear(uint16_t scene_id, rbc_mesh_value_handle_t handle)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return mesh_scene_action_clear(scene_id, handle);
+}
+
+uint32_t rbc_mesh_scene_recall(uint16_t scene_id)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (RBC_MESH_SCENE_ACTIONS_MAX == 0)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    uint8_t data[2] = {scene_id & 0xFF, scene_id >> 8};
+
+    /* no critical errors if this call fails, ignore return */
+    mesh_gatt_value_set(RBC_MESH_SCENE_HANDLE, data, sizeof(data));
+
+    return vh_local_update(RBC_MESH_SCENE_HANDLE, data, sizeof(data));
+}
+
+uint32_t rbc_mesh_scene_recall_at(uint16_t scene_id, uint32_t time_us)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (RBC_MESH_SCENE_ACTIONS_MAX == 0 || RBC_MESH_TIME_SYNC == 0)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    uint8_t data[6] = {scene_id & 0xFF, scene_id >> 8,
+                       time_us & 0xFF, (time_us >> 8) & 0xFF, (time_us >> 16) & 0xFF, time_us >> 24};
+
+    /* no critical errors if this call fails, ignore return */
+    mesh_gatt_value_set(RBC_MESH_SCENE_HANDLE, data, sizeof(data));
+
+    return vh_local_update(RBC_MESH_SCENE_HANDLE, data, sizeof(data));
+}
+
 uint32_t rbc_mesh_value_get(rbc_mesh_value_handle_t handle, uint8_t* data, uint16_t* len)
 {
     if (handle > RBC_MESH_APP_MAX_HANDLE)
@@ -270,6 +539,40 @@ uint32_t rbc_mesh_value_get(rbc_mesh_value_handle_t handle, uint8_t* data, uint1
     return vh_value_get(handle, data, len);
 }
 
+uint32_t rbc_mesh_value_read(rbc_mesh_value_handle_t handle, uint8_t* data, uint16_t* len, uint16_t* p_version)
+{
+    if (handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return vh_value_read(handle, data, len, p_version);
+}
+
+uint32_t rbc_mesh_value_peek(rbc_mesh_value_handle_t handle, const uint8_t** pp_data, uint16_t* p_len, uint32_t* p_token)
+{
+    if (handle > RBC_MESH_APP_MAX_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    return vh_value_peek(handle, pp_data, p_len, p_token);
+}
+
+uint32_t rbc_mesh_value_peek_check(uint32_t token)
+{
+    return vh_value_peek_check(token);
+}
+
+uint32_t rbc_mesh_value_next(uint16_t* p_cursor, rbc_mesh_value_handle_t* p_handle, uint8_t* data, uint16_t* len, uint16_t* p_version)
+{
+    uint32_t error_code;
+    do
+    {
+        /* the framework's own handles aren't shown to the application */
+        error_code = vh_value_next(p_cursor, p_handle, data, len, p_version);
+    } while (error_code == NRF_SUCCESS && *p_handle > RBC_MESH_APP_MAX_HANDLE);
+    return error_code;
+}
+
 uint32_t rbc_mesh_access_address_get(uint32_t* access_address)
 {
     if (m_mesh_state == MESH_STATE_UNINITIALIZED)
@@ -324,122 +627,589 @@ uint32_t rbc_mesh_tx_event_flag_get(rbc_mesh_value_handle_t handle, bool* is_doi
     return vh_tx_event_flag_get(handle, is_doing_tx_event);
 }
 
-void rbc_mesh_tx_power_set(rbc_mesh_txpower_t tx_power)
-{
-    vh_tx_power_set(tx_power);
-}
-
-
-void rbc_mesh_ble_evt_handler(ble_evt_t* p_evt)
+uint32_t rbc_mesh_power_mode_set(rbc_mesh_power_mode_t power_mode)
 {
     if (m_mesh_state == MESH_STATE_UNINITIALIZED)
     {
-        return;
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (power_mode >= RBC_MESH_POWER_MODE__COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
     }
 
-    mesh_gatt_sd_ble_event_handle(p_evt);
-}
+    timeslot_low_power_set(power_mode != RBC_MESH_POWER_MODE_NORMAL);
+    vh_leaf_set(power_mode == RBC_MESH_POWER_MODE_LEAF);
 
-void rbc_mesh_sd_evt_handler(uint32_t sd_evt)
-{
-    timeslot_sd_event_handler(sd_evt);
-	
+    return NRF_SUCCESS;
 }
 
-/** Internal only function to push mesh events to application queue. */
-uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_event)
+uint32_t rbc_mesh_adv_channel_map_set(uint8_t adv_channel_map)
 {
     if (m_mesh_state == MESH_STATE_UNINITIALIZED)
     {
         return NRF_ERROR_INVALID_STATE;
     }
-    if (p_event == NULL)
+    if (adv_channel_map & ~RBC_MESH_ADV_CHANNEL_ALL)
     {
-        return NRF_ERROR_NULL;
+        return NRF_ERROR_INVALID_PARAM;
     }
-    
-    uint32_t error_code = fifo_push(&m_rbc_event_fifo, p_event);
-    
-    #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)|| defined (WITH_ACK_SLAVE)|| defined (WITHOUT_ACK_SLAVE)
-    
-    
-		
-		if (error_code != NRF_SUCCESS)
-			   top_queue_drop++;
-		
-		 switch (p_event->type)
-         {
-            case RBC_MESH_EVENT_TYPE_NEW_VAL:
-					top_queue_counter[0]++;
-				    break;
-						
-            case RBC_MESH_EVENT_TYPE_UPDATE_VAL:
-					top_queue_counter[1]++;
-					break;
-            case RBC_MESH_EVENT_TYPE_CONFLICTING_VAL:
-					top_queue_counter[2]++;
-				    break;
-			case RBC_MESH_EVENT_TYPE_TX:
-					top_queue_counter[3]++;
-					break;
-						
-			default:
-					break;
-		}
-         
-      #endif
-        
-    
 
-    if (error_code == NRF_SUCCESS && p_event->params.rx.p_data != NULL)
-    {
-        switch (p_event->type)
-        {
-            case RBC_MESH_EVENT_TYPE_NEW_VAL:
-            case RBC_MESH_EVENT_TYPE_UPDATE_VAL:
-            case RBC_MESH_EVENT_TYPE_CONFLICTING_VAL:
-                if (p_event->params.rx.p_data)
-                {
-                    mesh_packet_ref_count_inc((mesh_packet_t*) p_event->params.rx.p_data); /* will be aligned by packet manager */
-                }
-                break;
-            case RBC_MESH_EVENT_TYPE_TX:
-                if (p_event->params.tx.p_data)
-                {
-                    mesh_packet_ref_count_inc((mesh_packet_t*) p_event->params.tx.p_data); /* will be aligned by packet manager */
-                }
-                break;
-            default:
-                break;
-        }
-    }
-    return error_code;
+    tc_adv_channel_map_set(adv_channel_map);
+    vh_adv_channel_map_set(adv_channel_map);
+
+    return NRF_SUCCESS;
 }
 
-uint32_t rbc_mesh_event_get(rbc_mesh_event_t* p_evt)
+uint32_t rbc_mesh_survey_start(uint32_t interval_ms)
 {
     if (m_mesh_state == MESH_STATE_UNINITIALIZED)
     {
         return NRF_ERROR_INVALID_STATE;
     }
-    if (fifo_pop(&m_rbc_event_fifo, p_evt) != NRF_SUCCESS)
+    if (interval_ms < 100 || interval_ms > 60000)
     {
-        return NRF_ERROR_NOT_FOUND;
+        return NRF_ERROR_INVALID_PARAM;
     }
 
+    mesh_survey_start(interval_ms * 1000); /* ms -> us */
+
     return NRF_SUCCESS;
 }
 
-uint32_t rbc_mesh_event_peek(rbc_mesh_event_t* p_evt)
+uint32_t rbc_mesh_survey_stop(void)
 {
     if (m_mesh_state == MESH_STATE_UNINITIALIZED)
     {
         return NRF_ERROR_INVALID_STATE;
     }
-    if (p_evt == NULL)
-    {
-        return NRF_ERROR_NULL;
-    }
+
+    mesh_survey_stop();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_digest_start(uint32_t interval_ms)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (interval_ms < 100 || interval_ms > 60000)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    mesh_digest_start(interval_ms * 1000); /* ms -> us */
+
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_digest_stop(void)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    mesh_digest_stop();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_survey_entry_get(uint8_t index, rbc_mesh_survey_entry_t* p_entry)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_entry == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    return mesh_survey_entry_get(index, p_entry);
+}
+
+uint32_t rbc_mesh_survey_reset(void)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    mesh_survey_reset();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_backbone_set(bool enabled, uint32_t access_address, uint8_t channel)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (enabled)
+    {
+        if (channel > 39)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+        if (access_address == RBC_MESH_ACCESS_ADDRESS_BLE_ADV)
+        {
+            return NRF_ERROR_INVALID_ADDR;
+        }
+    }
+
+    tc_backbone_set(enabled, access_address, channel);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_report_gateway_set(bool gateway)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return mesh_report_gateway_set(gateway);
+}
+
+uint32_t rbc_mesh_report_submit(uint8_t zone, int16_t value)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return mesh_report_submit(zone, value);
+}
+
+uint32_t rbc_mesh_report_hops_get(uint8_t* p_hops)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_hops == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return mesh_report_hops_get(p_hops);
+}
+
+uint32_t rbc_mesh_time_root_set(bool root)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return mesh_time_root_set(root);
+}
+
+uint32_t rbc_mesh_time_get(uint32_t* p_time_us)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_time_us == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return mesh_time_get(timer_now(), p_time_us);
+}
+
+uint32_t rbc_mesh_timestamp_get(uint64_t* p_time_us)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_time_us == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    *p_time_us = timebase_now();
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_timestamp_extend(uint32_t timestamp_us, uint64_t* p_time_us)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_time_us == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    *p_time_us = timebase_extend(timestamp_us);
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_probe_start(uint16_t target, uint32_t interval_ms)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (interval_ms == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return mesh_probe_start(target, interval_ms * 1000); /* ms -> us */
+}
+
+uint32_t rbc_mesh_probe_stop(void)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return mesh_probe_stop();
+}
+
+uint32_t rbc_mesh_probe_stats_get(uint8_t index, rbc_mesh_probe_stats_t* p_stats)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    return mesh_probe_stats_get(index, p_stats);
+}
+
+uint32_t rbc_mesh_probe_reset(void)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return mesh_probe_reset();
+}
+
+uint32_t rbc_mesh_powerfail_state_set(const uint8_t* p_data, uint8_t length)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_data == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+#ifdef MESH_POWERFAIL
+    return mesh_powerfail_state_set(p_data, length);
+#else
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+uint32_t rbc_mesh_powerfail_state_get(uint8_t* p_data, uint8_t* p_length)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_data == NULL || p_length == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+#ifdef MESH_POWERFAIL
+    return mesh_powerfail_state_get(p_data, p_length);
+#else
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+uint32_t rbc_mesh_fault_capture(rbc_mesh_fault_type_t type, uint32_t error_code, uint32_t pc, uint32_t lr, uint16_t line)
+{
+#ifdef MESH_FAULTLOG
+    mesh_faultlog_capture(type, error_code, pc, lr, line);
+    return NRF_SUCCESS;
+#else
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+uint32_t rbc_mesh_fault_get(uint8_t index, rbc_mesh_fault_record_t* p_record)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_record == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+#ifdef MESH_FAULTLOG
+    return mesh_faultlog_get(index, p_record);
+#else
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+uint32_t rbc_mesh_bridge_set(uint32_t access_address, uint8_t channel, const rbc_mesh_handle_range_t* p_ranges, uint8_t count)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (count > 0)
+    {
+        if (p_ranges == NULL)
+        {
+            return NRF_ERROR_NULL;
+        }
+        if (channel > 39)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+        if (access_address == RBC_MESH_ACCESS_ADDRESS_BLE_ADV ||
+            access_address == m_access_addr)
+        {
+            return NRF_ERROR_INVALID_ADDR;
+        }
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (p_ranges[i].last < p_ranges[i].first ||
+                p_ranges[i].last > RBC_MESH_APP_MAX_HANDLE)
+            {
+                return NRF_ERROR_INVALID_PARAM;
+            }
+        }
+    }
+
+    return tc_bridge_set(access_address, channel, p_ranges, count);
+}
+
+uint32_t rbc_mesh_packet_pool_stats_get(rbc_mesh_packet_pool_stats_t* p_stats)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    mesh_packet_pool_stats_get(p_stats);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_stats_get(rbc_mesh_stats_t* p_stats)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    mesh_stats_get(p_stats);
+
+    return NRF_SUCCESS;
+}
+
+void rbc_mesh_tx_power_set(rbc_mesh_txpower_t tx_power)
+{
+    mesh_neighbour_tx_power_max_set(tx_power);
+}
+
+uint32_t rbc_mesh_tx_power_adaptive_set(bool enabled)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    mesh_neighbour_tx_power_adaptive_set(enabled);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_tx_power_get(rbc_mesh_txpower_t* p_tx_power)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_tx_power == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    *p_tx_power = (rbc_mesh_txpower_t) vh_tx_config_get()->tx_power;
+
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_neighbour_get(uint8_t index, rbc_mesh_neighbour_t* p_neighbour)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_neighbour == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    return mesh_neighbour_get(index, p_neighbour);
+}
+
+
+void rbc_mesh_ble_evt_handler(ble_evt_t* p_evt)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return;
+    }
+
+    mesh_gatt_sd_ble_event_handle(p_evt);
+}
+
+uint32_t rbc_mesh_coex_stats_get(rbc_mesh_coex_stats_t* p_stats)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_stats == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    mesh_coex_stats_get(p_stats);
+
+    return NRF_SUCCESS;
+}
+
+void rbc_mesh_radio_notification_handler(bool radio_active)
+{
+    mesh_coex_radio_notification(radio_active);
+}
+
+void rbc_mesh_sd_flash_pending_set(bool pending)
+{
+    mesh_coex_sd_flash_pending_set(pending);
+}
+
+void rbc_mesh_sd_evt_handler(uint32_t sd_evt)
+{
+    timeslot_sd_event_handler(sd_evt);
+#ifdef MESH_POWERFAIL
+    mesh_powerfail_sd_evt_handler(sd_evt);
+#endif
+    rand_refill();
+}
+
+/** Internal only function to push mesh events to application queue. */
+uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_event)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_event == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (m_event_cb != NULL && !m_in_event_cb && event_handler_is_dispatching())
+    {
+        /* the caller holds the packet the event data points into until we return */
+        m_in_event_cb = true;
+        bool handled = m_event_cb(p_event);
+        m_in_event_cb = false;
+        if (handled)
+        {
+            return NRF_SUCCESS;
+        }
+    }
+
+#if RBC_MESH_APP_EVENT_COALESCE
+    if (p_event->type == RBC_MESH_EVENT_TYPE_UPDATE_VAL &&
+        event_coalesce(p_event))
+    {
+        return NRF_SUCCESS; /* the application already has a pending notification */
+    }
+#endif
+
+    uint32_t error_code = fifo_push(&m_rbc_event_fifo, p_event);
+    
+    if (error_code != NRF_SUCCESS)
+    {
+        MESH_STATS_INC(app_queue_drop);
+    }
+
+    if (error_code == NRF_SUCCESS && p_event->params.rx.p_data != NULL)
+    {
+        switch (p_event->type)
+        {
+            case RBC_MESH_EVENT_TYPE_NEW_VAL:
+            case RBC_MESH_EVENT_TYPE_UPDATE_VAL:
+            case RBC_MESH_EVENT_TYPE_CONFLICTING_VAL:
+                if (p_event->params.rx.p_data)
+                {
+                    mesh_packet_ref_count_inc((mesh_packet_t*) p_event->params.rx.p_data); /* will be aligned by packet manager */
+                }
+                break;
+            case RBC_MESH_EVENT_TYPE_TX:
+                if (p_event->params.tx.p_data)
+                {
+                    mesh_packet_ref_count_inc((mesh_packet_t*) p_event->params.tx.p_data); /* will be aligned by packet manager */
+                }
+                break;
+            default:
+                break;
+        }
+    }
+#ifdef RBC_MESH_FREERTOS
+    /* after the reference counting, as the event task may release the event at once */
+    if (error_code == NRF_SUCCESS)
+    {
+        mesh_freertos_event_notify();
+    }
+#endif
+    return error_code;
+}
+
+uint32_t rbc_mesh_event_get(rbc_mesh_event_t* p_evt)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (mp_acquired_event != NULL)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (fifo_pop(&m_rbc_event_fifo, p_evt) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t rbc_mesh_event_peek(rbc_mesh_event_t* p_evt)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_evt == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
 
     if (fifo_peek(&m_rbc_event_fifo, p_evt) != NRF_SUCCESS)
     {
@@ -449,8 +1219,36 @@ uint32_t rbc_mesh_event_peek(rbc_mesh_event_t* p_evt)
     return NRF_SUCCESS;
 }
 
+uint32_t rbc_mesh_event_acquire(rbc_mesh_event_t** pp_evt)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (pp_evt == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if (mp_acquired_event != NULL)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    /* the producer can't overwrite the oldest element until it's popped */
+    mp_acquired_event = (rbc_mesh_event_t*) fifo_peek_ptr(&m_rbc_event_fifo);
+    if (mp_acquired_event == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *pp_evt = mp_acquired_event;
+    return NRF_SUCCESS;
+}
+
 void rbc_mesh_event_release(rbc_mesh_event_t* p_evt)
 {
+    bool in_place = (p_evt != NULL && p_evt == mp_acquired_event);
+
     switch (p_evt->type)
     {
         case RBC_MESH_EVENT_TYPE_UPDATE_VAL:
@@ -471,6 +1269,23 @@ void rbc_mesh_event_release(rbc_mesh_event_t* p_evt)
         default:
             break;
     }
+
+    if (in_place)
+    {
+        /* done with the queue slot, give it back to the producer */
+        mp_acquired_event = NULL;
+        fifo_pop(&m_rbc_event_fifo, NULL);
+    }
+}
+
+uint32_t rbc_mesh_event_cb_set(rbc_mesh_event_cb_t event_cb)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    m_event_cb = event_cb;
+    return NRF_SUCCESS;
 }
 
 void rbc_mesh_packet_peek_cb_set(rbc_mesh_packet_peek_cb_t packet_peek_cb)
@@ -478,3 +1293,35 @@ void rbc_mesh_packet_peek_cb_set(rbc_mesh_packet_peek_cb_t packet_peek_cb)
     tc_packet_peek_cb_set(packet_peek_cb);
 }
 
+uint32_t rbc_mesh_rx_whitelist_set(const ble_gap_addr_t* p_addrs, uint8_t count)
+{
+    return tc_rx_whitelist_set(p_addrs, count);
+}
+
+uint32_t rbc_mesh_auth_key_set(const uint8_t* p_key, uint32_t seq_start)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_key == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    return mesh_auth_key_set(p_key, seq_start);
+}
+
+uint32_t rbc_mesh_auth_seq_get(uint32_t* p_seq)
+{
+    if (m_mesh_state == MESH_STATE_UNINITIALIZED)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p_seq == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    return mesh_auth_seq_get(p_seq);
+}
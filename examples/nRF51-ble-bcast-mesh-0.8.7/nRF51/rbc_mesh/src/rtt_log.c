@@ -0,0 +1,141 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifdef RTT_LOG_DEFERRED
+
+#include "rtt_log.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include "toolchain.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#if (RTT_LOG_BUFFER_WORDS & (RTT_LOG_BUFFER_WORDS - 1)) != 0
+#error "RTT_LOG_BUFFER_WORDS must be a power of two"
+#endif
+
+/** Marks the first word of a record, for the host to find its way back after lost data. */
+#define RECORD_MAGIC                (0xA5)
+#define BUFFER_SIZE                 (RTT_LOG_BUFFER_WORDS * 4)
+
+/**
+ * Record layout, in 32 bit little endian words:
+ *  0: RECORD_MAGIC << 24 | argument count << 16 | records dropped before this one
+ *  1: address of the format string
+ *  2..: arguments
+ */
+#define RECORD_HEADER(arg_count, dropped) \
+    (((uint32_t) RECORD_MAGIC << 24) | ((arg_count) << 16) | (dropped))
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static uint32_t m_buffer[RTT_LOG_BUFFER_WORDS];
+static uint8_t m_rtt_buffer[RTT_LOG_RTT_BUFFER_SIZE];
+/** Free running byte offsets, written by the loggers and by the flush. */
+static volatile uint32_t m_head;
+static volatile uint32_t m_tail;
+static uint16_t m_dropped;
+static bool m_rtt_configured;
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void rtt_log_deferred(const char* p_format, uint32_t arg_count, ...)
+{
+    uint32_t args[RTT_LOG_ARGS_MAX];
+    va_list arg_list;
+    if (arg_count > RTT_LOG_ARGS_MAX)
+    {
+        arg_count = RTT_LOG_ARGS_MAX;
+    }
+    va_start(arg_list, arg_count);
+    for (uint32_t i = 0; i < arg_count; ++i)
+    {
+        args[i] = va_arg(arg_list, uint32_t);
+    }
+    va_end(arg_list);
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    uint32_t head = m_head;
+    if (BUFFER_SIZE - (head - m_tail) < (2 + arg_count) * 4)
+    {
+        if (m_dropped < UINT16_MAX)
+        {
+            m_dropped++;
+        }
+    }
+    else
+    {
+        uint32_t index = head / 4;
+        m_buffer[index++ & (RTT_LOG_BUFFER_WORDS - 1)] = RECORD_HEADER(arg_count, m_dropped);
+        m_buffer[index++ & (RTT_LOG_BUFFER_WORDS - 1)] = (uint32_t) p_format;
+        for (uint32_t i = 0; i < arg_count; ++i)
+        {
+            m_buffer[index++ & (RTT_LOG_BUFFER_WORDS - 1)] = args[i];
+        }
+        m_head = index * 4;
+        m_dropped = 0;
+    }
+    _ENABLE_IRQS(was_masked);
+}
+
+void rtt_log_flush(void)
+{
+    if (!m_rtt_configured)
+    {
+        /* a full RTT buffer must not block the caller */
+        (void) SEGGER_RTT_ConfigUpBuffer(RTT_LOG_CHANNEL, "rtt_log",
+                m_rtt_buffer, RTT_LOG_RTT_BUFFER_SIZE, SEGGER_RTT_MODE_NO_BLOCK_TRIM);
+        m_rtt_configured = true;
+    }
+
+    uint32_t head = m_head;
+    while (m_tail != head)
+    {
+        uint32_t offset = m_tail & (BUFFER_SIZE - 1);
+        uint32_t length = head - m_tail;
+        if (length > BUFFER_SIZE - offset)
+        {
+            length = BUFFER_SIZE - offset;
+        }
+
+        uint32_t written = SEGGER_RTT_Write(RTT_LOG_CHANNEL, &((uint8_t*) m_buffer)[offset], length);
+        m_tail += written;
+        if (written < length)
+        {
+            break; /* the host hasn't caught up */
+        }
+    }
+}
+
+#endif /* RTT_LOG_DEFERRED */
@@ -47,7 +47,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define SERIAL_LENGTH_POS       (0)
 #define SERIAL_OPCODE_POS       (1)
 
-#define SERIAL_QUEUE_SIZE       (4)
 
 #define SERIAL_REQN_GPIOTE_CH   (0)
 
@@ -68,8 +67,8 @@ typedef enum
 
 static fifo_t rx_fifo;
 static fifo_t tx_fifo;
-static serial_data_t rx_fifo_buffer[SERIAL_QUEUE_SIZE];
-static serial_data_t tx_fifo_buffer[SERIAL_QUEUE_SIZE];
+static serial_data_t rx_fifo_buffer[SERIAL_HANDLER_RX_QUEUE_LENGTH];
+static serial_data_t tx_fifo_buffer[SERIAL_HANDLER_TX_QUEUE_LENGTH];
 
 
 static uint8_t dummy_data = 0;
@@ -81,6 +80,14 @@ static bool has_pending_tx = false;
 static bool doing_tx = false;
 static bool suspend = false;
 
+#if SERIAL_SPI_STREAMING
+/* first byte is the credit count, followed by frames and a zero length terminator */
+static uint8_t stream_tx_buffer[SERIAL_SPI_STREAM_BUFFER_SIZE];
+static uint8_t stream_rx_buffer[SERIAL_SPI_STREAM_BUFFER_SIZE];
+/* length of the frames in stream_tx_buffer, not counting the credit byte */
+static uint32_t stream_tx_len = 0;
+#endif
+
 /*****************************************************************************
 * Static functions
 *****************************************************************************/
@@ -89,6 +96,15 @@ static void mesh_aci_command_check_cb(void* p_context)
     mesh_aci_command_check();
 }
 
+static bool tx_is_empty(void)
+{
+#if SERIAL_SPI_STREAMING
+    return (fifo_is_empty(&tx_fifo) && stream_tx_len == 0);
+#else
+    return fifo_is_empty(&tx_fifo);
+#endif
+}
+
 static void enable_pin_listener(bool enable)
 {
     if (enable)
@@ -102,6 +118,76 @@ static void enable_pin_listener(bool enable)
     }
 }
 
+#if SERIAL_SPI_STREAMING
+static uint8_t credits_get(void)
+{
+    return SERIAL_HANDLER_RX_QUEUE_LENGTH - fifo_get_len(&rx_fifo);
+}
+
+static void prepare_rx(void)
+{
+    uint32_t error_code;
+    /* the credit byte is read by the SPIS at the start of the transaction */
+    dummy_data = credits_get();
+    error_code = spi_slave_buffers_set(&dummy_data,
+                                      stream_rx_buffer,
+                                      1,
+                                      SERIAL_SPI_STREAM_BUFFER_SIZE);
+    APP_ERROR_CHECK(error_code);
+    has_pending_tx = false;
+}
+
+/** Fill up the tx stream with queued events, behind any frames the master didn't read last time. */
+static void stream_tx_fill(void)
+{
+    serial_data_t next;
+    while (fifo_peek(&tx_fifo, &next) == NRF_SUCCESS &&
+           1 + stream_tx_len + next.buffer[SERIAL_LENGTH_POS] + 1 <= SERIAL_SPI_STREAM_BUFFER_SIZE)
+    {
+        (void) fifo_pop(&tx_fifo, &next);
+        memcpy(&stream_tx_buffer[1 + stream_tx_len], next.buffer, next.buffer[SERIAL_LENGTH_POS] + 1);
+        stream_tx_len += next.buffer[SERIAL_LENGTH_POS] + 1;
+    }
+}
+
+/** Drop the frames the master read completely, and keep the rest for the next transaction. */
+static void stream_tx_consume(uint32_t tx_amount)
+{
+    uint32_t offset = 0;
+    while (offset < stream_tx_len &&
+           1 + offset + stream_tx_buffer[1 + offset] + 1 <= tx_amount)
+    {
+        offset += stream_tx_buffer[1 + offset] + 1;
+    }
+    memmove(&stream_tx_buffer[1], &stream_tx_buffer[1 + offset], stream_tx_len - offset);
+    stream_tx_len -= offset;
+}
+
+/** Push all complete commands in the rx stream to the command queue. */
+static bool stream_rx_process(uint32_t rx_amount)
+{
+    bool pushed = false;
+    uint32_t offset = 0;
+    while (offset < rx_amount && stream_rx_buffer[offset] > 0)
+    {
+        const uint32_t frame_len = stream_rx_buffer[offset] + 1;
+        if (frame_len > SERIAL_DATA_MAX_LEN || offset + frame_len > rx_amount)
+        {
+            /* corrupt or truncated frame, drop the rest of the stream */
+            break;
+        }
+        serial_data_t frame;
+        frame.status_byte = 0;
+        memcpy(frame.buffer, &stream_rx_buffer[offset], frame_len);
+        /* the master isn't allowed to send more commands than it has credits for */
+        APP_ERROR_CHECK(fifo_spsc_push(&rx_fifo, &frame));
+        pushed = true;
+        offset += frame_len;
+    }
+    memset(stream_rx_buffer, 0, SERIAL_SPI_STREAM_BUFFER_SIZE);
+    return pushed;
+}
+#else
 static void prepare_rx(void)
 {
     uint32_t error_code;
@@ -112,6 +198,7 @@ static void prepare_rx(void)
     APP_ERROR_CHECK(error_code);
     has_pending_tx = false;
 }
+#endif
 
 /**
 * @brief Called when master requests send, or we want to notify master
@@ -130,6 +217,32 @@ static void do_transmit(void)
 
     bool ordered_buffer = false;
 
+#if SERIAL_SPI_STREAMING
+    (void) tx_ptr;
+    (void) tx_len;
+    stream_tx_fill();
+    if (stream_tx_len > 0)
+    {
+        stream_tx_buffer[0] = credits_get();
+        uint32_t stream_len = 1 + stream_tx_len;
+        if (stream_len < SERIAL_SPI_STREAM_BUFFER_SIZE)
+        {
+            stream_tx_buffer[stream_len++] = 0; /* terminator */
+        }
+        error_code = spi_slave_buffers_set(stream_tx_buffer,
+                                          stream_rx_buffer,
+                                          stream_len,
+                                          SERIAL_SPI_STREAM_BUFFER_SIZE);
+        APP_ERROR_CHECK(error_code);
+        ordered_buffer = true;
+        has_pending_tx = true;
+        doing_tx = true;
+    }
+    else
+    {
+        dummy_data = credits_get();
+    }
+#else
     if (fifo_pop(&tx_fifo, &tx_buffer) == NRF_SUCCESS)
     {
         tx_len = tx_buffer.buffer[SERIAL_LENGTH_POS] + 2;
@@ -144,6 +257,7 @@ static void do_transmit(void)
         has_pending_tx = true;
         doing_tx = true;
     }
+#endif
     if (!ordered_buffer)
     {
         /* don't need to wait for SPIS mutex */
@@ -216,6 +330,22 @@ void spi_event_handler(spi_slave_evt_t evt)
 
         case SPI_SLAVE_XFER_DONE:
             NRF_GPIO->OUTSET = (1 << PIN_RDYN);
+#if SERIAL_SPI_STREAMING
+            if (doing_tx)
+            {
+                doing_tx = false;
+                stream_tx_consume(evt.tx_amount);
+            }
+            if (stream_rx_process(evt.rx_amount))
+            {
+                /* notify ACI handler */
+                async_event_t async_evt;
+                memset(&async_evt, 0, sizeof(async_event_t));
+                async_evt.callback.generic.cb = mesh_aci_command_check_cb;
+                async_evt.type = EVENT_TYPE_GENERIC;
+                event_handler_push(&async_evt);
+            }
+#else
             if (doing_tx)
             {
                 doing_tx = false;
@@ -228,7 +358,7 @@ void spi_event_handler(spi_slave_evt_t evt)
             /* handle incoming */
             if (rx_buffer.buffer[SERIAL_LENGTH_POS] > 0)
             {
-                if (fifo_push(&rx_fifo, &rx_buffer) == NRF_SUCCESS)
+                if (fifo_spsc_push(&rx_fifo, &rx_buffer) == NRF_SUCCESS)
                 {
 
                     /* notify ACI handler */
@@ -243,11 +373,12 @@ void spi_event_handler(spi_slave_evt_t evt)
                     APP_ERROR_CHECK(NRF_ERROR_NO_MEM);
                 }
             }
+#endif
             if (suspend)
             {
                 return;
             }
-            if (fifo_is_empty(&tx_fifo))
+            if (tx_is_empty())
             {
                 serial_state = SERIAL_STATE_IDLE;
                 prepare_rx();
@@ -279,12 +410,12 @@ void serial_handler_init(void)
 {
     has_pending_tx = false;
     /* init packet queues */
-    tx_fifo.array_len = SERIAL_QUEUE_SIZE;
+    tx_fifo.array_len = SERIAL_HANDLER_TX_QUEUE_LENGTH;
     tx_fifo.elem_array = tx_fifo_buffer;
     tx_fifo.elem_size = sizeof(serial_data_t);
     tx_fifo.memcpy_fptr = NULL;
     fifo_init(&tx_fifo);
-    rx_fifo.array_len = SERIAL_QUEUE_SIZE;
+    rx_fifo.array_len = SERIAL_HANDLER_RX_QUEUE_LENGTH;
     rx_fifo.elem_array = rx_fifo_buffer;
     rx_fifo.elem_size = sizeof(serial_data_t);
     rx_fifo.memcpy_fptr = NULL;
@@ -312,7 +443,7 @@ void serial_handler_init(void)
 
 uint32_t serial_handler_credit_available(void)
 {
-    return fifo_get_len(&rx_fifo);
+    return SERIAL_HANDLER_RX_QUEUE_LENGTH - fifo_get_len(&rx_fifo);
 }
 
 void serial_wait_for_completion(void)
@@ -368,7 +499,7 @@ bool serial_handler_command_get(serial_cmd_t* cmd)
     NVIC_DisableIRQ(SPI1_TWI1_IRQn);
     enable_pin_listener(false);
     serial_data_t temp;
-    if (fifo_pop(&rx_fifo, &temp) != NRF_SUCCESS)
+    if (fifo_spsc_pop(&rx_fifo, &temp) != NRF_SUCCESS)
     {
         enable_pin_listener(true);
         NVIC_EnableIRQ(SPI1_TWI1_IRQn);
@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "event_handler.h"
 #include "rbc_mesh_common.h"
 #include "fifo.h"
+#include "mesh_watermark.h"
 
 #include "nrf_soc.h"
 #include "boards.h"
@@ -39,7 +40,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "app_util_platform.h"
 #include <string.h>
 
-#define SERIAL_QUEUE_SIZE       (4)
 
 /*****************************************************************************
 * Static types
@@ -55,8 +55,8 @@ typedef enum
 *****************************************************************************/
 static fifo_t           m_rx_fifo;
 static fifo_t           m_tx_fifo;
-static serial_data_t    m_rx_fifo_buffer[SERIAL_QUEUE_SIZE];
-static serial_data_t    m_tx_fifo_buffer[SERIAL_QUEUE_SIZE];
+static serial_data_t    m_rx_fifo_buffer[SERIAL_HANDLER_RX_QUEUE_LENGTH];
+static serial_data_t    m_tx_fifo_buffer[SERIAL_HANDLER_TX_QUEUE_LENGTH];
 
 static serial_state_t   m_serial_state;
 static serial_data_t    m_tx_buffer;
@@ -80,17 +80,27 @@ static void mesh_aci_command_check_cb(void* p_context)
 #endif
 
 
+/** @brief Load the next queued event into the TX buffer, and start sending its first byte. */
+static bool tx_buffer_load(void)
+{
+    if (fifo_pop(&m_tx_fifo, &m_tx_buffer) != NRF_SUCCESS)
+    {
+        return false;
+    }
+    m_tx_len = ((serial_evt_t*) m_tx_buffer.buffer)->length; /* should be serial_evt_t->length+1, but will be decremented after the push below, so we don't bother */
+    mp_tx_ptr = &m_tx_buffer.buffer[0];
+    NRF_UART0->TXD = *(mp_tx_ptr++);
+    return true;
+}
+
 /** @brief Process packet queue, always done in the async context */
 static void do_transmit(void* p_context)
 {
-    if (fifo_pop(&m_tx_fifo, &m_tx_buffer) == NRF_SUCCESS)
+    if (!fifo_is_empty(&m_tx_fifo))
     {
-        m_tx_len = ((serial_evt_t*) m_tx_buffer.buffer)->length; /* should be serial_evt_t->length+1, but will be decremented after the push below, so we don't bother */
-        mp_tx_ptr = &m_tx_buffer.buffer[0];
-
         NRF_UART0->EVENTS_TXDRDY = 0;
         NRF_UART0->TASKS_STARTTX = 1;
-        NRF_UART0->TXD = *(mp_tx_ptr++);
+        (void) tx_buffer_load();
     }
 }
 
@@ -125,7 +135,7 @@ static void char_rx(uint8_t c)
     uint32_t len = (uint32_t)(pp - rx_buf.buffer);
     if (len >= sizeof(rx_buf) || (len > 1 && len >= rx_buf.buffer[0] + 1)) /* end of command */
     {
-        if (fifo_push(&m_rx_fifo, &rx_buf) != NRF_SUCCESS)
+        if (fifo_spsc_push(&m_rx_fifo, &rx_buf) != NRF_SUCCESS)
         {
             /* respond inline, queue was full */
             serial_evt_t fail_evt;
@@ -162,6 +172,7 @@ static void char_rx(uint8_t c)
 *****************************************************************************/
 void UART0_IRQHandler(void)
 {
+    WATERMARK_ENTER(MESH_WATERMARK_CONTEXT_SERIAL);
     /* receive all pending bytes */
     while (NRF_UART0->EVENTS_RXDRDY)
     {
@@ -178,6 +189,12 @@ void UART0_IRQHandler(void)
         {
             NRF_UART0->TXD = *(mp_tx_ptr++);
         }
+        else if (!m_suspend && tx_buffer_load())
+        {
+            /* The last byte has left TXD, so the buffer is free. Continue
+               with the next event right away, instead of stopping the
+               transmitter and waiting for the async context. */
+        }
         else
         {
             NRF_UART0->TASKS_STOPTX = 1;
@@ -192,6 +209,7 @@ void UART0_IRQHandler(void)
             }
         }
     }
+    WATERMARK_EXIT(MESH_WATERMARK_CONTEXT_SERIAL);
 }
 
 /*****************************************************************************
@@ -201,12 +219,12 @@ void UART0_IRQHandler(void)
 void serial_handler_init(void)
 {
     /* init packet queues */
-    m_tx_fifo.array_len = SERIAL_QUEUE_SIZE;
+    m_tx_fifo.array_len = SERIAL_HANDLER_TX_QUEUE_LENGTH;
     m_tx_fifo.elem_array = m_tx_fifo_buffer;
     m_tx_fifo.elem_size = sizeof(serial_data_t);
     m_tx_fifo.memcpy_fptr = NULL;
     fifo_init(&m_tx_fifo);
-    m_rx_fifo.array_len = SERIAL_QUEUE_SIZE;
+    m_rx_fifo.array_len = SERIAL_HANDLER_RX_QUEUE_LENGTH;
     m_rx_fifo.elem_array = m_rx_fifo_buffer;
     m_rx_fifo.elem_size = sizeof(serial_data_t);
     m_rx_fifo.memcpy_fptr = NULL;
@@ -226,7 +244,7 @@ void serial_handler_init(void)
     NRF_UART0->PSELCTS       = CTS_PIN_NUMBER;
     NRF_UART0->PSELRTS       = RTS_PIN_NUMBER;
     NRF_UART0->CONFIG        = (UART_CONFIG_HWFC_Enabled << UART_CONFIG_HWFC_Pos);
-    NRF_UART0->BAUDRATE      = (UART_BAUDRATE_BAUDRATE_Baud115200 << UART_BAUDRATE_BAUDRATE_Pos);
+    NRF_UART0->BAUDRATE      = (SERIAL_UART_BAUDRATE << UART_BAUDRATE_BAUDRATE_Pos);
     NRF_UART0->ENABLE        = (UART_ENABLE_ENABLE_Enabled << UART_ENABLE_ENABLE_Pos);
     NRF_UART0->INTENSET      = (UART_INTENSET_RXDRDY_Msk |
                                 UART_INTENSET_TXDRDY_Msk);
@@ -240,7 +258,7 @@ void serial_handler_init(void)
 
 uint32_t serial_handler_credit_available(void)
 {
-    return fifo_get_len(&m_rx_fifo);
+    return SERIAL_HANDLER_RX_QUEUE_LENGTH - fifo_get_len(&m_rx_fifo);
 }
 
 void serial_wait_for_completion(void)
@@ -278,15 +296,17 @@ bool serial_handler_event_send(serial_evt_t* evt)
 
 bool serial_handler_command_get(serial_cmd_t* cmd)
 {
-    serial_data_t temp;
-    if (fifo_pop(&m_rx_fifo, &temp) != NRF_SUCCESS)
+    /* rx fifo is SPSC between the UART IRQ and us, copy the command out in place */
+    serial_data_t* p_temp = (serial_data_t*) fifo_spsc_pop_reserve(&m_rx_fifo);
+    if (p_temp == NULL)
     {
         return false;
     }
-    if (((serial_cmd_t*) temp.buffer)->length > 0)
+    if (((serial_cmd_t*) p_temp->buffer)->length > 0)
     {
-        memcpy(cmd, temp.buffer, ((serial_cmd_t*) temp.buffer)->length + 1);
+        memcpy(cmd, p_temp->buffer, ((serial_cmd_t*) p_temp->buffer)->length + 1);
     }
+    fifo_spsc_pop_release(&m_rx_fifo);
 
     if (m_serial_state == SERIAL_STATE_WAIT_FOR_QUEUE)
     {
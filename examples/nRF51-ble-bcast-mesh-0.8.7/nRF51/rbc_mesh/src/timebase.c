@@ -0,0 +1,161 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include "timebase.h"
+#include "timer.h"
+#include "toolchain.h"
+#include "nrf.h"
+
+/** RTC counter width mask. */
+#define TIMEBASE_RTC_MASK           (0xFFFFFF)
+/** RTC ticks per second, the RTC0 prescaler is 0. */
+#define TIMEBASE_RTC_TICKS_PER_S    (32768)
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static uint64_t m_last_us;      /**< Latest time handed out, the timebase never goes below it. */
+static uint64_t m_ts_start_us;  /**< Time at the start of the current timeslot. */
+static bool     m_in_ts;        /**< Whether TIMER0 is running for the framework. */
+#ifdef SOFTDEVICE_PRESENT
+static uint64_t m_rtc_ticks;    /**< RTC0 ticks since the timebase was started. */
+static uint32_t m_rtc_last;     /**< RTC0 counter at the last update. */
+#endif
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+#ifdef SOFTDEVICE_PRESENT
+/** Get the time from the RTC ticks. Converts the whole count every time,
+ * so the rounding doesn't add up. */
+static inline uint64_t rtc_ticks_to_us(uint64_t ticks)
+{
+    return (ticks / TIMEBASE_RTC_TICKS_PER_S) * 1000000 +
+        ((ticks % TIMEBASE_RTC_TICKS_PER_S) * 1000000) / TIMEBASE_RTC_TICKS_PER_S;
+}
+
+/** Add the RTC ticks since the last call to the timebase. IRQs must be masked. */
+static uint64_t rtc_time_update(void)
+{
+    uint32_t rtc = NRF_RTC0->COUNTER;
+    m_rtc_ticks += (rtc - m_rtc_last) & TIMEBASE_RTC_MASK;
+    m_rtc_last = rtc;
+    return rtc_ticks_to_us(m_rtc_ticks);
+}
+#endif
+
+/** Get the time without the monotonic guard. IRQs must be masked. */
+static uint64_t time_get(void)
+{
+    if (m_in_ts)
+    {
+        /* TIMER0 counts from the timeslot start, and the framework timestamps
+           are the lower half of the timebase. */
+        return m_ts_start_us + (uint32_t) (timer_now() - (uint32_t) m_ts_start_us);
+    }
+#ifdef SOFTDEVICE_PRESENT
+    return rtc_time_update();
+#else
+    /* without a Softdevice, the timer runs for as long as the framework does */
+    return m_last_us;
+#endif
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void timebase_init(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    m_last_us = 0;
+    m_ts_start_us = 0;
+    m_in_ts = false;
+#ifdef SOFTDEVICE_PRESENT
+    m_rtc_ticks = 0;
+    m_rtc_last = NRF_RTC0->COUNTER;
+#endif
+    _ENABLE_IRQS(was_masked);
+}
+
+uint64_t timebase_on_ts_begin(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    uint64_t time = time_get();
+    if (time < m_last_us)
+    {
+        time = m_last_us;
+    }
+    m_last_us = time;
+    m_ts_start_us = time;
+    m_in_ts = true;
+    _ENABLE_IRQS(was_masked);
+    return time;
+}
+
+void timebase_on_ts_end(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    uint64_t time = time_get();
+    if (time > m_last_us)
+    {
+        m_last_us = time;
+    }
+    m_in_ts = false;
+    _ENABLE_IRQS(was_masked);
+}
+
+uint64_t timebase_now(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    uint64_t time = time_get();
+    if (time < m_last_us)
+    {
+        time = m_last_us;
+    }
+    m_last_us = time;
+    _ENABLE_IRQS(was_masked);
+    return time;
+}
+
+uint64_t timebase_extend(timestamp_t timestamp)
+{
+    uint64_t now = timebase_now();
+    int32_t diff = (int32_t) (timestamp - (uint32_t) now);
+    if (diff < 0 && (uint64_t) -(int64_t) diff > now)
+    {
+        /* from before the timebase was started */
+        return 0;
+    }
+    return now + diff;
+}
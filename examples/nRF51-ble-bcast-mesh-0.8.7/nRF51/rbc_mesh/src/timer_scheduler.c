@@ -28,6 +28,8 @@ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ************************************************************************************/
 #include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
 #include "timer_scheduler.h"
 #include "event_handler.h"
 #include "toolchain.h"
@@ -38,12 +40,28 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /** Time in us to regard as immidiate when firing several timers at once */
 #define TIMER_MARGIN    (100)
 
+/** Each wheel slot covers 2^TIMER_WHEEL_SLOT_BITS us. */
+#define TIMER_WHEEL_SLOT_BITS   (11)
+/** Number of slots in the wheel, must be power of two. Events further away than one
+ * revolution share slots with the nearer ones, and are skipped until they're due. */
+#define TIMER_WHEEL_SLOTS       (32)
+#define TIMER_WHEEL_SLOT_LENGTH (1UL << TIMER_WHEEL_SLOT_BITS)
+
+#define TIMER_WHEEL_SLOT_OF(time)   (((time) >> TIMER_WHEEL_SLOT_BITS) & (TIMER_WHEEL_SLOTS - 1))
+
+#if (TIMER_WHEEL_SLOTS & (TIMER_WHEEL_SLOTS - 1))
+#error "TIMER_WHEEL_SLOTS must be power of two"
+#endif
+
 /*****************************************************************************
 * Local typedefs
 *****************************************************************************/
 typedef struct
 {
-    timer_event_t* p_head;
+    timer_event_t* p_slots[TIMER_WHEEL_SLOTS];
+    timestamp_t last_time; /**< Time of the last wheel sweep. Events before it are put in its slot. */
+    timer_event_t* p_earliest; /**< Cached earliest event, only valid if earliest_valid is set. */
+    bool earliest_valid;
     uint32_t pending_reschedules;
 } scheduler_t;
 
@@ -58,98 +76,151 @@ static void timer_cb(timestamp_t timestamp);
 
 static void add_evt(timer_event_t* p_evt)
 {
-    if (m_scheduler.p_head == NULL ||
-        TIMER_OLDER_THAN(p_evt->timestamp, m_scheduler.p_head->timestamp))
+    /* overdue events go in the slot of the next sweep, so they're not missed */
+    timestamp_t slot_time = p_evt->timestamp;
+    if (TIMER_OLDER_THAN(slot_time, m_scheduler.last_time))
     {
-        p_evt->p_next = m_scheduler.p_head;
-        m_scheduler.p_head = p_evt;
-        return;
+        slot_time = m_scheduler.last_time;
     }
-    timer_event_t* p_temp = m_scheduler.p_head;
+    timer_event_t** pp_slot = &m_scheduler.p_slots[TIMER_WHEEL_SLOT_OF(slot_time)];
 
-    while (p_temp->p_next &&
-         TIMER_OLDER_THAN(p_temp->p_next->timestamp, p_evt->timestamp))
+    p_evt->p_next = *pp_slot;
+    if (p_evt->p_next)
     {
-        p_temp = p_temp->p_next;
+        p_evt->p_next->pp_prev = &p_evt->p_next;
     }
+    p_evt->pp_prev = pp_slot;
+    *pp_slot = p_evt;
 
-    p_evt->p_next = p_temp->p_next;
-    p_temp->p_next = p_evt;
+    if (m_scheduler.earliest_valid &&
+        (m_scheduler.p_earliest == NULL ||
+         TIMER_OLDER_THAN(p_evt->timestamp, m_scheduler.p_earliest->timestamp)))
+    {
+        m_scheduler.p_earliest = p_evt;
+    }
 }
 
 static uint32_t remove_evt(timer_event_t* p_evt)
 {
-    if (p_evt == m_scheduler.p_head)
+    if (p_evt->pp_prev == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *p_evt->pp_prev = p_evt->p_next;
+    if (p_evt->p_next)
+    {
+        p_evt->p_next->pp_prev = p_evt->pp_prev;
+    }
+    p_evt->p_next = NULL;
+    p_evt->pp_prev = NULL;
+
+    if (p_evt == m_scheduler.p_earliest)
+    {
+        m_scheduler.earliest_valid = false;
+    }
+    return NRF_SUCCESS;
+}
+
+/** Find the scheduled event with the earliest timestamp, or NULL if there are none. */
+static timer_event_t* earliest_get(void)
+{
+    if (m_scheduler.earliest_valid)
     {
-        m_scheduler.p_head = p_evt->p_next;
-        p_evt->p_next = NULL;
-        return NRF_SUCCESS;
+        return m_scheduler.p_earliest;
     }
 
-    timer_event_t* p_temp = m_scheduler.p_head;
-    while (p_temp &&
-           p_temp->p_next &&
-           !TIMER_OLDER_THAN(p_evt->timestamp, p_temp->p_next->timestamp)
-          )
+    timer_event_t* p_earliest = NULL;
+    uint32_t first_slot = TIMER_WHEEL_SLOT_OF(m_scheduler.last_time);
+    timestamp_t slot_end = (m_scheduler.last_time & ~(TIMER_WHEEL_SLOT_LENGTH - 1)) + TIMER_WHEEL_SLOT_LENGTH;
+
+    for (uint32_t i = 0; i < TIMER_WHEEL_SLOTS; ++i, slot_end += TIMER_WHEEL_SLOT_LENGTH)
     {
-        if (p_temp->p_next == p_evt)
+        for (timer_event_t* p_evt = m_scheduler.p_slots[(first_slot + i) & (TIMER_WHEEL_SLOTS - 1)];
+             p_evt != NULL;
+             p_evt = p_evt->p_next)
         {
-            p_temp->p_next = p_evt->p_next;
-            p_evt->p_next = NULL;
-            return NRF_SUCCESS;
+            if (p_earliest == NULL || TIMER_OLDER_THAN(p_evt->timestamp, p_earliest->timestamp))
+            {
+                p_earliest = p_evt;
+            }
+        }
+        /* no later slot can hold anything earlier than an event due in this revolution */
+        if (p_earliest && TIMER_OLDER_THAN(p_earliest->timestamp, slot_end))
+        {
+            break;
         }
-
-        p_temp = p_temp->p_next;
     }
 
-    return NRF_ERROR_NOT_FOUND;
+    m_scheduler.p_earliest = p_earliest;
+    m_scheduler.earliest_valid = true;
+    return p_earliest;
 }
 
 static void fire_timers(timestamp_t time_now)
 {
-   if (m_scheduler.pending_reschedules)
-   {
-       return;
-   }
-
-   while (m_scheduler.p_head &&
-       TIMER_OLDER_THAN(m_scheduler.p_head->timestamp, time_now + TIMER_MARGIN))
-   {
-       timer_event_t* p_evt = m_scheduler.p_head;
-       async_event_t evt;
-       evt.type = EVENT_TYPE_TIMER_SCH;
-       evt.callback.timer_sch.cb = p_evt->cb;
-       evt.callback.timer_sch.p_context = p_evt->p_context;
-       evt.callback.timer_sch.timestamp = time_now;
-       if (event_handler_push(&evt) != NRF_SUCCESS)
-       {
-           /* event queue full */
-           return;
-       }
-
-        /* iterate */
-        m_scheduler.p_head = p_evt->p_next;
-        p_evt->p_next = NULL;
-
-        if (p_evt->interval != 0)
+    if (m_scheduler.pending_reschedules)
+    {
+        return;
+    }
+
+    timestamp_t fire_time = time_now + TIMER_MARGIN;
+    uint32_t first_slot = TIMER_WHEEL_SLOT_OF(m_scheduler.last_time);
+    uint32_t slot_count = TIMER_WHEEL_SLOTS;
+    if (!TIMER_OLDER_THAN(fire_time, m_scheduler.last_time) &&
+        (fire_time - m_scheduler.last_time) < TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOT_LENGTH)
+    {
+        slot_count = ((TIMER_WHEEL_SLOT_OF(fire_time) - first_slot) & (TIMER_WHEEL_SLOTS - 1)) + 1;
+    }
+
+    for (uint32_t i = 0; i < slot_count; ++i)
+    {
+        timer_event_t* p_evt = m_scheduler.p_slots[(first_slot + i) & (TIMER_WHEEL_SLOTS - 1)];
+        while (p_evt)
         {
-            do
+            timer_event_t* p_next = p_evt->p_next;
+            if (TIMER_OLDER_THAN(p_evt->timestamp, fire_time))
             {
-                p_evt->timestamp += p_evt->interval;
-            } while (TIMER_OLDER_THAN(p_evt->timestamp, time_now + TIMER_MARGIN));
-
-            add_evt(p_evt);
+                async_event_t evt;
+                evt.type = EVENT_TYPE_TIMER_SCH;
+                evt.callback.timer_sch.cb = p_evt->cb;
+                evt.callback.timer_sch.p_context = p_evt->p_context;
+                evt.callback.timer_sch.timestamp = time_now;
+                if (event_handler_push(&evt) != NRF_SUCCESS)
+                {
+                    /* event queue full, continue from this slot next time */
+                    m_scheduler.last_time += i * TIMER_WHEEL_SLOT_LENGTH;
+                    return;
+                }
+
+                remove_evt(p_evt);
+
+                if (p_evt->interval != 0)
+                {
+                    /* re-arm in place, no need to look at the other events */
+                    do
+                    {
+                        p_evt->timestamp += p_evt->interval;
+                    } while (TIMER_OLDER_THAN(p_evt->timestamp, fire_time));
+
+                    add_evt(p_evt);
+                }
+            }
+            p_evt = p_next;
         }
-   }
+    }
+
+    m_scheduler.last_time = time_now;
 }
 
 static void setup_timeout(timestamp_t time_now)
 {
-    if (m_scheduler.p_head)
+    timer_event_t* p_earliest = earliest_get();
+    if (p_earliest)
     {
-        if (TIMER_OLDER_THAN(time_now, m_scheduler.p_head->timestamp))
+        if (TIMER_OLDER_THAN(time_now, p_earliest->timestamp))
         {
-            timer_order_cb(TIMER_INDEX_SCHEDULER, m_scheduler.p_head->timestamp, timer_cb, TIMER_ATTR_NONE);
+            timer_order_cb(TIMER_INDEX_SCHEDULER, p_earliest->timestamp, timer_cb, TIMER_ATTR_NONE);
         }
         else
         {
@@ -163,6 +234,7 @@ static void async_schedule(void* p_context)
     TICK_PIN(3);
     timer_event_t* p_evt = (timer_event_t*) p_context;
     timestamp_t time_now = timer_now();
+    remove_evt(p_evt);
     add_evt(p_evt);
 
     fire_timers(time_now);
@@ -205,7 +277,8 @@ static void timer_cb(timestamp_t timestamp)
 *****************************************************************************/
 uint32_t timer_sch_init(void)
 {
-    m_scheduler.p_head = NULL;
+    memset(&m_scheduler, 0, sizeof(m_scheduler));
+    m_scheduler.earliest_valid = true; /* no events, p_earliest is NULL */
     return NRF_SUCCESS;
 }
 
@@ -215,7 +288,6 @@ uint32_t timer_sch_schedule(timer_event_t* p_timer_evt)
     {
         return NRF_ERROR_NULL;
     }
-    p_timer_evt->p_next = NULL; /* sanitize linked list pointer */
     async_event_t evt;
     evt.type = EVENT_TYPE_GENERIC;
     evt.callback.generic.cb = async_schedule;
@@ -36,12 +36,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "radio_control.h"
 #include "timer.h"
+#include "timebase.h"
 #include "transport_control.h"
 #include "event_handler.h"
+#include "mesh_stats.h"
+#include "mesh_trace.h"
+#include "mesh_watermark.h"
+#include "mesh_coex.h"
 #include "rbc_mesh_common.h"
 
+#ifdef RBC_MESH_GZLL_BRIDGE
+#include "mesh_gzll_bridge.h"
+#endif
 #ifdef MESH_DFU
 #include "dfu_app.h"
+#endif
+#if defined(MESH_DFU) || defined(MESH_PERSIST) || defined(MESH_POWERFAIL)
 #include "mesh_flash.h"
 #endif
 
@@ -49,6 +59,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "nrf_sdm.h"
 #include "nrf_soc.h"
 
+#ifdef SOFTDEVICE_PRESENT
 
 #define TIMESLOT_END_SAFETY_MARGIN_US       (1000)          /**< Allocated time between end timer timeout and actual timeslot end. */
 #define TIMESLOT_SLOT_LENGTH_US             (10000)         /**< Base timeslot length. */
@@ -58,10 +69,36 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define TIMESLOT_MAX_LENGTH_US              (10000000UL)    /**< The upper limit for timeslot extensions. */
 #define TIMESLOT_MAX_LENGTH_FIRST_US        (10000UL)    /**< The upper limit for timeslot extensions for the first timeslot. */
 #define RTC_MAX_TIME_TICKS                  (0xFFFFFF)      /**< RTC-clock rollover time. */
+#define TIMESLOT_EXTEND_LENGTH_MIN_US       (2500)          /**< Shortest extension requested when the mesh is idle. */
+#define TIMESLOT_EXTEND_LENGTH_MAX_US       (40000)         /**< Longest extension requested when the mesh is backlogged. */
+#define TIMESLOT_IDLE_MAX_LENGTH_US         (200000)        /**< Stop extending an idle timeslot after this long, to give time back to the Softdevice. */
+#define TIMESLOT_DUTY_CYCLE_WINDOW_US       (60000000UL)    /**< Approximate averaging window for the duty cycle. */
+#define TIMESLOT_LP_DISTANCE_MIN_US         ((TIMESLOT_SLOT_LENGTH_US * 1000UL) / RBC_MESH_LP_DUTY_CYCLE_PERMILLE) /**< Shortest distance between timeslot starts in low power mode. */
+#define TIMESLOT_LP_DISTANCE_MAX_US         (RBC_MESH_LP_SYNC_INTERVAL_MS * 1000UL) /**< Longest distance between timeslot starts in low power mode. */
+#define TIMESLOT_DRIFT_WINDOW_US            (2000000UL)     /**< Timeslot time measured before each new estimate of the RC oscillator drift. */
+#define TIMESLOT_DRIFT_GUARD_PPM            (40)            /**< Added to the measured drift, for the drift between estimates and calibrations. */
+#define RTC_TICK_WAIT_MAX_US                (40)            /**< Longest wait for the next RTC tick, a bit over one LF clock period. */
+
+#if (RBC_MESH_LP_DUTY_CYCLE_PERMILLE == 0 || RBC_MESH_LP_DUTY_CYCLE_PERMILLE > 1000)
+    #error "RBC_MESH_LP_DUTY_CYCLE_PERMILLE must be in the range 1-1000"
+#endif
+#if (TIMESLOT_LP_DISTANCE_MAX_US > NRF_RADIO_DISTANCE_MAX_US)
+    #error "RBC_MESH_LP_SYNC_INTERVAL_MS is longer than the Softdevice allows between timeslots"
+#endif
 
 /*****************************************************************************
 * Local type definitions
 *****************************************************************************/
+/**
+ * Traffic load, sampled from the radio and async event queues.
+ */
+typedef enum
+{
+    TS_LOAD_IDLE,       /** Nothing but the ongoing search in the radio queue, and no pending events. */
+    TS_LOAD_NORMAL,     /** Some traffic, but the queues are keeping up. */
+    TS_LOAD_BUSY        /** The queues are backlogged. */
+} ts_load_t;
+
 /**
  * Types of forced command sent to the signal handler.
  */
@@ -93,6 +130,23 @@ static nrf_radio_request_t m_radio_request_earliest =
                     }
                 };
 
+/** Timeslot request relative to the previous timeslot, for low power mode */
+static nrf_radio_request_t m_radio_request_normal =
+                {
+                    .request_type = NRF_RADIO_REQ_TYPE_NORMAL,
+                    .params.normal =
+                    {
+#if (NORDIC_SDK_VERSION >= 11)
+                        .hfclk = NRF_RADIO_HFCLK_CFG_XTAL_GUARANTEED,
+#else
+                        .hfclk = NRF_RADIO_HFCLK_CFG_DEFAULT,
+#endif
+                        .priority = NRF_RADIO_PRIORITY_NORMAL,
+                        .distance_us = TIMESLOT_LP_DISTANCE_MAX_US,
+                        .length_us = TIMESLOT_SLOT_LENGTH_US
+                    }
+                };
+
 static nrf_radio_signal_callback_return_param_t m_ret_param; /** Return parameter for SD radio signal handler. */
 static timestamp_t          m_timeslot_length           = 0; /** Length of current timeslot (including extensions). */
 static timestamp_t          m_start_time                = 0; /** Start time for current timeslot. */
@@ -104,17 +158,178 @@ static bool                 m_end_timer_triggered       = false; /** The timeslo
 static ts_forced_command_t  m_timeslot_forced_command   = TS_FORCED_COMMAND_NONE; /** Forced command, checked in radio signal callback. */
 static uint32_t             m_lfclk_ppm                 = 250; /** The set drift accuracy for the LF clock source. */
 static uint32_t             m_timeslot_count            = 0;
+static timestamp_t          m_extend_length             = TIMESLOT_SLOT_EXTEND_LENGTH_US; /** Extension length adapted to the traffic load, kept across timeslots. */
+static uint32_t             m_duty_active_us            = 0; /** Time spent in timeslots within the duty cycle window. */
+static uint32_t             m_duty_elapsed_us           = 0; /** Length of the duty cycle window. */
+static bool                 m_low_power                 = false; /** Limit the duty cycle, see timeslot_low_power_set(). */
+static bool                 m_wakeup_pending            = false; /** m_wakeup_time is set. */
+static timestamp_t          m_wakeup_time               = 0; /** When the framework next needs the radio. */
+static bool                 m_lfclk_is_rc               = false; /** The LF clock runs from the RC oscillator, and its drift is measured. */
+static uint32_t             m_lfclk_drift_ppm           = 0; /** Last measured drift of the RC oscillator, 0 until measured. */
+static bool                 m_drift_sample_valid        = false; /** An RTC tick was sampled at the start of the current timeslot. */
+static uint32_t             m_drift_sample_rtc          = 0; /** RTC counter at the sampled tick. */
+static timestamp_t          m_drift_sample_time         = 0; /** HF timer time at the sampled tick. */
+static uint32_t             m_drift_hf_us               = 0; /** HF time accumulated in the current estimation window. */
+static uint32_t             m_drift_lf_ticks            = 0; /** LF ticks accumulated in the current estimation window. */
+#ifdef RBC_MESH_GZLL_BRIDGE
+static bool                 m_in_bridge_window          = false; /** The current timeslot has been handed to the Gazell bridge. */
+#endif
 
 /*****************************************************************************
 * Static Functions
 *****************************************************************************/
 static uint32_t end_timer_margin(void)
 {
-    return (m_timeslot_length * m_lfclk_ppm) / 1000000 + TIMESLOT_END_SAFETY_MARGIN_US;
+    uint32_t ppm = m_lfclk_ppm;
+
+    /* the softdevice times the timeslot with the LF clock, and we time its
+       end with the HF clock. A calibrated RC oscillator usually does much
+       better than its rated accuracy, so use what was measured. */
+    if (m_lfclk_drift_ppm != 0)
+    {
+        ppm = m_lfclk_drift_ppm + TIMESLOT_DRIFT_GUARD_PPM;
+    }
+    return (m_timeslot_length * ppm) / 1000000 + TIMESLOT_END_SAFETY_MARGIN_US;
+}
+
+/**
+ * Wait for the next RTC tick, and sample it with the HF timer, so that LF
+ * time can be measured without the up to one tick quantization error. Must be
+ * called in a timeslot, and takes at most one LF clock period.
+ */
+static bool rtc_tick_sample(uint32_t* p_rtc, timestamp_t* p_time)
+{
+    uint32_t rtc = NRF_RTC0->COUNTER;
+    timestamp_t start = timer_now();
+
+    while (NRF_RTC0->COUNTER == rtc)
+    {
+        if (TIMER_DIFF(timer_now(), start) > RTC_TICK_WAIT_MAX_US)
+        {
+            return false;
+        }
+    }
+    *p_time = timer_now();
+    *p_rtc = NRF_RTC0->COUNTER;
+    return true;
+}
+
+/** Start measuring the LF clock against the HF crystal for this timeslot. */
+static void drift_measure_start(void)
+{
+    if (m_lfclk_is_rc)
+    {
+        m_drift_sample_valid = rtc_tick_sample(&m_drift_sample_rtc, &m_drift_sample_time);
+    }
+}
+
+/**
+ * End the measurement of this timeslot, and update the drift estimate once
+ * enough time has been measured. The estimate follows the softdevice's
+ * temperature triggered recalibrations of the RC oscillator.
+ */
+static void drift_measure_end(void)
+{
+    uint32_t rtc;
+    timestamp_t time;
+
+    if (!m_drift_sample_valid || !rtc_tick_sample(&rtc, &time))
+    {
+        return;
+    }
+
+    m_drift_hf_us += TIMER_DIFF(time, m_drift_sample_time);
+    m_drift_lf_ticks += (rtc - m_drift_sample_rtc) & RTC_MAX_TIME_TICKS;
+
+    if (m_drift_hf_us >= TIMESLOT_DRIFT_WINDOW_US)
+    {
+        uint32_t lf_us = (uint32_t) (((uint64_t) m_drift_lf_ticks * 1000000) >> 15);
+        uint32_t diff_us = (lf_us > m_drift_hf_us) ? (lf_us - m_drift_hf_us) : (m_drift_hf_us - lf_us);
+
+        /* never 0, which means "not measured" */
+        m_lfclk_drift_ppm = (uint32_t) (((uint64_t) diff_us * 1000000) / m_drift_hf_us) + 1;
+        m_drift_hf_us = 0;
+        m_drift_lf_ticks = 0;
+    }
+}
+
+/** Whether the current timeslot has been handed to the Gazell bridge. */
+static inline bool in_bridge_window(void)
+{
+#ifdef RBC_MESH_GZLL_BRIDGE
+    return m_in_bridge_window;
+#else
+    return false;
+#endif
+}
+
+static ts_load_t load_get(void)
+{
+    uint32_t radio_queue_len = radio_queue_len_get();
+    uint32_t async_queue_len = event_handler_queue_len_get();
+
+    if (radio_queue_len > RBC_MESH_RADIO_QUEUE_LENGTH / 2 ||
+        async_queue_len > (RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH + RBC_MESH_INTERNAL_RX_EVENT_QUEUE_LENGTH) / 2)
+    {
+        return TS_LOAD_BUSY;
+    }
+    if (radio_queue_len <= 1 && async_queue_len == 0)
+    {
+        /* only the preemptable search is in the radio queue */
+        return TS_LOAD_IDLE;
+    }
+    return TS_LOAD_NORMAL;
+}
+
+/** Adapt the extension length to the load, and return whether to extend at all. */
+static bool extend_length_adapt(void)
+{
+    switch (load_get())
+    {
+        case TS_LOAD_BUSY:
+            if (m_extend_length < TIMESLOT_EXTEND_LENGTH_MAX_US)
+            {
+                m_extend_length <<= 1;
+                if (m_extend_length > TIMESLOT_EXTEND_LENGTH_MAX_US)
+                {
+                    m_extend_length = TIMESLOT_EXTEND_LENGTH_MAX_US;
+                }
+            }
+            return true;
+
+        case TS_LOAD_IDLE:
+            if (m_extend_length > TIMESLOT_EXTEND_LENGTH_MIN_US)
+            {
+                m_extend_length >>= 1;
+                if (m_extend_length < TIMESLOT_EXTEND_LENGTH_MIN_US)
+                {
+                    m_extend_length = TIMESLOT_EXTEND_LENGTH_MIN_US;
+                }
+            }
+            /* let the timeslot run out, so the softdevice gets its time */
+            return (m_timeslot_length < TIMESLOT_IDLE_MAX_LENGTH_US);
+
+        default:
+            return true;
+    }
+}
+
+static void duty_cycle_register(timestamp_t active_us, timestamp_t elapsed_us)
+{
+    m_duty_active_us += active_us;
+    m_duty_elapsed_us += elapsed_us;
+
+    /* halve the history to get a moving average without overflowing */
+    if (m_duty_elapsed_us > TIMESLOT_DUTY_CYCLE_WINDOW_US)
+    {
+        m_duty_active_us >>= 1;
+        m_duty_elapsed_us >>= 1;
+    }
 }
 
 static void ts_order_earliest(timestamp_t length_us)
 {
+    length_us = mesh_coex_slot_length_get(length_us);
     if (m_is_in_callback)
     {
         m_radio_request_earliest.params.earliest.length_us = length_us;
@@ -128,52 +343,96 @@ static void ts_order_earliest(timestamp_t length_us)
     m_timeslot_length = length_us;
 }
 
-static void ts_extend(timestamp_t extra_time_us)
+/** Order the first timeslot after the current one. Must be called from the
+  callback, at the end of the timeslot. */
+static void ts_order_next(void)
 {
-    if (m_is_in_callback)
+    timestamp_t gap = mesh_coex_gap_get();
+    if (!m_low_power && gap == 0)
     {
-        if (m_timeslot_length + extra_time_us > TIMESLOT_MAX_LENGTH_US)
+        ts_order_earliest(TIMESLOT_SLOT_LENGTH_US);
+        return;
+    }
+
+    timestamp_t length = mesh_coex_slot_length_get(TIMESLOT_SLOT_LENGTH_US);
+    if (!m_low_power)
+    {
+        /* leave room for the Softdevice flash operations */
+        m_radio_request_normal.params.normal.distance_us = m_timeslot_length + gap;
+        m_radio_request_normal.params.normal.length_us = length;
+        m_ret_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END;
+        m_ret_param.params.request.p_next = &m_radio_request_normal;
+        m_timeslot_length = length;
+        return;
+    }
+
+    /* wake up for the next TX, or to sync with the other nodes */
+    uint32_t distance = TIMESLOT_LP_DISTANCE_MAX_US;
+    if (m_wakeup_pending)
+    {
+        uint32_t wakeup_distance = TIMER_OLDER_THAN(m_wakeup_time, m_start_time) ?
+            0 : TIMER_DIFF(m_wakeup_time, m_start_time);
+        if (wakeup_distance < distance)
         {
-            extra_time_us = TIMESLOT_MAX_LENGTH_US - m_timeslot_length;
+            distance = wakeup_distance;
         }
-        m_ret_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_EXTEND;
-        m_ret_param.params.extend.length_us = extra_time_us;
     }
-}
-
-void start_time_update(void)
-{
-    static uint64_t s_last_rtc_value = 0;
-    uint64_t rtc_time = NRF_RTC0->COUNTER;
+    if (distance < TIMESLOT_LP_DISTANCE_MIN_US)
+    {
+        distance = TIMESLOT_LP_DISTANCE_MIN_US;
+    }
 
-    /* First run, no delta. */
-    if(m_timeslot_count == 0)
+    if (distance < m_timeslot_length + gap)
     {
-        s_last_rtc_value = rtc_time;
+        distance = m_timeslot_length + gap;
     }
 
-    uint64_t delta_rtc_time;
-    if(s_last_rtc_value > rtc_time)
+    m_radio_request_normal.params.normal.distance_us = distance;
+    m_radio_request_normal.params.normal.length_us = length;
+    m_ret_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END;
+    m_ret_param.params.request.p_next = &m_radio_request_normal;
+    m_timeslot_length = length;
+}
+
+static void ts_extend(timestamp_t extra_time_us)
+{
+#ifdef RBC_MESH_GZLL_BRIDGE
+    /* end the timeslot, so the next one goes to Gazell */
+    if (mesh_gzll_bridge_window_due(timer_now()))
     {
-        delta_rtc_time = RTC_MAX_TIME_TICKS - s_last_rtc_value + rtc_time;
+        return;
     }
-    else
+#endif
+    if (m_is_in_callback && mesh_coex_extend_allowed())
     {
-        delta_rtc_time = rtc_time - s_last_rtc_value;
+        if (m_timeslot_length + extra_time_us > TIMESLOT_MAX_LENGTH_US)
+        {
+            extra_time_us = TIMESLOT_MAX_LENGTH_US - m_timeslot_length;
+        }
+        m_ret_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_EXTEND;
+        m_ret_param.params.extend.length_us = extra_time_us;
     }
+}
 
-    /* scale to microseconds */
-    m_start_time += ((delta_rtc_time * 1000000) >> 15);
-    s_last_rtc_value = rtc_time;
+void start_time_update(void)
+{
+    /* the framework timestamps are the lower half of the 64 bit timebase */
+    m_start_time = (timestamp_t) timebase_on_ts_begin();
 }
 
 static void timeslot_end(void)
 {
+    timestamp_t length_us = TIMER_DIFF(timer_now(), m_start_time);
+    duty_cycle_register(length_us, 0);
+    mesh_coex_timeslot_end(length_us);
+    MESH_STATS_ADD(timeslot_us, length_us);
     radio_disable();
+    timebase_on_ts_end();
     timer_on_ts_end(timeslot_end_time_get());
     m_is_in_timeslot = false;
     m_is_in_callback = false;
     m_end_timer_triggered = false;
+    m_drift_sample_valid = false;
     CLEAR_PIN(PIN_IN_TS);
     CLEAR_PIN(PIN_IN_CB);
     
@@ -217,6 +476,7 @@ void timeslot_sd_event_handler(uint32_t evt)
             /* Something in the softdevice is blocking our requests,
                go into emergency mode, where slots are short, in order to
                avoid complete lockout. */
+            mesh_coex_blocked();
             ts_order_earliest(TIMESLOT_SLOT_EMERGENCY_LENGTH_US);
             break;
 
@@ -225,6 +485,7 @@ void timeslot_sd_event_handler(uint32_t evt)
             break;
 
         case NRF_EVT_RADIO_CANCELED:
+            mesh_coex_canceled();
             ts_order_earliest(TIMESLOT_SLOT_LENGTH_US);
             break;
         default:
@@ -245,21 +506,43 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
 {
     static uint32_t requested_extend_time = 0;
     static uint32_t successful_extensions = 0;
+    TRACE_ENTER(MESH_TRACE_SITE_RADIO_SIGNAL);
+    WATERMARK_ENTER(MESH_WATERMARK_CONTEXT_RADIO);
     SET_PIN(PIN_IN_CB);
     m_is_in_callback = true;
 
-    switch (m_timeslot_forced_command)
+    ts_forced_command_t forced_command = m_timeslot_forced_command;
+#ifdef RBC_MESH_GZLL_BRIDGE
+    if (m_in_bridge_window)
+    {
+        if (forced_command == TS_FORCED_COMMAND_STOP)
+        {
+            mesh_gzll_bridge_window_abort();
+            m_in_bridge_window = false;
+        }
+        else
+        {
+            /* restart once the Gazell window is over */
+            forced_command = TS_FORCED_COMMAND_NONE;
+        }
+    }
+#endif
+    switch (forced_command)
     {
         case TS_FORCED_COMMAND_STOP:
             m_ret_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_END;
             m_timeslot_count = 0;
             timeslot_end();
+            WATERMARK_EXIT(MESH_WATERMARK_CONTEXT_RADIO);
+            TRACE_EXIT(MESH_TRACE_SITE_RADIO_SIGNAL);
             return &m_ret_param;
 
         case TS_FORCED_COMMAND_RESTART:
             ts_order_earliest(TIMESLOT_SLOT_LENGTH_US);
             timeslot_end();
             m_timeslot_forced_command = TS_FORCED_COMMAND_NONE;
+            WATERMARK_EXIT(MESH_WATERMARK_CONTEXT_RADIO);
+            TRACE_EXIT(MESH_TRACE_SITE_RADIO_SIGNAL);
             return &m_ret_param;
 
         default:
@@ -275,21 +558,50 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
             m_is_in_timeslot = true;
             m_end_timer_triggered = false;
             successful_extensions = 0;
+            MESH_STATS_INC(timeslot_count);
 
+            timestamp_t prev_start_time = m_start_time;
             start_time_update();
+            if (m_timeslot_count != 0)
+            {
+                duty_cycle_register(0, TIMER_DIFF(m_start_time, prev_start_time));
+            }
+
+            if (m_wakeup_pending && !TIMER_OLDER_THAN(m_start_time, m_wakeup_time))
+            {
+                m_wakeup_pending = false;
+            }
+
+#ifdef RBC_MESH_GZLL_BRIDGE
+            if (mesh_gzll_bridge_window_due(m_start_time))
+            {
+                /* the mesh sits this timeslot out */
+                m_in_bridge_window = true;
+                mesh_gzll_bridge_window_start(m_start_time, m_timeslot_length - end_timer_margin());
+                if (!++m_timeslot_count)
+                {
+                    m_timeslot_count++;
+                }
+                break;
+            }
+#endif
 
             /* notify other modules */
             event_handler_on_ts_begin();
             timer_on_ts_begin(m_start_time);
             tc_on_ts_begin();
-
-            m_negotiate_timeslot_length = TIMESLOT_SLOT_EXTEND_LENGTH_US;
+            drift_measure_start();
 
             timer_order_cb(TIMER_INDEX_TS_END, timeslot_start_time_get() + m_timeslot_length - end_timer_margin(),
                     end_timer_handler, (timer_attr_t) (TIMER_ATTR_SYNCHRONOUS | TIMER_ATTR_TIMESLOT_LOCAL));
 
             /* attempt to extend our time right away */
-            ts_extend(m_negotiate_timeslot_length);
+            extend_length_adapt();
+            m_negotiate_timeslot_length = m_extend_length;
+            if (!m_low_power)
+            {
+                ts_extend(m_negotiate_timeslot_length);
+            }
 
             /* increase timeslot-count, but skip =0 on rollover */
             if (!++m_timeslot_count)
@@ -300,11 +612,29 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
             break;
         }
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_RADIO:
+#ifdef RBC_MESH_GZLL_BRIDGE
+            if (m_in_bridge_window)
+            {
+                mesh_gzll_bridge_radio_event();
+                break;
+            }
+#endif
             /* send to radio control module */
             radio_event_handler();
             break;
 
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_TIMER0:
+#ifdef RBC_MESH_GZLL_BRIDGE
+            if (m_in_bridge_window)
+            {
+                if (mesh_gzll_bridge_timer_event())
+                {
+                    m_in_bridge_window = false;
+                    m_end_timer_triggered = true;
+                }
+                break;
+            }
+#endif
             /* send to timer control module */
             timer_event_handler();
             break;
@@ -321,6 +651,12 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
 
             m_ret_param.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE;
 
+            if (!extend_length_adapt() || m_low_power)
+            {
+                break;
+            }
+            m_negotiate_timeslot_length = m_extend_length;
+
             if (m_timeslot_count == 1)
             {
                 if (m_timeslot_length + m_negotiate_timeslot_length < TIMESLOT_MAX_LENGTH_FIRST_US)
@@ -339,6 +675,7 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
             break;
 
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_FAILED:
+            MESH_STATS_INC(timeslot_extend_denied);
             m_negotiate_timeslot_length >>= 1;
             if (m_negotiate_timeslot_length > 1000)
             {
@@ -352,7 +689,8 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
 
     if (m_end_timer_triggered)
     {
-        ts_order_earliest(TIMESLOT_SLOT_LENGTH_US);
+        drift_measure_end();
+        ts_order_next();
         timeslot_end();
     }
     else if (m_ret_param.callback_action == NRF_RADIO_SIGNAL_CALLBACK_ACTION_EXTEND)
@@ -361,14 +699,19 @@ static nrf_radio_signal_callback_return_param_t* radio_signal_callback(uint8_t s
     }
     else
     {
-#ifdef MESH_DFU
-        mesh_flash_op_execute(timeslot_remaining_time_get());
+#if defined(MESH_DFU) || defined(MESH_PERSIST) || defined(MESH_POWERFAIL)
+        if (!in_bridge_window())
+        {
+            mesh_flash_op_execute(timeslot_remaining_time_get());
+        }
 #endif
         requested_extend_time = 0;
     }
 
     m_is_in_callback = false;
     CLEAR_PIN(PIN_IN_CB);
+    WATERMARK_EXIT(MESH_WATERMARK_CONTEXT_RADIO);
+    TRACE_EXIT(MESH_TRACE_SITE_RADIO_SIGNAL);
     return &m_ret_param;
 }
 
@@ -386,6 +729,7 @@ uint32_t timeslot_init(nrf_clock_lfclksrc_t lfclksrc)
     {
         return NRF_ERROR_INVALID_STATE;
     }
+    timebase_init();
 
 #if (NORDIC_SDK_VERSION >= 11)
     switch (lfclksrc.xtal_accuracy)
@@ -417,6 +761,7 @@ uint32_t timeslot_init(nrf_clock_lfclksrc_t lfclksrc)
         default:
             m_lfclk_ppm = 250;
     }
+    m_lfclk_is_rc = (lfclksrc.source == NRF_CLOCK_LF_SRC_RC);
 #else
     switch (lfclksrc)
     {
@@ -447,7 +792,12 @@ uint32_t timeslot_init(nrf_clock_lfclksrc_t lfclksrc)
         default: /* all RC-sources are 250 */
             m_lfclk_ppm = 250;
     }
+    m_lfclk_is_rc = (lfclksrc >= NRF_CLOCK_LFCLKSRC_RC_250_PPM_250MS_CALIBRATION &&
+                     lfclksrc <= NRF_CLOCK_LFCLKSRC_RC_250_PPM_TEMP_16000MS_CALIBRATION);
 #endif
+    m_lfclk_drift_ppm = 0;
+    m_drift_hf_us = 0;
+    m_drift_lf_ticks = 0;
 
     m_is_in_callback = false;
     m_framework_initialized = true;
@@ -524,8 +874,250 @@ timestamp_t timeslot_remaining_time_get(void)
     return TIMER_DIFF((m_timeslot_length + m_start_time), timer_now());
 }
 
+uint32_t timeslot_duty_cycle_get(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    uint32_t active_us = m_duty_active_us;
+    uint32_t elapsed_us = m_duty_elapsed_us;
+    _ENABLE_IRQS(was_masked);
+
+    if (elapsed_us < 1000)
+    {
+        return 0;
+    }
+    uint32_t duty_cycle = active_us / (elapsed_us / 1000);
+    return (duty_cycle > 1000) ? 1000 : duty_cycle;
+}
+
+uint32_t timeslot_lfclk_drift_get(void)
+{
+    return m_lfclk_drift_ppm;
+}
+
+void timeslot_low_power_set(bool low_power)
+{
+    m_low_power = low_power;
+}
+
+void timeslot_wakeup_set(timestamp_t timestamp)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    m_wakeup_time = timestamp;
+    m_wakeup_pending = true;
+    _ENABLE_IRQS(was_masked);
+}
+
+timestamp_t timeslot_extend_length_get(void)
+{
+    return m_extend_length;
+}
+
+bool timeslot_is_in_ts(void)
+{
+    return m_is_in_timeslot;
+}
+
+#else /* SOFTDEVICE NOT PRESENT */
+
+/* Without a Softdevice, the framework owns the radio and TIMER0 outright, and
+   runs in a single timeslot that lasts until the framework is stopped. The
+   radio listens whenever it isn't transmitting, and there are no timeslot
+   ends to negotiate or keep margins for. The timestamps stand still while the
+   framework is stopped. */
+
+#define TIMESLOT_SLOT_LENGTH_US             (10000)         /**< Time given to callers asking how much is left of the timeslot. */
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static timestamp_t          m_start_time                = 0; /** Start time for current timeslot. */
+static bool                 m_is_in_timeslot            = false; /** A timeslot is currently in progress. */
+static bool                 m_framework_initialized     = false; /** The timeslot_init function has been called. */
+
+/*****************************************************************************
+* Static Functions
+*****************************************************************************/
+/** Run the flash operations that fit, like at the end of a Softdevice timeslot callback. */
+static void flash_ops_execute(void)
+{
+#if defined(MESH_DFU) || defined(MESH_PERSIST) || defined(MESH_POWERFAIL)
+    mesh_flash_op_execute(timeslot_remaining_time_get());
+#endif
+}
+
+/*****************************************************************************
+* IRQ handlers, owned by the Softdevice when it's present
+*****************************************************************************/
+void RADIO_IRQHandler(void)
+{
+    TRACE_ENTER(MESH_TRACE_SITE_RADIO_SIGNAL);
+    WATERMARK_ENTER(MESH_WATERMARK_CONTEXT_RADIO);
+    radio_event_handler();
+    flash_ops_execute();
+    WATERMARK_EXIT(MESH_WATERMARK_CONTEXT_RADIO);
+    TRACE_EXIT(MESH_TRACE_SITE_RADIO_SIGNAL);
+}
+
+void TIMER0_IRQHandler(void)
+{
+    TRACE_ENTER(MESH_TRACE_SITE_RADIO_SIGNAL);
+    WATERMARK_ENTER(MESH_WATERMARK_CONTEXT_RADIO);
+    timer_event_handler();
+    flash_ops_execute();
+    WATERMARK_EXIT(MESH_WATERMARK_CONTEXT_RADIO);
+    TRACE_EXIT(MESH_TRACE_SITE_RADIO_SIGNAL);
+}
+
+/*****************************************************************************
+* Interface Functions
+*****************************************************************************/
+void timeslot_sd_event_handler(uint32_t evt)
+{
+    /* no Softdevice events */
+}
+
+#if (NORDIC_SDK_VERSION >= 11)
+uint32_t timeslot_init(nrf_clock_lf_cfg_t lfclksrc)
+#else
+uint32_t timeslot_init(nrf_clock_lfclksrc_t lfclksrc)
+#endif
+{
+    if (m_framework_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    timebase_init();
+
+    /* the radio needs the crystal, which the Softdevice would have started */
+    NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
+    NRF_CLOCK->TASKS_HFCLKSTART = 1;
+    while (!NRF_CLOCK->EVENTS_HFCLKSTARTED);
+
+    /* the radio and timer handlers run at the Softdevice timeslot priority */
+    NVIC_SetPriority(RADIO_IRQn, 0);
+    NVIC_SetPriority(TIMER0_IRQn, 0);
+
+    m_framework_initialized = true;
+    return NRF_SUCCESS;
+}
+
+void timeslot_stop(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (m_is_in_timeslot)
+    {
+        timestamp_t now = timer_now();
+        MESH_STATS_ADD(timeslot_us, TIMER_DIFF(now, m_start_time));
+        m_start_time = now;
+        radio_disable();
+        timebase_on_ts_end();
+        timer_on_ts_end(m_start_time);
+        NRF_TIMER0->TASKS_STOP = 1;
+        NVIC_DisableIRQ(RADIO_IRQn);
+        NVIC_DisableIRQ(TIMER0_IRQn);
+        NVIC_ClearPendingIRQ(RADIO_IRQn);
+        NVIC_ClearPendingIRQ(TIMER0_IRQn);
+        m_is_in_timeslot = false;
+        CLEAR_PIN(PIN_IN_TS);
+    }
+    _ENABLE_IRQS(was_masked);
+}
+
+void timeslot_restart(void)
+{
+    if (m_is_in_timeslot)
+    {
+        timeslot_stop();
+        (void) timeslot_resume();
+    }
+}
+
+uint32_t timeslot_resume(void)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (m_is_in_timeslot)
+    {
+        _ENABLE_IRQS(was_masked);
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    /* 1MHz, counting from the start time */
+    NRF_TIMER0->TASKS_STOP = 1;
+    NRF_TIMER0->MODE = TIMER_MODE_MODE_Timer;
+    NRF_TIMER0->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
+    NRF_TIMER0->PRESCALER = 4;
+    NRF_TIMER0->TASKS_CLEAR = 1;
+    NRF_TIMER0->TASKS_START = 1;
+
+    SET_PIN(PIN_IN_TS);
+    m_is_in_timeslot = true;
+    MESH_STATS_INC(timeslot_count);
+    m_start_time = (timestamp_t) timebase_on_ts_begin();
+
+    /* notify other modules */
+    event_handler_on_ts_begin();
+    timer_on_ts_begin(m_start_time);
+    tc_on_ts_begin();
+    _ENABLE_IRQS(was_masked);
+
+    return NRF_SUCCESS;
+}
+
+timestamp_t timeslot_start_time_get(void)
+{
+    return m_start_time;
+}
+
+timestamp_t timeslot_end_time_get(void)
+{
+    if (!m_is_in_timeslot)
+    {
+        return 0;
+    }
+    return timer_now() + TIMESLOT_SLOT_LENGTH_US;
+}
+
+timestamp_t timeslot_remaining_time_get(void)
+{
+    if (!m_is_in_timeslot)
+    {
+        return 0;
+    }
+    return TIMESLOT_SLOT_LENGTH_US;
+}
+
+uint32_t timeslot_duty_cycle_get(void)
+{
+    return (m_is_in_timeslot ? 1000 : 0);
+}
+
+uint32_t timeslot_lfclk_drift_get(void)
+{
+    return 0;
+}
+
+void timeslot_low_power_set(bool low_power)
+{
+    /* the radio is never given up */
+}
+
+void timeslot_wakeup_set(timestamp_t timestamp)
+{
+    /* always awake */
+}
+
+timestamp_t timeslot_extend_length_get(void)
+{
+    return 0;
+}
+
 bool timeslot_is_in_ts(void)
 {
     return m_is_in_timeslot;
 }
 
+#endif /* SOFTDEVICE_PRESENT */
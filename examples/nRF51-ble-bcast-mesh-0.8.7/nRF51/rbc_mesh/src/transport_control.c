@@ -33,6 +33,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "radio_control.h"
 #include "mesh_gatt.h"
 #include "mesh_packet.h"
+#include "mesh_object.h"
+#include "mesh_survey.h"
+#include "mesh_digest.h"
+#include "mesh_report.h"
+#include "mesh_time.h"
+#include "mesh_probe.h"
+#include "mesh_neighbour.h"
+#include "mesh_stats.h"
+#include "mesh_trace.h"
 #include "timer.h"
 #include "rbc_mesh.h"
 #include "event_handler.h"
@@ -42,6 +51,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "version_handler.h"
 #include "mesh_aci.h"
 #include "app_error.h"
+#include "toolchain.h"
 
 #if defined(WITH_ACK_MASTER) || defined (WITHOUT_ACK_MASTER)|| defined (WITH_ACK_SLAVE)
 
@@ -72,6 +82,14 @@ typedef struct
 {
     uint32_t access_address;
     uint8_t channel;
+    uint8_t adv_channel_map; /* advertising channels to scan, 0 for single channel */
+    uint8_t rx_adv_channel_index; /* current scan channel, offset from 37 */
+    bool backbone_enabled; /* send and scan on the backbone bearer too */
+    uint8_t backbone_channel; /* channel of the backbone bearer */
+    bool rx_backbone; /* the current scan is on the backbone */
+    uint8_t bridge_channel; /* channel of the bridged network */
+    bool rx_bridge; /* the current scan is on the bridged network */
+    bool rx_bridge_last; /* the last scan off the BLE channels was on the bridged network */
     bool queue_saturation; /* flag indicating a full processing queue */
 } tc_state_t;
 
@@ -80,88 +98,222 @@ typedef struct
 ******************************************************************************/
 static tc_state_t m_state;
 static rbc_mesh_packet_peek_cb_t mp_packet_peek_cb;
+static timer_event_t m_channel_rotate_evt;
+#if RBC_MESH_RX_WHITELIST_SIZE > 0
+static ble_gap_addr_t m_rx_whitelist[RBC_MESH_RX_WHITELIST_SIZE];
+static uint8_t m_rx_whitelist_count;
+#endif
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+static rbc_mesh_handle_range_t m_bridge_ranges[RBC_MESH_BRIDGE_RANGES_MAX];
+static uint8_t m_bridge_range_count;
+/** Packet of the pending scan on the bridged network, to tell its packets apart. */
+static uint8_t* volatile mp_bridge_rx_packet;
+#endif
 
-/* STATS */
-#ifdef PACKET_STATS
-
+/******************************************************************************
+* Static functions
+******************************************************************************/
+static void rx_cb(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi);
+static void tx_cb(uint8_t* p_data);
 
-#if defined (WITH_ACK_MASTER) 
-static struct
+static bool bridge_enabled(void)
 {
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats __attribute__((at(0x20003030)))  = {0};
-
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+    return (m_bridge_range_count > 0);
+#else
+    return false;
+#endif
+}
 
-#elif defined(WITHOUT_ACK_MASTER) 
-static struct
+/** Whether the scan rotates between several channels or bearers. */
+static bool scan_rotates(void)
 {
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats __attribute__((at(0x2000273C))) = {0};
-
-
+    return (m_state.backbone_enabled || bridge_enabled() ||
+            (m_state.adv_channel_map & (m_state.adv_channel_map - 1)) != 0);
+}
 
-#elif defined(WITH_ACK_SLAVE)
-static struct
+static void scan_rotation_update(bool was_rotating)
 {
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats __attribute__((at(0x20002750))) = {0};
+    bool rotate = scan_rotates();
+    if (rotate && !was_rotating)
+    {
+        m_channel_rotate_evt.timestamp = timer_now() + RBC_MESH_ADV_CHANNEL_SCAN_INTERVAL_US;
+        m_channel_rotate_evt.interval = RBC_MESH_ADV_CHANNEL_SCAN_INTERVAL_US;
+        APP_ERROR_CHECK(timer_sch_schedule(&m_channel_rotate_evt));
+    }
+    else if (!rotate && was_rotating)
+    {
+        APP_ERROR_CHECK(timer_sch_abort(&m_channel_rotate_evt));
+    }
+}
 
-#elif defined(WITHOUT_ACK_SLAVE)
-static struct
+static uint8_t rx_channel_next(void)
 {
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats __attribute__((at(0x20002738))) = {0};
+    /* every other scan is on the backbone or the bridged network, between
+       the BLE channels. With both, they take turns. */
+    bool was_on_ble = (!m_state.rx_backbone && !m_state.rx_bridge);
+    m_state.rx_backbone = false;
+    m_state.rx_bridge = false;
+    if (was_on_ble)
+    {
+        if (bridge_enabled() && !(m_state.backbone_enabled && m_state.rx_bridge_last))
+        {
+            m_state.rx_bridge = true;
+            m_state.rx_bridge_last = true;
+            return m_state.bridge_channel;
+        }
+        if (m_state.backbone_enabled)
+        {
+            m_state.rx_backbone = true;
+            m_state.rx_bridge_last = false;
+            return m_state.backbone_channel;
+        }
+    }
 
-#else
-static struct
-{
-    uint32_t queue_drop;
-    uint32_t queue_ok;
-    uint32_t crc_fail;
-} m_packet_stats = {0};
+    if (m_state.adv_channel_map == 0)
+    {
+        return m_state.channel;
+    }
 
-#endif
+    /* step to the next channel in the map */
+    do
+    {
+        m_state.rx_adv_channel_index = (m_state.rx_adv_channel_index + 1) % 3;
+    } while ((m_state.adv_channel_map & (1 << m_state.rx_adv_channel_index)) == 0);
 
-#endif
-/******************************************************************************
-* Static functions
-******************************************************************************/
-static void rx_cb(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi);
-static void tx_cb(uint8_t* p_data);
+    return 37 + m_state.rx_adv_channel_index;
+}
 
 static void order_search(void)
 {
     radio_event_t evt;
 
     evt.event_type = RADIO_EVENT_TYPE_RX_PREEMPTABLE;
-    evt.channel = m_state.channel;
+    evt.channel = rx_channel_next();
+    evt.backbone = m_state.rx_backbone;
+    evt.bridge = m_state.rx_bridge;
 
     if (!mesh_packet_acquire((mesh_packet_t**) &evt.packet_ptr))
     {
         return; /* something is hogging all the packets */
     }
 
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+    if (evt.bridge)
+    {
+        /* set before the order, the radio may finish the event right away */
+        mp_bridge_rx_packet = evt.packet_ptr;
+    }
+#endif
     if (radio_order(&evt) != NRF_SUCCESS)
     {
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+        if (evt.bridge)
+        {
+            mp_bridge_rx_packet = NULL;
+        }
+#endif
         /* couldn't queue the packet for reception, immediately free its only ref */
         mesh_packet_ref_count_dec((mesh_packet_t*) evt.packet_ptr);
     }
 }
 
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+/** Only let the bridged handles in from the other network. The other records
+  of a batch are marked invalid in place, and skipped by the version handler. */
+static bool rx_bridge_filter_pass(mesh_packet_t* p_packet)
+{
+    mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packet);
+    if (p_adv_data == NULL)
+    {
+        return false;
+    }
+    if (p_adv_data->handle == MESH_BATCH_HANDLE)
+    {
+        bool pass = false;
+        mesh_batch_adv_data_t* p_batch = (mesh_batch_adv_data_t*) p_adv_data;
+        for (mesh_batch_record_t* p_record = mesh_packet_batch_record_next(p_batch, NULL);
+             p_record != NULL;
+             p_record = mesh_packet_batch_record_next(p_batch, p_record))
+        {
+            if (tc_bridge_handle_is_set(p_record->handle))
+            {
+                pass = true;
+            }
+            else
+            {
+                p_record->handle = RBC_MESH_INVALID_HANDLE;
+            }
+        }
+        return pass;
+    }
+    return (p_adv_data->handle <= RBC_MESH_APP_MAX_HANDLE &&
+            tc_bridge_handle_is_set(p_adv_data->handle));
+}
+#endif
+
+
+/** Cheap check of whether a received packet is worth a slot in the async
+  queue. Runs in the radio interrupt, so it only looks at the address and AD
+  structures. */
+static bool rx_prefilter_pass(mesh_packet_t* p_packet)
+{
+#if RBC_MESH_RX_WHITELIST_SIZE > 0
+    if (m_rx_whitelist_count > 0)
+    {
+        uint32_t i;
+        for (i = 0; i < m_rx_whitelist_count; ++i)
+        {
+            if (m_rx_whitelist[i].addr_type == p_packet->header.addr_type &&
+                memcmp(m_rx_whitelist[i].addr, p_packet->addr, BLE_GAP_ADDR_LEN) == 0)
+            {
+                break;
+            }
+        }
+        if (i == m_rx_whitelist_count)
+        {
+            return false;
+        }
+    }
+#endif
+    /* the peek function wants to see the foreign advertisements too */
+    return (mp_packet_peek_cb != NULL || mesh_packet_adv_data_get(p_packet) != NULL);
+}
 
 /* immediate radio callback, executed in STACK_LOW */
 static void rx_cb(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi)
 {
+    TRACE_ENTER(MESH_TRACE_SITE_RX_CB);
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+    bool from_bridge = (p_data == mp_bridge_rx_packet);
+    if (from_bridge)
+    {
+        /* the buffer goes back to the pool, and may come back for any scan */
+        mp_bridge_rx_packet = NULL;
+    }
+#endif
     if (success && ((mesh_packet_t*) p_data)->header.length <= MESH_PACKET_BLE_OVERHEAD + BLE_ADV_PACKET_PAYLOAD_MAX_LENGTH)
     {
+        MESH_STATS_INC(rx_ok);
+        bool pass;
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+        if (from_bridge)
+        {
+            pass = rx_bridge_filter_pass((mesh_packet_t*) p_data);
+        }
+        else
+#endif
+        {
+            pass = rx_prefilter_pass((mesh_packet_t*) p_data);
+        }
+        if (!pass)
+        {
+            MESH_STATS_INC(rx_filtered);
+            mesh_packet_ref_count_dec((mesh_packet_t*) p_data);
+            TRACE_EXIT(MESH_TRACE_SITE_RX_CB);
+            return;
+        }
+
         async_event_t evt;
         evt.type = EVENT_TYPE_PACKET;
         evt.callback.packet.payload = p_data;
@@ -174,26 +326,17 @@ static void rx_cb(uint8_t* p_data, bool success, uint32_t crc, uint8_t rssi)
         {
             mesh_packet_ref_count_dec((mesh_packet_t*) p_data);
             m_state.queue_saturation = true;
-#ifdef PACKET_STATS
-            m_packet_stats.queue_drop++;
-#endif
-        }
-        else
-        {
-#ifdef PACKET_STATS
-            m_packet_stats.queue_ok++;
-#endif
+            MESH_STATS_INC(event_queue_drop);
         }
     }
     else if (crc < 0x1000000) /* don't want to trigger on artifical crc values */
     {
-#ifdef PACKET_STATS
-        m_packet_stats.crc_fail++;
-#endif
+        MESH_STATS_INC(rx_crc_fail);
     }
 
     /* no longer needed in this context */
     mesh_packet_ref_count_dec((mesh_packet_t*) p_data);
+    TRACE_EXIT(MESH_TRACE_SITE_RX_CB);
 }
 
 
@@ -240,6 +383,13 @@ static void tx_cb(uint8_t* p_data)
             .p_context = p_data
         }
     };
+    MESH_STATS_INC(tx_count);
+    mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get((mesh_packet_t*) p_data);
+    if (p_adv_data != NULL && p_adv_data->handle == MESH_TIME_HANDLE)
+    {
+        /* the time is taken as close to the end of the packet as possible */
+        mesh_time_tx_end((mesh_packet_t*) p_data, timer_now());
+    }
     if (event_handler_push(&tx_cb_evt) != NRF_SUCCESS)
     {
         mesh_packet_ref_count_dec((mesh_packet_t*) p_data); /* radio ref removed (pushed in tc_tx) */
@@ -253,6 +403,16 @@ static void radio_idle_callback(void)
         order_search();
 }
 
+/* periodic scan channel rotation, executed in APP_LOW */
+static void channel_rotate_cb(timestamp_t timestamp, void* p_context)
+{
+    /* the new search preempts the ongoing one on the current channel */
+    if (timeslot_is_in_ts() && !m_state.queue_saturation)
+    {
+        order_search();
+    }
+}
+
 static void mesh_framework_packet_handle(mesh_adv_data_t* p_adv_data, uint32_t timestamp)
 {
 #ifdef MESH_DFU
@@ -262,6 +422,7 @@ static void mesh_framework_packet_handle(mesh_adv_data_t* p_adv_data, uint32_t t
     rx_cmd.type = BL_CMD_TYPE_RX;
     rx_cmd.params.rx.length = p_dfu->adv_data_length - DFU_PACKET_ADV_OVERHEAD;
     rx_cmd.params.rx.p_dfu_packet = &p_dfu->dfu_packet;
+    rx_cmd.params.rx.from_serial = false;
     dfu_cmd_send(&rx_cmd);
 #endif
 }
@@ -272,11 +433,31 @@ static void mesh_framework_packet_handle(mesh_adv_data_t* p_adv_data, uint32_t t
 void tc_init(uint32_t access_address, uint8_t channel)
 {
     mp_packet_peek_cb = NULL;
+    m_state.adv_channel_map = 0;
+    m_state.rx_adv_channel_index = 0;
+    m_state.backbone_enabled = false;
+    m_state.rx_backbone = false;
+    m_state.rx_bridge = false;
+    m_state.rx_bridge_last = false;
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+    m_bridge_range_count = 0;
+    mp_bridge_rx_packet = NULL;
+#endif
+    m_channel_rotate_evt.cb = channel_rotate_cb;
+    m_channel_rotate_evt.p_context = NULL;
+    m_channel_rotate_evt.p_next = NULL;
     tc_radio_params_set(access_address, channel);
 }
 
 void tc_radio_params_set(uint32_t access_address, uint8_t channel)
 {
+#if RBC_MESH_LONG_PACKETS
+    if (access_address == RBC_MESH_ACCESS_ADDRESS_BLE_ADV)
+    {
+        /* long packets must stay off the advertisement address */
+        return;
+    }
+#endif
     if (channel < 40)
     {
         m_state.access_address = access_address;
@@ -291,9 +472,78 @@ void tc_on_ts_begin(void)
     radio_init(radio_idle_callback, rx_cb, tx_cb);
 }
 
+void tc_adv_channel_map_set(uint8_t adv_channel_map)
+{
+    /* only rotate the scan channel when there's more than one to rotate between */
+    bool was_rotating = scan_rotates();
+    m_state.adv_channel_map = (adv_channel_map & RBC_MESH_ADV_CHANNEL_ALL);
+    scan_rotation_update(was_rotating);
+}
+
+void tc_backbone_set(bool enabled, uint32_t access_address, uint8_t channel)
+{
+    bool was_rotating = scan_rotates();
+    if (enabled)
+    {
+        radio_backbone_aa_set(access_address);
+        m_state.backbone_channel = channel;
+    }
+    m_state.backbone_enabled = enabled;
+    scan_rotation_update(was_rotating);
+}
+
+uint32_t tc_bridge_set(uint32_t access_address, uint8_t channel, const rbc_mesh_handle_range_t* p_ranges, uint8_t count)
+{
+    if (count > RBC_MESH_BRIDGE_RANGES_MAX)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_ranges == NULL && count > 0)
+    {
+        return NRF_ERROR_NULL;
+    }
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+    bool was_rotating = scan_rotates();
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (count > 0)
+    {
+        memcpy(m_bridge_ranges, p_ranges, count * sizeof(rbc_mesh_handle_range_t));
+        radio_bridge_aa_set(access_address);
+        m_state.bridge_channel = channel;
+    }
+    m_bridge_range_count = count;
+    _ENABLE_IRQS(was_masked);
+    scan_rotation_update(was_rotating);
+#endif
+    return NRF_SUCCESS;
+}
+
+bool tc_bridge_handle_is_set(rbc_mesh_value_handle_t handle)
+{
+#if RBC_MESH_BRIDGE_RANGES_MAX > 0
+    for (uint32_t i = 0; i < m_bridge_range_count; ++i)
+    {
+        if (handle >= m_bridge_ranges[i].first && handle <= m_bridge_ranges[i].last)
+        {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
 uint32_t tc_tx(mesh_packet_t* p_packet, const tc_tx_config_t* p_config)
 {
     TICK_PIN(PIN_MESH_TX);
+#if RBC_MESH_LONG_PACKETS
+    if (!p_config->alt_access_address &&
+        p_packet->header.length > BLE_GAP_ADDR_LEN + BLE_ADV_PACKET_LEGACY_PAYLOAD_MAX_LENGTH)
+    {
+        /* BLE scanners don't expect anything longer than a legacy advertisement */
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+#endif
     /* queue the packet for transmission */
     radio_event_t event;
     memset(&event, 0, sizeof(radio_event_t));
@@ -304,11 +554,46 @@ uint32_t tc_tx(mesh_packet_t* p_packet, const tc_tx_config_t* p_config)
     p_packet->header._rfu3 = 0;
 
     event.packet_ptr = (uint8_t*) p_packet;
-    event.access_address = p_config->alt_access_address;
-    event.channel = p_config->first_channel;
     event.event_type = RADIO_EVENT_TYPE_TX;
     event.tx_power = (uint8_t) p_config->tx_power;
 
+    mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packet);
+
+    /* time beacons are timed per packet, and stay on the given channel */
+    if (m_state.backbone_enabled &&
+        (p_adv_data == NULL || p_adv_data->handle != MESH_TIME_HANDLE))
+    {
+        /* first on the backbone, where it takes the least air time */
+        event.backbone = true;
+        event.channel = m_state.backbone_channel;
+        mesh_packet_ref_count_inc(p_packet); /* queue will have a reference until tx_cb */
+        if (radio_order(&event) != NRF_SUCCESS)
+        {
+            mesh_packet_ref_count_dec(p_packet); /* queue couldn't hold the ref */
+            return NRF_ERROR_NO_MEM;
+        }
+        event.backbone = false;
+    }
+
+    if (p_adv_data != NULL &&
+        p_adv_data->handle <= RBC_MESH_APP_MAX_HANDLE &&
+        tc_bridge_handle_is_set(p_adv_data->handle))
+    {
+        /* bridged values reach the other network as well */
+        event.bridge = true;
+        event.channel = m_state.bridge_channel;
+        mesh_packet_ref_count_inc(p_packet); /* queue will have a reference until tx_cb */
+        if (radio_order(&event) != NRF_SUCCESS)
+        {
+            mesh_packet_ref_count_dec(p_packet); /* queue couldn't hold the ref */
+            return NRF_ERROR_NO_MEM;
+        }
+        event.bridge = false;
+    }
+
+    event.access_address = p_config->alt_access_address;
+    event.channel = p_config->first_channel;
+
     /* send packet on each channel in the channel map */
     for (uint32_t i = 0; i < 32; ++i)
     {
@@ -371,11 +656,46 @@ void tc_packet_handler(uint8_t* data, uint32_t crc, uint32_t timestamp, uint8_t
 
     if (p_mesh_adv_data != NULL)
     {
+        mesh_neighbour_rx(&addr, timestamp, rssi);
+
         /* filter mesh packets on handle range */
         if (p_mesh_adv_data->handle <= RBC_MESH_APP_MAX_HANDLE)
         {
             vh_rx(p_packet, timestamp, rssi);
         }
+        else if (p_mesh_adv_data->handle == MESH_BATCH_HANDLE)
+        {
+            vh_rx_batch(p_packet, timestamp, rssi);
+        }
+        else if (p_mesh_adv_data->handle == MESH_OBJECT_HANDLE_SEGMENT ||
+                 p_mesh_adv_data->handle == MESH_OBJECT_HANDLE_REQ)
+        {
+            mesh_object_rx(p_mesh_adv_data, timestamp);
+        }
+        else if (p_mesh_adv_data->handle == MESH_SYNC_HANDLE)
+        {
+            vh_rx_sync(p_mesh_adv_data, timestamp);
+        }
+        else if (p_mesh_adv_data->handle == MESH_SURVEY_HANDLE)
+        {
+            mesh_survey_rx(p_packet, timestamp, rssi);
+        }
+        else if (p_mesh_adv_data->handle == MESH_DIGEST_HANDLE)
+        {
+            mesh_digest_rx(p_mesh_adv_data, timestamp);
+        }
+        else if (p_mesh_adv_data->handle == MESH_REPORT_HANDLE)
+        {
+            mesh_report_rx(p_packet, timestamp, rssi);
+        }
+        else if (p_mesh_adv_data->handle == MESH_TIME_HANDLE)
+        {
+            mesh_time_rx(p_packet, timestamp);
+        }
+        else if (p_mesh_adv_data->handle == MESH_PROBE_HANDLE)
+        {
+            mesh_probe_rx(p_packet, timestamp);
+        }
         else
         {
             mesh_framework_packet_handle(p_mesh_adv_data, timestamp);
@@ -394,6 +714,29 @@ void tc_packet_handler(uint8_t* data, uint32_t crc, uint32_t timestamp, uint8_t
     CLEAR_PIN(PIN_RX);
 }
 
+uint32_t tc_rx_whitelist_set(const ble_gap_addr_t* p_addrs, uint8_t count)
+{
+    if (count > RBC_MESH_RX_WHITELIST_SIZE)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_addrs == NULL && count > 0)
+    {
+        return NRF_ERROR_NULL;
+    }
+#if RBC_MESH_RX_WHITELIST_SIZE > 0
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    if (count > 0)
+    {
+        memcpy(m_rx_whitelist, p_addrs, count * sizeof(ble_gap_addr_t));
+    }
+    m_rx_whitelist_count = count;
+    _ENABLE_IRQS(was_masked);
+#endif
+    return NRF_SUCCESS;
+}
+
 void tc_packet_peek_cb_set(rbc_mesh_packet_peek_cb_t packet_peek_cb)
 {
     mp_packet_peek_cb = packet_peek_cb;
@@ -43,15 +43,24 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 
 #define TIME_MARGIN (1000)
+
+#define DENSITY_C_MAX   (63)    /* Highest C folded into the density, keeps it within 8 bits */
+#define DENSITY_REF_Q2  (TRICKLE_DENSITY_REF * 4)
 /*****************************************************************************
 * Static Globals
 *****************************************************************************/
 
 /*global parameters for trickle behavior, set in trickle_setup() */
-static uint32_t g_i_min, g_i_max;
-static uint8_t g_k;
+static struct
+{
+    uint32_t i_min;
+    uint32_t i_max;
+    uint8_t k;
+} g_params[TRICKLE_PARAM_SETS];
 
-static prng_t g_rand;
+#define I_MIN(trickle)  (g_params[(trickle)->param_set].i_min)
+#define I_MAX(trickle)  (g_params[(trickle)->param_set].i_max)
+#define K(trickle)      (g_params[(trickle)->param_set].k)
 
 /*****************************************************************************
 * Static Functions
@@ -65,6 +74,7 @@ static void trickle_interval_begin(trickle_t* trickle)
     if (trickle_is_enabled(trickle))
     {
         trickle->c = 0;
+        trickle->c_frac = 0;
         trickle->i += trickle->i_relative;
     }
 }
@@ -78,23 +88,66 @@ static void refresh_t(trickle_t* trickle, uint32_t time_now)
     }
     time_prev = time_now;
 
-    uint32_t rand_number = rand_prng_get(&g_rand);
-
     uint32_t i_half = trickle->i_relative >> 1;
 
-    trickle->t = trickle->i + i_half + (rand_number % i_half);
+    trickle->t = trickle->i + i_half + rand_range(i_half);
+}
+
+/** Fold the C of a finished interval into the density, a moving average with weight 1/4. */
+static void density_update(trickle_t* trickle)
+{
+    uint8_t c = (trickle->c > DENSITY_C_MAX) ? DENSITY_C_MAX : trickle->c;
+    trickle->density = trickle->density - (trickle->density >> 2) + c;
+}
+
+/** Count a TX timeout, halving both counters at saturation to keep their ratio. */
+static void tx_stats_update(trickle_t* trickle, bool do_tx)
+{
+    if (trickle->tx_count == UINT16_MAX || trickle->suppressed_count == UINT16_MAX)
+    {
+        trickle->tx_count >>= 1;
+        trickle->suppressed_count >>= 1;
+    }
+    if (do_tx)
+    {
+        trickle->tx_count++;
+    }
+    else
+    {
+        trickle->suppressed_count++;
+    }
+}
+
+/** Length of the first interval after a reset. Dense neighbourhoods spread
+  the reset burst out over a longer interval instead of colliding in i_min. */
+static uint32_t first_interval_get(trickle_t* trickle)
+{
+    uint32_t i_relative = I_MIN(trickle);
+#if TRICKLE_ADAPTIVE
+    for (uint32_t shift = 0;
+        shift < TRICKLE_FIRST_INTERVAL_SHIFT_MAX &&
+        trickle->density >= (DENSITY_REF_Q2 << shift) &&
+        (i_relative << 1) <= I_MAX(trickle) * I_MIN(trickle);
+        ++shift)
+    {
+        i_relative <<= 1;
+    }
+#endif
+    return i_relative;
 }
 
 static void check_interval(trickle_t* trickle, uint32_t time_now)
 {
     if (!TIMER_OLDER_THAN(time_now, trickle->i) && trickle_is_enabled(trickle))
     {
-        if (trickle->i_relative < g_i_max * g_i_min)
+        density_update(trickle);
+        if (trickle->i_relative < I_MAX(trickle) * I_MIN(trickle))
             trickle->i_relative <<= 1;
         else
-            trickle->i_relative = g_i_max * g_i_min;
+            trickle->i_relative = I_MAX(trickle) * I_MIN(trickle);
         /* we've started a new interval since we last touched this trickle */
         trickle->c = 0;
+        trickle->c_frac = 0;
         trickle->i = trickle->i_relative + time_now;
     }
 }
@@ -104,22 +157,84 @@ static void check_interval(trickle_t* trickle, uint32_t time_now)
 *****************************************************************************/
 void trickle_setup(uint32_t i_min, uint32_t i_max, uint8_t k)
 {
-    g_i_min = i_min;
-    g_i_max = i_max;
-    g_k = k;
+    for (uint32_t i = 0; i < TRICKLE_PARAM_SETS; ++i)
+    {
+        trickle_params_set(i, i_min, i_max, k);
+    }
+
+    rand_init();
+}
+
+void trickle_params_set(uint8_t param_set, uint32_t i_min, uint32_t i_max, uint8_t k)
+{
+    APP_ERROR_CHECK_BOOL(param_set < TRICKLE_PARAM_SETS);
+    g_params[param_set].i_min = i_min;
+    g_params[param_set].i_max = i_max;
+    g_params[param_set].k = k;
+}
+
+void trickle_param_set_select(trickle_t* trickle, uint8_t param_set)
+{
+    APP_ERROR_CHECK_BOOL(param_set < TRICKLE_PARAM_SETS);
+    trickle->param_set = param_set;
+}
+
+uint8_t trickle_k_get(trickle_t* trickle)
+{
+#if TRICKLE_ADAPTIVE
+    if (trickle->density > DENSITY_REF_Q2)
+    {
+        uint32_t k = (K(trickle) * DENSITY_REF_Q2) / trickle->density;
+        if (k < TRICKLE_K_MIN)
+        {
+            k = TRICKLE_K_MIN;
+        }
+        return (k < K(trickle)) ? k : K(trickle);
+    }
+#endif
+    return K(trickle);
+}
 
-    rand_prng_seed(&g_rand);
+void trickle_stats_reset(trickle_t* trickle)
+{
+    trickle->density = 0;
+    trickle->tx_count = 0;
+    trickle->suppressed_count = 0;
 }
 
 void trickle_rx_consistent(trickle_t* trickle, uint32_t time_now)
+{
+    trickle_rx_consistent_weighted(trickle, time_now, TRICKLE_RX_WEIGHT_FULL);
+}
+
+void trickle_rx_consistent_weighted(trickle_t* trickle, uint32_t time_now, uint8_t weight)
+{
+    if (trickle_is_enabled(trickle))
+    {
+        TICK_PIN(PIN_CONSISTENT);
+        check_interval(trickle, time_now);
+        trickle->c_frac += (weight > TRICKLE_RX_WEIGHT_FULL) ? TRICKLE_RX_WEIGHT_FULL : weight;
+        if (trickle->c_frac >= TRICKLE_RX_WEIGHT_FULL)
+        {
+            trickle->c_frac -= TRICKLE_RX_WEIGHT_FULL;
+            if (trickle->c + 1 != TRICKLE_C_DISABLED)
+            {
+                ++trickle->c;
+            }
+        }
+    }
+}
+
+void trickle_rx_suppress(trickle_t* trickle, uint32_t time_now)
 {
     if (trickle_is_enabled(trickle))
     {
         TICK_PIN(PIN_CONSISTENT);
         check_interval(trickle, time_now);
-        if (trickle->c + 1 != TRICKLE_C_DISABLED)
+        uint8_t k = trickle_k_get(trickle);
+        if (trickle->c < k)
         {
-            ++trickle->c;
+            trickle->c = k;
         }
     }
 }
@@ -127,7 +242,7 @@ void trickle_rx_consistent(trickle_t* trickle, uint32_t time_now)
 void trickle_rx_inconsistent(trickle_t* trickle, uint32_t time_now)
 {
     TICK_PIN(PIN_INCONSISTENT);
-    if (trickle->i_relative > g_i_min)
+    if (trickle->i_relative > first_interval_get(trickle))
     {
         trickle_timer_reset(trickle, time_now);
     }
@@ -136,12 +251,31 @@ void trickle_rx_inconsistent(trickle_t* trickle, uint32_t time_now)
 void trickle_timer_reset(trickle_t* trickle, uint32_t time_now)
 {
     trickle->i = time_now;
-    trickle->i_relative = g_i_min;
+    trickle->i_relative = first_interval_get(trickle);
 
     refresh_t(trickle, time_now);
     trickle_interval_begin(trickle);
 }
 
+void trickle_tx_advance(trickle_t* trickle, uint32_t time_now)
+{
+    if (!trickle_is_enabled(trickle))
+    {
+        return;
+    }
+    uint32_t i_start = trickle->i - trickle->i_relative;
+    uint32_t i_quarter = trickle->i_relative >> 2;
+    uint32_t t = i_start + i_quarter + rand_range(i_quarter);
+    if (TIMER_OLDER_THAN(t, time_now))
+    {
+        t = time_now;
+    }
+    if (TIMER_OLDER_THAN(t, trickle->t))
+    {
+        trickle->t = t;
+    }
+}
+
 void trickle_tx_register(trickle_t* trickle, uint32_t time_now)
 {
     if (TIMER_OLDER_THAN(trickle->i, time_now))
@@ -159,7 +293,8 @@ void trickle_tx_timeout(trickle_t* trickle, bool* out_do_tx, uint32_t time_now)
     }
     else
     {
-        *out_do_tx = (trickle->c < g_k);
+        *out_do_tx = (trickle->c < trickle_k_get(trickle));
+        tx_stats_update(trickle, *out_do_tx);
         check_interval(trickle, time_now);
         if (!(*out_do_tx))
         {
@@ -42,6 +42,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mesh_packet.h"
 #include "mesh_gatt.h"
 #include "mesh_aci.h"
+#include "mesh_trace.h"
+#include "mesh_stats.h"
+#include "mesh_scene.h"
+#include "mesh_auth.h"
+#include "timeslot.h"
+#include "rand.h"
 
 #include "nrf_error.h"
 #include "app_error.h"
@@ -53,9 +59,54 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define TIMESLOT_STARTUP_DELAY_US       (100)
 
+#if (RBC_MESH_BATCH_VALUE_MAX_LEN + MESH_BATCH_RECORD_OVERHEAD > MESH_BATCH_CAPACITY)
+    #error "RBC_MESH_BATCH_VALUE_MAX_LEN is too long to fit in a batch packet"
+#endif
+
+#define SYNC_REQ_INTERVAL_US           (RBC_MESH_SYNC_REQ_INTERVAL_MS * 1000)
+#define SYNC_HOLDOFF_US                (RBC_MESH_SYNC_HOLDOFF_MS * 1000)
+
+#if (RBC_MESH_SYNC_REQUESTS * RBC_MESH_SYNC_WINDOW > UINT16_MAX)
+    #error "The sync requests span more values than the sync offset can represent"
+#endif
+
+#define LOCAL_UPDATE_WINDOW_US         (RBC_MESH_LOCAL_UPDATE_WINDOW_MS * 1000)
+
 /* event push isn't present in the API header file. */
 extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt);
 
+/******************************************************************************
+* Local typedefs
+******************************************************************************/
+typedef __packed_armcc struct
+{
+    uint8_t                 adv_data_length;
+    uint8_t                 adv_data_type;
+    uint16_t                mesh_uuid;
+    rbc_mesh_value_handle_t handle; /**< Always MESH_SYNC_HANDLE. */
+    uint16_t                offset; /**< Number of the neighbour's most recently used values to skip. */
+} __packed_gcc sync_req_adv_data_t;
+
+#if RBC_MESH_LOCAL_UPDATE_WINDOW_MS > 0
+/** Local update window of a handle, see RBC_MESH_LOCAL_UPDATE_WINDOW_MS. */
+typedef struct
+{
+    timer_event_t           timer_evt;  /**< Fires at the end of the window. */
+    rbc_mesh_value_handle_t handle;     /**< RBC_MESH_INVALID_HANDLE when the slot is free. */
+    bool                    pending;    /**< The value was set during the window, and is waiting for the end of it. */
+    uint8_t                 length;
+    uint8_t                 data[RBC_MESH_VALUE_MAX_LEN];
+} local_update_window_t;
+#endif
+
+#if RBC_MESH_RX_DUP_CACHE_SIZE > 0
+/** Signature of the packet last found consistent with the stored value of a handle. */
+typedef struct
+{
+    rbc_mesh_value_handle_t handle; /**< RBC_MESH_INVALID_HANDLE when the entry is free. */
+    uint32_t                hash;   /**< Hash of the advertiser address and the whole AD structure. */
+} rx_dup_entry_t;
+#endif
 
 /******************************************************************************
 * Static globals
@@ -63,6 +114,23 @@ extern uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt);
 static bool             m_is_initialized = false;
 static timer_event_t    m_tx_timer_evt;
 static tc_tx_config_t   m_tx_config;
+static uint8_t          m_channel;
+static uint8_t          m_channels_per_tx = 1;
+static rbc_mesh_handle_range_t m_subscriptions[RBC_MESH_SUBSCRIPTION_RANGES_MAX];
+static uint8_t          m_subscription_count; /* 0 means all handles */
+static bool             m_is_leaf;            /* only transmit local values */
+static timer_event_t    m_sync_timer_evt;
+static uint8_t          m_sync_reqs_left;
+static bool             m_sync_answered;
+static uint16_t         m_sync_answered_offset;
+static timestamp_t      m_sync_answered_time;
+#if RBC_MESH_LOCAL_UPDATE_WINDOW_MS > 0
+static local_update_window_t m_local_update_windows[RBC_MESH_LOCAL_UPDATE_WINDOWS];
+#endif
+#if RBC_MESH_RX_DUP_CACHE_SIZE > 0
+static rx_dup_entry_t   m_rx_dups[RBC_MESH_RX_DUP_CACHE_SIZE];
+static uint8_t          m_rx_dup_next; /* entry to replace next */
+#endif
 /******************************************************************************
 * Static functions
 ******************************************************************************/
@@ -103,6 +171,143 @@ int16_t version_delta(uint16_t old_version, uint16_t new_version)
     }
 }
 
+#if VH_RSSI_WEIGHTING
+/** Weight of a consistent RX with the given RSSI, in 1/TRICKLE_RX_WEIGHT_FULL. */
+static uint8_t rssi_weight(int8_t rssi_dbm)
+{
+    if (rssi_dbm >= VH_RSSI_STRONG_DBM)
+    {
+        return TRICKLE_RX_WEIGHT_FULL;
+    }
+    if (rssi_dbm <= VH_RSSI_WEAK_DBM)
+    {
+        return 1;
+    }
+    return 1 + ((TRICKLE_RX_WEIGHT_FULL - 1) * (rssi_dbm - VH_RSSI_WEAK_DBM)) /
+        (VH_RSSI_STRONG_DBM - VH_RSSI_WEAK_DBM);
+}
+#endif
+
+#if RBC_MESH_RX_DUP_CACHE_SIZE > 0
+/** FNV-1a over the advertiser address and the AD structure, which covers the
+   handle, version, value and any auth trailer. */
+static uint32_t rx_dup_hash(mesh_packet_t* p_packet, mesh_adv_data_t* p_adv_data)
+{
+    uint32_t hash = 2166136261UL ^ p_packet->header.addr_type;
+    for (uint32_t i = 0; i < BLE_GAP_ADDR_LEN; ++i)
+    {
+        hash = (hash ^ p_packet->addr[i]) * 16777619UL;
+    }
+    const uint8_t* p_data = (const uint8_t*) p_adv_data;
+    for (uint32_t i = 0; i < p_adv_data->adv_data_length + 1U; ++i)
+    {
+        hash = (hash ^ p_data[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+static rx_dup_entry_t* rx_dup_entry_get(rbc_mesh_value_handle_t handle)
+{
+    for (uint32_t i = 0; i < RBC_MESH_RX_DUP_CACHE_SIZE; ++i)
+    {
+        if (m_rx_dups[i].handle == handle)
+        {
+            return &m_rx_dups[i];
+        }
+    }
+    return NULL;
+}
+
+/** Remember the packet as a copy of the stored value of its handle. */
+static void rx_dup_set(mesh_packet_t* p_packet, mesh_adv_data_t* p_adv_data)
+{
+    rx_dup_entry_t* p_entry = rx_dup_entry_get(p_adv_data->handle);
+    if (p_entry == NULL)
+    {
+        p_entry = &m_rx_dups[m_rx_dup_next];
+        m_rx_dup_next = (m_rx_dup_next + 1) % RBC_MESH_RX_DUP_CACHE_SIZE;
+    }
+    p_entry->handle = p_adv_data->handle;
+    p_entry->hash = rx_dup_hash(p_packet, p_adv_data);
+}
+
+/**
+* Count an exact copy of the stored value as a consistent RX, without the
+* rest of the RX processing.
+*
+* @return Whether the packet was a known copy.
+*/
+static bool rx_dup_handle(mesh_packet_t* p_packet, mesh_adv_data_t* p_adv_data, uint32_t timestamp, uint8_t rssi)
+{
+    rx_dup_entry_t* p_entry = rx_dup_entry_get(p_adv_data->handle);
+    if (p_entry == NULL ||
+        p_entry->hash != rx_dup_hash(p_packet, p_adv_data))
+    {
+        return false;
+    }
+#if VH_RSSI_WEIGHTING
+    uint8_t weight = rssi_weight(-((int8_t) rssi));
+#else
+    uint8_t weight = TRICKLE_RX_WEIGHT_FULL;
+#endif
+    if (handle_storage_rx_duplicate(p_adv_data->handle, p_adv_data->version, timestamp, weight) != NRF_SUCCESS)
+    {
+        /* the value has changed or left the cache, take the long way */
+        p_entry->handle = RBC_MESH_INVALID_HANDLE;
+        return false;
+    }
+    MESH_STATS_INC(rx_duplicate);
+    return true;
+}
+#endif
+
+static bool is_subscribed(rbc_mesh_value_handle_t handle)
+{
+    if (m_subscription_count == 0)
+    {
+        return true;
+    }
+    for (uint32_t i = 0; i < m_subscription_count; ++i)
+    {
+        if (handle >= m_subscriptions[i].first && handle <= m_subscriptions[i].last)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Store a new or updated value that is only to be relayed, without telling the application. */
+static uint32_t relay_value_store(mesh_packet_t* p_packet, mesh_adv_data_t* p_adv_data, uint32_t timestamp, int8_t rssi_dbm)
+{
+    if (m_is_leaf)
+    {
+        return NRF_SUCCESS; /* leaves don't relay */
+    }
+    mesh_packet_take_ownership(p_packet);
+    handle_info_t new_info =
+    {
+        .p_packet = p_packet,
+        .version = p_adv_data->version
+    };
+    uint32_t error_code = handle_storage_relay_info_set(p_adv_data->handle, &new_info);
+    if (error_code != NRF_SUCCESS)
+    {
+        return error_code;
+    }
+#if RBC_MESH_RX_DUP_CACHE_SIZE > 0
+    rx_dup_set(p_packet, p_adv_data);
+#endif
+#if VH_RSSI_WEIGHTING
+    if (rssi_dbm <= VH_RSSI_WEAK_DBM)
+    {
+        handle_storage_tx_advance(p_adv_data->handle, timestamp);
+    }
+#endif
+    vh_order_update(timestamp);
+    return NRF_SUCCESS;
+}
+
 /** compare payloads, assuming version number is equal */
 static bool payload_has_conflict(mesh_adv_data_t* p_old_adv, mesh_adv_data_t* p_new_adv)
 {
@@ -117,6 +322,53 @@ static bool payload_has_conflict(mesh_adv_data_t* p_old_adv, mesh_adv_data_t* p_
     return (memcmp(p_old_adv->data, p_new_adv->data, p_old_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD) != 0);
 }
 
+#if RBC_MESH_CONFLICT_RESOLVE
+/**
+* Whether a received payload replaces the stored one of the same version. The
+* longest payload wins, then the one with the highest bytes, which every node
+* agrees on no matter which of the values it got first.
+*/
+static bool conflict_won(handle_info_t* p_info, mesh_adv_data_t* p_new_adv)
+{
+    if (p_info->p_packet == NULL)
+    {
+        return false;
+    }
+    mesh_adv_data_t* p_old_adv = mesh_packet_adv_data_get(p_info->p_packet);
+    if (p_old_adv == NULL ||
+        p_new_adv->adv_data_length != p_old_adv->adv_data_length)
+    {
+        return (p_old_adv == NULL ||
+                p_new_adv->adv_data_length > p_old_adv->adv_data_length);
+    }
+    return (memcmp(p_new_adv->data, p_old_adv->data, p_new_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD) > 0);
+}
+#endif
+
+
+#ifdef MESH_AUTH
+/** Only packets that would change the state of the value need their MIC
+   checked. Older versions are only answered with our own, and repeats of the
+   stored packet are the bulk of the traffic, which skips the AES blocks. */
+static bool auth_required(mesh_packet_t* p_packet, handle_info_t* p_info, uint32_t info_error_code, int16_t delta)
+{
+    if (info_error_code != NRF_SUCCESS || delta > 0)
+    {
+        return true;
+    }
+    if (delta < 0 || p_info->p_packet == NULL)
+    {
+        return false;
+    }
+    mesh_adv_data_t* p_stored_adv = mesh_packet_adv_data_get(p_info->p_packet);
+    mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(p_packet);
+    return (p_stored_adv == NULL ||
+            p_stored_adv->adv_data_length != p_adv->adv_data_length ||
+            p_info->p_packet->header.addr_type != p_packet->header.addr_type ||
+            memcmp(p_info->p_packet->addr, p_packet->addr, BLE_GAP_ADDR_LEN) != 0 ||
+            memcmp(p_stored_adv, p_adv, p_adv->adv_data_length + 1) != 0);
+}
+#endif
 
 static void transmit_all_instances(uint32_t timestamp, void* p_context);
 
@@ -128,6 +380,7 @@ static void order_next_transmission(uint32_t time_now)
     {
         return;
     }
+    timeslot_wakeup_set(timeout);
     if (timeout < time_now + 1000)
     {
         vh_order_update(timeout);
@@ -141,36 +394,196 @@ static void order_next_transmission(uint32_t time_now)
     }
 }
 
+static void transmit_single(mesh_packet_t* p_packet, uint32_t timestamp)
+{
+#ifdef MESH_AUTH
+    /* Values are signed on their first transmission, after the handle storage
+       has settled their version. Unsigned values would only be dropped by the
+       neighbours, so skip the radio time until there's a key. */
+    if (mesh_auth_packet_sign(p_packet) != NRF_SUCCESS)
+    {
+        mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(p_packet);
+        if (p_adv)
+        {
+            APP_ERROR_CHECK(handle_storage_transmitted(p_adv->handle, timestamp));
+        }
+        return;
+    }
+#endif
+    if (tc_tx(p_packet, &m_tx_config) == NRF_SUCCESS)
+    {
+        mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(p_packet);
+        if (p_adv)
+        {
+            PIN_OUT(p_adv->handle, 8);
+            APP_ERROR_CHECK(handle_storage_transmitted(p_adv->handle, timestamp));
+        }
+        else
+        {
+            APP_ERROR_CHECK(NRF_ERROR_INVALID_DATA);
+        }
+    }
+}
+
+static void sync_req_tx(uint16_t offset)
+{
+    mesh_packet_t* p_packet;
+    if (!mesh_packet_acquire(&p_packet))
+    {
+        return; /* the next request covers for it */
+    }
+
+    sync_req_adv_data_t* p_req = (sync_req_adv_data_t*) &p_packet->payload[0];
+    (void) mesh_packet_set_local_addr(p_packet);
+    p_packet->header.length = MESH_PACKET_BLE_OVERHEAD + sizeof(sync_req_adv_data_t);
+    p_packet->header.type = BLE_PACKET_TYPE_ADV_NONCONN_IND;
+
+    p_req->adv_data_length = sizeof(sync_req_adv_data_t) - 1;
+    p_req->adv_data_type = MESH_ADV_DATA_TYPE;
+    p_req->mesh_uuid = MESH_UUID;
+    p_req->handle = MESH_SYNC_HANDLE;
+    p_req->offset = offset;
+
+    (void) tc_tx(p_packet, &m_tx_config);
+    mesh_packet_ref_count_dec(p_packet);
+}
+
+static void sync_timer_order(timestamp_t time_now)
+{
+    /* spread the requests of nodes starting at the same time */
+    timestamp_t delay = SYNC_REQ_INTERVAL_US / 2 + rand_range(SYNC_REQ_INTERVAL_US);
+    (void) timer_sch_reschedule(&m_sync_timer_evt, time_now + delay);
+}
+
+static void sync_timeout(timestamp_t timestamp, void* p_context)
+{
+    if (m_sync_reqs_left == 0)
+    {
+        return;
+    }
+    m_sync_reqs_left--;
+    sync_req_tx((RBC_MESH_SYNC_REQUESTS - 1 - m_sync_reqs_left) * RBC_MESH_SYNC_WINDOW);
+    if (m_sync_reqs_left > 0)
+    {
+        sync_timer_order(timestamp);
+    }
+}
+
+static void sync_start(void* p_context)
+{
+    m_sync_reqs_left = RBC_MESH_SYNC_REQUESTS;
+    if (m_sync_reqs_left > 0)
+    {
+        sync_timer_order(timer_now());
+    }
+}
+
+/** Values with TX events must go out in their own packet, as the TX event is
+   generated from the handle of the transmitted packet. So must bridged values,
+   as the whole packet is forwarded to the other network. */
+static bool batch_eligible(mesh_packet_t* p_packet)
+{
+#ifdef MESH_AUTH
+    /* batch records don't carry the originator's signature */
+    return false;
+#endif
+    mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(p_packet);
+    bool doing_tx_event = false;
+    return (p_adv != NULL &&
+            p_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD <= RBC_MESH_BATCH_VALUE_MAX_LEN &&
+            vh_tx_event_flag_get(p_adv->handle, &doing_tx_event) == NRF_SUCCESS &&
+            !doing_tx_event &&
+            !tc_bridge_handle_is_set(p_adv->handle));
+}
+
+/** Transmit the given packets as a single batch packet. */
+static void transmit_batch(mesh_packet_t** pp_packets, uint32_t count, uint32_t timestamp)
+{
+    if (count == 1)
+    {
+        /* no point in wrapping a single value */
+        transmit_single(pp_packets[0], timestamp);
+        return;
+    }
+
+    mesh_packet_t* p_batch = NULL;
+    if (!mesh_packet_acquire(&p_batch))
+    {
+        return;
+    }
+    APP_ERROR_CHECK(mesh_packet_batch_build(p_batch));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(pp_packets[i]);
+        APP_ERROR_CHECK(mesh_packet_batch_append(p_batch,
+                    p_adv->handle,
+                    p_adv->version,
+                    p_adv->data,
+                    p_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD));
+    }
+
+    if (tc_tx(p_batch, &m_tx_config) == NRF_SUCCESS)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(pp_packets[i]);
+            PIN_OUT(p_adv->handle, 8);
+            APP_ERROR_CHECK(handle_storage_transmitted(p_adv->handle, timestamp));
+        }
+    }
+    mesh_packet_ref_count_dec(p_batch);
+}
+
 static void transmit_all_instances(uint32_t timestamp, void* p_context)
 {
+    TRACE_ENTER(MESH_TRACE_SITE_TRANSMIT_ALL);
     SET_PIN(8);
     mesh_packet_t* pp_tx_packets[RBC_MESH_RADIO_QUEUE_LENGTH - 1];
-    uint32_t count = RBC_MESH_RADIO_QUEUE_LENGTH - 1;
+    /* each packet takes one radio queue slot per channel */
+    uint32_t count = (RBC_MESH_RADIO_QUEUE_LENGTH - 1) / m_channels_per_tx;
 
     uint32_t error_code = handle_storage_tx_packets_get(timestamp, pp_tx_packets, &count);
     if (error_code == NRF_SUCCESS)
     {
+        /* coalesce small values into batches, send the rest as they are */
+        mesh_packet_t* pp_batch[RBC_MESH_RADIO_QUEUE_LENGTH - 1];
+        uint32_t batch_count = 0;
+        uint32_t batch_len = 0;
+
         for (uint32_t i = 0; i < count; ++i)
         {
-            error_code = tc_tx(pp_tx_packets[i], &m_tx_config);
-            if (error_code == NRF_SUCCESS)
+            if (batch_eligible(pp_tx_packets[i]))
             {
                 mesh_adv_data_t* p_adv = mesh_packet_adv_data_get(pp_tx_packets[i]);
-                if (p_adv)
-                {
-                    PIN_OUT(p_adv->handle, 8);
-                    APP_ERROR_CHECK(handle_storage_transmitted(p_adv->handle, timestamp));
-                }
-                else
+                uint32_t record_len = MESH_BATCH_RECORD_OVERHEAD + p_adv->adv_data_length - MESH_PACKET_ADV_OVERHEAD;
+                if (batch_len + record_len > MESH_BATCH_CAPACITY)
                 {
-                    APP_ERROR_CHECK(NRF_ERROR_INVALID_DATA);
+                    transmit_batch(pp_batch, batch_count, timestamp);
+                    batch_count = 0;
+                    batch_len = 0;
                 }
+                pp_batch[batch_count++] = pp_tx_packets[i];
+                batch_len += record_len;
             }
+            else
+            {
+                transmit_single(pp_tx_packets[i], timestamp);
+            }
+        }
+
+        if (batch_count > 0)
+        {
+            transmit_batch(pp_batch, batch_count, timestamp);
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
             mesh_packet_ref_count_dec(pp_tx_packets[i]);
         }
     }
     CLEAR_PIN(8);
     order_next_transmission(timestamp);
+    TRACE_EXIT(MESH_TRACE_SITE_TRANSMIT_ALL);
 }
 
 /******************************************************************************
@@ -192,10 +605,33 @@ uint32_t vh_init(uint32_t min_interval_us,
     m_tx_timer_evt.interval = 0;
     m_tx_timer_evt.p_context = NULL;
 
+    memset(&m_sync_timer_evt, 0, sizeof(m_sync_timer_evt));
+    m_sync_timer_evt.cb = sync_timeout;
+    m_sync_reqs_left = 0;
+    m_sync_answered = false;
+
+#if RBC_MESH_RX_DUP_CACHE_SIZE > 0
+    for (uint32_t i = 0; i < RBC_MESH_RX_DUP_CACHE_SIZE; ++i)
+    {
+        m_rx_dups[i].handle = RBC_MESH_INVALID_HANDLE;
+    }
+    m_rx_dup_next = 0;
+#endif
+
+#if RBC_MESH_LOCAL_UPDATE_WINDOW_MS > 0
+    memset(m_local_update_windows, 0, sizeof(m_local_update_windows));
+    for (uint32_t i = 0; i < RBC_MESH_LOCAL_UPDATE_WINDOWS; ++i)
+    {
+        m_local_update_windows[i].handle = RBC_MESH_INVALID_HANDLE;
+    }
+#endif
+
     m_tx_config.alt_access_address = (access_address != RBC_MESH_ACCESS_ADDRESS_BLE_ADV);
     m_tx_config.first_channel = channel;
     m_tx_config.channel_map = 1; /* Only the first channel */
     m_tx_config.tx_power = tx_power;
+    m_channel = channel;
+    m_channels_per_tx = 1;
 
     m_is_initialized = true;
     return NRF_SUCCESS;
@@ -211,18 +647,70 @@ void vh_tx_power_set(rbc_mesh_txpower_t tx_power)
     m_tx_config.tx_power = tx_power;
 }
 
+const tc_tx_config_t* vh_tx_config_get(void)
+{
+    return &m_tx_config;
+}
+
+void vh_adv_channel_map_set(uint8_t adv_channel_map)
+{
+    if (adv_channel_map == 0)
+    {
+        m_tx_config.first_channel = m_channel;
+        m_tx_config.channel_map = 1; /* Only the first channel */
+        m_channels_per_tx = 1;
+    }
+    else
+    {
+        /* bit 0 in the channel map is the first advertising channel */
+        m_tx_config.first_channel = 37;
+        m_tx_config.channel_map = adv_channel_map;
+        m_channels_per_tx = ((adv_channel_map >> 0) & 0x01) +
+                            ((adv_channel_map >> 1) & 0x01) +
+                            ((adv_channel_map >> 2) & 0x01);
+    }
+}
+
 uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
 {
+    TRACE_ENTER(MESH_TRACE_SITE_VH_RX);
     mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packet);
     if (p_adv_data == NULL)
     {
+        TRACE_EXIT(MESH_TRACE_SITE_VH_RX);
         return NRF_ERROR_INVALID_DATA;
     }
 
+#if RBC_MESH_RX_DUP_CACHE_SIZE > 0
+    if (rx_dup_handle(p_packet, p_adv_data, timestamp, rssi))
+    {
+        TRACE_EXIT(MESH_TRACE_SITE_VH_RX);
+        return NRF_SUCCESS;
+    }
+#endif
+
     handle_info_t info;
     uint32_t error_code = handle_storage_info_get(p_adv_data->handle, &info);
 
     int16_t delta = version_delta(info.version, p_adv_data->version);
+    const bool subscribed = is_subscribed(p_adv_data->handle);
+#if RBC_MESH_CONFLICT_RESOLVE
+    const bool conflict_replaces = (error_code == NRF_SUCCESS &&
+                                    delta == 0 &&
+                                    conflict_won(&info, p_adv_data));
+#else
+    const bool conflict_replaces = false;
+#endif
+
+#ifdef MESH_AUTH
+    if (auth_required(p_packet, &info, error_code, delta) &&
+        mesh_auth_packet_verify(p_packet) != NRF_SUCCESS)
+    {
+        mesh_packet_ref_count_dec(info.p_packet);
+        TRACE_EXIT(MESH_TRACE_SITE_VH_RX);
+        return NRF_ERROR_INVALID_DATA;
+    }
+#endif
 
     /* prepare app event */
     rbc_mesh_event_t evt;
@@ -237,6 +725,14 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
 
     if (error_code == NRF_ERROR_NOT_FOUND)
     {
+        if (!subscribed)
+        {
+            error_code = relay_value_store(p_packet, p_adv_data, timestamp, evt.params.rx.rssi);
+            mesh_packet_ref_count_dec(info.p_packet);
+            TRACE_EXIT(MESH_TRACE_SITE_VH_RX);
+            return error_code;
+        }
+
         /* couldn't find the handle in the handle storage */
         evt.type = RBC_MESH_EVENT_TYPE_NEW_VAL;
         evt.params.rx.version_delta = delta;
@@ -246,6 +742,7 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
         if (error_code != NRF_SUCCESS)
         {
             mesh_packet_ref_count_dec(info.p_packet);
+            TRACE_EXIT(MESH_TRACE_SITE_VH_RX);
             return error_code;
         }
 
@@ -260,10 +757,28 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
         {
             /* assert if this doesn't work. The empty allocation above should have prevented any errors this time. */
             APP_ERROR_CHECK(handle_storage_info_set(p_adv_data->handle, &new_info));
+#if RBC_MESH_RX_DUP_CACHE_SIZE > 0
+            rx_dup_set(p_packet, p_adv_data);
+#endif
+            if (m_is_leaf)
+            {
+                /* keep the value for the application, but don't relay it */
+                APP_ERROR_CHECK(handle_storage_flag_set(p_adv_data->handle, HANDLE_FLAG_DISABLED, true));
+            }
+            mesh_scene_value_rx(p_adv_data->handle,
+                p_adv_data->data,
+                p_adv_data->adv_data_length - MESH_PACKET_ADV_OVERHEAD);
 
             mesh_gatt_value_set(p_adv_data->handle,
                 p_adv_data->data,
                 p_adv_data->adv_data_length - MESH_PACKET_ADV_OVERHEAD);
+#if VH_RSSI_WEIGHTING
+            if (evt.params.rx.rssi <= VH_RSSI_WEAK_DBM)
+            {
+                /* we're at the edge of the sender's range, pass it on early */
+                handle_storage_tx_advance(p_adv_data->handle, timestamp);
+            }
+#endif
         }
 
         vh_order_update(timestamp);
@@ -277,7 +792,7 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
         handle_storage_rx_inconsistent(p_adv_data->handle, timestamp);
         vh_order_update(timestamp);
     }
-    else if (delta == 0)
+    else if (delta == 0 && !conflict_replaces)
     {
         mesh_adv_data_t* p_stored_adv_data = NULL;
         if (info.p_packet)
@@ -285,8 +800,27 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
             p_stored_adv_data = mesh_packet_adv_data_get(info.p_packet);
         }
 
+#if RBC_MESH_CONFLICT_RESOLVE
         if (p_stored_adv_data &&
             payload_has_conflict(p_stored_adv_data, p_adv_data))
+        {
+            /* ours wins, make sure the sender hears it soon */
+            MESH_STATS_INC(conflicts_resolved);
+            handle_storage_rx_inconsistent(p_adv_data->handle, timestamp);
+            vh_order_update(timestamp);
+        }
+        else
+        {
+#if VH_RSSI_WEIGHTING
+            handle_storage_rx_consistent(p_adv_data->handle, timestamp, rssi_weight(evt.params.rx.rssi));
+#else
+            handle_storage_rx_consistent(p_adv_data->handle, timestamp, TRICKLE_RX_WEIGHT_FULL);
+#endif
+        }
+#else
+        if (subscribed &&
+            p_stored_adv_data &&
+            payload_has_conflict(p_stored_adv_data, p_adv_data))
         {
             evt.type = RBC_MESH_EVENT_TYPE_CONFLICTING_VAL;
             rbc_mesh_event_push(&evt); /* not really important whether this succeeds. */
@@ -296,10 +830,37 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
 #endif
         }
 
-        handle_storage_rx_consistent(p_adv_data->handle, timestamp);
+#if VH_RSSI_WEIGHTING
+        handle_storage_rx_consistent(p_adv_data->handle, timestamp, rssi_weight(evt.params.rx.rssi));
+#else
+        handle_storage_rx_consistent(p_adv_data->handle, timestamp, TRICKLE_RX_WEIGHT_FULL);
+#endif
+#endif
+#if RBC_MESH_RX_DUP_CACHE_SIZE > 0
+        if (p_stored_adv_data &&
+            !payload_has_conflict(p_stored_adv_data, p_adv_data))
+        {
+            rx_dup_set(p_packet, p_adv_data);
+        }
+#endif
+    }
+    else if (!subscribed) /* delta > 0, or a conflicting value that wins */
+    {
+        if (conflict_replaces)
+        {
+            MESH_STATS_INC(conflicts_resolved);
+        }
+        error_code = relay_value_store(p_packet, p_adv_data, timestamp, evt.params.rx.rssi);
+        mesh_packet_ref_count_dec(info.p_packet);
+        TRACE_EXIT(MESH_TRACE_SITE_VH_RX);
+        return error_code;
     }
-    else /* delta > 0 */
+    else /* delta > 0, or a conflicting value that wins */
     {
+        if (conflict_replaces)
+        {
+            MESH_STATS_INC(conflicts_resolved);
+        }
         evt.type = RBC_MESH_EVENT_TYPE_UPDATE_VAL;
         evt.params.rx.version_delta = delta;
 
@@ -308,6 +869,7 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
         if (error_code != NRF_SUCCESS)
         {
             mesh_packet_ref_count_dec(info.p_packet);
+            TRACE_EXIT(MESH_TRACE_SITE_VH_RX);
             return error_code;
         }
 
@@ -322,10 +884,28 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
         {
             /* assert if this doesn't work. The empty allocation above should have prevented any errors this time. */
             APP_ERROR_CHECK(handle_storage_info_set(p_adv_data->handle, &new_info));
+#if RBC_MESH_RX_DUP_CACHE_SIZE > 0
+            rx_dup_set(p_packet, p_adv_data);
+#endif
+            if (m_is_leaf)
+            {
+                /* keep the value for the application, but don't relay it */
+                APP_ERROR_CHECK(handle_storage_flag_set(p_adv_data->handle, HANDLE_FLAG_DISABLED, true));
+            }
+            mesh_scene_value_rx(p_adv_data->handle,
+                p_adv_data->data,
+                p_adv_data->adv_data_length - MESH_PACKET_ADV_OVERHEAD);
 
             mesh_gatt_value_set(p_adv_data->handle,
                 p_adv_data->data,
                 p_adv_data->adv_data_length - MESH_PACKET_ADV_OVERHEAD);
+#if VH_RSSI_WEIGHTING
+            if (evt.params.rx.rssi <= VH_RSSI_WEAK_DBM)
+            {
+                /* we're at the edge of the sender's range, pass it on early */
+                handle_storage_tx_advance(p_adv_data->handle, timestamp);
+            }
+#endif
         }
 
         vh_order_update(timestamp);
@@ -336,32 +916,117 @@ uint32_t vh_rx(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
     }
 
     mesh_packet_ref_count_dec(info.p_packet);
+    TRACE_EXIT(MESH_TRACE_SITE_VH_RX);
     return NRF_SUCCESS;
 }
 
-uint32_t vh_local_update(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
+void vh_rx_sync(mesh_adv_data_t* p_adv_data, uint32_t timestamp)
 {
-    if (!m_is_initialized)
+    sync_req_adv_data_t* p_req = (sync_req_adv_data_t*) p_adv_data;
+    if (p_req->adv_data_length < sizeof(sync_req_adv_data_t) - 1)
     {
-        return NRF_ERROR_INVALID_STATE;
+        return;
+    }
+    if (m_sync_answered &&
+        p_req->offset == m_sync_answered_offset &&
+        TIMER_DIFF(timestamp, m_sync_answered_time) < SYNC_HOLDOFF_US)
+    {
+        return; /* already restarted for someone else */
     }
+    m_sync_answered = true;
+    m_sync_answered_offset = p_req->offset;
+    m_sync_answered_time = timestamp;
+
+    /* Every neighbour restarts the same values, trickle suppression keeps
+       them from all sending each one. */
+    handle_storage_sync_reset(p_req->offset, RBC_MESH_SYNC_WINDOW, timestamp);
+    vh_order_update(timestamp);
+}
 
-    uint32_t error_code;
-    mesh_packet_t* p_packet = NULL;
+uint32_t vh_sync_start(void)
+{
+    async_event_t evt;
+    evt.type = EVENT_TYPE_GENERIC;
+    evt.callback.generic.cb = sync_start;
+    evt.callback.generic.p_context = NULL;
+    return event_handler_push(&evt);
+}
 
-    if (!mesh_packet_acquire(&p_packet))
+uint32_t vh_rx_batch(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
+{
+#ifdef MESH_AUTH
+    /* can't be authenticated, authenticated nodes never send them */
+    return NRF_ERROR_INVALID_DATA;
+#endif
+    mesh_batch_adv_data_t* p_batch_adv_data = (mesh_batch_adv_data_t*) mesh_packet_adv_data_get(p_packet);
+    mesh_batch_record_t* p_record = mesh_packet_batch_record_next(p_batch_adv_data, NULL);
+    if (p_record == NULL)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    uint32_t error_code = NRF_SUCCESS;
+    for (; p_record != NULL; p_record = mesh_packet_batch_record_next(p_batch_adv_data, p_record))
+    {
+        if (p_record->handle > RBC_MESH_APP_MAX_HANDLE)
+        {
+            continue;
+        }
+
+        /* The handle storage keeps one packet per value, give each record its own. */
+        mesh_packet_t* p_value_packet = NULL;
+        if (!mesh_packet_acquire(&p_value_packet))
+        {
+            return NRF_ERROR_NO_MEM;
+        }
+        mesh_packet_build(p_value_packet,
+                p_record->handle,
+                p_record->version,
+                p_record->data,
+                p_record->length);
+
+        /* keep the sender's address for the app event */
+        p_value_packet->header.addr_type = p_packet->header.addr_type;
+        memcpy(p_value_packet->addr, p_packet->addr, BLE_GAP_ADDR_LEN);
+
+        uint32_t record_error_code = vh_rx(p_value_packet, timestamp, rssi);
+        if (record_error_code != NRF_SUCCESS)
+        {
+            error_code = record_error_code;
+        }
+        mesh_packet_ref_count_dec(p_value_packet);
+    }
+
+    return error_code;
+}
+
+static uint32_t local_packet_build(mesh_packet_t** pp_packet, rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
+{
+    if (!mesh_packet_acquire(pp_packet))
     {
         return NRF_ERROR_NO_MEM;
     }
 
-    error_code = mesh_packet_build(p_packet,
+    uint32_t error_code = mesh_packet_build(*pp_packet,
             handle,
             1, /* Will be overwritten if handle storage knows the current version */
             data,
             length);
     if (error_code != NRF_SUCCESS)
     {
-        mesh_packet_ref_count_dec(p_packet);
+        mesh_packet_ref_count_dec(*pp_packet);
+        *pp_packet = NULL;
+    }
+    return error_code;
+}
+
+/** Bump the version of a local value, and restart its trickle timer. */
+static uint32_t local_update_send(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
+{
+    mesh_packet_t* p_packet = NULL;
+    uint32_t error_code = local_packet_build(&p_packet, handle, data, length);
+    if (error_code != NRF_SUCCESS)
+    {
         return error_code;
     }
 
@@ -369,12 +1034,222 @@ uint32_t vh_local_update(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t
     if (error_code == NRF_SUCCESS)
     {
         vh_order_update(timer_now()); /* will be executed after the packet push */
+        mesh_scene_value_rx(handle, data, length);
     }
 
     mesh_packet_ref_count_dec(p_packet);
     return error_code;
 }
 
+#if RBC_MESH_LOCAL_UPDATE_WINDOW_MS > 0
+/**
+* End of a local update window. Sends the last value set during the window,
+* and keeps the window open for another period if there was one, so a value
+* that keeps changing is sent once per window.
+*/
+static void local_update_window_end(timestamp_t timestamp, void* p_context)
+{
+    local_update_window_t* p_window = (local_update_window_t*) p_context;
+    uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+    uint8_t length = 0;
+    rbc_mesh_value_handle_t handle = p_window->handle;
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    bool pending = p_window->pending;
+    if (pending)
+    {
+        length = p_window->length;
+        memcpy(data, p_window->data, length);
+        p_window->pending = false;
+    }
+    else
+    {
+        p_window->handle = RBC_MESH_INVALID_HANDLE;
+    }
+    _ENABLE_IRQS(was_masked);
+
+    if (pending)
+    {
+        if (local_update_send(handle, data, length) != NRF_SUCCESS)
+        {
+            /* try again at the end of the next window, unless overwritten */
+            _DISABLE_IRQS(was_masked);
+            if (!p_window->pending)
+            {
+                p_window->length = length;
+                memcpy(p_window->data, data, length);
+                p_window->pending = true;
+            }
+            _ENABLE_IRQS(was_masked);
+        }
+        (void) timer_sch_reschedule(&p_window->timer_evt, timestamp + LOCAL_UPDATE_WINDOW_US);
+    }
+}
+
+/**
+* Store a local update as the pending value of the open window of its handle.
+*
+* @return Whether the handle had an open window.
+*/
+static bool local_update_coalesce(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
+{
+    bool stored = false;
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    for (uint32_t i = 0; i < RBC_MESH_LOCAL_UPDATE_WINDOWS; ++i)
+    {
+        if (m_local_update_windows[i].handle == handle)
+        {
+            m_local_update_windows[i].length = length;
+            memcpy(m_local_update_windows[i].data, data, length);
+            m_local_update_windows[i].pending = true;
+            stored = true;
+            break;
+        }
+    }
+    _ENABLE_IRQS(was_masked);
+    return stored;
+}
+
+/** Open a window for a handle that was just sent, if there's a free slot. */
+static void local_update_window_open(rbc_mesh_value_handle_t handle)
+{
+    local_update_window_t* p_window = NULL;
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    for (uint32_t i = 0; i < RBC_MESH_LOCAL_UPDATE_WINDOWS; ++i)
+    {
+        if (m_local_update_windows[i].handle == RBC_MESH_INVALID_HANDLE)
+        {
+            p_window = &m_local_update_windows[i];
+            p_window->handle = handle;
+            p_window->pending = false;
+            break;
+        }
+    }
+    _ENABLE_IRQS(was_masked);
+
+    if (p_window != NULL)
+    {
+        p_window->timer_evt.cb = local_update_window_end;
+        p_window->timer_evt.p_context = p_window;
+        p_window->timer_evt.interval = TIMER_EVENT_INTERVAL_SINGLE_SHOT;
+        (void) timer_sch_reschedule(&p_window->timer_evt, timer_now() + LOCAL_UPDATE_WINDOW_US);
+    }
+}
+
+/** Drop the pending value of a handle, which has been overtaken by a bulk update. */
+static void local_update_pending_clear(rbc_mesh_value_handle_t handle)
+{
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    for (uint32_t i = 0; i < RBC_MESH_LOCAL_UPDATE_WINDOWS; ++i)
+    {
+        if (m_local_update_windows[i].handle == handle)
+        {
+            m_local_update_windows[i].pending = false;
+        }
+    }
+    _ENABLE_IRQS(was_masked);
+}
+#endif
+
+uint32_t vh_local_update(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+#if RBC_MESH_LOCAL_UPDATE_WINDOW_MS > 0
+    if (length <= RBC_MESH_VALUE_MAX_LEN &&
+        local_update_coalesce(handle, data, length))
+    {
+        return NRF_SUCCESS; /* sent at the end of the window */
+    }
+
+    uint32_t error_code = local_update_send(handle, data, length);
+    if (error_code == NRF_SUCCESS)
+    {
+        local_update_window_open(handle);
+    }
+    return error_code;
+#else
+    return local_update_send(handle, data, length);
+#endif
+}
+
+uint32_t vh_local_update_bulk(const rbc_mesh_value_t* p_values, uint32_t count, uint32_t* p_success_mask)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (count == 0 || count > 32)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    uint32_t error_code = NRF_SUCCESS;
+    mesh_packet_t* packets[32];
+    *p_success_mask = 0;
+
+    /* packet building reads the local address from the softdevice, which
+       can't be done with interrupts disabled. */
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t build_error = local_packet_build(&packets[i], p_values[i].handle, p_values[i].p_data, p_values[i].length);
+        if (build_error != NRF_SUCCESS && error_code == NRF_SUCCESS)
+        {
+            error_code = build_error;
+        }
+    }
+
+    uint32_t was_masked;
+    _DISABLE_IRQS(was_masked);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (packets[i] != NULL)
+        {
+            uint32_t push_error = handle_storage_local_packet_push(packets[i]);
+            if (push_error == NRF_SUCCESS)
+            {
+                *p_success_mask |= (1 << i);
+            }
+            else if (error_code == NRF_SUCCESS)
+            {
+                error_code = push_error;
+            }
+        }
+    }
+    _ENABLE_IRQS(was_masked);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (packets[i] != NULL)
+        {
+            mesh_packet_ref_count_dec(packets[i]);
+        }
+    }
+
+    if (*p_success_mask != 0)
+    {
+        vh_order_update(timer_now()); /* will be executed after the packet push */
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (*p_success_mask & (1 << i))
+        {
+#if RBC_MESH_LOCAL_UPDATE_WINDOW_MS > 0
+            local_update_pending_clear(p_values[i].handle);
+#endif
+            mesh_scene_value_rx(p_values[i].handle, p_values[i].p_data, p_values[i].length);
+        }
+    }
+    return error_code;
+}
+
 uint32_t vh_on_timeslot_begin(void)
 {
     return vh_order_update(timer_now());
@@ -431,6 +1306,42 @@ uint32_t vh_value_get(rbc_mesh_value_handle_t handle, uint8_t* data, uint16_t* l
     return NRF_SUCCESS;
 }
 
+uint32_t vh_value_read(rbc_mesh_value_handle_t handle, uint8_t* data, uint16_t* length, uint16_t* p_version)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return handle_storage_value_read(handle, data, length, p_version);
+}
+
+uint32_t vh_value_peek(rbc_mesh_value_handle_t handle, const uint8_t** pp_data, uint16_t* p_length, uint32_t* p_token)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return handle_storage_value_peek(handle, pp_data, p_length, p_token);
+}
+
+uint32_t vh_value_peek_check(uint32_t token)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return handle_storage_value_peek_check(token);
+}
+
+uint32_t vh_value_next(uint16_t* p_cursor, rbc_mesh_value_handle_t* p_handle, uint8_t* data, uint16_t* length, uint16_t* p_version)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return handle_storage_value_next(p_cursor, p_handle, data, length, p_version);
+}
+
 uint32_t vh_tx_event_set(rbc_mesh_value_handle_t handle, bool do_tx_event)
 {
     if (!m_is_initialized)
@@ -545,6 +1456,24 @@ uint32_t vh_value_persistence_set(rbc_mesh_value_handle_t handle, bool persisten
     return error_code;
 }
 
+uint32_t vh_flag_set_bulk(const rbc_mesh_flag_op_t* p_ops, uint32_t count, uint32_t* p_applied_count)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return handle_storage_flag_set_bulk(p_ops, count, p_applied_count);
+}
+
+uint32_t vh_flag_set_range(rbc_mesh_value_handle_t first, rbc_mesh_value_handle_t last, rbc_mesh_handle_flag_t flag, bool value)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return handle_storage_flag_set_range(first, last, flag, value);
+}
+
 uint32_t vh_value_persistence_get(rbc_mesh_value_handle_t handle, bool* p_persistent)
 {
     if (!m_is_initialized)
@@ -564,3 +1493,87 @@ uint32_t vh_value_persistence_get(rbc_mesh_value_handle_t handle, bool* p_persis
     event_handler_critical_section_end();
     return error_code;
 }
+
+uint32_t vh_value_qos_set(rbc_mesh_value_handle_t handle, rbc_mesh_qos_class_t qos_class)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    return handle_storage_qos_set_async(handle, qos_class);
+}
+
+uint32_t vh_value_qos_get(rbc_mesh_value_handle_t handle, rbc_mesh_qos_class_t* p_qos_class)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    event_handler_critical_section_begin();
+
+    uint32_t error_code = handle_storage_qos_get(handle, p_qos_class);
+
+    event_handler_critical_section_end();
+    return error_code;
+}
+
+void vh_leaf_set(bool is_leaf)
+{
+    m_is_leaf = is_leaf;
+}
+
+uint32_t vh_subscription_set(const rbc_mesh_handle_range_t* p_ranges, uint8_t count)
+{
+    if (count > RBC_MESH_SUBSCRIPTION_RANGES_MAX)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_ranges == NULL && count > 0)
+    {
+        return NRF_ERROR_NULL;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (p_ranges[i].last < p_ranges[i].first)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    event_handler_critical_section_begin();
+    if (count > 0)
+    {
+        memcpy(m_subscriptions, p_ranges, count * sizeof(rbc_mesh_handle_range_t));
+    }
+    m_subscription_count = count;
+    event_handler_critical_section_end();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t vh_value_stats_get(rbc_mesh_value_handle_t handle, rbc_mesh_handle_stats_t* p_stats)
+{
+    if (!m_is_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (handle == RBC_MESH_INVALID_HANDLE)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    return handle_storage_trickle_stats_get(handle, p_stats);
+}
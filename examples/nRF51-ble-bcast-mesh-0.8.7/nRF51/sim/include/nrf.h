@@ -0,0 +1,89 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef SIM_NRF_H__
+#define SIM_NRF_H__
+
+/**
+ * @file
+ * Host stand-in for the device header. Provides the few registers the mesh
+ * core reads, backed by the state of the simulated device.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define __ASM           __asm__
+#define __INLINE        inline
+#define __STATIC_INLINE static inline
+#define __I             volatile const
+#define __O             volatile
+#define __IO            volatile
+
+#define __NOP()
+#define __DMB()
+#define __WFE()
+#define __SEV()
+#define __enable_irq()
+#define __disable_irq()     (0)
+
+typedef enum
+{
+    POWER_CLOCK_IRQn = 0,
+    RADIO_IRQn       = 1,
+    TIMER0_IRQn      = 8,
+    RTC0_IRQn        = 11,
+    SWI0_IRQn        = 20,
+    SWI1_IRQn        = 21,
+    SWI2_IRQn        = 22,
+    SWI3_IRQn        = 23,
+} IRQn_Type;
+
+#define NVIC_EnableIRQ(irq)
+#define NVIC_DisableIRQ(irq)
+#define NVIC_SetPendingIRQ(irq)
+#define NVIC_ClearPendingIRQ(irq)
+#define NVIC_SetPriority(irq, prio)
+
+typedef struct
+{
+    uint32_t DEVICEADDRTYPE;
+    uint32_t DEVICEADDR[2];
+    struct
+    {
+        uint32_t RAM;
+    } INFO;
+} NRF_FICR_Type;
+
+/** Factory information of the simulated device in context. */
+extern NRF_FICR_Type g_sim_ficr;
+
+#define NRF_FICR (&g_sim_ficr)
+
+#endif /* SIM_NRF_H__ */
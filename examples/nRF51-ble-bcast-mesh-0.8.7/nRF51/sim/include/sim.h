@@ -0,0 +1,228 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+#ifndef SIM_H__
+#define SIM_H__
+
+/**
+ * @file
+ * Discrete event simulator for the mesh core. Runs any number of devices in
+ * one host process, by swapping the static state of the core modules in and
+ * out as the simulation moves between devices, and connects them through a
+ * simple radio model.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rbc_mesh.h"
+#include "mesh_packet.h"
+#include "event_handler.h"
+#include "timer.h"
+
+/** Simulation time, in microseconds. Devices see the lower 32 bits through timer_now(). */
+typedef uint64_t sim_time_t;
+
+/** Simulation start, so devices don't all begin at timestamp 0. */
+#define SIM_TIME_START_US           (1000000ULL)
+
+/** Hardware timers of each device, indexed like the TIMER_INDEX_* defines. */
+#define SIM_TIMER_COUNT             (4)
+
+/** Radio ramp-up time, before the first bit of each transmission. */
+#define SIM_RADIO_RAMP_US           (140)
+
+/** Bits on air per byte at 1Mbit. */
+#define SIM_RADIO_US_PER_BYTE       (8)
+
+/** Preamble, access address, CRC and the two byte header, on air around the packet length. */
+#define SIM_RADIO_FRAME_OVERHEAD    (1 + 4 + 3 + 2)
+
+/** Lowest signal a device can receive, in dBm. */
+#define SIM_RADIO_SENSITIVITY_DBM   (-93)
+
+/** Path loss at 1 meter, in dB. */
+#define SIM_RADIO_PATH_LOSS_1M_DB   (40.0)
+
+/** The strongest transmit power of the radio, bounds the neighbour lists. */
+#define SIM_RADIO_TX_POWER_MAX_DBM  (4)
+
+/** Types of simulation events. */
+typedef enum
+{
+    SIM_EVT_DISPATCH,   /**< Run the event handler of a device. */
+    SIM_EVT_TIMER,      /**< Hardware timer of a device fires, arg is the timer index and generation. */
+    SIM_EVT_TX_START,   /**< A device starts transmitting the head of its radio queue. */
+    SIM_EVT_TX_END,     /**< A device has transmitted the head of its radio queue. */
+    SIM_EVT_RX_END,     /**< A device has received a packet, arg is the reception token. */
+    SIM_EVT_PUBLISH,    /**< A device updates a value, arg is the handle. */
+} sim_evt_type_t;
+
+/** Simulation event. */
+typedef struct
+{
+    sim_time_t  time;   /**< When the event happens. */
+    uint64_t    order;  /**< Insertion order, to keep events at the same time in FIFO order. */
+    uint32_t    node;   /**< Device the event happens on. */
+    uint32_t    arg;    /**< Event specific argument. */
+    uint8_t     type;   /**< See @ref sim_evt_type_t. */
+} sim_evt_t;
+
+/** Event queue of one of the simulated event handler priorities. */
+typedef struct
+{
+    async_event_t*  p_evts;
+    uint16_t        len;
+    uint16_t        head;
+    uint16_t        count;
+} sim_evt_queue_t;
+
+/** Radio state of a simulated device. */
+typedef enum
+{
+    SIM_RADIO_RX,       /**< Listening, may lock onto a packet. */
+    SIM_RADIO_RAMP,     /**< Switching to TX, deaf. */
+    SIM_RADIO_TX,       /**< Transmitting, deaf. */
+} sim_radio_state_t;
+
+/** Neighbour of a simulated device, someone who may hear it. */
+typedef struct
+{
+    uint32_t    node;       /**< Index of the neighbour. */
+    float       path_loss;  /**< Path loss to the neighbour, in dB. */
+} sim_neighbour_t;
+
+/** A simulated device. */
+typedef struct
+{
+    uint8_t*            p_state;            /**< Saved static state of the mesh core, while another device runs. */
+    float               x;                  /**< Position, in meters. */
+    float               y;                  /**< Position, in meters. */
+    sim_neighbour_t*    p_neighbours;
+    uint32_t            neighbour_count;
+
+    sim_evt_queue_t     rx_queue;           /**< Received packets. */
+    sim_evt_queue_t     ts_queue;           /**< Timer events. */
+    sim_evt_queue_t     evt_queue;          /**< Everything else. */
+    bool                dispatch_pending;
+
+    struct
+    {
+        timer_callback_t    cb;
+        timer_attr_t        attr;
+        timestamp_t         timestamp;
+        uint32_t            generation;     /**< Ordering a timer again invalidates the pending fire event. */
+    } timers[SIM_TIMER_COUNT];
+
+    mesh_packet_t       tx_queue[RBC_MESH_RADIO_QUEUE_LENGTH];
+    uint8_t             tx_channels[RBC_MESH_RADIO_QUEUE_LENGTH];  /**< Channels each queued packet goes out on. */
+    int8_t              tx_power[RBC_MESH_RADIO_QUEUE_LENGTH];     /**< Transmit power of each queued packet, in dBm. */
+    uint8_t             tx_head;
+    uint8_t             tx_count;
+    sim_radio_state_t   radio_state;
+
+    mesh_packet_t       rx_packet;          /**< Packet the receiver is locked onto. */
+    bool                rx_active;
+    bool                rx_corrupt;
+    int8_t              rx_rssi;            /**< Signal of the locked packet, in dBm. */
+    uint32_t            rx_token;           /**< Matches the RX_END event to the reception. */
+
+    uint32_t            tx_packets;         /**< Packets transmitted, each on all its channels. */
+    uint64_t            tx_airtime_us;      /**< Time on air. */
+    uint32_t            rx_packets;         /**< Packets passed to the event handler. */
+    uint32_t            rx_collisions;      /**< Packets lost to an overlapping one. */
+    uint32_t            rx_deaf;            /**< Packets missed while transmitting. */
+    uint32_t            rx_lost;            /**< Packets lost to the random loss. */
+    uint32_t            rx_queue_full;      /**< Packets dropped for a full event queue or packet pool. */
+} sim_node_t;
+
+/** Parameters of the radio model. */
+typedef struct
+{
+    float       path_loss_exponent;     /**< Log distance path loss exponent. */
+    float       capture_db;             /**< Signal margin that lets a locked packet survive an overlapping one. */
+    float       loss;                   /**< Share of otherwise good packets lost, 0 to 1. */
+} sim_radio_params_t;
+
+/*****************************************************************************
+* sim_sched.c
+*****************************************************************************/
+void sim_sched_init(void);
+
+void sim_sched_push(sim_time_t time, sim_evt_type_t type, uint32_t node, uint32_t arg);
+
+bool sim_sched_pop(sim_evt_t* p_evt);
+
+sim_time_t sim_now(void);
+
+/*****************************************************************************
+* sim_node.c
+*****************************************************************************/
+extern sim_node_t* g_sim_nodes;
+extern uint32_t g_sim_node_count;
+
+void sim_nodes_init(uint32_t count, uint64_t seed);
+
+void sim_node_enter(uint32_t node);
+
+uint32_t sim_node_current(void);
+
+void sim_node_mesh_init(uint32_t node,
+        uint32_t interval_min_us,
+        uint32_t access_addr,
+        uint8_t channel,
+        rbc_mesh_txpower_t tx_power);
+
+void sim_node_dispatch(uint32_t node);
+
+void sim_node_timer_fire(uint32_t node, uint32_t arg);
+
+void sim_node_packet_rx(uint32_t node, const mesh_packet_t* p_packet, int8_t rssi);
+
+uint32_t sim_rand(void);
+
+float sim_randf(void);
+
+/*****************************************************************************
+* sim_radio.c
+*****************************************************************************/
+void sim_radio_init(const sim_radio_params_t* p_params);
+
+void sim_radio_tx_start(uint32_t node);
+
+void sim_radio_tx_end(uint32_t node);
+
+void sim_radio_rx_end(uint32_t node, uint32_t token);
+
+/*****************************************************************************
+* main.c
+*****************************************************************************/
+/** Called when a device's application gets a new value. */
+void sim_value_rx(uint32_t node, rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length);
+
+#endif /* SIM_H__ */
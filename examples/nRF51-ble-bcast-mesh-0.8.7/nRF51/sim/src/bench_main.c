@@ -0,0 +1,175 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+/**
+ * @file
+ * Host runner of the data structure microbenchmarks in mesh_microbench.c,
+ * with stand-ins for the rest of the framework.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "mesh_microbench.h"
+#include "event_handler.h"
+#include "timer.h"
+#include "rand.h"
+#include "timeslot.h"
+#include "app_error.h"
+#include "nrf_error.h"
+#if defined(__x86_64__) || defined(__i386__)
+/* the time stamp counter, without the intrinsics headers, which clash with the device header macros */
+#define cycles_read()       __builtin_ia32_rdtsc()
+#define HAVE_CYCLES
+#endif
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define ROUNDS_DEFAULT      (10000)
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static double m_ns_per_tick = 1.0;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint64_t ns_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+#ifdef HAVE_CYCLES
+static uint32_t cycles_get(void)
+{
+    return (uint32_t) cycles_read();
+}
+
+/** Time stamp counter ticks against the monotonic clock. */
+static void cycles_calibrate(void)
+{
+    uint64_t ns_start = ns_now();
+    uint64_t cycles_start = cycles_read();
+    while (ns_now() - ns_start < 100000000ULL)
+    {
+    }
+    m_ns_per_tick = (double) (ns_now() - ns_start) / (double) (cycles_read() - cycles_start);
+}
+#else
+static uint32_t ns_get(void)
+{
+    return (uint32_t) ns_now();
+}
+#endif
+
+static void result_print(const mesh_microbench_result_t* p_result)
+{
+    double ticks_per_op = (double) p_result->ticks / p_result->ops;
+#ifdef HAVE_CYCLES
+    printf("%-24s %6u %10.1f %10.1f\n", p_result->p_name, p_result->entries,
+            ticks_per_op * m_ns_per_tick, ticks_per_op);
+#else
+    printf("%-24s %6u %10.1f %10s\n", p_result->p_name, p_result->entries,
+            ticks_per_op, "-");
+#endif
+}
+
+/*****************************************************************************
+* Framework stand-ins
+*****************************************************************************/
+uint32_t event_handler_push(async_event_t* p_evt)
+{
+    return NRF_SUCCESS;
+}
+
+void event_handler_critical_section_begin(void)
+{
+}
+
+void event_handler_critical_section_end(void)
+{
+}
+
+timestamp_t timer_now(void)
+{
+    return 0; /* like outside a timeslot, the benchmarks pass their own time */
+}
+
+uint32_t rand_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t rand_range(uint32_t range)
+{
+    return (range == 0) ? 0 : (uint32_t) rand() % range;
+}
+
+uint32_t timeslot_duty_cycle_get(void)
+{
+    return 0;
+}
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t* p_file_name)
+{
+    fprintf(stderr, "Error 0x%x at %s:%u\n", error_code,
+            p_file_name ? (const char*) p_file_name : "?", line_num);
+    exit(1);
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+int main(int argc, char** argv)
+{
+    mesh_microbench_params_t params;
+    params.rounds = (argc > 1) ? strtoul(argv[1], NULL, 0) : ROUNDS_DEFAULT;
+    params.clock_mask = UINT32_MAX;
+    params.result_cb = result_print;
+#ifdef HAVE_CYCLES
+    cycles_calibrate();
+    params.clock = cycles_get;
+#else
+    params.clock = ns_get;
+#endif
+
+    printf("%-24s %6s %10s %10s\n", "case", "values", "ns/op", "cycles/op");
+    uint32_t error_code = mesh_microbench_run(&params);
+    if (error_code != NRF_SUCCESS)
+    {
+        fprintf(stderr, "Benchmark failed: 0x%x\n", error_code);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,487 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+/**
+ * @file
+ * Runs a network of simulated devices where some devices publish a value
+ * at a fixed rate, and reports how fast and how far each update spreads,
+ * and what it costs in airtime.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "sim.h"
+#include "version_handler.h"
+#include "mesh_stats.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define SEQ_LEN             (4)
+#define WARMUP_US           (1000000ULL)
+
+typedef struct
+{
+    uint32_t    nodes;
+    bool        random_layout;
+    float       spacing;
+    uint32_t    interval_min_ms;
+    int8_t      tx_power;
+    uint32_t    publishers;
+    uint32_t    period_ms;
+    uint32_t    value_len;
+    float       duration_s;
+    float       settle_s;
+    uint64_t    seed;
+    sim_radio_params_t radio;
+} sim_params_t;
+
+/** Spread of one published update. */
+typedef struct
+{
+    sim_time_t  published;
+    sim_time_t  last_reached;
+    uint32_t    reached;
+} update_t;
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static sim_params_t m_params =
+{
+    .nodes = 100,
+    .random_layout = false,
+    .spacing = 10.0f,
+    .interval_min_ms = 100,
+    .tx_power = 0,
+    .publishers = 1,
+    .period_ms = 1000,
+    .value_len = SEQ_LEN,
+    .duration_s = 30.0f,
+    .settle_s = 5.0f,
+    .seed = 1,
+    .radio =
+    {
+        .path_loss_exponent = 3.0f,
+        .capture_db = 6.0f,
+        .loss = 0.0f,
+    },
+};
+
+static update_t** mp_updates;       /**< Updates of each publisher, by sequence number. */
+static uint32_t* mp_update_count;   /**< Updates published by each publisher. */
+static uint32_t m_update_max;
+static uint32_t* mp_node_seq;       /**< Latest sequence number of each publisher at each device. */
+static uint32_t* mp_latency;        /**< Time from publication to each device getting each update, in microseconds. */
+static uint32_t m_latency_count;
+static uint32_t m_latency_size;
+static uint32_t m_publish_fails;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static void usage(const char* p_name)
+{
+    printf("Usage: %s [options]\n"
+           "  -n <count>    Number of devices (%u)\n"
+           "  -r            Place the devices at random, instead of on a grid\n"
+           "  -d <meters>   Grid spacing, or the mean spacing of random placement (%.1f)\n"
+           "  -e <exponent> Path loss exponent (%.1f)\n"
+           "  -c <dB>       Capture margin of a packet over an overlapping one (%.1f)\n"
+           "  -l <percent>  Random packet loss (%.1f)\n"
+           "  -i <ms>       Minimum Trickle interval (%u)\n"
+           "  -p <dBm>      Transmit power (%d)\n"
+           "  -P <count>    Publishing devices, each on its own handle (%u)\n"
+           "  -u <ms>       Time between updates of each publisher (%u)\n"
+           "  -v <bytes>    Value length (%u)\n"
+           "  -t <s>        Simulated time (%.1f)\n"
+           "  -w <s>        Time at the end without updates, to let the last ones settle (%.1f)\n"
+           "  -s <seed>     Random seed (%llu)\n",
+           p_name,
+           m_params.nodes,
+           m_params.spacing,
+           m_params.radio.path_loss_exponent,
+           m_params.radio.capture_db,
+           m_params.radio.loss * 100.0f,
+           m_params.interval_min_ms,
+           m_params.tx_power,
+           m_params.publishers,
+           m_params.period_ms,
+           m_params.value_len,
+           m_params.duration_s,
+           m_params.settle_s,
+           (unsigned long long) m_params.seed);
+}
+
+static bool params_parse(int argc, char** argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:rd:e:c:l:i:p:P:u:v:t:w:s:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': m_params.nodes = strtoul(optarg, NULL, 0); break;
+            case 'r': m_params.random_layout = true; break;
+            case 'd': m_params.spacing = strtof(optarg, NULL); break;
+            case 'e': m_params.radio.path_loss_exponent = strtof(optarg, NULL); break;
+            case 'c': m_params.radio.capture_db = strtof(optarg, NULL); break;
+            case 'l': m_params.radio.loss = strtof(optarg, NULL) / 100.0f; break;
+            case 'i': m_params.interval_min_ms = strtoul(optarg, NULL, 0); break;
+            case 'p': m_params.tx_power = (int8_t) strtol(optarg, NULL, 0); break;
+            case 'P': m_params.publishers = strtoul(optarg, NULL, 0); break;
+            case 'u': m_params.period_ms = strtoul(optarg, NULL, 0); break;
+            case 'v': m_params.value_len = strtoul(optarg, NULL, 0); break;
+            case 't': m_params.duration_s = strtof(optarg, NULL); break;
+            case 'w': m_params.settle_s = strtof(optarg, NULL); break;
+            case 's': m_params.seed = strtoull(optarg, NULL, 0); break;
+            default:
+                usage(argv[0]);
+                return false;
+        }
+    }
+
+    if (m_params.nodes < 2 ||
+        m_params.publishers == 0 ||
+        m_params.publishers > m_params.nodes ||
+        m_params.publishers > RBC_MESH_APP_MAX_HANDLE ||
+        m_params.period_ms == 0 ||
+        m_params.value_len < SEQ_LEN ||
+        m_params.value_len > RBC_MESH_VALUE_MAX_LEN ||
+        m_params.radio.path_loss_exponent <= 0.0f ||
+        m_params.settle_s >= m_params.duration_s)
+    {
+        usage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+static void nodes_place(void)
+{
+    uint32_t columns = (uint32_t) ceilf(sqrtf((float) m_params.nodes));
+    float side = columns * m_params.spacing;
+    for (uint32_t i = 0; i < m_params.nodes; ++i)
+    {
+        if (m_params.random_layout)
+        {
+            g_sim_nodes[i].x = sim_randf() * side;
+            g_sim_nodes[i].y = sim_randf() * side;
+        }
+        else
+        {
+            g_sim_nodes[i].x = (i % columns) * m_params.spacing;
+            g_sim_nodes[i].y = (i / columns) * m_params.spacing;
+        }
+    }
+}
+
+static uint32_t publisher_node(uint32_t publisher)
+{
+    /* spread out over the device list, which is also spread out on the grid */
+    return (uint32_t) (((uint64_t) publisher * m_params.nodes) / m_params.publishers);
+}
+
+static void latency_add(sim_time_t latency)
+{
+    if (m_latency_count == m_latency_size)
+    {
+        m_latency_size = m_latency_size ? m_latency_size * 2 : 1024;
+        mp_latency = realloc(mp_latency, m_latency_size * sizeof(uint32_t));
+        if (mp_latency == NULL)
+        {
+            fprintf(stderr, "Out of memory for the latency samples\n");
+            exit(1);
+        }
+    }
+    mp_latency[m_latency_count++] = (uint32_t) latency;
+}
+
+/** Mark the updates up to seq as reached at the device. */
+static void updates_reach(uint32_t node, uint32_t publisher, uint32_t seq)
+{
+    uint32_t* p_node_seq = &mp_node_seq[node * m_params.publishers + publisher];
+    if (seq > mp_update_count[publisher])
+    {
+        return; /* not published in this run */
+    }
+    for (uint32_t i = *p_node_seq + 1; i <= seq; ++i)
+    {
+        update_t* p_update = &mp_updates[publisher][i - 1];
+        p_update->reached++;
+        p_update->last_reached = sim_now();
+        if (node != publisher_node(publisher))
+        {
+            latency_add(sim_now() - p_update->published);
+        }
+    }
+    if (seq > *p_node_seq)
+    {
+        *p_node_seq = seq;
+    }
+}
+
+static void publish(uint32_t node, uint32_t publisher)
+{
+    sim_node_enter(node);
+    uint32_t seq = mp_update_count[publisher] + 1;
+    if (seq > m_update_max)
+    {
+        return;
+    }
+
+    uint8_t data[RBC_MESH_VALUE_MAX_LEN];
+    memset(data, 0, sizeof(data));
+    memcpy(data, &seq, SEQ_LEN);
+    if (vh_local_update(publisher + 1, data, m_params.value_len) != NRF_SUCCESS)
+    {
+        m_publish_fails++;
+        return;
+    }
+    mp_update_count[publisher] = seq;
+    mp_updates[publisher][seq - 1].published = sim_now();
+    updates_reach(node, publisher, seq);
+}
+
+static int latency_compare(const void* p_a, const void* p_b)
+{
+    uint32_t a = *(const uint32_t*) p_a;
+    uint32_t b = *(const uint32_t*) p_b;
+    return (a > b) - (a < b);
+}
+
+static double percentile_ms(const uint32_t* p_sorted, uint32_t count, uint32_t percent)
+{
+    if (count == 0)
+    {
+        return 0.0;
+    }
+    uint32_t index = (uint32_t) (((uint64_t) count * percent) / 100);
+    if (index >= count)
+    {
+        index = count - 1;
+    }
+    return p_sorted[index] / 1000.0;
+}
+
+static void report(void)
+{
+    uint64_t neighbours = 0;
+    uint64_t tx_packets = 0;
+    uint64_t airtime_us = 0;
+    uint64_t rx_packets = 0;
+    uint64_t rx_collisions = 0;
+    uint64_t rx_deaf = 0;
+    uint64_t rx_lost = 0;
+    uint64_t rx_queue_full = 0;
+    rbc_mesh_stats_t total;
+    memset(&total, 0, sizeof(total));
+
+    for (uint32_t i = 0; i < m_params.nodes; ++i)
+    {
+        sim_node_t* p_node = &g_sim_nodes[i];
+        neighbours += p_node->neighbour_count;
+        tx_packets += p_node->tx_packets;
+        airtime_us += p_node->tx_airtime_us;
+        rx_packets += p_node->rx_packets;
+        rx_collisions += p_node->rx_collisions;
+        rx_deaf += p_node->rx_deaf;
+        rx_lost += p_node->rx_lost;
+        rx_queue_full += p_node->rx_queue_full;
+
+        rbc_mesh_stats_t stats;
+        sim_node_enter(i);
+        mesh_stats_get(&stats);
+        total.tx_count += stats.tx_count;
+        total.pool_exhausted += stats.pool_exhausted;
+        total.event_queue_drop += stats.event_queue_drop;
+        total.radio_queue_drop += stats.radio_queue_drop;
+        total.conflicts_resolved += stats.conflicts_resolved;
+        total.rx_duplicate += stats.rx_duplicate;
+        total.cache_hits += stats.cache_hits;
+        total.cache_misses += stats.cache_misses;
+        total.cache_evictions += stats.cache_evictions;
+    }
+
+    /* updates stop at publish_end, so they all have time to settle */
+    uint32_t settled = 0;
+    uint32_t converged = 0;
+    uint64_t reached = 0;
+    uint32_t* p_convergence = malloc((m_update_max * m_params.publishers + 1) * sizeof(uint32_t));
+    for (uint32_t p = 0; p < m_params.publishers; ++p)
+    {
+        for (uint32_t i = 0; i < mp_update_count[p]; ++i)
+        {
+            update_t* p_update = &mp_updates[p][i];
+            settled++;
+            reached += p_update->reached;
+            if (p_update->reached == m_params.nodes)
+            {
+                p_convergence[converged++] = (uint32_t) (p_update->last_reached - p_update->published);
+            }
+        }
+    }
+    qsort(p_convergence, converged, sizeof(uint32_t), latency_compare);
+    qsort(mp_latency, m_latency_count, sizeof(uint32_t), latency_compare);
+
+    double seconds = m_params.duration_s;
+    printf("Devices:        %u, %s %.1f m apart, %.1f neighbours on average\n",
+            m_params.nodes,
+            m_params.random_layout ? "on average" : "on a grid",
+            m_params.spacing,
+            (double) neighbours / m_params.nodes);
+    printf("Updates:        %u published by %u device(s), %u refused by the framework\n",
+            settled,
+            m_params.publishers,
+            m_publish_fails);
+    printf("Coverage:       %.1f %% of the devices got each settled update\n",
+            settled ? 100.0 * reached / ((double) settled * m_params.nodes) : 0.0);
+    printf("Convergence:    %u of %u reached every device, median %.1f ms, max %.1f ms\n",
+            converged, settled,
+            percentile_ms(p_convergence, converged, 50),
+            converged ? p_convergence[converged - 1] / 1000.0 : 0.0);
+    printf("Latency:        median %.1f ms, 95th percentile %.1f ms, to each device\n",
+            percentile_ms(mp_latency, m_latency_count, 50),
+            percentile_ms(mp_latency, m_latency_count, 95));
+    printf("Airtime:        %.2f packets/s per device, %.2f %% of the time on air\n",
+            tx_packets / seconds / m_params.nodes,
+            100.0 * airtime_us / (seconds * 1e6 * m_params.nodes));
+    printf("Receptions:     %llu ok, %llu collided, %llu missed while transmitting, %llu lost, %llu dropped\n",
+            (unsigned long long) rx_packets,
+            (unsigned long long) rx_collisions,
+            (unsigned long long) rx_deaf,
+            (unsigned long long) rx_lost,
+            (unsigned long long) rx_queue_full);
+    printf("Duplicates:     %u (%.1f %% of the received packets)\n",
+            total.rx_duplicate,
+            rx_packets ? 100.0 * total.rx_duplicate / rx_packets : 0.0);
+    printf("Caches:         %u hits, %u misses, %u evictions\n",
+            total.cache_hits,
+            total.cache_misses,
+            total.cache_evictions);
+    printf("Core:           %u conflicts resolved, %u pool exhausted, %u event queue drops, %u radio queue drops\n",
+            total.conflicts_resolved,
+            total.pool_exhausted,
+            total.event_queue_drop,
+            total.radio_queue_drop);
+    free(p_convergence);
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void sim_value_rx(uint32_t node, rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length)
+{
+    if (handle == 0 || handle > m_params.publishers || length < SEQ_LEN)
+    {
+        return;
+    }
+    uint32_t seq;
+    memcpy(&seq, p_data, SEQ_LEN);
+    updates_reach(node, handle - 1, seq);
+}
+
+int main(int argc, char** argv)
+{
+    if (!params_parse(argc, argv))
+    {
+        return 1;
+    }
+
+    sim_sched_init();
+    sim_nodes_init(m_params.nodes, m_params.seed);
+    nodes_place();
+    sim_radio_init(&m_params.radio);
+
+    sim_time_t end = SIM_TIME_START_US + (sim_time_t) (m_params.duration_s * 1e6);
+    sim_time_t publish_end = end - (sim_time_t) (m_params.settle_s * 1e6);
+    sim_time_t period_us = m_params.period_ms * 1000ULL;
+
+    m_update_max = (uint32_t) ((publish_end - SIM_TIME_START_US) / period_us) + 1;
+    mp_updates = malloc(m_params.publishers * sizeof(update_t*));
+    mp_update_count = calloc(m_params.publishers, sizeof(uint32_t));
+    mp_node_seq = calloc((size_t) m_params.nodes * m_params.publishers, sizeof(uint32_t));
+    for (uint32_t p = 0; p < m_params.publishers; ++p)
+    {
+        mp_updates[p] = calloc(m_update_max, sizeof(update_t));
+    }
+
+    for (uint32_t i = 0; i < m_params.nodes; ++i)
+    {
+        sim_node_mesh_init(i,
+                m_params.interval_min_ms * 1000,
+                RBC_MESH_ACCESS_ADDRESS_BLE_ADV,
+                38,
+                (rbc_mesh_txpower_t) (uint8_t) m_params.tx_power);
+    }
+
+    /* publishers take turns within each period */
+    for (uint32_t p = 0; p < m_params.publishers; ++p)
+    {
+        sim_sched_push(SIM_TIME_START_US + WARMUP_US + (period_us * p) / m_params.publishers,
+                SIM_EVT_PUBLISH, publisher_node(p), p);
+    }
+
+    sim_evt_t evt;
+    while (sim_sched_pop(&evt) && evt.time <= end)
+    {
+        switch (evt.type)
+        {
+            case SIM_EVT_DISPATCH:
+                sim_node_dispatch(evt.node);
+                break;
+            case SIM_EVT_TIMER:
+                sim_node_timer_fire(evt.node, evt.arg);
+                break;
+            case SIM_EVT_TX_START:
+                sim_radio_tx_start(evt.node);
+                break;
+            case SIM_EVT_TX_END:
+                sim_radio_tx_end(evt.node);
+                break;
+            case SIM_EVT_RX_END:
+                sim_radio_rx_end(evt.node, evt.arg);
+                break;
+            case SIM_EVT_PUBLISH:
+                publish(evt.node, evt.arg);
+                if (evt.time + period_us <= publish_end)
+                {
+                    sim_sched_push(evt.time + period_us, SIM_EVT_PUBLISH, evt.node, evt.arg);
+                }
+                break;
+        }
+    }
+
+    report();
+    return 0;
+}
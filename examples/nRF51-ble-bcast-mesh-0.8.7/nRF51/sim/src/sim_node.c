@@ -0,0 +1,468 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "version_handler.h"
+#include "handle_storage.h"
+#include "timer_scheduler.h"
+#include "mesh_stats.h"
+#include "timeslot.h"
+#include "rand.h"
+#include "mesh_gatt.h"
+#include "mesh_scene.h"
+#include "app_error.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Local defines
+*****************************************************************************/
+#define NODE_NONE   (0xFFFFFFFF)
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+/** Bounds of the static state of the mesh core, gathered by the link step. */
+extern uint8_t __start_mesh_state[];
+extern uint8_t __stop_mesh_state[];
+
+sim_node_t* g_sim_nodes;
+uint32_t g_sim_node_count;
+
+static uint32_t m_current = NODE_NONE;
+static uint64_t m_prng;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static size_t state_size(void)
+{
+    return (size_t) (__stop_mesh_state - __start_mesh_state);
+}
+
+static void queue_init(sim_evt_queue_t* p_queue, uint16_t len)
+{
+    p_queue->p_evts = calloc(len, sizeof(async_event_t));
+    p_queue->len = len;
+    p_queue->head = 0;
+    p_queue->count = 0;
+}
+
+static uint32_t queue_push(sim_evt_queue_t* p_queue, const async_event_t* p_evt)
+{
+    if (p_queue->count == p_queue->len)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_queue->p_evts[(p_queue->head + p_queue->count++) % p_queue->len] = *p_evt;
+    return NRF_SUCCESS;
+}
+
+static bool queue_pop(sim_evt_queue_t* p_queue, async_event_t* p_evt)
+{
+    if (p_queue->count == 0)
+    {
+        return false;
+    }
+    *p_evt = p_queue->p_evts[p_queue->head];
+    p_queue->head = (p_queue->head + 1) % p_queue->len;
+    p_queue->count--;
+    return true;
+}
+
+static void dispatch_order(uint32_t node)
+{
+    if (!g_sim_nodes[node].dispatch_pending)
+    {
+        g_sim_nodes[node].dispatch_pending = true;
+        sim_sched_push(sim_now(), SIM_EVT_DISPATCH, node, 0);
+    }
+}
+
+/** The part of tc_packet_handler() that concerns the core modules. */
+static void packet_handle(mesh_packet_t* p_packet, uint32_t timestamp, uint8_t rssi)
+{
+    mesh_adv_data_t* p_adv_data = mesh_packet_adv_data_get(p_packet);
+    if (p_adv_data != NULL)
+    {
+        if (p_adv_data->handle <= RBC_MESH_APP_MAX_HANDLE)
+        {
+            vh_rx(p_packet, timestamp, rssi);
+        }
+        else if (p_adv_data->handle == MESH_BATCH_HANDLE)
+        {
+            vh_rx_batch(p_packet, timestamp, rssi);
+        }
+        else if (p_adv_data->handle == MESH_SYNC_HANDLE)
+        {
+            vh_rx_sync(p_adv_data, timestamp);
+        }
+    }
+    mesh_packet_ref_count_dec(p_packet); /* from the radio */
+}
+
+static void async_event_execute(async_event_t* p_evt)
+{
+    switch (p_evt->type)
+    {
+        case EVENT_TYPE_TIMER:
+            p_evt->callback.timer.cb(p_evt->callback.timer.timestamp);
+            break;
+        case EVENT_TYPE_GENERIC:
+            p_evt->callback.generic.cb(p_evt->callback.generic.p_context);
+            break;
+        case EVENT_TYPE_PACKET:
+            packet_handle((mesh_packet_t*) p_evt->callback.packet.payload,
+                          p_evt->callback.packet.timestamp,
+                          p_evt->callback.packet.rssi);
+            break;
+        case EVENT_TYPE_SET_FLAG:
+            handle_storage_flag_set(p_evt->callback.set_flag.handle,
+                                    (handle_flag_t) p_evt->callback.set_flag.flag,
+                                    p_evt->callback.set_flag.value);
+            break;
+        case EVENT_TYPE_SET_QOS:
+            handle_storage_qos_set(p_evt->callback.set_qos.handle,
+                                   (rbc_mesh_qos_class_t) p_evt->callback.set_qos.qos_class);
+            break;
+        case EVENT_TYPE_TIMER_SCH:
+            p_evt->callback.timer_sch.cb(p_evt->callback.timer_sch.timestamp,
+                                         p_evt->callback.timer_sch.p_context);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool queue_execute(sim_evt_queue_t* p_queue, uint32_t budget)
+{
+    bool got_evt = false;
+    async_event_t evt;
+    for (uint32_t i = 0; i < budget && queue_pop(p_queue, &evt); ++i)
+    {
+        async_event_execute(&evt);
+        got_evt = true;
+    }
+    return got_evt;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void sim_nodes_init(uint32_t count, uint64_t seed)
+{
+    m_prng = seed ? seed : 1;
+    g_sim_node_count = count;
+    g_sim_nodes = calloc(count, sizeof(sim_node_t));
+    if (g_sim_nodes == NULL)
+    {
+        fprintf(stderr, "Out of memory for %u devices\n", count);
+        exit(1);
+    }
+
+    /* every device starts out with the state the core modules were linked with */
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        sim_node_t* p_node = &g_sim_nodes[i];
+        p_node->p_state = malloc(state_size());
+        if (p_node->p_state == NULL)
+        {
+            fprintf(stderr, "Out of memory for %u devices\n", count);
+            exit(1);
+        }
+        memcpy(p_node->p_state, __start_mesh_state, state_size());
+        queue_init(&p_node->rx_queue, RBC_MESH_INTERNAL_RX_EVENT_QUEUE_LENGTH);
+        queue_init(&p_node->ts_queue, RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH);
+        queue_init(&p_node->evt_queue, RBC_MESH_INTERNAL_EVENT_QUEUE_LENGTH);
+        p_node->radio_state = SIM_RADIO_RX;
+    }
+    m_current = NODE_NONE;
+}
+
+void sim_node_enter(uint32_t node)
+{
+    if (node == m_current)
+    {
+        return;
+    }
+    if (m_current != NODE_NONE)
+    {
+        memcpy(g_sim_nodes[m_current].p_state, __start_mesh_state, state_size());
+    }
+    memcpy(__start_mesh_state, g_sim_nodes[node].p_state, state_size());
+    m_current = node;
+}
+
+uint32_t sim_node_current(void)
+{
+    return m_current;
+}
+
+void sim_node_mesh_init(uint32_t node,
+        uint32_t interval_min_us,
+        uint32_t access_addr,
+        uint8_t channel,
+        rbc_mesh_txpower_t tx_power)
+{
+    sim_node_enter(node);
+
+    /* random static address, unique per device */
+    g_sim_ficr.DEVICEADDRTYPE = 1;
+    g_sim_ficr.DEVICEADDR[0] = 0x5EED0000 + node;
+    g_sim_ficr.DEVICEADDR[1] = 0xC000 | (node >> 16);
+    g_sim_ficr.INFO.RAM = 4;
+
+    /* the parts of rbc_mesh_init() that concern the core modules */
+    timer_sch_init();
+    mesh_stats_init();
+    mesh_packet_init();
+    APP_ERROR_CHECK(vh_init(interval_min_us, access_addr, channel, tx_power));
+    vh_on_timeslot_begin();
+}
+
+void sim_node_dispatch(uint32_t node)
+{
+    sim_node_enter(node);
+    sim_node_t* p_node = &g_sim_nodes[node];
+    p_node->dispatch_pending = false;
+
+    /* same priorities and budgets as the event handler IRQ, always in a timeslot */
+    while (true)
+    {
+        bool got_evt = queue_execute(&p_node->rx_queue, RBC_MESH_INTERNAL_RX_EVENT_BUDGET);
+        got_evt |= queue_execute(&p_node->ts_queue, RBC_MESH_INTERNAL_TIMER_EVENT_BUDGET);
+        got_evt |= queue_execute(&p_node->evt_queue, RBC_MESH_INTERNAL_EVENT_BUDGET);
+        if (!got_evt)
+        {
+            break;
+        }
+    }
+}
+
+void sim_node_timer_fire(uint32_t node, uint32_t arg)
+{
+    sim_node_enter(node);
+    sim_node_t* p_node = &g_sim_nodes[node];
+    uint8_t timer = arg & 0xFF;
+    if ((p_node->timers[timer].generation & 0xFFFFFF) != (arg >> 8) ||
+        p_node->timers[timer].cb == NULL)
+    {
+        return; /* aborted or ordered again */
+    }
+
+    timer_callback_t cb = p_node->timers[timer].cb;
+    p_node->timers[timer].cb = NULL;
+    if (p_node->timers[timer].attr & TIMER_ATTR_SYNCHRONOUS)
+    {
+        cb(timer_now());
+    }
+    else
+    {
+        async_event_t evt;
+        evt.type = EVENT_TYPE_TIMER;
+        evt.callback.timer.cb = cb;
+        evt.callback.timer.timestamp = timer_now();
+        event_handler_push(&evt);
+    }
+}
+
+void sim_node_packet_rx(uint32_t node, const mesh_packet_t* p_packet, int8_t rssi)
+{
+    sim_node_enter(node);
+    sim_node_t* p_node = &g_sim_nodes[node];
+
+    mesh_packet_t* p_rx_packet = NULL;
+    if (!mesh_packet_acquire(&p_rx_packet))
+    {
+        p_node->rx_queue_full++;
+        return;
+    }
+    memcpy(p_rx_packet, p_packet, sizeof(mesh_packet_t));
+
+    async_event_t evt;
+    evt.type = EVENT_TYPE_PACKET;
+    evt.callback.packet.payload = (uint8_t*) p_rx_packet;
+    evt.callback.packet.crc = 0;
+    evt.callback.packet.timestamp = timer_now();
+    evt.callback.packet.rssi = (uint8_t) -rssi; /* RSSISAMPLE is the magnitude */
+    if (event_handler_push(&evt) != NRF_SUCCESS)
+    {
+        MESH_STATS_INC(event_queue_drop);
+        mesh_packet_ref_count_dec(p_rx_packet);
+        p_node->rx_queue_full++;
+        return;
+    }
+    p_node->rx_packets++;
+}
+
+uint32_t sim_rand(void)
+{
+    /* xorshift64* */
+    m_prng ^= m_prng >> 12;
+    m_prng ^= m_prng << 25;
+    m_prng ^= m_prng >> 27;
+    return (uint32_t) ((m_prng * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+float sim_randf(void)
+{
+    return (sim_rand() >> 8) / (float) (1 << 24);
+}
+
+/*****************************************************************************
+* Device HAL, for the device in context
+*****************************************************************************/
+uint32_t event_handler_push(async_event_t* p_evt)
+{
+    if (p_evt == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    sim_node_t* p_node = &g_sim_nodes[m_current];
+    sim_evt_queue_t* p_queue;
+    switch (p_evt->type)
+    {
+        case EVENT_TYPE_PACKET:
+            p_queue = &p_node->rx_queue;
+            break;
+        case EVENT_TYPE_TIMER:
+            p_queue = &p_node->ts_queue;
+            break;
+        case EVENT_TYPE_GENERIC:
+        case EVENT_TYPE_SET_FLAG:
+        case EVENT_TYPE_SET_QOS:
+        case EVENT_TYPE_TIMER_SCH:
+            p_queue = &p_node->evt_queue;
+            break;
+        default:
+            return NRF_ERROR_INVALID_PARAM;
+    }
+    uint32_t error_code = queue_push(p_queue, p_evt);
+    if (error_code == NRF_SUCCESS)
+    {
+        dispatch_order(m_current);
+    }
+    return error_code;
+}
+
+void event_handler_critical_section_begin(void)
+{
+}
+
+void event_handler_critical_section_end(void)
+{
+}
+
+timestamp_t timer_now(void)
+{
+    return (timestamp_t) sim_now();
+}
+
+uint32_t timer_order_cb(uint8_t timer,
+        timestamp_t time,
+        timer_callback_t callback,
+        timer_attr_t attr)
+{
+    if (timer >= SIM_TIMER_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    sim_node_t* p_node = &g_sim_nodes[m_current];
+    p_node->timers[timer].cb = callback;
+    p_node->timers[timer].attr = attr;
+    p_node->timers[timer].timestamp = time;
+    p_node->timers[timer].generation++;
+
+    /* the timestamp wraps, take the nearest time it can mean */
+    int32_t delta = (int32_t) (time - timer_now());
+    sim_time_t fire_time = (delta > 0) ? sim_now() + delta : sim_now();
+    sim_sched_push(fire_time, SIM_EVT_TIMER, m_current,
+            timer | ((p_node->timers[timer].generation & 0xFFFFFF) << 8));
+    return NRF_SUCCESS;
+}
+
+uint32_t rand_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t rand_range(uint32_t range)
+{
+    return (range == 0) ? 0 : sim_rand() % range;
+}
+
+uint32_t timeslot_duty_cycle_get(void)
+{
+    return 1000; /* the simulated radio never sleeps */
+}
+
+void timeslot_wakeup_set(timestamp_t timestamp)
+{
+}
+
+uint32_t mesh_gatt_value_set(rbc_mesh_value_handle_t handle, uint8_t* data, uint8_t length)
+{
+    return NRF_SUCCESS;
+}
+
+void mesh_scene_value_rx(rbc_mesh_value_handle_t handle, const uint8_t* p_data, uint8_t length)
+{
+}
+
+uint32_t rbc_mesh_event_push(rbc_mesh_event_t* p_evt)
+{
+    if (p_evt == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    /* the application reads the value right away, no reference needed */
+    if (p_evt->type == RBC_MESH_EVENT_TYPE_NEW_VAL ||
+        p_evt->type == RBC_MESH_EVENT_TYPE_UPDATE_VAL)
+    {
+        sim_value_rx(m_current,
+                p_evt->params.rx.value_handle,
+                p_evt->params.rx.p_data,
+                p_evt->params.rx.data_len);
+    }
+    return NRF_SUCCESS;
+}
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t* p_file_name)
+{
+    fprintf(stderr, "Device %u failed at %llu us: error 0x%x at %s:%u\n",
+            m_current,
+            (unsigned long long) (sim_now() - SIM_TIME_START_US),
+            error_code,
+            p_file_name ? (const char*) p_file_name : "?",
+            line_num);
+    exit(1);
+}
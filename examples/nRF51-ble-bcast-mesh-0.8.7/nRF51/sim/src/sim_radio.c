@@ -0,0 +1,260 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "sim.h"
+#include "transport_control.h"
+#include "mesh_stats.h"
+#include "nrf_error.h"
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+static sim_radio_params_t m_params;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static uint32_t frame_time_us(const mesh_packet_t* p_packet)
+{
+    return (SIM_RADIO_FRAME_OVERHEAD + p_packet->header.length) * SIM_RADIO_US_PER_BYTE;
+}
+
+static uint8_t channel_count(uint8_t channel_map)
+{
+    uint8_t count = 0;
+    for (; channel_map; channel_map &= channel_map - 1)
+    {
+        count++;
+    }
+    return (count == 0) ? 1 : count;
+}
+
+static void neighbours_find(uint32_t node, float range)
+{
+    sim_node_t* p_node = &g_sim_nodes[node];
+    uint32_t size = 8;
+    p_node->p_neighbours = malloc(size * sizeof(sim_neighbour_t));
+    p_node->neighbour_count = 0;
+
+    for (uint32_t i = 0; i < g_sim_node_count; ++i)
+    {
+        if (i == node)
+        {
+            continue;
+        }
+        float dx = g_sim_nodes[i].x - p_node->x;
+        float dy = g_sim_nodes[i].y - p_node->y;
+        float distance = sqrtf(dx * dx + dy * dy);
+        if (distance > range)
+        {
+            continue;
+        }
+        if (p_node->neighbour_count == size)
+        {
+            size *= 2;
+            p_node->p_neighbours = realloc(p_node->p_neighbours, size * sizeof(sim_neighbour_t));
+            if (p_node->p_neighbours == NULL)
+            {
+                fprintf(stderr, "Out of memory for the neighbour lists\n");
+                exit(1);
+            }
+        }
+        sim_neighbour_t* p_neighbour = &p_node->p_neighbours[p_node->neighbour_count++];
+        p_neighbour->node = i;
+        p_neighbour->path_loss = SIM_RADIO_PATH_LOSS_1M_DB +
+            10.0f * m_params.path_loss_exponent * log10f(distance < 1.0f ? 1.0f : distance);
+    }
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void sim_radio_init(const sim_radio_params_t* p_params)
+{
+    m_params = *p_params;
+
+    /* nobody hears anything beyond the range of the strongest transmit power */
+    float range = powf(10.0f,
+            (SIM_RADIO_TX_POWER_MAX_DBM - SIM_RADIO_SENSITIVITY_DBM - SIM_RADIO_PATH_LOSS_1M_DB) /
+            (10.0f * m_params.path_loss_exponent));
+
+    for (uint32_t i = 0; i < g_sim_node_count; ++i)
+    {
+        neighbours_find(i, range);
+    }
+}
+
+void sim_radio_tx_start(uint32_t node)
+{
+    sim_node_t* p_node = &g_sim_nodes[node];
+    const mesh_packet_t* p_packet = &p_node->tx_queue[p_node->tx_head];
+    uint8_t channels = p_node->tx_channels[p_node->tx_head];
+    int8_t tx_power = p_node->tx_power[p_node->tx_head];
+
+    /* the copies on each channel go out back to back, and are modelled as one burst */
+    uint32_t frame_us = frame_time_us(p_packet);
+    uint32_t burst_us = channels * frame_us + (channels - 1) * SIM_RADIO_RAMP_US;
+
+    p_node->radio_state = SIM_RADIO_TX;
+    p_node->tx_packets++;
+    p_node->tx_airtime_us += channels * frame_us;
+    sim_sched_push(sim_now() + burst_us, SIM_EVT_TX_END, node, 0);
+
+    for (uint32_t i = 0; i < p_node->neighbour_count; ++i)
+    {
+        float rssi = tx_power - p_node->p_neighbours[i].path_loss;
+        if (rssi < SIM_RADIO_SENSITIVITY_DBM)
+        {
+            continue;
+        }
+
+        sim_node_t* p_rx = &g_sim_nodes[p_node->p_neighbours[i].node];
+        if (p_rx->radio_state != SIM_RADIO_RX)
+        {
+            p_rx->rx_deaf++;
+            continue;
+        }
+
+        if (p_rx->rx_active)
+        {
+            /* the receiver stays locked onto the first packet, which only
+             * survives if it's sufficiently stronger */
+            if (p_rx->rx_rssi - rssi < m_params.capture_db)
+            {
+                p_rx->rx_corrupt = true;
+            }
+            p_rx->rx_collisions++;
+            continue;
+        }
+
+        p_rx->rx_active = true;
+        p_rx->rx_corrupt = false;
+        p_rx->rx_rssi = (int8_t) rssi;
+        p_rx->rx_token++;
+        memcpy(&p_rx->rx_packet, p_packet, sizeof(mesh_packet_t));
+        sim_sched_push(sim_now() + burst_us, SIM_EVT_RX_END, p_node->p_neighbours[i].node, p_rx->rx_token);
+    }
+}
+
+void sim_radio_tx_end(uint32_t node)
+{
+    sim_node_t* p_node = &g_sim_nodes[node];
+    uint8_t channels = p_node->tx_channels[p_node->tx_head];
+
+    p_node->tx_head = (p_node->tx_head + 1) % RBC_MESH_RADIO_QUEUE_LENGTH;
+    p_node->tx_count--;
+
+    sim_node_enter(node);
+    for (uint32_t i = 0; i < channels; ++i)
+    {
+        MESH_STATS_INC(tx_count);
+    }
+
+    if (p_node->tx_count > 0)
+    {
+        p_node->radio_state = SIM_RADIO_RAMP;
+        sim_sched_push(sim_now() + SIM_RADIO_RAMP_US, SIM_EVT_TX_START, node, 0);
+    }
+    else
+    {
+        p_node->radio_state = SIM_RADIO_RX;
+    }
+}
+
+void sim_radio_rx_end(uint32_t node, uint32_t token)
+{
+    sim_node_t* p_node = &g_sim_nodes[node];
+    if (!p_node->rx_active || p_node->rx_token != token)
+    {
+        return; /* aborted */
+    }
+    p_node->rx_active = false;
+
+    if (p_node->rx_corrupt)
+    {
+        p_node->rx_collisions++;
+    }
+    else if (m_params.loss > 0 && sim_randf() < m_params.loss)
+    {
+        p_node->rx_lost++;
+    }
+    else
+    {
+        sim_node_packet_rx(node, &p_node->rx_packet, p_node->rx_rssi);
+    }
+}
+
+/*****************************************************************************
+* Device HAL, for the device in context
+*****************************************************************************/
+uint32_t tc_tx(mesh_packet_t* p_packet, const tc_tx_config_t* p_config)
+{
+    uint32_t node = sim_node_current();
+    sim_node_t* p_node = &g_sim_nodes[node];
+    if (p_node->tx_count == RBC_MESH_RADIO_QUEUE_LENGTH)
+    {
+        MESH_STATS_INC(radio_queue_drop);
+        return NRF_ERROR_NO_MEM;
+    }
+
+    /* clean packet header before sending */
+    p_packet->header._rfu1 = 0;
+    p_packet->header._rfu2 = 0;
+    p_packet->header._rfu3 = 0;
+
+    uint8_t slot = (p_node->tx_head + p_node->tx_count) % RBC_MESH_RADIO_QUEUE_LENGTH;
+    memcpy(&p_node->tx_queue[slot], p_packet, sizeof(mesh_packet_t));
+    p_node->tx_channels[slot] = channel_count(p_config->channel_map);
+    p_node->tx_power[slot] = (int8_t) p_config->tx_power;
+    p_node->tx_count++;
+
+    if (p_node->radio_state == SIM_RADIO_RX)
+    {
+        if (p_node->rx_active)
+        {
+            /* the radio leaves RX for the transmission */
+            p_node->rx_active = false;
+            p_node->rx_deaf++;
+        }
+        p_node->radio_state = SIM_RADIO_RAMP;
+        sim_sched_push(sim_now() + SIM_RADIO_RAMP_US, SIM_EVT_TX_START, node, 0);
+    }
+    return NRF_SUCCESS;
+}
+
+bool tc_bridge_handle_is_set(rbc_mesh_value_handle_t handle)
+{
+    /* the simulated radio has a single network */
+    return false;
+}
@@ -0,0 +1,146 @@
+/***********************************************************************************
+Copyright (c) Nordic Semiconductor ASA
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+
+  3. Neither the name of Nordic Semiconductor ASA nor the names of other
+  contributors to this software may be used to endorse or promote products
+  derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+************************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "sim.h"
+
+/*****************************************************************************
+* Static globals
+*****************************************************************************/
+/** Binary min-heap of pending events, ordered by time and insertion order. */
+static sim_evt_t*   mp_heap;
+static uint32_t     m_heap_size;
+static uint32_t     m_heap_count;
+static uint64_t     m_order;
+static sim_time_t   m_now;
+
+/*****************************************************************************
+* Static functions
+*****************************************************************************/
+static bool evt_before(const sim_evt_t* p_a, const sim_evt_t* p_b)
+{
+    return (p_a->time < p_b->time ||
+            (p_a->time == p_b->time && p_a->order < p_b->order));
+}
+
+static void evt_swap(uint32_t a, uint32_t b)
+{
+    sim_evt_t temp = mp_heap[a];
+    mp_heap[a] = mp_heap[b];
+    mp_heap[b] = temp;
+}
+
+/*****************************************************************************
+* Interface functions
+*****************************************************************************/
+void sim_sched_init(void)
+{
+    free(mp_heap);
+    m_heap_size = 1024;
+    mp_heap = malloc(m_heap_size * sizeof(sim_evt_t));
+    m_heap_count = 0;
+    m_order = 0;
+    m_now = SIM_TIME_START_US;
+}
+
+void sim_sched_push(sim_time_t time, sim_evt_type_t type, uint32_t node, uint32_t arg)
+{
+    if (m_heap_count == m_heap_size)
+    {
+        m_heap_size *= 2;
+        mp_heap = realloc(mp_heap, m_heap_size * sizeof(sim_evt_t));
+        if (mp_heap == NULL)
+        {
+            fprintf(stderr, "Out of memory for the event queue\n");
+            exit(1);
+        }
+    }
+
+    /* events can't happen in the past */
+    if (time < m_now)
+    {
+        time = m_now;
+    }
+
+    uint32_t i = m_heap_count++;
+    mp_heap[i].time = time;
+    mp_heap[i].order = m_order++;
+    mp_heap[i].type = type;
+    mp_heap[i].node = node;
+    mp_heap[i].arg = arg;
+
+    while (i > 0 && evt_before(&mp_heap[i], &mp_heap[(i - 1) / 2]))
+    {
+        evt_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+bool sim_sched_pop(sim_evt_t* p_evt)
+{
+    if (m_heap_count == 0)
+    {
+        return false;
+    }
+
+    *p_evt = mp_heap[0];
+    mp_heap[0] = mp_heap[--m_heap_count];
+
+    uint32_t i = 0;
+    while (true)
+    {
+        uint32_t first = i;
+        uint32_t left = 2 * i + 1;
+        uint32_t right = 2 * i + 2;
+        if (left < m_heap_count && evt_before(&mp_heap[left], &mp_heap[first]))
+        {
+            first = left;
+        }
+        if (right < m_heap_count && evt_before(&mp_heap[right], &mp_heap[first]))
+        {
+            first = right;
+        }
+        if (first == i)
+        {
+            break;
+        }
+        evt_swap(i, first);
+        i = first;
+    }
+
+    m_now = p_evt->time;
+    return true;
+}
+
+sim_time_t sim_now(void)
+{
+    return m_now;
+}
@@ -35,6 +35,10 @@
 #include "cmsis_os.h"
 #include "nrf51.h"
 #include "nrf51_bitfields.h"
+#ifdef SOFTDEVICE_PRESENT
+#include "nrf_soc.h"
+#include "nrf_sdm.h"
+#endif
 /*----------------------------------------------------------------------------
  *      RTX User configuration part BEGIN
  *---------------------------------------------------------------------------*/
@@ -121,6 +125,22 @@
  #define OS_TICK        1000
 #endif
 
+//   <q> Stop the RTX Timer tick when idle
+//   <i> When all threads are waiting, the idle demon stops the tick, sleeps until
+//   <i> the next RTX timeout or interrupt, and advances the kernel time by the
+//   <i> sleep duration on wakeup.
+#ifndef OS_TICKLESS_IDLE
+ #define OS_TICKLESS_IDLE 1
+#endif
+
+//   <o>Minimum tickless idle duration [ticks] <2-1000>
+//   <i> Shorter idle periods keep the tick running, as the RTC compare needs a
+//   <i> margin of 2 counts to be sure to trigger.
+//   <i> Default: 3
+#ifndef OS_TICKLESS_MIN
+ #define OS_TICKLESS_MIN 3
+#endif
+
 // </h>
 
 // <h>System Configuration
@@ -214,49 +234,77 @@
 
 /*--------------------------- os_idle_demon ---------------------------------*/
 #define TIMER_MASK 0xFFFFFF
-volatile unsigned int rtos_suspend;
+
+// Sleep until an interrupt is pended, including the interrupts disabled in the
+// NVIC, like the kernel timer one while the scheduler is suspended.
+static void idle_wait (void)
+{
+#ifdef SOFTDEVICE_PRESENT
+    uint8_t sd_enabled = 0;
+
+    (void)sd_softdevice_is_enabled(&sd_enabled);
+    if (sd_enabled)
+    {
+        (void)sd_app_evt_wait();
+        return;
+    }
+#endif
+    __WFE();
+    __SEV();
+    __WFE();
+}
 
 void os_idle_demon (void)
 {
-    unsigned int expected_time;
-    unsigned int prev_time;
+#if (OS_TICKLESS_IDLE == 1) && (OS_SYSTICK == 0)
+    uint32_t sleep_ticks;
+    uint32_t start;
+    uint32_t now;
+#endif
+
+    SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
 
     for (;; )
     {
-        rtos_suspend   = 1;
-        expected_time  = os_suspend();
-        expected_time &= TIMER_MASK;
-
-        if (expected_time > 2)
+#if (OS_TICKLESS_IDLE == 1) && (OS_SYSTICK == 0)
+        // The scheduler and the kernel timer interrupt are locked until os_resume().
+        sleep_ticks = os_suspend();
+        if (sleep_ticks < OS_TICKLESS_MIN)
         {
-            prev_time       = NRF_RTC1->COUNTER;
-            expected_time  += prev_time;
-            NRF_RTC1->CC[0] =
-                (expected_time > TIMER_MASK) ? expected_time - TIMER_MASK : expected_time;
-            NRF_RTC1->INTENCLR = RTC_INTENSET_TICK_Msk;
-
-            NVIC_EnableIRQ(RTC1_IRQn);
-            __disable_irq();
-
-            if (rtos_suspend)
-            {
-                NRF_RTC1->INTENSET = RTC_INTENSET_COMPARE0_Msk;
-                __WFI();
-                NRF_RTC1->EVENTS_COMPARE[0] = 0;
-                NRF_RTC1->INTENCLR          = RTC_INTENSET_COMPARE0_Msk;
-            }
-            __enable_irq();
-            NRF_RTC1->INTENSET = RTC_INTENSET_TICK_Msk;
-
-            expected_time = NRF_RTC1->COUNTER;
-            expected_time = (expected_time >= prev_time)
-                            ? expected_time - prev_time : TIMER_MASK - prev_time + expected_time;
+            os_resume(0);
+            idle_wait();
+            continue;
         }
-        os_resume(expected_time);
+
+        start           = NRF_RTC1->COUNTER;
+        NRF_RTC1->CC[0] = (start + sleep_ticks) & TIMER_MASK;
+        NRF_RTC1->EVENTS_COMPARE[0] = 0;
+        NRF_RTC1->INTENCLR = RTC_INTENSET_TICK_Msk;
+        NRF_RTC1->INTENSET = RTC_INTENSET_COMPARE0_Msk;
+
+        // Any interrupt ends the sleep, a thread may have been made ready.
+        idle_wait();
+
+        NRF_RTC1->INTENCLR          = RTC_INTENSET_COMPARE0_Msk;
+        NRF_RTC1->EVENTS_COMPARE[0] = 0;
+
+        // The TICK events of the sleep are compensated here, not by the handler.
+        // A tick between the clear and the read would be counted twice.
+        do
+        {
+            NRF_RTC1->EVENTS_TICK = 0;
+            now = NRF_RTC1->COUNTER;
+        } while (NRF_RTC1->EVENTS_TICK != 0);
+        NVIC_ClearPendingIRQ(RTC1_IRQn);
+        NRF_RTC1->INTENSET = RTC_INTENSET_TICK_Msk;
+
+        os_resume((now - start) & TIMER_MASK);
+#else
+        idle_wait();
+#endif
     }
 }
 
-
 #if (OS_SYSTICK == 0)   // Functions for alternative timer as RTX kernel timer
 
 /*--------------------------- os_tick_init ----------------------------------*/
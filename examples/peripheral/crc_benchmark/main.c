@@ -0,0 +1,204 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ * @defgroup crc_benchmark_example_main main.c
+ * @{
+ * @ingroup crc_benchmark_example
+ * @brief CRC Benchmark Example Application main file.
+ *
+ * Measures the throughput of the bitwise, table driven and slice-by-4 implementations of
+ * crc16_compute() and crc32_compute() with TIMER0, and prints the results on the UART. The
+ * implementations are normally selected at build time with CRC16_IMPL and CRC32_IMPL, so each
+ * is compiled into this file under its own name.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "app_uart.h"
+#include "app_error.h"
+#include "nrf_delay.h"
+#include "nrf.h"
+#include "bsp.h"
+
+#define CRC16_IMPL      CRC16_IMPL_BITWISE
+#define crc16_compute   crc16_compute_bitwise
+#include "crc16.c"
+#undef crc16_compute
+#undef CRC16_IMPL
+
+#define CRC16_IMPL      CRC16_IMPL_TABLE
+#define crc16_compute   crc16_compute_table
+#define m_crc16_table   m_crc16_table_single
+#include "crc16.c"
+#undef m_crc16_table
+#undef CRC16_TABLE_COUNT
+#undef crc16_compute
+#undef CRC16_IMPL
+
+#define CRC16_IMPL      CRC16_IMPL_SLICE_BY_4
+#define crc16_compute   crc16_compute_slice_by_4
+#include "crc16.c"
+#undef crc16_compute
+
+#define CRC32_IMPL      CRC32_IMPL_BITWISE
+#define crc32_compute   crc32_compute_bitwise
+#include "crc32.c"
+#undef crc32_compute
+#undef CRC32_IMPL
+
+#define CRC32_IMPL      CRC32_IMPL_TABLE
+#define crc32_compute   crc32_compute_table
+#define m_crc32_table   m_crc32_table_single
+#include "crc32.c"
+#undef m_crc32_table
+#undef CRC32_TABLE_COUNT
+#undef crc32_compute
+#undef CRC32_IMPL
+
+#define CRC32_IMPL      CRC32_IMPL_SLICE_BY_4
+#define crc32_compute   crc32_compute_slice_by_4
+#include "crc32.c"
+#undef crc32_compute
+
+#define UART_TX_BUF_SIZE 256                         /**< UART TX buffer size. */
+#define UART_RX_BUF_SIZE 1                           /**< UART RX buffer size. */
+
+#define BENCH_DATA_SIZE  4096                        /**< Size of the block the CRCs are computed over, e.g. a part of a DFU image. */
+#define TIMER_FREQ_HZ    16000000                    /**< TIMER0 frequency with prescaler 0. */
+
+typedef uint16_t (*crc16_func_t)(const uint8_t * p_data, uint32_t size, const uint16_t * p_crc);
+typedef uint32_t (*crc32_func_t)(uint8_t const * p_data, uint32_t size, uint32_t const * p_crc);
+
+static uint8_t m_data[BENCH_DATA_SIZE];
+
+void uart_error_handle(app_uart_evt_t * p_event)
+{
+    if (p_event->evt_type == APP_UART_COMMUNICATION_ERROR)
+    {
+        APP_ERROR_HANDLER(p_event->data.error_communication);
+    }
+    else if (p_event->evt_type == APP_UART_FIFO_ERROR)
+    {
+        APP_ERROR_HANDLER(p_event->data.error_code);
+    }
+}
+
+
+/** @brief Function for starting the HF crystal and TIMER0 as a free running 32 bit counter.
+ */
+static void timer_init(void)
+{
+    NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
+    NRF_CLOCK->TASKS_HFCLKSTART    = 1;
+    while (NRF_CLOCK->EVENTS_HFCLKSTARTED == 0)
+    {
+        // Do nothing.
+    }
+
+    NRF_TIMER0->MODE      = TIMER_MODE_MODE_Timer;
+    NRF_TIMER0->BITMODE   = TIMER_BITMODE_BITMODE_32Bit;
+    NRF_TIMER0->PRESCALER = 0;
+    NRF_TIMER0->TASKS_CLEAR = 1;
+    NRF_TIMER0->TASKS_START = 1;
+}
+
+
+static uint32_t timer_ticks_get(void)
+{
+    NRF_TIMER0->TASKS_CAPTURE[0] = 1;
+    return NRF_TIMER0->CC[0];
+}
+
+
+static void result_print(const char * p_name, uint32_t ticks, uint32_t crc)
+{
+    // bytes/s = size * TIMER_FREQ_HZ / ticks, split up to stay within 32 bits.
+    uint32_t kbytes_per_s = (BENCH_DATA_SIZE * (TIMER_FREQ_HZ / 1000)) / ticks;
+
+    printf("%-18s %8lu us %6lu kB/s  crc 0x%08lx\r\n",
+           p_name,
+           (unsigned long)(ticks / (TIMER_FREQ_HZ / 1000000)),
+           (unsigned long)kbytes_per_s,
+           (unsigned long)crc);
+}
+
+
+static void crc16_bench(const char * p_name, crc16_func_t compute)
+{
+    uint32_t start = timer_ticks_get();
+    uint16_t crc   = compute(m_data, BENCH_DATA_SIZE, NULL);
+
+    result_print(p_name, timer_ticks_get() - start, crc);
+}
+
+
+static void crc32_bench(const char * p_name, crc32_func_t compute)
+{
+    uint32_t start = timer_ticks_get();
+    uint32_t crc   = compute(m_data, BENCH_DATA_SIZE, NULL);
+
+    result_print(p_name, timer_ticks_get() - start, crc);
+}
+
+
+/**
+ * @brief Function for main application entry.
+ */
+int main(void)
+{
+    uint32_t err_code;
+    uint32_t seed = 1;
+    const app_uart_comm_params_t comm_params =
+      {
+          RX_PIN_NUMBER,
+          TX_PIN_NUMBER,
+          RTS_PIN_NUMBER,
+          CTS_PIN_NUMBER,
+          APP_UART_FLOW_CONTROL_ENABLED,
+          false,
+          UART_BAUDRATE_BAUDRATE_Baud38400
+      };
+
+    APP_UART_FIFO_INIT(&comm_params,
+                         UART_RX_BUF_SIZE,
+                         UART_TX_BUF_SIZE,
+                         uart_error_handle,
+                         APP_IRQ_PRIORITY_LOW,
+                         err_code);
+
+    APP_ERROR_CHECK(err_code);
+
+    timer_init();
+
+    for (uint32_t i = 0; i < BENCH_DATA_SIZE; i++)
+    {
+        seed      = seed * 1103515245 + 12345;
+        m_data[i] = (uint8_t)(seed >> 16);
+    }
+
+    printf("\r\nCRC benchmark, %d bytes\r\n", BENCH_DATA_SIZE);
+    while (true)
+    {
+        crc16_bench("crc16 bitwise", crc16_compute_bitwise);
+        crc16_bench("crc16 table", crc16_compute_table);
+        crc16_bench("crc16 slice-by-4", crc16_compute_slice_by_4);
+        crc32_bench("crc32 bitwise", crc32_compute_bitwise);
+        crc32_bench("crc32 table", crc32_compute_table);
+        crc32_bench("crc32 slice-by-4", crc32_compute_slice_by_4);
+        printf("\r\n");
+        nrf_delay_ms(1000);
+    }
+}
+
+/** @} */
@@ -0,0 +1,165 @@
+/* Copyright (c) 2015 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ * @defgroup sha256_benchmark_example_main main.c
+ * @{
+ * @ingroup sha256_benchmark_example
+ * @brief SHA-256 Benchmark Example Application main file.
+ *
+ * Hashes 100 kB of flash, the size of a typical application image, with the sha256 module and
+ * prints the cycles per byte on the UART. The image is hashed once in a single call, and once in
+ * 16 byte calls like the DFU transfer does with each segment. TIMER0 runs from the 16 MHz HF
+ * clock, the same as the nRF51 CPU, so its ticks are CPU cycles.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "app_uart.h"
+#include "app_error.h"
+#include "nrf_delay.h"
+#include "nrf.h"
+#include "bsp.h"
+#include "sha256.h"
+
+#define UART_TX_BUF_SIZE   256                       /**< UART TX buffer size. */
+#define UART_RX_BUF_SIZE   1                         /**< UART RX buffer size. */
+
+#define BENCH_FLASH_START  0x00001000                /**< Start of the flash region to hash. */
+#define BENCH_FLASH_SIZE   (100 * 1024)              /**< Size of the flash region to hash. */
+#define BENCH_CHUNK_SIZE   16                        /**< Data per call in the chunked run, the size of a DFU segment. */
+
+void uart_error_handle(app_uart_evt_t * p_event)
+{
+    if (p_event->evt_type == APP_UART_COMMUNICATION_ERROR)
+    {
+        APP_ERROR_HANDLER(p_event->data.error_communication);
+    }
+    else if (p_event->evt_type == APP_UART_FIFO_ERROR)
+    {
+        APP_ERROR_HANDLER(p_event->data.error_code);
+    }
+}
+
+
+/** @brief Function for starting the HF crystal and TIMER0 as a free running 32 bit counter.
+ */
+static void timer_init(void)
+{
+    NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
+    NRF_CLOCK->TASKS_HFCLKSTART    = 1;
+    while (NRF_CLOCK->EVENTS_HFCLKSTARTED == 0)
+    {
+        // Do nothing.
+    }
+
+    NRF_TIMER0->MODE      = TIMER_MODE_MODE_Timer;
+    NRF_TIMER0->BITMODE   = TIMER_BITMODE_BITMODE_32Bit;
+    NRF_TIMER0->PRESCALER = 0;
+    NRF_TIMER0->TASKS_CLEAR = 1;
+    NRF_TIMER0->TASKS_START = 1;
+}
+
+
+static uint32_t timer_ticks_get(void)
+{
+    NRF_TIMER0->TASKS_CAPTURE[0] = 1;
+    return NRF_TIMER0->CC[0];
+}
+
+
+static void result_print(const char * p_name, uint32_t cycles, const uint8_t * p_hash)
+{
+    uint32_t centi_cycles_per_byte = (uint32_t)(((uint64_t)cycles * 100) / BENCH_FLASH_SIZE);
+
+    printf("%-10s %9lu cycles %3lu.%02lu cycles/byte  hash %02x%02x%02x%02x...\r\n",
+           p_name,
+           (unsigned long)cycles,
+           (unsigned long)(centi_cycles_per_byte / 100),
+           (unsigned long)(centi_cycles_per_byte % 100),
+           p_hash[0], p_hash[1], p_hash[2], p_hash[3]);
+}
+
+
+static void bench_single(void)
+{
+    sha256_context_t ctx;
+    uint8_t          hash[32];
+    uint32_t         start = timer_ticks_get();
+
+    APP_ERROR_CHECK(sha256_init(&ctx));
+    APP_ERROR_CHECK(sha256_update(&ctx, (const uint8_t *)BENCH_FLASH_START, BENCH_FLASH_SIZE));
+    APP_ERROR_CHECK(sha256_final(&ctx, hash));
+
+    result_print("single", timer_ticks_get() - start, hash);
+}
+
+
+static void bench_chunked(void)
+{
+    sha256_context_t ctx;
+    uint8_t          hash[32];
+    uint32_t         start = timer_ticks_get();
+
+    APP_ERROR_CHECK(sha256_init(&ctx));
+    for (uint32_t offset = 0; offset < BENCH_FLASH_SIZE; offset += BENCH_CHUNK_SIZE)
+    {
+        APP_ERROR_CHECK(sha256_update(&ctx,
+                                      (const uint8_t *)(BENCH_FLASH_START + offset),
+                                      BENCH_CHUNK_SIZE));
+    }
+    APP_ERROR_CHECK(sha256_final(&ctx, hash));
+
+    result_print("chunked", timer_ticks_get() - start, hash);
+}
+
+
+/**
+ * @brief Function for main application entry.
+ */
+int main(void)
+{
+    uint32_t err_code;
+    const app_uart_comm_params_t comm_params =
+      {
+          RX_PIN_NUMBER,
+          TX_PIN_NUMBER,
+          RTS_PIN_NUMBER,
+          CTS_PIN_NUMBER,
+          APP_UART_FLOW_CONTROL_ENABLED,
+          false,
+          UART_BAUDRATE_BAUDRATE_Baud38400
+      };
+
+    APP_UART_FIFO_INIT(&comm_params,
+                         UART_RX_BUF_SIZE,
+                         UART_TX_BUF_SIZE,
+                         uart_error_handle,
+                         APP_IRQ_PRIORITY_LOW,
+                         err_code);
+
+    APP_ERROR_CHECK(err_code);
+
+    timer_init();
+
+    printf("\r\nSHA-256 benchmark, %d bytes\r\n", BENCH_FLASH_SIZE);
+    while (true)
+    {
+        bench_single();
+        bench_chunked();
+        printf("\r\n");
+        nrf_delay_ms(1000);
+    }
+}
+
+/** @} */
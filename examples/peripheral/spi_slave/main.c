@@ -27,8 +27,17 @@
 #include <stdint.h>
 
 #define APP_TIMER_PRESCALER      0                     /**< Value of the RTC1 PRESCALER register. */
+#if SPI_SLAVE_BENCHMARK
+#define APP_TIMER_MAX_TIMERS     (BSP_APP_TIMERS_NUMBER + 1) /**< Maximum number of simultaneously created timers. */
+#define APP_TIMER_OP_QUEUE_SIZE  3                           /**< Size of timer operation queues. */
+#define RATE_SAMPLE_INTERVAL     APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER) /**< Transaction rate sampling interval (ticks). */
+
+static app_timer_id_t    m_rate_timer_id;       /**< Transaction rate sampling timer. */
+static volatile uint32_t m_xfer_rate;           /**< Transactions per second, last sampled. */
+#else
 #define APP_TIMER_MAX_TIMERS     BSP_APP_TIMERS_NUMBER /**< Maximum number of simultaneously created timers. */
 #define APP_TIMER_OP_QUEUE_SIZE  2                     /**< Size of timer operation queues. */
+#endif
 
 
 /**@brief Function for initializing bsp module.
@@ -52,6 +61,40 @@ void bsp_configuration()
     APP_ERROR_CHECK(err_code);
 }
 
+#if SPI_SLAVE_BENCHMARK
+/**@brief Function for handling the transaction rate sampling timer timeout.
+ *
+ * @param[in] p_context Not used.
+ */
+static void rate_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+    
+    m_xfer_rate = spi_slave_example_rate_sample();
+    
+    // LED1 blinks once per second while transactions are coming in.
+    if (m_xfer_rate != 0)
+    {
+        uint32_t err_code = bsp_indication_set(BSP_INDICATE_RCV_OK);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for starting the transaction rate sampling timer.
+ */
+static void rate_timer_start(void)
+{
+    uint32_t err_code;
+    
+    err_code = app_timer_create(&m_rate_timer_id, APP_TIMER_MODE_REPEATED, rate_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+    
+    err_code = app_timer_start(m_rate_timer_id, RATE_SAMPLE_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
 /**@brief Function for application main entry. Does not return.
  */ 
 int main(void)
@@ -62,6 +105,10 @@ int main(void)
     const uint32_t err_code = spi_slave_example_init();
     APP_ERROR_CHECK(err_code);
     
+#if SPI_SLAVE_BENCHMARK
+    rate_timer_start();
+#endif
+    
     // Enter application main processing loop.
     for (;;)
     {
@@ -13,6 +13,8 @@
 #include "spi_slave_example.h"
 #include "spi_slave.h"
 #include "app_error.h"
+#include "app_util.h"
+#include "app_util_platform.h"
 #include "bsp.h"
 
 #define TX_BUF_SIZE   16u               /**< SPI TX buffer size. */      
@@ -20,8 +22,15 @@
 #define DEF_CHARACTER 0xAAu             /**< SPI default character. Character clocked out in case of an ignored transaction. */      
 #define ORC_CHARACTER 0x55u             /**< SPI over-read character. Character clocked out after an over-read of the transmit buffer. */      
 
+#if SPI_SLAVE_BENCHMARK
+static uint8_t           m_tx_bufs[2][TX_BUF_SIZE]; /**< SPI TX buffers, used in turn. */
+static uint8_t           m_rx_bufs[2][RX_BUF_SIZE]; /**< SPI RX buffers, used in turn. */
+static volatile uint32_t m_xfer_count;              /**< Number of transactions since the last sample. */
+static uint32_t          m_xfer_rate;               /**< Last sampled number of transactions. */
+#else
 static uint8_t m_tx_buf[TX_BUF_SIZE];   /**< SPI TX buffer. */      
 static uint8_t m_rx_buf[RX_BUF_SIZE];   /**< SPI RX buffer. */          
+#endif
 
 /**@brief Function for initializing buffers.
  *
@@ -39,6 +48,7 @@ static __INLINE void spi_slave_buffers_init(uint8_t * const p_tx_buf, uint8_t *
     }
 }
 
+#if !SPI_SLAVE_BENCHMARK
 /**@brief Function for checking if received data is valid.
  *
  * @param[in] p_rx_buf  Pointer to a receive  buffer.
@@ -88,6 +98,45 @@ static void spi_slave_event_handle(spi_slave_evt_t event)
     }
 }
 
+#else
+/**@brief Function for SPI slave event callback in benchmark mode.
+ *
+ * Upon receiving an SPI transaction complete event, the transaction is counted and the buffers 
+ * it used are queued again, behind the buffers that were armed in the meantime. The last sampled 
+ * rate is written to the first bytes of the TX buffer, for the master to read.
+ *
+ * @param[in] event SPI slave driver event.
+ */
+static void spi_slave_event_handle(spi_slave_evt_t event)
+{
+    uint32_t err_code;
+    
+    if (event.evt_type == SPI_SLAVE_XFER_DONE)
+    {
+        m_xfer_count++;
+        
+        (void)uint32_encode(m_xfer_rate, event.p_tx_buf);
+        
+        //Queue buffers.
+        err_code = spi_slave_buffers_queue(event.p_tx_buf, event.p_rx_buf, TX_BUF_SIZE, RX_BUF_SIZE);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+uint32_t spi_slave_example_rate_sample(void)
+{
+    uint32_t count;
+    
+    CRITICAL_REGION_ENTER();
+    count        = m_xfer_count;
+    m_xfer_count = 0;
+    CRITICAL_REGION_EXIT();
+    
+    m_xfer_rate = count;
+    return count;
+}
+#endif // SPI_SLAVE_BENCHMARK
+
 /**@brief Function for initializing SPI slave.
  *
  *  Function configures a SPI slave and sets buffers.
@@ -114,12 +163,25 @@ uint32_t spi_slave_example_init(void)
     err_code = spi_slave_init(&spi_slave_config);
     APP_ERROR_CHECK(err_code);
     
+#if SPI_SLAVE_BENCHMARK
+    //Initialize buffers.
+    spi_slave_buffers_init(m_tx_bufs[0], m_rx_bufs[0], (uint16_t)TX_BUF_SIZE);
+    spi_slave_buffers_init(m_tx_bufs[1], m_rx_bufs[1], (uint16_t)TX_BUF_SIZE);
+    
+    //Set the first buffers, and queue the second ones behind them.
+    err_code = spi_slave_buffers_set(m_tx_bufs[0], m_rx_bufs[0], TX_BUF_SIZE, RX_BUF_SIZE);
+    APP_ERROR_CHECK(err_code);
+    
+    err_code = spi_slave_buffers_queue(m_tx_bufs[1], m_rx_bufs[1], TX_BUF_SIZE, RX_BUF_SIZE);
+    APP_ERROR_CHECK(err_code);
+#else
     //Initialize buffers.
     spi_slave_buffers_init(m_tx_buf, m_rx_buf, (uint16_t)TX_BUF_SIZE);
     
     //Set buffers.
     err_code = spi_slave_buffers_set(m_tx_buf, m_rx_buf, sizeof(m_tx_buf), sizeof(m_rx_buf));
     APP_ERROR_CHECK(err_code);            
+#endif
 
     return NRF_SUCCESS;
 }
@@ -24,12 +24,31 @@
 
 #include <stdint.h>
 
+/**@brief Set to 1 to run the transaction rate benchmark instead of the buffer check.
+ *
+ * In the benchmark, the SPI slave alternates between two buffer pairs queued with 
+ * @ref spi_slave_buffers_queue, and counts the completed transactions. The first four bytes 
+ * clocked out in every transaction hold the number of transactions in the last second 
+ * (little endian).
+ */
+#ifndef SPI_SLAVE_BENCHMARK
+#define SPI_SLAVE_BENCHMARK 0
+#endif
+
 /**@brief Function for initializing the SPI slave example.
  *
  * @retval NRF_SUCCESS  Operation success.
  */ 
 uint32_t spi_slave_example_init(void);
 
+#if SPI_SLAVE_BENCHMARK
+/**@brief Function for sampling the number of transactions in the benchmark.
+ *
+ * @return Number of transactions completed since the previous call.
+ */
+uint32_t spi_slave_example_rate_sample(void);
+#endif
+
 #endif // SPI_SLAVE_EXAMPLE_H__
 
 /** @} */